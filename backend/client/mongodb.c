@@ -27,29 +27,59 @@
 
 #include <julea.h>
 
-static mongoc_client_t* backend_connection = NULL;
+struct JMongoDBBatch
+{
+	gchar* namespace;
+	mongoc_client_t* client;
+	mongoc_write_concern_t* write_concern;
+	mongoc_bulk_operation_t* bulk_op;
+	gboolean ordered;
+};
+
+typedef struct JMongoDBBatch JMongoDBBatch;
+
+struct JMongoDBIterator
+{
+	mongoc_client_t* client;
+	mongoc_cursor_t* cursor;
+};
+
+typedef struct JMongoDBIterator JMongoDBIterator;
+
+/**
+ * mongoc_client_t is not thread-safe, each operation pops its own client from the pool.
+ */
+static mongoc_client_pool_t* backend_pool = NULL;
+
+/**
+ * The namespaces whose key index has already been created.
+ */
+static GHashTable* backend_indexes = NULL;
+static GMutex backend_indexes_mutex[1];
 
 static gchar* backend_host = NULL;
 static gchar* backend_database = NULL;
 
 static
 gboolean
-backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
+backend_create_index (mongoc_client_t* client, gchar const* namespace)
 {
 	bson_t command[1];
 	bson_t index[1];
 	bson_t indexes[1];
 	bson_t key[1];
 	bson_t reply[1];
-	mongoc_bulk_operation_t* bulk_op;
-	mongoc_collection_t* m_collection;
 	mongoc_database_t* m_database;
-	mongoc_write_concern_t* write_concern;
 
+	gboolean ret = TRUE;
 	gchar* index_name;
 
-	g_return_val_if_fail(namespace != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
+	g_mutex_lock(backend_indexes_mutex);
+
+	if (g_hash_table_contains(backend_indexes, namespace))
+	{
+		goto end;
+	}
 
 	bson_init(key);
 	bson_append_int32(key, "key", -1, 1);
@@ -69,6 +99,94 @@ backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer*
 	bson_destroy(key);
 	bson_free(index_name);
 
+	m_database = mongoc_client_get_database(client, backend_database);
+	ret = mongoc_database_write_command_with_opts(m_database, command, NULL, reply, NULL);
+	mongoc_database_destroy(m_database);
+
+	bson_destroy(command);
+	bson_destroy(reply);
+
+	/* Creating an existing index succeeds, so it is only remembered once the server acknowledged it. */
+	if (ret)
+	{
+		g_hash_table_add(backend_indexes, g_strdup(namespace));
+	}
+
+end:
+	g_mutex_unlock(backend_indexes_mutex);
+
+	return ret;
+}
+
+static
+mongoc_bulk_operation_t*
+backend_batch_get_bulk_operation (JMongoDBBatch* batch)
+{
+	mongoc_collection_t* m_collection;
+
+	if (batch->bulk_op == NULL)
+	{
+		m_collection = mongoc_client_get_collection(batch->client, backend_database, batch->namespace);
+		batch->bulk_op = mongoc_collection_create_bulk_operation(m_collection, batch->ordered, batch->write_concern);
+		mongoc_collection_destroy(m_collection);
+	}
+
+	return batch->bulk_op;
+}
+
+static
+gboolean
+backend_query (gchar const* namespace, bson_t const* filter, bson_t const* opts, gpointer* data)
+{
+	gboolean ret = FALSE;
+
+	JMongoDBIterator* iterator;
+	mongoc_client_t* client;
+	mongoc_collection_t* m_collection;
+	mongoc_cursor_t* cursor;
+
+	client = mongoc_client_pool_pop(backend_pool);
+
+	m_collection = mongoc_client_get_collection(client, backend_database, namespace);
+	cursor = mongoc_collection_find_with_opts(m_collection, filter, opts, NULL);
+	mongoc_collection_destroy(m_collection);
+
+	if (cursor != NULL)
+	{
+		iterator = g_slice_new(JMongoDBIterator);
+		iterator->client = client;
+		iterator->cursor = cursor;
+
+		ret = TRUE;
+		*data = iterator;
+	}
+	else
+	{
+		mongoc_client_pool_push(backend_pool, client);
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
+{
+	JMongoDBBatch* batch;
+	mongoc_client_t* client;
+	mongoc_write_concern_t* write_concern;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	client = mongoc_client_pool_pop(backend_pool);
+
+	if (!backend_create_index(client, namespace))
+	{
+		mongoc_client_pool_push(backend_pool, client);
+		return FALSE;
+	}
+
 	write_concern = mongoc_write_concern_new();
 
 	if (safety != J_SEMANTICS_SAFETY_NONE)
@@ -85,22 +203,29 @@ backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer*
 		mongoc_write_concern_set_w(write_concern, MONGOC_WRITE_CONCERN_W_UNACKNOWLEDGED);
 	}
 
-	/* FIXME cache */
-	m_collection = mongoc_client_get_collection(backend_connection, backend_database, namespace);
-	m_database = mongoc_client_get_database(backend_connection, backend_database);
+	batch = g_slice_new(JMongoDBBatch);
+	batch->namespace = g_strdup(namespace);
+	batch->client = client;
+	batch->write_concern = write_concern;
+	/* The bulk operation is created lazily, allowing the batch to be made unordered first. */
+	batch->bulk_op = NULL;
+	batch->ordered = TRUE;
 
-	mongoc_database_write_command_with_opts(m_database, command, NULL, reply, NULL);
+	*data = batch;
 
-	bulk_op = mongoc_collection_create_bulk_operation(m_collection, FALSE, write_concern);
+	return TRUE;
+}
 
-	mongoc_collection_destroy(m_collection);
-	mongoc_database_destroy(m_database);
-	mongoc_write_concern_destroy(write_concern);
+static
+gboolean
+backend_batch_set_unordered (gpointer data)
+{
+	JMongoDBBatch* batch = data;
 
-	bson_destroy(command);
-	bson_destroy(reply);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(batch->bulk_op == NULL, FALSE);
 
-	*data = bulk_op;
+	batch->ordered = FALSE;
 
 	return TRUE;
 }
@@ -109,28 +234,26 @@ static
 gboolean
 backend_batch_execute (gpointer data)
 {
-	gboolean ret = FALSE;
+	gboolean ret = TRUE;
 
 	bson_t reply[1];
-	mongoc_bulk_operation_t* bulk_op = data;
+	JMongoDBBatch* batch = data;
 
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	ret = mongoc_bulk_operation_execute(bulk_op, reply, NULL);
-
-	/*
-	if (!ret)
+	if (batch->bulk_op != NULL)
 	{
-		bson_t error[1];
+		ret = mongoc_bulk_operation_execute(batch->bulk_op, reply, NULL);
 
-		mongo_cmd_get_last_error(mongo_connection, store->name, error);
-		bson_print(error);
-		bson_destroy(error);
+		mongoc_bulk_operation_destroy(batch->bulk_op);
+		bson_destroy(reply);
 	}
-	*/
 
-	mongoc_bulk_operation_destroy(bulk_op);
-	bson_destroy(reply);
+	mongoc_client_pool_push(backend_pool, batch->client);
+	mongoc_write_concern_destroy(batch->write_concern);
+
+	g_free(batch->namespace);
+	g_slice_free(JMongoDBBatch, batch);
 
 	return ret;
 }
@@ -141,7 +264,7 @@ backend_put (gpointer data, gchar const* key, bson_t const* value)
 {
 	bson_t document[1];
 	bson_t selector[1];
-	mongoc_bulk_operation_t* bulk_op = data;
+	mongoc_bulk_operation_t* bulk_op;
 
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
@@ -154,6 +277,8 @@ backend_put (gpointer data, gchar const* key, bson_t const* value)
 	bson_init(selector);
 	bson_append_utf8(selector, "key", -1, key, -1);
 
+	bulk_op = backend_batch_get_bulk_operation(data);
+
 	/* FIXME use insert when possible */
 	//mongoc_bulk_operation_insert(bulk_op, document);
 	mongoc_bulk_operation_replace_one(bulk_op, selector, document, TRUE);
@@ -180,7 +305,7 @@ gboolean
 backend_delete (gpointer data, gchar const* key)
 {
 	bson_t document[1];
-	mongoc_bulk_operation_t* bulk_op = data;
+	mongoc_bulk_operation_t* bulk_op;
 
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
@@ -188,6 +313,7 @@ backend_delete (gpointer data, gchar const* key)
 	bson_init(document);
 	bson_append_utf8(document, "key", -1, key, -1);
 
+	bulk_op = backend_batch_get_bulk_operation(data);
 	mongoc_bulk_operation_remove(bulk_op, document);
 
 	bson_destroy(document);
@@ -204,6 +330,7 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 	bson_t document[1];
 	bson_t opts[1];
 	bson_t const* result;
+	mongoc_client_t* client;
 	mongoc_collection_t* m_collection;
 	mongoc_cursor_t* cursor;
 
@@ -217,7 +344,8 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 	bson_init(opts);
 	bson_append_int32(opts, "limit", -1, 1);
 
-	m_collection = mongoc_client_get_collection(backend_connection, backend_database, namespace);
+	client = mongoc_client_pool_pop(backend_pool);
+	m_collection = mongoc_client_get_collection(client, backend_database, namespace);
 	cursor = mongoc_collection_find_with_opts(m_collection, document, opts, NULL);
 
 	while (mongoc_cursor_next(cursor, &result))
@@ -244,6 +372,7 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 
 	mongoc_cursor_destroy(cursor);
 	mongoc_collection_destroy(m_collection);
+	mongoc_client_pool_push(backend_pool, client);
 
 	return ret;
 }
@@ -255,24 +384,13 @@ backend_get_all (gchar const* namespace, gpointer* data)
 	gboolean ret = FALSE;
 
 	bson_t document[1];
-	mongoc_collection_t* m_collection;
-	mongoc_cursor_t* cursor;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	bson_init(document);
 
-	m_collection = mongoc_client_get_collection(backend_connection, backend_database, namespace);
-	cursor = mongoc_collection_find_with_opts(m_collection, document, NULL, NULL);
-
-	if (cursor != NULL)
-	{
-		ret = TRUE;
-		*data = cursor;
-	}
-
-	mongoc_collection_destroy(m_collection);
+	ret = backend_query(namespace, document, NULL, data);
 
 	bson_destroy(document);
 
@@ -286,8 +404,6 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 	gboolean ret = FALSE;
 
 	bson_t document[1];
-	mongoc_collection_t* m_collection;
-	mongoc_cursor_t* cursor;
 	g_autofree gchar* escaped_prefix = NULL;
 	g_autofree gchar* regex_prefix = NULL;
 
@@ -301,17 +417,57 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 	bson_init(document);
 	bson_append_regex(document, "key", -1, regex_prefix, NULL);
 
-	m_collection = mongoc_client_get_collection(backend_connection, backend_database, namespace);
-	cursor = mongoc_collection_find_with_opts(m_collection, document, NULL, NULL);
+	ret = backend_query(namespace, document, NULL, data);
 
-	if (cursor != NULL)
+	bson_destroy(document);
+
+	return ret;
+}
+
+static
+gboolean
+backend_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
+{
+	gboolean ret = FALSE;
+
+	bson_t document[1];
+	bson_t key[1];
+	bson_t opts[1];
+	bson_t sort[1];
+	g_autofree gchar* escaped_prefix = NULL;
+	g_autofree gchar* regex_prefix = NULL;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	escaped_prefix = g_regex_escape_string(prefix, -1);
+	regex_prefix = g_strdup_printf("^%s", escaped_prefix);
+
+	bson_init(document);
+	bson_append_document_begin(document, "key", -1, key);
+	bson_append_regex(key, "$regex", -1, regex_prefix, NULL);
+
+	if (start_after != NULL)
 	{
-		ret = TRUE;
-		*data = cursor;
+		bson_append_utf8(key, "$gt", -1, start_after, -1);
 	}
 
-	mongoc_collection_destroy(m_collection);
+	bson_append_document_end(document, key);
+
+	bson_init(opts);
+	bson_append_document_begin(opts, "sort", -1, sort);
+	bson_append_int32(sort, "key", -1, 1);
+	bson_append_document_end(opts, sort);
+
+	if (limit > 0)
+	{
+		bson_append_int64(opts, "limit", -1, limit);
+	}
+
+	ret = backend_query(namespace, document, opts, data);
 
+	bson_destroy(opts);
 	bson_destroy(document);
 
 	return ret;
@@ -319,20 +475,28 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 
 static
 gboolean
-backend_iterate (gpointer data, bson_t* result_out)
+backend_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
 {
 	bson_t const* result;
 	bson_iter_t iter;
-	mongoc_cursor_t* cursor = data;
+	JMongoDBIterator* iterator = data;
 
 	gboolean ret = FALSE;
 
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key_out != NULL, FALSE);
 	g_return_val_if_fail(result_out != NULL, FALSE);
 
 	/* FIXME */
-	if (mongoc_cursor_next(cursor, &result))
+	if (mongoc_cursor_next(iterator->cursor, &result))
 	{
+		*key_out = "";
+
+		if (bson_iter_init_find(&iter, result, "key") && BSON_ITER_HOLDS_UTF8(&iter))
+		{
+			*key_out = bson_iter_utf8(&iter, NULL);
+		}
+
 		if (bson_iter_init_find(&iter, result, "value") && bson_iter_type(&iter) == BSON_TYPE_DOCUMENT)
 		{
 			bson_value_t const* value;
@@ -345,7 +509,9 @@ backend_iterate (gpointer data, bson_t* result_out)
 	}
 	else
 	{
-		mongoc_cursor_destroy(cursor);
+		mongoc_cursor_destroy(iterator->cursor);
+		mongoc_client_pool_push(backend_pool, iterator->client);
+		g_slice_free(JMongoDBIterator, iterator);
 	}
 
 	return ret;
@@ -355,6 +521,7 @@ static
 gboolean
 backend_init (gchar const* path)
 {
+	mongoc_client_t* client;
 	mongoc_uri_t* uri;
 
 	gboolean ret = FALSE;
@@ -373,13 +540,17 @@ backend_init (gchar const* path)
 	g_return_val_if_fail(backend_host != NULL, FALSE);
 	g_return_val_if_fail(backend_database != NULL, FALSE);
 
+	backend_indexes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
 	uri = mongoc_uri_new_for_host_port(backend_host, 27017);
-	backend_connection = mongoc_client_new_from_uri(uri);
+	backend_pool = mongoc_client_pool_new(uri);
 	mongoc_uri_destroy(uri);
 
-	if (backend_connection != NULL)
+	if (backend_pool != NULL)
 	{
-		ret = mongoc_client_get_server_status(backend_connection, NULL, NULL, NULL);
+		client = mongoc_client_pool_pop(backend_pool);
+		ret = mongoc_client_get_server_status(client, NULL, NULL, NULL);
+		mongoc_client_pool_push(backend_pool, client);
 	}
 
 	if (!ret)
@@ -394,7 +565,12 @@ static
 void
 backend_fini (void)
 {
-	mongoc_client_destroy(backend_connection);
+	if (backend_pool != NULL)
+	{
+		mongoc_client_pool_destroy(backend_pool);
+	}
+
+	g_hash_table_unref(backend_indexes);
 
 	g_free(backend_database);
 	g_free(backend_host);
@@ -410,11 +586,13 @@ JBackend mongodb_backend = {
 		.fini = backend_fini,
 		.batch_start = backend_batch_start,
 		.batch_execute = backend_batch_execute,
+		.batch_set_unordered = backend_batch_set_unordered,
 		.put = backend_put,
 		.delete = backend_delete,
 		.get = backend_get,
 		.get_all = backend_get_all,
 		.get_by_prefix = backend_get_by_prefix,
+		.get_range = backend_get_range,
 		.iterate = backend_iterate
 	}
 };
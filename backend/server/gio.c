@@ -234,6 +234,20 @@ backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offs
 	return ret;
 }
 
+static
+gboolean
+backend_truncate (gpointer data, guint64 size)
+{
+	JBackendFile* bf = data;
+	gboolean ret;
+
+	j_trace_file_begin(bf->path, J_TRACE_FILE_WRITE);
+	ret = g_seekable_truncate(G_SEEKABLE(bf->stream), size, NULL, NULL);
+	j_trace_file_end(bf->path, J_TRACE_FILE_WRITE, 0, size);
+
+	return ret;
+}
+
 static
 gboolean
 backend_init (gchar const* path)
@@ -269,7 +283,11 @@ JBackend gio_backend = {
 		.status = backend_status,
 		.sync = backend_sync,
 		.read = backend_read,
-		.write = backend_write
+		.write = backend_write,
+		.truncate = backend_truncate,
+		.allocate = NULL,
+		.punch_hole = NULL,
+		.copy = NULL
 	}
 };
 
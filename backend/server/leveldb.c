@@ -23,6 +23,8 @@
 #include <glib.h>
 #include <gmodule.h>
 
+#include <string.h>
+
 #include <leveldb/c.h>
 
 #include <julea.h>
@@ -40,6 +42,11 @@ struct JLevelDBIterator
 {
 	leveldb_iterator_t* iterator;
 	gchar* prefix;
+	/* The length of the namespace prefix, which is stripped from the returned keys. */
+	gsize namespace_len;
+	/* The number of keys that can still be returned, G_MAXUINT32 for no limit. */
+	guint32 remaining;
+	gboolean first;
 };
 
 typedef struct JLevelDBIterator JLevelDBIterator;
@@ -50,6 +57,45 @@ static leveldb_readoptions_t* backend_read_options = NULL;
 static leveldb_writeoptions_t* backend_write_options = NULL;
 static leveldb_writeoptions_t* backend_write_options_sync = NULL;
 
+/* Have to outlive backend_db. */
+static leveldb_cache_t* backend_cache = NULL;
+static leveldb_filterpolicy_t* backend_filter_policy = NULL;
+
+/* The default size of the LRU block cache, LevelDB's own default is 8 MiB. */
+#define JD_BACKEND_CACHE_SIZE (64 * 1024 * 1024)
+
+/* The default number of bits per key used by the bloom filter. */
+#define JD_BACKEND_BLOOM_BITS 10
+
+/*
+ * Parses an option of the form name={value}: and advances path behind it.
+ */
+static
+gboolean
+backend_parse_option (gchar const** path, gchar const* name, guint64* value)
+{
+	g_autofree gchar* prefix = NULL;
+	gchar* end;
+
+	prefix = g_strdup_printf("%s=", name);
+
+	if (!g_str_has_prefix(*path, prefix))
+	{
+		return FALSE;
+	}
+
+	*value = g_ascii_strtoull(*path + strlen(prefix), &end, 10);
+
+	if (*end != ':')
+	{
+		return FALSE;
+	}
+
+	*path = end + 1;
+
+	return TRUE;
+}
+
 static
 gboolean
 backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
@@ -96,22 +142,30 @@ backend_batch_execute (gpointer data)
 
 static
 gboolean
-backend_put (gpointer data, gchar const* key, bson_t const* value)
+backend_put_raw (gpointer data, gchar const* key, gconstpointer value, guint32 len)
 {
 	JLevelDBBatch* batch = data;
 	g_autofree gchar* nskey = NULL;
 
 	g_return_val_if_fail(key != NULL, FALSE);
-	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
-	leveldb_writebatch_put(batch->batch, nskey, strlen(nskey) + 1, (gconstpointer)bson_get_data(value), value->len);
+	leveldb_writebatch_put(batch->batch, nskey, strlen(nskey) + 1, value, len);
 
 	// FIXME
 	return TRUE;
 }
 
+static
+gboolean
+backend_put (gpointer data, gchar const* key, bson_t const* value)
+{
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	return backend_put_raw(data, key, bson_get_data(value), value->len);
+}
+
 static
 gboolean
 backend_delete (gpointer data, gchar const* key)
@@ -158,34 +212,31 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 
 static
 gboolean
-backend_get_all (gchar const* namespace, gpointer* data)
+backend_get_raw (gchar const* namespace, gchar const* key, GBytes** value)
 {
-	JLevelDBIterator* iterator = NULL;
-	leveldb_iterator_t* it;
+	g_autofree gchar* nskey = NULL;
+	gpointer result;
+	gsize result_len;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
 
-	it = leveldb_create_iterator(backend_db, backend_read_options);
+	nskey = g_strdup_printf("%s:%s", namespace, key);
+	result = leveldb_get(backend_db, backend_read_options, nskey, strlen(nskey) + 1, &result_len, NULL);
 
-	if (it != NULL)
+	if (result != NULL)
 	{
-		iterator = g_slice_new(JLevelDBIterator);
-		iterator->iterator = it;
-		iterator->prefix = g_strdup_printf("%s:", namespace);
-
-		// FIXME check +1
-		leveldb_iter_seek(iterator->iterator, iterator->prefix, strlen(iterator->prefix) + 1);
-
-		*data = iterator;
+		/* Take over LevelDB's buffer instead of copying it. */
+		*value = g_bytes_new_with_free_func(result, result_len, leveldb_free, result);
 	}
 
-	return (iterator != NULL);
+	return (result != NULL);
 }
 
 static
 gboolean
-backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+backend_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
 {
 	JLevelDBIterator* iterator = NULL;
 	leveldb_iterator_t* it;
@@ -201,9 +252,36 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 		iterator = g_slice_new(JLevelDBIterator);
 		iterator->iterator = it;
 		iterator->prefix = g_strdup_printf("%s:%s", namespace, prefix);
+		iterator->namespace_len = strlen(namespace) + 1;
+		iterator->remaining = (limit > 0) ? limit : G_MAXUINT32;
+		iterator->first = TRUE;
+
+		if (start_after != NULL && g_strcmp0(start_after, prefix) >= 0)
+		{
+			g_autofree gchar* nskey = NULL;
+
+			/* Keys contain their terminating null byte, so they compare like strings. */
+			nskey = g_strdup_printf("%s:%s", namespace, start_after);
+			leveldb_iter_seek(iterator->iterator, nskey, strlen(nskey) + 1);
+
+			if (leveldb_iter_valid(iterator->iterator))
+			{
+				gchar const* key;
+				gsize len;
 
-		// FIXME check +1
-		leveldb_iter_seek(iterator->iterator, iterator->prefix, strlen(iterator->prefix) + 1);
+				key = leveldb_iter_key(iterator->iterator, &len);
+
+				if (g_strcmp0(key, nskey) == 0)
+				{
+					leveldb_iter_next(iterator->iterator);
+				}
+			}
+		}
+		else
+		{
+			// FIXME check +1
+			leveldb_iter_seek(iterator->iterator, iterator->prefix, strlen(iterator->prefix) + 1);
+		}
 
 		*data = iterator;
 	}
@@ -213,14 +291,37 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 
 static
 gboolean
-backend_iterate (gpointer data, bson_t* result_out)
+backend_get_all (gchar const* namespace, gpointer* data)
+{
+	return backend_get_range(namespace, "", NULL, 0, data);
+}
+
+static
+gboolean
+backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	return backend_get_range(namespace, prefix, NULL, 0, data);
+}
+
+static
+gboolean
+backend_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
 {
 	JLevelDBIterator* iterator = data;
 
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key_out != NULL, FALSE);
 	g_return_val_if_fail(result_out != NULL, FALSE);
 
-	if (leveldb_iter_valid(iterator->iterator))
+	/* Only advance now, moving the iterator invalidates the previously returned key and value. */
+	if (!iterator->first)
+	{
+		leveldb_iter_next(iterator->iterator);
+	}
+
+	iterator->first = FALSE;
+
+	if (iterator->remaining > 0 && leveldb_iter_valid(iterator->iterator))
 	{
 		gchar const* key;
 		gconstpointer value;
@@ -236,9 +337,9 @@ backend_iterate (gpointer data, bson_t* result_out)
 
 		value = leveldb_iter_value(iterator->iterator, &len);
 		bson_init_static(result_out, value, len);
+		*key_out = key + iterator->namespace_len;
 
-		// FIXME might invalidate value
-		leveldb_iter_next(iterator->iterator);
+		iterator->remaining--;
 
 		return TRUE;
 	}
@@ -257,9 +358,26 @@ backend_init (gchar const* path)
 {
 	leveldb_options_t* options;
 	g_autofree gchar* dirname = NULL;
+	guint64 cache_size = JD_BACKEND_CACHE_SIZE;
+	guint64 bloom_bits = JD_BACKEND_BLOOM_BITS;
+	guint64 write_buffer_size = 0;
+	guint64 max_open_files = 0;
+	gboolean parsed;
 
 	g_return_val_if_fail(path != NULL, FALSE);
 
+	/* Path syntax: [cache-size={bytes}:][bloom-bits={bits}:][write-buffer-size={bytes}:][max-open-files={files}:][path]
+	   e.g.: cache-size=268435456:bloom-bits=10:/var/storage/meta
+	   Options set to 0 use LevelDB's defaults, bloom-bits=0 disables the bloom filter. */
+	do
+	{
+		parsed = backend_parse_option(&path, "cache-size", &cache_size)
+			|| backend_parse_option(&path, "bloom-bits", &bloom_bits)
+			|| backend_parse_option(&path, "write-buffer-size", &write_buffer_size)
+			|| backend_parse_option(&path, "max-open-files", &max_open_files);
+	}
+	while (parsed);
+
 	dirname = g_path_get_dirname(path);
 	g_mkdir_with_parents(dirname, 0700);
 
@@ -267,6 +385,29 @@ backend_init (gchar const* path)
 	leveldb_options_set_create_if_missing(options, 1);
 	leveldb_options_set_compression(options, leveldb_snappy_compression);
 
+	if (cache_size > 0)
+	{
+		backend_cache = leveldb_cache_create_lru(cache_size);
+		leveldb_options_set_cache(options, backend_cache);
+	}
+
+	/* Lets lookups of missing keys skip most SSTables. */
+	if (bloom_bits > 0)
+	{
+		backend_filter_policy = leveldb_filterpolicy_create_bloom(bloom_bits);
+		leveldb_options_set_filter_policy(options, backend_filter_policy);
+	}
+
+	if (write_buffer_size > 0)
+	{
+		leveldb_options_set_write_buffer_size(options, write_buffer_size);
+	}
+
+	if (max_open_files > 0)
+	{
+		leveldb_options_set_max_open_files(options, max_open_files);
+	}
+
 	backend_read_options = leveldb_readoptions_create();
 	backend_write_options = leveldb_writeoptions_create();
 	backend_write_options_sync = leveldb_writeoptions_create();
@@ -291,6 +432,16 @@ backend_fini (void)
 	{
 		leveldb_close(backend_db);
 	}
+
+	if (backend_filter_policy != NULL)
+	{
+		leveldb_filterpolicy_destroy(backend_filter_policy);
+	}
+
+	if (backend_cache != NULL)
+	{
+		leveldb_cache_destroy(backend_cache);
+	}
 }
 
 static
@@ -306,7 +457,10 @@ JBackend leveldb_backend = {
 		.get = backend_get,
 		.get_all = backend_get_all,
 		.get_by_prefix = backend_get_by_prefix,
-		.iterate = backend_iterate
+		.get_range = backend_get_range,
+		.iterate = backend_iterate,
+		.put_raw = backend_put_raw,
+		.get_raw = backend_get_raw
 	}
 };
 
@@ -15,7 +15,6 @@
  * You should have received a copy of the GNU Lesser General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-
 #define _POSIX_C_SOURCE 200809L
 
 #include <julea-config.h>
@@ -23,50 +22,310 @@
 #include <glib.h>
 #include <gmodule.h>
 
+#include <string.h>
+
 #include <lmdb.h>
 
 #include <julea.h>
 
+/*
+ * A buffered operation of a batch that spans multiple partitions.
+ */
+struct JLMDBOperation
+{
+	guint partition;
+	gchar* nskey;
+	/* The value, NULL for deletes. */
+	GBytes* value;
+};
+
+typedef struct JLMDBOperation JLMDBOperation;
+
 struct JLMDBBatch
 {
+	/* The write transaction if there is only one partition, NULL otherwise. */
 	MDB_txn* txn;
+	/* The buffered operations if there are multiple partitions, NULL otherwise. */
+	GArray* operations;
 	gchar* namespace;
 	JSemanticsSafety safety;
+	/* The flags used for puts, MDB_APPEND for sorted batches. */
+	guint put_flags;
 };
 
 typedef struct JLMDBBatch JLMDBBatch;
 
-struct JLMDBIterator
+/*
+ * A partition's cursor of an iterator.
+ */
+struct JLMDBIteratorCursor
 {
 	MDB_cursor* cursor;
 	MDB_txn* txn;
-	gboolean first;
+	/* The current key and value, only valid while valid is TRUE. */
+	MDB_val key;
+	MDB_val value;
+	gboolean valid;
+};
+
+typedef struct JLMDBIteratorCursor JLMDBIteratorCursor;
+
+struct JLMDBIterator
+{
+	/* One cursor per partition, their keys are merged in order. */
+	JLMDBIteratorCursor* cursors;
+	/* The cursor whose key has been returned last, -1 before the first call. */
+	gint last;
 	gchar* prefix;
+	/* The key to start at, either the prefix or the key to start after. */
+	gchar* start;
+	/* The length of the namespace prefix, which is stripped from the returned keys. */
+	gsize namespace_len;
+	/* The number of keys that can still be returned, G_MAXUINT32 for no limit. */
+	guint32 remaining;
 };
 
 typedef struct JLMDBIterator JLMDBIterator;
 
-static MDB_env* backend_env = NULL;
-static MDB_dbi backend_dbi;
+/*
+ * An environment with its own writer.
+ * Keys are partitioned across environments by hash, so that writes of different keys can be committed in parallel.
+ */
+struct JLMDBPartition
+{
+	MDB_env* env;
+	MDB_dbi dbi;
+};
+
+typedef struct JLMDBPartition JLMDBPartition;
+
+static JLMDBPartition* backend_partitions = NULL;
+static guint backend_partition_count = 0;
+
+/*
+ * The default map size, which limits the size of the database.
+ * Only address space is reserved, so it can be generous.
+ */
+#define JD_BACKEND_MAP_SIZE (G_GUINT64_CONSTANT(1024) * 1024 * 1024)
+
+/*
+ * The maximum number of concurrent readers, every thread keeps one read transaction.
+ */
+#define JD_BACKEND_MAX_READERS 4096
+
+/*
+ * The maximum number of partitions.
+ */
+#define JD_BACKEND_MAX_PARTITIONS 64
+
+/* All cached read transactions, so that they can be aborted in backend_fini(). */
+static GPtrArray* backend_read_txns = NULL;
+G_LOCK_DEFINE_STATIC(backend_read_txns);
+
+/*
+ * Returns the partition of a key including its namespace.
+ * The hash has to be stable, because keys stay in their partition across restarts.
+ */
+static
+guint
+backend_partition (gchar const* nskey)
+{
+	return j_helper_hash(nskey) % backend_partition_count;
+}
+
+static
+void
+backend_read_txn_destroy (gpointer data)
+{
+	MDB_txn** txns = data;
+
+	G_LOCK(backend_read_txns);
+
+	/* The transactions have already been aborted if the backend has been finalized. */
+	if (backend_read_txns != NULL && g_ptr_array_remove_fast(backend_read_txns, txns))
+	{
+		for (guint i = 0; i < backend_partition_count; i++)
+		{
+			if (txns[i] != NULL)
+			{
+				mdb_txn_abort(txns[i]);
+			}
+		}
+	}
+
+	G_UNLOCK(backend_read_txns);
+
+	g_free(txns);
+}
+
+static GPrivate backend_read_txn = G_PRIVATE_INIT(backend_read_txn_destroy);
+
+/*
+ * Returns the thread's read transaction of a partition.
+ * It is only reset after use, so that later reads only have to renew it instead of allocating a new one.
+ */
+static
+MDB_txn*
+backend_read_txn_begin (guint partition)
+{
+	MDB_txn** txns;
+	MDB_txn* txn;
+
+	if ((txns = g_private_get(&backend_read_txn)) == NULL)
+	{
+		txns = g_new0(MDB_txn*, backend_partition_count);
+
+		G_LOCK(backend_read_txns);
+		g_ptr_array_add(backend_read_txns, txns);
+		G_UNLOCK(backend_read_txns);
+
+		g_private_set(&backend_read_txn, txns);
+	}
+
+	if ((txn = txns[partition]) != NULL)
+	{
+		return (mdb_txn_renew(txn) == 0) ? txn : NULL;
+	}
+
+	if (mdb_txn_begin(backend_partitions[partition].env, NULL, MDB_RDONLY, &txn) != 0)
+	{
+		return NULL;
+	}
+
+	txns[partition] = txn;
+
+	return txn;
+}
+
+static
+void
+backend_read_txn_end (MDB_txn* txn)
+{
+	mdb_txn_reset(txn);
+}
+
+/*
+ * Starts a write transaction of a partition with the flags for the given safety.
+ */
+static
+gboolean
+backend_write_txn_begin (guint partition, JSemanticsSafety safety, MDB_txn** txn)
+{
+	JLMDBPartition* p = &(backend_partitions[partition]);
+	guint flags = 0;
+
+	if (mdb_txn_begin(p->env, NULL, 0, txn) != 0)
+	{
+		return FALSE;
+	}
+
+	/*
+	 * The environment's flags are evaluated when committing.
+	 * Only one write transaction can be active, so they belong to this batch until it has been committed.
+	 */
+	switch (safety)
+	{
+		case J_SEMANTICS_SAFETY_NONE:
+			flags = MDB_NOSYNC;
+			break;
+		case J_SEMANTICS_SAFETY_NETWORK:
+			flags = MDB_NOMETASYNC;
+			break;
+		case J_SEMANTICS_SAFETY_STORAGE:
+		default:
+			break;
+	}
+
+	mdb_env_set_flags(p->env, MDB_NOSYNC | MDB_NOMETASYNC, 0);
+
+	if (flags != 0)
+	{
+		mdb_env_set_flags(p->env, flags, 1);
+	}
+
+	return TRUE;
+}
+
+/*
+ * Applies an operation to a write transaction.
+ */
+static
+gboolean
+backend_write (MDB_txn* txn, guint partition, gchar const* nskey, GBytes* value, guint put_flags)
+{
+	MDB_dbi dbi = backend_partitions[partition].dbi;
+	MDB_val m_key;
+	MDB_val m_value;
+	gint ret;
+
+	m_key.mv_size = strlen(nskey) + 1;
+	m_key.mv_data = (gpointer)nskey;
+
+	if (value == NULL)
+	{
+		return (mdb_del(txn, dbi, &m_key, NULL) == 0);
+	}
+
+	m_value.mv_data = (gpointer)g_bytes_get_data(value, &(m_value.mv_size));
+
+	ret = mdb_put(txn, dbi, &m_key, &m_value, put_flags);
+
+	/* Appending fails for keys that do not sort after all existing ones, for example, if the database already contains a later namespace. */
+	if (ret == MDB_KEYEXIST && put_flags == MDB_APPEND)
+	{
+		ret = mdb_put(txn, dbi, &m_key, &m_value, 0);
+	}
+
+	return (ret == 0);
+}
+
+static
+void
+backend_operation_clear (gpointer data)
+{
+	JLMDBOperation* operation = data;
+
+	g_free(operation->nskey);
+
+	if (operation->value != NULL)
+	{
+		g_bytes_unref(operation->value);
+	}
+}
 
 static
 gboolean
 backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
 {
 	JLMDBBatch* batch = NULL;
-	MDB_txn* txn;
+	MDB_txn* txn = NULL;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	if (mdb_txn_begin(backend_env, NULL, 0, &txn) == 0)
+	/*
+	 * With multiple partitions, operations are buffered and every partition is committed separately.
+	 * This avoids holding the write locks of several partitions at once, which could deadlock with other batches.
+	 */
+	if (backend_partition_count == 1 && !backend_write_txn_begin(0, safety, &txn))
 	{
-		batch = g_slice_new(JLMDBBatch);
-		batch->txn = txn;
-		batch->namespace = g_strdup(namespace);
-		batch->safety = safety;
+		goto end;
 	}
 
+	batch = g_slice_new(JLMDBBatch);
+	batch->txn = txn;
+	batch->operations = NULL;
+	batch->namespace = g_strdup(namespace);
+	batch->safety = safety;
+	batch->put_flags = 0;
+
+	if (backend_partition_count > 1)
+	{
+		batch->operations = g_array_new(FALSE, FALSE, sizeof(JLMDBOperation));
+		g_array_set_clear_func(batch->operations, backend_operation_clear);
+	}
+
+end:
 	*data = batch;
 
 	return (batch != NULL);
@@ -82,14 +341,56 @@ backend_batch_execute (gpointer data)
 
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	// FIXME do something with batch->safety
-
-	if (mdb_txn_commit(batch->txn) == 0)
+	if (batch->txn != NULL)
 	{
-		ret = TRUE;
+		/* Frees the transaction, even if it fails. */
+		if (mdb_txn_commit(batch->txn) == 0)
+		{
+			ret = TRUE;
+		}
 	}
+	else
+	{
+		ret = TRUE;
 
-	// FIXME free txn
+		/* Partitions are committed one after the other, so the batch is only atomic per partition. */
+		for (guint p = 0; p < backend_partition_count; p++)
+		{
+			MDB_txn* txn = NULL;
+			gboolean written = TRUE;
+
+			for (guint i = 0; i < batch->operations->len; i++)
+			{
+				JLMDBOperation* operation = &g_array_index(batch->operations, JLMDBOperation, i);
+
+				if (operation->partition != p)
+				{
+					continue;
+				}
+
+				if (txn == NULL && !backend_write_txn_begin(p, batch->safety, &txn))
+				{
+					written = FALSE;
+					break;
+				}
+
+				/* Deleting non-existent keys is not an error. */
+				if (!backend_write(txn, p, operation->nskey, operation->value, batch->put_flags) && operation->value != NULL)
+				{
+					written = FALSE;
+				}
+			}
+
+			if (txn != NULL)
+			{
+				written = (mdb_txn_commit(txn) == 0) && written;
+			}
+
+			ret = written && ret;
+		}
+
+		g_array_unref(batch->operations);
+	}
 
 	g_free(batch->namespace);
 	g_slice_free(JLMDBBatch, batch);
@@ -99,25 +400,59 @@ backend_batch_execute (gpointer data)
 
 static
 gboolean
-backend_put (gpointer data, gchar const* key, bson_t const* value)
+backend_batch_set_sorted (gpointer data)
 {
 	JLMDBBatch* batch = data;
-	MDB_val m_key;
-	MDB_val m_value;
-	g_autofree gchar* nskey = NULL;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	/* Appending skips searching the B-tree and fills pages completely. */
+	batch->put_flags = MDB_APPEND;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_put_raw (gpointer data, gchar const* key, gconstpointer value, guint32 len)
+{
+	JLMDBBatch* batch = data;
+	JLMDBOperation operation;
+	gchar* nskey;
 
 	g_return_val_if_fail(key != NULL, FALSE);
-	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
 
-	m_key.mv_size = strlen(nskey) + 1;
-	m_key.mv_data = nskey;
-	m_value.mv_size = value->len;
-	m_value.mv_data = bson_get_data(value);
+	if (batch->txn != NULL)
+	{
+		g_autoptr(GBytes) bytes = NULL;
+		gboolean ret;
+
+		/* The value is written right away, so it does not have to be copied. */
+		bytes = g_bytes_new_static(value, len);
+		ret = backend_write(batch->txn, 0, nskey, bytes, batch->put_flags);
+		g_free(nskey);
+
+		return ret;
+	}
+
+	operation.partition = backend_partition(nskey);
+	operation.nskey = nskey;
+	operation.value = g_bytes_new(value, len);
+	g_array_append_val(batch->operations, operation);
 
-	return (mdb_put(batch->txn, backend_dbi, &m_key, &m_value, 0) == 0);
+	return TRUE;
+}
+
+static
+gboolean
+backend_put (gpointer data, gchar const* key, bson_t const* value)
+{
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	return backend_put_raw(data, key, bson_get_data(value), value->len);
 }
 
 static
@@ -125,18 +460,30 @@ gboolean
 backend_delete (gpointer data, gchar const* key)
 {
 	JLMDBBatch* batch = data;
-	MDB_val m_key;
-	g_autofree gchar* nskey = NULL;
+	JLMDBOperation operation;
+	gchar* nskey;
 
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	nskey = g_strdup_printf("%s:%s", batch->namespace, key);
 
-	m_key.mv_size = strlen(nskey) + 1;
-	m_key.mv_data = nskey;
+	if (batch->txn != NULL)
+	{
+		gboolean ret;
+
+		ret = backend_write(batch->txn, 0, nskey, NULL, 0);
+		g_free(nskey);
+
+		return ret;
+	}
+
+	operation.partition = backend_partition(nskey);
+	operation.nskey = nskey;
+	operation.value = NULL;
+	g_array_append_val(batch->operations, operation);
 
-	return (mdb_del(batch->txn, backend_dbi, &m_key, NULL) == 0);
+	return TRUE;
 }
 
 static
@@ -149,22 +496,24 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 	MDB_val m_key;
 	MDB_val m_value;
 	g_autofree gchar* nskey = NULL;
+	guint partition;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(result_out != NULL, FALSE);
 
-	if (mdb_txn_begin(backend_env, NULL, 0, &txn) != 0)
+	nskey = g_strdup_printf("%s:%s", namespace, key);
+	partition = backend_partition(nskey);
+
+	if ((txn = backend_read_txn_begin(partition)) == NULL)
 	{
 		goto error;
 	}
 
-	nskey = g_strdup_printf("%s:%s", namespace, key);
-
 	m_key.mv_size = strlen(nskey) + 1;
 	m_key.mv_data = nskey;
 
-	if (mdb_get(txn, backend_dbi, &m_key, &m_value) == 0)
+	if (mdb_get(txn, backend_partitions[partition].dbi, &m_key, &m_value) == 0)
 	{
 		bson_t tmp[1];
 
@@ -175,10 +524,7 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 		ret = TRUE;
 	}
 
-	if (mdb_txn_commit(txn) != 0)
-	{
-		goto error;
-	}
+	backend_read_txn_end(txn);
 
 	return ret;
 
@@ -188,28 +534,104 @@ error:
 
 static
 gboolean
-backend_get_all (gchar const* namespace, gpointer* data)
+backend_get_raw (gchar const* namespace, gchar const* key, GBytes** value)
 {
-	JLMDBIterator* iterator = NULL;
+	gboolean ret = FALSE;
+
+	MDB_txn* txn;
+	MDB_val m_key;
+	MDB_val m_value;
+	g_autofree gchar* nskey = NULL;
+	guint partition;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
-	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
 
-	iterator = g_slice_new(JLMDBIterator);
-	iterator->first = TRUE;
-	iterator->prefix = g_strdup_printf("%s:", namespace);
+	nskey = g_strdup_printf("%s:%s", namespace, key);
+	partition = backend_partition(nskey);
 
-	mdb_txn_begin(backend_env, NULL, 0, &(iterator->txn));
-	mdb_cursor_open(iterator->txn, backend_dbi, &(iterator->cursor));
+	if ((txn = backend_read_txn_begin(partition)) == NULL)
+	{
+		return FALSE;
+	}
 
-	*data = iterator;
+	m_key.mv_size = strlen(nskey) + 1;
+	m_key.mv_data = nskey;
 
-	return (iterator != NULL);
+	/* The data is only valid until the transaction ends. */
+	if (mdb_get(txn, backend_partitions[partition].dbi, &m_key, &m_value) == 0)
+	{
+		*value = g_bytes_new(m_value.mv_data, m_value.mv_size);
+		ret = TRUE;
+	}
+
+	backend_read_txn_end(txn);
+
+	return ret;
+}
+
+static
+void
+backend_iterator_free (JLMDBIterator* iterator)
+{
+	for (guint i = 0; i < backend_partition_count; i++)
+	{
+		JLMDBIteratorCursor* cursor = &(iterator->cursors[i]);
+
+		if (cursor->cursor != NULL)
+		{
+			mdb_cursor_close(cursor->cursor);
+		}
+
+		if (cursor->txn != NULL)
+		{
+			mdb_txn_abort(cursor->txn);
+		}
+	}
+
+	g_free(iterator->cursors);
+	g_free(iterator->prefix);
+	g_free(iterator->start);
+	g_slice_free(JLMDBIterator, iterator);
+}
+
+/*
+ * Moves a cursor to its first key or the next one and checks whether it still matches the prefix.
+ */
+static
+void
+backend_iterator_cursor_next (JLMDBIterator* iterator, JLMDBIteratorCursor* cursor, gboolean first)
+{
+	MDB_cursor_op cursor_op = MDB_NEXT;
+	gint ret;
+
+	if (first)
+	{
+		gchar* start = (iterator->start != NULL) ? iterator->start : iterator->prefix;
+
+		// FIXME check +1
+		cursor->key.mv_size = strlen(start) + 1;
+		cursor->key.mv_data = start;
+
+		cursor_op = MDB_SET_RANGE;
+	}
+
+	ret = mdb_cursor_get(cursor->cursor, &(cursor->key), &(cursor->value), cursor_op);
+
+	/* Keys contain their terminating null byte, so the range starts at the key to start after if it exists. */
+	if (ret == 0 && first && iterator->start != NULL && g_strcmp0(cursor->key.mv_data, iterator->start) == 0)
+	{
+		ret = mdb_cursor_get(cursor->cursor, &(cursor->key), &(cursor->value), MDB_NEXT);
+	}
+
+	// FIXME check whether we can completely terminate
+	cursor->valid = (ret == 0 && g_str_has_prefix(cursor->key.mv_data, iterator->prefix));
 }
 
 static
 gboolean
-backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+backend_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
 {
 	JLMDBIterator* iterator = NULL;
 
@@ -217,12 +639,36 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 	g_return_val_if_fail(prefix != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
+	*data = NULL;
+
 	iterator = g_slice_new(JLMDBIterator);
-	iterator->first = TRUE;
+	iterator->cursors = g_new0(JLMDBIteratorCursor, backend_partition_count);
+	iterator->last = -1;
 	iterator->prefix = g_strdup_printf("%s:%s", namespace, prefix);
+	iterator->start = NULL;
+	iterator->namespace_len = strlen(namespace) + 1;
+	iterator->remaining = (limit > 0) ? limit : G_MAXUINT32;
 
-	mdb_txn_begin(backend_env, NULL, 0, &(iterator->txn));
-	mdb_cursor_open(iterator->txn, backend_dbi, &(iterator->cursor));
+	if (start_after != NULL && g_strcmp0(start_after, prefix) >= 0)
+	{
+		iterator->start = g_strdup_printf("%s:%s", namespace, start_after);
+	}
+
+	for (guint i = 0; i < backend_partition_count; i++)
+	{
+		JLMDBIteratorCursor* cursor = &(iterator->cursors[i]);
+
+		/* Iterators have their own transactions, because they can be interleaved with other reads. */
+		if (mdb_txn_begin(backend_partitions[i].env, NULL, MDB_RDONLY, &(cursor->txn)) != 0)
+		{
+			cursor->txn = NULL;
+			backend_iterator_free(iterator);
+
+			return FALSE;
+		}
+
+		mdb_cursor_open(cursor->txn, backend_partitions[i].dbi, &(cursor->cursor));
+	}
 
 	*data = iterator;
 
@@ -231,86 +677,125 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 
 static
 gboolean
-backend_iterate (gpointer data, bson_t* result_out)
+backend_get_all (gchar const* namespace, gpointer* data)
+{
+	return backend_get_range(namespace, "", NULL, 0, data);
+}
+
+static
+gboolean
+backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	return backend_get_range(namespace, prefix, NULL, 0, data);
+}
+
+static
+gboolean
+backend_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
 {
 	JLMDBIterator* iterator = data;
-	MDB_cursor_op cursor_op = MDB_NEXT;
-	MDB_val m_key;
-	MDB_val m_value;
+	JLMDBIteratorCursor* next = NULL;
 
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key_out != NULL, FALSE);
 	g_return_val_if_fail(result_out != NULL, FALSE);
 
-	if (iterator->first)
+	if (iterator->remaining == 0)
 	{
-		// FIXME check +1
-		m_key.mv_size = strlen(iterator->prefix) + 1;
-		m_key.mv_data = iterator->prefix;
-
-		cursor_op = MDB_SET_RANGE;
+		goto out;
+	}
 
-		iterator->first = FALSE;
+	/* Only advance now, moving a cursor invalidates the previously returned key and value. */
+	if (iterator->last < 0)
+	{
+		for (guint i = 0; i < backend_partition_count; i++)
+		{
+			backend_iterator_cursor_next(iterator, &(iterator->cursors[i]), TRUE);
+		}
+	}
+	else
+	{
+		backend_iterator_cursor_next(iterator, &(iterator->cursors[iterator->last]), FALSE);
 	}
 
-	if (mdb_cursor_get(iterator->cursor, &m_key, &m_value, cursor_op) == 0)
+	/* Merge the partitions by returning the smallest key first. */
+	for (guint i = 0; i < backend_partition_count; i++)
 	{
-		if (!g_str_has_prefix(m_key.mv_data, iterator->prefix))
+		JLMDBIteratorCursor* cursor = &(iterator->cursors[i]);
+
+		if (cursor->valid && (next == NULL || g_strcmp0(cursor->key.mv_data, next->key.mv_data) < 0))
 		{
-			// FIXME check whether we can completely terminate
-			goto out;
+			next = cursor;
+			iterator->last = i;
 		}
+	}
 
-		bson_init_static(result_out, m_value.mv_data, m_value.mv_size);
+	if (next != NULL)
+	{
+		bson_init_static(result_out, next->value.mv_data, next->value.mv_size);
+		*key_out = (gchar const*)next->key.mv_data + iterator->namespace_len;
+
+		iterator->remaining--;
 
 		return TRUE;
 	}
 
 out:
-	mdb_txn_commit(iterator->txn);
-
-	g_free(iterator->prefix);
-	g_slice_free(JLMDBIterator, iterator);
+	backend_iterator_free(iterator);
 
 	return FALSE;
 }
 
+/*
+ * Opens a partition's environment.
+ */
 static
 gboolean
-backend_init (gchar const* path)
+backend_partition_open (JLMDBPartition* partition, gchar const* path, guint64 map_size)
 {
 	MDB_txn* txn;
 
-	g_return_val_if_fail(path != NULL, FALSE);
-
 	g_mkdir_with_parents(path, 0700);
 
-	if (mdb_env_create(&backend_env) == 0)
+	if (mdb_env_create(&(partition->env)) != 0)
 	{
-		if (mdb_env_open(backend_env, path, 0, 0600) != 0)
-		{
-			goto error;
-		}
+		partition->env = NULL;
+		return FALSE;
+	}
 
-		if (mdb_txn_begin(backend_env, NULL, 0, &txn) != 0)
-		{
-			goto error;
-		}
+	if (mdb_env_set_mapsize(partition->env, map_size) != 0
+	    || mdb_env_set_maxreaders(partition->env, JD_BACKEND_MAX_READERS) != 0)
+	{
+		goto error;
+	}
 
-		if (mdb_dbi_open(txn, NULL, 0, &backend_dbi) != 0)
-		{
-			goto error;
-		}
+	/* Read transactions are cached per thread, MDB_NOTLS allows iterators to use additional ones. */
+	if (mdb_env_open(partition->env, path, MDB_NOTLS, 0600) != 0)
+	{
+		goto error;
+	}
 
-		if (mdb_txn_commit(txn) != 0)
-		{
-			goto error;
-		}
+	if (mdb_txn_begin(partition->env, NULL, 0, &txn) != 0)
+	{
+		goto error;
 	}
 
-	return (backend_env != NULL);
+	if (mdb_dbi_open(txn, NULL, 0, &(partition->dbi)) != 0)
+	{
+		mdb_txn_abort(txn);
+		goto error;
+	}
+
+	if (mdb_txn_commit(txn) != 0)
+	{
+		goto error;
+	}
+
+	return TRUE;
 
 error:
-	mdb_env_close(backend_env);
+	mdb_env_close(partition->env);
+	partition->env = NULL;
 
 	return FALSE;
 }
@@ -319,10 +804,103 @@ static
 void
 backend_fini (void)
 {
-	if (backend_env != NULL)
+	G_LOCK(backend_read_txns);
+
+	if (backend_read_txns != NULL)
+	{
+		for (guint i = 0; i < backend_read_txns->len; i++)
+		{
+			MDB_txn** txns = g_ptr_array_index(backend_read_txns, i);
+
+			for (guint j = 0; j < backend_partition_count; j++)
+			{
+				if (txns[j] != NULL)
+				{
+					mdb_txn_abort(txns[j]);
+					txns[j] = NULL;
+				}
+			}
+		}
+
+		g_ptr_array_free(backend_read_txns, TRUE);
+		backend_read_txns = NULL;
+	}
+
+	G_UNLOCK(backend_read_txns);
+
+	for (guint i = 0; i < backend_partition_count; i++)
 	{
-		mdb_env_close(backend_env);
+		if (backend_partitions[i].env != NULL)
+		{
+			mdb_env_close(backend_partitions[i].env);
+		}
 	}
+
+	g_free(backend_partitions);
+	backend_partitions = NULL;
+	backend_partition_count = 0;
+}
+
+static
+gboolean
+backend_init (gchar const* path)
+{
+	guint64 map_size = JD_BACKEND_MAP_SIZE;
+	guint64 partitions = 1;
+
+	g_return_val_if_fail(path != NULL, FALSE);
+
+	/* The map size can be given as map-size={bytes}:path. */
+	if (g_str_has_prefix(path, "map-size="))
+	{
+		gchar* end;
+
+		map_size = g_ascii_strtoull(path + strlen("map-size="), &end, 10);
+
+		if (*end != ':' || map_size == 0)
+		{
+			g_critical("Invalid map size in %s.", path);
+			return FALSE;
+		}
+
+		path = end + 1;
+	}
+
+	/* The number of partitions can be given as partitions={count}:path. */
+	if (g_str_has_prefix(path, "partitions="))
+	{
+		gchar* end;
+
+		partitions = g_ascii_strtoull(path + strlen("partitions="), &end, 10);
+
+		if (*end != ':' || partitions == 0 || partitions > JD_BACKEND_MAX_PARTITIONS)
+		{
+			g_critical("Invalid number of partitions in %s.", path);
+			return FALSE;
+		}
+
+		path = end + 1;
+	}
+
+	backend_partition_count = partitions;
+	backend_partitions = g_new0(JLMDBPartition, backend_partition_count);
+	backend_read_txns = g_ptr_array_new();
+
+	for (guint i = 0; i < backend_partition_count; i++)
+	{
+		g_autofree gchar* partition_path = NULL;
+
+		/* A single partition uses the path directly, so that existing databases keep working. */
+		partition_path = (backend_partition_count > 1) ? g_strdup_printf("%s/%u", path, i) : g_strdup(path);
+
+		if (!backend_partition_open(&(backend_partitions[i]), partition_path, map_size))
+		{
+			backend_fini();
+			return FALSE;
+		}
+	}
+
+	return TRUE;
 }
 
 static
@@ -333,12 +911,16 @@ JBackend lmdb_backend = {
 		.fini = backend_fini,
 		.batch_start = backend_batch_start,
 		.batch_execute = backend_batch_execute,
+		.batch_set_sorted = backend_batch_set_sorted,
 		.put = backend_put,
 		.delete = backend_delete,
 		.get = backend_get,
 		.get_all = backend_get_all,
 		.get_by_prefix = backend_get_by_prefix,
-		.iterate = backend_iterate
+		.get_range = backend_get_range,
+		.iterate = backend_iterate,
+		.put_raw = backend_put_raw,
+		.get_raw = backend_get_raw
 	}
 };
 
@@ -0,0 +1,675 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+/* The number of shards per namespace, must be a power of two. */
+#define JD_BACKEND_SHARDS 16
+
+/*
+ * The values of a shard are immutable, so that readers can keep references after unlocking.
+ */
+struct JMemoryShard
+{
+	GRWLock lock;
+	/* Maps keys to GBytes. */
+	GHashTable* table;
+};
+
+typedef struct JMemoryShard JMemoryShard;
+
+struct JMemoryNamespace
+{
+	JMemoryShard shards[JD_BACKEND_SHARDS];
+
+	/*
+	 * Contains all keys in sorted order for prefix iterations.
+	 * Writers lock the index before locking shards.
+	 */
+	GRWLock index_lock;
+	GSequence* index;
+};
+
+typedef struct JMemoryNamespace JMemoryNamespace;
+
+struct JMemoryOperation
+{
+	gchar* key;
+	/* NULL for deletes. */
+	GBytes* value;
+};
+
+typedef struct JMemoryOperation JMemoryOperation;
+
+struct JMemoryBatch
+{
+	JMemoryNamespace* namespace;
+	GArray* operations;
+};
+
+typedef struct JMemoryBatch JMemoryBatch;
+
+/*
+ * Iterators work on a snapshot of the matching values.
+ */
+struct JMemoryIterator
+{
+	GPtrArray* keys;
+	GPtrArray* values;
+	guint current;
+};
+
+typedef struct JMemoryIterator JMemoryIterator;
+
+/* Maps names to JMemoryNamespace, namespaces are never removed. */
+static GHashTable* backend_namespaces = NULL;
+static GRWLock backend_namespaces_lock;
+
+/* The file the data is written to when shutting down, NULL if data should be discarded. */
+static gchar* backend_snapshot_path = NULL;
+
+static
+gint
+backend_key_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	(void)user_data;
+
+	return strcmp(a, b);
+}
+
+static
+JMemoryShard*
+backend_namespace_get_shard (JMemoryNamespace* namespace, gchar const* key)
+{
+	return &(namespace->shards[g_str_hash(key) & (JD_BACKEND_SHARDS - 1)]);
+}
+
+static
+JMemoryNamespace*
+backend_namespace_new (void)
+{
+	JMemoryNamespace* namespace;
+
+	namespace = g_slice_new(JMemoryNamespace);
+
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		g_rw_lock_init(&(namespace->shards[i].lock));
+		namespace->shards[i].table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_bytes_unref);
+	}
+
+	g_rw_lock_init(&(namespace->index_lock));
+	/* The keys are owned by the shards. */
+	namespace->index = g_sequence_new(NULL);
+
+	return namespace;
+}
+
+static
+void
+backend_namespace_free (gpointer data)
+{
+	JMemoryNamespace* namespace = data;
+
+	g_sequence_free(namespace->index);
+	g_rw_lock_clear(&(namespace->index_lock));
+
+	for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+	{
+		g_hash_table_unref(namespace->shards[i].table);
+		g_rw_lock_clear(&(namespace->shards[i].lock));
+	}
+
+	g_slice_free(JMemoryNamespace, namespace);
+}
+
+static
+JMemoryNamespace*
+backend_namespace_get (gchar const* name, gboolean create)
+{
+	JMemoryNamespace* namespace;
+
+	g_rw_lock_reader_lock(&backend_namespaces_lock);
+	namespace = g_hash_table_lookup(backend_namespaces, name);
+	g_rw_lock_reader_unlock(&backend_namespaces_lock);
+
+	if (namespace != NULL || !create)
+	{
+		return namespace;
+	}
+
+	g_rw_lock_writer_lock(&backend_namespaces_lock);
+
+	/* Another thread might have created the namespace in the meantime. */
+	if ((namespace = g_hash_table_lookup(backend_namespaces, name)) == NULL)
+	{
+		namespace = backend_namespace_new();
+		g_hash_table_insert(backend_namespaces, g_strdup(name), namespace);
+	}
+
+	g_rw_lock_writer_unlock(&backend_namespaces_lock);
+
+	return namespace;
+}
+
+/*
+ * Applies a single operation, the caller has to hold the namespace's index lock for writing.
+ */
+static
+void
+backend_namespace_apply (JMemoryNamespace* namespace, gchar* key, GBytes* value)
+{
+	JMemoryShard* shard;
+	gchar* stored_key;
+	gboolean exists;
+
+	shard = backend_namespace_get_shard(namespace, key);
+
+	g_rw_lock_writer_lock(&(shard->lock));
+
+	exists = g_hash_table_lookup_extended(shard->table, key, (gpointer*)&stored_key, NULL);
+
+	if (value != NULL)
+	{
+		/* Existing keys are kept, they are referenced by the index. */
+		g_hash_table_insert(shard->table, key, value);
+
+		if (!exists)
+		{
+			g_sequence_insert_sorted(namespace->index, key, backend_key_compare, NULL);
+		}
+	}
+	else
+	{
+		if (exists)
+		{
+			g_sequence_remove(g_sequence_lookup(namespace->index, stored_key, backend_key_compare, NULL));
+			g_hash_table_remove(shard->table, key);
+		}
+
+		g_free(key);
+	}
+
+	g_rw_lock_writer_unlock(&(shard->lock));
+}
+
+static
+void
+backend_snapshot_load (gchar const* path)
+{
+	bson_reader_t* reader;
+	bson_t const* document;
+	bool eof = FALSE;
+
+	if (!g_file_test(path, G_FILE_TEST_EXISTS))
+	{
+		return;
+	}
+
+	if ((reader = bson_reader_new_from_file(path, NULL)) == NULL)
+	{
+		g_warning("Could not read snapshot %s.", path);
+		return;
+	}
+
+	while ((document = bson_reader_read(reader, &eof)) != NULL)
+	{
+		JMemoryNamespace* namespace;
+		bson_iter_t iter;
+		gchar const* name = NULL;
+		gchar const* key = NULL;
+		guint8 const* data = NULL;
+		guint32 len = 0;
+
+		if (bson_iter_init_find(&iter, document, "namespace") && BSON_ITER_HOLDS_UTF8(&iter))
+		{
+			name = bson_iter_utf8(&iter, NULL);
+		}
+
+		if (bson_iter_init_find(&iter, document, "key") && BSON_ITER_HOLDS_UTF8(&iter))
+		{
+			key = bson_iter_utf8(&iter, NULL);
+		}
+
+		if (bson_iter_init_find(&iter, document, "value") && BSON_ITER_HOLDS_BINARY(&iter))
+		{
+			bson_iter_binary(&iter, NULL, &len, &data);
+		}
+
+		if (name == NULL || key == NULL || data == NULL)
+		{
+			continue;
+		}
+
+		namespace = backend_namespace_get(name, TRUE);
+
+		g_rw_lock_writer_lock(&(namespace->index_lock));
+		backend_namespace_apply(namespace, g_strdup(key), g_bytes_new(data, len));
+		g_rw_lock_writer_unlock(&(namespace->index_lock));
+	}
+
+	if (!eof)
+	{
+		g_warning("Snapshot %s is truncated.", path);
+	}
+
+	bson_reader_destroy(reader);
+}
+
+/*
+ * Writes all namespaces to a file, which consists of one BSON document per key.
+ */
+static
+void
+backend_snapshot_save (gchar const* path)
+{
+	GHashTableIter iter;
+	g_autoptr(GByteArray) snapshot = NULL;
+	g_autofree gchar* dirname = NULL;
+	gpointer name;
+	gpointer value;
+
+	snapshot = g_byte_array_new();
+
+	g_hash_table_iter_init(&iter, backend_namespaces);
+
+	while (g_hash_table_iter_next(&iter, &name, &value))
+	{
+		JMemoryNamespace* namespace = value;
+
+		for (guint i = 0; i < JD_BACKEND_SHARDS; i++)
+		{
+			GHashTableIter shard_iter;
+			gpointer key;
+			gpointer bytes;
+
+			g_hash_table_iter_init(&shard_iter, namespace->shards[i].table);
+
+			while (g_hash_table_iter_next(&shard_iter, &key, &bytes))
+			{
+				bson_t document[1];
+				gconstpointer data;
+				gsize len;
+
+				data = g_bytes_get_data(bytes, &len);
+
+				bson_init(document);
+				bson_append_utf8(document, "namespace", -1, name, -1);
+				bson_append_utf8(document, "key", -1, key, -1);
+				bson_append_binary(document, "value", -1, BSON_SUBTYPE_BINARY, data, len);
+
+				g_byte_array_append(snapshot, bson_get_data(document), document->len);
+
+				bson_destroy(document);
+			}
+		}
+	}
+
+	dirname = g_path_get_dirname(path);
+	g_mkdir_with_parents(dirname, 0700);
+
+	/* Replaces the previous snapshot atomically. */
+	if (!g_file_set_contents(path, (gchar const*)snapshot->data, snapshot->len, NULL))
+	{
+		g_warning("Could not write snapshot %s.", path);
+	}
+}
+
+static
+gboolean
+backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
+{
+	JMemoryBatch* batch;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	/* Nothing is persisted before shutting down, so all safety levels behave the same. */
+	(void)safety;
+
+	batch = g_slice_new(JMemoryBatch);
+	batch->namespace = backend_namespace_get(namespace, TRUE);
+	batch->operations = g_array_new(FALSE, FALSE, sizeof(JMemoryOperation));
+
+	*data = batch;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_batch_execute (gpointer data)
+{
+	JMemoryBatch* batch = data;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	/* Holding the index lock makes the batch atomic for iterations. */
+	g_rw_lock_writer_lock(&(batch->namespace->index_lock));
+
+	for (guint i = 0; i < batch->operations->len; i++)
+	{
+		JMemoryOperation* operation = &g_array_index(batch->operations, JMemoryOperation, i);
+
+		backend_namespace_apply(batch->namespace, operation->key, operation->value);
+	}
+
+	g_rw_lock_writer_unlock(&(batch->namespace->index_lock));
+
+	g_array_unref(batch->operations);
+	g_slice_free(JMemoryBatch, batch);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_put_raw (gpointer data, gchar const* key, gconstpointer value, guint32 len)
+{
+	JMemoryBatch* batch = data;
+	JMemoryOperation operation;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+
+	operation.key = g_strdup(key);
+	operation.value = g_bytes_new(value, len);
+
+	g_array_append_val(batch->operations, operation);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_put (gpointer data, gchar const* key, bson_t const* value)
+{
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	return backend_put_raw(data, key, bson_get_data(value), value->len);
+}
+
+static
+gboolean
+backend_delete (gpointer data, gchar const* key)
+{
+	JMemoryBatch* batch = data;
+	JMemoryOperation operation;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+
+	operation.key = g_strdup(key);
+	operation.value = NULL;
+
+	g_array_append_val(batch->operations, operation);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_get_raw (gchar const* namespace, gchar const* key, GBytes** value)
+{
+	JMemoryNamespace* memory_namespace;
+	JMemoryShard* shard;
+	GBytes* bytes;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	if ((memory_namespace = backend_namespace_get(namespace, FALSE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	/* Point operations only lock a single shard. */
+	shard = backend_namespace_get_shard(memory_namespace, key);
+
+	g_rw_lock_reader_lock(&(shard->lock));
+
+	/* Values are immutable, so they can be shared instead of copied. */
+	if ((bytes = g_hash_table_lookup(shard->table, key)) != NULL)
+	{
+		*value = g_bytes_ref(bytes);
+	}
+
+	g_rw_lock_reader_unlock(&(shard->lock));
+
+	return (bytes != NULL);
+}
+
+static
+gboolean
+backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
+{
+	GBytes* value;
+
+	g_return_val_if_fail(result_out != NULL, FALSE);
+
+	if (backend_get_raw(namespace, key, &value))
+	{
+		bson_t tmp[1];
+		gconstpointer data;
+		gsize len;
+
+		data = g_bytes_get_data(value, &len);
+
+		bson_init_static(tmp, data, len);
+		bson_copy_to(tmp, result_out);
+
+		g_bytes_unref(value);
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static
+gboolean
+backend_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
+{
+	JMemoryNamespace* memory_namespace;
+	JMemoryIterator* iterator;
+	GSequenceIter* position;
+	gsize prefix_len;
+	gboolean after;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if ((memory_namespace = backend_namespace_get(namespace, FALSE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	prefix_len = strlen(prefix);
+
+	/* Starts after start_after if it sorts behind the prefix, otherwise at the prefix. */
+	after = (start_after != NULL && strcmp(start_after, prefix) >= 0);
+
+	iterator = g_slice_new(JMemoryIterator);
+	iterator->keys = g_ptr_array_new_with_free_func(g_free);
+	iterator->values = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+	iterator->current = 0;
+
+	g_rw_lock_reader_lock(&(memory_namespace->index_lock));
+
+	/* Returns the position behind all keys that are not greater than the searched key. */
+	position = g_sequence_search(memory_namespace->index, (gpointer)(after ? start_after : prefix), backend_key_compare, NULL);
+
+	/* The prefix itself is part of the range. */
+	if (!after && !g_sequence_iter_is_begin(position))
+	{
+		GSequenceIter* previous = g_sequence_iter_prev(position);
+
+		if (strcmp(g_sequence_get(previous), prefix) == 0)
+		{
+			position = previous;
+		}
+	}
+
+	for (; !g_sequence_iter_is_end(position); position = g_sequence_iter_next(position))
+	{
+		gchar const* key = g_sequence_get(position);
+		JMemoryShard* shard;
+
+		if (strncmp(key, prefix, prefix_len) != 0 || (limit > 0 && iterator->values->len >= limit))
+		{
+			break;
+		}
+
+		shard = backend_namespace_get_shard(memory_namespace, key);
+
+		g_rw_lock_reader_lock(&(shard->lock));
+		g_ptr_array_add(iterator->values, g_bytes_ref(g_hash_table_lookup(shard->table, key)));
+		g_rw_lock_reader_unlock(&(shard->lock));
+
+		/* Keys can be freed by writers once the index has been unlocked. */
+		g_ptr_array_add(iterator->keys, g_strdup(key));
+	}
+
+	g_rw_lock_reader_unlock(&(memory_namespace->index_lock));
+
+	*data = iterator;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_get_all (gchar const* namespace, gpointer* data)
+{
+	return backend_get_range(namespace, "", NULL, 0, data);
+}
+
+static
+gboolean
+backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	return backend_get_range(namespace, prefix, NULL, 0, data);
+}
+
+static
+gboolean
+backend_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
+{
+	JMemoryIterator* iterator = data;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key_out != NULL, FALSE);
+	g_return_val_if_fail(result_out != NULL, FALSE);
+
+	if (iterator->current < iterator->values->len)
+	{
+		GBytes* value;
+		gconstpointer value_data;
+		gsize len;
+
+		value = g_ptr_array_index(iterator->values, iterator->current);
+		*key_out = g_ptr_array_index(iterator->keys, iterator->current);
+		iterator->current++;
+
+		value_data = g_bytes_get_data(value, &len);
+		bson_init_static(result_out, value_data, len);
+
+		return TRUE;
+	}
+
+	g_ptr_array_unref(iterator->keys);
+	g_ptr_array_unref(iterator->values);
+	g_slice_free(JMemoryIterator, iterator);
+
+	return FALSE;
+}
+
+static
+gboolean
+backend_init (gchar const* path)
+{
+	g_return_val_if_fail(path != NULL, FALSE);
+
+	backend_namespaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, backend_namespace_free);
+
+	/* Path syntax: [path to snapshot]
+	   e.g.: /var/storage/meta.snapshot, an empty path discards all data when shutting down. */
+	if (path[0] != '\0')
+	{
+		backend_snapshot_path = g_strdup(path);
+		backend_snapshot_load(backend_snapshot_path);
+	}
+
+	return TRUE;
+}
+
+static
+void
+backend_fini (void)
+{
+	if (backend_snapshot_path != NULL)
+	{
+		backend_snapshot_save(backend_snapshot_path);
+		g_free(backend_snapshot_path);
+	}
+
+	g_hash_table_unref(backend_namespaces);
+}
+
+static
+JBackend memory_backend = {
+	.type = J_BACKEND_TYPE_KV,
+	.kv = {
+		.init = backend_init,
+		.fini = backend_fini,
+		.batch_start = backend_batch_start,
+		.batch_execute = backend_batch_execute,
+		.put = backend_put,
+		.delete = backend_delete,
+		.get = backend_get,
+		.get_all = backend_get_all,
+		.get_by_prefix = backend_get_by_prefix,
+		.get_range = backend_get_range,
+		.iterate = backend_iterate,
+		.put_raw = backend_put_raw,
+		.get_raw = backend_get_raw
+	}
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info (JBackendType type)
+{
+	JBackend* backend = NULL;
+
+	if (type == J_BACKEND_TYPE_KV)
+	{
+		backend = &memory_backend;
+	}
+
+	return backend;
+}
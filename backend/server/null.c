@@ -21,8 +21,158 @@
 #include <glib.h>
 #include <gmodule.h>
 
+#include <string.h>
+
 #include <julea.h>
 
+/*
+ * A simulated device.
+ * Every operation takes the device's latency, transfers additionally take their size divided by the bandwidth.
+ * Transfers share the bandwidth, so concurrent operations slow each other down like on a real device.
+ */
+struct JBackendDevice
+{
+	/* The latency of each operation in microseconds. */
+	gint64 latency;
+
+	/* The bandwidth in bytes per second, 0 if unlimited. */
+	guint64 bandwidth;
+
+	/* The time during which unused bandwidth is saved for later transfers, like tokens in a bucket. */
+	gint64 burst;
+
+	/* The time at which all previous transfers have finished. */
+	gint64 available;
+
+	GMutex mutex;
+};
+
+typedef struct JBackendDevice JBackendDevice;
+
+/* The object and key-value backends can be loaded from the same module, so each of them has its own device. */
+static JBackendDevice jd_backend_object_device;
+static JBackendDevice jd_backend_kv_device;
+
+static
+gboolean
+backend_device_init (JBackendDevice* device, gchar const* path)
+{
+	g_auto(GStrv) options = NULL;
+	guint64 burst = 0;
+
+	device->latency = 0;
+	device->bandwidth = 0;
+	device->burst = 0;
+	device->available = 0;
+
+	g_mutex_init(&(device->mutex));
+
+	/* Path syntax: [option=value][,option=value]...
+	   Options: latency (microseconds), bandwidth (bytes per second), burst (bytes)
+	   e.g.: latency=100,bandwidth=1000000000
+	   Paths without options are ignored for compatibility. */
+	if (path == NULL || strchr(path, '=') == NULL)
+	{
+		return TRUE;
+	}
+
+	options = g_strsplit(path, ",", 0);
+
+	for (guint i = 0; options[i] != NULL; i++)
+	{
+		gchar const* value;
+		guint64 number;
+		gchar* end;
+
+		if ((value = strchr(options[i], '=')) == NULL)
+		{
+			g_critical("Invalid option %s.", options[i]);
+			return FALSE;
+		}
+
+		number = g_ascii_strtoull(value + 1, &end, 10);
+
+		if (*end != '\0')
+		{
+			g_critical("Invalid value in option %s.", options[i]);
+			return FALSE;
+		}
+
+		if (g_str_has_prefix(options[i], "latency="))
+		{
+			device->latency = number;
+		}
+		else if (g_str_has_prefix(options[i], "bandwidth="))
+		{
+			device->bandwidth = number;
+		}
+		else if (g_str_has_prefix(options[i], "burst="))
+		{
+			burst = number;
+		}
+		else
+		{
+			g_critical("Unknown option %s.", options[i]);
+			return FALSE;
+		}
+	}
+
+	if (device->bandwidth > 0)
+	{
+		device->burst = burst * G_USEC_PER_SEC / device->bandwidth;
+	}
+
+	return TRUE;
+}
+
+static
+void
+backend_device_fini (JBackendDevice* device)
+{
+	g_mutex_clear(&(device->mutex));
+}
+
+/*
+ * Waits until the device would have finished an operation transferring the given number of bytes.
+ */
+static
+void
+backend_device_access (JBackendDevice* device, guint64 bytes)
+{
+	gint64 now;
+	gint64 end;
+
+	if (device->latency == 0 && (device->bandwidth == 0 || bytes == 0))
+	{
+		return;
+	}
+
+	now = g_get_monotonic_time();
+	end = now;
+
+	if (device->bandwidth > 0 && bytes > 0)
+	{
+		gint64 start;
+
+		g_mutex_lock(&(device->mutex));
+
+		/* An idle device can use the bandwidth saved during the burst time. */
+		start = MAX(device->available, now - device->burst);
+		device->available = start + (gint64)(bytes * G_USEC_PER_SEC / device->bandwidth);
+		end = MAX(end, device->available);
+
+		g_mutex_unlock(&(device->mutex));
+	}
+
+	end += device->latency;
+
+	if (end > now)
+	{
+		g_usleep(end - now);
+	}
+}
+
+
 static
 gboolean
 backend_create (gchar const* namespace, gchar const* path, gpointer* data)
@@ -32,6 +182,7 @@ backend_create (gchar const* namespace, gchar const* path, gpointer* data)
 	full_path = g_build_filename(namespace, path, NULL);
 
 	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+	backend_device_access(&jd_backend_object_device, 0);
 	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
 
 	*data = full_path;
@@ -62,6 +213,7 @@ backend_delete (gpointer data)
 	gchar* full_path = data;
 
 	j_trace_file_begin(full_path, J_TRACE_FILE_DELETE);
+	backend_device_access(&jd_backend_object_device, 0);
 	j_trace_file_end(full_path, J_TRACE_FILE_DELETE, 0, 0);
 
 	g_free(full_path);
@@ -69,6 +221,18 @@ backend_delete (gpointer data)
 	return TRUE;
 }
 
+static
+gboolean
+backend_purge (gchar const* namespace, gchar const* directory)
+{
+	(void)namespace;
+	(void)directory;
+
+	backend_device_access(&jd_backend_object_device, 0);
+
+	return TRUE;
+}
+
 static
 gboolean
 backend_close (gpointer data)
@@ -90,6 +254,7 @@ backend_status (gpointer data, gint64* modification_time, guint64* size)
 	gchar const* full_path = data;
 
 	j_trace_file_begin(full_path, J_TRACE_FILE_STATUS);
+	backend_device_access(&jd_backend_object_device, 0);
 	j_trace_file_end(full_path, J_TRACE_FILE_STATUS, 0, 0);
 
 	*modification_time = 0;
@@ -105,6 +270,7 @@ backend_sync (gpointer data)
 	gchar const* full_path = data;
 
 	j_trace_file_begin(full_path, J_TRACE_FILE_SYNC);
+	backend_device_access(&jd_backend_object_device, 0);
 	j_trace_file_end(full_path, J_TRACE_FILE_SYNC, 0, 0);
 
 	return TRUE;
@@ -119,6 +285,7 @@ backend_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, gu
 	(void)buffer;
 
 	j_trace_file_begin(full_path, J_TRACE_FILE_READ);
+	backend_device_access(&jd_backend_object_device, length);
 	j_trace_file_end(full_path, J_TRACE_FILE_READ, length, offset);
 
 	if (bytes_read != NULL)
@@ -138,6 +305,7 @@ backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offs
 	(void)buffer;
 
 	j_trace_file_begin(full_path, J_TRACE_FILE_WRITE);
+	backend_device_access(&jd_backend_object_device, length);
 	j_trace_file_end(full_path, J_TRACE_FILE_WRITE, length, offset);
 
 	if (bytes_written != NULL)
@@ -152,15 +320,161 @@ static
 gboolean
 backend_init (gchar const* path)
 {
-	(void)path;
+	return backend_device_init(&jd_backend_object_device, path);
+}
+
+static
+void
+backend_fini (void)
+{
+	backend_device_fini(&jd_backend_object_device);
+}
+
+/*
+ * Key-value batches only count the size of their values, which are transferred when the batch is executed.
+ */
+struct JBackendBatch
+{
+	guint64 bytes;
+};
+
+typedef struct JBackendBatch JBackendBatch;
+
+/* Nothing is stored, so all iterators are empty. */
+static gchar jd_backend_kv_iterator;
+
+static
+gboolean
+backend_kv_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
+{
+	JBackendBatch* batch;
+
+	(void)namespace;
+	(void)safety;
+
+	batch = g_slice_new(JBackendBatch);
+	batch->bytes = 0;
+
+	*data = batch;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_kv_batch_execute (gpointer data)
+{
+	JBackendBatch* batch = data;
+
+	backend_device_access(&jd_backend_kv_device, batch->bytes);
+
+	g_slice_free(JBackendBatch, batch);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_kv_put (gpointer data, gchar const* key, bson_t const* value)
+{
+	JBackendBatch* batch = data;
+
+	(void)key;
+
+	batch->bytes += value->len;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_kv_delete (gpointer data, gchar const* key)
+{
+	(void)data;
+	(void)key;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_kv_get (gchar const* namespace, gchar const* key, bson_t* result_out)
+{
+	(void)namespace;
+	(void)key;
+	(void)result_out;
+
+	backend_device_access(&jd_backend_kv_device, 0);
+
+	return FALSE;
+}
+
+static
+gboolean
+backend_kv_get_all (gchar const* namespace, gpointer* data)
+{
+	(void)namespace;
+
+	backend_device_access(&jd_backend_kv_device, 0);
+
+	*data = &jd_backend_kv_iterator;
 
 	return TRUE;
 }
 
+static
+gboolean
+backend_kv_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	(void)namespace;
+	(void)prefix;
+
+	backend_device_access(&jd_backend_kv_device, 0);
+
+	*data = &jd_backend_kv_iterator;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_kv_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
+{
+	(void)namespace;
+	(void)prefix;
+	(void)start_after;
+	(void)limit;
+
+	backend_device_access(&jd_backend_kv_device, 0);
+
+	*data = &jd_backend_kv_iterator;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_kv_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
+{
+	(void)data;
+	(void)key_out;
+	(void)result_out;
+
+	return FALSE;
+}
+
+static
+gboolean
+backend_kv_init (gchar const* path)
+{
+	return backend_device_init(&jd_backend_kv_device, path);
+}
+
 static
 void
-backend_fini (void)
+backend_kv_fini (void)
 {
+	backend_device_fini(&jd_backend_kv_device);
 }
 
 static
@@ -176,7 +490,26 @@ JBackend null_backend = {
 		.status = backend_status,
 		.sync = backend_sync,
 		.read = backend_read,
-		.write = backend_write
+		.write = backend_write,
+		.purge = backend_purge
+	}
+};
+
+static
+JBackend null_kv_backend = {
+	.type = J_BACKEND_TYPE_KV,
+	.kv = {
+		.init = backend_kv_init,
+		.fini = backend_kv_fini,
+		.batch_start = backend_kv_batch_start,
+		.batch_execute = backend_kv_batch_execute,
+		.put = backend_kv_put,
+		.delete = backend_kv_delete,
+		.get = backend_kv_get,
+		.get_all = backend_kv_get_all,
+		.get_by_prefix = backend_kv_get_by_prefix,
+		.get_range = backend_kv_get_range,
+		.iterate = backend_kv_iterate
 	}
 };
 
@@ -190,6 +523,10 @@ backend_info (JBackendType type)
 	{
 		backend = &null_backend;
 	}
+	else if (type == J_BACKEND_TYPE_KV)
+	{
+		backend = &null_kv_backend;
+	}
 
 	return backend;
 }
@@ -0,0 +1,555 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <julea-config.h>
+
+/* Required for MAP_SHARED_VALIDATE and MAP_SYNC */
+#define _GNU_SOURCE
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libpmem.h>
+
+#include <julea.h>
+
+/*
+ * The minimum size of a mapping.
+ * Mappings are larger than their files, so that growing files usually does not require remapping them.
+ */
+#define JD_BACKEND_MAP_SIZE (64 * 1024 * 1024)
+
+struct JBackendFile
+{
+	gchar* path;
+	gint fd;
+
+	/* The mapping and its size, which might be larger than the file. */
+	gchar* map;
+	guint64 capacity;
+
+	/* The file's size, data beyond it must not be accessed. */
+	guint64 size;
+
+	/* Whether the file is on persistent memory, stores then only have to be flushed from the CPU caches. */
+	gboolean pmem;
+
+	/* Whether the file's size has changed since the last sync. */
+	gboolean metadata_dirty;
+
+	/* Protects the mapping and the size, remapping and growing require exclusive access. */
+	GRWLock lock;
+};
+
+typedef struct JBackendFile JBackendFile;
+
+static gchar* jd_backend_path = NULL;
+
+static
+gboolean
+backend_file_map (JBackendFile* file, guint64 size)
+{
+	gchar* map = MAP_FAILED;
+	guint64 capacity;
+
+	capacity = MAX(JD_BACKEND_MAP_SIZE, (G_GUINT64_CONSTANT(1) << g_bit_storage(size)));
+
+	if (file->map != NULL)
+	{
+		munmap(file->map, file->capacity);
+		file->map = NULL;
+		file->capacity = 0;
+	}
+
+	file->pmem = FALSE;
+
+#ifdef MAP_SYNC
+	/* Only succeeds on DAX file systems, where page faults also persist the file system's metadata. */
+	map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED_VALIDATE | MAP_SYNC, file->fd, 0);
+	file->pmem = (map != MAP_FAILED);
+#endif
+
+	if (map == MAP_FAILED)
+	{
+		map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+	}
+
+	if (map == MAP_FAILED)
+	{
+		return FALSE;
+	}
+
+	file->map = map;
+	file->capacity = capacity;
+
+	return TRUE;
+}
+
+static
+JBackendFile*
+backend_file_new (gchar* path, gint fd)
+{
+	JBackendFile* file;
+	struct stat buf;
+
+	file = g_slice_new(JBackendFile);
+	file->path = path;
+	file->fd = fd;
+	file->map = NULL;
+	file->capacity = 0;
+	file->size = 0;
+	file->pmem = FALSE;
+	file->metadata_dirty = FALSE;
+
+	g_rw_lock_init(&(file->lock));
+
+	if (fd != -1 && fstat(fd, &buf) == 0)
+	{
+		file->size = buf.st_size;
+		backend_file_map(file, file->size);
+	}
+
+	return file;
+}
+
+/*
+ * Copies data into the mapping.
+ * On persistent memory, non-temporal stores are used and the data is flushed from the CPU caches,
+ * so that only a fence is necessary to make it persistent.
+ */
+static
+void
+backend_file_copy (JBackendFile* file, gconstpointer buffer, guint64 length, guint64 offset)
+{
+	if (file->pmem)
+	{
+		pmem_memcpy_nodrain(file->map + offset, buffer, length);
+	}
+	else
+	{
+		memcpy(file->map + offset, buffer, length);
+	}
+}
+
+static
+gboolean
+backend_file_write (JBackendFile* file, gconstpointer buffer, guint64 length, guint64 offset)
+{
+	gboolean ret = TRUE;
+	guint64 end = offset + length;
+
+	if (file->map == NULL)
+	{
+		return FALSE;
+	}
+
+	g_rw_lock_reader_lock(&(file->lock));
+
+	if (end <= file->size)
+	{
+		backend_file_copy(file, buffer, length, offset);
+		g_rw_lock_reader_unlock(&(file->lock));
+
+		return TRUE;
+	}
+
+	g_rw_lock_reader_unlock(&(file->lock));
+
+	g_rw_lock_writer_lock(&(file->lock));
+
+	/* Another write might have grown the file in the meantime. */
+	if (end > file->size)
+	{
+		/* Allocating the blocks up front avoids allocating them during page faults. */
+		if (posix_fallocate(file->fd, file->size, end - file->size) != 0)
+		{
+			ret = FALSE;
+			goto end;
+		}
+
+		file->size = end;
+		file->metadata_dirty = TRUE;
+
+		if (end > file->capacity && !backend_file_map(file, end))
+		{
+			ret = FALSE;
+			goto end;
+		}
+	}
+
+	backend_file_copy(file, buffer, length, offset);
+
+end:
+	g_rw_lock_writer_unlock(&(file->lock));
+
+	return ret;
+}
+
+static
+gboolean
+backend_file_sync (JBackendFile* file)
+{
+	gboolean ret = TRUE;
+
+	g_rw_lock_writer_lock(&(file->lock));
+
+	if (file->pmem)
+	{
+		/* Flushes issued by other threads are ordered by the synchronization that handed the sync to this thread. */
+		pmem_drain();
+	}
+	else if (file->map != NULL && file->size > 0)
+	{
+		ret = (msync(file->map, file->size, MS_SYNC) == 0);
+	}
+
+	/* Page faults only persist the metadata of the faulting pages, a changed size has to be synced explicitly. */
+	if (file->metadata_dirty)
+	{
+		ret = (fdatasync(file->fd) == 0) && ret;
+		file->metadata_dirty = FALSE;
+	}
+
+	g_rw_lock_writer_unlock(&(file->lock));
+
+	return ret;
+}
+
+static
+gboolean
+backend_create (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendFile* file;
+	g_autofree gchar* parent = NULL;
+	gchar* full_path;
+	gint fd;
+
+	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+
+	parent = g_path_get_dirname(full_path);
+	g_mkdir_with_parents(parent, 0700);
+
+	fd = open(full_path, O_RDWR | O_CREAT, 0600);
+
+	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
+
+	file = backend_file_new(full_path, fd);
+
+	*data = file;
+
+	return (file->map != NULL);
+}
+
+static
+gboolean
+backend_open (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendFile* file;
+	gchar* full_path;
+	gint fd;
+
+	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_OPEN);
+	fd = open(full_path, O_RDWR);
+	j_trace_file_end(full_path, J_TRACE_FILE_OPEN, 0, 0);
+
+	file = backend_file_new(full_path, fd);
+
+	*data = file;
+
+	return (file->map != NULL);
+}
+
+static
+gboolean
+backend_close (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret = TRUE;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_CLOSE);
+
+	if (file->map != NULL)
+	{
+		munmap(file->map, file->capacity);
+	}
+
+	if (file->fd != -1)
+	{
+		ret = (close(file->fd) == 0);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_CLOSE, 0, 0);
+
+	g_rw_lock_clear(&(file->lock));
+
+	g_free(file->path);
+	g_slice_free(JBackendFile, file);
+
+	return ret;
+}
+
+static
+gboolean
+backend_delete (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
+	ret = (g_unlink(file->path) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+
+	backend_close(file);
+
+	return ret;
+}
+
+static
+gboolean
+backend_status (gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+	struct stat buf;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
+	ret = (fstat(file->fd, &buf) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
+
+	if (modification_time != NULL)
+	{
+		*modification_time = buf.st_mtime * G_USEC_PER_SEC;
+
+#ifdef HAVE_STMTIM_TVNSEC
+		*modification_time += buf.st_mtim.tv_nsec / 1000;
+#endif
+	}
+
+	if (size != NULL)
+	{
+		*size = buf.st_size;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_sync (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_SYNC);
+	ret = backend_file_sync(file);
+	j_trace_file_end(file->path, J_TRACE_FILE_SYNC, 0, 0);
+
+	return ret;
+}
+
+static
+gboolean
+backend_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendFile* file = data;
+	guint64 nbytes = 0;
+
+	if (file->map == NULL)
+	{
+		return FALSE;
+	}
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+
+	g_rw_lock_reader_lock(&(file->lock));
+
+	if (offset < file->size)
+	{
+		nbytes = MIN(length, file->size - offset);
+		memcpy(buffer, file->map + offset, nbytes);
+	}
+
+	g_rw_lock_reader_unlock(&(file->lock));
+
+	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes;
+	}
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+	ret = backend_file_write(file, buffer, length, offset);
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, length, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = (ret) ? length : 0;
+	}
+
+	return ret;
+}
+
+/*
+ * Writes all extents and syncs them in the same thread, so that a single fence suffices on persistent memory.
+ */
+static
+gboolean
+backend_writev (gpointer data, gconstpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+	gboolean ret = TRUE;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+	for (guint i = 0; i < count; i++)
+	{
+		if (backend_file_write(file, buffers[i], lengths[i], offsets[i]))
+		{
+			bytes_written[i] = lengths[i];
+		}
+		else
+		{
+			bytes_written[i] = 0;
+			ret = FALSE;
+		}
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, 0);
+
+	if (sync)
+	{
+		ret = backend_sync(file) && ret;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_truncate (gpointer data, guint64 size)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+	g_rw_lock_writer_lock(&(file->lock));
+
+	ret = (ftruncate(file->fd, size) == 0);
+
+	if (ret)
+	{
+		file->size = size;
+		file->metadata_dirty = TRUE;
+
+		if (size > file->capacity)
+		{
+			ret = backend_file_map(file, size);
+		}
+	}
+
+	g_rw_lock_writer_unlock(&(file->lock));
+
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, size);
+
+	return ret;
+}
+
+static
+gboolean
+backend_init (gchar const* path)
+{
+	jd_backend_path = g_strdup(path);
+
+	g_mkdir_with_parents(path, 0700);
+
+	return TRUE;
+}
+
+static
+void
+backend_fini (void)
+{
+	g_free(jd_backend_path);
+}
+
+static
+JBackend pmem_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.object = {
+		.init = backend_init,
+		.fini = backend_fini,
+		.create = backend_create,
+		.delete = backend_delete,
+		.open = backend_open,
+		.close = backend_close,
+		.status = backend_status,
+		.sync = backend_sync,
+		.read = backend_read,
+		.write = backend_write,
+		.read_to_fd = NULL,
+		.write_from_fd = NULL,
+		.truncate = backend_truncate,
+		.allocate = NULL,
+		.punch_hole = NULL,
+		.copy = NULL,
+		.readv = NULL,
+		.writev = backend_writev,
+		.hint = NULL
+	}
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info (JBackendType type)
+{
+	JBackend* backend = NULL;
+
+	if (type == J_BACKEND_TYPE_OBJECT)
+	{
+		backend = &pmem_backend;
+	}
+
+	return backend;
+}
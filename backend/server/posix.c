@@ -20,375 +20,2159 @@
 
 #include <julea-config.h>
 
+#if defined(HAVE_SPLICE) || defined(HAVE_FALLOCATE) || defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_O_DIRECT) || defined(HAVE_SEEK_DATA)
+/* Required for splice(), fallocate(), copy_file_range(), O_DIRECT and SEEK_DATA */
+#define _GNU_SOURCE
+#endif
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <gmodule.h>
 
+#include <errno.h>
 #include <fcntl.h>
+#include <string.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
+#if defined(HAVE_SENDFILE) || defined(HAVE_SPLICE)
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_FICLONE
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
 #include <julea.h>
 
+/**
+ * The alignment of buffers, offsets and lengths required for direct I/O.
+ */
+#define JD_BACKEND_DIRECT_ALIGNMENT 4096
+
+/**
+ * Compressed objects are stored as independently compressed chunks of this size, so reads only have to decompress the chunks they touch.
+ */
+#define JD_BACKEND_CHUNK_SIZE (64 * 1024)
+
+/**
+ * Every chunk has a slot of fixed size, so its position follows from its number and no separate index has to be maintained.
+ * A slot holds the chunk's header and data, the rest of it is left as a hole.
+ */
+#define JD_BACKEND_CHUNK_SLOT_SIZE (JD_BACKEND_CHUNK_SIZE + JD_BACKEND_DIRECT_ALIGNMENT)
+
+/**
+ * The slots of compressed objects start after the file header identifying them.
+ */
+#define JD_BACKEND_COMPRESSED_HEADER_SIZE JD_BACKEND_DIRECT_ALIGNMENT
+
+static gchar const jd_backend_compressed_magic[8] = "JULEA-Z";
+
+/*
+ * The header of a chunk, stored in little endian.
+ * Holes read as a header with a length of 0, which means that the chunk only contains zeros.
+ */
+struct JBackendChunkHeader
+{
+	/* The stored length, equal to the length if the chunk could not be compressed. */
+	guint32 stored_length;
+	guint32 length;
+};
+
+typedef struct JBackendChunkHeader JBackendChunkHeader;
+
 struct JBackendFile
 {
 	gchar* path;
 	gint fd;
+
+	/* Only opened in direct mode, -1 otherwise. */
+	gint direct_fd;
+
+	/* Protected by the shard's mutex. */
 	guint ref_count;
+
+	/* Whether the file is part of the cache, FALSE if opening failed or the file has been deleted. */
+	gboolean cached;
+
+	/* The file's link in the shard's list of unused files. */
+	GList unused_link;
+
+	/* Whether the file is stored in compressed chunks. */
+	gboolean compressed;
+
+	/* Serializes the read-modify-write cycles of compressed files. */
+	GMutex mutex;
 };
 
 typedef struct JBackendFile JBackendFile;
 
-static GHashTable* jd_backend_file_cache = NULL;
-static gchar* jd_backend_path = NULL;
+/**
+ * The number of shards of the file cache.
+ * Each shard has its own lock, so that threads accessing different files rarely contend.
+ */
+#define JD_BACKEND_FILE_CACHE_SHARDS 16
+
+/*
+ * Unused files are kept open, so that objects accessed repeatedly do not have to be reopened.
+ * Each shard holds a bounded number of files and closes the least recently used unused file if it is full.
+ */
+struct JBackendFileCacheShard
+{
+	GMutex mutex;
+	GHashTable* files;
+
+	/* Unused files, the least recently used one last. */
+	GQueue unused;
+};
+
+typedef struct JBackendFileCacheShard JBackendFileCacheShard;
+
+/*
+ * A directory that is being listed.
+ */
+struct JBackendListDirectory
+{
+	GDir* dir;
+	gchar* path;
+
+	/* The objects' path below the fan-out directories, NULL for fan-out directories. */
+	gchar* name;
+	guint depth;
+};
+
+typedef struct JBackendListDirectory JBackendListDirectory;
+
+/*
+ * Lists objects by walking the namespace's directories lazily, so the listing never has to be held in memory completely.
+ */
+struct JBackendListIterator
+{
+	/* The directories being listed, the innermost one last. */
+	GPtrArray* directories;
+
+	/* NULL to list all objects. */
+	gchar* prefix;
+	gchar* current;
+};
+
+typedef struct JBackendListIterator JBackendListIterator;
+
+static JBackendFileCacheShard jd_backend_file_cache[JD_BACKEND_FILE_CACHE_SHARDS];
+static guint jd_backend_file_cache_shard_size = 0;
+/*
+ * The directories of all devices, objects are placed on one of them by hashing their namespace and path.
+ */
+static gchar** jd_backend_paths = NULL;
+static guint jd_backend_path_count = 0;
+static gboolean jd_backend_direct = FALSE;
+static guint jd_backend_fanout = 0;
+/*
+ * The namespaces whose new objects are compressed, NULL if compression is disabled.
+ */
+static gchar** jd_backend_compressed_namespaces = NULL;
+/*
+ * The number of bytes written to compressed chunks before and after compressing them.
+ */
+static guint64 volatile jd_backend_compressed_bytes = 0;
+static guint64 volatile jd_backend_stored_bytes = 0;
+
+static JBackend posix_backend;
+
+#ifdef HAVE_SPLICE
+static
+void
+jd_backend_pipe_free (gpointer data)
+{
+	gint* fds = data;
+
+	close(fds[0]);
+	close(fds[1]);
+
+	g_free(fds);
+}
+
+/* Every thread uses its own pipe for splicing data from sockets into files. */
+static GPrivate jd_backend_pipe = G_PRIVATE_INIT(jd_backend_pipe_free);
+#endif
+
+static
+JBackendFileCacheShard*
+backend_file_cache_get_shard (gchar const* path)
+{
+	return &(jd_backend_file_cache[g_str_hash(path) % JD_BACKEND_FILE_CACHE_SHARDS]);
+}
+
+static
+void
+backend_file_close (JBackendFile* file)
+{
+	if (file->fd != -1)
+	{
+		j_trace_file_begin(file->path, J_TRACE_FILE_CLOSE);
+		close(file->fd);
+
+		if (file->direct_fd != -1)
+		{
+			close(file->direct_fd);
+		}
+
+		j_trace_file_end(file->path, J_TRACE_FILE_CLOSE, 0, 0);
+	}
+
+	g_mutex_clear(&(file->mutex));
+	g_free(file->path);
+	g_slice_free(JBackendFile, file);
+}
+
+/*
+ * Closes unused files until the shard is within its size.
+ * Files that are in use can not be closed, so the shard might stay too large.
+ * The shard has to be locked.
+ */
+static
+void
+backend_file_cache_trim (JBackendFileCacheShard* shard)
+{
+	while (g_hash_table_size(shard->files) > jd_backend_file_cache_shard_size && shard->unused.length > 0)
+	{
+		JBackendFile* file;
+
+		file = g_queue_pop_tail_link(&(shard->unused))->data;
+		g_hash_table_remove(shard->files, file->path);
+
+		backend_file_close(file);
+	}
+}
+
+static
+void
+backend_file_unref (gpointer data)
+{
+	JBackendFileCacheShard* shard;
+	JBackendFile* file = data;
+	gboolean close_file = FALSE;
+
+	shard = backend_file_cache_get_shard(file->path);
+
+	g_mutex_lock(&(shard->mutex));
+
+	file->ref_count--;
+
+	if (file->ref_count == 0)
+	{
+		if (file->cached)
+		{
+			g_queue_push_head_link(&(shard->unused), &(file->unused_link));
+			backend_file_cache_trim(shard);
+		}
+		else
+		{
+			close_file = TRUE;
+		}
+	}
+
+	g_mutex_unlock(&(shard->mutex));
+
+	if (close_file)
+	{
+		backend_file_close(file);
+	}
+}
+
+/*
+ * Takes a reference to a cached file.
+ * The shard has to be locked.
+ */
+static
+void
+backend_file_ref_cached (JBackendFileCacheShard* shard, JBackendFile* file)
+{
+	if (file->ref_count == 0)
+	{
+		g_queue_unlink(&(shard->unused), &(file->unused_link));
+	}
+
+	file->ref_count++;
+}
+
+/*
+ * Files are reference-counted and not bound to a thread.
+ * This allows the server to share handles between its worker threads.
+ */
+static
+JBackendFile*
+backend_file_get (gchar const* key)
+{
+	JBackendFileCacheShard* shard;
+	JBackendFile* file;
+
+	shard = backend_file_cache_get_shard(key);
+
+	g_mutex_lock(&(shard->mutex));
+
+	if ((file = g_hash_table_lookup(shard->files, key)) != NULL)
+	{
+		backend_file_ref_cached(shard, file);
+	}
+
+	g_mutex_unlock(&(shard->mutex));
+
+	return file;
+}
+
+/*
+ * Adds a newly opened file to the cache.
+ * If another thread has opened the same file in the meantime, its file is returned instead.
+ */
+static
+JBackendFile*
+backend_file_add (JBackendFile* file)
+{
+	JBackendFileCacheShard* shard;
+	JBackendFile* existing;
+
+	shard = backend_file_cache_get_shard(file->path);
+
+	g_mutex_lock(&(shard->mutex));
+
+	if ((existing = g_hash_table_lookup(shard->files, file->path)) != NULL)
+	{
+		backend_file_ref_cached(shard, existing);
+	}
+	else
+	{
+		file->cached = TRUE;
+		g_hash_table_insert(shard->files, file->path, file);
+		backend_file_cache_trim(shard);
+	}
+
+	g_mutex_unlock(&(shard->mutex));
+
+	if (existing != NULL)
+	{
+		backend_file_close(file);
+		file = existing;
+	}
+
+	return file;
+}
+
+/*
+ * Removes a file from the cache, so that it is closed as soon as it is not used anymore.
+ */
+static
+void
+backend_file_remove (JBackendFile* file)
+{
+	JBackendFileCacheShard* shard;
+
+	shard = backend_file_cache_get_shard(file->path);
+
+	g_mutex_lock(&(shard->mutex));
+
+	if (file->cached)
+	{
+		g_hash_table_remove(shard->files, file->path);
+		file->cached = FALSE;
+	}
+
+	g_mutex_unlock(&(shard->mutex));
+}
+
+/*
+ * Opens a second descriptor bypassing the page cache, used for the aligned parts of reads and writes.
+ * Unaligned parts still use the buffered descriptor.
+ */
+static
+gint
+backend_open_direct (gchar const* path, gint fd)
+{
+	gint direct_fd = -1;
+
+#ifdef HAVE_O_DIRECT
+	if (jd_backend_direct && fd != -1)
+	{
+		direct_fd = open(path, O_RDWR | O_DIRECT);
+	}
+#else
+	(void)path;
+	(void)fd;
+#endif
+
+	return direct_fd;
+}
+
+static
+JBackendFile*
+backend_file_new (gchar* path, gint fd)
+{
+	JBackendFile* file;
+
+	file = g_slice_new(JBackendFile);
+	file->path = path;
+	file->fd = fd;
+	file->direct_fd = backend_open_direct(path, fd);
+	file->ref_count = 1;
+	file->cached = FALSE;
+	file->unused_link.data = file;
+	file->unused_link.next = NULL;
+	file->unused_link.prev = NULL;
+	file->compressed = FALSE;
+
+	g_mutex_init(&(file->mutex));
+
+	return file;
+}
+
+/*
+ * Splits a transfer into an unaligned head, an aligned middle part and an unaligned tail.
+ * Returns FALSE if no part of it can use direct I/O.
+ */
+static
+gboolean
+backend_direct_split (JBackendFile* file, gconstpointer buffer, guint64 length, guint64 offset, guint64* head, guint64* middle)
+{
+	guint64 misalignment;
+
+	if (file->direct_fd == -1)
+	{
+		return FALSE;
+	}
+
+	misalignment = offset % JD_BACKEND_DIRECT_ALIGNMENT;
+
+	/* The buffer has to become aligned at the same point as the offset. */
+	if ((guintptr)buffer % JD_BACKEND_DIRECT_ALIGNMENT != misalignment)
+	{
+		return FALSE;
+	}
+
+	*head = (misalignment > 0) ? MIN(length, JD_BACKEND_DIRECT_ALIGNMENT - misalignment) : 0;
+	*middle = (length - *head) - ((length - *head) % JD_BACKEND_DIRECT_ALIGNMENT);
+
+	return (*middle > 0);
+}
+
+static
+guint64
+backend_pread_all (gint fd, gchar* buffer, guint64 length, guint64 offset)
+{
+	guint64 nbytes_total = 0;
+
+	while (nbytes_total < length)
+	{
+		gssize nbytes;
+
+		nbytes = pread(fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+static
+guint64
+backend_pwrite_all (gint fd, gchar const* buffer, guint64 length, guint64 offset)
+{
+	guint64 nbytes_total = 0;
+
+	while (nbytes_total < length)
+	{
+		gssize nbytes;
+
+		nbytes = pwrite(fd, buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+
+		if (nbytes <= 0)
+		{
+			if (nbytes < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+#ifdef HAVE_LZ4
+static
+gboolean
+backend_compressed_namespace (gchar const* namespace)
+{
+	if (jd_backend_compressed_namespaces == NULL)
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; jd_backend_compressed_namespaces[i] != NULL; i++)
+	{
+		if (g_strcmp0(jd_backend_compressed_namespaces[i], namespace) == 0)
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*
+ * Determines whether a newly opened file is compressed.
+ * Empty files in compressed namespaces get a header, existing files keep their format.
+ * This allows enabling compression for namespaces that already contain objects.
+ */
+static
+void
+backend_compressed_detect (JBackendFile* file, gchar const* namespace)
+{
+	gchar magic[sizeof(jd_backend_compressed_magic)];
+	struct stat buf;
+
+	if (file->fd == -1 || !backend_compressed_namespace(namespace))
+	{
+		return;
+	}
+
+	if (fstat(file->fd, &buf) != 0)
+	{
+		return;
+	}
+
+	if (buf.st_size == 0)
+	{
+		file->compressed = (backend_pwrite_all(file->fd, jd_backend_compressed_magic, sizeof(jd_backend_compressed_magic), 0) == sizeof(jd_backend_compressed_magic));
+	}
+	else
+	{
+		file->compressed = (backend_pread_all(file->fd, magic, sizeof(magic), 0) == sizeof(magic) && memcmp(magic, jd_backend_compressed_magic, sizeof(magic)) == 0);
+	}
+}
+
+static
+guint64
+backend_compressed_slot_offset (guint64 chunk)
+{
+	return JD_BACKEND_COMPRESSED_HEADER_SIZE + chunk * JD_BACKEND_CHUNK_SLOT_SIZE;
+}
+
+/*
+ * Returns the number of slots, the last one being the only one that may end before its slot does.
+ */
+static
+gboolean
+backend_compressed_slot_count (JBackendFile* file, guint64* count)
+{
+	struct stat buf;
+
+	if (fstat(file->fd, &buf) != 0)
+	{
+		return FALSE;
+	}
+
+	*count = 0;
+
+	if ((guint64)buf.st_size > JD_BACKEND_COMPRESSED_HEADER_SIZE)
+	{
+		*count = (buf.st_size - JD_BACKEND_COMPRESSED_HEADER_SIZE - 1) / JD_BACKEND_CHUNK_SLOT_SIZE + 1;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Reads and decompresses a chunk into a buffer of JD_BACKEND_CHUNK_SIZE bytes.
+ * The part after the chunk's length is filled with zeros.
+ */
+static
+gboolean
+backend_compressed_read_chunk (JBackendFile* file, guint64 chunk, gchar* data, guint32* length)
+{
+	JBackendChunkHeader header;
+	guint64 offset;
+	guint64 nbytes;
+	guint32 stored_length;
+
+	offset = backend_compressed_slot_offset(chunk);
+	nbytes = backend_pread_all(file->fd, (gchar*)&header, sizeof(header), offset);
+
+	if (nbytes == 0)
+	{
+		/* The chunk lies beyond the end of the file. */
+		header.stored_length = 0;
+		header.length = 0;
+	}
+	else if (nbytes != sizeof(header))
+	{
+		return FALSE;
+	}
+
+	stored_length = GUINT32_FROM_LE(header.stored_length);
+	*length = GUINT32_FROM_LE(header.length);
+
+	if (*length > JD_BACKEND_CHUNK_SIZE || stored_length > *length)
+	{
+		g_warning("Chunk %" G_GUINT64_FORMAT " of %s is corrupted.", chunk, file->path);
+		return FALSE;
+	}
+
+	if (stored_length == *length)
+	{
+		if (backend_pread_all(file->fd, data, *length, offset + sizeof(header)) != *length)
+		{
+			return FALSE;
+		}
+	}
+	else
+	{
+		g_autofree gchar* stored = NULL;
+
+		stored = g_malloc(stored_length);
+
+		if (backend_pread_all(file->fd, stored, stored_length, offset + sizeof(header)) != stored_length)
+		{
+			return FALSE;
+		}
+
+		if (LZ4_decompress_safe(stored, data, stored_length, JD_BACKEND_CHUNK_SIZE) != (gint)*length)
+		{
+			g_warning("Chunk %" G_GUINT64_FORMAT " of %s is corrupted.", chunk, file->path);
+			return FALSE;
+		}
+	}
+
+	memset(data + *length, 0, JD_BACKEND_CHUNK_SIZE - *length);
+
+	return TRUE;
+}
+
+/*
+ * Compresses and writes a chunk into its slot.
+ * If the slot is the last one, the file is truncated to the chunk's end, otherwise the rest of the slot is punched.
+ */
+static
+gboolean
+backend_compressed_write_chunk (JBackendFile* file, guint64 chunk, gchar const* data, guint32 length, gboolean last)
+{
+	JBackendChunkHeader* header;
+	g_autofree gchar* slot = NULL;
+	guint64 offset;
+	guint64 end;
+	gint stored_length = 0;
+
+	slot = g_malloc(sizeof(JBackendChunkHeader) + JD_BACKEND_CHUNK_SIZE);
+	header = (JBackendChunkHeader*)(gpointer)slot;
+
+	/* Chunks that do not become smaller are stored as they are. */
+	if (length > 1)
+	{
+		stored_length = LZ4_compress_default(data, slot + sizeof(JBackendChunkHeader), length, length - 1);
+	}
+
+	if (stored_length <= 0)
+	{
+		stored_length = length;
+		memcpy(slot + sizeof(JBackendChunkHeader), data, length);
+	}
+
+	header->stored_length = GUINT32_TO_LE(stored_length);
+	header->length = GUINT32_TO_LE(length);
+
+	offset = backend_compressed_slot_offset(chunk);
+	end = offset + sizeof(JBackendChunkHeader) + stored_length;
+
+	if (backend_pwrite_all(file->fd, slot, sizeof(JBackendChunkHeader) + stored_length, offset) != sizeof(JBackendChunkHeader) + stored_length)
+	{
+		return FALSE;
+	}
+
+	j_helper_atomic_add(&jd_backend_compressed_bytes, length);
+	j_helper_atomic_add(&jd_backend_stored_bytes, sizeof(JBackendChunkHeader) + stored_length);
+
+	if (last)
+	{
+		return (ftruncate(file->fd, end) == 0);
+	}
+
+#ifdef HAVE_FALLOCATE
+	/* Only whole blocks are freed, punching fails harmlessly on file systems that do not support it. */
+	fallocate(file->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, end, offset + JD_BACKEND_CHUNK_SLOT_SIZE - end);
+#endif
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_compressed_size (JBackendFile* file, guint64* size)
+{
+	g_autofree gchar* data = NULL;
+	guint64 count;
+	guint32 length;
+
+	*size = 0;
+
+	if (!backend_compressed_slot_count(file, &count))
+	{
+		return FALSE;
+	}
+
+	if (count == 0)
+	{
+		return TRUE;
+	}
+
+	data = g_malloc(JD_BACKEND_CHUNK_SIZE);
+
+	if (!backend_compressed_read_chunk(file, count - 1, data, &length))
+	{
+		return FALSE;
+	}
+
+	*size = (count - 1) * JD_BACKEND_CHUNK_SIZE + length;
+
+	return TRUE;
+}
+
+/*
+ * Reads the chunks overlapping the range, stopping at the end of the object.
+ * The file's mutex has to be locked.
+ */
+static
+guint64
+backend_compressed_read (JBackendFile* file, gchar* buffer, guint64 length, guint64 offset)
+{
+	g_autofree gchar* data = NULL;
+	guint64 size;
+	guint64 nbytes_total = 0;
+
+	if (!backend_compressed_size(file, &size) || offset >= size)
+	{
+		return 0;
+	}
+
+	length = MIN(length, size - offset);
+	data = g_malloc(JD_BACKEND_CHUNK_SIZE);
+
+	while (nbytes_total < length)
+	{
+		guint64 chunk = (offset + nbytes_total) / JD_BACKEND_CHUNK_SIZE;
+		guint64 chunk_offset = (offset + nbytes_total) % JD_BACKEND_CHUNK_SIZE;
+		guint64 nbytes = MIN(length - nbytes_total, JD_BACKEND_CHUNK_SIZE - chunk_offset);
+		guint32 chunk_length;
+
+		/* Chunks before the last one are padded with zeros. */
+		if (!backend_compressed_read_chunk(file, chunk, data, &chunk_length))
+		{
+			break;
+		}
+
+		memcpy(buffer + nbytes_total, data + chunk_offset, nbytes);
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+/*
+ * Writes the range by merging it into the overlapping chunks.
+ * If buffer is NULL, zeros are written.
+ * The file's mutex has to be locked.
+ */
+static
+guint64
+backend_compressed_write (JBackendFile* file, gchar const* buffer, guint64 length, guint64 offset)
+{
+	g_autofree gchar* data = NULL;
+	guint64 count;
+	guint64 nbytes_total = 0;
+
+	if (!backend_compressed_slot_count(file, &count))
+	{
+		return 0;
+	}
+
+	data = g_malloc(JD_BACKEND_CHUNK_SIZE);
+
+	while (nbytes_total < length)
+	{
+		guint64 chunk = (offset + nbytes_total) / JD_BACKEND_CHUNK_SIZE;
+		guint64 chunk_offset = (offset + nbytes_total) % JD_BACKEND_CHUNK_SIZE;
+		guint64 nbytes = MIN(length - nbytes_total, JD_BACKEND_CHUNK_SIZE - chunk_offset);
+		guint32 chunk_length = 0;
+
+		/* Chunks that are overwritten completely do not have to be read. */
+		if (nbytes < JD_BACKEND_CHUNK_SIZE && !backend_compressed_read_chunk(file, chunk, data, &chunk_length))
+		{
+			break;
+		}
+
+		if (buffer != NULL)
+		{
+			memcpy(data + chunk_offset, buffer + nbytes_total, nbytes);
+		}
+		else
+		{
+			memset(data + chunk_offset, 0, nbytes);
+		}
+
+		chunk_length = MAX(chunk_length, chunk_offset + nbytes);
+
+		if (!backend_compressed_write_chunk(file, chunk, data, chunk_length, chunk + 1 >= count))
+		{
+			break;
+		}
+
+		count = MAX(count, chunk + 1);
+		nbytes_total += nbytes;
+	}
+
+	return nbytes_total;
+}
+
+/*
+ * Truncates or extends the object by rewriting its new last chunk.
+ * The file's mutex has to be locked.
+ */
+static
+gboolean
+backend_compressed_truncate (JBackendFile* file, guint64 size)
+{
+	g_autofree gchar* data = NULL;
+	guint64 chunk;
+	guint32 length;
+
+	if (size == 0)
+	{
+		return (ftruncate(file->fd, JD_BACKEND_COMPRESSED_HEADER_SIZE) == 0);
+	}
+
+	chunk = (size - 1) / JD_BACKEND_CHUNK_SIZE;
+	data = g_malloc(JD_BACKEND_CHUNK_SIZE);
+
+	if (!backend_compressed_read_chunk(file, chunk, data, &length))
+	{
+		return FALSE;
+	}
+
+	return backend_compressed_write_chunk(file, chunk, data, size - chunk * JD_BACKEND_CHUNK_SIZE, TRUE);
+}
+#else
+static
+void
+backend_compressed_detect (JBackendFile* file, gchar const* namespace)
+{
+	(void)file;
+	(void)namespace;
+}
+#endif
+
+/*
+ * Returns the directory of the device an object is placed on.
+ * The placement only depends on the object's name, so the list of devices must not be changed for existing objects.
+ */
+static
+gchar const*
+backend_device_path (gchar const* namespace, gchar const* path)
+{
+	g_autofree gchar* name = NULL;
+
+	if (jd_backend_path_count == 1)
+	{
+		return jd_backend_paths[0];
+	}
+
+	/* The namespace is included, so that the placement differs from the fan-out, which only hashes the path. */
+	name = g_strconcat(namespace, "/", path, NULL);
+
+	return jd_backend_paths[j_helper_hash(name) % jd_backend_path_count];
+}
+
+/*
+ * With fan-out, objects are spread over hashed directories within their namespace.
+ */
+static
+gchar*
+backend_build_path (gchar const* namespace, gchar const* path)
+{
+	g_autofree gchar* fanout_path = NULL;
+
+	fanout_path = j_helper_get_fanout_path(path, jd_backend_fanout);
+
+	return g_build_filename(backend_device_path(namespace, path), namespace, fanout_path, NULL);
+}
+
+static
+gboolean
+backend_create (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendFile* file = NULL;
+	g_autofree gchar* parent = NULL;
+	gchar* full_path;
+	gint fd;
+
+	full_path = backend_build_path(namespace, path);
+
+	if ((file = backend_file_get(full_path)) != NULL)
+	{
+		g_free(full_path);
+
+		goto end;
+	}
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+
+	parent = g_path_get_dirname(full_path);
+	g_mkdir_with_parents(parent, 0700);
+
+	fd = open(full_path, O_RDWR | O_CREAT, 0600);
+
+	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
+
+	file = backend_file_new(full_path, fd);
+	backend_compressed_detect(file, namespace);
+
+	/* Files that could not be opened are not cached, so that later attempts try again. */
+	if (fd != -1)
+	{
+		file = backend_file_add(file);
+	}
+
+end:
+	*data = file;
+
+	return (file->fd != -1);
+}
+
+static
+gboolean
+backend_open (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendFile* file = NULL;
+	gchar* full_path;
+	gint fd;
+
+	full_path = backend_build_path(namespace, path);
+
+	if ((file = backend_file_get(full_path)) != NULL)
+	{
+		g_free(full_path);
+
+		goto end;
+	}
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_OPEN);
+	fd = open(full_path, O_RDWR);
+	j_trace_file_end(full_path, J_TRACE_FILE_OPEN, 0, 0);
+
+	file = backend_file_new(full_path, fd);
+	backend_compressed_detect(file, namespace);
+
+	if (fd != -1)
+	{
+		file = backend_file_add(file);
+	}
+
+end:
+	*data = file;
+
+	return (file->fd != -1);
+}
+
+static
+gboolean
+backend_delete (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
+	ret = (g_unlink(file->path) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+
+	/* Otherwise, recreating the object would return the deleted file. */
+	backend_file_remove(file);
+	backend_file_unref(file);
+
+	return ret;
+}
+
+static
+gboolean
+backend_rename (gpointer data, gchar const* namespace, gchar const* path)
+{
+	JBackendFile* file = data;
+	g_autofree gchar* new_path = NULL;
+	g_autofree gchar* parent = NULL;
+	gboolean ret;
+
+	/* Fails if the new name is placed on a different device. */
+	new_path = backend_build_path(namespace, path);
+	parent = g_path_get_dirname(new_path);
+	g_mkdir_with_parents(parent, 0700);
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
+	ret = (g_rename(file->path, new_path) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+
+	/* The object stays open if it could not be moved, so that the caller can still delete it. */
+	if (ret)
+	{
+		/* The cached file still refers to the old path. */
+		backend_file_remove(file);
+		backend_file_unref(file);
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_close (gpointer data)
+{
+	JBackendFile* file = data;
+
+	backend_file_unref(file);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_status (gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+	struct stat buf;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
+	ret = (fstat(file->fd, &buf) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
+
+	if (modification_time != NULL)
+	{
+		*modification_time = buf.st_mtime * G_USEC_PER_SEC;
+
+#ifdef HAVE_STMTIM_TVNSEC
+		*modification_time += buf.st_mtim.tv_nsec / 1000;
+#endif
+	}
+
+	if (size != NULL)
+	{
+		*size = buf.st_size;
+
+#ifdef HAVE_LZ4
+		if (ret && file->compressed)
+		{
+			g_mutex_lock(&(file->mutex));
+			ret = backend_compressed_size(file, size);
+			g_mutex_unlock(&(file->mutex));
+		}
+#endif
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_sync (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_SYNC);
+	ret = (fsync(file->fd) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_SYNC, 0, 0);
+
+	return ret;
+}
+
+static
+gboolean
+backend_truncate (gpointer data, guint64 size)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+#ifdef HAVE_LZ4
+	if (file->compressed)
+	{
+		g_mutex_lock(&(file->mutex));
+		ret = backend_compressed_truncate(file, size);
+		g_mutex_unlock(&(file->mutex));
+	}
+	else
+#endif
+	{
+		ret = (ftruncate(file->fd, size) == 0);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, size);
+
+	return ret;
+}
+
+/*
+ * Reserves space without changing the file's size if possible.
+ */
+static
+gboolean
+backend_allocate (gpointer data, guint64 length, guint64 offset)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	/* The space needed by compressed chunks is not known in advance. */
+	if (file->compressed)
+	{
+		return TRUE;
+	}
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+#ifdef HAVE_FALLOCATE
+	ret = (fallocate(file->fd, FALLOC_FL_KEEP_SIZE, offset, length) == 0);
+#else
+	ret = (posix_fallocate(file->fd, offset, length) == 0);
+#endif
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, offset);
+
+	return ret;
+}
+
+#ifdef HAVE_FALLOCATE
+static
+gboolean
+backend_punch_hole (gpointer data, guint64 length, guint64 offset)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+#ifdef HAVE_LZ4
+	if (file->compressed)
+	{
+		guint64 size;
+
+		g_mutex_lock(&(file->mutex));
+
+		/* Holes do not change the object's size, so only the part within the object has to be zeroed. */
+		ret = backend_compressed_size(file, &size);
+
+		if (ret && offset < size)
+		{
+			length = MIN(length, size - offset);
+			ret = (backend_compressed_write(file, NULL, length, offset) == length);
+		}
+
+		g_mutex_unlock(&(file->mutex));
+	}
+	else
+#endif
+	{
+		ret = (fallocate(file->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, offset);
+
+	return ret;
+}
+#endif
+
+#ifdef HAVE_SEEK_DATA
+/*
+ * Finds the extents containing data using SEEK_DATA and SEEK_HOLE.
+ * File systems without support for holes report the whole file as data.
+ */
+static
+gboolean
+backend_extents (gpointer data, guint64 length, guint64 offset, guint64* lengths, guint64* offsets, guint max_count, guint* count)
+{
+	JBackendFile* file = data;
+	gboolean ret = TRUE;
+	guint64 end;
+	guint64 position;
+	guint64 size;
+	struct stat buf;
+
+	*count = 0;
+
+	if (fstat(file->fd, &buf) != 0)
+	{
+		return FALSE;
+	}
+
+	size = buf.st_size;
+	end = (length > G_MAXUINT64 - offset) ? G_MAXUINT64 : offset + length;
+
+#ifdef HAVE_LZ4
+	/* Compressed chunks do not correspond to the object's offsets, so the whole object is reported as data. */
+	if (file->compressed)
+	{
+		g_mutex_lock(&(file->mutex));
+		ret = backend_compressed_size(file, &size);
+		g_mutex_unlock(&(file->mutex));
+
+		end = MIN(end, size);
+
+		if (ret && max_count > 0 && offset < end)
+		{
+			lengths[0] = end - offset;
+			offsets[0] = offset;
+			*count = 1;
+		}
+
+		return ret;
+	}
+#endif
+
+	end = MIN(end, size);
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
+
+	position = offset;
+
+	while (position < end && *count < max_count)
+	{
+		off_t data_start;
+		off_t hole_start;
+
+		/* The file offset is changed, which is harmless because all accesses use explicit offsets. */
+		data_start = lseek(file->fd, position, SEEK_DATA);
+
+		if (data_start < 0)
+		{
+			/* There is no more data after the position. */
+			ret = (errno == ENXIO);
+			break;
+		}
+
+		if ((guint64)data_start >= end)
+		{
+			break;
+		}
+
+		hole_start = lseek(file->fd, data_start, SEEK_HOLE);
+
+		if (hole_start < 0)
+		{
+			ret = FALSE;
+			break;
+		}
+
+		lengths[*count] = MIN((guint64)hole_start, end) - data_start;
+		offsets[*count] = data_start;
+		(*count)++;
+
+		position = hole_start;
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
+
+	return ret;
+}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+/*
+ * Copies the whole file within the kernel.
+ * Reflinks share the data until it is modified, otherwise copy_file_range() is used.
+ */
+static
+gboolean
+backend_copy (gpointer from, gpointer to, guint64* bytes_copied)
+{
+	JBackendFile* from_file = from;
+	JBackendFile* to_file = to;
+
+	gboolean ret = TRUE;
+	loff_t from_offset = 0;
+	loff_t to_offset = 0;
+
+	/* Files with different formats have to be copied by reading and writing them. */
+	if (from_file->compressed != to_file->compressed)
+	{
+		return FALSE;
+	}
+
+	j_trace_file_begin(to_file->path, J_TRACE_FILE_WRITE);
+
+	if (ftruncate(to_file->fd, 0) != 0)
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+#ifdef HAVE_FICLONE
+	if (ioctl(to_file->fd, FICLONE, from_file->fd) == 0)
+	{
+		struct stat buf;
+
+		if (fstat(to_file->fd, &buf) == 0)
+		{
+			to_offset = buf.st_size;
+		}
+
+		goto end;
+	}
+#endif
+
+	while (TRUE)
+	{
+		gssize nbytes;
+
+		nbytes = copy_file_range(from_file->fd, &from_offset, to_file->fd, &to_offset, G_MAXSSIZE, 0);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			if (errno != EINTR)
+			{
+				ret = FALSE;
+				break;
+			}
+		}
+	}
+
+end:
+	j_trace_file_end(to_file->path, J_TRACE_FILE_WRITE, to_offset, 0);
+
+	*bytes_copied = to_offset;
+
+#ifdef HAVE_LZ4
+	/* The header and the slots are copied, too. */
+	if (ret && to_file->compressed)
+	{
+		ret = backend_compressed_size(to_file, bytes_copied);
+	}
+#endif
+
+	return ret;
+}
+#endif
+
+static
+gboolean
+backend_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendFile* file = data;
+	gchar* buf = buffer;
+	guint64 head;
+	guint64 middle;
+
+	guint64 nbytes_total = 0;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+
+#ifdef HAVE_LZ4
+	if (file->compressed)
+	{
+		g_mutex_lock(&(file->mutex));
+		nbytes_total = backend_compressed_read(file, buf, length, offset);
+		g_mutex_unlock(&(file->mutex));
+	}
+	else
+#endif
+	if (backend_direct_split(file, buffer, length, offset, &head, &middle))
+	{
+		/* Every part has to be read completely, otherwise the end of the object has been reached. */
+		nbytes_total = backend_pread_all(file->fd, buf, head, offset);
+
+		if (nbytes_total == head)
+		{
+			nbytes_total += backend_pread_all(file->direct_fd, buf + head, middle, offset + head);
+		}
+
+		if (nbytes_total == head + middle)
+		{
+			nbytes_total += backend_pread_all(file->fd, buf + nbytes_total, length - nbytes_total, offset + nbytes_total);
+		}
+	}
+	else
+	{
+		nbytes_total = backend_pread_all(file->fd, buf, length, offset);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes_total, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes_total;
+	}
+
+	return (nbytes_total == length);
+}
+
+static
+gboolean
+backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+	gchar const* buf = buffer;
+	guint64 head;
+	guint64 middle;
+
+	guint64 nbytes_total = 0;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+#ifdef HAVE_LZ4
+	if (file->compressed)
+	{
+		g_mutex_lock(&(file->mutex));
+		nbytes_total = backend_compressed_write(file, buf, length, offset);
+		g_mutex_unlock(&(file->mutex));
+	}
+	else
+#endif
+	if (backend_direct_split(file, buffer, length, offset, &head, &middle))
+	{
+		nbytes_total = backend_pwrite_all(file->fd, buf, head, offset);
+
+		if (nbytes_total == head)
+		{
+			nbytes_total += backend_pwrite_all(file->direct_fd, buf + head, middle, offset + head);
+		}
+
+		if (nbytes_total == head + middle)
+		{
+			nbytes_total += backend_pwrite_all(file->fd, buf + nbytes_total, length - nbytes_total, offset + nbytes_total);
+		}
+	}
+	else
+	{
+		nbytes_total = backend_pwrite_all(file->fd, buf, length, offset);
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, nbytes_total, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes_total;
+	}
+
+	return (nbytes_total == length);
+}
+
+#if defined(HAVE_SENDFILE) || defined(HAVE_SPLICE)
+/*
+ * Waits until a socket is ready.
+ * GSocket puts its descriptors into non-blocking mode, so sendfile() and splice() return EAGAIN instead of blocking.
+ */
+static
+gboolean
+backend_fd_wait (gint fd, gshort events)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = events;
+	pfd.revents = 0;
+
+	while (poll(&pfd, 1, -1) < 0)
+	{
+		if (errno != EINTR)
+		{
+			return FALSE;
+		}
+	}
+
+	return ((pfd.revents & (POLLERR | POLLNVAL)) == 0);
+}
+#endif
+
+#ifdef HAVE_SENDFILE
+static
+gboolean
+backend_read_to_fd (gpointer data, gint fd, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendFile* file = data;
+
+	gsize nbytes_total = 0;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+
+	while (nbytes_total < length)
+	{
+		off_t file_offset = offset + nbytes_total;
+		gssize nbytes;
+
+		/* The data is copied from the page cache to the socket without passing through user space. */
+		nbytes = sendfile(fd, file->fd, &file_offset, length - nbytes_total);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			/* The socket's send buffer is full. */
+			if ((errno == EAGAIN || errno == EWOULDBLOCK) && backend_fd_wait(fd, POLLOUT))
+			{
+				continue;
+			}
+
+			break;
+		}
+
+		nbytes_total += nbytes;
+	}
+
+	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes_total, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes_total;
+	}
+
+	return (nbytes_total == length);
+}
+#endif
+
+#ifdef HAVE_SPLICE
+static
+gint*
+jd_backend_pipe_get_thread (void)
+{
+	gint* fds;
+
+	fds = g_private_get(&jd_backend_pipe);
+
+	if (G_UNLIKELY(fds == NULL))
+	{
+		fds = g_new(gint, 2);
+
+		if (pipe(fds) != 0)
+		{
+			g_free(fds);
+			return NULL;
+		}
+
+		g_private_replace(&jd_backend_pipe, fds);
+	}
+
+	return fds;
+}
+
+/*
+ * Moves data from fd into the file using a pipe, without copying it to user space.
+ * Exactly length bytes are consumed from fd, even if writing to the file fails, to keep the stream consistent.
+ * If fd fails before, it is shut down, because the rest of the stream can not be interpreted anymore.
+ */
+static
+gboolean
+backend_write_from_fd (gpointer data, gint fd, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+
+	gint* fds;
+	gboolean error = FALSE;
+	gsize nbytes_consumed = 0;
+	gsize nbytes_total = 0;
+
+	if ((fds = jd_backend_pipe_get_thread()) == NULL)
+	{
+		return FALSE;
+	}
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+
+	while (nbytes_consumed < length)
+	{
+		gssize nbytes;
+
+		nbytes = splice(fd, NULL, fds[1], NULL, MIN(length - nbytes_consumed, 64 * 1024), SPLICE_F_MOVE | SPLICE_F_MORE);
+
+		if (nbytes == 0)
+		{
+			shutdown(fd, SHUT_RDWR);
+			break;
+		}
+		else if (nbytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			/* The rest of the payload has not arrived yet. */
+			if ((errno == EAGAIN || errno == EWOULDBLOCK) && backend_fd_wait(fd, POLLIN))
+			{
+				continue;
+			}
+
+			shutdown(fd, SHUT_RDWR);
+			break;
+		}
+
+		nbytes_consumed += nbytes;
+
+		while (nbytes > 0)
+		{
+			gssize nbytes_file;
+
+			if (!error)
+			{
+				loff_t file_offset = offset + nbytes_total;
+
+				nbytes_file = splice(fds[0], NULL, file->fd, &file_offset, nbytes, SPLICE_F_MOVE);
+			}
+			else
+			{
+				gchar buf[4096];
+
+				/* Drain the pipe if the file can not be written anymore. */
+				nbytes_file = read(fds[0], buf, MIN((gsize)nbytes, sizeof(buf)));
+			}
+
+			if (nbytes_file == 0)
+			{
+				/* The pipe still holds data but none of it could be moved, so it is broken. */
+				shutdown(fd, SHUT_RDWR);
+				goto end;
+			}
+			else if (nbytes_file < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				if (error)
+				{
+					/* The pipe is broken, too. */
+					shutdown(fd, SHUT_RDWR);
+					goto end;
+				}
+
+				error = TRUE;
+				continue;
+			}
+
+			if (!error)
+			{
+				nbytes_total += nbytes_file;
+			}
+
+			nbytes -= nbytes_file;
+		}
+	}
+
+end:
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, nbytes_total, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes_total;
+	}
 
-G_LOCK_DEFINE_STATIC(jd_backend_file_cache);
+	return (nbytes_total == length);
+}
+#endif
 
+/*
+ * Removes all cached files below a directory, closing the unused ones.
+ * Files that are in use are closed as soon as they are released.
+ */
 static
 void
-jd_backend_files_free (gpointer data)
+backend_file_cache_remove_prefix (gchar const* prefix)
 {
-	GHashTable* files = data;
+	for (guint i = 0; i < JD_BACKEND_FILE_CACHE_SHARDS; i++)
+	{
+		JBackendFileCacheShard* shard = &(jd_backend_file_cache[i]);
+		GHashTableIter iter;
+		GList* closed = NULL;
+		gpointer value;
 
-	g_hash_table_destroy(files);
-}
+		g_mutex_lock(&(shard->mutex));
 
-// FIXME not deleted?
-static GPrivate jd_backend_files = G_PRIVATE_INIT(jd_backend_files_free);
+		g_hash_table_iter_init(&iter, shard->files);
 
-static
-void
-backend_file_unref (gpointer data)
-{
-	JBackendFile* file = data;
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			JBackendFile* file = value;
+
+			if (!g_str_has_prefix(file->path, prefix))
+			{
+				continue;
+			}
 
-	G_LOCK(jd_backend_file_cache);
+			g_hash_table_iter_remove(&iter);
+			file->cached = FALSE;
 
-	if (g_atomic_int_dec_and_test(&(file->ref_count)))
-	{
-		g_hash_table_remove(jd_backend_file_cache, file->path);
+			if (file->ref_count == 0)
+			{
+				g_queue_unlink(&(shard->unused), &(file->unused_link));
+				closed = g_list_prepend(closed, file);
+			}
+		}
 
-		j_trace_file_begin(file->path, J_TRACE_FILE_CLOSE);
-		close(file->fd);
-		j_trace_file_end(file->path, J_TRACE_FILE_CLOSE, 0, 0);
+		g_mutex_unlock(&(shard->mutex));
 
-		g_free(file->path);
-		g_slice_free(JBackendFile, file);
+		g_list_free_full(closed, (GDestroyNotify)backend_file_close);
 	}
-
-	G_UNLOCK(jd_backend_file_cache);
 }
 
+/*
+ * Removes a file or a directory including its contents.
+ */
 static
-GHashTable*
-jd_backend_files_get_thread (void)
+gboolean
+backend_remove_tree (gchar const* path)
 {
-	GHashTable* files;
+	GDir* dir;
+	gchar const* name;
+	gboolean ret = TRUE;
 
-	files = g_private_get(&jd_backend_files);
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return (g_unlink(path) == 0 || errno == ENOENT);
+	}
 
-	if (G_UNLIKELY(files == NULL))
+	while ((name = g_dir_read_name(dir)) != NULL)
 	{
-		files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, backend_file_unref);
-		g_private_replace(&jd_backend_files, files);
+		g_autofree gchar* child = NULL;
+
+		child = g_build_filename(path, name, NULL);
+		ret = backend_remove_tree(child) && ret;
 	}
 
-	return files;
+	g_dir_close(dir);
+
+	return (g_rmdir(path) == 0) && ret;
 }
 
+/*
+ * Removes the directory from every fan-out directory below the given one.
+ */
 static
-JBackendFile*
-backend_file_get (GHashTable* files, gchar const* key)
+gboolean
+backend_purge_fanout (gchar const* path, guint depth, gchar const* directory)
 {
-	JBackendFile* file;
+	GDir* dir;
+	gchar const* name;
+	gboolean ret = TRUE;
 
-	if ((file = g_hash_table_lookup(files, key)) != NULL)
+	if (depth == 0)
 	{
-		goto end;
+		g_autofree gchar* purged = NULL;
+		g_autofree gchar* prefix = NULL;
+
+		purged = g_build_filename(path, directory, NULL);
+		prefix = g_strconcat(purged, G_DIR_SEPARATOR_S, NULL);
+
+		backend_file_cache_remove_prefix(prefix);
+
+		return backend_remove_tree(purged);
 	}
 
-	G_LOCK(jd_backend_file_cache);
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return TRUE;
+	}
 
-	if ((file = g_hash_table_lookup(jd_backend_file_cache, key)) != NULL)
+	while ((name = g_dir_read_name(dir)) != NULL)
 	{
-		g_atomic_int_inc(&(file->ref_count));
-		g_hash_table_insert(files, file->path, file);
-		G_UNLOCK(jd_backend_file_cache);
+		g_autofree gchar* child = NULL;
+
+		child = g_build_filename(path, name, NULL);
+		ret = backend_purge_fanout(child, depth - 1, directory) && ret;
 	}
 
-	/* Attention: The caller must call backend_file_add() if NULL is returned! */
+	g_dir_close(dir);
 
-end:
-	return file;
+	return ret;
 }
 
 static
-void
-backend_file_add (GHashTable* files, JBackendFile* file)
+gboolean
+backend_purge (gchar const* namespace, gchar const* directory)
 {
-	g_hash_table_insert(jd_backend_file_cache, file->path, file);
-	g_hash_table_insert(files, file->path, file);
+	gboolean ret = TRUE;
+
+	/* With fan-out, the objects of a directory are spread over all hashed directories of all devices. */
+	for (guint i = 0; i < jd_backend_path_count; i++)
+	{
+		g_autofree gchar* path = NULL;
 
-	G_UNLOCK(jd_backend_file_cache);
+		path = g_build_filename(jd_backend_paths[i], namespace, NULL);
+		ret = backend_purge_fanout(path, jd_backend_fanout, directory) && ret;
+	}
+
+	return ret;
 }
 
 static
-gboolean
-backend_create (gchar const* namespace, gchar const* path, gpointer* data)
+void
+backend_list_directory_free (gpointer data)
 {
-	GHashTable* files = jd_backend_files_get_thread();
-
-	JBackendFile* file = NULL;
-	g_autofree gchar* parent = NULL;
-	gchar* full_path;
-	gint fd;
+	JBackendListDirectory* directory = data;
 
-	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+	g_dir_close(directory->dir);
+	g_free(directory->path);
+	g_free(directory->name);
 
-	if ((file = backend_file_get(files, full_path)) != NULL)
-	{
-		g_free(full_path);
+	g_slice_free(JBackendListDirectory, directory);
+}
 
-		// FIXME
-		fd = file->fd;
+static
+void
+backend_list_push (JBackendListIterator* iterator, gchar const* path, gchar const* name, guint depth)
+{
+	JBackendListDirectory* directory;
+	GDir* dir;
 
-		goto end;
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return;
 	}
 
-	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+	directory = g_slice_new(JBackendListDirectory);
+	directory->dir = dir;
+	directory->path = g_strdup(path);
+	directory->name = g_strdup(name);
+	directory->depth = depth;
 
-	parent = g_path_get_dirname(full_path);
-	g_mkdir_with_parents(parent, 0700);
+	g_ptr_array_add(iterator->directories, directory);
+}
 
-	fd = open(full_path, O_RDWR | O_CREAT, 0600);
+static
+gboolean
+backend_list_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	JBackendListIterator* iterator;
 
-	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
+	iterator = g_slice_new(JBackendListIterator);
+	iterator->directories = g_ptr_array_new_with_free_func(backend_list_directory_free);
+	iterator->prefix = g_strdup(prefix);
+	iterator->current = NULL;
 
-	file = g_slice_new(JBackendFile);
-	file->path = full_path;
-	file->fd = fd;
-	file->ref_count = 1;
+	/* The devices are listed one after the other, a missing namespace does not contain any objects. */
+	for (guint i = jd_backend_path_count; i > 0; i--)
+	{
+		g_autofree gchar* path = NULL;
 
-	backend_file_add(files, file);
+		path = g_build_filename(jd_backend_paths[i - 1], namespace, NULL);
+		backend_list_push(iterator, path, NULL, 0);
+	}
 
-end:
-	*data = file;
+	*data = iterator;
 
-	return (fd != -1);
+	return TRUE;
 }
 
 static
 gboolean
-backend_open (gchar const* namespace, gchar const* path, gpointer* data)
+backend_list (gchar const* namespace, gpointer* data)
 {
-	GHashTable* files = jd_backend_files_get_thread();
+	return backend_list_by_prefix(namespace, NULL, data);
+}
 
-	JBackendFile* file = NULL;
-	gchar* full_path;
-	gint fd;
+static
+gboolean
+backend_iterate (gpointer data, gchar const** path)
+{
+	JBackendListIterator* iterator = data;
 
-	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+	g_free(iterator->current);
+	iterator->current = NULL;
 
-	if ((file = backend_file_get(files, full_path)) != NULL)
+	while (iterator->directories->len > 0)
 	{
-		g_free(full_path);
-
-		// FIXME
-		fd = file->fd;
+		JBackendListDirectory* directory = g_ptr_array_index(iterator->directories, iterator->directories->len - 1);
+		g_autofree gchar* child = NULL;
+		g_autofree gchar* name = NULL;
+		gchar const* entry;
 
-		goto end;
-	}
+		if ((entry = g_dir_read_name(directory->dir)) == NULL)
+		{
+			g_ptr_array_remove_index(iterator->directories, iterator->directories->len - 1);
+			continue;
+		}
 
-	j_trace_file_begin(full_path, J_TRACE_FILE_OPEN);
-	fd = open(full_path, O_RDWR);
-	j_trace_file_end(full_path, J_TRACE_FILE_OPEN, 0, 0);
+		child = g_build_filename(directory->path, entry, NULL);
 
-	file = g_slice_new(JBackendFile);
-	file->path = full_path;
-	file->fd = fd;
-	file->ref_count = 1;
+		/* Fan-out directories only mirror the hash of the objects' names. */
+		if (directory->depth < jd_backend_fanout)
+		{
+			backend_list_push(iterator, child, NULL, directory->depth + 1);
+			continue;
+		}
 
-	backend_file_add(files, file);
+		name = (directory->name != NULL) ? g_build_filename(directory->name, entry, NULL) : g_strdup(entry);
 
-end:
-	*data = file;
+		if (g_file_test(child, G_FILE_TEST_IS_DIR))
+		{
+			g_autofree gchar* name_dir = NULL;
 
-	return (fd != -1);
-}
+			name_dir = g_strconcat(name, G_DIR_SEPARATOR_S, NULL);
 
-static
-gboolean
-backend_delete (gpointer data)
-{
-	JBackendFile* file = data;
-	GHashTable* files = jd_backend_files_get_thread();
-	gboolean ret;
+			/* Skip directories that can not contain objects with the prefix. */
+			if (iterator->prefix == NULL || g_str_has_prefix(name_dir, iterator->prefix) || g_str_has_prefix(iterator->prefix, name_dir))
+			{
+				backend_list_push(iterator, child, name, directory->depth + 1);
+			}
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
-	ret = (g_unlink(file->path) == 0);
-	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+			continue;
+		}
 
-	g_hash_table_remove(files, file->path);
+		if (iterator->prefix == NULL || g_str_has_prefix(name, iterator->prefix))
+		{
+			iterator->current = g_steal_pointer(&name);
+			*path = iterator->current;
 
-	return ret;
-}
+			return TRUE;
+		}
+	}
 
-static
-gboolean
-backend_close (gpointer data)
-{
-	JBackendFile* file = data;
-	GHashTable* files = jd_backend_files_get_thread();
-	gboolean ret;
+	g_ptr_array_unref(iterator->directories);
+	g_free(iterator->prefix);
 
-	ret = g_hash_table_remove(files, file->path);
+	g_slice_free(JBackendListIterator, iterator);
 
-	return ret;
+	return FALSE;
 }
 
+#ifdef HAVE_POSIX_FADVISE
 static
 gboolean
-backend_status (gpointer data, gint64* modification_time, guint64* size)
+backend_hint (gpointer data, gint access, guint64 length, guint64 offset)
 {
 	JBackendFile* file = data;
+	gint advice = POSIX_FADV_NORMAL;
 	gboolean ret;
-	struct stat buf;
-
-	j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
-	ret = (fstat(file->fd, &buf) == 0);
-	j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
 
-	if (modification_time != NULL)
+	if (access == J_SEMANTICS_ACCESS_SEQUENTIAL)
 	{
-		*modification_time = buf.st_mtime * G_USEC_PER_SEC;
-
-#ifdef HAVE_STMTIM_TVNSEC
-		*modification_time += buf.st_mtim.tv_nsec / 1000;
-#endif
+		advice = POSIX_FADV_SEQUENTIAL;
+	}
+	else if (access == J_SEMANTICS_ACCESS_RANDOM)
+	{
+		advice = POSIX_FADV_RANDOM;
 	}
 
-	if (size != NULL)
+	/* The readahead window belongs to the descriptor, so the advice always applies to the whole file. */
+	ret = (posix_fadvise(file->fd, 0, 0, advice) == 0);
+
+	/* Start reading the following range, so that the next read of a stream finds it in the page cache.
+	   Direct I/O bypasses the page cache, so prefetching would only waste memory. */
+	if (access == J_SEMANTICS_ACCESS_SEQUENTIAL && file->direct_fd == -1)
 	{
-		*size = buf.st_size;
+		posix_fadvise(file->fd, offset + length, length, POSIX_FADV_WILLNEED);
 	}
 
 	return ret;
 }
+#endif
 
+#ifdef HAVE_POSIX_FADVISE
 static
 gboolean
-backend_sync (gpointer data)
+backend_prefetch (gpointer data, guint64 length, guint64 offset)
 {
 	JBackendFile* file = data;
-	gboolean ret;
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_SYNC);
-	ret = (fsync(file->fd) == 0);
-	j_trace_file_end(file->path, J_TRACE_FILE_SYNC, 0, 0);
+	/* Direct reads do not use the page cache, so there is nothing to warm. */
+	if (file->direct_fd != -1)
+	{
+		return TRUE;
+	}
 
-	return ret;
+#ifdef HAVE_LZ4
+	/* Compressed blocks are not stored at their logical offsets, so the whole file is read. */
+	if (file->compressed)
+	{
+		offset = 0;
+		length = 0;
+	}
+#endif
+
+	return (posix_fadvise(file->fd, offset, length, POSIX_FADV_WILLNEED) == 0);
 }
+#endif
 
 static
 gboolean
-backend_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+backend_init (gchar const* path)
 {
-	JBackendFile* file = data;
+	struct rlimit limit;
+	guint64 max_files = 65536;
 
-	gsize nbytes_total = 0;
+	/* Path syntax: [direct:][compress=namespace[+namespace...]:][fanout=[depth]:][path][,path...]
+	   e.g.: direct:fanout=2:/var/storage/data, compress=object:/var/storage/data or /nvme0/data,/nvme1/data */
+	if (g_str_has_prefix(path, "direct:"))
+	{
+		path += strlen("direct:");
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+#ifdef HAVE_O_DIRECT
+		jd_backend_direct = TRUE;
 
-	while (nbytes_total < length)
-	{
-		gssize nbytes;
+		/* Copying between the socket and the page cache would bypass direct I/O. */
+		posix_backend.object.read_to_fd = NULL;
+		posix_backend.object.write_from_fd = NULL;
+#else
+		g_warning("Direct I/O is not supported, using buffered I/O.");
+#endif
+	}
 
-		nbytes = pread(file->fd, (gchar*)buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+	if (g_str_has_prefix(path, "compress="))
+	{
+		gchar const* end;
+		g_autofree gchar* namespaces = NULL;
 
-		if (nbytes == 0)
-		{
-			break;
-		}
-		else if (nbytes < 0)
+		if ((end = strchr(path, ':')) == NULL)
 		{
-			if (errno != EINTR)
-			{
-				break;
-			}
+			g_critical("Invalid compression, the namespaces have to be followed by a colon.");
+			return FALSE;
 		}
 
-		nbytes_total += nbytes;
-	}
+		namespaces = g_strndup(path + strlen("compress="), end - (path + strlen("compress=")));
+		path = end + 1;
 
-	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes_total, offset);
+#ifdef HAVE_LZ4
+		jd_backend_compressed_namespaces = g_strsplit(namespaces, "+", 0);
 
-	if (bytes_read != NULL)
-	{
-		*bytes_read = nbytes_total;
+		/* Compressed chunks have to pass through user space. */
+		posix_backend.object.read_to_fd = NULL;
+		posix_backend.object.write_from_fd = NULL;
+#else
+		g_warning("Compression is not supported, storing objects uncompressed.");
+#endif
 	}
 
-	return (nbytes_total == length);
-}
+	if (g_str_has_prefix(path, "fanout="))
+	{
+		gchar* end;
 
-static
-gboolean
-backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
-{
-	JBackendFile* file = data;
+		jd_backend_fanout = g_ascii_strtoull(path + strlen("fanout="), &end, 10);
 
-	gsize nbytes_total = 0;
+		if (*end != ':' || jd_backend_fanout > 4)
+		{
+			g_critical("Invalid fan-out, the depth has to be between 0 and 4.");
+			return FALSE;
+		}
 
-	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+		path = end + 1;
+	}
 
-	while (nbytes_total < length)
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
 	{
-		gssize nbytes;
-
-		nbytes = pwrite(file->fd, (gchar const*)buffer + nbytes_total, length - nbytes_total, offset + nbytes_total);
+		max_files = limit.rlim_cur;
+	}
 
-		if (nbytes <= 0)
-		{
-			if (errno != EINTR)
-			{
-				break;
-			}
-		}
+	/* Leave half of the descriptors for connections, direct I/O needs two descriptors per file. */
+	max_files = max_files / 2 / (jd_backend_direct ? 2 : 1);
+	jd_backend_file_cache_shard_size = MAX(max_files / JD_BACKEND_FILE_CACHE_SHARDS, 1);
 
-		nbytes_total += nbytes;
+	for (guint i = 0; i < JD_BACKEND_FILE_CACHE_SHARDS; i++)
+	{
+		g_mutex_init(&(jd_backend_file_cache[i].mutex));
+		jd_backend_file_cache[i].files = g_hash_table_new(g_str_hash, g_str_equal);
+		g_queue_init(&(jd_backend_file_cache[i].unused));
 	}
 
-	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, nbytes_total, offset);
+	jd_backend_paths = g_strsplit(path, ",", 0);
+	jd_backend_path_count = g_strv_length(jd_backend_paths);
 
-	if (bytes_written != NULL)
+	if (jd_backend_path_count == 0)
 	{
-		*bytes_written = nbytes_total;
+		g_critical("No path given.");
+		return FALSE;
 	}
 
-	return (nbytes_total == length);
+	for (guint i = 0; i < jd_backend_path_count; i++)
+	{
+		g_mkdir_with_parents(jd_backend_paths[i], 0700);
+	}
+
+	return TRUE;
 }
 
 static
-gboolean
-backend_init (gchar const* path)
+void
+backend_fini (void)
 {
-	jd_backend_path = g_strdup(path);
-	jd_backend_file_cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
+	for (guint i = 0; i < JD_BACKEND_FILE_CACHE_SHARDS; i++)
+	{
+		JBackendFileCacheShard* shard = &(jd_backend_file_cache[i]);
+		GList* link;
 
-	g_mkdir_with_parents(path, 0700);
+		while ((link = g_queue_pop_head_link(&(shard->unused))) != NULL)
+		{
+			JBackendFile* file = link->data;
 
-	return TRUE;
+			g_hash_table_remove(shard->files, file->path);
+			backend_file_close(file);
+		}
+
+		/* All files should have been closed by now. */
+		g_assert(g_hash_table_size(shard->files) == 0);
+		g_hash_table_destroy(shard->files);
+		g_mutex_clear(&(shard->mutex));
+	}
+
+	g_strfreev(jd_backend_paths);
+	jd_backend_paths = NULL;
+	jd_backend_path_count = 0;
+
+	g_strfreev(jd_backend_compressed_namespaces);
+	jd_backend_compressed_namespaces = NULL;
 }
 
+#ifdef HAVE_LZ4
 static
-void
-backend_fini (void)
+gboolean
+backend_compression (guint64* bytes_compressed, guint64* bytes_stored)
 {
-	g_assert(g_hash_table_size(jd_backend_file_cache) == 0);
-	g_hash_table_destroy(jd_backend_file_cache);
+	*bytes_compressed = j_helper_atomic_add(&jd_backend_compressed_bytes, 0);
+	*bytes_stored = j_helper_atomic_add(&jd_backend_stored_bytes, 0);
 
-	g_free(jd_backend_path);
+	return TRUE;
 }
+#endif
 
 static
 JBackend posix_backend = {
@@ -403,7 +2187,54 @@ JBackend posix_backend = {
 		.status = backend_status,
 		.sync = backend_sync,
 		.read = backend_read,
-		.write = backend_write
+		.write = backend_write,
+#ifdef HAVE_SENDFILE
+		.read_to_fd = backend_read_to_fd,
+#else
+		.read_to_fd = NULL,
+#endif
+#ifdef HAVE_SPLICE
+		.write_from_fd = backend_write_from_fd,
+#else
+		.write_from_fd = NULL,
+#endif
+		.truncate = backend_truncate,
+		.allocate = backend_allocate,
+#ifdef HAVE_FALLOCATE
+		.punch_hole = backend_punch_hole,
+#else
+		.punch_hole = NULL,
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+		.copy = backend_copy,
+#else
+		.copy = NULL,
+#endif
+#ifdef HAVE_POSIX_FADVISE
+		.hint = backend_hint,
+#else
+		.hint = NULL,
+#endif
+		.purge = backend_purge,
+		.rename = backend_rename,
+		.list = backend_list,
+		.list_by_prefix = backend_list_by_prefix,
+		.iterate = backend_iterate,
+#ifdef HAVE_LZ4
+		.compression = backend_compression,
+#else
+		.compression = NULL,
+#endif
+#ifdef HAVE_SEEK_DATA
+		.extents = backend_extents,
+#else
+		.extents = NULL,
+#endif
+#ifdef HAVE_POSIX_FADVISE
+		.prefetch = backend_prefetch
+#else
+		.prefetch = NULL
+#endif
 	}
 };
 
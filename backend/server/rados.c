@@ -47,10 +47,18 @@ backend_create (gchar const* namespace, gchar const* path, gpointer* data)
 	gchar* full_path = g_strconcat(namespace, path, NULL);
 	gint ret = 0;
 
+	rados_write_op_t write_op;
+
+	/* Unlike rados_write_full(), this does not truncate existing objects. */
+	write_op = rados_create_write_op();
+	rados_write_op_create(write_op, LIBRADOS_CREATE_IDEMPOTENT, NULL);
+
 	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
- 	ret = rados_write_full(backend_io, full_path, "", 0);
+	ret = rados_write_op_operate(write_op, backend_io, full_path, NULL, 0);
 	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
 
+	rados_release_write_op(write_op);
+
     g_return_val_if_fail(ret == 0, FALSE);
 
 	bf = g_slice_new(JBackendFile);
@@ -185,6 +193,160 @@ backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offs
 	return TRUE;
 }
 
+static
+gboolean
+backend_truncate (gpointer data, guint64 size)
+{
+	JBackendFile* bf = data;
+	gint ret = 0;
+
+	j_trace_file_begin(bf->path, J_TRACE_FILE_WRITE);
+	ret = rados_trunc(backend_io, bf->path, size);
+	j_trace_file_end(bf->path, J_TRACE_FILE_WRITE, 0, size);
+
+	return (ret == 0);
+}
+
+static
+gboolean
+backend_punch_hole (gpointer data, guint64 length, guint64 offset)
+{
+	JBackendFile* bf = data;
+	gint ret = 0;
+
+	rados_write_op_t write_op;
+
+	/* RADOS objects are sparse, zeroing a range releases its space. */
+	write_op = rados_create_write_op();
+	rados_write_op_zero(write_op, offset, length);
+
+	j_trace_file_begin(bf->path, J_TRACE_FILE_WRITE);
+	ret = rados_write_op_operate(write_op, backend_io, bf->path, NULL, 0);
+	j_trace_file_end(bf->path, J_TRACE_FILE_WRITE, 0, offset);
+
+	rados_release_write_op(write_op);
+
+	return (ret == 0);
+}
+
+/*
+ * All reads are submitted before waiting for any of them, so that RADOS can execute them in parallel.
+ */
+static
+gboolean
+backend_readv (gpointer data, gpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, guint64* bytes_read)
+{
+	JBackendFile* bf = data;
+	g_autofree rados_completion_t* completions = NULL;
+	gboolean ret = TRUE;
+
+	completions = g_new(rados_completion_t, count);
+
+	j_trace_file_begin(bf->path, J_TRACE_FILE_READ);
+
+	for (guint i = 0; i < count; i++)
+	{
+		bytes_read[i] = 0;
+
+		if (rados_aio_create_completion(NULL, NULL, NULL, &(completions[i])) != 0)
+		{
+			completions[i] = NULL;
+			ret = FALSE;
+		}
+		else if (rados_aio_read(backend_io, bf->path, completions[i], buffers[i], lengths[i], offsets[i]) != 0)
+		{
+			rados_aio_release(completions[i]);
+			completions[i] = NULL;
+			ret = FALSE;
+		}
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		gint nbytes;
+
+		if (completions[i] == NULL)
+		{
+			continue;
+		}
+
+		rados_aio_wait_for_complete(completions[i]);
+		nbytes = rados_aio_get_return_value(completions[i]);
+		rados_aio_release(completions[i]);
+
+		if (nbytes < 0)
+		{
+			ret = FALSE;
+			continue;
+		}
+
+		bytes_read[i] = nbytes;
+	}
+
+	j_trace_file_end(bf->path, J_TRACE_FILE_READ, 0, 0);
+
+	return ret;
+}
+
+/*
+ * All writes are combined into one compound operation.
+ * In contrast to independent asynchronous writes, this keeps overlapping writes in order.
+ */
+static
+gboolean
+backend_writev (gpointer data, gconstpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* bytes_written)
+{
+	JBackendFile* bf = data;
+	gboolean ret = FALSE;
+
+	rados_completion_t completion;
+	rados_write_op_t write_op;
+
+	/* RADOS only acknowledges writes once they are stored on all replicas, so there is nothing to sync. */
+	(void)sync;
+
+	if (count == 0)
+	{
+		return TRUE;
+	}
+
+	write_op = rados_create_write_op();
+
+	for (guint i = 0; i < count; i++)
+	{
+		rados_write_op_write(write_op, buffers[i], lengths[i], offsets[i]);
+		bytes_written[i] = 0;
+	}
+
+	j_trace_file_begin(bf->path, J_TRACE_FILE_WRITE);
+
+	if (rados_aio_create_completion(NULL, NULL, NULL, &completion) == 0)
+	{
+		if (rados_aio_write_op_operate(write_op, backend_io, completion, bf->path, NULL, 0) == 0)
+		{
+			rados_aio_wait_for_complete(completion);
+			ret = (rados_aio_get_return_value(completion) == 0);
+		}
+
+		rados_aio_release(completion);
+	}
+
+	j_trace_file_end(bf->path, J_TRACE_FILE_WRITE, 0, 0);
+
+	rados_release_write_op(write_op);
+
+	/* Compound operations are atomic, so either all or none of the writes have been executed. */
+	if (ret)
+	{
+		for (guint i = 0; i < count; i++)
+		{
+			bytes_written[i] = lengths[i];
+		}
+	}
+
+	return ret;
+}
+
 static
 gboolean
 backend_init (gchar const* path)
@@ -258,7 +420,13 @@ JBackend rados_backend = {
 		.status = backend_status,
 		.sync = backend_sync,
 		.read = backend_read,
-		.write = backend_write
+		.write = backend_write,
+		.truncate = backend_truncate,
+		.allocate = NULL,
+		.punch_hole = backend_punch_hole,
+		.copy = NULL,
+		.readv = backend_readv,
+		.writev = backend_writev
 	}
 };
 
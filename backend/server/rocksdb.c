@@ -0,0 +1,808 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <rocksdb/c.h>
+
+#include <julea.h>
+
+struct JRocksDBBatch
+{
+	rocksdb_writebatch_t* batch;
+	rocksdb_column_family_handle_t* column_family;
+	JSemanticsSafety safety;
+	/* Sorted batches are written to an SST file that is ingested when executing them. */
+	rocksdb_sstfilewriter_t* sst_writer;
+	gchar* sst_path;
+	guint64 sst_entries;
+};
+
+typedef struct JRocksDBBatch JRocksDBBatch;
+
+struct JRocksDBIterator
+{
+	rocksdb_iterator_t* iterator;
+	gchar* prefix;
+	gsize prefix_len;
+	/* The number of keys that can still be returned, G_MAXUINT32 for no limit. */
+	guint32 remaining;
+	gboolean first;
+	/* The current key, RocksDB's keys are not null-terminated. */
+	gchar* key;
+};
+
+typedef struct JRocksDBIterator JRocksDBIterator;
+
+static rocksdb_t* backend_db = NULL;
+static gchar* backend_path = NULL;
+static rocksdb_options_t* backend_options = NULL;
+static rocksdb_cache_t* backend_cache = NULL;
+
+static rocksdb_readoptions_t* backend_read_options = NULL;
+static rocksdb_readoptions_t* backend_read_options_prefix = NULL;
+static rocksdb_writeoptions_t* backend_write_options = NULL;
+static rocksdb_writeoptions_t* backend_write_options_sync = NULL;
+static rocksdb_writeoptions_t* backend_write_options_unsafe = NULL;
+
+/* Maps namespaces to column families. */
+static GHashTable* backend_column_families = NULL;
+static GRWLock backend_column_families_lock;
+
+/* The length of the prefixes used for the prefix bloom filters. */
+static gsize backend_prefix_len = 0;
+
+/* Makes the names of SST files unique. */
+static gint backend_sst_counter = 0;
+
+/* The default size of the LRU block cache. */
+#define JD_BACKEND_CACHE_SIZE (64 * 1024 * 1024)
+
+/* The default number of bits per key used by the bloom filters. */
+#define JD_BACKEND_BLOOM_BITS 10
+
+/* The default length of the prefixes used for the prefix bloom filters. */
+#define JD_BACKEND_PREFIX_LENGTH 8
+
+/*
+ * Parses an option of the form name={value}: and advances path behind it.
+ */
+static
+gboolean
+backend_parse_option (gchar const** path, gchar const* name, guint64* value)
+{
+	g_autofree gchar* prefix = NULL;
+	gchar* end;
+
+	prefix = g_strdup_printf("%s=", name);
+
+	if (!g_str_has_prefix(*path, prefix))
+	{
+		return FALSE;
+	}
+
+	*value = g_ascii_strtoull(*path + strlen(prefix), &end, 10);
+
+	if (*end != ':')
+	{
+		return FALSE;
+	}
+
+	*path = end + 1;
+
+	return TRUE;
+}
+
+/*
+ * Returns the column family of a namespace.
+ * If create is TRUE, missing column families are created.
+ */
+static
+rocksdb_column_family_handle_t*
+backend_get_column_family (gchar const* namespace, gboolean create)
+{
+	rocksdb_column_family_handle_t* column_family;
+	gchar* error = NULL;
+
+	g_rw_lock_reader_lock(&backend_column_families_lock);
+	column_family = g_hash_table_lookup(backend_column_families, namespace);
+	g_rw_lock_reader_unlock(&backend_column_families_lock);
+
+	if (column_family != NULL || !create)
+	{
+		return column_family;
+	}
+
+	g_rw_lock_writer_lock(&backend_column_families_lock);
+
+	/* Another thread might have created the column family in the meantime. */
+	if ((column_family = g_hash_table_lookup(backend_column_families, namespace)) == NULL)
+	{
+		column_family = rocksdb_create_column_family(backend_db, backend_options, namespace, &error);
+
+		if (error == NULL)
+		{
+			g_hash_table_insert(backend_column_families, g_strdup(namespace), column_family);
+		}
+		else
+		{
+			g_critical("Could not create column family %s: %s", namespace, error);
+			rocksdb_free(error);
+
+			column_family = NULL;
+		}
+	}
+
+	g_rw_lock_writer_unlock(&backend_column_families_lock);
+
+	return column_family;
+}
+
+static
+gboolean
+backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
+{
+	JRocksDBBatch* batch;
+	rocksdb_column_family_handle_t* column_family;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if ((column_family = backend_get_column_family(namespace, TRUE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	batch = g_slice_new(JRocksDBBatch);
+
+	batch->batch = rocksdb_writebatch_create();
+	batch->column_family = column_family;
+	batch->safety = safety;
+	batch->sst_writer = NULL;
+	batch->sst_path = NULL;
+	batch->sst_entries = 0;
+	*data = batch;
+
+	return TRUE;
+}
+
+/*
+ * Finishes a sorted batch's SST file and moves it into the database.
+ * Ingested files are synced, so the batch is always stored safely.
+ */
+static
+gboolean
+backend_batch_ingest (JRocksDBBatch* batch)
+{
+	rocksdb_ingestexternalfileoptions_t* ingest_options;
+	gchar const* files[1];
+	gchar* error = NULL;
+
+	/* Empty SST files cannot be finished. */
+	if (batch->sst_entries > 0)
+	{
+		rocksdb_sstfilewriter_finish(batch->sst_writer, &error);
+	}
+
+	if (batch->sst_entries > 0 && error == NULL)
+	{
+		files[0] = batch->sst_path;
+
+		ingest_options = rocksdb_ingestexternalfileoptions_create();
+		rocksdb_ingestexternalfileoptions_set_move_files(ingest_options, 1);
+		rocksdb_ingest_external_file_cf(backend_db, batch->column_family, files, G_N_ELEMENTS(files), ingest_options, &error);
+		rocksdb_ingestexternalfileoptions_destroy(ingest_options);
+	}
+
+	rocksdb_sstfilewriter_destroy(batch->sst_writer);
+
+	/* Moving hard-links the file, so the original has to be removed in any case. */
+	g_unlink(batch->sst_path);
+	g_free(batch->sst_path);
+
+	if (error != NULL)
+	{
+		g_critical("Could not ingest sorted batch: %s", error);
+		rocksdb_free(error);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_batch_execute (gpointer data)
+{
+	JRocksDBBatch* batch = data;
+
+	rocksdb_writeoptions_t* write_options = backend_write_options;
+	gchar* error = NULL;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if (batch->sst_writer != NULL)
+	{
+		gboolean ret;
+
+		ret = backend_batch_ingest(batch);
+
+		rocksdb_writebatch_destroy(batch->batch);
+		g_slice_free(JRocksDBBatch, batch);
+
+		return ret;
+	}
+
+	if (batch->safety == J_SEMANTICS_SAFETY_STORAGE)
+	{
+		write_options = backend_write_options_sync;
+	}
+	else if (batch->safety == J_SEMANTICS_SAFETY_NONE)
+	{
+		write_options = backend_write_options_unsafe;
+	}
+
+	rocksdb_write(backend_db, write_options, batch->batch, &error);
+
+	rocksdb_writebatch_destroy(batch->batch);
+	g_slice_free(JRocksDBBatch, batch);
+
+	if (error != NULL)
+	{
+		rocksdb_free(error);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_batch_set_sorted (gpointer data)
+{
+	JRocksDBBatch* batch = data;
+
+	rocksdb_envoptions_t* env_options;
+	gchar* error = NULL;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(batch->sst_writer == NULL, FALSE);
+
+	/* The file is created next to the database, so that moving it does not have to copy it. */
+	batch->sst_path = g_strdup_printf("%s/load-%d.sst", backend_path, g_atomic_int_add(&backend_sst_counter, 1));
+
+	env_options = rocksdb_envoptions_create();
+	batch->sst_writer = rocksdb_sstfilewriter_create(env_options, backend_options);
+	rocksdb_envoptions_destroy(env_options);
+
+	rocksdb_sstfilewriter_open(batch->sst_writer, batch->sst_path, &error);
+
+	if (error != NULL)
+	{
+		g_critical("Could not create SST file %s: %s", batch->sst_path, error);
+		rocksdb_free(error);
+
+		rocksdb_sstfilewriter_destroy(batch->sst_writer);
+		g_free(batch->sst_path);
+
+		batch->sst_writer = NULL;
+		batch->sst_path = NULL;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_put_raw (gpointer data, gchar const* key, gconstpointer value, guint32 len)
+{
+	JRocksDBBatch* batch = data;
+
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if (batch->sst_writer != NULL)
+	{
+		gchar* error = NULL;
+
+		/* Fails if the keys are not in ascending order. */
+		rocksdb_sstfilewriter_put(batch->sst_writer, key, strlen(key), value, len, &error);
+
+		if (error != NULL)
+		{
+			rocksdb_free(error);
+
+			return FALSE;
+		}
+
+		batch->sst_entries++;
+
+		return TRUE;
+	}
+
+	rocksdb_writebatch_put_cf(batch->batch, batch->column_family, key, strlen(key), value, len);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_put (gpointer data, gchar const* key, bson_t const* value)
+{
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	return backend_put_raw(data, key, bson_get_data(value), value->len);
+}
+
+static
+gboolean
+backend_delete (gpointer data, gchar const* key)
+{
+	JRocksDBBatch* batch = data;
+
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(batch->sst_writer == NULL, FALSE);
+
+	rocksdb_writebatch_delete_cf(batch->batch, batch->column_family, key, strlen(key));
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
+{
+	gboolean ret = FALSE;
+
+	rocksdb_column_family_handle_t* column_family;
+	gchar* result;
+	gchar* error = NULL;
+	gsize result_len;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(result_out != NULL, FALSE);
+
+	if ((column_family = backend_get_column_family(namespace, FALSE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	result = rocksdb_get_cf(backend_db, backend_read_options, column_family, key, strlen(key), &result_len, &error);
+
+	if (error != NULL)
+	{
+		rocksdb_free(error);
+
+		return FALSE;
+	}
+
+	if (result != NULL)
+	{
+		bson_t tmp[1];
+
+		bson_init_static(tmp, (guint8 const*)result, result_len);
+		bson_copy_to(tmp, result_out);
+
+		rocksdb_free(result);
+
+		ret = TRUE;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_get_raw (gchar const* namespace, gchar const* key, GBytes** value)
+{
+	rocksdb_column_family_handle_t* column_family;
+	gchar* result;
+	gchar* error = NULL;
+	gsize result_len;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	if ((column_family = backend_get_column_family(namespace, FALSE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	result = rocksdb_get_cf(backend_db, backend_read_options, column_family, key, strlen(key), &result_len, &error);
+
+	if (error != NULL)
+	{
+		rocksdb_free(error);
+
+		return FALSE;
+	}
+
+	if (result == NULL)
+	{
+		return FALSE;
+	}
+
+	/* Take over RocksDB's buffer instead of copying it. */
+	*value = g_bytes_new_with_free_func(result, result_len, rocksdb_free, result);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
+{
+	JRocksDBIterator* iterator;
+	rocksdb_column_family_handle_t* column_family;
+	rocksdb_readoptions_t* read_options = backend_read_options;
+	gsize prefix_len;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if ((column_family = backend_get_column_family(namespace, FALSE)) == NULL)
+	{
+		return FALSE;
+	}
+
+	prefix_len = strlen(prefix);
+
+	/*
+	 * The prefix bloom filters can only be used if the prefix is at least as long as the extracted one.
+	 * Otherwise, keys with different extracted prefixes would be skipped.
+	 */
+	if (backend_prefix_len > 0 && prefix_len >= backend_prefix_len)
+	{
+		read_options = backend_read_options_prefix;
+	}
+
+	iterator = g_slice_new(JRocksDBIterator);
+	iterator->iterator = rocksdb_create_iterator_cf(backend_db, read_options, column_family);
+	iterator->prefix = g_strdup(prefix);
+	iterator->prefix_len = prefix_len;
+	iterator->remaining = (limit > 0) ? limit : G_MAXUINT32;
+	iterator->first = TRUE;
+	iterator->key = NULL;
+
+	if (start_after != NULL && strcmp(start_after, prefix) >= 0)
+	{
+		gsize start_after_len;
+
+		start_after_len = strlen(start_after);
+		rocksdb_iter_seek(iterator->iterator, start_after, start_after_len);
+
+		if (rocksdb_iter_valid(iterator->iterator))
+		{
+			gchar const* key;
+			gsize len;
+
+			key = rocksdb_iter_key(iterator->iterator, &len);
+
+			if (len == start_after_len && memcmp(key, start_after, len) == 0)
+			{
+				rocksdb_iter_next(iterator->iterator);
+			}
+		}
+	}
+	else
+	{
+		rocksdb_iter_seek(iterator->iterator, iterator->prefix, iterator->prefix_len);
+	}
+
+	*data = iterator;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_get_all (gchar const* namespace, gpointer* data)
+{
+	return backend_get_range(namespace, "", NULL, 0, data);
+}
+
+static
+gboolean
+backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
+{
+	return backend_get_range(namespace, prefix, NULL, 0, data);
+}
+
+static
+gboolean
+backend_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
+{
+	JRocksDBIterator* iterator = data;
+
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key_out != NULL, FALSE);
+	g_return_val_if_fail(result_out != NULL, FALSE);
+
+	/* Only advance now, moving the iterator invalidates the previously returned value. */
+	if (!iterator->first)
+	{
+		rocksdb_iter_next(iterator->iterator);
+	}
+
+	iterator->first = FALSE;
+
+	if (iterator->remaining > 0 && rocksdb_iter_valid(iterator->iterator))
+	{
+		gchar const* key;
+		gchar const* value;
+		gsize len;
+
+		key = rocksdb_iter_key(iterator->iterator, &len);
+
+		/* Keys are sorted, so there are no more matching keys. */
+		if (len < iterator->prefix_len || memcmp(key, iterator->prefix, iterator->prefix_len) != 0)
+		{
+			goto out;
+		}
+
+		g_free(iterator->key);
+		iterator->key = g_strndup(key, len);
+		*key_out = iterator->key;
+
+		value = rocksdb_iter_value(iterator->iterator, &len);
+		bson_init_static(result_out, (guint8 const*)value, len);
+
+		iterator->remaining--;
+
+		return TRUE;
+	}
+
+out:
+	g_free(iterator->key);
+	g_free(iterator->prefix);
+	rocksdb_iter_destroy(iterator->iterator);
+	g_slice_free(JRocksDBIterator, iterator);
+
+	return FALSE;
+}
+
+static
+gboolean
+backend_init (gchar const* path)
+{
+	rocksdb_block_based_table_options_t* table_options;
+	g_autofree rocksdb_options_t const** column_family_options = NULL;
+	g_autofree rocksdb_column_family_handle_t** column_family_handles = NULL;
+	gchar** column_family_names = NULL;
+	gchar const* default_names[] = { "default" };
+	gchar const* const* names;
+	gchar* error = NULL;
+	gsize column_family_names_len = 0;
+	gsize names_len;
+	guint64 cache_size = JD_BACKEND_CACHE_SIZE;
+	guint64 bloom_bits = JD_BACKEND_BLOOM_BITS;
+	guint64 prefix_length = JD_BACKEND_PREFIX_LENGTH;
+	gboolean parsed;
+
+	g_return_val_if_fail(path != NULL, FALSE);
+
+	/* Path syntax: [cache-size={bytes}:][bloom-bits={bits}:][prefix-length={bytes}:][path]
+	   e.g.: cache-size=268435456:prefix-length=16:/var/storage/meta
+	   bloom-bits=0 disables the bloom filters, prefix-length=0 disables the prefix bloom filters. */
+	do
+	{
+		parsed = backend_parse_option(&path, "cache-size", &cache_size)
+			|| backend_parse_option(&path, "bloom-bits", &bloom_bits)
+			|| backend_parse_option(&path, "prefix-length", &prefix_length);
+	}
+	while (parsed);
+
+	g_mkdir_with_parents(path, 0700);
+
+	backend_path = g_strdup(path);
+
+	backend_options = rocksdb_options_create();
+	rocksdb_options_set_create_if_missing(backend_options, 1);
+	rocksdb_options_set_create_missing_column_families(backend_options, 1);
+	/* Uses background threads for flushes and compactions. */
+	rocksdb_options_increase_parallelism(backend_options, g_get_num_processors());
+
+	table_options = rocksdb_block_based_options_create();
+
+	if (cache_size > 0)
+	{
+		backend_cache = rocksdb_cache_create_lru(cache_size);
+		rocksdb_block_based_options_set_block_cache(table_options, backend_cache);
+	}
+
+	if (bloom_bits > 0)
+	{
+		/* Takes ownership of the filter policy. */
+		rocksdb_block_based_options_set_filter_policy(table_options, rocksdb_filterpolicy_create_bloom(bloom_bits));
+	}
+
+	rocksdb_options_set_block_based_table_factory(backend_options, table_options);
+	rocksdb_block_based_options_destroy(table_options);
+
+	if (prefix_length > 0)
+	{
+		backend_prefix_len = prefix_length;
+
+		/* Takes ownership of the slice transform. */
+		rocksdb_options_set_prefix_extractor(backend_options, rocksdb_slicetransform_create_fixed_prefix(prefix_length));
+		rocksdb_options_set_memtable_prefix_bloom_size_ratio(backend_options, 0.1);
+	}
+
+	/* Existing column families have to be opened together with the database. */
+	column_family_names = rocksdb_list_column_families(backend_options, path, &column_family_names_len, &error);
+
+	if (error != NULL)
+	{
+		/* The database does not exist yet. */
+		rocksdb_free(error);
+		error = NULL;
+
+		column_family_names = NULL;
+		column_family_names_len = 0;
+	}
+
+	if (column_family_names != NULL)
+	{
+		names = (gchar const* const*)column_family_names;
+		names_len = column_family_names_len;
+	}
+	else
+	{
+		names = default_names;
+		names_len = G_N_ELEMENTS(default_names);
+	}
+
+	column_family_options = g_new(rocksdb_options_t const*, names_len);
+	column_family_handles = g_new(rocksdb_column_family_handle_t*, names_len);
+
+	for (gsize i = 0; i < names_len; i++)
+	{
+		column_family_options[i] = backend_options;
+	}
+
+	backend_db = rocksdb_open_column_families(backend_options, path, names_len, names, column_family_options, column_family_handles, &error);
+
+	if (error != NULL)
+	{
+		g_critical("Could not open database %s: %s", path, error);
+		rocksdb_free(error);
+
+		backend_db = NULL;
+	}
+
+	backend_column_families = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	if (backend_db != NULL)
+	{
+		for (gsize i = 0; i < names_len; i++)
+		{
+			g_hash_table_insert(backend_column_families, g_strdup(names[i]), column_family_handles[i]);
+		}
+	}
+
+	if (column_family_names != NULL)
+	{
+		rocksdb_list_column_families_destroy(column_family_names, column_family_names_len);
+	}
+
+	backend_read_options = rocksdb_readoptions_create();
+	rocksdb_readoptions_set_total_order_seek(backend_read_options, 1);
+
+	backend_read_options_prefix = rocksdb_readoptions_create();
+	rocksdb_readoptions_set_prefix_same_as_start(backend_read_options_prefix, 1);
+
+	backend_write_options = rocksdb_writeoptions_create();
+	backend_write_options_sync = rocksdb_writeoptions_create();
+	rocksdb_writeoptions_set_sync(backend_write_options_sync, 1);
+	/* Without safety, writes do not have to survive crashes. */
+	backend_write_options_unsafe = rocksdb_writeoptions_create();
+	rocksdb_writeoptions_disable_WAL(backend_write_options_unsafe, 1);
+
+	return (backend_db != NULL);
+}
+
+static
+void
+backend_fini (void)
+{
+	if (backend_column_families != NULL)
+	{
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init(&iter, backend_column_families);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			rocksdb_column_family_handle_destroy(value);
+		}
+
+		g_hash_table_destroy(backend_column_families);
+	}
+
+	if (backend_db != NULL)
+	{
+		rocksdb_close(backend_db);
+	}
+
+	rocksdb_readoptions_destroy(backend_read_options);
+	rocksdb_readoptions_destroy(backend_read_options_prefix);
+	rocksdb_writeoptions_destroy(backend_write_options);
+	rocksdb_writeoptions_destroy(backend_write_options_sync);
+	rocksdb_writeoptions_destroy(backend_write_options_unsafe);
+
+	rocksdb_options_destroy(backend_options);
+
+	g_free(backend_path);
+
+	if (backend_cache != NULL)
+	{
+		rocksdb_cache_destroy(backend_cache);
+	}
+}
+
+static
+JBackend rocksdb_backend = {
+	.type = J_BACKEND_TYPE_KV,
+	.kv = {
+		.init = backend_init,
+		.fini = backend_fini,
+		.batch_start = backend_batch_start,
+		.batch_execute = backend_batch_execute,
+		.batch_set_sorted = backend_batch_set_sorted,
+		.put = backend_put,
+		.delete = backend_delete,
+		.get = backend_get,
+		.get_all = backend_get_all,
+		.get_by_prefix = backend_get_by_prefix,
+		.get_range = backend_get_range,
+		.iterate = backend_iterate,
+		.put_raw = backend_put_raw,
+		.get_raw = backend_get_raw
+	}
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info (JBackendType type)
+{
+	JBackend* backend = NULL;
+
+	if (type == J_BACKEND_TYPE_KV)
+	{
+		backend = &rocksdb_backend;
+	}
+
+	return backend;
+}
@@ -27,29 +27,183 @@
 
 #include <julea.h>
 
+/*
+ * Every thread uses its own connection, because a connection can only execute one transaction at a time.
+ * Its statements are prepared once and reused.
+ */
+struct JSQLiteConnection
+{
+	sqlite3* db;
+
+	sqlite3_stmt* put;
+	sqlite3_stmt* delete;
+	sqlite3_stmt* get;
+
+	/* The current synchronous level, -1 if unknown. */
+	gint synchronous;
+};
+
+typedef struct JSQLiteConnection JSQLiteConnection;
+
 struct JSQLiteBatch
 {
+	JSQLiteConnection* connection;
 	gchar* namespace;
 	JSemanticsSafety safety;
 };
 
 typedef struct JSQLiteBatch JSQLiteBatch;
 
-static sqlite3* backend_db = NULL;
+static gchar* backend_path = NULL;
+
+/* All open connections, so that they can be closed in backend_fini(). */
+static GPtrArray* backend_connections = NULL;
+G_LOCK_DEFINE_STATIC(backend_connections);
+
+static
+void
+backend_connection_close (JSQLiteConnection* connection)
+{
+	sqlite3_finalize(connection->put);
+	sqlite3_finalize(connection->delete);
+	sqlite3_finalize(connection->get);
+	sqlite3_close(connection->db);
+
+	g_slice_free(JSQLiteConnection, connection);
+}
+
+static
+void
+backend_connection_destroy (gpointer data)
+{
+	gboolean close_connection = FALSE;
+
+	G_LOCK(backend_connections);
+
+	/* The connection has already been closed if the backend has been finalized. */
+	if (backend_connections != NULL)
+	{
+		close_connection = g_ptr_array_remove_fast(backend_connections, data);
+	}
+
+	G_UNLOCK(backend_connections);
+
+	if (close_connection)
+	{
+		backend_connection_close(data);
+	}
+}
+
+static GPrivate backend_connection = G_PRIVATE_INIT(backend_connection_destroy);
+
+static
+JSQLiteConnection*
+backend_connection_get (void)
+{
+	JSQLiteConnection* connection;
+
+	if ((connection = g_private_get(&backend_connection)) != NULL)
+	{
+		return connection;
+	}
+
+	connection = g_slice_new0(JSQLiteConnection);
+	connection->synchronous = -1;
+
+	if (sqlite3_open(backend_path, &(connection->db)) != SQLITE_OK)
+	{
+		goto error;
+	}
+
+	/* Writers of other threads hold the database lock only for the duration of their batch. */
+	sqlite3_busy_timeout(connection->db, 60 * 1000);
+
+	if (sqlite3_prepare_v2(connection->db, "INSERT OR REPLACE INTO julea (namespace, key, value) VALUES (?, ?, ?);", -1, &(connection->put), NULL) != SQLITE_OK
+	    || sqlite3_prepare_v2(connection->db, "DELETE FROM julea WHERE namespace = ? AND key = ?;", -1, &(connection->delete), NULL) != SQLITE_OK
+	    || sqlite3_prepare_v2(connection->db, "SELECT value FROM julea WHERE namespace = ? AND key = ?;", -1, &(connection->get), NULL) != SQLITE_OK)
+	{
+		goto error;
+	}
+
+	G_LOCK(backend_connections);
+	g_ptr_array_add(backend_connections, connection);
+	G_UNLOCK(backend_connections);
+
+	g_private_set(&backend_connection, connection);
+
+	return connection;
+
+error:
+	backend_connection_close(connection);
+
+	return NULL;
+}
+
+/*
+ * With write-ahead logging, NORMAL only syncs during checkpoints, FULL also syncs every commit.
+ */
+static
+gboolean
+backend_connection_set_safety (JSQLiteConnection* connection, JSemanticsSafety safety)
+{
+	gchar const* sql;
+	gint synchronous;
+
+	switch (safety)
+	{
+		case J_SEMANTICS_SAFETY_NONE:
+			synchronous = 0;
+			sql = "PRAGMA synchronous = OFF;";
+			break;
+		case J_SEMANTICS_SAFETY_STORAGE:
+			synchronous = 2;
+			sql = "PRAGMA synchronous = FULL;";
+			break;
+		case J_SEMANTICS_SAFETY_NETWORK:
+		default:
+			synchronous = 1;
+			sql = "PRAGMA synchronous = NORMAL;";
+			break;
+	}
+
+	if (connection->synchronous == synchronous)
+	{
+		return TRUE;
+	}
+
+	if (sqlite3_exec(connection->db, sql, NULL, NULL, NULL) != SQLITE_OK)
+	{
+		return FALSE;
+	}
+
+	connection->synchronous = synchronous;
+
+	return TRUE;
+}
 
 static
 gboolean
 backend_batch_start (gchar const* namespace, JSemanticsSafety safety, gpointer* data)
 {
 	JSQLiteBatch* batch = NULL;
+	JSQLiteConnection* connection;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	if (sqlite3_exec(backend_db, "BEGIN TRANSACTION;", NULL, NULL, NULL) == SQLITE_OK)
+	connection = backend_connection_get();
+
+	/*
+	 * The synchronous level can not be changed within a transaction.
+	 * Taking the write lock immediately avoids deadlocks between transactions that want to upgrade their locks.
+	 */
+	if (connection != NULL
+	    && backend_connection_set_safety(connection, safety)
+	    && sqlite3_exec(connection->db, "BEGIN IMMEDIATE TRANSACTION;", NULL, NULL, NULL) == SQLITE_OK)
 	{
 		batch = g_slice_new(JSQLiteBatch);
 
+		batch->connection = connection;
 		batch->namespace = g_strdup(namespace);
 		batch->safety = safety;
 	}
@@ -69,12 +223,14 @@ backend_batch_execute (gpointer data)
 
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	// FIXME do something with batch->safety
-
-	if (sqlite3_exec(backend_db, "COMMIT;", NULL, NULL, NULL) == SQLITE_OK)
+	if (sqlite3_exec(batch->connection->db, "COMMIT;", NULL, NULL, NULL) == SQLITE_OK)
 	{
 		ret = TRUE;
 	}
+	else
+	{
+		sqlite3_exec(batch->connection->db, "ROLLBACK;", NULL, NULL, NULL);
+	}
 
 	g_free(batch->namespace);
 	g_slice_free(JSQLiteBatch, batch);
@@ -84,25 +240,37 @@ backend_batch_execute (gpointer data)
 
 static
 gboolean
-backend_put (gpointer data, gchar const* key, bson_t const* value)
+backend_put_raw (gpointer data, gchar const* key, gconstpointer value, guint32 len)
 {
 	JSQLiteBatch* batch = data;
 	sqlite3_stmt* stmt;
+	gboolean ret;
 
 	g_return_val_if_fail(key != NULL, FALSE);
-	g_return_val_if_fail(value != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	sqlite3_prepare_v2(backend_db, "INSERT INTO julea (namespace, key, value) VALUES (?, ?, ?);", -1, &stmt, NULL);
+	stmt = batch->connection->put;
+
 	sqlite3_bind_text(stmt, 1, batch->namespace, -1, NULL);
 	sqlite3_bind_text(stmt, 2, key, -1, NULL);
-	sqlite3_bind_blob(stmt, 3, bson_get_data(value), value->len, NULL);
+	/* A NULL pointer would store NULL instead of an empty value. */
+	sqlite3_bind_blob(stmt, 3, (value != NULL) ? value : "", len, NULL);
 
-	sqlite3_step(stmt);
-	sqlite3_finalize(stmt);
+	ret = (sqlite3_step(stmt) == SQLITE_DONE);
 
-	// FIXME
-	return TRUE;
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	return ret;
+}
+
+static
+gboolean
+backend_put (gpointer data, gchar const* key, bson_t const* value)
+{
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	return backend_put_raw(data, key, bson_get_data(value), value->len);
 }
 
 static
@@ -111,28 +279,30 @@ backend_delete (gpointer data, gchar const* key)
 {
 	JSQLiteBatch* batch = data;
 	sqlite3_stmt* stmt;
-	g_autofree gchar* nskey = NULL;
+	gboolean ret;
 
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	sqlite3_prepare_v2(backend_db, "DELETE FROM julea WHERE namespace = ? AND key = ?;", -1, &stmt, NULL);
+	stmt = batch->connection->delete;
+
 	sqlite3_bind_text(stmt, 1, batch->namespace, -1, NULL);
 	sqlite3_bind_text(stmt, 2, key, -1, NULL);
 
-	sqlite3_step(stmt);
-	sqlite3_finalize(stmt);
+	ret = (sqlite3_step(stmt) == SQLITE_DONE);
 
-	// FIXME
-	return TRUE;
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	return ret;
 }
 
 static
 gboolean
 backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 {
+	JSQLiteConnection* connection;
 	sqlite3_stmt* stmt;
-	g_autofree gchar* nskey = NULL;
 	gint ret;
 	gconstpointer result = NULL;
 	gsize result_len;
@@ -141,7 +311,13 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(result_out != NULL, FALSE);
 
-	sqlite3_prepare_v2(backend_db, "SELECT value FROM julea WHERE namespace = ? AND key = ?;", -1, &stmt, NULL);
+	if ((connection = backend_connection_get()) == NULL)
+	{
+		return FALSE;
+	}
+
+	stmt = connection->get;
+
 	sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
 	sqlite3_bind_text(stmt, 2, key, -1, NULL);
 
@@ -159,21 +335,61 @@ backend_get (gchar const* namespace, gchar const* key, bson_t* result_out)
 		bson_copy_to(tmp, result_out);
 	}
 
-	sqlite3_finalize(stmt);
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
 
 	return (result != NULL);
 }
 
+static
+gboolean
+backend_get_raw (gchar const* namespace, gchar const* key, GBytes** value)
+{
+	JSQLiteConnection* connection;
+	sqlite3_stmt* stmt;
+	gboolean found;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	if ((connection = backend_connection_get()) == NULL)
+	{
+		return FALSE;
+	}
+
+	stmt = connection->get;
+
+	sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
+	sqlite3_bind_text(stmt, 2, key, -1, NULL);
+
+	/* Empty values have no blob, so the row has to be checked instead. */
+	found = (sqlite3_step(stmt) == SQLITE_ROW);
+
+	if (found)
+	{
+		/* The blob is only valid until the statement is reset. */
+		*value = g_bytes_new(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
+	}
+
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	return found;
+}
+
 static
 gboolean
 backend_get_all (gchar const* namespace, gpointer* data)
 {
+	JSQLiteConnection* connection;
 	sqlite3_stmt* stmt = NULL;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	if (sqlite3_prepare_v2(backend_db, "SELECT key, value FROM julea WHERE namespace = ?;", -1, &stmt, NULL) == SQLITE_OK)
+	if ((connection = backend_connection_get()) != NULL
+	    && sqlite3_prepare_v2(connection->db, "SELECT key, value FROM julea WHERE namespace = ?;", -1, &stmt, NULL) == SQLITE_OK)
 	{
 		sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
 	}
@@ -187,13 +403,15 @@ static
 gboolean
 backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* data)
 {
+	JSQLiteConnection* connection;
 	sqlite3_stmt* stmt = NULL;
 
 	g_return_val_if_fail(namespace != NULL, FALSE);
 	g_return_val_if_fail(prefix != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
 
-	if (sqlite3_prepare_v2(backend_db, "SELECT key, value FROM julea WHERE namespace = ? AND key LIKE ? || '%';", -1, &stmt, NULL) == SQLITE_OK)
+	if ((connection = backend_connection_get()) != NULL
+	    && sqlite3_prepare_v2(connection->db, "SELECT key, value FROM julea WHERE namespace = ? AND key LIKE ? || '%';", -1, &stmt, NULL) == SQLITE_OK)
 	{
 		sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
 		sqlite3_bind_text(stmt, 2, prefix, -1, NULL);
@@ -206,11 +424,48 @@ backend_get_by_prefix (gchar const* namespace, gchar const* prefix, gpointer* da
 
 static
 gboolean
-backend_iterate (gpointer data, bson_t* result_out)
+backend_get_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* data)
+{
+	JSQLiteConnection* connection;
+	sqlite3_stmt* stmt = NULL;
+
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	/* The unique index returns the keys in order, so only the requested ones have to be looked at. */
+	if ((connection = backend_connection_get()) != NULL
+	    && sqlite3_prepare_v2(connection->db, "SELECT key, value FROM julea WHERE namespace = ?1 AND key LIKE ?2 || '%' AND (?3 IS NULL OR key > ?3) ORDER BY key LIMIT ?4;", -1, &stmt, NULL) == SQLITE_OK)
+	{
+		sqlite3_bind_text(stmt, 1, namespace, -1, NULL);
+		sqlite3_bind_text(stmt, 2, prefix, -1, NULL);
+
+		if (start_after != NULL)
+		{
+			sqlite3_bind_text(stmt, 3, start_after, -1, NULL);
+		}
+		else
+		{
+			sqlite3_bind_null(stmt, 3);
+		}
+
+		/* A negative limit means no limit. */
+		sqlite3_bind_int64(stmt, 4, (limit > 0) ? (sqlite3_int64)limit : -1);
+	}
+
+	*data = stmt;
+
+	return (stmt != NULL);
+}
+
+static
+gboolean
+backend_iterate (gpointer data, gchar const** key_out, bson_t* result_out)
 {
 	sqlite3_stmt* stmt = data;
 
 	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(key_out != NULL, FALSE);
 	g_return_val_if_fail(result_out != NULL, FALSE);
 
 	if (sqlite3_step(stmt) == SQLITE_ROW)
@@ -223,9 +478,8 @@ backend_iterate (gpointer data, bson_t* result_out)
 		value = sqlite3_column_blob(stmt, 1);
 		len = sqlite3_column_bytes(stmt, 1);
 
-		(void)key;
-
 		bson_init_static(result_out, value, len);
+		*key_out = (gchar const*)key;
 
 		return TRUE;
 	}
@@ -240,31 +494,43 @@ gboolean
 backend_init (gchar const* path)
 {
 	g_autofree gchar* dirname = NULL;
+	sqlite3* db = NULL;
 
 	g_return_val_if_fail(path != NULL, FALSE);
 
 	dirname = g_path_get_dirname(path);
 	g_mkdir_with_parents(dirname, 0700);
 
-	if (sqlite3_open(path, &backend_db) != SQLITE_OK)
+	if (sqlite3_open(path, &db) != SQLITE_OK)
 	{
 		goto error;
 	}
 
-	if (sqlite3_exec(backend_db, "CREATE TABLE IF NOT EXISTS julea (namespace TEXT NOT NULL, key TEXT NOT NULL, value BLOB NOT NULL);", NULL, NULL, NULL) != SQLITE_OK)
+	/* The journal mode is persistent and lets readers proceed while a batch is being written. */
+	if (sqlite3_exec(db, "PRAGMA journal_mode = WAL;", NULL, NULL, NULL) != SQLITE_OK)
 	{
 		goto error;
 	}
 
-	if (sqlite3_exec(backend_db, "CREATE UNIQUE INDEX IF NOT EXISTS julea_namespace_key ON julea (namespace, key);", NULL, NULL, NULL) != SQLITE_OK)
+	if (sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS julea (namespace TEXT NOT NULL, key TEXT NOT NULL, value BLOB NOT NULL);", NULL, NULL, NULL) != SQLITE_OK)
 	{
 		goto error;
 	}
 
-	return (backend_db != NULL);
+	if (sqlite3_exec(db, "CREATE UNIQUE INDEX IF NOT EXISTS julea_namespace_key ON julea (namespace, key);", NULL, NULL, NULL) != SQLITE_OK)
+	{
+		goto error;
+	}
+
+	sqlite3_close(db);
+
+	backend_path = g_strdup(path);
+	backend_connections = g_ptr_array_new();
+
+	return TRUE;
 
 error:
-	sqlite3_close(backend_db);
+	sqlite3_close(db);
 
 	return FALSE;
 }
@@ -273,10 +539,19 @@ static
 void
 backend_fini (void)
 {
-	if (backend_db != NULL)
+	G_LOCK(backend_connections);
+
+	for (guint i = 0; i < backend_connections->len; i++)
 	{
-		sqlite3_close(backend_db);
+		backend_connection_close(g_ptr_array_index(backend_connections, i));
 	}
+
+	g_ptr_array_free(backend_connections, TRUE);
+	backend_connections = NULL;
+
+	G_UNLOCK(backend_connections);
+
+	g_free(backend_path);
 }
 
 static
@@ -292,7 +567,10 @@ JBackend sqlite_backend = {
 		.get = backend_get,
 		.get_all = backend_get_all,
 		.get_by_prefix = backend_get_by_prefix,
-		.iterate = backend_iterate
+		.get_range = backend_get_range,
+		.iterate = backend_iterate,
+		.put_raw = backend_put_raw,
+		.get_raw = backend_get_raw
 	}
 };
 
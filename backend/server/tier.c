@@ -0,0 +1,888 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+/*
+ * The fast tier receives new objects, the capacity tier receives cold ones.
+ */
+enum
+{
+	JD_TIER_FAST,
+	JD_TIER_CAPACITY,
+	JD_TIER_COUNT
+};
+
+/*
+ * The default time in seconds after which unused objects are migrated to the capacity tier.
+ */
+#define JD_BACKEND_AGE 3600
+
+/*
+ * The size of the buffer used for migrating objects.
+ */
+#define JD_BACKEND_MIGRATION_BUFFER (4 * 1024 * 1024)
+
+struct JBackendTier
+{
+	GModule* module;
+	JBackend* backend;
+};
+
+typedef struct JBackendTier JBackendTier;
+
+/*
+ * All handles of an object share an entry.
+ * Entries of objects on the fast tier are kept after their last handle has been closed,
+ * because they track when the object has been accessed last.
+ */
+struct JBackendTierEntry
+{
+	gchar* namespace;
+	gchar* path;
+	gchar* key;
+
+	/* Protected by jd_backend_entries_mutex. */
+	guint ref_count;
+	gboolean deleted;
+
+	/* The tier the object is stored on, -1 if it has not been looked up yet. */
+	gint tier;
+
+	/* The tier's handle, NULL if the object is not open. */
+	gpointer object;
+
+	/* The time of the last access in seconds, accessed atomically. */
+	gint last_access;
+
+	/* Protects tier and object, migrating an object requires exclusive access. */
+	GRWLock lock;
+};
+
+typedef struct JBackendTierEntry JBackendTierEntry;
+
+static JBackendTier jd_backend_tiers[JD_TIER_COUNT];
+
+static GHashTable* jd_backend_entries = NULL;
+static GMutex jd_backend_entries_mutex;
+
+static gint jd_backend_age = JD_BACKEND_AGE;
+
+static GThread* jd_backend_migration_thread = NULL;
+static GMutex jd_backend_migration_mutex;
+static GCond jd_backend_migration_cond;
+static gboolean jd_backend_migration_stop = FALSE;
+
+static JBackend tier_backend;
+
+static
+gint
+backend_now (void)
+{
+	return g_get_monotonic_time() / G_USEC_PER_SEC;
+}
+
+static
+void
+backend_entry_free (JBackendTierEntry* entry)
+{
+	g_rw_lock_clear(&(entry->lock));
+
+	g_free(entry->namespace);
+	g_free(entry->path);
+	g_free(entry->key);
+
+	g_slice_free(JBackendTierEntry, entry);
+}
+
+static
+JBackendTierEntry*
+backend_entry_ref (gchar const* namespace, gchar const* path)
+{
+	JBackendTierEntry* entry;
+	g_autofree gchar* key = NULL;
+
+	key = g_strdup_printf("%s/%s", namespace, path);
+
+	g_mutex_lock(&jd_backend_entries_mutex);
+
+	if ((entry = g_hash_table_lookup(jd_backend_entries, key)) == NULL)
+	{
+		entry = g_slice_new(JBackendTierEntry);
+		entry->namespace = g_strdup(namespace);
+		entry->path = g_strdup(path);
+		entry->key = g_steal_pointer(&key);
+		entry->ref_count = 0;
+		entry->deleted = FALSE;
+		entry->tier = -1;
+		entry->object = NULL;
+		entry->last_access = backend_now();
+
+		g_rw_lock_init(&(entry->lock));
+
+		g_hash_table_insert(jd_backend_entries, entry->key, entry);
+	}
+
+	entry->ref_count++;
+
+	g_mutex_unlock(&jd_backend_entries_mutex);
+
+	return entry;
+}
+
+static
+void
+backend_entry_unref (JBackendTierEntry* entry)
+{
+	gboolean free_entry = FALSE;
+
+	g_mutex_lock(&jd_backend_entries_mutex);
+
+	entry->ref_count--;
+
+	if (entry->ref_count == 0)
+	{
+		/* Nobody else can hold the lock without a reference. */
+		if (entry->object != NULL)
+		{
+			j_backend_object_close(jd_backend_tiers[entry->tier].backend, entry->object);
+			entry->object = NULL;
+		}
+
+		if (entry->deleted)
+		{
+			free_entry = TRUE;
+		}
+		else if (entry->tier != JD_TIER_FAST)
+		{
+			g_hash_table_remove(jd_backend_entries, entry->key);
+			free_entry = TRUE;
+		}
+	}
+
+	g_mutex_unlock(&jd_backend_entries_mutex);
+
+	if (free_entry)
+	{
+		backend_entry_free(entry);
+	}
+}
+
+/*
+ * Looks up the tier of an object, optionally creating it on the fast tier.
+ */
+static
+gboolean
+backend_entry_resolve (JBackendTierEntry* entry, gboolean create)
+{
+	gpointer object;
+	gboolean ret = TRUE;
+
+	g_rw_lock_writer_lock(&(entry->lock));
+
+	if (entry->tier == -1)
+	{
+		ret = FALSE;
+
+		for (gint i = 0; i < JD_TIER_COUNT; i++)
+		{
+			if (j_backend_object_open(jd_backend_tiers[i].backend, entry->namespace, entry->path, &object))
+			{
+				entry->tier = i;
+				entry->object = object;
+				ret = TRUE;
+				break;
+			}
+		}
+
+		if (!ret && create && j_backend_object_create(jd_backend_tiers[JD_TIER_FAST].backend, entry->namespace, entry->path, &object))
+		{
+			entry->tier = JD_TIER_FAST;
+			entry->object = object;
+			ret = TRUE;
+		}
+	}
+
+	g_rw_lock_writer_unlock(&(entry->lock));
+
+	return ret;
+}
+
+/*
+ * Returns the tier's handle with the entry's lock held for reading.
+ * Objects are reopened on demand after their last handle has been closed.
+ */
+static
+gpointer
+backend_entry_lock (JBackendTierEntry* entry)
+{
+	g_atomic_int_set(&(entry->last_access), backend_now());
+
+	g_rw_lock_reader_lock(&(entry->lock));
+
+	while (entry->object == NULL)
+	{
+		gpointer object;
+		gboolean failed;
+
+		g_rw_lock_reader_unlock(&(entry->lock));
+		g_rw_lock_writer_lock(&(entry->lock));
+
+		if (entry->object == NULL && j_backend_object_open(jd_backend_tiers[entry->tier].backend, entry->namespace, entry->path, &object))
+		{
+			entry->object = object;
+		}
+
+		failed = (entry->object == NULL);
+
+		g_rw_lock_writer_unlock(&(entry->lock));
+
+		if (failed)
+		{
+			return NULL;
+		}
+
+		g_rw_lock_reader_lock(&(entry->lock));
+	}
+
+	return entry->object;
+}
+
+static
+void
+backend_entry_unlock (JBackendTierEntry* entry)
+{
+	g_rw_lock_reader_unlock(&(entry->lock));
+}
+
+/*
+ * Copies an object to another tier and deletes it from its current tier afterwards.
+ * The copy is synced first, so the object is always complete on at least one tier.
+ */
+static
+void
+backend_entry_migrate (JBackendTierEntry* entry, gint target, gchar* buffer)
+{
+	JBackend* source;
+	JBackend* destination = jd_backend_tiers[target].backend;
+	gpointer object;
+	guint64 size = 0;
+	guint64 offset = 0;
+	gboolean ret;
+
+	g_rw_lock_writer_lock(&(entry->lock));
+
+	/* The object might have been moved by another thread in the meantime. */
+	if (entry->tier == -1 || entry->tier == target)
+	{
+		goto end;
+	}
+
+	source = jd_backend_tiers[entry->tier].backend;
+
+	if (entry->object == NULL && !j_backend_object_open(source, entry->namespace, entry->path, &(entry->object)))
+	{
+		entry->object = NULL;
+		goto end;
+	}
+
+	if (!j_backend_object_status(source, entry->object, NULL, &size)
+	    || !j_backend_object_create(destination, entry->namespace, entry->path, &object))
+	{
+		goto end;
+	}
+
+	ret = TRUE;
+
+	/* Remove leftovers of a previous migration that has been interrupted. */
+	if (destination->object.truncate != NULL)
+	{
+		ret = j_backend_object_truncate(destination, object, 0);
+	}
+
+	while (ret && offset < size)
+	{
+		guint64 bytes_read = 0;
+		guint64 bytes_written = 0;
+
+		ret = j_backend_object_read(source, entry->object, buffer, MIN(JD_BACKEND_MIGRATION_BUFFER, size - offset), offset, &bytes_read)
+		      && bytes_read > 0
+		      && j_backend_object_write(destination, object, buffer, bytes_read, offset, &bytes_written)
+		      && bytes_written == bytes_read;
+
+		offset += bytes_read;
+	}
+
+	if (!ret || !j_backend_object_sync(destination, object))
+	{
+		j_backend_object_delete(destination, object);
+		goto end;
+	}
+
+	/* Deleting closes the source tier's handle. */
+	j_backend_object_delete(source, entry->object);
+
+	entry->tier = target;
+	entry->object = object;
+
+end:
+	g_rw_lock_writer_unlock(&(entry->lock));
+}
+
+static
+gpointer
+backend_migration_thread (gpointer data)
+{
+	g_autofree gchar* buffer = NULL;
+
+	(void)data;
+
+	buffer = g_malloc(JD_BACKEND_MIGRATION_BUFFER);
+
+	g_mutex_lock(&jd_backend_migration_mutex);
+
+	while (!jd_backend_migration_stop)
+	{
+		GHashTableIter iter;
+		GSList* candidates = NULL;
+		JBackendTierEntry* entry;
+		gint64 wake_up;
+		gint now;
+
+		/* Checking ten times per age keeps objects at most 10 % longer than configured on the fast tier. */
+		wake_up = g_get_monotonic_time() + MAX(jd_backend_age / 10, 1) * G_USEC_PER_SEC;
+
+		if (g_cond_wait_until(&jd_backend_migration_cond, &jd_backend_migration_mutex, wake_up) || jd_backend_migration_stop)
+		{
+			continue;
+		}
+
+		g_mutex_unlock(&jd_backend_migration_mutex);
+
+		now = backend_now();
+
+		g_mutex_lock(&jd_backend_entries_mutex);
+
+		g_hash_table_iter_init(&iter, jd_backend_entries);
+
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&entry))
+		{
+			if (entry->tier == JD_TIER_FAST && now - g_atomic_int_get(&(entry->last_access)) >= jd_backend_age)
+			{
+				entry->ref_count++;
+				candidates = g_slist_prepend(candidates, entry);
+			}
+		}
+
+		g_mutex_unlock(&jd_backend_entries_mutex);
+
+		for (GSList* l = candidates; l != NULL; l = l->next)
+		{
+			backend_entry_migrate(l->data, JD_TIER_CAPACITY, buffer);
+			backend_entry_unref(l->data);
+		}
+
+		g_slist_free(candidates);
+
+		g_mutex_lock(&jd_backend_migration_mutex);
+	}
+
+	g_mutex_unlock(&jd_backend_migration_mutex);
+
+	return NULL;
+}
+
+static
+gboolean
+backend_create (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendTierEntry* entry;
+
+	entry = backend_entry_ref(namespace, path);
+
+	/* Existing objects are kept on their tier, new ones are created on the fast tier. */
+	if (!backend_entry_resolve(entry, TRUE))
+	{
+		backend_entry_unref(entry);
+		return FALSE;
+	}
+
+	g_atomic_int_set(&(entry->last_access), backend_now());
+
+	*data = entry;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_open (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendTierEntry* entry;
+
+	entry = backend_entry_ref(namespace, path);
+
+	if (!backend_entry_resolve(entry, FALSE))
+	{
+		backend_entry_unref(entry);
+		return FALSE;
+	}
+
+	g_atomic_int_set(&(entry->last_access), backend_now());
+
+	*data = entry;
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_close (gpointer data)
+{
+	backend_entry_unref(data);
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_delete (gpointer data)
+{
+	JBackendTierEntry* entry = data;
+	gboolean ret = FALSE;
+
+	g_rw_lock_writer_lock(&(entry->lock));
+
+	for (gint i = 0; i < JD_TIER_COUNT; i++)
+	{
+		gpointer object = NULL;
+
+		if (i == entry->tier && entry->object != NULL)
+		{
+			object = entry->object;
+			entry->object = NULL;
+		}
+		/* Also removes leftovers of interrupted migrations. */
+		else if (!j_backend_object_open(jd_backend_tiers[i].backend, entry->namespace, entry->path, &object))
+		{
+			continue;
+		}
+
+		ret = j_backend_object_delete(jd_backend_tiers[i].backend, object) || ret;
+	}
+
+	g_rw_lock_writer_unlock(&(entry->lock));
+
+	g_mutex_lock(&jd_backend_entries_mutex);
+
+	if (!entry->deleted)
+	{
+		entry->deleted = TRUE;
+		g_hash_table_remove(jd_backend_entries, entry->key);
+	}
+
+	g_mutex_unlock(&jd_backend_entries_mutex);
+
+	backend_entry_unref(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_status (gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_status(jd_backend_tiers[entry->tier].backend, object, modification_time, size);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_sync (gpointer data)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_sync(jd_backend_tiers[entry->tier].backend, object);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_read(jd_backend_tiers[entry->tier].backend, object, buffer, length, offset, bytes_read);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_write(jd_backend_tiers[entry->tier].backend, object, buffer, length, offset, bytes_written);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_truncate (gpointer data, guint64 size)
+{
+	JBackendTierEntry* entry = data;
+	JBackend* backend;
+	gpointer object;
+	gboolean ret = FALSE;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	backend = jd_backend_tiers[entry->tier].backend;
+
+	if (backend->object.truncate != NULL)
+	{
+		ret = j_backend_object_truncate(backend, object, size);
+	}
+
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_readv (gpointer data, gpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, guint64* bytes_read)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_readv(jd_backend_tiers[entry->tier].backend, object, buffers, lengths, offsets, count, bytes_read);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_writev (gpointer data, gconstpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* bytes_written)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_writev(jd_backend_tiers[entry->tier].backend, object, buffers, lengths, offsets, count, sync, bytes_written);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+static
+gboolean
+backend_hint (gpointer data, gint access, guint64 length, guint64 offset)
+{
+	JBackendTierEntry* entry = data;
+	JBackend* backend;
+	gpointer object;
+	gboolean ret = TRUE;
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	backend = jd_backend_tiers[entry->tier].backend;
+
+	if (backend->object.hint != NULL)
+	{
+		ret = j_backend_object_hint(backend, object, access, length, offset);
+	}
+
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+/*
+ * Promotes objects on the capacity tier to the fast tier before passing the prefetch on.
+ * Promotion always moves the whole object, because entries do not track which parts are on which tier.
+ */
+static
+gboolean
+backend_prefetch (gpointer data, guint64 length, guint64 offset)
+{
+	JBackendTierEntry* entry = data;
+	gpointer object;
+	gboolean ret;
+
+	if (entry->tier == JD_TIER_CAPACITY)
+	{
+		g_autofree gchar* buffer = NULL;
+
+		buffer = g_malloc(JD_BACKEND_MIGRATION_BUFFER);
+		backend_entry_migrate(entry, JD_TIER_FAST, buffer);
+	}
+
+	if ((object = backend_entry_lock(entry)) == NULL)
+	{
+		return FALSE;
+	}
+
+	ret = j_backend_object_prefetch(jd_backend_tiers[entry->tier].backend, object, length, offset);
+	backend_entry_unlock(entry);
+
+	return ret;
+}
+
+/*
+ * Loads and initializes a tier given as {backend}:{path}.
+ */
+static
+gboolean
+backend_tier_init (JBackendTier* tier, gchar const* specification)
+{
+	g_auto(GStrv) parts = NULL;
+
+	parts = g_strsplit(specification, ":", 2);
+
+	if (g_strv_length(parts) != 2)
+	{
+		g_critical("Invalid tier %s.", specification);
+		return FALSE;
+	}
+
+	if (!j_backend_load_server(parts[0], "server", J_BACKEND_TYPE_OBJECT, &(tier->module), &(tier->backend)) || tier->backend == NULL)
+	{
+		g_critical("Could not load object backend %s.", parts[0]);
+		return FALSE;
+	}
+
+	if (!j_backend_object_init(tier->backend, parts[1]))
+	{
+		g_critical("Could not initialize object backend %s.", parts[0]);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static
+gboolean
+backend_init (gchar const* path)
+{
+	g_auto(GStrv) split = NULL;
+	g_auto(GStrv) fast_name = NULL;
+	g_auto(GStrv) capacity_name = NULL;
+	guint split_len;
+
+	split = g_strsplit(path, ";", 0);
+	split_len = g_strv_length(split);
+
+	if (split_len < 2)
+	{
+		g_critical("The tier backend requires a fast and a capacity tier.");
+		return FALSE;
+	}
+
+	for (guint i = 2; i < split_len; i++)
+	{
+		if (g_str_has_prefix(split[i], "age="))
+		{
+			jd_backend_age = g_ascii_strtoll(split[i] + strlen("age="), NULL, 10);
+		}
+		else
+		{
+			g_critical("Unknown option %s.", split[i]);
+			return FALSE;
+		}
+	}
+
+	if (jd_backend_age <= 0)
+	{
+		g_critical("Invalid age, it has to be positive.");
+		return FALSE;
+	}
+
+	/* Backends keep their state in their module, so each one can only be used for one tier. */
+	fast_name = g_strsplit(split[0], ":", 2);
+	capacity_name = g_strsplit(split[1], ":", 2);
+
+	if (g_strcmp0(fast_name[0], capacity_name[0]) == 0)
+	{
+		g_critical("The tiers have to use different object backends.");
+		return FALSE;
+	}
+
+	if (!backend_tier_init(&(jd_backend_tiers[JD_TIER_FAST]), split[0])
+	    || !backend_tier_init(&(jd_backend_tiers[JD_TIER_CAPACITY]), split[1]))
+	{
+		return FALSE;
+	}
+
+	/* The vectored callbacks can only be offered if both tiers implement them. */
+	if (jd_backend_tiers[JD_TIER_FAST].backend->object.readv == NULL || jd_backend_tiers[JD_TIER_CAPACITY].backend->object.readv == NULL)
+	{
+		tier_backend.object.readv = NULL;
+	}
+
+	if (jd_backend_tiers[JD_TIER_FAST].backend->object.writev == NULL || jd_backend_tiers[JD_TIER_CAPACITY].backend->object.writev == NULL)
+	{
+		tier_backend.object.writev = NULL;
+	}
+
+	jd_backend_entries = g_hash_table_new(g_str_hash, g_str_equal);
+
+	jd_backend_migration_stop = FALSE;
+	jd_backend_migration_thread = g_thread_new("JBackendTier", backend_migration_thread, NULL);
+
+	return TRUE;
+}
+
+static
+void
+backend_fini (void)
+{
+	GHashTableIter iter;
+	JBackendTierEntry* entry;
+
+	g_mutex_lock(&jd_backend_migration_mutex);
+	jd_backend_migration_stop = TRUE;
+	g_cond_signal(&jd_backend_migration_cond);
+	g_mutex_unlock(&jd_backend_migration_mutex);
+
+	g_thread_join(jd_backend_migration_thread);
+
+	g_hash_table_iter_init(&iter, jd_backend_entries);
+
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer*)&entry))
+	{
+		if (entry->object != NULL)
+		{
+			j_backend_object_close(jd_backend_tiers[entry->tier].backend, entry->object);
+		}
+
+		backend_entry_free(entry);
+	}
+
+	g_hash_table_destroy(jd_backend_entries);
+
+	for (guint i = 0; i < JD_TIER_COUNT; i++)
+	{
+		j_backend_object_fini(jd_backend_tiers[i].backend);
+		g_module_close(jd_backend_tiers[i].module);
+	}
+}
+
+static
+JBackend tier_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.object = {
+		.init = backend_init,
+		.fini = backend_fini,
+		.create = backend_create,
+		.delete = backend_delete,
+		.open = backend_open,
+		.close = backend_close,
+		.status = backend_status,
+		.sync = backend_sync,
+		.read = backend_read,
+		.write = backend_write,
+		.read_to_fd = NULL,
+		.write_from_fd = NULL,
+		.truncate = backend_truncate,
+		.allocate = NULL,
+		.punch_hole = NULL,
+		.copy = NULL,
+		.readv = backend_readv,
+		.writev = backend_writev,
+		.hint = backend_hint,
+		.prefetch = backend_prefetch
+	}
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info (JBackendType type)
+{
+	JBackend* backend = NULL;
+
+	if (type == J_BACKEND_TYPE_OBJECT)
+	{
+		backend = &tier_backend;
+	}
+
+	return backend;
+}
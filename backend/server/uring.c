@@ -0,0 +1,514 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <liburing.h>
+
+#include <julea.h>
+
+/**
+ * The number of entries of each thread's submission queue.
+ * Larger batches are submitted in several rounds.
+ */
+#define JD_BACKEND_RING_ENTRIES 256
+
+struct JBackendFile
+{
+	gchar* path;
+	gint fd;
+};
+
+typedef struct JBackendFile JBackendFile;
+
+static gchar* jd_backend_path = NULL;
+
+static
+void
+jd_backend_ring_free (gpointer data)
+{
+	struct io_uring* ring = data;
+
+	io_uring_queue_exit(ring);
+
+	g_slice_free(struct io_uring, ring);
+}
+
+/* Every thread uses its own ring, so submissions do not have to be synchronized. */
+static GPrivate jd_backend_ring = G_PRIVATE_INIT(jd_backend_ring_free);
+
+static
+struct io_uring*
+jd_backend_ring_get_thread (void)
+{
+	struct io_uring* ring;
+
+	if ((ring = g_private_get(&jd_backend_ring)) == NULL)
+	{
+		ring = g_slice_new(struct io_uring);
+
+		if (io_uring_queue_init(JD_BACKEND_RING_ENTRIES, ring, 0) < 0)
+		{
+			g_slice_free(struct io_uring, ring);
+			return NULL;
+		}
+
+		g_private_set(&jd_backend_ring, ring);
+	}
+
+	return ring;
+}
+
+/*
+ * Submits the given reads or writes and waits for them.
+ * The final fsync is drained, so it is only started after all other requests have completed.
+ */
+static
+gboolean
+jd_backend_ring_submit (JBackendFile* file, gboolean write, gpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* nbytes)
+{
+	struct io_uring* ring;
+	gboolean ret = TRUE;
+	guint done = 0;
+
+	if ((ring = jd_backend_ring_get_thread()) == NULL)
+	{
+		return FALSE;
+	}
+
+	while (done < count || sync)
+	{
+		guint round;
+		guint submitted;
+		gboolean round_sync;
+
+		round = MIN(count - done, JD_BACKEND_RING_ENTRIES - 1);
+		round_sync = (sync && done + round == count);
+		submitted = round + (round_sync ? 1 : 0);
+
+		for (guint i = done; i < done + round; i++)
+		{
+			struct io_uring_sqe* sqe;
+
+			sqe = io_uring_get_sqe(ring);
+
+			if (write)
+			{
+				io_uring_prep_write(sqe, file->fd, buffers[i], lengths[i], offsets[i]);
+			}
+			else
+			{
+				io_uring_prep_read(sqe, file->fd, buffers[i], lengths[i], offsets[i]);
+			}
+
+			io_uring_sqe_set_data(sqe, GUINT_TO_POINTER(i));
+			nbytes[i] = 0;
+		}
+
+		if (round_sync)
+		{
+			struct io_uring_sqe* sqe;
+
+			sqe = io_uring_get_sqe(ring);
+			io_uring_prep_fsync(sqe, file->fd, 0);
+			io_uring_sqe_set_flags(sqe, IOSQE_IO_DRAIN);
+			io_uring_sqe_set_data(sqe, GUINT_TO_POINTER(G_MAXUINT));
+		}
+
+		if (io_uring_submit_and_wait(ring, submitted) < 0)
+		{
+			return FALSE;
+		}
+
+		for (guint i = 0; i < submitted; i++)
+		{
+			struct io_uring_cqe* cqe;
+			guint index;
+
+			if (io_uring_wait_cqe(ring, &cqe) < 0)
+			{
+				return FALSE;
+			}
+
+			index = GPOINTER_TO_UINT(io_uring_cqe_get_data(cqe));
+
+			if (cqe->res < 0)
+			{
+				ret = FALSE;
+			}
+			else if (index != G_MAXUINT)
+			{
+				nbytes[index] = cqe->res;
+
+				/* Short reads only happen at the end of the file, short writes are errors. */
+				if (write && nbytes[index] != lengths[index])
+				{
+					ret = FALSE;
+				}
+			}
+
+			io_uring_cqe_seen(ring, cqe);
+		}
+
+		done += round;
+
+		if (round_sync)
+		{
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_create (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendFile* file;
+	g_autofree gchar* parent = NULL;
+	gchar* full_path;
+	gint fd;
+
+	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_CREATE);
+
+	parent = g_path_get_dirname(full_path);
+	g_mkdir_with_parents(parent, 0700);
+
+	fd = open(full_path, O_RDWR | O_CREAT, 0600);
+
+	j_trace_file_end(full_path, J_TRACE_FILE_CREATE, 0, 0);
+
+	file = g_slice_new(JBackendFile);
+	file->path = full_path;
+	file->fd = fd;
+
+	*data = file;
+
+	return (fd != -1);
+}
+
+static
+gboolean
+backend_open (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JBackendFile* file;
+	gchar* full_path;
+	gint fd;
+
+	full_path = g_build_filename(jd_backend_path, namespace, path, NULL);
+
+	j_trace_file_begin(full_path, J_TRACE_FILE_OPEN);
+	fd = open(full_path, O_RDWR);
+	j_trace_file_end(full_path, J_TRACE_FILE_OPEN, 0, 0);
+
+	file = g_slice_new(JBackendFile);
+	file->path = full_path;
+	file->fd = fd;
+
+	*data = file;
+
+	return (fd != -1);
+}
+
+static
+gboolean
+backend_close (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret = TRUE;
+
+	if (file->fd != -1)
+	{
+		j_trace_file_begin(file->path, J_TRACE_FILE_CLOSE);
+		ret = (close(file->fd) == 0);
+		j_trace_file_end(file->path, J_TRACE_FILE_CLOSE, 0, 0);
+	}
+
+	g_free(file->path);
+	g_slice_free(JBackendFile, file);
+
+	return ret;
+}
+
+static
+gboolean
+backend_delete (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_DELETE);
+	ret = (g_unlink(file->path) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_DELETE, 0, 0);
+
+	backend_close(file);
+
+	return ret;
+}
+
+static
+gboolean
+backend_status (gpointer data, gint64* modification_time, guint64* size)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+	struct stat buf;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_STATUS);
+	ret = (fstat(file->fd, &buf) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_STATUS, 0, 0);
+
+	if (modification_time != NULL)
+	{
+		*modification_time = buf.st_mtime * G_USEC_PER_SEC;
+
+#ifdef HAVE_STMTIM_TVNSEC
+		*modification_time += buf.st_mtim.tv_nsec / 1000;
+#endif
+	}
+
+	if (size != NULL)
+	{
+		*size = buf.st_size;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_sync (gpointer data)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_SYNC);
+	ret = (fsync(file->fd) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_SYNC, 0, 0);
+
+	return ret;
+}
+
+static
+gboolean
+backend_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+	guint64 nbytes = 0;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+	ret = jd_backend_ring_submit(file, FALSE, &buffer, &length, &offset, 1, FALSE, &nbytes);
+	j_trace_file_end(file->path, J_TRACE_FILE_READ, nbytes, offset);
+
+	if (bytes_read != NULL)
+	{
+		*bytes_read = nbytes;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+	gpointer buffers[1] = { (gpointer)buffer };
+	guint64 nbytes = 0;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+	ret = jd_backend_ring_submit(file, TRUE, buffers, &length, &offset, 1, FALSE, &nbytes);
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, nbytes, offset);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = nbytes;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+backend_readv (gpointer data, gpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, guint64* bytes_read)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_READ);
+	ret = jd_backend_ring_submit(file, FALSE, buffers, lengths, offsets, count, FALSE, bytes_read);
+	j_trace_file_end(file->path, J_TRACE_FILE_READ, 0, 0);
+
+	return ret;
+}
+
+static
+gboolean
+backend_writev (gpointer data, gconstpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* bytes_written)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	/* The buffers are only read, io_uring's interface just does not distinguish reads from writes. */
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+	ret = jd_backend_ring_submit(file, TRUE, (gpointer const*)buffers, lengths, offsets, count, sync, bytes_written);
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, 0);
+
+	return ret;
+}
+
+static
+gboolean
+backend_truncate (gpointer data, guint64 size)
+{
+	JBackendFile* file = data;
+	gboolean ret;
+
+	j_trace_file_begin(file->path, J_TRACE_FILE_WRITE);
+	ret = (ftruncate(file->fd, size) == 0);
+	j_trace_file_end(file->path, J_TRACE_FILE_WRITE, 0, size);
+
+	return ret;
+}
+
+#ifdef HAVE_POSIX_FADVISE
+static
+gboolean
+backend_hint (gpointer data, gint access, guint64 length, guint64 offset)
+{
+	JBackendFile* file = data;
+	gint advice = POSIX_FADV_NORMAL;
+	gboolean ret;
+
+	if (access == J_SEMANTICS_ACCESS_SEQUENTIAL)
+	{
+		advice = POSIX_FADV_SEQUENTIAL;
+	}
+	else if (access == J_SEMANTICS_ACCESS_RANDOM)
+	{
+		advice = POSIX_FADV_RANDOM;
+	}
+
+	/* The readahead window belongs to the descriptor, so the advice always applies to the whole file. */
+	ret = (posix_fadvise(file->fd, 0, 0, advice) == 0);
+
+	/* Start reading the following range, so that the next read of a stream finds it in the page cache. */
+	if (access == J_SEMANTICS_ACCESS_SEQUENTIAL)
+	{
+		posix_fadvise(file->fd, offset + length, length, POSIX_FADV_WILLNEED);
+	}
+
+	return ret;
+}
+#endif
+
+#ifdef HAVE_POSIX_FADVISE
+static
+gboolean
+backend_prefetch (gpointer data, guint64 length, guint64 offset)
+{
+	JBackendFile* file = data;
+
+	return (posix_fadvise(file->fd, offset, length, POSIX_FADV_WILLNEED) == 0);
+}
+#endif
+
+static
+gboolean
+backend_init (gchar const* path)
+{
+	jd_backend_path = g_strdup(path);
+
+	g_mkdir_with_parents(path, 0700);
+
+	/* Fail early if the kernel does not support io_uring. */
+	if (jd_backend_ring_get_thread() == NULL)
+	{
+		g_critical("Could not initialize io_uring.");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static
+void
+backend_fini (void)
+{
+	g_free(jd_backend_path);
+}
+
+static
+JBackend uring_backend = {
+	.type = J_BACKEND_TYPE_OBJECT,
+	.object = {
+		.init = backend_init,
+		.fini = backend_fini,
+		.create = backend_create,
+		.delete = backend_delete,
+		.open = backend_open,
+		.close = backend_close,
+		.status = backend_status,
+		.sync = backend_sync,
+		.read = backend_read,
+		.write = backend_write,
+		.read_to_fd = NULL,
+		.write_from_fd = NULL,
+		.truncate = backend_truncate,
+		.allocate = NULL,
+		.punch_hole = NULL,
+		.copy = NULL,
+		.readv = backend_readv,
+		.writev = backend_writev,
+#ifdef HAVE_POSIX_FADVISE
+		.hint = backend_hint,
+		.prefetch = backend_prefetch
+#else
+		.hint = NULL,
+		.prefetch = NULL
+#endif
+	}
+};
+
+G_MODULE_EXPORT
+JBackend*
+backend_info (JBackendType type)
+{
+	JBackend* backend = NULL;
+
+	if (type == J_BACKEND_TYPE_OBJECT)
+	{
+		backend = &uring_backend;
+	}
+
+	return backend;
+}
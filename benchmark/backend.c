@@ -0,0 +1,606 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Benchmarks for server backends.
+ *
+ * The backends are loaded into the benchmark process and called directly, bypassing the client, the network and the server.
+ * This makes it possible to tell the cost of a backend from the protocol overhead.
+ * All operations are executed by --backend-threads threads at once, every thread using its own objects and keys.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+
+#include "benchmark.h"
+
+static gchar* opt_backend_object = NULL;
+static gchar* opt_backend_object_path = NULL;
+static gchar* opt_backend_kv = NULL;
+static gchar* opt_backend_kv_path = NULL;
+static gint opt_backend_threads = 1;
+
+static JBackend* benchmark_backend_object = NULL;
+static JBackend* benchmark_backend_kv = NULL;
+
+typedef struct BackendThread BackendThread;
+
+typedef void (*BackendFunc) (BackendThread*);
+
+struct BackendThread
+{
+	BackendFunc func;
+
+	guint index;
+
+	/**
+	 * The number of operations to execute.
+	 */
+	guint n;
+
+	guint64 block_size;
+	guint64 bytes;
+};
+
+static
+gpointer
+backend_thread (gpointer data)
+{
+	BackendThread* thread = data;
+
+	(*(thread->func))(thread);
+
+	return NULL;
+}
+
+/**
+ * Runs a function on all threads and returns the number of bytes they have transferred.
+ */
+static
+guint64
+backend_run_threads (BackendFunc func, guint n, guint64 block_size)
+{
+	g_autofree GThread** threads = NULL;
+	g_autofree BackendThread* thread_data = NULL;
+	guint64 bytes = 0;
+
+	threads = g_new(GThread*, opt_backend_threads);
+	thread_data = g_new(BackendThread, opt_backend_threads);
+
+	for (gint i = 0; i < opt_backend_threads; i++)
+	{
+		thread_data[i].func = func;
+		thread_data[i].index = i;
+		thread_data[i].n = n / opt_backend_threads + ((guint)i < n % opt_backend_threads ? 1 : 0);
+		thread_data[i].block_size = block_size;
+		thread_data[i].bytes = 0;
+
+		threads[i] = g_thread_new("benchmark-backend", backend_thread, &(thread_data[i]));
+	}
+
+	for (gint i = 0; i < opt_backend_threads; i++)
+	{
+		g_thread_join(threads[i]);
+		bytes += thread_data[i].bytes;
+	}
+
+	return bytes;
+}
+
+/**
+ * Runs a benchmark: setup and cleanup are not timed, func is.
+ */
+static
+void
+_benchmark_backend (BenchmarkResult* result, BackendFunc setup, BackendFunc func, BackendFunc cleanup, guint n, guint64 block_size)
+{
+	gdouble elapsed;
+	guint64 bytes;
+
+	if (setup != NULL)
+	{
+		backend_run_threads(setup, n, block_size);
+	}
+
+	j_benchmark_timer_start();
+	bytes = backend_run_threads(func, n, block_size);
+	elapsed = j_benchmark_timer_elapsed();
+
+	if (cleanup != NULL)
+	{
+		backend_run_threads(cleanup, n, block_size);
+	}
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+	result->bytes = bytes;
+}
+
+static
+gchar*
+backend_name (BackendThread const* thread, guint i)
+{
+	return g_strdup_printf("benchmark-%u-%u", thread->index, i);
+}
+
+static
+void
+backend_object_create (BackendThread* thread)
+{
+	for (guint i = 0; i < thread->n; i++)
+	{
+		g_autofree gchar* name = NULL;
+		gpointer object;
+
+		name = backend_name(thread, i);
+
+		if (j_backend_object_create(benchmark_backend_object, "benchmark", name, &object))
+		{
+			j_backend_object_close(benchmark_backend_object, object);
+		}
+	}
+}
+
+static
+void
+backend_object_delete (BackendThread* thread)
+{
+	for (guint i = 0; i < thread->n; i++)
+	{
+		g_autofree gchar* name = NULL;
+		gpointer object;
+
+		name = backend_name(thread, i);
+
+		if (j_backend_object_open(benchmark_backend_object, "benchmark", name, &object))
+		{
+			j_backend_object_delete(benchmark_backend_object, object);
+		}
+	}
+}
+
+/**
+ * Opens and queries the thread's first object n times.
+ */
+static
+void
+backend_object_status (BackendThread* thread)
+{
+	g_autofree gchar* name = NULL;
+
+	name = backend_name(thread, 0);
+
+	for (guint i = 0; i < thread->n; i++)
+	{
+		gpointer object;
+		gint64 modification_time;
+		guint64 size;
+
+		if (j_backend_object_open(benchmark_backend_object, "benchmark", name, &object))
+		{
+			j_backend_object_status(benchmark_backend_object, object, &modification_time, &size);
+			j_backend_object_close(benchmark_backend_object, object);
+		}
+	}
+}
+
+static
+void
+backend_object_create_one (BackendThread* thread)
+{
+	g_autofree gchar* name = NULL;
+	gpointer object;
+
+	name = backend_name(thread, 0);
+
+	if (j_backend_object_create(benchmark_backend_object, "benchmark", name, &object))
+	{
+		j_backend_object_close(benchmark_backend_object, object);
+	}
+}
+
+static
+void
+backend_object_delete_one (BackendThread* thread)
+{
+	g_autofree gchar* name = NULL;
+	gpointer object;
+
+	name = backend_name(thread, 0);
+
+	if (j_backend_object_open(benchmark_backend_object, "benchmark", name, &object))
+	{
+		j_backend_object_delete(benchmark_backend_object, object);
+	}
+}
+
+/**
+ * Writes or reads n blocks sequentially to or from the thread's first object.
+ */
+static
+void
+backend_object_transfer (BackendThread* thread, gboolean write)
+{
+	g_autofree gchar* name = NULL;
+	g_autofree gchar* buffer = NULL;
+	gpointer object;
+
+	name = backend_name(thread, 0);
+	buffer = g_malloc0(thread->block_size);
+
+	if (write)
+	{
+		if (!j_backend_object_create(benchmark_backend_object, "benchmark", name, &object))
+		{
+			return;
+		}
+	}
+	else if (!j_backend_object_open(benchmark_backend_object, "benchmark", name, &object))
+	{
+		return;
+	}
+
+	for (guint i = 0; i < thread->n; i++)
+	{
+		guint64 bytes = 0;
+
+		if (write)
+		{
+			j_backend_object_write(benchmark_backend_object, object, buffer, thread->block_size, i * thread->block_size, &bytes);
+		}
+		else
+		{
+			j_backend_object_read(benchmark_backend_object, object, buffer, thread->block_size, i * thread->block_size, &bytes);
+		}
+
+		thread->bytes += bytes;
+	}
+
+	j_backend_object_close(benchmark_backend_object, object);
+}
+
+static
+void
+backend_object_write (BackendThread* thread)
+{
+	backend_object_transfer(thread, TRUE);
+}
+
+static
+void
+backend_object_read (BackendThread* thread)
+{
+	backend_object_transfer(thread, FALSE);
+}
+
+static
+void
+benchmark_backend_object_create (BenchmarkResult* result)
+{
+	_benchmark_backend(result, NULL, backend_object_create, backend_object_delete, 10000, 0);
+}
+
+static
+void
+benchmark_backend_object_delete (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_object_create, backend_object_delete, NULL, 10000, 0);
+}
+
+static
+void
+benchmark_backend_object_status (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_object_create_one, backend_object_status, backend_object_delete_one, 100000, 0);
+}
+
+static
+void
+benchmark_backend_object_write_4k (BenchmarkResult* result)
+{
+	_benchmark_backend(result, NULL, backend_object_write, backend_object_delete_one, 25000, 4 * 1024);
+}
+
+static
+void
+benchmark_backend_object_read_4k (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_object_write, backend_object_read, backend_object_delete_one, 25000, 4 * 1024);
+}
+
+static
+void
+benchmark_backend_object_write_1m (BenchmarkResult* result)
+{
+	_benchmark_backend(result, NULL, backend_object_write, backend_object_delete_one, 1000, 1024 * 1024);
+}
+
+static
+void
+benchmark_backend_object_read_1m (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_object_write, backend_object_read, backend_object_delete_one, 1000, 1024 * 1024);
+}
+
+/**
+ * Puts n keys, using one batch per key or a single batch for all of them.
+ */
+static
+void
+backend_kv_put_internal (BackendThread* thread, gboolean single_batch)
+{
+	gpointer batch = NULL;
+	bson_t value[1];
+
+	bson_init(value);
+	BSON_APPEND_INT32(value, "value", thread->index);
+
+	for (guint i = 0; i < thread->n; i++)
+	{
+		g_autofree gchar* key = NULL;
+
+		key = backend_name(thread, i);
+
+		if (batch == NULL && !j_backend_kv_batch_start(benchmark_backend_kv, "benchmark", J_SEMANTICS_SAFETY_NETWORK, &batch))
+		{
+			break;
+		}
+
+		j_backend_kv_put(benchmark_backend_kv, batch, key, value);
+
+		if (!single_batch)
+		{
+			j_backend_kv_batch_execute(benchmark_backend_kv, batch);
+			batch = NULL;
+		}
+	}
+
+	if (batch != NULL)
+	{
+		j_backend_kv_batch_execute(benchmark_backend_kv, batch);
+	}
+
+	bson_destroy(value);
+}
+
+static
+void
+backend_kv_put (BackendThread* thread)
+{
+	backend_kv_put_internal(thread, FALSE);
+}
+
+static
+void
+backend_kv_put_batch (BackendThread* thread)
+{
+	backend_kv_put_internal(thread, TRUE);
+}
+
+static
+void
+backend_kv_get (BackendThread* thread)
+{
+	for (guint i = 0; i < thread->n; i++)
+	{
+		g_autofree gchar* key = NULL;
+		bson_t value[1];
+
+		key = backend_name(thread, i);
+
+		if (j_backend_kv_get(benchmark_backend_kv, "benchmark", key, value))
+		{
+			bson_destroy(value);
+		}
+	}
+}
+
+/**
+ * Iterates over the thread's keys, n / 100 times.
+ */
+static
+void
+backend_kv_iterate (BackendThread* thread)
+{
+	g_autofree gchar* prefix = NULL;
+
+	prefix = g_strdup_printf("benchmark-%u-", thread->index);
+
+	for (guint i = 0; i < thread->n / 100; i++)
+	{
+		gpointer iterator;
+
+		if (j_backend_kv_get_by_prefix(benchmark_backend_kv, "benchmark", prefix, &iterator))
+		{
+			gchar const* key;
+			bson_t value[1];
+
+			while (j_backend_kv_iterate(benchmark_backend_kv, iterator, &key, value))
+			{
+				bson_destroy(value);
+			}
+		}
+	}
+}
+
+static
+void
+backend_kv_delete (BackendThread* thread)
+{
+	for (guint i = 0; i < thread->n; i++)
+	{
+		g_autofree gchar* key = NULL;
+		gpointer batch;
+
+		key = backend_name(thread, i);
+
+		if (j_backend_kv_batch_start(benchmark_backend_kv, "benchmark", J_SEMANTICS_SAFETY_NETWORK, &batch))
+		{
+			j_backend_kv_delete(benchmark_backend_kv, batch, key);
+			j_backend_kv_batch_execute(benchmark_backend_kv, batch);
+		}
+	}
+}
+
+static
+void
+benchmark_backend_kv_put (BenchmarkResult* result)
+{
+	_benchmark_backend(result, NULL, backend_kv_put, backend_kv_delete, 100000, 0);
+}
+
+static
+void
+benchmark_backend_kv_put_batch (BenchmarkResult* result)
+{
+	_benchmark_backend(result, NULL, backend_kv_put_batch, backend_kv_delete, 100000, 0);
+}
+
+static
+void
+benchmark_backend_kv_get (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_kv_put_batch, backend_kv_get, backend_kv_delete, 100000, 0);
+}
+
+static
+void
+benchmark_backend_kv_iterate (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_kv_put_batch, backend_kv_iterate, backend_kv_delete, 100000, 0);
+
+	/* Every iteration returns all of the thread's keys. */
+	result->operations = 100000 / opt_backend_threads / 100 * opt_backend_threads;
+}
+
+static
+void
+benchmark_backend_kv_delete (BenchmarkResult* result)
+{
+	_benchmark_backend(result, backend_kv_put_batch, backend_kv_delete, NULL, 100000, 0);
+}
+
+/**
+ * Returns the options of the backend benchmarks.
+ */
+GOptionGroup*
+benchmark_backend_get_option_group (void)
+{
+	GOptionGroup* group;
+
+	static GOptionEntry entries[] = {
+		{ "backend-object", 0, 0, G_OPTION_ARG_STRING, &opt_backend_object, "Object backend to benchmark", "posix" },
+		{ "backend-object-path", 0, 0, G_OPTION_ARG_STRING, &opt_backend_object_path, "Path for the object backend", "/tmp/julea-benchmark/object" },
+		{ "backend-kv", 0, 0, G_OPTION_ARG_STRING, &opt_backend_kv, "Key-value backend to benchmark", "lmdb" },
+		{ "backend-kv-path", 0, 0, G_OPTION_ARG_STRING, &opt_backend_kv_path, "Path for the key-value backend", "/tmp/julea-benchmark/kv" },
+		{ "backend-threads", 0, 0, G_OPTION_ARG_INT, &opt_backend_threads, "Number of threads", "1" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	group = g_option_group_new("backend", "Backend benchmark options", "Show backend benchmark options", NULL, NULL);
+	g_option_group_add_entries(group, entries);
+
+	return group;
+}
+
+void
+benchmark_backend (void)
+{
+	GModule* module = NULL;
+
+	if (opt_backend_threads <= 0)
+	{
+		g_warning("Invalid number of backend threads, skipping backend benchmarks.");
+		goto end;
+	}
+
+	if (opt_backend_object != NULL)
+	{
+		if (opt_backend_object_path != NULL
+		    && j_backend_load_server(opt_backend_object, "server", J_BACKEND_TYPE_OBJECT, &module, &benchmark_backend_object)
+		    && benchmark_backend_object != NULL
+		    && j_backend_object_init(benchmark_backend_object, opt_backend_object_path))
+		{
+			j_benchmark_run("/backend/object/create", benchmark_backend_object_create);
+			j_benchmark_run("/backend/object/delete", benchmark_backend_object_delete);
+			j_benchmark_run("/backend/object/status", benchmark_backend_object_status);
+			j_benchmark_run("/backend/object/write-4k", benchmark_backend_object_write_4k);
+			j_benchmark_run("/backend/object/read-4k", benchmark_backend_object_read_4k);
+			j_benchmark_run("/backend/object/write-1m", benchmark_backend_object_write_1m);
+			j_benchmark_run("/backend/object/read-1m", benchmark_backend_object_read_1m);
+
+			j_backend_object_fini(benchmark_backend_object);
+		}
+		else
+		{
+			g_warning("Could not load object backend %s, skipping object backend benchmarks.", opt_backend_object);
+		}
+
+		if (module != NULL)
+		{
+			g_module_close(module);
+			module = NULL;
+		}
+
+		benchmark_backend_object = NULL;
+	}
+
+	if (opt_backend_kv != NULL)
+	{
+		if (opt_backend_kv_path != NULL
+		    && j_backend_load_server(opt_backend_kv, "server", J_BACKEND_TYPE_KV, &module, &benchmark_backend_kv)
+		    && benchmark_backend_kv != NULL
+		    && j_backend_kv_init(benchmark_backend_kv, opt_backend_kv_path))
+		{
+			j_benchmark_run("/backend/kv/put", benchmark_backend_kv_put);
+			j_benchmark_run("/backend/kv/put-batch", benchmark_backend_kv_put_batch);
+			j_benchmark_run("/backend/kv/get", benchmark_backend_kv_get);
+			j_benchmark_run("/backend/kv/iterate", benchmark_backend_kv_iterate);
+			j_benchmark_run("/backend/kv/delete", benchmark_backend_kv_delete);
+
+			j_backend_kv_fini(benchmark_backend_kv);
+		}
+		else
+		{
+			g_warning("Could not load key-value backend %s, skipping key-value backend benchmarks.", opt_backend_kv);
+		}
+
+		if (module != NULL)
+		{
+			g_module_close(module);
+		}
+
+		benchmark_backend_kv = NULL;
+	}
+
+end:
+	g_free(opt_backend_object);
+	g_free(opt_backend_object_path);
+	g_free(opt_backend_kv);
+	g_free(opt_backend_kv_path);
+}
@@ -67,8 +67,54 @@ benchmark_background_operation_new_ref_unref (BenchmarkResult* result)
 	result->operations = n;
 }
 
+static
+void
+benchmark_background_operation_new_ref_unref_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+
+	(void)thread;
+
+	for (guint i = 0; i < *n; i++)
+	{
+		JBackgroundOperation* background_operation;
+
+		background_operation = j_background_operation_new(on_background_operation_completed, NULL);
+		j_background_operation_unref(background_operation);
+	}
+}
+
+/**
+ * All threads submit operations to the shared thread pool.
+ */
+static
+void
+benchmark_background_operation_new_ref_unref_threads (BenchmarkResult* result)
+{
+	guint const n = 100000;
+
+	gdouble elapsed;
+	guint per_thread;
+
+	per_thread = n / j_benchmark_get_threads();
+
+	g_atomic_int_set(&benchmark_background_operation_counter, 0);
+
+	j_benchmark_timer_start();
+
+	j_benchmark_threads_execute(benchmark_background_operation_new_ref_unref_thread, &per_thread);
+
+	while (g_atomic_int_get(&benchmark_background_operation_counter) != (gint)(per_thread * j_benchmark_get_threads()));
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = per_thread * j_benchmark_get_threads();
+}
+
 void
 benchmark_background_operation (void)
 {
 	j_benchmark_run("/background-operation", benchmark_background_operation_new_ref_unref);
+	j_benchmark_run_threads("/background-operation/threads", benchmark_background_operation_new_ref_unref_threads);
 }
@@ -20,6 +20,7 @@
 
 #include <glib.h>
 
+#include <math.h>
 #include <string.h>
 
 #include <julea.h>
@@ -29,23 +30,140 @@
 #include "benchmark.h"
 
 static gboolean opt_machine_readable = FALSE;
+static gboolean opt_json = FALSE;
 static gchar* opt_path = NULL;
 static gchar* opt_semantics = NULL;
 static gchar* opt_template = NULL;
+static gint opt_warmup = 0;
+static gint opt_repetitions = 1;
+
+/**
+ * The number of sub-buckets per power of two in the latency histogram.
+ * Latencies are recorded with a relative error of at most 1/J_BENCHMARK_LATENCY_SUB_BUCKETS.
+ */
+#define J_BENCHMARK_LATENCY_SUB_BUCKETS 16
+
+/**
+ * The number of buckets in the latency histogram, covering latencies of up to 2^40 nanoseconds.
+ */
+#define J_BENCHMARK_LATENCY_BUCKETS (40 * J_BENCHMARK_LATENCY_SUB_BUCKETS)
 
 static JSemantics* j_benchmark_semantics = NULL;
 
 static GTimer* j_benchmark_timer = NULL;
 
+/**
+ * The time of the previous lap, in seconds since the timer was started.
+ */
+static gdouble j_benchmark_lap = 0.0;
+
+/**
+ * Whether laps are recorded, which is not the case during warmup runs.
+ */
+static gboolean j_benchmark_record = FALSE;
+
+static guint64 j_benchmark_latency[J_BENCHMARK_LATENCY_BUCKETS];
+static guint64 j_benchmark_latency_count = 0;
+
+/**
+ * Protects the latency histogram, which can be updated by several threads.
+ */
+static GMutex j_benchmark_latency_mutex;
+
+static gboolean j_benchmark_json_first = TRUE;
+
+/**
+ * Returns the histogram bucket for a latency.
+ * The first J_BENCHMARK_LATENCY_SUB_BUCKETS buckets are linear, after that, every power of two is split into J_BENCHMARK_LATENCY_SUB_BUCKETS buckets.
+ */
+static
+guint
+j_benchmark_latency_bucket (guint64 nsec)
+{
+	guint bits;
+	guint bucket;
+
+	if (nsec < J_BENCHMARK_LATENCY_SUB_BUCKETS)
+	{
+		return nsec;
+	}
+
+	/* J_BENCHMARK_LATENCY_SUB_BUCKETS is 2^4, the four bits after the most significant one select the sub-bucket. */
+	bits = g_bit_storage(nsec);
+	bucket = (bits - 4) * J_BENCHMARK_LATENCY_SUB_BUCKETS + ((nsec >> (bits - 5)) & (J_BENCHMARK_LATENCY_SUB_BUCKETS - 1));
+
+	return MIN(bucket, J_BENCHMARK_LATENCY_BUCKETS - 1);
+}
+
+/**
+ * Returns the smallest latency that falls into a bucket.
+ */
+static
+guint64
+j_benchmark_latency_bucket_start (guint bucket)
+{
+	guint bits;
+
+	if (bucket < J_BENCHMARK_LATENCY_SUB_BUCKETS)
+	{
+		return bucket;
+	}
+
+	bits = bucket / J_BENCHMARK_LATENCY_SUB_BUCKETS + 4;
+
+	return (G_GUINT64_CONSTANT(1) << (bits - 1)) | ((guint64)(bucket % J_BENCHMARK_LATENCY_SUB_BUCKETS) << (bits - 5));
+}
+
+/**
+ * Returns a percentile of the recorded latencies in seconds.
+ */
+static
+gdouble
+j_benchmark_latency_percentile (gdouble percentile)
+{
+	guint64 rank;
+	guint64 count = 0;
+
+	rank = (guint64)(percentile / 100.0 * j_benchmark_latency_count);
+
+	if (rank >= j_benchmark_latency_count)
+	{
+		rank = j_benchmark_latency_count - 1;
+	}
+
+	for (guint i = 0; i < J_BENCHMARK_LATENCY_BUCKETS; i++)
+	{
+		count += j_benchmark_latency[i];
+
+		if (count > rank)
+		{
+			/* Report the middle of the bucket. */
+			return (j_benchmark_latency_bucket_start(i) + j_benchmark_latency_bucket_start(i + 1)) / 2.0 / 1e9;
+		}
+	}
+
+	return 0.0;
+}
+
 JSemantics*
 j_benchmark_get_semantics (void)
 {
 	return j_semantics_ref(j_benchmark_semantics);
 }
 
+/**
+ * Returns the namespace benchmarks should create their objects in.
+ */
+gchar const*
+j_benchmark_get_namespace (void)
+{
+	return "benchmark";
+}
+
 void
 j_benchmark_timer_start (void)
 {
+	j_benchmark_lap = 0.0;
 	g_timer_start(j_benchmark_timer);
 }
 
@@ -55,13 +173,125 @@ j_benchmark_timer_elapsed (void)
 	return g_timer_elapsed(j_benchmark_timer, NULL);
 }
 
+/**
+ * Records the latency of a single operation, that is, the time since the timer was started or since the previous lap.
+ * Benchmarks that execute one operation at a time should call this after every operation.
+ */
+void
+j_benchmark_timer_lap (void)
+{
+	gdouble now;
+
+	now = g_timer_elapsed(j_benchmark_timer, NULL);
+	j_benchmark_latency_add(now - j_benchmark_lap);
+	j_benchmark_lap = now;
+}
+
+/**
+ * Records the latency of a single operation in seconds.
+ * Unlike j_benchmark_timer_lap(), this can be called by several threads at once, which have to measure the latency themselves.
+ */
+void
+j_benchmark_latency_add (gdouble latency)
+{
+	if (!j_benchmark_record)
+	{
+		return;
+	}
+
+	g_mutex_lock(&j_benchmark_latency_mutex);
+	j_benchmark_latency[j_benchmark_latency_bucket(latency * 1e9)]++;
+	j_benchmark_latency_count++;
+	g_mutex_unlock(&j_benchmark_latency_mutex);
+}
+
+static
+void
+j_benchmark_print_json (gchar const* name, BenchmarkResult const* result, gdouble const* elapsed_times, gdouble total_elapsed)
+{
+	gdouble mean = 0.0;
+	gdouble min = G_MAXDOUBLE;
+	gdouble max = 0.0;
+	gdouble variance = 0.0;
+
+	for (gint i = 0; i < opt_repetitions; i++)
+	{
+		mean += elapsed_times[i] / opt_repetitions;
+		min = MIN(min, elapsed_times[i]);
+		max = MAX(max, elapsed_times[i]);
+	}
+
+	for (gint i = 0; i < opt_repetitions; i++)
+	{
+		variance += (elapsed_times[i] - mean) * (elapsed_times[i] - mean) / opt_repetitions;
+	}
+
+	g_print("%s\n  {\n", (j_benchmark_json_first) ? "" : ",");
+	j_benchmark_json_first = FALSE;
+
+	g_print("    \"name\": \"%s\",\n", name);
+	g_print("    \"repetitions\": %d,\n", opt_repetitions);
+	g_print("    \"elapsed\": { \"mean\": %f, \"min\": %f, \"max\": %f, \"stddev\": %f, \"runs\": [", mean, min, max, sqrt(variance));
+
+	for (gint i = 0; i < opt_repetitions; i++)
+	{
+		g_print("%s%f", (i > 0) ? ", " : "", elapsed_times[i]);
+	}
+
+	g_print("] },\n");
+	g_print("    \"operations\": %" G_GUINT64_FORMAT ",\n", result->operations);
+	g_print("    \"bytes\": %" G_GUINT64_FORMAT ",\n", result->bytes);
+
+	if (result->operations != 0)
+	{
+		g_print("    \"operations_per_second\": %f,\n", (gdouble)result->operations / mean);
+	}
+
+	if (result->bytes != 0)
+	{
+		g_print("    \"bytes_per_second\": %f,\n", (gdouble)result->bytes / mean);
+	}
+
+	if (result->allocations >= 0)
+	{
+		g_print("    \"allocations\": %" G_GINT64_FORMAT ",\n", result->allocations);
+	}
+
+	if (result->memory >= 0)
+	{
+		g_print("    \"memory\": %" G_GINT64_FORMAT ",\n", result->memory);
+	}
+
+	if (j_benchmark_latency_count > 0)
+	{
+		g_print("    \"latency\": { \"samples\": %" G_GUINT64_FORMAT ", \"p50\": %e, \"p99\": %e, \"p999\": %e },\n",
+			j_benchmark_latency_count, j_benchmark_latency_percentile(50.0), j_benchmark_latency_percentile(99.0), j_benchmark_latency_percentile(99.9));
+	}
+
+	g_print("    \"total_elapsed\": %f\n", total_elapsed);
+	g_print("  }");
+}
+
+/**
+ * Returns whether a benchmark whose name starts with prefix might be run, so that expensive setup can be skipped otherwise.
+ */
+gboolean
+j_benchmark_is_selected (gchar const* prefix)
+{
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	return (opt_path == NULL || g_str_has_prefix(prefix, opt_path) || g_str_has_prefix(opt_path, prefix));
+}
+
 void
 j_benchmark_run (gchar const* name, BenchmarkFunc benchmark_func)
 {
 	BenchmarkResult result;
 	GTimer* func_timer;
 	g_autofree gchar* left = NULL;
+	g_autofree gdouble* elapsed_times = NULL;
 	gdouble elapsed;
+	gdouble elapsed_mean = 0.0;
 
 	g_return_if_fail(name != NULL);
 	g_return_if_fail(benchmark_func != NULL);
@@ -72,28 +302,73 @@ j_benchmark_run (gchar const* name, BenchmarkFunc benchmark_func)
 	}
 
 	func_timer = g_timer_new();
-	result.elapsed_time = 0.0;
-	result.operations = 0;
-	result.bytes = 0;
+	elapsed_times = g_new(gdouble, opt_repetitions);
+
+	memset(j_benchmark_latency, 0, sizeof(j_benchmark_latency));
+	j_benchmark_latency_count = 0;
 
-	if (!opt_machine_readable)
+	/* JSON output is printed at once after the benchmark has finished. */
+	if (!opt_json)
 	{
-		left = g_strconcat(name, ":", NULL);
-		g_print("%-50s ", left);
+		if (!opt_machine_readable)
+		{
+			left = g_strconcat(name, ":", NULL);
+			g_print("%-50s ", left);
+		}
+		else
+		{
+			g_print("%s", name);
+		}
 	}
-	else
+
+	g_timer_start(func_timer);
+
+	for (gint i = 0; i < opt_warmup + opt_repetitions; i++)
 	{
-		g_print("%s", name);
+		result.elapsed_time = 0.0;
+		result.operations = 0;
+		result.bytes = 0;
+		result.allocations = -1;
+		result.memory = -1;
+
+		j_benchmark_record = (i >= opt_warmup);
+		(*benchmark_func)(&result);
+
+		if (i >= opt_warmup)
+		{
+			elapsed_times[i - opt_warmup] = result.elapsed_time;
+			elapsed_mean += result.elapsed_time / opt_repetitions;
+		}
 	}
 
-	g_timer_start(func_timer);
-	(*benchmark_func)(&result);
+	j_benchmark_record = FALSE;
 	elapsed = g_timer_elapsed(func_timer, NULL);
 
-	if (!opt_machine_readable)
+	/* The rates are based on the mean elapsed time of all repetitions. */
+	result.elapsed_time = elapsed_mean;
+
+	if (opt_json)
+	{
+		j_benchmark_print_json(name, &result, elapsed_times, elapsed);
+	}
+	else if (!opt_machine_readable)
 	{
 		g_print("%.3f seconds", result.elapsed_time);
 
+		if (opt_repetitions > 1)
+		{
+			gdouble min = G_MAXDOUBLE;
+			gdouble max = 0.0;
+
+			for (gint i = 0; i < opt_repetitions; i++)
+			{
+				min = MIN(min, elapsed_times[i]);
+				max = MAX(max, elapsed_times[i]);
+			}
+
+			g_print(" (%.3f-%.3f seconds)", min, max);
+		}
+
 		if (result.operations != 0)
 		{
 			g_print(" (%.0f/s)", (gdouble)result.operations / result.elapsed_time);
@@ -107,6 +382,24 @@ j_benchmark_run (gchar const* name, BenchmarkFunc benchmark_func)
 			g_print(" (%s/s)", size);
 		}
 
+		if (result.allocations >= 0 && result.operations != 0)
+		{
+			g_print(" (%.2f allocations/operation)", (gdouble)result.allocations / result.operations);
+		}
+
+		if (result.memory >= 0)
+		{
+			g_autofree gchar* size = NULL;
+
+			size = g_format_size(result.memory);
+			g_print(" (%s resident)", size);
+		}
+
+		if (j_benchmark_latency_count > 0)
+		{
+			g_print(" (p50 %.1f us, p99 %.1f us, p999 %.1f us)", j_benchmark_latency_percentile(50.0) * 1e6, j_benchmark_latency_percentile(99.0) * 1e6, j_benchmark_latency_percentile(99.9) * 1e6);
+		}
+
 		g_print(" [%.3f seconds]\n", elapsed);
 	}
 	else
@@ -145,14 +438,22 @@ main (int argc, char** argv)
 
 	GOptionEntry entries[] = {
 		{ "machine-readable", 0, 0, G_OPTION_ARG_NONE, &opt_machine_readable, "Produce machine-readable output", NULL },
+		{ "json", 0, 0, G_OPTION_ARG_NONE, &opt_json, "Produce JSON output", NULL },
 		{ "path", 'p', 0, G_OPTION_ARG_STRING, &opt_path, "Benchmark path to use", "/" },
 		{ "semantics", 's', 0, G_OPTION_ARG_STRING, &opt_semantics, "Semantics to use", NULL },
 		{ "template", 't', 0, G_OPTION_ARG_STRING, &opt_template, "Semantics template to use", "default" },
+		{ "warmup", 'w', 0, G_OPTION_ARG_INT, &opt_warmup, "Number of unmeasured runs per benchmark", "0" },
+		{ "repetitions", 'r', 0, G_OPTION_ARG_INT, &opt_repetitions, "Number of measured runs per benchmark", "1" },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
 	context = g_option_context_new(NULL);
 	g_option_context_add_main_entries(context, entries, NULL);
+	g_option_context_add_group(context, j_benchmark_threads_get_option_group());
+	g_option_context_add_group(context, benchmark_kv_ycsb_get_option_group());
+	g_option_context_add_group(context, benchmark_kv_scan_get_option_group());
+	g_option_context_add_group(context, benchmark_backend_get_option_group());
+	g_option_context_add_group(context, benchmark_fuse_get_option_group());
 
 	if (!g_option_context_parse(context, &argc, &argv, &error))
 	{
@@ -169,12 +470,23 @@ main (int argc, char** argv)
 
 	g_option_context_free(context);
 
+	if (opt_warmup < 0 || opt_repetitions < 1)
+	{
+		g_printerr("The number of warmup runs must not be negative and at least one repetition is required.\n");
+
+		return 1;
+	}
+
 	j_init();
 
 	j_benchmark_semantics = j_semantics_new_from_string(opt_template, opt_semantics);
 	j_benchmark_timer = g_timer_new();
 
-	if (opt_machine_readable)
+	if (opt_json)
+	{
+		g_print("[");
+	}
+	else if (opt_machine_readable)
 	{
 		g_print("name  elapsed  operations  bytes  total_elapsed\n");
 	}
@@ -185,18 +497,36 @@ main (int argc, char** argv)
 	benchmark_lock();
 	benchmark_memory_chunk();
 	benchmark_message();
+	benchmark_trace();
+
+	// Network
+	benchmark_network();
+
+	// Backends
+	benchmark_backend();
 
 	// KV client
 	benchmark_kv();
+	benchmark_kv_ycsb();
+	benchmark_kv_scan();
 
 	// Object client
 	benchmark_distributed_object();
+	benchmark_distributed_object_pattern();
 	benchmark_object();
 
 	// Item client
 	benchmark_collection();
 	benchmark_item();
 
+	// FUSE, only if requested
+	benchmark_fuse();
+
+	if (opt_json)
+	{
+		g_print("\n]\n");
+	}
+
 	g_timer_destroy(j_benchmark_timer);
 	j_semantics_unref(j_benchmark_semantics);
 
@@ -26,6 +26,16 @@ struct BenchmarkResult
 	gdouble elapsed_time;
 	guint64 operations;
 	guint64 bytes;
+
+	/**
+	 * The number of heap allocations, -1 if not measured.
+	 */
+	gint64 allocations;
+
+	/**
+	 * The growth of the resident memory in bytes, -1 if not measured.
+	 */
+	gint64 memory;
 };
 
 typedef struct BenchmarkResult BenchmarkResult;
@@ -33,26 +43,50 @@ typedef struct BenchmarkResult BenchmarkResult;
 #include <jsemantics.h>
 
 typedef void (*BenchmarkFunc) (BenchmarkResult*);
+typedef void (*BenchmarkThreadFunc) (guint, gpointer);
 
 JSemantics* j_benchmark_get_semantics (void);
+gchar const* j_benchmark_get_namespace (void);
 
 void j_benchmark_timer_start (void);
 gdouble j_benchmark_timer_elapsed (void);
+void j_benchmark_timer_lap (void);
+void j_benchmark_latency_add (gdouble);
 
+gboolean j_benchmark_is_selected (gchar const*);
 void j_benchmark_run (gchar const*, BenchmarkFunc);
 
+GOptionGroup* j_benchmark_threads_get_option_group (void);
+guint j_benchmark_get_threads (void);
+void j_benchmark_threads_execute (BenchmarkThreadFunc, gpointer);
+void j_benchmark_run_threads (gchar const*, BenchmarkFunc);
+
+void benchmark_backend (void);
+GOptionGroup* benchmark_backend_get_option_group (void);
+
 void benchmark_background_operation (void);
 void benchmark_cache (void);
 void benchmark_lock (void);
 void benchmark_memory_chunk (void);
 void benchmark_message (void);
+void benchmark_trace (void);
+
+void benchmark_network (void);
 
 void benchmark_kv (void);
+void benchmark_kv_ycsb (void);
+GOptionGroup* benchmark_kv_ycsb_get_option_group (void);
+void benchmark_kv_scan (void);
+GOptionGroup* benchmark_kv_scan_get_option_group (void);
 
 void benchmark_distributed_object (void);
+void benchmark_distributed_object_pattern (void);
 void benchmark_object (void);
 
 void benchmark_collection (void);
 void benchmark_item (void);
 
+void benchmark_fuse (void);
+GOptionGroup* benchmark_fuse_get_option_group (void);
+
 #endif
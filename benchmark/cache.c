@@ -55,8 +55,56 @@ benchmark_cache_get (BenchmarkResult* result)
 	result->operations = n;
 }
 
+struct BenchmarkCacheThreads
+{
+	JCache* cache;
+	guint n;
+};
+
+typedef struct BenchmarkCacheThreads BenchmarkCacheThreads;
+
+static
+void
+benchmark_cache_get_thread (guint thread, gpointer data)
+{
+	BenchmarkCacheThreads* cache_threads = data;
+
+	(void)thread;
+
+	for (guint i = 0; i < cache_threads->n; i++)
+	{
+		j_cache_get(cache_threads->cache, 1);
+	}
+}
+
+/**
+ * All threads share one cache.
+ */
+static
+void
+benchmark_cache_get_threads (BenchmarkResult* result)
+{
+	guint const n = 10 * 1024 * 1024;
+
+	BenchmarkCacheThreads cache_threads;
+	gdouble elapsed;
+
+	cache_threads.cache = j_cache_new(n);
+	cache_threads.n = n / j_benchmark_get_threads();
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_cache_get_thread, &cache_threads);
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_cache_free(cache_threads.cache);
+
+	result->elapsed_time = elapsed;
+	result->operations = cache_threads.n * j_benchmark_get_threads();
+}
+
 void
 benchmark_cache (void)
 {
 	j_benchmark_run("/cache", benchmark_cache_get);
+	j_benchmark_run_threads("/cache/threads", benchmark_cache_get_threads);
 }
@@ -0,0 +1,421 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Benchmarks for a mounted julea-fuse, which go through the kernel's FUSE layer.
+ * They mirror the item benchmarks, so the overhead of FUSE can be seen by comparing them to the native API.
+ * The benchmarks only run if a mount point is given using --fuse-mountpoint, see scripts/benchmark-fuse.sh.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "benchmark.h"
+
+static gchar* opt_fuse_mountpoint = NULL;
+static gint opt_fuse_block_size = 1024 * 1024;
+static gint opt_fuse_blocks = 64;
+static gint opt_fuse_files = 10000;
+
+/**
+ * The directory the benchmarks work in.
+ */
+static gchar* benchmark_fuse_directory = NULL;
+
+static
+gchar*
+benchmark_fuse_path (guint i)
+{
+	return g_strdup_printf("%s/benchmark-%u", benchmark_fuse_directory, i);
+}
+
+/**
+ * Creates files without writing to them.
+ */
+static
+void
+benchmark_fuse_create_files (guint n)
+{
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* path = NULL;
+		gint fd;
+
+		path = benchmark_fuse_path(i);
+		fd = open(path, O_CREAT | O_WRONLY, 0600);
+		g_assert(fd >= 0);
+		close(fd);
+	}
+}
+
+static
+void
+benchmark_fuse_unlink_files (guint n)
+{
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* path = NULL;
+
+		path = benchmark_fuse_path(i);
+		unlink(path);
+	}
+}
+
+static
+void
+benchmark_fuse_create (BenchmarkResult* result)
+{
+	guint const n = 1000;
+
+	gdouble elapsed;
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* path = NULL;
+		gint fd;
+
+		path = benchmark_fuse_path(i);
+		fd = open(path, O_CREAT | O_WRONLY, 0600);
+		g_assert(fd >= 0);
+		close(fd);
+
+		j_benchmark_timer_lap();
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	benchmark_fuse_unlink_files(n);
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+}
+
+static
+void
+benchmark_fuse_stat (BenchmarkResult* result)
+{
+	guint const n = 1000;
+
+	gdouble elapsed;
+
+	benchmark_fuse_create_files(n);
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* path = NULL;
+		struct stat buf;
+		gint ret;
+
+		path = benchmark_fuse_path(i);
+		ret = stat(path, &buf);
+		g_assert(ret == 0);
+
+		j_benchmark_timer_lap();
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	benchmark_fuse_unlink_files(n);
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+}
+
+static
+void
+benchmark_fuse_unlink (BenchmarkResult* result)
+{
+	guint const n = 1000;
+
+	gdouble elapsed;
+
+	benchmark_fuse_create_files(n);
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autofree gchar* path = NULL;
+		gint ret;
+
+		path = benchmark_fuse_path(i);
+		ret = unlink(path);
+		g_assert(ret == 0);
+
+		j_benchmark_timer_lap();
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+}
+
+/**
+ * Lists a large directory, additionally getting every entry's attributes like ls -l does.
+ */
+static
+void
+_benchmark_fuse_list (BenchmarkResult* result, gboolean attributes)
+{
+	guint const n = opt_fuse_files;
+
+	DIR* dir;
+	struct dirent* entry;
+	gdouble elapsed;
+	guint count = 0;
+
+	benchmark_fuse_create_files(n);
+
+	j_benchmark_timer_start();
+
+	dir = opendir(benchmark_fuse_directory);
+	g_assert(dir != NULL);
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+		{
+			continue;
+		}
+
+		if (attributes)
+		{
+			struct stat buf;
+
+			fstatat(dirfd(dir), entry->d_name, &buf, AT_SYMLINK_NOFOLLOW);
+		}
+
+		count++;
+	}
+
+	closedir(dir);
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	g_assert(count == n);
+
+	benchmark_fuse_unlink_files(n);
+
+	result->elapsed_time = elapsed;
+	result->operations = count;
+}
+
+static
+void
+benchmark_fuse_readdir (BenchmarkResult* result)
+{
+	_benchmark_fuse_list(result, FALSE);
+}
+
+static
+void
+benchmark_fuse_ls (BenchmarkResult* result)
+{
+	_benchmark_fuse_list(result, TRUE);
+}
+
+/**
+ * Accesses a file of opt_fuse_blocks blocks, either sequentially or in a random order.
+ */
+static
+void
+_benchmark_fuse_access (BenchmarkResult* result, gboolean write, gboolean shuffle)
+{
+	guint const n = opt_fuse_blocks;
+	gsize const block_size = opt_fuse_block_size;
+
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* buf = NULL;
+	g_autofree guint* order = NULL;
+	g_autoptr(GRand) rng = NULL;
+	gdouble elapsed;
+	gint fd;
+
+	path = benchmark_fuse_path(0);
+	buf = g_malloc0(block_size);
+	order = g_new(guint, n);
+	rng = g_rand_new_with_seed(42);
+
+	for (guint i = 0; i < n; i++)
+	{
+		order[i] = i;
+	}
+
+	if (shuffle)
+	{
+		for (guint i = n - 1; i > 0; i--)
+		{
+			guint j = g_rand_int_range(rng, 0, i + 1);
+			guint tmp = order[i];
+
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+	}
+
+	fd = open(path, O_CREAT | O_RDWR, 0600);
+	g_assert(fd >= 0);
+
+	/* Reads need existing data. */
+	if (!write)
+	{
+		for (guint i = 0; i < n; i++)
+		{
+			gssize ret;
+
+			ret = pwrite(fd, buf, block_size, i * block_size);
+			g_assert(ret == (gssize)block_size);
+		}
+
+		close(fd);
+		fd = open(path, O_RDONLY);
+		g_assert(fd >= 0);
+	}
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		gssize ret;
+
+		if (write)
+		{
+			ret = pwrite(fd, buf, block_size, order[i] * block_size);
+		}
+		else
+		{
+			ret = pread(fd, buf, block_size, order[i] * block_size);
+		}
+
+		g_assert(ret == (gssize)block_size);
+
+		j_benchmark_timer_lap();
+	}
+
+	/* Closing flushes the written data. */
+	close(fd);
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	unlink(path);
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+	result->bytes = n * block_size;
+}
+
+static
+void
+benchmark_fuse_write (BenchmarkResult* result)
+{
+	_benchmark_fuse_access(result, TRUE, FALSE);
+}
+
+static
+void
+benchmark_fuse_read (BenchmarkResult* result)
+{
+	_benchmark_fuse_access(result, FALSE, FALSE);
+}
+
+static
+void
+benchmark_fuse_write_random (BenchmarkResult* result)
+{
+	_benchmark_fuse_access(result, TRUE, TRUE);
+}
+
+static
+void
+benchmark_fuse_read_random (BenchmarkResult* result)
+{
+	_benchmark_fuse_access(result, FALSE, TRUE);
+}
+
+GOptionGroup*
+benchmark_fuse_get_option_group (void)
+{
+	GOptionGroup* group;
+
+	static GOptionEntry entries[] = {
+		{ "fuse-mountpoint", 0, 0, G_OPTION_ARG_STRING, &opt_fuse_mountpoint, "Mount point of julea-fuse to benchmark", NULL },
+		{ "fuse-block-size", 0, 0, G_OPTION_ARG_INT, &opt_fuse_block_size, "Block size for reads and writes", "1048576" },
+		{ "fuse-blocks", 0, 0, G_OPTION_ARG_INT, &opt_fuse_blocks, "Number of blocks per file", "64" },
+		{ "fuse-files", 0, 0, G_OPTION_ARG_INT, &opt_fuse_files, "Number of files in listed directories", "10000" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	group = g_option_group_new("fuse", "FUSE benchmark options", "Show FUSE benchmark options", NULL, NULL);
+	g_option_group_add_entries(group, entries);
+
+	return group;
+}
+
+void
+benchmark_fuse (void)
+{
+	if (opt_fuse_mountpoint == NULL)
+	{
+		return;
+	}
+
+	if (opt_fuse_block_size <= 0 || opt_fuse_blocks <= 0 || opt_fuse_files <= 0)
+	{
+		g_warning("Invalid FUSE benchmark options, skipping FUSE benchmarks.");
+		return;
+	}
+
+	benchmark_fuse_directory = g_build_filename(opt_fuse_mountpoint, j_benchmark_get_namespace(), NULL);
+
+	if (g_mkdir(benchmark_fuse_directory, 0700) != 0)
+	{
+		g_warning("Could not create %s, skipping FUSE benchmarks.", benchmark_fuse_directory);
+		goto end;
+	}
+
+	j_benchmark_run("/fuse/create", benchmark_fuse_create);
+	j_benchmark_run("/fuse/stat", benchmark_fuse_stat);
+	j_benchmark_run("/fuse/unlink", benchmark_fuse_unlink);
+	j_benchmark_run("/fuse/readdir", benchmark_fuse_readdir);
+	j_benchmark_run("/fuse/ls-l", benchmark_fuse_ls);
+	j_benchmark_run("/fuse/write", benchmark_fuse_write);
+	j_benchmark_run("/fuse/read", benchmark_fuse_read);
+	j_benchmark_run("/fuse/write-random", benchmark_fuse_write_random);
+	j_benchmark_run("/fuse/read-random", benchmark_fuse_read_random);
+
+	g_rmdir(benchmark_fuse_directory);
+
+end:
+	g_clear_pointer(&benchmark_fuse_directory, g_free);
+}
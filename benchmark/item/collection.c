@@ -47,7 +47,7 @@ _benchmark_collection_create (BenchmarkResult* result, gboolean use_batch)
 		g_autoptr(JCollection) collection = NULL;
 		g_autofree gchar* name = NULL;
 
-		name = g_strdup_printf("benchmark-%d", i);
+		name = g_strdup_printf("%s-%d", j_benchmark_get_namespace(), i);
 		collection = j_collection_create(name, batch);
 
 		j_collection_delete(collection, delete_batch);
@@ -55,6 +55,7 @@ _benchmark_collection_create (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -103,7 +104,7 @@ _benchmark_collection_delete (BenchmarkResult* result, gboolean use_batch)
 		g_autoptr(JCollection) collection = NULL;
 		g_autofree gchar* name = NULL;
 
-		name = g_strdup_printf("benchmark-%d", i);
+		name = g_strdup_printf("%s-%d", j_benchmark_get_namespace(), i);
 		collection = j_collection_create(name, batch);
 	}
 
@@ -116,7 +117,7 @@ _benchmark_collection_delete (BenchmarkResult* result, gboolean use_batch)
 		g_autoptr(JCollection) collection = NULL;
 		g_autofree gchar* name = NULL;
 
-		name = g_strdup_printf("benchmark-%d", i);
+		name = g_strdup_printf("%s-%d", j_benchmark_get_namespace(), i);
 		j_collection_get(&collection, name, batch);
 		j_batch_execute(batch);
 
@@ -125,6 +126,7 @@ _benchmark_collection_delete (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -175,7 +177,7 @@ benchmark_collection_delete_batch_without_get (BenchmarkResult* result)
 		g_autoptr(JCollection) collection = NULL;
 		g_autofree gchar* name = NULL;
 
-		name = g_strdup_printf("benchmark-%d", i);
+		name = g_strdup_printf("%s-%d", j_benchmark_get_namespace(), i);
 		collection = j_collection_create(name, batch);
 
 		j_collection_delete(collection, delete_batch);
@@ -215,7 +217,7 @@ _benchmark_collection_unordered_create_delete (BenchmarkResult* result, gboolean
 		g_autoptr(JCollection) collection = NULL;
 		g_autofree gchar* name = NULL;
 
-		name = g_strdup_printf("benchmark-%d", i);
+		name = g_strdup_printf("%s-%d", j_benchmark_get_namespace(), i);
 		collection = j_collection_create(name, batch);
 
 		j_collection_delete(collection, batch);
@@ -223,6 +225,7 @@ _benchmark_collection_unordered_create_delete (BenchmarkResult* result, gboolean
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
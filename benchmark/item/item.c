@@ -43,7 +43,7 @@ _benchmark_item_create (BenchmarkResult* result, gboolean use_batch)
 	delete_batch = j_batch_new(semantics);
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	j_batch_execute(batch);
 
 	j_benchmark_timer_start();
@@ -61,6 +61,7 @@ _benchmark_item_create (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -108,7 +109,7 @@ _benchmark_item_delete (BenchmarkResult* result, gboolean use_batch)
 	get_batch = j_batch_new(semantics);
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	j_batch_execute(batch);
 
 	for (guint i = 0; i < n; i++)
@@ -138,6 +139,7 @@ _benchmark_item_delete (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -185,7 +187,7 @@ benchmark_item_delete_batch_without_get (BenchmarkResult* result)
 	delete_batch = j_batch_new(semantics);
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	j_batch_execute(batch);
 
 	for (guint i = 0; i < n; i++)
@@ -233,7 +235,7 @@ _benchmark_item_get_status (BenchmarkResult* result, gboolean use_batch)
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	item = j_item_create(collection, "benchmark", NULL, batch);
 	j_item_write(item, dummy, 1, 0, &nb, batch);
 
@@ -248,6 +250,7 @@ _benchmark_item_get_status (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -299,7 +302,7 @@ _benchmark_item_read (BenchmarkResult* result, gboolean use_batch, guint block_s
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	item = j_item_create(collection, "benchmark", NULL, batch);
 
 	for (guint i = 0; i < n; i++)
@@ -319,6 +322,7 @@ _benchmark_item_read (BenchmarkResult* result, gboolean use_batch, guint block_s
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 
 			g_assert_cmpuint(nb, ==, block_size);
 		}
@@ -375,7 +379,7 @@ _benchmark_item_write (BenchmarkResult* result, gboolean use_batch, guint block_
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	item = j_item_create(collection, "benchmark", NULL, batch);
 	j_batch_execute(batch);
 
@@ -388,6 +392,7 @@ _benchmark_item_write (BenchmarkResult* result, gboolean use_batch, guint block_
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 
 			g_assert_cmpuint(nb, ==, block_size);
 		}
@@ -439,7 +444,7 @@ _benchmark_item_unordered_create_delete (BenchmarkResult* result, gboolean use_b
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	collection = j_collection_create("benchmark", batch);
+	collection = j_collection_create(j_benchmark_get_namespace(), batch);
 	j_batch_execute(batch);
 
 	j_benchmark_timer_start();
@@ -457,6 +462,7 @@ _benchmark_item_unordered_create_delete (BenchmarkResult* result, gboolean use_b
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -56,7 +56,7 @@ _benchmark_kv_put (BenchmarkResult* result, gboolean use_batch)
 		bson_init(empty);
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_kv_new("benchmark", name);
+		object = j_kv_new(j_benchmark_get_namespace(), name);
 		j_kv_put(object, empty, batch);
 
 		j_kv_delete(object, delete_batch);
@@ -64,6 +64,7 @@ _benchmark_kv_put (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -119,7 +120,7 @@ _benchmark_kv_delete (BenchmarkResult* result, gboolean use_batch)
 		bson_init(empty);
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_kv_new("benchmark", name);
+		object = j_kv_new(j_benchmark_get_namespace(), name);
 		j_kv_put(object, empty, batch);
 	}
 
@@ -133,13 +134,14 @@ _benchmark_kv_delete (BenchmarkResult* result, gboolean use_batch)
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_kv_new("benchmark", name);
+		object = j_kv_new(j_benchmark_get_namespace(), name);
 
 		j_kv_delete(object, batch);
 
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -197,7 +199,7 @@ _benchmark_kv_unordered_put_delete (BenchmarkResult* result, gboolean use_batch)
 		bson_init(empty);
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_kv_new("benchmark", name);
+		object = j_kv_new(j_benchmark_get_namespace(), name);
 		j_kv_put(object, empty, batch);
 
 		j_kv_delete(object, batch);
@@ -205,6 +207,7 @@ _benchmark_kv_unordered_put_delete (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -0,0 +1,533 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Scaling of prefix scans with the number of keys.
+ *
+ * A namespace is filled with 10^3 keys and grown by a factor of ten up to --scan-keys keys (untimed).
+ * At every size, the whole namespace and a prefix matching 1% of the keys are scanned.
+ * The latency is the time to the first result, the rate is the number of keys returned per second.
+ * The resident memory's growth during a scan is reported, too.
+ *
+ * The backends given by --scan-backends are loaded into the benchmark process, one after the other,
+ * so their memory use is what a server would need for the scan.
+ * Afterwards, the same is done using JKVIterator and JItemIterator, whose memory use is the client's.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <string.h>
+#include <unistd.h>
+
+#include <bson.h>
+
+#include <julea.h>
+#include <julea-kv.h>
+#include <julea-item.h>
+
+#include "benchmark.h"
+
+static gint opt_scan_keys = 100000;
+static gchar* opt_scan_backends = NULL;
+static gchar* opt_scan_path = NULL;
+
+/**
+ * The number of keys put per batch while filling.
+ */
+#define SCAN_BATCH 10000
+
+/**
+ * How many keys are returned between two samples of the resident memory.
+ */
+#define SCAN_MEMORY_INTERVAL 65536
+
+/**
+ * The number of distinct prefixes, so that a prefix scan returns 1% of the keys.
+ */
+#define SCAN_PREFIXES 100
+
+static JBackend* scan_backend = NULL;
+static gchar* scan_namespace = NULL;
+static JCollection* scan_collection = NULL;
+
+static
+gchar*
+scan_key (guint i)
+{
+	return g_strdup_printf("scan-%02u-%08u", i % SCAN_PREFIXES, i);
+}
+
+/**
+ * Returns the resident memory of the benchmark process in bytes, -1 if it is unknown.
+ */
+static
+gint64
+scan_memory (void)
+{
+	g_autofree gchar* contents = NULL;
+	gchar* resident;
+	glong page_size;
+
+	if (!g_file_get_contents("/proc/self/statm", &contents, NULL, NULL))
+	{
+		return -1;
+	}
+
+	/* The first field is the total size, the second one the resident size, both in pages. */
+	if ((resident = strchr(contents, ' ')) == NULL || (page_size = sysconf(_SC_PAGESIZE)) <= 0)
+	{
+		return -1;
+	}
+
+	return g_ascii_strtoll(resident + 1, NULL, 10) * page_size;
+}
+
+/**
+ * Records the state of a scan after another key has been returned.
+ */
+static
+void
+scan_count (guint64* count, gint64 memory_base, gint64* memory_peak)
+{
+	if (*count == 0)
+	{
+		j_benchmark_latency_add(j_benchmark_timer_elapsed());
+	}
+
+	(*count)++;
+
+	if (memory_base >= 0 && *count % SCAN_MEMORY_INTERVAL == 0)
+	{
+		*memory_peak = MAX(*memory_peak, scan_memory());
+	}
+}
+
+static
+void
+scan_result (BenchmarkResult* result, guint64 count, gint64 memory_base, gint64 memory_peak)
+{
+	result->elapsed_time = j_benchmark_timer_elapsed();
+	result->operations = count;
+
+	if (memory_base >= 0)
+	{
+		result->memory = MAX(memory_peak, scan_memory()) - memory_base;
+	}
+}
+
+static
+void
+scan_backend_fill (guint from, guint to)
+{
+	bson_t value[1];
+
+	bson_init(value);
+	BSON_APPEND_INT32(value, "value", 0);
+
+	for (guint i = from; i < to; i += SCAN_BATCH)
+	{
+		gpointer batch;
+
+		if (!j_backend_kv_batch_start(scan_backend, scan_namespace, J_SEMANTICS_SAFETY_NETWORK, &batch))
+		{
+			break;
+		}
+
+		for (guint j = i; j < MIN(i + SCAN_BATCH, to); j++)
+		{
+			g_autofree gchar* key = NULL;
+
+			key = scan_key(j);
+			j_backend_kv_put(scan_backend, batch, key, value);
+		}
+
+		j_backend_kv_batch_execute(scan_backend, batch);
+	}
+
+	bson_destroy(value);
+}
+
+static
+void
+scan_backend_clear (guint n)
+{
+	for (guint i = 0; i < n; i += SCAN_BATCH)
+	{
+		gpointer batch;
+
+		if (!j_backend_kv_batch_start(scan_backend, scan_namespace, J_SEMANTICS_SAFETY_NETWORK, &batch))
+		{
+			break;
+		}
+
+		for (guint j = i; j < MIN(i + SCAN_BATCH, n); j++)
+		{
+			g_autofree gchar* key = NULL;
+
+			key = scan_key(j);
+			j_backend_kv_delete(scan_backend, batch, key);
+		}
+
+		j_backend_kv_batch_execute(scan_backend, batch);
+	}
+}
+
+static
+void
+_benchmark_scan_backend (BenchmarkResult* result, gboolean use_prefix)
+{
+	gpointer iterator;
+	gboolean ret;
+	guint64 count = 0;
+	gint64 memory_base;
+	gint64 memory_peak;
+
+	memory_base = scan_memory();
+	memory_peak = memory_base;
+
+	j_benchmark_timer_start();
+
+	if (use_prefix)
+	{
+		ret = j_backend_kv_get_by_prefix(scan_backend, scan_namespace, "scan-42-", &iterator);
+	}
+	else
+	{
+		ret = j_backend_kv_get_all(scan_backend, scan_namespace, &iterator);
+	}
+
+	if (ret)
+	{
+		gchar const* key;
+		bson_t value[1];
+
+		while (j_backend_kv_iterate(scan_backend, iterator, &key, value))
+		{
+			bson_destroy(value);
+			scan_count(&count, memory_base, &memory_peak);
+		}
+	}
+
+	scan_result(result, count, memory_base, memory_peak);
+}
+
+static
+void
+benchmark_scan_backend_all (BenchmarkResult* result)
+{
+	_benchmark_scan_backend(result, FALSE);
+}
+
+static
+void
+benchmark_scan_backend_prefix (BenchmarkResult* result)
+{
+	_benchmark_scan_backend(result, TRUE);
+}
+
+static
+void
+scan_kv_fill (guint from, guint to)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = from; i < to; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* key = NULL;
+		bson_t* value;
+
+		key = scan_key(i);
+		kv = j_kv_new(scan_namespace, key);
+
+		/* Values are freed using g_slice_free(). */
+		value = g_slice_new(bson_t);
+		bson_init(value);
+		BSON_APPEND_INT32(value, "value", 0);
+
+		j_kv_put(kv, value, batch);
+
+		if ((i + 1) % SCAN_BATCH == 0)
+		{
+			j_batch_execute(batch);
+		}
+	}
+
+	j_batch_execute(batch);
+}
+
+static
+void
+_benchmark_scan_kv (BenchmarkResult* result, gboolean use_prefix)
+{
+	JKVIterator* iterator;
+	guint64 count = 0;
+	gint64 memory_base;
+	gint64 memory_peak;
+
+	memory_base = scan_memory();
+	memory_peak = memory_base;
+
+	j_benchmark_timer_start();
+
+	iterator = j_kv_iterator_new_for_prefix(scan_namespace, (use_prefix) ? "scan-42-" : NULL);
+
+	while (j_kv_iterator_next(iterator))
+	{
+		scan_count(&count, memory_base, &memory_peak);
+	}
+
+	scan_result(result, count, memory_base, memory_peak);
+
+	j_kv_iterator_free(iterator);
+}
+
+static
+void
+benchmark_scan_kv_all (BenchmarkResult* result)
+{
+	_benchmark_scan_kv(result, FALSE);
+}
+
+static
+void
+benchmark_scan_kv_prefix (BenchmarkResult* result)
+{
+	_benchmark_scan_kv(result, TRUE);
+}
+
+static
+void
+scan_item_fill (guint from, guint to)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = from; i < to; i++)
+	{
+		g_autoptr(JItem) item = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = scan_key(i);
+		item = j_item_create(scan_collection, name, NULL, batch);
+
+		if ((i + 1) % SCAN_BATCH == 0)
+		{
+			j_batch_execute(batch);
+		}
+	}
+
+	j_batch_execute(batch);
+}
+
+/**
+ * Items are stored with their collection's name as the key prefix, so iterating over a collection is a prefix scan.
+ */
+static
+void
+benchmark_scan_item (BenchmarkResult* result)
+{
+	JItemIterator* iterator;
+	guint64 count = 0;
+	gint64 memory_base;
+	gint64 memory_peak;
+
+	memory_base = scan_memory();
+	memory_peak = memory_base;
+
+	j_benchmark_timer_start();
+
+	iterator = j_item_iterator_new(scan_collection);
+
+	while (j_item_iterator_next(iterator))
+	{
+		g_autoptr(JItem) item = NULL;
+
+		item = j_item_iterator_get(iterator);
+		scan_count(&count, memory_base, &memory_peak);
+	}
+
+	scan_result(result, count, memory_base, memory_peak);
+
+	j_item_iterator_free(iterator);
+}
+
+/**
+ * Runs a benchmark for every size, after growing the data to that size using fill_func.
+ *
+ * \return The number of keys that have been filled in.
+ */
+static
+guint
+scan_run_sizes (gchar const* prefix, void (*fill_func) (guint, guint), BenchmarkFunc all_func, BenchmarkFunc prefix_func)
+{
+	guint filled = 0;
+
+	/* Filling takes much longer than scanning, so skip it if none of the benchmarks would be run. */
+	if (!j_benchmark_is_selected(prefix))
+	{
+		return 0;
+	}
+
+	for (guint n = 1000; n <= (guint)opt_scan_keys; n *= 10)
+	{
+		g_autofree gchar* name = NULL;
+
+		(*fill_func)(filled, n);
+		filled = n;
+
+		name = g_strdup_printf("%s/%u%s", prefix, n, (prefix_func != NULL) ? "/all" : "");
+		j_benchmark_run(name, all_func);
+
+		if (prefix_func != NULL)
+		{
+			g_free(name);
+			name = g_strdup_printf("%s/%u/prefix", prefix, n);
+			j_benchmark_run(name, prefix_func);
+		}
+
+		if (n > G_MAXUINT / 10)
+		{
+			break;
+		}
+	}
+
+	return filled;
+}
+
+static
+void
+benchmark_scan_backends (void)
+{
+	g_auto(GStrv) backends = NULL;
+
+	backends = g_strsplit(opt_scan_backends, ",", 0);
+
+	for (guint i = 0; backends[i] != NULL; i++)
+	{
+		GModule* module = NULL;
+		g_autofree gchar* path = NULL;
+		g_autofree gchar* prefix = NULL;
+		guint filled;
+
+		path = g_build_filename(opt_scan_path, backends[i], NULL);
+
+		if (j_backend_load_server(backends[i], "server", J_BACKEND_TYPE_KV, &module, &scan_backend)
+		    && scan_backend != NULL
+		    && j_backend_kv_init(scan_backend, path))
+		{
+			prefix = g_strdup_printf("/backend/kv/scan/%s", backends[i]);
+			filled = scan_run_sizes(prefix, scan_backend_fill, benchmark_scan_backend_all, benchmark_scan_backend_prefix);
+			scan_backend_clear(filled);
+
+			j_backend_kv_fini(scan_backend);
+		}
+		else
+		{
+			g_warning("Could not load key-value backend %s, skipping its scan benchmarks.", backends[i]);
+		}
+
+		if (module != NULL)
+		{
+			g_module_close(module);
+		}
+
+		scan_backend = NULL;
+	}
+}
+
+GOptionGroup*
+benchmark_kv_scan_get_option_group (void)
+{
+	GOptionGroup* group;
+
+	static GOptionEntry entries[] = {
+		{ "scan-keys", 0, 0, G_OPTION_ARG_INT, &opt_scan_keys, "Maximum number of keys to scan", "100000" },
+		{ "scan-backends", 0, 0, G_OPTION_ARG_STRING, &opt_scan_backends, "Comma-separated key-value backends to scan directly", "lmdb,leveldb" },
+		{ "scan-path", 0, 0, G_OPTION_ARG_STRING, &opt_scan_path, "Path for the key-value backends, each one uses a subdirectory", "/tmp/julea-benchmark/scan" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	group = g_option_group_new("scan", "Scan benchmark options", "Show scan benchmark options", NULL, NULL);
+	g_option_group_add_entries(group, entries);
+
+	return group;
+}
+
+void
+benchmark_kv_scan (void)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+
+	if (opt_scan_keys < 1000)
+	{
+		g_warning("At least 1000 keys are required, skipping scan benchmarks.");
+		goto end;
+	}
+
+	scan_namespace = g_strdup_printf("%s-scan", j_benchmark_get_namespace());
+
+	if (opt_scan_backends != NULL)
+	{
+		if (opt_scan_path == NULL)
+		{
+			opt_scan_path = g_strdup("/tmp/julea-benchmark/scan");
+		}
+
+		benchmark_scan_backends();
+	}
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	if (scan_run_sizes("/kv/scan", scan_kv_fill, benchmark_scan_kv_all, benchmark_scan_kv_prefix) > 0)
+	{
+		j_kv_delete_by_prefix(scan_namespace, "scan-", batch);
+		j_batch_execute(batch);
+	}
+
+	if (j_benchmark_is_selected("/item/scan"))
+	{
+		scan_collection = j_collection_create(scan_namespace, batch);
+		j_batch_execute(batch);
+
+		scan_run_sizes("/item/scan", scan_item_fill, benchmark_scan_item, NULL);
+		j_collection_delete_recursive(scan_collection, batch);
+		j_batch_execute(batch);
+
+		g_clear_pointer(&scan_collection, j_collection_unref);
+	}
+	g_clear_pointer(&scan_namespace, g_free);
+
+end:
+	g_free(opt_scan_backends);
+	g_free(opt_scan_path);
+}
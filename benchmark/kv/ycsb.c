@@ -0,0 +1,529 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Mixed key-value workloads equivalent to YCSB's core workloads A to F.
+ *
+ * Every workload first loads --ycsb-records records (untimed) and then executes --ycsb-operations operations,
+ * one at a time, using --ycsb-threads threads.
+ * Keys are chosen using YCSB's scrambled Zipfian distribution (theta 0.99) unless another distribution is requested;
+ * workload D always prefers recently inserted records.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <julea.h>
+#include <julea-kv.h>
+
+#include "benchmark.h"
+
+static gint opt_ycsb_records = 10000;
+static gint opt_ycsb_operations = 100000;
+static gint opt_ycsb_value_size = 1000;
+static gint opt_ycsb_threads = 1;
+static gint opt_ycsb_scan_length = 100;
+static gchar* opt_ycsb_distribution = NULL;
+
+enum YCSBDistribution
+{
+	YCSB_DISTRIBUTION_UNIFORM,
+	YCSB_DISTRIBUTION_ZIPFIAN,
+	YCSB_DISTRIBUTION_LATEST
+};
+
+typedef enum YCSBDistribution YCSBDistribution;
+
+/**
+ * A workload, the proportions are given in percent.
+ */
+struct YCSBWorkload
+{
+	guint read;
+	guint update;
+	guint insert;
+	guint scan;
+	guint read_modify_write;
+
+	YCSBDistribution distribution;
+};
+
+typedef struct YCSBWorkload YCSBWorkload;
+
+/**
+ * The Zipfian constant used by YCSB.
+ */
+#define YCSB_ZIPFIAN_THETA 0.99
+
+/**
+ * State shared by all threads of a run.
+ */
+struct YCSBRun
+{
+	YCSBWorkload const* workload;
+	YCSBDistribution distribution;
+
+	gchar* namespace;
+	gchar* value;
+
+	/**
+	 * The number of records, grows with inserts.
+	 */
+	gsize records;
+
+	/**
+	 * Precomputed constants of the Zipfian distribution over the loaded records.
+	 */
+	struct
+	{
+		guint64 items;
+		gdouble zetan;
+		gdouble alpha;
+		gdouble eta;
+	}
+	zipfian;
+};
+
+typedef struct YCSBRun YCSBRun;
+
+struct YCSBThread
+{
+	YCSBRun* run;
+	guint operations;
+	guint32 seed;
+};
+
+typedef struct YCSBThread YCSBThread;
+
+/**
+ * Hashes a record number using FNV-1a, so that popular records are spread over the key space.
+ */
+static
+guint64
+ycsb_hash (guint64 value)
+{
+	guint64 hash = G_GUINT64_CONSTANT(0xcbf29ce484222325);
+
+	for (guint i = 0; i < sizeof(value); i++)
+	{
+		hash ^= value & 0xff;
+		hash *= G_GUINT64_CONSTANT(0x100000001b3);
+		value >>= 8;
+	}
+
+	return hash;
+}
+
+static
+gchar*
+ycsb_key (guint64 record)
+{
+	/* Fixed-width keys sort like the hashes they contain. */
+	return g_strdup_printf("user%020" G_GUINT64_FORMAT, ycsb_hash(record));
+}
+
+static
+bson_t*
+ycsb_value (YCSBRun const* run)
+{
+	bson_t* value;
+
+	/* Values are freed using g_slice_free(). */
+	value = g_slice_new(bson_t);
+	bson_init(value);
+	bson_append_binary(value, "field0", -1, BSON_SUBTYPE_BINARY, (guint8 const*)run->value, opt_ycsb_value_size);
+
+	return value;
+}
+
+static
+gdouble
+ycsb_zeta (guint64 n, gdouble theta)
+{
+	gdouble sum = 0.0;
+
+	for (guint64 i = 1; i <= n; i++)
+	{
+		sum += 1.0 / pow(i, theta);
+	}
+
+	return sum;
+}
+
+static
+void
+ycsb_zipfian_init (YCSBRun* run, guint64 items)
+{
+	gdouble zeta2;
+
+	run->zipfian.items = items;
+	run->zipfian.zetan = ycsb_zeta(items, YCSB_ZIPFIAN_THETA);
+	run->zipfian.alpha = 1.0 / (1.0 - YCSB_ZIPFIAN_THETA);
+
+	zeta2 = ycsb_zeta(2, YCSB_ZIPFIAN_THETA);
+	run->zipfian.eta = (1.0 - pow(2.0 / items, 1.0 - YCSB_ZIPFIAN_THETA)) / (1.0 - zeta2 / run->zipfian.zetan);
+}
+
+/**
+ * Returns a Zipfian-distributed rank, 0 being the most popular one (Gray et al., Quickly Generating Billion-Record Synthetic Databases).
+ */
+static
+guint64
+ycsb_zipfian_next (YCSBRun const* run, GRand* rand)
+{
+	gdouble u;
+	gdouble uz;
+	guint64 rank;
+
+	u = g_rand_double(rand);
+	uz = u * run->zipfian.zetan;
+
+	if (uz < 1.0)
+	{
+		return 0;
+	}
+
+	if (uz < 1.0 + pow(0.5, YCSB_ZIPFIAN_THETA))
+	{
+		return 1;
+	}
+
+	rank = run->zipfian.items * pow(run->zipfian.eta * u - run->zipfian.eta + 1.0, run->zipfian.alpha);
+
+	return MIN(rank, run->zipfian.items - 1);
+}
+
+/**
+ * Chooses an existing record.
+ */
+static
+guint64
+ycsb_next_record (YCSBRun* run, GRand* rand)
+{
+	guint64 records;
+	guint64 rank;
+
+	records = (gsize)g_atomic_pointer_get(&(run->records));
+
+	switch (run->distribution)
+	{
+		case YCSB_DISTRIBUTION_UNIFORM:
+			return (guint64)(g_rand_double(rand) * records);
+		case YCSB_DISTRIBUTION_ZIPFIAN:
+			return ycsb_hash(ycsb_zipfian_next(run, rand)) % records;
+		case YCSB_DISTRIBUTION_LATEST:
+			rank = ycsb_zipfian_next(run, rand);
+
+			return (rank < records) ? records - 1 - rank : 0;
+		default:
+			g_assert_not_reached();
+	}
+
+	return 0;
+}
+
+static
+void
+ycsb_get_func (bson_t const* value, gpointer data)
+{
+	(void)value;
+	(void)data;
+}
+
+static
+gpointer
+ycsb_thread (gpointer data)
+{
+	YCSBThread* thread = data;
+	YCSBRun* run = thread->run;
+	YCSBWorkload const* workload = run->workload;
+	g_autoptr(GRand) rand = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	rand = g_rand_new_with_seed(thread->seed);
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = 0; i < thread->operations; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* key = NULL;
+		guint choice;
+
+		choice = g_rand_int_range(rand, 0, 100);
+
+		if (choice < workload->insert)
+		{
+			gsize record;
+
+			/* Other threads might already choose the new record before it has been written, which YCSB allows, too. */
+			record = g_atomic_pointer_add(&(run->records), 1);
+			key = ycsb_key(record);
+
+			kv = j_kv_new(run->namespace, key);
+			j_kv_put(kv, ycsb_value(run), batch);
+			j_batch_execute(batch);
+		}
+		else if (choice < workload->insert + workload->scan)
+		{
+			JKVIterator* iterator;
+			guint length;
+
+			key = ycsb_key(ycsb_next_record(run, rand));
+			length = g_rand_int_range(rand, 1, opt_ycsb_scan_length + 1);
+
+			iterator = j_kv_iterator_new_range(run->namespace, "user", key, length);
+
+			while (j_kv_iterator_next(iterator))
+			{
+				j_kv_iterator_get(iterator);
+			}
+
+			j_kv_iterator_free(iterator);
+		}
+		else
+		{
+			key = ycsb_key(ycsb_next_record(run, rand));
+			kv = j_kv_new(run->namespace, key);
+
+			if (choice < workload->insert + workload->scan + workload->update)
+			{
+				j_kv_put(kv, ycsb_value(run), batch);
+			}
+			else if (choice < workload->insert + workload->scan + workload->update + workload->read_modify_write)
+			{
+				j_kv_get_callback(kv, ycsb_get_func, NULL, batch);
+				j_batch_execute(batch);
+
+				j_kv_put(kv, ycsb_value(run), batch);
+			}
+			else
+			{
+				j_kv_get_callback(kv, ycsb_get_func, NULL, batch);
+			}
+
+			j_batch_execute(batch);
+		}
+
+		if (opt_ycsb_threads == 1)
+		{
+			j_benchmark_timer_lap();
+		}
+	}
+
+	return NULL;
+}
+
+static
+void
+_benchmark_kv_ycsb (BenchmarkResult* result, YCSBWorkload const* workload)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree GThread** threads = NULL;
+	g_autofree YCSBThread* thread_data = NULL;
+	YCSBRun run;
+	gdouble elapsed;
+
+	run.workload = workload;
+	run.distribution = workload->distribution;
+	run.namespace = g_strdup_printf("%s-ycsb", j_benchmark_get_namespace());
+	run.value = g_malloc(opt_ycsb_value_size);
+	run.records = opt_ycsb_records;
+
+	if (g_strcmp0(opt_ycsb_distribution, "uniform") == 0)
+	{
+		run.distribution = YCSB_DISTRIBUTION_UNIFORM;
+	}
+	else if (g_strcmp0(opt_ycsb_distribution, "zipfian") == 0)
+	{
+		run.distribution = YCSB_DISTRIBUTION_ZIPFIAN;
+	}
+	else if (g_strcmp0(opt_ycsb_distribution, "latest") == 0)
+	{
+		run.distribution = YCSB_DISTRIBUTION_LATEST;
+	}
+
+	for (gint i = 0; i < opt_ycsb_value_size; i++)
+	{
+		run.value[i] = g_random_int_range(0, 256);
+	}
+
+	ycsb_zipfian_init(&run, opt_ycsb_records);
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (gint i = 0; i < opt_ycsb_records; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* key = NULL;
+
+		key = ycsb_key(i);
+		kv = j_kv_new(run.namespace, key);
+		j_kv_put(kv, ycsb_value(&run), batch);
+
+		if (i % 1000 == 999)
+		{
+			j_batch_execute(batch);
+		}
+	}
+
+	j_batch_execute(batch);
+
+	threads = g_new(GThread*, opt_ycsb_threads);
+	thread_data = g_new(YCSBThread, opt_ycsb_threads);
+
+	j_benchmark_timer_start();
+
+	for (gint i = 0; i < opt_ycsb_threads; i++)
+	{
+		thread_data[i].run = &run;
+		thread_data[i].operations = opt_ycsb_operations / opt_ycsb_threads + ((i < opt_ycsb_operations % opt_ycsb_threads) ? 1 : 0);
+		thread_data[i].seed = g_random_int();
+
+		threads[i] = g_thread_new("benchmark-ycsb", ycsb_thread, &(thread_data[i]));
+	}
+
+	for (gint i = 0; i < opt_ycsb_threads; i++)
+	{
+		g_thread_join(threads[i]);
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_kv_delete_by_prefix(run.namespace, "user", batch);
+	j_batch_execute(batch);
+
+	g_free(run.namespace);
+	g_free(run.value);
+
+	result->elapsed_time = elapsed;
+	result->operations = opt_ycsb_operations;
+}
+
+static
+void
+benchmark_kv_ycsb_a (BenchmarkResult* result)
+{
+	/* Update heavy */
+	static YCSBWorkload const workload = { 50, 50, 0, 0, 0, YCSB_DISTRIBUTION_ZIPFIAN };
+
+	_benchmark_kv_ycsb(result, &workload);
+}
+
+static
+void
+benchmark_kv_ycsb_b (BenchmarkResult* result)
+{
+	/* Read mostly */
+	static YCSBWorkload const workload = { 95, 5, 0, 0, 0, YCSB_DISTRIBUTION_ZIPFIAN };
+
+	_benchmark_kv_ycsb(result, &workload);
+}
+
+static
+void
+benchmark_kv_ycsb_c (BenchmarkResult* result)
+{
+	/* Read only */
+	static YCSBWorkload const workload = { 100, 0, 0, 0, 0, YCSB_DISTRIBUTION_ZIPFIAN };
+
+	_benchmark_kv_ycsb(result, &workload);
+}
+
+static
+void
+benchmark_kv_ycsb_d (BenchmarkResult* result)
+{
+	/* Read latest */
+	static YCSBWorkload const workload = { 95, 0, 5, 0, 0, YCSB_DISTRIBUTION_LATEST };
+
+	_benchmark_kv_ycsb(result, &workload);
+}
+
+static
+void
+benchmark_kv_ycsb_e (BenchmarkResult* result)
+{
+	/* Short ranges */
+	static YCSBWorkload const workload = { 0, 0, 5, 95, 0, YCSB_DISTRIBUTION_ZIPFIAN };
+
+	_benchmark_kv_ycsb(result, &workload);
+}
+
+static
+void
+benchmark_kv_ycsb_f (BenchmarkResult* result)
+{
+	/* Read-modify-write */
+	static YCSBWorkload const workload = { 50, 0, 0, 0, 50, YCSB_DISTRIBUTION_ZIPFIAN };
+
+	_benchmark_kv_ycsb(result, &workload);
+}
+
+/**
+ * Returns the options of the YCSB workloads.
+ */
+GOptionGroup*
+benchmark_kv_ycsb_get_option_group (void)
+{
+	GOptionGroup* group;
+
+	static GOptionEntry entries[] = {
+		{ "ycsb-records", 0, 0, G_OPTION_ARG_INT, &opt_ycsb_records, "Number of records to load", "10000" },
+		{ "ycsb-operations", 0, 0, G_OPTION_ARG_INT, &opt_ycsb_operations, "Number of operations per workload", "100000" },
+		{ "ycsb-value-size", 0, 0, G_OPTION_ARG_INT, &opt_ycsb_value_size, "Size of values in bytes", "1000" },
+		{ "ycsb-threads", 0, 0, G_OPTION_ARG_INT, &opt_ycsb_threads, "Number of client threads", "1" },
+		{ "ycsb-scan-length", 0, 0, G_OPTION_ARG_INT, &opt_ycsb_scan_length, "Maximum number of records per scan", "100" },
+		{ "ycsb-distribution", 0, 0, G_OPTION_ARG_STRING, &opt_ycsb_distribution, "Key distribution to use instead of the workload's (uniform, zipfian or latest)", NULL },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	group = g_option_group_new("ycsb", "YCSB workload options", "Show YCSB workload options", NULL, NULL);
+	g_option_group_add_entries(group, entries);
+
+	return group;
+}
+
+void
+benchmark_kv_ycsb (void)
+{
+	if (opt_ycsb_records <= 0 || opt_ycsb_operations <= 0 || opt_ycsb_value_size < 0 || opt_ycsb_threads <= 0 || opt_ycsb_scan_length <= 0)
+	{
+		g_warning("Invalid YCSB options, skipping YCSB workloads.");
+		return;
+	}
+
+	j_benchmark_run("/kv/ycsb/a", benchmark_kv_ycsb_a);
+	j_benchmark_run("/kv/ycsb/b", benchmark_kv_ycsb_b);
+	j_benchmark_run("/kv/ycsb/c", benchmark_kv_ycsb_c);
+	j_benchmark_run("/kv/ycsb/d", benchmark_kv_ycsb_d);
+	j_benchmark_run("/kv/ycsb/e", benchmark_kv_ycsb_e);
+	j_benchmark_run("/kv/ycsb/f", benchmark_kv_ycsb_f);
+
+	g_free(opt_ycsb_distribution);
+	opt_ycsb_distribution = NULL;
+}
@@ -48,7 +48,7 @@ _benchmark_lock (BenchmarkResult* result, gboolean acquire, gboolean add)
 
 	for (guint i = 0; i < n; i++)
 	{
-		lock = j_lock_new("benchmark", "path");
+		lock = j_lock_new(j_benchmark_get_namespace(), "path");
 
 		if (add)
 		{
@@ -113,10 +113,49 @@ benchmark_lock_add (BenchmarkResult* result)
 	_benchmark_lock(result, TRUE, TRUE);
 }
 
+static
+void
+benchmark_lock_acquire_release_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+
+	for (guint i = 0; i < *n; i++)
+	{
+		JLock* lock;
+
+		/* All threads lock different blocks of the same path. */
+		lock = j_lock_new(j_benchmark_get_namespace(), "path");
+		j_lock_add(lock, thread * *n + i);
+		j_lock_acquire(lock);
+		j_lock_release(lock);
+		j_lock_free(lock);
+	}
+}
+
+static
+void
+benchmark_lock_acquire_release_threads (BenchmarkResult* result)
+{
+	guint const n = 3000;
+
+	gdouble elapsed;
+	guint per_thread;
+
+	per_thread = n / j_benchmark_get_threads();
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_lock_acquire_release_thread, &per_thread);
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = per_thread * j_benchmark_get_threads();
+}
+
 void
 benchmark_lock (void)
 {
 	j_benchmark_run("/lock/acquire", benchmark_lock_acquire);
 	j_benchmark_run("/lock/release", benchmark_lock_release);
 	j_benchmark_run("/lock/add", benchmark_lock_add);
+	j_benchmark_run_threads("/lock/acquire-release/threads", benchmark_lock_acquire_release_threads);
 }
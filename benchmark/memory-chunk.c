@@ -52,8 +52,67 @@ benchmark_memory_chunk_get (BenchmarkResult* result)
 	result->operations = n;
 }
 
+struct BenchmarkMemoryChunkThreads
+{
+	JMemoryChunk** memory_chunks;
+	guint n;
+};
+
+typedef struct BenchmarkMemoryChunkThreads BenchmarkMemoryChunkThreads;
+
+static
+void
+benchmark_memory_chunk_get_thread (guint thread, gpointer data)
+{
+	BenchmarkMemoryChunkThreads* memory_chunk_threads = data;
+
+	for (guint i = 0; i < memory_chunk_threads->n; i++)
+	{
+		j_memory_chunk_get(memory_chunk_threads->memory_chunks[thread], 1);
+	}
+}
+
+/**
+ * Memory chunks are not thread-safe, so every thread uses its own one.
+ */
+static
+void
+benchmark_memory_chunk_get_threads (BenchmarkResult* result)
+{
+	guint const n = 50 * 1024 * 1024;
+
+	BenchmarkMemoryChunkThreads memory_chunk_threads;
+	gdouble elapsed;
+	guint threads;
+
+	threads = j_benchmark_get_threads();
+
+	memory_chunk_threads.memory_chunks = g_new(JMemoryChunk*, threads);
+	memory_chunk_threads.n = n / threads;
+
+	for (guint i = 0; i < threads; i++)
+	{
+		memory_chunk_threads.memory_chunks[i] = j_memory_chunk_new(memory_chunk_threads.n);
+	}
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_memory_chunk_get_thread, &memory_chunk_threads);
+	elapsed = j_benchmark_timer_elapsed();
+
+	for (guint i = 0; i < threads; i++)
+	{
+		j_memory_chunk_free(memory_chunk_threads.memory_chunks[i]);
+	}
+
+	g_free(memory_chunk_threads.memory_chunks);
+
+	result->elapsed_time = elapsed;
+	result->operations = memory_chunk_threads.n * threads;
+}
+
 void
 benchmark_memory_chunk (void)
 {
 	j_benchmark_run("/memory_chunk", benchmark_memory_chunk_get);
+	j_benchmark_run_threads("/memory_chunk/threads", benchmark_memory_chunk_get_threads);
 }
@@ -74,6 +74,115 @@ benchmark_message_new_append (BenchmarkResult* result)
 	_benchmark_message_new(result, TRUE);
 }
 
+/**
+ * Sends and receives messages like a server does, reusing the receive message.
+ */
+static
+void
+benchmark_message_reuse (BenchmarkResult* result)
+{
+	guint const n = 500000;
+	guint64 const dummy = 42;
+
+	g_autoptr(JMessage) message = NULL;
+	guint64 allocations;
+	gdouble elapsed;
+
+	message = j_message_new(J_MESSAGE_NONE, 0);
+
+	j_benchmark_timer_start();
+	allocations = j_message_get_allocation_count();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JMessage) request = NULL;
+		g_autoptr(JMessage) reply = NULL;
+
+		request = j_message_new(J_MESSAGE_KV_GET, sizeof(guint64));
+		j_message_add_operation(request, sizeof(guint64));
+		j_message_append_8(request, &dummy);
+
+		reply = j_message_new_reply(request);
+		j_message_add_operation(reply, sizeof(guint64));
+		j_message_append_8(reply, &dummy);
+
+		j_message_reset(message);
+	}
+
+	result->allocations = j_message_get_allocation_count() - allocations;
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+}
+
+/**
+ * Encodes and decodes messages with small operations like the ones used for key-value and small object accesses.
+ * The reported bytes are the bytes on the wire, including the header.
+ */
+static
+void
+_benchmark_message_encode (BenchmarkResult* result, gboolean compact)
+{
+	guint const n = 100000;
+	guint const m = 100;
+
+	gdouble elapsed;
+	guint64 bytes = 0;
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JMessage) message = NULL;
+		guint64 sum = 0;
+
+		message = j_message_new(J_MESSAGE_OBJECT_WRITE, 0);
+		j_message_set_compact(message, compact);
+
+		for (guint j = 0; j < m; j++)
+		{
+			j_message_add_operation(message, 2 * sizeof(guint64));
+			j_message_append_varint(message, 100);
+			j_message_append_varint(message, j * 100);
+		}
+
+		j_message_rewind(message);
+
+		for (guint j = 0; j < m; j++)
+		{
+			sum += j_message_get_varint(message);
+			sum += j_message_get_varint(message);
+		}
+
+		g_assert(sum > 0);
+
+		/* 20 bytes of header */
+		bytes += 20 + j_message_get_length(message);
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+	result->bytes = bytes;
+}
+
+static
+void
+benchmark_message_encode_fixed (BenchmarkResult* result)
+{
+	_benchmark_message_encode(result, FALSE);
+}
+
+static
+void
+benchmark_message_encode_compact (BenchmarkResult* result)
+{
+	_benchmark_message_encode(result, TRUE);
+}
+
 static
 void
 _benchmark_message_add_operation (BenchmarkResult* result, gboolean large)
@@ -124,6 +233,9 @@ benchmark_message (void)
 {
 	j_benchmark_run("/message/new", benchmark_message_new);
 	j_benchmark_run("/message/new-append", benchmark_message_new_append);
+	j_benchmark_run("/message/reuse", benchmark_message_reuse);
 	j_benchmark_run("/message/add-operation-small", benchmark_message_add_operation_small);
 	j_benchmark_run("/message/add-operation-large", benchmark_message_add_operation_large);
+	j_benchmark_run("/message/encode-fixed", benchmark_message_encode_fixed);
+	j_benchmark_run("/message/encode-compact", benchmark_message_encode_compact);
 }
@@ -0,0 +1,611 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Driver for running the benchmarks on many MPI ranks at once.
+ *
+ * All ranks run every benchmark at the same time, the timers are started after a barrier.
+ * The existing benchmarks use one namespace per rank, so they behave like file-per-process workloads.
+ * Additionally, there are shared-file, file-per-process and metadata benchmarks modeled after IOR and mdtest.
+ * Rank 0 prints the aggregate throughput, that is, the operations of all ranks divided by the slowest rank's time,
+ * as well as the slowest and fastest rank's throughput.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <mpi.h>
+
+#include <julea.h>
+#include <julea-object.h>
+
+#include "benchmark.h"
+
+static gboolean opt_machine_readable = FALSE;
+static gchar* opt_path = NULL;
+static gchar* opt_semantics = NULL;
+static gchar* opt_template = NULL;
+static gint opt_block_size = 1024 * 1024;
+static gint opt_blocks = 64;
+static gint opt_files = 1000;
+
+static JSemantics* j_benchmark_semantics = NULL;
+
+static GTimer* j_benchmark_timer = NULL;
+
+static gint j_benchmark_rank = 0;
+static gint j_benchmark_size = 1;
+
+static gchar* j_benchmark_namespace = NULL;
+
+/**
+ * The namespace shared by all ranks.
+ */
+static gchar const* const j_benchmark_shared_namespace = "benchmark-mpi";
+
+JSemantics*
+j_benchmark_get_semantics (void)
+{
+	return j_semantics_ref(j_benchmark_semantics);
+}
+
+gchar const*
+j_benchmark_get_namespace (void)
+{
+	return j_benchmark_namespace;
+}
+
+void
+j_benchmark_timer_start (void)
+{
+	MPI_Barrier(MPI_COMM_WORLD);
+	g_timer_start(j_benchmark_timer);
+}
+
+gdouble
+j_benchmark_timer_elapsed (void)
+{
+	return g_timer_elapsed(j_benchmark_timer, NULL);
+}
+
+void
+j_benchmark_timer_lap (void)
+{
+	/* Latencies are not sampled, only the throughput of all ranks is reported. */
+}
+
+void
+j_benchmark_latency_add (gdouble latency)
+{
+	(void)latency;
+}
+
+/**
+ * Returns whether a benchmark whose name starts with prefix might be run, so that expensive setup can be skipped otherwise.
+ */
+gboolean
+j_benchmark_is_selected (gchar const* prefix)
+{
+	g_return_val_if_fail(prefix != NULL, FALSE);
+
+	return (opt_path == NULL || g_str_has_prefix(prefix, opt_path) || g_str_has_prefix(opt_path, prefix));
+}
+
+void
+j_benchmark_run (gchar const* name, BenchmarkFunc benchmark_func)
+{
+	BenchmarkResult result;
+	g_autofree gdouble* results = NULL;
+	gdouble local[3];
+	gdouble elapsed_max = 0.0;
+	gdouble operations = 0.0;
+	gdouble bytes = 0.0;
+	gdouble rate_min = G_MAXDOUBLE;
+	gdouble rate_max = 0.0;
+
+	g_return_if_fail(name != NULL);
+	g_return_if_fail(benchmark_func != NULL);
+
+	if (opt_path != NULL && !g_str_has_prefix(name, opt_path))
+	{
+		return;
+	}
+
+	result.elapsed_time = 0.0;
+	result.operations = 0;
+	result.bytes = 0;
+	result.allocations = -1;
+	result.memory = -1;
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	(*benchmark_func)(&result);
+
+	local[0] = result.elapsed_time;
+	local[1] = result.operations;
+	local[2] = result.bytes;
+
+	if (j_benchmark_rank == 0)
+	{
+		results = g_new(gdouble, 3 * j_benchmark_size);
+	}
+
+	MPI_Gather(local, 3, MPI_DOUBLE, results, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+	if (j_benchmark_rank != 0)
+	{
+		return;
+	}
+
+	for (gint i = 0; i < j_benchmark_size; i++)
+	{
+		gdouble const* rank = &(results[3 * i]);
+
+		elapsed_max = MAX(elapsed_max, rank[0]);
+		operations += rank[1];
+		bytes += rank[2];
+
+		if (rank[0] > 0.0)
+		{
+			/* Compare bytes if the benchmark transfers data, operations otherwise. */
+			gdouble rate = ((result.bytes != 0) ? rank[2] : rank[1]) / rank[0];
+
+			rate_min = MIN(rate_min, rate);
+			rate_max = MAX(rate_max, rate);
+		}
+	}
+
+	if (rate_min > rate_max)
+	{
+		rate_min = rate_max;
+	}
+
+	if (!opt_machine_readable)
+	{
+		g_autofree gchar* left = NULL;
+
+		left = g_strconcat(name, ":", NULL);
+		g_print("%-50s %.3f seconds", left, elapsed_max);
+
+		if (operations != 0.0)
+		{
+			g_print(" (%.0f/s)", operations / elapsed_max);
+		}
+
+		if (bytes != 0.0)
+		{
+			g_autofree gchar* size = NULL;
+
+			size = g_format_size(bytes / elapsed_max);
+			g_print(" (%s/s)", size);
+		}
+
+		if (result.bytes != 0)
+		{
+			g_autofree gchar* min = NULL;
+			g_autofree gchar* max = NULL;
+
+			min = g_format_size(rate_min);
+			max = g_format_size(rate_max);
+			g_print(" [%s/s-%s/s per rank]\n", min, max);
+		}
+		else
+		{
+			g_print(" [%.0f/s-%.0f/s per rank]\n", rate_min, rate_max);
+		}
+	}
+	else
+	{
+		g_print("%s %d %f", name, j_benchmark_size, elapsed_max);
+
+		if (operations != 0.0)
+		{
+			g_print(" %f", operations / elapsed_max);
+		}
+		else
+		{
+			g_print(" -");
+		}
+
+		if (bytes != 0.0)
+		{
+			g_print(" %f", bytes / elapsed_max);
+		}
+		else
+		{
+			g_print(" -");
+		}
+
+		g_print(" %f %f\n", rate_min, rate_max);
+	}
+}
+
+/**
+ * Writes opt_blocks blocks per rank.
+ * If shared is TRUE, all ranks write to one object, rank r writing the r-th block of every segment of j_benchmark_size blocks.
+ * Otherwise, every rank writes to its own object.
+ */
+static
+void
+_benchmark_mpi_write (BenchmarkResult* result, gboolean shared)
+{
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* name = NULL;
+	gdouble elapsed;
+	guint64 bytes_written = 0;
+
+	buffer = g_malloc0(opt_block_size);
+	name = (shared) ? g_strdup("shared") : g_strdup_printf("rank-%d", j_benchmark_rank);
+
+	distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+	semantics = j_benchmark_get_semantics();
+
+	if (shared)
+	{
+		/* All ranks have to agree on the shared object's distribution. */
+		j_distribution_set(distribution, "start-index", 0);
+	}
+
+	batch = j_batch_new(semantics);
+
+	object = j_distributed_object_new(j_benchmark_shared_namespace, name, distribution);
+
+	if (!shared || j_benchmark_rank == 0)
+	{
+		j_distributed_object_create(object, batch);
+		j_batch_execute(batch);
+	}
+
+	j_benchmark_timer_start();
+
+	for (gint i = 0; i < opt_blocks; i++)
+	{
+		guint64 block;
+
+		block = (shared) ? (guint64)i * j_benchmark_size + j_benchmark_rank : (guint64)i;
+		j_distributed_object_write(object, buffer, opt_block_size, block * opt_block_size, &bytes_written, batch);
+	}
+
+	j_batch_execute(batch);
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = opt_blocks;
+	result->bytes = bytes_written;
+}
+
+/**
+ * Reads the blocks written by _benchmark_mpi_write and deletes the objects afterwards.
+ * Every rank reads the blocks written by its neighbor, so that data cannot be served from a client-side cache.
+ */
+static
+void
+_benchmark_mpi_read (BenchmarkResult* result, gboolean shared)
+{
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* name = NULL;
+	gdouble elapsed;
+	gint neighbor;
+	guint64 bytes_read = 0;
+
+	buffer = g_malloc(opt_block_size);
+	neighbor = (j_benchmark_rank + 1) % j_benchmark_size;
+	name = (shared) ? g_strdup("shared") : g_strdup_printf("rank-%d", neighbor);
+
+	distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+	semantics = j_benchmark_get_semantics();
+
+	if (shared)
+	{
+		/* All ranks have to agree on the shared object's distribution. */
+		j_distribution_set(distribution, "start-index", 0);
+	}
+
+	batch = j_batch_new(semantics);
+
+	object = j_distributed_object_new(j_benchmark_shared_namespace, name, distribution);
+
+	j_benchmark_timer_start();
+
+	for (gint i = 0; i < opt_blocks; i++)
+	{
+		guint64 block;
+
+		block = (shared) ? (guint64)i * j_benchmark_size + neighbor : (guint64)i;
+		j_distributed_object_read(object, buffer, opt_block_size, block * opt_block_size, &bytes_read, batch);
+	}
+
+	j_batch_execute(batch);
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	/* Objects must not be deleted while other ranks are still reading them. */
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	if (!shared || j_benchmark_rank == 0)
+	{
+		g_autoptr(JDistributedObject) own = NULL;
+		g_autofree gchar* own_name = NULL;
+
+		own_name = (shared) ? g_strdup("shared") : g_strdup_printf("rank-%d", j_benchmark_rank);
+		own = j_distributed_object_new(j_benchmark_shared_namespace, own_name, distribution);
+
+		j_distributed_object_delete(own, batch);
+		j_batch_execute(batch);
+	}
+
+	result->elapsed_time = elapsed;
+	result->operations = opt_blocks;
+	result->bytes = bytes_read;
+}
+
+static
+void
+benchmark_mpi_shared_file_write (BenchmarkResult* result)
+{
+	_benchmark_mpi_write(result, TRUE);
+}
+
+static
+void
+benchmark_mpi_shared_file_read (BenchmarkResult* result)
+{
+	_benchmark_mpi_read(result, TRUE);
+}
+
+static
+void
+benchmark_mpi_file_per_process_write (BenchmarkResult* result)
+{
+	_benchmark_mpi_write(result, FALSE);
+}
+
+static
+void
+benchmark_mpi_file_per_process_read (BenchmarkResult* result)
+{
+	_benchmark_mpi_read(result, FALSE);
+}
+
+enum BenchmarkMPIMetadata
+{
+	BENCHMARK_MPI_METADATA_CREATE,
+	BENCHMARK_MPI_METADATA_STAT,
+	BENCHMARK_MPI_METADATA_DELETE
+};
+
+typedef enum BenchmarkMPIMetadata BenchmarkMPIMetadata;
+
+/**
+ * Creates, stats or deletes opt_files objects per rank in the shared namespace, one operation at a time.
+ * Like mdtest, every rank stats the objects created by its neighbor.
+ */
+static
+void
+_benchmark_mpi_metadata (BenchmarkResult* result, BenchmarkMPIMetadata operation)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	gdouble elapsed;
+	gint rank;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	rank = (operation == BENCHMARK_MPI_METADATA_STAT) ? (j_benchmark_rank + 1) % j_benchmark_size : j_benchmark_rank;
+
+	j_benchmark_timer_start();
+
+	for (gint i = 0; i < opt_files; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* name = NULL;
+		gint64 modification_time;
+		guint64 size;
+
+		name = g_strdup_printf("file-%d-%d", rank, i);
+		object = j_object_new(j_benchmark_shared_namespace, name);
+
+		switch (operation)
+		{
+			case BENCHMARK_MPI_METADATA_CREATE:
+				j_object_create(object, batch);
+				break;
+			case BENCHMARK_MPI_METADATA_STAT:
+				j_object_status(object, &modification_time, &size, batch);
+				break;
+			case BENCHMARK_MPI_METADATA_DELETE:
+				j_object_delete(object, batch);
+				break;
+			default:
+				g_assert_not_reached();
+		}
+
+		j_batch_execute(batch);
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = opt_files;
+}
+
+static
+void
+benchmark_mpi_metadata_create (BenchmarkResult* result)
+{
+	_benchmark_mpi_metadata(result, BENCHMARK_MPI_METADATA_CREATE);
+}
+
+static
+void
+benchmark_mpi_metadata_stat (BenchmarkResult* result)
+{
+	_benchmark_mpi_metadata(result, BENCHMARK_MPI_METADATA_STAT);
+}
+
+static
+void
+benchmark_mpi_metadata_delete (BenchmarkResult* result)
+{
+	_benchmark_mpi_metadata(result, BENCHMARK_MPI_METADATA_DELETE);
+}
+
+static
+void
+benchmark_mpi (void)
+{
+	j_benchmark_run("/mpi/shared-file/write", benchmark_mpi_shared_file_write);
+	j_benchmark_run("/mpi/shared-file/read", benchmark_mpi_shared_file_read);
+	j_benchmark_run("/mpi/file-per-process/write", benchmark_mpi_file_per_process_write);
+	j_benchmark_run("/mpi/file-per-process/read", benchmark_mpi_file_per_process_read);
+	/* The order matters, the objects are stat'ed and deleted after being created. */
+	j_benchmark_run("/mpi/metadata/create", benchmark_mpi_metadata_create);
+	j_benchmark_run("/mpi/metadata/stat", benchmark_mpi_metadata_stat);
+	j_benchmark_run("/mpi/metadata/delete", benchmark_mpi_metadata_delete);
+}
+
+int
+main (int argc, char** argv)
+{
+	GError* error = NULL;
+	GOptionContext* context;
+
+	GOptionEntry entries[] = {
+		{ "machine-readable", 0, 0, G_OPTION_ARG_NONE, &opt_machine_readable, "Produce machine-readable output", NULL },
+		{ "path", 'p', 0, G_OPTION_ARG_STRING, &opt_path, "Benchmark path to use", "/" },
+		{ "semantics", 's', 0, G_OPTION_ARG_STRING, &opt_semantics, "Semantics to use", NULL },
+		{ "template", 't', 0, G_OPTION_ARG_STRING, &opt_template, "Semantics template to use", "default" },
+		{ "block-size", 'b', 0, G_OPTION_ARG_INT, &opt_block_size, "Block size for the shared-file and file-per-process benchmarks", "1048576" },
+		{ "blocks", 'n', 0, G_OPTION_ARG_INT, &opt_blocks, "Number of blocks per rank", "64" },
+		{ "files", 'f', 0, G_OPTION_ARG_INT, &opt_files, "Number of objects per rank for the metadata benchmarks", "1000" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &j_benchmark_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &j_benchmark_size);
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, entries, NULL);
+	g_option_context_add_group(context, j_benchmark_threads_get_option_group());
+	g_option_context_add_group(context, benchmark_kv_ycsb_get_option_group());
+	g_option_context_add_group(context, benchmark_kv_scan_get_option_group());
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_option_context_free(context);
+
+		if (error)
+		{
+			if (j_benchmark_rank == 0)
+			{
+				g_printerr("%s\n", error->message);
+			}
+
+			g_error_free(error);
+		}
+
+		MPI_Finalize();
+
+		return 1;
+	}
+
+	g_option_context_free(context);
+
+	if (opt_block_size <= 0 || opt_blocks <= 0 || opt_files <= 0)
+	{
+		if (j_benchmark_rank == 0)
+		{
+			g_printerr("Block size, blocks and files have to be positive.\n");
+		}
+
+		MPI_Finalize();
+
+		return 1;
+	}
+
+	j_init();
+
+	j_benchmark_semantics = j_semantics_new_from_string(opt_template, opt_semantics);
+	j_benchmark_timer = g_timer_new();
+	j_benchmark_namespace = g_strdup_printf("benchmark-%d", j_benchmark_rank);
+
+	if (opt_machine_readable && j_benchmark_rank == 0)
+	{
+		g_print("name  ranks  elapsed  operations  bytes  rank_min  rank_max\n");
+	}
+
+	// Core
+	benchmark_background_operation();
+	benchmark_cache();
+	benchmark_lock();
+	benchmark_memory_chunk();
+	benchmark_message();
+	benchmark_trace();
+
+	// Network
+	benchmark_network();
+
+	// Backends, only if requested
+	benchmark_backend();
+
+	// KV client
+	benchmark_kv();
+	benchmark_kv_ycsb();
+	benchmark_kv_scan();
+
+	// Object client
+	benchmark_distributed_object();
+	benchmark_distributed_object_pattern();
+	benchmark_object();
+
+	// Item client
+	benchmark_collection();
+	benchmark_item();
+
+	// Multiple clients
+	benchmark_mpi();
+
+	g_free(j_benchmark_namespace);
+	g_timer_destroy(j_benchmark_timer);
+	j_semantics_unref(j_benchmark_semantics);
+
+	j_fini();
+
+	g_free(opt_path);
+	g_free(opt_semantics);
+	g_free(opt_template);
+
+	MPI_Finalize();
+
+	return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Round trips to live servers, which measure the transport's overhead without any backend involved.
+ *
+ * Every thread uses a dedicated connection, so the connection pool's limits do not apply.
+ * Compression and checksums are disabled on these connections, because they would be measured instead of the transport.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <julea.h>
+
+#include <julea-internal.h>
+
+#include "benchmark.h"
+
+/**
+ * The number of bytes echoed per run, reduced to fit the number of operations.
+ **/
+#define BENCHMARK_NETWORK_BYTES (256 * 1024 * 1024)
+
+struct BenchmarkNetwork
+{
+	GSocketConnection** connections;
+	guint operations;
+	guint64 size;
+};
+
+typedef struct BenchmarkNetwork BenchmarkNetwork;
+
+/**
+ * The payload size of the current echo benchmark.
+ */
+static guint64 benchmark_network_size = 0;
+
+/**
+ * Establishes one connection per thread, spread over all object servers.
+ */
+static
+GSocketConnection**
+benchmark_network_connect (void)
+{
+	GSocketConnection** connections;
+	guint server_count;
+	guint threads;
+
+	server_count = j_configuration_get_object_server_count(j_configuration());
+	threads = j_benchmark_get_threads();
+	connections = g_new(GSocketConnection*, threads);
+
+	for (guint i = 0; i < threads; i++)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+
+		connections[i] = j_connection_pool_connect_object(i % server_count);
+		g_assert(connections[i] != NULL);
+
+		/* Pinging without any capabilities disables compression and checksums for the server's replies. */
+		message = j_message_new(J_MESSAGE_PING, 0);
+		reply = j_message_new_reply(message);
+		j_message_send(message, connections[i]);
+		j_message_receive(reply, connections[i]);
+
+		j_message_set_compression(connections[i], FALSE);
+		j_message_set_checksum(connections[i], FALSE);
+	}
+
+	return connections;
+}
+
+static
+void
+benchmark_network_disconnect (GSocketConnection** connections)
+{
+	for (guint i = 0; i < j_benchmark_get_threads(); i++)
+	{
+		g_io_stream_close(G_IO_STREAM(connections[i]), NULL, NULL);
+		g_object_unref(connections[i]);
+	}
+
+	g_free(connections);
+}
+
+static
+void
+benchmark_network_ping_thread (guint thread, gpointer data)
+{
+	BenchmarkNetwork* network = data;
+	GSocketConnection* connection = network->connections[thread];
+
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+
+	message = j_message_new(J_MESSAGE_PING, 0);
+	reply = j_message_new_reply(message);
+
+	for (guint i = 0; i < network->operations; i++)
+	{
+		gint64 start;
+
+		start = g_get_monotonic_time();
+
+		j_message_send(message, connection);
+		j_message_receive(reply, connection);
+
+		j_benchmark_latency_add((gdouble)(g_get_monotonic_time() - start) / G_USEC_PER_SEC);
+	}
+}
+
+/**
+ * Echoes a payload, one message of at most J_STRIPE_SIZE bytes at a time.
+ * The server echoes each message in one or more replies, so the received bytes are counted.
+ */
+static
+void
+benchmark_network_echo_thread (guint thread, gpointer data)
+{
+	BenchmarkNetwork* network = data;
+	GSocketConnection* connection = network->connections[thread];
+	GInputStream* input;
+
+	g_autofree gchar* payload = NULL;
+	g_autofree gchar* echo = NULL;
+	g_autoptr(JMessage) reply = NULL;
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	payload = g_malloc0(network->size);
+	echo = g_malloc(network->size);
+	reply = j_message_new(J_MESSAGE_NONE, 0);
+
+	for (guint i = 0; i < network->operations; i++)
+	{
+		gint64 start;
+
+		start = g_get_monotonic_time();
+
+		for (guint64 offset = 0; offset < network->size; offset += J_STRIPE_SIZE)
+		{
+			g_autoptr(JMessage) message = NULL;
+			guint64 length;
+			guint64 received = 0;
+
+			length = MIN(J_STRIPE_SIZE, network->size - offset);
+
+			message = j_message_new(J_MESSAGE_ECHO, 0);
+			j_message_add_operation(message, sizeof(guint64));
+			j_message_append_varint(message, length);
+			j_message_add_send(message, payload + offset, length);
+
+			j_message_send(message, connection);
+
+			while (received < length)
+			{
+				guint32 operation_count;
+
+				j_message_receive(reply, connection);
+				operation_count = j_message_get_count(reply);
+
+				for (guint32 j = 0; j < operation_count; j++)
+				{
+					guint64 nbytes;
+
+					nbytes = j_message_get_varint(reply);
+
+					if (nbytes > 0)
+					{
+						g_input_stream_read_all(input, echo + offset + received, nbytes, NULL, NULL, NULL);
+						received += nbytes;
+					}
+				}
+			}
+		}
+
+		j_benchmark_latency_add((gdouble)(g_get_monotonic_time() - start) / G_USEC_PER_SEC);
+	}
+}
+
+static
+void
+benchmark_network_ping (BenchmarkResult* result)
+{
+	guint const n = 10000;
+
+	BenchmarkNetwork network;
+	gdouble elapsed;
+
+	network.connections = benchmark_network_connect();
+	network.operations = MAX(n / j_benchmark_get_threads(), 1);
+	network.size = 0;
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_network_ping_thread, &network);
+	elapsed = j_benchmark_timer_elapsed();
+
+	benchmark_network_disconnect(network.connections);
+
+	result->elapsed_time = elapsed;
+	result->operations = network.operations * j_benchmark_get_threads();
+}
+
+/**
+ * The reported bytes are the echoed payloads, which have been transferred in both directions.
+ */
+static
+void
+benchmark_network_echo (BenchmarkResult* result)
+{
+	BenchmarkNetwork network;
+	gdouble elapsed;
+	guint n;
+
+	n = CLAMP(BENCHMARK_NETWORK_BYTES / benchmark_network_size, 10, 10000);
+
+	network.connections = benchmark_network_connect();
+	network.operations = MAX(n / j_benchmark_get_threads(), 1);
+	network.size = benchmark_network_size;
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_network_echo_thread, &network);
+	elapsed = j_benchmark_timer_elapsed();
+
+	benchmark_network_disconnect(network.connections);
+
+	result->elapsed_time = elapsed;
+	result->operations = network.operations * j_benchmark_get_threads();
+	result->bytes = result->operations * network.size;
+}
+
+void
+benchmark_network (void)
+{
+	/* Without servers, there is no network to measure. */
+	if (j_object_backend() != NULL || j_configuration_get_object_server_count(j_configuration()) == 0)
+	{
+		return;
+	}
+
+	j_benchmark_run_threads("/network/ping", benchmark_network_ping);
+
+	/* 64 B to 64 MiB */
+	for (guint64 size = 64; size <= 64 * 1024 * 1024; size *= 4)
+	{
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("/network/echo/%" G_GUINT64_FORMAT, size);
+
+		benchmark_network_size = size;
+		j_benchmark_run_threads(name, benchmark_network_echo);
+	}
+}
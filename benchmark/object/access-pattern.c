@@ -0,0 +1,338 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Access patterns for distributed objects.
+ *
+ * Every combination of distribution, pattern and block size transfers the same amount of data using a single batch,
+ * so that the results show how the distribution splits the accesses and how well the server merges them.
+ * The shared pattern is run with increasing numbers of threads that write to and read from one object (N-to-1).
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+#include <julea-object.h>
+
+#include "benchmark.h"
+
+/**
+ * The number of bytes transferred by every benchmark.
+ */
+#define BENCHMARK_PATTERN_SIZE (16 * 1024 * 1024)
+
+enum BenchmarkPattern
+{
+	BENCHMARK_PATTERN_SEQUENTIAL,
+	BENCHMARK_PATTERN_BACKWARDS,
+	BENCHMARK_PATTERN_STRIDED,
+	BENCHMARK_PATTERN_RANDOM,
+	BENCHMARK_PATTERN_UNALIGNED,
+	BENCHMARK_PATTERN_SHARED
+};
+
+typedef enum BenchmarkPattern BenchmarkPattern;
+
+static gchar const* benchmark_pattern_names[] = {
+	"sequential",
+	"backwards",
+	"strided",
+	"random",
+	"unaligned",
+	"shared"
+};
+
+static gchar const* benchmark_pattern_distribution_names[] = {
+	"round-robin",
+	"single-server",
+	"weighted"
+};
+
+/**
+ * The parameters of the current benchmark, benchmark functions do not take arguments.
+ */
+static JDistributionType benchmark_pattern_distribution;
+static BenchmarkPattern benchmark_pattern;
+static guint64 benchmark_pattern_block_size;
+
+struct BenchmarkPatternThread
+{
+	JSemantics* semantics;
+	gboolean write;
+};
+
+typedef struct BenchmarkPatternThread BenchmarkPatternThread;
+
+static
+JDistribution*
+benchmark_pattern_new_distribution (void)
+{
+	JDistribution* distribution;
+
+	distribution = j_distribution_new(benchmark_pattern_distribution);
+
+	switch (benchmark_pattern_distribution)
+	{
+		case J_DISTRIBUTION_ROUND_ROBIN:
+			j_distribution_set(distribution, "start-index", 0);
+			break;
+		case J_DISTRIBUTION_SINGLE_SERVER:
+			j_distribution_set(distribution, "index", 0);
+			break;
+		case J_DISTRIBUTION_WEIGHTED:
+			/* Server i gets i + 1 shares. */
+			for (guint i = 0; i < j_configuration_get_object_server_count(j_configuration()); i++)
+			{
+				j_distribution_set2(distribution, "weight", i, i + 1);
+			}
+			break;
+		case J_DISTRIBUTION_RENDEZVOUS:
+		case J_DISTRIBUTION_REPLICATED:
+		case J_DISTRIBUTION_ERASURE:
+		case J_DISTRIBUTION_LOCAL:
+		default:
+			g_assert_not_reached();
+	}
+
+	return distribution;
+}
+
+/**
+ * Returns the offsets and the length of all accesses of a pattern.
+ * The shared pattern returns the offsets of one of threads threads, which access every threads-th block.
+ */
+static
+guint64*
+benchmark_pattern_offsets (BenchmarkPattern pattern, guint64 block_size, guint thread, guint threads, guint* n, guint64* length)
+{
+	g_autoptr(GRand) rand = NULL;
+	guint64* offsets;
+
+	*n = BENCHMARK_PATTERN_SIZE / block_size;
+	*length = block_size;
+
+	if (pattern == BENCHMARK_PATTERN_SHARED)
+	{
+		*n /= threads;
+	}
+
+	offsets = g_new(guint64, *n);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		switch (pattern)
+		{
+			case BENCHMARK_PATTERN_SEQUENTIAL:
+			case BENCHMARK_PATTERN_RANDOM:
+				offsets[i] = i * block_size;
+				break;
+			case BENCHMARK_PATTERN_BACKWARDS:
+				offsets[i] = (*n - 1 - i) * block_size;
+				break;
+			case BENCHMARK_PATTERN_STRIDED:
+				/* Leave gaps of three blocks. */
+				offsets[i] = i * 4 * block_size;
+				break;
+			case BENCHMARK_PATTERN_UNALIGNED:
+				/* Accesses are slightly smaller than a block and start at odd offsets, so they straddle block boundaries. */
+				*length = block_size - 3;
+				offsets[i] = i * block_size + 1;
+				break;
+			case BENCHMARK_PATTERN_SHARED:
+				offsets[i] = ((guint64)i * threads + thread) * block_size;
+				break;
+			default:
+				g_assert_not_reached();
+		}
+	}
+
+	if (pattern == BENCHMARK_PATTERN_RANDOM)
+	{
+		/* Fisher-Yates shuffle with a fixed seed, so that reads use the same order as writes. */
+		rand = g_rand_new_with_seed(42);
+
+		for (guint i = *n - 1; i > 0; i--)
+		{
+			guint j;
+			guint64 tmp;
+
+			j = g_rand_int_range(rand, 0, i + 1);
+			tmp = offsets[i];
+			offsets[i] = offsets[j];
+			offsets[j] = tmp;
+		}
+	}
+
+	return offsets;
+}
+
+/**
+ * Transfers the thread's part of the pattern using a single batch.
+ * Every thread uses its own handle for the object, because distributions must not be shared by threads.
+ */
+static
+guint64
+benchmark_pattern_transfer (JSemantics* semantics, gboolean write, guint thread, guint threads)
+{
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autofree guint64* offsets = NULL;
+	g_autofree gchar* buffer = NULL;
+	guint64 length;
+	guint64 bytes = 0;
+	guint n;
+
+	offsets = benchmark_pattern_offsets(benchmark_pattern, benchmark_pattern_block_size, thread, threads, &n, &length);
+	buffer = g_malloc0(length);
+	batch = j_batch_new(semantics);
+
+	distribution = benchmark_pattern_new_distribution();
+	object = j_distributed_object_new(j_benchmark_get_namespace(), "benchmark-pattern", distribution);
+
+	for (guint i = 0; i < n; i++)
+	{
+		if (write)
+		{
+			j_distributed_object_write(object, buffer, length, offsets[i], &bytes, batch);
+		}
+		else
+		{
+			j_distributed_object_read(object, buffer, length, offsets[i], &bytes, batch);
+		}
+	}
+
+	j_batch_execute(batch);
+
+	return bytes;
+}
+
+static
+void
+benchmark_pattern_thread (guint thread, gpointer data)
+{
+	BenchmarkPatternThread* pattern_thread = data;
+
+	benchmark_pattern_transfer(pattern_thread->semantics, pattern_thread->write, thread, j_benchmark_get_threads());
+}
+
+static
+void
+_benchmark_pattern (BenchmarkResult* result, gboolean write)
+{
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree guint64* offsets = NULL;
+	BenchmarkPatternThread pattern_thread;
+	gdouble elapsed;
+	guint64 length;
+	guint threads;
+	guint n;
+
+	threads = (benchmark_pattern == BENCHMARK_PATTERN_SHARED) ? j_benchmark_get_threads() : 1;
+
+	distribution = benchmark_pattern_new_distribution();
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	object = j_distributed_object_new(j_benchmark_get_namespace(), "benchmark-pattern", distribution);
+	j_distributed_object_create(object, batch);
+	j_batch_execute(batch);
+
+	pattern_thread.semantics = semantics;
+	pattern_thread.write = TRUE;
+
+	if (!write)
+	{
+		/* Reads use the same pattern as the writes, so they never hit holes. */
+		j_benchmark_threads_execute(benchmark_pattern_thread, &pattern_thread);
+		pattern_thread.write = FALSE;
+	}
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_pattern_thread, &pattern_thread);
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_distributed_object_delete(object, batch);
+	j_batch_execute(batch);
+
+	offsets = benchmark_pattern_offsets(benchmark_pattern, benchmark_pattern_block_size, 0, threads, &n, &length);
+
+	result->elapsed_time = elapsed;
+	result->operations = (guint64)n * threads;
+	result->bytes = result->operations * length;
+}
+
+static
+void
+benchmark_pattern_write (BenchmarkResult* result)
+{
+	_benchmark_pattern(result, TRUE);
+}
+
+static
+void
+benchmark_pattern_read (BenchmarkResult* result)
+{
+	_benchmark_pattern(result, FALSE);
+}
+
+void
+benchmark_distributed_object_pattern (void)
+{
+	JDistributionType const distributions[] = { J_DISTRIBUTION_ROUND_ROBIN, J_DISTRIBUTION_SINGLE_SERVER, J_DISTRIBUTION_WEIGHTED };
+	guint64 const block_sizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+
+	for (guint d = 0; d < G_N_ELEMENTS(distributions); d++)
+	{
+		for (guint p = 0; p < G_N_ELEMENTS(benchmark_pattern_names); p++)
+		{
+			for (guint b = 0; b < G_N_ELEMENTS(block_sizes); b++)
+			{
+				g_autofree gchar* write_name = NULL;
+				g_autofree gchar* read_name = NULL;
+
+				benchmark_pattern_distribution = distributions[d];
+				benchmark_pattern = p;
+				benchmark_pattern_block_size = block_sizes[b];
+
+				write_name = g_strdup_printf("/object/distributed-object/pattern/%s/%s/%" G_GUINT64_FORMAT "k/write", benchmark_pattern_distribution_names[d], benchmark_pattern_names[p], block_sizes[b] / 1024);
+				read_name = g_strdup_printf("/object/distributed-object/pattern/%s/%s/%" G_GUINT64_FORMAT "k/read", benchmark_pattern_distribution_names[d], benchmark_pattern_names[p], block_sizes[b] / 1024);
+
+				if (benchmark_pattern == BENCHMARK_PATTERN_SHARED)
+				{
+					j_benchmark_run_threads(write_name, benchmark_pattern_write);
+					j_benchmark_run_threads(read_name, benchmark_pattern_read);
+				}
+				else
+				{
+					j_benchmark_run(write_name, benchmark_pattern_write);
+					j_benchmark_run(read_name, benchmark_pattern_read);
+				}
+			}
+		}
+	}
+}
@@ -52,7 +52,7 @@ _benchmark_distributed_object_create (BenchmarkResult* result, gboolean use_batc
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_distributed_object_new("benchmark", name, distribution);
+		object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
 		j_distributed_object_create(object, batch);
 
 		j_distributed_object_delete(object, delete_batch);
@@ -60,6 +60,7 @@ _benchmark_distributed_object_create (BenchmarkResult* result, gboolean use_batc
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -111,7 +112,7 @@ _benchmark_distributed_object_delete (BenchmarkResult* result, gboolean use_batc
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_distributed_object_new("benchmark", name, distribution);
+		object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
 		j_distributed_object_create(object, batch);
 	}
 
@@ -125,13 +126,14 @@ _benchmark_distributed_object_delete (BenchmarkResult* result, gboolean use_batc
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_distributed_object_new("benchmark", name, distribution);
+		object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
 
 		j_distributed_object_delete(object, batch);
 
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -183,7 +185,7 @@ _benchmark_distributed_object_status (BenchmarkResult* result, gboolean use_batc
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	object = j_distributed_object_new("benchmark", "benchmark", distribution);
+	object = j_distributed_object_new(j_benchmark_get_namespace(), "benchmark", distribution);
 	j_distributed_object_create(object, batch);
 	j_distributed_object_write(object, dummy, 1, 0, &size, batch);
 
@@ -198,6 +200,7 @@ _benchmark_distributed_object_status (BenchmarkResult* result, gboolean use_batc
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -249,7 +252,7 @@ _benchmark_distributed_object_read (BenchmarkResult* result, gboolean use_batch,
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	object = j_distributed_object_new("benchmark", "benchmark", distribution);
+	object = j_distributed_object_new(j_benchmark_get_namespace(), "benchmark", distribution);
 	j_distributed_object_create(object, batch);
 
 	for (guint i = 0; i < n; i++)
@@ -269,6 +272,7 @@ _benchmark_distributed_object_read (BenchmarkResult* result, gboolean use_batch,
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 
 			g_assert_cmpuint(nb, ==, block_size);
 		}
@@ -325,7 +329,7 @@ _benchmark_distributed_object_write (BenchmarkResult* result, gboolean use_batch
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	object = j_distributed_object_new("benchmark", "benchmark", distribution);
+	object = j_distributed_object_new(j_benchmark_get_namespace(), "benchmark", distribution);
 	j_distributed_object_create(object, batch);
 	j_batch_execute(batch);
 
@@ -338,6 +342,7 @@ _benchmark_distributed_object_write (BenchmarkResult* result, gboolean use_batch
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 
 			g_assert_cmpuint(nb, ==, block_size);
 		}
@@ -397,7 +402,7 @@ _benchmark_distributed_object_unordered_create_delete (BenchmarkResult* result,
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_distributed_object_new("benchmark", name, distribution);
+		object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
 		j_distributed_object_create(object, batch);
 
 		j_distributed_object_delete(object, batch);
@@ -405,6 +410,7 @@ _benchmark_distributed_object_unordered_create_delete (BenchmarkResult* result,
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -435,6 +441,201 @@ benchmark_distributed_object_unordered_create_delete_batch (BenchmarkResult* res
 	_benchmark_distributed_object_unordered_create_delete(result, TRUE);
 }
 
+/**
+ * Returns a distribution for the thread benchmarks.
+ * Objects are created, written and deleted by different functions with their own distributions, which therefore have to agree on the start index.
+ */
+static
+JDistribution*
+benchmark_distributed_object_thread_distribution (void)
+{
+	JDistribution* distribution;
+
+	distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+	j_distribution_set(distribution, "start-index", 0);
+
+	return distribution;
+}
+
+/**
+ * Every thread creates its own objects, executing one batch per object.
+ */
+static
+void
+benchmark_distributed_object_create_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	distribution = benchmark_distributed_object_thread_distribution();
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		g_autoptr(JDistributedObject) object = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("benchmark-%u-%u", thread, i);
+		object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
+		j_distributed_object_create(object, batch);
+		j_batch_execute(batch);
+	}
+}
+
+static
+void
+benchmark_distributed_object_delete_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	distribution = benchmark_distributed_object_thread_distribution();
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		g_autoptr(JDistributedObject) object = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("benchmark-%u-%u", thread, i);
+		object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
+		j_distributed_object_delete(object, batch);
+	}
+
+	j_batch_execute(batch);
+}
+
+static
+void
+benchmark_distributed_object_create_threads (BenchmarkResult* result)
+{
+	guint const n = 10000;
+
+	gdouble elapsed;
+	guint per_thread;
+
+	per_thread = n / j_benchmark_get_threads();
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_distributed_object_create_thread, &per_thread);
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_benchmark_threads_execute(benchmark_distributed_object_delete_thread, &per_thread);
+
+	result->elapsed_time = elapsed;
+	result->operations = per_thread * j_benchmark_get_threads();
+}
+
+/**
+ * Every thread writes 4 KiB blocks to its own object, executing one batch per block.
+ */
+static
+void
+benchmark_distributed_object_write_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+	guint const block_size = 4 * 1024;
+
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* name = NULL;
+	gchar dummy[block_size];
+	guint64 nb = 0;
+
+	memset(dummy, 0, block_size);
+
+	distribution = benchmark_distributed_object_thread_distribution();
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("benchmark-%u", thread);
+	object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		j_distributed_object_write(object, dummy, block_size, i * block_size, &nb, batch);
+		j_batch_execute(batch);
+	}
+}
+
+static
+void
+benchmark_distributed_object_delete_write_thread (guint thread, gpointer data)
+{
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* name = NULL;
+
+	(void)data;
+
+	distribution = benchmark_distributed_object_thread_distribution();
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("benchmark-%u", thread);
+	object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
+	j_distributed_object_delete(object, batch);
+	j_batch_execute(batch);
+}
+
+static
+void
+benchmark_distributed_object_create_write_thread (guint thread, gpointer data)
+{
+	g_autoptr(JDistributedObject) object = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* name = NULL;
+
+	(void)data;
+
+	distribution = benchmark_distributed_object_thread_distribution();
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("benchmark-%u", thread);
+	object = j_distributed_object_new(j_benchmark_get_namespace(), name, distribution);
+	j_distributed_object_create(object, batch);
+	j_batch_execute(batch);
+}
+
+static
+void
+benchmark_distributed_object_write_threads (BenchmarkResult* result)
+{
+	guint const n = 25000;
+
+	gdouble elapsed;
+	guint per_thread;
+
+	per_thread = n / j_benchmark_get_threads();
+
+	j_benchmark_threads_execute(benchmark_distributed_object_create_write_thread, NULL);
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_distributed_object_write_thread, &per_thread);
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_benchmark_threads_execute(benchmark_distributed_object_delete_write_thread, NULL);
+
+	result->elapsed_time = elapsed;
+	result->operations = per_thread * j_benchmark_get_threads();
+	result->bytes = result->operations * 4 * 1024;
+}
+
 void
 benchmark_distributed_object (void)
 {
@@ -452,4 +653,7 @@ benchmark_distributed_object (void)
 
 	j_benchmark_run("/object/distributed-object/unordered-create-delete", benchmark_distributed_object_unordered_create_delete);
 	j_benchmark_run("/object/distributed-object/unordered-create-delete-batch", benchmark_distributed_object_unordered_create_delete_batch);
+
+	j_benchmark_run_threads("/object/distributed-object/create/threads", benchmark_distributed_object_create_threads);
+	j_benchmark_run_threads("/object/distributed-object/write/threads", benchmark_distributed_object_write_threads);
 }
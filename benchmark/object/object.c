@@ -50,7 +50,7 @@ _benchmark_object_create (BenchmarkResult* result, gboolean use_batch)
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_object_new("benchmark", name);
+		object = j_object_new(j_benchmark_get_namespace(), name);
 		j_object_create(object, batch);
 
 		j_object_delete(object, delete_batch);
@@ -58,6 +58,7 @@ _benchmark_object_create (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -107,7 +108,7 @@ _benchmark_object_delete (BenchmarkResult* result, gboolean use_batch)
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_object_new("benchmark", name);
+		object = j_object_new(j_benchmark_get_namespace(), name);
 		j_object_create(object, batch);
 	}
 
@@ -121,13 +122,14 @@ _benchmark_object_delete (BenchmarkResult* result, gboolean use_batch)
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_object_new("benchmark", name);
+		object = j_object_new(j_benchmark_get_namespace(), name);
 
 		j_object_delete(object, batch);
 
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -177,7 +179,7 @@ _benchmark_object_status (BenchmarkResult* result, gboolean use_batch)
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	object = j_object_new("benchmark", "benchmark");
+	object = j_object_new(j_benchmark_get_namespace(), "benchmark");
 	j_object_create(object, batch);
 	j_object_write(object, dummy, 1, 0, &size, batch);
 
@@ -192,6 +194,7 @@ _benchmark_object_status (BenchmarkResult* result, gboolean use_batch)
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -241,7 +244,7 @@ _benchmark_object_read (BenchmarkResult* result, gboolean use_batch, guint block
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	object = j_object_new("benchmark", "benchmark");
+	object = j_object_new(j_benchmark_get_namespace(), "benchmark");
 	j_object_create(object, batch);
 
 	for (guint i = 0; i < n; i++)
@@ -261,6 +264,7 @@ _benchmark_object_read (BenchmarkResult* result, gboolean use_batch, guint block
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 
 			g_assert_cmpuint(nb, ==, block_size);
 		}
@@ -315,7 +319,7 @@ _benchmark_object_write (BenchmarkResult* result, gboolean use_batch, guint bloc
 	semantics = j_benchmark_get_semantics();
 	batch = j_batch_new(semantics);
 
-	object = j_object_new("benchmark", "benchmark");
+	object = j_object_new(j_benchmark_get_namespace(), "benchmark");
 	j_object_create(object, batch);
 	j_batch_execute(batch);
 
@@ -328,6 +332,7 @@ _benchmark_object_write (BenchmarkResult* result, gboolean use_batch, guint bloc
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 
 			g_assert_cmpuint(nb, ==, block_size);
 		}
@@ -385,7 +390,7 @@ _benchmark_object_unordered_create_delete (BenchmarkResult* result, gboolean use
 		g_autofree gchar* name = NULL;
 
 		name = g_strdup_printf("benchmark-%d", i);
-		object = j_object_new("benchmark", name);
+		object = j_object_new(j_benchmark_get_namespace(), name);
 		j_object_create(object, batch);
 
 		j_object_delete(object, batch);
@@ -393,6 +398,7 @@ _benchmark_object_unordered_create_delete (BenchmarkResult* result, gboolean use
 		if (!use_batch)
 		{
 			j_batch_execute(batch);
+			j_benchmark_timer_lap();
 		}
 	}
 
@@ -423,6 +429,175 @@ benchmark_object_unordered_create_delete_batch (BenchmarkResult* result)
 	_benchmark_object_unordered_create_delete(result, TRUE);
 }
 
+/**
+ * Every thread creates its own objects, executing one batch per object.
+ */
+static
+void
+benchmark_object_create_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("benchmark-%u-%u", thread, i);
+		object = j_object_new(j_benchmark_get_namespace(), name);
+		j_object_create(object, batch);
+		j_batch_execute(batch);
+	}
+}
+
+static
+void
+benchmark_object_delete_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("benchmark-%u-%u", thread, i);
+		object = j_object_new(j_benchmark_get_namespace(), name);
+		j_object_delete(object, batch);
+	}
+
+	j_batch_execute(batch);
+}
+
+static
+void
+benchmark_object_create_threads (BenchmarkResult* result)
+{
+	guint const n = 10000;
+
+	gdouble elapsed;
+	guint per_thread;
+
+	per_thread = n / j_benchmark_get_threads();
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_object_create_thread, &per_thread);
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_benchmark_threads_execute(benchmark_object_delete_thread, &per_thread);
+
+	result->elapsed_time = elapsed;
+	result->operations = per_thread * j_benchmark_get_threads();
+}
+
+/**
+ * Every thread writes 4 KiB blocks to its own object, executing one batch per block.
+ */
+static
+void
+benchmark_object_write_thread (guint thread, gpointer data)
+{
+	guint const* n = data;
+	guint const block_size = 4 * 1024;
+
+	g_autoptr(JObject) object = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* name = NULL;
+	gchar dummy[block_size];
+	guint64 nb = 0;
+
+	memset(dummy, 0, block_size);
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("benchmark-%u", thread);
+	object = j_object_new(j_benchmark_get_namespace(), name);
+
+	for (guint i = 0; i < *n; i++)
+	{
+		j_object_write(object, dummy, block_size, i * block_size, &nb, batch);
+		j_batch_execute(batch);
+	}
+}
+
+static
+void
+benchmark_object_delete_write_thread (guint thread, gpointer data)
+{
+	g_autoptr(JObject) object = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* name = NULL;
+
+	(void)data;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("benchmark-%u", thread);
+	object = j_object_new(j_benchmark_get_namespace(), name);
+	j_object_delete(object, batch);
+	j_batch_execute(batch);
+}
+
+static
+void
+benchmark_object_create_write_thread (guint thread, gpointer data)
+{
+	g_autoptr(JObject) object = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autofree gchar* name = NULL;
+
+	(void)data;
+
+	semantics = j_benchmark_get_semantics();
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("benchmark-%u", thread);
+	object = j_object_new(j_benchmark_get_namespace(), name);
+	j_object_create(object, batch);
+	j_batch_execute(batch);
+}
+
+static
+void
+benchmark_object_write_threads (BenchmarkResult* result)
+{
+	guint const n = 25000;
+
+	gdouble elapsed;
+	guint per_thread;
+
+	per_thread = n / j_benchmark_get_threads();
+
+	j_benchmark_threads_execute(benchmark_object_create_write_thread, NULL);
+
+	j_benchmark_timer_start();
+	j_benchmark_threads_execute(benchmark_object_write_thread, &per_thread);
+	elapsed = j_benchmark_timer_elapsed();
+
+	j_benchmark_threads_execute(benchmark_object_delete_write_thread, NULL);
+
+	result->elapsed_time = elapsed;
+	result->operations = per_thread * j_benchmark_get_threads();
+	result->bytes = result->operations * 4 * 1024;
+}
+
 void
 benchmark_object (void)
 {
@@ -440,4 +615,7 @@ benchmark_object (void)
 
 	j_benchmark_run("/object/object/unordered-create-delete", benchmark_object_unordered_create_delete);
 	j_benchmark_run("/object/object/unordered-create-delete-batch", benchmark_object_unordered_create_delete_batch);
+
+	j_benchmark_run_threads("/object/object/create/threads", benchmark_object_create_threads);
+	j_benchmark_run_threads("/object/object/write/threads", benchmark_object_write_threads);
 }
@@ -0,0 +1,325 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Measures how long it takes to start and shut down JULEA.
+ *
+ * Every iteration loads and parses the configuration, initializes JULEA and executes a first batch that contacts every server.
+ * Connections are only established on first use, so the first batch includes connecting to the servers and the capability pings.
+ * Afterwards, JULEA is shut down again.
+ * The number of servers and max-connections can be overridden to measure how startup scales with them.
+ *
+ * If built with MPI, all ranks start at the same time after a barrier, like the processes of a parallel job.
+ * Rank 0 reports the slowest rank's times, because a job can only start once all of its processes have.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <julea.h>
+#include <julea-kv.h>
+#include <julea-object.h>
+
+static gint opt_iterations = 10;
+static gint opt_servers = 0;
+static gint opt_max_connections = 0;
+static gboolean opt_machine_readable = FALSE;
+
+enum BenchmarkStartupPhase
+{
+	BENCHMARK_STARTUP_CONFIGURATION,
+	BENCHMARK_STARTUP_INIT,
+	BENCHMARK_STARTUP_FIRST_BATCH,
+	BENCHMARK_STARTUP_FINI,
+	BENCHMARK_STARTUP_PHASES
+};
+
+typedef enum BenchmarkStartupPhase BenchmarkStartupPhase;
+
+static gchar const* const benchmark_startup_phases[] = {
+	"configuration",
+	"init",
+	"first-batch",
+	"fini"
+};
+
+/**
+ * Keeps only the first servers of a type.
+ */
+static
+void
+benchmark_startup_limit_servers (GKeyFile* key_file, gchar const* type, guint limit)
+{
+	g_auto(GStrv) servers = NULL;
+	gsize servers_len = 0;
+
+	servers = g_key_file_get_string_list(key_file, "servers", type, &servers_len, NULL);
+
+	if (servers != NULL && servers_len > limit)
+	{
+		g_key_file_set_string_list(key_file, "servers", type, (gchar const* const*)servers, limit);
+	}
+}
+
+/**
+ * Loads the configuration and applies the overrides.
+ */
+static
+JConfiguration*
+benchmark_startup_configuration (void)
+{
+	JConfiguration* configuration;
+	GKeyFile* key_file;
+
+	if ((key_file = j_configuration_load_key_file()) == NULL)
+	{
+		return NULL;
+	}
+
+	if (opt_servers > 0)
+	{
+		benchmark_startup_limit_servers(key_file, "object", opt_servers);
+		benchmark_startup_limit_servers(key_file, "kv", opt_servers);
+	}
+
+	if (opt_max_connections > 0)
+	{
+		g_key_file_set_integer(key_file, "clients", "max-connections", opt_max_connections);
+	}
+
+	configuration = j_configuration_new_for_data(key_file);
+	g_key_file_free(key_file);
+
+	return configuration;
+}
+
+/**
+ * Executes a batch that contacts every object and key-value server.
+ * The accessed object and key do not exist, so no data is transferred.
+ */
+static
+void
+benchmark_startup_first_batch (void)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(GPtrArray) objects = NULL;
+	g_autoptr(GPtrArray) kvs = NULL;
+	g_autofree GBytes** values = NULL;
+	JConfiguration* configuration;
+	guint32 object_count;
+	guint32 kv_count;
+	gint64 modification_time;
+	guint64 size;
+
+	configuration = j_configuration();
+	object_count = j_configuration_get_object_server_count(configuration);
+	kv_count = j_configuration_get_kv_server_count(configuration);
+
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	batch = j_batch_new(semantics);
+
+	objects = g_ptr_array_new_with_free_func((GDestroyNotify)j_object_unref);
+	kvs = g_ptr_array_new_with_free_func((GDestroyNotify)j_kv_unref);
+	values = g_new0(GBytes*, kv_count);
+
+	for (guint32 i = 0; i < object_count; i++)
+	{
+		JObject* object;
+
+		object = j_object_new_for_index(i, "benchmark-startup", "startup");
+		j_object_status(object, &modification_time, &size, batch);
+		g_ptr_array_add(objects, object);
+	}
+
+	for (guint32 i = 0; i < kv_count; i++)
+	{
+		JKV* kv;
+
+		kv = j_kv_new_for_index(i, "benchmark-startup", "startup");
+		j_kv_get_raw(kv, &(values[i]), batch);
+		g_ptr_array_add(kvs, kv);
+	}
+
+	/* Neither the object nor the key exist, so the batch is expected to fail. */
+	j_batch_execute(batch);
+
+	for (guint32 i = 0; i < kv_count; i++)
+	{
+		if (values[i] != NULL)
+		{
+			g_bytes_unref(values[i]);
+		}
+	}
+}
+
+static
+void
+benchmark_startup_run (gdouble* elapsed)
+{
+	g_autoptr(GTimer) timer = NULL;
+	JConfiguration* configuration;
+
+	timer = g_timer_new();
+
+	configuration = benchmark_startup_configuration();
+	elapsed[BENCHMARK_STARTUP_CONFIGURATION] = g_timer_elapsed(timer, NULL);
+
+	if (configuration == NULL)
+	{
+		g_error("Failed to load the configuration.");
+	}
+
+	g_timer_start(timer);
+	j_init_for_configuration(configuration);
+	j_configuration_unref(configuration);
+	elapsed[BENCHMARK_STARTUP_INIT] = g_timer_elapsed(timer, NULL);
+
+	g_timer_start(timer);
+	benchmark_startup_first_batch();
+	elapsed[BENCHMARK_STARTUP_FIRST_BATCH] = g_timer_elapsed(timer, NULL);
+
+	g_timer_start(timer);
+	j_fini();
+	elapsed[BENCHMARK_STARTUP_FINI] = g_timer_elapsed(timer, NULL);
+}
+
+int
+main (int argc, char** argv)
+{
+	GError* error = NULL;
+	GOptionContext* context;
+	g_autoptr(JConfiguration) configuration = NULL;
+	gdouble min[BENCHMARK_STARTUP_PHASES];
+	gdouble max[BENCHMARK_STARTUP_PHASES];
+	gdouble mean[BENCHMARK_STARTUP_PHASES];
+	gint rank = 0;
+	gint size = 1;
+
+	GOptionEntry entries[] = {
+		{ "iterations", 'i', 0, G_OPTION_ARG_INT, &opt_iterations, "Number of measured startups", "10" },
+		{ "servers", 0, 0, G_OPTION_ARG_INT, &opt_servers, "Maximum number of object and key-value servers to use, 0 for all", "0" },
+		{ "max-connections", 0, 0, G_OPTION_ARG_INT, &opt_max_connections, "Override the maximum number of connections, 0 to keep the configured one", "0" },
+		{ "machine-readable", 0, 0, G_OPTION_ARG_NONE, &opt_machine_readable, "Produce machine-readable output", NULL },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+#ifdef HAVE_MPI
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+#endif
+
+	context = g_option_context_new(NULL);
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_option_context_free(context);
+
+		if (error)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+
+		return 1;
+	}
+
+	g_option_context_free(context);
+
+	if (opt_iterations <= 0 || opt_servers < 0 || opt_max_connections < 0)
+	{
+		g_printerr("Invalid arguments.\n");
+		return 1;
+	}
+
+	for (guint i = 0; i < BENCHMARK_STARTUP_PHASES; i++)
+	{
+		min[i] = G_MAXDOUBLE;
+		max[i] = 0.0;
+		mean[i] = 0.0;
+	}
+
+	for (gint i = 0; i < opt_iterations; i++)
+	{
+		gdouble elapsed[BENCHMARK_STARTUP_PHASES];
+
+#ifdef HAVE_MPI
+		MPI_Barrier(MPI_COMM_WORLD);
+#endif
+
+		benchmark_startup_run(elapsed);
+
+#ifdef HAVE_MPI
+		MPI_Allreduce(MPI_IN_PLACE, elapsed, BENCHMARK_STARTUP_PHASES, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+#endif
+
+		for (guint j = 0; j < BENCHMARK_STARTUP_PHASES; j++)
+		{
+			min[j] = MIN(min[j], elapsed[j]);
+			max[j] = MAX(max[j], elapsed[j]);
+			mean[j] += elapsed[j] / opt_iterations;
+		}
+	}
+
+	if (rank == 0)
+	{
+		configuration = benchmark_startup_configuration();
+
+		if (opt_machine_readable)
+		{
+			g_print("phase  ranks  object_servers  kv_servers  max_connections  mean  min  max\n");
+		}
+		else
+		{
+			g_print("%d ranks, %u object servers, %u key-value servers, %u maximum connections\n", size,
+				j_configuration_get_object_server_count(configuration), j_configuration_get_kv_server_count(configuration), j_configuration_get_max_connections(configuration));
+		}
+
+		for (guint i = 0; i < BENCHMARK_STARTUP_PHASES; i++)
+		{
+			if (opt_machine_readable)
+			{
+				g_print("%s %d %u %u %u %f %f %f\n", benchmark_startup_phases[i], size,
+					j_configuration_get_object_server_count(configuration), j_configuration_get_kv_server_count(configuration), j_configuration_get_max_connections(configuration),
+					mean[i], min[i], max[i]);
+			}
+			else
+			{
+				g_autofree gchar* left = NULL;
+
+				left = g_strconcat(benchmark_startup_phases[i], ":", NULL);
+				g_print("%-20s %.6f seconds (%.6f-%.6f seconds)\n", left, mean[i], min[i], max[i]);
+			}
+		}
+	}
+
+#ifdef HAVE_MPI
+	MPI_Finalize();
+#endif
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Support for running benchmarks with increasing numbers of threads.
+ *
+ * A benchmark registered with j_benchmark_run_threads() is run once per thread count,
+ * starting with one thread and doubling the count up to --threads (defaults to the number of processors).
+ * Each run shows up as a separate benchmark whose name is suffixed with the thread count,
+ * so throughput that stops growing or drops exposes contention.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include "benchmark.h"
+
+static gint opt_threads = 0;
+
+static guint j_benchmark_threads = 1;
+
+struct BenchmarkThread
+{
+	BenchmarkThreadFunc func;
+	gpointer data;
+	guint index;
+
+	/**
+	 * All threads wait for this to become TRUE, so that they start at the same time.
+	 */
+	gint* start;
+};
+
+typedef struct BenchmarkThread BenchmarkThread;
+
+static
+gpointer
+j_benchmark_thread (gpointer data)
+{
+	BenchmarkThread* thread = data;
+
+	while (!g_atomic_int_get(thread->start))
+	{
+		g_thread_yield();
+	}
+
+	(*(thread->func))(thread->index, thread->data);
+
+	return NULL;
+}
+
+/**
+ * Returns the options for the thread sweeps.
+ */
+GOptionGroup*
+j_benchmark_threads_get_option_group (void)
+{
+	GOptionGroup* group;
+
+	static GOptionEntry entries[] = {
+		{ "threads", 0, 0, G_OPTION_ARG_INT, &opt_threads, "Maximum number of threads for scaling benchmarks", "0" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	group = g_option_group_new("threads", "Thread scaling options", "Show thread scaling options", NULL, NULL);
+	g_option_group_add_entries(group, entries);
+
+	return group;
+}
+
+/**
+ * Returns the number of threads of the current run.
+ */
+guint
+j_benchmark_get_threads (void)
+{
+	return j_benchmark_threads;
+}
+
+/**
+ * Executes a function on the current number of threads and waits for all of them to finish.
+ * The threads are created before they are released at the same time.
+ */
+void
+j_benchmark_threads_execute (BenchmarkThreadFunc func, gpointer data)
+{
+	g_autofree GThread** threads = NULL;
+	g_autofree BenchmarkThread* thread_data = NULL;
+	gint start = FALSE;
+
+	g_return_if_fail(func != NULL);
+
+	threads = g_new(GThread*, j_benchmark_threads);
+	thread_data = g_new(BenchmarkThread, j_benchmark_threads);
+
+	for (guint i = 0; i < j_benchmark_threads; i++)
+	{
+		thread_data[i].func = func;
+		thread_data[i].data = data;
+		thread_data[i].index = i;
+		thread_data[i].start = &start;
+
+		threads[i] = g_thread_new("benchmark", j_benchmark_thread, &(thread_data[i]));
+	}
+
+	g_atomic_int_set(&start, TRUE);
+
+	for (guint i = 0; i < j_benchmark_threads; i++)
+	{
+		g_thread_join(threads[i]);
+	}
+}
+
+/**
+ * Runs a benchmark for 1, 2, 4, ... threads, up to the maximum number of threads.
+ * The benchmark gets the current number using j_benchmark_get_threads() and usually calls j_benchmark_threads_execute().
+ */
+void
+j_benchmark_run_threads (gchar const* name, BenchmarkFunc benchmark_func)
+{
+	guint max_threads;
+
+	g_return_if_fail(name != NULL);
+	g_return_if_fail(benchmark_func != NULL);
+
+	max_threads = (opt_threads > 0) ? (guint)opt_threads : g_get_num_processors();
+
+	for (guint threads = 1; threads <= max_threads; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2)
+	{
+		g_autofree gchar* threads_name = NULL;
+
+		threads_name = g_strdup_printf("%s/%u", name, threads);
+
+		j_benchmark_threads = threads;
+		j_benchmark_run(threads_name, benchmark_func);
+	}
+
+	j_benchmark_threads = 1;
+}
@@ -0,0 +1,81 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include "benchmark.h"
+
+/**
+ * Measures the cost of trace points.
+ * Without J_TRACE, this is the overhead every traced function pays.
+ */
+static
+void
+_benchmark_trace_enter_leave (BenchmarkResult* result, gboolean inline_check)
+{
+	guint const n = 10000000;
+
+	gdouble elapsed;
+
+	j_benchmark_timer_start();
+
+	for (guint i = 0; i < n; i++)
+	{
+		if (inline_check)
+		{
+			j_trace_enter(G_STRFUNC, NULL);
+			j_trace_leave(G_STRFUNC);
+		}
+		else
+		{
+			/* Calls the functions unconditionally, like trace points used to. */
+			j_trace_enter_real(G_STRFUNC, NULL);
+			j_trace_leave_real(G_STRFUNC);
+		}
+	}
+
+	elapsed = j_benchmark_timer_elapsed();
+
+	result->elapsed_time = elapsed;
+	result->operations = n;
+}
+
+static
+void
+benchmark_trace_enter_leave (BenchmarkResult* result)
+{
+	_benchmark_trace_enter_leave(result, TRUE);
+}
+
+static
+void
+benchmark_trace_enter_leave_call (BenchmarkResult* result)
+{
+	_benchmark_trace_enter_leave(result, FALSE);
+}
+
+void
+benchmark_trace (void)
+{
+	j_benchmark_run("/trace/enter-leave", benchmark_trace_enter_leave);
+	j_benchmark_run("/trace/enter-leave-call", benchmark_trace_enter_leave_call);
+}
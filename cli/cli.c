@@ -45,9 +45,9 @@ j_cmd_usage (void)
 	g_print("Commands:\n");
 	g_print("  create      uri\n");
 	g_print("  create-all  uri\n");
-	g_print("  copy        src-uri dst-uri\n");
+	g_print("  copy        [--buffers=N] [--jobs=N] src-uri dst-uri\n");
 	g_print("  delete      uri\n");
-	g_print("  list        uri\n");
+	g_print("  list        [-l] uri\n");
 	g_print("  status      uri\n");
 	g_print("\n");
 	g_print("URIs:\n");
@@ -57,6 +57,8 @@ j_cmd_usage (void)
 	g_print("  julea://collection[/item]\n");
 	g_print("  file://path\n");
 	g_print("\n");
+	g_print("Directories and collections are copied recursively.\n");
+	g_print("\n");
 }
 
 gboolean
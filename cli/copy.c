@@ -20,22 +20,796 @@
 
 #include "cli.h"
 
+#include <julea-internal.h>
+
 #include <gio/gio.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * One side of a copy.
+ * Exactly one of object, item and fd is set.
+ **/
+struct JCmdCopyEnd
+{
+	JObject* object;
+	JItem* item;
+	gint fd;
+};
+
+typedef struct JCmdCopyEnd JCmdCopyEnd;
+
+/**
+ * A buffer and the batch currently using it.
+ **/
+struct JCmdCopySlot
+{
+	JBatch* batch;
+	gchar* buffer;
+
+	guint64 offset;
+	guint64 length;
+
+	/**
+	 * The number of bytes read from and written to JULEA.
+	 **/
+	guint64 bytes_read;
+	guint64 bytes_written;
+
+	/**
+	 * The file the data read from JULEA is written to, -1 if there is none.
+	 **/
+	gint fd;
+
+	gboolean success;
+};
+
+typedef struct JCmdCopySlot JCmdCopySlot;
+
+/**
+ * One file of a recursive copy.
+ **/
+struct JCmdCopyJob
+{
+	gchar* name;
+
+	JCmdCopyEnd source;
+	JCmdCopyEnd destination;
+};
+
+typedef struct JCmdCopyJob JCmdCopyJob;
+
+/**
+ * A range of the source that has to be copied.
+ **/
+struct JCmdCopyRange
+{
+	guint64 offset;
+	guint64 length;
+};
+
+typedef struct JCmdCopyRange JCmdCopyRange;
+
+/**
+ * The number of buffers in flight per file.
+ **/
+static guint j_cmd_copy_buffers = 3;
+
+/**
+ * The number of files copied in parallel, 0 for one per processor.
+ **/
+static guint j_cmd_copy_jobs = 0;
+
+static gint j_cmd_copy_failed = 0;
+
+static
+void
+j_cmd_copy_end_init (JCmdCopyEnd* end)
+{
+	end->object = NULL;
+	end->item = NULL;
+	end->fd = -1;
+}
+
+static
+void
+j_cmd_copy_end_clear (JCmdCopyEnd* end)
+{
+	if (end->object != NULL)
+	{
+		j_object_unref(end->object);
+	}
+
+	if (end->item != NULL)
+	{
+		j_item_unref(end->item);
+	}
+
+	if (end->fd >= 0)
+	{
+		close(end->fd);
+	}
+
+	j_cmd_copy_end_init(end);
+}
+
+static
+gboolean
+j_cmd_copy_end_get_size (JCmdCopyEnd* end, guint64* size)
+{
+	gboolean ret = FALSE;
+
+	if (end->fd >= 0)
+	{
+		struct stat buf;
+
+		if (fstat(end->fd, &buf) == 0)
+		{
+			*size = buf.st_size;
+			ret = TRUE;
+		}
+	}
+	else
+	{
+		g_autoptr(JBatch) batch = NULL;
+
+		batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+		if (end->object != NULL)
+		{
+			gint64 modification_time;
+
+			j_object_status(end->object, &modification_time, size, batch);
+			ret = j_batch_execute(batch);
+		}
+		else
+		{
+			j_item_get_status(end->item, batch);
+			ret = j_batch_execute(batch);
+
+			*size = j_item_get_size(end->item);
+		}
+	}
+
+	return ret;
+}
+
+static
+gboolean
+j_cmd_copy_pread (gint fd, gchar* buffer, guint64 length, guint64 offset)
+{
+	while (length > 0)
+	{
+		gssize nbytes;
+
+		nbytes = pread(fd, buffer, length, offset);
+
+		if (nbytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (nbytes <= 0)
+		{
+			return FALSE;
+		}
+
+		buffer += nbytes;
+		length -= nbytes;
+		offset += nbytes;
+	}
+
+	return TRUE;
+}
+
+static
+gboolean
+j_cmd_copy_pwrite (gint fd, gchar const* buffer, guint64 length, guint64 offset)
+{
+	while (length > 0)
+	{
+		gssize nbytes;
+
+		nbytes = pwrite(fd, buffer, length, offset);
+
+		if (nbytes < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (nbytes <= 0)
+		{
+			return FALSE;
+		}
+
+		buffer += nbytes;
+		length -= nbytes;
+		offset += nbytes;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Writes the data read from JULEA to the destination file.
+ * Called from the batch's thread, so files are written in parallel, too.
+ **/
+static
+void
+j_cmd_copy_slot_completed (JBatch* batch, gboolean ret, gpointer data)
+{
+	JCmdCopySlot* slot = data;
+
+	(void)batch;
+
+	slot->success = ret;
+
+	if (ret && slot->fd >= 0)
+	{
+		slot->success = j_cmd_copy_pwrite(slot->fd, slot->buffer, slot->bytes_read, slot->offset);
+	}
+}
+
+static
+gboolean
+j_cmd_copy_slot_finish (JCmdCopySlot* slot)
+{
+	gboolean ret = TRUE;
+
+	if (slot->batch != NULL)
+	{
+		j_batch_wait(slot->batch);
+		ret = slot->success;
+
+		j_batch_unref(slot->batch);
+		slot->batch = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * Lets the destination read as zeros up to the source's size, so that the source's holes do not have to be copied.
+ * Destination files have just been created, destination objects might already contain data.
+ **/
+static
+gboolean
+j_cmd_copy_prepare_holes (JCmdCopyEnd* destination, guint64 size)
+{
+	gboolean ret = FALSE;
+
+	if (destination->fd >= 0)
+	{
+		ret = (ftruncate(destination->fd, size) == 0);
+	}
+	else if (destination->object != NULL)
+	{
+		g_autoptr(JBatch) batch = NULL;
+
+		batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+		j_object_truncate(destination->object, 0, batch);
+		j_object_truncate(destination->object, size, batch);
+		ret = j_batch_execute(batch);
+	}
+
+	return ret;
+}
+
+/**
+ * Determines the ranges of the source that have to be copied.
+ * Only the extents containing data are copied from objects, if the destination can be prepared accordingly.
+ * Items are striped over several objects and are always copied completely.
+ **/
+static
+GArray*
+j_cmd_copy_get_ranges (JCmdCopyEnd* source, JCmdCopyEnd* destination, guint64 size)
+{
+	GArray* ranges;
+	JCmdCopyRange range;
+
+	ranges = g_array_new(FALSE, FALSE, sizeof(JCmdCopyRange));
+
+	if (source->object != NULL && destination->item == NULL && size > 0 && j_cmd_copy_prepare_holes(destination, size))
+	{
+		guint64 lengths[64];
+		guint64 offsets[64];
+		guint64 position = 0;
+		guint count;
+
+		do
+		{
+			g_autoptr(JBatch) batch = NULL;
+
+			batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+			j_object_extents(source->object, size - position, position, lengths, offsets, G_N_ELEMENTS(lengths), &count, batch);
+
+			if (!j_batch_execute(batch))
+			{
+				/* The destination reads as zeros, so it can still be overwritten completely. */
+				g_array_set_size(ranges, 0);
+				goto full;
+			}
+
+			for (guint i = 0; i < count; i++)
+			{
+				range.offset = offsets[i];
+				range.length = lengths[i];
+				g_array_append_val(ranges, range);
+			}
+
+			if (count > 0)
+			{
+				position = offsets[count - 1] + lengths[count - 1];
+			}
+		}
+		while (count == G_N_ELEMENTS(lengths) && position < size);
+
+		return ranges;
+	}
+
+full:
+	range.offset = 0;
+	range.length = size;
+	g_array_append_val(ranges, range);
+
+	return ranges;
+}
+
+/**
+ * Copies the data from source to destination.
+ * The data is transferred in chunks of the items' optimal access size.
+ * Up to buffers chunks are in flight at the same time, so reading the next chunks overlaps with writing the previous ones.
+ **/
+static
+gboolean
+j_cmd_copy_data (JCmdCopyEnd* source, JCmdCopyEnd* destination, guint buffers)
+{
+	g_autofree JCmdCopySlot* slots = NULL;
+	g_autoptr(GArray) ranges = NULL;
+	gboolean ret = TRUE;
+	guint64 chunk_size = J_STRIPE_SIZE;
+	guint64 size;
+	guint next = 0;
+
+	if (!j_cmd_copy_end_get_size(source, &size))
+	{
+		return FALSE;
+	}
+
+	if (destination->item != NULL)
+	{
+		chunk_size = j_item_get_optimal_access_size(destination->item);
+	}
+	else if (source->item != NULL)
+	{
+		chunk_size = j_item_get_optimal_access_size(source->item);
+	}
+
+	slots = g_new0(JCmdCopySlot, buffers);
+	ranges = j_cmd_copy_get_ranges(source, destination, size);
+
+	for (guint r = 0; ret && r < ranges->len; r++)
+	{
+		JCmdCopyRange const* range = &g_array_index(ranges, JCmdCopyRange, r);
+
+		for (guint64 offset = range->offset; offset < range->offset + range->length; offset += chunk_size)
+		{
+			JCmdCopySlot* slot = &(slots[next]);
+
+			next = (next + 1) % buffers;
+
+			/* The slot's previous chunk has to be finished before its buffer can be reused. */
+			if (!(ret = j_cmd_copy_slot_finish(slot)))
+			{
+				break;
+			}
+
+			if (slot->buffer == NULL)
+			{
+				slot->buffer = g_malloc(chunk_size);
+			}
+
+			slot->offset = offset;
+			slot->length = MIN(chunk_size, range->offset + range->length - offset);
+			slot->bytes_read = slot->length;
+			slot->fd = destination->fd;
+			slot->success = TRUE;
+
+			if (source->fd >= 0)
+			{
+				if (!(ret = j_cmd_copy_pread(source->fd, slot->buffer, slot->length, offset)))
+				{
+					break;
+				}
+
+				if (destination->fd >= 0)
+				{
+					if (!(ret = j_cmd_copy_pwrite(destination->fd, slot->buffer, slot->length, offset)))
+					{
+						break;
+					}
+
+					continue;
+				}
+
+				/* The data has already been written to the buffer. */
+				slot->fd = -1;
+			}
+
+			slot->batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+			if (source->object != NULL)
+			{
+				j_object_read(source->object, slot->buffer, slot->length, offset, &(slot->bytes_read), slot->batch);
+			}
+			else if (source->item != NULL)
+			{
+				j_item_read(source->item, slot->buffer, slot->length, offset, &(slot->bytes_read), slot->batch);
+			}
+
+			/* The write is executed after the read of the same batch, the sizes are known in advance. */
+			if (destination->object != NULL)
+			{
+				j_object_write(destination->object, slot->buffer, slot->length, offset, &(slot->bytes_written), slot->batch);
+			}
+			else if (destination->item != NULL)
+			{
+				j_item_write(destination->item, slot->buffer, slot->length, offset, &(slot->bytes_written), slot->batch);
+			}
+
+			j_batch_execute_async(slot->batch, j_cmd_copy_slot_completed, slot);
+		}
+	}
+
+	for (guint i = 0; i < buffers; i++)
+	{
+		ret = j_cmd_copy_slot_finish(&(slots[i])) && ret;
+		g_free(slots[i].buffer);
+	}
+
+	return ret;
+}
+
+static
+void
+j_cmd_copy_job_free (JCmdCopyJob* job)
+{
+	j_cmd_copy_end_clear(&(job->source));
+	j_cmd_copy_end_clear(&(job->destination));
+
+	g_free(job->name);
+
+	g_slice_free(JCmdCopyJob, job);
+}
+
+static
+void
+j_cmd_copy_job_run (gpointer data, gpointer user_data)
+{
+	JCmdCopyJob* job = data;
+
+	(void)user_data;
+
+	if (!j_cmd_copy_data(&(job->source), &(job->destination), j_cmd_copy_buffers))
+	{
+		g_printerr("Error: Could not copy “%s”.\n", job->name);
+		g_atomic_int_set(&j_cmd_copy_failed, 1);
+	}
+
+	j_cmd_copy_job_free(job);
+}
+
+/**
+ * Items can not contain slashes, so the relative paths of imported files are escaped.
+ **/
+static
+gchar*
+j_cmd_copy_escape_name (gchar const* path)
+{
+	GString* name;
+
+	name = g_string_new(NULL);
+
+	for (; *path != '\0'; path++)
+	{
+		if (*path == '%')
+		{
+			g_string_append(name, "%25");
+		}
+		else if (*path == '/')
+		{
+			g_string_append(name, "%2F");
+		}
+		else
+		{
+			g_string_append_c(name, *path);
+		}
+	}
+
+	return g_string_free(name, FALSE);
+}
+
+/**
+ * Returns the relative path an item is exported to, NULL if it would leave the destination directory.
+ **/
+static
+gchar*
+j_cmd_copy_unescape_name (gchar const* name)
+{
+	g_auto(GStrv) components = NULL;
+	gchar* path;
+
+	if ((path = g_uri_unescape_string(name, NULL)) == NULL)
+	{
+		path = g_strdup(name);
+	}
+
+	components = g_strsplit(path, "/", 0);
+
+	for (guint i = 0; components[i] != NULL; i++)
+	{
+		if (components[i][0] == '\0' || g_strcmp0(components[i], ".") == 0 || g_strcmp0(components[i], "..") == 0)
+		{
+			g_free(path);
+			return NULL;
+		}
+	}
+
+	return path;
+}
+
+static
+void
+j_cmd_copy_list_directory (gchar const* base, gchar const* relative, GPtrArray* paths)
+{
+	g_autofree gchar* path = NULL;
+	GDir* dir;
+	gchar const* name;
+
+	path = (relative != NULL) ? g_build_filename(base, relative, NULL) : g_strdup(base);
+
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return;
+	}
+
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* child = NULL;
+		g_autofree gchar* child_path = NULL;
+
+		child = (relative != NULL) ? g_build_filename(relative, name, NULL) : g_strdup(name);
+		child_path = g_build_filename(base, child, NULL);
+
+		if (g_file_test(child_path, G_FILE_TEST_IS_SYMLINK))
+		{
+			continue;
+		}
+
+		if (g_file_test(child_path, G_FILE_TEST_IS_DIR))
+		{
+			j_cmd_copy_list_directory(base, child, paths);
+		}
+		else if (g_file_test(child_path, G_FILE_TEST_IS_REGULAR))
+		{
+			g_ptr_array_add(paths, g_steal_pointer(&child));
+		}
+	}
+
+	g_dir_close(dir);
+}
+
+/**
+ * Copies a directory or collection into a directory or collection.
+ * The files are copied by multiple threads.
+ * Existing items and files are overwritten.
+ **/
+static
+gboolean
+j_cmd_copy_recursive (gchar const* source_path, JURI* source_uri, gchar const* destination_path, JURI* destination_uri)
+{
+	g_autoptr(GPtrArray) jobs = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	GThreadPool* pool;
+	guint thread_count;
+
+	jobs = g_ptr_array_new();
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	if (source_path != NULL)
+	{
+		g_autoptr(GPtrArray) paths = NULL;
+
+		paths = g_ptr_array_new_with_free_func(g_free);
+		j_cmd_copy_list_directory(source_path, NULL, paths);
+
+		for (guint i = 0; i < paths->len; i++)
+		{
+			JCmdCopyJob* job;
+			g_autofree gchar* path = NULL;
+
+			path = g_build_filename(source_path, g_ptr_array_index(paths, i), NULL);
+
+			job = g_slice_new(JCmdCopyJob);
+			job->name = g_strdup(g_ptr_array_index(paths, i));
+			j_cmd_copy_end_init(&(job->source));
+			j_cmd_copy_end_init(&(job->destination));
+
+			if ((job->source.fd = open(path, O_RDONLY)) < 0)
+			{
+				g_printerr("Error: Could not open “%s”.\n", path);
+				j_cmd_copy_job_free(job);
+				continue;
+			}
+
+			g_ptr_array_add(jobs, job);
+		}
+	}
+	else
+	{
+		JItemIterator* iterator;
+
+		iterator = j_item_iterator_new(j_uri_get_collection(source_uri));
+
+		while (j_item_iterator_next(iterator))
+		{
+			JCmdCopyJob* job;
+			JItem* item;
+
+			item = j_item_iterator_get(iterator);
+
+			job = g_slice_new(JCmdCopyJob);
+			job->name = g_strdup(j_item_get_name(item));
+			j_cmd_copy_end_init(&(job->source));
+			j_cmd_copy_end_init(&(job->destination));
+			job->source.item = item;
+
+			g_ptr_array_add(jobs, job);
+		}
+
+		j_item_iterator_free(iterator);
+	}
+
+	for (guint i = 0; i < jobs->len; i++)
+	{
+		JCmdCopyJob* job = g_ptr_array_index(jobs, i);
+
+		if (destination_path != NULL)
+		{
+			g_autofree gchar* relative = NULL;
+			g_autofree gchar* path = NULL;
+			g_autofree gchar* dirname = NULL;
+
+			relative = (source_path != NULL) ? g_strdup(job->name) : j_cmd_copy_unescape_name(job->name);
+
+			if (relative == NULL)
+			{
+				g_printerr("Error: Can not export “%s”.\n", job->name);
+				continue;
+			}
+
+			path = g_build_filename(destination_path, relative, NULL);
+			dirname = g_path_get_dirname(path);
+
+			if (g_mkdir_with_parents(dirname, 0777) != 0 || (job->destination.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+			{
+				g_printerr("Error: Could not create “%s”.\n", path);
+			}
+		}
+		else
+		{
+			g_autofree gchar* name = NULL;
+
+			name = (source_path != NULL) ? j_cmd_copy_escape_name(job->name) : g_strdup(job->name);
+
+			/* All items are created with one batch. */
+			job->destination.item = j_item_create(j_uri_get_collection(destination_uri), name, NULL, batch);
+		}
+	}
+
+	if (destination_uri != NULL && jobs->len > 0 && !j_batch_execute(batch))
+	{
+		g_printerr("Error: Could not create items.\n");
+		g_atomic_int_set(&j_cmd_copy_failed, 1);
+	}
+
+	thread_count = (j_cmd_copy_jobs > 0) ? j_cmd_copy_jobs : g_get_num_processors();
+	pool = g_thread_pool_new(j_cmd_copy_job_run, NULL, thread_count, FALSE, NULL);
+
+	for (guint i = 0; i < jobs->len; i++)
+	{
+		JCmdCopyJob* job = g_ptr_array_index(jobs, i);
+
+		if (job->destination.item == NULL && job->destination.fd < 0)
+		{
+			g_atomic_int_set(&j_cmd_copy_failed, 1);
+			j_cmd_copy_job_free(job);
+			continue;
+		}
+
+		g_thread_pool_push(pool, job, NULL);
+	}
+
+	/* Waits for all jobs to finish. */
+	g_thread_pool_free(pool, FALSE, TRUE);
+
+	return !g_atomic_int_get(&j_cmd_copy_failed);
+}
+
+/**
+ * Parses a positive count, returning 0 if it is invalid.
+ **/
+static
+guint
+j_cmd_copy_parse_count (gchar const* value)
+{
+	gchar* end;
+	guint64 count;
+
+	count = g_ascii_strtoull(value, &end, 10);
+
+	if (value[0] == '\0' || *end != '\0' || count > 1024)
+	{
+		return 0;
+	}
+
+	return count;
+}
+
+/**
+ * Parses the options preceding the URIs.
+ *
+ * \return The first argument that is not an option, NULL on error.
+ **/
+static
+gchar const**
+j_cmd_copy_parse_options (gchar const** arguments)
+{
+	for (; *arguments != NULL && g_str_has_prefix(*arguments, "--"); arguments++)
+	{
+		if (g_str_has_prefix(*arguments, "--buffers="))
+		{
+			if ((j_cmd_copy_buffers = j_cmd_copy_parse_count(*arguments + strlen("--buffers="))) == 0)
+			{
+				return NULL;
+			}
+		}
+		else if (g_str_has_prefix(*arguments, "--jobs="))
+		{
+			if ((j_cmd_copy_jobs = j_cmd_copy_parse_count(*arguments + strlen("--jobs="))) == 0)
+			{
+				return NULL;
+			}
+		}
+		else
+		{
+			return NULL;
+		}
+	}
+
+	return arguments;
+}
+
 gboolean
 j_cmd_copy (gchar const** arguments)
 {
 	gboolean ret = TRUE;
+	JCmdCopyEnd end[2];
 	JObjectURI* ouri[2] = { NULL, NULL };
 	JURI* uri[2] = { NULL, NULL };
+	gchar* path[2] = { NULL, NULL };
+	gboolean directory[2] = { FALSE, FALSE };
 	GError* error;
-	GFile* file;
-	GFileIOStream* stream[2] = { NULL, NULL };
-	g_autofree gchar* buffer = NULL;
-	guint64 offset;
 	guint i;
 
-	if (j_cmd_arguments_length(arguments) != 2)
+	j_cmd_copy_end_init(&(end[0]));
+	j_cmd_copy_end_init(&(end[1]));
+
+	if ((arguments = j_cmd_copy_parse_options(arguments)) == NULL || j_cmd_arguments_length(arguments) != 2)
 	{
 		ret = FALSE;
 		j_cmd_usage();
@@ -58,16 +832,32 @@ j_cmd_copy (gchar const** arguments)
 				j_object_create(j_object_uri_get_object(ouri[i]), batch);
 				j_batch_execute(batch);
 			}
+
+			end[i].object = j_object_ref(j_object_uri_get_object(ouri[i]));
 		}
 		else if ((uri[i] = j_uri_new(arguments[i])) != NULL)
 		{
 			error = NULL;
 
+			/* Collections are copied recursively. */
 			if (j_uri_get_item_name(uri[i]) == NULL)
 			{
-				ret = FALSE;
-				j_cmd_usage();
-				goto end;
+				directory[i] = TRUE;
+
+				if (!j_uri_get(uri[i], &error))
+				{
+					g_clear_error(&error);
+
+					if (i == 0 || !j_uri_create(uri[i], FALSE, &error) || !j_uri_get(uri[i], &error))
+					{
+						ret = FALSE;
+						g_print("Error: %s\n", (error != NULL) ? error->message : "Invalid collection.");
+						g_clear_error(&error);
+						goto end;
+					}
+				}
+
+				continue;
 			}
 
 			if (i == 0)
@@ -114,117 +904,90 @@ j_cmd_copy (gchar const** arguments)
 
 				j_uri_get(uri[i], NULL);
 			}
+
+			end[i].item = j_item_ref(j_uri_get_item(uri[i]));
 		}
 		else
 		{
-			error = NULL;
+			GFile* file;
 
 			file = g_file_new_for_commandline_arg(arguments[i]);
+			path[i] = g_file_get_path(file);
+			g_object_unref(file);
+
+			if (path[i] == NULL)
+			{
+				ret = FALSE;
+				g_print("Error: “%s” is not a local file.\n", arguments[i]);
+				goto end;
+			}
+
+			/* Directories are copied recursively, missing destination directories are created. */
+			if (g_file_test(path[i], G_FILE_TEST_IS_DIR) || (i == 1 && directory[0]))
+			{
+				directory[i] = TRUE;
+				continue;
+			}
 
 			if (i == 0)
 			{
-				stream[i] = g_file_open_readwrite(file, NULL, &error);
+				end[i].fd = open(path[i], O_RDONLY);
 			}
 			else if (i == 1)
 			{
-				stream[i] = g_file_create_readwrite(file, G_FILE_CREATE_NONE, NULL, &error);
+				end[i].fd = open(path[i], O_WRONLY | O_CREAT | O_EXCL, 0666);
 			}
 
-			g_object_unref(file);
-
-			if (stream[i] == NULL)
+			if (end[i].fd < 0)
 			{
 				ret = FALSE;
-
-				if (error != NULL)
-				{
-					g_print("Error: %s\n", error->message);
-					g_error_free(error);
-				}
-
+				g_print("Error: Could not open “%s”: %s\n", path[i], g_strerror(errno));
 				goto end;
 			}
-
 		}
 	}
 
-	offset = 0;
-	buffer = g_new(gchar, 1024 * 1024);
-
-	while (TRUE)
+	if (directory[0] || directory[1])
 	{
-		g_autoptr(JBatch) batch = NULL;
-		guint64 bytes_read = 0;
-
-		batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
-
-		if (ouri[0] != NULL)
-		{
-			guint64 nbytes;
-
-			j_object_read(j_object_uri_get_object(ouri[0]), buffer, 1024 * 1024, offset, &nbytes, batch);
-			j_batch_execute(batch);
-
-			bytes_read = nbytes;
-		}
-		else if (uri[0] != NULL)
+		if (!directory[0] || !directory[1])
 		{
-			guint64 nbytes;
-
-			j_item_read(j_uri_get_item(uri[0]), buffer, 1024 * 1024, offset, &nbytes, batch);
-			j_batch_execute(batch);
-
-			bytes_read = nbytes;
+			ret = FALSE;
+			g_print("Error: Directories and collections can only be copied into directories and collections.\n");
+			goto end;
 		}
-		else if (stream[0] != NULL)
-		{
-			GInputStream* input;
-			gsize nbytes;
 
-			input = g_io_stream_get_input_stream(G_IO_STREAM(stream[0]));
-
-			g_input_stream_read_all(input, buffer, 1024 * 1024, &nbytes, NULL, NULL);
-			bytes_read = nbytes;
-		}
+		ret = j_cmd_copy_recursive(path[0], (path[0] == NULL) ? uri[0] : NULL, path[1], (path[1] == NULL) ? uri[1] : NULL);
+		goto end;
+	}
 
-		if (ouri[1] != NULL)
-		{
-			guint64 dummy;
+	/* Objects are copied by the servers, so the data does not have to pass through the client. */
+	if (ouri[0] != NULL && ouri[1] != NULL)
+	{
+		g_autoptr(JBatch) batch = NULL;
+		guint64 bytes_copied;
 
-			j_object_write(j_object_uri_get_object(ouri[1]), buffer, bytes_read, offset, &dummy, batch);
-			j_batch_execute(batch);
-		}
-		else if (uri[1] != NULL)
-		{
-			guint64 dummy;
+		batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+		j_object_copy(j_object_uri_get_object(ouri[0]), j_object_uri_get_object(ouri[1]), &bytes_copied, batch);
 
-			j_item_write(j_uri_get_item(uri[1]), buffer, bytes_read, offset, &dummy, batch);
-			j_batch_execute(batch);
-		}
-		else if (stream[1] != NULL)
+		if (!j_batch_execute(batch))
 		{
-			GOutputStream* output;
-
-			output = g_io_stream_get_output_stream(G_IO_STREAM(stream[1]));
-
-			g_output_stream_write_all(output, buffer, bytes_read, NULL, NULL, NULL);
+			ret = FALSE;
+			g_print("Error: Could not copy object.\n");
 		}
 
-		offset += bytes_read;
+		goto end;
+	}
 
-		if (bytes_read < 1024 * 1024)
-		{
-			break;
-		}
+	if (!j_cmd_copy_data(&(end[0]), &(end[1]), j_cmd_copy_buffers))
+	{
+		ret = FALSE;
+		g_print("Error: Could not copy data.\n");
 	}
 
 end:
 	for (i = 0; i <= 1; i++)
 	{
-		if (stream[i] != NULL)
-		{
-			g_object_unref(stream[i]);
-		}
+		j_cmd_copy_end_clear(&(end[i]));
 
 		if (ouri[i] != NULL)
 		{
@@ -235,6 +998,8 @@ end:
 		{
 			j_uri_free(uri[i]);
 		}
+
+		g_free(path[i]);
 	}
 
 	return ret;
@@ -26,6 +26,13 @@ j_cmd_list (gchar const** arguments)
 	gboolean ret = TRUE;
 	g_autoptr(JURI) uri = NULL;
 	GError* error = NULL;
+	gboolean long_format = FALSE;
+
+	if (g_strcmp0(arguments[0], "-l") == 0)
+	{
+		long_format = TRUE;
+		arguments++;
+	}
 
 	if (j_cmd_arguments_length(arguments) != 1)
 	{
@@ -57,14 +64,31 @@ j_cmd_list (gchar const** arguments)
 	else if (j_uri_get_collection(uri) != NULL)
 	{
 		JItemIterator* iterator;
+		/* The status is stored with the items, so the servers only have to send the required fields. */
+		gchar const* name_fields[] = { NULL };
+		gchar const* status_fields[] = { "status", NULL };
 
-		iterator = j_item_iterator_new(j_uri_get_collection(uri));
+		iterator = j_item_iterator_new_filter(j_uri_get_collection(uri), NULL, (long_format) ? status_fields : name_fields);
 
+		/* The items are printed as they are received. */
 		while (j_item_iterator_next(iterator))
 		{
 			JItem* item_ = j_item_iterator_get(iterator);
 
-			g_print("%s\n", j_item_get_name(item_));
+			if (long_format)
+			{
+				g_autoptr(GDateTime) date_time = NULL;
+				g_autofree gchar* modification_time_string = NULL;
+
+				date_time = g_date_time_new_from_unix_local(j_item_get_modification_time(item_) / G_USEC_PER_SEC);
+				modification_time_string = g_date_time_format(date_time, "%Y-%m-%d %H:%M:%S");
+
+				g_print("%12" G_GUINT64_FORMAT " %s %s\n", j_item_get_size(item_), modification_time_string, j_item_get_name(item_));
+			}
+			else
+			{
+				g_print("%s\n", j_item_get_name(item_));
+			}
 
 			j_item_unref(item_);
 		}
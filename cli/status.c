@@ -152,7 +152,19 @@ j_cmd_status (gchar const** arguments)
 		}
 		else if (j_uri_get_collection(uri) != NULL)
 		{
+			JCollectionStats stats;
+			g_autoptr(GDateTime) date_time = NULL;
+			g_autofree gchar* modification_time_string = NULL;
+
+			/* The statistics are maintained incrementally, so the items do not have to be queried. */
+			j_collection_get_stats(j_uri_get_collection(uri), &stats, batch);
+			j_batch_execute(batch);
+
+			date_time = g_date_time_new_from_unix_local(stats.modification_time / G_USEC_PER_SEC);
+			modification_time_string = g_date_time_format(date_time, "%Y-%m-%d %H:%M:%S");
 
+			g_print("Items:             %" G_GUINT64_FORMAT "\n", stats.item_count);
+			g_print("Modification time: %s.%06" G_GUINT64_FORMAT "\n", modification_time_string, stats.modification_time % G_USEC_PER_SEC);
 		}
 		else
 		{
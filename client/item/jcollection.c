@@ -28,12 +28,14 @@
 
 #include <item/jcollection.h>
 #include <item/jcollection-internal.h>
+#include <item/jmetadata-cache-internal.h>
 
 #include <item/jitem.h>
 #include <item/jitem-internal.h>
 
 #include <julea.h>
 #include <julea-kv.h>
+#include <julea-object.h>
 
 /**
  * \defgroup JCollection Collection
@@ -177,6 +179,7 @@ j_collection_create (gchar const* name, JBatch* batch)
 
 	value = j_collection_serialize(collection);
 
+	j_metadata_cache_remove(j_metadata_cache_collections(), name);
 	j_kv_put(collection->kv, value, batch);
 
 end:
@@ -190,10 +193,12 @@ j_collection_get_callback (bson_t const* value, gpointer data)
 	JCollection** collection = data;
 
 	*collection = j_collection_new_from_bson(value);
+	j_metadata_cache_insert(j_metadata_cache_collections(), (*collection)->name, *collection);
 }
 
 /**
  * Gets a collection.
+ * Batches with eventual consistency may use a cached collection, which is returned immediately.
  *
  * \author Michael Kuhn
  *
@@ -212,6 +217,14 @@ j_collection_get (JCollection** collection, gchar const* name, JBatch* batch)
 	g_return_if_fail(collection != NULL);
 	g_return_if_fail(name != NULL);
 
+	if (j_metadata_cache_is_usable(j_batch_get_semantics(batch)))
+	{
+		if ((*collection = j_metadata_cache_lookup(j_metadata_cache_collections(), name)) != NULL)
+		{
+			return;
+		}
+	}
+
 	kv = j_kv_new("collections", name);
 	j_kv_get_callback(kv, j_collection_get_callback, collection, batch);
 }
@@ -230,12 +243,99 @@ j_collection_get (JCollection** collection, gchar const* name, JBatch* batch)
 void
 j_collection_delete (JCollection* collection, JBatch* batch)
 {
+	g_autofree gchar* prefix = NULL;
+
+	g_return_if_fail(collection != NULL);
+	g_return_if_fail(batch != NULL);
+
+	prefix = g_strconcat(collection->name, "/", NULL);
+
+	j_metadata_cache_remove(j_metadata_cache_collections(), collection->name);
+	j_metadata_cache_remove_prefix(j_metadata_cache_items(), prefix);
+
+	j_kv_delete(collection->kv, batch);
+}
+
+/**
+ * Deletes a collection together with all of its items and their data.
+ * Instead of deleting every item individually, all servers remove the items' metadata and objects concurrently.
+ * The items' objects can only be removed by object backends that support purging.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param collection A collection.
+ * \param batch      A batch.
+ **/
+void
+j_collection_delete_recursive (JCollection* collection, JBatch* batch)
+{
+	g_autofree gchar* prefix = NULL;
+
 	g_return_if_fail(collection != NULL);
 	g_return_if_fail(batch != NULL);
 
+	prefix = g_strconcat(collection->name, "/", NULL);
+
+	j_metadata_cache_remove(j_metadata_cache_collections(), collection->name);
+	j_metadata_cache_remove_prefix(j_metadata_cache_items(), prefix);
+
+	j_kv_delete_by_prefix("items", prefix, batch);
+	j_distributed_object_purge("item", collection->name, batch);
 	j_kv_delete(collection->kv, batch);
 }
 
+static
+void
+j_collection_get_stats_callback (bson_t const* value, gpointer data)
+{
+	JCollectionStats* stats = data;
+	bson_iter_t iter;
+
+	if (bson_iter_init_find(&iter, value, "item_count") && BSON_ITER_HOLDS_NUMBER(&iter))
+	{
+		stats->item_count = MAX(bson_iter_as_int64(&iter), 0);
+	}
+
+	if (bson_iter_init_find(&iter, value, "modification_time") && BSON_ITER_HOLDS_NUMBER(&iter))
+	{
+		stats->modification_time = bson_iter_as_int64(&iter);
+	}
+}
+
+/**
+ * Gets a collection's statistics.
+ * The statistics are maintained together with the collection's metadata, so no items have to be iterated.
+ * The total size of the items is not maintained, because concurrent writes can not be accounted for exactly; it has to be computed from the items' statuses.
+ * The statistics have to be kept alive until the batch has been executed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JCollectionStats stats;
+ *
+ * j_collection_get_stats(collection, &stats, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param collection A collection.
+ * \param stats      The statistics.
+ * \param batch      A batch.
+ **/
+void
+j_collection_get_stats (JCollection* collection, JCollectionStats* stats, JBatch* batch)
+{
+	g_return_if_fail(collection != NULL);
+	g_return_if_fail(stats != NULL);
+
+	stats->item_count = 0;
+	stats->modification_time = 0;
+
+	j_kv_get_callback(collection->kv, j_collection_get_stats_callback, stats, batch);
+}
+
 /* Internal */
 
 /**
@@ -459,6 +559,45 @@ j_collection_get_id (JCollection* collection)
 	return &(collection->id);
 }
 
+/**
+ * Updates a collection's statistics.
+ * The item count is incremented atomically by the KV server, the modification time is max-merged.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param collection        A collection.
+ * \param item_delta        The change of the number of items.
+ * \param modification_time A modification time.
+ * \param batch             A batch.
+ **/
+void
+j_collection_update_stats (JCollection* collection, gint64 item_delta, gint64 modification_time, JBatch* batch)
+{
+	bson_t maxima[1];
+
+	g_return_if_fail(collection != NULL);
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (item_delta != 0)
+	{
+		j_kv_increment(collection->kv, "item_count", item_delta, NULL, batch);
+	}
+
+	bson_init(maxima);
+	bson_append_int64(maxima, "modification_time", -1, modification_time);
+	j_kv_max_merge(collection->kv, maxima, batch);
+	bson_destroy(maxima);
+
+	j_trace_leave(G_STRFUNC);
+}
+
 /**
  * @}
  **/
@@ -70,7 +70,61 @@ j_item_iterator_new (JCollection* collection)
 
 	iterator = g_slice_new(JItemIterator);
 	iterator->collection = j_collection_ref(collection);
-	iterator->iterator = j_kv_iterator_new(0, "items", prefix);
+	iterator->iterator = j_kv_iterator_new_for_prefix("items", prefix);
+
+	return iterator;
+}
+
+/**
+ * Creates a new JItemIterator that only returns items matching a filter.
+ * The filter refers to the items' serialized fields, for example, "status.size".
+ * If fields are given, the returned items only contain these fields, which is sufficient for listings.
+ * The fields required to construct items (_id, name and distribution) are always included.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * gchar const* fields[] = { "status", NULL };
+ * JItemIterator* iterator;
+ *
+ * iterator = j_item_iterator_new_filter(collection, NULL, fields);
+ * \endcode
+ *
+ * \param collection A JCollection.
+ * \param filter     A filter, NULL to return all items.
+ * \param fields     A NULL-terminated array of field names, NULL to return complete items.
+ *
+ * \return A new JItemIterator.
+ **/
+JItemIterator*
+j_item_iterator_new_filter (JCollection* collection, bson_t const* filter, gchar const* const* fields)
+{
+	JItemIterator* iterator;
+	g_autoptr(GPtrArray) item_fields = NULL;
+	g_autofree gchar* prefix = NULL;
+
+	g_return_val_if_fail(collection != NULL, NULL);
+
+	prefix = g_strdup_printf("%s/", j_collection_get_name(collection));
+
+	if (fields != NULL)
+	{
+		item_fields = g_ptr_array_new();
+		g_ptr_array_add(item_fields, (gpointer)"_id");
+		g_ptr_array_add(item_fields, (gpointer)"name");
+		g_ptr_array_add(item_fields, (gpointer)"distribution");
+
+		for (guint i = 0; fields[i] != NULL; i++)
+		{
+			g_ptr_array_add(item_fields, (gpointer)fields[i]);
+		}
+
+		g_ptr_array_add(item_fields, NULL);
+	}
+
+	iterator = g_slice_new(JItemIterator);
+	iterator->collection = j_collection_ref(collection);
+	iterator->iterator = j_kv_iterator_new_filter("items", prefix, filter, (item_fields != NULL) ? (gchar const* const*)item_fields->pdata : NULL);
 
 	return iterator;
 }
@@ -34,6 +34,8 @@
 #include <item/jcollection.h>
 #include <item/jcollection-internal.h>
 
+#include <item/jmetadata-cache-internal.h>
+
 #include <julea.h>
 #include <julea-kv.h>
 #include <julea-object.h>
@@ -54,6 +56,88 @@ struct JItemGetData
 
 typedef struct JItemGetData JItemGetData;
 
+struct JItemGetManyData
+{
+	JCollection* collection;
+	JItem** items;
+
+	/**
+	 * The positions in items of the fetched values, which skip cached items.
+	 */
+	guint32* indices;
+};
+
+typedef struct JItemGetManyData JItemGetManyData;
+
+/**
+ * A range of items deserialized by one thread.
+ */
+struct JItemDeserializeData
+{
+	JCollection* collection;
+	JItem** items;
+	guint32 const* indices;
+	GBytes** values;
+	guint32 start;
+	guint32 end;
+};
+
+typedef struct JItemDeserializeData JItemDeserializeData;
+
+/**
+ * A write of an item.
+ * The item's stored status is only updated after its data has been written.
+ */
+struct JItemWriteOperation
+{
+	JItem* item;
+
+	gconstpointer data;
+	guint64 length;
+	guint64 offset;
+
+	/**
+	 * The caller's counter, which might be shared by several writes.
+	 */
+	guint64* bytes_written;
+
+	/**
+	 * The number of bytes written by this write only.
+	 */
+	guint64 written;
+
+	guint64 cached_bytes_written;
+};
+
+typedef struct JItemWriteOperation JItemWriteOperation;
+
+/**
+ * A truncate of an item.
+ * The item's stored status is only updated after its data has been truncated.
+ */
+struct JItemTruncateOperation
+{
+	JItem* item;
+	guint64 size;
+};
+
+typedef struct JItemTruncateOperation JItemTruncateOperation;
+
+/**
+ * The result of reading an item's stored status.
+ */
+struct JItemStatusData
+{
+	JItem* item;
+
+	/**
+	 * Whether the stored metadata contained a status.
+	 */
+	gboolean found;
+};
+
+typedef struct JItemStatusData JItemStatusData;
+
 /**
  * A JItem.
  **/
@@ -69,6 +153,12 @@ struct JItem
 	 **/
 	gchar* name;
 
+	/**
+	 * The name of the item's object.
+	 * It does not depend on the item's name, so that renaming an item does not have to move its data.
+	 **/
+	gchar* object_name;
+
 	JCredentials* credentials;
 	JDistribution* distribution;
 
@@ -96,6 +186,12 @@ struct JItem
 	}
 	status;
 
+	/**
+	 * The user-defined attributes.
+	 * Maps names to values, both strings, and is NULL if there are none.
+	 **/
+	GHashTable* attributes;
+
 	/**
 	 * The parent collection.
 	 **/
@@ -107,6 +203,8 @@ struct JItem
 	gint ref_count;
 };
 
+static bson_t* j_item_serialize_full (JItem*, gboolean);
+
 /**
  * Increases an item's reference count.
  *
@@ -171,9 +269,15 @@ j_item_unref (JItem* item)
 			j_collection_unref(item->collection);
 		}
 
+		if (item->attributes != NULL)
+		{
+			g_hash_table_unref(item->attributes);
+		}
+
 		j_credentials_unref(item->credentials);
 		j_distribution_unref(item->distribution);
 
+		g_free(item->object_name);
 		g_free(item->name);
 
 		g_slice_free(JItem, item);
@@ -225,6 +329,7 @@ j_item_create (JCollection* collection, gchar const* name, JDistribution* distri
 {
 	JItem* item;
 	bson_t* value;
+	g_autofree gchar* path = NULL;
 
 	g_return_val_if_fail(collection != NULL, NULL);
 	g_return_val_if_fail(name != NULL, NULL);
@@ -238,15 +343,33 @@ j_item_create (JCollection* collection, gchar const* name, JDistribution* distri
 
 	value = j_item_serialize(item, j_batch_get_semantics(batch));
 
+	path = g_build_path("/", j_collection_get_name(collection), name, NULL);
+	j_metadata_cache_remove(j_metadata_cache_items(), path);
+
 	j_distributed_object_create(item->object, batch);
 	j_kv_put(item->kv, value, batch);
 
+	j_collection_update_stats(collection, 1, item->status.modification_time, batch);
+
 end:
 	j_trace_leave(G_STRFUNC);
 
 	return item;
 }
 
+/**
+ * Caches an item under its KV key.
+ */
+static
+void
+j_item_cache_insert (JItem* item)
+{
+	g_autofree gchar* path = NULL;
+
+	path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
+	j_metadata_cache_insert(j_metadata_cache_items(), path, item);
+}
+
 static
 void
 j_item_get_callback (bson_t const* value, gpointer data_)
@@ -254,6 +377,7 @@ j_item_get_callback (bson_t const* value, gpointer data_)
 	JItemGetData* data = data_;
 
 	*(data->item) = j_item_new_from_bson(data->collection, value);
+	j_item_cache_insert(*(data->item));
 
 	j_collection_unref(data->collection);
 	g_slice_free(JItemGetData, data);
@@ -261,6 +385,7 @@ j_item_get_callback (bson_t const* value, gpointer data_)
 
 /**
  * Gets an item from a collection.
+ * Batches with eventual consistency may use a cached item, which is returned immediately.
  *
  * \author Michael Kuhn
  *
@@ -285,107 +410,961 @@ j_item_get (JCollection* collection, JItem** item, gchar const* name, JBatch* ba
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	path = g_build_path("/", j_collection_get_name(collection), name, NULL);
+
+	if (j_metadata_cache_is_usable(j_batch_get_semantics(batch)))
+	{
+		if ((*item = j_metadata_cache_lookup(j_metadata_cache_items(), path)) != NULL)
+		{
+			goto end;
+		}
+	}
+
 	data = g_slice_new(JItemGetData);
 	data->collection = j_collection_ref(collection);
 	data->item = item;
 
-	path = g_build_path("/", j_collection_get_name(collection), name, NULL);
-	kv = j_kv_new("items", path);
-	j_kv_get_callback(kv, j_item_get_callback, data, batch);
+	kv = j_kv_new("items", path);
+	j_kv_get_callback(kv, j_item_get_callback, data, batch);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+static
+gpointer
+j_item_deserialize_background_operation (gpointer data)
+{
+	JItemDeserializeData* deserialize_data = data;
+
+	for (guint32 i = deserialize_data->start; i < deserialize_data->end; i++)
+	{
+		GBytes* value = deserialize_data->values[i];
+		bson_t b[1];
+
+		if (value == NULL)
+		{
+			continue;
+		}
+
+		if (bson_init_static(b, g_bytes_get_data(value, NULL), g_bytes_get_size(value)))
+		{
+			JItem* item;
+
+			item = j_item_new_from_bson(deserialize_data->collection, b);
+			j_item_cache_insert(item);
+
+			deserialize_data->items[deserialize_data->indices[i]] = item;
+		}
+	}
+
+	return data;
+}
+
+static
+void
+j_item_get_many_callback (GBytes** values, guint32 count, gpointer data_)
+{
+	JItemGetManyData* data = data_;
+	JItemDeserializeData* deserialize_data;
+	gpointer* background_data;
+	guint32 chunk_count;
+	guint32 chunk_size;
+
+	/* Every thread deserializes a contiguous range of items. */
+	chunk_count = MIN(count, g_get_num_processors());
+	chunk_size = (count + chunk_count - 1) / chunk_count;
+	chunk_count = (count + chunk_size - 1) / chunk_size;
+
+	deserialize_data = g_new(JItemDeserializeData, chunk_count);
+	background_data = g_new(gpointer, chunk_count);
+
+	for (guint32 i = 0; i < chunk_count; i++)
+	{
+		deserialize_data[i].collection = data->collection;
+		deserialize_data[i].items = data->items;
+		deserialize_data[i].indices = data->indices;
+		deserialize_data[i].values = values;
+		deserialize_data[i].start = i * chunk_size;
+		deserialize_data[i].end = MIN(count, (i + 1) * chunk_size);
+
+		background_data[i] = &(deserialize_data[i]);
+	}
+
+	if (chunk_count == 1)
+	{
+		j_item_deserialize_background_operation(background_data[0]);
+	}
+	else
+	{
+		j_helper_execute_parallel(j_item_deserialize_background_operation, background_data, chunk_count);
+	}
+
+	g_free(background_data);
+	g_free(deserialize_data);
+
+	j_collection_unref(data->collection);
+	g_free(data->indices);
+	g_slice_free(JItemGetManyData, data);
+}
+
+/**
+ * Gets multiple items from a collection.
+ * The items' values are fetched with one message per server and deserialized in parallel.
+ * Items that do not exist are set to NULL.
+ * Batches with eventual consistency may use cached items, which are returned immediately.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * gchar const* names[] = { "a", "b" };
+ * JItem* items[2];
+ *
+ * j_item_get_many(collection, items, names, 2, batch);
+ * \endcode
+ *
+ * \param collection A collection.
+ * \param items      An array of item pointers.
+ * \param names      An array of names.
+ * \param count      The number of names.
+ * \param batch      A batch.
+ **/
+void
+j_item_get_many (JCollection* collection, JItem** items, gchar const* const* names, guint32 count, JBatch* batch)
+{
+	JItemGetManyData* data;
+	g_autofree JKV** kvs = NULL;
+	g_autofree guint32* indices = NULL;
+	GString* path;
+	gboolean cached;
+	gsize prefix_len;
+	guint32 kv_count = 0;
+
+	g_return_if_fail(collection != NULL);
+	g_return_if_fail(items != NULL);
+	g_return_if_fail(names != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (count == 0)
+	{
+		goto end;
+	}
+
+	cached = j_metadata_cache_is_usable(j_batch_get_semantics(batch));
+
+	kvs = g_new(JKV*, count);
+	indices = g_new(guint32, count);
+	path = g_string_new(j_collection_get_name(collection));
+	g_string_append_c(path, '/');
+	prefix_len = path->len;
+
+	for (guint32 i = 0; i < count; i++)
+	{
+		g_string_truncate(path, prefix_len);
+		g_string_append(path, names[i]);
+
+		if (cached && (items[i] = j_metadata_cache_lookup(j_metadata_cache_items(), path->str)) != NULL)
+		{
+			continue;
+		}
+
+		items[i] = NULL;
+		indices[kv_count] = i;
+		kvs[kv_count] = j_kv_new("items", path->str);
+		kv_count++;
+	}
+
+	g_string_free(path, TRUE);
+
+	if (kv_count > 0)
+	{
+		data = g_slice_new(JItemGetManyData);
+		data->collection = j_collection_ref(collection);
+		data->items = items;
+		data->indices = g_steal_pointer(&indices);
+
+		j_kv_get_many_callback(kvs, kv_count, j_item_get_many_callback, data, batch);
+	}
+
+	for (guint32 i = 0; i < kv_count; i++)
+	{
+		j_kv_unref(kvs[i]);
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deletes an item from a collection.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param collection A collection.
+ * \param item       An item.
+ * \param batch      A batch.
+ **/
+void
+j_item_delete (JItem* item, JBatch* batch)
+{
+	g_autofree gchar* path = NULL;
+
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
+	j_metadata_cache_remove(j_metadata_cache_items(), path);
+
+	j_kv_delete(item->kv, batch);
+	j_distributed_object_delete(item->object, batch);
+
+	j_collection_update_stats(item->collection, -1, g_get_real_time(), batch);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Creates a snapshot of an item in the same collection.
+ * The snapshot gets the item's distribution, size and attributes; its data is created by the servers without passing through the client and shared with the item if the object backend supports it.
+ * Subsequent writes to the item do not modify the snapshot.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JItem) snapshot = NULL;
+ *
+ * snapshot = j_item_snapshot(item, "checkpoint-1", batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param item  An item.
+ * \param name  The snapshot's name.
+ * \param batch A batch.
+ *
+ * \return The snapshot. Should be freed with j_item_unref().
+ **/
+JItem*
+j_item_snapshot (JItem* item, gchar const* name, JBatch* batch)
+{
+	JItem* snapshot;
+	bson_t* value;
+	g_autofree gchar* path = NULL;
+
+	g_return_val_if_fail(item != NULL, NULL);
+	g_return_val_if_fail(name != NULL, NULL);
+	g_return_val_if_fail(batch != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Both objects have to place their data on the same servers. */
+	if ((snapshot = j_item_new(item->collection, name, j_distribution_ref(item->distribution))) == NULL)
+	{
+		goto end;
+	}
+
+	snapshot->status.size = item->status.size;
+
+	if (item->attributes != NULL)
+	{
+		GHashTableIter iter;
+		gpointer key;
+		gpointer attribute;
+
+		snapshot->attributes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+		g_hash_table_iter_init(&iter, item->attributes);
+
+		while (g_hash_table_iter_next(&iter, &key, &attribute))
+		{
+			g_hash_table_insert(snapshot->attributes, g_strdup(key), g_strdup(attribute));
+		}
+	}
+
+	value = j_item_serialize(snapshot, j_batch_get_semantics(batch));
+
+	path = g_build_path("/", j_collection_get_name(item->collection), name, NULL);
+	j_metadata_cache_remove(j_metadata_cache_items(), path);
+
+	j_distributed_object_snapshot(item->object, snapshot->object, batch);
+	j_kv_put(snapshot->kv, value, batch);
+
+	j_collection_update_stats(item->collection, 1, snapshot->status.modification_time, batch);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return snapshot;
+}
+
+/**
+ * Renames an item within its collection.
+ * Only the item's metadata is moved, its data stays in place.
+ * An existing item with the new name is replaced, but its data is not deleted.
+ * The stored status is replaced by the item's current status, so it should be up to date, for example by calling j_item_get_status() before.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_item_rename(item, "checkpoint-2", batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param item  An item.
+ * \param name  The new name.
+ * \param batch A batch.
+ **/
+void
+j_item_rename (JItem* item, gchar const* name, JBatch* batch)
+{
+	bson_t* value;
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* new_path = NULL;
+
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(name != NULL && strpbrk(name, "/") == NULL);
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
+	new_path = g_build_path("/", j_collection_get_name(item->collection), name, NULL);
+
+	j_metadata_cache_remove(j_metadata_cache_items(), path);
+	j_metadata_cache_remove(j_metadata_cache_items(), new_path);
+
+	g_free(item->name);
+	item->name = g_strdup(name);
+
+	value = j_item_serialize_full(item, TRUE);
+
+	/* The operations keep their own references to the old KV. */
+	j_kv_delete(item->kv, batch);
+	j_kv_unref(item->kv);
+
+	item->kv = j_kv_new("items", new_path);
+	j_kv_put(item->kv, value, batch);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reads an item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item       An item.
+ * \param data       A buffer to hold the read data.
+ * \param length     Number of bytes to read.
+ * \param offset     An offset within #item.
+ * \param bytes_read Number of bytes read.
+ * \param batch      A batch.
+ **/
+void
+j_item_read (JItem* item, gpointer data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+{
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(bytes_read != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_distributed_object_read(item->object, data, length, offset, bytes_read, batch);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+static
+void
+j_item_write_free (gpointer data)
+{
+	JItemWriteOperation* operation = data;
+
+	j_item_unref(operation->item);
+
+	g_slice_free(JItemWriteOperation, operation);
+}
+
+static
+guint64
+j_item_write_cache_size (gpointer data)
+{
+	JItemWriteOperation* operation = data;
+
+	return operation->length;
+}
+
+/**
+ * Copies a write's data into the operation cache and reports it as written.
+ *
+ * \private
+ **/
+static
+void
+j_item_write_cache (gpointer data, gpointer buffer)
+{
+	JItemWriteOperation* operation = data;
+
+	memcpy(buffer, operation->data, operation->length);
+	operation->data = buffer;
+
+	j_helper_atomic_add(operation->bytes_written, operation->length);
+	operation->cached_bytes_written = 0;
+	operation->bytes_written = &(operation->cached_bytes_written);
+}
+
+/**
+ * Writes an item's data and updates its stored status afterwards.
+ * All operations belong to the same item, because they share its object as their key.
+ *
+ * \private
+ **/
+static
+gboolean
+j_item_write_exec (JList* operations, JSemantics* semantics)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JListIterator) iterator = NULL;
+	JItem* item = NULL;
+	guint64 max_offset = 0;
+	gboolean ret;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* The nested batch is executed immediately, so the writes are combined as usual. */
+	batch = j_batch_new(semantics);
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
+	{
+		JItemWriteOperation* operation = j_list_iterator_get(iterator);
+
+		item = operation->item;
+		operation->written = 0;
+
+		j_distributed_object_write(item->object, operation->data, operation->length, operation->offset, &(operation->written), batch);
+	}
+
+	ret = j_batch_execute(batch);
+
+	j_list_iterator_free(iterator);
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
+	{
+		JItemWriteOperation* operation = j_list_iterator_get(iterator);
+
+		j_helper_atomic_add(operation->bytes_written, operation->written);
+
+		if (operation->written > 0)
+		{
+			max_offset = MAX(max_offset, operation->offset + operation->written);
+		}
+	}
+
+	/* The writes are combined into one update of the stored status, which only covers data that has actually been written. */
+	if (max_offset > 0)
+	{
+		bson_t maxima[1];
+		bson_t b_status[1];
+		gint64 modification_time;
+
+		modification_time = g_get_real_time();
+
+		bson_init(maxima);
+		bson_append_document_begin(maxima, "status", -1, b_status);
+		bson_append_int64(b_status, "size", -1, max_offset);
+		bson_append_int64(b_status, "modification_time", -1, modification_time);
+		bson_append_document_end(maxima, b_status);
+
+		j_kv_max_merge(item->kv, maxima, batch);
+		bson_destroy(maxima);
+
+		j_item_set_size(item, MAX(item->status.size, max_offset));
+		j_item_set_modification_time(item, modification_time);
+
+		j_collection_update_stats(item->collection, 0, modification_time, batch);
+
+		ret = j_batch_execute(batch) && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Writes an item.
+ * The item's stored status is updated once the data has been written.
+ *
+ * \note
+ * j_item_write() modifies bytes_written even if j_batch_execute() is not called.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item          An item.
+ * \param data          A buffer holding the data to write.
+ * \param length        Number of bytes to write.
+ * \param offset        An offset within #item.
+ * \param bytes_written Number of bytes written.
+ * \param batch         A batch.
+ **/
+void
+j_item_write (JItem* item, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+{
+	JItemWriteOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(bytes_written != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* The first write chose the block size, so the stored distribution has to be updated. */
+	if (j_distribution_adapt(item->distribution, offset + length))
+	{
+		bson_t* value;
+
+		value = j_item_serialize(item, j_batch_get_semantics(batch));
+		j_kv_put(item->kv, value, batch);
+	}
+
+	iop = g_slice_new(JItemWriteOperation);
+	iop->item = j_item_ref(item);
+	iop->data = data;
+	iop->length = length;
+	iop->offset = offset;
+	iop->bytes_written = bytes_written;
+	iop->written = 0;
+
+	/* Sharing the object's key keeps the writes in order with the object's other operations. */
+	operation = j_operation_new();
+	operation->key = item->object;
+	operation->data = iop;
+	operation->exec_func = j_item_write_exec;
+	operation->free_func = j_item_write_free;
+	operation->cache_size_func = j_item_write_cache_size;
+	operation->cache_func = j_item_write_cache;
+
+	*bytes_written = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+static
+void
+j_item_truncate_free (gpointer data)
+{
+	JItemTruncateOperation* operation = data;
+
+	j_item_unref(operation->item);
+
+	g_slice_free(JItemTruncateOperation, operation);
+}
+
+/**
+ * Truncates an item's data and replaces its stored status afterwards.
+ * All operations belong to the same item, because they share its object as their key.
+ *
+ * \private
+ **/
+static
+gboolean
+j_item_truncate_exec (JList* operations, JSemantics* semantics)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JListIterator) iterator = NULL;
+	g_autofree gchar* path = NULL;
+	JItem* item = NULL;
+	bson_t* value;
+	guint64 size = 0;
+	gint64 modification_time;
+	gboolean ret;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	batch = j_batch_new(semantics);
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
+	{
+		JItemTruncateOperation* operation = j_list_iterator_get(iterator);
+
+		item = operation->item;
+		size = operation->size;
+
+		j_distributed_object_truncate(item->object, operation->size, batch);
+	}
+
+	if (!j_batch_execute(batch))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	modification_time = g_get_real_time();
+
+	j_item_set_size(item, size);
+	j_item_set_modification_time(item, modification_time);
+
+	/* Max-merging cannot shrink the stored size, so the whole status is replaced. */
+	path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
+	j_metadata_cache_remove(j_metadata_cache_items(), path);
+
+	value = j_item_serialize_full(item, TRUE);
+	j_kv_put(item->kv, value, batch);
+
+	j_collection_update_stats(item->collection, 0, modification_time, batch);
+
+	ret = j_batch_execute(batch);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Truncates or extends an item.
+ * The item's stored status is replaced by its current status once the data has been truncated, so it should be up to date, for example by calling j_item_get_status() before.
+ * Fails for items that are erasure coded.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_item_truncate(item, 0, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param item  An item.
+ * \param size  The new size.
+ * \param batch A batch.
+ **/
+void
+j_item_truncate (JItem* item, guint64 size, JBatch* batch)
+{
+	JItemTruncateOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Like the first write, extending an empty item chooses the block size. */
+	if (j_distribution_adapt(item->distribution, size))
+	{
+		bson_t* value;
+
+		value = j_item_serialize(item, j_batch_get_semantics(batch));
+		j_kv_put(item->kv, value, batch);
+	}
+
+	iop = g_slice_new(JItemTruncateOperation);
+	iop->item = j_item_ref(item);
+	iop->size = size;
+
+	/* Sharing the object's key keeps the truncate in order with the item's writes. */
+	operation = j_operation_new();
+	operation->key = item->object;
+	operation->data = iop;
+	operation->exec_func = j_item_truncate_exec;
+	operation->free_func = j_item_truncate_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Preallocates space for an item without changing its size.
+ * Fails if the object backend does not support preallocation.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item   An item.
+ * \param length Number of bytes to preallocate.
+ * \param offset An offset within #item.
+ * \param batch  A batch.
+ **/
+void
+j_item_allocate (JItem* item, guint64 length, guint64 offset, JBatch* batch)
+{
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_distributed_object_allocate(item->object, length, offset, batch);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deallocates a range of an item without changing its size.
+ * The range reads as zeros afterwards.
+ * Fails if the object backend does not support punching holes and for items that are erasure coded.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item   An item.
+ * \param length Number of bytes to deallocate.
+ * \param offset An offset within #item.
+ * \param batch  A batch.
+ **/
+void
+j_item_punch_hole (JItem* item, guint64 length, guint64 offset, JBatch* batch)
+{
+	g_return_if_fail(item != NULL);
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_distributed_object_punch_hole(item->object, length, offset, batch);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+static
+void
+j_item_set_attribute_local (JItem* item, gchar const* name, gchar const* value)
+{
+	if (item->attributes == NULL)
+	{
+		item->attributes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	}
+
+	g_hash_table_insert(item->attributes, g_strdup(name), g_strdup(value));
+}
+
+/**
+ * Returns one of an item's attributes.
+ * Attributes are stored with the item's metadata, so they are available without further operations after j_item_get().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item An item.
+ * \param name An attribute name.
+ *
+ * \return The attribute's value or NULL if it is not set.
+ **/
+gchar const*
+j_item_get_attribute (JItem* item, gchar const* name)
+{
+	gchar const* value = NULL;
+
+	g_return_val_if_fail(item != NULL, NULL);
+	g_return_val_if_fail(name != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (item->attributes != NULL)
+	{
+		value = g_hash_table_lookup(item->attributes, name);
+	}
 
 	j_trace_leave(G_STRFUNC);
+
+	return value;
 }
 
 /**
- * Deletes an item from a collection.
+ * Sets one of an item's attributes.
+ * The attribute is merged into the item's stored metadata, together with the status updates of the batch's writes.
  *
  * \author Michael Kuhn
  *
  * \code
+ * j_item_set_attribute(item, "units", "K", batch);
  * \endcode
  *
- * \param collection A collection.
- * \param item       An item.
- * \param batch      A batch.
+ * \param item  An item.
+ * \param name  An attribute name, which must not contain dots.
+ * \param value A value.
+ * \param batch A batch.
  **/
 void
-j_item_delete (JItem* item, JBatch* batch)
+j_item_set_attribute (JItem* item, gchar const* name, gchar const* value, JBatch* batch)
 {
+	bson_t b[1];
+	bson_t b_attributes[1];
+
 	g_return_if_fail(item != NULL);
-	g_return_if_fail(batch != NULL);
+	g_return_if_fail(name != NULL && name[0] != '\0' && strchr(name, '.') == NULL);
+	g_return_if_fail(value != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	j_kv_delete(item->kv, batch);
-	j_distributed_object_delete(item->object, batch);
+	j_item_set_attribute_local(item, name, value);
+
+	/* Strings are replaced by max-merges, which are combined with the status updates of j_item_write(). */
+	bson_init(b);
+	bson_append_document_begin(b, "attributes", -1, b_attributes);
+	bson_append_utf8(b_attributes, name, -1, value, -1);
+	bson_append_document_end(b, b_attributes);
+
+	j_kv_max_merge(item->kv, b, batch);
+	bson_destroy(b);
 
 	j_trace_leave(G_STRFUNC);
 }
 
-/**
- * Reads an item.
- *
- * \author Michael Kuhn
- *
- * \code
- * \endcode
- *
- * \param item       An item.
- * \param data       A buffer to hold the read data.
- * \param length     Number of bytes to read.
- * \param offset     An offset within #item.
- * \param bytes_read Number of bytes read.
- * \param batch      A batch.
- **/
+static
 void
-j_item_read (JItem* item, gpointer data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+j_item_deserialize_status (JItem* item, bson_t const* b)
 {
+	bson_iter_t iterator;
+
 	g_return_if_fail(item != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(bytes_read != NULL);
+	g_return_if_fail(b != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	j_distributed_object_read(item->object, data, length, offset, bytes_read, batch);
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "size") == 0)
+		{
+			item->status.size = bson_iter_int64(&iterator);
+			item->status.age = g_get_real_time();
+		}
+		else if (g_strcmp0(key, "modification_time") == 0)
+		{
+			item->status.modification_time = bson_iter_int64(&iterator);
+			item->status.age = g_get_real_time();
+		}
+	}
 
 	j_trace_leave(G_STRFUNC);
 }
 
+static
+void
+j_item_get_status_callback (bson_t const* value, gpointer data)
+{
+	JItemStatusData* status_data = data;
+	bson_iter_t iterator;
+
+	if (bson_iter_init_find(&iterator, value, "status") && BSON_ITER_HOLDS_DOCUMENT(&iterator))
+	{
+		guint8 const* b_data;
+		guint32 len;
+		bson_t b_status[1];
+
+		bson_iter_document(&iterator, &len, &b_data);
+		bson_init_static(b_status, b_data, len);
+		j_item_deserialize_status(status_data->item, b_status);
+		bson_destroy(b_status);
+
+		status_data->found = TRUE;
+	}
+}
+
+static
+void
+j_item_get_status_free (gpointer data)
+{
+	JItem* item = data;
+
+	j_item_unref(item);
+}
+
 /**
- * Writes an item.
- *
- * \note
- * j_item_write() modifies bytes_written even if j_batch_execute() is not called.
- *
- * \author Michael Kuhn
+ * Reads an item's stored status.
+ * Items written before the status was stored do not have one, so their status is queried from their object and stored.
+ * All operations belong to the same item, because they share its object as their key.
  *
- * \code
- * \endcode
- *
- * \param item          An item.
- * \param data          A buffer holding the data to write.
- * \param length        Number of bytes to write.
- * \param offset        An offset within #item.
- * \param bytes_written Number of bytes written.
- * \param batch         A batch.
+ * \private
  **/
-void
-j_item_write (JItem* item, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+static
+gboolean
+j_item_get_status_exec (JList* operations, JSemantics* semantics)
 {
-	g_return_if_fail(item != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(bytes_written != NULL);
+	g_autoptr(JBatch) batch = NULL;
+	JItemStatusData status_data;
+	JItem* item;
+	gboolean ret;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	// FIXME see j_item_write_exec
-	j_distributed_object_write(item->object, data, length, offset, bytes_written, batch);
+	item = j_list_get_first(operations);
+	batch = j_batch_new(semantics);
+
+	status_data.item = item;
+	status_data.found = FALSE;
+
+	j_kv_get_callback(item->kv, j_item_get_status_callback, &status_data, batch);
+	ret = j_batch_execute(batch);
+
+	if (ret && !status_data.found)
+	{
+		bson_t status[1];
+		bson_t b_status[1];
+		gint64 modification_time = 0;
+		guint64 size = 0;
+
+		j_distributed_object_status(item->object, &modification_time, &size, batch);
+
+		if (!j_batch_execute(batch))
+		{
+			ret = FALSE;
+			goto end;
+		}
+
+		j_item_set_size(item, size);
+		j_item_set_modification_time(item, modification_time);
 
+		/* Max-merging does not overwrite a status stored by a concurrent write. */
+		bson_init(status);
+		bson_append_document_begin(status, "status", -1, b_status);
+		bson_append_int64(b_status, "size", -1, size);
+		bson_append_int64(b_status, "modification_time", -1, modification_time);
+		bson_append_document_end(status, b_status);
+
+		j_kv_max_merge(item->kv, status, batch);
+		bson_destroy(status);
+
+		ret = j_batch_execute(batch);
+	}
+
+end:
 	j_trace_leave(G_STRFUNC);
+
+	return ret;
 }
 
 /**
  * Get the status of an item.
+ * The size and modification time are read from the item's stored status, which is maintained by j_item_write().
+ * If the item does not have a stored status yet, it is queried from the item's data and stored.
  *
  * \author Michael Kuhn
  *
@@ -398,12 +1377,20 @@ j_item_write (JItem* item, gconstpointer data, guint64 length, guint64 offset, g
 void
 j_item_get_status (JItem* item, JBatch* batch)
 {
+	JOperation* operation;
+
 	g_return_if_fail(item != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	// FIXME check j_item_get_status_exec
-	j_distributed_object_status(item->object, &(item->status.modification_time), &(item->status.size), batch);
+	/* Sharing the object's key orders the operation after the item's writes. */
+	operation = j_operation_new();
+	operation->key = item->object;
+	operation->data = j_item_ref(item);
+	operation->exec_func = j_item_get_status_exec;
+	operation->free_func = j_item_get_status_free;
+
+	j_batch_add(batch, operation);
 
 	j_trace_leave(G_STRFUNC);
 }
@@ -456,6 +1443,7 @@ j_item_get_modification_time (JItem* item)
 
 /**
  * Returns the item's optimal access size.
+ * The size covers one block on each server the item is striped across.
  *
  * \author Michael Kuhn
  *
@@ -481,7 +1469,7 @@ j_item_get_optimal_access_size (JItem* item)
 	j_trace_enter(G_STRFUNC, NULL);
 	j_trace_leave(G_STRFUNC);
 
-	return 512 * 1024;
+	return j_distribution_get_optimal_access_size(item->distribution);
 }
 
 /* Internal */
@@ -522,22 +1510,34 @@ j_item_new (JCollection* collection, gchar const* name, JDistribution* distribut
 	if (distribution == NULL)
 	{
 		distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+		j_distribution_set_adaptive(distribution);
 	}
 
 	item = g_slice_new(JItem);
 	bson_oid_init(&(item->id), bson_context_get_default());
 	item->name = g_strdup(name);
+	item->object_name = NULL;
 	item->credentials = j_credentials_new();
 	item->distribution = distribution;
 	item->status.age = g_get_real_time();
 	item->status.size = 0;
 	item->status.modification_time = g_get_real_time();
+	item->attributes = NULL;
 	item->collection = j_collection_ref(collection);
 	item->ref_count = 1;
 
 	path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
+
+	/* Objects keep the collection's prefix, so that they can still be purged together with it. */
+	{
+		gchar id[25];
+
+		bson_oid_to_string(&(item->id), id);
+		item->object_name = g_build_path("/", j_collection_get_name(item->collection), id, NULL);
+	}
+
 	item->kv = j_kv_new("items", path);
-	item->object = j_distributed_object_new("item", path, item->distribution);
+	item->object = j_distributed_object_new("item", item->object_name, item->distribution);
 
 end:
 	j_trace_leave(G_STRFUNC);
@@ -573,19 +1573,28 @@ j_item_new_from_bson (JCollection* collection, bson_t const* b)
 
 	item = g_slice_new(JItem);
 	item->name = NULL;
+	item->object_name = NULL;
 	item->credentials = j_credentials_new();
 	item->distribution = NULL;
 	item->status.age = 0;
 	item->status.size = 0;
 	item->status.modification_time = 0;
+	item->attributes = NULL;
 	item->collection = j_collection_ref(collection);
 	item->ref_count = 1;
 
 	j_item_deserialize(item, b);
 
 	path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
+
+	/* Items created before objects were named independently use their path. */
+	if (item->object_name == NULL)
+	{
+		item->object_name = g_strdup(path);
+	}
+
 	item->kv = j_kv_new("items", path);
-	item->object = j_distributed_object_new("item", path, item->distribution);
+	item->object = j_distributed_object_new("item", item->object_name, item->distribution);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -659,17 +1668,42 @@ j_item_get_credentials (JItem* item)
  **/
 bson_t*
 j_item_serialize (JItem* item, JSemantics* semantics)
+{
+	g_return_val_if_fail(item != NULL, NULL);
+
+	return j_item_serialize_full(item, j_semantics_get(semantics, J_SEMANTICS_CONCURRENCY) == J_SEMANTICS_CONCURRENCY_NONE);
+}
+
+/**
+ * Serializes an item, optionally including its status.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item   An item.
+ * \param status Whether to include the status.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static
+bson_t*
+j_item_serialize_full (JItem* item, gboolean status)
 {
 	bson_t* b;
-	bson_t* b_cred;
-	bson_t* b_distribution;
+	bson_t const* b_cred;
+	bson_t const* b_distribution;
 
 	g_return_val_if_fail(item != NULL, NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	b_cred = j_credentials_serialize(item->credentials);
-	b_distribution = j_distribution_serialize(item->distribution);
+	/* Credentials and distributions rarely change, so their serialized forms are reused. */
+	b_cred = j_credentials_serialize_cached(item->credentials);
+	b_distribution = j_distribution_serialize_cached(item->distribution);
 
 	b = g_slice_new(bson_t);
 	bson_init(b);
@@ -677,8 +1711,9 @@ j_item_serialize (JItem* item, JSemantics* semantics)
 	bson_append_oid(b, "_id", -1, &(item->id));
 	bson_append_oid(b, "collection", -1, j_collection_get_id(item->collection));
 	bson_append_utf8(b, "name", -1, item->name, -1);
+	bson_append_utf8(b, "object", -1, item->object_name, -1);
 
-	if (j_semantics_get(semantics, J_SEMANTICS_CONCURRENCY) == J_SEMANTICS_CONCURRENCY_NONE)
+	if (status)
 	{
 		bson_t b_document[1];
 
@@ -692,53 +1727,33 @@ j_item_serialize (JItem* item, JSemantics* semantics)
 		bson_destroy(b_document);
 	}
 
-	bson_append_document(b, "credentials", -1, b_cred);
-	bson_append_document(b, "distribution", -1, b_distribution);
-
-	//bson_finish(b);
-
-	bson_destroy(b_cred);
-	bson_destroy(b_distribution);
-	g_slice_free(bson_t, b_cred);
-	g_slice_free(bson_t, b_distribution);
-
-	j_trace_leave(G_STRFUNC);
-
-	return b;
-}
-
-static
-void
-j_item_deserialize_status (JItem* item, bson_t const* b)
-{
-	bson_iter_t iterator;
-
-	g_return_if_fail(item != NULL);
-	g_return_if_fail(b != NULL);
-
-	j_trace_enter(G_STRFUNC, NULL);
-
-	bson_iter_init(&iterator, b);
-
-	while (bson_iter_next(&iterator))
+	if (item->attributes != NULL)
 	{
-		gchar const* key;
+		GHashTableIter iter;
+		gpointer name;
+		gpointer value;
+		bson_t b_document[1];
 
-		key = bson_iter_key(&iterator);
+		bson_append_document_begin(b, "attributes", -1, b_document);
 
-		if (g_strcmp0(key, "size") == 0)
-		{
-			item->status.size = bson_iter_int64(&iterator);
-			item->status.age = g_get_real_time();
-		}
-		else if (g_strcmp0(key, "modification_time") == 0)
+		g_hash_table_iter_init(&iter, item->attributes);
+
+		while (g_hash_table_iter_next(&iter, &name, &value))
 		{
-			item->status.modification_time = bson_iter_int64(&iterator);
-			item->status.age = g_get_real_time();
+			bson_append_utf8(b_document, name, -1, value, -1);
 		}
+
+		bson_append_document_end(b, b_document);
 	}
 
+	bson_append_document(b, "credentials", -1, b_cred);
+	bson_append_document(b, "distribution", -1, b_distribution);
+
+	//bson_finish(b);
+
 	j_trace_leave(G_STRFUNC);
+
+	return b;
 }
 
 /**
@@ -781,6 +1796,11 @@ j_item_deserialize (JItem* item, bson_t const* b)
 			g_free(item->name);
 			item->name = g_strdup(bson_iter_utf8(&iterator, NULL /*FIXME*/));
 		}
+		else if (g_strcmp0(key, "object") == 0)
+		{
+			g_free(item->object_name);
+			item->object_name = g_strdup(bson_iter_utf8(&iterator, NULL));
+		}
 		else if (g_strcmp0(key, "status") == 0)
 		{
 			guint8 const* data;
@@ -792,6 +1812,26 @@ j_item_deserialize (JItem* item, bson_t const* b)
 			j_item_deserialize_status(item, b_status);
 			bson_destroy(b_status);
 		}
+		else if (g_strcmp0(key, "attributes") == 0)
+		{
+			bson_iter_t child;
+
+			if (item->attributes != NULL)
+			{
+				g_hash_table_remove_all(item->attributes);
+			}
+
+			if (bson_iter_recurse(&iterator, &child))
+			{
+				while (bson_iter_next(&child))
+				{
+					if (BSON_ITER_HOLDS_UTF8(&child))
+					{
+						j_item_set_attribute_local(item, bson_iter_key(&child), bson_iter_utf8(&child, NULL));
+					}
+				}
+			}
+		}
 		else if (g_strcmp0(key, "credentials") == 0)
 		{
 			guint8 const* data;
@@ -893,109 +1933,6 @@ j_item_set_size (JItem* item, guint64 size)
 	j_trace_leave(G_STRFUNC);
 }
 
-/*
-gboolean
-j_item_write_exec (JList* operations, JSemantics* semantics)
-{
-	if (j_semantics_get(semantics, J_SEMANTICS_CONCURRENCY) == J_SEMANTICS_CONCURRENCY_NONE && FALSE)
-	{
-		bson_t b_document[1];
-		bson_t cond[1];
-		bson_t op[1];
-		mongoc_client_t* mongo_connection;
-		mongoc_collection_t* mongo_collection;
-		mongoc_write_concern_t* write_concern;
-		gint ret;
-
-		j_helper_set_write_concern(write_concern, semantics);
-
-		bson_init(cond);
-		bson_append_oid(cond, "_id", -1, &(item->id));
-		bson_append_int32(cond, "Status.ModificationTime", -1, item->status.modification_time);
-		//bson_finish(cond);
-
-		j_item_set_modification_time(item, g_get_real_time());
-
-		bson_init(op);
-
-		bson_append_document_begin(op, "$set", -1, b_document);
-
-		if (max_offset > item->status.size)
-		{
-			j_item_set_size(item, max_offset);
-			bson_append_int64(b_document, "Status.Size", -1, item->status.size);
-		}
-
-		bson_append_int64(b_document, "Status.ModificationTime", -1, item->status.modification_time);
-		bson_append_document_end(op, b_document);
-
-		//bson_finish(op);
-
-		mongo_connection = j_connection_pool_pop_kv(0);
-		mongo_collection = mongoc_client_get_collection(mongo_connection, "JULEA", "Items");
-
-		ret = mongoc_collection_update(mongo_collection, MONGOC_UPDATE_NONE, cond, op, write_concern, NULL);
-
-		j_connection_pool_push_kv(0, mongo_connection);
-
-		if (!ret)
-		{
-
-		}
-
-		bson_destroy(cond);
-		bson_destroy(op);
-
-		mongoc_write_concern_destroy(write_concern);
-	}
-}
-*/
-
-/*
-gboolean
-j_item_get_status_exec (JList* operations, JSemantics* semantics)
-{
-	if (semantics_consistency != J_SEMANTICS_CONSISTENCY_IMMEDIATE)
-	{
-		if (item->status.age >= (guint64)g_get_real_time() - G_USEC_PER_SEC)
-		{
-			continue;
-		}
-	}
-
-	if (semantics_concurrency == J_SEMANTICS_CONCURRENCY_NONE)
-	{
-		bson_t result[1];
-		gchar* path;
-
-		bson_init(&opts);
-		bson_append_int32(&opts, "limit", -1, 1);
-		bson_append_document_begin(&opts, "projection", -1, &projection);
-
-		bson_append_bool(&projection, "Status.Size", -1, TRUE);
-		bson_append_bool(&projection, "Status.ModificationTime", -1, TRUE);
-
-		bson_append_document_end(&opts, &projection);
-
-		if (kv_backend != NULL)
-		{
-			path = g_build_path("/", j_collection_get_name(item->collection), item->name, NULL);
-			ret = j_backend_kv_get(kv_backend, "items", path, result) && ret;
-			g_free(path);
-		}
-
-		bson_init(&b);
-		bson_append_oid(&b, "_id", -1, &(item->id));
-
-		if (ret)
-		{
-			j_item_deserialize(item, result);
-			bson_destroy(result);
-		}
-	}
-}
-*/
-
 /**
  * @}
  **/
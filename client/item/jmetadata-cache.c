@@ -0,0 +1,449 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A bounded cache of deserialized metadata objects.
+ * Entries are leased for a fixed time and the least recently used entry is evicted when the cache is full.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <item/jmetadata-cache-internal.h>
+
+#include <item/jcollection.h>
+#include <item/jitem.h>
+
+#include <julea.h>
+
+/**
+ * \defgroup JMetadataCache Metadata Cache
+ *
+ * @{
+ **/
+
+/**
+ * The maximum number of cached collections.
+ */
+#define J_METADATA_CACHE_COLLECTIONS_SIZE 1024
+
+/**
+ * How long collections are cached.
+ * Collections are practically immutable, so they can be leased for a long time.
+ */
+#define J_METADATA_CACHE_COLLECTIONS_LEASE (60 * G_TIME_SPAN_SECOND)
+
+/**
+ * The maximum number of cached items.
+ */
+#define J_METADATA_CACHE_ITEMS_SIZE 65536
+
+/**
+ * How long items are cached.
+ */
+#define J_METADATA_CACHE_ITEMS_LEASE G_TIME_SPAN_SECOND
+
+struct JMetadataCacheEntry
+{
+	gchar* key;
+	gpointer object;
+
+	/**
+	 * The monotonic time at which the lease expires.
+	 */
+	gint64 expires;
+
+	/**
+	 * The entry's link in the LRU queue.
+	 */
+	GList* link;
+};
+
+typedef struct JMetadataCacheEntry JMetadataCacheEntry;
+
+struct JMetadataCache
+{
+	/**
+	 * Maps keys to entries.
+	 */
+	GHashTable* entries;
+
+	/**
+	 * The entries ordered from most to least recently used.
+	 */
+	GQueue* lru;
+
+	guint size;
+	GTimeSpan lease;
+
+	GBoxedCopyFunc ref_func;
+	GDestroyNotify unref_func;
+
+	GMutex mutex[1];
+};
+
+static
+void
+j_metadata_cache_entry_free (JMetadataCache* cache, JMetadataCacheEntry* entry)
+{
+	g_queue_delete_link(cache->lru, entry->link);
+	cache->unref_func(entry->object);
+	g_free(entry->key);
+
+	g_slice_free(JMetadataCacheEntry, entry);
+}
+
+/**
+ * Removes an entry.
+ * Has to be called with the mutex held.
+ */
+static
+void
+j_metadata_cache_entry_remove (JMetadataCache* cache, JMetadataCacheEntry* entry)
+{
+	g_hash_table_remove(cache->entries, entry->key);
+	j_metadata_cache_entry_free(cache, entry);
+}
+
+/**
+ * Creates a new metadata cache.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size       The maximum number of entries.
+ * \param lease      How long entries are valid.
+ * \param ref_func   A function to reference cached objects.
+ * \param unref_func A function to release cached objects.
+ *
+ * \return A new cache. Should be freed with j_metadata_cache_free().
+ **/
+JMetadataCache*
+j_metadata_cache_new (guint size, GTimeSpan lease, GBoxedCopyFunc ref_func, GDestroyNotify unref_func)
+{
+	JMetadataCache* cache;
+
+	g_return_val_if_fail(size > 0, NULL);
+	g_return_val_if_fail(ref_func != NULL, NULL);
+	g_return_val_if_fail(unref_func != NULL, NULL);
+
+	cache = g_slice_new(JMetadataCache);
+	cache->entries = g_hash_table_new(g_str_hash, g_str_equal);
+	cache->lru = g_queue_new();
+	cache->size = size;
+	cache->lease = lease;
+	cache->ref_func = ref_func;
+	cache->unref_func = unref_func;
+	g_mutex_init(cache->mutex);
+
+	return cache;
+}
+
+/**
+ * Frees a metadata cache and releases all cached objects.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A cache.
+ **/
+void
+j_metadata_cache_free (JMetadataCache* cache)
+{
+	JMetadataCacheEntry* entry;
+
+	g_return_if_fail(cache != NULL);
+
+	while ((entry = g_queue_peek_tail(cache->lru)) != NULL)
+	{
+		j_metadata_cache_entry_remove(cache, entry);
+	}
+
+	g_hash_table_unref(cache->entries);
+	g_queue_free(cache->lru);
+	g_mutex_clear(cache->mutex);
+
+	g_slice_free(JMetadataCache, cache);
+}
+
+/**
+ * Checks whether cached metadata may be used for a batch.
+ * Only batches with eventual consistency accept metadata that might be outdated.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param semantics A semantics object.
+ *
+ * \return TRUE if the cache may be used, FALSE otherwise.
+ **/
+gboolean
+j_metadata_cache_is_usable (JSemantics* semantics)
+{
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	return (j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) == J_SEMANTICS_CONSISTENCY_EVENTUAL);
+}
+
+/**
+ * Looks up an object.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A cache.
+ * \param key   A key.
+ *
+ * \return A new reference to the object, NULL if it is not cached or its lease has expired.
+ **/
+gpointer
+j_metadata_cache_lookup (JMetadataCache* cache, gchar const* key)
+{
+	JMetadataCacheEntry* entry;
+	gpointer object = NULL;
+
+	g_return_val_if_fail(cache != NULL, NULL);
+	g_return_val_if_fail(key != NULL, NULL);
+
+	g_mutex_lock(cache->mutex);
+
+	if ((entry = g_hash_table_lookup(cache->entries, key)) != NULL)
+	{
+		if (g_get_monotonic_time() < entry->expires)
+		{
+			object = cache->ref_func(entry->object);
+
+			g_queue_unlink(cache->lru, entry->link);
+			g_queue_push_head_link(cache->lru, entry->link);
+		}
+		else
+		{
+			j_metadata_cache_entry_remove(cache, entry);
+		}
+	}
+
+	g_mutex_unlock(cache->mutex);
+
+	return object;
+}
+
+/**
+ * Inserts an object, replacing an existing entry for the key.
+ * The cache takes its own reference.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache  A cache.
+ * \param key    A key.
+ * \param object An object.
+ **/
+void
+j_metadata_cache_insert (JMetadataCache* cache, gchar const* key, gpointer object)
+{
+	JMetadataCacheEntry* entry;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(key != NULL);
+	g_return_if_fail(object != NULL);
+
+	g_mutex_lock(cache->mutex);
+
+	if ((entry = g_hash_table_lookup(cache->entries, key)) != NULL)
+	{
+		j_metadata_cache_entry_remove(cache, entry);
+	}
+
+	if (g_hash_table_size(cache->entries) >= cache->size)
+	{
+		j_metadata_cache_entry_remove(cache, g_queue_peek_tail(cache->lru));
+	}
+
+	entry = g_slice_new(JMetadataCacheEntry);
+	entry->key = g_strdup(key);
+	entry->object = cache->ref_func(object);
+	entry->expires = g_get_monotonic_time() + cache->lease;
+
+	g_queue_push_head(cache->lru, entry);
+	entry->link = g_queue_peek_head_link(cache->lru);
+
+	g_hash_table_insert(cache->entries, entry->key, entry);
+
+	g_mutex_unlock(cache->mutex);
+}
+
+/**
+ * Removes the entry for a key.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A cache.
+ * \param key   A key.
+ **/
+void
+j_metadata_cache_remove (JMetadataCache* cache, gchar const* key)
+{
+	JMetadataCacheEntry* entry;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(key != NULL);
+
+	g_mutex_lock(cache->mutex);
+
+	if ((entry = g_hash_table_lookup(cache->entries, key)) != NULL)
+	{
+		j_metadata_cache_entry_remove(cache, entry);
+	}
+
+	g_mutex_unlock(cache->mutex);
+}
+
+/**
+ * Removes the entries of all keys starting with a prefix.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache  A cache.
+ * \param prefix A prefix.
+ **/
+void
+j_metadata_cache_remove_prefix (JMetadataCache* cache, gchar const* prefix)
+{
+	GList* link;
+	gsize prefix_len;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(prefix != NULL);
+
+	prefix_len = strlen(prefix);
+
+	g_mutex_lock(cache->mutex);
+
+	link = g_queue_peek_head_link(cache->lru);
+
+	while (link != NULL)
+	{
+		JMetadataCacheEntry* entry = link->data;
+
+		link = link->next;
+
+		if (strncmp(entry->key, prefix, prefix_len) == 0)
+		{
+			j_metadata_cache_entry_remove(cache, entry);
+		}
+	}
+
+	g_mutex_unlock(cache->mutex);
+}
+
+static
+gpointer
+j_metadata_cache_collections_new (gpointer data)
+{
+	(void)data;
+
+	return j_metadata_cache_new(J_METADATA_CACHE_COLLECTIONS_SIZE, J_METADATA_CACHE_COLLECTIONS_LEASE, (GBoxedCopyFunc)j_collection_ref, (GDestroyNotify)j_collection_unref);
+}
+
+static
+gpointer
+j_metadata_cache_items_new (gpointer data)
+{
+	(void)data;
+
+	return j_metadata_cache_new(J_METADATA_CACHE_ITEMS_SIZE, J_METADATA_CACHE_ITEMS_LEASE, (GBoxedCopyFunc)j_item_ref, (GDestroyNotify)j_item_unref);
+}
+
+/**
+ * Returns the cache of collections, which are keyed by their names.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return The cache.
+ **/
+JMetadataCache*
+j_metadata_cache_collections (void)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	return g_once(&once, j_metadata_cache_collections_new, NULL);
+}
+
+/**
+ * Returns the cache of items, which are keyed by their KV keys.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return The cache.
+ **/
+JMetadataCache*
+j_metadata_cache_items (void)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	return g_once(&once, j_metadata_cache_items_new, NULL);
+}
+
+/**
+ * @}
+ **/
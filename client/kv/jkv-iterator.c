@@ -40,6 +40,60 @@
  * @{
  **/
 
+/**
+ * The results of one server.
+ **/
+struct JKVIteratorSource
+{
+	/**
+	 * The index of the server.
+	 **/
+	guint32 index;
+
+	/**
+	 * The index of the server's read replica, -1 for the server itself.
+	 **/
+	gint replica;
+
+	/**
+	 * The request, which is needed to create new replies.
+	 **/
+	JMessage* request;
+
+	/**
+	 * The current reply.
+	 * The server sends the results in multiple replies, which are received one at a time.
+	 **/
+	JMessage* reply;
+
+	/**
+	 * Whether the current reply is referenced by values returned from j_kv_iterator_get_bytes().
+	 * If so, the next reply is received into a new message instead of reusing it.
+	 **/
+	gboolean reply_shared;
+
+	/**
+	 * The number of operations left in the current reply.
+	 **/
+	guint32 remaining;
+
+	/**
+	 * The connection the replies are received from.
+	 * It is returned to the pool as soon as the last reply has been received.
+	 **/
+	GSocketConnection* connection;
+
+	/**
+	 * The next result, which has been received but not returned yet.
+	 * Only used by ordered iterators, head_len is 0 if there is none.
+	 **/
+	gchar const* head_key;
+	gconstpointer head_data;
+	guint32 head_len;
+};
+
+typedef struct JKVIteratorSource JKVIteratorSource;
+
 struct JKVIterator
 {
 	JBackend* kv_backend;
@@ -54,83 +108,601 @@ struct JKVIterator
 	 **/
 	bson_t current[1];
 
-	JMessage* reply;
+	/**
+	 * The key of the current document.
+	 **/
+	gchar const* current_key;
+
+	/**
+	 * The source the current document has been received from, NULL for client-side backends.
+	 **/
+	JKVIteratorSource* current_owner;
+
+	/**
+	 * Whether the results of all servers are merged in key order.
+	 **/
+	gboolean ordered;
+
+	/**
+	 * The number of results that can still be returned, G_MAXUINT32 for no limit.
+	 **/
+	guint32 remaining;
+
+	/**
+	 * The filter and fields, which are only needed for client-side backends.
+	 * Servers evaluate them before sending the results.
+	 **/
+	bson_t* filter;
+	gchar** fields;
+
+	/**
+	 * The delimiter and the prefix's length, which are only needed for client-side backends.
+	 * Keys that contain the delimiter after the prefix are skipped.
+	 **/
+	gchar* delimiter;
+	gsize prefix_len;
+
+	/**
+	 * The projection of the current document if fields are used with client-side backends.
+	 **/
+	bson_t projected[1];
+	gboolean has_projected;
+
+	/**
+	 * The servers the results are received from.
+	 * All requests are sent up front, so that the servers look up their results concurrently.
+	 **/
+	JKVIteratorSource* sources;
+
+	/**
+	 * The number of sources.
+	 **/
+	guint32 sources_len;
+
+	/**
+	 * The source the results are currently received from.
+	 **/
+	guint32 current_source;
 };
 
 /**
- * Creates a new JKVIterator.
- *
- * \author Michael Kuhn
- *
- * \param store A JStore.
+ * Returns the length of the next result from the server, receiving the next reply if necessary.
+ * Returns the connection to the pool once the end of the results has been reached.
  *
- * \return A new JKVIterator.
+ * \return The length of the next result or 0 if there are no more results.
  **/
-JKVIterator*
-j_kv_iterator_new (guint32 index, gchar const* namespace, gchar const* prefix)
+static
+guint32
+j_kv_iterator_source_next_length (JKVIteratorSource* source)
 {
-	JKVIterator* iterator;
+	guint32 len = 0;
 
-	JConfiguration* configuration = j_configuration();
+	if (source->connection == NULL)
+	{
+		goto end;
+	}
 
-	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(index < j_configuration_get_kv_server_count(configuration), NULL);
+	if (source->remaining == 0)
+	{
+		if (source->reply_shared)
+		{
+			j_message_unref(source->reply);
+			source->reply = j_message_new_reply(source->request);
+			source->reply_shared = FALSE;
+		}
 
-	/* FIXME still necessary? */
-	//j_operation_cache_flush();
+		if (!j_message_receive(source->reply, source->connection))
+		{
+			/* The connection is in an unknown state after a failed receive. */
+			if (source->replica >= 0)
+			{
+				j_connection_pool_discard_kv_replica(source->index, source->replica, source->connection);
+			}
+			else
+			{
+				j_connection_pool_discard_kv(source->index, source->connection);
+			}
+
+			source->connection = NULL;
+			goto end;
+		}
 
-	iterator = g_slice_new(JKVIterator);
-	iterator->kv_backend = j_kv_backend();
-	iterator->cursor = NULL;
-	iterator->reply = NULL;
+		source->remaining = j_message_get_count(source->reply);
+	}
 
-	if (iterator->kv_backend != NULL)
+	source->remaining--;
+	len = j_message_get_varint(source->reply);
+
+	if (len > 0)
+	{
+		goto end;
+	}
+
+done:
+	if (source->replica >= 0)
+	{
+		j_connection_pool_push_kv_replica(source->index, source->replica, source->connection);
+	}
+	else
 	{
-		if (prefix == NULL)
+		j_connection_pool_push_kv(source->index, source->connection);
+	}
+
+	source->connection = NULL;
+
+end:
+	return len;
+}
+
+/**
+ * Receives the next result from the server.
+ *
+ * \return The length of the result's data or 0 if there are no more results.
+ **/
+static
+guint32
+j_kv_iterator_source_next (JKVIteratorSource* source, gchar const** key, gconstpointer* data)
+{
+	guint32 len;
+
+	if ((len = j_kv_iterator_source_next_length(source)) > 0)
+	{
+		*data = j_message_get_n(source->reply, len);
+		*key = j_message_get_string(source->reply);
+	}
+
+	return len;
+}
+
+/**
+ * Sends a request to a server, whose results are received lazily.
+ **/
+static
+void
+j_kv_iterator_source_start (JKVIteratorSource* source, guint32 index, gint replica, JMessage* message)
+{
+	source->index = index;
+	source->replica = replica;
+	source->remaining = 0;
+	source->head_key = NULL;
+	source->head_data = NULL;
+	source->head_len = 0;
+	source->connection = (replica >= 0) ? j_connection_pool_pop_kv_replica(index, replica) : j_connection_pool_pop_kv(index);
+	j_message_send(message, source->connection);
+
+	/* The replies are received lazily by j_kv_iterator_next(). */
+	source->request = j_message_ref(message);
+	source->reply = j_message_new_reply(message);
+	source->reply_shared = FALSE;
+}
+
+/**
+ * Sends the request for the results of a server.
+ **/
+static
+void
+j_kv_iterator_source_init (JKVIteratorSource* source, guint32 index, gint replica, gchar const* namespace, gchar const* prefix, gchar const* delimiter, gchar const* start_after, guint32 limit, bson_t const* filter, gchar const* const* fields)
+{
+	g_autoptr(JMessage) message = NULL;
+	gsize namespace_len;
+	gsize prefix_len;
+	gsize delimiter_len;
+	gsize start_after_len;
+	gsize fields_size = 0;
+	guint32 fields_len = 0;
+	gboolean compact;
+
+	namespace_len = strlen(namespace) + 1;
+	compact = (replica >= 0) ? j_connection_pool_get_compact_kv_replica(index, replica) : j_connection_pool_get_compact_kv(index);
+
+	if (prefix == NULL && delimiter == NULL && start_after == NULL && limit == 0 && filter == NULL && fields == NULL)
+	{
+		message = j_message_new(J_MESSAGE_KV_GET_ALL, namespace_len);
+		j_message_set_compact(message, compact);
+		j_message_append_n(message, namespace, namespace_len);
+	}
+	else
+	{
+		/* An empty key to start after starts at the beginning of the prefix. */
+		prefix = (prefix != NULL) ? prefix : "";
+		delimiter = (delimiter != NULL) ? delimiter : "";
+		start_after = (start_after != NULL) ? start_after : "";
+
+		prefix_len = strlen(prefix) + 1;
+		delimiter_len = strlen(delimiter) + 1;
+		start_after_len = strlen(start_after) + 1;
+
+		if (fields != NULL)
+		{
+			for (fields_len = 0; fields[fields_len] != NULL; fields_len++)
+			{
+				fields_size += strlen(fields[fields_len]) + 1;
+			}
+		}
+
+		message = j_message_new(J_MESSAGE_KV_GET_BY_PREFIX, namespace_len + prefix_len + start_after_len + 3 * sizeof(guint64) + ((filter != NULL) ? filter->len : 0) + fields_size + delimiter_len);
+		j_message_set_compact(message, compact);
+		j_message_append_n(message, namespace, namespace_len);
+		j_message_append_n(message, prefix, prefix_len);
+		j_message_append_n(message, start_after, start_after_len);
+		j_message_append_varint(message, limit);
+
+		/* The filter and the fields are evaluated by the server, so that only the requested data is sent. */
+		if (filter != NULL)
 		{
-			j_backend_kv_get_all(iterator->kv_backend, namespace, &(iterator->cursor));
+			j_message_append_varint(message, filter->len);
+			j_message_append_n(message, bson_get_data(filter), filter->len);
 		}
 		else
 		{
-			j_backend_kv_get_by_prefix(iterator->kv_backend, namespace, prefix, &(iterator->cursor));
+			j_message_append_varint(message, 0);
 		}
+
+		j_message_append_varint(message, fields_len);
+
+		for (guint32 i = 0; i < fields_len; i++)
+		{
+			j_message_append_n(message, fields[i], strlen(fields[i]) + 1);
+		}
+
+		/* An empty delimiter returns all keys with the prefix. */
+		j_message_append_n(message, delimiter, delimiter_len);
 	}
-	else
+
+	j_kv_iterator_source_start(source, index, replica, message);
+}
+
+/**
+ * Sends the request for the values of a server whose field matches a range.
+ **/
+static
+void
+j_kv_iterator_source_init_index (JKVIteratorSource* source, guint32 index, gchar const* namespace, gchar const* field, bson_t const* range, gchar const* const* fields)
+{
+	g_autoptr(JMessage) message = NULL;
+	gsize namespace_len;
+	gsize field_len;
+	gsize fields_size = 0;
+	guint32 fields_len = 0;
+
+	namespace_len = strlen(namespace) + 1;
+	field_len = strlen(field) + 1;
+
+	if (fields != NULL)
+	{
+		for (fields_len = 0; fields[fields_len] != NULL; fields_len++)
+		{
+			fields_size += strlen(fields[fields_len]) + 1;
+		}
+	}
+
+	message = j_message_new(J_MESSAGE_KV_GET_BY_INDEX, namespace_len + field_len + 3 * sizeof(guint64) + range->len + fields_size);
+	j_message_set_compact(message, j_connection_pool_get_compact_kv(index));
+	j_message_append_n(message, namespace, namespace_len);
+	j_message_append_n(message, field, field_len);
+	j_message_append_varint(message, range->len);
+	j_message_append_n(message, bson_get_data(range), range->len);
+	/* No limit */
+	j_message_append_varint(message, 0);
+	j_message_append_varint(message, fields_len);
+
+	for (guint32 i = 0; i < fields_len; i++)
 	{
-		g_autoptr(JMessage) message = NULL;
-		JMessageType message_type;
-		GSocketConnection* kv_connection;
-		gsize namespace_len;
-		gsize prefix_len;
+		j_message_append_n(message, fields[i], strlen(fields[i]) + 1);
+	}
 
-		namespace_len = strlen(namespace) + 1;
+	/* Replicas do not maintain indexes. */
+	j_kv_iterator_source_start(source, index, -1, message);
+}
 
-		if (prefix == NULL)
+static
+JKVIterator*
+j_kv_iterator_new_internal (guint32 index, guint32 sources_len, gchar const* namespace, gchar const* prefix, gchar const* delimiter, gboolean ordered, gchar const* start_after, guint32 limit, bson_t const* filter, gchar const* const* fields, gboolean eventual)
+{
+	JKVIterator* iterator;
+
+	/* Iterators do not use batches, so cached puts and deletes have to be executed first. */
+	j_batch_wait_cached();
+
+	iterator = g_slice_new(JKVIterator);
+	iterator->kv_backend = j_kv_backend_for_namespace(namespace);
+	iterator->cursor = NULL;
+	iterator->current_key = NULL;
+	iterator->current_owner = NULL;
+	iterator->ordered = ordered;
+	iterator->remaining = (limit > 0) ? limit : G_MAXUINT32;
+	iterator->filter = NULL;
+	iterator->fields = NULL;
+	iterator->delimiter = NULL;
+	iterator->prefix_len = 0;
+	iterator->has_projected = FALSE;
+	iterator->sources = NULL;
+	iterator->sources_len = 0;
+	iterator->current_source = 0;
+
+	if (iterator->kv_backend != NULL)
+	{
+		gboolean ret;
+
+		if (ordered)
+		{
+			/* Skipped keys must not count towards the limit, which is enforced by j_kv_iterator_next() instead. */
+			ret = j_backend_kv_get_range(iterator->kv_backend, namespace, (prefix != NULL) ? prefix : "", start_after, (delimiter == NULL) ? limit : 0, &(iterator->cursor));
+		}
+		else if (prefix == NULL)
 		{
-			message_type = J_MESSAGE_KV_GET_ALL;
-			prefix_len = 0;
+			ret = j_backend_kv_get_all(iterator->kv_backend, namespace, &(iterator->cursor));
 		}
 		else
 		{
-			message_type = J_MESSAGE_KV_GET_BY_PREFIX;
-			prefix_len = strlen(prefix) + 1;
+			ret = j_backend_kv_get_by_prefix(iterator->kv_backend, namespace, prefix, &(iterator->cursor));
 		}
 
-		message = j_message_new(message_type, namespace_len + prefix_len);
-		j_message_append_n(message, namespace, namespace_len);
+		if (!ret)
+		{
+			iterator->cursor = NULL;
+		}
 
-		if (prefix != NULL)
+		if (filter != NULL)
 		{
-			j_message_append_n(message, prefix, prefix_len);
+			iterator->filter = bson_copy(filter);
 		}
 
-		kv_connection = j_connection_pool_pop_kv(index);
-		j_message_send(message, kv_connection);
+		iterator->fields = g_strdupv((gchar**)fields);
+		iterator->delimiter = g_strdup(delimiter);
+		iterator->prefix_len = (prefix != NULL) ? strlen(prefix) : 0;
+	}
+	else
+	{
+		iterator->sources = g_new(JKVIteratorSource, sources_len);
+		iterator->sources_len = sources_len;
 
-		iterator->reply = j_message_new_reply(message);
-		j_message_receive(iterator->reply, kv_connection);
+		for (guint32 i = 0; i < sources_len; i++)
+		{
+			gint replica;
 
-		j_connection_pool_push_kv(index, kv_connection);
+			replica = (eventual) ? j_connection_pool_pick_kv_replica(index + i) : -1;
+			j_kv_iterator_source_init(&(iterator->sources[i]), index + i, replica, namespace, prefix, delimiter, start_after, limit, filter, fields);
+		}
+	}
+
+	return iterator;
+}
+
+/**
+ * Creates a new JKVIterator for one key-value server.
+ * Keys are spread over all servers by j_kv_new(), so use j_kv_iterator_new_for_prefix() to get all of a namespace's values.
+ *
+ * \author Michael Kuhn
+ *
+ * \param index     The index of the server.
+ * \param namespace A namespace.
+ * \param prefix    A key prefix, NULL to iterate over all keys.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new (guint32 index, gchar const* namespace, gchar const* prefix)
+{
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(index < j_configuration_get_kv_server_count(configuration), NULL);
+
+	return j_kv_iterator_new_internal(index, 1, namespace, prefix, NULL, FALSE, NULL, 0, NULL, NULL, FALSE);
+}
+
+/**
+ * Creates a new JKVIterator for all key-value servers.
+ * Keys are spread over all servers by j_kv_new(), so this returns all of the namespace's values.
+ * The values of one server are returned before the ones of the next server.
+ *
+ * \author Michael Kuhn
+ *
+ * \param namespace A namespace.
+ * \param prefix    A key prefix, NULL to iterate over all keys.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_for_prefix (gchar const* namespace, gchar const* prefix)
+{
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_kv_server_count(configuration), namespace, prefix, NULL, FALSE, NULL, 0, NULL, NULL, FALSE);
+}
+
+/**
+ * Creates a new JKVIterator for all key-value servers that honors the consistency semantics.
+ * Unless immediate consistency is requested, the values may be read from a server's read replicas.
+ * These can lag behind the server, so recent changes might not be returned yet.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JSemantics) semantics = NULL;
+ * JKVIterator* iterator;
+ *
+ * semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+ * j_semantics_set(semantics, J_SEMANTICS_CONSISTENCY, J_SEMANTICS_CONSISTENCY_EVENTUAL);
+ * iterator = j_kv_iterator_new_for_semantics("items", "collection/", semantics);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param prefix    A key prefix, NULL to iterate over all keys.
+ * \param semantics A semantics object.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_for_semantics (gchar const* namespace, gchar const* prefix, JSemantics* semantics)
+{
+	JConfiguration* configuration = j_configuration();
+	gboolean eventual;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(semantics != NULL, NULL);
+
+	eventual = (j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) != J_SEMANTICS_CONSISTENCY_IMMEDIATE);
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_kv_server_count(configuration), namespace, prefix, NULL, FALSE, NULL, 0, NULL, NULL, eventual);
+}
+
+/**
+ * Creates a new JKVIterator for a range of keys on all key-value servers.
+ * The values are returned in ascending key order, the results of all servers are merged.
+ * Each server only looks at the requested range, so this can be used to page through large namespaces.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JKVIterator* iterator;
+ *
+ * iterator = j_kv_iterator_new_range("items", "collection/", last_key, 100);
+ * \endcode
+ *
+ * \param namespace   A namespace.
+ * \param prefix      A key prefix, NULL to iterate over all keys.
+ * \param start_after Only keys that sort after this one are returned, NULL to start at the first key.
+ * \param limit       The maximum number of values, 0 for no limit.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_range (gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit)
+{
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_kv_server_count(configuration), namespace, prefix, NULL, TRUE, start_after, limit, NULL, NULL, FALSE);
+}
+
+/**
+ * Creates a new JKVIterator for the direct children of a prefix on all key-value servers.
+ * Keys that contain the delimiter after the prefix are skipped by the servers, so only the prefix's immediate children are returned.
+ * Like j_kv_iterator_new_range(), the values are returned in ascending key order and can be paged through using start_after and limit.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JKVIterator* iterator;
+ *
+ * iterator = j_kv_iterator_new_children("posix", "/dir/", "/", last_key, 100);
+ * \endcode
+ *
+ * \param namespace   A namespace.
+ * \param prefix      A key prefix.
+ * \param delimiter   A delimiter.
+ * \param start_after Only keys that sort after this one are returned, NULL to start at the first key.
+ * \param limit       The maximum number of values, 0 for no limit.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_children (gchar const* namespace, gchar const* prefix, gchar const* delimiter, gchar const* start_after, guint32 limit)
+{
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(prefix != NULL, NULL);
+	g_return_val_if_fail(delimiter != NULL && delimiter[0] != '\0', NULL);
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_kv_server_count(configuration), namespace, prefix, delimiter, TRUE, start_after, limit, NULL, NULL, FALSE);
+}
+
+/**
+ * Creates a new JKVIterator that only returns values matching a filter.
+ * The filter is evaluated by the servers, see j_helper_bson_match() for the supported conditions.
+ * If fields are given, only these fields are returned, which reduces the amount of transferred data.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * gchar const* fields[] = { "name", "status", NULL };
+ * JKVIterator* iterator;
+ *
+ * iterator = j_kv_iterator_new_filter("items", "collection/", NULL, fields);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param prefix    A key prefix, NULL to iterate over all keys.
+ * \param filter    A filter, NULL to return all values.
+ * \param fields    A NULL-terminated array of field names, NULL to return complete values.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_filter (gchar const* namespace, gchar const* prefix, bson_t const* filter, gchar const* const* fields)
+{
+	JConfiguration* configuration = j_configuration();
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	return j_kv_iterator_new_internal(0, j_configuration_get_kv_server_count(configuration), namespace, prefix, NULL, FALSE, NULL, 0, filter, fields, FALSE);
+}
+
+/**
+ * Creates a new JKVIterator that returns the values whose field matches a range.
+ * Servers use the field's index created with j_kv_create_index() to read only the matching values.
+ * The range supports the conditions of j_helper_bson_match(), $eq, $gt, $gte, $lt and $lte are used to restrict the scan.
+ * Without an index, the servers filter all values.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JKVIterator* iterator;
+ * bson_t range[1];
+ *
+ * bson_init(range);
+ * bson_append_int64(range, "$gt", -1, 1024 * 1024 * 1024);
+ *
+ * iterator = j_kv_iterator_new_index("items", "status.size", range, NULL);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param field     A field, which can be a dotted path.
+ * \param range     A document of conditions.
+ * \param fields    A NULL-terminated array of field names, NULL to return complete values.
+ *
+ * \return A new JKVIterator.
+ **/
+JKVIterator*
+j_kv_iterator_new_index (gchar const* namespace, gchar const* field, bson_t const* range, gchar const* const* fields)
+{
+	JConfiguration* configuration = j_configuration();
+	JKVIterator* iterator;
+	guint32 server_count;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(field != NULL, NULL);
+	g_return_val_if_fail(range != NULL, NULL);
+
+	if (j_kv_backend_for_namespace(namespace) != NULL)
+	{
+		bson_t filter[1];
+
+		/* Client-side backends do not maintain indexes. */
+		bson_init(filter);
+		bson_append_document(filter, field, -1, range);
+		iterator = j_kv_iterator_new_internal(0, 1, namespace, NULL, NULL, FALSE, NULL, 0, filter, fields, FALSE);
+		bson_destroy(filter);
+
+		return iterator;
+	}
+
+	server_count = j_configuration_get_kv_server_count(configuration);
+
+	/* Create the iterator without sources and send the index requests instead. */
+	iterator = j_kv_iterator_new_internal(0, 0, namespace, NULL, NULL, FALSE, NULL, 0, NULL, NULL, FALSE);
+	iterator->sources = g_new(JKVIteratorSource, server_count);
+	iterator->sources_len = server_count;
+
+	for (guint32 i = 0; i < server_count; i++)
+	{
+		j_kv_iterator_source_init_index(&(iterator->sources[i]), i, namespace, field, range, fields);
 	}
 
 	return iterator;
@@ -148,11 +720,47 @@ j_kv_iterator_free (JKVIterator* iterator)
 {
 	g_return_if_fail(iterator != NULL);
 
-	if (iterator->reply != NULL)
+	for (guint32 i = 0; i < iterator->sources_len; i++)
+	{
+		JKVIteratorSource* source = &(iterator->sources[i]);
+
+		/* Drain the remaining replies, the connection could not be reused otherwise. */
+		while (source->connection != NULL)
+		{
+			gchar const* key;
+			gconstpointer data;
+
+			j_kv_iterator_source_next(source, &key, &data);
+		}
+
+		j_message_unref(source->reply);
+		j_message_unref(source->request);
+	}
+
+	g_free(iterator->sources);
+
+	/* Backends only free their cursors once they are exhausted. */
+	while (iterator->cursor != NULL)
+	{
+		if (!j_backend_kv_iterate(iterator->kv_backend, iterator->cursor, &(iterator->current_key), iterator->current))
+		{
+			iterator->cursor = NULL;
+		}
+	}
+
+	if (iterator->filter != NULL)
+	{
+		bson_destroy(iterator->filter);
+	}
+
+	if (iterator->has_projected)
 	{
-		j_message_unref(iterator->reply);
+		bson_destroy(iterator->projected);
 	}
 
+	g_strfreev(iterator->fields);
+	g_free(iterator->delimiter);
+
 	g_slice_free(JKVIterator, iterator);
 }
 
@@ -175,26 +783,99 @@ j_kv_iterator_next (JKVIterator* iterator)
 
 	g_return_val_if_fail(iterator != NULL, FALSE);
 
+	if (iterator->remaining == 0)
+	{
+		return FALSE;
+	}
+
 	if (iterator->kv_backend != NULL)
 	{
-		ret = j_backend_kv_iterate(iterator->kv_backend, iterator->cursor, iterator->current);
+		if (iterator->has_projected)
+		{
+			bson_destroy(iterator->projected);
+			iterator->has_projected = FALSE;
+		}
+
+		while (iterator->cursor != NULL && !ret)
+		{
+			if (!j_backend_kv_iterate(iterator->kv_backend, iterator->cursor, &(iterator->current_key), iterator->current))
+			{
+				/* The backend frees the cursor at the end. */
+				iterator->cursor = NULL;
+				break;
+			}
+
+			ret = (iterator->filter == NULL || j_helper_bson_match(iterator->current, iterator->filter))
+				&& (iterator->delimiter == NULL || strstr(iterator->current_key + iterator->prefix_len, iterator->delimiter) == NULL);
+		}
+
+		if (ret && iterator->fields != NULL)
+		{
+			j_helper_bson_project(iterator->current, (gchar const* const*)iterator->fields, iterator->projected);
+			iterator->has_projected = TRUE;
+		}
 	}
-	else
+	else if (iterator->ordered)
 	{
-		guint32 len;
+		JKVIteratorSource* next = NULL;
+
+		/* Every server returns its keys in order, so the smallest of their next keys is the next one overall. */
+		for (guint32 i = 0; i < iterator->sources_len; i++)
+		{
+			JKVIteratorSource* source = &(iterator->sources[i]);
 
-		len = j_message_get_4(iterator->reply);
+			if (source->head_len == 0)
+			{
+				source->head_len = j_kv_iterator_source_next(source, &(source->head_key), &(source->head_data));
+			}
 
-		if (len > 0)
+			if (source->head_len > 0 && (next == NULL || g_strcmp0(source->head_key, next->head_key) < 0))
+			{
+				next = source;
+			}
+		}
+
+		if (next != NULL)
 		{
-			gconstpointer data;
+			bson_init_static(iterator->current, next->head_data, next->head_len);
+			iterator->current_key = next->head_key;
+			iterator->current_owner = next;
 
-			data = j_message_get_n(iterator->reply, len);
-			bson_init_static(iterator->current, data, len);
+			/* The data stays valid until the next result of this source is received. */
+			next->head_len = 0;
 
 			ret = TRUE;
 		}
 	}
+	else
+	{
+		/* Continue with the next server once a server's results have been consumed. */
+		while (!ret && iterator->current_source < iterator->sources_len)
+		{
+			JKVIteratorSource* source = &(iterator->sources[iterator->current_source]);
+			gconstpointer data;
+			guint32 len;
+
+			len = j_kv_iterator_source_next(source, &(iterator->current_key), &data);
+
+			if (len > 0)
+			{
+				bson_init_static(iterator->current, data, len);
+				iterator->current_owner = source;
+
+				ret = TRUE;
+			}
+			else
+			{
+				iterator->current_source++;
+			}
+		}
+	}
+
+	if (ret)
+	{
+		iterator->remaining--;
+	}
 
 	return ret;
 }
@@ -216,10 +897,76 @@ j_kv_iterator_get (JKVIterator* iterator)
 {
 	g_return_val_if_fail(iterator != NULL, NULL);
 
-	// FIXME return key
+	if (iterator->has_projected)
+	{
+		return iterator->projected;
+	}
+
 	return iterator->current;
 }
 
+/**
+ * Returns the key of the current value.
+ * It can be passed to j_kv_iterator_new_range() to continue after the current value.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param iterator A store iterator.
+ *
+ * \return The key, which is only valid until the next call to j_kv_iterator_next().
+ **/
+gchar const*
+j_kv_iterator_get_key (JKVIterator* iterator)
+{
+	g_return_val_if_fail(iterator != NULL, NULL);
+
+	return iterator->current_key;
+}
+
+/**
+ * Returns the current value without copying it.
+ * In contrast to j_kv_iterator_get(), the value stays valid after j_kv_iterator_next().
+ * Values received from servers reference the reply they are contained in, only values of client-side backends are copied.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(GBytes) bytes = NULL;
+ * bson_t value[1];
+ * gconstpointer data;
+ * gsize len;
+ *
+ * bytes = j_kv_iterator_get_bytes(iterator);
+ * data = g_bytes_get_data(bytes, &len);
+ * bson_init_static(value, data, len);
+ * \endcode
+ *
+ * \param iterator A store iterator.
+ *
+ * \return The value. Should be freed with g_bytes_unref().
+ **/
+GBytes*
+j_kv_iterator_get_bytes (JKVIterator* iterator)
+{
+	bson_t const* value;
+
+	g_return_val_if_fail(iterator != NULL, NULL);
+
+	value = j_kv_iterator_get(iterator);
+
+	if (iterator->kv_backend != NULL || iterator->current_owner == NULL)
+	{
+		return g_bytes_new(bson_get_data(value), value->len);
+	}
+
+	iterator->current_owner->reply_shared = TRUE;
+
+	return g_bytes_new_with_free_func(bson_get_data(value), value->len, (GDestroyNotify)j_message_unref, j_message_ref(iterator->current_owner->reply));
+}
+
 /**
  * @}
  **/
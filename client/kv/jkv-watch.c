@@ -0,0 +1,479 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <kv/jkv-watch.h>
+
+#include <julea.h>
+
+/**
+ * \defgroup JKVWatch KV Watch
+ *
+ * Data structures and functions for watching key-value pairs.
+ *
+ * @{
+ **/
+
+/**
+ * A change of a watched key-value pair.
+ **/
+struct JKVWatchEvent
+{
+	gchar* key;
+	gboolean deleted;
+
+	/**
+	 * The value after the change, NULL if values have not been requested or the pair has been deleted.
+	 **/
+	bson_t* value;
+};
+
+typedef struct JKVWatchEvent JKVWatchEvent;
+
+/**
+ * The notifications of one server.
+ **/
+struct JKVWatchSource
+{
+	JKVWatch* watch;
+
+	GSocketConnection* connection;
+
+	/**
+	 * Receives the server's notifications and queues their events.
+	 **/
+	GThread* thread;
+};
+
+typedef struct JKVWatchSource JKVWatchSource;
+
+struct JKVWatch
+{
+	gboolean values;
+
+	/**
+	 * The servers the notifications are received from.
+	 * Keys are spread over all servers, so every server has to be watched.
+	 **/
+	JKVWatchSource* sources;
+	guint32 sources_len;
+
+	/**
+	 * The received events.
+	 **/
+	GAsyncQueue* events;
+
+	/**
+	 * The number of sources that still receive notifications.
+	 **/
+	gint active;
+
+	/**
+	 * The current event, NULL before the first call to j_kv_watch_next().
+	 **/
+	JKVWatchEvent* current;
+};
+
+/**
+ * Queued when a source has stopped receiving notifications.
+ **/
+static JKVWatchEvent j_kv_watch_end;
+
+static
+void
+j_kv_watch_event_free (JKVWatchEvent* event)
+{
+	if (event == NULL || event == &j_kv_watch_end)
+	{
+		return;
+	}
+
+	if (event->value != NULL)
+	{
+		bson_destroy(event->value);
+	}
+
+	g_free(event->key);
+	g_slice_free(JKVWatchEvent, event);
+}
+
+/**
+ * Receives a server's notifications until the connection is closed.
+ * Every operation consists of the key, whether it has been deleted and, if values have been requested, its value.
+ *
+ * \private
+ **/
+static
+gpointer
+j_kv_watch_source_receive (gpointer data)
+{
+	JKVWatchSource* source = data;
+	JKVWatch* watch = source->watch;
+	g_autoptr(JMessage) message = NULL;
+
+	message = j_message_new(J_MESSAGE_NONE, 0);
+
+	while (j_message_receive(message, source->connection))
+	{
+		guint32 operation_count;
+
+		operation_count = j_message_get_count(message);
+
+		for (guint32 i = 0; i < operation_count; i++)
+		{
+			JKVWatchEvent* event;
+
+			event = g_slice_new(JKVWatchEvent);
+			event->key = g_strdup(j_message_get_string(message));
+			event->deleted = (j_message_get_1(message) != 0);
+			event->value = NULL;
+
+			if (watch->values)
+			{
+				guint32 len;
+
+				len = j_message_get_varint(message);
+
+				if (len > 0)
+				{
+					event->value = bson_new_from_data(j_message_get_n(message, len), len);
+				}
+			}
+
+			g_async_queue_push(watch->events, event);
+		}
+
+		j_message_reset(message);
+	}
+
+	g_atomic_int_add(&(watch->active), -1);
+	g_async_queue_push(watch->events, &j_kv_watch_end);
+
+	return NULL;
+}
+
+/**
+ * Starts watching a server.
+ *
+ * \private
+ *
+ * \return TRUE if the server accepted the watch, FALSE otherwise.
+ **/
+static
+gboolean
+j_kv_watch_source_init (JKVWatchSource* source, JKVWatch* watch, guint32 index, gchar const* namespace, gchar const* prefix)
+{
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	gsize namespace_len;
+	gsize prefix_len;
+	gchar values;
+
+	source->watch = watch;
+	source->thread = NULL;
+	source->connection = j_connection_pool_connect_kv(index);
+
+	if (source->connection == NULL)
+	{
+		return FALSE;
+	}
+
+	namespace_len = strlen(namespace) + 1;
+	prefix_len = strlen(prefix) + 1;
+	values = watch->values;
+
+	message = j_message_new(J_MESSAGE_KV_WATCH, namespace_len);
+	j_message_append_n(message, namespace, namespace_len);
+	j_message_add_operation(message, prefix_len + 1);
+	j_message_append_n(message, prefix, prefix_len);
+	j_message_append_1(message, &values);
+
+	reply = j_message_new_reply(message);
+
+	if (!j_message_send(message, source->connection) || !j_message_receive(reply, source->connection))
+	{
+		return FALSE;
+	}
+
+	if (j_message_get_count(reply) != 1 || j_message_get_1(reply) == 0)
+	{
+		return FALSE;
+	}
+
+	g_atomic_int_add(&(watch->active), 1);
+	source->thread = g_thread_new("julea-kv-watch", j_kv_watch_source_receive, source);
+
+	return TRUE;
+}
+
+/**
+ * Creates a new JKVWatch for all key-value pairs with a prefix on all key-value servers.
+ * Each watch uses dedicated connections, over which the servers push changes as they happen.
+ * Fast updates of the same key are coalesced, so only the most recent change might be reported.
+ * Watches require key-value servers, NULL is returned if the backend is accessed directly.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JKVWatch) watch = NULL;
+ *
+ * watch = j_kv_watch_new("tasks", "status/", FALSE);
+ *
+ * while (j_kv_watch_next(watch, -1))
+ * {
+ *   g_print("%s changed\n", j_kv_watch_get_key(watch));
+ * }
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param prefix    A key prefix, "" to watch the whole namespace.
+ * \param values    Whether notifications should include the current values.
+ *
+ * \return A new watch, NULL if not all servers could be watched. Should be freed with j_kv_watch_free().
+ **/
+JKVWatch*
+j_kv_watch_new (gchar const* namespace, gchar const* prefix, gboolean values)
+{
+	JKVWatch* watch;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(prefix != NULL, NULL);
+
+	if (j_kv_backend_for_namespace(namespace) != NULL)
+	{
+		return NULL;
+	}
+
+	watch = g_slice_new(JKVWatch);
+	watch->values = values;
+	watch->sources_len = j_configuration_get_kv_server_count(j_configuration());
+	watch->sources = g_new(JKVWatchSource, watch->sources_len);
+	watch->events = g_async_queue_new();
+	watch->active = 0;
+	watch->current = NULL;
+
+	for (guint32 i = 0; i < watch->sources_len; i++)
+	{
+		ret = j_kv_watch_source_init(&(watch->sources[i]), watch, i, namespace, prefix) && ret;
+	}
+
+	if (!ret)
+	{
+		j_kv_watch_free(watch);
+		watch = NULL;
+	}
+
+	return watch;
+}
+
+/**
+ * Frees the memory allocated by the watch and closes its connections.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param watch A watch.
+ **/
+void
+j_kv_watch_free (JKVWatch* watch)
+{
+	JKVWatchEvent* event;
+
+	g_return_if_fail(watch != NULL);
+
+	for (guint32 i = 0; i < watch->sources_len; i++)
+	{
+		JKVWatchSource* source = &(watch->sources[i]);
+
+		if (source->connection == NULL)
+		{
+			continue;
+		}
+
+		/* Wake up the receiving thread. */
+		g_socket_shutdown(g_socket_connection_get_socket(source->connection), TRUE, TRUE, NULL);
+
+		if (source->thread != NULL)
+		{
+			g_thread_join(source->thread);
+		}
+
+		g_io_stream_close(G_IO_STREAM(source->connection), NULL, NULL);
+		g_object_unref(source->connection);
+	}
+
+	while ((event = g_async_queue_try_pop(watch->events)) != NULL)
+	{
+		j_kv_watch_event_free(event);
+	}
+
+	j_kv_watch_event_free(watch->current);
+	g_async_queue_unref(watch->events);
+	g_free(watch->sources);
+
+	g_slice_free(JKVWatch, watch);
+}
+
+/**
+ * Waits for the next change.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param watch   A watch.
+ * \param timeout The maximum time to wait in microseconds, -1 to wait indefinitely.
+ *
+ * \return TRUE if there is a change, FALSE if the timeout has expired or all servers have closed their connections.
+ **/
+gboolean
+j_kv_watch_next (JKVWatch* watch, gint64 timeout)
+{
+	JKVWatchEvent* event = NULL;
+	gint64 end_time;
+
+	g_return_val_if_fail(watch != NULL, FALSE);
+
+	j_kv_watch_event_free(watch->current);
+	watch->current = NULL;
+
+	if (g_atomic_int_get(&(watch->active)) == 0 && g_async_queue_length(watch->events) <= 0)
+	{
+		return FALSE;
+	}
+
+	end_time = (timeout >= 0) ? g_get_monotonic_time() + timeout : -1;
+
+	while (event == NULL)
+	{
+		if (end_time < 0)
+		{
+			event = g_async_queue_pop(watch->events);
+		}
+		else
+		{
+			gint64 remaining;
+
+			remaining = MAX(end_time - g_get_monotonic_time(), 0);
+			event = g_async_queue_timeout_pop(watch->events, remaining);
+
+			if (event == NULL)
+			{
+				return FALSE;
+			}
+		}
+
+		if (event == &j_kv_watch_end)
+		{
+			event = NULL;
+
+			/* Events that have been queued before the end marker have already been returned. */
+			if (g_atomic_int_get(&(watch->active)) == 0 && g_async_queue_length(watch->events) <= 0)
+			{
+				return FALSE;
+			}
+		}
+	}
+
+	watch->current = event;
+
+	return TRUE;
+}
+
+/**
+ * Returns the key of the current change.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param watch A watch.
+ *
+ * \return The key.
+ **/
+gchar const*
+j_kv_watch_get_key (JKVWatch* watch)
+{
+	g_return_val_if_fail(watch != NULL, NULL);
+	g_return_val_if_fail(watch->current != NULL, NULL);
+
+	return watch->current->key;
+}
+
+/**
+ * Returns whether the current change has deleted the key-value pair.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param watch A watch.
+ *
+ * \return TRUE if the pair has been deleted, FALSE if it has been put or modified.
+ **/
+gboolean
+j_kv_watch_is_deleted (JKVWatch* watch)
+{
+	g_return_val_if_fail(watch != NULL, FALSE);
+	g_return_val_if_fail(watch->current != NULL, FALSE);
+
+	return watch->current->deleted;
+}
+
+/**
+ * Returns the value after the current change.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param watch A watch.
+ *
+ * \return The value, NULL if values have not been requested, the pair has been deleted or its value is not a BSON document.
+ **/
+bson_t const*
+j_kv_watch_get (JKVWatch* watch)
+{
+	g_return_val_if_fail(watch != NULL, NULL);
+	g_return_val_if_fail(watch->current != NULL, NULL);
+
+	return watch->current->value;
+}
+
+/**
+ * @}
+ **/
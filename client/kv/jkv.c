@@ -48,8 +48,14 @@ struct JKVOperation
 		{
 			JKV* kv;
 			bson_t* value;
+			GBytes** bytes;
 			JKVGetFunc func;
 			gpointer data;
+
+			/**
+			 * Whether #bytes should receive a raw value.
+			 **/
+			gboolean raw;
 		}
 		get;
 
@@ -59,6 +65,48 @@ struct JKVOperation
 			bson_t* value;
 		}
 		put;
+
+		struct
+		{
+			JKV* kv;
+			GBytes* value;
+		}
+		put_raw;
+
+		struct
+		{
+			JKV* kv;
+			guint64 expected;
+			bson_t* value;
+			guint64* version;
+		}
+		compare_and_swap;
+
+		struct
+		{
+			JKV* kv;
+			gchar* field;
+			gint64 delta;
+			gint64* result;
+		}
+		increment;
+
+		struct
+		{
+			JKV* kv;
+			bson_t* value;
+		}
+		max_merge;
+
+		struct
+		{
+			JKV* kv;
+			GBytes** values;
+			guint32 count;
+			JKVGetManyFunc func;
+			gpointer data;
+		}
+		get_many;
 	};
 };
 
@@ -84,6 +132,13 @@ struct JKV
 	 **/
 	gchar* key;
 
+	/**
+	 * The key used for combining operations.
+	 * It is shared by all KVs, so operations of different namespaces and servers are combined.
+	 * Gets of all namespaces are sent in one message per server, other operations are split by namespace.
+	 **/
+	GQuark batch_key;
+
 	/**
 	 * The reference count.
 	 **/
@@ -100,8 +155,16 @@ j_kv_put_free (gpointer data)
 	bson_destroy(operation->put.value);
 	// FIXME
 	g_slice_free(bson_t, operation->put.value);
+}
+
+static
+void
+j_kv_put_raw_free (gpointer data)
+{
+	JKVOperation* operation = data;
 
-	g_slice_free(JKVOperation, operation);
+	j_kv_unref(operation->put_raw.kv);
+	g_bytes_unref(operation->put_raw.value);
 }
 
 static
@@ -113,229 +176,576 @@ j_kv_delete_free (gpointer data)
 	j_kv_unref(kv);
 }
 
+static
+guint64
+j_kv_put_cache_size (gpointer data)
+{
+	JKVOperation* operation = data;
+
+	return operation->put.value->len;
+}
+
+/**
+ * Moves a put's value into the operation cache.
+ * The put already owns its value, but moving it makes pending puts count towards the cache's size.
+ *
+ * \private
+ **/
 static
 void
-j_kv_get_free (gpointer data)
+j_kv_put_cache (gpointer data, gpointer buffer)
 {
 	JKVOperation* operation = data;
+	guint32 len;
 
-	j_kv_unref(operation->get.kv);
+	len = operation->put.value->len;
+	memcpy(buffer, bson_get_data(operation->put.value), len);
 
-	g_slice_free(JKVOperation, operation);
+	bson_destroy(operation->put.value);
+	bson_init_static(operation->put.value, buffer, len);
 }
 
 static
-gboolean
-j_kv_put_exec (JList* operations, JSemantics* semantics)
+guint64
+j_kv_put_raw_cache_size (gpointer data)
 {
-	gboolean ret = TRUE;
+	JKVOperation* operation = data;
 
-	JBackend* kv_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) message = NULL;
-	JSemanticsSafety safety;
-	gchar const* namespace;
-	gpointer kv_batch;
-	gsize namespace_len;
-	guint32 index;
+	return g_bytes_get_size(operation->put_raw.value);
+}
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+/**
+ * Moves a raw put's value into the operation cache, like for j_kv_put_cache().
+ *
+ * \private
+ **/
+static
+void
+j_kv_put_raw_cache (gpointer data, gpointer buffer)
+{
+	JKVOperation* operation = data;
+	gconstpointer value_data;
+	gsize len;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	value_data = g_bytes_get_data(operation->put_raw.value, &len);
+	memcpy(buffer, value_data, len);
 
-	{
-		JKVOperation* kop;
+	g_bytes_unref(operation->put_raw.value);
+	operation->put_raw.value = g_bytes_new_static(buffer, len);
+}
 
-		kop = j_list_get_first(operations);
-		g_assert(kop != NULL);
+/**
+ * Deletes do not reference the caller's memory, so there is nothing to copy.
+ *
+ * \private
+ **/
+static
+void
+j_kv_delete_cache (gpointer data, gpointer buffer)
+{
+	(void)data;
+	(void)buffer;
+}
 
-		namespace = kop->put.kv->namespace;
-		namespace_len = strlen(namespace) + 1;
-		index = kop->put.kv->index;
-	}
+static
+void
+j_kv_get_free (gpointer data)
+{
+	JKVOperation* operation = data;
 
-	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
-	it = j_list_iterator_new(operations);
-	kv_backend = j_kv_backend();
+	j_kv_unref(operation->get.kv);
+}
 
-	if (kv_backend != NULL)
-	{
-		ret = j_backend_kv_batch_start(kv_backend, namespace, safety, &kv_batch);
-	}
-	else
-	{
-		/**
-		 * Force safe semantics to make the server send a reply.
-		 * Otherwise, nasty races can occur when using unsafe semantics:
-		 * - The client creates the item and sends its first write.
-		 * - The client sends another operation using another connection from the pool.
-		 * - The second operation is executed first and fails because the item does not exist.
-		 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
-		 **/
-		message = j_message_new(J_MESSAGE_KV_PUT, namespace_len);
-		j_message_set_safety(message, semantics);
-		//j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
-		j_message_append_n(message, namespace, namespace_len);
-	}
+static
+void
+j_kv_compare_and_swap_free (gpointer data)
+{
+	JKVOperation* operation = data;
 
-	while (j_list_iterator_next(it))
-	{
-		JKVOperation* kop = j_list_iterator_get(it);
+	j_kv_unref(operation->compare_and_swap.kv);
+	bson_destroy(operation->compare_and_swap.value);
+}
 
-		if (kv_backend != NULL)
-		{
-			ret = j_backend_kv_put(kv_backend, kv_batch, kop->put.kv->key, kop->put.value) && ret;
-		}
-		else
-		{
-			gsize key_len;
+static
+void
+j_kv_increment_free (gpointer data)
+{
+	JKVOperation* operation = data;
 
-			key_len = strlen(kop->put.kv->key) + 1;
+	j_kv_unref(operation->increment.kv);
+	g_free(operation->increment.field);
+}
 
-			j_message_add_operation(message, key_len + 4 + kop->put.value->len);
-			j_message_append_n(message, kop->put.kv->key, key_len);
-			j_message_append_4(message, &(kop->put.value->len));
-			j_message_append_n(message, bson_get_data(kop->put.value), kop->put.value->len);
-		}
-	}
+static
+void
+j_kv_get_many_free (gpointer data)
+{
+	JKVOperation* operation = data;
 
-	if (kv_backend != NULL)
+	j_kv_unref(operation->get_many.kv);
+
+	for (guint32 i = 0; i < operation->get_many.count; i++)
 	{
-		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
+		if (operation->get_many.values[i] != NULL)
+		{
+			g_bytes_unref(operation->get_many.values[i]);
+		}
 	}
-	else
-	{
-		GSocketConnection* kv_connection;
 
-		kv_connection = j_connection_pool_pop_kv(index);
-		j_message_send(message, kv_connection);
+	g_free(operation->get_many.values);
+}
 
-		if (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-		{
-			g_autoptr(JMessage) reply = NULL;
+static
+void
+j_kv_max_merge_free (gpointer data)
+{
+	JKVOperation* operation = data;
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, kv_connection);
+	j_kv_unref(operation->max_merge.kv);
+	bson_destroy(operation->max_merge.value);
+}
 
-			/* FIXME do something with reply */
-		}
+/**
+ * The messages sent to one server.
+ */
+struct JKVBackgroundData
+{
+	/**
+	 * The server's index.
+	 */
+	guint32 index;
 
-		j_connection_pool_push_kv(index, kv_connection);
-	}
+	/**
+	 * The read replica's index, -1 for the server itself.
+	 */
+	gint replica;
 
-	j_trace_leave(G_STRFUNC);
+	/**
+	 * The message.
+	 */
+	JMessage* message;
 
-	return ret;
-}
+	/**
+	 * The get operations answered by the reply, in order, NULL for other operations.
+	 */
+	JList* operations;
+
+	/**
+	 * Whether the request succeeded.
+	 */
+	gboolean ret;
+};
 
+typedef struct JKVBackgroundData JKVBackgroundData;
+
+/**
+ * Sends a put or delete message to its server.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
 static
-gboolean
-j_kv_delete_exec (JList* operations, JSemantics* semantics)
+gpointer
+j_kv_request_background_operation (gpointer data)
 {
-	gboolean ret = TRUE;
-
-	JBackend* kv_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) message = NULL;
-	JSemanticsSafety safety;
-	gchar const* namespace;
-	gpointer kv_batch;
-	gsize namespace_len;
-	guint32 index;
+	JKVBackgroundData* background_data = data;
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+	g_autoptr(JMessage) reply = NULL;
+	gboolean wait;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	wait = (j_message_get_flags(background_data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0;
+	reply = j_connection_pool_request_kv(background_data->index, background_data->message, wait);
 
+	/* The request failed, timed out or was cancelled. */
+	if (reply == NULL && wait)
 	{
-		JKV* object;
+		background_data->ret = FALSE;
+	}
 
-		object = j_list_get_first(operations);
-		g_assert(object != NULL);
+	/* FIXME do something with reply */
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
-		index = object->index;
-	}
+	return data;
+}
 
-	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
-	it = j_list_iterator_new(operations);
-	kv_backend = j_kv_backend();
+/**
+ * Sends a get message to its server and hands the results to the operations.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
+static
+gpointer
+j_kv_get_background_operation (gpointer data)
+{
+	JKVBackgroundData* background_data = data;
 
-	if (kv_backend != NULL)
+	g_autoptr(JListIterator) iter = NULL;
+	g_autoptr(JMessage) reply = NULL;
+
+	if (background_data->replica >= 0)
 	{
-		ret = j_backend_kv_batch_start(kv_backend, namespace, safety, &kv_batch);
+		reply = j_connection_pool_request_kv_replica(background_data->index, background_data->replica, background_data->message, TRUE);
 	}
 	else
 	{
-		message = j_message_new(J_MESSAGE_KV_DELETE, namespace_len);
-		j_message_set_safety(message, semantics);
-		j_message_append_n(message, namespace, namespace_len);
+		reply = j_connection_pool_request_kv(background_data->index, background_data->message, TRUE);
 	}
 
-	while (j_list_iterator_next(it))
+	if (reply == NULL)
 	{
-		JKV* kv = j_list_iterator_get(it);
+		background_data->ret = FALSE;
+		return data;
+	}
 
-		if (kv_backend != NULL)
+	iter = j_list_iterator_new(background_data->operations);
+
+	while (j_list_iterator_next(iter))
+	{
+		JKVOperation* kop = j_list_iterator_get(iter);
+		gboolean found;
+		guint32 len;
+
+		/* Raw values can be empty, so their replies say whether the key exists. */
+		if (kop->get.raw)
 		{
-			ret = j_backend_kv_delete(kv_backend, kv_batch, kv->key) && ret;
+			found = (j_message_get_1(reply) != 0);
+			len = (found) ? j_message_get_varint(reply) : 0;
 		}
 		else
 		{
-			gsize key_len;
-
-			key_len = strlen(kv->key) + 1;
-
-			j_message_add_operation(message, key_len);
-			j_message_append_n(message, kv->key, key_len);
+			len = j_message_get_varint(reply);
+			found = (len > 0);
 		}
-	}
-
-	if (kv_backend != NULL)
-	{
-		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
-	}
-	else
-	{
-		GSocketConnection* kv_connection;
 
-		kv_connection = j_connection_pool_pop_kv(index);
-		j_message_send(message, kv_connection);
+		background_data->ret = found && background_data->ret;
 
-		if (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+		if (found)
 		{
-			g_autoptr(JMessage) reply = NULL;
+			gconstpointer value_data;
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, kv_connection);
+			value_data = j_message_get_n(reply, len);
 
-			/* FIXME do something with reply */
-		}
+			/* Callbacks and bytes get a view into the reply, only values owned by the caller are copied. */
+			if (kop->get.bytes != NULL)
+			{
+				*(kop->get.bytes) = g_bytes_new_with_free_func(value_data, len, (GDestroyNotify)j_message_unref, j_message_ref(reply));
+			}
+			else
+			{
+				bson_t tmp[1];
 
-		j_connection_pool_push_kv(index, kv_connection);
-	}
+				bson_init_static(tmp, value_data, len);
 
-	j_trace_leave(G_STRFUNC);
+				if (kop->get.func != NULL)
+				{
+					kop->get.func(tmp, kop->get.data);
+				}
+				else
+				{
+					bson_copy_to(tmp, kop->get.value);
+				}
+			}
+		}
+	}
 
-	return ret;
+	return data;
 }
 
-static
+/**
+ * Sends a compare-and-swap or increment message to its server and hands the results to the operations.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
+static
+gpointer
+j_kv_update_background_operation (gpointer data)
+{
+	JKVBackgroundData* background_data = data;
+
+	g_autoptr(JListIterator) iter = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	JMessageType type;
+
+	type = j_message_get_type(background_data->message);
+	reply = j_connection_pool_request_kv(background_data->index, background_data->message, TRUE);
+
+	if (reply == NULL)
+	{
+		background_data->ret = FALSE;
+		return data;
+	}
+
+	iter = j_list_iterator_new(background_data->operations);
+
+	while (j_list_iterator_next(iter))
+	{
+		JKVOperation* kop = j_list_iterator_get(iter);
+		gboolean success;
+		guint64 result;
+
+		success = j_message_get_1(reply);
+		result = j_message_get_8(reply);
+
+		background_data->ret = success && background_data->ret;
+
+		if (type == J_MESSAGE_KV_COMPARE_AND_SWAP)
+		{
+			if (kop->compare_and_swap.version != NULL)
+			{
+				*(kop->compare_and_swap.version) = result;
+			}
+		}
+		else if (success && kop->increment.result != NULL)
+		{
+			*(kop->increment.result) = result;
+		}
+	}
+
+	return data;
+}
+
+/**
+ * Sends an index creation or prefix deletion message to its server.
+ * The reply contains one success byte per operation.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
+static
+gpointer
+j_kv_create_index_background_operation (gpointer data)
+{
+	JKVBackgroundData* background_data = data;
+
+	g_autoptr(JMessage) reply = NULL;
+	guint32 count;
+
+	reply = j_connection_pool_request_kv(background_data->index, background_data->message, TRUE);
+
+	if (reply == NULL)
+	{
+		background_data->ret = FALSE;
+		return data;
+	}
+
+	count = j_message_get_count(reply);
+
+	for (guint32 i = 0; i < count; i++)
+	{
+		background_data->ret = j_message_get_1(reply) && background_data->ret;
+	}
+
+	return data;
+}
+
+/**
+ * Returns the message for a server, creating it if necessary.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param messages      The messages, one per server.
+ * \param index         The server's index.
+ * \param type          The message type.
+ * \param namespace     The namespace.
+ * \param namespace_len The namespace's length, including the terminating null byte.
+ * \param semantics     The semantics.
+ *
+ * \return The server's message.
+ **/
+static
+JMessage*
+j_kv_get_message (JMessage** messages, guint32 index, JMessageType type, gchar const* namespace, gsize namespace_len, JSemantics* semantics)
+{
+	if (messages[index] == NULL)
+	{
+		messages[index] = j_message_new(type, namespace_len);
+		j_message_set_compact(messages[index], j_connection_pool_get_compact_kv(index));
+		j_message_set_safety(messages[index], semantics);
+		j_message_append_n(messages[index], namespace, namespace_len);
+	}
+
+	return messages[index];
+}
+
+/**
+ * Sends the messages to their servers in parallel and waits for all of them.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param func       The background function.
+ * \param messages   The messages, one per server, NULL for servers without operations.
+ * \param operations The get operations per server, NULL for other operations.
+ * \param replicas   The read replica per server, NULL to use the servers themselves.
+ * \param length     The number of servers.
+ *
+ * \return TRUE if all requests succeeded, FALSE otherwise.
+ **/
+static
 gboolean
-j_kv_get_exec (JList* operations, JSemantics* semantics)
+j_kv_execute_messages (JBackgroundOperationFunc func, JMessage** messages, JList** operations, gint const* replicas, guint32 length)
+{
+	g_autofree gpointer* background_data = NULL;
+	gboolean ret = TRUE;
+
+	background_data = g_new(gpointer, length);
+
+	for (guint32 i = 0; i < length; i++)
+	{
+		JKVBackgroundData* data = NULL;
+
+		if (messages[i] != NULL)
+		{
+			data = g_slice_new(JKVBackgroundData);
+			data->index = i;
+			data->message = messages[i];
+			data->operations = (operations != NULL) ? operations[i] : NULL;
+			data->replica = (replicas != NULL) ? replicas[i] : -1;
+			data->ret = TRUE;
+		}
+
+		background_data[i] = data;
+	}
+
+	j_helper_execute_parallel(func, background_data, length);
+
+	for (guint32 i = 0; i < length; i++)
+	{
+		JKVBackgroundData* data = background_data[i];
+
+		if (data == NULL)
+		{
+			continue;
+		}
+
+		ret = data->ret && ret;
+
+		j_message_unref(data->message);
+
+		if (data->operations != NULL)
+		{
+			j_list_unref(data->operations);
+		}
+
+		g_slice_free(JKVBackgroundData, data);
+	}
+
+	return ret;
+}
+
+typedef JKV* (*JKVOperationKVFunc) (gpointer);
+
+static
+JKV*
+j_kv_operation_kv (gpointer data)
+{
+	JKVOperation* kop = data;
+
+	/* All operations start with their KV. */
+	return kop->put.kv;
+}
+
+static
+JKV*
+j_kv_delete_kv (gpointer data)
+{
+	return data;
+}
+
+/**
+ * Executes operations in runs of the same namespace.
+ * Put and delete messages (and backend batches) are bound to a single namespace.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param operations The operations.
+ * \param semantics  The semantics.
+ * \param exec_func  The function executing operations of one namespace.
+ * \param kv_func    The function returning an operation's KV.
+ *
+ * \return TRUE if all operations succeeded, FALSE otherwise.
+ **/
+static
+gboolean
+j_kv_exec_by_namespace (JList* operations, JSemantics* semantics, JOperationExecFunc exec_func, JKVOperationKVFunc kv_func)
+{
+	g_autoptr(JListIterator) it = NULL;
+	JList* run = NULL;
+	gchar const* namespace = NULL;
+	gboolean ret = TRUE;
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		gpointer data = j_list_iterator_get(it);
+		JKV* kv = kv_func(data);
+
+		if (run != NULL && g_strcmp0(kv->namespace, namespace) != 0)
+		{
+			ret = exec_func(run, semantics) && ret;
+			j_list_unref(run);
+			run = NULL;
+		}
+
+		if (run == NULL)
+		{
+			run = j_list_new(NULL);
+			namespace = kv->namespace;
+		}
+
+		j_list_append(run, data);
+	}
+
+	if (run != NULL)
+	{
+		ret = exec_func(run, semantics) && ret;
+		j_list_unref(run);
+	}
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_put_exec_namespace (JList* operations, JSemantics* semantics)
 {
 	gboolean ret = TRUE;
 
 	JBackend* kv_backend;
 	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) message = NULL;
-	//JSemanticsSafety safety;
+	g_autofree JMessage** messages = NULL;
+	JSemanticsSafety safety;
 	gchar const* namespace;
+	gpointer kv_batch;
 	gsize namespace_len;
-	guint32 index;
+	guint32 server_count = 0;
 
 	g_return_val_if_fail(operations != NULL, FALSE);
 	g_return_val_if_fail(semantics != NULL, FALSE);
@@ -348,29 +758,29 @@ j_kv_get_exec (JList* operations, JSemantics* semantics)
 		kop = j_list_get_first(operations);
 		g_assert(kop != NULL);
 
-		namespace = kop->get.kv->namespace;
+		namespace = kop->put.kv->namespace;
 		namespace_len = strlen(namespace) + 1;
-		index = kop->get.kv->index;
 	}
 
-	//safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
 	it = j_list_iterator_new(operations);
-	kv_backend = j_kv_backend();
+	kv_backend = j_kv_backend_for_namespace(namespace);
 
-	if (kv_backend == NULL)
+	if (kv_backend != NULL)
+	{
+		ret = j_backend_kv_batch_start(kv_backend, namespace, safety, &kv_batch);
+
+		/* Without strict ordering, the backend is free to execute the batch's operations in any order. */
+		if (ret && kv_backend->kv.batch_set_unordered != NULL && j_semantics_get(semantics, J_SEMANTICS_ORDERING) != J_SEMANTICS_ORDERING_STRICT)
+		{
+			j_backend_kv_batch_set_unordered(kv_backend, kv_batch);
+		}
+	}
+	else
 	{
-		/**
-		 * Force safe semantics to make the server send a reply.
-		 * Otherwise, nasty races can occur when using unsafe semantics:
-		 * - The client creates the item and sends its first write.
-		 * - The client sends another operation using another connection from the pool.
-		 * - The second operation is executed first and fails because the item does not exist.
-		 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
-		 **/
-		message = j_message_new(J_MESSAGE_KV_GET, namespace_len);
-		j_message_set_safety(message, semantics);
-		//j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
-		j_message_append_n(message, namespace, namespace_len);
+		/* The operations can belong to different servers, each one gets its own message. */
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
 	}
 
 	while (j_list_iterator_next(it))
@@ -379,254 +789,1436 @@ j_kv_get_exec (JList* operations, JSemantics* semantics)
 
 		if (kv_backend != NULL)
 		{
-			if (kop->get.func != NULL)
-			{
-				bson_t tmp[1];
+			ret = j_backend_kv_put(kv_backend, kv_batch, kop->put.kv->key, kop->put.value) && ret;
+		}
+		else
+		{
+			JMessage* message;
+			gsize key_len;
 
-				ret = j_backend_kv_get(kv_backend, kop->get.kv->namespace, kop->get.kv->key, tmp) && ret;
+			message = j_kv_get_message(messages, kop->put.kv->index, J_MESSAGE_KV_PUT, namespace, namespace_len, semantics);
+			key_len = strlen(kop->put.kv->key) + 1;
 
-				if (ret)
-				{
-					kop->get.func(tmp, kop->get.data);
-					bson_destroy(tmp);
-				}
-			}
-			else
-			{
-				ret = j_backend_kv_get(kv_backend, kop->get.kv->namespace, kop->get.kv->key, kop->get.value) && ret;
-			}
+			j_message_add_operation(message, key_len + sizeof(guint64) + kop->put.value->len);
+			j_message_append_n(message, kop->put.kv->key, key_len);
+			j_message_append_varint(message, kop->put.value->len);
+			j_message_append_n(message, bson_get_data(kop->put.value), kop->put.value->len);
+		}
+	}
+
+	if (kv_backend != NULL)
+	{
+		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
+	}
+	else
+	{
+		ret = j_kv_execute_messages(j_kv_request_background_operation, messages, NULL, NULL, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_put_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_put_exec_namespace, j_kv_operation_kv);
+}
+
+static
+gboolean
+j_kv_put_raw_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	JSemanticsSafety safety;
+	gchar const* namespace;
+	gpointer kv_batch;
+	gsize namespace_len;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JKVOperation* kop;
+
+		kop = j_list_get_first(operations);
+		g_assert(kop != NULL);
+
+		namespace = kop->put_raw.kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_backend_for_namespace(namespace);
+
+	if (kv_backend != NULL)
+	{
+		ret = j_backend_kv_batch_start(kv_backend, namespace, safety, &kv_batch);
+
+		/* Without strict ordering, the backend is free to execute the batch's operations in any order. */
+		if (ret && kv_backend->kv.batch_set_unordered != NULL && j_semantics_get(semantics, J_SEMANTICS_ORDERING) != J_SEMANTICS_ORDERING_STRICT)
+		{
+			j_backend_kv_batch_set_unordered(kv_backend, kv_batch);
+		}
+	}
+	else
+	{
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+		gconstpointer value_data;
+		gsize len;
+
+		value_data = g_bytes_get_data(kop->put_raw.value, &len);
+
+		if (kv_backend != NULL)
+		{
+			ret = j_backend_kv_put_raw(kv_backend, kv_batch, kop->put_raw.kv->key, value_data, len) && ret;
 		}
 		else
 		{
+			JMessage* message;
 			gsize key_len;
 
-			key_len = strlen(kop->get.kv->key) + 1;
+			message = j_kv_get_message(messages, kop->put_raw.kv->index, J_MESSAGE_KV_PUT_RAW, namespace, namespace_len, semantics);
+			key_len = strlen(kop->put_raw.kv->key) + 1;
 
-			j_message_add_operation(message, key_len);
-			j_message_append_n(message, kop->get.kv->key, key_len);
+			j_message_add_operation(message, key_len + sizeof(guint64) + len);
+			j_message_append_n(message, kop->put_raw.kv->key, key_len);
+			j_message_append_varint(message, len);
+			j_message_append_n(message, value_data, len);
 		}
 	}
 
-	if (kv_backend == NULL)
+	if (kv_backend != NULL)
 	{
-		g_autoptr(JListIterator) iter = NULL;
-		g_autoptr(JMessage) reply = NULL;
-		GSocketConnection* kv_connection;
+		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
+	}
+	else
+	{
+		ret = j_kv_execute_messages(j_kv_request_background_operation, messages, NULL, NULL, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_put_raw_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_put_raw_exec_namespace, j_kv_operation_kv);
+}
+
+static
+gboolean
+j_kv_delete_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	JSemanticsSafety safety;
+	gchar const* namespace;
+	gpointer kv_batch;
+	gsize namespace_len;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JKV* object;
+
+		object = j_list_get_first(operations);
+		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	safety = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_backend_for_namespace(namespace);
+
+	if (kv_backend != NULL)
+	{
+		ret = j_backend_kv_batch_start(kv_backend, namespace, safety, &kv_batch);
+
+		/* Without strict ordering, the backend is free to execute the batch's operations in any order. */
+		if (ret && kv_backend->kv.batch_set_unordered != NULL && j_semantics_get(semantics, J_SEMANTICS_ORDERING) != J_SEMANTICS_ORDERING_STRICT)
+		{
+			j_backend_kv_batch_set_unordered(kv_backend, kv_batch);
+		}
+	}
+	else
+	{
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JKV* kv = j_list_iterator_get(it);
+
+		if (kv_backend != NULL)
+		{
+			ret = j_backend_kv_delete(kv_backend, kv_batch, kv->key) && ret;
+		}
+		else
+		{
+			JMessage* message;
+			gsize key_len;
+
+			message = j_kv_get_message(messages, kv->index, J_MESSAGE_KV_DELETE, namespace, namespace_len, semantics);
+			key_len = strlen(kv->key) + 1;
+
+			j_message_add_operation(message, key_len);
+			j_message_append_n(message, kv->key, key_len);
+		}
+	}
+
+	if (kv_backend != NULL)
+	{
+		ret = j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
+	}
+	else
+	{
+		ret = j_kv_execute_messages(j_kv_request_background_operation, messages, NULL, NULL, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_delete_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_delete_exec_namespace, j_kv_delete_kv);
+}
+
+/**
+ * Executes gets, which are either all raw or not.
+ *
+ * \private
+ **/
+static
+gboolean
+j_kv_get_exec_internal (JList* operations, JSemantics* semantics, gboolean raw)
+{
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	g_autofree JList** server_operations = NULL;
+	g_autofree gint* replicas = NULL;
+	gboolean eventual;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_backend();
+	eventual = (j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) != J_SEMANTICS_CONSISTENCY_IMMEDIATE);
+
+	if (kv_backend == NULL)
+	{
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+		server_operations = g_new0(JList*, server_count);
+		replicas = g_new(gint, server_count);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+		JBackend* kop_backend;
+
+		/* Gets are combined over all namespaces, which might be routed differently. */
+		kop_backend = j_kv_backend_for_namespace(kop->get.kv->namespace);
+
+		if (kop_backend != NULL)
+		{
+			if (raw)
+			{
+				ret = j_backend_kv_get_raw(kop_backend, kop->get.kv->namespace, kop->get.kv->key, kop->get.bytes) && ret;
+			}
+			else if (kop->get.func != NULL)
+			{
+				bson_t tmp[1];
+				gboolean found;
+
+				found = j_backend_kv_get(kop_backend, kop->get.kv->namespace, kop->get.kv->key, tmp);
+				ret = found && ret;
+
+				if (found)
+				{
+					kop->get.func(tmp, kop->get.data);
+					bson_destroy(tmp);
+				}
+			}
+			else if (kop->get.bytes != NULL)
+			{
+				bson_t tmp[1];
+				gboolean found;
+
+				found = j_backend_kv_get(kop_backend, kop->get.kv->namespace, kop->get.kv->key, tmp);
+				ret = found && ret;
+
+				if (found)
+				{
+					guint8* buf;
+					guint32 len;
+
+					/* Take over the backend's buffer instead of copying it. */
+					buf = bson_destroy_with_steal(tmp, TRUE, &len);
+					*(kop->get.bytes) = g_bytes_new_with_free_func(buf, len, bson_free, buf);
+				}
+			}
+			else
+			{
+				ret = j_backend_kv_get(kop_backend, kop->get.kv->namespace, kop->get.kv->key, kop->get.value) && ret;
+			}
+		}
+		else
+		{
+			JMessage* message;
+			guint32 index = kop->get.kv->index;
+			gsize key_len;
+			gsize namespace_len;
+
+			/* Gets carry their namespace, so one message per server answers all of them. */
+			if (messages[index] == NULL)
+			{
+				/* Reads that do not have to see the latest writes are spread over the server's read replicas. */
+				replicas[index] = (eventual) ? j_connection_pool_pick_kv_replica(index) : -1;
+
+				messages[index] = j_message_new((raw) ? J_MESSAGE_KV_GET_RAW : J_MESSAGE_KV_GET, 0);
+				j_message_set_compact(messages[index], (replicas[index] >= 0) ? j_connection_pool_get_compact_kv_replica(index, replicas[index]) : j_connection_pool_get_compact_kv(index));
+				j_message_set_safety(messages[index], semantics);
+			}
+
+			message = messages[index];
+			namespace_len = strlen(kop->get.kv->namespace) + 1;
+			key_len = strlen(kop->get.kv->key) + 1;
+
+			j_message_add_operation(message, namespace_len + key_len);
+			j_message_append_n(message, kop->get.kv->namespace, namespace_len);
+			j_message_append_n(message, kop->get.kv->key, key_len);
+
+			/* The operations are owned by the batch. */
+			if (server_operations[index] == NULL)
+			{
+				server_operations[index] = j_list_new(NULL);
+			}
+
+			j_list_append(server_operations[index], kop);
+		}
+	}
+
+	if (kv_backend == NULL)
+	{
+		ret = j_kv_execute_messages(j_kv_get_background_operation, messages, server_operations, replicas, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_get_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_get_exec_internal(operations, semantics, FALSE);
+}
+
+static
+gboolean
+j_kv_get_raw_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_get_exec_internal(operations, semantics, TRUE);
+}
+
+static
+gboolean
+j_kv_update_exec (JList* operations, JSemantics* semantics, JMessageType type)
+{
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	g_autofree JList** server_operations = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JKVOperation* kop;
+
+		kop = j_list_get_first(operations);
+		g_assert(kop != NULL);
+
+		/* Both operation types start with the KV. */
+		namespace = kop->compare_and_swap.kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_backend_for_namespace(namespace);
+
+	if (kv_backend == NULL)
+	{
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+		server_operations = g_new0(JList*, server_count);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+		JKV* kv = kop->compare_and_swap.kv;
+
+		if (kv_backend != NULL)
+		{
+			if (type == J_MESSAGE_KV_COMPARE_AND_SWAP)
+			{
+				guint64 version = 0;
+
+				ret = j_backend_kv_compare_and_swap(kv_backend, namespace, kv->key, kop->compare_and_swap.expected, kop->compare_and_swap.value, &version) && ret;
+
+				if (kop->compare_and_swap.version != NULL)
+				{
+					*(kop->compare_and_swap.version) = version;
+				}
+			}
+			else
+			{
+				gint64 result = 0;
+				gboolean success;
+
+				success = j_backend_kv_increment(kv_backend, namespace, kv->key, kop->increment.field, kop->increment.delta, &result);
+				ret = success && ret;
+
+				if (success && kop->increment.result != NULL)
+				{
+					*(kop->increment.result) = result;
+				}
+			}
+		}
+		else
+		{
+			JMessage* message;
+			gsize key_len;
+
+			message = j_kv_get_message(messages, kv->index, type, namespace, namespace_len, semantics);
+			key_len = strlen(kv->key) + 1;
+
+			if (type == J_MESSAGE_KV_COMPARE_AND_SWAP)
+			{
+				bson_t* value = kop->compare_and_swap.value;
+
+				j_message_add_operation(message, key_len + sizeof(guint64) + sizeof(guint64) + value->len);
+				j_message_append_n(message, kv->key, key_len);
+				j_message_append_8(message, &(kop->compare_and_swap.expected));
+				j_message_append_varint(message, value->len);
+				j_message_append_n(message, bson_get_data(value), value->len);
+			}
+			else
+			{
+				gsize field_len;
+
+				field_len = strlen(kop->increment.field) + 1;
+
+				j_message_add_operation(message, key_len + field_len + sizeof(gint64));
+				j_message_append_n(message, kv->key, key_len);
+				j_message_append_n(message, kop->increment.field, field_len);
+				j_message_append_8(message, &(kop->increment.delta));
+			}
+
+			/* The operations are owned by the batch. */
+			if (server_operations[kv->index] == NULL)
+			{
+				server_operations[kv->index] = j_list_new(NULL);
+			}
+
+			j_list_append(server_operations[kv->index], kop);
+		}
+	}
+
+	if (kv_backend == NULL)
+	{
+		ret = j_kv_execute_messages(j_kv_update_background_operation, messages, server_operations, NULL, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_compare_and_swap_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	return j_kv_update_exec(operations, semantics, J_MESSAGE_KV_COMPARE_AND_SWAP);
+}
+
+static
+gboolean
+j_kv_compare_and_swap_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_compare_and_swap_exec_namespace, j_kv_operation_kv);
+}
+
+static
+gboolean
+j_kv_increment_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	return j_kv_update_exec(operations, semantics, J_MESSAGE_KV_INCREMENT);
+}
+
+static
+gboolean
+j_kv_increment_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_increment_exec_namespace, j_kv_operation_kv);
+}
+
+/**
+ * Hands the values fetched by j_kv_get_many_callback() to the callbacks.
+ * It runs after the gets because it uses the same key, which keeps operations in order.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param operations The operations.
+ * \param semantics  The batch's semantics.
+ *
+ * \return TRUE.
+ **/
+static
+gboolean
+j_kv_get_many_exec (JList* operations, JSemantics* semantics)
+{
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+
+		kop->get_many.func(kop->get_many.values, kop->get_many.count, kop->get_many.data);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return TRUE;
+}
+
+/**
+ * Combines the max-merges of a namespace, so that every value is only updated once per batch.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param operations The operations of one namespace.
+ * \param semantics  The batch's semantics.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_kv_max_merge_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(GHashTable) maxima = NULL;
+	g_autoptr(GPtrArray) kvs = NULL;
+	g_autofree JMessage** messages = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JKVOperation* kop;
+
+		kop = j_list_get_first(operations);
+		g_assert(kop != NULL);
+
+		namespace = kop->max_merge.kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	/* The keys belong to the KVs, which are kept alive by the operations. */
+	maxima = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)bson_destroy);
+	kvs = g_ptr_array_new();
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JKVOperation* kop = j_list_iterator_get(it);
+		JKV* kv = kop->max_merge.kv;
+		bson_t* current;
+
+		if ((current = g_hash_table_lookup(maxima, kv->key)) == NULL)
+		{
+			g_hash_table_insert(maxima, kv->key, bson_copy(kop->max_merge.value));
+			g_ptr_array_add(kvs, kv);
+		}
+		else
+		{
+			bson_t merged[1];
+
+			j_helper_bson_merge_max(current, kop->max_merge.value, merged);
+			g_hash_table_insert(maxima, kv->key, bson_copy(merged));
+			bson_destroy(merged);
+		}
+	}
+
+	kv_backend = j_kv_backend_for_namespace(namespace);
+
+	if (kv_backend == NULL)
+	{
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+	}
+
+	for (guint i = 0; i < kvs->len; i++)
+	{
+		JKV* kv = g_ptr_array_index(kvs, i);
+		bson_t const* value;
+
+		value = g_hash_table_lookup(maxima, kv->key);
+
+		if (kv_backend != NULL)
+		{
+			ret = j_backend_kv_max_merge(kv_backend, namespace, kv->key, value) && ret;
+		}
+		else
+		{
+			JMessage* message;
+			gsize key_len;
+
+			message = j_kv_get_message(messages, kv->index, J_MESSAGE_KV_MAX_MERGE, namespace, namespace_len, semantics);
+			key_len = strlen(kv->key) + 1;
+
+			j_message_add_operation(message, key_len + sizeof(guint64) + value->len);
+			j_message_append_n(message, kv->key, key_len);
+			j_message_append_varint(message, value->len);
+			j_message_append_n(message, bson_get_data(value), value->len);
+		}
+	}
+
+	if (kv_backend == NULL)
+	{
+		ret = j_kv_execute_messages(j_kv_request_background_operation, messages, NULL, NULL, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_max_merge_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_max_merge_exec_namespace, j_kv_operation_kv);
+}
+
+static
+gboolean
+j_kv_create_index_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 server_count;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	{
+		JKV* kv;
+
+		kv = j_list_get_first(operations);
+		g_assert(kv != NULL);
+
+		namespace = kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	/* Without servers, nothing has to be maintained and index scans filter all values. */
+	if (j_kv_backend_for_namespace(namespace) != NULL)
+	{
+		return TRUE;
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+	server_count = j_configuration_get_kv_server_count(j_configuration());
+	messages = g_new0(JMessage*, server_count);
+
+	while (j_list_iterator_next(it))
+	{
+		JKV* kv = j_list_iterator_get(it);
+		gsize field_len;
+
+		field_len = strlen(kv->key) + 1;
+
+		/* Every server indexes its own values. */
+		for (guint32 i = 0; i < server_count; i++)
+		{
+			JMessage* message;
+
+			message = j_kv_get_message(messages, i, J_MESSAGE_KV_CREATE_INDEX, namespace, namespace_len, semantics);
+
+			j_message_add_operation(message, field_len);
+			j_message_append_n(message, kv->key, field_len);
+		}
+	}
+
+	ret = j_kv_execute_messages(j_kv_create_index_background_operation, messages, NULL, NULL, server_count);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_create_index_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_create_index_exec_namespace, j_kv_delete_kv);
+}
+
+/**
+ * Deletes the values of a namespace whose keys start with a prefix from the local backend.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param kv_backend A backend.
+ * \param namespace  A namespace.
+ * \param prefix     A prefix.
+ * \param safety     The safety semantics.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_kv_delete_by_prefix_local (JBackend* kv_backend, gchar const* namespace, gchar const* prefix, JSemanticsSafety safety)
+{
+	g_autoptr(GPtrArray) keys = NULL;
+	gpointer iterator;
+	gpointer kv_batch;
+	gboolean ret = TRUE;
+
+	keys = g_ptr_array_new_with_free_func(g_free);
+
+	/* The keys are collected first, so that the iterator does not observe its own deletions. */
+	if (j_backend_kv_get_by_prefix(kv_backend, namespace, prefix, &iterator))
+	{
+		bson_t value[1];
+		gchar const* key;
+
+		while (j_backend_kv_iterate(kv_backend, iterator, &key, value))
+		{
+			g_ptr_array_add(keys, g_strdup(key));
+			bson_destroy(value);
+		}
+	}
+
+	if (keys->len == 0)
+	{
+		return TRUE;
+	}
+
+	if (!j_backend_kv_batch_start(kv_backend, namespace, safety, &kv_batch))
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; i < keys->len; i++)
+	{
+		ret = j_backend_kv_delete(kv_backend, kv_batch, g_ptr_array_index(keys, i)) && ret;
+	}
+
+	return j_backend_kv_batch_execute(kv_backend, kv_batch) && ret;
+}
+
+static
+gboolean
+j_kv_delete_by_prefix_exec_namespace (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* kv_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JKV* kv;
+
+		kv = j_list_get_first(operations);
+		g_assert(kv != NULL);
+
+		namespace = kv->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	it = j_list_iterator_new(operations);
+	kv_backend = j_kv_backend_for_namespace(namespace);
+
+	if (kv_backend == NULL)
+	{
+		server_count = j_configuration_get_kv_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JKV* kv = j_list_iterator_get(it);
+
+		if (kv_backend != NULL)
+		{
+			ret = j_kv_delete_by_prefix_local(kv_backend, namespace, kv->key, j_semantics_get(semantics, J_SEMANTICS_SAFETY)) && ret;
+		}
+		else
+		{
+			gsize prefix_len;
+
+			prefix_len = strlen(kv->key) + 1;
+
+			/* The keys are hashed to servers, so every server can hold some of them. */
+			for (guint32 i = 0; i < server_count; i++)
+			{
+				JMessage* message;
+
+				message = j_kv_get_message(messages, i, J_MESSAGE_KV_DELETE_BY_PREFIX, namespace, namespace_len, semantics);
+
+				j_message_add_operation(message, prefix_len);
+				j_message_append_n(message, kv->key, prefix_len);
+			}
+		}
+	}
+
+	if (kv_backend == NULL)
+	{
+		ret = j_kv_execute_messages(j_kv_create_index_background_operation, messages, NULL, NULL, server_count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_kv_delete_by_prefix_exec (JList* operations, JSemantics* semantics)
+{
+	return j_kv_exec_by_namespace(operations, semantics, j_kv_delete_by_prefix_exec_namespace, j_kv_delete_kv);
+}
+
+/**
+ * Creates a new item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JKV* i;
+ *
+ * i = j_kv_new("JULEA");
+ * \endcode
+ *
+ * \param key         An item key.
+ * \param distribution A distribution.
+ *
+ * \return A new item. Should be freed with j_kv_unref().
+ **/
+JKV*
+j_kv_new (gchar const* namespace, gchar const* key)
+{
+	JConfiguration* configuration = j_configuration();
+	JKV* kv;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(key != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	kv = g_slice_new(JKV);
+	kv->index = j_helper_hash(key) % j_configuration_get_kv_server_count(configuration);
+	kv->namespace = g_strdup(namespace);
+	kv->key = g_strdup(key);
+	kv->ref_count = 1;
+
+	kv->batch_key = g_quark_from_static_string("kv");
+
+	j_trace_leave(G_STRFUNC);
+
+	return kv;
+}
+
+/**
+ * Creates a new item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JKV* i;
+ *
+ * i = j_kv_new("JULEA");
+ * \endcode
+ *
+ * \param key         An item key.
+ * \param distribution A distribution.
+ *
+ * \return A new item. Should be freed with j_kv_unref().
+ **/
+JKV*
+j_kv_new_for_index (guint32 index, gchar const* namespace, gchar const* key)
+{
+	JConfiguration* configuration = j_configuration();
+	JKV* kv;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(key != NULL, NULL);
+	g_return_val_if_fail(index < j_configuration_get_kv_server_count(configuration), NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	kv = g_slice_new(JKV);
+	kv->index = index;
+	kv->namespace = g_strdup(namespace);
+	kv->key = g_strdup(key);
+	kv->ref_count = 1;
+
+	kv->batch_key = g_quark_from_static_string("kv");
+
+	j_trace_leave(G_STRFUNC);
+
+	return kv;
+}
+
+/**
+ * Increases an item's reference count.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JKV* i;
+ *
+ * j_kv_ref(i);
+ * \endcode
+ *
+ * \param item An item.
+ *
+ * \return #item.
+ **/
+JKV*
+j_kv_ref (JKV* kv)
+{
+	g_return_val_if_fail(kv != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_atomic_int_inc(&(kv->ref_count));
+
+	j_trace_leave(G_STRFUNC);
+
+	return kv;
+}
+
+/**
+ * Decreases an item's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item An item.
+ **/
+void
+j_kv_unref (JKV* kv)
+{
+	g_return_if_fail(kv != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (g_atomic_int_dec_and_test(&(kv->ref_count)))
+	{
+		g_free(kv->key);
+		g_free(kv->namespace);
+
+		g_slice_free(JKV, kv);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Creates an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param key         A key.
+ * \param distribution A distribution.
+ * \param batch        A batch.
+ *
+ * \return A new item. Should be freed with j_kv_unref().
+ **/
+void
+j_kv_put (JKV* kv, bson_t* value, JBatch* batch)
+{
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(kv != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->put.kv = j_kv_ref(kv);
+	kop->put.value = value;
+
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_put_exec;
+	operation->free_func = j_kv_put_free;
+	operation->cache_size_func = j_kv_put_cache_size;
+	operation->cache_func = j_kv_put_cache;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Puts a value that is stored as opaque bytes instead of a BSON document.
+ * This avoids encoding and decoding BSON for values that are blobs anyway, for example, serialized data of other libraries.
+ * Raw values can only be read using j_kv_get_raw().
+ * They should be kept in namespaces of their own, because indexes, filters, compare-and-swap, increments and merges require BSON documents.
+ * The backend has to support raw values, which the MongoDB and null backends do not.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(GBytes) value = NULL;
+ *
+ * value = g_bytes_new(data, len);
+ * j_kv_put_raw(kv, value, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param kv    A KV.
+ * \param value The value, which is referenced until the batch has been executed.
+ * \param batch A batch.
+ **/
+void
+j_kv_put_raw (JKV* kv, GBytes* value, JBatch* batch)
+{
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(kv != NULL);
+	g_return_if_fail(value != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->put_raw.kv = j_kv_ref(kv);
+	kop->put_raw.value = g_bytes_ref(value);
+
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_put_raw_exec;
+	operation->free_func = j_kv_put_raw_free;
+	operation->cache_size_func = j_kv_put_raw_cache_size;
+	operation->cache_func = j_kv_put_raw_cache;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deletes an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item       An item.
+ * \param batch      A batch.
+ **/
+void
+j_kv_delete (JKV* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
 
-		kv_connection = j_connection_pool_pop_kv(index);
-		j_message_send(message, kv_connection);
+	j_trace_enter(G_STRFUNC, NULL);
 
-		reply = j_message_new_reply(message);
-		j_message_receive(reply, kv_connection);
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(object->batch_key);
+	operation->data = j_kv_ref(object);
+	operation->exec_func = j_kv_delete_exec;
+	operation->free_func = j_kv_delete_free;
+	operation->cache_func = j_kv_delete_cache;
 
-		iter = j_list_iterator_new(operations);
+	j_batch_add(batch, operation);
 
-		while (j_list_iterator_next(iter))
-		{
-			JKVOperation* kop = j_list_iterator_get(iter);
-			guint32 len;
+	j_trace_leave(G_STRFUNC);
+}
 
-			len = j_message_get_4(reply);
-			ret = (len > 0) && ret;
+/**
+ * Get the status of an item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item      An item.
+ * \param batch     A batch.
+ **/
+void
+j_kv_get (JKV* kv, bson_t* value, JBatch* batch)
+{
+	JKVOperation* kop;
+	JOperation* operation;
 
-			if (len > 0)
-			{
-				bson_t tmp[1];
-				gconstpointer data;
+	g_return_if_fail(kv != NULL);
 
-				data = j_message_get_n(reply, len);
+	j_trace_enter(G_STRFUNC, NULL);
 
-				// FIXME check whether copies can be avoided
-				bson_init_static(tmp, data, len);
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->get.kv = j_kv_ref(kv);
+	kop->get.value = value;
+	kop->get.bytes = NULL;
+	kop->get.func = NULL;
+	kop->get.data = NULL;
+	kop->get.raw = FALSE;
 
-				if (kop->get.func != NULL)
-				{
-					kop->get.func(tmp, kop->get.data);
-				}
-				else
-				{
-					bson_copy_to(tmp, kop->get.value);
-				}
-			}
-		}
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_get_exec;
+	operation->free_func = j_kv_get_free;
 
-		j_connection_pool_push_kv(index, kv_connection);
-	}
+	j_batch_add(batch, operation);
 
 	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 /**
- * Creates a new item.
+ * Gets a value without copying it.
+ * The returned bytes reference the server's reply, which stays allocated until they are freed.
  *
  * \author Michael Kuhn
  *
  * \code
- * JKV* i;
+ * g_autoptr(GBytes) bytes = NULL;
+ * bson_t value[1];
+ * gconstpointer data;
+ * gsize len;
  *
- * i = j_kv_new("JULEA");
- * \endcode
+ * j_kv_get_bytes(kv, &bytes, batch);
+ * j_batch_execute(batch);
  *
- * \param key         An item key.
- * \param distribution A distribution.
+ * data = g_bytes_get_data(bytes, &len);
+ * bson_init_static(value, data, len);
+ * \endcode
  *
- * \return A new item. Should be freed with j_kv_unref().
+ * \param kv    A KV.
+ * \param bytes Returns the value, which should be freed with g_bytes_unref().
+ * \param batch A batch.
  **/
-JKV*
-j_kv_new (gchar const* namespace, gchar const* key)
+void
+j_kv_get_bytes (JKV* kv, GBytes** bytes, JBatch* batch)
 {
-	JConfiguration* configuration = j_configuration();
-	JKV* kv;
+	JKVOperation* kop;
+	JOperation* operation;
 
-	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(key != NULL, NULL);
+	g_return_if_fail(kv != NULL);
+	g_return_if_fail(bytes != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	kv = g_slice_new(JKV);
-	kv->index = j_helper_hash(key) % j_configuration_get_kv_server_count(configuration);
-	kv->namespace = g_strdup(namespace);
-	kv->key = g_strdup(key);
-	kv->ref_count = 1;
+	*bytes = NULL;
 
-	j_trace_leave(G_STRFUNC);
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->get.kv = j_kv_ref(kv);
+	kop->get.value = NULL;
+	kop->get.bytes = bytes;
+	kop->get.func = NULL;
+	kop->get.data = NULL;
+	kop->get.raw = FALSE;
 
-	return kv;
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_get_exec;
+	operation->free_func = j_kv_get_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Creates a new item.
+ * Gets a value that has been put using j_kv_put_raw().
+ * Like for j_kv_get_bytes(), the returned bytes reference the server's reply instead of being copied.
  *
  * \author Michael Kuhn
  *
  * \code
- * JKV* i;
+ * g_autoptr(GBytes) value = NULL;
  *
- * i = j_kv_new("JULEA");
- * \endcode
+ * j_kv_get_raw(kv, &value, batch);
  *
- * \param key         An item key.
- * \param distribution A distribution.
+ * if (j_batch_execute(batch))
+ * {
+ *   data = g_bytes_get_data(value, &len);
+ * }
+ * \endcode
  *
- * \return A new item. Should be freed with j_kv_unref().
+ * \param kv    A KV.
+ * \param value Returns the value, NULL if it does not exist. Should be freed with g_bytes_unref().
+ * \param batch A batch.
  **/
-JKV*
-j_kv_new_for_index (guint32 index, gchar const* namespace, gchar const* key)
+void
+j_kv_get_raw (JKV* kv, GBytes** value, JBatch* batch)
 {
-	JConfiguration* configuration = j_configuration();
-	JKV* kv;
+	JKVOperation* kop;
+	JOperation* operation;
 
-	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(key != NULL, NULL);
-	g_return_val_if_fail(index < j_configuration_get_kv_server_count(configuration), NULL);
+	g_return_if_fail(kv != NULL);
+	g_return_if_fail(value != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	kv = g_slice_new(JKV);
-	kv->index = index;
-	kv->namespace = g_strdup(namespace);
-	kv->key = g_strdup(key);
-	kv->ref_count = 1;
+	*value = NULL;
 
-	j_trace_leave(G_STRFUNC);
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->get.kv = j_kv_ref(kv);
+	kop->get.value = NULL;
+	kop->get.bytes = value;
+	kop->get.func = NULL;
+	kop->get.data = NULL;
+	kop->get.raw = TRUE;
 
-	return kv;
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_get_raw_exec;
+	operation->free_func = j_kv_get_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Increases an item's reference count.
+ * Get the status of an item.
+ * The value passed to the callback points into the server's reply and is only valid during the callback.
  *
  * \author Michael Kuhn
  *
  * \code
- * JKV* i;
- *
- * j_kv_ref(i);
  * \endcode
  *
- * \param item An item.
- *
- * \return #item.
+ * \param item      An item.
+ * \param batch     A batch.
  **/
-JKV*
-j_kv_ref (JKV* kv)
+void
+j_kv_get_callback (JKV* kv, JKVGetFunc func, gpointer data, JBatch* batch)
 {
-	g_return_val_if_fail(kv != NULL, NULL);
+	JKVOperation* kop;
+	JOperation* operation;
+
+	g_return_if_fail(kv != NULL);
+	g_return_if_fail(func != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	g_atomic_int_inc(&(kv->ref_count));
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->get.kv = j_kv_ref(kv);
+	kop->get.value = NULL;
+	kop->get.bytes = NULL;
+	kop->get.func = func;
+	kop->get.data = data;
+	kop->get.raw = FALSE;
 
-	j_trace_leave(G_STRFUNC);
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_get_exec;
+	operation->free_func = j_kv_get_free;
 
-	return kv;
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Decreases an item's reference count.
- * When the reference count reaches zero, frees the memory allocated for the item.
+ * Stores a value if the stored value's version matches.
+ * The comparison and the update are performed atomically by the server.
+ * The version is kept in the value's _version field and incremented on every successful swap.
+ * Values stored with j_kv_put() have version 1.
+ * If the swap fails, executing the batch returns FALSE.
  *
  * \author Michael Kuhn
  *
  * \code
+ * guint64 version;
+ *
+ * // Put if absent
+ * j_kv_compare_and_swap(kv, 0, value, &version, batch);
  * \endcode
  *
- * \param item An item.
+ * \param kv       A KV.
+ * \param expected The expected version, 0 if the key must not exist.
+ * \param value    The new value, which is copied.
+ * \param version  Returns the current version, can be NULL.
+ * \param batch    A batch.
  **/
 void
-j_kv_unref (JKV* kv)
+j_kv_compare_and_swap (JKV* kv, guint64 expected, bson_t const* value, guint64* version, JBatch* batch)
 {
+	JKVOperation* kop;
+	JOperation* operation;
+
 	g_return_if_fail(kv != NULL);
+	g_return_if_fail(value != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (g_atomic_int_dec_and_test(&(kv->ref_count)))
-	{
-		g_free(kv->key);
-		g_free(kv->namespace);
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->compare_and_swap.kv = j_kv_ref(kv);
+	kop->compare_and_swap.expected = expected;
+	kop->compare_and_swap.value = bson_copy(value);
+	kop->compare_and_swap.version = version;
 
-		g_slice_free(JKV, kv);
-	}
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_compare_and_swap_exec;
+	operation->free_func = j_kv_compare_and_swap_free;
+
+	j_batch_add(batch, operation);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Creates an object.
+ * Atomically adds to an integer field of a value.
+ * Missing values and fields are treated as 0.
  *
  * \author Michael Kuhn
  *
  * \code
- * \endcode
+ * gint64 count;
  *
- * \param key         A key.
- * \param distribution A distribution.
- * \param batch        A batch.
+ * j_kv_increment(kv, "count", 1, &count, batch);
+ * \endcode
  *
- * \return A new item. Should be freed with j_kv_unref().
+ * \param kv     A KV.
+ * \param field  A top-level field.
+ * \param delta  The value to add.
+ * \param result Returns the field's new value, can be NULL.
+ * \param batch  A batch.
  **/
 void
-j_kv_put (JKV* kv, bson_t* value, JBatch* batch)
+j_kv_increment (JKV* kv, gchar const* field, gint64 delta, gint64* result, JBatch* batch)
 {
 	JKVOperation* kop;
 	JOperation* operation;
 
 	g_return_if_fail(kv != NULL);
+	g_return_if_fail(field != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	kop = g_slice_new(JKVOperation);
-	kop->put.kv = j_kv_ref(kv);
-	kop->put.value = value;
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->increment.kv = j_kv_ref(kv);
+	kop->increment.field = g_strdup(field);
+	kop->increment.delta = delta;
+	kop->increment.result = result;
 
 	operation = j_operation_new();
-	// FIXME key = index + namespace
-	operation->key = kv;
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
 	operation->data = kop;
-	operation->exec_func = j_kv_put_exec;
-	operation->free_func = j_kv_put_free;
+	operation->exec_func = j_kv_increment_exec;
+	operation->free_func = j_kv_increment_free;
 
 	j_batch_add(batch, operation);
 
@@ -634,30 +2226,51 @@ j_kv_put (JKV* kv, bson_t* value, JBatch* batch)
 }
 
 /**
- * Deletes an object.
+ * Gets multiple values and hands them to a callback at once.
+ * The gets are combined with all other gets of the batch, so one message is sent per server.
+ * The callback is called after all values have been received; missing values are NULL.
+ * The values are only valid during the callback.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param item       An item.
- * \param batch      A batch.
+ * \param kvs   An array of KVs.
+ * \param count The number of KVs.
+ * \param func  A callback.
+ * \param data  User data passed to the callback.
+ * \param batch A batch.
  **/
 void
-j_kv_delete (JKV* object, JBatch* batch)
+j_kv_get_many_callback (JKV** kvs, guint32 count, JKVGetManyFunc func, gpointer data, JBatch* batch)
 {
+	JKVOperation* kop;
 	JOperation* operation;
 
-	g_return_if_fail(object != NULL);
+	g_return_if_fail(kvs != NULL);
+	g_return_if_fail(count > 0);
+	g_return_if_fail(func != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->get_many.kv = j_kv_ref(kvs[0]);
+	kop->get_many.values = g_new0(GBytes*, count);
+	kop->get_many.count = count;
+	kop->get_many.func = func;
+	kop->get_many.data = data;
+
+	for (guint32 i = 0; i < count; i++)
+	{
+		j_kv_get_bytes(kvs[i], &(kop->get_many.values[i]), batch);
+	}
+
 	operation = j_operation_new();
-	operation->key = object;
-	operation->data = j_kv_ref(object);
-	operation->exec_func = j_kv_delete_exec;
-	operation->free_func = j_kv_delete_free;
+	operation->key = GUINT_TO_POINTER(kvs[0]->batch_key);
+	operation->data = kop;
+	operation->exec_func = j_kv_get_many_exec;
+	operation->free_func = j_kv_get_many_free;
 
 	j_batch_add(batch, operation);
 
@@ -665,37 +2278,41 @@ j_kv_delete (JKV* object, JBatch* batch)
 }
 
 /**
- * Get the status of an item.
+ * Merges maxima into a value.
+ * Numeric fields are set to the maximum of their current and new values, subdocuments are merged recursively and other fields are replaced.
+ * Missing values are created.
+ * Max-merges of the same KV within a batch are combined, so the value is only updated once.
  *
  * \author Michael Kuhn
  *
  * \code
+ * j_kv_max_merge(kv, maxima, batch);
  * \endcode
  *
- * \param item      An item.
- * \param batch     A batch.
+ * \param kv     A KV.
+ * \param maxima A document of maxima.
+ * \param batch  A batch.
  **/
 void
-j_kv_get (JKV* kv, bson_t* value, JBatch* batch)
+j_kv_max_merge (JKV* kv, bson_t const* maxima, JBatch* batch)
 {
 	JKVOperation* kop;
 	JOperation* operation;
 
 	g_return_if_fail(kv != NULL);
+	g_return_if_fail(maxima != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	kop = g_slice_new(JKVOperation);
-	kop->get.kv = j_kv_ref(kv);
-	kop->get.value = value;
-	kop->get.func = NULL;
-	kop->get.data = NULL;
+	kop = j_batch_alloc(batch, sizeof(JKVOperation));
+	kop->max_merge.kv = j_kv_ref(kv);
+	kop->max_merge.value = bson_copy(maxima);
 
 	operation = j_operation_new();
-	operation->key = kv;
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
 	operation->data = kop;
-	operation->exec_func = j_kv_get_exec;
-	operation->free_func = j_kv_get_free;
+	operation->exec_func = j_kv_max_merge_exec;
+	operation->free_func = j_kv_max_merge_free;
 
 	j_batch_add(batch, operation);
 
@@ -703,38 +2320,79 @@ j_kv_get (JKV* kv, bson_t* value, JBatch* batch)
 }
 
 /**
- * Get the status of an item.
+ * Creates a secondary index on a field of a namespace's values.
+ * Servers update the index together with the values and add existing values when it is created.
+ * Creating an existing index has no effect.
+ * The index is used by j_kv_iterator_new_index().
  *
  * \author Michael Kuhn
  *
  * \code
+ * j_kv_create_index("items", "status.size", batch);
  * \endcode
  *
- * \param item      An item.
+ * \param namespace A namespace.
+ * \param field     A field, which can be a dotted path.
  * \param batch     A batch.
  **/
 void
-j_kv_get_callback (JKV* kv, JKVGetFunc func, gpointer data, JBatch* batch)
+j_kv_create_index (gchar const* namespace, gchar const* field, JBatch* batch)
 {
-	JKVOperation* kop;
+	JKV* kv;
 	JOperation* operation;
 
-	g_return_if_fail(kv != NULL);
-	g_return_if_fail(func != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(field != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	kop = g_slice_new(JKVOperation);
-	kop->get.kv = j_kv_ref(kv);
-	kop->get.value = NULL;
-	kop->get.func = func;
-	kop->get.data = data;
+	/* The KV's key holds the field. */
+	kv = j_kv_new(namespace, field);
 
 	operation = j_operation_new();
-	operation->key = kv;
-	operation->data = kop;
-	operation->exec_func = j_kv_get_exec;
-	operation->free_func = j_kv_get_free;
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kv;
+	operation->exec_func = j_kv_create_index_exec;
+	operation->free_func = j_kv_delete_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deletes all values of a namespace whose keys start with a prefix.
+ * Every server deletes its values in one backend batch.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_kv_delete_by_prefix("items", "scratch/", batch);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param prefix    A prefix.
+ * \param batch     A batch.
+ **/
+void
+j_kv_delete_by_prefix (gchar const* namespace, gchar const* prefix, JBatch* batch)
+{
+	JKV* kv;
+	JOperation* operation;
+
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(prefix != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* The KV's key holds the prefix. */
+	kv = j_kv_new(namespace, prefix);
+
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(kv->batch_key);
+	operation->data = kv;
+	operation->exec_func = j_kv_delete_by_prefix_exec;
+	operation->free_func = j_kv_delete_free;
 
 	j_batch_add(batch, operation);
 
@@ -0,0 +1,560 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <mpi.h>
+
+#include <mpi/jmpi-aggregator.h>
+
+#include <julea.h>
+#include <julea-object.h>
+
+/**
+ * \defgroup JMPIAggregator MPI Aggregator
+ *
+ * Collective write aggregation for objects written by many MPI ranks.
+ *
+ * Every server is owned by one aggregator rank.
+ * When flushing, all ranks send the parts of their writes to the owners of the servers storing them.
+ * The aggregators merge the parts they receive and write them, so each server only receives few large writes from few clients.
+ *
+ * @{
+ **/
+
+/**
+ * A write that has not been flushed yet.
+ **/
+struct JMPIAggregatorPiece
+{
+	gconstpointer data;
+	guint64 length;
+	guint64 offset;
+};
+
+typedef struct JMPIAggregatorPiece JMPIAggregatorPiece;
+
+/**
+ * The header of a part sent to an aggregator.
+ **/
+struct JMPIAggregatorHeader
+{
+	guint64 offset;
+	guint64 length;
+};
+
+typedef struct JMPIAggregatorHeader JMPIAggregatorHeader;
+
+/**
+ * A part received by an aggregator.
+ **/
+struct JMPIAggregatorPart
+{
+	guint64 offset;
+	guint64 length;
+	gchar const* data;
+
+	/**
+	 * The order the part has been received in, later parts overwrite earlier ones.
+	 **/
+	guint64 sequence;
+};
+
+typedef struct JMPIAggregatorPart JMPIAggregatorPart;
+
+struct JMPIAggregator
+{
+	MPI_Comm comm;
+	gint rank;
+	gint size;
+
+	JDistributedObject* object;
+
+	/**
+	 * A private copy of the object's distribution, which is used to determine which servers store the writes.
+	 **/
+	JDistribution* distribution;
+
+	guint server_count;
+
+	/**
+	 * The rank of the aggregator owning each server.
+	 **/
+	gint* owners;
+
+	/**
+	 * Whether this rank is an aggregator.
+	 **/
+	gboolean aggregator;
+
+	/**
+	 * The writes that have not been flushed yet.
+	 **/
+	GArray* pieces;
+};
+
+static
+gint
+j_mpi_aggregator_part_compare (gconstpointer a, gconstpointer b)
+{
+	JMPIAggregatorPart const* part_a = a;
+	JMPIAggregatorPart const* part_b = b;
+
+	if (part_a->offset != part_b->offset)
+	{
+		return (part_a->offset < part_b->offset) ? -1 : 1;
+	}
+
+	if (part_a->sequence != part_b->sequence)
+	{
+		return (part_a->sequence < part_b->sequence) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Creates a new aggregator.
+ * This is a collective operation, all ranks of the communicator have to call it with the same arguments.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param comm             A communicator.
+ * \param object           A distributed object.
+ * \param distribution     The object's distribution.
+ * \param aggregator_count The number of aggregators, 0 to use one per server.
+ *
+ * \return A new aggregator. Should be freed with j_mpi_aggregator_free().
+ **/
+JMPIAggregator*
+j_mpi_aggregator_new (MPI_Comm comm, JDistributedObject* object, JDistribution* distribution, guint aggregator_count)
+{
+	JMPIAggregator* aggregator;
+
+	g_return_val_if_fail(object != NULL, NULL);
+	g_return_val_if_fail(distribution != NULL, NULL);
+
+	aggregator = g_slice_new(JMPIAggregator);
+
+	MPI_Comm_dup(comm, &(aggregator->comm));
+	MPI_Comm_rank(aggregator->comm, &(aggregator->rank));
+	MPI_Comm_size(aggregator->comm, &(aggregator->size));
+
+	aggregator->object = j_distributed_object_ref(object);
+	aggregator->distribution = j_distribution_new_from_bson(j_distribution_serialize_cached(distribution));
+	aggregator->server_count = j_configuration_get_object_server_count(j_configuration());
+	aggregator->owners = g_new(gint, aggregator->server_count);
+	aggregator->aggregator = FALSE;
+	aggregator->pieces = g_array_new(FALSE, FALSE, sizeof(JMPIAggregatorPiece));
+
+	/* More aggregators than servers would not reduce the number of writes any further. */
+	if (aggregator_count == 0 || aggregator_count > aggregator->server_count)
+	{
+		aggregator_count = aggregator->server_count;
+	}
+
+	aggregator_count = MIN(aggregator_count, (guint)aggregator->size);
+
+	for (guint i = 0; i < aggregator->server_count; i++)
+	{
+		/* Spread the aggregators across the communicator, consecutive ranks are usually located on the same node. */
+		aggregator->owners[i] = ((guint64)(i % aggregator_count) * aggregator->size) / aggregator_count;
+
+		if (aggregator->owners[i] == aggregator->rank)
+		{
+			aggregator->aggregator = TRUE;
+		}
+	}
+
+	return aggregator;
+}
+
+/**
+ * Frees the memory allocated by the aggregator.
+ * This is a collective operation.
+ * Writes that have not been flushed are discarded.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param aggregator An aggregator.
+ **/
+void
+j_mpi_aggregator_free (JMPIAggregator* aggregator)
+{
+	g_return_if_fail(aggregator != NULL);
+
+	g_array_unref(aggregator->pieces);
+	g_free(aggregator->owners);
+	j_distribution_unref(aggregator->distribution);
+	j_distributed_object_unref(aggregator->object);
+
+	MPI_Comm_free(&(aggregator->comm));
+
+	g_slice_free(JMPIAggregator, aggregator);
+}
+
+/**
+ * Returns whether this rank writes to the servers.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param aggregator An aggregator.
+ *
+ * \return TRUE if this rank is an aggregator, FALSE otherwise.
+ **/
+gboolean
+j_mpi_aggregator_is_aggregator (JMPIAggregator* aggregator)
+{
+	g_return_val_if_fail(aggregator != NULL, FALSE);
+
+	return aggregator->aggregator;
+}
+
+/**
+ * Adds a write to the aggregator.
+ * The data is only written by j_mpi_aggregator_flush() and has to stay valid until then.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param aggregator An aggregator.
+ * \param data       A buffer holding the data to write.
+ * \param length     Number of bytes to write.
+ * \param offset     An offset within the object.
+ **/
+void
+j_mpi_aggregator_write (JMPIAggregator* aggregator, gconstpointer data, guint64 length, guint64 offset)
+{
+	JMPIAggregatorPiece piece;
+
+	g_return_if_fail(aggregator != NULL);
+	g_return_if_fail(data != NULL);
+
+	if (length == 0)
+	{
+		return;
+	}
+
+	piece.data = data;
+	piece.length = length;
+	piece.offset = offset;
+
+	g_array_append_val(aggregator->pieces, piece);
+}
+
+/**
+ * Writes the parts an aggregator has received.
+ * Adjacent parts are merged, overlapping parts are written in the order they have been received.
+ **/
+static
+gboolean
+j_mpi_aggregator_write_parts (JMPIAggregator* aggregator, GArray* parts, guint64* bytes_written)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(GPtrArray) buffers = NULL;
+	guint i = 0;
+
+	if (parts->len == 0)
+	{
+		return TRUE;
+	}
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	buffers = g_ptr_array_new_with_free_func(g_free);
+
+	g_array_sort(parts, j_mpi_aggregator_part_compare);
+
+	while (i < parts->len)
+	{
+		JMPIAggregatorPart const* first = &g_array_index(parts, JMPIAggregatorPart, i);
+		gchar* buffer;
+		guint64 length = first->length;
+		guint64 position = 0;
+		guint j;
+
+		for (j = i + 1; j < parts->len; j++)
+		{
+			JMPIAggregatorPart const* part = &g_array_index(parts, JMPIAggregatorPart, j);
+
+			if (part->offset != first->offset + length)
+			{
+				break;
+			}
+
+			length += part->length;
+		}
+
+		buffer = g_malloc(length);
+		g_ptr_array_add(buffers, buffer);
+
+		for (guint k = i; k < j; k++)
+		{
+			JMPIAggregatorPart const* part = &g_array_index(parts, JMPIAggregatorPart, k);
+
+			memcpy(buffer + position, part->data, part->length);
+			position += part->length;
+		}
+
+		j_distributed_object_write(aggregator->object, buffer, length, first->offset, bytes_written, batch);
+
+		i = j;
+	}
+
+	return j_batch_execute(batch);
+}
+
+/**
+ * Writes all pending writes of all ranks.
+ * This is a collective operation, only aggregators communicate with the servers.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param aggregator    An aggregator.
+ * \param bytes_written Returns the number of bytes written by all ranks, might be NULL.
+ *
+ * \return TRUE on all ranks if all writes succeeded, FALSE otherwise.
+ **/
+gboolean
+j_mpi_aggregator_flush (JMPIAggregator* aggregator, guint64* bytes_written)
+{
+	g_autofree GArray** headers = NULL;
+	g_autofree GArray** data = NULL;
+	g_autofree gint* send_header_counts = NULL;
+	g_autofree gint* send_header_displacements = NULL;
+	g_autofree gint* send_data_counts = NULL;
+	g_autofree gint* send_data_displacements = NULL;
+	g_autofree gint* recv_header_counts = NULL;
+	g_autofree gint* recv_header_displacements = NULL;
+	g_autofree gint* recv_data_counts = NULL;
+	g_autofree gint* recv_data_displacements = NULL;
+	g_autofree gchar* send_headers = NULL;
+	g_autofree gchar* send_data = NULL;
+	g_autofree gchar* recv_headers = NULL;
+	g_autofree gchar* recv_data = NULL;
+	g_autoptr(GArray) parts = NULL;
+	guint64 send_header_size = 0;
+	guint64 send_data_size = 0;
+	guint64 recv_header_size = 0;
+	guint64 recv_data_size = 0;
+	guint64 local_bytes = 0;
+	guint64 total_bytes = 0;
+	gint local_ok = 1;
+	gint ok;
+	gint size;
+
+	g_return_val_if_fail(aggregator != NULL, FALSE);
+
+	size = aggregator->size;
+
+	headers = g_new(GArray*, size);
+	data = g_new(GArray*, size);
+
+	for (gint i = 0; i < size; i++)
+	{
+		headers[i] = g_array_new(FALSE, FALSE, sizeof(JMPIAggregatorHeader));
+		data[i] = g_array_new(FALSE, FALSE, sizeof(JMPIAggregatorPiece));
+	}
+
+	/* Split the writes into the parts stored on each server and assign them to the servers' owners. */
+	for (guint i = 0; i < aggregator->pieces->len; i++)
+	{
+		JMPIAggregatorPiece const* piece = &g_array_index(aggregator->pieces, JMPIAggregatorPiece, i);
+		JDistributionExtent extents[64];
+		guint64 position = 0;
+		guint count;
+
+		j_distribution_reset(aggregator->distribution, piece->length, piece->offset);
+
+		while ((count = j_distribution_distribute_extents(aggregator->distribution, extents, G_N_ELEMENTS(extents))) > 0)
+		{
+			for (guint j = 0; j < count; j++)
+			{
+				gint owner = aggregator->owners[extents[j].index];
+				JMPIAggregatorHeader header;
+				JMPIAggregatorPiece part;
+
+				header.offset = piece->offset + position;
+				header.length = extents[j].length;
+
+				part.data = (gchar const*)piece->data + position;
+				part.length = extents[j].length;
+				part.offset = header.offset;
+
+				g_array_append_val(headers[owner], header);
+				g_array_append_val(data[owner], part);
+
+				position += extents[j].length;
+			}
+		}
+	}
+
+	send_header_counts = g_new(gint, size);
+	send_header_displacements = g_new(gint, size);
+	send_data_counts = g_new(gint, size);
+	send_data_displacements = g_new(gint, size);
+	recv_header_counts = g_new(gint, size);
+	recv_header_displacements = g_new(gint, size);
+	recv_data_counts = g_new(gint, size);
+	recv_data_displacements = g_new(gint, size);
+
+	for (gint i = 0; i < size; i++)
+	{
+		guint64 data_size = 0;
+
+		for (guint j = 0; j < data[i]->len; j++)
+		{
+			data_size += g_array_index(data[i], JMPIAggregatorPiece, j).length;
+		}
+
+		/* MPI counts and displacements are limited to G_MAXINT. */
+		if (send_header_size + headers[i]->len * sizeof(JMPIAggregatorHeader) > G_MAXINT || send_data_size + data_size > G_MAXINT)
+		{
+			local_ok = 0;
+		}
+
+		send_header_counts[i] = headers[i]->len * sizeof(JMPIAggregatorHeader);
+		send_header_displacements[i] = send_header_size;
+		send_data_counts[i] = data_size;
+		send_data_displacements[i] = send_data_size;
+
+		send_header_size += headers[i]->len * sizeof(JMPIAggregatorHeader);
+		send_data_size += data_size;
+	}
+
+	MPI_Alltoall(send_header_counts, 1, MPI_INT, recv_header_counts, 1, MPI_INT, aggregator->comm);
+	MPI_Alltoall(send_data_counts, 1, MPI_INT, recv_data_counts, 1, MPI_INT, aggregator->comm);
+
+	for (gint i = 0; i < size; i++)
+	{
+		if (recv_header_size + recv_header_counts[i] > G_MAXINT || recv_data_size + recv_data_counts[i] > G_MAXINT)
+		{
+			local_ok = 0;
+		}
+
+		recv_header_displacements[i] = recv_header_size;
+		recv_data_displacements[i] = recv_data_size;
+
+		recv_header_size += recv_header_counts[i];
+		recv_data_size += recv_data_counts[i];
+	}
+
+	MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, aggregator->comm);
+
+	if (!ok)
+	{
+		g_warning("Too much data to aggregate, flush more often.");
+		goto end;
+	}
+
+	send_headers = g_malloc(MAX(send_header_size, 1));
+	send_data = g_malloc(MAX(send_data_size, 1));
+	recv_headers = g_malloc(MAX(recv_header_size, 1));
+	recv_data = g_malloc(MAX(recv_data_size, 1));
+
+	for (gint i = 0; i < size; i++)
+	{
+		guint64 position = send_data_displacements[i];
+
+		if (headers[i]->len > 0)
+		{
+			memcpy(send_headers + send_header_displacements[i], headers[i]->data, send_header_counts[i]);
+		}
+
+		for (guint j = 0; j < data[i]->len; j++)
+		{
+			JMPIAggregatorPiece const* part = &g_array_index(data[i], JMPIAggregatorPiece, j);
+
+			memcpy(send_data + position, part->data, part->length);
+			position += part->length;
+		}
+	}
+
+	MPI_Alltoallv(send_headers, send_header_counts, send_header_displacements, MPI_BYTE, recv_headers, recv_header_counts, recv_header_displacements, MPI_BYTE, aggregator->comm);
+	MPI_Alltoallv(send_data, send_data_counts, send_data_displacements, MPI_BYTE, recv_data, recv_data_counts, recv_data_displacements, MPI_BYTE, aggregator->comm);
+
+	parts = g_array_new(FALSE, FALSE, sizeof(JMPIAggregatorPart));
+
+	/* Headers and data are received in rank order, so the sequence reflects the order of the writes. */
+	for (gint i = 0; i < size; i++)
+	{
+		JMPIAggregatorHeader const* rank_headers = (JMPIAggregatorHeader const*)(gpointer)(recv_headers + recv_header_displacements[i]);
+		guint count = recv_header_counts[i] / sizeof(JMPIAggregatorHeader);
+		guint64 position = recv_data_displacements[i];
+
+		for (guint j = 0; j < count; j++)
+		{
+			JMPIAggregatorPart part;
+
+			part.offset = rank_headers[j].offset;
+			part.length = rank_headers[j].length;
+			part.data = recv_data + position;
+			part.sequence = parts->len;
+
+			g_array_append_val(parts, part);
+
+			position += part.length;
+		}
+	}
+
+	local_ok = j_mpi_aggregator_write_parts(aggregator, parts, &local_bytes) ? 1 : 0;
+
+	MPI_Allreduce(&local_ok, &ok, 1, MPI_INT, MPI_MIN, aggregator->comm);
+	MPI_Allreduce(&local_bytes, &total_bytes, 1, MPI_UINT64_T, MPI_SUM, aggregator->comm);
+
+end:
+	for (gint i = 0; i < size; i++)
+	{
+		g_array_unref(headers[i]);
+		g_array_unref(data[i]);
+	}
+
+	g_array_set_size(aggregator->pieces, 0);
+
+	if (bytes_written != NULL)
+	{
+		*bytes_written = total_bytes;
+	}
+
+	return (ok != 0);
+}
+
+/**
+ * @}
+ **/
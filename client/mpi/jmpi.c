@@ -0,0 +1,102 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <mpi.h>
+
+#include <mpi/jmpi.h>
+
+#include <julea.h>
+
+/**
+ * \defgroup JMPI MPI
+ *
+ * @{
+ **/
+
+/**
+ * Initializes JULEA for all ranks of a communicator.
+ * This is a collective operation that replaces j_init().
+ * Only the first rank reads the configuration file and broadcasts it to the others, so large jobs do not overload the file system storing it.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * MPI_Init(&argc, &argv);
+ * j_mpi_init(MPI_COMM_WORLD);
+ * \endcode
+ *
+ * \param comm A communicator.
+ **/
+void
+j_mpi_init (MPI_Comm comm)
+{
+	g_autoptr(GKeyFile) key_file = NULL;
+	g_autoptr(JConfiguration) configuration = NULL;
+	g_autofree gchar* data = NULL;
+	guint64 length = 0;
+	gint rank;
+
+	MPI_Comm_rank(comm, &rank);
+
+	if (rank == 0 && (key_file = j_configuration_load_key_file()) != NULL)
+	{
+		gsize data_length;
+
+		data = g_key_file_to_data(key_file, &data_length, NULL);
+		length = data_length;
+
+		g_clear_pointer(&key_file, g_key_file_free);
+	}
+
+	/* A length of 0 tells the other ranks that no configuration has been found. */
+	MPI_Bcast(&length, 1, MPI_UINT64_T, 0, comm);
+
+	if (length == 0 || length > G_MAXINT)
+	{
+		g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+	}
+
+	if (rank != 0)
+	{
+		data = g_malloc(length);
+	}
+
+	MPI_Bcast(data, length, MPI_CHAR, 0, comm);
+
+	key_file = g_key_file_new();
+
+	if (!g_key_file_load_from_data(key_file, data, length, G_KEY_FILE_NONE, NULL)
+	    || (configuration = j_configuration_new_for_data(key_file)) == NULL)
+	{
+		g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+	}
+
+	j_init_for_configuration(configuration);
+}
+
+/**
+ * @}
+ **/
@@ -23,6 +23,7 @@
 #include <julea-config.h>
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include <string.h>
 
@@ -40,6 +41,33 @@
  * @{
  **/
 
+/**
+ * The number of extents to request from the distribution at once.
+ */
+#define J_DISTRIBUTED_OBJECT_EXTENTS 64
+
+/**
+ * How long a status is cached for batches with eventual consistency.
+ */
+#define J_DISTRIBUTED_OBJECT_STATUS_LEASE G_TIME_SPAN_SECOND
+
+/**
+ * The namespace of the objects that track where appends to distributed objects are placed.
+ * Each distributed object has one such object on a single server, its size is the end of the appended data.
+ */
+#define J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE "julea-append"
+
+/**
+ * The number of buckets of the read latency histogram.
+ * Bucket i counts latencies of less than 2^i microseconds that did not fit into the previous buckets.
+ */
+#define J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS 32
+
+/**
+ * The number of reads that have to be recorded before reads are hedged.
+ */
+#define J_DISTRIBUTED_OBJECT_HEDGE_SAMPLES 100
+
 /**
  * Data for background operations.
  */
@@ -49,6 +77,17 @@ struct JDistributedObjectBackgroundData
 	JMessage* message;
 	JList* operations;
 
+	/**
+	 * The number of bytes read or written by the message, used to split large shares of a server.
+	 */
+	guint64 size;
+
+	/**
+	 * The regions of the operations' payloads, NULL if the payloads are transferred over the connection.
+	 * Only used by read and write parts.
+	 */
+	GPtrArray* regions;
+
 	/**
 	 * The union for read and write parts.
 	 */
@@ -73,21 +112,123 @@ struct JDistributedObjectBackgroundData
 		struct
 		{
 			JList* bytes_written;
+
+			/**
+			 * The data to write.
+			 * Contains #JDistributedObjectPayload elements.
+			 */
+			GArray* payloads;
 		}
 		write;
+
+		/**
+		 * The status part.
+		 */
+		struct
+		{
+			/**
+			 * The server's results, one per operation.
+			 */
+			gint64* modification_times;
+			guint64* sizes;
+
+			gboolean success;
+		}
+		status;
+
+		/**
+		 * The purge part.
+		 */
+		struct
+		{
+			gboolean success;
+		}
+		purge;
+
+		/**
+		 * The snapshot part.
+		 */
+		struct
+		{
+			/**
+			 * Whether the server has copied its part, one per operation.
+			 */
+			gboolean* copied;
+
+			gboolean success;
+		}
+		snapshot;
+
+		/**
+		 * The reduce part.
+		 */
+		struct
+		{
+			/**
+			 * The server's partial results, NULL if the server failed.
+			 */
+			JMessage* reply;
+		}
+		reduce;
+
+		/**
+		 * The part of truncates, preallocations, punched holes and prefetches.
+		 */
+		struct
+		{
+			gboolean success;
+		}
+		extent;
 	};
 };
 
 typedef struct JDistributedObjectBackgroundData JDistributedObjectBackgroundData;
 
+/**
+ * A purge of all objects below a directory of a namespace.
+ */
+struct JDistributedObjectPurge
+{
+	gchar* namespace;
+	gchar* directory;
+};
+
+typedef struct JDistributedObjectPurge JDistributedObjectPurge;
+
+/**
+ * A snapshot of an object.
+ */
+struct JDistributedObjectSnapshot
+{
+	JDistributedObject* object;
+	JDistributedObject* snapshot;
+};
+
+typedef struct JDistributedObjectSnapshot JDistributedObjectSnapshot;
+
 struct JDistributedObjectReadBuffer
 {
 	gchar* data;
 	guint64* bytes_read;
+
+	/**
+	 * The object's part the buffer is filled from.
+	 * Used to reconstruct the data if its server fails.
+	 */
+	guint64 offset;
+	guint64 length;
 };
 
 typedef struct JDistributedObjectReadBuffer JDistributedObjectReadBuffer;
 
+struct JDistributedObjectPayload
+{
+	gconstpointer data;
+	guint64 length;
+};
+
+typedef struct JDistributedObjectPayload JDistributedObjectPayload;
+
 struct JDistributedObjectOperation
 {
 	union
@@ -119,11 +260,66 @@ struct JDistributedObjectOperation
 			guint64* bytes_written;
 		}
 		write;
+
+		struct
+		{
+			JDistributedObject* object;
+			gconstpointer data;
+			guint64 length;
+			guint64* offset;
+		}
+		append;
+
+		struct
+		{
+			JDistributedObject* object;
+			JReduce* reduce;
+			guint64 length;
+			guint64 offset;
+		}
+		reduce;
+
+		struct
+		{
+			JDistributedObject* object;
+			guint64 length;
+			guint64 offset;
+		}
+		extent;
 	};
+
+	/**
+	 * The segments of a vectored read or write, NULL otherwise.
+	 * Each segment is a read or write of its own and shares the parent's bytes_read or bytes_written.
+	 */
+	struct JDistributedObjectOperation* segments;
+	guint segment_count;
+
+	/**
+	 * The write's bytes_written once it has been cached, the caller's counter is updated immediately.
+	 */
+	guint64 cached_bytes_written;
+
+	/**
+	 * The buffer from j_buffer_alloc() holding a write's data, which is referenced instead of copied when caching the write.
+	 */
+	gpointer buffer;
 };
 
 typedef struct JDistributedObjectOperation JDistributedObjectOperation;
 
+/**
+ * A segment of a vectored read or write, used to sort the segments by offset.
+ */
+struct JDistributedObjectSegment
+{
+	guint64 offset;
+	guint64 length;
+	guint index;
+};
+
+typedef struct JDistributedObjectSegment JDistributedObjectSegment;
+
 /**
  * A JDistributedObject.
  **/
@@ -141,6 +337,26 @@ struct JDistributedObject
 
 	JDistribution* distribution;
 
+	/**
+	 * The readahead, NULL if disabled.
+	 **/
+	JReadahead* readahead;
+
+	/**
+	 * The key used for combining status operations.
+	 * It identifies the namespace, because all operations of a message have to share it.
+	 **/
+	GQuark batch_key;
+
+	/**
+	 * The cached status and when it was retrieved, 0 if nothing is cached.
+	 **/
+	gint64 status_time;
+	gint64 status_modification_time;
+	guint64 status_size;
+
+	GMutex mutex;
+
 	/**
 	 * The reference count.
 	 **/
@@ -165,6 +381,18 @@ j_distributed_object_delete_free (gpointer data)
 	j_distributed_object_unref(object);
 }
 
+static
+void
+j_distributed_object_snapshot_free (gpointer data)
+{
+	JDistributedObjectSnapshot* snapshot = data;
+
+	j_distributed_object_unref(snapshot->object);
+	j_distributed_object_unref(snapshot->snapshot);
+
+	g_slice_free(JDistributedObjectSnapshot, snapshot);
+}
+
 static
 void
 j_distributed_object_status_free (gpointer data)
@@ -184,104 +412,112 @@ j_distributed_object_read_free (gpointer data)
 
 	j_distributed_object_unref(operation->read.object);
 
+	g_free(operation->segments);
 	g_slice_free(JDistributedObjectOperation, operation);
 }
 
 static
 void
-j_distributed_object_write_free (gpointer data)
+j_distributed_object_append_free (gpointer data)
 {
 	JDistributedObjectOperation* operation = data;
 
-	j_distributed_object_unref(operation->write.object);
+	j_distributed_object_unref(operation->append.object);
 
 	g_slice_free(JDistributedObjectOperation, operation);
 }
 
-/**
- * Executes create operations in a background operation.
- *
- * \private
- *
- * \author Michael Kuhn
- *
- * \param data Background data.
- *
- * \return #data.
- **/
 static
-gpointer
-j_distributed_object_create_background_operation (gpointer data)
+void
+j_distributed_object_reduce_free (gpointer data)
 {
-	JDistributedObjectBackgroundData* background_data = data;
+	JDistributedObjectOperation* operation = data;
 
-	GSocketConnection* object_connection;
+	j_distributed_object_unref(operation->reduce.object);
 
-	object_connection = j_connection_pool_pop_object(background_data->index);
+	g_slice_free(JDistributedObjectOperation, operation);
+}
 
-	j_message_send(background_data->message, object_connection);
+static
+void
+j_distributed_object_extent_free (gpointer data)
+{
+	JDistributedObjectOperation* operation = data;
 
-	if (j_message_get_flags(background_data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-	{
-		g_autoptr(JMessage) reply = NULL;
+	j_distributed_object_unref(operation->extent.object);
 
-		reply = j_message_new_reply(background_data->message);
-		j_message_receive(reply, object_connection);
+	g_slice_free(JDistributedObjectOperation, operation);
+}
 
-		/* FIXME do something with reply */
-	}
+static
+void
+j_distributed_object_write_free (gpointer data)
+{
+	JDistributedObjectOperation* operation = data;
 
-	j_message_unref(background_data->message);
-	j_connection_pool_push_object(background_data->index, object_connection);
+	if (operation->buffer != NULL)
+	{
+		j_buffer_unref(operation->buffer);
+	}
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+	j_distributed_object_unref(operation->write.object);
 
-	return NULL;
+	g_free(operation->segments);
+	g_slice_free(JDistributedObjectOperation, operation);
 }
 
 /**
- * Executes create operations in a background operation.
+ * Creates do not reference the caller's memory, so there is nothing to copy.
  *
  * \private
- *
- * \author Michael Kuhn
- *
- * \param data Background data.
- *
- * \return #data.
  **/
 static
-gpointer
-j_distributed_object_delete_background_operation (gpointer data)
+void
+j_distributed_object_create_cache (gpointer data, gpointer buffer)
 {
-	JDistributedObjectBackgroundData* background_data = data;
-
-	GSocketConnection* object_connection;
-
-	object_connection = j_connection_pool_pop_object(background_data->index);
+	(void)data;
+	(void)buffer;
+}
 
-	j_message_send(background_data->message, object_connection);
+static
+guint64
+j_distributed_object_write_cache_size (gpointer data)
+{
+	JDistributedObjectOperation* operation = data;
 
-	if (j_message_get_flags(background_data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+	/* Data in a pooled buffer does not have to be copied. */
+	if (operation->buffer == NULL)
 	{
-		g_autoptr(JMessage) reply = NULL;
-
-		reply = j_message_new_reply(background_data->message);
-		j_message_receive(reply, object_connection);
-
-		/* FIXME do something with reply */
+		operation->buffer = j_buffer_ref(operation->write.data, operation->write.length);
 	}
 
-	j_message_unref(background_data->message);
-	j_connection_pool_push_object(background_data->index, object_connection);
+	return (operation->buffer != NULL) ? 0 : operation->write.length;
+}
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+/**
+ * Copies a write's data into the operation cache and reports it as written.
+ *
+ * \private
+ **/
+static
+void
+j_distributed_object_write_cache (gpointer data, gpointer buffer)
+{
+	JDistributedObjectOperation* operation = data;
 
-	return NULL;
+	if (operation->buffer == NULL)
+	{
+		memcpy(buffer, operation->write.data, operation->write.length);
+		operation->write.data = buffer;
+	}
+
+	j_helper_atomic_add(operation->write.bytes_written, operation->write.length);
+	operation->cached_bytes_written = 0;
+	operation->write.bytes_written = &(operation->cached_bytes_written);
 }
 
 /**
- * Executes write operations in a background operation.
+ * Executes create operations in a background operation.
  *
  * \private
  *
@@ -293,914 +529,5139 @@ j_distributed_object_delete_background_operation (gpointer data)
  **/
 static
 gpointer
-j_distributed_object_read_background_operation (gpointer data)
+j_distributed_object_delete_background_operation (gpointer data)
 {
 	JDistributedObjectBackgroundData* background_data = data;
 
-	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) reply = NULL;
-	GSocketConnection* object_connection;
-	guint32 operations_done;
-	guint32 operation_count;
 
-	object_connection = j_connection_pool_pop_object(background_data->index);
-	j_message_send(background_data->message, object_connection);
+	reply = j_connection_pool_request_object(background_data->index, background_data->message, (j_message_get_flags(background_data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0);
 
-	reply = j_message_new_reply(background_data->message);
+	/* FIXME do something with reply */
 
-	operations_done = 0;
-	operation_count = j_message_get_count(background_data->message);
+	j_message_unref(background_data->message);
+
+	g_slice_free(JDistributedObjectBackgroundData, background_data);
 
-	it = j_list_iterator_new(background_data->read.buffers);
+	return NULL;
+}
+
+/**
+ * What is needed to hedge the reads of an object.
+ */
+struct JDistributedObjectHedging
+{
+	JDistributedObject* object;
+	JSemantics* semantics;
 
 	/**
-	 * This extra loop is necessary because the server might send multiple
-	 * replies per message. The same reply object can be used to receive
-	 * multiple times.
+	 * How long to wait for a reply before hedging in microseconds, -1 to only record the latencies.
 	 */
-	while (operations_done < operation_count)
-	{
-		guint32 reply_operation_count;
-
-		j_message_receive(reply, object_connection);
+	gint64 delay;
+};
 
-		reply_operation_count = j_message_get_count(reply);
+typedef struct JDistributedObjectHedging JDistributedObjectHedging;
 
-		for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
-		{
-			JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
-			gchar* read_data = buffer->data;
-			guint64* bytes_read = buffer->bytes_read;
+struct JDistributedObjectHedge;
 
-			guint64 nbytes;
+typedef struct JDistributedObjectHedge JDistributedObjectHedge;
 
-			nbytes = j_message_get_8(reply);
-			j_helper_atomic_add(bytes_read, nbytes);
+/**
+ * The state of a read or write exchanged with one server.
+ */
+struct JDistributedObjectExchange
+{
+	/**
+	 * The message and the operations' results.
+	 */
+	JDistributedObjectBackgroundData* data;
 
-			if (nbytes > 0)
-			{
-				GInputStream* input;
+	/**
+	 * The connection to the server.
+	 */
+	GSocketConnection* connection;
 
-				input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
-				g_input_stream_read_all(input, read_data, nbytes, NULL, NULL, NULL);
-			}
+	/**
+	 * The reply, NULL if no reply is expected.
+	 */
+	JMessage* reply;
 
-			g_slice_free(JDistributedObjectReadBuffer, buffer);
-		}
+	/**
+	 * Iterates over the buffers of a read.
+	 */
+	JListIterator* iterator;
 
-		operations_done += reply_operation_count;
-	}
+	/**
+	 * The buffer whose data is currently being received.
+	 */
+	JDistributedObjectReadBuffer* buffer;
 
-	j_message_unref(background_data->message);
+	/**
+	 * The number of bytes being received into #buffer.
+	 */
+	guint64 nbytes;
 
-	j_connection_pool_push_object(background_data->index, object_connection);
+	/**
+	 * Collects the buffers of a read that could not be filled, NULL to free them.
+	 */
+	JList* failed;
 
-	j_list_unref(background_data->read.buffers);
+	/**
+	 * Whether this is a read.
+	 */
+	gboolean read;
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
-
-	return NULL;
-}
-
-/**
- * Executes write operations in a background operation.
- *
- * \private
- *
- * \author Michael Kuhn
- *
- * \param data Background data.
- *
- * \return #data.
- **/
-static
-gpointer
-j_distributed_object_write_background_operation (gpointer data)
-{
-	JDistributedObjectBackgroundData* background_data = data;
-
-	GSocketConnection* object_connection;
-
-	object_connection = j_connection_pool_pop_object(background_data->index);
-	j_message_send(background_data->message, object_connection);
+	/**
+	 * The number of operations whose replies have been processed.
+	 */
+	guint32 operations_done;
 
-	if (j_message_get_flags(background_data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-	{
-		g_autoptr(JListIterator) it = NULL;
-		g_autoptr(JMessage) reply = NULL;
-		guint64 nbytes;
+	/**
+	 * The number of operations not yet processed in the current reply.
+	 */
+	guint32 reply_remaining;
 
-		reply = j_message_new_reply(background_data->message);
-		j_message_receive(reply, object_connection);
+	/**
+	 * The server's parts that wait for a connection, they are exchanged over this one when it is done.
+	 */
+	GQueue* waiting;
 
-		it = j_list_iterator_new(background_data->write.bytes_written);
+	/**
+	 * The number of unfinished exchanges.
+	 */
+	guint* pending;
 
-		while (j_list_iterator_next(it))
-		{
-			guint64* bytes_written = j_list_iterator_get(it);
+	/**
+	 * The parameters for hedging the read, NULL if it should not be hedged.
+	 */
+	JDistributedObjectHedging const* hedging;
 
-			nbytes = j_message_get_8(reply);
-			j_helper_atomic_add(bytes_written, nbytes);
-		}
-	}
+	/**
+	 * The hedge the exchange belongs to, NULL if there is none.
+	 */
+	JDistributedObjectHedge* hedge;
 
-	j_message_unref(background_data->message);
+	/**
+	 * When the message has been sent.
+	 */
+	gint64 start;
+};
 
-	j_connection_pool_push_object(background_data->index, object_connection);
+typedef struct JDistributedObjectExchange JDistributedObjectExchange;
 
-	j_list_unref(background_data->write.bytes_written);
+/**
+ * A read that is also sent to the servers holding other copies of its data if its server does not answer in time.
+ */
+struct JDistributedObjectHedge
+{
+	JDistributedObjectHedging const* hedging;
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+	/**
+	 * The original exchange, NULL once it is done.
+	 */
+	JDistributedObjectExchange* primary;
 
-	return NULL;
-}
+	/**
+	 * The original exchange's server.
+	 */
+	guint32 index;
 
-/**
- * Executes status operations in a background operation.
- *
- * \private
- *
- * \author Michael Kuhn
- *
- * \param data Background data.
- *
- * \return #data.
- **/
-static
-gpointer
-j_distributed_object_status_background_operation (gpointer data)
-{
-	JDistributedObjectBackgroundData* background_data = data;
+	/**
+	 * The exchanges with the other copies that are not done yet.
+	 */
+	GPtrArray* secondaries;
 
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) reply = NULL;
-	GSocketConnection* object_connection;
+	/**
+	 * Copies of the original buffers, because the originals are freed once they have been filled.
+	 */
+	JDistributedObjectReadBuffer* targets;
+	guint targets_len;
 
-	object_connection = j_connection_pool_pop_object(background_data->index);
-	j_message_send(background_data->message, object_connection);
+	/**
+	 * The data received from the other copies, one region per target.
+	 */
+	gchar* data;
+	guint64* nbytes;
 
-	reply = j_message_new_reply(background_data->message);
-	j_message_receive(reply, object_connection);
+	/**
+	 * Fires after the hedging delay, NULL once it has fired or has been removed.
+	 */
+	GSource* timer;
 
-	it = j_list_iterator_new(background_data->operations);
+	/**
+	 * The number of targets that the original exchange has filled.
+	 */
+	guint32 primary_filled;
 
-	while (j_list_iterator_next(it))
-	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		gint64* modification_time = operation->status.modification_time;
-		guint64* size = operation->status.size;
-		gint64 modification_time_;
-		guint64 size_;
+	gboolean primary_ok;
+	gboolean secondary_ok;
 
-		modification_time_ = j_message_get_8(reply);
-		size_ = j_message_get_8(reply);
+	/**
+	 * Whether the read has been sent to the other copies.
+	 */
+	gboolean hedged;
 
-		// FIXME
-		*modification_time = modification_time_;
-		j_helper_atomic_add(size, size_);
-	}
+	guint* pending;
+};
 
-	j_message_unref(background_data->message);
+/**
+ * The latencies of hedgeable reads, shared by all objects.
+ */
+static gsize j_distributed_object_read_latencies[J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS];
 
-	j_connection_pool_push_object(background_data->index, object_connection);
+static JDistributedObjectExchange* j_distributed_object_exchange_start (JDistributedObjectBackgroundData*, GSocketConnection*, gboolean, JList*, GQueue*, guint*, JDistributedObjectHedging const*);
 
-	g_slice_free(JDistributedObjectBackgroundData, background_data);
+static JDistributedObjectHedge* j_distributed_object_hedge_new (JDistributedObjectExchange*);
 
-	return NULL;
-}
+static void j_distributed_object_hedge_exchange_done (JDistributedObjectHedge*, JDistributedObjectExchange*, gboolean);
 
 static
-gboolean
-j_distributed_object_create_exec (JList* operations, JSemantics* semantics)
+void
+j_distributed_object_exchange_done (JDistributedObjectExchange* exchange, gboolean failed)
 {
-	gboolean ret = FALSE;
-
-	JBackend* object_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autofree JMessage** messages = NULL;
-	gchar const* namespace = NULL;
-	gsize namespace_len = 0;
-	guint32 server_count = 0;
+	JDistributedObjectBackgroundData* background_data = exchange->data;
+	JDistributedObjectBackgroundData* next;
+	GSocketConnection* connection = exchange->connection;
+	guint32 index = background_data->index;
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+	if (exchange->hedging != NULL && !failed)
+	{
+		g_atomic_pointer_add(&(j_distributed_object_read_latencies[MIN(g_bit_storage(g_get_monotonic_time() - exchange->start), J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS - 1)]), 1);
+	}
 
-	j_trace_enter(G_STRFUNC, NULL);
+	/* Has to happen before the buffers are freed, because the hedge needs to know how many have been filled. */
+	if (exchange->hedge != NULL)
+	{
+		j_distributed_object_hedge_exchange_done(exchange->hedge, exchange, failed);
+	}
 
+	if (exchange->read)
 	{
-		JDistributedObject* object;
+		JDistributedObjectReadBuffer* buffer = exchange->buffer;
 
-		object = j_list_get_first(operations);
-		g_assert(object != NULL);
+		/* Collect or free the buffers that have not been processed because of an error. */
+		while (buffer != NULL || j_list_iterator_next(exchange->iterator))
+		{
+			if (buffer == NULL)
+			{
+				buffer = j_list_iterator_get(exchange->iterator);
+			}
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
-	}
+			if (failed && exchange->failed != NULL)
+			{
+				j_list_append(exchange->failed, buffer);
+			}
+			else
+			{
+				g_slice_free(JDistributedObjectReadBuffer, buffer);
+			}
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+			buffer = NULL;
+		}
 
-	if (object_backend == NULL)
+		j_list_iterator_free(exchange->iterator);
+		j_list_unref(background_data->read.buffers);
+	}
+	else
 	{
-		server_count = j_configuration_get_object_server_count(j_configuration());
-		messages = g_new(JMessage*, server_count);
+		j_list_unref(background_data->write.bytes_written);
 
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
+		if (background_data->write.payloads != NULL)
 		{
-			/**
-			 * Force safe semantics to make the server send a reply.
-			 * Otherwise, nasty races can occur when using unsafe semantics:
-			 * - The client creates the object and sends its first write.
-			 * - The client sends another operation using another connection from the pool.
-			 * - The second operation is executed first and fails because the object does not exist.
-			 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
-			 **/
-			messages[i] = j_message_new(J_MESSAGE_OBJECT_CREATE, namespace_len);
-			j_message_set_safety(messages[i], semantics);
-			//j_message_force_safety(messages[i], J_SEMANTICS_SAFETY_NETWORK);
-			j_message_append_n(messages[i], namespace, namespace_len);
+			g_array_unref(background_data->write.payloads);
 		}
 	}
 
-	while (j_list_iterator_next(it))
+	/* The server has accessed the regions once it has replied or failed. */
+	if (background_data->regions != NULL)
 	{
-		JDistributedObject* object = j_list_iterator_get(it);
+		g_ptr_array_unref(background_data->regions);
+	}
 
-		if (object_backend != NULL)
-		{
-			gpointer object_handle;
+	if (exchange->reply != NULL)
+	{
+		j_message_unref(exchange->reply);
+	}
 
-			ret = j_backend_object_create(object_backend, object->namespace, object->name, &object_handle) && ret;
-			ret = j_backend_object_close(object_backend, object_handle) && ret;
-		}
-		else
-		{
-			gsize name_len;
+	j_message_unref(background_data->message);
 
-			name_len = strlen(object->name) + 1;
+	next = (exchange->waiting != NULL) ? g_queue_pop_head(exchange->waiting) : NULL;
 
-			// FIXME use actual distribution
-			for (guint i = 0; i < server_count; i++)
-			{
-				j_message_add_operation(messages[i], name_len);
-				j_message_append_n(messages[i], object->name, name_len);
-			}
+	if (failed)
+	{
+		/* The connection is in an unknown state after an error. */
+		j_connection_pool_discard_object(index, connection);
+	}
+	else if (next == NULL)
+	{
+		j_connection_pool_push_object(index, connection);
+	}
+
+	if (next != NULL)
+	{
+		if (failed)
+		{
+			connection = j_connection_pool_pop_object(index);
 		}
+
+		j_distributed_object_exchange_start(next, connection, exchange->read, exchange->failed, exchange->waiting, exchange->pending, exchange->hedging);
 	}
 
-	if (object_backend == NULL)
+	(*exchange->pending)--;
+
+	g_slice_free(JDistributedObjectBackgroundData, background_data);
+	g_slice_free(JDistributedObjectExchange, exchange);
+}
+
+static void j_distributed_object_exchange_received (GObject*, GAsyncResult*, gpointer);
+
+static void j_distributed_object_exchange_data_received (GObject*, GAsyncResult*, gpointer);
+
+/**
+ * Processes the operations of a read reply, receiving their data one after the other.
+ */
+static
+void
+j_distributed_object_exchange_process (JDistributedObjectExchange* exchange)
+{
+	JDistributedObjectBackgroundData* background_data = exchange->data;
+
+	while (exchange->reply_remaining > 0 && j_list_iterator_next(exchange->iterator))
 	{
-		g_autofree gpointer* background_data = NULL;
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(exchange->iterator);
+		guint64 nbytes;
 
-		background_data = g_new(gpointer, server_count);
+		nbytes = j_message_get_varint(exchange->reply);
 
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
-		{
-			JDistributedObjectBackgroundData* data;
+		exchange->reply_remaining--;
+		exchange->operations_done++;
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
-			data->message = messages[i];
-			data->operations = NULL;
+		/* Data written using RDMA is already in place, data written to shared memory has to be copied. */
+		if (nbytes > 0 && background_data->regions != NULL)
+		{
+			j_transport_region_sync(g_ptr_array_index(background_data->regions, exchange->operations_done - 1), nbytes);
+			j_helper_atomic_add(buffer->bytes_read, nbytes);
+		}
+		else if (nbytes > 0)
+		{
+			/* The bytes are only accounted for once they have been received. */
+			exchange->buffer = buffer;
+			exchange->nbytes = nbytes;
 
-			background_data[i] = data;
+			j_message_receive_data_async(exchange->connection, buffer->data, nbytes, j_distributed_object_exchange_data_received, exchange);
+			return;
 		}
 
-		j_helper_execute_parallel(j_distributed_object_create_background_operation, background_data, server_count);
+		g_slice_free(JDistributedObjectReadBuffer, buffer);
 	}
 
-	j_trace_leave(G_STRFUNC);
+	/* The server might send multiple replies per message. */
+	if (exchange->reply_remaining == 0 && exchange->operations_done < j_message_get_count(background_data->message))
+	{
+		j_message_receive_async(exchange->reply, exchange->connection, j_distributed_object_exchange_received, exchange);
+		return;
+	}
 
-	return ret;
+	j_distributed_object_exchange_done(exchange, FALSE);
 }
 
 static
-gboolean
-j_distributed_object_delete_exec (JList* operations, JSemantics* semantics)
+void
+j_distributed_object_exchange_data_received (GObject* source, GAsyncResult* result, gpointer data)
 {
-	gboolean ret = FALSE;
+	JDistributedObjectExchange* exchange = data;
 
-	JBackend* object_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autofree JMessage** messages = NULL;
-	gchar const* namespace = NULL;
-	gsize namespace_len = 0;
-	guint32 server_count = 0;
+	(void)source;
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+	if (!j_message_receive_finish(result))
+	{
+		j_distributed_object_exchange_done(exchange, TRUE);
+		return;
+	}
 
-	j_trace_enter(G_STRFUNC, NULL);
+	j_helper_atomic_add(exchange->buffer->bytes_read, exchange->nbytes);
 
-	{
-		JDistributedObject* object;
+	g_slice_free(JDistributedObjectReadBuffer, exchange->buffer);
+	exchange->buffer = NULL;
 
-		object = j_list_get_first(operations);
-		g_assert(object != NULL);
+	j_distributed_object_exchange_process(exchange);
+}
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
-	}
+static
+void
+j_distributed_object_exchange_received (GObject* source, GAsyncResult* result, gpointer data)
+{
+	JDistributedObjectExchange* exchange = data;
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+	(void)source;
 
-	if (object_backend == NULL)
+	if (!j_message_receive_finish(result))
 	{
-		server_count = j_configuration_get_object_server_count(j_configuration());
-		messages = g_new(JMessage*, server_count);
-
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
-		{
-			messages[i] = j_message_new(J_MESSAGE_OBJECT_DELETE, namespace_len);
-			j_message_set_safety(messages[i], semantics);
-			j_message_append_n(messages[i], namespace, namespace_len);
-		}
+		j_distributed_object_exchange_done(exchange, TRUE);
+		return;
 	}
 
-	while (j_list_iterator_next(it))
+	if (exchange->read)
 	{
-		JDistributedObject* object = j_list_iterator_get(it);
+		exchange->reply_remaining = j_message_get_count(exchange->reply);
 
-		if (object_backend != NULL)
+		/* Guard against replies without operations, which would never finish the read. */
+		if (exchange->reply_remaining == 0)
 		{
-			gpointer object_handle;
-
-			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
-			ret = j_backend_object_delete(object_backend, object_handle) && ret;
+			j_distributed_object_exchange_done(exchange, TRUE);
+			return;
 		}
-		else
-		{
-			gsize name_len;
 
-			name_len = strlen(object->name) + 1;
-
-			// FIXME use actual distribution
-			for (guint i = 0; i < server_count; i++)
-			{
-				j_message_add_operation(messages[i], name_len);
-				j_message_append_n(messages[i], object->name, name_len);
-			}
-		}
+		j_distributed_object_exchange_process(exchange);
 	}
-
-	if (object_backend == NULL)
+	else
 	{
-		g_autofree gpointer* background_data = NULL;
+		g_autoptr(JListIterator) it = NULL;
 
-		background_data = g_new(gpointer, server_count);
+		it = j_list_iterator_new(exchange->data->write.bytes_written);
 
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
+		while (j_list_iterator_next(it))
 		{
-			JDistributedObjectBackgroundData* data;
+			guint64* bytes_written = j_list_iterator_get(it);
+			guint64 nbytes;
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
-			data->message = messages[i];
-			data->operations = NULL;
+			nbytes = j_message_get_varint(exchange->reply);
 
-			background_data[i] = data;
+			if (bytes_written != NULL)
+			{
+				j_helper_atomic_add(bytes_written, nbytes);
+			}
 		}
 
-		j_helper_execute_parallel(j_distributed_object_delete_background_operation, background_data, server_count);
+		j_distributed_object_exchange_done(exchange, FALSE);
 	}
-
-	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 static
-gboolean
-j_distributed_object_read_exec (JList* operations, JSemantics* semantics)
+void
+j_distributed_object_exchange_sent (GObject* source, GAsyncResult* result, gpointer data)
 {
-	gboolean ret = FALSE;
-
-	JBackend* object_backend;
-	g_autofree JList** br_lists = NULL;
-	g_autoptr(JListIterator) it = NULL;
-	g_autofree JMessage** messages = NULL;
-	JDistributedObject* object = NULL;
-	gpointer object_handle;
-	gsize name_len = 0;
-	gsize namespace_len = 0;
-	guint32 server_count = 0;
-
-	// FIXME
-	//JLock* lock = NULL;
-
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+	JDistributedObjectExchange* exchange = data;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	(void)source;
 
+	if (!j_message_send_finish(result))
 	{
-		JDistributedObjectOperation* operation = j_list_get_first(operations);
-		g_assert(operation != NULL);
-
-		object = operation->status.object;
-		g_assert(object != NULL);
+		j_distributed_object_exchange_done(exchange, TRUE);
+		return;
 	}
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
-
-	if (object_backend != NULL)
+	if (exchange->reply == NULL)
 	{
-		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+		j_distributed_object_exchange_done(exchange, FALSE);
+		return;
 	}
-	else
-	{
-		server_count = j_configuration_get_object_server_count(j_configuration());
-		messages = g_new(JMessage*, server_count);
-		br_lists = g_new(JList*, server_count);
-
-		namespace_len = strlen(object->namespace) + 1;
-		name_len = strlen(object->name) + 1;
 
-		for (guint i = 0; i < server_count; i++)
-		{
-			messages[i] = NULL;
-			br_lists[i] = NULL;
-		}
-	}
+	j_message_receive_async(exchange->reply, exchange->connection, j_distributed_object_exchange_received, exchange);
+}
 
-	/*
-	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) != J_SEMANTICS_ATOMICITY_NONE)
+/**
+ * Starts exchanging a message over a connection.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data       The message and the operations' results.
+ * \param connection A connection to the message's server.
+ * \param read       Whether the operations are reads.
+ * \param failed     A list that collects the read buffers that could not be filled, NULL to ignore them.
+ * \param waiting    The server's parts that wait for a connection, NULL if there are none.
+ * \param pending    The number of unfinished exchanges.
+ * \param hedging    The parameters for hedging a read, NULL if it should not be hedged.
+ *
+ * \return The exchange.
+ **/
+static
+JDistributedObjectExchange*
+j_distributed_object_exchange_start (JDistributedObjectBackgroundData* data, GSocketConnection* connection, gboolean read, JList* failed, GQueue* waiting, guint* pending, JDistributedObjectHedging const* hedging)
+{
+	JDistributedObjectExchange* exchange;
+
+	exchange = g_slice_new(JDistributedObjectExchange);
+	exchange->data = data;
+	exchange->connection = connection;
+	exchange->reply = NULL;
+	exchange->iterator = NULL;
+	exchange->buffer = NULL;
+	exchange->nbytes = 0;
+	exchange->failed = failed;
+	exchange->read = read;
+	exchange->operations_done = 0;
+	exchange->reply_remaining = 0;
+	exchange->waiting = waiting;
+	exchange->pending = pending;
+	exchange->hedging = hedging;
+	exchange->hedge = NULL;
+	exchange->start = g_get_monotonic_time();
+
+	if (read || (j_message_get_flags(data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK))
 	{
-		lock = j_lock_new("object", path);
+		exchange->reply = j_message_new_reply(data->message);
 	}
-	*/
 
-	while (j_list_iterator_next(it))
+	if (read)
 	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		gpointer data = operation->read.data;
-		guint64 length = operation->read.length;
-		guint64 offset = operation->read.offset;
-		guint64* bytes_read = operation->read.bytes_read;
-
-		j_trace_file_begin(object->name, J_TRACE_FILE_READ);
-
-		if (object_backend != NULL)
-		{
-			ret = j_backend_object_read(object_backend, object_handle, data, length, offset, bytes_read) && ret;
-		}
-		else
-		{
-			gchar* new_data;
-			guint32 index;
-			guint64 block_id;
-			guint64 new_length;
-			guint64 new_offset;
-
-			j_distribution_reset(object->distribution, length, offset);
-			new_data = data;
-
-			while (j_distribution_distribute(object->distribution, &index, &new_length, &new_offset, &block_id))
-			{
-				JDistributedObjectReadBuffer* buffer;
-
-				if (messages[index] == NULL && br_lists[index] == NULL)
-				{
-					messages[index] = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
-					j_message_set_safety(messages[index], semantics);
-					j_message_append_n(messages[index], object->namespace, namespace_len);
-					j_message_append_n(messages[index], object->name, name_len);
+		exchange->iterator = j_list_iterator_new(data->read.buffers);
+	}
 
-					br_lists[index] = j_list_new(NULL);
-				}
+	(*pending)++;
 
-				j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
-				j_message_append_8(messages[index], &new_length);
-				j_message_append_8(messages[index], &new_offset);
+	j_message_send_async(data->message, exchange->connection, j_distributed_object_exchange_sent, exchange);
 
-				buffer = g_slice_new(JDistributedObjectReadBuffer);
-				buffer->data = new_data;
-				buffer->bytes_read = bytes_read;
+	if (hedging != NULL && hedging->delay >= 0)
+	{
+		exchange->hedge = j_distributed_object_hedge_new(exchange);
+	}
 
-				j_list_append(br_lists[index], buffer);
+	return exchange;
+}
 
-				/*
-				if (lock != NULL)
-				{
-					j_lock_add(lock, block_id);
-				}
-				*/
+/**
+ * Exchanges reads or writes with all servers from the calling thread.
+ * All messages are sent and received asynchronously, so the servers are accessed in parallel without a thread per server.
+ * A server can receive several messages, which are exchanged in parallel as long as the connection pool can provide further connections without waiting.
+ * The remaining messages are exchanged one after the other over the connections that become available.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param background_data Background data per message, NULL for servers without operations.
+ * \param count           The number of messages.
+ * \param read            Whether the operations are reads.
+ * \param failed          A list that collects the read buffers that could not be filled, NULL to ignore them.
+ * \param hedging         The parameters for hedging reads, NULL if they should not be hedged.
+ **/
+static
+void
+j_distributed_object_exchange (gpointer* background_data, guint count, gboolean read, JList* failed, JDistributedObjectHedging const* hedging)
+{
+	GMainContext* context;
+	g_autofree GQueue* waiting = NULL;
+	g_autofree gboolean* started = NULL;
+	guint32 server_count;
+	guint pending = 0;
 
-				new_data += new_length;
-			}
-		}
+	server_count = j_configuration_get_object_server_count(j_configuration());
+	waiting = g_new0(GQueue, server_count);
+	started = g_new0(gboolean, server_count);
 
-		j_trace_file_end(object->name, J_TRACE_FILE_READ, length, offset);
-	}
+	context = g_main_context_new();
+	g_main_context_push_thread_default(context);
 
-	if (object_backend != NULL)
-	{
-		ret = j_backend_object_close(object_backend, object_handle) && ret;
-	}
-	else
+	for (guint i = 0; i < count; i++)
 	{
-		g_autofree gpointer* background_data = NULL;
-
-		background_data = g_new(gpointer, server_count);
+		JDistributedObjectBackgroundData* data = background_data[i];
+		GSocketConnection* connection;
 
-		for (guint i = 0; i < server_count; i++)
+		if (data == NULL)
 		{
-			JDistributedObjectBackgroundData* data;
-
-			if (messages[i] == NULL)
-			{
-				background_data[i] = NULL;
-				continue;
-			}
+			continue;
+		}
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
-			data->message = messages[i];
-			data->operations = NULL;
-			data->read.buffers = br_lists[i];
+		/* Waiting is only allowed for a server's first message, because the connections of the others are only returned once their exchanges are done. */
+		if (!started[data->index])
+		{
+			connection = j_connection_pool_pop_object(data->index);
+			started[data->index] = TRUE;
+		}
+		else
+		{
+			connection = j_connection_pool_try_pop_object(data->index);
+		}
 
-			background_data[i] = data;
+		if (connection == NULL)
+		{
+			g_queue_push_tail(&(waiting[data->index]), data);
+			continue;
 		}
 
-		j_helper_execute_parallel(j_distributed_object_read_background_operation, background_data, server_count);
+		j_distributed_object_exchange_start(data, connection, read, failed, &(waiting[data->index]), &pending, hedging);
 	}
 
-	/*
-	if (lock != NULL)
+	while (pending > 0)
 	{
-		// FIXME busy wait
-		while (!j_lock_acquire(lock));
-
-		j_lock_free(lock);
+		g_main_context_iteration(context, TRUE);
 	}
-	*/
-
-	j_trace_leave(G_STRFUNC);
 
-	return ret;
+	g_main_context_pop_thread_default(context);
+	g_main_context_unref(context);
 }
 
 static
-gboolean
-j_distributed_object_write_exec (JList* operations, JSemantics* semantics)
+void
+j_distributed_object_region_free (gpointer data)
 {
-	gboolean ret = FALSE;
-
-	JBackend* object_backend;
-	g_autofree JList** bw_lists = NULL;
-	g_autoptr(JListIterator) it = NULL;
-	g_autofree JMessage** messages = NULL;
-	JDistributedObject* object = NULL;
-	gpointer object_handle;
-	gsize name_len = 0;
-	gsize namespace_len = 0;
-	guint32 server_count = 0;
+	j_transport_region_free(data);
+}
 
-	// FIXME
-	//JLock* lock = NULL;
+/**
+ * Returns the part of a server's share that the next extent should be added to.
+ * A new part is started once the current one has reached the maximum message size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param parts        The server's parts, NULL if there are none.
+ * \param message_size The maximum message size, 0 if the share should not be split.
+ *
+ * \return The current part, NULL if a new one has to be started.
+ **/
+static
+JDistributedObjectBackgroundData*
+j_distributed_object_part_get (GPtrArray* parts, guint64 message_size)
+{
+	JDistributedObjectBackgroundData* data;
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+	if (parts == NULL)
+	{
+		return NULL;
+	}
 
-	j_trace_enter(G_STRFUNC, NULL);
+	data = g_ptr_array_index(parts, parts->len - 1);
 
+	if (message_size > 0 && data->size >= message_size)
 	{
-		JDistributedObjectOperation* operation = j_list_get_first(operations);
-		g_assert(operation != NULL);
-
-		object = operation->status.object;
-		g_assert(object != NULL);
+		return NULL;
 	}
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+	return data;
+}
 
-	if (object_backend != NULL)
+/**
+ * Starts a new part of a server's share.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param parts   The server's parts, created if NULL.
+ * \param index   The server's index.
+ * \param message The part's message.
+ * \param read    Whether the operations are reads.
+ *
+ * \return The new part.
+ **/
+static
+JDistributedObjectBackgroundData*
+j_distributed_object_part_new (GPtrArray** parts, guint32 index, JMessage* message, gboolean read)
+{
+	JDistributedObjectBackgroundData* data;
+
+	data = g_slice_new(JDistributedObjectBackgroundData);
+	data->index = index;
+	data->message = message;
+	data->operations = NULL;
+	data->size = 0;
+	data->regions = NULL;
+
+	if (read)
 	{
-		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+		data->read.buffers = j_list_new(NULL);
 	}
 	else
 	{
-		server_count = j_configuration_get_object_server_count(j_configuration());
-		messages = g_new(JMessage*, server_count);
-		bw_lists = g_new(JList*, server_count);
-
-		namespace_len = strlen(object->namespace) + 1;
-		name_len = strlen(object->name) + 1;
-
-		for (guint i = 0; i < server_count; i++)
-		{
-			messages[i] = NULL;
-			bw_lists[i] = NULL;
-		}
+		data->write.bytes_written = j_list_new(NULL);
+		data->write.payloads = g_array_new(FALSE, FALSE, sizeof(JDistributedObjectPayload));
 	}
 
-	/*
-	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) != J_SEMANTICS_ATOMICITY_NONE)
+	/* Written regions have to stay registered until the server has read them, which is only known if it replies. */
+	if ((read || (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)) && (j_connection_pool_get_shm_object(index) != NULL || j_connection_pool_get_rdma_object(index)))
 	{
-		lock = j_lock_new("object", path);
+		data->regions = g_ptr_array_new_with_free_func(j_distributed_object_region_free);
 	}
-	*/
 
-	while (j_list_iterator_next(it))
+	if (*parts == NULL)
 	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		gconstpointer data = operation->write.data;
-		guint64 length = operation->write.length;
-		guint64 offset = operation->write.offset;
-		guint64* bytes_written = operation->write.bytes_written;
-
-		j_trace_file_begin(object->name, J_TRACE_FILE_WRITE);
-
-		if (object_backend != NULL)
-		{
-			ret = j_backend_object_write(object_backend, object_handle, data, length, offset, bytes_written) && ret;
-		}
-		else
-		{
-			gchar const* new_data;
-			guint32 index;
-			guint64 block_id;
-			guint64 new_length;
-			guint64 new_offset;
+		*parts = g_ptr_array_new();
+	}
 
-			j_distribution_reset(object->distribution, length, offset);
-			new_data = data;
+	g_ptr_array_add(*parts, data);
 
-			while (j_distribution_distribute(object->distribution, &index, &new_length, &new_offset, &block_id))
-			{
-				if (messages[index] == NULL && bw_lists[index] == NULL)
-				{
-					messages[index] = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + name_len);
-					j_message_set_safety(messages[index], semantics);
-					j_message_append_n(messages[index], object->namespace, namespace_len);
-					j_message_append_n(messages[index], object->name, name_len);
+	return data;
+}
 
-					bw_lists[index] = j_list_new(NULL);
-				}
+/**
+ * Adds a read or write to a part's message.
+ * The payload of a write has to be added to the part's payloads.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data   A part.
+ * \param length The number of bytes to read or write.
+ * \param offset An offset within the object.
+ **/
+static
+void
+j_distributed_object_part_add (JDistributedObjectBackgroundData* data, guint64 length, guint64 offset)
+{
+	/* Also reserve space for the operation's region. */
+	j_message_add_operation(data->message, sizeof(guint64) + sizeof(guint64) + ((data->regions != NULL) ? 2 * sizeof(guint64) : 0));
+	j_message_append_varint(data->message, length);
+	j_message_append_varint(data->message, offset);
+	data->size += length;
+}
 
-				j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
-				j_message_append_8(messages[index], &new_length);
-				j_message_append_8(messages[index], &new_offset);
-				j_message_add_send(messages[index], new_data, new_length);
+/**
+ * Completes a part before it is exchanged.
+ * The operations' payloads are registered, so that the server can access them using RDMA.
+ * For local servers, the regions are allocated from shared memory instead.
+ * Payloads that cannot be registered are transferred over the connection.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data A part.
+ * \param read Whether the operations are reads.
+ **/
+static
+void
+j_distributed_object_part_finish (JDistributedObjectBackgroundData* data, gboolean read)
+{
+	if (data->regions != NULL)
+	{
+		g_autoptr(JListIterator) it = NULL;
+		JTransportShm* shm;
+		guint count;
 
-				j_list_append(bw_lists[index], bytes_written);
+		shm = j_connection_pool_get_shm_object(data->index);
+		count = j_message_get_count(data->message);
 
-				/*
-				if (lock != NULL)
-				{
-					j_lock_add(lock, block_id);
-				}
-				*/
+		if (read)
+		{
+			it = j_list_iterator_new(data->read.buffers);
+		}
 
-				new_data += new_length;
+		for (guint i = 0; i < count; i++)
+		{
+			JTransportRegion* region;
+			gpointer payload;
+			guint64 length;
 
-				if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
-				{
-					j_helper_atomic_add(bytes_written, new_length);
-				}
+			if (read)
+			{
+				JDistributedObjectReadBuffer* buffer;
+
+				j_list_iterator_next(it);
+				buffer = j_list_iterator_get(it);
+
+				payload = buffer->data;
+				length = buffer->length;
 			}
-		}
+			else
+			{
+				JDistributedObjectPayload* write_payload = &g_array_index(data->write.payloads, JDistributedObjectPayload, i);
 
-		j_trace_file_end(object->name, J_TRACE_FILE_WRITE, length, offset);
+				/* Regions of writes are only read by the server. */
+				payload = (gpointer)write_payload->data;
+				length = write_payload->length;
+			}
+
+			if (shm != NULL)
+			{
+				region = j_transport_shm_region_new(shm, payload, length, !read);
+			}
+			else
+			{
+				region = j_transport_region_new(payload, length);
+			}
+
+			/* All operations of a message have to use the same transport. */
+			if (region == NULL)
+			{
+				g_ptr_array_unref(data->regions);
+				data->regions = NULL;
+				break;
+			}
+
+			g_ptr_array_add(data->regions, region);
+		}
 	}
 
-	if (object_backend != NULL)
+	if (data->regions != NULL)
 	{
-		ret = j_backend_object_close(object_backend, object_handle) && ret;
+		/* The regions follow the lengths and offsets of all operations. */
+		for (guint i = 0; i < data->regions->len; i++)
+		{
+			JTransportRemote remote = { 0, 0 };
+
+			j_transport_region_get_remote(g_ptr_array_index(data->regions, i), &remote);
+			j_message_append_8(data->message, &(remote.address));
+			j_message_append_8(data->message, &(remote.key));
+		}
+
+		j_message_set_rdma(data->message, TRUE);
 	}
-	else
+	else if (!read)
 	{
-		g_autofree gpointer* background_data = NULL;
+		for (guint i = 0; i < data->write.payloads->len; i++)
+		{
+			JDistributedObjectPayload* payload = &g_array_index(data->write.payloads, JDistributedObjectPayload, i);
 
-		background_data = g_new(gpointer, server_count);
+			j_message_add_send(data->message, payload->data, payload->length);
+		}
+	}
+}
+
+/**
+ * Exchanges the parts of all servers and frees the servers' arrays of parts.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param parts        The parts per server, NULL for servers without operations.
+ * \param server_count The number of servers.
+ * \param read         Whether the operations are reads.
+ * \param failed       A list that collects the read buffers that could not be filled, NULL to ignore them.
+ * \param hedging      The parameters for hedging reads, NULL if they should not be hedged.
+ **/
+static
+void
+j_distributed_object_exchange_parts (GPtrArray** parts, guint32 server_count, gboolean read, JList* failed, JDistributedObjectHedging const* hedging)
+{
+	g_autoptr(GPtrArray) background_data = NULL;
+	gboolean added = TRUE;
+
+	background_data = g_ptr_array_new();
+
+	/* Interleave the servers' parts, so that all servers are busy from the start. */
+	for (guint j = 0; added; j++)
+	{
+		added = FALSE;
 
 		for (guint i = 0; i < server_count; i++)
 		{
-			JDistributedObjectBackgroundData* data;
-
-			if (messages[i] == NULL)
+			if (parts[i] != NULL && j < parts[i]->len)
 			{
-				background_data[i] = NULL;
-				continue;
-			}
+				JDistributedObjectBackgroundData* data = g_ptr_array_index(parts[i], j);
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
-			data->message = messages[i];
-			data->operations = NULL;
-			data->write.bytes_written = bw_lists[i];
+				j_distributed_object_part_finish(data, read);
+				g_ptr_array_add(background_data, data);
+				added = TRUE;
+			}
+		}
+	}
 
-			background_data[i] = data;
+	for (guint i = 0; i < server_count; i++)
+	{
+		if (parts[i] != NULL)
+		{
+			g_ptr_array_unref(parts[i]);
 		}
+	}
+
+	j_distributed_object_exchange(background_data->pdata, background_data->len, read, failed, hedging);
+}
+
+/**
+ * Returns how long reads should wait for a reply before they are hedged.
+ * The delay is the upper bound of the latency histogram's bucket that contains the configured percentile.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \return The delay in microseconds, -1 if not enough reads have been recorded yet or hedging is disabled.
+ **/
+static
+gint64
+j_distributed_object_hedge_delay (void)
+{
+	guint64 buckets[J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS];
+	guint64 total = 0;
+	guint64 count = 0;
+	guint32 percentile;
 
-		j_helper_execute_parallel(j_distributed_object_write_background_operation, background_data, server_count);
+	percentile = j_configuration_get_hedge_percentile(j_configuration());
+
+	if (percentile == 0)
+	{
+		return -1;
 	}
 
-	/*
-	if (lock != NULL)
+	for (guint i = 0; i < J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS; i++)
 	{
-		// FIXME busy wait
-		while (!j_lock_acquire(lock));
+		buckets[i] = (gsize)g_atomic_pointer_get(&(j_distributed_object_read_latencies[i]));
+		total += buckets[i];
+	}
 
-		j_lock_free(lock);
+	if (total < J_DISTRIBUTED_OBJECT_HEDGE_SAMPLES)
+	{
+		return -1;
 	}
-	*/
 
-	j_trace_leave(G_STRFUNC);
+	for (guint i = 0; i < J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS; i++)
+	{
+		count += buckets[i];
 
-	return ret;
+		if (count * 100 >= total * percentile)
+		{
+			return G_GINT64_CONSTANT(1) << i;
+		}
+	}
+
+	return G_GINT64_CONSTANT(1) << (J_DISTRIBUTED_OBJECT_LATENCY_BUCKETS - 1);
 }
 
+/**
+ * Cancels an exchange by shutting down its connection.
+ * The exchange fails as soon as its pending operation notices the shutdown and the broken connection is replaced when it is popped next.
+ *
+ * \private
+ **/
 static
-gboolean
-j_distributed_object_status_exec (JList* operations, JSemantics* semantics)
+void
+j_distributed_object_exchange_cancel (JDistributedObjectExchange* exchange)
 {
-	gboolean ret = FALSE;
+	g_socket_shutdown(g_socket_connection_get_socket(exchange->connection), TRUE, TRUE, NULL);
+}
 
-	JBackend* object_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autofree JMessage** messages = NULL;
-	gchar const* namespace = NULL;
-	gsize namespace_len = 0;
-	guint32 server_count = 0;
+/**
+ * Frees the parts of a hedge that could not be sent.
+ *
+ * \private
+ **/
+static
+void
+j_distributed_object_hedge_parts_free (GPtrArray* parts)
+{
+	for (guint i = 0; i < parts->len; i++)
+	{
+		JDistributedObjectBackgroundData* data = g_ptr_array_index(parts, i);
+		g_autoptr(JListIterator) it = NULL;
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+		it = j_list_iterator_new(data->read.buffers);
 
-	j_trace_enter(G_STRFUNC, NULL);
+		while (j_list_iterator_next(it))
+		{
+			g_slice_free(JDistributedObjectReadBuffer, j_list_iterator_get(it));
+		}
+
+		if (data->regions != NULL)
+		{
+			g_ptr_array_unref(data->regions);
+		}
+
+		j_list_unref(data->read.buffers);
+		j_message_unref(data->message);
+		g_slice_free(JDistributedObjectBackgroundData, data);
+	}
+
+	g_ptr_array_unref(parts);
+}
 
+static JMessage* j_distributed_object_message_new (JDistributedObject*, JMessageType, guint32, JSemantics*);
+
+/**
+ * Sends a hedge's read to the servers holding the other copies of its data.
+ * The data is received into the hedge's own memory, so that both exchanges do not race for the caller's buffers.
+ * Hedges only use connections that are available without waiting; otherwise, the read is not hedged.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param hedge A hedge.
+ **/
+static
+void
+j_distributed_object_hedge_send (JDistributedObjectHedge* hedge)
+{
+	JDistribution* distribution = hedge->hedging->object->distribution;
+	g_autofree GPtrArray** parts = NULL;
+	g_autofree GSocketConnection** connections = NULL;
+	guint64 position = 0;
+	guint32 server_count;
+	guint replicas;
+	gboolean ret = TRUE;
+
+	server_count = j_configuration_get_object_server_count(j_configuration());
+	replicas = j_distribution_get_replica_count(distribution);
+	parts = g_new0(GPtrArray*, server_count);
+	connections = g_new0(GSocketConnection*, server_count);
+
+	for (guint i = 0; i < hedge->targets_len; i++)
 	{
-		JDistributedObjectOperation* operation = j_list_get_first(operations);
-		JDistributedObject* object = operation->status.object;
+		position += hedge->targets[i].length;
+	}
 
-		g_assert(operation != NULL);
-		g_assert(object != NULL);
+	hedge->data = g_malloc(position);
+	hedge->nbytes = g_new0(guint64, hedge->targets_len);
+	position = 0;
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
+	for (guint i = 0; i < hedge->targets_len && ret; i++)
+	{
+		JDistributedObjectReadBuffer* target = &(hedge->targets[i]);
+		JDistributionExtent extents[J_DISTRIBUTED_OBJECT_EXTENTS];
+		gchar* new_data;
+		guint count;
+
+		j_distribution_reset(distribution, target->length, target->offset);
+		new_data = hedge->data + position;
+
+		while (ret && (count = j_distribution_distribute_extents(distribution, extents, G_N_ELEMENTS(extents))) > 0)
+		{
+			for (guint k = 0; k < count && ret; k++)
+			{
+				JDistributedObjectBackgroundData* part;
+				JDistributedObjectReadBuffer* buffer;
+				guint32 index = hedge->index;
+				guint64 new_offset = 0;
+
+				/* Use the next copy that is not stored on the slow server. */
+				for (guint j = 1; j < replicas && index == hedge->index; j++)
+				{
+					j_distribution_get_replica(distribution, &(extents[k]), (extents[k].block_id + j) % replicas, &index, &new_offset);
+				}
+
+				if (index == hedge->index)
+				{
+					ret = FALSE;
+					break;
+				}
+
+				if ((part = j_distributed_object_part_get(parts[index], 0)) == NULL)
+				{
+					JMessage* message;
+
+					message = j_distributed_object_message_new(hedge->hedging->object, J_MESSAGE_OBJECT_READ, index, hedge->hedging->semantics);
+					j_message_set_access(message, hedge->hedging->semantics);
+
+					part = j_distributed_object_part_new(&(parts[index]), index, message, TRUE);
+				}
+
+				j_distributed_object_part_add(part, extents[k].length, new_offset);
+
+				buffer = g_slice_new(JDistributedObjectReadBuffer);
+				buffer->data = new_data;
+				buffer->bytes_read = &(hedge->nbytes[i]);
+				buffer->offset = target->offset + (new_data - (hedge->data + position));
+				buffer->length = extents[k].length;
+
+				j_list_append(part->read.buffers, buffer);
+
+				new_data += extents[k].length;
+			}
+		}
+
+		position += target->length;
 	}
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+	for (guint i = 0; i < server_count && ret; i++)
+	{
+		if (parts[i] != NULL && (connections[i] = j_connection_pool_try_pop_object(i)) == NULL)
+		{
+			ret = FALSE;
+		}
+	}
 
-	if (object_backend == NULL)
+	for (guint i = 0; i < server_count; i++)
 	{
-		server_count = j_configuration_get_object_server_count(j_configuration());
-		messages = g_new(JMessage*, server_count);
+		JDistributedObjectExchange* exchange;
 
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
+		if (parts[i] == NULL)
 		{
-			messages[i] = j_message_new(J_MESSAGE_OBJECT_STATUS, namespace_len);
-			j_message_set_safety(messages[i], semantics);
-			j_message_append_n(messages[i], namespace, namespace_len);
+			continue;
+		}
+
+		if (!ret)
+		{
+			if (connections[i] != NULL)
+			{
+				j_connection_pool_push_object(i, connections[i]);
+			}
+
+			j_distributed_object_hedge_parts_free(parts[i]);
+
+			continue;
 		}
+
+		/* Hedges are not split, so every server has exactly one part. */
+		j_distributed_object_part_finish(g_ptr_array_index(parts[i], 0), TRUE);
+		exchange = j_distributed_object_exchange_start(g_ptr_array_index(parts[i], 0), connections[i], TRUE, NULL, NULL, hedge->pending, NULL);
+		exchange->hedge = hedge;
+
+		g_ptr_array_add(hedge->secondaries, exchange);
+		g_ptr_array_unref(parts[i]);
 	}
 
+	hedge->hedged = ret;
+}
+
+static
+gboolean
+j_distributed_object_hedge_fire (gpointer data)
+{
+	JDistributedObjectHedge* hedge = data;
+
+	g_source_unref(hedge->timer);
+	hedge->timer = NULL;
+
+	j_distributed_object_hedge_send(hedge);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Creates a hedge for a read exchange, which is sent if the exchange is not done after the hedging delay.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param exchange A read exchange that has just been started.
+ *
+ * \return A new hedge, freed once all of its exchanges are done.
+ **/
+static
+JDistributedObjectHedge*
+j_distributed_object_hedge_new (JDistributedObjectExchange* exchange)
+{
+	JDistributedObjectHedge* hedge;
+	g_autoptr(JListIterator) it = NULL;
+	guint i = 0;
+
+	hedge = g_slice_new(JDistributedObjectHedge);
+	hedge->hedging = exchange->hedging;
+	hedge->primary = exchange;
+	hedge->index = exchange->data->index;
+	hedge->secondaries = g_ptr_array_new();
+	hedge->targets_len = j_list_length(exchange->data->read.buffers);
+	hedge->targets = g_new(JDistributedObjectReadBuffer, hedge->targets_len);
+	hedge->data = NULL;
+	hedge->nbytes = NULL;
+	hedge->primary_filled = 0;
+	hedge->primary_ok = FALSE;
+	hedge->secondary_ok = TRUE;
+	hedge->hedged = FALSE;
+	hedge->pending = exchange->pending;
+
+	it = j_list_iterator_new(exchange->data->read.buffers);
+
 	while (j_list_iterator_next(it))
 	{
-		JDistributedObjectOperation* operation = j_list_iterator_get(it);
-		JDistributedObject* object = operation->status.object;
-		gint64* modification_time = operation->status.modification_time;
-		guint64* size = operation->status.size;
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
 
-		if (modification_time != NULL)
+		hedge->targets[i++] = *buffer;
+	}
+
+	/* The exchange's context is the thread's default one. */
+	hedge->timer = g_timeout_source_new(MAX(hedge->hedging->delay / G_TIME_SPAN_MILLISECOND, 1));
+	g_source_set_callback(hedge->timer, j_distributed_object_hedge_fire, hedge, NULL);
+	g_source_attach(hedge->timer, g_main_context_get_thread_default());
+
+	return hedge;
+}
+
+/**
+ * Copies the other copies' data into the caller's buffers if they have answered instead of the original server and frees the hedge.
+ *
+ * \private
+ **/
+static
+void
+j_distributed_object_hedge_free (JDistributedObjectHedge* hedge)
+{
+	if (hedge->hedged && !hedge->primary_ok && hedge->secondary_ok)
+	{
+		guint64 position = 0;
+
+		for (guint i = 0; i < hedge->targets_len; i++)
 		{
-			*modification_time = 0;
+			JDistributedObjectReadBuffer* target = &(hedge->targets[i]);
+
+			/* The original server's data has already been accounted for. */
+			if (i >= hedge->primary_filled)
+			{
+				memcpy(target->data, hedge->data + position, hedge->nbytes[i]);
+				j_helper_atomic_add(target->bytes_read, hedge->nbytes[i]);
+			}
+
+			position += target->length;
 		}
+	}
+
+	g_ptr_array_unref(hedge->secondaries);
+	g_free(hedge->targets);
+	g_free(hedge->data);
+	g_free(hedge->nbytes);
+
+	g_slice_free(JDistributedObjectHedge, hedge);
+}
+
+/**
+ * Updates a hedge when one of its exchanges is done.
+ * The first successful side cancels the other one.
+ * If the original exchange fails before the hedge has been sent, it is sent immediately.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param hedge    A hedge.
+ * \param exchange One of the hedge's exchanges.
+ * \param failed   Whether the exchange has failed.
+ **/
+static
+void
+j_distributed_object_hedge_exchange_done (JDistributedObjectHedge* hedge, JDistributedObjectExchange* exchange, gboolean failed)
+{
+	if (exchange == hedge->primary)
+	{
+		hedge->primary = NULL;
+		hedge->primary_ok = !failed;
+		hedge->primary_filled = exchange->operations_done - ((exchange->buffer != NULL) ? 1 : 0);
+
+		if (hedge->timer != NULL)
+		{
+			g_source_destroy(hedge->timer);
+			g_source_unref(hedge->timer);
+			hedge->timer = NULL;
+		}
+
+		if (!failed)
+		{
+			for (guint i = 0; i < hedge->secondaries->len; i++)
+			{
+				j_distributed_object_exchange_cancel(g_ptr_array_index(hedge->secondaries, i));
+			}
+		}
+		else if (!hedge->hedged)
+		{
+			j_distributed_object_hedge_send(hedge);
+		}
+	}
+	else
+	{
+		g_ptr_array_remove_fast(hedge->secondaries, exchange);
+		hedge->secondary_ok = hedge->secondary_ok && !failed;
+
+		if (hedge->secondaries->len == 0 && hedge->secondary_ok && hedge->primary != NULL)
+		{
+			j_distributed_object_exchange_cancel(hedge->primary);
+		}
+	}
+
+	if (hedge->primary == NULL && hedge->secondaries->len == 0)
+	{
+		j_distributed_object_hedge_free(hedge);
+	}
+}
+
+/**
+ * Executes status operations in a background operation.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
+static
+gpointer
+j_distributed_object_status_background_operation (gpointer data)
+{
+	JDistributedObjectBackgroundData* background_data = data;
+
+	g_autoptr(JMessage) reply = NULL;
+	guint32 operation_count;
+
+	reply = j_connection_pool_request_object(background_data->index, background_data->message, TRUE);
+	background_data->status.success = (reply != NULL);
+
+	operation_count = j_message_get_count(background_data->message);
+
+	for (guint32 i = 0; reply != NULL && i < operation_count; i++)
+	{
+		background_data->status.modification_times[i] = j_message_get_8(reply);
+		background_data->status.sizes[i] = j_message_get_8(reply);
+	}
+
+	return NULL;
+}
+
+static
+gint
+j_distributed_object_segment_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+	JDistributedObjectSegment const* segment_a = a;
+	JDistributedObjectSegment const* segment_b = b;
+	gboolean const* by_index = data;
+
+	if (!*by_index && segment_a->offset != segment_b->offset)
+	{
+		return (segment_a->offset < segment_b->offset) ? -1 : 1;
+	}
+
+	return (segment_a->index < segment_b->index) ? -1 : (segment_a->index > segment_b->index) ? 1 : 0;
+}
+
+/**
+ * Sorts the segments of a vectored access by offset, so the server can merge adjacent ones.
+ * Overlapping writes have to be applied in their original order, so they are not sorted.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param segments A segment array.
+ * \param count    The number of segments.
+ * \param write    Whether the segments are written.
+ **/
+static
+void
+j_distributed_object_segments_sort (JDistributedObjectSegment* segments, guint count, gboolean write)
+{
+	gboolean by_index = FALSE;
+
+	g_qsort_with_data(segments, count, sizeof(JDistributedObjectSegment), j_distributed_object_segment_compare, &by_index);
+
+	if (!write)
+	{
+		return;
+	}
+
+	for (guint i = 1; i < count; i++)
+	{
+		if (segments[i - 1].offset + segments[i - 1].length > segments[i].offset)
+		{
+			by_index = TRUE;
+			g_qsort_with_data(segments, count, sizeof(JDistributedObjectSegment), j_distributed_object_segment_compare, &by_index);
+
+			break;
+		}
+	}
+}
+
+/**
+ * Replaces vectored operations by their segments.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ *
+ * \return A list of reads or writes. Should be freed with j_list_unref().
+ **/
+static
+JList*
+j_distributed_object_expand (JList* operations)
+{
+	JList* expanded;
+	g_autoptr(JListIterator) it = NULL;
+	gboolean vectored = FALSE;
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+
+		if (operation->segments != NULL)
+		{
+			vectored = TRUE;
+			break;
+		}
+	}
+
+	if (!vectored)
+	{
+		return j_list_ref(operations);
+	}
+
+	j_list_iterator_free(it);
+
+	expanded = j_list_new(NULL);
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+
+		if (operation->segments == NULL)
+		{
+			j_list_append(expanded, operation);
+			continue;
+		}
+
+		for (guint i = 0; i < operation->segment_count; i++)
+		{
+			j_list_append(expanded, &(operation->segments[i]));
+		}
+	}
+
+	return expanded;
+}
+
+/**
+ * Creates objects.
+ * Servers create their stripes implicitly when they are first written, so only client-side backends have to create objects.
+ * This way, creating an object does not require any communication and servers that never receive data do not store anything.
+ *
+ * \private
+ **/
+static
+gboolean
+j_distributed_object_create_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObject* object = j_list_get_first(operations);
+		g_assert(object != NULL);
+
+		object_backend = j_object_backend_for_namespace(object->namespace);
+	}
+
+	if (object_backend == NULL)
+	{
+		goto end;
+	}
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObject* object = j_list_iterator_get(it);
+		gpointer object_handle;
+
+		ret = j_backend_object_create(object_backend, object->namespace, object->name, &object_handle) && ret;
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static void j_distributed_object_status_invalidate (JDistributedObject*);
+
+static
+gboolean
+j_distributed_object_delete_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = FALSE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	g_autofree JMessage** append_messages = NULL;
+	gchar const* namespace = NULL;
+	gsize namespace_len = 0;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObject* object;
+
+		object = j_list_get_first(operations);
+		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(namespace);
+
+	if (object_backend == NULL)
+	{
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		messages = g_new(JMessage*, server_count);
+		append_messages = g_new0(JMessage*, server_count);
+
+		// FIXME use actual distribution
+		for (guint i = 0; i < server_count; i++)
+		{
+			messages[i] = j_message_new(J_MESSAGE_OBJECT_DELETE, namespace_len);
+			j_message_set_safety(messages[i], semantics);
+			j_message_append_n(messages[i], namespace, namespace_len);
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObject* object = j_list_iterator_get(it);
+		g_autofree gchar* append_path = NULL;
+
+		j_distributed_object_status_invalidate(object);
+
+		/* The object tracking appends has to be deleted, too, otherwise recreated objects would continue after the old data. */
+		append_path = g_strconcat(object->namespace, "/", object->name, NULL);
+
+		if (object_backend != NULL)
+		{
+			gpointer object_handle;
+
+			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+			ret = j_backend_object_delete(object_backend, object_handle) && ret;
+
+			if (j_backend_object_open(object_backend, J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE, append_path, &object_handle))
+			{
+				j_backend_object_delete(object_backend, object_handle);
+			}
+		}
+		else
+		{
+			gsize name_len;
+			gsize append_path_len;
+			guint32 index;
+
+			name_len = strlen(object->name) + 1;
+
+			// FIXME use actual distribution
+			for (guint i = 0; i < server_count; i++)
+			{
+				j_message_add_operation(messages[i], name_len);
+				j_message_append_n(messages[i], object->name, name_len);
+			}
+
+			append_path_len = strlen(append_path) + 1;
+			index = j_helper_hash(append_path) % server_count;
+
+			if (append_messages[index] == NULL)
+			{
+				append_messages[index] = j_message_new(J_MESSAGE_OBJECT_DELETE, strlen(J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE) + 1);
+				j_message_set_safety(append_messages[index], semantics);
+				j_message_append_n(append_messages[index], J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE, strlen(J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE) + 1);
+			}
+
+			j_message_add_operation(append_messages[index], append_path_len);
+			j_message_append_n(append_messages[index], append_path, append_path_len);
+		}
+	}
+
+	if (object_backend == NULL)
+	{
+		g_autofree gpointer* background_data = NULL;
+		guint count = 0;
+
+		background_data = g_new(gpointer, 2 * server_count);
+
+		// FIXME use actual distribution
+		for (guint i = 0; i < 2 * server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data;
+			JMessage* message;
+
+			message = (i < server_count) ? messages[i] : append_messages[i - server_count];
+
+			if (message == NULL)
+			{
+				continue;
+			}
+
+			data = g_slice_new(JDistributedObjectBackgroundData);
+			data->index = i % server_count;
+			data->message = message;
+			data->operations = NULL;
+
+			background_data[count] = data;
+			count++;
+		}
+
+		j_helper_execute_parallel(j_distributed_object_delete_background_operation, background_data, count);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+void
+j_distributed_object_purge_free (gpointer data)
+{
+	JDistributedObjectPurge* purge = data;
+
+	g_free(purge->namespace);
+	g_free(purge->directory);
+
+	g_slice_free(JDistributedObjectPurge, purge);
+}
+
+static
+gpointer
+j_distributed_object_purge_background_operation (gpointer data)
+{
+	JDistributedObjectBackgroundData* background_data = data;
+
+	g_autoptr(JMessage) reply = NULL;
+
+	reply = j_connection_pool_request_object(background_data->index, background_data->message, TRUE);
+
+	if (reply != NULL)
+	{
+		guint32 count;
+
+		count = j_message_get_count(reply);
+
+		for (guint32 i = 0; i < count; i++)
+		{
+			background_data->purge.success = j_message_get_1(reply) && background_data->purge.success;
+		}
+	}
+	else
+	{
+		background_data->purge.success = FALSE;
+	}
+
+	return data;
+}
+
+/**
+ * Purges directories on all servers in parallel.
+ * Every namespace gets its own message per server.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ * \param semantics  A semantics object.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_purge_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(GPtrArray) messages = NULL;
+	guint32 server_count;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+	server_count = j_configuration_get_object_server_count(j_configuration());
+
+	/* Contains one message per server for every namespace, in server order. */
+	messages = g_ptr_array_new();
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectPurge* purge = j_list_iterator_get(it);
+		JBackend* object_backend;
+		gsize directory_len;
+		guint offset = G_MAXUINT;
+
+		/* Purges are combined over all namespaces, which might be routed differently. */
+		object_backend = j_object_backend_for_namespace(purge->namespace);
+
+		if (object_backend != NULL)
+		{
+			ret = object_backend->object.purge != NULL && j_backend_object_purge(object_backend, purge->namespace, purge->directory) && ret;
+			continue;
+		}
+
+		for (guint j = 0; j < messages->len; j += server_count)
+		{
+			JMessage* message = g_ptr_array_index(messages, j);
+
+			if (g_strcmp0(j_message_get_string(message), purge->namespace) == 0)
+			{
+				offset = j;
+			}
+
+			j_message_rewind(message);
+
+			if (offset != G_MAXUINT)
+			{
+				break;
+			}
+		}
+
+		if (offset == G_MAXUINT)
+		{
+			gsize namespace_len;
+
+			namespace_len = strlen(purge->namespace) + 1;
+			offset = messages->len;
+
+			for (guint32 i = 0; i < server_count; i++)
+			{
+				JMessage* message;
+
+				message = j_message_new(J_MESSAGE_OBJECT_PURGE, namespace_len);
+				j_message_set_safety(message, semantics);
+				j_message_append_n(message, purge->namespace, namespace_len);
+
+				g_ptr_array_add(messages, message);
+			}
+		}
+
+		directory_len = strlen(purge->directory) + 1;
+
+		/* The objects are distributed over all servers. */
+		for (guint32 i = 0; i < server_count; i++)
+		{
+			JMessage* message = g_ptr_array_index(messages, offset + i);
+
+			j_message_add_operation(message, directory_len);
+			j_message_append_n(message, purge->directory, directory_len);
+		}
+	}
+
+	if (messages->len > 0)
+	{
+		g_autofree gpointer* background_data = NULL;
+
+		background_data = g_new(gpointer, messages->len);
+
+		for (guint i = 0; i < messages->len; i++)
+		{
+			JDistributedObjectBackgroundData* data;
+
+			data = g_slice_new(JDistributedObjectBackgroundData);
+			data->index = i % server_count;
+			data->message = g_ptr_array_index(messages, i);
+			data->operations = NULL;
+			data->purge.success = TRUE;
+
+			background_data[i] = data;
+		}
+
+		j_helper_execute_parallel(j_distributed_object_purge_background_operation, background_data, messages->len);
+
+		for (guint i = 0; i < messages->len; i++)
+		{
+			JDistributedObjectBackgroundData* data = background_data[i];
+
+			ret = data->purge.success && ret;
+
+			j_message_unref(data->message);
+			g_slice_free(JDistributedObjectBackgroundData, data);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * A stripe of an erasure coded object.
+ */
+struct JDistributedObjectStripe
+{
+	/**
+	 * The stripe's number.
+	 */
+	guint64 stripe;
+
+	/**
+	 * The stripe's blocks, NULL if the data blocks are taken from a write.
+	 */
+	gchar* blocks;
+
+	/**
+	 * The stripe's data blocks.
+	 */
+	gchar const* data;
+
+	/**
+	 * The stripe's parity blocks.
+	 */
+	gchar* parity;
+
+	/**
+	 * Whether the stripe's blocks are available, NULL for writes.
+	 */
+	gboolean* present;
+
+	/**
+	 * The number of writes that modify the stripe.
+	 */
+	guint writers;
+
+	/**
+	 * The last write that modifies the stripe.
+	 */
+	JDistributedObjectOperation* writer;
+
+	/**
+	 * Whether the writes cover the whole stripe.
+	 */
+	gboolean covered;
+
+	/**
+	 * The number of bytes read into the stripe.
+	 */
+	guint64 bytes_read;
+};
+
+typedef struct JDistributedObjectStripe JDistributedObjectStripe;
+
+static
+JDistributedObjectStripe*
+j_distributed_object_stripe_new (guint64 stripe)
+{
+	JDistributedObjectStripe* object_stripe;
+
+	object_stripe = g_slice_new(JDistributedObjectStripe);
+	object_stripe->stripe = stripe;
+	object_stripe->blocks = NULL;
+	object_stripe->data = NULL;
+	object_stripe->parity = NULL;
+	object_stripe->present = NULL;
+	object_stripe->writers = 0;
+	object_stripe->writer = NULL;
+	object_stripe->covered = FALSE;
+	object_stripe->bytes_read = 0;
+
+	return object_stripe;
+}
+
+static
+void
+j_distributed_object_stripe_free (gpointer data)
+{
+	JDistributedObjectStripe* object_stripe = data;
+
+	g_free(object_stripe->blocks);
+	g_free(object_stripe->parity);
+	g_free(object_stripe->present);
+
+	g_slice_free(JDistributedObjectStripe, object_stripe);
+}
+
+static
+void
+j_distributed_object_read_buffer_free (gpointer data)
+{
+	g_slice_free(JDistributedObjectReadBuffer, data);
+}
+
+/**
+ * Creates a message for reads or writes of an object on a server.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param object    An object.
+ * \param type      J_MESSAGE_OBJECT_READ, J_MESSAGE_OBJECT_WRITE or J_MESSAGE_OBJECT_PREFETCH.
+ * \param index     A server index.
+ * \param semantics Semantics.
+ *
+ * \return A new message.
+ **/
+static
+JMessage*
+j_distributed_object_message_new (JDistributedObject* object, JMessageType type, guint32 index, JSemantics* semantics)
+{
+	JMessage* message;
+	gsize name_len;
+	gsize namespace_len;
+
+	namespace_len = strlen(object->namespace) + 1;
+	name_len = strlen(object->name) + 1;
+
+	message = j_message_new(type, namespace_len + name_len);
+	j_message_set_compact(message, j_connection_pool_get_compact_object(index));
+	j_message_set_safety(message, semantics);
+	j_message_append_n(message, object->namespace, namespace_len);
+	j_message_append_n(message, object->name, name_len);
+
+	return message;
+}
+
+/**
+ * Creates a lock for the ranges of reads or writes if the semantics require atomicity.
+ * Writes to erasure coded objects modify whole stripes, so their ranges are extended to the stripe boundaries.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object     An object.
+ * \param operations A list of reads or writes.
+ * \param semantics  A semantics object.
+ * \param mode       J_LOCK_MODE_SHARED for reads, J_LOCK_MODE_EXCLUSIVE for writes.
+ *
+ * \return A lock that has not been acquired yet, NULL if no lock is required.
+ **/
+static
+JLock*
+j_distributed_object_lock (JDistributedObject* object, JList* operations, JSemantics* semantics, JLockMode mode)
+{
+	JLock* lock;
+	g_autoptr(JListIterator) it = NULL;
+	guint64 block_size;
+	guint64 stripe_size = 0;
+	guint data_count;
+	guint parity_count;
+
+	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) == J_SEMANTICS_ATOMICITY_NONE)
+	{
+		return NULL;
+	}
+
+	if (mode == J_LOCK_MODE_EXCLUSIVE && j_distribution_get_stripe(object->distribution, &data_count, &parity_count, &block_size) && parity_count > 0)
+	{
+		stripe_size = data_count * block_size;
+	}
+
+	lock = j_lock_new_for_mode(object->namespace, object->name, mode);
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		guint64 length;
+		guint64 offset;
+
+		if (mode == J_LOCK_MODE_EXCLUSIVE)
+		{
+			length = operation->write.length;
+			offset = operation->write.offset;
+		}
+		else
+		{
+			length = operation->read.length;
+			offset = operation->read.offset;
+		}
+
+		if (stripe_size > 0)
+		{
+			guint64 end;
+
+			end = ((offset + length + stripe_size - 1) / stripe_size) * stripe_size;
+			offset = (offset / stripe_size) * stripe_size;
+			length = end - offset;
+		}
+
+		j_lock_add_range(lock, offset, length);
+	}
+
+	return lock;
+}
+
+/**
+ * Reconstructs the read buffers whose servers failed from the remaining data and parity blocks.
+ * For every affected stripe, as many blocks as there are data blocks are read from the servers that did not fail.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param object    An erasure coded object.
+ * \param buffers   The buffers that could not be filled.
+ * \param semantics Semantics.
+ *
+ * \return TRUE if all buffers could be reconstructed, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_read_degraded (JDistributedObject* object, JList* buffers, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JErasure* erasure;
+	g_autoptr(GHashTable) stripes = NULL;
+	g_autoptr(JList) failed = NULL;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	g_autofree JList** br_lists = NULL;
+	g_autofree gboolean* failed_servers = NULL;
+	g_autofree gpointer* background_data = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	guint64 block_size;
+	guint data_count;
+	guint parity_count;
+	guint chunk_count;
+	guint32 server_count;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (!j_distribution_get_stripe(object->distribution, &data_count, &parity_count, &block_size))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	chunk_count = data_count + parity_count;
+	server_count = j_configuration_get_object_server_count(j_configuration());
+
+	stripes = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, j_distributed_object_stripe_free);
+	failed_servers = g_new0(gboolean, server_count);
+	messages = g_new0(JMessage*, server_count);
+	br_lists = g_new0(JList*, server_count);
+
+	it = j_list_iterator_new(buffers);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
+		guint64 block;
+		guint64 stripe;
+		guint32 index;
+		guint64 offset;
+
+		block = buffer->offset / block_size;
+		stripe = block / data_count;
+
+		j_distribution_get_chunk(object->distribution, stripe, block % data_count, &index, &offset);
+		failed_servers[index] = TRUE;
+
+		if (g_hash_table_lookup(stripes, &stripe) == NULL)
+		{
+			JDistributedObjectStripe* object_stripe;
+
+			object_stripe = j_distributed_object_stripe_new(stripe);
+			object_stripe->blocks = g_malloc0(chunk_count * block_size);
+			object_stripe->present = g_new0(gboolean, chunk_count);
+
+			g_hash_table_insert(stripes, &(object_stripe->stripe), object_stripe);
+		}
+	}
+
+	g_hash_table_iter_init(&iter, stripes);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JDistributedObjectStripe* object_stripe = value;
+		guint selected = 0;
+
+		/* Prefer data blocks, they do not have to be reconstructed. */
+		for (guint i = 0; i < chunk_count && selected < data_count; i++)
+		{
+			JDistributedObjectReadBuffer* buffer;
+			guint32 index;
+			guint64 offset;
+
+			j_distribution_get_chunk(object->distribution, object_stripe->stripe, i, &index, &offset);
+
+			if (failed_servers[index])
+			{
+				continue;
+			}
+
+			if (messages[index] == NULL)
+			{
+				messages[index] = j_distributed_object_message_new(object, J_MESSAGE_OBJECT_READ, index, semantics);
+				br_lists[index] = j_list_new(NULL);
+			}
+
+			j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
+			j_message_append_varint(messages[index], block_size);
+			j_message_append_varint(messages[index], offset);
+
+			buffer = g_slice_new(JDistributedObjectReadBuffer);
+			buffer->data = object_stripe->blocks + (i * block_size);
+			buffer->bytes_read = &(object_stripe->bytes_read);
+			buffer->offset = object_stripe->stripe * data_count * block_size;
+			buffer->length = block_size;
+
+			j_list_append(br_lists[index], buffer);
+
+			object_stripe->present[i] = TRUE;
+			selected++;
+		}
+	}
+
+	background_data = g_new(gpointer, server_count);
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data;
+
+		if (messages[i] == NULL)
+		{
+			background_data[i] = NULL;
+			continue;
+		}
+
+		data = g_slice_new(JDistributedObjectBackgroundData);
+		data->index = i;
+		data->message = messages[i];
+		data->operations = NULL;
+		data->regions = NULL;
+		data->read.buffers = br_lists[i];
+
+		background_data[i] = data;
+	}
+
+	failed = j_list_new(NULL);
+	j_distributed_object_exchange(background_data, server_count, TRUE, failed, NULL);
+
+	/* Blocks that could not be read either are missing. */
+	j_list_iterator_free(it);
+	it = j_list_iterator_new(failed);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
+		JDistributedObjectStripe* object_stripe;
+		guint64 stripe;
+
+		stripe = buffer->offset / (data_count * block_size);
+		object_stripe = g_hash_table_lookup(stripes, &stripe);
+		object_stripe->present[(buffer->data - object_stripe->blocks) / block_size] = FALSE;
+
+		g_slice_free(JDistributedObjectReadBuffer, buffer);
+	}
+
+	erasure = j_erasure_new(data_count, parity_count);
+
+	g_hash_table_iter_init(&iter, stripes);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JDistributedObjectStripe* object_stripe = value;
+		g_autofree gpointer* blocks = NULL;
+
+		blocks = g_new(gpointer, chunk_count);
+
+		for (guint i = 0; i < chunk_count; i++)
+		{
+			blocks[i] = object_stripe->blocks + (i * block_size);
+		}
+
+		if (!j_erasure_decode(erasure, blocks, object_stripe->present, block_size))
+		{
+			g_hash_table_iter_remove(&iter);
+			ret = FALSE;
+		}
+	}
+
+	j_erasure_free(erasure);
+
+	j_list_iterator_free(it);
+	it = j_list_iterator_new(buffers);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectReadBuffer* buffer = j_list_iterator_get(it);
+		JDistributedObjectStripe* object_stripe;
+		guint64 block;
+		guint64 stripe;
+
+		block = buffer->offset / block_size;
+		stripe = block / data_count;
+		object_stripe = g_hash_table_lookup(stripes, &stripe);
+
+		if (object_stripe != NULL)
+		{
+			memcpy(buffer->data, object_stripe->blocks + ((block % data_count) * block_size) + (buffer->offset % block_size), buffer->length);
+			j_helper_atomic_add(buffer->bytes_read, buffer->length);
+		}
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_distributed_object_read_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = FALSE;
+
+	JBackend* object_backend;
+	g_autofree GPtrArray** parts = NULL;
+	g_autofree guint64* loads = NULL;
+	g_autoptr(JList) expanded = NULL;
+	g_autoptr(JListIterator) it = NULL;
+	JList* failed = NULL;
+	guint64 block_size;
+	guint data_count;
+	guint parity_count;
+	JDistributedObject* object = NULL;
+	gpointer object_handle;
+	guint64 message_size = 0;
+	guint32 server_count = 0;
+
+	JLock* lock;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectOperation* operation = j_list_get_first(operations);
+		g_assert(operation != NULL);
+
+		object = operation->status.object;
+		g_assert(object != NULL);
+	}
+
+	expanded = j_distributed_object_expand(operations);
+
+	/* Reads served by the readahead do not have to be sent to the servers. */
+	if (object->readahead != NULL && j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) != J_SEMANTICS_CONSISTENCY_IMMEDIATE)
+	{
+		JList* remaining;
+
+		remaining = j_list_new(NULL);
+		it = j_list_iterator_new(expanded);
+
+		while (j_list_iterator_next(it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(it);
+
+			if (!j_readahead_read(object->readahead, operation->read.data, operation->read.length, operation->read.offset, operation->read.bytes_read))
+			{
+				j_list_append(remaining, operation);
+			}
+		}
+
+		j_list_iterator_free(it);
+		j_list_unref(expanded);
+
+		it = NULL;
+		expanded = remaining;
+
+		if (j_list_length(expanded) == 0)
+		{
+			j_trace_leave(G_STRFUNC);
+
+			return TRUE;
+		}
+	}
+
+	lock = j_distributed_object_lock(object, expanded, semantics, J_LOCK_MODE_SHARED);
+
+	if (lock != NULL)
+	{
+		ret = j_lock_acquire(lock) && ret;
+	}
+
+	it = j_list_iterator_new(expanded);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+	}
+	else
+	{
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		message_size = j_configuration_get_message_size(j_configuration());
+		parts = g_new0(GPtrArray*, server_count);
+		loads = g_new0(guint64, server_count);
+
+		/* Erasure coded objects can reconstruct the data of failed servers. */
+		if (j_distribution_get_stripe(object->distribution, &data_count, &parity_count, &block_size) && parity_count > 0)
+		{
+			failed = j_list_new(j_distributed_object_read_buffer_free);
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		gpointer data = operation->read.data;
+		guint64 length = operation->read.length;
+		guint64 offset = operation->read.offset;
+		guint64* bytes_read = operation->read.bytes_read;
+
+		j_trace_file_begin(object->name, J_TRACE_FILE_READ);
+
+		if (object_backend != NULL)
+		{
+			guint64 nbytes = 0;
+
+			ret = j_backend_object_read(object_backend, object_handle, data, length, offset, &nbytes) && ret;
+			j_helper_atomic_add(bytes_read, nbytes);
+		}
+		else
+		{
+			JDistributionExtent extents[J_DISTRIBUTED_OBJECT_EXTENTS];
+			gchar* new_data;
+			guint count;
+			guint replicas;
+
+			j_distribution_reset(object->distribution, length, offset);
+			new_data = data;
+			replicas = j_distribution_get_replica_count(object->distribution);
+
+			while ((count = j_distribution_distribute_extents(object->distribution, extents, G_N_ELEMENTS(extents))) > 0)
+			{
+				for (guint i = 0; i < count; i++)
+				{
+					JDistributedObjectBackgroundData* part;
+					JDistributedObjectReadBuffer* buffer;
+					guint32 index = extents[i].index;
+					guint64 new_length = extents[i].length;
+					guint64 new_offset = extents[i].offset;
+
+					/*
+					 * Read each extent from the copy whose server has the least data to send so far.
+					 * Large reads are thereby split across all copies.
+					 * Starting with different copies breaks ties between blocks.
+					 */
+					for (guint j = 0; j < replicas; j++)
+					{
+						guint32 replica_index;
+						guint64 replica_offset;
+
+						j_distribution_get_replica(object->distribution, &(extents[i]), (extents[i].block_id + j) % replicas, &replica_index, &replica_offset);
+
+						if (j == 0 || loads[replica_index] < loads[index])
+						{
+							index = replica_index;
+							new_offset = replica_offset;
+						}
+					}
+
+					loads[index] += new_length;
+
+					/* Large shares are split into several messages, so that they can be read over multiple connections in parallel. */
+					if ((part = j_distributed_object_part_get(parts[index], message_size)) == NULL)
+					{
+						JMessage* message;
+
+						message = j_distributed_object_message_new(object, J_MESSAGE_OBJECT_READ, index, semantics);
+						j_message_set_access(message, semantics);
+
+						part = j_distributed_object_part_new(&(parts[index]), index, message, TRUE);
+					}
+
+					j_distributed_object_part_add(part, new_length, new_offset);
+
+					buffer = g_slice_new(JDistributedObjectReadBuffer);
+					buffer->data = new_data;
+					buffer->bytes_read = bytes_read;
+					buffer->offset = offset + (new_data - (gchar*)data);
+					buffer->length = new_length;
+
+					j_list_append(part->read.buffers, buffer);
+
+					new_data += new_length;
+				}
+			}
+		}
+
+		j_trace_file_end(object->name, J_TRACE_FILE_READ, length, offset);
+	}
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		JDistributedObjectHedging hedging;
+
+		hedging.object = object;
+		hedging.semantics = semantics;
+		hedging.delay = j_distributed_object_hedge_delay();
+
+		/* Erasure coded objects reconstruct the data of slow servers only if they fail. */
+		j_distributed_object_exchange_parts(parts, server_count, TRUE, failed, (failed == NULL && j_distribution_get_replica_count(object->distribution) > 1 && j_configuration_get_hedge_percentile(j_configuration()) > 0) ? &hedging : NULL);
+
+		if (failed != NULL)
+		{
+			if (j_list_length(failed) > 0)
+			{
+				j_distributed_object_read_degraded(object, failed, semantics);
+			}
+
+			j_list_unref(failed);
+		}
+	}
+
+	if (lock != NULL)
+	{
+		/* Freeing the lock releases it. */
+		j_lock_free(lock);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Reads data for the readahead.
+ * The read is executed directly instead of using a batch, so it does not hold a reference to the object.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data       An object.
+ * \param buffer     A buffer to hold the read data.
+ * \param length     Number of bytes to read.
+ * \param offset     An offset within the object.
+ * \param bytes_read Number of bytes read.
+ **/
+static
+void
+j_distributed_object_readahead_fetch (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JDistributedObject* object = data;
+	JDistributedObjectOperation operation;
+	g_autoptr(JList) operations = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	operation.read.object = object;
+	operation.read.data = buffer;
+	operation.read.length = length;
+	operation.read.offset = offset;
+	operation.read.bytes_read = bytes_read;
+	operation.segments = NULL;
+	operation.segment_count = 0;
+
+	operations = j_list_new(NULL);
+	j_list_append(operations, &operation);
+
+	/* Immediate consistency bypasses the readahead, so the read is not served by the readahead itself. */
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_semantics_set(semantics, J_SEMANTICS_CONSISTENCY, J_SEMANTICS_CONSISTENCY_IMMEDIATE);
+
+	j_distributed_object_read_exec(operations, semantics);
+}
+
+/**
+ * What the chunks of device reads and writes are transferred with.
+ */
+struct JDistributedObjectDevice
+{
+	JDistributedObject* object;
+	JSemantics* semantics;
+};
+
+typedef struct JDistributedObjectDevice JDistributedObjectDevice;
+
+/**
+ * Reads a chunk of a device read into a bounce buffer.
+ *
+ * \private
+ **/
+static
+void
+j_distributed_object_device_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JDistributedObjectDevice* device = data;
+	JDistributedObjectOperation operation;
+	g_autoptr(JList) operations = NULL;
+
+	operation.read.object = device->object;
+	operation.read.data = buffer;
+	operation.read.length = length;
+	operation.read.offset = offset;
+	operation.read.bytes_read = bytes_read;
+	operation.segments = NULL;
+	operation.segment_count = 0;
+
+	operations = j_list_new(NULL);
+	j_list_append(operations, &operation);
+
+	j_distributed_object_read_exec(operations, device->semantics);
+}
+
+/**
+ * Executes reads into device memory.
+ *
+ * \private
+ **/
+static
+gboolean
+j_distributed_object_read_device_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributedObjectDevice device;
+
+		device.object = operation->read.object;
+		device.semantics = semantics;
+
+		ret = j_device_read(operation->read.data, operation->read.length, operation->read.offset, operation->read.bytes_read, j_distributed_object_device_read, &device) && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * A range of an object.
+ */
+struct JDistributedObjectRange
+{
+	guint64 offset;
+	guint64 end;
+};
+
+typedef struct JDistributedObjectRange JDistributedObjectRange;
+
+static
+gint
+j_distributed_object_range_compare (gconstpointer a, gconstpointer b)
+{
+	JDistributedObjectRange const* range_a = a;
+	JDistributedObjectRange const* range_b = b;
+
+	if (range_a->offset < range_b->offset)
+	{
+		return -1;
+	}
+	else if (range_a->offset > range_b->offset)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Checks whether any of the operations overlap.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param operations A list of writes.
+ *
+ * \return TRUE if at least two operations overlap, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_overlapping (JList* operations)
+{
+	g_autoptr(GArray) ranges = NULL;
+	g_autoptr(JListIterator) it = NULL;
+	guint64 end = 0;
+
+	ranges = g_array_new(FALSE, FALSE, sizeof(JDistributedObjectRange));
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributedObjectRange range;
+
+		range.offset = operation->write.offset;
+		range.end = operation->write.offset + operation->write.length;
+
+		g_array_append_val(ranges, range);
+	}
+
+	g_array_sort(ranges, j_distributed_object_range_compare);
+
+	for (guint i = 0; i < ranges->len; i++)
+	{
+		JDistributedObjectRange* range = &g_array_index(ranges, JDistributedObjectRange, i);
+
+		if (i > 0 && range->offset < end)
+		{
+			return TRUE;
+		}
+
+		end = MAX(end, range->end);
+	}
+
+	return FALSE;
+}
+
+/**
+ * Computes the parity blocks of all stripes modified by a batch of writes.
+ * Writes are combined first, so stripes that are covered by several writes do not have to be read.
+ * Stripes that are only partially covered are read and merged with the new data.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param object       An erasure coded object.
+ * \param operations   The write operations.
+ * \param semantics    Semantics.
+ * \param data_count   The number of data blocks per stripe.
+ * \param parity_count The number of parity blocks per stripe.
+ * \param block_size   The block size.
+ *
+ * \return The modified stripes. Should be freed with g_hash_table_unref().
+ **/
+static
+GHashTable*
+j_distributed_object_write_stripes (JDistributedObject* object, JList* operations, JSemantics* semantics, guint data_count, guint parity_count, guint64 block_size)
+{
+	GHashTable* stripes;
+	JErasure* erasure;
+	g_autoptr(GArray) ranges = NULL;
+	g_autoptr(JList) reads = NULL;
+	g_autoptr(JListIterator) it = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	guint64 stripe_size;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	stripe_size = data_count * block_size;
+
+	stripes = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, j_distributed_object_stripe_free);
+	ranges = g_array_new(FALSE, FALSE, sizeof(JDistributedObjectRange));
+	reads = j_list_new(j_distributed_object_read_free);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributedObjectRange range;
+
+		if (operation->write.length == 0)
+		{
+			continue;
+		}
+
+		range.offset = operation->write.offset;
+		range.end = operation->write.offset + operation->write.length;
+		g_array_append_val(ranges, range);
+
+		for (guint64 stripe = range.offset / stripe_size; stripe <= (range.end - 1) / stripe_size; stripe++)
+		{
+			JDistributedObjectStripe* object_stripe;
+
+			object_stripe = g_hash_table_lookup(stripes, &stripe);
+
+			if (object_stripe == NULL)
+			{
+				object_stripe = j_distributed_object_stripe_new(stripe);
+				g_hash_table_insert(stripes, &(object_stripe->stripe), object_stripe);
+			}
+
+			object_stripe->writers++;
+			object_stripe->writer = operation;
+		}
+	}
+
+	/* Merge adjacent and overlapping writes to find the stripes they cover completely. */
+	g_array_sort(ranges, j_distributed_object_range_compare);
+
+	for (guint i = 0; i < ranges->len;)
+	{
+		JDistributedObjectRange run = g_array_index(ranges, JDistributedObjectRange, i);
+
+		for (i++; i < ranges->len && g_array_index(ranges, JDistributedObjectRange, i).offset <= run.end; i++)
+		{
+			run.end = MAX(run.end, g_array_index(ranges, JDistributedObjectRange, i).end);
+		}
+
+		for (guint64 stripe = (run.offset + stripe_size - 1) / stripe_size; stripe < run.end / stripe_size; stripe++)
+		{
+			JDistributedObjectStripe* object_stripe;
+
+			object_stripe = g_hash_table_lookup(stripes, &stripe);
+			object_stripe->covered = TRUE;
+		}
+	}
+
+	g_hash_table_iter_init(&iter, stripes);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JDistributedObjectStripe* object_stripe = value;
+		JDistributedObjectOperation* writer = object_stripe->writer;
+		guint64 offset;
+
+		offset = object_stripe->stripe * stripe_size;
+
+		/* A stripe written completely by a single write is encoded from the write's data directly. */
+		if (object_stripe->writers == 1 && writer->write.offset <= offset && writer->write.offset + writer->write.length >= offset + stripe_size)
+		{
+			object_stripe->data = (gchar const*)writer->write.data + (offset - writer->write.offset);
+			continue;
+		}
+
+		object_stripe->blocks = g_malloc0(stripe_size);
+		object_stripe->data = object_stripe->blocks;
+
+		if (!object_stripe->covered)
+		{
+			JDistributedObjectOperation* read;
+
+			read = g_slice_new(JDistributedObjectOperation);
+			read->read.object = j_distributed_object_ref(object);
+			read->read.data = object_stripe->blocks;
+			read->read.length = stripe_size;
+			read->read.offset = offset;
+			read->read.bytes_read = &(object_stripe->bytes_read);
+			read->segments = NULL;
+			read->segment_count = 0;
+
+			j_list_append(reads, read);
+		}
+	}
+
+	if (j_list_length(reads) > 0)
+	{
+		g_autoptr(JSemantics) read_semantics = NULL;
+
+		/* The stripes are already covered by the write's exclusive lock, so the reads must not lock again. */
+		read_semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+		for (JSemanticsType type = J_SEMANTICS_ATOMICITY; type <= J_SEMANTICS_ACCESS; type++)
+		{
+			j_semantics_set(read_semantics, type, j_semantics_get(semantics, type));
+		}
+
+		j_semantics_set(read_semantics, J_SEMANTICS_ATOMICITY, J_SEMANTICS_ATOMICITY_NONE);
+
+		j_distributed_object_read_exec(reads, read_semantics);
+	}
+
+	/* Apply the writes in order, so later writes overwrite earlier ones. */
+	j_list_iterator_free(it);
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		guint64 end;
+
+		if (operation->write.length == 0)
+		{
+			continue;
+		}
+
+		end = operation->write.offset + operation->write.length;
+
+		for (guint64 stripe = operation->write.offset / stripe_size; stripe <= (end - 1) / stripe_size; stripe++)
+		{
+			JDistributedObjectStripe* object_stripe;
+			guint64 from;
+			guint64 to;
+
+			object_stripe = g_hash_table_lookup(stripes, &stripe);
+
+			if (object_stripe->blocks == NULL)
+			{
+				continue;
+			}
+
+			from = MAX(operation->write.offset, stripe * stripe_size);
+			to = MIN(end, (stripe + 1) * stripe_size);
+
+			memcpy(object_stripe->blocks + (from - (stripe * stripe_size)), (gchar const*)operation->write.data + (from - operation->write.offset), to - from);
+		}
+	}
+
+	erasure = j_erasure_new(data_count, parity_count);
+
+	g_hash_table_iter_init(&iter, stripes);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JDistributedObjectStripe* object_stripe = value;
+		g_autofree gconstpointer* data = NULL;
+		g_autofree gpointer* parity = NULL;
+
+		data = g_new(gconstpointer, data_count);
+		parity = g_new(gpointer, parity_count);
+		object_stripe->parity = g_malloc(parity_count * block_size);
+
+		for (guint i = 0; i < data_count; i++)
+		{
+			data[i] = object_stripe->data + (i * block_size);
+		}
+
+		for (guint i = 0; i < parity_count; i++)
+		{
+			parity[i] = object_stripe->parity + (i * block_size);
+		}
+
+		j_erasure_encode(erasure, data, parity, block_size);
+	}
+
+	j_erasure_free(erasure);
+
+	j_trace_leave(G_STRFUNC);
+
+	return stripes;
+}
+
+/**
+ * Asks the servers which blocks of a batch of writes they can copy from data they already store.
+ * Only whole blocks are considered, their digests are sent to each server in a single message.
+ * Has to iterate over the writes exactly like j_distributed_object_write_exec().
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param object       An object.
+ * \param operations   The write operations.
+ * \param semantics    Semantics.
+ * \param server_count The number of servers.
+ *
+ * \return The number of bytes each server has written per block and copy, NULL for data that has to be sent. Should be freed with j_list_unref().
+ **/
+static
+JList*
+j_distributed_object_write_dedup (JDistributedObject* object, JList* operations, JSemantics* semantics, guint32 server_count)
+{
+	JList* results;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	g_autofree JList** bw_lists = NULL;
+	g_autofree gpointer* background_data = NULL;
+	guint64 block_size;
+	gboolean candidates = FALSE;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	results = j_list_new(g_free);
+	messages = g_new0(JMessage*, server_count);
+	bw_lists = g_new0(JList*, server_count);
+	block_size = j_distribution_get_block_size(object->distribution);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributionExtent extents[J_DISTRIBUTED_OBJECT_EXTENTS];
+		gchar const* new_data;
+		guint count;
+		guint replicas;
+
+		j_distribution_reset(object->distribution, operation->write.length, operation->write.offset);
+		new_data = operation->write.data;
+		replicas = j_distribution_get_replica_count(object->distribution);
+
+		while ((count = j_distribution_distribute_extents(object->distribution, extents, G_N_ELEMENTS(extents))) > 0)
+		{
+			for (guint i = 0; i < count; i++)
+			{
+				guint64 new_length = extents[i].length;
+				guint8 digest[J_HELPER_SHA256_SIZE];
+				gboolean hashed = FALSE;
+
+				for (guint j = 0; j < replicas; j++)
+				{
+					guint32 index;
+					guint64 new_offset;
+					guint64* result;
+
+					j_distribution_get_replica(object->distribution, &(extents[i]), j, &index, &new_offset);
+
+					if (new_length != block_size || !j_connection_pool_get_dedup_object(index))
+					{
+						j_list_append(results, NULL);
+						continue;
+					}
+
+					if (!hashed)
+					{
+						j_helper_sha256(new_data, new_length, digest);
+						hashed = TRUE;
+					}
+
+					if (messages[index] == NULL)
+					{
+						messages[index] = j_distributed_object_message_new(object, J_MESSAGE_OBJECT_DEDUP, index, semantics);
+						j_message_set_create(messages[index], TRUE);
+						bw_lists[index] = j_list_new(NULL);
+					}
+
+					j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64) + J_HELPER_SHA256_SIZE);
+					j_message_append_varint(messages[index], new_length);
+					j_message_append_varint(messages[index], new_offset);
+					j_message_append_n(messages[index], digest, J_HELPER_SHA256_SIZE);
+
+					result = g_new0(guint64, 1);
+					j_list_append(results, result);
+					j_list_append(bw_lists[index], result);
+
+					candidates = TRUE;
+				}
+
+				new_data += new_length;
+			}
+		}
+	}
+
+	if (!candidates)
+	{
+		j_list_unref(results);
+		results = NULL;
+		goto end;
+	}
+
+	background_data = g_new(gpointer, server_count);
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		JDistributedObjectBackgroundData* data;
+
+		if (messages[i] == NULL)
+		{
+			background_data[i] = NULL;
+			continue;
+		}
+
+		data = g_slice_new(JDistributedObjectBackgroundData);
+		data->index = i;
+		data->message = messages[i];
+		data->operations = NULL;
+		data->regions = NULL;
+		data->write.bytes_written = bw_lists[i];
+		data->write.payloads = NULL;
+
+		background_data[i] = data;
+	}
+
+	/* The servers' replies add the number of copied bytes to the results. */
+	j_distributed_object_exchange(background_data, server_count, FALSE, NULL, NULL);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return results;
+}
+
+static
+gboolean
+j_distributed_object_write_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = FALSE;
+
+	JBackend* object_backend;
+	g_autofree GPtrArray** parts = NULL;
+	g_autoptr(JList) expanded = NULL;
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(GHashTable) stripes = NULL;
+	g_autoptr(JList) dedup = NULL;
+	g_autoptr(JListIterator) dedup_it = NULL;
+	JDistributedObject* object = NULL;
+	gpointer object_handle;
+	guint64 message_size = 0;
+	guint32 server_count = 0;
+	guint64 block_size;
+	guint data_count;
+	guint parity_count;
+
+	JLock* lock;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectOperation* operation = j_list_get_first(operations);
+		g_assert(operation != NULL);
+
+		object = operation->status.object;
+		g_assert(object != NULL);
+	}
+
+	expanded = j_distributed_object_expand(operations);
+
+	lock = j_distributed_object_lock(object, expanded, semantics, J_LOCK_MODE_EXCLUSIVE);
+
+	if (lock != NULL)
+	{
+		ret = j_lock_acquire(lock) && ret;
+	}
+
+	it = j_list_iterator_new(expanded);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+	}
+	else
+	{
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		parts = g_new0(GPtrArray*, server_count);
+
+		/* The parts of a share are written in no particular order, so overlapping writes have to stay in one message. */
+		if (!j_distributed_object_overlapping(expanded))
+		{
+			message_size = j_configuration_get_message_size(j_configuration());
+		}
+
+		/* The parity has to be computed before the data is modified, because partially written stripes have to be read. */
+		if (j_distribution_get_stripe(object->distribution, &data_count, &parity_count, &block_size) && parity_count > 0)
+		{
+			stripes = j_distributed_object_write_stripes(object, expanded, semantics, data_count, parity_count, block_size);
+		}
+
+		/* Deduplicated blocks are acknowledged by the servers' replies, which are only sent with network safety. */
+		if (j_configuration_get_dedup(j_configuration()) && j_semantics_get(semantics, J_SEMANTICS_SAFETY) != J_SEMANTICS_SAFETY_NONE)
+		{
+			if ((dedup = j_distributed_object_write_dedup(object, expanded, semantics, server_count)) != NULL)
+			{
+				dedup_it = j_list_iterator_new(dedup);
+			}
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		gconstpointer data = operation->write.data;
+		guint64 length = operation->write.length;
+		guint64 offset = operation->write.offset;
+		guint64* bytes_written = operation->write.bytes_written;
+
+		j_trace_file_begin(object->name, J_TRACE_FILE_WRITE);
+
+		if (object_backend != NULL)
+		{
+			guint64 nbytes = 0;
+
+			ret = j_backend_object_write(object_backend, object_handle, data, length, offset, &nbytes) && ret;
+			j_helper_atomic_add(bytes_written, nbytes);
+		}
+		else
+		{
+			JDistributionExtent extents[J_DISTRIBUTED_OBJECT_EXTENTS];
+			gchar const* new_data;
+			guint count;
+			guint replicas;
+
+			j_distribution_reset(object->distribution, length, offset);
+			new_data = data;
+			replicas = j_distribution_get_replica_count(object->distribution);
+
+			while ((count = j_distribution_distribute_extents(object->distribution, extents, G_N_ELEMENTS(extents))) > 0)
+			{
+				for (guint i = 0; i < count; i++)
+				{
+					guint64 new_length = extents[i].length;
+
+					/* All copies are sent at once, so the servers write them in parallel. */
+					for (guint j = 0; j < replicas; j++)
+					{
+						JDistributedObjectBackgroundData* part;
+						JDistributedObjectPayload payload;
+						guint32 index;
+						guint64 new_offset;
+
+						j_distribution_get_replica(object->distribution, &(extents[i]), j, &index, &new_offset);
+
+						if (dedup_it != NULL && j_list_iterator_next(dedup_it))
+						{
+							guint64* copied = j_list_iterator_get(dedup_it);
+
+							/* The server has already copied the block from data it stores. */
+							if (copied != NULL && *copied == new_length)
+							{
+								if (j == 0)
+								{
+									j_helper_atomic_add(bytes_written, new_length);
+								}
+
+								continue;
+							}
+						}
+
+						/* Large shares are split into several messages, so that they can be written over multiple connections in parallel. */
+						if ((part = j_distributed_object_part_get(parts[index], message_size)) == NULL)
+						{
+							JMessage* message;
+
+							message = j_distributed_object_message_new(object, J_MESSAGE_OBJECT_WRITE, index, semantics);
+							j_message_set_create(message, TRUE);
+
+							part = j_distributed_object_part_new(&(parts[index]), index, message, FALSE);
+						}
+
+						payload.data = new_data;
+						payload.length = new_length;
+
+						j_distributed_object_part_add(part, new_length, new_offset);
+						g_array_append_val(part->write.payloads, payload);
+
+						/* Only the primary copy counts towards the bytes written. */
+						j_list_append(part->write.bytes_written, (j == 0) ? bytes_written : NULL);
+					}
+
+					new_data += new_length;
+
+					if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+					{
+						j_helper_atomic_add(bytes_written, new_length);
+					}
+				}
+			}
+		}
+
+		j_trace_file_end(object->name, J_TRACE_FILE_WRITE, length, offset);
+	}
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		if (stripes != NULL)
+		{
+			GHashTableIter iter;
+			gpointer value;
+
+			g_hash_table_iter_init(&iter, stripes);
+
+			while (g_hash_table_iter_next(&iter, NULL, &value))
+			{
+				JDistributedObjectStripe* object_stripe = value;
+
+				for (guint i = 0; i < parity_count; i++)
+				{
+					JDistributedObjectBackgroundData* part;
+					JDistributedObjectPayload payload;
+					guint32 index;
+					guint64 new_offset;
+
+					j_distribution_get_chunk(object->distribution, object_stripe->stripe, data_count + i, &index, &new_offset);
+
+					if ((part = j_distributed_object_part_get(parts[index], message_size)) == NULL)
+					{
+						JMessage* message;
+
+						message = j_distributed_object_message_new(object, J_MESSAGE_OBJECT_WRITE, index, semantics);
+						j_message_set_create(message, TRUE);
+
+						part = j_distributed_object_part_new(&(parts[index]), index, message, FALSE);
+					}
+
+					payload.data = object_stripe->parity + (i * block_size);
+					payload.length = block_size;
+
+					j_distributed_object_part_add(part, block_size, new_offset);
+					g_array_append_val(part->write.payloads, payload);
+
+					/* Parity does not count towards the bytes written. */
+					j_list_append(part->write.bytes_written, NULL);
+				}
+			}
+		}
+
+		j_distributed_object_exchange_parts(parts, server_count, FALSE, NULL, NULL);
+	}
+
+	if (lock != NULL)
+	{
+		/* Freeing the lock releases it. */
+		j_lock_free(lock);
+	}
+
+	/* Prefetched data may predate the writes. */
+	if (object->readahead != NULL)
+	{
+		j_readahead_invalidate(object->readahead);
+	}
+
+	j_distributed_object_status_invalidate(object);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Writes a chunk of a device write from a bounce buffer.
+ *
+ * \private
+ **/
+static
+void
+j_distributed_object_device_write (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JDistributedObjectDevice* device = data;
+	JDistributedObjectOperation operation;
+	g_autoptr(JList) operations = NULL;
+
+	operation.write.object = device->object;
+	operation.write.data = buffer;
+	operation.write.length = length;
+	operation.write.offset = offset;
+	operation.write.bytes_written = bytes_written;
+	operation.segments = NULL;
+	operation.segment_count = 0;
+
+	operations = j_list_new(NULL);
+	j_list_append(operations, &operation);
+
+	/* The write has been sent once this returns, so the bounce buffer can be reused afterwards. */
+	j_distributed_object_write_exec(operations, device->semantics);
+}
+
+/**
+ * Executes writes from device memory.
+ *
+ * \private
+ **/
+static
+gboolean
+j_distributed_object_write_device_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributedObjectDevice device;
+
+		device.object = operation->write.object;
+		device.semantics = semantics;
+
+		ret = j_device_write(operation->write.data, operation->write.length, operation->write.offset, operation->write.bytes_written, j_distributed_object_device_write, &device) && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Appends data to an object.
+ * The space is reserved by extending the object tracking the appends, then the data is written like with j_distributed_object_write().
+ * The tracking object's server serializes the reservations, so concurrent appends never overlap.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of append operations, all for the same object.
+ * \param semantics  A semantics object.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_append_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(JList) writes = NULL;
+	g_autofree JDistributedObjectOperation* write_operations = NULL;
+	g_autofree gchar* append_path = NULL;
+	JDistributedObject* object;
+	guint i;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->append.object;
+		g_assert(object != NULL);
+	}
+
+	append_path = g_strconcat(object->namespace, "/", object->name, NULL);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	it = j_list_iterator_new(operations);
+
+	if (object_backend != NULL)
+	{
+		/* Without a server, appends of this process are serialized locally. */
+		G_LOCK_DEFINE_STATIC(j_distributed_object_append);
+		gpointer append_handle;
+
+		G_LOCK(j_distributed_object_append);
+
+		if (j_backend_object_open(object_backend, J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE, append_path, &append_handle)
+		    || j_backend_object_create(object_backend, J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE, append_path, &append_handle))
+		{
+			while (j_list_iterator_next(it))
+			{
+				JDistributedObjectOperation* operation = j_list_iterator_get(it);
+				guint64 size = 0;
+
+				ret = j_backend_object_status(object_backend, append_handle, NULL, &size) && ret;
+				ret = object_backend->object.truncate != NULL && j_backend_object_truncate(object_backend, append_handle, size + operation->append.length) && ret;
+
+				*(operation->append.offset) = size;
+			}
+
+			ret = j_backend_object_close(object_backend, append_handle) && ret;
+		}
+		else
+		{
+			ret = FALSE;
+		}
+
+		G_UNLOCK(j_distributed_object_append);
+	}
+	else
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+		gsize namespace_len;
+		gsize append_path_len;
+		guint32 index;
+		gchar reserve = TRUE;
+
+		namespace_len = strlen(J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE) + 1;
+		append_path_len = strlen(append_path) + 1;
+		index = j_helper_hash(append_path) % j_configuration_get_object_server_count(j_configuration());
+
+		message = j_message_new(J_MESSAGE_OBJECT_APPEND, namespace_len + append_path_len + 1);
+		j_message_set_safety(message, semantics);
+		j_message_append_n(message, J_DISTRIBUTED_OBJECT_APPEND_NAMESPACE, namespace_len);
+		j_message_append_n(message, append_path, append_path_len);
+		j_message_append_1(message, &reserve);
+
+		while (j_list_iterator_next(it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(it);
+
+			j_message_add_operation(message, sizeof(guint64));
+			j_message_append_varint(message, operation->append.length);
+		}
+
+		reply = j_connection_pool_request_object_ordered(index, j_helper_hash(append_path), message, TRUE);
+		ret = (reply != NULL);
+
+		if (reply != NULL)
+		{
+			j_list_iterator_free(it);
+			it = j_list_iterator_new(operations);
+
+			while (j_list_iterator_next(it))
+			{
+				JDistributedObjectOperation* operation = j_list_iterator_get(it);
+				guint64 nbytes;
+
+				*(operation->append.offset) = j_message_get_varint(reply);
+				nbytes = j_message_get_varint(reply);
+
+				ret = (nbytes == operation->append.length) && ret;
+			}
+		}
+	}
+
+	if (!ret)
+	{
+		goto end;
+	}
+
+	/* The data is written to the reserved space, in parallel to other clients' appends. */
+	writes = j_list_new(NULL);
+	write_operations = g_new(JDistributedObjectOperation, j_list_length(operations));
+
+	j_list_iterator_free(it);
+	it = j_list_iterator_new(operations);
+	i = 0;
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributedObjectOperation* write = &(write_operations[i]);
+
+		j_distribution_adapt(object->distribution, *(operation->append.offset) + operation->append.length);
+
+		write->write.object = object;
+		write->write.data = operation->append.data;
+		write->write.length = operation->append.length;
+		write->write.offset = *(operation->append.offset);
+		write->write.bytes_written = &(write->cached_bytes_written);
+		write->segments = NULL;
+		write->segment_count = 0;
+		write->cached_bytes_written = 0;
+
+		j_list_append(writes, write);
+		i++;
+	}
+
+	j_distributed_object_write_exec(writes, semantics);
+
+	for (i = 0; i < j_list_length(writes); i++)
+	{
+		ret = (write_operations[i].cached_bytes_written == write_operations[i].write.length) && ret;
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Executes a reduction on one server.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
+static
+gpointer
+j_distributed_object_reduce_background_operation (gpointer data)
+{
+	JDistributedObjectBackgroundData* background_data = data;
+
+	background_data->reduce.reply = j_connection_pool_request_object(background_data->index, background_data->message, TRUE);
+
+	return NULL;
+}
+
+static
+gboolean
+j_distributed_object_reduce_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	JDistributedObject* object;
+	JLock* lock = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->reduce.object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+
+	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) != J_SEMANTICS_ATOMICITY_NONE)
+	{
+		lock = j_lock_new_for_mode(object->namespace, object->name, J_LOCK_MODE_SHARED);
+
+		while (j_list_iterator_next(it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(it);
+
+			j_lock_add_range(lock, operation->reduce.offset, operation->reduce.length);
+		}
+
+		ret = j_lock_acquire(lock) && ret;
+
+		j_list_iterator_free(it);
+		it = j_list_iterator_new(operations);
+	}
+
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		g_autofree gchar* buffer = NULL;
+		gpointer object_handle;
+
+		if (!j_backend_object_open(object_backend, object->namespace, object->name, &object_handle))
+		{
+			ret = FALSE;
+			goto end;
+		}
+
+		buffer = g_malloc(J_STRIPE_SIZE);
+
+		while (j_list_iterator_next(it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(it);
+			guint64 length = operation->reduce.length;
+			guint64 offset = operation->reduce.offset;
+
+			while (length > 0)
+			{
+				guint64 nbytes = 0;
+
+				if (!j_backend_object_read(object_backend, object_handle, buffer, MIN(length, J_STRIPE_SIZE), offset, &nbytes) || nbytes == 0)
+				{
+					break;
+				}
+
+				j_reduce_update(operation->reduce.reduce, buffer, nbytes);
+
+				length -= nbytes;
+				offset += nbytes;
+			}
+		}
+
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		gsize name_len;
+		gsize namespace_len;
+		guint32 server_count;
+
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		/* Each message carries the parameters of one reduction, so operations are executed one by one. */
+		while (j_list_iterator_next(it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(it);
+			JDistributionExtent extents[J_DISTRIBUTED_OBJECT_EXTENTS];
+			g_autofree JMessage** messages = NULL;
+			g_autofree gpointer* background_data = NULL;
+			guint background_count = 0;
+			guint count;
+
+			messages = g_new0(JMessage*, server_count);
+			background_data = g_new(gpointer, server_count);
+
+			j_distribution_reset(object->distribution, operation->reduce.length, operation->reduce.offset);
+
+			while ((count = j_distribution_distribute_extents(object->distribution, extents, G_N_ELEMENTS(extents))) > 0)
+			{
+				for (guint i = 0; i < count; i++)
+				{
+					guint32 index = extents[i].index;
+
+					if (messages[index] == NULL)
+					{
+						messages[index] = j_message_new(J_MESSAGE_OBJECT_REDUCE, namespace_len + name_len + j_reduce_get_parameters_size());
+						j_message_set_compact(messages[index], j_connection_pool_get_compact_object(index));
+						j_message_set_safety(messages[index], semantics);
+						j_message_append_n(messages[index], object->namespace, namespace_len);
+						j_message_append_n(messages[index], object->name, name_len);
+						j_reduce_append_parameters(operation->reduce.reduce, messages[index]);
+					}
+
+					j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
+					j_message_append_varint(messages[index], extents[i].length);
+					j_message_append_varint(messages[index], extents[i].offset);
+				}
+			}
+
+			for (guint i = 0; i < server_count; i++)
+			{
+				JDistributedObjectBackgroundData* data;
+
+				if (messages[i] == NULL)
+				{
+					continue;
+				}
+
+				data = g_slice_new(JDistributedObjectBackgroundData);
+				data->index = i;
+				data->message = messages[i];
+				data->operations = NULL;
+				data->reduce.reply = NULL;
+
+				background_data[background_count] = data;
+				background_count++;
+			}
+
+			/* All servers reduce their parts in parallel, only the partial results are transferred. */
+			j_helper_execute_parallel(j_distributed_object_reduce_background_operation, background_data, background_count);
+
+			for (guint i = 0; i < background_count; i++)
+			{
+				JDistributedObjectBackgroundData* data = background_data[i];
+				guint32 reply_count;
+
+				reply_count = (data->reduce.reply != NULL) ? j_message_get_count(data->reduce.reply) : 0;
+
+				if (reply_count == j_message_get_count(data->message))
+				{
+					for (guint32 j = 0; j < reply_count; j++)
+					{
+						j_reduce_combine_from_message(operation->reduce.reduce, data->reduce.reply);
+					}
+				}
+				else
+				{
+					ret = FALSE;
+				}
+
+				if (data->reduce.reply != NULL)
+				{
+					j_message_unref(data->reduce.reply);
+				}
+
+				j_message_unref(data->message);
+
+				g_slice_free(JDistributedObjectBackgroundData, data);
+			}
+		}
+	}
+
+end:
+	if (lock != NULL)
+	{
+		/* Freeing the lock releases it. */
+		j_lock_free(lock);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Sends truncates, preallocations, punched holes or prefetches to one server.
+ * The server only replies to prefetches if the semantics ask for it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data Background data.
+ *
+ * \return #data.
+ **/
+static
+gpointer
+j_distributed_object_extent_background_operation (gpointer data)
+{
+	JDistributedObjectBackgroundData* background_data = data;
+
+	g_autoptr(JMessage) reply = NULL;
+	gboolean wait = TRUE;
+
+	if (j_message_get_type(background_data->message) == J_MESSAGE_OBJECT_PREFETCH)
+	{
+		wait = (j_message_get_flags(background_data->message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0;
+	}
+
+	reply = j_connection_pool_request_object(background_data->index, background_data->message, wait);
+
+	if (reply != NULL)
+	{
+		guint32 count;
+
+		count = j_message_get_count(reply);
+
+		for (guint32 i = 0; i < count; i++)
+		{
+			background_data->extent.success = j_message_get_1(reply) && background_data->extent.success;
+		}
+	}
+	else if (wait)
+	{
+		background_data->extent.success = FALSE;
+	}
+
+	return data;
+}
+
+/**
+ * Truncates, preallocates, punches holes into or prefetches an object.
+ * Preallocations, holes and prefetches are mapped to the servers like reads and writes, including all copies of replicated objects.
+ * Truncates are sent to all servers, each of which truncates its stripe to the part of the new size it stores.
+ * Truncating and punching holes would leave the parity of erasure coded objects outdated, so they are not supported for them.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ * \param semantics  A semantics object.
+ * \param type       J_MESSAGE_OBJECT_TRUNCATE, J_MESSAGE_OBJECT_ALLOCATE, J_MESSAGE_OBJECT_PUNCH_HOLE or J_MESSAGE_OBJECT_PREFETCH.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_extent_exec (JList* operations, JSemantics* semantics, JMessageType type)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	JDistributedObject* object;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->extent.object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		gpointer object_handle;
+
+		if (j_backend_object_open(object_backend, object->namespace, object->name, &object_handle))
+		{
+			while (j_list_iterator_next(it))
+			{
+				JDistributedObjectOperation* operation = j_list_iterator_get(it);
+				guint64 length = operation->extent.length;
+				guint64 offset = operation->extent.offset;
+
+				switch (type)
+				{
+					case J_MESSAGE_OBJECT_TRUNCATE:
+						ret = object_backend->object.truncate != NULL && j_backend_object_truncate(object_backend, object_handle, length) && ret;
+						break;
+					case J_MESSAGE_OBJECT_ALLOCATE:
+						ret = object_backend->object.allocate != NULL && j_backend_object_allocate(object_backend, object_handle, length, offset) && ret;
+						break;
+					case J_MESSAGE_OBJECT_PUNCH_HOLE:
+						ret = object_backend->object.punch_hole != NULL && j_backend_object_punch_hole(object_backend, object_handle, length, offset) && ret;
+						break;
+					case J_MESSAGE_OBJECT_PREFETCH:
+						ret = j_backend_object_prefetch(object_backend, object_handle, length, offset) && ret;
+						break;
+					default:
+						g_warn_if_reached();
+						break;
+				}
+			}
+
+			ret = j_backend_object_close(object_backend, object_handle) && ret;
+		}
+		else
+		{
+			ret = FALSE;
+		}
+	}
+	else
+	{
+		g_autofree JMessage** messages = NULL;
+		g_autofree gpointer* background_data = NULL;
+		g_autofree guint64* sizes = NULL;
+		guint background_count = 0;
+		guint32 server_count;
+		guint64 block_size;
+		guint data_count;
+		guint parity_count;
+		guint replicas = 1;
+
+		if ((type == J_MESSAGE_OBJECT_TRUNCATE || type == J_MESSAGE_OBJECT_PUNCH_HOLE) && j_distribution_get_stripe(object->distribution, &data_count, &parity_count, &block_size) && parity_count > 0)
+		{
+			ret = FALSE;
+			goto end;
+		}
+
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		messages = g_new0(JMessage*, server_count);
+		background_data = g_new(gpointer, server_count);
+		sizes = g_new(guint64, server_count);
+
+		/* Prefetches are only hints, so reading one copy is enough. */
+		if (type != J_MESSAGE_OBJECT_PREFETCH)
+		{
+			replicas = j_distribution_get_replica_count(object->distribution);
+		}
+
+		/* All operations share one message per server, because they do not return anything but their success. */
+		while (j_list_iterator_next(it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(it);
+			JDistributionExtent extents[J_DISTRIBUTED_OBJECT_EXTENTS];
+			guint count;
+
+			/* A truncate's new size is distributed like data, so that each server's size is the end of its last part. */
+			if (type == J_MESSAGE_OBJECT_TRUNCATE)
+			{
+				j_distribution_reset(object->distribution, operation->extent.length, 0);
+				memset(sizes, 0, server_count * sizeof(guint64));
+			}
+			else
+			{
+				j_distribution_reset(object->distribution, operation->extent.length, operation->extent.offset);
+			}
+
+			while ((count = j_distribution_distribute_extents(object->distribution, extents, G_N_ELEMENTS(extents))) > 0)
+			{
+				for (guint i = 0; i < count; i++)
+				{
+					for (guint j = 0; j < replicas; j++)
+					{
+						guint32 index;
+						guint64 offset;
+
+						j_distribution_get_replica(object->distribution, &(extents[i]), j, &index, &offset);
+
+						if (type == J_MESSAGE_OBJECT_TRUNCATE)
+						{
+							sizes[index] = MAX(sizes[index], offset + extents[i].length);
+							continue;
+						}
+
+						if (messages[index] == NULL)
+						{
+							messages[index] = j_distributed_object_message_new(object, type, index, semantics);
+						}
+
+						j_message_add_operation(messages[index], sizeof(guint64) + sizeof(guint64));
+						j_message_append_varint(messages[index], extents[i].length);
+						j_message_append_varint(messages[index], offset);
+					}
+				}
+			}
+
+			/* Servers that do not store any part of the new size have to drop their data, too. */
+			if (type == J_MESSAGE_OBJECT_TRUNCATE)
+			{
+				for (guint i = 0; i < server_count; i++)
+				{
+					if (messages[i] == NULL)
+					{
+						messages[i] = j_distributed_object_message_new(object, type, i, semantics);
+					}
+
+					j_message_add_operation(messages[i], sizeof(guint64));
+					j_message_append_varint(messages[i], sizes[i]);
+				}
+			}
+		}
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data;
+
+			if (messages[i] == NULL)
+			{
+				continue;
+			}
+
+			/* Stripes are only created by writes, so servers that have not been written to yet have to create them. */
+			if (type != J_MESSAGE_OBJECT_PREFETCH)
+			{
+				j_message_set_create(messages[i], TRUE);
+			}
+
+			data = g_slice_new(JDistributedObjectBackgroundData);
+			data->index = i;
+			data->message = messages[i];
+			data->operations = NULL;
+			data->extent.success = TRUE;
+
+			background_data[background_count] = data;
+			background_count++;
+		}
+
+		j_helper_execute_parallel(j_distributed_object_extent_background_operation, background_data, background_count);
+
+		for (guint i = 0; i < background_count; i++)
+		{
+			JDistributedObjectBackgroundData* data = background_data[i];
+
+			ret = data->extent.success && ret;
+
+			j_message_unref(data->message);
+			g_slice_free(JDistributedObjectBackgroundData, data);
+		}
+	}
+
+	if (type != J_MESSAGE_OBJECT_PREFETCH)
+	{
+		/* Prefetched data may predate the changes. */
+		if (object->readahead != NULL)
+		{
+			j_readahead_invalidate(object->readahead);
+		}
+
+		j_distributed_object_status_invalidate(object);
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_distributed_object_truncate_exec (JList* operations, JSemantics* semantics)
+{
+	return j_distributed_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_TRUNCATE);
+}
+
+static
+gboolean
+j_distributed_object_allocate_exec (JList* operations, JSemantics* semantics)
+{
+	return j_distributed_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_ALLOCATE);
+}
+
+static
+gboolean
+j_distributed_object_punch_hole_exec (JList* operations, JSemantics* semantics)
+{
+	return j_distributed_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_PUNCH_HOLE);
+}
+
+static
+gboolean
+j_distributed_object_prefetch_exec (JList* operations, JSemantics* semantics)
+{
+	return j_distributed_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_PREFETCH);
+}
+
+/**
+ * Looks up an object's cached status.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object            An object.
+ * \param modification_time Returns the modification time.
+ * \param size              Returns the size.
+ *
+ * \return TRUE if a valid status was cached, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_status_cached (JDistributedObject* object, gint64* modification_time, guint64* size)
+{
+	gboolean ret = FALSE;
+
+	g_mutex_lock(&(object->mutex));
+
+	if (object->status_time != 0 && g_get_monotonic_time() - object->status_time < J_DISTRIBUTED_OBJECT_STATUS_LEASE)
+	{
+		if (modification_time != NULL)
+		{
+			*modification_time = object->status_modification_time;
+		}
+
+		if (size != NULL)
+		{
+			*size = object->status_size;
+		}
+
+		ret = TRUE;
+	}
+
+	g_mutex_unlock(&(object->mutex));
+
+	return ret;
+}
+
+/**
+ * Discards an object's cached status.
+ * Must be called when the object is modified.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object An object.
+ **/
+static
+void
+j_distributed_object_status_invalidate (JDistributedObject* object)
+{
+	g_mutex_lock(&(object->mutex));
+	object->status_time = 0;
+	g_mutex_unlock(&(object->mutex));
+}
+
+static
+gpointer
+j_distributed_object_snapshot_background_operation (gpointer data)
+{
+	JDistributedObjectBackgroundData* background_data = data;
+
+	g_autoptr(JMessage) reply = NULL;
+
+	reply = j_connection_pool_request_object(background_data->index, background_data->message, TRUE);
+
+	if (reply != NULL)
+	{
+		guint32 count;
+
+		count = MIN(j_message_get_count(reply), j_message_get_count(background_data->message));
+
+		for (guint32 i = 0; i < count; i++)
+		{
+			background_data->snapshot.copied[i] = (j_message_get_1(reply) != 0);
+
+			/* Bytes copied */
+			j_message_get_8(reply);
+		}
+	}
+	else
+	{
+		background_data->snapshot.success = FALSE;
+	}
+
+	return data;
+}
+
+/**
+ * Creates snapshots of an object on all servers in parallel.
+ * Each server copies its part locally, which shares the data if its backend supports it.
+ * Servers that store no part of the object report a failure, so a snapshot succeeds if all servers replied and at least one of them has copied its part.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ * \param semantics  A semantics object.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_snapshot_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autofree JMessage** messages = NULL;
+	JDistributedObject* object;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectSnapshot* snapshot = j_list_get_first(operations);
+		g_assert(snapshot != NULL);
+
+		object = snapshot->object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend == NULL)
+	{
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		messages = g_new(JMessage*, server_count);
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			messages[i] = j_distributed_object_message_new(object, J_MESSAGE_OBJECT_COPY, i, semantics);
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectSnapshot* snapshot = j_list_iterator_get(it);
+
+		j_distributed_object_status_invalidate(snapshot->snapshot);
+
+		/* Prefetched data of the snapshot will be outdated. */
+		if (snapshot->snapshot->readahead != NULL)
+		{
+			j_readahead_invalidate(snapshot->snapshot->readahead);
+		}
+
+		if (object_backend != NULL)
+		{
+			gpointer from_handle = NULL;
+			gpointer to_handle = NULL;
+			guint64 nbytes = 0;
+
+			/* Snapshots have to be cheap, so they are not emulated by reading and writing the data. */
+			if (object_backend->object.copy == NULL)
+			{
+				ret = FALSE;
+				continue;
+			}
+
+			ret = j_backend_object_open(object_backend, object->namespace, object->name, &from_handle) && ret;
+			ret = j_backend_object_create(object_backend, snapshot->snapshot->namespace, snapshot->snapshot->name, &to_handle) && ret;
+
+			if (from_handle != NULL && to_handle != NULL)
+			{
+				ret = j_backend_object_copy(object_backend, from_handle, to_handle, &nbytes) && ret;
+			}
+
+			if (from_handle != NULL)
+			{
+				ret = j_backend_object_close(object_backend, from_handle) && ret;
+			}
+
+			if (to_handle != NULL)
+			{
+				ret = j_backend_object_close(object_backend, to_handle) && ret;
+			}
+		}
+		else
+		{
+			gsize to_name_len;
+			gsize to_namespace_len;
+			gchar local = 1;
+
+			to_namespace_len = strlen(snapshot->snapshot->namespace) + 1;
+			to_name_len = strlen(snapshot->snapshot->name) + 1;
+
+			/* Both objects use the same distribution, so every server copies its own part. */
+			for (guint32 i = 0; i < server_count; i++)
+			{
+				j_message_add_operation(messages[i], 1 + sizeof(guint32) + to_namespace_len + to_name_len);
+				j_message_append_1(messages[i], &local);
+				j_message_append_4(messages[i], &i);
+				j_message_append_n(messages[i], snapshot->snapshot->namespace, to_namespace_len);
+				j_message_append_n(messages[i], snapshot->snapshot->name, to_name_len);
+			}
+		}
+	}
+
+	if (object_backend == NULL)
+	{
+		g_autofree gpointer* background_data = NULL;
+		guint32 operation_count;
+
+		background_data = g_new(gpointer, server_count);
+		operation_count = j_list_length(operations);
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data;
+
+			data = g_slice_new(JDistributedObjectBackgroundData);
+			data->index = i;
+			data->message = messages[i];
+			data->operations = NULL;
+			data->snapshot.copied = g_new0(gboolean, operation_count);
+			data->snapshot.success = TRUE;
+
+			background_data[i] = data;
+		}
+
+		j_helper_execute_parallel(j_distributed_object_snapshot_background_operation, background_data, server_count);
+
+		for (guint32 j = 0; j < operation_count; j++)
+		{
+			gboolean copied = FALSE;
+
+			for (guint i = 0; i < server_count; i++)
+			{
+				JDistributedObjectBackgroundData* data = background_data[i];
+
+				copied = copied || data->snapshot.copied[j];
+			}
+
+			ret = copied && ret;
+		}
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data = background_data[i];
+
+			ret = data->snapshot.success && ret;
+
+			g_free(data->snapshot.copied);
+			j_message_unref(data->message);
+			g_slice_free(JDistributedObjectBackgroundData, data);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Retrieves the status of several objects.
+ * The objects share a namespace, so each server receives one message for all of them and the servers are queried in parallel.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ * \param semantics  A semantics object.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_distributed_object_status_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(JList) pending = NULL;
+	g_autofree JMessage** messages = NULL;
+	gboolean eventual;
+	gchar const* namespace = NULL;
+	gsize namespace_len = 0;
+	guint32 server_count = 0;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JDistributedObjectOperation* operation = j_list_get_first(operations);
+		JDistributedObject* object = operation->status.object;
+
+		g_assert(operation != NULL);
+		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(namespace);
+	eventual = (j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) == J_SEMANTICS_CONSISTENCY_EVENTUAL);
+
+	/* Contains the operations that have to be sent to the servers. */
+	pending = j_list_new(NULL);
+
+	if (object_backend == NULL)
+	{
+		server_count = j_configuration_get_object_server_count(j_configuration());
+		messages = g_new(JMessage*, server_count);
+
+		// FIXME use actual distribution
+		for (guint i = 0; i < server_count; i++)
+		{
+			messages[i] = j_message_new(J_MESSAGE_OBJECT_STATUS, namespace_len);
+			j_message_set_safety(messages[i], semantics);
+			j_message_append_n(messages[i], namespace, namespace_len);
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JDistributedObjectOperation* operation = j_list_iterator_get(it);
+		JDistributedObject* object = operation->status.object;
+		gint64* modification_time = operation->status.modification_time;
+		guint64* size = operation->status.size;
+
+		if (eventual && j_distributed_object_status_cached(object, modification_time, size))
+		{
+			continue;
+		}
+
+		if (object_backend != NULL)
+		{
+			gpointer object_handle;
+			gint64 modification_time_ = 0;
+			guint64 size_ = 0;
+
+			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+			ret = j_backend_object_status(object_backend, object_handle, &modification_time_, &size_) && ret;
+			ret = j_backend_object_close(object_backend, object_handle) && ret;
+
+			if (modification_time != NULL)
+			{
+				*modification_time = modification_time_;
+			}
+
+			if (size != NULL)
+			{
+				*size = size_;
+			}
+		}
+		else
+		{
+			gsize name_len;
+
+			name_len = strlen(object->name) + 1;
+
+			// FIXME use actual distribution
+			for (guint i = 0; i < server_count; i++)
+			{
+				j_message_add_operation(messages[i], name_len);
+				j_message_append_n(messages[i], object->name, name_len);
+			}
+
+			j_list_append(pending, operation);
+		}
+	}
+
+	if (object_backend == NULL)
+	{
+		g_autofree gpointer* background_data = NULL;
+		g_autoptr(JListIterator) pending_it = NULL;
+		guint pending_count;
+		guint j = 0;
+
+		pending_count = j_list_length(pending);
+		background_data = g_new(gpointer, server_count);
+
+		// FIXME use actual distribution
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data;
+
+			data = g_slice_new(JDistributedObjectBackgroundData);
+			data->index = i;
+			data->message = messages[i];
+			data->operations = pending;
+			data->status.modification_times = g_new0(gint64, pending_count);
+			data->status.sizes = g_new0(guint64, pending_count);
+			data->status.success = FALSE;
+
+			background_data[i] = data;
+		}
+
+		if (pending_count > 0)
+		{
+			j_helper_execute_parallel(j_distributed_object_status_background_operation, background_data, server_count);
+		}
+
+		pending_it = j_list_iterator_new(pending);
+
+		/* Each server stores a part of every object, so the sizes add up and the latest modification wins. */
+		while (j_list_iterator_next(pending_it))
+		{
+			JDistributedObjectOperation* operation = j_list_iterator_get(pending_it);
+			JDistributedObject* object = operation->status.object;
+			gboolean success = TRUE;
+			gint64 modification_time = 0;
+			guint64 size = 0;
+
+			for (guint i = 0; i < server_count; i++)
+			{
+				JDistributedObjectBackgroundData* data = background_data[i];
+
+				modification_time = MAX(modification_time, data->status.modification_times[j]);
+				size += data->status.sizes[j];
+				success = success && data->status.success;
+			}
+
+			if (operation->status.modification_time != NULL)
+			{
+				*(operation->status.modification_time) = modification_time;
+			}
+
+			if (operation->status.size != NULL)
+			{
+				*(operation->status.size) = size;
+			}
+
+			if (success)
+			{
+				g_mutex_lock(&(object->mutex));
+				object->status_time = g_get_monotonic_time();
+				object->status_modification_time = modification_time;
+				object->status_size = size;
+				g_mutex_unlock(&(object->mutex));
+			}
+
+			ret = success && ret;
+			j++;
+		}
+
+		for (guint i = 0; i < server_count; i++)
+		{
+			JDistributedObjectBackgroundData* data = background_data[i];
+
+			g_free(data->status.modification_times);
+			g_free(data->status.sizes);
+			j_message_unref(data->message);
+
+			g_slice_free(JDistributedObjectBackgroundData, data);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Creates a new object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistributedObject* i;
+ *
+ * i = j_distributed_object_new("JULEA");
+ * \endcode
+ *
+ * \param name         An object name.
+ * \param distribution A distribution.
+ *
+ * \return A new object. Should be freed with j_distributed_object_unref().
+ **/
+JDistributedObject*
+j_distributed_object_new (gchar const* namespace, gchar const* name, JDistribution* distribution)
+{
+	JDistributedObject* object = NULL;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(name != NULL, NULL);
+	g_return_val_if_fail(distribution != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	object = g_slice_new(JDistributedObject);
+	object->namespace = g_strdup(namespace);
+	object->name = g_strdup(name);
+	object->distribution = j_distribution_ref(distribution);
+	object->readahead = NULL;
+	object->batch_key = g_quark_from_string(namespace);
+	object->status_time = 0;
+	object->status_modification_time = 0;
+	object->status_size = 0;
+	object->ref_count = 1;
+
+	g_mutex_init(&(object->mutex));
+
+	j_trace_leave(G_STRFUNC);
+
+	return object;
+}
+
+/**
+ * Increases an object's reference count.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistributedObject* i;
+ *
+ * j_distributed_object_ref(i);
+ * \endcode
+ *
+ * \param object An object.
+ *
+ * \return #object.
+ **/
+JDistributedObject*
+j_distributed_object_ref (JDistributedObject* object)
+{
+	g_return_val_if_fail(object != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_atomic_int_inc(&(object->ref_count));
+
+	j_trace_leave(G_STRFUNC);
+
+	return object;
+}
+
+/**
+ * Decreases an object's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object An object.
+ **/
+void
+j_distributed_object_unref (JDistributedObject* object)
+{
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (g_atomic_int_dec_and_test(&(object->ref_count)))
+	{
+		/* Waits for outstanding prefetches, which do not hold references. */
+		if (object->readahead != NULL)
+		{
+			j_readahead_free(object->readahead);
+		}
+
+		g_free(object->name);
+		g_free(object->namespace);
+
+		j_distribution_unref(object->distribution);
+
+		g_mutex_clear(&(object->mutex));
+
+		g_slice_free(JDistributedObject, object);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Enables prefetching for sequential reads.
+ * Prefetched data is only used by batches whose semantics do not require immediate consistency.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistributedObject* o;
+ *
+ * ...
+ * j_distributed_object_set_readahead(o, 4 * 1024 * 1024);
+ * \endcode
+ *
+ * \param object An object.
+ * \param size   The number of bytes to prefetch at once, 0 to disable prefetching.
+ **/
+void
+j_distributed_object_set_readahead (JDistributedObject* object, guint64 size)
+{
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (object->readahead != NULL)
+	{
+		j_readahead_free(object->readahead);
+		object->readahead = NULL;
+	}
+
+	if (size > 0)
+	{
+		object->readahead = j_readahead_new(size, j_distributed_object_readahead_fetch, object);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Creates an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param name         A name.
+ * \param distribution A distribution.
+ * \param batch        A batch.
+ *
+ * \return A new object. Should be freed with j_distributed_object_unref().
+ **/
+void
+j_distributed_object_create (JDistributedObject* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	operation = j_operation_new();
+	// FIXME key = index + namespace
+	operation->key = object;
+	operation->data = j_distributed_object_ref(object);
+	operation->exec_func = j_distributed_object_create_exec;
+	operation->free_func = j_distributed_object_create_free;
+	operation->cache_func = j_distributed_object_create_cache;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deletes an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object     An object.
+ * \param batch      A batch.
+ **/
+void
+j_distributed_object_delete (JDistributedObject* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = j_distributed_object_ref(object);
+	operation->exec_func = j_distributed_object_delete_exec;
+	operation->free_func = j_distributed_object_delete_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deletes all objects of a namespace whose names lie below a directory.
+ * All servers purge their objects concurrently, which is much faster than deleting the objects one by one.
+ * This requires object backends that support purging, otherwise the batch fails.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_distributed_object_purge("item", "scratch", batch);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param directory A directory, i.e. the first component of the objects' names.
+ * \param batch     A batch.
+ **/
+void
+j_distributed_object_purge (gchar const* namespace, gchar const* directory, JBatch* batch)
+{
+	JDistributedObjectPurge* purge;
+	JOperation* operation;
+
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(directory != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	purge = g_slice_new(JDistributedObjectPurge);
+	purge->namespace = g_strdup(namespace);
+	purge->directory = g_strdup(directory);
+
+	operation = j_operation_new();
+	operation->key = GUINT_TO_POINTER(g_quark_from_static_string("object-purge"));
+	operation->data = purge;
+	operation->exec_func = j_distributed_object_purge_exec;
+	operation->free_func = j_distributed_object_purge_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Creates a snapshot of an object.
+ * Each server creates a snapshot of its part of the object, which shares the data with the snapshot if its backend supports it (for example, using reflinks on the posix backend).
+ * Subsequent writes to the object do not modify the snapshot.
+ * An existing object of the same name is overwritten, so snapshots should use new names.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JDistributedObject) snapshot = NULL;
+ *
+ * snapshot = j_distributed_object_new("checkpoints", "checkpoint-1", distribution);
+ * j_distributed_object_snapshot(object, snapshot, batch);
+ * \endcode
+ *
+ * \param object   An object.
+ * \param snapshot The snapshot, has to use the same distribution as #object.
+ * \param batch    A batch.
+ **/
+void
+j_distributed_object_snapshot (JDistributedObject* object, JDistributedObject* snapshot, JBatch* batch)
+{
+	JDistributedObjectSnapshot* data;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(snapshot != NULL);
+	g_return_if_fail(object != snapshot);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	data = g_slice_new(JDistributedObjectSnapshot);
+	data->object = j_distributed_object_ref(object);
+	data->snapshot = j_distributed_object_ref(snapshot);
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = data;
+	operation->exec_func = j_distributed_object_snapshot_exec;
+	operation->free_func = j_distributed_object_snapshot_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reads an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object     An object.
+ * \param data       A buffer to hold the read data.
+ * \param length     Number of bytes to read.
+ * \param offset     An offset within #object.
+ * \param bytes_read Number of bytes read.
+ * \param batch      A batch.
+ **/
+void
+j_distributed_object_read (JDistributedObject* object, gpointer data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+{
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_read != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->read.object = j_distributed_object_ref(object);
+	iop->read.data = data;
+	iop->read.length = length;
+	iop->read.offset = offset;
+	iop->read.bytes_read = bytes_read;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_read_exec;
+	operation->free_func = j_distributed_object_read_free;
+
+	*bytes_read = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Writes an object.
+ *
+ * \note
+ * j_distributed_object_write() modifies bytes_written even if j_batch_execute() is not called.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object        An object.
+ * \param data          A buffer holding the data to write.
+ * \param length        Number of bytes to write.
+ * \param offset        An offset within #object.
+ * \param bytes_written Number of bytes written.
+ * \param batch         A batch.
+ **/
+void
+j_distributed_object_write (JDistributedObject* object, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+{
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_written != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* An adaptive distribution chooses its block size before the first write is distributed. */
+	j_distribution_adapt(object->distribution, offset + length);
+
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->write.object = j_distributed_object_ref(object);
+	iop->write.data = data;
+	iop->write.length = length;
+	iop->write.offset = offset;
+	iop->write.bytes_written = bytes_written;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->buffer = NULL;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_write_exec;
+	operation->free_func = j_distributed_object_write_free;
+	operation->cache_size_func = j_distributed_object_write_cache_size;
+	operation->cache_func = j_distributed_object_write_cache;
+
+	*bytes_written = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reads an object into device memory.
+ * The data is staged through pinned host memory, copying each chunk to the device while the next one is read.
+ * Requires JULEA to be built with CUDA, see j_device_is_available().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object      An object.
+ * \param device_data A device buffer to hold the read data.
+ * \param length      Number of bytes to read.
+ * \param offset      An offset within #object.
+ * \param bytes_read  Number of bytes read.
+ * \param batch       A batch.
+ **/
+void
+j_distributed_object_read_device (JDistributedObject* object, gpointer device_data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+{
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(device_data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_read != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->read.object = j_distributed_object_ref(object);
+	iop->read.data = device_data;
+	iop->read.length = length;
+	iop->read.offset = offset;
+	iop->read.bytes_read = bytes_read;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_read_device_exec;
+	operation->free_func = j_distributed_object_read_free;
+
+	*bytes_read = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Writes an object from device memory.
+ * Each chunk is copied from the device into pinned host memory while the previous one is written.
+ * Unlike j_distributed_object_write(), the write is never cached, because device memory can not be copied by the operation cache.
+ * Requires JULEA to be built with CUDA, see j_device_is_available().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object        An object.
+ * \param device_data   A device buffer holding the data to write.
+ * \param length        Number of bytes to write.
+ * \param offset        An offset within #object.
+ * \param bytes_written Number of bytes written.
+ * \param batch         A batch.
+ **/
+void
+j_distributed_object_write_device (JDistributedObject* object, gconstpointer device_data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+{
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(device_data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_written != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_distribution_adapt(object->distribution, offset + length);
+
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->write.object = j_distributed_object_ref(object);
+	iop->write.data = device_data;
+	iop->write.length = length;
+	iop->write.offset = offset;
+	iop->write.bytes_written = bytes_written;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->buffer = NULL;
 
-		if (size != NULL)
-		{
-			*size = 0;
-		}
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_write_device_exec;
+	operation->free_func = j_distributed_object_write_free;
 
-		if (object_backend != NULL)
-		{
-			gpointer object_handle;
+	*bytes_written = 0;
 
-			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
-			ret = j_backend_object_status(object_backend, object_handle, modification_time, size) && ret;
-			ret = j_backend_object_close(object_backend, object_handle) && ret;
-		}
-		else
-		{
-			gsize name_len;
+	j_batch_add(batch, operation);
 
-			name_len = strlen(object->name) + 1;
+	j_trace_leave(G_STRFUNC);
+}
 
-			// FIXME use actual distribution
-			for (guint i = 0; i < server_count; i++)
-			{
-				j_message_add_operation(messages[i], name_len);
-				j_message_append_n(messages[i], object->name, name_len);
-			}
-		}
-	}
+/**
+ * Appends data to an object.
+ * The offset is assigned atomically, so several clients can append to the same object without coordinating.
+ * Offsets start after the data appended before, data written with j_distributed_object_write() is not taken into account.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint64 offset;
+ *
+ * j_distributed_object_append(object, record, record_length, &offset, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param object An object.
+ * \param data   A buffer holding the data to append.
+ * \param length Number of bytes to append.
+ * \param offset Returns the offset the data has been written to, once the batch has been executed.
+ * \param batch  A batch.
+ **/
+void
+j_distributed_object_append (JDistributedObject* object, gconstpointer data, guint64 length, guint64* offset, JBatch* batch)
+{
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
 
-	if (object_backend == NULL)
-	{
-		g_autofree gpointer* background_data = NULL;
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(offset != NULL);
 
-		background_data = g_new(gpointer, server_count);
+	j_trace_enter(G_STRFUNC, NULL);
 
-		// FIXME use actual distribution
-		for (guint i = 0; i < server_count; i++)
-		{
-			JDistributedObjectBackgroundData* data;
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->append.object = j_distributed_object_ref(object);
+	iop->append.data = data;
+	iop->append.length = length;
+	iop->append.offset = offset;
+	iop->segments = NULL;
+	iop->segment_count = 0;
 
-			data = g_slice_new(JDistributedObjectBackgroundData);
-			data->index = i;
-			data->message = messages[i];
-			data->operations = operations;
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_append_exec;
+	operation->free_func = j_distributed_object_append_free;
 
-			background_data[i] = data;
-		}
+	*offset = 0;
 
-		j_helper_execute_parallel(j_distributed_object_status_background_operation, background_data, server_count);
-	}
+	j_batch_add(batch, operation);
 
 	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 /**
- * Creates a new object.
+ * Reduces an extent of an object on its servers.
+ * The extent is interpreted as an array of the reduction's type, all servers reduce their parts in parallel and only the partial results are transferred.
+ * The result is combined into the reduction, so several extents and objects can be reduced together.
  *
  * \author Michael Kuhn
  *
  * \code
- * JDistributedObject* i;
+ * g_autoptr(JReduce) reduce = NULL;
  *
- * i = j_distributed_object_new("JULEA");
+ * reduce = j_reduce_new(J_REDUCE_TYPE_DOUBLE);
+ * j_reduce_set_histogram(reduce, 0.0, 1.0, 10);
+ * j_distributed_object_reduce(object, reduce, length, 0, batch);
+ * j_batch_execute(batch);
  * \endcode
  *
- * \param name         An object name.
- * \param distribution A distribution.
- *
- * \return A new object. Should be freed with j_distributed_object_unref().
+ * \param object An object.
+ * \param reduce A reduction, must not be modified until the batch has been executed.
+ * \param length The extent's length, should be a multiple of the element size.
+ * \param offset The extent's offset, should be a multiple of the element size.
+ * \param batch  A batch.
  **/
-JDistributedObject*
-j_distributed_object_new (gchar const* namespace, gchar const* name, JDistribution* distribution)
+void
+j_distributed_object_reduce (JDistributedObject* object, JReduce* reduce, guint64 length, guint64 offset, JBatch* batch)
 {
-	JDistributedObject* object = NULL;
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
 
-	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(name != NULL, NULL);
-	g_return_val_if_fail(distribution != NULL, NULL);
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(length > 0);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	object = g_slice_new(JDistributedObject);
-	object->namespace = g_strdup(namespace);
-	object->name = g_strdup(name);
-	object->distribution = j_distribution_ref(distribution);
-	object->ref_count = 1;
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->reduce.object = j_distributed_object_ref(object);
+	iop->reduce.reduce = reduce;
+	iop->reduce.length = length;
+	iop->reduce.offset = offset;
+	iop->segments = NULL;
+	iop->segment_count = 0;
 
-	j_trace_leave(G_STRFUNC);
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_distributed_object_reduce_exec;
+	operation->free_func = j_distributed_object_reduce_free;
 
-	return object;
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Increases an object's reference count.
+ * Adds an operation changing or prefetching an object's extents to a batch.
+ *
+ * \private
  *
  * \author Michael Kuhn
  *
  * \code
- * JDistributedObject* i;
+ * \endcode
  *
- * j_distributed_object_ref(i);
+ * \param object    An object.
+ * \param length    A length.
+ * \param offset    An offset within #object.
+ * \param exec_func The exec function.
+ * \param batch     A batch.
+ **/
+static
+void
+j_distributed_object_extent_add (JDistributedObject* object, guint64 length, guint64 offset, JOperationExecFunc exec_func, JBatch* batch)
+{
+	JDistributedObjectOperation* iop;
+	JOperation* operation;
+
+	iop = g_slice_new(JDistributedObjectOperation);
+	iop->extent.object = j_distributed_object_ref(object);
+	iop->extent.length = length;
+	iop->extent.offset = offset;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = exec_func;
+	operation->free_func = j_distributed_object_extent_free;
+
+	j_batch_add(batch, operation);
+}
+
+/**
+ * Truncates or extends an object.
+ * Each server truncates its part of the object, so that the object's size afterwards is #size.
+ * Fails for erasure coded objects.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
  * \endcode
  *
  * \param object An object.
- *
- * \return #object.
+ * \param size   The new size.
+ * \param batch  A batch.
  **/
-JDistributedObject*
-j_distributed_object_ref (JDistributedObject* object)
+void
+j_distributed_object_truncate (JDistributedObject* object, guint64 size, JBatch* batch)
 {
-	g_return_val_if_fail(object != NULL, NULL);
+	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	g_atomic_int_inc(&(object->ref_count));
+	j_distributed_object_extent_add(object, size, 0, j_distributed_object_truncate_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
-
-	return object;
 }
 
 /**
- * Decreases an object's reference count.
- * When the reference count reaches zero, frees the memory allocated for the object.
+ * Preallocates space for an object without changing its size.
+ * Fails if the object backend does not support preallocation.
  *
  * \author Michael Kuhn
  *
@@ -1208,95 +5669,85 @@ j_distributed_object_ref (JDistributedObject* object)
  * \endcode
  *
  * \param object An object.
+ * \param length Number of bytes to preallocate.
+ * \param offset An offset within #object.
+ * \param batch  A batch.
  **/
 void
-j_distributed_object_unref (JDistributedObject* object)
+j_distributed_object_allocate (JDistributedObject* object, guint64 length, guint64 offset, JBatch* batch)
 {
 	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (g_atomic_int_dec_and_test(&(object->ref_count)))
-	{
-		g_free(object->name);
-		g_free(object->namespace);
-
-		j_distribution_unref(object->distribution);
-
-		g_slice_free(JDistributedObject, object);
-	}
+	j_distributed_object_extent_add(object, length, offset, j_distributed_object_allocate_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Creates an object.
+ * Deallocates a range of an object without changing its size.
+ * The range reads as zeros afterwards.
+ * Fails if the object backend does not support punching holes and for erasure coded objects.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param name         A name.
- * \param distribution A distribution.
- * \param batch        A batch.
- *
- * \return A new object. Should be freed with j_distributed_object_unref().
+ * \param object An object.
+ * \param length Number of bytes to deallocate.
+ * \param offset An offset within #object.
+ * \param batch  A batch.
  **/
 void
-j_distributed_object_create (JDistributedObject* object, JBatch* batch)
+j_distributed_object_punch_hole (JDistributedObject* object, guint64 length, guint64 offset, JBatch* batch)
 {
-	JOperation* operation;
-
 	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	operation = j_operation_new();
-	// FIXME key = index + namespace
-	operation->key = object;
-	operation->data = j_distributed_object_ref(object);
-	operation->exec_func = j_distributed_object_create_exec;
-	operation->free_func = j_distributed_object_create_free;
-
-	j_batch_add(batch, operation);
+	j_distributed_object_extent_add(object, length, offset, j_distributed_object_punch_hole_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Deletes an object.
+ * Asks the object's servers to read an extent into memory, so that later reads do not have to wait for the storage.
+ * Depending on the object backend, the servers read their parts into the page cache or move them to a faster tier.
+ * No data is transferred and, unless the batch's safety semantics require it, the servers do not reply.
  *
  * \author Michael Kuhn
  *
  * \code
+ * g_autoptr(JBatch) batch = NULL;
+ *
+ * batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+ *
+ * j_distributed_object_prefetch(object, length, 0, batch);
+ * j_batch_execute(batch);
  * \endcode
  *
- * \param object     An object.
- * \param batch      A batch.
+ * \param object An object.
+ * \param length The extent's length.
+ * \param offset The extent's offset.
+ * \param batch  A batch.
  **/
 void
-j_distributed_object_delete (JDistributedObject* object, JBatch* batch)
+j_distributed_object_prefetch (JDistributedObject* object, guint64 length, guint64 offset, JBatch* batch)
 {
-	JOperation* operation;
-
 	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	operation = j_operation_new();
-	operation->key = object;
-	operation->data = j_distributed_object_ref(object);
-	operation->exec_func = j_distributed_object_delete_exec;
-	operation->free_func = j_distributed_object_delete_free;
-
-	j_batch_add(batch, operation);
+	j_distributed_object_extent_add(object, length, offset, j_distributed_object_prefetch_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Reads an object.
+ * Reads several extents of an object in one operation.
+ * Extent i is read into vectors[i].
  *
  * \author Michael Kuhn
  *
@@ -1304,31 +5755,76 @@ j_distributed_object_delete (JDistributedObject* object, JBatch* batch)
  * \endcode
  *
  * \param object     An object.
- * \param data       A buffer to hold the read data.
- * \param length     Number of bytes to read.
- * \param offset     An offset within #object.
- * \param bytes_read Number of bytes read.
+ * \param vectors    Buffers to hold the read data, one per extent.
+ * \param offsets    The extents' offsets within #object.
+ * \param count      The number of extents.
+ * \param bytes_read Number of bytes read in total.
  * \param batch      A batch.
  **/
 void
-j_distributed_object_read (JDistributedObject* object, gpointer data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+j_distributed_object_readv (JDistributedObject* object, GInputVector const* vectors, guint64 const* offsets, guint count, guint64* bytes_read, JBatch* batch)
 {
 	JDistributedObjectOperation* iop;
 	JOperation* operation;
+	g_autofree JDistributedObjectSegment* segments = NULL;
 
 	g_return_if_fail(object != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(length > 0);
+	g_return_if_fail(vectors != NULL);
+	g_return_if_fail(offsets != NULL);
+	g_return_if_fail(count > 0);
 	g_return_if_fail(bytes_read != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	segments = g_new(JDistributedObjectSegment, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		segments[i].offset = offsets[i];
+		segments[i].length = vectors[i].size;
+		segments[i].index = i;
+	}
+
+	j_distributed_object_segments_sort(segments, count, FALSE);
+
 	iop = g_slice_new(JDistributedObjectOperation);
 	iop->read.object = j_distributed_object_ref(object);
-	iop->read.data = data;
-	iop->read.length = length;
-	iop->read.offset = offset;
+	iop->read.data = NULL;
+	iop->read.length = 0;
+	iop->read.offset = 0;
 	iop->read.bytes_read = bytes_read;
+	iop->segments = g_new(JDistributedObjectOperation, count);
+	iop->segment_count = 0;
+
+	for (guint i = 0; i < count; i++)
+	{
+		JDistributedObjectOperation* segment;
+
+		if (segments[i].length == 0)
+		{
+			continue;
+		}
+
+		segment = &(iop->segments[iop->segment_count]);
+		segment->read.object = object;
+		segment->read.data = vectors[segments[i].index].buffer;
+		segment->read.length = segments[i].length;
+		segment->read.offset = segments[i].offset;
+		segment->read.bytes_read = bytes_read;
+		segment->segments = NULL;
+		segment->segment_count = 0;
+
+		iop->segment_count++;
+	}
+
+	*bytes_read = 0;
+
+	/* Nothing to do, the server must not receive an empty message. */
+	if (iop->segment_count == 0)
+	{
+		j_distributed_object_read_free(iop);
+		goto end;
+	}
 
 	operation = j_operation_new();
 	operation->key = object;
@@ -1336,18 +5832,19 @@ j_distributed_object_read (JDistributedObject* object, gpointer data, guint64 le
 	operation->exec_func = j_distributed_object_read_exec;
 	operation->free_func = j_distributed_object_read_free;
 
-	*bytes_read = 0;
-
 	j_batch_add(batch, operation);
 
+end:
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Writes an object.
+ * Writes several extents of an object in one operation.
+ * vectors[i] is written to extent i.
+ * Overlapping extents are written in the given order.
  *
  * \note
- * j_distributed_object_write() modifies bytes_written even if j_batch_execute() is not called.
+ * j_distributed_object_writev() modifies bytes_written even if j_batch_execute() is not called.
  *
  * \author Michael Kuhn
  *
@@ -1355,31 +5852,86 @@ j_distributed_object_read (JDistributedObject* object, gpointer data, guint64 le
  * \endcode
  *
  * \param object        An object.
- * \param data          A buffer holding the data to write.
- * \param length        Number of bytes to write.
- * \param offset        An offset within #object.
- * \param bytes_written Number of bytes written.
+ * \param vectors       Buffers holding the data to write, one per extent.
+ * \param offsets       The extents' offsets within #object.
+ * \param count         The number of extents.
+ * \param bytes_written Number of bytes written in total.
  * \param batch         A batch.
  **/
 void
-j_distributed_object_write (JDistributedObject* object, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+j_distributed_object_writev (JDistributedObject* object, GOutputVector const* vectors, guint64 const* offsets, guint count, guint64* bytes_written, JBatch* batch)
 {
 	JDistributedObjectOperation* iop;
 	JOperation* operation;
+	g_autofree JDistributedObjectSegment* segments = NULL;
+	guint64 size = 0;
 
 	g_return_if_fail(object != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(length > 0);
+	g_return_if_fail(vectors != NULL);
+	g_return_if_fail(offsets != NULL);
+	g_return_if_fail(count > 0);
 	g_return_if_fail(bytes_written != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	segments = g_new(JDistributedObjectSegment, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		segments[i].offset = offsets[i];
+		segments[i].length = vectors[i].size;
+		segments[i].index = i;
+	}
+
+	j_distributed_object_segments_sort(segments, count, TRUE);
+
+	for (guint i = 0; i < count; i++)
+	{
+		size = MAX(size, segments[i].offset + segments[i].length);
+	}
+
+	/* An adaptive distribution chooses its block size before the first write is distributed. */
+	j_distribution_adapt(object->distribution, size);
+
 	iop = g_slice_new(JDistributedObjectOperation);
 	iop->write.object = j_distributed_object_ref(object);
-	iop->write.data = data;
-	iop->write.length = length;
-	iop->write.offset = offset;
+	iop->write.data = NULL;
+	iop->write.length = 0;
+	iop->write.offset = 0;
 	iop->write.bytes_written = bytes_written;
+	iop->segments = g_new(JDistributedObjectOperation, count);
+	iop->segment_count = 0;
+	iop->buffer = NULL;
+
+	for (guint i = 0; i < count; i++)
+	{
+		JDistributedObjectOperation* segment;
+
+		if (segments[i].length == 0)
+		{
+			continue;
+		}
+
+		segment = &(iop->segments[iop->segment_count]);
+		segment->write.object = object;
+		segment->write.data = vectors[segments[i].index].buffer;
+		segment->write.length = segments[i].length;
+		segment->write.offset = segments[i].offset;
+		segment->write.bytes_written = bytes_written;
+		segment->segments = NULL;
+		segment->segment_count = 0;
+
+		iop->segment_count++;
+	}
+
+	*bytes_written = 0;
+
+	/* Nothing to do, the server must not receive an empty message. */
+	if (iop->segment_count == 0)
+	{
+		j_distributed_object_write_free(iop);
+		goto end;
+	}
 
 	operation = j_operation_new();
 	operation->key = object;
@@ -1387,10 +5939,9 @@ j_distributed_object_write (JDistributedObject* object, gconstpointer data, guin
 	operation->exec_func = j_distributed_object_write_exec;
 	operation->free_func = j_distributed_object_write_free;
 
-	*bytes_written = 0;
-
 	j_batch_add(batch, operation);
 
+end:
 	j_trace_leave(G_STRFUNC);
 }
 
@@ -1421,7 +5972,8 @@ j_distributed_object_status (JDistributedObject* object, gint64* modification_ti
 	iop->status.size = size;
 
 	operation = j_operation_new();
-	operation->key = object;
+	/* Status operations of several objects can be combined, unless relaxed ordering could move them before preceding writes. */
+	operation->key = (j_semantics_get(j_batch_get_semantics(batch), J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_RELAXED) ? (gpointer)object : GUINT_TO_POINTER(object->batch_key);
 	operation->data = iop;
 	operation->exec_func = j_distributed_object_status_exec;
 	operation->free_func = j_distributed_object_status_free;
@@ -24,6 +24,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <bson.h>
 
 #include <object/jobject-iterator.h>
@@ -38,25 +40,180 @@
  * @{
  **/
 
+/**
+ * The paths of one server.
+ **/
+struct JObjectIteratorSource
+{
+	/**
+	 * The index of the server.
+	 **/
+	guint32 index;
+
+	/**
+	 * The current reply.
+	 * The server sends the paths in multiple replies, which are received one at a time.
+	 **/
+	JMessage* reply;
+
+	/**
+	 * The number of operations left in the current reply.
+	 **/
+	guint32 remaining;
+
+	/**
+	 * The connection the replies are received from.
+	 * It is returned to the pool as soon as the last reply has been received.
+	 **/
+	GSocketConnection* connection;
+};
+
+typedef struct JObjectIteratorSource JObjectIteratorSource;
+
 struct JObjectIterator
 {
-	gchar* namespace;
 	JBackend* object_backend;
-	guint32 servers;
-	JMessage* message;
+
+	/**
+	 * The iterate cursor of client-side backends.
+	 **/
+	gpointer cursor;
+
+	/**
+	 * The path of the current object.
+	 **/
+	gchar const* current_path;
+
+	/**
+	 * The index of the server storing the current object.
+	 **/
+	guint32 current_index;
+
+	/**
+	 * The servers the paths are received from.
+	 * All requests are sent up front, so that the servers list their objects concurrently.
+	 **/
+	JObjectIteratorSource* sources;
+
+	/**
+	 * The number of sources.
+	 **/
+	guint32 sources_len;
+
+	/**
+	 * The source the paths are currently received from.
+	 **/
+	guint32 current_source;
 };
 
 /**
- * Creates a new JObjectIterator.
+ * Receives the next path from the server, receiving the next reply if necessary.
+ * Returns the connection to the pool once the end of the listing has been reached.
+ *
+ * \return The path or NULL if there are no more objects.
+ **/
+static
+gchar const*
+j_object_iterator_source_next (JObjectIteratorSource* source)
+{
+	gchar const* path = NULL;
+	guint32 len;
+
+	if (source->connection == NULL)
+	{
+		goto end;
+	}
+
+	if (source->remaining == 0)
+	{
+		if (!j_message_receive(source->reply, source->connection))
+		{
+			/* The connection is in an unknown state after a failed receive. */
+			j_connection_pool_discard_object(source->index, source->connection);
+			source->connection = NULL;
+			goto end;
+		}
+
+		source->remaining = j_message_get_count(source->reply);
+	}
+
+	source->remaining--;
+	len = j_message_get_varint(source->reply);
+
+	if (len > 0)
+	{
+		path = j_message_get_n(source->reply, len);
+		goto end;
+	}
+
+done:
+	j_connection_pool_push_object(source->index, source->connection);
+	source->connection = NULL;
+
+end:
+	return path;
+}
+
+/**
+ * Sends the request for the paths of a server, which are received lazily.
+ **/
+static
+void
+j_object_iterator_source_init (JObjectIteratorSource* source, guint32 index, gchar const* namespace, gchar const* prefix)
+{
+	g_autoptr(JMessage) message = NULL;
+	gsize namespace_len;
+	gsize prefix_len;
+
+	/* An empty prefix lists all objects. */
+	prefix = (prefix != NULL) ? prefix : "";
+
+	namespace_len = strlen(namespace) + 1;
+	prefix_len = strlen(prefix) + 1;
+
+	message = j_message_new(J_MESSAGE_OBJECT_LIST, namespace_len + prefix_len);
+	j_message_set_compact(message, j_connection_pool_get_compact_object(index));
+	j_message_append_n(message, namespace, namespace_len);
+	j_message_append_n(message, prefix, prefix_len);
+
+	source->index = index;
+	source->remaining = 0;
+	source->connection = j_connection_pool_pop_object(index);
+	j_message_send(message, source->connection);
+
+	source->reply = j_message_new_reply(message);
+}
+
+/**
+ * Creates a new JObjectIterator for all object servers.
+ * The paths of one server are returned before the ones of the next server, in no particular order.
+ * Distributed objects are returned once for every server storing a part of them.
  *
  * \author Michael Kuhn
  *
- * \param collection A JCollection.
+ * \code
+ * JObjectIterator* iterator;
+ *
+ * iterator = j_object_iterator_new("item", "collection/");
+ *
+ * while (j_object_iterator_next(iterator))
+ * {
+ *   guint64 index;
+ *   gchar const* path;
+ *
+ *   path = j_object_iterator_get(iterator, &index);
+ * }
+ *
+ * j_object_iterator_free(iterator);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param prefix    A path prefix, NULL to iterate over all objects.
  *
  * \return A new JObjectIterator.
  **/
 JObjectIterator*
-j_object_iterator_new (gchar const* namespace)
+j_object_iterator_new (gchar const* namespace, gchar const* prefix)
 {
 	JObjectIterator* iterator;
 
@@ -66,17 +223,45 @@ j_object_iterator_new (gchar const* namespace)
 
 	configuration = j_configuration();
 
+	/* Iterators do not use batches, so cached creates have to be executed first. */
+	j_batch_wait_cached();
+
 	iterator = g_slice_new(JObjectIterator);
-	iterator->namespace = g_strdup(namespace);
-	iterator->object_backend = j_object_backend();
-	iterator->servers = j_configuration_get_object_server_count(configuration);
-	iterator->message = NULL;
+	iterator->object_backend = j_object_backend_for_namespace(namespace);
+	iterator->cursor = NULL;
+	iterator->current_path = NULL;
+	iterator->current_index = 0;
+	iterator->sources = NULL;
+	iterator->sources_len = 0;
+	iterator->current_source = 0;
 
 	if (iterator->object_backend != NULL)
 	{
+		gboolean ret = FALSE;
+
+		if (prefix == NULL && iterator->object_backend->object.list != NULL)
+		{
+			ret = j_backend_object_list(iterator->object_backend, namespace, &(iterator->cursor));
+		}
+		else if (prefix != NULL && iterator->object_backend->object.list_by_prefix != NULL)
+		{
+			ret = j_backend_object_list_by_prefix(iterator->object_backend, namespace, prefix, &(iterator->cursor));
+		}
+
+		if (!ret)
+		{
+			iterator->cursor = NULL;
+		}
 	}
 	else
 	{
+		iterator->sources_len = j_configuration_get_object_server_count(configuration);
+		iterator->sources = g_new(JObjectIteratorSource, iterator->sources_len);
+
+		for (guint32 i = 0; i < iterator->sources_len; i++)
+		{
+			j_object_iterator_source_init(&(iterator->sources[i]), i, namespace, prefix);
+		}
 	}
 
 	return iterator;
@@ -94,27 +279,44 @@ j_object_iterator_free (JObjectIterator* iterator)
 {
 	g_return_if_fail(iterator != NULL);
 
-	if (iterator->message != NULL)
+	for (guint32 i = 0; i < iterator->sources_len; i++)
 	{
-		j_message_unref(iterator->message);
+		JObjectIteratorSource* source = &(iterator->sources[i]);
+
+		/* Drain the remaining replies, the connection could not be reused otherwise. */
+		while (source->connection != NULL)
+		{
+			j_object_iterator_source_next(source);
+		}
+
+		j_message_unref(source->reply);
 	}
 
-	g_free(iterator->namespace);
+	g_free(iterator->sources);
+
+	/* Backends only free their cursors once they are exhausted. */
+	while (iterator->cursor != NULL)
+	{
+		if (!j_backend_object_iterate(iterator->object_backend, iterator->cursor, &(iterator->current_path)))
+		{
+			iterator->cursor = NULL;
+		}
+	}
 
 	g_slice_free(JObjectIterator, iterator);
 }
 
 /**
- * Checks whether another item is available.
+ * Checks whether another object is available.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param iterator A collection iterator.
+ * \param iterator An object iterator.
  *
- * \return TRUE on success, FALSE if the end of the collection is reached.
+ * \return TRUE on success, FALSE if the end of the listing is reached.
  **/
 gboolean
 j_object_iterator_next (JObjectIterator* iterator)
@@ -125,34 +327,63 @@ j_object_iterator_next (JObjectIterator* iterator)
 
 	if (iterator->object_backend != NULL)
 	{
+		if (iterator->cursor != NULL)
+		{
+			ret = j_backend_object_iterate(iterator->object_backend, iterator->cursor, &(iterator->current_path));
+
+			/* The backend frees the cursor at the end. */
+			if (!ret)
+			{
+				iterator->cursor = NULL;
+			}
+		}
 	}
 	else
 	{
+		/* Continue with the next server once a server's paths have been consumed. */
+		while (!ret && iterator->current_source < iterator->sources_len)
+		{
+			JObjectIteratorSource* source = &(iterator->sources[iterator->current_source]);
+
+			if ((iterator->current_path = j_object_iterator_source_next(source)) != NULL)
+			{
+				iterator->current_index = source->index;
+				ret = TRUE;
+			}
+			else
+			{
+				iterator->current_source++;
+			}
+		}
 	}
 
 	return ret;
 }
 
 /**
- * Returns the current item.
+ * Returns the current object's path.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param iterator A collection iterator.
+ * \param iterator An object iterator.
+ * \param index    Returns the index of the server storing the object, can be NULL.
  *
- * \return A new item. Should be freed with j_object_unref().
+ * \return The path, which is only valid until the next call to j_object_iterator_next().
  **/
 gchar const*
 j_object_iterator_get (JObjectIterator* iterator, guint64* index)
 {
-	(void)index;
-
 	g_return_val_if_fail(iterator != NULL, NULL);
 
-	return NULL;
+	if (index != NULL)
+	{
+		*index = iterator->current_index;
+	}
+
+	return iterator->current_path;
 }
 
 /**
@@ -31,6 +31,7 @@
 #include <object/jobject.h>
 
 #include <julea.h>
+#include <julea-internal.h>
 
 /**
  * \defgroup JObject Object
@@ -71,11 +72,114 @@ struct JObjectOperation
 			guint64* bytes_written;
 		}
 		write;
+
+		struct
+		{
+			JObject* object;
+			gconstpointer data;
+			guint64 length;
+			guint64* offset;
+		}
+		append;
+
+		struct
+		{
+			JObject* object;
+			JReduce* reduce;
+			guint64 length;
+			guint64 offset;
+		}
+		reduce;
+
+		struct
+		{
+			JObject* object;
+			guint64 length;
+			guint64 offset;
+		}
+		extent;
+
+		struct
+		{
+			JObject* object;
+			guint64 length;
+			guint64 offset;
+			guint64* lengths;
+			guint64* offsets;
+			guint max_count;
+			guint* count;
+		}
+		extents;
+
+		struct
+		{
+			JObject* object;
+			JObject* to;
+			guint64* bytes_copied;
+		}
+		copy;
 	};
+
+	/**
+	 * The segments of a vectored read or write, NULL otherwise.
+	 * Each segment is a read or write of its own and shares the parent's bytes_read or bytes_written.
+	 */
+	struct JObjectOperation* segments;
+	guint segment_count;
+
+	/**
+	 * The data of a write aggregated by the write-behind buffer, NULL otherwise.
+	 */
+	struct JObjectWriteBehind* write_behind;
+
+	/**
+	 * The write's bytes_written once it has been cached, the caller's counter is updated immediately.
+	 */
+	guint64 cached_bytes_written;
+
+	/**
+	 * The buffer from j_buffer_alloc() holding a write's data, which is referenced instead of copied when caching the write.
+	 */
+	gpointer buffer;
 };
 
 typedef struct JObjectOperation JObjectOperation;
 
+/**
+ * Small contiguous writes aggregated into one write operation.
+ */
+struct JObjectWriteBehind
+{
+	/**
+	 * The aggregated data.
+	 */
+	GByteArray* data;
+
+	/**
+	 * The batch the write has been added to.
+	 */
+	JBatch* batch;
+
+	/**
+	 * The write's bytes_written, the callers' counters are updated immediately.
+	 */
+	guint64 bytes_written;
+};
+
+typedef struct JObjectWriteBehind JObjectWriteBehind;
+
+/**
+ * A segment of a vectored read or write, used to sort the segments by offset.
+ */
+struct JObjectSegment
+{
+	guint64 offset;
+	guint64 length;
+	guint index;
+};
+
+typedef struct JObjectSegment JObjectSegment;
+
 /**
  * A JObject.
  **/
@@ -96,6 +200,37 @@ struct JObject
 	 **/
 	gchar* name;
 
+	/**
+	 * The readahead, NULL if disabled.
+	 **/
+	JReadahead* readahead;
+
+	/**
+	 * Whether the modification time and size used to validate blocks of the node cache are known.
+	 * Both are fetched on the first read that uses the node cache and after the object has been changed.
+	 **/
+	gint node_cache_valid;
+	gint64 node_cache_modification_time;
+	guint64 node_cache_size;
+
+	/**
+	 * The write-behind buffer's size, 0 if disabled.
+	 **/
+	guint64 write_behind_size;
+
+	/**
+	 * The write that small writes are currently aggregated into, NULL if there is none.
+	 **/
+	JObjectOperation* write_behind;
+
+	/**
+	 * The server's handle if the object has been opened using j_object_open(), 0 otherwise.
+	 * Protected by #mutex.
+	 **/
+	guint64 handle;
+
+	GMutex mutex;
+
 	/**
 	 * The reference count.
 	 **/
@@ -120,6 +255,15 @@ j_object_delete_free (gpointer data)
 	j_object_unref(object);
 }
 
+static
+void
+j_object_open_free (gpointer data)
+{
+	JObject* object = data;
+
+	j_object_unref(object);
+}
+
 static
 void
 j_object_status_free (gpointer data)
@@ -127,227 +271,362 @@ j_object_status_free (gpointer data)
 	JObjectOperation* operation = data;
 
 	j_object_unref(operation->status.object);
-
-	g_slice_free(JObjectOperation, operation);
 }
 
 static
 void
-j_object_read_free (gpointer data)
+j_object_extent_free (gpointer data)
 {
 	JObjectOperation* operation = data;
 
-	j_object_unref(operation->read.object);
-
-	g_slice_free(JObjectOperation, operation);
+	j_object_unref(operation->extent.object);
 }
 
 static
 void
-j_object_write_free (gpointer data)
+j_object_extents_free (gpointer data)
 {
 	JObjectOperation* operation = data;
 
-	j_object_unref(operation->write.object);
+	j_object_unref(operation->extents.object);
+}
 
-	g_slice_free(JObjectOperation, operation);
+static
+void
+j_object_copy_free (gpointer data)
+{
+	JObjectOperation* operation = data;
+
+	j_object_unref(operation->copy.object);
+	j_object_unref(operation->copy.to);
 }
 
 static
-gboolean
-j_object_create_exec (JList* operations, JSemantics* semantics)
+void
+j_object_append_free (gpointer data)
 {
-	gboolean ret = FALSE;
+	JObjectOperation* operation = data;
 
-	JBackend* object_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) message = NULL;
-	gchar const* namespace;
-	gsize namespace_len;
-	guint32 index;
+	j_object_unref(operation->append.object);
+}
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+static
+void
+j_object_reduce_free (gpointer data)
+{
+	JObjectOperation* operation = data;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	j_object_unref(operation->reduce.object);
+}
 
-	{
-		JObject* object;
+static
+void
+j_object_read_free (gpointer data)
+{
+	JObjectOperation* operation = data;
 
-		object = j_list_get_first(operations);
-		g_assert(object != NULL);
+	j_object_unref(operation->read.object);
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
-		index = object->index;
-	}
+	g_free(operation->segments);
+}
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+/**
+ * Stops aggregating writes into the current write-behind buffer.
+ * The buffer's write stays part of its batch, so later operations are ordered after it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object    An object.
+ * \param operation The buffer's write, NULL to close any buffer.
+ **/
+static
+void
+j_object_write_behind_close (JObject* object, JObjectOperation* operation)
+{
+	g_mutex_lock(&(object->mutex));
 
-	if (object_backend == NULL)
+	if (operation == NULL || object->write_behind == operation)
 	{
-		/**
-		 * Force safe semantics to make the server send a reply.
-		 * Otherwise, nasty races can occur when using unsafe semantics:
-		 * - The client creates the item and sends its first write.
-		 * - The client sends another operation using another connection from the pool.
-		 * - The second operation is executed first and fails because the item does not exist.
-		 * This does not completely eliminate all races but fixes the common case of create, write, write, ...
-		 **/
-		message = j_message_new(J_MESSAGE_OBJECT_CREATE, namespace_len);
-		j_message_set_safety(message, semantics);
-		//j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
-		j_message_append_n(message, namespace, namespace_len);
+		object->write_behind = NULL;
 	}
 
-	while (j_list_iterator_next(it))
-	{
-		JObject* object = j_list_iterator_get(it);
-
-		if (object_backend != NULL)
-		{
-			gpointer object_handle;
+	g_mutex_unlock(&(object->mutex));
+}
 
-			ret = j_backend_object_create(object_backend, object->namespace, object->name, &object_handle) && ret;
-			ret = j_backend_object_close(object_backend, object_handle) && ret;
-		}
-		else
-		{
-			gsize name_len;
+static
+void
+j_object_write_free (gpointer data)
+{
+	JObjectOperation* operation = data;
 
-			name_len = strlen(object->name) + 1;
+	if (operation->write_behind != NULL)
+	{
+		j_object_write_behind_close(operation->write.object, operation);
 
-			j_message_add_operation(message, name_len);
-			j_message_append_n(message, object->name, name_len);
-		}
+		g_byte_array_unref(operation->write_behind->data);
+		g_slice_free(JObjectWriteBehind, operation->write_behind);
 	}
 
-	if (object_backend == NULL)
+	if (operation->buffer != NULL)
 	{
-		GSocketConnection* object_connection;
+		j_buffer_unref(operation->buffer);
+	}
 
-		object_connection = j_connection_pool_pop_object(index);
-		j_message_send(message, object_connection);
+	j_object_unref(operation->write.object);
 
-		if (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-		{
-			g_autoptr(JMessage) reply = NULL;
+	g_free(operation->segments);
+}
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, object_connection);
+/**
+ * Creates do not reference the caller's memory, so there is nothing to copy.
+ *
+ * \private
+ **/
+static
+void
+j_object_create_cache (gpointer data, gpointer buffer)
+{
+	(void)data;
+	(void)buffer;
+}
 
-			/* FIXME do something with reply */
-		}
+static
+guint64
+j_object_write_cache_size (gpointer data)
+{
+	JObjectOperation* operation = data;
 
-		j_connection_pool_push_object(index, object_connection);
+	/* The write-behind buffer already holds a copy. */
+	if (operation->write_behind != NULL)
+	{
+		return 0;
 	}
 
-	j_trace_leave(G_STRFUNC);
+	/* Data in a pooled buffer does not have to be copied. */
+	if (operation->buffer == NULL)
+	{
+		operation->buffer = j_buffer_ref(operation->write.data, operation->write.length);
+	}
 
-	return ret;
+	return (operation->buffer != NULL) ? 0 : operation->write.length;
 }
 
+/**
+ * Copies a write's data into the operation cache and reports it as written.
+ *
+ * \private
+ **/
 static
-gboolean
-j_object_delete_exec (JList* operations, JSemantics* semantics)
+void
+j_object_write_cache (gpointer data, gpointer buffer)
 {
-	gboolean ret = FALSE;
+	JObjectOperation* operation = data;
 
-	JBackend* object_backend;
-	g_autoptr(JListIterator) it = NULL;
-	g_autoptr(JMessage) message = NULL;
-	gchar const* namespace;
-	gsize namespace_len;
-	guint32 index;
+	if (operation->write_behind != NULL)
+	{
+		/* Later writes must not be appended to a buffer that is flushed in the background. */
+		j_object_write_behind_close(operation->write.object, operation);
+		return;
+	}
 
-	g_return_val_if_fail(operations != NULL, FALSE);
-	g_return_val_if_fail(semantics != NULL, FALSE);
+	if (operation->buffer == NULL)
+	{
+		memcpy(buffer, operation->write.data, operation->write.length);
+		operation->write.data = buffer;
+	}
 
-	j_trace_enter(G_STRFUNC, NULL);
+	j_helper_atomic_add(operation->write.bytes_written, operation->write.length);
+	operation->cached_bytes_written = 0;
+	operation->write.bytes_written = &(operation->cached_bytes_written);
+}
+
+static
+gint
+j_object_segment_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+	JObjectSegment const* segment_a = a;
+	JObjectSegment const* segment_b = b;
+	gboolean const* by_index = data;
 
+	if (!*by_index && segment_a->offset != segment_b->offset)
 	{
-		JObject* object;
+		return (segment_a->offset < segment_b->offset) ? -1 : 1;
+	}
 
-		object = j_list_get_first(operations);
-		g_assert(object != NULL);
+	return (segment_a->index < segment_b->index) ? -1 : (segment_a->index > segment_b->index) ? 1 : 0;
+}
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
-		index = object->index;
-	}
+/**
+ * Sorts the segments of a vectored access by offset, so the server can merge adjacent ones.
+ * Overlapping writes have to be applied in their original order, so they are not sorted.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param segments A segment array.
+ * \param count    The number of segments.
+ * \param write    Whether the segments are written.
+ **/
+static
+void
+j_object_segments_sort (JObjectSegment* segments, guint count, gboolean write)
+{
+	gboolean by_index = FALSE;
 
-	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+	g_qsort_with_data(segments, count, sizeof(JObjectSegment), j_object_segment_compare, &by_index);
 
-	if (object_backend == NULL)
+	if (!write)
 	{
-		message = j_message_new(J_MESSAGE_OBJECT_DELETE, namespace_len);
-		j_message_set_safety(message, semantics);
-		j_message_append_n(message, namespace, namespace_len);
+		return;
 	}
 
-	while (j_list_iterator_next(it))
+	for (guint i = 1; i < count; i++)
 	{
-		JObject* object = j_list_iterator_get(it);
-
-		if (object_backend != NULL)
+		if (segments[i - 1].offset + segments[i - 1].length > segments[i].offset)
 		{
-			gpointer object_handle;
+			by_index = TRUE;
+			g_qsort_with_data(segments, count, sizeof(JObjectSegment), j_object_segment_compare, &by_index);
 
-			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
-			ret = j_backend_object_delete(object_backend, object_handle) && ret;
+			break;
 		}
-		else
-		{
-			gsize name_len;
+	}
+}
 
-			name_len = strlen(object->name) + 1;
+/**
+ * Replaces vectored operations by their segments.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ *
+ * \return A list of reads or writes. Should be freed with j_list_unref().
+ **/
+static
+JList*
+j_object_expand (JList* operations)
+{
+	JList* expanded;
+	g_autoptr(JListIterator) it = NULL;
+	gboolean vectored = FALSE;
 
-			j_message_add_operation(message, name_len);
-			j_message_append_n(message, object->name, name_len);
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+
+		if (operation->segments != NULL)
+		{
+			vectored = TRUE;
+			break;
 		}
 	}
 
-	if (object_backend == NULL)
+	if (!vectored)
 	{
-		GSocketConnection* object_connection;
+		return j_list_ref(operations);
+	}
 
-		object_connection = j_connection_pool_pop_object(index);
-		j_message_send(message, object_connection);
+	j_list_iterator_free(it);
 
-		if (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-		{
-			g_autoptr(JMessage) reply = NULL;
+	expanded = j_list_new(NULL);
+	it = j_list_iterator_new(operations);
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, object_connection);
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
 
-			/* FIXME do something with reply */
+		if (operation->segments == NULL)
+		{
+			j_list_append(expanded, operation);
+			continue;
 		}
 
-		j_connection_pool_push_object(index, object_connection);
+		for (guint i = 0; i < operation->segment_count; i++)
+		{
+			j_list_append(expanded, &(operation->segments[i]));
+		}
 	}
 
-	j_trace_leave(G_STRFUNC);
+	return expanded;
+}
 
-	return ret;
+/**
+ * Creates a lock for the ranges of reads or writes if the semantics require atomicity.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object     An object.
+ * \param operations A list of reads or writes.
+ * \param semantics  A semantics object.
+ * \param mode       J_LOCK_MODE_SHARED for reads, J_LOCK_MODE_EXCLUSIVE for writes.
+ *
+ * \return A lock that has not been acquired yet, NULL if no lock is required.
+ **/
+static
+JLock*
+j_object_lock (JObject* object, JList* operations, JSemantics* semantics, JLockMode mode)
+{
+	JLock* lock;
+	g_autoptr(JListIterator) it = NULL;
+
+	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) == J_SEMANTICS_ATOMICITY_NONE)
+	{
+		return NULL;
+	}
+
+	lock = j_lock_new_for_mode(object->namespace, object->name, mode);
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+
+		if (mode == J_LOCK_MODE_EXCLUSIVE)
+		{
+			j_lock_add_range(lock, operation->write.offset, operation->write.length);
+		}
+		else
+		{
+			j_lock_add_range(lock, operation->read.offset, operation->read.length);
+		}
+	}
+
+	return lock;
 }
 
 static
 gboolean
-j_object_read_exec (JList* operations, JSemantics* semantics)
+j_object_create_exec (JList* operations, JSemantics* semantics)
 {
-	gboolean ret = TRUE;
+	gboolean ret = FALSE;
 
 	JBackend* object_backend;
-	JListIterator* it;
+	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) message = NULL;
-	JObject* object;
-	gpointer object_handle;
-
-	// FIXME
-	//JLock* lock = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 index;
+	guint32 key;
 
 	g_return_val_if_fail(operations != NULL, FALSE);
 	g_return_val_if_fail(semantics != NULL, FALSE);
@@ -355,139 +634,67 @@ j_object_read_exec (JList* operations, JSemantics* semantics)
 	j_trace_enter(G_STRFUNC, NULL);
 
 	{
-		JObjectOperation* operation = j_list_get_first(operations);
-
-		object = operation->status.object;
+		JObject* object;
 
-		g_assert(operation != NULL);
+		object = j_list_get_first(operations);
 		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+		index = object->index;
+		key = j_helper_hash(object->name);
 	}
 
 	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+	object_backend = j_object_backend_for_namespace(namespace);
 
-	if (object_backend != NULL)
-	{
-		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
-	}
-	else
+	if (object_backend == NULL)
 	{
-		gsize name_len;
-		gsize namespace_len;
-
-		namespace_len = strlen(object->namespace) + 1;
-		name_len = strlen(object->name) + 1;
-
-		message = j_message_new(J_MESSAGE_OBJECT_READ, namespace_len + name_len);
+		/**
+		 * The create does not have to wait for a reply even when using unsafe semantics.
+		 * All of the object's messages are sent in order, so following writes can not overtake it.
+		 **/
+		message = j_message_new(J_MESSAGE_OBJECT_CREATE, namespace_len);
 		j_message_set_safety(message, semantics);
-		j_message_append_n(message, object->namespace, namespace_len);
-		j_message_append_n(message, object->name, name_len);
-	}
-
-	/*
-	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) != J_SEMANTICS_ATOMICITY_NONE)
-	{
-		lock = j_lock_new("item", path);
+		j_message_append_n(message, namespace, namespace_len);
 	}
-	*/
 
 	while (j_list_iterator_next(it))
 	{
-		JObjectOperation* operation = j_list_iterator_get(it);
-		gpointer data = operation->read.data;
-		guint64 length = operation->read.length;
-		guint64 offset = operation->read.offset;
-		guint64* bytes_read = operation->read.bytes_read;
-
-		j_trace_file_begin(object->name, J_TRACE_FILE_READ);
+		JObject* object = j_list_iterator_get(it);
 
 		if (object_backend != NULL)
 		{
-			ret = j_backend_object_read(object_backend, object_handle, data, length, offset, bytes_read) && ret;
+			gpointer object_handle;
+
+			ret = j_backend_object_create(object_backend, object->namespace, object->name, &object_handle) && ret;
+			ret = j_backend_object_close(object_backend, object_handle) && ret;
 		}
 		else
 		{
-			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
-			j_message_append_8(message, &length);
-			j_message_append_8(message, &offset);
-		}
-
-		j_trace_file_end(object->name, J_TRACE_FILE_READ, length, offset);
-	}
+			gsize name_len;
 
-	j_list_iterator_free(it);
+			name_len = strlen(object->name) + 1;
 
-	if (object_backend != NULL)
-	{
-		ret = j_backend_object_close(object_backend, object_handle) && ret;
+			j_message_add_operation(message, name_len);
+			j_message_append_n(message, object->name, name_len);
+		}
 	}
-	else
+
+	if (object_backend == NULL)
 	{
 		g_autoptr(JMessage) reply = NULL;
-		GSocketConnection* object_connection;
-		guint32 operations_done;
-		guint32 operation_count;
-
-		object_connection = j_connection_pool_pop_object(object->index);
-		j_message_send(message, object_connection);
 
-		reply = j_message_new_reply(message);
-
-		operations_done = 0;
-		operation_count = j_message_get_count(message);
+		reply = j_connection_pool_request_object_ordered(index, key, message, (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0);
 
-		it = j_list_iterator_new(operations);
-
-		/**
-		 * This extra loop is necessary because the server might send multiple
-		 * replies per message. The same reply object can be used to receive
-		 * multiple times.
-		 */
-		while (operations_done < operation_count)
+		/* The request failed, timed out or was cancelled. */
+		if (reply == NULL && (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0)
 		{
-			guint32 reply_operation_count;
-
-			j_message_receive(reply, object_connection);
-
-			reply_operation_count = j_message_get_count(reply);
-
-			for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
-			{
-				JObjectOperation* operation = j_list_iterator_get(it);
-				gpointer data = operation->read.data;
-				guint64* bytes_read = operation->read.bytes_read;
-
-				guint64 nbytes;
-
-				nbytes = j_message_get_8(reply);
-				j_helper_atomic_add(bytes_read, nbytes);
-
-				if (nbytes > 0)
-				{
-					GInputStream* input;
-
-					input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
-					g_input_stream_read_all(input, data, nbytes, NULL, NULL, NULL);
-				}
-			}
-
-			operations_done += reply_operation_count;
+			ret = FALSE;
 		}
 
-		j_list_iterator_free(it);
-
-		j_connection_pool_push_object(object->index, object_connection);
-	}
-
-	/*
-	if (lock != NULL)
-	{
-		// FIXME busy wait
-		while (!j_lock_acquire(lock));
-
-		j_lock_free(lock);
+		/* FIXME do something with reply */
 	}
-	*/
 
 	j_trace_leave(G_STRFUNC);
 
@@ -496,18 +703,17 @@ j_object_read_exec (JList* operations, JSemantics* semantics)
 
 static
 gboolean
-j_object_write_exec (JList* operations, JSemantics* semantics)
+j_object_delete_exec (JList* operations, JSemantics* semantics)
 {
-	gboolean ret = TRUE;
+	gboolean ret = FALSE;
 
 	JBackend* object_backend;
-	JListIterator* it;
+	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) message = NULL;
-	JObject* object;
-	gpointer object_handle;
-
-	// FIXME
-	//JLock* lock = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 index;
+	guint32 key;
 
 	g_return_val_if_fail(operations != NULL, FALSE);
 	g_return_val_if_fail(semantics != NULL, FALSE);
@@ -515,144 +721,195 @@ j_object_write_exec (JList* operations, JSemantics* semantics)
 	j_trace_enter(G_STRFUNC, NULL);
 
 	{
-		JObjectOperation* operation = j_list_get_first(operations);
-
-		object = operation->status.object;
+		JObject* object;
 
-		g_assert(operation != NULL);
+		object = j_list_get_first(operations);
 		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+		index = object->index;
+		key = j_helper_hash(object->name);
 	}
 
 	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
+	object_backend = j_object_backend_for_namespace(namespace);
 
-	if (object_backend != NULL)
-	{
-		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
-	}
-	else
+	if (object_backend == NULL)
 	{
-		gsize name_len;
-		gsize namespace_len;
-
-		namespace_len = strlen(object->namespace) + 1;
-		name_len = strlen(object->name) + 1;
-
-		message = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + name_len);
+		message = j_message_new(J_MESSAGE_OBJECT_DELETE, namespace_len);
 		j_message_set_safety(message, semantics);
-		j_message_append_n(message, object->namespace, namespace_len);
-		j_message_append_n(message, object->name, name_len);
-	}
-
-	/*
-	if (j_semantics_get(semantics, J_SEMANTICS_ATOMICITY) != J_SEMANTICS_ATOMICITY_NONE)
-	{
-		lock = j_lock_new("item", path);
+		j_message_append_n(message, namespace, namespace_len);
 	}
-	*/
 
 	while (j_list_iterator_next(it))
 	{
-		JObjectOperation* operation = j_list_iterator_get(it);
-		gconstpointer data = operation->write.data;
-		guint64 length = operation->write.length;
-		guint64 offset = operation->write.offset;
-		guint64* bytes_written = operation->write.bytes_written;
-
-		j_trace_file_begin(object->name, J_TRACE_FILE_WRITE);
+		JObject* object = j_list_iterator_get(it);
 
-		/*
-		if (lock != NULL)
+		if (object_backend != NULL)
 		{
-			j_lock_add(lock, block_id);
-		}
-		*/
+			gpointer object_handle;
 
-		if (object_backend != NULL)
-		{
-			ret = j_backend_object_write(object_backend, object_handle, data, length, offset, bytes_written) && ret;
+			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+			ret = j_backend_object_delete(object_backend, object_handle) && ret;
 		}
 		else
 		{
-			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
-			j_message_append_8(message, &length);
-			j_message_append_8(message, &offset);
-			j_message_add_send(message, data, length);
+			gsize name_len;
+
+			name_len = strlen(object->name) + 1;
+
+			j_message_add_operation(message, name_len);
+			j_message_append_n(message, object->name, name_len);
 		}
+	}
 
-		j_trace_file_end(object->name, J_TRACE_FILE_WRITE, length, offset);
+	if (object_backend == NULL)
+	{
+		g_autoptr(JMessage) reply = NULL;
 
-		if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+		reply = j_connection_pool_request_object_ordered(index, key, message, (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0);
+
+		/* The request failed, timed out or was cancelled. */
+		if (reply == NULL && (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0)
 		{
-			j_helper_atomic_add(bytes_written, length);
+			ret = FALSE;
 		}
+
+		/* FIXME do something with reply */
 	}
 
-	j_list_iterator_free(it);
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+guint64
+j_object_get_handle (JObject* object)
+{
+	guint64 handle;
+
+	g_mutex_lock(&(object->mutex));
+	handle = object->handle;
+	g_mutex_unlock(&(object->mutex));
+
+	return handle;
+}
+
+/**
+ * Opens objects on their server, so that following reads, writes and status requests can refer to them using a handle.
+ * Objects that are already open are skipped.
+ *
+ * \private
+ **/
+static
+gboolean
+j_object_open_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GPtrArray) opened = NULL;
+	g_autoptr(GHashTable) seen = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	guint32 index;
+	guint32 key;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
 
-	if (object_backend != NULL)
 	{
-		ret = j_backend_object_close(object_backend, object_handle) && ret;
+		JObject* object;
+
+		object = j_list_get_first(operations);
+		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+		index = object->index;
+		key = j_helper_hash(object->name);
 	}
-	else
+
+	/* Local backends do not need handles, because objects are not looked up by a server. */
+	if (j_object_backend_for_namespace(namespace) != NULL)
 	{
-		GSocketConnection* object_connection;
+		return TRUE;
+	}
 
-		object_connection = j_connection_pool_pop_object(object->index);
-		j_message_send(message, object_connection);
+	j_trace_enter(G_STRFUNC, NULL);
 
-		if (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-		{
-			g_autoptr(JMessage) reply = NULL;
-			guint64 nbytes;
+	it = j_list_iterator_new(operations);
+	opened = g_ptr_array_new();
+	seen = g_hash_table_new(NULL, NULL);
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, object_connection);
+	message = j_message_new(J_MESSAGE_OBJECT_OPEN, namespace_len);
+	j_message_set_safety(message, semantics);
+	j_message_append_n(message, namespace, namespace_len);
 
-			it = j_list_iterator_new(operations);
+	while (j_list_iterator_next(it))
+	{
+		JObject* object = j_list_iterator_get(it);
+		gsize name_len;
 
-			while (j_list_iterator_next(it))
-			{
-				JObjectOperation* operation = j_list_iterator_get(it);
-				guint64* bytes_written = operation->write.bytes_written;
+		if (j_object_get_handle(object) != 0 || !g_hash_table_add(seen, object))
+		{
+			continue;
+		}
 
-				nbytes = j_message_get_8(reply);
-				j_helper_atomic_add(bytes_written, nbytes);
-			}
+		name_len = strlen(object->name) + 1;
 
-			j_list_iterator_free(it);
-		}
+		j_message_add_operation(message, name_len);
+		j_message_append_n(message, object->name, name_len);
 
-		j_connection_pool_push_object(object->index, object_connection);
+		g_ptr_array_add(opened, object);
 	}
 
-	/*
-	if (lock != NULL)
+	if (opened->len > 0)
 	{
-		// FIXME busy wait
-		while (!j_lock_acquire(lock));
+		g_autoptr(JMessage) reply = NULL;
 
-		j_lock_free(lock);
+		/* The handles are needed by the following operations, so the reply has to be waited for. */
+		reply = j_connection_pool_request_object_ordered(index, key, message, TRUE);
+		ret = (reply != NULL);
+
+		for (guint i = 0; reply != NULL && i < opened->len; i++)
+		{
+			JObject* object = g_ptr_array_index(opened, i);
+			guint64 handle;
+
+			/* Objects that could not be opened keep using their namespace and path. */
+			handle = j_message_get_8(reply);
+			ret = (handle != 0) && ret;
+
+			g_mutex_lock(&(object->mutex));
+			object->handle = handle;
+			g_mutex_unlock(&(object->mutex));
+		}
 	}
-	*/
 
 	j_trace_leave(G_STRFUNC);
 
 	return ret;
 }
 
+/**
+ * Closes the handles of objects, which refer to their objects by namespace and path again afterwards.
+ *
+ * \private
+ **/
 static
 gboolean
-j_object_status_exec (JList* operations, JSemantics* semantics)
+j_object_close_exec (JList* operations, JSemantics* semantics)
 {
-	gboolean ret = FALSE;
+	gboolean ret = TRUE;
 
-	JBackend* object_backend;
-	JListIterator* it;
+	g_autoptr(JListIterator) it = NULL;
 	g_autoptr(JMessage) message = NULL;
-	gchar const* namespace;
-	gsize namespace_len;
 	guint32 index;
+	guint32 key;
 
 	g_return_val_if_fail(operations != NULL, FALSE);
 	g_return_val_if_fail(semantics != NULL, FALSE);
@@ -660,336 +917,3178 @@ j_object_status_exec (JList* operations, JSemantics* semantics)
 	j_trace_enter(G_STRFUNC, NULL);
 
 	{
-		JObjectOperation* operation = j_list_get_first(operations);
-		JObject* object = operation->status.object;
+		JObject* object;
 
-		g_assert(operation != NULL);
+		object = j_list_get_first(operations);
 		g_assert(object != NULL);
 
-		namespace = object->namespace;
-		namespace_len = strlen(namespace) + 1;
 		index = object->index;
+		key = j_helper_hash(object->name);
 	}
 
 	it = j_list_iterator_new(operations);
-	object_backend = j_object_backend();
 
-	if (object_backend == NULL)
+	while (j_list_iterator_next(it))
 	{
-		message = j_message_new(J_MESSAGE_OBJECT_STATUS, namespace_len);
-		j_message_set_safety(message, semantics);
-		j_message_append_n(message, namespace, namespace_len);
+		JObject* object = j_list_iterator_get(it);
+		guint64 handle;
+
+		g_mutex_lock(&(object->mutex));
+		handle = object->handle;
+		object->handle = 0;
+		g_mutex_unlock(&(object->mutex));
+
+		if (handle == 0)
+		{
+			continue;
+		}
+
+		if (message == NULL)
+		{
+			message = j_message_new(J_MESSAGE_OBJECT_CLOSE, 0);
+			j_message_set_safety(message, semantics);
+		}
+
+		j_message_add_operation(message, sizeof(guint64));
+		j_message_append_8(message, &handle);
 	}
 
-	while (j_list_iterator_next(it))
+	if (message != NULL)
 	{
-		JObjectOperation* operation = j_list_iterator_get(it);
-		JObject* object = operation->status.object;
-		gint64* modification_time = operation->status.modification_time;
-		guint64* size = operation->status.size;
+		g_autoptr(JMessage) reply = NULL;
 
-		if (object_backend != NULL)
-		{
-			gpointer object_handle;
+		/* Closes are ordered after the object's previous messages, which might still use the handle. */
+		reply = j_connection_pool_request_object_ordered(index, key, message, (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0);
 
-			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
-			ret = j_backend_object_status(object_backend, object_handle, modification_time, size) && ret;
-			ret = j_backend_object_close(object_backend, object_handle) && ret;
+		/* The request failed, timed out or was cancelled. */
+		if (reply == NULL && (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0)
+		{
+			ret = FALSE;
 		}
-		else
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Creates a read or write message, which refers to the object using its handle if it has been opened.
+ *
+ * \private
+ **/
+static
+JMessage*
+j_object_message_new (JObject* object, JMessageType type)
+{
+	JMessage* message;
+	guint64 handle;
+
+	if ((handle = j_object_get_handle(object)) != 0)
+	{
+		message = j_message_new(type, sizeof(guint64));
+		j_message_set_handle(message, TRUE);
+		j_message_append_8(message, &handle);
+	}
+	else
+	{
+		gsize name_len;
+		gsize namespace_len;
+
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		message = j_message_new(type, namespace_len + name_len);
+		j_message_append_n(message, object->namespace, namespace_len);
+		j_message_append_n(message, object->name, name_len);
+	}
+
+	return message;
+}
+
+/**
+ * Returns the node cache shared by all objects, NULL if it is disabled.
+ **/
+static
+JNodeCache*
+j_object_get_node_cache (void)
+{
+	static gsize initialized = 0;
+	static JNodeCache* node_cache = NULL;
+
+	if (g_once_init_enter(&initialized))
+	{
+		gchar const* path;
+
+		path = j_configuration_get_node_cache(j_configuration());
+
+		if (path != NULL)
 		{
-			gsize name_len;
+			node_cache = j_node_cache_new(path);
+		}
 
-			name_len = strlen(object->name) + 1;
+		g_once_init_leave(&initialized, 1);
+	}
 
-			j_message_add_operation(message, name_len);
-			j_message_append_n(message, object->name, name_len);
+	return node_cache;
+}
+
+static gboolean j_object_node_cache_read (JObject*, JObjectOperation*);
+
+static
+void
+j_object_region_free (gpointer data)
+{
+	/* Empty operations do not have a region. */
+	if (data != NULL)
+	{
+		j_transport_region_free(data);
+	}
+}
+
+/**
+ * Registers the buffers of reads or writes, so that the server can access them using RDMA.
+ * For local servers, the regions are allocated from shared memory instead.
+ *
+ * \private
+ *
+ * \param copy Whether the buffers' contents have to be copied to shared memory.
+ *
+ * \return The operations' regions or NULL if the payloads have to be sent over the connection.
+ **/
+static
+GPtrArray*
+j_object_regions_new (JObject* object, JList* operations, gboolean copy)
+{
+	GPtrArray* regions;
+	JListIterator* it;
+	JTransportShm* shm;
+
+	shm = j_connection_pool_get_shm_object(object->index);
+
+	if (shm == NULL && !j_connection_pool_get_rdma_object(object->index))
+	{
+		return NULL;
+	}
+
+	regions = g_ptr_array_new_with_free_func(j_object_region_free);
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JTransportRegion* region = NULL;
+
+		/* Reads and writes share the layout of their buffers. */
+		if (operation->read.length > 0)
+		{
+			if (shm != NULL)
+			{
+				region = j_transport_shm_region_new(shm, operation->read.data, operation->read.length, copy);
+			}
+			else
+			{
+				region = j_transport_region_new(operation->read.data, operation->read.length);
+			}
+
+			/* All operations of a message have to use the same transport. */
+			if (region == NULL)
+			{
+				g_ptr_array_unref(regions);
+				regions = NULL;
+				break;
+			}
 		}
+
+		g_ptr_array_add(regions, region);
 	}
 
 	j_list_iterator_free(it);
 
-	if (object_backend == NULL)
+	return regions;
+}
+
+/**
+ * Appends the regions to a message, after the lengths and offsets of all operations.
+ *
+ * \private
+ **/
+static
+void
+j_object_regions_append (JMessage* message, GPtrArray* regions)
+{
+	for (guint i = 0; i < regions->len; i++)
 	{
-		g_autoptr(JMessage) reply = NULL;
-		GSocketConnection* object_connection;
+		JTransportRegion* region = g_ptr_array_index(regions, i);
+		JTransportRemote remote = { 0, 0 };
 
-		object_connection = j_connection_pool_pop_object(index);
-		j_message_send(message, object_connection);
+		if (region != NULL)
+		{
+			j_transport_region_get_remote(region, &remote);
+		}
 
-		reply = j_message_new_reply(message);
-		j_message_receive(reply, object_connection);
+		j_message_append_8(message, &(remote.address));
+		j_message_append_8(message, &(remote.key));
+	}
+}
+
+static
+gboolean
+j_object_read_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JList) expanded = NULL;
+	JListIterator* it;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GPtrArray) regions = NULL;
+	JObject* object;
+	gpointer object_handle;
+
+	/* Only used if the backend supports vectored I/O. */
+	g_autofree gpointer* extent_buffers = NULL;
+	g_autofree guint64* extent_lengths = NULL;
+	g_autofree guint64* extent_offsets = NULL;
+	g_autofree guint64* extent_nbytes = NULL;
+	g_autofree guint64** extent_counters = NULL;
+	guint extent_count = 0;
+
+	JLock* lock;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		object = operation->status.object;
+
+		g_assert(operation != NULL);
+		g_assert(object != NULL);
+	}
+
+	expanded = j_object_expand(operations);
+
+	/* Reads served by the node cache do not have to be sent to the servers, it is only used for remote objects. */
+	if (j_object_get_node_cache() != NULL && j_object_backend_for_namespace(object->namespace) == NULL && j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) != J_SEMANTICS_CONSISTENCY_IMMEDIATE)
+	{
+		JList* remaining;
+
+		remaining = j_list_new(NULL);
+		it = j_list_iterator_new(expanded);
+
+		while (j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+
+			if (!j_object_node_cache_read(object, operation))
+			{
+				j_list_append(remaining, operation);
+			}
+		}
+
+		j_list_iterator_free(it);
+		j_list_unref(expanded);
+
+		expanded = remaining;
+
+		if (j_list_length(expanded) == 0)
+		{
+			j_trace_leave(G_STRFUNC);
+
+			return TRUE;
+		}
+	}
+
+	/* Reads served by the readahead do not have to be sent to the servers. */
+	if (object->readahead != NULL && j_semantics_get(semantics, J_SEMANTICS_CONSISTENCY) != J_SEMANTICS_CONSISTENCY_IMMEDIATE)
+	{
+		JList* remaining;
+
+		remaining = j_list_new(NULL);
+		it = j_list_iterator_new(expanded);
+
+		while (j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+
+			if (!j_readahead_read(object->readahead, operation->read.data, operation->read.length, operation->read.offset, operation->read.bytes_read))
+			{
+				j_list_append(remaining, operation);
+			}
+		}
+
+		j_list_iterator_free(it);
+		j_list_unref(expanded);
+
+		expanded = remaining;
+
+		if (j_list_length(expanded) == 0)
+		{
+			j_trace_leave(G_STRFUNC);
+
+			return TRUE;
+		}
+	}
+
+	it = j_list_iterator_new(expanded);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+
+		/* All extents are collected and handed to the backend at once. */
+		if (object_backend->object.readv != NULL)
+		{
+			guint length = j_list_length(expanded);
+
+			extent_buffers = g_new(gpointer, length);
+			extent_lengths = g_new(guint64, length);
+			extent_offsets = g_new(guint64, length);
+			extent_counters = g_new(guint64*, length);
+		}
+	}
+	else
+	{
+		message = j_object_message_new(object, J_MESSAGE_OBJECT_READ);
+		j_message_set_compact(message, j_connection_pool_get_compact_object(object->index));
+		j_message_set_safety(message, semantics);
+		j_message_set_access(message, semantics);
+
+		/* The server writes the data to the registered buffers directly. */
+		if ((regions = j_object_regions_new(object, expanded, FALSE)) != NULL)
+		{
+			j_message_set_rdma(message, TRUE);
+		}
+	}
+
+	lock = j_object_lock(object, expanded, semantics, J_LOCK_MODE_SHARED);
+
+	if (lock != NULL)
+	{
+		ret = j_lock_acquire(lock) && ret;
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		gpointer data = operation->read.data;
+		guint64 length = operation->read.length;
+		guint64 offset = operation->read.offset;
+		guint64* bytes_read = operation->read.bytes_read;
+
+		j_trace_file_begin(object->name, J_TRACE_FILE_READ);
+
+		if (extent_buffers != NULL)
+		{
+			extent_buffers[extent_count] = data;
+			extent_lengths[extent_count] = length;
+			extent_offsets[extent_count] = offset;
+			extent_counters[extent_count] = bytes_read;
+			extent_count++;
+		}
+		else if (object_backend != NULL)
+		{
+			guint64 nbytes = 0;
+
+			ret = j_backend_object_read(object_backend, object_handle, data, length, offset, &nbytes) && ret;
+			j_helper_atomic_add(bytes_read, nbytes);
+		}
+		else
+		{
+			/* Also reserve space for the operation's region. */
+			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64) + ((regions != NULL) ? 2 * sizeof(guint64) : 0));
+			j_message_append_varint(message, length);
+			j_message_append_varint(message, offset);
+		}
+
+		j_trace_file_end(object->name, J_TRACE_FILE_READ, length, offset);
+	}
+
+	j_list_iterator_free(it);
+
+	if (regions != NULL)
+	{
+		j_object_regions_append(message, regions);
+	}
+
+	if (extent_count > 0)
+	{
+		extent_nbytes = g_new(guint64, extent_count);
+
+		ret = j_backend_object_readv(object_backend, object_handle, extent_buffers, extent_lengths, extent_offsets, extent_count, extent_nbytes) && ret;
+
+		for (guint i = 0; i < extent_count; i++)
+		{
+			j_helper_atomic_add(extent_counters[i], extent_nbytes[i]);
+		}
+	}
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		g_autoptr(JMessage) reply = NULL;
+		GSocketConnection* object_connection;
+		guint32 operations_done;
+		guint32 operation_count;
+		guint index = 0;
+
+		object_connection = j_connection_pool_pop_object_ordered(object->index, j_helper_hash(object->name));
+		j_message_send(message, object_connection);
+
+		reply = j_message_new_reply(message);
+
+		operations_done = 0;
+		operation_count = j_message_get_count(message);
+
+		it = j_list_iterator_new(expanded);
+
+		/**
+		 * This extra loop is necessary because the server might send multiple
+		 * replies per message. The same reply object can be used to receive
+		 * multiple times.
+		 */
+		while (operations_done < operation_count)
+		{
+			guint32 reply_operation_count;
+
+			j_message_receive(reply, object_connection);
+
+			reply_operation_count = j_message_get_count(reply);
+
+			for (guint i = 0; i < reply_operation_count && j_list_iterator_next(it); i++)
+			{
+				JObjectOperation* operation = j_list_iterator_get(it);
+				gpointer data = operation->read.data;
+				guint64* bytes_read = operation->read.bytes_read;
+
+				guint64 nbytes;
+
+				nbytes = j_message_get_varint(reply);
+
+				/* Data written using RDMA is already in place, data written to shared memory has to be copied. */
+				if (nbytes > 0 && regions != NULL)
+				{
+					j_transport_region_sync(g_ptr_array_index(regions, index), nbytes);
+				}
+				else if (nbytes > 0)
+				{
+					GInputStream* input;
+
+					input = g_io_stream_get_input_stream(G_IO_STREAM(object_connection));
+					g_input_stream_read_all(input, data, nbytes, NULL, NULL, NULL);
+				}
+
+				j_helper_atomic_add(bytes_read, nbytes);
+				index++;
+			}
+
+			operations_done += reply_operation_count;
+		}
+
+		j_list_iterator_free(it);
+
+		j_connection_pool_push_object(object->index, object_connection);
+	}
+
+	if (lock != NULL)
+	{
+		/* Freeing the lock releases it. */
+		j_lock_free(lock);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Reads data for the readahead.
+ * The read is executed directly instead of using a batch, so it does not hold a reference to the object.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data       An object.
+ * \param buffer     A buffer to hold the read data.
+ * \param length     Number of bytes to read.
+ * \param offset     An offset within the object.
+ * \param bytes_read Number of bytes read.
+ **/
+static
+void
+j_object_readahead_fetch (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JObject* object = data;
+	JObjectOperation operation;
+	g_autoptr(JList) operations = NULL;
+	g_autoptr(JSemantics) semantics = NULL;
+
+	operation.read.object = object;
+	operation.read.data = buffer;
+	operation.read.length = length;
+	operation.read.offset = offset;
+	operation.read.bytes_read = bytes_read;
+	operation.segments = NULL;
+	operation.segment_count = 0;
+
+	operations = j_list_new(NULL);
+	j_list_append(operations, &operation);
+
+	/* Immediate consistency bypasses the readahead, so the read is not served by the readahead itself. */
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_semantics_set(semantics, J_SEMANTICS_CONSISTENCY, J_SEMANTICS_CONSISTENCY_IMMEDIATE);
+
+	j_object_read_exec(operations, semantics);
+}
+
+static
+gboolean
+j_object_write_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JList) expanded = NULL;
+	JListIterator* it;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GPtrArray) regions = NULL;
+	JObject* object;
+	gpointer object_handle;
+
+	/* Only used if the backend supports vectored I/O. */
+	g_autofree gconstpointer* extent_buffers = NULL;
+	g_autofree guint64* extent_lengths = NULL;
+	g_autofree guint64* extent_offsets = NULL;
+	g_autofree guint64* extent_nbytes = NULL;
+	g_autofree guint64** extent_counters = NULL;
+	guint extent_count = 0;
+
+	JLock* lock;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		object = operation->status.object;
+
+		g_assert(operation != NULL);
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+
+	/* Aggregated writes must not grow while they are executed. */
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+
+		if (operation->write_behind != NULL)
+		{
+			j_object_write_behind_close(object, operation);
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	expanded = j_object_expand(operations);
+
+	it = j_list_iterator_new(expanded);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+
+		/* All extents are collected and handed to the backend at once. */
+		if (object_backend->object.writev != NULL)
+		{
+			guint length = j_list_length(expanded);
+
+			extent_buffers = g_new(gconstpointer, length);
+			extent_lengths = g_new(guint64, length);
+			extent_offsets = g_new(guint64, length);
+			extent_counters = g_new(guint64*, length);
+		}
+	}
+	else
+	{
+		message = j_object_message_new(object, J_MESSAGE_OBJECT_WRITE);
+		j_message_set_compact(message, j_connection_pool_get_compact_object(object->index));
+		j_message_set_safety(message, semantics);
+
+		/* The buffers have to stay registered until the server has read them, which is only known if it replies. */
+		if ((j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) && (regions = j_object_regions_new(object, expanded, TRUE)) != NULL)
+		{
+			j_message_set_rdma(message, TRUE);
+		}
+	}
+
+	lock = j_object_lock(object, expanded, semantics, J_LOCK_MODE_EXCLUSIVE);
+
+	if (lock != NULL)
+	{
+		ret = j_lock_acquire(lock) && ret;
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		gconstpointer data = operation->write.data;
+		guint64 length = operation->write.length;
+		guint64 offset = operation->write.offset;
+		guint64* bytes_written = operation->write.bytes_written;
+
+		j_trace_file_begin(object->name, J_TRACE_FILE_WRITE);
+
+		if (extent_buffers != NULL)
+		{
+			extent_buffers[extent_count] = data;
+			extent_lengths[extent_count] = length;
+			extent_offsets[extent_count] = offset;
+			extent_counters[extent_count] = bytes_written;
+			extent_count++;
+		}
+		else if (object_backend != NULL)
+		{
+			guint64 nbytes = 0;
+
+			ret = j_backend_object_write(object_backend, object_handle, data, length, offset, &nbytes) && ret;
+			j_helper_atomic_add(bytes_written, nbytes);
+		}
+		else
+		{
+			/* Also reserve space for the operation's region. */
+			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64) + ((regions != NULL) ? 2 * sizeof(guint64) : 0));
+			j_message_append_varint(message, length);
+			j_message_append_varint(message, offset);
+
+			/* The server reads the data from the registered buffers directly. */
+			if (regions == NULL)
+			{
+				j_message_add_send(message, data, length);
+			}
+		}
+
+		j_trace_file_end(object->name, J_TRACE_FILE_WRITE, length, offset);
+
+		if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+		{
+			j_helper_atomic_add(bytes_written, length);
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	if (regions != NULL)
+	{
+		j_object_regions_append(message, regions);
+	}
+
+	if (extent_count > 0)
+	{
+		extent_nbytes = g_new(guint64, extent_count);
+
+		ret = j_backend_object_writev(object_backend, object_handle, extent_buffers, extent_lengths, extent_offsets, extent_count, FALSE, extent_nbytes) && ret;
+
+		for (guint i = 0; i < extent_count; i++)
+		{
+			j_helper_atomic_add(extent_counters[i], extent_nbytes[i]);
+		}
+	}
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		g_autoptr(JMessage) reply = NULL;
+		gboolean wait;
+
+		wait = (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0;
+		reply = j_connection_pool_request_object_ordered(object->index, j_helper_hash(object->name), message, wait);
+
+		/* The request failed, timed out or was cancelled. */
+		if (reply == NULL && wait)
+		{
+			ret = FALSE;
+		}
+
+		if (reply != NULL)
+		{
+			guint64 nbytes;
+
+			it = j_list_iterator_new(expanded);
+
+			while (j_list_iterator_next(it))
+			{
+				JObjectOperation* operation = j_list_iterator_get(it);
+				guint64* bytes_written = operation->write.bytes_written;
+
+				nbytes = j_message_get_varint(reply);
+				j_helper_atomic_add(bytes_written, nbytes);
+			}
+
+			j_list_iterator_free(it);
+		}
+	}
+
+	if (lock != NULL)
+	{
+		/* Freeing the lock releases it. */
+		j_lock_free(lock);
+	}
+
+	/* Prefetched data may predate the writes. */
+	if (object->readahead != NULL)
+	{
+		j_readahead_invalidate(object->readahead);
+	}
+
+	g_atomic_int_set(&(object->node_cache_valid), FALSE);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * What the chunks of device reads and writes are transferred with.
+ */
+struct JObjectDevice
+{
+	JObject* object;
+	JSemantics* semantics;
+};
+
+typedef struct JObjectDevice JObjectDevice;
+
+/**
+ * Reads a chunk of a device read into a bounce buffer.
+ *
+ * \private
+ **/
+static
+void
+j_object_device_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JObjectDevice* device = data;
+	JObjectOperation operation;
+	g_autoptr(JList) operations = NULL;
+
+	operation.read.object = device->object;
+	operation.read.data = buffer;
+	operation.read.length = length;
+	operation.read.offset = offset;
+	operation.read.bytes_read = bytes_read;
+	operation.segments = NULL;
+	operation.segment_count = 0;
+
+	operations = j_list_new(NULL);
+	j_list_append(operations, &operation);
+
+	j_object_read_exec(operations, device->semantics);
+}
+
+/**
+ * Writes a chunk of a device write from a bounce buffer.
+ *
+ * \private
+ **/
+static
+void
+j_object_device_write (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JObjectDevice* device = data;
+	JObjectOperation operation;
+	g_autoptr(JList) operations = NULL;
+
+	operation.write.object = device->object;
+	operation.write.data = buffer;
+	operation.write.length = length;
+	operation.write.offset = offset;
+	operation.write.bytes_written = bytes_written;
+	operation.segments = NULL;
+	operation.segment_count = 0;
+	operation.write_behind = NULL;
+
+	operations = j_list_new(NULL);
+	j_list_append(operations, &operation);
+
+	j_object_write_exec(operations, device->semantics);
+}
+
+/**
+ * Executes reads into device memory.
+ *
+ * \private
+ **/
+static
+gboolean
+j_object_read_device_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JObjectDevice device;
+
+		device.object = operation->read.object;
+		device.semantics = semantics;
+
+		ret = j_device_read(operation->read.data, operation->read.length, operation->read.offset, operation->read.bytes_read, j_object_device_read, &device) && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Executes writes from device memory.
+ * Unsafe writes might only be sent once the batch has been executed, which is too late for the reused bounce buffers, so every chunk waits for its reply.
+ *
+ * \private
+ **/
+static
+gboolean
+j_object_write_device_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(JSemantics) chunk_semantics = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	chunk_semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	for (JSemanticsType key = J_SEMANTICS_ATOMICITY; key <= J_SEMANTICS_ACCESS; key++)
+	{
+		j_semantics_set(chunk_semantics, key, j_semantics_get(semantics, key));
+	}
+
+	if (j_semantics_get(semantics, J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+	{
+		j_semantics_set(chunk_semantics, J_SEMANTICS_SAFETY, J_SEMANTICS_SAFETY_NETWORK);
+	}
+
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JObjectDevice device;
+
+		device.object = operation->write.object;
+		device.semantics = chunk_semantics;
+
+		ret = j_device_write(operation->write.data, operation->write.length, operation->write.offset, operation->write.bytes_written, j_object_device_write, &device) && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Appends data to an object, the offsets are assigned by the server.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of append operations, all for the same object.
+ * \param semantics  A semantics object.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_object_append_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	g_autoptr(JMessage) message = NULL;
+	JObject* object;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->append.object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		/* Without a server, appends of this process are serialized locally. */
+		G_LOCK_DEFINE_STATIC(j_object_append);
+		gpointer object_handle;
+
+		G_LOCK(j_object_append);
+
+		if (j_backend_object_open(object_backend, object->namespace, object->name, &object_handle)
+		    || j_backend_object_create(object_backend, object->namespace, object->name, &object_handle))
+		{
+			while (j_list_iterator_next(it))
+			{
+				JObjectOperation* operation = j_list_iterator_get(it);
+				guint64 nbytes = 0;
+				guint64 size = 0;
+
+				ret = j_backend_object_status(object_backend, object_handle, NULL, &size) && ret;
+				ret = j_backend_object_write(object_backend, object_handle, operation->append.data, operation->append.length, size, &nbytes) && ret;
+				ret = (nbytes == operation->append.length) && ret;
+
+				*(operation->append.offset) = size;
+			}
+
+			ret = j_backend_object_close(object_backend, object_handle) && ret;
+		}
+		else
+		{
+			ret = FALSE;
+		}
+
+		G_UNLOCK(j_object_append);
+	}
+	else
+	{
+		g_autoptr(JMessage) reply = NULL;
+		gsize name_len;
+		gsize namespace_len;
+		gchar reserve = FALSE;
+
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		message = j_message_new(J_MESSAGE_OBJECT_APPEND, namespace_len + name_len + 1);
+		j_message_set_compact(message, j_connection_pool_get_compact_object(object->index));
+		j_message_set_safety(message, semantics);
+		j_message_append_n(message, object->namespace, namespace_len);
+		j_message_append_n(message, object->name, name_len);
+		j_message_append_1(message, &reserve);
+
+		while (j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+
+			j_message_add_operation(message, sizeof(guint64));
+			j_message_append_varint(message, operation->append.length);
+			j_message_add_send(message, operation->append.data, operation->append.length);
+		}
+
+		/* The offsets are only known once the server has replied. */
+		reply = j_connection_pool_request_object_ordered(object->index, j_helper_hash(object->name), message, TRUE);
+		ret = (reply != NULL);
+
+		if (reply != NULL)
+		{
+			j_list_iterator_free(it);
+			it = j_list_iterator_new(operations);
+
+			while (j_list_iterator_next(it))
+			{
+				JObjectOperation* operation = j_list_iterator_get(it);
+				guint64 nbytes;
+
+				*(operation->append.offset) = j_message_get_varint(reply);
+				nbytes = j_message_get_varint(reply);
+
+				ret = (nbytes == operation->append.length) && ret;
+			}
+		}
+	}
+
+	/* Prefetched data may predate the appends. */
+	if (object->readahead != NULL)
+	{
+		j_readahead_invalidate(object->readahead);
+	}
+
+	g_atomic_int_set(&(object->node_cache_valid), FALSE);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_object_reduce_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	g_autoptr(JListIterator) it = NULL;
+	JObject* object;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->reduce.object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		g_autofree gchar* buffer = NULL;
+		gpointer object_handle;
+
+		if (!j_backend_object_open(object_backend, object->namespace, object->name, &object_handle))
+		{
+			ret = FALSE;
+			goto end;
+		}
+
+		buffer = g_malloc(J_STRIPE_SIZE);
+
+		while (j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+			guint64 length = operation->reduce.length;
+			guint64 offset = operation->reduce.offset;
+
+			while (length > 0)
+			{
+				guint64 nbytes = 0;
+
+				if (!j_backend_object_read(object_backend, object_handle, buffer, MIN(length, J_STRIPE_SIZE), offset, &nbytes) || nbytes == 0)
+				{
+					break;
+				}
+
+				j_reduce_update(operation->reduce.reduce, buffer, nbytes);
+
+				length -= nbytes;
+				offset += nbytes;
+			}
+		}
+
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		gsize name_len;
+		gsize namespace_len;
+
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		/* Each message carries the parameters of one reduction, so operations are sent one by one. */
+		while (j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+			g_autoptr(JMessage) message = NULL;
+			g_autoptr(JMessage) reply = NULL;
+
+			message = j_message_new(J_MESSAGE_OBJECT_REDUCE, namespace_len + name_len + j_reduce_get_parameters_size());
+			j_message_set_compact(message, j_connection_pool_get_compact_object(object->index));
+			j_message_set_safety(message, semantics);
+			j_message_append_n(message, object->namespace, namespace_len);
+			j_message_append_n(message, object->name, name_len);
+			j_reduce_append_parameters(operation->reduce.reduce, message);
+
+			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
+			j_message_append_varint(message, operation->reduce.length);
+			j_message_append_varint(message, operation->reduce.offset);
+
+			reply = j_connection_pool_request_object_ordered(object->index, j_helper_hash(object->name), message, TRUE);
+
+			if (reply != NULL && j_message_get_count(reply) == 1)
+			{
+				j_reduce_combine_from_message(operation->reduce.reduce, reply);
+			}
+			else
+			{
+				ret = FALSE;
+			}
+		}
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_object_status_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = FALSE;
+
+	JBackend* object_backend;
+	JListIterator* it;
+	g_autoptr(JMessage) message = NULL;
+	gchar const* namespace;
+	gsize namespace_len;
+	gboolean handles = FALSE;
+	guint32 index;
+	guint32 key;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+		JObject* object = operation->status.object;
+
+		g_assert(operation != NULL);
+		g_assert(object != NULL);
+
+		namespace = object->namespace;
+		namespace_len = strlen(namespace) + 1;
+		index = object->index;
+		key = j_helper_hash(object->name);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(namespace);
+
+	if (object_backend == NULL)
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		/* Opened objects are referred to using their handles, which replace the namespace and paths. */
+		handles = (j_object_get_handle(operation->status.object) != 0);
+
+		message = j_message_new(J_MESSAGE_OBJECT_STATUS, (handles) ? 0 : namespace_len);
+		j_message_set_safety(message, semantics);
+		j_message_set_handle(message, handles);
+
+		if (!handles)
+		{
+			j_message_append_n(message, namespace, namespace_len);
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JObject* object = operation->status.object;
+		gint64* modification_time = operation->status.modification_time;
+		guint64* size = operation->status.size;
+
+		if (object_backend != NULL)
+		{
+			gpointer object_handle;
+
+			ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+			ret = j_backend_object_status(object_backend, object_handle, modification_time, size) && ret;
+			ret = j_backend_object_close(object_backend, object_handle) && ret;
+		}
+		else if (handles)
+		{
+			guint64 handle;
+
+			handle = j_object_get_handle(object);
+
+			j_message_add_operation(message, sizeof(guint64));
+			j_message_append_8(message, &handle);
+		}
+		else
+		{
+			gsize name_len;
+
+			name_len = strlen(object->name) + 1;
+
+			j_message_add_operation(message, name_len);
+			j_message_append_n(message, object->name, name_len);
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	if (object_backend == NULL)
+	{
+		g_autoptr(JMessage) reply = NULL;
+
+		reply = j_connection_pool_request_object_ordered(index, key, message, TRUE);
+
+		it = j_list_iterator_new(operations);
+
+		while (reply != NULL && j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+			gint64* modification_time = operation->status.modification_time;
+			guint64* size = operation->status.size;
+			gint64 modification_time_;
+			guint64 size_;
+
+			modification_time_ = j_message_get_8(reply);
+			size_ = j_message_get_8(reply);
+
+			*modification_time = modification_time_;
+			*size = size_;
+		}
+
+		j_list_iterator_free(it);
+
+		ret = (reply != NULL) && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Serves a read using the node cache, filling it from the servers if the data is not cached yet.
+ * Cached blocks are validated using the object's modification time and size, which are fetched once and after the object has been changed using this handle.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object    An object.
+ * \param operation A read operation.
+ *
+ * \return TRUE if the read has been served, FALSE if it has to be sent to the servers.
+ **/
+static
+gboolean
+j_object_node_cache_read (JObject* object, JObjectOperation* operation)
+{
+	JNodeCache* node_cache;
+	gint64 modification_time;
+	guint64 size;
+
+	node_cache = j_object_get_node_cache();
+
+	g_mutex_lock(&(object->mutex));
+
+	if (!g_atomic_int_get(&(object->node_cache_valid)))
+	{
+		JObjectOperation status;
+		g_autoptr(JList) operations = NULL;
+		g_autoptr(JSemantics) semantics = NULL;
+
+		status.status.object = object;
+		status.status.modification_time = &(object->node_cache_modification_time);
+		status.status.size = &(object->node_cache_size);
+		status.segments = NULL;
+		status.segment_count = 0;
+
+		/* Stays unchanged if the status could not be fetched. */
+		object->node_cache_modification_time = G_MININT64;
+
+		operations = j_list_new(NULL);
+		j_list_append(operations, &status);
+
+		semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+		j_object_status_exec(operations, semantics);
+
+		g_atomic_int_set(&(object->node_cache_valid), object->node_cache_modification_time != G_MININT64);
+	}
+
+	modification_time = object->node_cache_modification_time;
+	size = object->node_cache_size;
+
+	g_mutex_unlock(&(object->mutex));
+
+	if (modification_time == G_MININT64)
+	{
+		return FALSE;
+	}
+
+	if (j_node_cache_read(node_cache, object->namespace, object->name, modification_time, size, operation->read.data, operation->read.length, operation->read.offset, operation->read.bytes_read))
+	{
+		return TRUE;
+	}
+
+	return j_node_cache_fill(node_cache, object->namespace, object->name, modification_time, size, j_object_readahead_fetch, object, operation->read.data, operation->read.length, operation->read.offset, operation->read.bytes_read);
+}
+
+/**
+ * Truncates, preallocates, punches holes into or syncs an object.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param operations A list of operations.
+ * \param semantics  A semantics object.
+ * \param type       J_MESSAGE_OBJECT_TRUNCATE, J_MESSAGE_OBJECT_ALLOCATE, J_MESSAGE_OBJECT_PUNCH_HOLE, J_MESSAGE_OBJECT_SYNC or J_MESSAGE_OBJECT_PREFETCH.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_object_extent_exec (JList* operations, JSemantics* semantics, JMessageType type)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	JListIterator* it;
+	JObject* object;
+	gpointer object_handle;
+	g_autoptr(JMessage) message = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->extent.object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+	}
+	else
+	{
+		gsize name_len;
+		gsize namespace_len;
+
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		message = j_message_new(type, namespace_len + name_len);
+		j_message_set_safety(message, semantics);
+		j_message_append_n(message, object->namespace, namespace_len);
+		j_message_append_n(message, object->name, name_len);
+
+		/* Syncs are barriers, so they always have to wait for the storage. */
+		if (type == J_MESSAGE_OBJECT_SYNC)
+		{
+			j_message_force_safety(message, J_SEMANTICS_SAFETY_STORAGE);
+		}
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		guint64 length = operation->extent.length;
+		guint64 offset = operation->extent.offset;
+
+		if (object_backend != NULL)
+		{
+			switch (type)
+			{
+				case J_MESSAGE_OBJECT_TRUNCATE:
+					ret = object_backend->object.truncate != NULL && j_backend_object_truncate(object_backend, object_handle, length) && ret;
+					break;
+				case J_MESSAGE_OBJECT_ALLOCATE:
+					ret = object_backend->object.allocate != NULL && j_backend_object_allocate(object_backend, object_handle, length, offset) && ret;
+					break;
+				case J_MESSAGE_OBJECT_PUNCH_HOLE:
+					ret = object_backend->object.punch_hole != NULL && j_backend_object_punch_hole(object_backend, object_handle, length, offset) && ret;
+					break;
+				case J_MESSAGE_OBJECT_SYNC:
+					ret = j_backend_object_sync(object_backend, object_handle) && ret;
+					break;
+				case J_MESSAGE_OBJECT_PREFETCH:
+					ret = j_backend_object_prefetch(object_backend, object_handle, length, offset) && ret;
+					break;
+				default:
+					g_warn_if_reached();
+					break;
+			}
+		}
+		else if (type == J_MESSAGE_OBJECT_SYNC)
+		{
+			j_message_add_operation(message, 0);
+		}
+		else if (type == J_MESSAGE_OBJECT_TRUNCATE)
+		{
+			j_message_add_operation(message, sizeof(guint64));
+			j_message_append_varint(message, length);
+		}
+		else
+		{
+			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
+			j_message_append_varint(message, length);
+			j_message_append_varint(message, offset);
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_close(object_backend, object_handle) && ret;
+	}
+	else
+	{
+		g_autoptr(JMessage) reply = NULL;
+		guint32 operation_count;
+		gboolean wait = TRUE;
+
+		/* Servers only reply to prefetches if the semantics ask for it. */
+		if (type == J_MESSAGE_OBJECT_PREFETCH)
+		{
+			wait = (j_message_get_flags(message) & J_MESSAGE_FLAGS_SAFETY_NETWORK) != 0;
+		}
+
+		reply = j_connection_pool_request_object_ordered(object->index, j_helper_hash(object->name), message, wait);
+		ret = (!wait || reply != NULL) && ret;
+
+		operation_count = j_message_get_count(message);
+
+		for (guint32 i = 0; reply != NULL && i < operation_count; i++)
+		{
+			ret = (j_message_get_1(reply) != 0) && ret;
+		}
+	}
+
+	/* Prefetched data may predate the changes. */
+	if (type != J_MESSAGE_OBJECT_SYNC && type != J_MESSAGE_OBJECT_PREFETCH)
+	{
+		if (object->readahead != NULL)
+		{
+			j_readahead_invalidate(object->readahead);
+		}
+
+		g_atomic_int_set(&(object->node_cache_valid), FALSE);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+static
+gboolean
+j_object_truncate_exec (JList* operations, JSemantics* semantics)
+{
+	return j_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_TRUNCATE);
+}
+
+static
+gboolean
+j_object_allocate_exec (JList* operations, JSemantics* semantics)
+{
+	return j_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_ALLOCATE);
+}
+
+static
+gboolean
+j_object_punch_hole_exec (JList* operations, JSemantics* semantics)
+{
+	return j_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_PUNCH_HOLE);
+}
+
+static
+gboolean
+j_object_sync_exec (JList* operations, JSemantics* semantics)
+{
+	return j_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_SYNC);
+}
+
+static
+gboolean
+j_object_prefetch_exec (JList* operations, JSemantics* semantics)
+{
+	return j_object_extent_exec(operations, semantics, J_MESSAGE_OBJECT_PREFETCH);
+}
+
+static
+gboolean
+j_object_extents_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	JListIterator* it;
+	JObject* object;
+	g_autoptr(JMessage) message = NULL;
+	gpointer object_handle = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->extents.object;
+		g_assert(object != NULL);
+	}
+
+	it = j_list_iterator_new(operations);
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	if (object_backend != NULL)
+	{
+		ret = j_backend_object_open(object_backend, object->namespace, object->name, &object_handle) && ret;
+	}
+	else
+	{
+		gsize name_len;
+		gsize namespace_len;
+
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		message = j_message_new(J_MESSAGE_OBJECT_EXTENTS, namespace_len + name_len);
+		j_message_set_safety(message, semantics);
+		j_message_append_n(message, object->namespace, namespace_len);
+		j_message_append_n(message, object->name, name_len);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+
+		*(operation->extents.count) = 0;
+
+		if (object_backend != NULL)
+		{
+			ret = object_handle != NULL && j_backend_object_extents(object_backend, object_handle, operation->extents.length, operation->extents.offset, operation->extents.lengths, operation->extents.offsets, operation->extents.max_count, operation->extents.count) && ret;
+		}
+		else
+		{
+			guint32 max_count = operation->extents.max_count;
+
+			j_message_add_operation(message, sizeof(guint64) + sizeof(guint64) + sizeof(guint32));
+			j_message_append_varint(message, operation->extents.length);
+			j_message_append_varint(message, operation->extents.offset);
+			j_message_append_4(message, &max_count);
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	if (object_backend != NULL)
+	{
+		if (object_handle != NULL)
+		{
+			ret = j_backend_object_close(object_backend, object_handle) && ret;
+		}
+	}
+	else
+	{
+		g_autoptr(JMessage) reply = NULL;
+
+		reply = j_connection_pool_request_object_ordered(object->index, j_helper_hash(object->name), message, TRUE);
+		ret = (reply != NULL) && ret;
+
+		it = j_list_iterator_new(operations);
+
+		while (reply != NULL && j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+			guint32 count;
+
+			ret = (j_message_get_1(reply) != 0) && ret;
+			count = j_message_get_4(reply);
+
+			/* The server returns at most the requested number of extents. */
+			count = MIN(count, operation->extents.max_count);
+
+			for (guint32 i = 0; i < count; i++)
+			{
+				operation->extents.lengths[i] = j_message_get_varint(reply);
+				operation->extents.offsets[i] = j_message_get_varint(reply);
+			}
+
+			*(operation->extents.count) = count;
+		}
+
+		j_list_iterator_free(it);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Copies an object using a local object backend.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object_backend The object backend.
+ * \param object         The source object.
+ * \param to             The destination object.
+ * \param bytes_copied   Number of bytes copied.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_object_copy_backend (JBackend* object_backend, JObject* object, JObject* to, guint64* bytes_copied)
+{
+	gboolean ret = TRUE;
+	gpointer from_handle = NULL;
+	gpointer to_handle = NULL;
+
+	ret = j_backend_object_open(object_backend, object->namespace, object->name, &from_handle) && ret;
+	ret = j_backend_object_create(object_backend, to->namespace, to->name, &to_handle) && ret;
+
+	if (ret && object_backend->object.copy != NULL)
+	{
+		ret = j_backend_object_copy(object_backend, from_handle, to_handle, bytes_copied);
+	}
+	else if (ret)
+	{
+		g_autofree gchar* buf = NULL;
+		guint64 offset = 0;
+
+		buf = g_malloc(J_STRIPE_SIZE);
+
+		if (object_backend->object.truncate != NULL)
+		{
+			ret = j_backend_object_truncate(object_backend, to_handle, 0) && ret;
+		}
+
+		while (ret)
+		{
+			guint64 nbytes = 0;
+			guint64 bytes_written = 0;
+
+			ret = j_backend_object_read(object_backend, from_handle, buf, J_STRIPE_SIZE, offset, &nbytes) && ret;
+
+			if (!ret || nbytes == 0)
+			{
+				break;
+			}
+
+			ret = j_backend_object_write(object_backend, to_handle, buf, nbytes, offset, &bytes_written) && ret;
+
+			offset += bytes_written;
+
+			if (nbytes < J_STRIPE_SIZE)
+			{
+				break;
+			}
+		}
+
+		*bytes_copied = offset;
+	}
+
+	if (from_handle != NULL)
+	{
+		ret = j_backend_object_close(object_backend, from_handle) && ret;
+	}
+
+	if (to_handle != NULL)
+	{
+		ret = j_backend_object_close(object_backend, to_handle) && ret;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+j_object_copy_exec (JList* operations, JSemantics* semantics)
+{
+	gboolean ret = TRUE;
+
+	JBackend* object_backend;
+	JListIterator* it;
+	JObject* object;
+	g_autoptr(JMessage) message = NULL;
+
+	g_return_val_if_fail(operations != NULL, FALSE);
+	g_return_val_if_fail(semantics != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	{
+		JObjectOperation* operation = j_list_get_first(operations);
+
+		g_assert(operation != NULL);
+		object = operation->copy.object;
+		g_assert(object != NULL);
+	}
+
+	object_backend = j_object_backend_for_namespace(object->namespace);
+
+	/* Copies are performed by the source's backend or server, so both objects have to be routed the same way. */
+	it = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+
+		if (j_object_backend_for_namespace(operation->copy.to->namespace) != object_backend)
+		{
+			ret = FALSE;
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	if (!ret)
+	{
+		j_trace_leave(G_STRFUNC);
+
+		return FALSE;
+	}
+
+	it = j_list_iterator_new(operations);
+
+	if (object_backend == NULL)
+	{
+		gsize name_len;
+		gsize namespace_len;
+
+		namespace_len = strlen(object->namespace) + 1;
+		name_len = strlen(object->name) + 1;
+
+		message = j_message_new(J_MESSAGE_OBJECT_COPY, namespace_len + name_len);
+		j_message_set_safety(message, semantics);
+		j_message_append_n(message, object->namespace, namespace_len);
+		j_message_append_n(message, object->name, name_len);
+	}
+
+	while (j_list_iterator_next(it))
+	{
+		JObjectOperation* operation = j_list_iterator_get(it);
+		JObject* to = operation->copy.to;
+
+		if (object_backend != NULL)
+		{
+			guint64 nbytes = 0;
+
+			ret = j_object_copy_backend(object_backend, object, to, &nbytes) && ret;
+
+			if (operation->copy.bytes_copied != NULL)
+			{
+				j_helper_atomic_add(operation->copy.bytes_copied, nbytes);
+			}
+		}
+		else
+		{
+			gsize to_name_len;
+			gsize to_namespace_len;
+			gchar local;
+
+			to_namespace_len = strlen(to->namespace) + 1;
+			to_name_len = strlen(to->name) + 1;
+
+			/* The source server either copies locally or streams the data to the destination server. */
+			local = (object->index == to->index);
+
+			j_message_add_operation(message, 1 + sizeof(guint32) + to_namespace_len + to_name_len);
+			j_message_append_1(message, &local);
+			j_message_append_4(message, &(to->index));
+			j_message_append_n(message, to->namespace, to_namespace_len);
+			j_message_append_n(message, to->name, to_name_len);
+		}
+	}
+
+	j_list_iterator_free(it);
+
+	if (object_backend == NULL)
+	{
+		g_autoptr(JMessage) reply = NULL;
+
+		reply = j_connection_pool_request_object_ordered(object->index, j_helper_hash(object->name), message, TRUE);
+		ret = (reply != NULL) && ret;
+
+		it = j_list_iterator_new(operations);
+
+		while (reply != NULL && j_list_iterator_next(it))
+		{
+			JObjectOperation* operation = j_list_iterator_get(it);
+			gchar success;
+			guint64 nbytes;
+
+			success = j_message_get_1(reply);
+			nbytes = j_message_get_8(reply);
+
+			ret = (success != 0) && ret;
+
+			if (operation->copy.bytes_copied != NULL)
+			{
+				j_helper_atomic_add(operation->copy.bytes_copied, nbytes);
+			}
+		}
+
+		j_list_iterator_free(it);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Creates a new item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JObject* i;
+ *
+ * i = j_object_new("JULEA");
+ * \endcode
+ *
+ * \param name         An item name.
+ * \param distribution A distribution.
+ *
+ * \return A new item. Should be freed with j_object_unref().
+ **/
+JObject*
+j_object_new (gchar const* namespace, gchar const* name)
+{
+	JConfiguration* configuration = j_configuration();
+	JObject* object;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(name != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	object = g_slice_new(JObject);
+	object->index = j_helper_hash(name) % j_configuration_get_object_server_count(configuration);
+	object->namespace = g_strdup(namespace);
+	object->name = g_strdup(name);
+	object->readahead = NULL;
+	object->node_cache_valid = FALSE;
+	object->node_cache_modification_time = 0;
+	object->node_cache_size = 0;
+	object->write_behind_size = 0;
+	object->write_behind = NULL;
+	object->handle = 0;
+	g_mutex_init(&(object->mutex));
+	object->ref_count = 1;
+
+	j_trace_leave(G_STRFUNC);
+
+	return object;
+}
+
+/**
+ * Creates a new item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JObject* i;
+ *
+ * i = j_object_new("JULEA");
+ * \endcode
+ *
+ * \param name         An item name.
+ * \param distribution A distribution.
+ *
+ * \return A new item. Should be freed with j_object_unref().
+ **/
+JObject*
+j_object_new_for_index (guint32 index, gchar const* namespace, gchar const* name)
+{
+	JConfiguration* configuration = j_configuration();
+	JObject* object;
+
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(name != NULL, NULL);
+	g_return_val_if_fail(index < j_configuration_get_object_server_count(configuration), NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	object = g_slice_new(JObject);
+	object->index = index;
+	object->namespace = g_strdup(namespace);
+	object->name = g_strdup(name);
+	object->readahead = NULL;
+	object->node_cache_valid = FALSE;
+	object->node_cache_modification_time = 0;
+	object->node_cache_size = 0;
+	object->write_behind_size = 0;
+	object->write_behind = NULL;
+	object->handle = 0;
+	g_mutex_init(&(object->mutex));
+	object->ref_count = 1;
+
+	j_trace_leave(G_STRFUNC);
+
+	return object;
+}
+
+/**
+ * Increases an item's reference count.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JObject* i;
+ *
+ * j_object_ref(i);
+ * \endcode
+ *
+ * \param item An item.
+ *
+ * \return #item.
+ **/
+JObject*
+j_object_ref (JObject* item)
+{
+	g_return_val_if_fail(item != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_atomic_int_inc(&(item->ref_count));
+
+	j_trace_leave(G_STRFUNC);
+
+	return item;
+}
+
+/**
+ * Decreases an item's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item An item.
+ **/
+void
+j_object_unref (JObject* item)
+{
+	g_return_if_fail(item != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (g_atomic_int_dec_and_test(&(item->ref_count)))
+	{
+		/* Waits for outstanding prefetches, which do not hold references. */
+		if (item->readahead != NULL)
+		{
+			j_readahead_free(item->readahead);
+		}
+
+		g_free(item->name);
+		g_free(item->namespace);
+
+		g_mutex_clear(&(item->mutex));
+
+		g_slice_free(JObject, item);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Returns the index of the server an object is stored on.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object An object.
+ *
+ * \return The server's index.
+ **/
+guint32
+j_object_get_index (JObject* object)
+{
+	g_return_val_if_fail(object != NULL, 0);
+
+	return object->index;
+}
+
+/**
+ * Enables prefetching for sequential reads.
+ * Prefetched data is only used by batches whose semantics do not require immediate consistency.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JObject* o;
+ *
+ * ...
+ * j_object_set_readahead(o, 4 * 1024 * 1024);
+ * \endcode
+ *
+ * \param object An object.
+ * \param size   The number of bytes to prefetch at once, 0 to disable prefetching.
+ **/
+void
+j_object_set_readahead (JObject* object, guint64 size)
+{
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (object->readahead != NULL)
+	{
+		j_readahead_free(object->readahead);
+		object->readahead = NULL;
+	}
+
+	if (size > 0)
+	{
+		object->readahead = j_readahead_new(size, j_object_readahead_fetch, object);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Enables aggregating small contiguous writes.
+ * Only writes in batches with J_SEMANTICS_SAFETY_NONE are aggregated.
+ * Their data is copied and bytes_written is set immediately.
+ * Aggregated writes are sent when their batch is executed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object An object.
+ * \param size   The maximum size of aggregated writes, 0 to disable aggregation.
+ **/
+void
+j_object_set_write_behind (JObject* object, guint64 size)
+{
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&(object->mutex));
+
+	object->write_behind_size = size;
+	object->write_behind = NULL;
+
+	g_mutex_unlock(&(object->mutex));
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Creates an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param name         A name.
+ * \param distribution A distribution.
+ * \param batch        A batch.
+ *
+ * \return A new item. Should be freed with j_object_unref().
+ **/
+void
+j_object_create (JObject* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	operation = j_operation_new();
+	// FIXME key = index + namespace
+	operation->key = object;
+	operation->data = j_object_ref(object);
+	operation->exec_func = j_object_create_exec;
+	operation->free_func = j_object_create_free;
+	operation->cache_func = j_object_create_cache;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deletes an object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item       An item.
+ * \param batch      A batch.
+ **/
+void
+j_object_delete (JObject* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = j_object_ref(object);
+	operation->exec_func = j_object_delete_exec;
+	operation->free_func = j_object_delete_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Opens an object on its server.
+ * Afterwards, reads, writes and status requests refer to the object using a small handle instead of its namespace and path,
+ * which saves bandwidth and spares the server from looking up the object again.
+ * Like file descriptors, handles keep referring to the object even if it is deleted in the meantime.
+ * The handle is kept until j_object_close() is called, the server keeps the object open until then.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_object_open(object, batch);
+ * j_batch_execute(batch);
+ *
+ * for (guint i = 0; i < count; i++)
+ * {
+ *   j_object_read(object, buffer, length, offsets[i], &bytes_read, batch);
+ *   j_batch_execute(batch);
+ * }
+ *
+ * j_object_close(object, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param object An object.
+ * \param batch  A batch.
+ **/
+void
+j_object_open (JObject* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = j_object_ref(object);
+	operation->exec_func = j_object_open_exec;
+	operation->free_func = j_object_open_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Closes an object that has been opened using j_object_open().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object An object.
+ * \param batch  A batch.
+ **/
+void
+j_object_close (JObject* object, JBatch* batch)
+{
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes might still use the handle. */
+	j_object_write_behind_close(object, NULL);
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = j_object_ref(object);
+	operation->exec_func = j_object_close_exec;
+	operation->free_func = j_object_open_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reads an item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object     An object.
+ * \param data       A buffer to hold the read data.
+ * \param length     Number of bytes to read.
+ * \param offset     An offset within #object.
+ * \param bytes_read Number of bytes read.
+ * \param batch      A batch.
+ **/
+void
+j_object_read (JObject* object, gpointer data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_read != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->read.object = j_object_ref(object);
+	iop->read.data = data;
+	iop->read.length = length;
+	iop->read.offset = offset;
+	iop->read.bytes_read = bytes_read;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_read_exec;
+	operation->free_func = j_object_read_free;
+
+	*bytes_read = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Aggregates a small write with the preceding ones.
+ * The data is copied, so the caller's buffer can be reused immediately.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object An object.
+ * \param data   A buffer holding the data to write.
+ * \param length Number of bytes to write.
+ * \param offset An offset within #object.
+ * \param batch  A batch.
+ **/
+static
+void
+j_object_write_behind (JObject* object, gconstpointer data, guint64 length, guint64 offset, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_mutex_lock(&(object->mutex));
+
+	iop = object->write_behind;
+
+	if (iop != NULL && iop->write_behind->batch == batch && iop->write.offset + iop->write.length == offset && iop->write.length + length <= object->write_behind_size)
+	{
+		g_byte_array_append(iop->write_behind->data, data, length);
+
+		iop->write.data = iop->write_behind->data->data;
+		iop->write.length += length;
+
+		g_mutex_unlock(&(object->mutex));
+
+		return;
+	}
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->buffer = NULL;
+	iop->write_behind = g_slice_new(JObjectWriteBehind);
+	iop->write_behind->data = g_byte_array_sized_new(object->write_behind_size);
+	iop->write_behind->batch = batch;
+	iop->write_behind->bytes_written = 0;
+
+	g_byte_array_append(iop->write_behind->data, data, length);
+
+	iop->write.object = j_object_ref(object);
+	iop->write.data = iop->write_behind->data->data;
+	iop->write.length = length;
+	iop->write.offset = offset;
+	iop->write.bytes_written = &(iop->write_behind->bytes_written);
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	object->write_behind = iop;
+
+	g_mutex_unlock(&(object->mutex));
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_write_exec;
+	operation->free_func = j_object_write_free;
+	operation->cache_size_func = j_object_write_cache_size;
+	operation->cache_func = j_object_write_cache;
+
+	j_batch_add(batch, operation);
+}
+
+/**
+ * Writes an item.
+ *
+ * Unsafe writes are cached by copying their data, unless it has been allocated with j_buffer_alloc().
+ * In that case, the data must not be modified until the batch has been executed.
+ *
+ * \note
+ * j_object_write() modifies bytes_written even if j_batch_execute() is not called.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item          An item.
+ * \param data          A buffer holding the data to write.
+ * \param length        Number of bytes to write.
+ * \param offset        An offset within #item.
+ * \param bytes_written Number of bytes written.
+ * \param batch         A batch.
+ **/
+void
+j_object_write (JObject* object, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_written != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Unsafe writes do not report errors anyway, so small ones can be aggregated. */
+	if (length < object->write_behind_size && j_semantics_get(j_batch_get_semantics(batch), J_SEMANTICS_SAFETY) == J_SEMANTICS_SAFETY_NONE)
+	{
+		j_object_write_behind(object, data, length, offset, batch);
+		*bytes_written = length;
+
+		goto end;
+	}
+
+	/* Later small writes must not be aggregated with writes preceding this one. */
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->write.object = j_object_ref(object);
+	iop->write.data = data;
+	iop->write.length = length;
+	iop->write.offset = offset;
+	iop->write.bytes_written = bytes_written;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
+	iop->buffer = NULL;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_write_exec;
+	operation->free_func = j_object_write_free;
+	operation->cache_size_func = j_object_write_cache_size;
+	operation->cache_func = j_object_write_cache;
+
+	*bytes_written = 0;
+
+	j_batch_add(batch, operation);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reads an object into device memory.
+ * The data is staged through pinned host memory, copying each chunk to the device while the next one is read.
+ * Requires JULEA to be built with CUDA, see j_device_is_available().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object      An object.
+ * \param device_data A device buffer to hold the read data.
+ * \param length      Number of bytes to read.
+ * \param offset      An offset within #object.
+ * \param bytes_read  Number of bytes read.
+ * \param batch       A batch.
+ **/
+void
+j_object_read_device (JObject* object, gpointer device_data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(device_data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_read != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->read.object = j_object_ref(object);
+	iop->read.data = device_data;
+	iop->read.length = length;
+	iop->read.offset = offset;
+	iop->read.bytes_read = bytes_read;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_read_device_exec;
+	operation->free_func = j_object_read_free;
+
+	*bytes_read = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Writes an object from device memory.
+ * Each chunk is copied from the device into pinned host memory while the previous one is written.
+ * Unlike j_object_write(), the write is never aggregated or cached, because device memory can not be copied by the host.
+ * Requires JULEA to be built with CUDA, see j_device_is_available().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object        An object.
+ * \param device_data   A device buffer holding the data to write.
+ * \param length        Number of bytes to write.
+ * \param offset        An offset within #object.
+ * \param bytes_written Number of bytes written.
+ * \param batch         A batch.
+ **/
+void
+j_object_write_device (JObject* object, gconstpointer device_data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(device_data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(bytes_written != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->write.object = j_object_ref(object);
+	iop->write.data = device_data;
+	iop->write.length = length;
+	iop->write.offset = offset;
+	iop->write.bytes_written = bytes_written;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
+	iop->buffer = NULL;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_write_device_exec;
+	operation->free_func = j_object_write_free;
+
+	*bytes_written = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Appends data to an object.
+ * The server places the data at the object's current end, so several clients can append to the same object without coordinating.
+ * Concurrent appends to the same object are written together.
+ * The object is created if it does not exist.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint64 offset;
+ *
+ * j_object_append(object, record, record_length, &offset, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param object An object.
+ * \param data   A buffer holding the data to append.
+ * \param length Number of bytes to append.
+ * \param offset Returns the offset the data has been written to, once the batch has been executed.
+ * \param batch  A batch.
+ **/
+void
+j_object_append (JObject* object, gconstpointer data, guint64 length, guint64* offset, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
+	g_return_if_fail(offset != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->append.object = j_object_ref(object);
+	iop->append.data = data;
+	iop->append.length = length;
+	iop->append.offset = offset;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_append_exec;
+	operation->free_func = j_object_append_free;
+
+	*offset = 0;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reduces an extent of an object on its server.
+ * The extent is interpreted as an array of the reduction's type, only the partial result is transferred.
+ * The result is combined into the reduction, so several extents and objects can be reduced together.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JReduce) reduce = NULL;
+ *
+ * reduce = j_reduce_new(J_REDUCE_TYPE_DOUBLE);
+ * j_object_reduce(object, reduce, length, 0, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param object An object.
+ * \param reduce A reduction, must not be modified until the batch has been executed.
+ * \param length The extent's length, should be a multiple of the element size.
+ * \param offset The extent's offset, should be a multiple of the element size.
+ * \param batch  A batch.
+ **/
+void
+j_object_reduce (JObject* object, JReduce* reduce, guint64 length, guint64 offset, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(length > 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->reduce.object = j_object_ref(object);
+	iop->reduce.reduce = reduce;
+	iop->reduce.length = length;
+	iop->reduce.offset = offset;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_reduce_exec;
+	operation->free_func = j_object_reduce_free;
+
+	j_batch_add(batch, operation);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reads several extents of an object in one operation.
+ * Extent i is read into vectors[i].
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object     An object.
+ * \param vectors    Buffers to hold the read data, one per extent.
+ * \param offsets    The extents' offsets within #object.
+ * \param count      The number of extents.
+ * \param bytes_read Number of bytes read in total.
+ * \param batch      A batch.
+ **/
+void
+j_object_readv (JObject* object, GInputVector const* vectors, guint64 const* offsets, guint count, guint64* bytes_read, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+	g_autofree JObjectSegment* segments = NULL;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(vectors != NULL);
+	g_return_if_fail(offsets != NULL);
+	g_return_if_fail(count > 0);
+	g_return_if_fail(bytes_read != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	segments = g_new(JObjectSegment, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		segments[i].offset = offsets[i];
+		segments[i].length = vectors[i].size;
+		segments[i].index = i;
+	}
+
+	j_object_segments_sort(segments, count, FALSE);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->read.object = j_object_ref(object);
+	iop->read.data = NULL;
+	iop->read.length = 0;
+	iop->read.offset = 0;
+	iop->read.bytes_read = bytes_read;
+	iop->segments = g_new(JObjectOperation, count);
+	iop->segment_count = 0;
+
+	for (guint i = 0; i < count; i++)
+	{
+		JObjectOperation* segment;
+
+		if (segments[i].length == 0)
+		{
+			continue;
+		}
+
+		segment = &(iop->segments[iop->segment_count]);
+		segment->read.object = object;
+		segment->read.data = vectors[segments[i].index].buffer;
+		segment->read.length = segments[i].length;
+		segment->read.offset = segments[i].offset;
+		segment->read.bytes_read = bytes_read;
+		segment->segments = NULL;
+		segment->segment_count = 0;
+
+		iop->segment_count++;
+	}
+
+	*bytes_read = 0;
+
+	/* Nothing to do, the server must not receive an empty message. */
+	if (iop->segment_count == 0)
+	{
+		j_object_read_free(iop);
+		goto end;
+	}
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_read_exec;
+	operation->free_func = j_object_read_free;
+
+	j_batch_add(batch, operation);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Writes several extents of an object in one operation.
+ * vectors[i] is written to extent i.
+ * Overlapping extents are written in the given order.
+ *
+ * \note
+ * j_object_writev() modifies bytes_written even if j_batch_execute() is not called.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object        An object.
+ * \param vectors       Buffers holding the data to write, one per extent.
+ * \param offsets       The extents' offsets within #object.
+ * \param count         The number of extents.
+ * \param bytes_written Number of bytes written in total.
+ * \param batch         A batch.
+ **/
+void
+j_object_writev (JObject* object, GOutputVector const* vectors, guint64 const* offsets, guint count, guint64* bytes_written, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
+	g_autofree JObjectSegment* segments = NULL;
+
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(vectors != NULL);
+	g_return_if_fail(offsets != NULL);
+	g_return_if_fail(count > 0);
+	g_return_if_fail(bytes_written != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	segments = g_new(JObjectSegment, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		segments[i].offset = offsets[i];
+		segments[i].length = vectors[i].size;
+		segments[i].index = i;
+	}
+
+	j_object_segments_sort(segments, count, TRUE);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->write.object = j_object_ref(object);
+	iop->write.data = NULL;
+	iop->write.length = 0;
+	iop->write.offset = 0;
+	iop->write.bytes_written = bytes_written;
+	iop->segments = g_new(JObjectOperation, count);
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
+	iop->buffer = NULL;
+
+	for (guint i = 0; i < count; i++)
+	{
+		JObjectOperation* segment;
+
+		if (segments[i].length == 0)
+		{
+			continue;
+		}
+
+		segment = &(iop->segments[iop->segment_count]);
+		segment->write.object = object;
+		segment->write.data = vectors[segments[i].index].buffer;
+		segment->write.length = segments[i].length;
+		segment->write.offset = segments[i].offset;
+		segment->write.bytes_written = bytes_written;
+		segment->segments = NULL;
+		segment->segment_count = 0;
+		segment->write_behind = NULL;
+
+		iop->segment_count++;
+	}
+
+	*bytes_written = 0;
+
+	/* Nothing to do, the server must not receive an empty message. */
+	if (iop->segment_count == 0)
+	{
+		j_object_write_free(iop);
+		goto end;
+	}
+
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_write_exec;
+	operation->free_func = j_object_write_free;
+
+	j_batch_add(batch, operation);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Get the status of an item.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param item      An item.
+ * \param batch     A batch.
+ **/
+void
+j_object_status (JObject* object, gint64* modification_time, guint64* size, JBatch* batch)
+{
+	JObjectOperation* iop;
+	JOperation* operation;
 
-		it = j_list_iterator_new(operations);
+	g_return_if_fail(object != NULL);
 
-		while (j_list_iterator_next(it))
-		{
-			JObjectOperation* operation = j_list_iterator_get(it);
-			gint64* modification_time = operation->status.modification_time;
-			guint64* size = operation->status.size;
-			gint64 modification_time_;
-			guint64 size_;
+	j_trace_enter(G_STRFUNC, NULL);
 
-			modification_time_ = j_message_get_8(reply);
-			size_ = j_message_get_8(reply);
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
 
-			*modification_time = modification_time_;
-			*size = size_;
-		}
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->status.object = j_object_ref(object);
+	iop->status.modification_time = modification_time;
+	iop->status.size = size;
 
-		j_list_iterator_free(it);
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = j_object_status_exec;
+	operation->free_func = j_object_status_free;
 
-		j_connection_pool_push_object(index, object_connection);
-	}
+	j_batch_add(batch, operation);
 
 	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 /**
- * Creates a new item.
+ * Adds an operation changing an object's extents to a batch.
+ *
+ * \private
  *
  * \author Michael Kuhn
  *
  * \code
- * JObject* i;
- *
- * i = j_object_new("JULEA");
  * \endcode
  *
- * \param name         An item name.
- * \param distribution A distribution.
- *
- * \return A new item. Should be freed with j_object_unref().
+ * \param object    An object.
+ * \param length    A length.
+ * \param offset    An offset within #object.
+ * \param exec_func The exec function.
+ * \param batch     A batch.
  **/
-JObject*
-j_object_new (gchar const* namespace, gchar const* name)
+static
+void
+j_object_extent_add (JObject* object, guint64 length, guint64 offset, JOperationExecFunc exec_func, JBatch* batch)
 {
-	JConfiguration* configuration = j_configuration();
-	JObject* object;
-
-	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(name != NULL, NULL);
+	JObjectOperation* iop;
+	JOperation* operation;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
 
-	object = g_slice_new(JObject);
-	object->index = j_helper_hash(name) % j_configuration_get_object_server_count(configuration);
-	object->namespace = g_strdup(namespace);
-	object->name = g_strdup(name);
-	object->ref_count = 1;
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->extent.object = j_object_ref(object);
+	iop->extent.length = length;
+	iop->extent.offset = offset;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
 
-	j_trace_leave(G_STRFUNC);
+	operation = j_operation_new();
+	operation->key = object;
+	operation->data = iop;
+	operation->exec_func = exec_func;
+	operation->free_func = j_object_extent_free;
 
-	return object;
+	j_batch_add(batch, operation);
 }
 
 /**
- * Creates a new item.
+ * Truncates or extends an object.
  *
  * \author Michael Kuhn
  *
  * \code
- * JObject* i;
- *
- * i = j_object_new("JULEA");
  * \endcode
  *
- * \param name         An item name.
- * \param distribution A distribution.
- *
- * \return A new item. Should be freed with j_object_unref().
+ * \param object An object.
+ * \param size   The new size.
+ * \param batch  A batch.
  **/
-JObject*
-j_object_new_for_index (guint32 index, gchar const* namespace, gchar const* name)
+void
+j_object_truncate (JObject* object, guint64 size, JBatch* batch)
 {
-	JConfiguration* configuration = j_configuration();
-	JObject* object;
-
-	g_return_val_if_fail(namespace != NULL, NULL);
-	g_return_val_if_fail(name != NULL, NULL);
-	g_return_val_if_fail(index < j_configuration_get_object_server_count(configuration), NULL);
+	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	object = g_slice_new(JObject);
-	object->index = index;
-	object->namespace = g_strdup(namespace);
-	object->name = g_strdup(name);
-	object->ref_count = 1;
+	j_object_extent_add(object, size, 0, j_object_truncate_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
-
-	return object;
 }
 
 /**
- * Increases an item's reference count.
+ * Preallocates space for an object without changing its size.
+ * Fails if the object backend does not support preallocation.
  *
  * \author Michael Kuhn
  *
  * \code
- * JObject* i;
- *
- * j_object_ref(i);
  * \endcode
  *
- * \param item An item.
- *
- * \return #item.
+ * \param object An object.
+ * \param length Number of bytes to preallocate.
+ * \param offset An offset within #object.
+ * \param batch  A batch.
  **/
-JObject*
-j_object_ref (JObject* item)
+void
+j_object_allocate (JObject* object, guint64 length, guint64 offset, JBatch* batch)
 {
-	g_return_val_if_fail(item != NULL, NULL);
+	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	g_atomic_int_inc(&(item->ref_count));
+	j_object_extent_add(object, length, offset, j_object_allocate_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
-
-	return item;
 }
 
 /**
- * Decreases an item's reference count.
- * When the reference count reaches zero, frees the memory allocated for the item.
+ * Deallocates a range of an object without changing its size.
+ * The range reads as zeros afterwards.
+ * Fails if the object backend does not support punching holes.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param item An item.
+ * \param object An object.
+ * \param length Number of bytes to deallocate.
+ * \param offset An offset within #object.
+ * \param batch  A batch.
  **/
 void
-j_object_unref (JObject* item)
+j_object_punch_hole (JObject* object, guint64 length, guint64 offset, JBatch* batch)
 {
-	g_return_if_fail(item != NULL);
+	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (g_atomic_int_dec_and_test(&(item->ref_count)))
-	{
-		g_free(item->name);
-		g_free(item->namespace);
-
-		g_slice_free(JObject, item);
-	}
+	j_object_extent_add(object, length, offset, j_object_punch_hole_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Creates an object.
+ * Makes all previous changes of an object durable.
+ * Syncs are barriers for batches with weaker safety semantics, such as J_SEMANTICS_TEMPLATE_CHECKPOINT.
+ * Executing the batch first executes all cached batches and then waits until the object's data has reached the storage, regardless of the batch's semantics.
  *
  * \author Michael Kuhn
  *
  * \code
- * \endcode
+ * g_autoptr(JBatch) batch = NULL;
  *
- * \param name         A name.
- * \param distribution A distribution.
- * \param batch        A batch.
+ * batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_CHECKPOINT);
  *
- * \return A new item. Should be freed with j_object_unref().
+ * j_object_write(object, data, length, offset, &bytes_written, batch);
+ * j_batch_execute(batch);
+ *
+ * j_object_sync(object, batch);
+ * j_batch_execute(batch);
+ * \endcode
+ *
+ * \param object An object.
+ * \param batch  A batch.
  **/
 void
-j_object_create (JObject* object, JBatch* batch)
+j_object_sync (JObject* object, JBatch* batch)
 {
-	JOperation* operation;
-
 	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	operation = j_operation_new();
-	// FIXME key = index + namespace
-	operation->key = object;
-	operation->data = j_object_ref(object);
-	operation->exec_func = j_object_create_exec;
-	operation->free_func = j_object_create_free;
-
-	j_batch_add(batch, operation);
+	j_object_extent_add(object, 0, 0, j_object_sync_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Deletes an object.
+ * Asks the server to read a range of an object into memory, so that later reads do not have to wait for the storage.
+ * Depending on the object backend, the range is read into the page cache or the object is moved to a faster tier.
+ * No data is transferred and, unless the batch's safety semantics require it, the server does not reply.
  *
  * \author Michael Kuhn
  *
  * \code
+ * g_autoptr(JBatch) batch = NULL;
+ *
+ * batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+ *
+ * j_object_prefetch(object, 64 * 1024 * 1024, 0, batch);
+ * j_batch_execute(batch);
  * \endcode
  *
- * \param item       An item.
- * \param batch      A batch.
+ * \param object An object.
+ * \param length Number of bytes to prefetch.
+ * \param offset An offset within #object.
+ * \param batch  A batch.
  **/
 void
-j_object_delete (JObject* object, JBatch* batch)
+j_object_prefetch (JObject* object, guint64 length, guint64 offset, JBatch* batch)
 {
-	JOperation* operation;
-
 	g_return_if_fail(object != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	operation = j_operation_new();
-	operation->key = object;
-	operation->data = j_object_ref(object);
-	operation->exec_func = j_object_delete_exec;
-	operation->free_func = j_object_delete_free;
-
-	j_batch_add(batch, operation);
+	j_object_extent_add(object, length, offset, j_object_prefetch_exec, batch);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Reads an item.
+ * Returns the extents of a range that contain data, so that holes of sparse objects do not have to be read.
+ * Holes read as zeros, so only the returned extents have to be transferred when copying an object.
+ * If #count equals #max_count afterwards, the range might contain further extents after the last one.
+ * Backends that can not detect holes report the part of the range within the object as a single extent.
  *
  * \author Michael Kuhn
  *
  * \code
+ * guint64 lengths[64];
+ * guint64 offsets[64];
+ * guint count;
+ *
+ * j_object_extents(object, G_MAXUINT64, 0, lengths, offsets, G_N_ELEMENTS(lengths), &count, batch);
+ * j_batch_execute(batch);
  * \endcode
  *
- * \param object     An object.
- * \param data       A buffer to hold the read data.
- * \param length     Number of bytes to read.
- * \param offset     An offset within #object.
- * \param bytes_read Number of bytes read.
- * \param batch      A batch.
+ * \param object    An object.
+ * \param length    The length of the range.
+ * \param offset    The offset of the range.
+ * \param lengths   An array for the lengths of at least #max_count extents.
+ * \param offsets   An array for the offsets of at least #max_count extents.
+ * \param max_count The maximum number of extents.
+ * \param count     The number of extents found, in ascending order.
+ * \param batch     A batch.
  **/
 void
-j_object_read (JObject* object, gpointer data, guint64 length, guint64 offset, guint64* bytes_read, JBatch* batch)
+j_object_extents (JObject* object, guint64 length, guint64 offset, guint64* lengths, guint64* offsets, guint max_count, guint* count, JBatch* batch)
 {
 	JObjectOperation* iop;
 	JOperation* operation;
 
 	g_return_if_fail(object != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(length > 0);
-	g_return_if_fail(bytes_read != NULL);
+	g_return_if_fail(lengths != NULL);
+	g_return_if_fail(offsets != NULL);
+	g_return_if_fail(count != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	iop = g_slice_new(JObjectOperation);
-	iop->read.object = j_object_ref(object);
-	iop->read.data = data;
-	iop->read.length = length;
-	iop->read.offset = offset;
-	iop->read.bytes_read = bytes_read;
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->extents.object = j_object_ref(object);
+	iop->extents.length = length;
+	iop->extents.offset = offset;
+	iop->extents.lengths = lengths;
+	iop->extents.offsets = offsets;
+	iop->extents.max_count = max_count;
+	iop->extents.count = count;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
 
 	operation = j_operation_new();
 	operation->key = object;
 	operation->data = iop;
-	operation->exec_func = j_object_read_exec;
-	operation->free_func = j_object_read_free;
-
-	*bytes_read = 0;
+	operation->exec_func = j_object_extents_exec;
+	operation->free_func = j_object_extents_free;
 
 	j_batch_add(batch, operation);
 
@@ -997,50 +4096,54 @@ j_object_read (JObject* object, gpointer data, guint64 length, guint64 offset, g
 }
 
 /**
- * Writes an item.
+ * Adds a copy to a batch.
  *
- * \note
- * j_object_write() modifies bytes_written even if j_batch_execute() is not called.
- *
- * \author Michael Kuhn
+ * \private
  *
- * \code
- * \endcode
- *
- * \param item          An item.
- * \param data          A buffer holding the data to write.
- * \param length        Number of bytes to write.
- * \param offset        An offset within #item.
- * \param bytes_written Number of bytes written.
- * \param batch         A batch.
+ * \param object       The source object.
+ * \param to           The destination object.
+ * \param bytes_copied Number of bytes copied, NULL if the caller is not interested.
+ * \param batch        A batch.
  **/
+static
 void
-j_object_write (JObject* object, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written, JBatch* batch)
+j_object_copy_internal (JObject* object, JObject* to, guint64* bytes_copied, JBatch* batch)
 {
 	JObjectOperation* iop;
 	JOperation* operation;
 
-	g_return_if_fail(object != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(length > 0);
-	g_return_if_fail(bytes_written != NULL);
-
 	j_trace_enter(G_STRFUNC, NULL);
 
-	iop = g_slice_new(JObjectOperation);
-	iop->write.object = j_object_ref(object);
-	iop->write.data = data;
-	iop->write.length = length;
-	iop->write.offset = offset;
-	iop->write.bytes_written = bytes_written;
+	/* Pending small writes have to be ordered before this operation. */
+	j_object_write_behind_close(object, NULL);
+	j_object_write_behind_close(to, NULL);
+
+	/* Prefetched data of the destination will be outdated. */
+	if (to->readahead != NULL)
+	{
+		j_readahead_invalidate(to->readahead);
+	}
+
+	g_atomic_int_set(&(to->node_cache_valid), FALSE);
+
+	if (bytes_copied != NULL)
+	{
+		*bytes_copied = 0;
+	}
+
+	iop = j_batch_alloc(batch, sizeof(JObjectOperation));
+	iop->copy.object = j_object_ref(object);
+	iop->copy.to = j_object_ref(to);
+	iop->copy.bytes_copied = bytes_copied;
+	iop->segments = NULL;
+	iop->segment_count = 0;
+	iop->write_behind = NULL;
 
 	operation = j_operation_new();
 	operation->key = object;
 	operation->data = iop;
-	operation->exec_func = j_object_write_exec;
-	operation->free_func = j_object_write_free;
-
-	*bytes_written = 0;
+	operation->exec_func = j_object_copy_exec;
+	operation->free_func = j_object_copy_free;
 
 	j_batch_add(batch, operation);
 
@@ -1048,40 +4151,57 @@ j_object_write (JObject* object, gconstpointer data, guint64 length, guint64 off
 }
 
 /**
- * Get the status of an item.
+ * Copies an object.
+ * The data is copied by the servers and does not pass through the client.
+ * The destination is created if necessary and overwritten otherwise.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param item      An item.
- * \param batch     A batch.
+ * \param object       The source object.
+ * \param to           The destination object.
+ * \param bytes_copied Number of bytes copied.
+ * \param batch        A batch.
  **/
 void
-j_object_status (JObject* object, gint64* modification_time, guint64* size, JBatch* batch)
+j_object_copy (JObject* object, JObject* to, guint64* bytes_copied, JBatch* batch)
 {
-	JObjectOperation* iop;
-	JOperation* operation;
-
 	g_return_if_fail(object != NULL);
+	g_return_if_fail(to != NULL);
+	g_return_if_fail(bytes_copied != NULL);
 
-	j_trace_enter(G_STRFUNC, NULL);
-
-	iop = g_slice_new(JObjectOperation);
-	iop->status.object = j_object_ref(object);
-	iop->status.modification_time = modification_time;
-	iop->status.size = size;
-
-	operation = j_operation_new();
-	operation->key = object;
-	operation->data = iop;
-	operation->exec_func = j_object_status_exec;
-	operation->free_func = j_object_status_free;
+	j_object_copy_internal(object, to, bytes_copied, batch);
+}
 
-	j_batch_add(batch, operation);
+/**
+ * Creates a snapshot of an object.
+ * The snapshot is created by the object's server, which shares the data with the snapshot if its backend supports it (for example, using reflinks on the posix backend).
+ * Subsequent writes to the object do not modify the snapshot.
+ * An existing object of the same name is overwritten.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JObject) snapshot = NULL;
+ *
+ * snapshot = j_object_new_for_index(j_object_get_index(object), "checkpoints", "checkpoint-1");
+ * j_object_snapshot(object, snapshot, batch);
+ * \endcode
+ *
+ * \param object   An object.
+ * \param snapshot The snapshot, has to be stored on the same server as #object.
+ * \param batch    A batch.
+ **/
+void
+j_object_snapshot (JObject* object, JObject* snapshot, JBatch* batch)
+{
+	g_return_if_fail(object != NULL);
+	g_return_if_fail(snapshot != NULL);
+	g_return_if_fail(object->index == snapshot->index);
 
-	j_trace_leave(G_STRFUNC);
+	j_object_copy_internal(object, snapshot, NULL, batch);
 }
 
 /**
@@ -0,0 +1,137 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include "julea-fuse.h"
+
+/**
+ * A cached attribute, which is valid until its expiry.
+ **/
+struct JFuseAttr
+{
+	struct stat stbuf;
+
+	/**
+	 * The expiry, in monotonic microseconds.
+	 **/
+	gint64 expiry;
+};
+
+typedef struct JFuseAttr JFuseAttr;
+
+static GHashTable* jfs_attr_cache = NULL;
+static GMutex jfs_attr_cache_mutex;
+
+/**
+ * Entries are kept as long as the kernel keeps its own attributes, see attr_timeout.
+ **/
+static gint64 jfs_attr_cache_timeout = 0;
+
+static
+void
+jfs_attr_free (gpointer data)
+{
+	g_slice_free(JFuseAttr, data);
+}
+
+void
+jfs_attr_cache_init (gdouble timeout)
+{
+	jfs_attr_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, jfs_attr_free);
+	jfs_attr_cache_timeout = timeout * G_USEC_PER_SEC;
+}
+
+void
+jfs_attr_cache_fini (void)
+{
+	g_hash_table_unref(jfs_attr_cache);
+	jfs_attr_cache = NULL;
+}
+
+gboolean
+jfs_attr_cache_lookup (char const* path, struct stat* stbuf)
+{
+	JFuseAttr* attr;
+	gboolean ret = FALSE;
+
+	g_mutex_lock(&jfs_attr_cache_mutex);
+
+	if ((attr = g_hash_table_lookup(jfs_attr_cache, path)) != NULL)
+	{
+		if (attr->expiry > g_get_monotonic_time())
+		{
+			*stbuf = attr->stbuf;
+			ret = TRUE;
+		}
+		else
+		{
+			g_hash_table_remove(jfs_attr_cache, path);
+		}
+	}
+
+	g_mutex_unlock(&jfs_attr_cache_mutex);
+
+	return ret;
+}
+
+void
+jfs_attr_cache_insert (char const* path, struct stat const* stbuf)
+{
+	JFuseAttr* attr;
+
+	if (jfs_attr_cache_timeout <= 0)
+	{
+		return;
+	}
+
+	attr = g_slice_new(JFuseAttr);
+	attr->stbuf = *stbuf;
+	attr->expiry = g_get_monotonic_time() + jfs_attr_cache_timeout;
+
+	g_mutex_lock(&jfs_attr_cache_mutex);
+	g_hash_table_replace(jfs_attr_cache, g_strdup(path), attr);
+	g_mutex_unlock(&jfs_attr_cache_mutex);
+}
+
+/**
+ * Updates a cached file's size and modification time, if it is cached.
+ **/
+void
+jfs_attr_cache_update (char const* path, guint64 size, gint64 time)
+{
+	JFuseAttr* attr;
+
+	g_mutex_lock(&jfs_attr_cache_mutex);
+
+	if ((attr = g_hash_table_lookup(jfs_attr_cache, path)) != NULL)
+	{
+		attr->stbuf.st_size = size;
+		attr->stbuf.st_atime = attr->stbuf.st_ctime = attr->stbuf.st_mtime = time / G_USEC_PER_SEC;
+	}
+
+	g_mutex_unlock(&jfs_attr_cache_mutex);
+}
+
+void
+jfs_attr_cache_remove (char const* path)
+{
+	g_mutex_lock(&jfs_attr_cache_mutex);
+	g_hash_table_remove(jfs_attr_cache, path);
+	g_mutex_unlock(&jfs_attr_cache_mutex);
+}
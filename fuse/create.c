@@ -30,20 +30,26 @@ int jfs_create (char const* path, mode_t mode, struct fuse_file_info* fi)
 	g_autoptr(JKV) kv = NULL;
 	g_autoptr(JObject) object = NULL;
 	bson_t* file;
+	bson_oid_t oid;
+	gchar object_name[25];
 	g_autofree gchar* basename = NULL;
 
 	(void)mode;
-	(void)fi;
+
+	/* Objects are not named after their paths, so that files can be renamed without moving their data. */
+	bson_oid_init(&oid, bson_context_get_default());
+	bson_oid_to_string(&oid, object_name);
 
 	basename = g_path_get_basename(path);
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
 	kv = j_kv_new("posix", path);
-	object = j_object_new("posix", path);
+	object = j_object_new("posix", object_name);
 
 	// FIXME
 	file = g_slice_new(bson_t);
 	bson_init(file);
 	bson_append_utf8(file, "name", -1, basename, -1);
+	bson_append_utf8(file, "object", -1, object_name, -1);
 	bson_append_bool(file, "file", -1, TRUE);
 	bson_append_int64(file, "size", -1, 0);
 	bson_append_int64(file, "time", -1, g_get_real_time());
@@ -51,8 +57,11 @@ int jfs_create (char const* path, mode_t mode, struct fuse_file_info* fi)
 	j_kv_put(kv, file, batch);
 	j_object_create(object, batch);
 
+	jfs_attr_cache_remove(path);
+
 	if (j_batch_execute(batch))
 	{
+		fi->fh = (guint64)(guintptr)jfs_file_new(path, object_name, 0);
 		ret = 0;
 	}
 
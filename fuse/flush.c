@@ -0,0 +1,67 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include "julea-fuse.h"
+
+#include <errno.h>
+
+gboolean
+jfs_file_flush (JFuseFile* file)
+{
+	gboolean ret = TRUE;
+
+	g_mutex_lock(&(file->mutex));
+
+	if (file->size_changed)
+	{
+		bson_t maxima[1];
+
+		bson_init(maxima);
+		bson_append_int64(maxima, "size", -1, file->size);
+		bson_append_int64(maxima, "time", -1, g_get_real_time());
+
+		j_kv_max_merge(file->kv, maxima, file->batch);
+		bson_destroy(maxima);
+
+		ret = j_batch_execute(file->batch);
+		file->size_changed = !ret;
+
+		jfs_attr_cache_remove(file->path);
+	}
+
+	g_mutex_unlock(&(file->mutex));
+
+	return ret;
+}
+
+int
+jfs_flush (char const* path, struct fuse_file_info* fi)
+{
+	JFuseFile* file = (JFuseFile*)(guintptr)fi->fh;
+
+	(void)path;
+
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	return jfs_file_flush(file) ? 0 : -EIO;
+}
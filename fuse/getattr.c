@@ -23,6 +23,51 @@
 #include <errno.h>
 #include <string.h>
 
+void
+jfs_stat_from_bson (bson_t const* file, struct stat* stbuf)
+{
+	bson_iter_t iter;
+	gboolean is_file = TRUE;
+	gint64 size = 0;
+	gint64 time = 0;
+
+	if (bson_iter_init_find(&iter, file, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL)
+	{
+		is_file = bson_iter_bool(&iter);
+	}
+
+	if (bson_iter_init_find(&iter, file, "size") && BSON_ITER_HOLDS_NUMBER(&iter))
+	{
+		size = bson_iter_as_int64(&iter);
+	}
+
+	if (bson_iter_init_find(&iter, file, "time") && BSON_ITER_HOLDS_NUMBER(&iter))
+	{
+		time = bson_iter_as_int64(&iter);
+	}
+
+	memset(stbuf, 0, sizeof(*stbuf));
+
+	if (is_file)
+	{
+		stbuf->st_mode = S_IFREG | S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+		stbuf->st_nlink = 1;
+		stbuf->st_uid = 0;
+		stbuf->st_gid = 0;
+		stbuf->st_size = size;
+		stbuf->st_atime = stbuf->st_ctime = stbuf->st_mtime = time / G_USEC_PER_SEC;
+	}
+	else
+	{
+		stbuf->st_mode = S_IFDIR | S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
+		stbuf->st_nlink = 1;
+		stbuf->st_uid = 0;
+		stbuf->st_gid = 0;
+		stbuf->st_size = 0;
+		stbuf->st_atime = stbuf->st_ctime = stbuf->st_mtime = 0;
+	}
+}
+
 int
 jfs_getattr (char const* path, struct stat* stbuf)
 {
@@ -44,6 +89,11 @@ jfs_getattr (char const* path, struct stat* stbuf)
 		return 0;
 	}
 
+	if (jfs_attr_cache_lookup(path, stbuf))
+	{
+		return 0;
+	}
+
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
 	kv = j_kv_new("posix", path);
 
@@ -51,39 +101,12 @@ jfs_getattr (char const* path, struct stat* stbuf)
 
 	if (j_batch_execute(batch))
 	{
-		bson_iter_t iter;
-		gboolean is_file = TRUE;
-		// FIXME
-		gint64 size = 0;
-		gint64 time = 0;
-
-		if (bson_iter_init_find(&iter, file, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL)
-		{
-			is_file = bson_iter_bool(&iter);
-		}
-
-		if (is_file)
-		{
-			stbuf->st_mode = S_IFREG | S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-			stbuf->st_nlink = 1;
-			stbuf->st_uid = 0;
-			stbuf->st_gid = 0;
-			stbuf->st_size = size;
-			stbuf->st_atime = stbuf->st_ctime = stbuf->st_mtime = time / G_USEC_PER_SEC;
-
-			ret = 0;
-		}
-		else
-		{
-			stbuf->st_mode = S_IFDIR | S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
-			stbuf->st_nlink = 1;
-			stbuf->st_uid = 0;
-			stbuf->st_gid = 0;
-			stbuf->st_size = 0;
-			stbuf->st_atime = stbuf->st_ctime = stbuf->st_mtime = 0;
-
-			ret = 0;
-		}
+		jfs_stat_from_bson(file, stbuf);
+		jfs_attr_cache_insert(path, stbuf);
+
+		bson_destroy(file);
+
+		ret = 0;
 	}
 
 	return ret;
@@ -22,7 +22,17 @@
 
 void* jfs_init (struct fuse_conn_info* conn)
 {
-	(void)conn;
+	/* Splicing avoids copying the data between the kernel and the handlers. */
+#ifdef FUSE_CAP_SPLICE_READ
+	conn->want |= conn->capable & (FUSE_CAP_SPLICE_READ | FUSE_CAP_SPLICE_WRITE | FUSE_CAP_SPLICE_MOVE);
+#endif
+
+	/* Buffering writes in the kernel turns small application writes into large requests. */
+#ifdef FUSE_CAP_WRITEBACK_CACHE
+	conn->want |= conn->capable & FUSE_CAP_WRITEBACK_CACHE;
+#endif
+
+	conn->max_readahead = J_STRIPE_SIZE;
 
 	return NULL;
 }
@@ -28,11 +28,17 @@ struct fuse_operations jfs_vtable = {
 	.chown    = jfs_chown,
 	.create   = jfs_create,
 	.destroy  = jfs_destroy,
+	.flush    = jfs_flush,
 	.getattr  = jfs_getattr,
 	.init     = jfs_init,
 	.mkdir    = jfs_mkdir,
+	.open     = jfs_open,
+	.opendir  = jfs_opendir,
 	.read     = jfs_read,
 	.readdir  = jfs_readdir,
+	.release  = jfs_release,
+	.releasedir = jfs_releasedir,
+	.rename   = jfs_rename,
 	.rmdir    = jfs_rmdir,
 	.truncate = jfs_truncate,
 	.unlink   = jfs_unlink,
@@ -40,16 +46,47 @@ struct fuse_operations jfs_vtable = {
 	.write    = jfs_write,
 };
 
+static struct fuse_opt jfs_options[] = {
+	{ "attr_timeout=%lf", 0, 0 },
+	FUSE_OPT_END
+};
+
 int
 main (int argc, char** argv)
 {
+	struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
 	gint ret;
 
+	/* FUSE's default */
+	gdouble attr_timeout = 1.0;
+	g_autofree gchar* attr_timeout_option = NULL;
+	g_autofree gchar* io_size_option = NULL;
+
+	if (fuse_opt_parse(&args, &attr_timeout, jfs_options, NULL) == -1)
+	{
+		return 1;
+	}
+
+	/* The kernel is told the same timeout the attribute cache uses. */
+	attr_timeout_option = g_strdup_printf("-oattr_timeout=%f", attr_timeout);
+	fuse_opt_add_arg(&args, attr_timeout_option);
+
+	/*
+	 * Requests should cover whole stripes, otherwise the kernel splits accesses into 4 KiB (or 128 KiB) pieces.
+	 * FUSE handles requests in multiple threads unless -s is given.
+	 */
+	io_size_option = g_strdup_printf("-obig_writes,max_write=%u,max_read=%u", J_STRIPE_SIZE, J_STRIPE_SIZE);
+	fuse_opt_add_arg(&args, io_size_option);
+
 	j_init();
+	jfs_attr_cache_init(attr_timeout);
 
-	ret = fuse_main(argc, argv, &jfs_vtable, NULL);
+	ret = fuse_main(args.argc, args.argv, &jfs_vtable, NULL);
 
+	jfs_attr_cache_fini();
 	j_fini();
 
+	fuse_opt_free_args(&args);
+
 	return ret;
 }
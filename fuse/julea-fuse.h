@@ -25,20 +25,89 @@
 #include <julea-kv.h>
 #include <julea-object.h>
 
+#include <julea-internal.h>
+
 #include <glib.h>
 
+/**
+ * A file opened by FUSE, stored in fuse_file_info's fh.
+ * Reusing it avoids setting up the KV, object and batch for every read and write.
+ **/
+struct JFuseFile
+{
+	gchar* path;
+
+	JKV* kv;
+	JObject* object;
+	JBatch* batch;
+
+	/**
+	 * Serializes the users of batch, since FUSE can handle requests concurrently.
+	 **/
+	GMutex mutex;
+
+	/**
+	 * The file's size, which is only stored on flush.
+	 **/
+	guint64 size;
+	gboolean size_changed;
+};
+
+typedef struct JFuseFile JFuseFile;
+
+/**
+ * A directory opened by FUSE, stored in fuse_file_info's fh.
+ * It remembers where the last readdir stopped, so that the next one can continue from there.
+ **/
+struct JFuseDirectory
+{
+	gchar* prefix;
+
+	GMutex mutex;
+
+	/**
+	 * The key of the last returned entry and its offset.
+	 **/
+	gchar* last_key;
+	off_t last_offset;
+};
+
+typedef struct JFuseDirectory JFuseDirectory;
+
+void jfs_attr_cache_init (gdouble);
+void jfs_attr_cache_fini (void);
+gboolean jfs_attr_cache_lookup (char const*, struct stat*);
+void jfs_attr_cache_insert (char const*, struct stat const*);
+void jfs_attr_cache_update (char const*, guint64, gint64);
+void jfs_attr_cache_remove (char const*);
+
+void jfs_stat_from_bson (bson_t const*, struct stat*);
+
+gchar const* jfs_object_name (bson_t const*, char const*);
+JObject* jfs_object_new (char const*);
+
+JFuseFile* jfs_file_new (char const*, char const*, guint64);
+gboolean jfs_file_flush (JFuseFile*);
+void jfs_file_rename (char const*, char const*);
+void jfs_file_free (JFuseFile*);
+
 int jfs_access (char const*, int);
 int jfs_chmod (char const*, mode_t);
 int jfs_chown (char const*, uid_t, gid_t);
 int jfs_create (char const*, mode_t, struct fuse_file_info*);
 void jfs_destroy (void*);
+int jfs_flush (char const*, struct fuse_file_info*);
 int jfs_getattr (char const*, struct stat*);
 void* jfs_init (struct fuse_conn_info*);
 int jfs_link (char const*, char const*);
 int jfs_mkdir(char const*, mode_t);
 int jfs_open (char const*, struct fuse_file_info*);
+int jfs_opendir (char const*, struct fuse_file_info*);
 int jfs_read (char const*, char*, size_t, off_t, struct fuse_file_info*);
 int jfs_readdir (char const*, void*, fuse_fill_dir_t, off_t, struct fuse_file_info*);
+int jfs_release (char const*, struct fuse_file_info*);
+int jfs_releasedir (char const*, struct fuse_file_info*);
+int jfs_rename (char const*, char const*);
 int jfs_rmdir (char const*);
 int jfs_statfs (char const*, struct statvfs*);
 int jfs_truncate (char const*, off_t);
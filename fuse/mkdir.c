@@ -44,6 +44,8 @@ int jfs_mkdir(char const* path, mode_t mode)
 	bson_append_bool(file, "file", -1, FALSE);
 	j_kv_put(kv, file, batch);
 
+	jfs_attr_cache_remove(path);
+
 	if (j_batch_execute(batch))
 	{
 		ret = 0;
@@ -0,0 +1,201 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include "julea-fuse.h"
+
+#include <errno.h>
+#include <string.h>
+
+/**
+ * The open files, so that their paths can be updated when they are renamed.
+ **/
+static GList* jfs_files = NULL;
+static GMutex jfs_files_mutex;
+
+/**
+ * Returns the name of a file's object.
+ * Objects are named independently of their files, so that renaming a file does not have to move its data.
+ * Files created before have objects named after their original path.
+ **/
+gchar const*
+jfs_object_name (bson_t const* file, char const* path)
+{
+	bson_iter_t iter;
+
+	if (bson_iter_init_find(&iter, file, "object") && BSON_ITER_HOLDS_UTF8(&iter))
+	{
+		return bson_iter_utf8(&iter, NULL);
+	}
+
+	return path;
+}
+
+/**
+ * Looks up a file's object, for requests without an open file.
+ *
+ * \return The object, NULL if the file does not exist.
+ **/
+JObject*
+jfs_object_new (char const* path)
+{
+	JObject* object = NULL;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	bson_t file[1];
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
+	kv = j_kv_new("posix", path);
+
+	j_kv_get(kv, file, batch);
+
+	if (j_batch_execute(batch))
+	{
+		object = j_object_new("posix", jfs_object_name(file, path));
+		bson_destroy(file);
+	}
+
+	return object;
+}
+
+JFuseFile*
+jfs_file_new (char const* path, char const* object_name, guint64 size)
+{
+	JFuseFile* file;
+
+	file = g_slice_new(JFuseFile);
+	file->path = g_strdup(path);
+	file->kv = j_kv_new("posix", path);
+	file->object = j_object_new("posix", object_name);
+	file->batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
+	file->size = size;
+	file->size_changed = FALSE;
+
+	g_mutex_init(&(file->mutex));
+
+	g_mutex_lock(&jfs_files_mutex);
+	jfs_files = g_list_prepend(jfs_files, file);
+	g_mutex_unlock(&jfs_files_mutex);
+
+	return file;
+}
+
+/**
+ * Updates the paths of open files that have been renamed, including those within a renamed directory.
+ * Otherwise, their sizes would be stored at their old paths when they are flushed.
+ **/
+void
+jfs_file_rename (char const* from, char const* to)
+{
+	gsize from_len;
+
+	from_len = strlen(from);
+
+	g_mutex_lock(&jfs_files_mutex);
+
+	for (GList* l = jfs_files; l != NULL; l = l->next)
+	{
+		JFuseFile* file = l->data;
+		gchar* path;
+
+		if (strncmp(file->path, from, from_len) != 0 || (file->path[from_len] != '\0' && file->path[from_len] != '/'))
+		{
+			continue;
+		}
+
+		path = g_strconcat(to, file->path + from_len, NULL);
+
+		g_mutex_lock(&(file->mutex));
+
+		g_free(file->path);
+		file->path = path;
+
+		j_kv_unref(file->kv);
+		file->kv = j_kv_new("posix", path);
+
+		g_mutex_unlock(&(file->mutex));
+	}
+
+	g_mutex_unlock(&jfs_files_mutex);
+}
+
+void
+jfs_file_free (JFuseFile* file)
+{
+	g_mutex_lock(&jfs_files_mutex);
+	jfs_files = g_list_remove(jfs_files, file);
+	g_mutex_unlock(&jfs_files_mutex);
+
+	g_mutex_clear(&(file->mutex));
+
+	j_batch_unref(file->batch);
+	j_object_unref(file->object);
+	j_kv_unref(file->kv);
+
+	g_free(file->path);
+
+	g_slice_free(JFuseFile, file);
+}
+
+int
+jfs_open (char const* path, struct fuse_file_info* fi)
+{
+	int ret = -ENOENT;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	bson_t file[1];
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
+	kv = j_kv_new("posix", path);
+
+	j_kv_get(kv, file, batch);
+
+	if (j_batch_execute(batch))
+	{
+		bson_iter_t iter;
+		gboolean is_file = TRUE;
+		gint64 size = 0;
+
+		if (bson_iter_init_find(&iter, file, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL)
+		{
+			is_file = bson_iter_bool(&iter);
+		}
+
+		if (bson_iter_init_find(&iter, file, "size") && BSON_ITER_HOLDS_NUMBER(&iter))
+		{
+			size = bson_iter_as_int64(&iter);
+		}
+
+		if (is_file)
+		{
+			fi->fh = (guint64)(guintptr)jfs_file_new(path, jfs_object_name(file, path), size);
+			ret = 0;
+		}
+		else
+		{
+			ret = -EISDIR;
+		}
+
+		bson_destroy(file);
+	}
+
+	return ret;
+}
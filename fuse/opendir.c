@@ -0,0 +1,47 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include "julea-fuse.h"
+
+int
+jfs_opendir (char const* path, struct fuse_file_info* fi)
+{
+	JFuseDirectory* directory;
+
+	directory = g_slice_new(JFuseDirectory);
+
+	if (g_strcmp0(path, "/") == 0)
+	{
+		directory->prefix = g_strdup(path);
+	}
+	else
+	{
+		directory->prefix = g_strdup_printf("%s/", path);
+	}
+
+	directory->last_key = NULL;
+	directory->last_offset = 0;
+
+	g_mutex_init(&(directory->mutex));
+
+	fi->fh = (guint64)(guintptr)directory;
+
+	return 0;
+}
@@ -27,16 +27,35 @@ jfs_read (char const* path, char* buf, size_t size, off_t offset, struct fuse_fi
 {
 	int ret = -ENOENT;
 
+	JFuseFile* file = (JFuseFile*)(guintptr)fi->fh;
 	g_autoptr(JBatch) batch = NULL;
-	g_autoptr(JKV) kv = NULL;
 	g_autoptr(JObject) object = NULL;
 	guint64 bytes_read;
 
-	(void)fi;
+	/* Concurrent reads of the same file, such as the kernel's readahead, do not wait for the handle's batch. */
+	if (file != NULL && g_mutex_trylock(&(file->mutex)))
+	{
+
+		j_object_read(file->object, buf, size, offset, &bytes_read, file->batch);
+
+		if (j_batch_execute(file->batch))
+		{
+			ret = bytes_read;
+		}
+
+		g_mutex_unlock(&(file->mutex));
+
+		return ret;
+	}
+
+	object = (file != NULL) ? j_object_ref(file->object) : jfs_object_new(path);
+
+	if (object == NULL)
+	{
+		return ret;
+	}
 
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
-	kv = j_kv_new("posix", path);
-	object = j_object_new("posix", path);
 
 	j_object_read(object, buf, size, offset, &bytes_read, batch);
 
@@ -23,49 +23,84 @@
 #include <errno.h>
 #include <string.h>
 
+/**
+ * The number of entries requested from the servers at once.
+ **/
+#define JFS_READDIR_PAGE 256
+
 int
 jfs_readdir (char const* path, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi)
 {
-	int ret = -ENOENT;
-
-	JKVIterator* it;
-	g_autofree gchar* prefix = NULL;
+	JFuseDirectory* directory = (JFuseDirectory*)(guintptr)fi->fh;
+	gboolean full = FALSE;
 
-	(void)offset;
-	(void)fi;
+	(void)path;
 
-	if (g_strcmp0(path, "/") == 0)
+	if (directory == NULL)
 	{
-		prefix = g_strdup(path);
+		return -EBADF;
 	}
-	else
+
+	g_mutex_lock(&(directory->mutex));
+
+	/* Seeking anywhere but to the last position restarts the directory, skipping the first entries. */
+	if (offset != directory->last_offset)
 	{
-		prefix = g_strdup_printf("%s/", path);
+		g_free(directory->last_key);
+		directory->last_key = NULL;
+		directory->last_offset = 0;
 	}
 
-	it = j_kv_iterator_new(0, "posix", prefix);
-
-	while (j_kv_iterator_next(it))
+	while (!full)
 	{
-		bson_t const* value = j_kv_iterator_get(it);
-		bson_iter_t iter;
+		JKVIterator* it;
+		guint32 count = 0;
+
+		it = j_kv_iterator_new_children("posix", directory->prefix, "/", directory->last_key, JFS_READDIR_PAGE);
 
-		if (bson_iter_init_find(&iter, value, "name") && bson_iter_type(&iter) == BSON_TYPE_UTF8)
+		while (!full && j_kv_iterator_next(it))
 		{
-			gchar const* name;
+			bson_t const* value = j_kv_iterator_get(it);
+			gchar const* key = j_kv_iterator_get_key(it);
+			gchar const* name = "???";
+			bson_iter_t iter;
+			struct stat stbuf;
+
+			count++;
 
-			name = bson_iter_utf8(&iter, NULL);
-			filler(buf, name, NULL, 0);
+			if (bson_iter_init_find(&iter, value, "name") && bson_iter_type(&iter) == BSON_TYPE_UTF8)
+			{
+				name = bson_iter_utf8(&iter, NULL);
+			}
+
+			/* The values contain the attributes, so the following getattrs do not need further KV operations. */
+			jfs_stat_from_bson(value, &stbuf);
+			jfs_attr_cache_insert(key, &stbuf);
+
+			if (directory->last_offset >= offset)
+			{
+				/* The buffer is full, so the entry has to be returned by the next call. */
+				if (filler(buf, name, &stbuf, directory->last_offset + 1) != 0)
+				{
+					full = TRUE;
+					break;
+				}
+			}
+
+			g_free(directory->last_key);
+			directory->last_key = g_strdup(key);
+			directory->last_offset++;
 		}
-		else
+
+		j_kv_iterator_free(it);
+
+		if (count < JFS_READDIR_PAGE)
 		{
-			filler(buf, "???", NULL, 0);
+			break;
 		}
 	}
 
-	j_kv_iterator_free(it);
-
-	ret = 0;
+	g_mutex_unlock(&(directory->mutex));
 
-	return ret;
+	return 0;
 }
@@ -0,0 +1,43 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include "julea-fuse.h"
+
+int
+jfs_releasedir (char const* path, struct fuse_file_info* fi)
+{
+	JFuseDirectory* directory = (JFuseDirectory*)(guintptr)fi->fh;
+
+	(void)path;
+
+	if (directory != NULL)
+	{
+		g_mutex_clear(&(directory->mutex));
+
+		g_free(directory->last_key);
+		g_free(directory->prefix);
+
+		g_slice_free(JFuseDirectory, directory);
+
+		fi->fh = 0;
+	}
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include "julea-fuse.h"
+
+#include <errno.h>
+#include <string.h>
+
+/**
+ * Moves an entry's metadata to a new path.
+ * Files keep their objects, so their data does not have to be copied.
+ **/
+static
+void
+jfs_rename_entry (gchar const* from, gchar const* to, bson_t const* value, JBatch* batch)
+{
+	g_autoptr(JKV) from_kv = NULL;
+	g_autoptr(JKV) to_kv = NULL;
+	bson_t* renamed;
+	bson_iter_t iter;
+	g_autofree gchar* basename = NULL;
+
+	basename = g_path_get_basename(to);
+
+	renamed = g_slice_new(bson_t);
+	bson_init(renamed);
+	bson_copy_to_excluding_noinit(value, renamed, "name", "object", NULL);
+	bson_append_utf8(renamed, "name", -1, basename, -1);
+
+	if (bson_iter_init_find(&iter, value, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL && bson_iter_bool(&iter))
+	{
+		bson_append_utf8(renamed, "object", -1, jfs_object_name(value, from), -1);
+	}
+
+	from_kv = j_kv_new("posix", from);
+	to_kv = j_kv_new("posix", to);
+
+	j_kv_put(to_kv, renamed, batch);
+	j_kv_delete(from_kv, batch);
+
+	jfs_attr_cache_remove(from);
+	jfs_attr_cache_remove(to);
+}
+
+/**
+ * Checks whether a directory has any entries.
+ **/
+static
+gboolean
+jfs_rename_has_children (gchar const* path)
+{
+	JKVIterator* it;
+	g_autofree gchar* prefix = NULL;
+	gboolean ret;
+
+	prefix = g_strdup_printf("%s/", path);
+	it = j_kv_iterator_new_children("posix", prefix, "/", NULL, 1);
+	ret = j_kv_iterator_next(it);
+	j_kv_iterator_free(it);
+
+	return ret;
+}
+
+int
+jfs_rename (char const* from, char const* to)
+{
+	int ret = -ENOENT;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autoptr(JKV) to_kv = NULL;
+	bson_t file[1];
+	bson_t target[1];
+	bson_iter_t iter;
+	gboolean is_file = TRUE;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
+	kv = j_kv_new("posix", from);
+
+	j_kv_get(kv, file, batch);
+
+	if (!j_batch_execute(batch))
+	{
+		return ret;
+	}
+
+	if (bson_iter_init_find(&iter, file, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL)
+	{
+		is_file = bson_iter_bool(&iter);
+	}
+
+	to_kv = j_kv_new("posix", to);
+	j_kv_get(to_kv, target, batch);
+
+	/* An existing target is replaced, unless it is a directory that still has entries. */
+	if (j_batch_execute(batch))
+	{
+		gboolean target_is_file = TRUE;
+
+		if (bson_iter_init_find(&iter, target, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL)
+		{
+			target_is_file = bson_iter_bool(&iter);
+		}
+
+		bson_destroy(target);
+
+		if (is_file && !target_is_file)
+		{
+			ret = -EISDIR;
+			goto end;
+		}
+		else if (!is_file && target_is_file)
+		{
+			ret = -ENOTDIR;
+			goto end;
+		}
+		else if (!target_is_file && jfs_rename_has_children(to))
+		{
+			ret = -ENOTEMPTY;
+			goto end;
+		}
+	}
+
+	jfs_rename_entry(from, to, file, batch);
+
+	/* Keys are full paths, so all entries within a directory have to be moved, too. */
+	if (!is_file)
+	{
+		JKVIterator* it;
+		g_autofree gchar* prefix = NULL;
+		gsize from_len;
+
+		prefix = g_strdup_printf("%s/", from);
+		from_len = strlen(from);
+		it = j_kv_iterator_new_for_prefix("posix", prefix);
+
+		while (j_kv_iterator_next(it))
+		{
+			gchar const* key = j_kv_iterator_get_key(it);
+			g_autofree gchar* renamed = NULL;
+
+			renamed = g_strconcat(to, key + from_len, NULL);
+			jfs_rename_entry(key, renamed, j_kv_iterator_get(it), batch);
+		}
+
+		j_kv_iterator_free(it);
+	}
+
+	if (j_batch_execute(batch))
+	{
+		jfs_file_rename(from, to);
+		ret = 0;
+	}
+	else
+	{
+		ret = -EIO;
+	}
+
+end:
+	bson_destroy(file);
+
+	return ret;
+}
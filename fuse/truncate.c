@@ -29,10 +29,9 @@ jfs_truncate (char const* path, off_t size)
 
 	g_autoptr(JBatch) batch = NULL;
 	g_autoptr(JKV) kv = NULL;
+	g_autoptr(JObject) object = NULL;
 	bson_t file[1];
 
-	(void)size;
-
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
 	kv = j_kv_new("posix", path);
 
@@ -44,9 +43,25 @@ jfs_truncate (char const* path, off_t size)
 
 		if (bson_iter_init_find(&iter, file, "file") && bson_iter_type(&iter) == BSON_TYPE_BOOL && bson_iter_bool(&iter))
 		{
-			// FIXME
-			ret = 0;
+			bson_t* updated;
+
+			/* Truncating can shrink the file, so the size is replaced instead of max-merged. */
+			updated = g_slice_new(bson_t);
+			bson_init(updated);
+			bson_copy_to_excluding_noinit(file, updated, "size", "time", NULL);
+			bson_append_int64(updated, "size", -1, size);
+			bson_append_int64(updated, "time", -1, g_get_real_time());
+
+			object = j_object_new("posix", jfs_object_name(file, path));
+			j_object_truncate(object, size, batch);
+			j_kv_put(kv, updated, batch);
+
+			jfs_attr_cache_remove(path);
+
+			ret = j_batch_execute(batch) ? 0 : -EIO;
 		}
+
+		bson_destroy(file);
 	}
 
 	return ret;
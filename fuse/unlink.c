@@ -33,6 +33,7 @@ int jfs_unlink (char const* path)
 	kv = j_kv_new("posix", path);
 
 	j_kv_delete(kv, batch);
+	jfs_attr_cache_remove(path);
 
 	if (j_batch_execute(batch))
 	{
@@ -27,20 +27,55 @@ jfs_write (char const* path, char const* buf, size_t size, off_t offset, struct
 {
 	int ret = -ENOENT;
 
+	JFuseFile* file = (JFuseFile*)(guintptr)fi->fh;
 	g_autoptr(JBatch) batch = NULL;
 	g_autoptr(JKV) kv = NULL;
 	g_autoptr(JObject) object = NULL;
+	bson_t maxima[1];
 	guint64 bytes_written;
 
-	(void)fi;
+	if (file != NULL)
+	{
+		g_mutex_lock(&(file->mutex));
+
+		j_object_write(file->object, buf, size, offset, &bytes_written, file->batch);
+
+		if (j_batch_execute(file->batch))
+		{
+			if ((guint64)offset + bytes_written > file->size)
+			{
+				file->size = offset + bytes_written;
+				file->size_changed = TRUE;
+			}
+
+			jfs_attr_cache_update(path, file->size, g_get_real_time());
+
+			ret = bytes_written;
+		}
+
+		g_mutex_unlock(&(file->mutex));
+
+		return ret;
+	}
+
+	if ((object = jfs_object_new(path)) == NULL)
+	{
+		return ret;
+	}
 
 	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_POSIX);
 	kv = j_kv_new("posix", path);
-	object = j_object_new("posix", path);
 
-	// FIXME update size
 	j_object_write(object, buf, size, offset, &bytes_written, batch);
 
+	bson_init(maxima);
+	bson_append_int64(maxima, "size", -1, offset + size);
+	bson_append_int64(maxima, "time", -1, g_get_real_time());
+	j_kv_max_merge(kv, maxima, batch);
+	bson_destroy(maxima);
+
+	jfs_attr_cache_remove(path);
+
 	if (j_batch_execute(batch))
 	{
 		ret = bytes_written;
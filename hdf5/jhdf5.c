@@ -0,0 +1,1937 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * HDF5 VOL connector storing files in JULEA.
+ *
+ * Files, groups and datasets are stored as KV documents in the "hdf5" namespace, attributes in the "hdf5-attribute" namespace.
+ * Their keys are the escaped file name followed by the object's path, so all objects of a file share a prefix.
+ * The data of datasets is stored contiguously in row-major order in distributed objects named like their documents.
+ * Selections are translated into vectored reads and writes, asynchronous operations are executed using j_batch_execute_async().
+ *
+ * The connector is loaded by setting HDF5_PLUGIN_PATH to the library's directory and HDF5_VOL_CONNECTOR to "julea".
+ *
+ * The following operations are not supported and fail with an HDF5 error:
+ * - Committed datatypes (H5Tcommit() and H5Topen()).
+ * - Changing a dataset's extent (H5Dset_extent()).
+ * - Link operations other than checking whether a link exists, for example H5Lcreate_hard(), H5Lcopy(), H5Lmove(), H5Ldelete() and H5Literate().
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <hdf5.h>
+#include <H5PLextern.h>
+#include <H5VLconnector.h>
+
+#include <julea.h>
+#include <julea-kv.h>
+#include <julea-object.h>
+
+/**
+ * User-defined connector values range from 256 to 65535.
+ **/
+#define J_HDF5_VOL_VALUE 530
+
+#define J_HDF5_NAMESPACE "hdf5"
+#define J_HDF5_ATTRIBUTE_NAMESPACE "hdf5-attribute"
+
+/**
+ * Pushes an error for an operation the connector does not support onto HDF5's error stack.
+ **/
+#define J_HDF5_UNSUPPORTED(operation) H5Epush2(H5E_DEFAULT, __FILE__, G_STRFUNC, __LINE__, H5E_ERR_CLS, H5E_VOL, H5E_UNSUPPORTED, "%s is not supported by the JULEA VOL connector", operation)
+
+enum JHDF5ObjectType
+{
+	J_HDF5_OBJECT_FILE,
+	J_HDF5_OBJECT_GROUP,
+	J_HDF5_OBJECT_DATASET,
+	J_HDF5_OBJECT_ATTRIBUTE
+};
+
+typedef enum JHDF5ObjectType JHDF5ObjectType;
+
+/**
+ * A file, group, dataset or attribute.
+ **/
+struct JHDF5Object
+{
+	JHDF5ObjectType type;
+
+	/**
+	 * The key of the object's file, i.e. the escaped file name.
+	 **/
+	gchar* file;
+
+	/**
+	 * The object's key, attributes use the key of their object followed by their name.
+	 **/
+	gchar* key;
+
+	/**
+	 * The flags the file has been opened with.
+	 **/
+	unsigned flags;
+
+	union
+	{
+		struct
+		{
+			gchar* name;
+			hid_t fapl_id;
+			hid_t fcpl_id;
+		}
+		file;
+
+		struct
+		{
+			JDistributedObject* object;
+			hid_t type_id;
+			hid_t space_id;
+			hid_t dcpl_id;
+		}
+		dataset;
+
+		struct
+		{
+			JKV* kv;
+			hid_t type_id;
+			hid_t space_id;
+
+			/**
+			 * The attribute's data, kept up to date by writes.
+			 **/
+			GBytes* data;
+		}
+		attribute;
+	};
+};
+
+typedef struct JHDF5Object JHDF5Object;
+
+/**
+ * An asynchronous operation.
+ **/
+struct JHDF5Request
+{
+	JBatch* batch;
+
+	/**
+	 * The bytes read or written, one per dataset.
+	 **/
+	guint64* bytes;
+
+	/**
+	 * Whether the batch succeeded, only valid once it has finished.
+	 **/
+	gboolean ret;
+
+	H5VL_request_notify_t notify;
+	gpointer notify_context;
+	gboolean done;
+
+	GMutex mutex[1];
+};
+
+typedef struct JHDF5Request JHDF5Request;
+
+/**
+ * A part of a selection that is contiguous in both memory and the file.
+ **/
+struct JHDF5Sequence
+{
+	guint64 memory_offset;
+	guint64 file_offset;
+	guint64 length;
+};
+
+typedef struct JHDF5Sequence JHDF5Sequence;
+
+static H5VL_class_t const j_hdf5_vol;
+
+static
+JHDF5Object*
+j_hdf5_object_new (JHDF5ObjectType type, JHDF5Object const* parent, gchar* key)
+{
+	JHDF5Object* object;
+
+	object = g_slice_new0(JHDF5Object);
+	object->type = type;
+	object->file = (parent != NULL) ? g_strdup(parent->file) : g_strdup(key);
+	object->key = key;
+	object->flags = (parent != NULL) ? parent->flags : 0;
+
+	return object;
+}
+
+static
+void
+j_hdf5_object_free (JHDF5Object* object)
+{
+	switch (object->type)
+	{
+		case J_HDF5_OBJECT_FILE:
+			g_free(object->file.name);
+			H5Pclose(object->file.fapl_id);
+			H5Pclose(object->file.fcpl_id);
+			break;
+		case J_HDF5_OBJECT_GROUP:
+			break;
+		case J_HDF5_OBJECT_DATASET:
+			j_distributed_object_unref(object->dataset.object);
+			H5Tclose(object->dataset.type_id);
+			H5Sclose(object->dataset.space_id);
+			H5Pclose(object->dataset.dcpl_id);
+			break;
+		case J_HDF5_OBJECT_ATTRIBUTE:
+			j_kv_unref(object->attribute.kv);
+			H5Tclose(object->attribute.type_id);
+			H5Sclose(object->attribute.space_id);
+
+			if (object->attribute.data != NULL)
+			{
+				g_bytes_unref(object->attribute.data);
+			}
+
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	g_free(object->file);
+	g_free(object->key);
+
+	g_slice_free(JHDF5Object, object);
+}
+
+/**
+ * Returns the key of an object located relative to another one.
+ * Absolute paths are relative to the file's root group.
+ **/
+static
+gchar*
+j_hdf5_object_child_key (JHDF5Object const* parent, gchar const* name)
+{
+	GString* key;
+	g_auto(GStrv) components = NULL;
+
+	key = g_string_new((name[0] == '/') ? parent->file : parent->key);
+	components = g_strsplit(name, "/", 0);
+
+	for (guint i = 0; components[i] != NULL; i++)
+	{
+		if (components[i][0] == '\0' || g_strcmp0(components[i], ".") == 0)
+		{
+			continue;
+		}
+
+		g_string_append_c(key, '/');
+		g_string_append(key, components[i]);
+	}
+
+	return g_string_free(key, FALSE);
+}
+
+/**
+ * Fetches an object's document.
+ *
+ * \return The document, NULL if the object does not exist. Should be freed with g_bytes_unref().
+ **/
+static
+GBytes*
+j_hdf5_get (gchar const* namespace, gchar const* key)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	GBytes* bytes = NULL;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new(namespace, key);
+
+	j_kv_get_bytes(kv, &bytes, batch);
+
+	if (!j_batch_execute(batch) && bytes != NULL)
+	{
+		g_bytes_unref(bytes);
+		bytes = NULL;
+	}
+
+	return bytes;
+}
+
+static
+gboolean
+j_hdf5_exists (gchar const* namespace, gchar const* key)
+{
+	g_autoptr(GBytes) bytes = NULL;
+
+	bytes = j_hdf5_get(namespace, key);
+
+	return (bytes != NULL);
+}
+
+/**
+ * Checks whether a document is of the expected type.
+ **/
+static
+gboolean
+j_hdf5_document_is (bson_t const* document, gchar const* type)
+{
+	bson_iter_t iter;
+
+	return (bson_iter_init_find(&iter, document, "type") && BSON_ITER_HOLDS_UTF8(&iter) && g_strcmp0(bson_iter_utf8(&iter, NULL), type) == 0);
+}
+
+static
+gboolean
+j_hdf5_put (gchar const* namespace, gchar const* key, bson_t* document)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new(namespace, key);
+
+	/* The KV takes over the document. */
+	j_kv_put(kv, document, batch);
+
+	return j_batch_execute(batch);
+}
+
+static
+gboolean
+j_hdf5_append_type (bson_t* document, hid_t type_id)
+{
+	g_autofree guint8* buffer = NULL;
+	size_t size = 0;
+
+	if (H5Tencode(type_id, NULL, &size) < 0)
+	{
+		return FALSE;
+	}
+
+	buffer = g_malloc(size);
+
+	if (H5Tencode(type_id, buffer, &size) < 0)
+	{
+		return FALSE;
+	}
+
+	return bson_append_binary(document, "datatype", -1, BSON_SUBTYPE_BINARY, buffer, size);
+}
+
+static
+gboolean
+j_hdf5_append_space (bson_t* document, hid_t space_id)
+{
+	g_autofree guint8* buffer = NULL;
+	size_t size = 0;
+
+	if (H5Sencode2(space_id, NULL, &size, H5P_DEFAULT) < 0)
+	{
+		return FALSE;
+	}
+
+	buffer = g_malloc(size);
+
+	if (H5Sencode2(space_id, buffer, &size, H5P_DEFAULT) < 0)
+	{
+		return FALSE;
+	}
+
+	return bson_append_binary(document, "dataspace", -1, BSON_SUBTYPE_BINARY, buffer, size);
+}
+
+/**
+ * Decodes the datatype and dataspace of a dataset or attribute.
+ **/
+static
+gboolean
+j_hdf5_document_get_type_and_space (bson_t const* document, hid_t* type_id, hid_t* space_id)
+{
+	bson_iter_t iter;
+	bson_subtype_t subtype;
+	guint8 const* data;
+	guint32 len;
+
+	*type_id = H5I_INVALID_HID;
+	*space_id = H5I_INVALID_HID;
+
+	if (bson_iter_init_find(&iter, document, "datatype") && BSON_ITER_HOLDS_BINARY(&iter))
+	{
+		bson_iter_binary(&iter, &subtype, &len, &data);
+		*type_id = H5Tdecode(data);
+	}
+
+	if (bson_iter_init_find(&iter, document, "dataspace") && BSON_ITER_HOLDS_BINARY(&iter))
+	{
+		bson_iter_binary(&iter, &subtype, &len, &data);
+		*space_id = H5Sdecode(data);
+	}
+
+	if (*type_id < 0 || *space_id < 0)
+	{
+		if (*type_id >= 0)
+		{
+			H5Tclose(*type_id);
+		}
+
+		if (*space_id >= 0)
+		{
+			H5Sclose(*space_id);
+		}
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Deletes all documents and objects of a file.
+ **/
+static
+gboolean
+j_hdf5_file_delete (gchar const* file)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autofree gchar* prefix = NULL;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new(J_HDF5_NAMESPACE, file);
+	prefix = g_strconcat(file, "/", NULL);
+
+	/* The escaped file name does not contain slashes, so it is the datasets' directory. */
+	j_distributed_object_purge(J_HDF5_NAMESPACE, file, batch);
+	j_kv_delete_by_prefix(J_HDF5_ATTRIBUTE_NAMESPACE, prefix, batch);
+	j_kv_delete_by_prefix(J_HDF5_NAMESPACE, prefix, batch);
+	j_kv_delete(kv, batch);
+
+	return j_batch_execute(batch);
+}
+
+/**
+ * Splits a dataspace's selection into contiguous byte ranges, in the order its elements are transferred.
+ **/
+static
+GArray*
+j_hdf5_space_sequences (hid_t space_id, size_t element_size)
+{
+	GArray* sequences;
+	hid_t iter_id;
+
+	if ((iter_id = H5Ssel_iter_create(space_id, element_size, 0)) < 0)
+	{
+		return NULL;
+	}
+
+	/* Only offsets and lengths are used, the file offsets are filled in later. */
+	sequences = g_array_new(FALSE, FALSE, sizeof(JHDF5Sequence));
+
+	while (TRUE)
+	{
+		hsize_t offsets[64];
+		size_t lengths[64];
+		size_t count = 0;
+		size_t bytes = 0;
+
+		if (H5Ssel_iter_get_seq_list(iter_id, G_N_ELEMENTS(offsets), SIZE_MAX, &count, &bytes, offsets, lengths) < 0)
+		{
+			g_array_unref(sequences);
+			sequences = NULL;
+			break;
+		}
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			JHDF5Sequence sequence;
+
+			sequence.memory_offset = offsets[i];
+			sequence.file_offset = 0;
+			sequence.length = lengths[i];
+
+			g_array_append_val(sequences, sequence);
+		}
+	}
+
+	H5Ssel_iter_close(iter_id);
+
+	return sequences;
+}
+
+/**
+ * Pairs the memory and file selections, splitting sequences where they do not line up.
+ **/
+static
+GArray*
+j_hdf5_selection_sequences (hid_t mem_space_id, hid_t file_space_id, size_t element_size)
+{
+	g_autoptr(GArray) memory = NULL;
+	g_autoptr(GArray) file = NULL;
+	GArray* sequences;
+	guint64 memory_position = 0;
+	guint64 file_position = 0;
+	guint m = 0;
+	guint f = 0;
+
+	if (H5Sget_select_npoints(mem_space_id) != H5Sget_select_npoints(file_space_id))
+	{
+		return NULL;
+	}
+
+	memory = j_hdf5_space_sequences(mem_space_id, element_size);
+	file = j_hdf5_space_sequences(file_space_id, element_size);
+
+	if (memory == NULL || file == NULL)
+	{
+		return NULL;
+	}
+
+	sequences = g_array_new(FALSE, FALSE, sizeof(JHDF5Sequence));
+
+	while (m < memory->len && f < file->len)
+	{
+		JHDF5Sequence const* memory_sequence = &g_array_index(memory, JHDF5Sequence, m);
+		JHDF5Sequence const* file_sequence = &g_array_index(file, JHDF5Sequence, f);
+		JHDF5Sequence sequence;
+
+		sequence.memory_offset = memory_sequence->memory_offset + memory_position;
+		sequence.file_offset = file_sequence->memory_offset + file_position;
+		sequence.length = MIN(memory_sequence->length - memory_position, file_sequence->length - file_position);
+
+		g_array_append_val(sequences, sequence);
+
+		memory_position += sequence.length;
+		file_position += sequence.length;
+
+		if (memory_position == memory_sequence->length)
+		{
+			memory_position = 0;
+			m++;
+		}
+
+		if (file_position == file_sequence->length)
+		{
+			file_position = 0;
+			f++;
+		}
+	}
+
+	return sequences;
+}
+
+/**
+ * Adds the reads or writes of a dataset transfer to a batch.
+ **/
+static
+gboolean
+j_hdf5_dataset_transfer (JHDF5Object* dataset, hid_t mem_type_id, hid_t mem_space_id, hid_t file_space_id, gpointer buf, gboolean write, guint64* bytes, JBatch* batch)
+{
+	g_autoptr(GArray) sequences = NULL;
+	g_autofree guint64* offsets = NULL;
+	size_t element_size;
+
+	if (dataset->type != J_HDF5_OBJECT_DATASET)
+	{
+		return FALSE;
+	}
+
+	if (write && !(dataset->flags & H5F_ACC_RDWR))
+	{
+		return FALSE;
+	}
+
+	/* Data is stored in the dataset's type, so converting it is left to the application. */
+	if (H5Tequal(mem_type_id, dataset->dataset.type_id) <= 0)
+	{
+		g_warning("Type conversion is not supported by the JULEA VOL connector.");
+		return FALSE;
+	}
+
+	element_size = H5Tget_size(dataset->dataset.type_id);
+
+	if (file_space_id == H5S_ALL)
+	{
+		file_space_id = dataset->dataset.space_id;
+	}
+
+	if (mem_space_id == H5S_ALL)
+	{
+		mem_space_id = file_space_id;
+	}
+
+	if ((sequences = j_hdf5_selection_sequences(mem_space_id, file_space_id, element_size)) == NULL)
+	{
+		return FALSE;
+	}
+
+	if (sequences->len == 0)
+	{
+		return TRUE;
+	}
+
+	offsets = g_new(guint64, sequences->len);
+
+	for (guint i = 0; i < sequences->len; i++)
+	{
+		offsets[i] = g_array_index(sequences, JHDF5Sequence, i).file_offset;
+	}
+
+	if (write)
+	{
+		g_autofree GOutputVector* vectors = NULL;
+
+		vectors = g_new(GOutputVector, sequences->len);
+
+		for (guint i = 0; i < sequences->len; i++)
+		{
+			JHDF5Sequence const* sequence = &g_array_index(sequences, JHDF5Sequence, i);
+
+			vectors[i].buffer = (gchar const*)buf + sequence->memory_offset;
+			vectors[i].size = sequence->length;
+		}
+
+		j_distributed_object_writev(dataset->dataset.object, vectors, offsets, sequences->len, bytes, batch);
+	}
+	else
+	{
+		g_autofree GInputVector* vectors = NULL;
+
+		vectors = g_new(GInputVector, sequences->len);
+
+		for (guint i = 0; i < sequences->len; i++)
+		{
+			JHDF5Sequence const* sequence = &g_array_index(sequences, JHDF5Sequence, i);
+
+			vectors[i].buffer = (gchar*)buf + sequence->memory_offset;
+			vectors[i].size = sequence->length;
+
+			/* Parts that have never been written are read as zeros, like HDF5's default fill value. */
+			memset(vectors[i].buffer, 0, vectors[i].size);
+		}
+
+		j_distributed_object_readv(dataset->dataset.object, vectors, offsets, sequences->len, bytes, batch);
+	}
+
+	return TRUE;
+}
+
+static
+void
+j_hdf5_request_completed (JBatch* batch, gboolean ret, gpointer data)
+{
+	JHDF5Request* request = data;
+	H5VL_request_notify_t notify;
+	gpointer context;
+
+	(void)batch;
+
+	g_mutex_lock(request->mutex);
+	request->ret = ret;
+	request->done = TRUE;
+	notify = request->notify;
+	context = request->notify_context;
+	g_mutex_unlock(request->mutex);
+
+	if (notify != NULL)
+	{
+		notify(context, ret ? H5VL_REQUEST_STATUS_SUCCEED : H5VL_REQUEST_STATUS_FAIL);
+	}
+}
+
+static
+void
+j_hdf5_request_free (JHDF5Request* request)
+{
+	if (request->batch != NULL)
+	{
+		j_batch_wait(request->batch);
+		j_batch_unref(request->batch);
+	}
+
+	g_mutex_clear(request->mutex);
+	g_free(request->bytes);
+
+	g_slice_free(JHDF5Request, request);
+}
+
+/**
+ * Transfers the data of several datasets using a single batch.
+ **/
+static
+herr_t
+j_hdf5_dataset_transfer_all (size_t count, void* dset[], hid_t mem_type_id[], hid_t mem_space_id[], hid_t file_space_id[], gpointer buf[], gboolean write, void** req)
+{
+	g_autoptr(JBatch) batch = NULL;
+	JHDF5Request* request;
+	gboolean ret;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	request = g_slice_new0(JHDF5Request);
+	request->bytes = g_new0(guint64, count);
+	g_mutex_init(request->mutex);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!j_hdf5_dataset_transfer(dset[i], mem_type_id[i], mem_space_id[i], file_space_id[i], buf[i], write, &(request->bytes[i]), batch))
+		{
+			j_hdf5_request_free(request);
+			return -1;
+		}
+	}
+
+	if (req != NULL)
+	{
+		/* The request owns the bytes counters, so they stay valid while the batch is executed. */
+		request->batch = j_batch_ref(batch);
+		j_batch_execute_async(batch, j_hdf5_request_completed, request);
+		*req = request;
+
+		return 0;
+	}
+
+	ret = j_batch_execute(batch);
+	j_hdf5_request_free(request);
+
+	return ret ? 0 : -1;
+}
+
+static
+void*
+j_hdf5_file_create (char const* name, unsigned flags, hid_t fcpl_id, hid_t fapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* file;
+	bson_t* document;
+	gchar* key;
+
+	(void)dxpl_id;
+	(void)req;
+
+	key = g_uri_escape_string(name, NULL, FALSE);
+
+	if (j_hdf5_exists(J_HDF5_NAMESPACE, key))
+	{
+		if (flags & H5F_ACC_EXCL)
+		{
+			g_free(key);
+			return NULL;
+		}
+
+		j_hdf5_file_delete(key);
+	}
+
+	document = g_slice_new(bson_t);
+	bson_init(document);
+	bson_append_utf8(document, "type", -1, "file", -1);
+	bson_append_utf8(document, "name", -1, name, -1);
+
+	if (!j_hdf5_put(J_HDF5_NAMESPACE, key, document))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	file = j_hdf5_object_new(J_HDF5_OBJECT_FILE, NULL, key);
+	file->flags = flags | H5F_ACC_RDWR;
+	file->file.name = g_strdup(name);
+	file->file.fapl_id = H5Pcopy(fapl_id);
+	file->file.fcpl_id = H5Pcopy(fcpl_id);
+
+	return file;
+}
+
+static
+void*
+j_hdf5_file_open (char const* name, unsigned flags, hid_t fapl_id, hid_t dxpl_id, void** req)
+{
+	g_autoptr(GBytes) bytes = NULL;
+	JHDF5Object* file;
+	bson_t document[1];
+	gconstpointer data;
+	gsize len;
+	gchar* key;
+
+	(void)dxpl_id;
+	(void)req;
+
+	key = g_uri_escape_string(name, NULL, FALSE);
+
+	if ((bytes = j_hdf5_get(J_HDF5_NAMESPACE, key)) == NULL)
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	data = g_bytes_get_data(bytes, &len);
+
+	if (!bson_init_static(document, data, len) || !j_hdf5_document_is(document, "file"))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	file = j_hdf5_object_new(J_HDF5_OBJECT_FILE, NULL, key);
+	file->flags = flags;
+	file->file.name = g_strdup(name);
+	file->file.fapl_id = H5Pcopy(fapl_id);
+	file->file.fcpl_id = H5Pcreate(H5P_FILE_CREATE);
+
+	return file;
+}
+
+static
+herr_t
+j_hdf5_file_get (void* obj, H5VL_file_get_args_t* args, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* object = obj;
+	herr_t ret = 0;
+
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_FILE_GET_FAPL:
+			args->args.get_fapl.fapl_id = H5Pcopy(object->file.fapl_id);
+			break;
+		case H5VL_FILE_GET_FCPL:
+			args->args.get_fcpl.fcpl_id = H5Pcopy(object->file.fcpl_id);
+			break;
+		case H5VL_FILE_GET_INTENT:
+			*(args->args.get_intent.flags) = object->flags;
+			break;
+		case H5VL_FILE_GET_NAME:
+			{
+				/* Every object knows its file's key, only the file itself knows the name. */
+				g_autofree gchar* name = NULL;
+				gsize len;
+
+				name = g_uri_unescape_string(object->file, NULL);
+				len = strlen(name);
+
+				if (args->args.get_name.buf != NULL && args->args.get_name.buf_size > 0)
+				{
+					g_strlcpy(args->args.get_name.buf, name, args->args.get_name.buf_size);
+				}
+
+				*(args->args.get_name.file_name_len) = len;
+			}
+			break;
+		case H5VL_FILE_GET_CONT_INFO:
+		case H5VL_FILE_GET_FILENO:
+		case H5VL_FILE_GET_OBJ_COUNT:
+		case H5VL_FILE_GET_OBJ_IDS:
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+herr_t
+j_hdf5_file_specific (void* obj, H5VL_file_specific_args_t* args, hid_t dxpl_id, void** req)
+{
+	herr_t ret = 0;
+
+	(void)obj;
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_FILE_FLUSH:
+			/* Batches are executed immediately, so there is nothing to flush. */
+			break;
+		case H5VL_FILE_IS_ACCESSIBLE:
+			{
+				g_autofree gchar* key = NULL;
+
+				key = g_uri_escape_string(args->args.is_accessible.filename, NULL, FALSE);
+				*(args->args.is_accessible.accessible) = j_hdf5_exists(J_HDF5_NAMESPACE, key);
+			}
+			break;
+		case H5VL_FILE_DELETE:
+			{
+				g_autofree gchar* key = NULL;
+
+				key = g_uri_escape_string(args->args.del.filename, NULL, FALSE);
+				ret = j_hdf5_file_delete(key) ? 0 : -1;
+			}
+			break;
+		case H5VL_FILE_REOPEN:
+		case H5VL_FILE_IS_EQUAL:
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+herr_t
+j_hdf5_object_close (void* obj, hid_t dxpl_id, void** req)
+{
+	(void)dxpl_id;
+	(void)req;
+
+	j_hdf5_object_free(obj);
+
+	return 0;
+}
+
+static
+void*
+j_hdf5_group_create (void* obj, H5VL_loc_params_t const* loc_params, char const* name, hid_t lcpl_id, hid_t gcpl_id, hid_t gapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* parent = obj;
+	bson_t* document;
+	gchar* key;
+
+	(void)loc_params;
+	(void)lcpl_id;
+	(void)gcpl_id;
+	(void)gapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	if (!(parent->flags & H5F_ACC_RDWR))
+	{
+		return NULL;
+	}
+
+	key = j_hdf5_object_child_key(parent, name);
+
+	if (j_hdf5_exists(J_HDF5_NAMESPACE, key))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	document = g_slice_new(bson_t);
+	bson_init(document);
+	bson_append_utf8(document, "type", -1, "group", -1);
+
+	if (!j_hdf5_put(J_HDF5_NAMESPACE, key, document))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	return j_hdf5_object_new(J_HDF5_OBJECT_GROUP, parent, key);
+}
+
+static
+void*
+j_hdf5_group_open (void* obj, H5VL_loc_params_t const* loc_params, char const* name, hid_t gapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* parent = obj;
+	g_autoptr(GBytes) bytes = NULL;
+	bson_t document[1];
+	gconstpointer data;
+	gsize len;
+	gchar* key;
+
+	(void)loc_params;
+	(void)gapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	key = j_hdf5_object_child_key(parent, name);
+
+	/* The root group is the file itself. */
+	if (g_strcmp0(key, parent->file) == 0)
+	{
+		return j_hdf5_object_new(J_HDF5_OBJECT_GROUP, parent, key);
+	}
+
+	if ((bytes = j_hdf5_get(J_HDF5_NAMESPACE, key)) == NULL)
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	data = g_bytes_get_data(bytes, &len);
+
+	if (!bson_init_static(document, data, len) || !j_hdf5_document_is(document, "group"))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	return j_hdf5_object_new(J_HDF5_OBJECT_GROUP, parent, key);
+}
+
+static
+herr_t
+j_hdf5_group_get (void* obj, H5VL_group_get_args_t* args, hid_t dxpl_id, void** req)
+{
+	herr_t ret = 0;
+
+	(void)obj;
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_GROUP_GET_GCPL:
+			args->args.get_gcpl.gcpl_id = H5Pcreate(H5P_GROUP_CREATE);
+			break;
+		case H5VL_GROUP_GET_INFO:
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+void*
+j_hdf5_dataset_create (void* obj, H5VL_loc_params_t const* loc_params, char const* name, hid_t lcpl_id, hid_t type_id, hid_t space_id, hid_t dcpl_id, hid_t dapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* parent = obj;
+	JHDF5Object* dataset;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	bson_t* document;
+	bson_t* b_distribution;
+	gchar* key;
+
+	(void)loc_params;
+	(void)lcpl_id;
+	(void)dapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	if (!(parent->flags & H5F_ACC_RDWR))
+	{
+		return NULL;
+	}
+
+	key = j_hdf5_object_child_key(parent, name);
+
+	if (j_hdf5_exists(J_HDF5_NAMESPACE, key))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+	b_distribution = j_distribution_serialize(distribution);
+
+	document = g_slice_new(bson_t);
+	bson_init(document);
+	bson_append_utf8(document, "type", -1, "dataset", -1);
+	bson_append_document(document, "distribution", -1, b_distribution);
+	bson_destroy(b_distribution);
+	g_slice_free(bson_t, b_distribution);
+
+	if (!j_hdf5_append_type(document, type_id) || !j_hdf5_append_space(document, space_id))
+	{
+		bson_destroy(document);
+		g_slice_free(bson_t, document);
+		g_free(key);
+		return NULL;
+	}
+
+	if (!j_hdf5_put(J_HDF5_NAMESPACE, key, document))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	dataset = j_hdf5_object_new(J_HDF5_OBJECT_DATASET, parent, key);
+	dataset->dataset.object = j_distributed_object_new(J_HDF5_NAMESPACE, key, distribution);
+	dataset->dataset.type_id = H5Tcopy(type_id);
+	dataset->dataset.space_id = H5Scopy(space_id);
+	dataset->dataset.dcpl_id = H5Pcopy(dcpl_id);
+
+	/* Selections are relative to the whole dataset. */
+	H5Sselect_all(dataset->dataset.space_id);
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_distributed_object_create(dataset->dataset.object, batch);
+
+	if (!j_batch_execute(batch))
+	{
+		j_hdf5_object_free(dataset);
+		return NULL;
+	}
+
+	return dataset;
+}
+
+static
+void*
+j_hdf5_dataset_open (void* obj, H5VL_loc_params_t const* loc_params, char const* name, hid_t dapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* parent = obj;
+	JHDF5Object* dataset;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	bson_t document[1];
+	bson_iter_t iter;
+	gconstpointer data;
+	gsize len;
+	hid_t type_id;
+	hid_t space_id;
+	gchar* key;
+
+	(void)loc_params;
+	(void)dapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	key = j_hdf5_object_child_key(parent, name);
+
+	if ((bytes = j_hdf5_get(J_HDF5_NAMESPACE, key)) == NULL)
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	data = g_bytes_get_data(bytes, &len);
+
+	if (!bson_init_static(document, data, len) || !j_hdf5_document_is(document, "dataset") || !j_hdf5_document_get_type_and_space(document, &type_id, &space_id))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	if (bson_iter_init_find(&iter, document, "distribution") && BSON_ITER_HOLDS_DOCUMENT(&iter))
+	{
+		bson_t b_distribution[1];
+		guint8 const* b_data;
+		guint32 b_len;
+
+		bson_iter_document(&iter, &b_len, &b_data);
+
+		if (bson_init_static(b_distribution, b_data, b_len))
+		{
+			distribution = j_distribution_new_from_bson(b_distribution);
+		}
+	}
+
+	if (distribution == NULL)
+	{
+		distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+	}
+
+	dataset = j_hdf5_object_new(J_HDF5_OBJECT_DATASET, parent, key);
+	dataset->dataset.object = j_distributed_object_new(J_HDF5_NAMESPACE, key, distribution);
+	dataset->dataset.type_id = type_id;
+	dataset->dataset.space_id = space_id;
+	dataset->dataset.dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
+
+	H5Sselect_all(dataset->dataset.space_id);
+
+	return dataset;
+}
+
+static
+herr_t
+j_hdf5_dataset_read (size_t count, void* dset[], hid_t mem_type_id[], hid_t mem_space_id[], hid_t file_space_id[], hid_t dxpl_id, void* buf[], void** req)
+{
+	(void)dxpl_id;
+
+	return j_hdf5_dataset_transfer_all(count, dset, mem_type_id, mem_space_id, file_space_id, buf, FALSE, req);
+}
+
+static
+herr_t
+j_hdf5_dataset_write (size_t count, void* dset[], hid_t mem_type_id[], hid_t mem_space_id[], hid_t file_space_id[], hid_t dxpl_id, void const* buf[], void** req)
+{
+	(void)dxpl_id;
+
+	/* Writes do not modify the buffers, only their type is shared with reads. */
+	return j_hdf5_dataset_transfer_all(count, dset, mem_type_id, mem_space_id, file_space_id, (gpointer*)buf, TRUE, req);
+}
+
+static
+herr_t
+j_hdf5_dataset_get (void* obj, H5VL_dataset_get_args_t* args, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* dataset = obj;
+	herr_t ret = 0;
+
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_DATASET_GET_SPACE:
+			args->args.get_space.space_id = H5Scopy(dataset->dataset.space_id);
+			break;
+		case H5VL_DATASET_GET_TYPE:
+			args->args.get_type.type_id = H5Tcopy(dataset->dataset.type_id);
+			break;
+		case H5VL_DATASET_GET_DCPL:
+			args->args.get_dcpl.dcpl_id = H5Pcopy(dataset->dataset.dcpl_id);
+			break;
+		case H5VL_DATASET_GET_DAPL:
+			args->args.get_dapl.dapl_id = H5Pcreate(H5P_DATASET_ACCESS);
+			break;
+		case H5VL_DATASET_GET_STORAGE_SIZE:
+			{
+				g_autoptr(JBatch) batch = NULL;
+				gint64 modification_time;
+				guint64 size = 0;
+
+				batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+				j_distributed_object_status(dataset->dataset.object, &modification_time, &size, batch);
+
+				ret = j_batch_execute(batch) ? 0 : -1;
+				*(args->args.get_storage_size.storage_size) = size;
+			}
+			break;
+		case H5VL_DATASET_GET_SPACE_STATUS:
+		case H5VL_DATASET_GET_APPEND_FLUSH:
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+herr_t
+j_hdf5_dataset_specific (void* obj, H5VL_dataset_specific_args_t* args, hid_t dxpl_id, void** req)
+{
+	herr_t ret = 0;
+
+	(void)obj;
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_DATASET_FLUSH:
+		case H5VL_DATASET_REFRESH:
+			break;
+		case H5VL_DATASET_SET_EXTENT:
+			J_HDF5_UNSUPPORTED("Changing a dataset's extent");
+			ret = -1;
+			break;
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+/**
+ * Returns the object an attribute belongs to, which might be given by name.
+ **/
+static
+gchar*
+j_hdf5_attribute_object_key (JHDF5Object const* object, H5VL_loc_params_t const* loc_params)
+{
+	if (loc_params->type == H5VL_OBJECT_BY_NAME)
+	{
+		return j_hdf5_object_child_key(object, loc_params->loc_data.loc_by_name.name);
+	}
+
+	return g_strdup(object->key);
+}
+
+static
+void*
+j_hdf5_attr_create (void* obj, H5VL_loc_params_t const* loc_params, char const* attr_name, hid_t type_id, hid_t space_id, hid_t acpl_id, hid_t aapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* parent = obj;
+	JHDF5Object* attribute;
+	g_autofree gchar* object_key = NULL;
+	bson_t* document;
+	gchar* key;
+
+	(void)acpl_id;
+	(void)aapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	if (!(parent->flags & H5F_ACC_RDWR))
+	{
+		return NULL;
+	}
+
+	object_key = j_hdf5_attribute_object_key(parent, loc_params);
+	key = g_strconcat(object_key, "/", attr_name, NULL);
+
+	if (j_hdf5_exists(J_HDF5_ATTRIBUTE_NAMESPACE, key))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	document = g_slice_new(bson_t);
+	bson_init(document);
+
+	if (!j_hdf5_append_type(document, type_id) || !j_hdf5_append_space(document, space_id))
+	{
+		bson_destroy(document);
+		g_slice_free(bson_t, document);
+		g_free(key);
+		return NULL;
+	}
+
+	if (!j_hdf5_put(J_HDF5_ATTRIBUTE_NAMESPACE, key, document))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	attribute = j_hdf5_object_new(J_HDF5_OBJECT_ATTRIBUTE, parent, key);
+	attribute->attribute.kv = j_kv_new(J_HDF5_ATTRIBUTE_NAMESPACE, key);
+	attribute->attribute.type_id = H5Tcopy(type_id);
+	attribute->attribute.space_id = H5Scopy(space_id);
+	attribute->attribute.data = NULL;
+
+	return attribute;
+}
+
+static
+void*
+j_hdf5_attr_open (void* obj, H5VL_loc_params_t const* loc_params, char const* attr_name, hid_t aapl_id, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* parent = obj;
+	JHDF5Object* attribute;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autofree gchar* object_key = NULL;
+	bson_t document[1];
+	bson_iter_t iter;
+	gconstpointer data;
+	gsize len;
+	hid_t type_id;
+	hid_t space_id;
+	gchar* key;
+
+	(void)aapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	object_key = j_hdf5_attribute_object_key(parent, loc_params);
+	key = g_strconcat(object_key, "/", attr_name, NULL);
+
+	if ((bytes = j_hdf5_get(J_HDF5_ATTRIBUTE_NAMESPACE, key)) == NULL)
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	data = g_bytes_get_data(bytes, &len);
+
+	if (!bson_init_static(document, data, len) || !j_hdf5_document_get_type_and_space(document, &type_id, &space_id))
+	{
+		g_free(key);
+		return NULL;
+	}
+
+	attribute = j_hdf5_object_new(J_HDF5_OBJECT_ATTRIBUTE, parent, key);
+	attribute->attribute.kv = j_kv_new(J_HDF5_ATTRIBUTE_NAMESPACE, key);
+	attribute->attribute.type_id = type_id;
+	attribute->attribute.space_id = space_id;
+	attribute->attribute.data = NULL;
+
+	if (bson_iter_init_find(&iter, document, "data") && BSON_ITER_HOLDS_BINARY(&iter))
+	{
+		bson_subtype_t subtype;
+		guint8 const* binary;
+		guint32 binary_len;
+
+		bson_iter_binary(&iter, &subtype, &binary_len, &binary);
+		attribute->attribute.data = g_bytes_new(binary, binary_len);
+	}
+
+	return attribute;
+}
+
+/**
+ * Returns the size of an attribute's data.
+ **/
+static
+gsize
+j_hdf5_attribute_size (JHDF5Object const* attribute)
+{
+	hssize_t points;
+
+	points = H5Sget_simple_extent_npoints(attribute->attribute.space_id);
+
+	return (points > 0) ? (gsize)points * H5Tget_size(attribute->attribute.type_id) : 0;
+}
+
+static
+herr_t
+j_hdf5_attr_read (void* attr, hid_t mem_type_id, void* buf, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* attribute = attr;
+	gsize size;
+
+	(void)dxpl_id;
+	(void)req;
+
+	if (H5Tequal(mem_type_id, attribute->attribute.type_id) <= 0)
+	{
+		g_warning("Type conversion is not supported by the JULEA VOL connector.");
+		return -1;
+	}
+
+	size = j_hdf5_attribute_size(attribute);
+
+	/* Attributes that have never been written are read as zeros. */
+	memset(buf, 0, size);
+
+	if (attribute->attribute.data != NULL)
+	{
+		gconstpointer data;
+		gsize len;
+
+		data = g_bytes_get_data(attribute->attribute.data, &len);
+		memcpy(buf, data, MIN(len, size));
+	}
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_attr_write (void* attr, hid_t mem_type_id, void const* buf, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* attribute = attr;
+	g_autoptr(JBatch) batch = NULL;
+	bson_t* document;
+	gsize size;
+
+	(void)dxpl_id;
+	(void)req;
+
+	if (!(attribute->flags & H5F_ACC_RDWR))
+	{
+		return -1;
+	}
+
+	if (H5Tequal(mem_type_id, attribute->attribute.type_id) <= 0)
+	{
+		g_warning("Type conversion is not supported by the JULEA VOL connector.");
+		return -1;
+	}
+
+	size = j_hdf5_attribute_size(attribute);
+
+	/* Attributes are always written as a whole, so the whole document is replaced. */
+	document = g_slice_new(bson_t);
+	bson_init(document);
+
+	if (!j_hdf5_append_type(document, attribute->attribute.type_id) || !j_hdf5_append_space(document, attribute->attribute.space_id))
+	{
+		bson_destroy(document);
+		g_slice_free(bson_t, document);
+		return -1;
+	}
+
+	bson_append_binary(document, "data", -1, BSON_SUBTYPE_BINARY, buf, size);
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_kv_put(attribute->attribute.kv, document, batch);
+
+	if (!j_batch_execute(batch))
+	{
+		return -1;
+	}
+
+	if (attribute->attribute.data != NULL)
+	{
+		g_bytes_unref(attribute->attribute.data);
+	}
+
+	attribute->attribute.data = g_bytes_new(buf, size);
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_attr_get (void* obj, H5VL_attr_get_args_t* args, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* attribute = obj;
+	herr_t ret = 0;
+
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_ATTR_GET_SPACE:
+			args->args.get_space.space_id = H5Scopy(attribute->attribute.space_id);
+			break;
+		case H5VL_ATTR_GET_TYPE:
+			args->args.get_type.type_id = H5Tcopy(attribute->attribute.type_id);
+			break;
+		case H5VL_ATTR_GET_ACPL:
+			args->args.get_acpl.acpl_id = H5Pcreate(H5P_ATTRIBUTE_CREATE);
+			break;
+		case H5VL_ATTR_GET_STORAGE_SIZE:
+			*(args->args.get_storage_size.data_size) = j_hdf5_attribute_size(attribute);
+			break;
+		case H5VL_ATTR_GET_INFO:
+		case H5VL_ATTR_GET_NAME:
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+herr_t
+j_hdf5_attr_specific (void* obj, H5VL_loc_params_t const* loc_params, H5VL_attr_specific_args_t* args, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* object = obj;
+	g_autofree gchar* object_key = NULL;
+	herr_t ret = 0;
+
+	(void)dxpl_id;
+	(void)req;
+
+	object_key = j_hdf5_attribute_object_key(object, loc_params);
+
+	switch (args->op_type)
+	{
+		case H5VL_ATTR_EXISTS:
+			{
+				g_autofree gchar* key = NULL;
+
+				key = g_strconcat(object_key, "/", args->args.exists.name, NULL);
+				*(args->args.exists.exists) = j_hdf5_exists(J_HDF5_ATTRIBUTE_NAMESPACE, key);
+			}
+			break;
+		case H5VL_ATTR_DELETE:
+			{
+				g_autoptr(JBatch) batch = NULL;
+				g_autoptr(JKV) kv = NULL;
+				g_autofree gchar* key = NULL;
+
+				if (!(object->flags & H5F_ACC_RDWR))
+				{
+					ret = -1;
+					break;
+				}
+
+				key = g_strconcat(object_key, "/", args->args.del.name, NULL);
+				batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+				kv = j_kv_new(J_HDF5_ATTRIBUTE_NAMESPACE, key);
+
+				j_kv_delete(kv, batch);
+				ret = j_batch_execute(batch) ? 0 : -1;
+			}
+			break;
+		case H5VL_ATTR_DELETE_BY_IDX:
+		case H5VL_ATTR_ITER:
+		case H5VL_ATTR_RENAME:
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+herr_t
+j_hdf5_link_specific (void* obj, H5VL_loc_params_t const* loc_params, H5VL_link_specific_args_t* args, hid_t dxpl_id, void** req)
+{
+	JHDF5Object* object = obj;
+	herr_t ret = 0;
+
+	(void)dxpl_id;
+	(void)req;
+
+	switch (args->op_type)
+	{
+		case H5VL_LINK_EXISTS:
+			{
+				g_autofree gchar* key = NULL;
+
+				if (loc_params->type != H5VL_OBJECT_BY_NAME)
+				{
+					ret = -1;
+					break;
+				}
+
+				key = j_hdf5_object_child_key(object, loc_params->loc_data.loc_by_name.name);
+				*(args->args.exists.exists) = j_hdf5_exists(J_HDF5_NAMESPACE, key);
+			}
+			break;
+		case H5VL_LINK_DELETE:
+			J_HDF5_UNSUPPORTED("Deleting links");
+			ret = -1;
+			break;
+		case H5VL_LINK_ITER:
+			J_HDF5_UNSUPPORTED("Iterating over links");
+			ret = -1;
+			break;
+		default:
+			ret = -1;
+			break;
+	}
+
+	return ret;
+}
+
+static
+herr_t
+j_hdf5_link_create (H5VL_link_create_args_t* args, void* obj, H5VL_loc_params_t const* loc_params, hid_t lcpl_id, hid_t lapl_id, hid_t dxpl_id, void** req)
+{
+	(void)args;
+	(void)obj;
+	(void)loc_params;
+	(void)lcpl_id;
+	(void)lapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	J_HDF5_UNSUPPORTED("Creating links");
+
+	return -1;
+}
+
+static
+herr_t
+j_hdf5_link_copy (void* src_obj, H5VL_loc_params_t const* loc_params1, void* dst_obj, H5VL_loc_params_t const* loc_params2, hid_t lcpl_id, hid_t lapl_id, hid_t dxpl_id, void** req)
+{
+	(void)src_obj;
+	(void)loc_params1;
+	(void)dst_obj;
+	(void)loc_params2;
+	(void)lcpl_id;
+	(void)lapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	J_HDF5_UNSUPPORTED("Copying links");
+
+	return -1;
+}
+
+static
+herr_t
+j_hdf5_link_move (void* src_obj, H5VL_loc_params_t const* loc_params1, void* dst_obj, H5VL_loc_params_t const* loc_params2, hid_t lcpl_id, hid_t lapl_id, hid_t dxpl_id, void** req)
+{
+	(void)src_obj;
+	(void)loc_params1;
+	(void)dst_obj;
+	(void)loc_params2;
+	(void)lcpl_id;
+	(void)lapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	J_HDF5_UNSUPPORTED("Moving links");
+
+	return -1;
+}
+
+static
+herr_t
+j_hdf5_link_get (void* obj, H5VL_loc_params_t const* loc_params, H5VL_link_get_args_t* args, hid_t dxpl_id, void** req)
+{
+	(void)obj;
+	(void)loc_params;
+	(void)args;
+	(void)dxpl_id;
+	(void)req;
+
+	J_HDF5_UNSUPPORTED("Querying links");
+
+	return -1;
+}
+
+static
+void*
+j_hdf5_datatype_commit (void* obj, H5VL_loc_params_t const* loc_params, char const* name, hid_t type_id, hid_t lcpl_id, hid_t tcpl_id, hid_t tapl_id, hid_t dxpl_id, void** req)
+{
+	(void)obj;
+	(void)loc_params;
+	(void)name;
+	(void)type_id;
+	(void)lcpl_id;
+	(void)tcpl_id;
+	(void)tapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	J_HDF5_UNSUPPORTED("Committing datatypes");
+
+	return NULL;
+}
+
+static
+void*
+j_hdf5_datatype_open (void* obj, H5VL_loc_params_t const* loc_params, char const* name, hid_t tapl_id, hid_t dxpl_id, void** req)
+{
+	(void)obj;
+	(void)loc_params;
+	(void)name;
+	(void)tapl_id;
+	(void)dxpl_id;
+	(void)req;
+
+	J_HDF5_UNSUPPORTED("Opening committed datatypes");
+
+	return NULL;
+}
+
+static
+herr_t
+j_hdf5_introspect_get_conn_cls (void* obj, H5VL_get_conn_lvl_t lvl, H5VL_class_t const** conn_cls)
+{
+	(void)obj;
+	(void)lvl;
+
+	*conn_cls = &j_hdf5_vol;
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_introspect_get_cap_flags (void const* info, uint64_t* cap_flags)
+{
+	(void)info;
+
+	*cap_flags = j_hdf5_vol.cap_flags;
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_introspect_opt_query (void* obj, H5VL_subclass_t cls, int opt_type, uint64_t* flags)
+{
+	(void)obj;
+	(void)cls;
+	(void)opt_type;
+
+	/* No optional operations are supported. */
+	*flags = 0;
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_request_wait (void* req, uint64_t timeout, H5VL_request_status_t* status)
+{
+	JHDF5Request* request = req;
+	gint64 deadline;
+
+	if (timeout == H5ES_WAIT_FOREVER)
+	{
+		j_batch_wait(request->batch);
+	}
+	else
+	{
+		/* The timeout is given in nanoseconds. */
+		deadline = g_get_monotonic_time() + (gint64)MIN(timeout / 1000, (uint64_t)G_MAXINT32);
+
+		while (!j_batch_test(request->batch) && g_get_monotonic_time() < deadline)
+		{
+			g_usleep(10);
+		}
+	}
+
+	if (!j_batch_test(request->batch))
+	{
+		*status = H5VL_REQUEST_STATUS_IN_PROGRESS;
+	}
+	else
+	{
+		g_mutex_lock(request->mutex);
+		*status = request->ret ? H5VL_REQUEST_STATUS_SUCCEED : H5VL_REQUEST_STATUS_FAIL;
+		g_mutex_unlock(request->mutex);
+	}
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_request_notify (void* req, H5VL_request_notify_t cb, void* ctx)
+{
+	JHDF5Request* request = req;
+	gboolean done;
+	gboolean ret;
+
+	g_mutex_lock(request->mutex);
+	done = request->done;
+	ret = request->ret;
+
+	if (!done)
+	{
+		request->notify = cb;
+		request->notify_context = ctx;
+	}
+
+	g_mutex_unlock(request->mutex);
+
+	/* The batch might have finished before the callback was registered. */
+	if (done)
+	{
+		cb(ctx, ret ? H5VL_REQUEST_STATUS_SUCCEED : H5VL_REQUEST_STATUS_FAIL);
+	}
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_request_cancel (void* req, H5VL_request_status_t* status)
+{
+	(void)req;
+
+	/* Batches can not be canceled once they are being executed. */
+	*status = H5VL_REQUEST_STATUS_CANT_CANCEL;
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_request_free_callback (void* req)
+{
+	j_hdf5_request_free(req);
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_initialize (hid_t vipl_id)
+{
+	(void)vipl_id;
+
+	j_init();
+
+	return 0;
+}
+
+static
+herr_t
+j_hdf5_terminate (void)
+{
+	j_fini();
+
+	return 0;
+}
+
+static H5VL_class_t const j_hdf5_vol = {
+	.version = H5VL_VERSION,
+	.value = J_HDF5_VOL_VALUE,
+	.name = "julea",
+	.conn_version = 1,
+	.cap_flags = H5VL_CAP_FLAG_ASYNC | H5VL_CAP_FLAG_FILE_BASIC | H5VL_CAP_FLAG_GROUP_BASIC | H5VL_CAP_FLAG_DATASET_BASIC | H5VL_CAP_FLAG_ATTR_BASIC,
+	.initialize = j_hdf5_initialize,
+	.terminate = j_hdf5_terminate,
+	.info_cls = {
+		.size = 0
+	},
+	.attr_cls = {
+		.create = j_hdf5_attr_create,
+		.open = j_hdf5_attr_open,
+		.read = j_hdf5_attr_read,
+		.write = j_hdf5_attr_write,
+		.get = j_hdf5_attr_get,
+		.specific = j_hdf5_attr_specific,
+		.close = j_hdf5_object_close
+	},
+	.dataset_cls = {
+		.create = j_hdf5_dataset_create,
+		.open = j_hdf5_dataset_open,
+		.read = j_hdf5_dataset_read,
+		.write = j_hdf5_dataset_write,
+		.get = j_hdf5_dataset_get,
+		.specific = j_hdf5_dataset_specific,
+		.close = j_hdf5_object_close
+	},
+	.file_cls = {
+		.create = j_hdf5_file_create,
+		.open = j_hdf5_file_open,
+		.get = j_hdf5_file_get,
+		.specific = j_hdf5_file_specific,
+		.close = j_hdf5_object_close
+	},
+	.group_cls = {
+		.create = j_hdf5_group_create,
+		.open = j_hdf5_group_open,
+		.get = j_hdf5_group_get,
+		.close = j_hdf5_object_close
+	},
+	.datatype_cls = {
+		.commit = j_hdf5_datatype_commit,
+		.open = j_hdf5_datatype_open
+	},
+	.link_cls = {
+		.create = j_hdf5_link_create,
+		.copy = j_hdf5_link_copy,
+		.move = j_hdf5_link_move,
+		.get = j_hdf5_link_get,
+		.specific = j_hdf5_link_specific
+	},
+	.introspect_cls = {
+		.get_conn_cls = j_hdf5_introspect_get_conn_cls,
+		.get_cap_flags = j_hdf5_introspect_get_cap_flags,
+		.opt_query = j_hdf5_introspect_opt_query
+	},
+	.request_cls = {
+		.wait = j_hdf5_request_wait,
+		.notify = j_hdf5_request_notify,
+		.cancel = j_hdf5_request_cancel,
+		.free = j_hdf5_request_free_callback
+	}
+};
+
+H5PL_type_t
+H5PLget_plugin_type (void)
+{
+	return H5PL_TYPE_VOL;
+}
+
+void const*
+H5PLget_plugin_info (void)
+{
+	return &j_hdf5_vol;
+}
@@ -43,6 +43,8 @@ G_GNUC_INTERNAL void j_collection_deserialize (JCollection*, bson_t const*);
 
 G_GNUC_INTERNAL bson_oid_t const* j_collection_get_id (JCollection*);
 
+G_GNUC_INTERNAL void j_collection_update_stats (JCollection*, gint64, gint64, JBatch*);
+
 G_GNUC_INTERNAL gboolean j_collection_get_exec (JList*, JSemantics*);
 
 #endif
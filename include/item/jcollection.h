@@ -33,6 +33,25 @@ struct JCollection;
 
 typedef struct JCollection JCollection;
 
+/**
+ * A collection's aggregate statistics.
+ **/
+struct JCollectionStats
+{
+	/**
+	 * The number of items.
+	 **/
+	guint64 item_count;
+
+	/**
+	 * The time of the last modification of any item.
+	 * Stored in microseconds since the Epoch.
+	 **/
+	gint64 modification_time;
+};
+
+typedef struct JCollectionStats JCollectionStats;
+
 #include <item/jitem.h>
 
 #include <julea.h>
@@ -47,5 +66,8 @@ gchar const* j_collection_get_name (JCollection*);
 JCollection* j_collection_create (gchar const*, JBatch*);
 void j_collection_get (JCollection**, gchar const*, JBatch*);
 void j_collection_delete (JCollection*, JBatch*);
+void j_collection_delete_recursive (JCollection*, JBatch*);
+
+void j_collection_get_stats (JCollection*, JCollectionStats*, JBatch*);
 
 #endif
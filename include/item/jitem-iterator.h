@@ -37,6 +37,7 @@ typedef struct JItemIterator JItemIterator;
 #include <item/jitem.h>
 
 JItemIterator* j_item_iterator_new (JCollection*);
+JItemIterator* j_item_iterator_new_filter (JCollection*, bson_t const*, gchar const* const*);
 void j_item_iterator_free (JItemIterator*);
 
 gboolean j_item_iterator_next (JItemIterator*);
@@ -47,11 +47,18 @@ JCredentials* j_item_get_credentials (JItem*);
 
 JItem* j_item_create (JCollection*, gchar const*, JDistribution*, JBatch*);
 void j_item_delete (JItem*, JBatch*);
+JItem* j_item_snapshot (JItem*, gchar const*, JBatch*);
+void j_item_rename (JItem*, gchar const*, JBatch*);
 void j_item_get (JCollection*, JItem**, gchar const*, JBatch*);
+void j_item_get_many (JCollection*, JItem**, gchar const* const*, guint32, JBatch*);
 
 void j_item_read (JItem*, gpointer, guint64, guint64, guint64*, JBatch*);
 void j_item_write (JItem*, gconstpointer, guint64, guint64, guint64*, JBatch*);
 
+void j_item_truncate (JItem*, guint64, JBatch*);
+void j_item_allocate (JItem*, guint64, guint64, JBatch*);
+void j_item_punch_hole (JItem*, guint64, guint64, JBatch*);
+
 void j_item_get_status (JItem*, JBatch*);
 
 guint64 j_item_get_size (JItem*);
@@ -59,4 +66,7 @@ gint64 j_item_get_modification_time (JItem*);
 
 guint64 j_item_get_optimal_access_size (JItem*);
 
+gchar const* j_item_get_attribute (JItem*, gchar const*);
+void j_item_set_attribute (JItem*, gchar const*, gchar const*, JBatch*);
+
 #endif
@@ -39,6 +39,9 @@ enum JBackendType
 
 typedef enum JBackendType JBackendType;
 
+/* The field holding the version of values stored with compare_and_swap */
+#define J_BACKEND_KV_VERSION "_version"
+
 struct JBackend
 {
 	JBackendType type;
@@ -61,6 +64,46 @@ struct JBackend
 
 			gboolean (*read) (gpointer, gpointer, guint64, guint64, guint64*);
 			gboolean (*write) (gpointer, gconstpointer, guint64, guint64, guint64*);
+
+			/* Optional */
+			gboolean (*read_to_fd) (gpointer, gint, guint64, guint64, guint64*);
+			gboolean (*write_from_fd) (gpointer, gint, guint64, guint64, guint64*);
+
+			/* Optional */
+			gboolean (*truncate) (gpointer, guint64);
+			gboolean (*allocate) (gpointer, guint64, guint64);
+			gboolean (*punch_hole) (gpointer, guint64, guint64);
+
+			/* Optional */
+			gboolean (*copy) (gpointer, gpointer, guint64*);
+
+			/* Optional, submit several extents at once */
+			gboolean (*readv) (gpointer, gpointer const*, guint64 const*, guint64 const*, guint, guint64*);
+			gboolean (*writev) (gpointer, gconstpointer const*, guint64 const*, guint64 const*, guint, gboolean, guint64*);
+
+			/* Optional, the access pattern of the given range (see JSemanticsAccess) */
+			gboolean (*hint) (gpointer, gint, guint64, guint64);
+
+			/* Optional, deletes all objects of a namespace whose paths lie below the given directory */
+			gboolean (*purge) (gchar const*, gchar const*);
+
+			/* Optional, moves an object to another namespace and path, the object is closed afterwards (like delete) unless moving it failed */
+			gboolean (*rename) (gpointer, gchar const*, gchar const*);
+
+			/* Optional, lists the paths of a namespace's objects (starting with the given prefix) in no particular order */
+			gboolean (*list) (gchar const*, gpointer*);
+			gboolean (*list_by_prefix) (gchar const*, gchar const*, gpointer*);
+			/* Returns the next path, which is only valid until the next call, the iterator is freed when it returns FALSE */
+			gboolean (*iterate) (gpointer, gchar const**);
+
+			/* Optional, returns the number of bytes written to compressed objects before and after compressing them */
+			gboolean (*compression) (guint64*, guint64*);
+
+			/* Optional, returns up to the given number of extents of the range that contain data, in ascending order */
+			gboolean (*extents) (gpointer, guint64, guint64, guint64*, guint64*, guint, guint*);
+
+			/* Optional, starts reading the given range into memory or a faster tier without waiting for it */
+			gboolean (*prefetch) (gpointer, guint64, guint64);
 		}
 		object;
 
@@ -71,6 +114,10 @@ struct JBackend
 
 			gboolean (*batch_start) (gchar const*, JSemanticsSafety, gpointer*);
 			gboolean (*batch_execute) (gpointer);
+			/* Optional, allows executing the batch's operations in any order, has to be called before adding operations */
+			gboolean (*batch_set_unordered) (gpointer);
+			/* Optional, promises that only puts of ascending keys follow, allows loading them efficiently, has to be called before adding operations */
+			gboolean (*batch_set_sorted) (gpointer);
 
 			gboolean (*put) (gpointer, gchar const*, bson_t const*);
 			gboolean (*delete) (gpointer, gchar const*);
@@ -79,7 +126,22 @@ struct JBackend
 
 			gboolean (*get_all) (gchar const*, gpointer*);
 			gboolean (*get_by_prefix) (gchar const*, gchar const*, gpointer*);
-			gboolean (*iterate) (gpointer, bson_t*);
+			/* Keys with the given prefix that sort after the given key (NULL for all keys) in ascending order, limited to the given number (0 for no limit) */
+			gboolean (*get_range) (gchar const*, gchar const*, gchar const*, guint32, gpointer*);
+			/* Returns the key and the value, both are only valid until the next call */
+			gboolean (*iterate) (gpointer, gchar const**, bson_t*);
+
+			/* Optional, atomic conditional updates of a single key, emulated if not provided */
+			/* Stores the value if the key's version matches (0 if it does not exist) and returns the current version */
+			gboolean (*compare_and_swap) (gchar const*, gchar const*, guint64, bson_t const*, guint64*);
+			/* Adds to an integer field (created if necessary) and returns its new value */
+			gboolean (*increment) (gchar const*, gchar const*, gchar const*, gint64, gint64*);
+			/* Sets numeric fields to the maximum of their current and the given value (see j_helper_bson_merge_max()) */
+			gboolean (*max_merge) (gchar const*, gchar const*, bson_t const*);
+
+			/* Optional, stores and returns values as opaque bytes instead of BSON documents */
+			gboolean (*put_raw) (gpointer, gchar const*, gconstpointer, guint32);
+			gboolean (*get_raw) (gchar const*, gchar const*, GBytes**);
 		}
 		kv;
 	};
@@ -109,11 +171,35 @@ gboolean j_backend_object_sync (JBackend*, gpointer);
 gboolean j_backend_object_read (JBackend*, gpointer, gpointer, guint64, guint64, guint64*);
 gboolean j_backend_object_write (JBackend*, gpointer, gconstpointer, guint64, guint64, guint64*);
 
+gboolean j_backend_object_read_to_fd (JBackend*, gpointer, gint, guint64, guint64, guint64*);
+gboolean j_backend_object_write_from_fd (JBackend*, gpointer, gint, guint64, guint64, guint64*);
+
+gboolean j_backend_object_truncate (JBackend*, gpointer, guint64);
+gboolean j_backend_object_allocate (JBackend*, gpointer, guint64, guint64);
+gboolean j_backend_object_punch_hole (JBackend*, gpointer, guint64, guint64);
+
+gboolean j_backend_object_copy (JBackend*, gpointer, gpointer, guint64*);
+
+gboolean j_backend_object_readv (JBackend*, gpointer, gpointer const*, guint64 const*, guint64 const*, guint, guint64*);
+gboolean j_backend_object_writev (JBackend*, gpointer, gconstpointer const*, guint64 const*, guint64 const*, guint, gboolean, guint64*);
+gboolean j_backend_object_hint (JBackend*, gpointer, gint, guint64, guint64);
+gboolean j_backend_object_purge (JBackend*, gchar const*, gchar const*);
+gboolean j_backend_object_rename (JBackend*, gpointer, gchar const*, gchar const*);
+
+gboolean j_backend_object_list (JBackend*, gchar const*, gpointer*);
+gboolean j_backend_object_list_by_prefix (JBackend*, gchar const*, gchar const*, gpointer*);
+gboolean j_backend_object_iterate (JBackend*, gpointer, gchar const**);
+gboolean j_backend_object_compression (JBackend*, guint64*, guint64*);
+gboolean j_backend_object_extents (JBackend*, gpointer, guint64, guint64, guint64*, guint64*, guint, guint*);
+gboolean j_backend_object_prefetch (JBackend*, gpointer, guint64, guint64);
+
 gboolean j_backend_kv_init (JBackend*, gchar const*);
 void j_backend_kv_fini (JBackend*);
 
 gboolean j_backend_kv_batch_start (JBackend*, gchar const*, JSemanticsSafety, gpointer*);
 gboolean j_backend_kv_batch_execute (JBackend*, gpointer);
+gboolean j_backend_kv_batch_set_unordered (JBackend*, gpointer);
+gboolean j_backend_kv_batch_set_sorted (JBackend*, gpointer);
 
 gboolean j_backend_kv_put (JBackend*, gpointer, gchar const*, bson_t const*);
 gboolean j_backend_kv_delete (JBackend*, gpointer, gchar const*);
@@ -122,6 +208,14 @@ gboolean j_backend_kv_get (JBackend*, gchar const*, gchar const*, bson_t*);
 
 gboolean j_backend_kv_get_all (JBackend*, gchar const*, gpointer*);
 gboolean j_backend_kv_get_by_prefix (JBackend*, gchar const*, gchar const*, gpointer*);
-gboolean j_backend_kv_iterate (JBackend*, gpointer, bson_t*);
+gboolean j_backend_kv_get_range (JBackend*, gchar const*, gchar const*, gchar const*, guint32, gpointer*);
+gboolean j_backend_kv_iterate (JBackend*, gpointer, gchar const**, bson_t*);
+
+gboolean j_backend_kv_compare_and_swap (JBackend*, gchar const*, gchar const*, guint64, bson_t const*, guint64*);
+gboolean j_backend_kv_increment (JBackend*, gchar const*, gchar const*, gchar const*, gint64, gint64*);
+gboolean j_backend_kv_max_merge (JBackend*, gchar const*, gchar const*, bson_t const*);
+
+gboolean j_backend_kv_put_raw (JBackend*, gpointer, gchar const*, gconstpointer, guint32);
+gboolean j_backend_kv_get_raw (JBackend*, gchar const*, gchar const*, GBytes**);
 
 #endif
@@ -29,9 +29,13 @@
 
 #include <glib.h>
 
-G_GNUC_INTERNAL void j_background_operation_init (guint count);
+#include <jbackground-operation.h>
+
+G_GNUC_INTERNAL void j_background_operation_init (guint, gboolean);
 G_GNUC_INTERNAL void j_background_operation_fini (void);
 
 G_GNUC_INTERNAL guint j_background_operation_get_num_threads (void);
 
+G_GNUC_INTERNAL void j_background_operation_execute_parallel (JBackgroundOperationFunc, gpointer*, guint);
+
 #endif
@@ -30,11 +30,22 @@
 #include <glib.h>
 
 #include <jbatch.h>
+#include <jstatistics.h>
 
 G_GNUC_INTERNAL JBatch* j_batch_new_from_batch (JBatch*);
 
 G_GNUC_INTERNAL JList* j_batch_get_operations (JBatch*);
+G_GNUC_INTERNAL void j_batch_move_operations (JBatch*, JBatch*);
 
 G_GNUC_INTERNAL gboolean j_batch_execute_internal (JBatch*);
 
+G_GNUC_INTERNAL GCancellable* j_batch_get_cancellable (void);
+
+G_GNUC_INTERNAL guint64 j_batch_get_trace_id (void);
+G_GNUC_INTERNAL void j_batch_set_trace_id (guint64);
+
+G_GNUC_INTERNAL JStatistics* j_batch_get_current_statistics (void);
+G_GNUC_INTERNAL void j_batch_set_current_statistics (JStatistics*);
+G_GNUC_INTERNAL void j_batch_statistics_add (JStatisticsType, guint64);
+
 #endif
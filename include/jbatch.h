@@ -28,6 +28,7 @@
 #endif
 
 #include <glib.h>
+#include <gio/gio.h>
 
 struct JBatch;
 
@@ -37,6 +38,7 @@ typedef void (*JOperationCompletedFunc) (JBatch*, gboolean, gpointer);
 
 #include <joperation.h>
 #include <jsemantics.h>
+#include <jstatistics.h>
 
 JBatch* j_batch_new (JSemantics*);
 JBatch* j_batch_new_for_template (JSemanticsTemplate);
@@ -47,11 +49,24 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(JBatch, j_batch_unref)
 
 JSemantics* j_batch_get_semantics (JBatch*);
 
+void j_batch_set_timeout (JBatch*, guint64);
+void j_batch_set_cancellable (JBatch*, GCancellable*);
+
+void j_batch_set_statistics (JBatch*, JStatistics*);
+JStatistics* j_batch_get_statistics (JBatch*);
+
 void j_batch_add (JBatch*, JOperation*);
+gpointer j_batch_alloc (JBatch*, gsize);
 
 gboolean j_batch_execute (JBatch*);
 
+JOperationResult j_batch_get_result (JBatch*, guint);
+
 void j_batch_execute_async (JBatch*, JOperationCompletedFunc, gpointer);
+gboolean j_batch_test (JBatch*);
 void j_batch_wait (JBatch*);
+guint j_batch_wait_any (JBatch**, guint);
+
+void j_batch_wait_cached (void);
 
 #endif
@@ -38,6 +38,7 @@ typedef struct JCommon JCommon;
 #include <jconfiguration.h>
 
 void j_init (void);
+void j_init_for_configuration (JConfiguration*);
 void j_fini (void);
 
 JConfiguration* j_configuration (void);
@@ -45,4 +46,7 @@ JConfiguration* j_configuration (void);
 JBackend* j_object_backend (void);
 JBackend* j_kv_backend (void);
 
+JBackend* j_object_backend_for_namespace (gchar const*);
+JBackend* j_kv_backend_for_namespace (gchar const*);
+
 #endif
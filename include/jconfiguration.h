@@ -33,6 +33,8 @@ struct JConfiguration;
 
 typedef struct JConfiguration JConfiguration;
 
+GKeyFile* j_configuration_load_key_file (void);
+
 JConfiguration* j_configuration_new (void);
 JConfiguration* j_configuration_new_for_data (GKeyFile*);
 
@@ -47,6 +49,11 @@ gchar const* j_configuration_get_kv_server (JConfiguration*, guint32);
 guint32 j_configuration_get_object_server_count (JConfiguration*);
 guint32 j_configuration_get_kv_server_count (JConfiguration*);
 
+gboolean j_configuration_get_object_server_local (JConfiguration*, guint32*);
+
+gchar const* j_configuration_get_kv_replica (JConfiguration*, guint32, guint32);
+guint32 j_configuration_get_kv_replica_count (JConfiguration*, guint32);
+
 gchar const* j_configuration_get_object_backend (JConfiguration*);
 gchar const* j_configuration_get_object_component (JConfiguration*);
 gchar const* j_configuration_get_object_path (JConfiguration*);
@@ -55,6 +62,52 @@ gchar const* j_configuration_get_kv_backend (JConfiguration*);
 gchar const* j_configuration_get_kv_component (JConfiguration*);
 gchar const* j_configuration_get_kv_path (JConfiguration*);
 
+gboolean j_configuration_is_object_namespace_local (JConfiguration*, gchar const*);
+gchar const* j_configuration_get_object_local_backend (JConfiguration*);
+gchar const* j_configuration_get_object_local_path (JConfiguration*);
+
+gboolean j_configuration_is_kv_namespace_local (JConfiguration*, gchar const*);
+gchar const* j_configuration_get_kv_local_backend (JConfiguration*);
+gchar const* j_configuration_get_kv_local_path (JConfiguration*);
+
+gchar const* j_configuration_get_server_mode (JConfiguration*);
+guint32 j_configuration_get_server_threads (JConfiguration*);
+guint64 j_configuration_get_server_group_commit_time (JConfiguration*);
+guint32 j_configuration_get_server_group_commit_size (JConfiguration*);
+gboolean j_configuration_get_server_pipeline (JConfiguration*);
+guint64 j_configuration_get_server_write_buffer_size (JConfiguration*);
+guint64 j_configuration_get_server_write_buffer_time (JConfiguration*);
+guint32 j_configuration_get_server_scheduler_slots (JConfiguration*);
+guint32 j_configuration_get_server_scheduler_weight_metadata (JConfiguration*);
+guint32 j_configuration_get_server_scheduler_weight_small (JConfiguration*);
+guint32 j_configuration_get_server_scheduler_weight_bulk (JConfiguration*);
+guint64 j_configuration_get_server_memory_budget (JConfiguration*);
+guint64 j_configuration_get_server_inline_size (JConfiguration*);
+guint64 j_configuration_get_server_scrub_rate (JConfiguration*);
+guint64 j_configuration_get_server_scrub_interval (JConfiguration*);
+guint64 j_configuration_get_server_trash_rate (JConfiguration*);
+guint64 j_configuration_get_server_kv_cache_size (JConfiguration*);
+gboolean j_configuration_get_server_kv_filter (JConfiguration*);
+gchar const* j_configuration_get_server_numa_node (JConfiguration*);
+gboolean j_configuration_get_server_huge_pages (JConfiguration*);
+gchar const* j_configuration_get_server_journal (JConfiguration*);
+guint32 j_configuration_get_server_dedup (JConfiguration*);
+
 guint32 j_configuration_get_max_connections (JConfiguration*);
+guint32 j_configuration_get_multiplex_connections (JConfiguration*);
+guint32 j_configuration_get_prewarm_connections (JConfiguration*);
+guint64 j_configuration_get_cache_size (JConfiguration*);
+guint64 j_configuration_get_block_size (JConfiguration*);
+guint64 j_configuration_get_message_size (JConfiguration*);
+guint32 j_configuration_get_hedge_percentile (JConfiguration*);
+guint32 j_configuration_get_background_threads (JConfiguration*);
+gboolean j_configuration_get_pin_threads (JConfiguration*);
+gboolean j_configuration_get_huge_pages (JConfiguration*);
+gchar const* j_configuration_get_node_cache (JConfiguration*);
+gboolean j_configuration_get_dedup (JConfiguration*);
+guint64 j_configuration_get_combine_window (JConfiguration*);
+guint32 j_configuration_get_trace_sample (JConfiguration*);
+gboolean j_configuration_get_checksums (JConfiguration*);
+gboolean j_configuration_get_rdma (JConfiguration*);
 
 #endif
@@ -30,9 +30,9 @@
 #include <glib.h>
 #include <gio/gio.h>
 
-#include <jconfiguration.h>
+#include <jconnection-pool.h>
 
-G_GNUC_INTERNAL void j_connection_pool_init (JConfiguration*);
-G_GNUC_INTERNAL void j_connection_pool_fini (void);
+G_GNUC_INTERNAL void j_connection_pool_compound_begin (void);
+G_GNUC_INTERNAL void j_connection_pool_compound_end (void);
 
 #endif
@@ -30,10 +30,68 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <jconfiguration.h>
+#include <jmessage.h>
+#include <jtransport.h>
+
+enum JConnectionPoolStatisticsType
+{
+	J_CONNECTION_POOL_STATISTICS_CONNECTIONS,
+	J_CONNECTION_POOL_STATISTICS_IN_USE,
+	J_CONNECTION_POOL_STATISTICS_POPS,
+	J_CONNECTION_POOL_STATISTICS_WAITS,
+	J_CONNECTION_POOL_STATISTICS_WAIT_TIME,
+	J_CONNECTION_POOL_STATISTICS_CONNECTS,
+	J_CONNECTION_POOL_STATISTICS_CONNECT_FAILURES,
+	J_CONNECTION_POOL_STATISTICS_RECONNECTS
+};
+
+typedef enum JConnectionPoolStatisticsType JConnectionPoolStatisticsType;
+
+/**
+ * The number of buckets of the wait time histograms.
+ * Bucket i contains all wait times below 2^i microseconds that do not fit into bucket i-1.
+ **/
+#define J_CONNECTION_POOL_WAIT_BUCKETS 32
+
+/* Also used by servers that forward data to other servers. */
+void j_connection_pool_init (JConfiguration*);
+void j_connection_pool_fini (void);
+
 GSocketConnection* j_connection_pool_pop_object (guint);
+GSocketConnection* j_connection_pool_pop_object_ordered (guint, guint32);
+GSocketConnection* j_connection_pool_try_pop_object (guint);
 void j_connection_pool_push_object (guint, GSocketConnection*);
+void j_connection_pool_discard_object (guint, GSocketConnection*);
 
 GSocketConnection* j_connection_pool_pop_kv (guint);
 void j_connection_pool_push_kv (guint, GSocketConnection*);
+void j_connection_pool_discard_kv (guint, GSocketConnection*);
+GSocketConnection* j_connection_pool_connect_object (guint);
+GSocketConnection* j_connection_pool_connect_kv (guint);
+
+GSocketConnection* j_connection_pool_pop_kv_replica (guint, guint);
+void j_connection_pool_push_kv_replica (guint, guint, GSocketConnection*);
+void j_connection_pool_discard_kv_replica (guint, guint, GSocketConnection*);
+
+JMessage* j_connection_pool_request_object (guint, JMessage*, gboolean);
+JMessage* j_connection_pool_request_object_ordered (guint, guint32, JMessage*, gboolean);
+JMessage* j_connection_pool_request_kv (guint, JMessage*, gboolean);
+JMessage* j_connection_pool_request_kv_replica (guint, guint, JMessage*, gboolean);
+
+gboolean j_connection_pool_get_compact_object (guint);
+gboolean j_connection_pool_get_rdma_object (guint);
+JTransportShm* j_connection_pool_get_shm_object (guint);
+gboolean j_connection_pool_get_compact_kv (guint);
+gboolean j_connection_pool_get_dedup_object (guint);
+gboolean j_connection_pool_get_compact_kv_replica (guint, guint);
+
+guint j_connection_pool_get_kv_replica_count (guint);
+gint j_connection_pool_pick_kv_replica (guint);
+
+guint64 j_connection_pool_get_statistics_object (guint, JConnectionPoolStatisticsType);
+guint64 j_connection_pool_get_statistics_kv (guint, JConnectionPoolStatisticsType);
+void j_connection_pool_get_wait_histogram_object (guint, guint64*);
+void j_connection_pool_get_wait_histogram_kv (guint, guint64*);
 
 #endif
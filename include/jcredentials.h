@@ -43,6 +43,7 @@ guint32 j_credentials_get_user (JCredentials*);
 guint32 j_credentials_get_group (JCredentials*);
 
 bson_t* j_credentials_serialize (JCredentials*);
+bson_t const* j_credentials_serialize_cached (JCredentials*);
 void j_credentials_deserialize (JCredentials*, bson_t const*);
 
 #endif
@@ -0,0 +1,39 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_DEVICE_H
+#define JULEA_DEVICE_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+typedef void (*JDeviceFunc) (gpointer, gpointer, guint64, guint64, guint64*);
+
+gboolean j_device_is_available (void);
+
+gboolean j_device_read (gpointer, guint64, guint64, guint64*, JDeviceFunc, gpointer);
+gboolean j_device_write (gconstpointer, guint64, guint64, guint64*, JDeviceFunc, gpointer);
+
+#endif
@@ -33,7 +33,11 @@ enum JDistributionType
 {
 	J_DISTRIBUTION_ROUND_ROBIN,
 	J_DISTRIBUTION_SINGLE_SERVER,
-	J_DISTRIBUTION_WEIGHTED
+	J_DISTRIBUTION_WEIGHTED,
+	J_DISTRIBUTION_RENDEZVOUS,
+	J_DISTRIBUTION_REPLICATED,
+	J_DISTRIBUTION_ERASURE,
+	J_DISTRIBUTION_LOCAL
 };
 
 typedef enum JDistributionType JDistributionType;
@@ -42,6 +46,34 @@ struct JDistribution;
 
 typedef struct JDistribution JDistribution;
 
+/**
+ * A contiguous part of a distributed range that is stored on one server.
+ **/
+struct JDistributionExtent
+{
+	/**
+	 * The server index.
+	 **/
+	guint index;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset on the server.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block ID.
+	 **/
+	guint64 block_id;
+};
+
+typedef struct JDistributionExtent JDistributionExtent;
+
 #include <bson.h>
 
 #include <jconfiguration.h>
@@ -56,12 +88,28 @@ void j_distribution_unref (JDistribution*);
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(JDistribution, j_distribution_unref)
 
 bson_t* j_distribution_serialize (JDistribution*);
+bson_t const* j_distribution_serialize_cached (JDistribution*);
 
 void j_distribution_set_block_size (JDistribution*, guint64);
+guint64 j_distribution_get_block_size (JDistribution*);
+guint64 j_distribution_get_optimal_access_size (JDistribution*);
+
+void j_distribution_set_expected_size (JDistribution*, guint64);
+void j_distribution_set_adaptive (JDistribution*);
+gboolean j_distribution_adapt (JDistribution*, guint64);
+
 void j_distribution_set (JDistribution*, gchar const*, guint64);
 void j_distribution_set2 (JDistribution*, gchar const*, guint64, guint64);
+void j_distribution_set_weights_from_servers (JDistribution*);
 
 void j_distribution_reset (JDistribution*, guint64, guint64);
 gboolean j_distribution_distribute (JDistribution*, guint*, guint64*, guint64*, guint64*);
+guint j_distribution_distribute_extents (JDistribution*, JDistributionExtent*, guint);
+
+guint j_distribution_get_replica_count (JDistribution*);
+void j_distribution_get_replica (JDistribution*, JDistributionExtent const*, guint, guint*, guint64*);
+
+gboolean j_distribution_get_stripe (JDistribution*, guint*, guint*, guint64*);
+void j_distribution_get_chunk (JDistribution*, guint64, guint, guint*, guint64*);
 
 #endif
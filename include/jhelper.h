@@ -30,14 +30,42 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <bson.h>
+
 #include <jbackground-operation.h>
 
+/**
+ * The size of huge pages.
+ **/
+#define J_HELPER_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * The size of SHA-256 digests.
+ **/
+#define J_HELPER_SHA256_SIZE 32
+
 void j_helper_set_nodelay (GSocketConnection*, gboolean);
+void j_helper_set_cork (GSocketConnection*, gboolean);
+
+gchar* j_helper_get_local_socket_path (guint);
+gboolean j_helper_is_local_host (gchar const*);
 
 gboolean j_helper_execute_parallel (JBackgroundOperationFunc, gpointer*, guint);
 
 guint64 j_helper_atomic_add (guint64 volatile*, guint64);
 
+void j_helper_set_huge_pages (gboolean);
+gpointer j_helper_alloc_huge (gsize);
+void j_helper_free_huge (gpointer, gsize);
+
 guint32 j_helper_hash (gchar const*);
+gchar* j_helper_get_fanout_path (gchar const*, guint);
+
+guint32 j_helper_crc32c (guint32, gconstpointer, gsize);
+void j_helper_sha256 (gconstpointer, gsize, guint8*);
+
+gboolean j_helper_bson_match (bson_t const*, bson_t const*);
+void j_helper_bson_project (bson_t const*, gchar const* const*, bson_t*);
+void j_helper_bson_merge_max (bson_t const*, bson_t const*, bson_t*);
 
 #endif
@@ -29,25 +29,8 @@
 
 #include <glib.h>
 
-/**
- * A JList element.
- **/
-struct JListElement
-{
-	/**
-	 * Pointer to the next element.
-	 **/
-	struct JListElement* next;
-	/**
-	 * Pointer to data.
-	 **/
-	gpointer data;
-};
-
-typedef struct JListElement JListElement;
-
 #include <jlist.h>
 
-G_GNUC_INTERNAL JListElement* j_list_head (JList*);
+G_GNUC_INTERNAL gpointer j_list_get_nth (JList*, guint);
 
 #endif
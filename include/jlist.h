@@ -51,4 +51,6 @@ gpointer j_list_get_last (JList*);
 
 void j_list_delete_all (JList*);
 
+void j_list_move_all (JList*, JList*);
+
 #endif
@@ -0,0 +1,52 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_LOCK_MANAGER_H
+#define JULEA_LOCK_MANAGER_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+enum JLockMode
+{
+	J_LOCK_MODE_SHARED,
+	J_LOCK_MODE_EXCLUSIVE
+};
+
+typedef enum JLockMode JLockMode;
+
+struct JLockManager;
+
+typedef struct JLockManager JLockManager;
+
+JLockManager* j_lock_manager_new (void);
+void j_lock_manager_free (JLockManager*);
+
+guint64 j_lock_manager_acquire (JLockManager*, gchar const*, JLockMode, guint64 const*, guint64 const*, guint, gint64);
+gboolean j_lock_manager_release (JLockManager*, gchar const*, guint64);
+
+guint j_lock_manager_get_contended (JLockManager*, guint64*, guint, gint64);
+
+#endif
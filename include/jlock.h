@@ -29,16 +29,21 @@
 
 #include <glib.h>
 
+#include <jlock-manager.h>
+
 struct JLock;
 
 typedef struct JLock JLock;
 
 JLock* j_lock_new (gchar const*, gchar const*);
+JLock* j_lock_new_for_mode (gchar const*, gchar const*, JLockMode);
 void j_lock_free (JLock*);
 
 gboolean j_lock_acquire (JLock*);
+gboolean j_lock_try_acquire (JLock*);
 gboolean j_lock_release (JLock*);
 
 void j_lock_add (JLock*, guint64);
+void j_lock_add_range (JLock*, guint64, guint64);
 
 #endif
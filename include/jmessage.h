@@ -45,16 +45,55 @@ enum JMessageType
 	J_MESSAGE_KV_GET,
 	J_MESSAGE_KV_GET_ALL,
 	J_MESSAGE_KV_GET_BY_PREFIX,
+	J_MESSAGE_OBJECT_CAPACITY,
+	J_MESSAGE_OBJECT_TRUNCATE,
+	J_MESSAGE_OBJECT_ALLOCATE,
+	J_MESSAGE_OBJECT_PUNCH_HOLE,
+	J_MESSAGE_OBJECT_COPY,
+	J_MESSAGE_KV_COMPARE_AND_SWAP,
+	J_MESSAGE_KV_INCREMENT,
+	J_MESSAGE_KV_CREATE_INDEX,
+	J_MESSAGE_KV_GET_BY_INDEX,
+	J_MESSAGE_KV_MAX_MERGE,
+	J_MESSAGE_OBJECT_PURGE,
+	J_MESSAGE_KV_DELETE_BY_PREFIX,
+	J_MESSAGE_LOCK_ACQUIRE,
+	J_MESSAGE_LOCK_RELEASE,
+	J_MESSAGE_LOCK_REVOKE,
+	J_MESSAGE_OBJECT_LIST,
+	J_MESSAGE_OBJECT_DEDUP,
+	J_MESSAGE_OBJECT_APPEND,
+	J_MESSAGE_OBJECT_REDUCE,
+	J_MESSAGE_KV_WATCH,
+	J_MESSAGE_KV_PUT_RAW,
+	J_MESSAGE_KV_GET_RAW,
+	J_MESSAGE_OBJECT_OPEN,
+	J_MESSAGE_OBJECT_CLOSE,
+	J_MESSAGE_ECHO,
+	J_MESSAGE_OBJECT_SYNC,
+	J_MESSAGE_OBJECT_EXTENTS,
+	J_MESSAGE_OBJECT_PREFETCH,
+	J_MESSAGE_COMPOUND
 };
 
 typedef enum JMessageType JMessageType;
 
 enum JMessageFlags
 {
-	J_MESSAGE_FLAGS_NONE           = 0,
-	J_MESSAGE_FLAGS_REPLY          = 1 << 0,
-	J_MESSAGE_FLAGS_SAFETY_NETWORK = 1 << 1,
-	J_MESSAGE_FLAGS_SAFETY_STORAGE = 1 << 2,
+	J_MESSAGE_FLAGS_NONE              = 0,
+	J_MESSAGE_FLAGS_REPLY             = 1 << 0,
+	J_MESSAGE_FLAGS_SAFETY_NETWORK    = 1 << 1,
+	J_MESSAGE_FLAGS_SAFETY_STORAGE    = 1 << 2,
+	J_MESSAGE_FLAGS_COMPRESSED        = 1 << 3,
+	J_MESSAGE_FLAGS_CHECKSUM          = 1 << 4,
+	J_MESSAGE_FLAGS_COMPACT           = 1 << 5,
+	J_MESSAGE_FLAGS_RDMA              = 1 << 6,
+	J_MESSAGE_FLAGS_ACCESS_SEQUENTIAL = 1 << 7,
+	J_MESSAGE_FLAGS_ACCESS_RANDOM     = 1 << 8,
+	J_MESSAGE_FLAGS_TRACED            = 1 << 9,
+	J_MESSAGE_FLAGS_CREATE            = 1 << 10,
+	J_MESSAGE_FLAGS_HANDLE            = 1 << 11,
+	J_MESSAGE_FLAGS_LENGTH64          = 1 << 12,
 };
 
 typedef enum JMessageFlags JMessageFlags;
@@ -63,6 +102,8 @@ struct JMessage;
 
 typedef struct JMessage JMessage;
 
+typedef JMessage* (*JMessageLookupFunc) (guint32, gpointer);
+
 #include <jsemantics.h>
 
 JMessage* j_message_new (JMessageType, gsize);
@@ -70,25 +111,59 @@ JMessage* j_message_new_reply (JMessage*);
 JMessage* j_message_ref (JMessage*);
 void j_message_unref (JMessage*);
 
+void j_message_reset (JMessage*);
+guint64 j_message_get_allocation_count (void);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(JMessage, j_message_unref)
 
+guint32 j_message_get_id (JMessage const*);
+void j_message_set_id (JMessage*, guint32);
+guint64 j_message_get_trace_id (JMessage const*);
+void j_message_set_trace_id (JMessage*, guint64);
+
 JMessageType j_message_get_type (JMessage const*);
 JMessageFlags j_message_get_flags (JMessage const*);
 guint32 j_message_get_count (JMessage const*);
+gsize j_message_get_length (JMessage const*);
 
 gboolean j_message_append_1 (JMessage*, gconstpointer);
 gboolean j_message_append_4 (JMessage*, gconstpointer);
 gboolean j_message_append_8 (JMessage*, gconstpointer);
 gboolean j_message_append_n (JMessage*, gconstpointer, gsize);
+gboolean j_message_append_varint (JMessage*, guint64);
 
 gchar j_message_get_1 (JMessage*);
 gint32 j_message_get_4 (JMessage*);
 gint64 j_message_get_8 (JMessage*);
 gpointer j_message_get_n (JMessage*, gsize);
 gchar const* j_message_get_string (JMessage*);
+guint64 j_message_get_varint (JMessage*);
+
+void j_message_rewind (JMessage*);
+
+gboolean j_message_compression_available (void);
+void j_message_set_compression (GSocketConnection*, gboolean);
+gboolean j_message_get_compression (GSocketConnection*);
+
+void j_message_set_checksum (GSocketConnection*, gboolean);
+gboolean j_message_get_checksum (GSocketConnection*);
+gboolean j_message_get_payload_checksum (JMessage*, guint32*);
+guint64 j_message_get_checksum_error_count (void);
+
+void j_message_set_length64 (GSocketConnection*, gboolean);
+gboolean j_message_get_length64 (GSocketConnection*);
 
 gboolean j_message_send (JMessage*, GSocketConnection*);
 gboolean j_message_receive (JMessage*, GSocketConnection*);
+gboolean j_message_receive_lookup (GSocketConnection*, JMessageLookupFunc, gpointer, JMessage**);
+gboolean j_message_receive_header (JMessage*, GSocketConnection*, guint64*);
+gboolean j_message_receive_body (JMessage*, GSocketConnection*, gpointer, gsize);
+
+void j_message_send_async (JMessage*, GSocketConnection*, GAsyncReadyCallback, gpointer);
+gboolean j_message_send_finish (GAsyncResult*);
+void j_message_receive_async (JMessage*, GSocketConnection*, GAsyncReadyCallback, gpointer);
+gboolean j_message_receive_finish (GAsyncResult*);
+void j_message_receive_data_async (GSocketConnection*, gpointer, gsize, GAsyncReadyCallback, gpointer);
 
 gboolean j_message_read (JMessage*, GInputStream*);
 gboolean j_message_write (JMessage*, GOutputStream*);
@@ -96,7 +171,15 @@ gboolean j_message_write (JMessage*, GOutputStream*);
 void j_message_add_send (JMessage*, gconstpointer, guint64);
 void j_message_add_operation (JMessage*, gsize);
 
+void j_message_append_message (JMessage*, JMessage*);
+JMessage* j_message_get_message (JMessage*);
+
 void j_message_set_safety (JMessage*, JSemantics*);
 void j_message_force_safety (JMessage*, gint);
+void j_message_set_compact (JMessage*, gboolean);
+void j_message_set_access (JMessage*, JSemantics*);
+void j_message_set_create (JMessage*, gboolean);
+void j_message_set_handle (JMessage*, gboolean);
+void j_message_set_rdma (JMessage*, gboolean);
 
 #endif
@@ -0,0 +1,44 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_NODE_CACHE_H
+#define JULEA_NODE_CACHE_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+struct JNodeCache;
+
+typedef struct JNodeCache JNodeCache;
+
+typedef void (*JNodeCacheFunc) (gpointer, gpointer, guint64, guint64, guint64*);
+
+JNodeCache* j_node_cache_new (gchar const*);
+void j_node_cache_free (JNodeCache*);
+
+gboolean j_node_cache_read (JNodeCache*, gchar const*, gchar const*, gint64, guint64, gpointer, guint64, guint64, guint64*);
+gboolean j_node_cache_fill (JNodeCache*, gchar const*, gchar const*, gint64, guint64, JNodeCacheFunc, gpointer, gpointer, guint64, guint64, guint64*);
+
+#endif
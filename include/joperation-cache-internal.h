@@ -30,8 +30,9 @@
 #include <glib.h>
 
 #include <jbatch.h>
+#include <jconfiguration.h>
 
-G_GNUC_INTERNAL void j_operation_cache_init (void);
+G_GNUC_INTERNAL void j_operation_cache_init (JConfiguration*);
 G_GNUC_INTERNAL void j_operation_cache_fini (void);
 
 G_GNUC_INTERNAL gboolean j_operation_cache_flush (void);
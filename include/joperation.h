@@ -34,6 +34,21 @@
 
 typedef gboolean (*JOperationExecFunc) (JList*, JSemantics*);
 typedef void (*JOperationFreeFunc) (gpointer);
+typedef guint64 (*JOperationCacheSizeFunc) (gpointer);
+typedef void (*JOperationCacheFunc) (gpointer, gpointer);
+
+/**
+ * The result of an operation, see j_batch_get_result().
+ **/
+enum JOperationResult
+{
+	J_OPERATION_RESULT_SUCCESS,
+	J_OPERATION_RESULT_FAILED,
+	J_OPERATION_RESULT_CANCELLED,
+	J_OPERATION_RESULT_TIMED_OUT
+};
+
+typedef enum JOperationResult JOperationResult;
 
 /**
  * An operation.
@@ -45,6 +60,17 @@ struct JOperation
 
 	JOperationExecFunc exec_func;
 	JOperationFreeFunc free_func;
+
+	/**
+	 * Returns the number of bytes the operation needs in the operation cache, can be NULL if it needs none.
+	 */
+	JOperationCacheSizeFunc cache_size_func;
+
+	/**
+	 * Prepares the operation for being executed by the operation cache, NULL if it can not be cached.
+	 * It receives a buffer of cache_size_func's size and has to copy everything it references of the caller's memory into it.
+	 */
+	JOperationCacheFunc cache_func;
 };
 
 typedef struct JOperation JOperation;
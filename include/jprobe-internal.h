@@ -0,0 +1,50 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Static probes for tools like bpftrace and SystemTap.
+ * Probes are placed in the "julea" provider and compile to a single no-op instruction, so they can stay enabled in production builds.
+ * See scripts/bpftrace for examples.
+ **/
+
+#ifndef JULEA_PROBE_H
+#define JULEA_PROBE_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define J_PROBE(name) DTRACE_PROBE(julea, name)
+#define J_PROBE1(name, a) DTRACE_PROBE1(julea, name, a)
+#define J_PROBE2(name, a, b) DTRACE_PROBE2(julea, name, a, b)
+#define J_PROBE3(name, a, b, c) DTRACE_PROBE3(julea, name, a, b, c)
+#define J_PROBE4(name, a, b, c, d) DTRACE_PROBE4(julea, name, a, b, c, d)
+#else
+#define J_PROBE(name)
+#define J_PROBE1(name, a)
+#define J_PROBE2(name, a, b)
+#define J_PROBE3(name, a, b, c)
+#define J_PROBE4(name, a, b, c, d)
+#endif
+
+#endif
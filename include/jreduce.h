@@ -0,0 +1,88 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_REDUCE_H
+#define JULEA_REDUCE_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+#include <jmessage.h>
+
+enum JReduceType
+{
+	J_REDUCE_TYPE_INT32,
+	J_REDUCE_TYPE_INT64,
+	J_REDUCE_TYPE_FLOAT,
+	J_REDUCE_TYPE_DOUBLE
+};
+
+typedef enum JReduceType JReduceType;
+
+/**
+ * A value of a reduction.
+ * Integer arrays use i, floating-point arrays use f.
+ **/
+union JReduceValue
+{
+	gint64 i;
+	gdouble f;
+};
+
+typedef union JReduceValue JReduceValue;
+
+struct JReduce;
+
+typedef struct JReduce JReduce;
+
+JReduce* j_reduce_new (JReduceType);
+void j_reduce_free (JReduce*);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(JReduce, j_reduce_free)
+
+void j_reduce_set_histogram (JReduce*, gdouble, gdouble, guint);
+
+JReduceType j_reduce_get_type (JReduce const*);
+gsize j_reduce_get_element_size (JReduce const*);
+
+void j_reduce_reset (JReduce*);
+void j_reduce_update (JReduce*, gconstpointer, guint64);
+void j_reduce_combine (JReduce*, JReduce const*);
+
+guint64 j_reduce_get_count (JReduce const*);
+JReduceValue j_reduce_get_min (JReduce const*);
+JReduceValue j_reduce_get_max (JReduce const*);
+JReduceValue j_reduce_get_sum (JReduce const*);
+guint64 const* j_reduce_get_histogram (JReduce const*, guint*);
+
+gsize j_reduce_get_parameters_size (void);
+void j_reduce_append_parameters (JReduce const*, JMessage*);
+JReduce* j_reduce_new_from_message (JMessage*);
+
+gsize j_reduce_get_result_size (JReduce const*);
+void j_reduce_append_result (JReduce const*, JMessage*);
+void j_reduce_combine_from_message (JReduce*, JMessage*);
+
+#endif
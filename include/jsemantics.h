@@ -33,7 +33,8 @@ enum JSemanticsTemplate
 {
 	J_SEMANTICS_TEMPLATE_DEFAULT,
 	J_SEMANTICS_TEMPLATE_POSIX,
-	J_SEMANTICS_TEMPLATE_TEMPORARY_LOCAL
+	J_SEMANTICS_TEMPLATE_TEMPORARY_LOCAL,
+	J_SEMANTICS_TEMPLATE_CHECKPOINT
 };
 
 typedef enum JSemanticsTemplate JSemanticsTemplate;
@@ -46,7 +47,8 @@ enum JSemanticsType
 	J_SEMANTICS_ORDERING,
 	J_SEMANTICS_PERSISTENCY,
 	J_SEMANTICS_SAFETY,
-	J_SEMANTICS_SECURITY
+	J_SEMANTICS_SECURITY,
+	J_SEMANTICS_ACCESS
 };
 
 typedef enum JSemanticsType JSemanticsType;
@@ -113,6 +115,19 @@ enum JSemanticsSecurity
 
 typedef enum JSemanticsSecurity JSemanticsSecurity;
 
+/**
+ * How objects are going to be accessed.
+ * This is only a hint that allows backends to optimize prefetching.
+ */
+enum JSemanticsAccess
+{
+	J_SEMANTICS_ACCESS_DEFAULT,
+	J_SEMANTICS_ACCESS_SEQUENTIAL,
+	J_SEMANTICS_ACCESS_RANDOM
+};
+
+typedef enum JSemanticsAccess JSemanticsAccess;
+
 struct JSemantics;
 
 typedef struct JSemantics JSemantics;
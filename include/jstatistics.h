@@ -38,7 +38,17 @@ enum JStatisticsType
 	J_STATISTICS_BYTES_READ,
 	J_STATISTICS_BYTES_WRITTEN,
 	J_STATISTICS_BYTES_RECEIVED,
-	J_STATISTICS_BYTES_SENT
+	J_STATISTICS_BYTES_SENT,
+	J_STATISTICS_CHECKSUM_ERRORS,
+	J_STATISTICS_KV_CACHE_HITS,
+	J_STATISTICS_KV_CACHE_MISSES,
+	J_STATISTICS_BYTES_COMPRESSED,
+	J_STATISTICS_BYTES_STORED,
+	J_STATISTICS_MESSAGES_SENT,
+	J_STATISTICS_MESSAGES_RECEIVED,
+	J_STATISTICS_SERVERS,
+	J_STATISTICS_CONNECTION_WAIT,
+	J_STATISTICS_NETWORK_TIME
 };
 
 typedef enum JStatisticsType JStatisticsType;
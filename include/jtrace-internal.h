@@ -44,6 +44,98 @@ enum JTraceFileOperation
 
 typedef enum JTraceFileOperation JTraceFileOperation;
 
+/**
+ * Phases of a flow, which connects events across threads and processes.
+ */
+enum JTraceFlow
+{
+	J_TRACE_FLOW_BEGIN,
+	J_TRACE_FLOW_STEP,
+	J_TRACE_FLOW_END
+};
+
+typedef enum JTraceFlow JTraceFlow;
+
+/**
+ * The magic bytes at the beginning of files written by the ring back-end.
+ */
+#define J_TRACE_RING_MAGIC "JTRACE01"
+
+/**
+ * Types of records in files written by the ring back-end.
+ * Every record consists of a JTraceRecord header followed by its payload.
+ */
+enum JTraceRecordType
+{
+	/**
+	 * The payload contains the current tick count and wall-clock time in microseconds (two guint64).
+	 */
+	J_TRACE_RECORD_CLOCK,
+	/**
+	 * The payload contains the name of a thread, function, file or counter ID (without terminating null byte).
+	 */
+	J_TRACE_RECORD_THREAD,
+	J_TRACE_RECORD_FUNCTION,
+	J_TRACE_RECORD_FILE,
+	J_TRACE_RECORD_COUNTER,
+	/**
+	 * The payload contains a thread's events as an array of JTraceEvent.
+	 */
+	J_TRACE_RECORD_EVENTS,
+	/**
+	 * The payload contains the number of events a thread has dropped (one guint64).
+	 */
+	J_TRACE_RECORD_DROPPED
+};
+
+typedef enum JTraceRecordType JTraceRecordType;
+
+enum JTraceEventType
+{
+	J_TRACE_EVENT_ENTER,
+	J_TRACE_EVENT_LEAVE,
+	J_TRACE_EVENT_FILE_BEGIN,
+	J_TRACE_EVENT_FILE_END,
+	J_TRACE_EVENT_COUNTER
+};
+
+typedef enum JTraceEventType JTraceEventType;
+
+struct JTraceRecord
+{
+	guint32 type;
+	/**
+	 * The ID of the defined name or of the thread the record belongs to.
+	 */
+	guint32 id;
+	guint64 size;
+};
+
+typedef struct JTraceRecord JTraceRecord;
+
+struct JTraceEvent
+{
+	/**
+	 * The tick count, which can be converted using the clock records.
+	 */
+	guint64 ticks;
+	/**
+	 * The ID of the function, file or counter.
+	 */
+	guint32 id;
+	guint16 type;
+	/**
+	 * The JTraceFileOperation of file events.
+	 */
+	guint16 op;
+	/**
+	 * The length and offset of file events or the value of counter events.
+	 */
+	guint64 value[2];
+};
+
+typedef struct JTraceEvent JTraceEvent;
+
 struct JTrace;
 
 typedef struct JTrace JTrace;
@@ -57,12 +149,74 @@ JTrace* j_trace_new (GThread*);
 JTrace* j_trace_ref (JTrace*);
 void j_trace_unref (JTrace*);
 
-void j_trace_enter (gchar const*, gchar const*, ...) G_GNUC_PRINTF(2, 3);
-void j_trace_leave (gchar const*);
+void j_trace_enter_real (gchar const*, gchar const*, ...) G_GNUC_PRINTF(2, 3);
+void j_trace_leave_real (gchar const*);
+
+void j_trace_file_begin_real (gchar const*, JTraceFileOperation);
+void j_trace_file_end_real (gchar const*, JTraceFileOperation, guint64, guint64);
+
+void j_trace_counter_real (gchar const*, guint64);
+
+void j_trace_flow_real (gchar const*, guint64, JTraceFlow);
+
+/**
+ * Whether any trace back-end is enabled.
+ * It is checked inline by the trace points below, so disabled trace points only cost a load and a predicted branch.
+ * Their arguments are not evaluated in this case.
+ */
+extern gboolean j_trace_enabled;
+
+/**
+ * Incremented whenever the trace framework is initialized, invalidating the call sites' cached filter results.
+ */
+extern guint j_trace_generation;
+
+guint j_trace_site_resolve (guint*, gchar const*);
+
+/**
+ * Returns whether a call site passes the function filter.
+ * The cached result contains the generation it was computed in and whether the site is traced.
+ */
+static inline
+gboolean
+j_trace_site_check (guint* site, gchar const* name)
+{
+	guint value;
+
+	value = (guint)g_atomic_int_get(site);
+
+	if (G_UNLIKELY((value >> 1) != j_trace_generation))
+	{
+		value = j_trace_site_resolve(site, name);
+	}
+
+	return (value & 1);
+}
+
+/*
+ * Configuring with --disable-trace compiles out all trace points.
+ * The calls are kept in dead branches so that their arguments still count as used.
+ */
+#ifdef JULEA_TRACE_DISABLED
+#define J_TRACE_POINT(call) G_STMT_START { if (0) { call; } } G_STMT_END
+#define J_TRACE_POINT_FILTERED(name, call) J_TRACE_POINT(call)
+#else
+#define J_TRACE_POINT(call) G_STMT_START { if (G_UNLIKELY(j_trace_enabled)) { call; } } G_STMT_END
+/*
+ * Function trace points additionally cache whether J_TRACE_FUNCTION matches them per call site,
+ * so filtered functions skip the call just like disabled ones.
+ */
+#define J_TRACE_POINT_FILTERED(name, call) G_STMT_START { static guint j_trace_site = 0; if (G_UNLIKELY(j_trace_enabled) && j_trace_site_check(&j_trace_site, name)) { call; } } G_STMT_END
+#endif
+
+#define j_trace_enter(name, ...) J_TRACE_POINT_FILTERED(name, j_trace_enter_real(name, __VA_ARGS__))
+#define j_trace_leave(name) J_TRACE_POINT_FILTERED(name, j_trace_leave_real(name))
+
+#define j_trace_file_begin(path, op) J_TRACE_POINT(j_trace_file_begin_real(path, op))
+#define j_trace_file_end(path, op, length, offset) J_TRACE_POINT(j_trace_file_end_real(path, op, length, offset))
 
-void j_trace_file_begin (gchar const*, JTraceFileOperation);
-void j_trace_file_end (gchar const*, JTraceFileOperation, guint64, guint64);
+#define j_trace_counter(name, value) J_TRACE_POINT(j_trace_counter_real(name, value))
 
-void j_trace_counter (gchar const*, guint64);
+#define j_trace_flow(name, id, phase) J_TRACE_POINT(j_trace_flow_real(name, id, phase))
 
 #endif
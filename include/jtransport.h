@@ -0,0 +1,74 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_TRANSPORT_H
+#define JULEA_TRANSPORT_H
+
+#if !defined(JULEA_H) && !defined(JULEA_COMPILATION)
+#error "Only <julea.h> can be included directly."
+#endif
+
+#include <glib.h>
+#include <gio/gio.h>
+
+/**
+ * A memory region of a peer that can be accessed remotely.
+ **/
+struct JTransportRemote
+{
+	guint64 address;
+	guint64 key;
+};
+
+typedef struct JTransportRemote JTransportRemote;
+
+struct JTransportRegion;
+
+typedef struct JTransportRegion JTransportRegion;
+
+struct JTransportShm;
+
+typedef struct JTransportShm JTransportShm;
+
+gboolean j_transport_rdma_init (void);
+void j_transport_fini (void);
+
+gchar* j_transport_get_address (void);
+gboolean j_transport_accept (GSocketConnection*, gchar const*);
+
+JTransportRegion* j_transport_region_new (gpointer, guint64);
+void j_transport_region_get_remote (JTransportRegion*, JTransportRemote*);
+void j_transport_region_free (JTransportRegion*);
+void j_transport_region_sync (JTransportRegion*, guint64);
+
+JTransportShm* j_transport_shm_new (guint64);
+void j_transport_shm_free (JTransportShm*);
+
+gboolean j_transport_shm_offer (JTransportShm*, GSocketConnection*);
+gboolean j_transport_shm_accept (GSocketConnection*);
+
+JTransportRegion* j_transport_shm_region_new (JTransportShm*, gpointer, guint64, gboolean);
+
+gboolean j_transport_receive (GSocketConnection*, JTransportRemote const*, gpointer, guint64);
+gboolean j_transport_send (GSocketConnection*, JTransportRemote const*, gconstpointer, guint64);
+
+#endif
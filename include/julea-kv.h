@@ -26,5 +26,6 @@
 #include <kv/jkv.h>
 #include <kv/jkv-iterator.h>
 #include <kv/jkv-uri.h>
+#include <kv/jkv-watch.h>
 
 #endif
@@ -35,21 +35,29 @@
 #include <jbackend.h>
 #include <jbackground-operation.h>
 #include <jbatch.h>
+#include <jbuffer.h>
 #include <jcache.h>
 #include <jcommon.h>
 #include <jconfiguration.h>
 #include <jconnection-pool.h>
 #include <jcredentials.h>
+#include <jdevice.h>
 #include <jdistribution.h>
+#include <jerasure.h>
 #include <jhelper.h>
 #include <jlist.h>
 #include <jlist-iterator.h>
 #include <jlock.h>
+#include <jlock-manager.h>
 #include <jmemory-chunk.h>
 #include <jmessage.h>
+#include <jnode-cache.h>
 #include <joperation.h>
+#include <jreadahead.h>
+#include <jreduce.h>
 #include <jsemantics.h>
 #include <jstatistics.h>
+#include <jtransport.h>
 
 // FIXME
 #include <jtrace-internal.h>
@@ -36,9 +36,17 @@ typedef struct JKVIterator JKVIterator;
 #include <kv/jkv.h>
 
 JKVIterator* j_kv_iterator_new (guint32, gchar const*, gchar const*);
+JKVIterator* j_kv_iterator_new_for_prefix (gchar const*, gchar const*);
+JKVIterator* j_kv_iterator_new_for_semantics (gchar const*, gchar const*, JSemantics*);
+JKVIterator* j_kv_iterator_new_range (gchar const*, gchar const*, gchar const*, guint32);
+JKVIterator* j_kv_iterator_new_children (gchar const*, gchar const*, gchar const*, gchar const*, guint32);
+JKVIterator* j_kv_iterator_new_filter (gchar const*, gchar const*, bson_t const*, gchar const* const*);
+JKVIterator* j_kv_iterator_new_index (gchar const*, gchar const*, bson_t const*, gchar const* const*);
 void j_kv_iterator_free (JKVIterator*);
 
 gboolean j_kv_iterator_next (JKVIterator*);
 bson_t const* j_kv_iterator_get (JKVIterator*);
+gchar const* j_kv_iterator_get_key (JKVIterator*);
+GBytes* j_kv_iterator_get_bytes (JKVIterator*);
 
 #endif
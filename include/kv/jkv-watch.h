@@ -0,0 +1,48 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_KV_KV_WATCH_H
+#define JULEA_KV_KV_WATCH_H
+
+#if !defined(JULEA_KV_H) && !defined(JULEA_KV_COMPILATION)
+#error "Only <julea-kv.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+struct JKVWatch;
+
+typedef struct JKVWatch JKVWatch;
+
+#include <bson.h>
+
+JKVWatch* j_kv_watch_new (gchar const*, gchar const*, gboolean);
+void j_kv_watch_free (JKVWatch*);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(JKVWatch, j_kv_watch_free)
+
+gboolean j_kv_watch_next (JKVWatch*, gint64);
+gchar const* j_kv_watch_get_key (JKVWatch*);
+gboolean j_kv_watch_is_deleted (JKVWatch*);
+bson_t const* j_kv_watch_get (JKVWatch*);
+
+#endif
@@ -38,6 +38,7 @@ typedef struct JKV JKV;
 #include <julea.h>
 
 typedef void (*JKVGetFunc) (bson_t const*, gpointer);
+typedef void (*JKVGetManyFunc) (GBytes**, guint32, gpointer);
 
 JKV* j_kv_new (gchar const*, gchar const*);
 JKV* j_kv_new_for_index (guint32, gchar const*, gchar const*);
@@ -47,9 +48,20 @@ void j_kv_unref (JKV*);
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(JKV, j_kv_unref)
 
 void j_kv_put (JKV*, bson_t*, JBatch*);
+void j_kv_put_raw (JKV*, GBytes*, JBatch*);
 void j_kv_delete (JKV*, JBatch*);
+void j_kv_delete_by_prefix (gchar const*, gchar const*, JBatch*);
 
 void j_kv_get (JKV*, bson_t*, JBatch*);
 void j_kv_get_callback (JKV*, JKVGetFunc, gpointer, JBatch*);
+void j_kv_get_bytes (JKV*, GBytes**, JBatch*);
+void j_kv_get_raw (JKV*, GBytes**, JBatch*);
+void j_kv_get_many_callback (JKV**, guint32, JKVGetManyFunc, gpointer, JBatch*);
+
+void j_kv_compare_and_swap (JKV*, guint64, bson_t const*, guint64*, JBatch*);
+void j_kv_increment (JKV*, gchar const*, gint64, gint64*, JBatch*);
+void j_kv_max_merge (JKV*, bson_t const*, JBatch*);
+
+void j_kv_create_index (gchar const*, gchar const*, JBatch*);
 
 #endif
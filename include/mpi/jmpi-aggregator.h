@@ -0,0 +1,51 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_MPI_MPI_AGGREGATOR_H
+#define JULEA_MPI_MPI_AGGREGATOR_H
+
+#if !defined(JULEA_MPI_H) && !defined(JULEA_MPI_COMPILATION)
+#error "Only <julea-mpi.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+#include <mpi.h>
+
+struct JMPIAggregator;
+
+typedef struct JMPIAggregator JMPIAggregator;
+
+#include <julea.h>
+#include <julea-object.h>
+
+JMPIAggregator* j_mpi_aggregator_new (MPI_Comm, JDistributedObject*, JDistribution*, guint);
+void j_mpi_aggregator_free (JMPIAggregator*);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(JMPIAggregator, j_mpi_aggregator_free)
+
+gboolean j_mpi_aggregator_is_aggregator (JMPIAggregator*);
+
+void j_mpi_aggregator_write (JMPIAggregator*, gconstpointer, guint64, guint64);
+gboolean j_mpi_aggregator_flush (JMPIAggregator*, guint64*);
+
+#endif
@@ -41,11 +41,26 @@ void j_distributed_object_unref (JDistributedObject*);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(JDistributedObject, j_distributed_object_unref)
 
+void j_distributed_object_set_readahead (JDistributedObject*, guint64);
+
 void j_distributed_object_create (JDistributedObject*, JBatch*);
 void j_distributed_object_delete (JDistributedObject*, JBatch*);
+void j_distributed_object_purge (gchar const*, gchar const*, JBatch*);
+void j_distributed_object_snapshot (JDistributedObject*, JDistributedObject*, JBatch*);
 
 void j_distributed_object_read (JDistributedObject*, gpointer, guint64, guint64, guint64*, JBatch*);
 void j_distributed_object_write (JDistributedObject*, gconstpointer, guint64, guint64, guint64*, JBatch*);
+void j_distributed_object_read_device (JDistributedObject*, gpointer, guint64, guint64, guint64*, JBatch*);
+void j_distributed_object_write_device (JDistributedObject*, gconstpointer, guint64, guint64, guint64*, JBatch*);
+void j_distributed_object_append (JDistributedObject*, gconstpointer, guint64, guint64*, JBatch*);
+void j_distributed_object_reduce (JDistributedObject*, JReduce*, guint64, guint64, JBatch*);
+void j_distributed_object_truncate (JDistributedObject*, guint64, JBatch*);
+void j_distributed_object_allocate (JDistributedObject*, guint64, guint64, JBatch*);
+void j_distributed_object_punch_hole (JDistributedObject*, guint64, guint64, JBatch*);
+void j_distributed_object_prefetch (JDistributedObject*, guint64, guint64, JBatch*);
+
+void j_distributed_object_readv (JDistributedObject*, GInputVector const*, guint64 const*, guint, guint64*, JBatch*);
+void j_distributed_object_writev (JDistributedObject*, GOutputVector const*, guint64 const*, guint, guint64*, JBatch*);
 
 void j_distributed_object_status (JDistributedObject*, gint64*, guint64*, JBatch*);
 
@@ -33,7 +33,7 @@ struct JObjectIterator;
 
 typedef struct JObjectIterator JObjectIterator;
 
-JObjectIterator* j_object_iterator_new (gchar const*);
+JObjectIterator* j_object_iterator_new (gchar const*, gchar const*);
 void j_object_iterator_free (JObjectIterator*);
 
 gboolean j_object_iterator_next (JObjectIterator*);
@@ -42,12 +42,37 @@ void j_object_unref (JObject*);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(JObject, j_object_unref)
 
+guint32 j_object_get_index (JObject*);
+
+void j_object_set_readahead (JObject*, guint64);
+void j_object_set_write_behind (JObject*, guint64);
+
 void j_object_create (JObject*, JBatch*);
 void j_object_delete (JObject*, JBatch*);
 
+void j_object_open (JObject*, JBatch*);
+void j_object_close (JObject*, JBatch*);
+
 void j_object_read (JObject*, gpointer, guint64, guint64, guint64*, JBatch*);
 void j_object_write (JObject*, gconstpointer, guint64, guint64, guint64*, JBatch*);
+void j_object_read_device (JObject*, gpointer, guint64, guint64, guint64*, JBatch*);
+void j_object_write_device (JObject*, gconstpointer, guint64, guint64, guint64*, JBatch*);
+void j_object_append (JObject*, gconstpointer, guint64, guint64*, JBatch*);
+void j_object_reduce (JObject*, JReduce*, guint64, guint64, JBatch*);
+
+void j_object_readv (JObject*, GInputVector const*, guint64 const*, guint, guint64*, JBatch*);
+void j_object_writev (JObject*, GOutputVector const*, guint64 const*, guint, guint64*, JBatch*);
 
 void j_object_status (JObject*, gint64*, guint64*, JBatch*);
 
+void j_object_truncate (JObject*, guint64, JBatch*);
+void j_object_allocate (JObject*, guint64, guint64, JBatch*);
+void j_object_punch_hole (JObject*, guint64, guint64, JBatch*);
+void j_object_sync (JObject*, JBatch*);
+void j_object_prefetch (JObject*, guint64, guint64, JBatch*);
+void j_object_extents (JObject*, guint64, guint64, guint64*, guint64*, guint, guint*, JBatch*);
+
+void j_object_copy (JObject*, JObject*, guint64*, JBatch*);
+void j_object_snapshot (JObject*, JObject*, JBatch*);
+
 #endif
@@ -32,6 +32,7 @@
 #include <bson.h>
 
 #include <jconfiguration.h>
+#include <jdistribution.h>
 
 struct JDistributionVTable
 {
@@ -40,12 +41,20 @@ struct JDistributionVTable
 
 	void (*distribution_set) (gpointer, gchar const*, guint64);
 	void (*distribution_set2) (gpointer, gchar const*, guint64, guint64);
+	guint64 (*distribution_get_block_size) (gpointer);
 
 	void (*distribution_serialize) (gpointer, bson_t*);
 	void (*distribution_deserialize) (gpointer, bson_t const*);
 
 	void (*distribution_reset) (gpointer, guint64, guint64);
 	gboolean (*distribution_distribute) (gpointer, guint*, guint64*, guint64*, guint64*);
+	guint (*distribution_distribute_extents) (gpointer, JDistributionExtent*, guint);
+
+	guint (*distribution_get_replica_count) (gpointer);
+	void (*distribution_get_replica) (gpointer, JDistributionExtent const*, guint, guint*, guint64*);
+
+	gboolean (*distribution_get_stripe) (gpointer, guint*, guint*, guint64*);
+	void (*distribution_get_chunk) (gpointer, guint64, guint, guint*, guint64*);
 };
 
 typedef struct JDistributionVTable JDistributionVTable;
@@ -53,5 +62,9 @@ typedef struct JDistributionVTable JDistributionVTable;
 void j_distribution_round_robin_get_vtable (JDistributionVTable*);
 void j_distribution_single_server_get_vtable (JDistributionVTable*);
 void j_distribution_weighted_get_vtable (JDistributionVTable*);
+void j_distribution_rendezvous_get_vtable (JDistributionVTable*);
+void j_distribution_replicated_get_vtable (JDistributionVTable*);
+void j_distribution_erasure_get_vtable (JDistributionVTable*);
+void j_distribution_local_get_vtable (JDistributionVTable*);
 
 #endif
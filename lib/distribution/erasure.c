@@ -0,0 +1,556 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <jconfiguration.h>
+#include <jtrace-internal.h>
+
+#include <julea-internal.h>
+
+#include "distribution.h"
+
+/**
+ * \defgroup JDistribution Distribution
+ *
+ * Data structures and functions for managing distributions.
+ *
+ * @{
+ **/
+
+/**
+ * A distribution.
+ **/
+struct JDistributionErasure
+{
+	/**
+	 * The server count.
+	 **/
+	guint server_count;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block size.
+	 */
+	guint64 block_size;
+
+	guint start_index;
+
+	/**
+	 * The number of data blocks per stripe.
+	 */
+	guint data_count;
+
+	/**
+	 * The number of parity blocks per stripe.
+	 */
+	guint parity_count;
+};
+
+typedef struct JDistributionErasure JDistributionErasure;
+
+/**
+ * Returns the server a chunk of a stripe is stored on.
+ * The chunks of a stripe are stored on consecutive servers, the data chunks being followed by the parity chunks.
+ * Each stripe starts on the server after the previous stripe's last chunk.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param stripe       A stripe.
+ * \param chunk        A chunk.
+ *
+ * \return The server index.
+ **/
+static
+guint
+distribution_get_index (JDistributionErasure* distribution, guint64 stripe, guint chunk)
+{
+	guint64 position;
+
+	position = (stripe % distribution->server_count) * (distribution->data_count + distribution->parity_count);
+
+	return (distribution->start_index + position + chunk) % distribution->server_count;
+}
+
+/**
+ * Distributes data in stripes of data and parity blocks.
+ * Every server stores at most one chunk per stripe, so the stripe determines the offset on the server.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param new_length   A new length.
+ * \param new_offset   A new offset.
+ *
+ * \return TRUE on success, FALSE if the distribution is finished.
+ **/
+static
+gboolean
+distribution_distribute (gpointer data, guint* index, guint64* new_length, guint64* new_offset, guint64* block_id)
+{
+	JDistributionErasure* distribution = data;
+
+	gboolean ret = TRUE;
+	guint64 block;
+	guint64 displacement;
+	guint64 stripe;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	stripe = block / distribution->data_count;
+	displacement = distribution->offset % distribution->block_size;
+
+	*index = distribution_get_index(distribution, stripe, block % distribution->data_count);
+	*new_length = MIN(distribution->length, distribution->block_size - displacement);
+	*new_offset = (stripe * distribution->block_size) + displacement;
+	*block_id = block;
+
+	distribution->length -= *new_length;
+	distribution->offset += *new_length;
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Distributes the next extents of the range.
+ * Only the first extent's position is computed using divisions, the following ones are derived from it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents, 0 if the distribution is finished.
+ **/
+static
+guint
+distribution_distribute_extents (gpointer data, JDistributionExtent* extents, guint count)
+{
+	JDistributionErasure* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 stripe;
+	guint chunk;
+	guint n = 0;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	stripe = block / distribution->data_count;
+	chunk = block % distribution->data_count;
+	displacement = distribution->offset % distribution->block_size;
+
+	for (n = 0; n < count && distribution->length > 0; n++)
+	{
+		extents[n].index = distribution_get_index(distribution, stripe, chunk);
+		extents[n].length = MIN(distribution->length, distribution->block_size - displacement);
+		extents[n].offset = (stripe * distribution->block_size) + displacement;
+		extents[n].block_id = block;
+
+		distribution->length -= extents[n].length;
+		distribution->offset += extents[n].length;
+
+		displacement = 0;
+		block++;
+		chunk++;
+
+		if (chunk == distribution->data_count)
+		{
+			chunk = 0;
+			stripe++;
+		}
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
+/**
+ * Returns the stripe layout.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param data_count   The number of data blocks per stripe.
+ * \param parity_count The number of parity blocks per stripe.
+ * \param block_size   The block size.
+ *
+ * \return TRUE.
+ **/
+static
+gboolean
+distribution_get_stripe (gpointer data, guint* data_count, guint* parity_count, guint64* block_size)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, FALSE);
+
+	*data_count = distribution->data_count;
+	*parity_count = distribution->parity_count;
+	*block_size = distribution->block_size;
+
+	return TRUE;
+}
+
+/**
+ * Returns where a chunk of a stripe is stored.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param stripe       A stripe.
+ * \param chunk        A chunk, the data chunks are followed by the parity chunks.
+ * \param index        A server index.
+ * \param offset       An offset on the server.
+ **/
+static
+void
+distribution_get_chunk (gpointer data, guint64 stripe, guint chunk, guint* index, guint64* offset)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(chunk < distribution->data_count + distribution->parity_count);
+
+	*index = distribution_get_index(distribution, stripe, chunk);
+	*offset = stripe * distribution->block_size;
+}
+
+static
+gpointer
+distribution_new (guint server_count)
+{
+	JDistributionErasure* distribution;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution = g_slice_new(JDistributionErasure);
+	distribution->server_count = server_count;
+	distribution->length = 0;
+	distribution->offset = 0;
+	distribution->block_size = J_STRIPE_SIZE;
+
+	distribution->start_index = g_random_int_range(0, distribution->server_count);
+	distribution->parity_count = (server_count > 1) ? 1 : 0;
+	distribution->data_count = server_count - distribution->parity_count;
+
+	j_trace_leave(G_STRFUNC);
+
+	return distribution;
+}
+
+/**
+ * Decreases a distribution's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ **/
+static
+void
+distribution_free (gpointer data)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_slice_free(JDistributionErasure, distribution);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Sets the stripe layout for the erasure coding distribution.
+ * A stripe's data and parity blocks must not exceed the number of servers.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param key          A key.
+ * \param value        A value.
+ */
+static
+void
+distribution_set (gpointer data, gchar const* key, guint64 value)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (g_strcmp0(key, "block-size") == 0)
+	{
+		distribution->block_size = value;
+	}
+	else if (g_strcmp0(key, "start-index") == 0)
+	{
+		g_return_if_fail(value < distribution->server_count);
+
+		distribution->start_index = value;
+	}
+	else if (g_strcmp0(key, "data-blocks") == 0)
+	{
+		g_return_if_fail(value > 0 && value + distribution->parity_count <= distribution->server_count);
+
+		distribution->data_count = value;
+	}
+	else if (g_strcmp0(key, "parity-blocks") == 0)
+	{
+		g_return_if_fail(distribution->data_count + value <= distribution->server_count);
+
+		distribution->parity_count = value;
+	}
+}
+
+/**
+ * Returns the distribution's block size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ **/
+static
+guint64
+distribution_get_block_size (gpointer data)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return distribution->block_size;
+}
+
+/**
+ * Serializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution Credentials.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static
+void
+distribution_serialize (gpointer data, bson_t* b)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_append_int64(b, "block_size", -1, distribution->block_size);
+	bson_append_int32(b, "start_index", -1, distribution->start_index);
+	bson_append_int32(b, "data_blocks", -1, distribution->data_count);
+	bson_append_int32(b, "parity_blocks", -1, distribution->parity_count);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deserializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution distribution.
+ * \param b           A BSON object.
+ **/
+static
+void
+distribution_deserialize (gpointer data, bson_t const* b)
+{
+	JDistributionErasure* distribution = data;
+
+	bson_iter_t iterator;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(b != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "block_size") == 0)
+		{
+			distribution->block_size = bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "start_index") == 0)
+		{
+			distribution->start_index = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "data_blocks") == 0)
+		{
+			distribution->data_count = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "parity_blocks") == 0)
+		{
+			distribution->parity_count = bson_iter_int32(&iterator);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Initializes a distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * j_distribution_init(d, 0, 0);
+ * \endcode
+ *
+ * \param length A length.
+ * \param offset An offset.
+ *
+ * \return A new distribution. Should be freed with j_distribution_unref().
+ **/
+static
+void
+distribution_reset (gpointer data, guint64 length, guint64 offset)
+{
+	JDistributionErasure* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution->length = length;
+	distribution->offset = offset;
+
+	j_trace_leave(G_STRFUNC);
+}
+
+void
+j_distribution_erasure_get_vtable (JDistributionVTable* vtable)
+{
+	vtable->distribution_new = distribution_new;
+	vtable->distribution_free = distribution_free;
+	vtable->distribution_set = distribution_set;
+	vtable->distribution_set2 = NULL;
+	vtable->distribution_get_block_size = distribution_get_block_size;
+	vtable->distribution_serialize = distribution_serialize;
+	vtable->distribution_deserialize = distribution_deserialize;
+	vtable->distribution_reset = distribution_reset;
+	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_distribute_extents = distribution_distribute_extents;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
+	vtable->distribution_get_stripe = distribution_get_stripe;
+	vtable->distribution_get_chunk = distribution_get_chunk;
+}
+
+/**
+ * @}
+ **/
@@ -0,0 +1,493 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <julea-internal.h>
+#include <jconfiguration.h>
+#include <jtrace-internal.h>
+
+#include "distribution.h"
+
+/**
+ * \defgroup JDistribution Distribution
+ *
+ * Data structures and functions for managing distributions.
+ *
+ * @{
+ **/
+
+/**
+ * A distribution that places blocks on the object server running on the writer's host.
+ * The first #local_blocks blocks are stored on the local server, the remaining ones are distributed in a round robin fashion.
+ * Without a local server, all blocks are distributed in a round robin fashion.
+ **/
+struct JDistributionLocal
+{
+	/**
+	 * The server count.
+	 **/
+	guint server_count;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block size.
+	 */
+	guint64 block_size;
+
+	/**
+	 * The local server's index, #server_count if there is none.
+	 */
+	guint index;
+
+	/**
+	 * The number of blocks stored on the local server, G_MAXUINT64 for all blocks.
+	 */
+	guint64 local_blocks;
+
+	/**
+	 * The server that stores the first of the remaining blocks.
+	 */
+	guint start_index;
+};
+
+typedef struct JDistributionLocal JDistributionLocal;
+
+/**
+ * Determines the server and the offset on the server of a block.
+ * Remaining blocks on the local server are stored behind the local blocks.
+ *
+ * \private
+ **/
+static
+void
+distribution_locate (JDistributionLocal* distribution, guint64 block, guint* index, guint64* offset)
+{
+	guint64 local_blocks;
+	guint64 round;
+
+	local_blocks = (distribution->index < distribution->server_count) ? distribution->local_blocks : 0;
+
+	if (block < local_blocks)
+	{
+		*index = distribution->index;
+		*offset = block * distribution->block_size;
+		return;
+	}
+
+	block -= local_blocks;
+	round = block / distribution->server_count;
+
+	*index = (distribution->start_index + block) % distribution->server_count;
+	*offset = round * distribution->block_size;
+
+	if (*index == distribution->index)
+	{
+		*offset += local_blocks * distribution->block_size;
+	}
+}
+
+/**
+ * Distributes data to the local server first.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param new_length   A new length.
+ * \param new_offset   A new offset.
+ *
+ * \return TRUE on success, FALSE if the distribution is finished.
+ **/
+static
+gboolean
+distribution_distribute (gpointer data, guint* index, guint64* new_length, guint64* new_offset, guint64* block_id)
+{
+	JDistributionLocal* distribution = data;
+
+	gboolean ret = TRUE;
+	guint64 block;
+	guint64 displacement;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	displacement = distribution->offset % distribution->block_size;
+
+	distribution_locate(distribution, block, index, new_offset);
+
+	*new_length = MIN(distribution->length, distribution->block_size - displacement);
+	*new_offset += displacement;
+	*block_id = block;
+
+	distribution->length -= *new_length;
+	distribution->offset += *new_length;
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Distributes the next extents of the range.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents, 0 if the distribution is finished.
+ **/
+static
+guint
+distribution_distribute_extents (gpointer data, JDistributionExtent* extents, guint count)
+{
+	JDistributionLocal* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint n = 0;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	displacement = distribution->offset % distribution->block_size;
+
+	for (n = 0; n < count && distribution->length > 0; n++)
+	{
+		distribution_locate(distribution, block, &(extents[n].index), &(extents[n].offset));
+
+		extents[n].length = MIN(distribution->length, distribution->block_size - displacement);
+		extents[n].offset += displacement;
+		extents[n].block_id = block;
+
+		distribution->length -= extents[n].length;
+		distribution->offset += extents[n].length;
+
+		displacement = 0;
+		block++;
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
+static
+gpointer
+distribution_new (guint server_count)
+{
+	JDistributionLocal* distribution;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution = g_slice_new(JDistributionLocal);
+	distribution->server_count = server_count;
+	distribution->length = 0;
+	distribution->offset = 0;
+	distribution->block_size = J_STRIPE_SIZE;
+	distribution->index = server_count;
+	distribution->local_blocks = G_MAXUINT64;
+
+	distribution->start_index = g_random_int_range(0, distribution->server_count);
+
+	j_trace_leave(G_STRFUNC);
+
+	return distribution;
+}
+
+/**
+ * Decreases a distribution's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ **/
+static
+void
+distribution_free (gpointer data)
+{
+	JDistributionLocal* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_slice_free(JDistributionLocal, distribution);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Sets the local server's index or the number of local blocks.
+ * The remaining blocks start on the server following the local one.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param key          The key.
+ * \param value        The value.
+ */
+static
+void
+distribution_set (gpointer data, gchar const* key, guint64 value)
+{
+	JDistributionLocal* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (g_strcmp0(key, "block-size") == 0)
+	{
+		distribution->block_size = value;
+	}
+	else if (g_strcmp0(key, "index") == 0)
+	{
+		g_return_if_fail(value < distribution->server_count);
+
+		distribution->index = value;
+		distribution->start_index = (value + 1) % distribution->server_count;
+	}
+	else if (g_strcmp0(key, "local-blocks") == 0)
+	{
+		distribution->local_blocks = value;
+	}
+}
+
+/**
+ * Returns the distribution's block size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ **/
+static
+guint64
+distribution_get_block_size (gpointer data)
+{
+	JDistributionLocal* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return distribution->block_size;
+}
+
+/**
+ * Serializes distribution.
+ * The local server is serialized, too, so that readers on other hosts find the blocks.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution Credentials.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static
+void
+distribution_serialize (gpointer data, bson_t* b)
+{
+	JDistributionLocal* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_append_int64(b, "block_size", -1, distribution->block_size);
+
+	if (distribution->index < distribution->server_count)
+	{
+		bson_append_int32(b, "index", -1, distribution->index);
+	}
+
+	bson_append_int64(b, "local_blocks", -1, (gint64)distribution->local_blocks);
+	bson_append_int32(b, "start_index", -1, distribution->start_index);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deserializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution distribution.
+ * \param b           A BSON object.
+ **/
+static
+void
+distribution_deserialize (gpointer data, bson_t const* b)
+{
+	JDistributionLocal* distribution = data;
+
+	bson_iter_t iterator;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(b != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Distributions without a local server do not serialize an index. */
+	distribution->index = distribution->server_count;
+
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "block_size") == 0)
+		{
+			distribution->block_size = bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "index") == 0)
+		{
+			distribution->index = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "local_blocks") == 0)
+		{
+			distribution->local_blocks = (guint64)bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "start_index") == 0)
+		{
+			distribution->start_index = bson_iter_int32(&iterator);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Initializes a distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * j_distribution_init(d, 0, 0);
+ * \endcode
+ *
+ * \param length A length.
+ * \param offset An offset.
+ *
+ * \return A new distribution. Should be freed with j_distribution_unref().
+ **/
+static
+void
+distribution_reset (gpointer data, guint64 length, guint64 offset)
+{
+	JDistributionLocal* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution->length = length;
+	distribution->offset = offset;
+
+	j_trace_leave(G_STRFUNC);
+}
+
+void
+j_distribution_local_get_vtable (JDistributionVTable* vtable)
+{
+	vtable->distribution_new = distribution_new;
+	vtable->distribution_free = distribution_free;
+	vtable->distribution_set = distribution_set;
+	vtable->distribution_set2 = NULL;
+	vtable->distribution_get_block_size = distribution_get_block_size;
+	vtable->distribution_serialize = distribution_serialize;
+	vtable->distribution_deserialize = distribution_deserialize;
+	vtable->distribution_reset = distribution_reset;
+	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_distribute_extents = distribution_distribute_extents;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
+	vtable->distribution_get_stripe = NULL;
+	vtable->distribution_get_chunk = NULL;
+}
+
+/**
+ * @}
+ **/
@@ -0,0 +1,489 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <jconfiguration.h>
+#include <jtrace-internal.h>
+
+#include <julea-internal.h>
+
+#include "distribution.h"
+
+/**
+ * \defgroup JDistribution Distribution
+ *
+ * Data structures and functions for managing distributions.
+ *
+ * @{
+ **/
+
+/**
+ * A distribution.
+ **/
+struct JDistributionRendezvous
+{
+	/**
+	 * The server count.
+	 **/
+	guint server_count;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block size.
+	 */
+	guint64 block_size;
+
+	/**
+	 * The seed that is mixed into all block hashes.
+	 * Different seeds spread different objects' blocks differently.
+	 */
+	guint64 seed;
+};
+
+typedef struct JDistributionRendezvous JDistributionRendezvous;
+
+/**
+ * Calculates the score of a server for a block.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param seed  A seed.
+ * \param block A block.
+ * \param index A server index.
+ *
+ * \return The score.
+ **/
+static
+guint64
+distribution_score (guint64 seed, guint64 block, guint index)
+{
+	guint64 hash;
+
+	/* SplitMix64 finalizer. */
+	hash = seed ^ (block * G_GUINT64_CONSTANT(0x9E3779B97F4A7C15)) ^ ((guint64)index * G_GUINT64_CONSTANT(0xC2B2AE3D27D4EB4F));
+	hash = (hash ^ (hash >> 30)) * G_GUINT64_CONSTANT(0xBF58476D1CE4E5B9);
+	hash = (hash ^ (hash >> 27)) * G_GUINT64_CONSTANT(0x94D049BB133111EB);
+	hash = hash ^ (hash >> 31);
+
+	return hash;
+}
+
+/**
+ * Returns the server a block is stored on.
+ * This is the server with the highest score, that is, adding a server only moves the blocks it wins.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param block        A block.
+ *
+ * \return The server index.
+ **/
+static
+guint
+distribution_get_index (JDistributionRendezvous* distribution, guint64 block)
+{
+	guint64 max_score = 0;
+	guint index = 0;
+
+	for (guint i = 0; i < distribution->server_count; i++)
+	{
+		guint64 score;
+
+		score = distribution_score(distribution->seed, block, i);
+
+		if (i == 0 || score > max_score)
+		{
+			max_score = score;
+			index = i;
+		}
+	}
+
+	return index;
+}
+
+/**
+ * Distributes data using rendezvous hashing.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param new_length   A new length.
+ * \param new_offset   A new offset.
+ *
+ * \return TRUE on success, FALSE if the distribution is finished.
+ **/
+static
+gboolean
+distribution_distribute (gpointer data, guint* index, guint64* new_length, guint64* new_offset, guint64* block_id)
+{
+	JDistributionRendezvous* distribution = data;
+
+	gboolean ret = TRUE;
+	guint64 block;
+	guint64 displacement;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	displacement = distribution->offset % distribution->block_size;
+
+	/* Blocks keep their offset on the server, so they can be moved between servers as they are. */
+	*index = distribution_get_index(distribution, block);
+	*new_length = MIN(distribution->length, distribution->block_size - displacement);
+	*new_offset = distribution->offset;
+	*block_id = block;
+
+	distribution->length -= *new_length;
+	distribution->offset += *new_length;
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Distributes the next extents of the range.
+ * Only the first extent's position is computed using divisions, the following ones are derived from it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents, 0 if the distribution is finished.
+ **/
+static
+guint
+distribution_distribute_extents (gpointer data, JDistributionExtent* extents, guint count)
+{
+	JDistributionRendezvous* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint n = 0;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	displacement = distribution->offset % distribution->block_size;
+
+	for (n = 0; n < count && distribution->length > 0; n++)
+	{
+		extents[n].index = distribution_get_index(distribution, block);
+		extents[n].length = MIN(distribution->length, distribution->block_size - displacement);
+		extents[n].offset = distribution->offset;
+		extents[n].block_id = block;
+
+		distribution->length -= extents[n].length;
+		distribution->offset += extents[n].length;
+
+		displacement = 0;
+		block++;
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
+static
+gpointer
+distribution_new (guint server_count)
+{
+	JDistributionRendezvous* distribution;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution = g_slice_new(JDistributionRendezvous);
+	distribution->server_count = server_count;
+	distribution->length = 0;
+	distribution->offset = 0;
+	distribution->block_size = J_STRIPE_SIZE;
+
+	distribution->seed = ((guint64)g_random_int() << 32) | g_random_int();
+
+	j_trace_leave(G_STRFUNC);
+
+	return distribution;
+}
+
+/**
+ * Decreases a distribution's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ **/
+static
+void
+distribution_free (gpointer data)
+{
+	JDistributionRendezvous* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_slice_free(JDistributionRendezvous, distribution);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Sets the seed for the rendezvous distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param seed         A seed.
+ */
+static
+void
+distribution_set (gpointer data, gchar const* key, guint64 value)
+{
+	JDistributionRendezvous* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (g_strcmp0(key, "block-size") == 0)
+	{
+		distribution->block_size = value;
+	}
+	else if (g_strcmp0(key, "seed") == 0)
+	{
+		distribution->seed = value;
+	}
+}
+
+/**
+ * Returns the distribution's block size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ **/
+static
+guint64
+distribution_get_block_size (gpointer data)
+{
+	JDistributionRendezvous* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return distribution->block_size;
+}
+
+/**
+ * Serializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution Credentials.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static
+void
+distribution_serialize (gpointer data, bson_t* b)
+{
+	JDistributionRendezvous* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_append_int64(b, "block_size", -1, distribution->block_size);
+	bson_append_int64(b, "seed", -1, distribution->seed);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deserializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution distribution.
+ * \param b           A BSON object.
+ **/
+static
+void
+distribution_deserialize (gpointer data, bson_t const* b)
+{
+	JDistributionRendezvous* distribution = data;
+
+	bson_iter_t iterator;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(b != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "block_size") == 0)
+		{
+			distribution->block_size = bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "seed") == 0)
+		{
+			distribution->seed = bson_iter_int64(&iterator);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Initializes a distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * j_distribution_init(d, 0, 0);
+ * \endcode
+ *
+ * \param length A length.
+ * \param offset An offset.
+ *
+ * \return A new distribution. Should be freed with j_distribution_unref().
+ **/
+static
+void
+distribution_reset (gpointer data, guint64 length, guint64 offset)
+{
+	JDistributionRendezvous* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution->length = length;
+	distribution->offset = offset;
+
+	j_trace_leave(G_STRFUNC);
+}
+
+void
+j_distribution_rendezvous_get_vtable (JDistributionVTable* vtable)
+{
+	vtable->distribution_new = distribution_new;
+	vtable->distribution_free = distribution_free;
+	vtable->distribution_set = distribution_set;
+	vtable->distribution_set2 = NULL;
+	vtable->distribution_get_block_size = distribution_get_block_size;
+	vtable->distribution_serialize = distribution_serialize;
+	vtable->distribution_deserialize = distribution_deserialize;
+	vtable->distribution_reset = distribution_reset;
+	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_distribute_extents = distribution_distribute_extents;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
+	vtable->distribution_get_stripe = NULL;
+	vtable->distribution_get_chunk = NULL;
+}
+
+/**
+ * @}
+ **/
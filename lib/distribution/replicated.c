@@ -0,0 +1,509 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <julea-internal.h>
+#include <jconfiguration.h>
+#include <jtrace-internal.h>
+
+#include "distribution.h"
+
+/**
+ * \defgroup JDistribution Distribution
+ *
+ * Data structures and functions for managing distributions.
+ *
+ * @{
+ **/
+
+/**
+ * A distribution.
+ **/
+struct JDistributionReplicated
+{
+	/**
+	 * The server count.
+	 **/
+	guint server_count;
+
+	/**
+	 * The length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The offset.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The block size.
+	 */
+	guint64 block_size;
+
+	guint start_index;
+
+	/**
+	 * The number of copies of each block.
+	 */
+	guint replicas;
+};
+
+typedef struct JDistributionReplicated JDistributionReplicated;
+
+/**
+ * Distributes data in a round robin fashion and stores copies on the following servers.
+ * Each server stores #replicas slots per round, the primary copy of a block uses the first one.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param index        A server index.
+ * \param new_length   A new length.
+ * \param new_offset   A new offset.
+ *
+ * \return TRUE on success, FALSE if the distribution is finished.
+ **/
+static
+gboolean
+distribution_distribute (gpointer data, guint* index, guint64* new_length, guint64* new_offset, guint64* block_id)
+{
+	JDistributionReplicated* distribution = data;
+
+	gboolean ret = TRUE;
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	round = block / distribution->server_count;
+	displacement = distribution->offset % distribution->block_size;
+
+	*index = (distribution->start_index + block) % distribution->server_count;
+	*new_length = MIN(distribution->length, distribution->block_size - displacement);
+	*new_offset = (round * distribution->replicas * distribution->block_size) + displacement;
+	*block_id = block;
+
+	distribution->length -= *new_length;
+	distribution->offset += *new_length;
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Distributes the next extents of the range.
+ * Only the first extent's position is computed using divisions, the following ones are derived from it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents, 0 if the distribution is finished.
+ **/
+static
+guint
+distribution_distribute_extents (gpointer data, JDistributionExtent* extents, guint count)
+{
+	JDistributionReplicated* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+	guint position;
+	guint index;
+	guint n = 0;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	round = block / distribution->server_count;
+	position = block % distribution->server_count;
+	displacement = distribution->offset % distribution->block_size;
+	index = (distribution->start_index + position) % distribution->server_count;
+
+	for (n = 0; n < count && distribution->length > 0; n++)
+	{
+		extents[n].index = index;
+		extents[n].length = MIN(distribution->length, distribution->block_size - displacement);
+		extents[n].offset = (round * distribution->replicas * distribution->block_size) + displacement;
+		extents[n].block_id = block;
+
+		distribution->length -= extents[n].length;
+		distribution->offset += extents[n].length;
+
+		displacement = 0;
+		block++;
+		position++;
+		index++;
+
+		if (index == distribution->server_count)
+		{
+			index = 0;
+		}
+
+		if (position == distribution->server_count)
+		{
+			position = 0;
+			round++;
+		}
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
+static
+gpointer
+distribution_new (guint server_count)
+{
+	JDistributionReplicated* distribution;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution = g_slice_new(JDistributionReplicated);
+	distribution->server_count = server_count;
+	distribution->length = 0;
+	distribution->offset = 0;
+	distribution->block_size = J_STRIPE_SIZE;
+
+	distribution->start_index = g_random_int_range(0, distribution->server_count);
+	distribution->replicas = MIN(2, distribution->server_count);
+
+	j_trace_leave(G_STRFUNC);
+
+	return distribution;
+}
+
+/**
+ * Decreases a distribution's reference count.
+ * When the reference count reaches zero, frees the memory allocated for the distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ **/
+static
+void
+distribution_free (gpointer data)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_slice_free(JDistributionReplicated, distribution);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Returns the number of copies of each block.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The number of copies.
+ **/
+static
+guint
+distribution_get_replica_count (gpointer data)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 1);
+
+	return distribution->replicas;
+}
+
+/**
+ * Returns where a copy of an extent is stored.
+ * The copy with number j is stored on the j-th server after the primary one, in the j-th slot of the round.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extent       An extent of the primary copy.
+ * \param replica      A copy number.
+ * \param index        A server index.
+ * \param offset       An offset on the server.
+ **/
+static
+void
+distribution_get_replica (gpointer data, JDistributionExtent const* extent, guint replica, guint* index, guint64* offset)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(replica < distribution->replicas);
+
+	*index = (extent->index + replica) % distribution->server_count;
+	*offset = extent->offset + (replica * distribution->block_size);
+}
+
+/**
+ * Sets the start index for the round robin distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param start_index  An index.
+ */
+static
+void
+distribution_set (gpointer data, gchar const* key, guint64 value)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (g_strcmp0(key, "block-size") == 0)
+	{
+		distribution->block_size = value;
+	}
+	else if (g_strcmp0(key, "start-index") == 0)
+	{
+		g_return_if_fail(value < distribution->server_count);
+
+		distribution->start_index = value;
+	}
+	else if (g_strcmp0(key, "replicas") == 0)
+	{
+		g_return_if_fail(value > 0 && value <= distribution->server_count);
+
+		distribution->replicas = value;
+	}
+}
+
+/**
+ * Returns the distribution's block size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ **/
+static
+guint64
+distribution_get_block_size (gpointer data)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return distribution->block_size;
+}
+
+/**
+ * Serializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution Credentials.
+ *
+ * \return A new BSON object. Should be freed with g_slice_free().
+ **/
+static
+void
+distribution_serialize (gpointer data, bson_t* b)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_append_int64(b, "block_size", -1, distribution->block_size);
+	bson_append_int32(b, "start_index", -1, distribution->start_index);
+	bson_append_int32(b, "replicas", -1, distribution->replicas);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Deserializes distribution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution distribution.
+ * \param b           A BSON object.
+ **/
+static
+void
+distribution_deserialize (gpointer data, bson_t const* b)
+{
+	JDistributionReplicated* distribution = data;
+
+	bson_iter_t iterator;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(b != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	bson_iter_init(&iterator, b);
+
+	while (bson_iter_next(&iterator))
+	{
+		gchar const* key;
+
+		key = bson_iter_key(&iterator);
+
+		if (g_strcmp0(key, "block_size") == 0)
+		{
+			distribution->block_size = bson_iter_int64(&iterator);
+		}
+		else if (g_strcmp0(key, "start_index") == 0)
+		{
+			distribution->start_index = bson_iter_int32(&iterator);
+		}
+		else if (g_strcmp0(key, "replicas") == 0)
+		{
+			distribution->replicas = bson_iter_int32(&iterator);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Initializes a distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * j_distribution_init(d, 0, 0);
+ * \endcode
+ *
+ * \param length A length.
+ * \param offset An offset.
+ *
+ * \return A new distribution. Should be freed with j_distribution_unref().
+ **/
+static
+void
+distribution_reset (gpointer data, guint64 length, guint64 offset)
+{
+	JDistributionReplicated* distribution = data;
+
+	g_return_if_fail(distribution != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	distribution->length = length;
+	distribution->offset = offset;
+
+	j_trace_leave(G_STRFUNC);
+}
+
+void
+j_distribution_replicated_get_vtable (JDistributionVTable* vtable)
+{
+	vtable->distribution_new = distribution_new;
+	vtable->distribution_free = distribution_free;
+	vtable->distribution_set = distribution_set;
+	vtable->distribution_set2 = NULL;
+	vtable->distribution_get_block_size = distribution_get_block_size;
+	vtable->distribution_serialize = distribution_serialize;
+	vtable->distribution_deserialize = distribution_deserialize;
+	vtable->distribution_reset = distribution_reset;
+	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_distribute_extents = distribution_distribute_extents;
+	vtable->distribution_get_replica_count = distribution_get_replica_count;
+	vtable->distribution_get_replica = distribution_get_replica;
+	vtable->distribution_get_stripe = NULL;
+	vtable->distribution_get_chunk = NULL;
+}
+
+/**
+ * @}
+ **/
@@ -124,6 +124,82 @@ end:
 	return ret;
 }
 
+/**
+ * Distributes the next extents of the range.
+ * Only the first extent's position is computed using divisions, the following ones are derived from it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents, 0 if the distribution is finished.
+ **/
+static
+guint
+distribution_distribute_extents (gpointer data, JDistributionExtent* extents, guint count)
+{
+	JDistributionRoundRobin* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+	guint position;
+	guint index;
+	guint n = 0;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	round = block / distribution->server_count;
+	position = block % distribution->server_count;
+	displacement = distribution->offset % distribution->block_size;
+	index = (distribution->start_index + position) % distribution->server_count;
+
+	for (n = 0; n < count && distribution->length > 0; n++)
+	{
+		extents[n].index = index;
+		extents[n].length = MIN(distribution->length, distribution->block_size - displacement);
+		extents[n].offset = (round * distribution->block_size) + displacement;
+		extents[n].block_id = block;
+
+		distribution->length -= extents[n].length;
+		distribution->offset += extents[n].length;
+
+		displacement = 0;
+		block++;
+		position++;
+		index++;
+
+		if (index == distribution->server_count)
+		{
+			index = 0;
+		}
+
+		if (position == distribution->server_count)
+		{
+			position = 0;
+			round++;
+		}
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
 static
 gpointer
 distribution_new (guint server_count)
@@ -202,6 +278,31 @@ distribution_set (gpointer data, gchar const* key, guint64 value)
 	}
 }
 
+/**
+ * Returns the distribution's block size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ **/
+static
+guint64
+distribution_get_block_size (gpointer data)
+{
+	JDistributionRoundRobin* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return distribution->block_size;
+}
+
 /**
  * Serializes distribution.
  *
@@ -318,10 +419,16 @@ j_distribution_round_robin_get_vtable (JDistributionVTable* vtable)
 	vtable->distribution_free = distribution_free;
 	vtable->distribution_set = distribution_set;
 	vtable->distribution_set2 = NULL;
+	vtable->distribution_get_block_size = distribution_get_block_size;
 	vtable->distribution_serialize = distribution_serialize;
 	vtable->distribution_deserialize = distribution_deserialize;
 	vtable->distribution_reset = distribution_reset;
 	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_distribute_extents = distribution_distribute_extents;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
+	vtable->distribution_get_stripe = NULL;
+	vtable->distribution_get_chunk = NULL;
 }
 
 /**
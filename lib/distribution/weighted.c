@@ -142,6 +142,94 @@ end:
 	return ret;
 }
 
+/**
+ * Distributes the next extents of the range.
+ * Only the first extent's position is computed using divisions, the following ones are derived from it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents, 0 if the distribution is finished.
+ **/
+static
+guint
+distribution_distribute_extents (gpointer data, JDistributionExtent* extents, guint count)
+{
+	JDistributionWeighted* distribution = data;
+
+	guint64 block;
+	guint64 displacement;
+	guint64 round;
+	guint block_offset;
+	guint index = 0;
+	guint n = 0;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (distribution->length == 0)
+	{
+		goto end;
+	}
+
+	block = distribution->offset / distribution->block_size;
+	round = block / distribution->sum;
+	displacement = distribution->offset % distribution->block_size;
+
+	block_offset = block % distribution->sum;
+
+	for (guint i = 0; i < distribution->server_count; i++)
+	{
+		if (block_offset < distribution->weights[i])
+		{
+			index = i;
+			break;
+		}
+
+		block_offset -= distribution->weights[i];
+	}
+
+	for (n = 0; n < count && distribution->length > 0; n++)
+	{
+		extents[n].index = index;
+		extents[n].length = MIN(distribution->length, distribution->block_size - displacement);
+		extents[n].offset = (((round * distribution->weights[index]) + block_offset) * distribution->block_size) + displacement;
+		extents[n].block_id = block;
+
+		distribution->length -= extents[n].length;
+		distribution->offset += extents[n].length;
+
+		displacement = 0;
+		block++;
+		block_offset++;
+
+		/* Move on to the next server with a non-zero weight, starting a new round after the last one. */
+		while (block_offset == distribution->weights[index])
+		{
+			block_offset = 0;
+			index++;
+
+			if (index == distribution->server_count)
+			{
+				index = 0;
+				round++;
+			}
+		}
+	}
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
 static
 gpointer
 distribution_new (guint server_count)
@@ -241,6 +329,31 @@ distribution_set2 (gpointer data, gchar const* key, guint64 value1, guint64 valu
 	}
 }
 
+/**
+ * Returns the distribution's block size.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ **/
+static
+guint64
+distribution_get_block_size (gpointer data)
+{
+	JDistributionWeighted* distribution = data;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+
+	return distribution->block_size;
+}
+
 /**
  * Serializes distribution.
  *
@@ -379,10 +492,16 @@ j_distribution_weighted_get_vtable (JDistributionVTable* vtable)
 	vtable->distribution_free = distribution_free;
 	vtable->distribution_set = distribution_set;
 	vtable->distribution_set2 = distribution_set2;
+	vtable->distribution_get_block_size = distribution_get_block_size;
 	vtable->distribution_serialize = distribution_serialize;
 	vtable->distribution_deserialize = distribution_deserialize;
 	vtable->distribution_reset = distribution_reset;
 	vtable->distribution_distribute = distribution_distribute;
+	vtable->distribution_distribute_extents = distribution_distribute_extents;
+	vtable->distribution_get_replica_count = NULL;
+	vtable->distribution_get_replica = NULL;
+	vtable->distribution_get_stripe = NULL;
+	vtable->distribution_get_chunk = NULL;
 }
 
 /**
@@ -26,6 +26,8 @@
 #include <gmodule.h>
 
 #include <jbackend.h>
+#include <jhelper.h>
+#include <jprobe-internal.h>
 
 #include <jtrace-internal.h>
 
@@ -37,6 +39,9 @@
  * @{
  **/
 
+/* Serializes emulated conditional updates, see j_backend_kv_compare_and_swap() */
+static GMutex j_backend_kv_update_mutex;
+
 static
 GModule*
 j_backend_load (gchar const* name, gchar const* component, JBackendType type, JBackend** backend)
@@ -72,7 +77,9 @@ j_backend_load (gchar const* name, gchar const* component, JBackendType type, JB
 		g_assert(module_backend_info != NULL);
 
 		j_trace_enter("backend_info", "%d", type);
+		J_PROBE1(backend_enter, "backend_info");
 		tmp_backend = module_backend_info(type);
+		J_PROBE1(backend_leave, "backend_info");
 		j_trace_leave("backend_info");
 
 		if (tmp_backend != NULL)
@@ -103,6 +110,7 @@ j_backend_load (gchar const* name, gchar const* component, JBackendType type, JB
 				g_assert(tmp_backend->kv.get != NULL);
 				g_assert(tmp_backend->kv.get_all != NULL);
 				g_assert(tmp_backend->kv.get_by_prefix != NULL);
+				g_assert(tmp_backend->kv.get_range != NULL);
 				g_assert(tmp_backend->kv.iterate != NULL);
 			}
 		}
@@ -167,7 +175,9 @@ j_backend_object_init (JBackend* backend, gchar const* path)
 	g_return_val_if_fail(path != NULL, FALSE);
 
 	j_trace_enter("backend_init", "%s", path);
+	J_PROBE1(backend_enter, "backend_init");
 	ret = backend->object.init(path);
+	J_PROBE1(backend_leave, "backend_init");
 	j_trace_leave("backend_init");
 
 	return ret;
@@ -180,7 +190,9 @@ j_backend_object_fini (JBackend* backend)
 	g_return_if_fail(backend->type == J_BACKEND_TYPE_OBJECT);
 
 	j_trace_enter("backend_fini", NULL);
+	J_PROBE1(backend_enter, "backend_fini");
 	backend->object.fini();
+	J_PROBE1(backend_leave, "backend_fini");
 	j_trace_leave("backend_fini");
 }
 
@@ -196,7 +208,9 @@ j_backend_object_create (JBackend* backend, gchar const* namespace, gchar const*
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	j_trace_enter("backend_create", "%s, %s, %p", namespace, path, (gpointer)data);
+	J_PROBE1(backend_enter, "backend_create");
 	ret = backend->object.create(namespace, path, data);
+	J_PROBE1(backend_leave, "backend_create");
 	j_trace_leave("backend_create");
 
 	return ret;
@@ -214,7 +228,9 @@ j_backend_object_open (JBackend* backend, gchar const* namespace, gchar const* p
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	j_trace_enter("backend_open", "%s, %s, %p", namespace, path, (gpointer)data);
+	J_PROBE1(backend_enter, "backend_open");
 	ret = backend->object.open(namespace, path, data);
+	J_PROBE1(backend_leave, "backend_open");
 	j_trace_leave("backend_open");
 
 	return ret;
@@ -230,7 +246,9 @@ j_backend_object_delete (JBackend* backend, gpointer data)
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	j_trace_enter("backend_delete", "%p", data);
+	J_PROBE1(backend_enter, "backend_delete");
 	ret = backend->object.delete(data);
+	J_PROBE1(backend_leave, "backend_delete");
 	j_trace_leave("backend_delete");
 
 	return ret;
@@ -246,7 +264,9 @@ j_backend_object_close (JBackend* backend, gpointer data)
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	j_trace_enter("backend_close", "%p", data);
+	J_PROBE1(backend_enter, "backend_close");
 	ret = backend->object.close(data);
+	J_PROBE1(backend_leave, "backend_close");
 	j_trace_leave("backend_close");
 
 	return ret;
@@ -264,7 +284,9 @@ j_backend_object_status (JBackend* backend, gpointer data, gint64* modification_
 	g_return_val_if_fail(size != NULL, FALSE);
 
 	j_trace_enter("backend_status", "%p, %p, %p", data, (gpointer)modification_time, (gpointer)size);
+	J_PROBE1(backend_enter, "backend_status");
 	ret = backend->object.status(data, modification_time, size);
+	J_PROBE1(backend_leave, "backend_status");
 	j_trace_leave("backend_status");
 
 	return ret;
@@ -280,7 +302,9 @@ j_backend_object_sync (JBackend* backend, gpointer data)
 	g_return_val_if_fail(data != NULL, FALSE);
 
 	j_trace_enter("backend_sync", "%p", data);
+	J_PROBE1(backend_enter, "backend_sync");
 	ret = backend->object.sync(data);
+	J_PROBE1(backend_leave, "backend_sync");
 	j_trace_leave("backend_sync");
 
 	return ret;
@@ -298,7 +322,9 @@ j_backend_object_read (JBackend* backend, gpointer data, gpointer buffer, guint6
 	g_return_val_if_fail(bytes_read != NULL, FALSE);
 
 	j_trace_enter("backend_read", "%p, %p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, buffer, length, offset, (gpointer)bytes_read);
+	J_PROBE1(backend_enter, "backend_read");
 	ret = backend->object.read(data, buffer, length, offset, bytes_read);
+	J_PROBE1(backend_leave, "backend_read");
 	j_trace_leave("backend_read");
 
 	return ret;
@@ -316,12 +342,394 @@ j_backend_object_write (JBackend* backend, gpointer data, gconstpointer buffer,
 	g_return_val_if_fail(bytes_written != NULL, FALSE);
 
 	j_trace_enter("backend_write", "%p, %p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, buffer, length, offset, (gpointer)bytes_written);
+	J_PROBE1(backend_enter, "backend_write");
 	ret = backend->object.write(data, buffer, length, offset, bytes_written);
+	J_PROBE1(backend_leave, "backend_write");
 	j_trace_leave("backend_write");
 
 	return ret;
 }
 
+gboolean
+j_backend_object_read_to_fd (JBackend* backend, gpointer data, gint fd, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.read_to_fd != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(fd >= 0, FALSE);
+	g_return_val_if_fail(bytes_read != NULL, FALSE);
+
+	j_trace_enter("backend_read_to_fd", "%p, %d, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, fd, length, offset, (gpointer)bytes_read);
+	J_PROBE1(backend_enter, "backend_read_to_fd");
+	ret = backend->object.read_to_fd(data, fd, length, offset, bytes_read);
+	J_PROBE1(backend_leave, "backend_read_to_fd");
+	j_trace_leave("backend_read_to_fd");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_write_from_fd (JBackend* backend, gpointer data, gint fd, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.write_from_fd != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(fd >= 0, FALSE);
+	g_return_val_if_fail(bytes_written != NULL, FALSE);
+
+	j_trace_enter("backend_write_from_fd", "%p, %d, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %p", data, fd, length, offset, (gpointer)bytes_written);
+	J_PROBE1(backend_enter, "backend_write_from_fd");
+	ret = backend->object.write_from_fd(data, fd, length, offset, bytes_written);
+	J_PROBE1(backend_leave, "backend_write_from_fd");
+	j_trace_leave("backend_write_from_fd");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_truncate (JBackend* backend, gpointer data, guint64 size)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.truncate != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	j_trace_enter("backend_truncate", "%p, %" G_GUINT64_FORMAT, data, size);
+	J_PROBE1(backend_enter, "backend_truncate");
+	ret = backend->object.truncate(data, size);
+	J_PROBE1(backend_leave, "backend_truncate");
+	j_trace_leave("backend_truncate");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_allocate (JBackend* backend, gpointer data, guint64 length, guint64 offset)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.allocate != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	j_trace_enter("backend_allocate", "%p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT, data, length, offset);
+	J_PROBE1(backend_enter, "backend_allocate");
+	ret = backend->object.allocate(data, length, offset);
+	J_PROBE1(backend_leave, "backend_allocate");
+	j_trace_leave("backend_allocate");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_punch_hole (JBackend* backend, gpointer data, guint64 length, guint64 offset)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.punch_hole != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	j_trace_enter("backend_punch_hole", "%p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT, data, length, offset);
+	J_PROBE1(backend_enter, "backend_punch_hole");
+	ret = backend->object.punch_hole(data, length, offset);
+	J_PROBE1(backend_leave, "backend_punch_hole");
+	j_trace_leave("backend_punch_hole");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_copy (JBackend* backend, gpointer from, gpointer to, guint64* bytes_copied)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.copy != NULL, FALSE);
+	g_return_val_if_fail(from != NULL, FALSE);
+	g_return_val_if_fail(to != NULL, FALSE);
+	g_return_val_if_fail(bytes_copied != NULL, FALSE);
+
+	j_trace_enter("backend_copy", "%p, %p, %p", from, to, (gpointer)bytes_copied);
+	J_PROBE1(backend_enter, "backend_copy");
+	ret = backend->object.copy(from, to, bytes_copied);
+	J_PROBE1(backend_leave, "backend_copy");
+	j_trace_leave("backend_copy");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_readv (JBackend* backend, gpointer data, gpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, guint64* bytes_read)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.readv != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(buffers != NULL, FALSE);
+	g_return_val_if_fail(lengths != NULL, FALSE);
+	g_return_val_if_fail(offsets != NULL, FALSE);
+	g_return_val_if_fail(bytes_read != NULL, FALSE);
+
+	j_trace_enter("backend_readv", "%p, %p, %p, %p, %u, %p", data, (gconstpointer)buffers, (gconstpointer)lengths, (gconstpointer)offsets, count, (gpointer)bytes_read);
+	J_PROBE1(backend_enter, "backend_readv");
+	ret = backend->object.readv(data, buffers, lengths, offsets, count, bytes_read);
+	J_PROBE1(backend_leave, "backend_readv");
+	j_trace_leave("backend_readv");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_writev (JBackend* backend, gpointer data, gconstpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* bytes_written)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.writev != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(buffers != NULL, FALSE);
+	g_return_val_if_fail(lengths != NULL, FALSE);
+	g_return_val_if_fail(offsets != NULL, FALSE);
+	g_return_val_if_fail(bytes_written != NULL, FALSE);
+
+	j_trace_enter("backend_writev", "%p, %p, %p, %p, %u, %d, %p", data, (gconstpointer)buffers, (gconstpointer)lengths, (gconstpointer)offsets, count, sync, (gpointer)bytes_written);
+	J_PROBE1(backend_enter, "backend_writev");
+	ret = backend->object.writev(data, buffers, lengths, offsets, count, sync, bytes_written);
+	J_PROBE1(backend_leave, "backend_writev");
+	j_trace_leave("backend_writev");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_hint (JBackend* backend, gpointer data, gint access, guint64 length, guint64 offset)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.hint != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	j_trace_enter("backend_hint", "%p, %d, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT, data, access, length, offset);
+	J_PROBE1(backend_enter, "backend_hint");
+	ret = backend->object.hint(data, access, length, offset);
+	J_PROBE1(backend_leave, "backend_hint");
+	j_trace_leave("backend_hint");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_purge (JBackend* backend, gchar const* namespace, gchar const* directory)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.purge != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(directory != NULL, FALSE);
+
+	j_trace_enter("backend_purge", "%s, %s", namespace, directory);
+	J_PROBE1(backend_enter, "backend_purge");
+	ret = backend->object.purge(namespace, directory);
+	J_PROBE1(backend_leave, "backend_purge");
+	j_trace_leave("backend_purge");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_rename (JBackend* backend, gpointer data, gchar const* namespace, gchar const* path)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.rename != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(path != NULL, FALSE);
+
+	j_trace_enter("backend_rename", "%p, %s, %s", data, namespace, path);
+	J_PROBE1(backend_enter, "backend_rename");
+	ret = backend->object.rename(data, namespace, path);
+	J_PROBE1(backend_leave, "backend_rename");
+	j_trace_leave("backend_rename");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_list (JBackend* backend, gchar const* namespace, gpointer* iterator)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.list != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+
+	j_trace_enter("backend_list", "%s, %p", namespace, (gpointer)iterator);
+	J_PROBE1(backend_enter, "backend_list");
+	ret = backend->object.list(namespace, iterator);
+	J_PROBE1(backend_leave, "backend_list");
+	j_trace_leave("backend_list");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_list_by_prefix (JBackend* backend, gchar const* namespace, gchar const* prefix, gpointer* iterator)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.list_by_prefix != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+
+	j_trace_enter("backend_list_by_prefix", "%s, %s, %p", namespace, prefix, (gpointer)iterator);
+	J_PROBE1(backend_enter, "backend_list_by_prefix");
+	ret = backend->object.list_by_prefix(namespace, prefix, iterator);
+	J_PROBE1(backend_leave, "backend_list_by_prefix");
+	j_trace_leave("backend_list_by_prefix");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_iterate (JBackend* backend, gpointer iterator, gchar const** path)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.iterate != NULL, FALSE);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+	g_return_val_if_fail(path != NULL, FALSE);
+
+	j_trace_enter("backend_iterate", "%p, %p", iterator, (gpointer)path);
+	J_PROBE1(backend_enter, "backend_iterate");
+	ret = backend->object.iterate(iterator, path);
+	J_PROBE1(backend_leave, "backend_iterate");
+	j_trace_leave("backend_iterate");
+
+	return ret;
+}
+
+gboolean
+j_backend_object_compression (JBackend* backend, guint64* bytes_compressed, guint64* bytes_stored)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(backend->object.compression != NULL, FALSE);
+	g_return_val_if_fail(bytes_compressed != NULL, FALSE);
+	g_return_val_if_fail(bytes_stored != NULL, FALSE);
+
+	j_trace_enter("backend_compression", "%p, %p", (gpointer)bytes_compressed, (gpointer)bytes_stored);
+	J_PROBE1(backend_enter, "backend_compression");
+	ret = backend->object.compression(bytes_compressed, bytes_stored);
+	J_PROBE1(backend_leave, "backend_compression");
+	j_trace_leave("backend_compression");
+
+	return ret;
+}
+
+/**
+ * Returns the extents of a range that contain data.
+ * Backends that can not detect holes report the part of the range within the object as a single extent.
+ */
+gboolean
+j_backend_object_extents (JBackend* backend, gpointer data, guint64 length, guint64 offset, guint64* lengths, guint64* offsets, guint max_count, guint* count)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(lengths != NULL, FALSE);
+	g_return_val_if_fail(offsets != NULL, FALSE);
+	g_return_val_if_fail(count != NULL, FALSE);
+
+	*count = 0;
+
+	if (backend->object.extents == NULL)
+	{
+		guint64 size;
+
+		if (!j_backend_object_status(backend, data, NULL, &size))
+		{
+			return FALSE;
+		}
+
+		if (max_count > 0 && offset < size && length > 0)
+		{
+			lengths[0] = MIN(length, size - offset);
+			offsets[0] = offset;
+			*count = 1;
+		}
+
+		return TRUE;
+	}
+
+	j_trace_enter("backend_extents", "%p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT ", %u", data, length, offset, max_count);
+	J_PROBE1(backend_enter, "backend_extents");
+	ret = backend->object.extents(data, length, offset, lengths, offsets, max_count, count);
+	J_PROBE1(backend_leave, "backend_extents");
+	j_trace_leave("backend_extents");
+
+	return ret;
+}
+
+/**
+ * Starts reading a range into memory or a faster tier.
+ * Prefetching is only a hint, so backends that do not support it succeed without doing anything.
+ */
+gboolean
+j_backend_object_prefetch (JBackend* backend, gpointer data, guint64 length, guint64 offset)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_OBJECT, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	if (backend->object.prefetch == NULL)
+	{
+		return TRUE;
+	}
+
+	j_trace_enter("backend_prefetch", "%p, %" G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT, data, length, offset);
+	J_PROBE1(backend_enter, "backend_prefetch");
+	ret = backend->object.prefetch(data, length, offset);
+	J_PROBE1(backend_leave, "backend_prefetch");
+	j_trace_leave("backend_prefetch");
+
+	return ret;
+}
+
 gboolean
 j_backend_kv_init (JBackend* backend, gchar const* path)
 {
@@ -332,7 +740,9 @@ j_backend_kv_init (JBackend* backend, gchar const* path)
 	g_return_val_if_fail(path != NULL, FALSE);
 
 	j_trace_enter("backend_init", "%s", path);
+	J_PROBE1(backend_enter, "backend_init");
 	ret = backend->kv.init(path);
+	J_PROBE1(backend_leave, "backend_init");
 	j_trace_leave("backend_init");
 
 	return ret;
@@ -345,7 +755,9 @@ j_backend_kv_fini (JBackend* backend)
 	g_return_if_fail(backend->type == J_BACKEND_TYPE_KV);
 
 	j_trace_enter("backend_fini", NULL);
+	J_PROBE1(backend_enter, "backend_fini");
 	backend->kv.fini();
+	J_PROBE1(backend_leave, "backend_fini");
 	j_trace_leave("backend_fini");
 }
 
@@ -360,7 +772,9 @@ j_backend_kv_batch_start (JBackend* backend, gchar const* namespace, JSemanticsS
 	g_return_val_if_fail(batch != NULL, FALSE);
 
 	j_trace_enter("backend_batch_start", "%s, %d, %p", namespace, safety, (gpointer)batch);
+	J_PROBE1(backend_enter, "backend_batch_start");
 	ret = backend->kv.batch_start(namespace, safety, batch);
+	J_PROBE1(backend_leave, "backend_batch_start");
 	j_trace_leave("backend_batch_start");
 
 	return ret;
@@ -376,12 +790,52 @@ j_backend_kv_batch_execute (JBackend* backend, gpointer batch)
 	g_return_val_if_fail(batch != NULL, FALSE);
 
 	j_trace_enter("backend_batch_execute", "%p", batch);
+	J_PROBE1(backend_enter, "backend_batch_execute");
 	ret = backend->kv.batch_execute(batch);
+	J_PROBE1(backend_leave, "backend_batch_execute");
 	j_trace_leave("backend_batch_execute");
 
 	return ret;
 }
 
+gboolean
+j_backend_kv_batch_set_unordered (JBackend* backend, gpointer batch)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(backend->kv.batch_set_unordered != NULL, FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
+
+	j_trace_enter("backend_batch_set_unordered", "%p", batch);
+	J_PROBE1(backend_enter, "backend_batch_set_unordered");
+	ret = backend->kv.batch_set_unordered(batch);
+	J_PROBE1(backend_leave, "backend_batch_set_unordered");
+	j_trace_leave("backend_batch_set_unordered");
+
+	return ret;
+}
+
+gboolean
+j_backend_kv_batch_set_sorted (JBackend* backend, gpointer batch)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(backend->kv.batch_set_sorted != NULL, FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
+
+	j_trace_enter("backend_batch_set_sorted", "%p", batch);
+	J_PROBE1(backend_enter, "backend_batch_set_sorted");
+	ret = backend->kv.batch_set_sorted(batch);
+	J_PROBE1(backend_leave, "backend_batch_set_sorted");
+	j_trace_leave("backend_batch_set_sorted");
+
+	return ret;
+}
+
 gboolean
 j_backend_kv_put (JBackend* backend, gpointer batch, gchar const* key, bson_t const* value)
 {
@@ -394,7 +848,9 @@ j_backend_kv_put (JBackend* backend, gpointer batch, gchar const* key, bson_t co
 	g_return_val_if_fail(value != NULL, FALSE);
 
 	j_trace_enter("backend_put", "%p, %s, %p", batch, key, (gconstpointer)value);
+	J_PROBE1(backend_enter, "backend_put");
 	ret = backend->kv.put(batch, key, value);
+	J_PROBE1(backend_leave, "backend_put");
 	j_trace_leave("backend_put");
 
 	return ret;
@@ -411,7 +867,9 @@ j_backend_kv_delete (JBackend* backend, gpointer batch, gchar const* key)
 	g_return_val_if_fail(key != NULL, FALSE);
 
 	j_trace_enter("backend_delete", "%p, %s", batch, key);
+	J_PROBE1(backend_enter, "backend_delete");
 	ret = backend->kv.delete(batch, key);
+	J_PROBE1(backend_leave, "backend_delete");
 	j_trace_leave("backend_delete");
 
 	return ret;
@@ -429,7 +887,9 @@ j_backend_kv_get (JBackend* backend, gchar const* namespace, gchar const* key, b
 	g_return_val_if_fail(value != NULL, FALSE);
 
 	j_trace_enter("backend_get", "%s, %s, %p", namespace, key, (gpointer)value);
+	J_PROBE1(backend_enter, "backend_get");
 	ret = backend->kv.get(namespace, key, value);
+	J_PROBE1(backend_leave, "backend_get");
 	j_trace_leave("backend_get");
 
 	return ret;
@@ -446,7 +906,9 @@ j_backend_kv_get_all (JBackend* backend, gchar const* namespace, gpointer* itera
 	g_return_val_if_fail(iterator != NULL, FALSE);
 
 	j_trace_enter("backend_get_all", "%s, %p", namespace, (gpointer)iterator);
+	J_PROBE1(backend_enter, "backend_get_all");
 	ret = backend->kv.get_all(namespace, iterator);
+	J_PROBE1(backend_leave, "backend_get_all");
 	j_trace_leave("backend_get_all");
 
 	return ret;
@@ -464,28 +926,403 @@ j_backend_kv_get_by_prefix (JBackend* backend, gchar const* namespace, gchar con
 	g_return_val_if_fail(iterator != NULL, FALSE);
 
 	j_trace_enter("backend_get_by_prefix", "%s, %s, %p", namespace, prefix, (gpointer)iterator);
+	J_PROBE1(backend_enter, "backend_get_by_prefix");
 	ret = backend->kv.get_by_prefix(namespace, prefix, iterator);
+	J_PROBE1(backend_leave, "backend_get_by_prefix");
 	j_trace_leave("backend_get_by_prefix");
 
 	return ret;
 }
+
+gboolean
+j_backend_kv_get_range (JBackend* backend, gchar const* namespace, gchar const* prefix, gchar const* start_after, guint32 limit, gpointer* iterator)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(prefix != NULL, FALSE);
+	g_return_val_if_fail(iterator != NULL, FALSE);
+
+	j_trace_enter("backend_get_range", "%s, %s, %s, %" G_GUINT32_FORMAT ", %p", namespace, prefix, start_after, limit, (gpointer)iterator);
+	J_PROBE1(backend_enter, "backend_get_range");
+	ret = backend->kv.get_range(namespace, prefix, start_after, limit, iterator);
+	J_PROBE1(backend_leave, "backend_get_range");
+	j_trace_leave("backend_get_range");
+
+	return ret;
+}
+
 gboolean
-j_backend_kv_iterate (JBackend* backend, gpointer iterator, bson_t* value)
+j_backend_kv_iterate (JBackend* backend, gpointer iterator, gchar const** key, bson_t* value)
 {
 	gboolean ret;
 
 	g_return_val_if_fail(backend != NULL, FALSE);
 	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
 	g_return_val_if_fail(iterator != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
 	g_return_val_if_fail(value != NULL, FALSE);
 
-	j_trace_enter("backend_iterate", "%p, %p", iterator, (gpointer)value);
-	ret = backend->kv.iterate(iterator, value);
+	j_trace_enter("backend_iterate", "%p, %p, %p", iterator, (gpointer)key, (gpointer)value);
+	J_PROBE1(backend_enter, "backend_iterate");
+	ret = backend->kv.iterate(iterator, key, value);
+	J_PROBE1(backend_leave, "backend_iterate");
 	j_trace_leave("backend_iterate");
 
 	return ret;
 }
 
+/**
+ * Returns the version of a value.
+ * Values that have not been stored using compare-and-swap have version 1.
+ *
+ * \private
+ *
+ * \param value A value.
+ *
+ * \return The version.
+ **/
+static
+guint64
+j_backend_kv_get_version (bson_t const* value)
+{
+	bson_iter_t iter;
+
+	if (bson_iter_init_find(&iter, value, J_BACKEND_KV_VERSION) && BSON_ITER_HOLDS_INT64(&iter))
+	{
+		return bson_iter_int64(&iter);
+	}
+
+	return 1;
+}
+
+/**
+ * Stores a value using a single batch.
+ *
+ * \private
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param key       A key.
+ * \param value     A value.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+static
+gboolean
+j_backend_kv_put_single (JBackend* backend, gchar const* namespace, gchar const* key, bson_t const* value)
+{
+	gboolean ret;
+	gpointer batch;
+
+	if (!backend->kv.batch_start(namespace, J_SEMANTICS_SAFETY_NETWORK, &batch))
+	{
+		return FALSE;
+	}
+
+	ret = backend->kv.put(batch, key, value);
+	ret = backend->kv.batch_execute(batch) && ret;
+
+	return ret;
+}
+
+/**
+ * Stores a value if the stored value's version matches.
+ * Backends without native support are emulated using get and put.
+ * The emulation is atomic with respect to other conditional updates in this process, but not to plain puts.
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param key       A key.
+ * \param expected  The expected version, 0 if the key must not exist.
+ * \param value     The new value, stored with version #expected + 1.
+ * \param version   Returns the current version, that is, #expected + 1 on success.
+ *
+ * \return TRUE if the value has been stored, FALSE otherwise.
+ **/
+gboolean
+j_backend_kv_compare_and_swap (JBackend* backend, gchar const* namespace, gchar const* key, guint64 expected, bson_t const* value, guint64* version)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+	g_return_val_if_fail(version != NULL, FALSE);
+
+	j_trace_enter("backend_compare_and_swap", "%s, %s, %" G_GUINT64_FORMAT ", %p, %p", namespace, key, expected, (gconstpointer)value, (gpointer)version);
+	J_PROBE1(backend_enter, "backend_compare_and_swap");
+
+	if (backend->kv.compare_and_swap != NULL)
+	{
+		ret = backend->kv.compare_and_swap(namespace, key, expected, value, version);
+	}
+	else
+	{
+		bson_t current[1];
+		guint64 current_version = 0;
+
+		g_mutex_lock(&j_backend_kv_update_mutex);
+
+		if (backend->kv.get(namespace, key, current))
+		{
+			current_version = j_backend_kv_get_version(current);
+			bson_destroy(current);
+		}
+
+		ret = (current_version == expected);
+
+		if (ret)
+		{
+			bson_t versioned[1];
+
+			bson_init(versioned);
+			bson_copy_to_excluding_noinit(value, versioned, J_BACKEND_KV_VERSION, NULL);
+			bson_append_int64(versioned, J_BACKEND_KV_VERSION, -1, expected + 1);
+
+			ret = j_backend_kv_put_single(backend, namespace, key, versioned);
+
+			if (ret)
+			{
+				current_version = expected + 1;
+			}
+
+			bson_destroy(versioned);
+		}
+
+		g_mutex_unlock(&j_backend_kv_update_mutex);
+
+		*version = current_version;
+	}
+
+	J_PROBE1(backend_leave, "backend_compare_and_swap");
+	j_trace_leave("backend_compare_and_swap");
+
+	return ret;
+}
+
+/**
+ * Adds to an integer field of a value.
+ * Missing values and fields are treated as 0.
+ * Backends without native support are emulated like j_backend_kv_compare_and_swap().
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param key       A key.
+ * \param field     A top-level field.
+ * \param delta     The value to add.
+ * \param result    Returns the field's new value.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+j_backend_kv_increment (JBackend* backend, gchar const* namespace, gchar const* key, gchar const* field, gint64 delta, gint64* result)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(field != NULL, FALSE);
+	g_return_val_if_fail(result != NULL, FALSE);
+
+	j_trace_enter("backend_increment", "%s, %s, %s, %" G_GINT64_FORMAT ", %p", namespace, key, field, delta, (gpointer)result);
+	J_PROBE1(backend_enter, "backend_increment");
+
+	if (backend->kv.increment != NULL)
+	{
+		ret = backend->kv.increment(namespace, key, field, delta, result);
+	}
+	else
+	{
+		bson_t current[1];
+		bson_t updated[1];
+		bson_iter_t iter;
+		gboolean found;
+		gint64 value = 0;
+
+		g_mutex_lock(&j_backend_kv_update_mutex);
+
+		found = backend->kv.get(namespace, key, current);
+		bson_init(updated);
+
+		if (found)
+		{
+			if (bson_iter_init_find(&iter, current, field) && BSON_ITER_HOLDS_NUMBER(&iter))
+			{
+				value = bson_iter_as_int64(&iter);
+			}
+
+			bson_copy_to_excluding_noinit(current, updated, field, NULL);
+			bson_destroy(current);
+		}
+
+		value += delta;
+		bson_append_int64(updated, field, -1, value);
+
+		ret = j_backend_kv_put_single(backend, namespace, key, updated);
+
+		g_mutex_unlock(&j_backend_kv_update_mutex);
+
+		bson_destroy(updated);
+
+		*result = value;
+	}
+
+	J_PROBE1(backend_leave, "backend_increment");
+	j_trace_leave("backend_increment");
+
+	return ret;
+}
+
+/**
+ * Merges maxima into a value, creating it if necessary.
+ * Backends without native support are emulated like j_backend_kv_compare_and_swap().
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param key       A key.
+ * \param maxima    A document of maxima, see j_helper_bson_merge_max().
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+j_backend_kv_max_merge (JBackend* backend, gchar const* namespace, gchar const* key, bson_t const* maxima)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(maxima != NULL, FALSE);
+
+	j_trace_enter("backend_max_merge", "%s, %s, %p", namespace, key, (gconstpointer)maxima);
+	J_PROBE1(backend_enter, "backend_max_merge");
+
+	if (backend->kv.max_merge != NULL)
+	{
+		ret = backend->kv.max_merge(namespace, key, maxima);
+	}
+	else
+	{
+		bson_t current[1];
+		bson_t merged[1];
+
+		g_mutex_lock(&j_backend_kv_update_mutex);
+
+		if (backend->kv.get(namespace, key, current))
+		{
+			j_helper_bson_merge_max(current, maxima, merged);
+			bson_destroy(current);
+		}
+		else
+		{
+			bson_copy_to(maxima, merged);
+		}
+
+		ret = j_backend_kv_put_single(backend, namespace, key, merged);
+
+		g_mutex_unlock(&j_backend_kv_update_mutex);
+
+		bson_destroy(merged);
+	}
+
+	J_PROBE1(backend_leave, "backend_max_merge");
+	j_trace_leave("backend_max_merge");
+
+	return ret;
+}
+
+/**
+ * Puts a value that is stored as opaque bytes.
+ * Raw values are not BSON documents, so they can only be read using j_backend_kv_get_raw().
+ *
+ * \param backend A backend.
+ * \param batch   A batch.
+ * \param key     A key.
+ * \param data    The value's data.
+ * \param len     The value's length.
+ *
+ * \return TRUE on success, FALSE otherwise or if the backend does not support raw values.
+ **/
+gboolean
+j_backend_kv_put_raw (JBackend* backend, gpointer batch, gchar const* key, gconstpointer data, guint32 len)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(batch != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(data != NULL || len == 0, FALSE);
+
+	if (backend->kv.put_raw == NULL)
+	{
+		return FALSE;
+	}
+
+	j_trace_enter("backend_put_raw", "%p, %s, %p, %u", batch, key, data, len);
+	J_PROBE1(backend_enter, "backend_put_raw");
+	ret = backend->kv.put_raw(batch, key, data, len);
+	J_PROBE1(backend_leave, "backend_put_raw");
+	j_trace_leave("backend_put_raw");
+
+	return ret;
+}
+
+/**
+ * Gets a value as opaque bytes.
+ * This works for raw values and BSON documents alike, as both are stored as bytes.
+ *
+ * \param backend   A backend.
+ * \param namespace A namespace.
+ * \param key       A key.
+ * \param value     Returns the value, which should be freed with g_bytes_unref().
+ *
+ * \return TRUE if the value exists, FALSE otherwise.
+ **/
+gboolean
+j_backend_kv_get_raw (JBackend* backend, gchar const* namespace, gchar const* key, GBytes** value)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(backend != NULL, FALSE);
+	g_return_val_if_fail(backend->type == J_BACKEND_TYPE_KV, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+
+	j_trace_enter("backend_get_raw", "%s, %s, %p", namespace, key, (gpointer)value);
+	J_PROBE1(backend_enter, "backend_get_raw");
+
+	if (backend->kv.get_raw != NULL)
+	{
+		ret = backend->kv.get_raw(namespace, key, value);
+	}
+	else
+	{
+		bson_t current[1];
+
+		/* Backends without raw values only store BSON documents. */
+		if ((ret = backend->kv.get(namespace, key, current)))
+		{
+			*value = g_bytes_new(bson_get_data(current), current->len);
+			bson_destroy(current);
+		}
+	}
+
+	J_PROBE1(backend_leave, "backend_get_raw");
+	j_trace_leave("backend_get_raw");
+
+	return ret;
+}
+
 /**
  * @}
  **/
@@ -22,13 +22,23 @@
 
 #include <julea-config.h>
 
+#ifdef HAVE_SCHED_SETAFFINITY
+/* Required for sched_setaffinity() */
+#define _GNU_SOURCE
+#endif
+
 #include <glib.h>
 
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
 #include <unistd.h>
 
 #include <jbackground-operation.h>
 #include <jbackground-operation-internal.h>
 
+#include <jbatch-internal.h>
 #include <jcommon.h>
 #include <jhelper-internal.h>
 #include <jtrace-internal.h>
@@ -38,6 +48,19 @@
  * @{
  **/
 
+/**
+ * Counts the outstanding operations of a group executed by j_background_operation_execute_parallel().
+ **/
+struct JBackgroundOperationLatch
+{
+	guint pending;
+
+	GMutex mutex;
+	GCond cond;
+};
+
+typedef struct JBackgroundOperationLatch JBackgroundOperationLatch;
+
 /**
  * A background operation.
  **/
@@ -73,16 +96,104 @@ struct JBackgroundOperation
 	 */
 	GCond cond[1];
 
+	/**
+	 * The trace ID of the thread that started the operation.
+	 **/
+	guint64 trace_id;
+
+	/**
+	 * The statistics of the thread that started the operation.
+	 **/
+	JStatistics* statistics;
+
+	/**
+	 * The latch to count down on completion, NULL for reference-counted operations.
+	 * Operations with a latch are owned by the waiting thread and only use #func, #data, #result, #trace_id and #statistics.
+	 **/
+	JBackgroundOperationLatch* latch;
+
 	/**
 	 * The reference count.
 	 **/
 	gint ref_count;
 };
 
-static GThreadPool* j_thread_pool = NULL;
+/**
+ * How often threads waiting for a background operation check for queued operations they could help with.
+ **/
+#define J_BACKGROUND_OPERATION_HELP_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
 
 /**
- * Executes background operations.
+ * A worker thread with its own queue of background operations.
+ * Workers take operations from the front of their own queue and steal from the back of other workers' queues.
+ **/
+struct JBackgroundWorker
+{
+	GThread* thread;
+
+	/**
+	 * The queued operations.
+	 **/
+	GQueue queue;
+
+	/**
+	 * The mutex for #queue.
+	 **/
+	GMutex mutex;
+
+	/**
+	 * The worker's index.
+	 **/
+	guint index;
+
+	/**
+	 * Whether to pin the worker to a processor.
+	 **/
+	gboolean pin;
+};
+
+typedef struct JBackgroundWorker JBackgroundWorker;
+
+/**
+ * The workers.
+ **/
+static JBackgroundWorker* j_background_workers = NULL;
+static guint j_background_worker_count = 0;
+
+/**
+ * Whether the workers' threads have been started.
+ * They are only started once the first operation is queued, so processes that never use them do not pay for them.
+ **/
+static gsize j_background_started = 0;
+
+/**
+ * The number of queued operations.
+ **/
+static gint j_background_queued = 0;
+
+/**
+ * Used for distributing operations created by other threads.
+ **/
+static guint j_background_next = 0;
+
+/**
+ * Whether the workers should terminate.
+ **/
+static gboolean j_background_shutdown = FALSE;
+
+/**
+ * The mutex and condition for idle workers.
+ **/
+static GMutex j_background_mutex;
+static GCond j_background_cond;
+
+/**
+ * The current thread's worker, NULL for other threads.
+ **/
+static GPrivate j_background_worker;
+
+/**
+ * Executes a background operation.
  *
  * \private
  *
@@ -91,46 +202,250 @@ static GThreadPool* j_thread_pool = NULL;
  * \code
  * \endcode
  *
- * \param data A background operations.
- * \param user_data User data.
+ * \param background_operation A background operation.
  **/
 static
 void
-j_background_operation_thread (gpointer data, gpointer user_data)
+j_background_operation_run (JBackgroundOperation* background_operation)
 {
-	JBackgroundOperation* background_operation = data;
-
-	(void)user_data;
+	JStatistics* statistics;
+	guint64 trace_id;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	/*
+	 * Messages created by the operation belong to the traced batch that started it.
+	 * Waiting threads also run other operations, so their own trace ID and statistics have to be restored afterwards.
+	 */
+	trace_id = j_batch_get_trace_id();
+	statistics = j_batch_get_current_statistics();
+	j_batch_set_trace_id(background_operation->trace_id);
+	j_batch_set_current_statistics(background_operation->statistics);
 	background_operation->result = (*(background_operation->func))(background_operation->data);
+	j_batch_set_trace_id(trace_id);
+	j_batch_set_current_statistics(statistics);
+
+	if (background_operation->latch != NULL)
+	{
+		JBackgroundOperationLatch* latch = background_operation->latch;
+
+		/* The operation might be freed as soon as the latch reaches zero. */
+		g_mutex_lock(&(latch->mutex));
+
+		latch->pending--;
+
+		if (latch->pending == 0)
+		{
+			g_cond_signal(&(latch->cond));
+		}
+
+		g_mutex_unlock(&(latch->mutex));
+
+		goto end;
+	}
 
 	g_mutex_lock(background_operation->mutex);
 	background_operation->completed = TRUE;
-	g_cond_signal(background_operation->cond);
+	g_cond_broadcast(background_operation->cond);
 	g_mutex_unlock(background_operation->mutex);
 
 	j_background_operation_unref(background_operation);
 
+end:
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Initializes the background operation framework.
+ * Queues a background operation.
+ *
+ * \private
  *
  * \author Michael Kuhn
  *
  * \code
- * j_background_operation_init();
  * \endcode
+ *
+ * \param background_operation A background operation.
  **/
+static
 void
-j_background_operation_init (guint count)
+j_background_operation_push (JBackgroundOperation* background_operation)
+{
+	JBackgroundWorker* worker;
+
+	if (g_once_init_enter(&j_background_started))
+	{
+		for (guint i = 0; i < j_background_worker_count; i++)
+		{
+			j_background_workers[i].thread = g_thread_new("JBackgroundOperation", j_background_operation_thread, &(j_background_workers[i]));
+		}
+
+		g_once_init_leave(&j_background_started, 1);
+	}
+
+	worker = g_private_get(&j_background_worker);
+
+	/* Operations created by workers stay local, others are distributed round-robin. */
+	if (worker == NULL)
+	{
+		worker = &(j_background_workers[(guint)g_atomic_int_add(&j_background_next, 1) % j_background_worker_count]);
+	}
+
+	g_mutex_lock(&(worker->mutex));
+	g_queue_push_head(&(worker->queue), background_operation);
+	g_mutex_unlock(&(worker->mutex));
+
+	g_atomic_int_inc(&j_background_queued);
+
+	g_mutex_lock(&j_background_mutex);
+	g_cond_signal(&j_background_cond);
+	g_mutex_unlock(&j_background_mutex);
+}
+
+/**
+ * Takes a queued background operation.
+ * The worker's own queue is preferred; if it is empty, operations are stolen from other workers.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param worker A worker, NULL if the current thread is not a worker.
+ *
+ * \return A background operation or NULL if none is queued.
+ **/
+static
+JBackgroundOperation*
+j_background_operation_take (JBackgroundWorker* worker)
 {
-	GThreadPool* thread_pool;
+	JBackgroundOperation* background_operation = NULL;
+	guint start;
+
+	if (g_atomic_int_get(&j_background_queued) == 0)
+	{
+		return NULL;
+	}
+
+	if (worker != NULL)
+	{
+		g_mutex_lock(&(worker->mutex));
+		background_operation = g_queue_pop_head(&(worker->queue));
+		g_mutex_unlock(&(worker->mutex));
+	}
+
+	start = (worker != NULL) ? worker->index + 1 : 0;
+
+	for (guint i = 0; i < j_background_worker_count && background_operation == NULL; i++)
+	{
+		JBackgroundWorker* victim = &(j_background_workers[(start + i) % j_background_worker_count]);
 
-	g_return_if_fail(j_thread_pool == NULL);
+		if (victim == worker)
+		{
+			continue;
+		}
+
+		g_mutex_lock(&(victim->mutex));
+		background_operation = g_queue_pop_tail(&(victim->queue));
+		g_mutex_unlock(&(victim->mutex));
+	}
+
+	if (background_operation != NULL)
+	{
+		g_atomic_int_add(&j_background_queued, -1);
+	}
+
+	return background_operation;
+}
+
+/**
+ * Executes background operations.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data A worker.
+ *
+ * \return NULL.
+ **/
+static
+gpointer
+j_background_operation_thread (gpointer data)
+{
+	JBackgroundWorker* worker = data;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_private_set(&j_background_worker, worker);
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	if (worker->pin)
+	{
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(worker->index % g_get_num_processors(), &set);
+
+		sched_setaffinity(0, sizeof(set), &set);
+	}
+#endif
+
+	while (TRUE)
+	{
+		JBackgroundOperation* background_operation;
+
+		background_operation = j_background_operation_take(worker);
+
+		if (background_operation != NULL)
+		{
+			j_background_operation_run(background_operation);
+			continue;
+		}
+
+		g_mutex_lock(&j_background_mutex);
+
+		while (g_atomic_int_get(&j_background_queued) == 0 && !j_background_shutdown)
+		{
+			g_cond_wait(&j_background_cond, &j_background_mutex);
+		}
+
+		/* Queued operations are still executed when shutting down. */
+		if (g_atomic_int_get(&j_background_queued) == 0 && j_background_shutdown)
+		{
+			g_mutex_unlock(&j_background_mutex);
+			break;
+		}
+
+		g_mutex_unlock(&j_background_mutex);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return NULL;
+}
+
+/**
+ * Initializes the background operation framework.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_background_operation_init(0, FALSE);
+ * \endcode
+ *
+ * \param count The number of threads, 0 to use one per processor.
+ * \param pin   Whether to pin the threads to processors.
+ **/
+void
+j_background_operation_init (guint count, gboolean pin)
+{
+	g_return_if_fail(j_background_workers == NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
@@ -139,14 +454,25 @@ j_background_operation_init (guint count)
 		count = g_get_num_processors();
 	}
 
-	thread_pool = g_thread_pool_new(j_background_operation_thread, NULL, count, FALSE, NULL);
-	g_atomic_pointer_set(&j_thread_pool, thread_pool);
+	j_background_shutdown = FALSE;
+	j_background_worker_count = count;
+	j_background_workers = g_new(JBackgroundWorker, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		g_queue_init(&(j_background_workers[i].queue));
+		g_mutex_init(&(j_background_workers[i].mutex));
+		j_background_workers[i].index = i;
+		j_background_workers[i].pin = pin;
+		j_background_workers[i].thread = NULL;
+	}
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
  * Shuts down the background operation framework.
+ * Queued background operations are executed before the threads terminate.
  *
  * \author Michael Kuhn
  *
@@ -157,16 +483,29 @@ j_background_operation_init (guint count)
 void
 j_background_operation_fini (void)
 {
-	GThreadPool* thread_pool;
-
-	g_return_if_fail(j_thread_pool != NULL);
+	g_return_if_fail(j_background_workers != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	thread_pool = g_atomic_pointer_get(&j_thread_pool);
-	g_atomic_pointer_set(&j_thread_pool, NULL);
+	g_mutex_lock(&j_background_mutex);
+	j_background_shutdown = TRUE;
+	g_cond_broadcast(&j_background_cond);
+	g_mutex_unlock(&j_background_mutex);
 
-	g_thread_pool_free(thread_pool, FALSE, TRUE);
+	for (guint i = 0; i < j_background_worker_count; i++)
+	{
+		if (j_background_workers[i].thread != NULL)
+		{
+			g_thread_join(j_background_workers[i].thread);
+		}
+
+		g_mutex_clear(&(j_background_workers[i].mutex));
+	}
+
+	g_free(j_background_workers);
+	j_background_workers = NULL;
+	j_background_worker_count = 0;
+	j_background_started = 0;
 
 	j_trace_leave(G_STRFUNC);
 }
@@ -174,7 +513,7 @@ j_background_operation_fini (void)
 guint
 j_background_operation_get_num_threads (void)
 {
-	return g_thread_pool_get_max_threads(j_thread_pool);
+	return j_background_worker_count;
 }
 
 /**
@@ -214,12 +553,15 @@ j_background_operation_new (JBackgroundOperationFunc func, gpointer data)
 	background_operation->data = data;
 	background_operation->result = NULL;
 	background_operation->completed = FALSE;
+	background_operation->trace_id = j_batch_get_trace_id();
+	background_operation->statistics = j_batch_get_current_statistics();
+	background_operation->latch = NULL;
 	background_operation->ref_count = 2;
 
 	g_mutex_init(background_operation->mutex);
 	g_cond_init(background_operation->cond);
 
-	g_thread_pool_push(j_thread_pool, background_operation, NULL);
+	j_background_operation_push(background_operation);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -289,6 +631,7 @@ j_background_operation_unref (JBackgroundOperation* background_operation)
 
 /**
  * Waits for a background operation to finish.
+ * While waiting, the calling thread helps executing queued background operations.
  *
  * \author Michael Kuhn
  *
@@ -305,15 +648,37 @@ j_background_operation_unref (JBackgroundOperation* background_operation)
 gpointer
 j_background_operation_wait (JBackgroundOperation* background_operation)
 {
+	JBackgroundWorker* worker;
+
 	g_return_val_if_fail(background_operation != NULL, NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	worker = g_private_get(&j_background_worker);
+
 	g_mutex_lock(background_operation->mutex);
 
 	while (!background_operation->completed)
 	{
-		g_cond_wait(background_operation->cond, background_operation->mutex);
+		JBackgroundOperation* other;
+
+		g_mutex_unlock(background_operation->mutex);
+
+		/* Help executing queued operations instead of blocking. */
+		if ((other = j_background_operation_take(worker)) != NULL)
+		{
+			j_background_operation_run(other);
+			g_mutex_lock(background_operation->mutex);
+			continue;
+		}
+
+		g_mutex_lock(background_operation->mutex);
+
+		/* Wake up regularly to check for new operations. */
+		if (!background_operation->completed)
+		{
+			g_cond_wait_until(background_operation->cond, background_operation->mutex, g_get_monotonic_time() + J_BACKGROUND_OPERATION_HELP_INTERVAL);
+		}
 	}
 
 	g_mutex_unlock(background_operation->mutex);
@@ -323,6 +688,134 @@ j_background_operation_wait (JBackgroundOperation* background_operation)
 	return background_operation->result;
 }
 
+/**
+ * Executes a function for several data items in parallel and waits for all of them.
+ * The calling thread executes one of the items itself and helps with queued operations while waiting.
+ * The other items are queued as operations that are counted by a shared latch instead of being reference-counted.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param func   A function.
+ * \param data   The data items, NULL items are skipped. Each item is replaced with #func's return value.
+ * \param length The number of data items.
+ **/
+void
+j_background_operation_execute_parallel (JBackgroundOperationFunc func, gpointer* data, guint length)
+{
+	JBackgroundOperation* operations;
+	JBackgroundOperationLatch latch;
+	JBackgroundWorker* worker;
+	guint count = 0;
+	guint own = length;
+	guint n = 0;
+
+	g_return_if_fail(func != NULL);
+	g_return_if_fail(data != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	for (guint i = 0; i < length; i++)
+	{
+		if (data[i] != NULL)
+		{
+			if (own == length)
+			{
+				own = i;
+			}
+
+			count++;
+		}
+	}
+
+	if (count <= 1)
+	{
+		if (own < length)
+		{
+			data[own] = func(data[own]);
+		}
+
+		goto end;
+	}
+
+	operations = g_new(JBackgroundOperation, count - 1);
+	latch.pending = count - 1;
+	g_mutex_init(&(latch.mutex));
+	g_cond_init(&(latch.cond));
+
+	for (guint i = own + 1; i < length; i++)
+	{
+		if (data[i] == NULL)
+		{
+			continue;
+		}
+
+		operations[n].func = func;
+		operations[n].data = data[i];
+		operations[n].result = NULL;
+		operations[n].trace_id = j_batch_get_trace_id();
+		operations[n].statistics = j_batch_get_current_statistics();
+		operations[n].latch = &latch;
+
+		j_background_operation_push(&(operations[n]));
+		n++;
+	}
+
+	data[own] = func(data[own]);
+
+	worker = g_private_get(&j_background_worker);
+
+	g_mutex_lock(&(latch.mutex));
+
+	while (latch.pending > 0)
+	{
+		JBackgroundOperation* other;
+
+		g_mutex_unlock(&(latch.mutex));
+
+		/* Help executing queued operations instead of blocking. */
+		if ((other = j_background_operation_take(worker)) != NULL)
+		{
+			j_background_operation_run(other);
+			g_mutex_lock(&(latch.mutex));
+			continue;
+		}
+
+		g_mutex_lock(&(latch.mutex));
+
+		/* Wake up regularly to check for new operations. */
+		if (latch.pending > 0)
+		{
+			g_cond_wait_until(&(latch.cond), &(latch.mutex), g_get_monotonic_time() + J_BACKGROUND_OPERATION_HELP_INTERVAL);
+		}
+	}
+
+	g_mutex_unlock(&(latch.mutex));
+
+	g_cond_clear(&(latch.cond));
+	g_mutex_clear(&(latch.mutex));
+
+	n = 0;
+
+	for (guint i = own + 1; i < length; i++)
+	{
+		if (data[i] != NULL)
+		{
+			data[i] = operations[n].result;
+			n++;
+		}
+	}
+
+	g_free(operations);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
 /**
  * @}
  **/
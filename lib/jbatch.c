@@ -23,20 +23,37 @@
 #include <julea-config.h>
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include <jbatch.h>
 #include <jbatch-internal.h>
 
-#include <jbackground-operation.h>
 #include <jcache.h>
 #include <jcommon.h>
+#include <jconfiguration.h>
+#include <jconnection-pool-internal.h>
 #include <jlist.h>
 #include <jlist-iterator.h>
 #include <joperation-cache-internal.h>
 #include <joperation-internal.h>
+#include <jprobe-internal.h>
 #include <jsemantics.h>
+#include <jstatistics.h>
+#include <jstatistics-internal.h>
 #include <jtrace-internal.h>
 
+#include <julea-internal.h>
+
+/**
+ * The size of a batch's arena chunks.
+ **/
+#define J_BATCH_ARENA_CHUNK_SIZE (16 * 1024)
+
+/**
+ * The alignment of memory allocated from a batch's arena.
+ **/
+#define J_BATCH_ARENA_ALIGNMENT (2 * sizeof(gpointer))
+
 /**
  * \defgroup JBatch Batch
  *
@@ -59,9 +76,54 @@ struct JBatch
 	JSemantics* semantics;
 
 	/**
-	 * The background operation used for j_batch_execute_async().
+	 * Whether the batch is being executed by j_batch_execute_async().
+	 * Protected by j_batch_async_mutex.
+	 **/
+	gboolean pending;
+
+	/**
+	 * The maximum execution time in microseconds, 0 if unlimited.
+	 **/
+	guint64 timeout;
+
+	/**
+	 * The user's cancellable, NULL if not set.
+	 **/
+	GCancellable* cancellable;
+
+	/**
+	 * The cancellable of the current execution.
+	 * It is cancelled if the timeout expires or #cancellable is cancelled.
 	 **/
-	JBackgroundOperation* background_operation;
+	GCancellable* execution_cancellable;
+
+	/**
+	 * The statistics to collect into, NULL if not set.
+	 * Not owned by the batch.
+	 **/
+	JStatistics* statistics;
+
+	/**
+	 * The results of the last execution's operations, in the order they have been added.
+	 * Contains #JOperationResult elements.
+	 **/
+	GArray* results;
+
+	/**
+	 * The arena for the operations' payloads, see j_batch_alloc().
+	 * Contains the chunks, the first one is the current one.
+	 **/
+	GSList* arena;
+
+	/**
+	 * The number of used bytes of the current chunk.
+	 **/
+	gsize arena_used;
+
+	/**
+	 * The size of the current chunk.
+	 **/
+	gsize arena_size;
 
 	/**
 	 * The reference count.
@@ -78,13 +140,57 @@ struct JOperationAsync
 
 typedef struct JOperationAsync JOperationAsync;
 
+/**
+ * Protects the batches' pending flags.
+ **/
+static GMutex j_batch_async_mutex;
+
+/**
+ * Signaled whenever an asynchronous batch has finished.
+ **/
+static GCond j_batch_async_cond;
+
+/**
+ * The cancellable of the batch executed by the current thread.
+ **/
+static GPrivate j_batch_current_cancellable;
+
+/**
+ * The trace ID of the batch executed by the current thread.
+ **/
+static GPrivate j_batch_current_trace_id = G_PRIVATE_INIT(g_free);
+
+/**
+ * The statistics of the batch executed by the current thread.
+ **/
+static GPrivate j_batch_current_statistics;
+
+/**
+ * The number of operations the current thread is executing.
+ * Batches executed by operations, for example, to update metadata after writing data, are nested.
+ **/
+static GPrivate j_batch_current_depth;
+
+/**
+ * The number of executed batches, used for sampling them for tracing.
+ **/
+static guint j_batch_trace_count = 0;
+
+/**
+ * Executes asynchronous batches.
+ * A bounded number of threads handles all outstanding batches; further batches are queued.
+ *
+ * \private
+ **/
 static
-gpointer
-j_batch_background_operation (gpointer data)
+void
+j_batch_async_thread (gpointer data, gpointer user_data)
 {
 	JOperationAsync* async = data;
 	gboolean ret;
 
+	(void)user_data;
+
 	j_trace_enter(G_STRFUNC, NULL);
 
 	ret = j_batch_execute(async->batch);
@@ -94,13 +200,31 @@ j_batch_background_operation (gpointer data)
 		(*async->func)(async->batch, ret, async->user_data);
 	}
 
+	g_mutex_lock(&j_batch_async_mutex);
+	async->batch->pending = FALSE;
+	g_cond_broadcast(&j_batch_async_cond);
+	g_mutex_unlock(&j_batch_async_mutex);
+
 	j_batch_unref(async->batch);
 
 	g_slice_free(JOperationAsync, async);
 
 	j_trace_leave(G_STRFUNC);
+}
 
-	return NULL;
+/**
+ * Creates the thread pool for asynchronous batches.
+ * It is separate from the background operations' thread pool, because batches might use background operations and wait for them.
+ *
+ * \private
+ **/
+static
+gpointer
+j_batch_async_thread_pool_new (gpointer data)
+{
+	(void)data;
+
+	return g_thread_pool_new(j_batch_async_thread, NULL, g_get_num_processors(), FALSE, NULL);
 }
 
 /**
@@ -127,7 +251,15 @@ j_batch_new (JSemantics* semantics)
 	batch = g_slice_new(JBatch);
 	batch->list = j_list_new((JListFreeFunc)j_operation_free);
 	batch->semantics = j_semantics_ref(semantics);
-	batch->background_operation = NULL;
+	batch->pending = FALSE;
+	batch->timeout = 0;
+	batch->cancellable = NULL;
+	batch->execution_cancellable = NULL;
+	batch->statistics = NULL;
+	batch->results = g_array_new(FALSE, TRUE, sizeof(JOperationResult));
+	batch->arena = NULL;
+	batch->arena_used = 0;
+	batch->arena_size = 0;
 	batch->ref_count = 1;
 
 	j_trace_leave(G_STRFUNC);
@@ -135,6 +267,76 @@ j_batch_new (JSemantics* semantics)
 	return batch;
 }
 
+/**
+ * Frees the memory allocated from a batch's arena.
+ * The current chunk is kept, so that reused batches do not have to allocate again.
+ *
+ * \private
+ *
+ * \param batch A batch, whose operations have been freed.
+ **/
+static
+void
+j_batch_arena_clear (JBatch* batch)
+{
+	GSList* chunks;
+
+	if (batch->arena == NULL)
+	{
+		return;
+	}
+
+	if (batch->arena_size == J_BATCH_ARENA_CHUNK_SIZE)
+	{
+		chunks = batch->arena->next;
+		batch->arena->next = NULL;
+	}
+	else
+	{
+		chunks = batch->arena;
+		batch->arena = NULL;
+		batch->arena_size = 0;
+	}
+
+	batch->arena_used = 0;
+
+	g_slist_free_full(chunks, g_free);
+}
+
+/**
+ * Moves the memory allocated from a batch's arena to another batch.
+ *
+ * \private
+ *
+ * \param batch     A batch.
+ * \param old_batch The batch whose arena is moved, it is empty afterwards.
+ **/
+static
+void
+j_batch_arena_move (JBatch* batch, JBatch* old_batch)
+{
+	if (old_batch->arena == NULL)
+	{
+		return;
+	}
+
+	if (batch->arena == NULL)
+	{
+		batch->arena = old_batch->arena;
+		batch->arena_used = old_batch->arena_used;
+		batch->arena_size = old_batch->arena_size;
+	}
+	else
+	{
+		/* The current chunk stays the same, the moved chunks are only freed. */
+		batch->arena->next = g_slist_concat(old_batch->arena, batch->arena->next);
+	}
+
+	old_batch->arena = NULL;
+	old_batch->arena_used = 0;
+	old_batch->arena_size = 0;
+}
+
 /**
  * Creates a new batch for a semantics template.
  *
@@ -209,17 +411,20 @@ j_batch_unref (JBatch* batch)
 
 	if (g_atomic_int_dec_and_test(&(batch->ref_count)))
 	{
-		if (batch->background_operation != NULL)
+		if (batch->semantics != NULL)
 		{
-			j_background_operation_unref(batch->background_operation);
+			j_semantics_unref(batch->semantics);
 		}
 
-		if (batch->semantics != NULL)
+		if (batch->cancellable != NULL)
 		{
-			j_semantics_unref(batch->semantics);
+			g_object_unref(batch->cancellable);
 		}
 
+		/* The operations' payloads might have been allocated from the arena. */
 		j_list_unref(batch->list);
+		g_slist_free_full(batch->arena, g_free);
+		g_array_unref(batch->results);
 
 		g_slice_free(JBatch, batch);
 	}
@@ -227,6 +432,208 @@ j_batch_unref (JBatch* batch)
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Operations of concurrently executed batches that are combined into one execution.
+ **/
+struct JBatchCombiner
+{
+	JOperationExecFunc exec_func;
+	gpointer key;
+	JSemantics* semantics;
+
+	/**
+	 * The operations' data of all combined batches.
+	 **/
+	JList* list;
+
+	/**
+	 * The number of threads waiting for the combined execution.
+	 **/
+	guint waiting;
+
+	gboolean done;
+	gboolean ret;
+};
+
+typedef struct JBatchCombiner JBatchCombiner;
+
+/**
+ * Protects the combiners.
+ **/
+static GMutex j_batch_combine_mutex;
+
+/**
+ * Signaled whenever a combined execution has finished.
+ **/
+static GCond j_batch_combine_cond;
+
+/**
+ * The combiners that still accept operations.
+ * Protected by j_batch_combine_mutex.
+ **/
+static GList* j_batch_combiners = NULL;
+
+/**
+ * Checks whether two semantics are equal.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param semantics       A semantics object.
+ * \param other_semantics Another semantics object.
+ *
+ * \return TRUE if the semantics are equal, FALSE otherwise.
+ **/
+static
+gboolean
+j_batch_semantics_equal (JSemantics* semantics, JSemantics* other_semantics)
+{
+	JSemanticsType const types[] = {
+		J_SEMANTICS_ATOMICITY,
+		J_SEMANTICS_CONCURRENCY,
+		J_SEMANTICS_CONSISTENCY,
+		J_SEMANTICS_ORDERING,
+		J_SEMANTICS_PERSISTENCY,
+		J_SEMANTICS_SAFETY,
+		J_SEMANTICS_SECURITY
+	};
+
+	if (semantics == other_semantics)
+	{
+		return TRUE;
+	}
+
+	for (guint i = 0; i < G_N_ELEMENTS(types); i++)
+	{
+		if (j_semantics_get(semantics, types[i]) != j_semantics_get(other_semantics, types[i]))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Executes operations together with compatible operations of other threads.
+ * The first thread waits for the combine window and then executes all operations collected in the meantime.
+ * Operations are compatible if they have the same type and key and their batches have equal semantics.
+ * All combined batches get the result of the combined execution.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch     A batch.
+ * \param exec_func The operations' exec function.
+ * \param key       The operations' key.
+ * \param list      The operations' data, which is empty afterwards.
+ * \param window    The combine window in microseconds.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_batch_combine (JBatch* batch, JOperationExecFunc exec_func, gpointer key, JList* list, guint64 window)
+{
+	JBatchCombiner* combiner = NULL;
+	gboolean ret;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&j_batch_combine_mutex);
+
+	for (GList* l = j_batch_combiners; l != NULL; l = l->next)
+	{
+		JBatchCombiner* other = l->data;
+
+		if (other->exec_func == exec_func && other->key == key && j_batch_semantics_equal(other->semantics, batch->semantics))
+		{
+			combiner = other;
+			break;
+		}
+	}
+
+	if (combiner != NULL)
+	{
+		j_list_move_all(combiner->list, list);
+		combiner->waiting++;
+
+		while (!combiner->done)
+		{
+			g_cond_wait(&j_batch_combine_cond, &j_batch_combine_mutex);
+		}
+
+		ret = combiner->ret;
+		combiner->waiting--;
+
+		if (combiner->waiting == 0)
+		{
+			j_list_unref(combiner->list);
+			j_semantics_unref(combiner->semantics);
+			g_slice_free(JBatchCombiner, combiner);
+		}
+
+		g_mutex_unlock(&j_batch_combine_mutex);
+
+		goto end;
+	}
+
+	combiner = g_slice_new(JBatchCombiner);
+	combiner->exec_func = exec_func;
+	combiner->key = key;
+	combiner->semantics = j_semantics_ref(batch->semantics);
+	combiner->list = j_list_new(NULL);
+	combiner->waiting = 1;
+	combiner->done = FALSE;
+	combiner->ret = FALSE;
+
+	j_list_move_all(combiner->list, list);
+	j_batch_combiners = g_list_prepend(j_batch_combiners, combiner);
+
+	g_mutex_unlock(&j_batch_combine_mutex);
+
+	g_usleep(window);
+
+	g_mutex_lock(&j_batch_combine_mutex);
+	j_batch_combiners = g_list_remove(j_batch_combiners, combiner);
+	g_mutex_unlock(&j_batch_combine_mutex);
+
+	/* No other thread can add operations anymore. */
+	ret = exec_func(combiner->list, combiner->semantics);
+
+	g_mutex_lock(&j_batch_combine_mutex);
+
+	combiner->ret = ret;
+	combiner->done = TRUE;
+	combiner->waiting--;
+
+	if (combiner->waiting == 0)
+	{
+		j_list_unref(combiner->list);
+		j_semantics_unref(combiner->semantics);
+		g_slice_free(JBatchCombiner, combiner);
+	}
+	else
+	{
+		g_cond_broadcast(&j_batch_combine_cond);
+	}
+
+	g_mutex_unlock(&j_batch_combine_mutex);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
 /**
  * Executes the batch parts of a given batch type.
  *
@@ -238,13 +645,16 @@ j_batch_unref (JBatch* batch)
  * \endcode
  *
  * \param type An operation type.
+ * \param key  The operations' key.
  * \param list A list of batch parts.
  **/
 static
 gboolean
-j_batch_execute_same (JBatch* batch, JOperationExecFunc exec_func, JList* list)
+j_batch_execute_same (JBatch* batch, JOperationExecFunc exec_func, gpointer key, JList* list)
 {
 	JOperation* operation;
+	guint64 combine_window;
+	guint depth;
 	gboolean ret = FALSE;
 
 	j_trace_enter(G_STRFUNC, NULL);
@@ -256,11 +666,36 @@ j_batch_execute_same (JBatch* batch, JOperationExecFunc exec_func, JList* list)
 		goto end;
 	}
 
-	if (exec_func != NULL)
+	/* Cancelled batches do not start executing further operations. */
+	if (batch->execution_cancellable != NULL && g_cancellable_is_cancelled(batch->execution_cancellable))
+	{
+		exec_func = NULL;
+	}
+
+	/* Waiting for other batches would not respect the timeout and cancellation. */
+	combine_window = (batch->execution_cancellable == NULL) ? j_configuration_get_combine_window(j_configuration()) : 0;
+
+	depth = GPOINTER_TO_UINT(g_private_get(&j_batch_current_depth));
+	g_private_set(&j_batch_current_depth, GUINT_TO_POINTER(depth + 1));
+
+	if (exec_func != NULL && combine_window > 0)
+	{
+		ret = j_batch_combine(batch, exec_func, key, list, combine_window);
+	}
+	else if (exec_func != NULL)
 	{
+		gpointer cancellable;
+
+		cancellable = g_private_get(&j_batch_current_cancellable);
+		g_private_set(&j_batch_current_cancellable, batch->execution_cancellable);
+
 		ret = exec_func(list, batch->semantics);
+
+		g_private_set(&j_batch_current_cancellable, cancellable);
 	}
 
+	g_private_set(&j_batch_current_depth, GUINT_TO_POINTER(depth));
+
 	j_list_delete_all(list);
 
 end:
@@ -290,75 +725,251 @@ j_batch_execute (JBatch* batch)
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	J_PROBE2(batch_execute_begin, batch, j_list_length(batch->list));
+
+	/* Operations succeed unless their group fails, cached ones are reported as successful. */
+	g_array_set_size(batch->results, 0);
+	g_array_set_size(batch->results, j_list_length(batch->list));
+
 	if (j_list_length(batch->list) == 0)
 	{
 		ret = FALSE;
 		goto end;
 	}
 
-	if (j_semantics_get(batch->semantics, J_SEMANTICS_PERSISTENCY) == J_SEMANTICS_PERSISTENCY_EVENTUAL
-	    && j_operation_cache_add(batch))
+	/* Nested batches must neither be cached nor wait for the cache, which might be executing the operation that nests them. */
+	if (g_private_get(&j_batch_current_depth) == NULL)
 	{
-		ret = TRUE;
-		goto end;
-	}
+		if (j_semantics_get(batch->semantics, J_SEMANTICS_PERSISTENCY) == J_SEMANTICS_PERSISTENCY_EVENTUAL
+		    && j_operation_cache_add(batch))
+		{
+			ret = TRUE;
+			goto end;
+		}
 
-	j_operation_cache_flush();
+		j_operation_cache_flush();
+	}
 
 	ret = j_batch_execute_internal(batch);
 	j_list_delete_all(batch->list);
+	j_batch_arena_clear(batch);
 
 end:
+	J_PROBE2(batch_execute_end, batch, ret);
+
 	j_trace_leave(G_STRFUNC);
 
 	return ret;
 }
 
 /**
- * Executes the batch asynchronously.
+ * Returns the result of one of the operations of the batch's last execution.
+ * Operations are numbered in the order they have been added, starting at 0.
+ * Operations that are executed together share their result.
+ * If the batch is cancelled or times out, operations that have not finished are reported as cancelled or timed out.
  *
  * \author Michael Kuhn
  *
  * \code
+ * if (!j_batch_execute(batch) && j_batch_get_result(batch, 0) == J_OPERATION_RESULT_TIMED_OUT)
+ * {
+ *   ...
+ * }
  * \endcode
  *
- * \param batch     A batch.
- * \param func      A complete function.
+ * \param batch A batch.
+ * \param index An operation's position.
  *
- * \return TRUE on success, FALSE if an error occurred.
+ * \return The operation's result.
  **/
-void
-j_batch_execute_async (JBatch* batch, JOperationCompletedFunc func, gpointer user_data)
+JOperationResult
+j_batch_get_result (JBatch* batch, guint index)
 {
-	JOperationAsync* async;
-
-	g_return_if_fail(batch != NULL);
-	g_return_if_fail(batch->background_operation == NULL);
+	g_return_val_if_fail(batch != NULL, J_OPERATION_RESULT_FAILED);
+	g_return_val_if_fail(index < batch->results->len, J_OPERATION_RESULT_FAILED);
 
-	j_trace_enter(G_STRFUNC, NULL);
+	return g_array_index(batch->results, JOperationResult, index);
+}
 
-	async = g_slice_new(JOperationAsync);
-	async->batch = j_batch_ref(batch);
-	async->func = func;
+/**
+ * Executes the batch asynchronously.
+ * Many batches can be outstanding at the same time; they are executed by a bounded number of threads.
+ * Their completion can be checked using j_batch_test(), j_batch_wait() and j_batch_wait_any().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch     A batch.
+ * \param func      A complete function, called from another thread.
+ * \param user_data User data given to #func.
+ **/
+void
+j_batch_execute_async (JBatch* batch, JOperationCompletedFunc func, gpointer user_data)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	JOperationAsync* async;
+	GThreadPool* thread_pool;
+
+	g_return_if_fail(batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	thread_pool = g_once(&once, j_batch_async_thread_pool_new, NULL);
+
+	g_mutex_lock(&j_batch_async_mutex);
+
+	if (batch->pending)
+	{
+		g_mutex_unlock(&j_batch_async_mutex);
+		J_CRITICAL("%s", "Batch is already being executed.");
+		goto end;
+	}
+
+	batch->pending = TRUE;
+
+	g_mutex_unlock(&j_batch_async_mutex);
+
+	async = g_slice_new(JOperationAsync);
+	async->batch = j_batch_ref(batch);
+	async->func = func;
 	async->user_data = user_data;
 
-	batch->background_operation = j_background_operation_new(j_batch_background_operation, async);
+	g_thread_pool_push(thread_pool, async, NULL);
 
+end:
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Checks whether an asynchronous batch has finished without blocking.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE if the batch has finished or is not being executed asynchronously, FALSE otherwise.
+ **/
+gboolean
+j_batch_test (JBatch* batch)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(batch != NULL, FALSE);
+
+	g_mutex_lock(&j_batch_async_mutex);
+	ret = !batch->pending;
+	g_mutex_unlock(&j_batch_async_mutex);
+
+	return ret;
+}
+
+/**
+ * Waits for an asynchronous batch to finish.
+ * Returns immediately if the batch is not being executed asynchronously.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ **/
 void
 j_batch_wait (JBatch* batch)
 {
 	g_return_if_fail(batch != NULL);
 
-	if (batch->background_operation != NULL)
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&j_batch_async_mutex);
+
+	while (batch->pending)
 	{
-		j_background_operation_wait(batch->background_operation);
-		j_background_operation_unref(batch->background_operation);
-		batch->background_operation = NULL;
+		g_cond_wait(&j_batch_async_cond, &j_batch_async_mutex);
 	}
 
+	g_mutex_unlock(&j_batch_async_mutex);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Waits for any of the given asynchronous batches to finish.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JBatch* batches[2];
+ * guint index;
+ *
+ * j_batch_execute_async(batches[0], NULL, NULL);
+ * j_batch_execute_async(batches[1], NULL, NULL);
+ *
+ * index = j_batch_wait_any(batches, 2);
+ * \endcode
+ *
+ * \param batches An array of batches.
+ * \param count   The number of batches.
+ *
+ * \return The index of a batch that has finished or is not being executed asynchronously.
+ **/
+guint
+j_batch_wait_any (JBatch** batches, guint count)
+{
+	guint ret = 0;
+
+	g_return_val_if_fail(batches != NULL, 0);
+	g_return_val_if_fail(count > 0, 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&j_batch_async_mutex);
+
+	while (TRUE)
+	{
+		for (ret = 0; ret < count; ret++)
+		{
+			if (!batches[ret]->pending)
+			{
+				goto end;
+			}
+		}
+
+		g_cond_wait(&j_batch_async_cond, &j_batch_async_mutex);
+	}
+
+end:
+	g_mutex_unlock(&j_batch_async_mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Waits until all batches with eventual persistency have been executed.
+ * Such batches are cached and executed in the background, so operations that bypass batches, such as iterators, have to wait for them to see their effects.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_batch_execute(batch);
+ * j_batch_wait_cached();
+ * \endcode
+ **/
+void
+j_batch_wait_cached (void)
+{
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_operation_cache_flush();
+
 	j_trace_leave(G_STRFUNC);
 }
 
@@ -390,16 +1001,54 @@ j_batch_new_from_batch (JBatch* old_batch)
 	batch = g_slice_new(JBatch);
 	batch->list = old_batch->list;
 	batch->semantics = j_semantics_ref(old_batch->semantics);
-	batch->background_operation = NULL;
+	batch->pending = FALSE;
+	batch->timeout = old_batch->timeout;
+	batch->cancellable = (old_batch->cancellable != NULL) ? g_object_ref(old_batch->cancellable) : NULL;
+	batch->execution_cancellable = NULL;
+	/* Cached batches are executed later, when the statistics might not exist anymore. */
+	batch->statistics = NULL;
+	batch->results = g_array_new(FALSE, TRUE, sizeof(JOperationResult));
+	batch->arena = NULL;
+	batch->arena_used = 0;
+	batch->arena_size = 0;
 	batch->ref_count = 1;
 
 	old_batch->list = j_list_new((JListFreeFunc)j_operation_free);
+	j_batch_arena_move(batch, old_batch);
 
 	j_trace_leave(G_STRFUNC);
 
 	return batch;
 }
 
+/**
+ * Moves all operations of a batch to another batch.
+ * Their payloads stay valid, because the memory allocated from the batch's arena is moved, too.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch     A batch.
+ * \param old_batch The batch whose operations are moved.
+ **/
+void
+j_batch_move_operations (JBatch* batch, JBatch* old_batch)
+{
+	g_return_if_fail(batch != NULL);
+	g_return_if_fail(old_batch != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_list_move_all(batch->list, old_batch->list);
+	j_batch_arena_move(batch, old_batch);
+
+	j_trace_leave(G_STRFUNC);
+}
+
 /**
  * Returns a batch's parts.
  *
@@ -456,6 +1105,108 @@ j_batch_get_semantics (JBatch* batch)
 	return ret;
 }
 
+/**
+ * Sets the batch's timeout.
+ * If the batch's execution takes longer, outstanding network operations are interrupted and remaining operations are not executed.
+ * Operations that have already been sent might still be executed by the servers.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_batch_set_timeout(batch, G_TIME_SPAN_SECOND);
+ * \endcode
+ *
+ * \param batch   A batch.
+ * \param timeout The timeout in microseconds, 0 if unlimited.
+ **/
+void
+j_batch_set_timeout (JBatch* batch, guint64 timeout)
+{
+	g_return_if_fail(batch != NULL);
+
+	batch->timeout = timeout;
+}
+
+/**
+ * Sets the batch's cancellable.
+ * Cancelling it interrupts the batch's execution like an expired timeout.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch       A batch.
+ * \param cancellable A cancellable, or NULL.
+ **/
+void
+j_batch_set_cancellable (JBatch* batch, GCancellable* cancellable)
+{
+	g_return_if_fail(batch != NULL);
+
+	if (cancellable != NULL)
+	{
+		g_object_ref(cancellable);
+	}
+
+	if (batch->cancellable != NULL)
+	{
+		g_object_unref(batch->cancellable);
+	}
+
+	batch->cancellable = cancellable;
+}
+
+/**
+ * Sets the batch's statistics.
+ * While the batch is executed, the number of messages and bytes, the contacted servers as well as the time spent waiting for connections and on the network are added to it.
+ * The statistics is not owned by the batch and has to exist until the batch's execution has finished.
+ * Batches that are cached due to eventual persistency are not accounted.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * g_autoptr(JBatch) batch = NULL;
+ * JStatistics* statistics;
+ *
+ * statistics = j_statistics_new(FALSE);
+ * j_batch_set_statistics(batch, statistics);
+ * j_batch_execute(batch);
+ * g_print("%" G_GUINT64_FORMAT " messages\n", j_statistics_get(statistics, J_STATISTICS_MESSAGES_SENT));
+ * j_statistics_free(statistics);
+ * \endcode
+ *
+ * \param batch      A batch.
+ * \param statistics A statistics, or NULL.
+ **/
+void
+j_batch_set_statistics (JBatch* batch, JStatistics* statistics)
+{
+	g_return_if_fail(batch != NULL);
+
+	batch->statistics = statistics;
+}
+
+/**
+ * Returns the batch's statistics.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return The statistics, NULL if not set.
+ **/
+JStatistics*
+j_batch_get_statistics (JBatch* batch)
+{
+	g_return_val_if_fail(batch != NULL, NULL);
+
+	return batch->statistics;
+}
+
 /**
  * Adds a new operation to the batch.
  *
@@ -483,71 +1234,855 @@ j_batch_add (JBatch* batch, JOperation* operation)
 }
 
 /**
- * Executes the batch.
- *
- * \private
+ * Allocates memory for the payload of an operation of the batch.
+ * The memory is taken from an arena, so that adding many operations does not allocate for each one.
+ * It is freed all at once after the batch's operations have been executed and freed, so operations must not free it themselves.
  *
  * \author Michael Kuhn
  *
  * \code
+ * iop = j_batch_alloc(batch, sizeof(JObjectOperation));
  * \endcode
  *
  * \param batch A batch.
+ * \param size  A size.
  *
- * \return TRUE on success, FALSE if an error occurred.
+ * \return Uninitialized memory, which must only be used by operations added to #batch.
  **/
-gboolean
-j_batch_execute_internal (JBatch* batch)
+gpointer
+j_batch_alloc (JBatch* batch, gsize size)
 {
-	g_autoptr(JList) same_list = NULL;
-	g_autoptr(JListIterator) iterator = NULL;
-	JOperationExecFunc last_exec_func;
-	gpointer last_key;
-	gboolean ret = TRUE;
+	gpointer ret;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	g_return_val_if_fail(batch != NULL, NULL);
 
-	iterator = j_list_iterator_new(batch->list);
-	same_list = j_list_new(NULL);
-	last_key = NULL;
-	last_exec_func = NULL;
+	size = (size + J_BATCH_ARENA_ALIGNMENT - 1) & ~(J_BATCH_ARENA_ALIGNMENT - 1);
 
-	if (j_semantics_get(batch->semantics, J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_RELAXED)
+	if (size > J_BATCH_ARENA_CHUNK_SIZE / 4)
 	{
-		/* FIXME: perform some optimizations */
-		/**
-		 * It is important to consider dependencies:
-		 * - Operations have to be performed before their dependent ones.
-		 *   For example, a collection has to be created before items in it can be created.
-		 */
+		/* Large payloads get a chunk of their own, behind the current one. */
+		ret = g_malloc(size);
+
+		if (batch->arena == NULL)
+		{
+			batch->arena = g_slist_prepend(NULL, ret);
+			batch->arena_used = size;
+			batch->arena_size = size;
+		}
+		else
+		{
+			batch->arena->next = g_slist_prepend(batch->arena->next, ret);
+		}
+
+		return ret;
 	}
 
-	/**
-	 * Try to combine as many operations of the same type as possible.
-	 * These are temporarily stored in same_list.
-	 */
-	while (j_list_iterator_next(iterator))
+	if (batch->arena == NULL || batch->arena_used + size > batch->arena_size)
 	{
-		JOperation* operation = j_list_iterator_get(iterator);
+		batch->arena = g_slist_prepend(batch->arena, g_malloc(J_BATCH_ARENA_CHUNK_SIZE));
+		batch->arena_used = 0;
+		batch->arena_size = J_BATCH_ARENA_CHUNK_SIZE;
+	}
 
-		/* We only combine operations with the same type and the same key. */
-		if ((operation->exec_func != last_exec_func || operation->key != last_key) && last_exec_func != NULL)
+	ret = (gchar*)batch->arena->data + batch->arena_used;
+	batch->arena_used += size;
+
+	return ret;
+}
+
+/**
+ * Records the result of one of the batch's operations.
+ * Failures are attributed to the cancellation or the timeout if the execution has been cancelled.
+ *
+ * \private
+ *
+ * \param batch A batch.
+ * \param index The operation's position within the batch.
+ * \param ret   The result of the operation's group.
+ **/
+static
+void
+j_batch_set_result (JBatch* batch, guint index, gboolean ret)
+{
+	JOperationResult result = J_OPERATION_RESULT_SUCCESS;
+
+	if (!ret)
+	{
+		result = J_OPERATION_RESULT_FAILED;
+
+		if (batch->execution_cancellable != NULL && g_cancellable_is_cancelled(batch->execution_cancellable))
 		{
-			ret = j_batch_execute_same(batch, last_exec_func, same_list) && ret;
+			/* The execution's cancellable is cancelled by the user's or by the timeout. */
+			result = (batch->cancellable != NULL && g_cancellable_is_cancelled(batch->cancellable)) ? J_OPERATION_RESULT_CANCELLED : J_OPERATION_RESULT_TIMED_OUT;
 		}
-
-		last_key = operation->key;
-		last_exec_func = operation->exec_func;
-		j_list_append(same_list, operation->data);
 	}
 
-	ret = j_batch_execute_same(batch, last_exec_func, same_list) && ret;
+	g_array_index(batch->results, JOperationResult, index) = result;
+}
 
-	j_trace_leave(G_STRFUNC);
+/**
+ * A group of operations of the same type and with the same key that are executed together.
+ **/
+struct JBatchGroup
+{
+	JBatch* batch;
+	JOperationExecFunc exec_func;
+	gpointer key;
+
+	/**
+	 * The operations' data.
+	 **/
+	JList* list;
+
+	/**
+	 * The operations' positions within the batch.
+	 **/
+	GArray* indices;
+
+	/**
+	 * The groups with a lower wave have to be executed first.
+	 **/
+	guint wave;
+
+	gboolean ret;
+
+	/**
+	 * The wave's completion state.
+	 **/
+	struct JBatchWave* wave_state;
+};
+
+typedef struct JBatchGroup JBatchGroup;
+
+/**
+ * The groups of one wave that are being executed concurrently.
+ **/
+struct JBatchWave
+{
+	guint pending;
+
+	GMutex mutex;
+	GCond cond;
+};
+
+typedef struct JBatchWave JBatchWave;
+
+static
+void
+j_batch_group_free (gpointer data)
+{
+	JBatchGroup* group = data;
+
+	j_list_unref(group->list);
+	g_array_unref(group->indices);
+	g_slice_free(JBatchGroup, group);
+}
+
+static
+void
+j_batch_group_thread (gpointer data, gpointer user_data)
+{
+	JBatchGroup* group = data;
+	JBatchWave* wave = group->wave_state;
+
+	(void)user_data;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	group->ret = j_batch_execute_same(group->batch, group->exec_func, group->key, group->list);
+
+	g_mutex_lock(&(wave->mutex));
+
+	wave->pending--;
+
+	if (wave->pending == 0)
+	{
+		g_cond_signal(&(wave->cond));
+	}
+
+	g_mutex_unlock(&(wave->mutex));
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Creates the thread pool for executing groups concurrently.
+ * It is separate from the background operations' thread pool, because the groups' exec functions might use background operations and wait for them.
+ *
+ * \private
+ **/
+static
+gpointer
+j_batch_thread_pool_new (gpointer data)
+{
+	(void)data;
+
+	return g_thread_pool_new(j_batch_group_thread, NULL, g_get_num_processors(), FALSE, NULL);
+}
+
+/**
+ * Executes groups of operations concurrently.
+ * The first group is executed by the calling thread.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param groups A list of groups.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_batch_execute_wave (GPtrArray* groups)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	GThreadPool* thread_pool;
+	JBatchGroup* first;
+	JBatchWave wave;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(groups->len > 0, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	thread_pool = g_once(&once, j_batch_thread_pool_new, NULL);
+
+	wave.pending = groups->len - 1;
+	g_mutex_init(&(wave.mutex));
+	g_cond_init(&(wave.cond));
+
+	for (guint i = 1; i < groups->len; i++)
+	{
+		JBatchGroup* group = g_ptr_array_index(groups, i);
+
+		group->wave_state = &wave;
+		g_thread_pool_push(thread_pool, group, NULL);
+	}
+
+	first = g_ptr_array_index(groups, 0);
+	first->ret = j_batch_execute_same(first->batch, first->exec_func, first->key, first->list);
+
+	g_mutex_lock(&(wave.mutex));
+
+	while (wave.pending > 0)
+	{
+		g_cond_wait(&(wave.cond), &(wave.mutex));
+	}
+
+	g_mutex_unlock(&(wave.mutex));
+
+	g_cond_clear(&(wave.cond));
+	g_mutex_clear(&(wave.mutex));
+
+	for (guint i = 0; i < groups->len; i++)
+	{
+		JBatchGroup* group = g_ptr_array_index(groups, i);
+
+		ret = group->ret && ret;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Executes a batch with relaxed ordering semantics.
+ *
+ * Operations of the same type and with the same key are combined into groups, even if they are not adjacent.
+ * Operations with the same key stay in their original order relative to each other:
+ * An operation is only moved forward to join an earlier group if no operation of another type with the same key lies between them.
+ * For example, writes to an object can not overtake the object's creation.
+ *
+ * Operations with different keys are considered independent.
+ * Each key's groups form a chain and the groups are executed in waves, the n-th wave containing the n-th group of every chain.
+ * The groups within a wave are executed concurrently, so that, for example, metadata and data operations overlap.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_batch_execute_relaxed (JBatch* batch)
+{
+	g_autoptr(GHashTable) last_groups = NULL;
+	g_autoptr(GPtrArray) groups = NULL;
+	g_autoptr(JListIterator) iterator = NULL;
+	guint wave_count = 0;
+	guint index = 0;
+	gboolean ret = TRUE;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Maps keys to their last group. */
+	last_groups = g_hash_table_new(NULL, NULL);
+	groups = g_ptr_array_new_with_free_func(j_batch_group_free);
+	iterator = j_list_iterator_new(batch->list);
+
+	while (j_list_iterator_next(iterator))
+	{
+		JOperation* operation = j_list_iterator_get(iterator);
+		JBatchGroup* last_group;
+		JBatchGroup* group;
+
+		last_group = g_hash_table_lookup(last_groups, operation->key);
+		group = last_group;
+
+		if (group == NULL || group->exec_func != operation->exec_func)
+		{
+			group = g_slice_new(JBatchGroup);
+			group->batch = batch;
+			group->exec_func = operation->exec_func;
+			group->key = operation->key;
+			group->list = j_list_new(NULL);
+			group->indices = g_array_new(FALSE, FALSE, sizeof(guint));
+			group->wave = (last_group != NULL) ? last_group->wave + 1 : 0;
+			group->ret = TRUE;
+			group->wave_state = NULL;
+
+			wave_count = MAX(wave_count, group->wave + 1);
+
+			g_ptr_array_add(groups, group);
+			g_hash_table_insert(last_groups, operation->key, group);
+		}
+
+		j_list_append(group->list, operation->data);
+		g_array_append_val(group->indices, index);
+		index++;
+	}
+
+	for (guint wave = 0; wave < wave_count; wave++)
+	{
+		g_autoptr(GPtrArray) wave_groups = NULL;
+
+		wave_groups = g_ptr_array_new();
+
+		for (guint i = 0; i < groups->len; i++)
+		{
+			JBatchGroup* group = g_ptr_array_index(groups, i);
+
+			if (group->wave == wave)
+			{
+				g_ptr_array_add(wave_groups, group);
+			}
+		}
+
+		ret = j_batch_execute_wave(wave_groups) && ret;
+
+		for (guint i = 0; i < wave_groups->len; i++)
+		{
+			JBatchGroup* group = g_ptr_array_index(wave_groups, i);
+
+			for (guint j = 0; j < group->indices->len; j++)
+			{
+				j_batch_set_result(batch, g_array_index(group->indices, guint, j), group->ret);
+			}
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Executes the batch's operations.
+ * If the batch's ordering semantics are relaxed, operations are reordered to combine as many of them as possible and independent ones are executed concurrently.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_batch_execute_operations (JBatch* batch)
+{
+	g_autoptr(JList) same_list = NULL;
+	g_autoptr(JListIterator) iterator = NULL;
+	JOperationExecFunc last_exec_func;
+	gpointer last_key;
+	guint first = 0;
+	guint index = 0;
+	gboolean ret = TRUE;
+
+	if (j_semantics_get(batch->semantics, J_SEMANTICS_ORDERING) == J_SEMANTICS_ORDERING_RELAXED)
+	{
+		return j_batch_execute_relaxed(batch);
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	iterator = j_list_iterator_new(batch->list);
+	same_list = j_list_new(NULL);
+	last_key = NULL;
+	last_exec_func = NULL;
+
+	/* Consecutive groups' messages for the same server are sent as compound messages. */
+	j_connection_pool_compound_begin();
+
+	/**
+	 * Try to combine as many operations of the same type as possible.
+	 * These are temporarily stored in same_list.
+	 */
+	while (j_list_iterator_next(iterator))
+	{
+		JOperation* operation = j_list_iterator_get(iterator);
+
+		/* We only combine operations with the same type and the same key. */
+		if ((operation->exec_func != last_exec_func || operation->key != last_key) && last_exec_func != NULL)
+		{
+			gboolean same_ret;
+
+			same_ret = j_batch_execute_same(batch, last_exec_func, last_key, same_list);
+			ret = same_ret && ret;
+
+			for (; first < index; first++)
+			{
+				j_batch_set_result(batch, first, same_ret);
+			}
+		}
+
+		last_key = operation->key;
+		last_exec_func = operation->exec_func;
+		j_list_append(same_list, operation->data);
+		index++;
+	}
+
+	{
+		gboolean same_ret;
+
+		same_ret = j_batch_execute_same(batch, last_exec_func, last_key, same_list);
+		ret = same_ret && ret;
+
+		for (; first < index; first++)
+		{
+			j_batch_set_result(batch, first, same_ret);
+		}
+	}
+
+	j_connection_pool_compound_end();
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Runs the timer thread's main loop.
+ *
+ * \private
+ **/
+static
+gpointer
+j_batch_timer_thread (gpointer data)
+{
+	GMainContext* context = data;
+	GMainLoop* main_loop;
+
+	g_main_context_push_thread_default(context);
+
+	main_loop = g_main_loop_new(context, FALSE);
+	g_main_loop_run(main_loop);
+
+	return NULL;
+}
+
+/**
+ * Creates the main context used for batch timeouts.
+ * Its thread is never stopped, since timeouts can be registered at any time.
+ *
+ * \private
+ **/
+static
+gpointer
+j_batch_timer_context_new (gpointer data)
+{
+	GMainContext* context;
+
+	(void)data;
+
+	context = g_main_context_new();
+	g_thread_unref(g_thread_new("j_batch_timer", j_batch_timer_thread, context));
+
+	return context;
+}
+
+static
+gboolean
+j_batch_timeout (gpointer data)
+{
+	GCancellable* cancellable = data;
+
+	g_cancellable_cancel(cancellable);
+
+	return G_SOURCE_REMOVE;
+}
+
+static
+void
+j_batch_cancelled (GCancellable* cancellable, gpointer data)
+{
+	GCancellable* execution_cancellable = data;
+
+	(void)cancellable;
+
+	g_cancellable_cancel(execution_cancellable);
+}
+
+/**
+ * Chooses whether to trace a batch, according to the configured sample rate.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return A new trace ID, 0 if the batch should not be traced.
+ **/
+static
+guint64
+j_batch_trace_sample (void)
+{
+	guint32 sample;
+	guint64 trace_id;
+
+	sample = j_configuration_get_trace_sample(j_configuration());
+
+	if (sample == 0 || (guint)g_atomic_int_add(&j_batch_trace_count, 1) % sample != 0)
+	{
+		return 0;
+	}
+
+	do
+	{
+		trace_id = ((guint64)g_random_int() << 32) | g_random_int();
+	}
+	while (trace_id == 0);
+
+	return trace_id;
+}
+
+/**
+ * Executes the batch.
+ * If a timeout or a cancellable has been set, the batch is executed with its own cancellable, which is used for all network operations.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_batch_execute_cancellable (JBatch* batch)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	GCancellable* cancellable;
+	GSource* timeout_source = NULL;
+	gulong handler = 0;
+	gboolean ret;
+
+	if (batch->timeout == 0 && batch->cancellable == NULL)
+	{
+		return j_batch_execute_operations(batch);
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	cancellable = g_cancellable_new();
+
+	if (batch->cancellable != NULL)
+	{
+		handler = g_cancellable_connect(batch->cancellable, G_CALLBACK(j_batch_cancelled), cancellable, NULL);
+	}
+
+	if (batch->timeout > 0)
+	{
+		GMainContext* context;
+
+		context = g_once(&once, j_batch_timer_context_new, NULL);
+
+		/* Round up, so that the timeout does not expire too early. */
+		timeout_source = g_timeout_source_new((batch->timeout + G_TIME_SPAN_MILLISECOND - 1) / G_TIME_SPAN_MILLISECOND);
+		g_source_set_callback(timeout_source, j_batch_timeout, g_object_ref(cancellable), g_object_unref);
+		g_source_attach(timeout_source, context);
+	}
+
+	batch->execution_cancellable = cancellable;
+
+	ret = j_batch_execute_operations(batch);
+	ret = ret && !g_cancellable_is_cancelled(cancellable);
+
+	batch->execution_cancellable = NULL;
+
+	if (timeout_source != NULL)
+	{
+		g_source_destroy(timeout_source);
+		g_source_unref(timeout_source);
+	}
+
+	if (handler != 0)
+	{
+		g_cancellable_disconnect(batch->cancellable, handler);
+	}
+
+	g_object_unref(cancellable);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Executes the batch.
+ * Sampled batches are traced, so that their messages can be followed to the servers.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_batch_execute_traced (JBatch* batch)
+{
+	guint64 trace_id;
+	guint64 previous_trace_id;
+	guint operation_count;
+	gint64 start;
+	gboolean ret;
+
+	if (G_LIKELY((trace_id = j_batch_trace_sample()) == 0))
+	{
+		return j_batch_execute_cancellable(batch);
+	}
+
+	previous_trace_id = j_batch_get_trace_id();
+	j_batch_set_trace_id(trace_id);
+
+	j_trace_flow("batch", trace_id, J_TRACE_FLOW_BEGIN);
+
+	operation_count = j_list_length(batch->list);
+	start = g_get_monotonic_time();
+
+	ret = j_batch_execute_cancellable(batch);
+
+	g_debug("Trace %016" G_GINT64_MODIFIER "x: batch of %u operations took %" G_GINT64_FORMAT " us (%s)", trace_id, operation_count, g_get_monotonic_time() - start, (ret) ? "succeeded" : "failed");
+	j_trace_flow("batch", trace_id, J_TRACE_FLOW_END);
+
+	j_batch_set_trace_id(previous_trace_id);
+
+	return ret;
+}
+
+/**
+ * Executes the batch.
+ * If the batch has statistics, they are collected by the current thread and the background operations it starts.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param batch A batch.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_batch_execute_internal (JBatch* batch)
+{
+	JStatistics* previous_statistics;
+	gboolean ret;
+
+	if (G_LIKELY(batch->statistics == NULL))
+	{
+		return j_batch_execute_traced(batch);
+	}
+
+	previous_statistics = j_batch_get_current_statistics();
+	j_batch_set_current_statistics(batch->statistics);
+
+	ret = j_batch_execute_traced(batch);
+
+	j_batch_set_current_statistics(previous_statistics);
 
 	return ret;
 }
 
+/**
+ * Returns the cancellable of the batch executed by the current thread.
+ * Network operations should use it, so that they can be interrupted when the batch times out or is cancelled.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return A cancellable, NULL if the current thread does not execute a cancellable batch.
+ **/
+GCancellable*
+j_batch_get_cancellable (void)
+{
+	return g_private_get(&j_batch_current_cancellable);
+}
+
+/**
+ * Returns the trace ID of the batch executed by the current thread.
+ * Messages created by the thread inherit it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return A trace ID, 0 if the current thread does not execute a traced batch.
+ **/
+guint64
+j_batch_get_trace_id (void)
+{
+	guint64* trace_id;
+
+	trace_id = g_private_get(&j_batch_current_trace_id);
+
+	return (trace_id != NULL) ? *trace_id : 0;
+}
+
+/**
+ * Sets the trace ID of the current thread.
+ * Background operations use it to inherit the trace ID of the thread that started them.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param trace_id A trace ID, 0 to stop tracing.
+ **/
+void
+j_batch_set_trace_id (guint64 trace_id)
+{
+	guint64* location;
+
+	if ((location = g_private_get(&j_batch_current_trace_id)) == NULL)
+	{
+		if (trace_id == 0)
+		{
+			return;
+		}
+
+		location = g_new(guint64, 1);
+		g_private_set(&j_batch_current_trace_id, location);
+	}
+
+	*location = trace_id;
+}
+
+/**
+ * Returns the statistics of the batch executed by the current thread.
+ * The message layer and the connection pool add to it.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return A statistics, NULL if the current thread does not execute a batch with statistics.
+ **/
+JStatistics*
+j_batch_get_current_statistics (void)
+{
+	return g_private_get(&j_batch_current_statistics);
+}
+
+/**
+ * Sets the statistics of the current thread.
+ * Background operations use it to inherit the statistics of the thread that started them.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param statistics A statistics, NULL to stop collecting.
+ **/
+void
+j_batch_set_current_statistics (JStatistics* statistics)
+{
+	g_private_set(&j_batch_current_statistics, statistics);
+}
+
+/**
+ * Adds a value to the statistics of the current thread, if any.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param type  A statistics type.
+ * \param value A value.
+ **/
+void
+j_batch_statistics_add (JStatisticsType type, guint64 value)
+{
+	JStatistics* statistics;
+
+	if (G_LIKELY((statistics = g_private_get(&j_batch_current_statistics)) == NULL))
+	{
+		return;
+	}
+
+	j_statistics_add_atomic(statistics, type, value);
+}
+
 /**
  * @}
  **/
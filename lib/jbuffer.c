@@ -0,0 +1,376 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <stdlib.h>
+
+#ifdef HAVE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+#include <jbuffer.h>
+
+#include <jhelper.h>
+#include <jtrace-internal.h>
+
+/**
+ * \defgroup JBuffer Buffer
+ *
+ * Aligned buffers from a shared pool.
+ *
+ * Buffers are aligned to pages, so they can be used for direct I/O, and are registered with CUDA if it is available.
+ * Freed buffers are kept for reuse, so that neither allocation nor registration has to be repeated.
+ * Writes whose data is part of such a buffer are cached without copying it, the buffer is kept alive until the write has been executed instead.
+ * The data must therefore not be modified before the write's batch has been executed, even if the buffer has been freed.
+ *
+ * @{
+ **/
+
+/**
+ * The alignment of buffers.
+ **/
+#define J_BUFFER_ALIGNMENT 4096
+
+/**
+ * The size of the largest buffers that are kept for reuse, larger ones are freed immediately.
+ **/
+#define J_BUFFER_MAX_POOLED (64 * 1024 * 1024)
+
+/**
+ * The number of size classes, which are powers of two from J_BUFFER_ALIGNMENT to J_BUFFER_MAX_POOLED.
+ **/
+#define J_BUFFER_CLASSES 15
+
+/**
+ * The maximum number of free buffers kept per size class.
+ **/
+#define J_BUFFER_CACHED 4
+
+struct JBuffer
+{
+	gchar* data;
+
+	/**
+	 * The allocated size, which might be larger than requested.
+	 **/
+	gsize size;
+
+	/**
+	 * The caller's reference and those of cached writes.
+	 **/
+	gint ref_count;
+};
+
+typedef struct JBuffer JBuffer;
+
+/**
+ * Protects the buffers and the free lists.
+ **/
+static GMutex j_buffer_mutex;
+
+/**
+ * All buffers in use, ordered by address.
+ **/
+static GTree* j_buffer_buffers = NULL;
+
+/**
+ * Free buffers per size class.
+ **/
+static GQueue j_buffer_free_lists[J_BUFFER_CLASSES];
+
+static
+gint
+j_buffer_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+	JBuffer const* buffer_a = a;
+	JBuffer const* buffer_b = b;
+
+	(void)data;
+
+	return (buffer_a->data < buffer_b->data) ? -1 : (buffer_a->data > buffer_b->data) ? 1 : 0;
+}
+
+/**
+ * Finds the buffer containing an address, used with g_tree_search().
+ *
+ * \private
+ **/
+static
+gint
+j_buffer_search (gconstpointer key, gconstpointer data)
+{
+	JBuffer const* buffer = key;
+	gchar const* address = data;
+
+	/* Negative values continue the search among smaller addresses. */
+	if (address < buffer->data)
+	{
+		return -1;
+	}
+
+	if (address >= buffer->data + buffer->size)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the size class of a size, J_BUFFER_CLASSES if buffers of this size are not pooled.
+ *
+ * \private
+ **/
+static
+guint
+j_buffer_get_class (gsize size)
+{
+	guint size_class = 0;
+
+	for (gsize class_size = J_BUFFER_ALIGNMENT; class_size < size; class_size *= 2)
+	{
+		size_class++;
+	}
+
+	return size_class;
+}
+
+static
+void
+j_buffer_destroy (JBuffer* buffer)
+{
+#ifdef HAVE_CUDA
+	cudaHostUnregister(buffer->data);
+#endif
+
+	if (buffer->size >= J_HELPER_HUGE_PAGE_SIZE)
+	{
+		j_helper_free_huge(buffer->data, buffer->size);
+	}
+	else
+	{
+		free(buffer->data);
+	}
+
+	g_slice_free(JBuffer, buffer);
+}
+
+/**
+ * Allocates an aligned buffer.
+ * Buffers of up to 64 MiB are taken from a pool that is shared by all threads.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * gpointer data;
+ *
+ * data = j_buffer_alloc(1024 * 1024);
+ * j_object_write(object, data, 1024 * 1024, 0, &bytes_written, batch);
+ * j_buffer_free(data);
+ * \endcode
+ *
+ * \param size A size.
+ *
+ * \return A buffer aligned to at least 4 KiB. Should be freed with j_buffer_free().
+ **/
+gpointer
+j_buffer_alloc (gsize size)
+{
+	JBuffer* buffer = NULL;
+	guint size_class;
+
+	g_return_val_if_fail(size > 0, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	size_class = j_buffer_get_class(size);
+
+	g_mutex_lock(&j_buffer_mutex);
+
+	if (j_buffer_buffers == NULL)
+	{
+		j_buffer_buffers = g_tree_new_full(j_buffer_compare, NULL, NULL, NULL);
+	}
+
+	if (size_class < J_BUFFER_CLASSES)
+	{
+		buffer = g_queue_pop_head(&(j_buffer_free_lists[size_class]));
+	}
+
+	g_mutex_unlock(&j_buffer_mutex);
+
+	if (buffer == NULL)
+	{
+		gpointer data;
+
+		buffer = g_slice_new(JBuffer);
+		buffer->size = (size_class < J_BUFFER_CLASSES) ? (gsize)J_BUFFER_ALIGNMENT << size_class : (size + J_BUFFER_ALIGNMENT - 1) & ~((gsize)J_BUFFER_ALIGNMENT - 1);
+
+		if (buffer->size >= J_HELPER_HUGE_PAGE_SIZE)
+		{
+			data = j_helper_alloc_huge(buffer->size);
+		}
+		else if (posix_memalign(&data, J_BUFFER_ALIGNMENT, buffer->size) != 0)
+		{
+			g_error("%s: failed to allocate %" G_GSIZE_FORMAT " bytes", G_STRLOC, buffer->size);
+		}
+
+		buffer->data = data;
+
+#ifdef HAVE_CUDA
+		/* Registration is only an optimization, transfers to and from unregistered memory still work. */
+		cudaHostRegister(buffer->data, buffer->size, cudaHostRegisterDefault);
+#endif
+	}
+
+	buffer->ref_count = 1;
+
+	g_mutex_lock(&j_buffer_mutex);
+	g_tree_insert(j_buffer_buffers, buffer, buffer);
+	g_mutex_unlock(&j_buffer_mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return buffer->data;
+}
+
+/**
+ * Frees a buffer allocated by j_buffer_alloc().
+ * Cached writes of the buffer's data keep it alive until they have been executed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data A buffer.
+ **/
+void
+j_buffer_free (gpointer data)
+{
+	JBuffer* buffer;
+
+	if (data == NULL)
+	{
+		return;
+	}
+
+	g_mutex_lock(&j_buffer_mutex);
+	buffer = (j_buffer_buffers != NULL) ? g_tree_search(j_buffer_buffers, j_buffer_search, data) : NULL;
+	g_mutex_unlock(&j_buffer_mutex);
+
+	g_return_if_fail(buffer != NULL && buffer->data == data);
+
+	j_buffer_unref(buffer);
+}
+
+/**
+ * Acquires a reference to the buffer containing some data.
+ * Used by operations that would otherwise have to copy the data, because the caller might free it.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data   Some data.
+ * \param length The data's length.
+ *
+ * \return The buffer, which should be released with j_buffer_unref(), or NULL if the data is not part of a buffer allocated by j_buffer_alloc().
+ **/
+gpointer
+j_buffer_ref (gconstpointer data, gsize length)
+{
+	JBuffer* buffer = NULL;
+
+	g_return_val_if_fail(data != NULL, NULL);
+
+	g_mutex_lock(&j_buffer_mutex);
+
+	if (j_buffer_buffers != NULL && (buffer = g_tree_search(j_buffer_buffers, j_buffer_search, data)) != NULL)
+	{
+		if ((gchar const*)data + length <= buffer->data + buffer->size)
+		{
+			buffer->ref_count++;
+		}
+		else
+		{
+			buffer = NULL;
+		}
+	}
+
+	g_mutex_unlock(&j_buffer_mutex);
+
+	return buffer;
+}
+
+/**
+ * Releases a reference acquired by j_buffer_ref().
+ * The buffer is returned to the pool once its last reference has been released.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param buffer A buffer returned by j_buffer_ref().
+ **/
+void
+j_buffer_unref (gpointer buffer)
+{
+	JBuffer* buffer_ = buffer;
+	guint size_class;
+
+	g_return_if_fail(buffer_ != NULL);
+
+	g_mutex_lock(&j_buffer_mutex);
+
+	if (--buffer_->ref_count > 0)
+	{
+		g_mutex_unlock(&j_buffer_mutex);
+		return;
+	}
+
+	g_tree_remove(j_buffer_buffers, buffer_);
+
+	size_class = j_buffer_get_class(buffer_->size);
+
+	if (size_class < J_BUFFER_CLASSES && j_buffer_free_lists[size_class].length < J_BUFFER_CACHED)
+	{
+		g_queue_push_head(&(j_buffer_free_lists[size_class]), buffer_);
+		buffer_ = NULL;
+	}
+
+	g_mutex_unlock(&j_buffer_mutex);
+
+	if (buffer_ != NULL)
+	{
+		j_buffer_destroy(buffer_);
+	}
+}
+
+/**
+ * @}
+ **/
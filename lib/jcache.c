@@ -29,6 +29,7 @@
 #include <jcache.h>
 
 #include <jcommon.h>
+#include <jhelper.h>
 #include <jtrace-internal.h>
 
 /**
@@ -36,6 +37,77 @@
  * @{
  **/
 
+/**
+ * The number of size classes.
+ * Size class i holds blocks of J_CACHE_CLASS_MIN << i bytes, larger segments are allocated individually.
+ **/
+#define J_CACHE_CLASSES 13
+
+/**
+ * The smallest block size.
+ **/
+#define J_CACHE_CLASS_MIN 16
+
+/**
+ * The size of the slabs that blocks are carved from.
+ * Each slab fits into a huge page and is larger than the largest block.
+ **/
+#define J_CACHE_SLAB_SIZE J_HELPER_HUGE_PAGE_SIZE
+
+/**
+ * The number of magazines.
+ * Each thread uses one of them, so threads rarely contend for the same lock.
+ **/
+#define J_CACHE_MAGAZINES 16
+
+/**
+ * The maximum number of free blocks per size class kept in a magazine.
+ * Half of them are moved between the magazine and the depot at once.
+ **/
+#define J_CACHE_MAGAZINE_SIZE 64
+
+/**
+ * The header in front of every segment.
+ **/
+struct JCacheBlock
+{
+	/**
+	 * The segment's length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The segment's size class, J_CACHE_CLASSES if it was allocated individually.
+	 **/
+	guint64 size_class;
+};
+
+typedef struct JCacheBlock JCacheBlock;
+
+/**
+ * Free blocks of one size class.
+ * The blocks are linked using their first bytes.
+ **/
+struct JCacheFreeList
+{
+	gpointer head;
+	guint count;
+};
+
+typedef struct JCacheFreeList JCacheFreeList;
+
+/**
+ * Free blocks used by a subset of threads.
+ **/
+struct JCacheMagazine
+{
+	JCacheFreeList free[J_CACHE_CLASSES];
+
+	GMutex mutex[1];
+};
+
+typedef struct JCacheMagazine JCacheMagazine;
+
 /**
  * A cache.
  */
@@ -46,13 +118,239 @@ struct JCache
 	*/
 	guint64 size;
 
-	GHashTable* buffers;
+	/**
+	 * The length of all segments handed out.
+	 * Modified atomically.
+	 **/
+	gsize used;
+
+	JCacheMagazine magazines[J_CACHE_MAGAZINES];
+
+	/**
+	 * Free blocks shared by all magazines.
+	 * Protected by mutex.
+	 **/
+	JCacheFreeList depot[J_CACHE_CLASSES];
 
-	guint64 used;
+	/**
+	 * The current slab of each size class and the number of bytes still available in it.
+	 * Protected by mutex.
+	 **/
+	gchar* slab[J_CACHE_CLASSES];
+	gsize slab_available[J_CACHE_CLASSES];
+
+	/**
+	 * All slabs.
+	 * Protected by mutex.
+	 **/
+	GSList* slabs;
+
+	/**
+	 * Individually allocated segments.
+	 * Protected by mutex.
+	 **/
+	GHashTable* buffers;
 
 	GMutex mutex[1];
 };
 
+/**
+ * The index of the magazine used by the current thread, plus one.
+ **/
+static GPrivate j_cache_thread_magazine;
+
+/**
+ * Returns the magazine used by the current thread.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A cache.
+ *
+ * \return A magazine.
+ **/
+static
+JCacheMagazine*
+j_cache_get_magazine (JCache* cache)
+{
+	static gint next_magazine = 0;
+
+	guint index;
+
+	index = GPOINTER_TO_UINT(g_private_get(&j_cache_thread_magazine));
+
+	if (G_UNLIKELY(index == 0))
+	{
+		index = ((guint)g_atomic_int_add(&next_magazine, 1) % J_CACHE_MAGAZINES) + 1;
+		g_private_set(&j_cache_thread_magazine, GUINT_TO_POINTER(index));
+	}
+
+	return &(cache->magazines[index - 1]);
+}
+
+/**
+ * Returns the size class for a length.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param length A length.
+ *
+ * \return The size class, J_CACHE_CLASSES if the length is too large for all of them.
+ **/
+static
+guint
+j_cache_size_class (guint64 length)
+{
+	guint size_class = 0;
+
+	while (size_class < J_CACHE_CLASSES && ((guint64)J_CACHE_CLASS_MIN << size_class) < length)
+	{
+		size_class++;
+	}
+
+	return size_class;
+}
+
+static
+void
+j_cache_free_list_push (JCacheFreeList* list, gpointer block)
+{
+	*((gpointer*)block) = list->head;
+	list->head = block;
+	list->count++;
+}
+
+static
+gpointer
+j_cache_free_list_pop (JCacheFreeList* list)
+{
+	gpointer block = list->head;
+
+	if (block != NULL)
+	{
+		list->head = *((gpointer*)block);
+		list->count--;
+	}
+
+	return block;
+}
+
+/**
+ * Frees an individually allocated block.
+ * Blocks of at least a huge page are allocated using j_helper_alloc_huge().
+ **/
+static
+void
+j_cache_block_free (JCacheBlock* block)
+{
+	gsize size;
+
+	size = sizeof(JCacheBlock) + block->length;
+
+	if (size >= J_HELPER_HUGE_PAGE_SIZE)
+	{
+		j_helper_free_huge(block, size);
+	}
+	else
+	{
+		g_free(block);
+	}
+}
+
+/**
+ * Refills a magazine's free list from the depot, carving new blocks from slabs if necessary.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache      A cache.
+ * \param list       A magazine's free list.
+ * \param size_class A size class.
+ **/
+static
+void
+j_cache_refill (JCache* cache, JCacheFreeList* list, guint size_class)
+{
+	gsize block_size;
+
+	block_size = sizeof(JCacheBlock) + ((gsize)J_CACHE_CLASS_MIN << size_class);
+
+	g_mutex_lock(cache->mutex);
+
+	while (list->count < J_CACHE_MAGAZINE_SIZE / 2)
+	{
+		gpointer block;
+
+		block = j_cache_free_list_pop(&(cache->depot[size_class]));
+
+		if (block == NULL)
+		{
+			if (cache->slab_available[size_class] < block_size)
+			{
+				cache->slab[size_class] = j_helper_alloc_huge(J_CACHE_SLAB_SIZE);
+				cache->slab_available[size_class] = J_CACHE_SLAB_SIZE;
+				cache->slabs = g_slist_prepend(cache->slabs, cache->slab[size_class]);
+			}
+
+			block = cache->slab[size_class];
+			cache->slab[size_class] += block_size;
+			cache->slab_available[size_class] -= block_size;
+		}
+
+		j_cache_free_list_push(list, block);
+	}
+
+	g_mutex_unlock(cache->mutex);
+}
+
+/**
+ * Reserves space in the cache.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache  A cache.
+ * \param length A length.
+ *
+ * \return TRUE if the space could be reserved, FALSE otherwise.
+ **/
+static
+gboolean
+j_cache_reserve (JCache* cache, guint64 length)
+{
+	gsize used;
+
+	do
+	{
+		used = GPOINTER_TO_SIZE(g_atomic_pointer_get(&(cache->used)));
+
+		if (used + length > cache->size)
+		{
+			return FALSE;
+		}
+	}
+	while (!g_atomic_pointer_compare_and_exchange(&(cache->used), GSIZE_TO_POINTER(used), GSIZE_TO_POINTER(used + length)));
+
+	return TRUE;
+}
+
 /**
  * Creates a new cache.
  *
@@ -77,10 +375,16 @@ j_cache_new (guint64 size)
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	cache = g_slice_new(JCache);
+	cache = g_slice_new0(JCache);
 	cache->size = size;
-	cache->buffers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
 	cache->used = 0;
+	cache->slabs = NULL;
+	cache->buffers = g_hash_table_new(NULL, NULL);
+
+	for (guint i = 0; i < J_CACHE_MAGAZINES; i++)
+	{
+		g_mutex_init(cache->magazines[i].mutex);
+	}
 
 	g_mutex_init(cache->mutex);
 
@@ -109,7 +413,6 @@ j_cache_free (JCache* cache)
 {
 	GHashTableIter iter[1];
 	gpointer key;
-	gpointer value;
 
 	g_return_if_fail(cache != NULL);
 
@@ -117,13 +420,25 @@ j_cache_free (JCache* cache)
 
 	g_hash_table_iter_init(iter, cache->buffers);
 
-	while (g_hash_table_iter_next(iter, &key, &value))
+	while (g_hash_table_iter_next(iter, &key, NULL))
 	{
-		g_free(key);
+		j_cache_block_free(key);
 	}
 
 	g_hash_table_unref(cache->buffers);
 
+	for (GSList* l = cache->slabs; l != NULL; l = l->next)
+	{
+		j_helper_free_huge(l->data, J_CACHE_SLAB_SIZE);
+	}
+
+	g_slist_free(cache->slabs);
+
+	for (guint i = 0; i < J_CACHE_MAGAZINES; i++)
+	{
+		g_mutex_clear(cache->magazines[i].mutex);
+	}
+
 	g_mutex_clear(cache->mutex);
 
 	g_slice_free(JCache, cache);
@@ -133,6 +448,7 @@ j_cache_free (JCache* cache)
 
 /**
  * Gets a new segment from the cache.
+ * Small segments are taken from the current thread's magazine, which is refilled from slabs shared by all threads.
  *
  * \author Michael Kuhn
  *
@@ -152,54 +468,129 @@ j_cache_free (JCache* cache)
 gpointer
 j_cache_get (JCache* cache, guint64 length)
 {
-	gpointer ret = NULL;
+	JCacheBlock* block;
+	guint size_class;
 
 	g_return_val_if_fail(cache != NULL, NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	g_mutex_lock(cache->mutex);
-
-	if (cache->used + length > cache->size)
+	if (!j_cache_reserve(cache, length))
 	{
+		block = NULL;
 		goto end;
 	}
 
-	ret = g_malloc(length);
-	cache->used += length;
+	size_class = j_cache_size_class(length);
 
-	g_hash_table_insert(cache->buffers, ret, GSIZE_TO_POINTER(length));
+	if (size_class < J_CACHE_CLASSES)
+	{
+		JCacheMagazine* magazine;
+		JCacheFreeList* list;
 
-end:
-	g_mutex_unlock(cache->mutex);
+		magazine = j_cache_get_magazine(cache);
+		list = &(magazine->free[size_class]);
+
+		g_mutex_lock(magazine->mutex);
+
+		if (list->count == 0)
+		{
+			j_cache_refill(cache, list, size_class);
+		}
+
+		block = j_cache_free_list_pop(list);
+
+		g_mutex_unlock(magazine->mutex);
+	}
+	else
+	{
+		block = (sizeof(JCacheBlock) + length >= J_HELPER_HUGE_PAGE_SIZE) ? j_helper_alloc_huge(sizeof(JCacheBlock) + length) : g_malloc(sizeof(JCacheBlock) + length);
 
+		g_mutex_lock(cache->mutex);
+		g_hash_table_add(cache->buffers, block);
+		g_mutex_unlock(cache->mutex);
+	}
+
+	block->length = length;
+	block->size_class = size_class;
+
+end:
 	j_trace_leave(G_STRFUNC);
 
-	return ret;
+	return (block != NULL) ? block + 1 : NULL;
 }
 
+/**
+ * Releases a segment.
+ * Its memory is kept for reuse by the cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A cache.
+ * \param data  A segment returned by j_cache_get().
+ **/
 void
 j_cache_release (JCache* cache, gpointer data)
 {
-	gpointer size;
+	JCacheBlock* block;
+	guint64 length;
 
 	g_return_if_fail(cache != NULL);
 	g_return_if_fail(data != NULL);
 
-	g_mutex_lock(cache->mutex);
+	block = (JCacheBlock*)data - 1;
+	length = block->length;
 
-	if ((size = g_hash_table_lookup(cache->buffers, data)) == NULL)
+	if (block->size_class < J_CACHE_CLASSES)
 	{
-		g_warn_if_reached();
-		return;
+		JCacheMagazine* magazine;
+		JCacheFreeList* list;
+		guint size_class;
+
+		size_class = block->size_class;
+		magazine = j_cache_get_magazine(cache);
+		list = &(magazine->free[size_class]);
+
+		g_mutex_lock(magazine->mutex);
+
+		j_cache_free_list_push(list, block);
+
+		/* Return half of the blocks to the depot, so that other threads can use them. */
+		if (list->count > J_CACHE_MAGAZINE_SIZE)
+		{
+			g_mutex_lock(cache->mutex);
+
+			while (list->count > J_CACHE_MAGAZINE_SIZE / 2)
+			{
+				j_cache_free_list_push(&(cache->depot[size_class]), j_cache_free_list_pop(list));
+			}
+
+			g_mutex_unlock(cache->mutex);
+		}
+
+		g_mutex_unlock(magazine->mutex);
 	}
+	else
+	{
+		gboolean found;
 
-	g_hash_table_remove(cache->buffers, data);
+		g_mutex_lock(cache->mutex);
+		found = g_hash_table_remove(cache->buffers, block);
+		g_mutex_unlock(cache->mutex);
 
-	cache->used -= GPOINTER_TO_SIZE(size);
-	g_free(data);
+		if (!found)
+		{
+			g_warn_if_reached();
+			return;
+		}
 
-	g_mutex_unlock(cache->mutex);
+		j_cache_block_free(block);
+	}
+
+	g_atomic_pointer_add(&(cache->used), -(gssize)length);
 }
 
 /**
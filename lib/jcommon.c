@@ -33,13 +33,16 @@
 #include <jconfiguration.h>
 #include <jconnection-pool-internal.h>
 #include <jdistribution-internal.h>
+#include <jhelper.h>
 #include <jlist.h>
 #include <jlist-iterator.h>
+#include <jlock-internal.h>
 #include <jbatch.h>
 #include <jbatch-internal.h>
 #include <joperation-cache-internal.h>
 #include <joperation-internal.h>
 #include <jtrace-internal.h>
+#include <jtransport.h>
 
 /**
  * \defgroup JCommon Common
@@ -61,6 +64,25 @@ struct JCommon
 
 	GModule* object_module;
 	GModule* kv_module;
+
+	/**
+	 * Whether the backends have been loaded.
+	 * Backends are loaded on first use, so processes that only talk to servers do not have to load them.
+	 */
+	gsize object_loaded;
+	gsize kv_loaded;
+
+	/**
+	 * The backends for local namespaces, which are always loaded by the client.
+	 */
+	JBackend* object_local_backend;
+	JBackend* kv_local_backend;
+
+	GModule* object_local_module;
+	GModule* kv_local_module;
+
+	gsize object_local_loaded;
+	gsize kv_local_loaded;
 };
 
 static JCommon* j_common = NULL;
@@ -123,89 +145,77 @@ j_get_program_name (gchar const* default_name)
  * Initializes JULEA.
  *
  * \author Michael Kuhn
- *
- * \param argc A pointer to \c argc.
- * \param argv A pointer to \c argv.
  */
 void
 j_init (void)
+{
+	JConfiguration* configuration;
+
+	g_return_if_fail(!j_is_initialized());
+
+	configuration = j_configuration_new();
+
+	if (configuration == NULL)
+	{
+		g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+	}
+
+	j_init_for_configuration(configuration);
+	j_configuration_unref(configuration);
+}
+
+/**
+ * Initializes JULEA using the given configuration.
+ * This allows parallel applications to read the configuration once and distribute it among their processes.
+ * Backends, background threads and connections are only set up when they are first used.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ */
+void
+j_init_for_configuration (JConfiguration* configuration)
 {
 	JCommon* common;
 	g_autofree gchar* basename = NULL;
-	gchar const* object_backend;
-	gchar const* object_component;
-	gchar const* object_path;
-	gchar const* kv_backend;
-	gchar const* kv_component;
-	gchar const* kv_path;
 
+	g_return_if_fail(configuration != NULL);
 	g_return_if_fail(!j_is_initialized());
 
 	common = g_slice_new(JCommon);
-	common->configuration = NULL;
+	common->configuration = j_configuration_ref(configuration);
+	common->object_backend = NULL;
+	common->kv_backend = NULL;
+	common->object_module = NULL;
+	common->kv_module = NULL;
+	common->object_loaded = 0;
+	common->kv_loaded = 0;
+	common->object_local_backend = NULL;
+	common->kv_local_backend = NULL;
+	common->object_local_module = NULL;
+	common->kv_local_module = NULL;
+	common->object_local_loaded = 0;
+	common->kv_local_loaded = 0;
 
 	basename = j_get_program_name("julea");
 	j_trace_init(basename);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	common->configuration = j_configuration_new();
-
-	if (common->configuration == NULL)
-	{
-		goto error;
-	}
-
-	object_backend = j_configuration_get_object_backend(common->configuration);
-	object_component = j_configuration_get_object_component(common->configuration);
-	object_path = j_configuration_get_object_path(common->configuration);
-
-	kv_backend = j_configuration_get_kv_backend(common->configuration);
-	kv_component = j_configuration_get_kv_component(common->configuration);
-	kv_path = j_configuration_get_kv_path(common->configuration);
-
-	if (j_backend_load_client(object_backend, object_component, J_BACKEND_TYPE_OBJECT, &(common->object_module), &(common->object_backend)))
-	{
-		if (common->object_backend == NULL || !j_backend_object_init(common->object_backend, object_path))
-		{
-			J_CRITICAL("Could not initialize object backend %s.\n", object_backend);
-			goto error;
-		}
-	}
-
-	if (j_backend_load_client(kv_backend, kv_component, J_BACKEND_TYPE_KV, &(common->kv_module), &(common->kv_backend)))
-	{
-		if (common->kv_backend == NULL || !j_backend_kv_init(common->kv_backend, kv_path))
-		{
-			J_CRITICAL("Could not initialize kv backend %s.\n", kv_backend);
-			goto error;
-		}
-	}
+	/* Has to happen before any buffers are allocated. */
+	j_helper_set_huge_pages(j_configuration_get_huge_pages(common->configuration));
 
 	j_connection_pool_init(common->configuration);
 	j_distribution_init();
-	j_background_operation_init(0);
-	j_operation_cache_init();
+	j_background_operation_init(j_configuration_get_background_threads(common->configuration), j_configuration_get_pin_threads(common->configuration));
+	j_operation_cache_init(common->configuration);
 
 	g_atomic_pointer_set(&j_common, common);
 
 	j_trace_leave(G_STRFUNC);
-
-	return;
-
-error:
-	if (common->configuration != NULL)
-	{
-		j_configuration_unref(common->configuration);
-	}
-
-	j_trace_leave(G_STRFUNC);
-
-	j_trace_fini();
-
-	g_slice_free(JCommon, common);
-
-	g_error("%s: Failed to initialize JULEA.", G_STRLOC);
 }
 
 /**
@@ -223,12 +233,34 @@ j_fini (void)
 	j_trace_enter(G_STRFUNC, NULL);
 
 	j_operation_cache_fini();
+	j_lock_fini();
 	j_background_operation_fini();
 	j_connection_pool_fini();
+	j_transport_fini();
 
 	common = g_atomic_pointer_get(&j_common);
 	g_atomic_pointer_set(&j_common, NULL);
 
+	if (common->kv_local_backend != NULL)
+	{
+		j_backend_kv_fini(common->kv_local_backend);
+	}
+
+	if (common->object_local_backend != NULL)
+	{
+		j_backend_object_fini(common->object_local_backend);
+	}
+
+	if (common->kv_local_module)
+	{
+		g_module_close(common->kv_local_module);
+	}
+
+	if (common->object_local_module)
+	{
+		g_module_close(common->object_local_module);
+	}
+
 	if (common->kv_backend != NULL)
 	{
 		j_backend_kv_fini(common->kv_backend);
@@ -258,6 +290,109 @@ j_fini (void)
 	g_slice_free(JCommon, common);
 }
 
+/**
+ * Loads a client backend.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param common The common structure.
+ * \param type   A backend type.
+ */
+static
+void
+j_load_backend (JCommon* common, JBackendType type)
+{
+	gchar const* backend;
+	gchar const* component;
+	gchar const* path;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (type == J_BACKEND_TYPE_OBJECT)
+	{
+		backend = j_configuration_get_object_backend(common->configuration);
+		component = j_configuration_get_object_component(common->configuration);
+		path = j_configuration_get_object_path(common->configuration);
+
+		if (j_backend_load_client(backend, component, J_BACKEND_TYPE_OBJECT, &(common->object_module), &(common->object_backend)))
+		{
+			if (common->object_backend == NULL || !j_backend_object_init(common->object_backend, path))
+			{
+				J_CRITICAL("Could not initialize object backend %s.\n", backend);
+				g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+			}
+		}
+	}
+	else
+	{
+		backend = j_configuration_get_kv_backend(common->configuration);
+		component = j_configuration_get_kv_component(common->configuration);
+		path = j_configuration_get_kv_path(common->configuration);
+
+		if (j_backend_load_client(backend, component, J_BACKEND_TYPE_KV, &(common->kv_module), &(common->kv_backend)))
+		{
+			if (common->kv_backend == NULL || !j_backend_kv_init(common->kv_backend, path))
+			{
+				J_CRITICAL("Could not initialize kv backend %s.\n", backend);
+				g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+			}
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Loads the client backend for local namespaces.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param common The common structure.
+ * \param type   A backend type.
+ */
+static
+void
+j_load_local_backend (JCommon* common, JBackendType type)
+{
+	gchar const* backend;
+	gchar const* path;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (type == J_BACKEND_TYPE_OBJECT)
+	{
+		backend = j_configuration_get_object_local_backend(common->configuration);
+		path = j_configuration_get_object_local_path(common->configuration);
+
+		j_backend_load_client(backend, "client", J_BACKEND_TYPE_OBJECT, &(common->object_local_module), &(common->object_local_backend));
+
+		if (common->object_local_backend == NULL || !j_backend_object_init(common->object_local_backend, path))
+		{
+			J_CRITICAL("Could not initialize local object backend %s.\n", backend);
+			g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+		}
+	}
+	else
+	{
+		backend = j_configuration_get_kv_local_backend(common->configuration);
+		path = j_configuration_get_kv_local_path(common->configuration);
+
+		j_backend_load_client(backend, "client", J_BACKEND_TYPE_KV, &(common->kv_local_module), &(common->kv_local_backend));
+
+		if (common->kv_local_backend == NULL || !j_backend_kv_init(common->kv_local_backend, path))
+		{
+			J_CRITICAL("Could not initialize local kv backend %s.\n", backend);
+			g_error("%s: Failed to initialize JULEA.", G_STRLOC);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
 /* Internal */
 
 /**
@@ -299,6 +434,12 @@ j_object_backend (void)
 
 	common = g_atomic_pointer_get(&j_common);
 
+	if (g_once_init_enter(&(common->object_loaded)))
+	{
+		j_load_backend(common, J_BACKEND_TYPE_OBJECT);
+		g_once_init_leave(&(common->object_loaded), 1);
+	}
+
 	return common->object_backend;
 }
 
@@ -320,9 +461,87 @@ j_kv_backend (void)
 
 	common = g_atomic_pointer_get(&j_common);
 
+	if (g_once_init_enter(&(common->kv_loaded)))
+	{
+		j_load_backend(common, J_BACKEND_TYPE_KV);
+		g_once_init_leave(&(common->kv_loaded), 1);
+	}
+
 	return common->kv_backend;
 }
 
+/**
+ * Returns the data backend for a namespace.
+ * Namespaces listed in the object group's local-namespaces key use the local backend, all others use j_object_backend().
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param namespace A namespace.
+ *
+ * \return The data backend, NULL if the namespace is stored on the object servers.
+ */
+JBackend*
+j_object_backend_for_namespace (gchar const* namespace)
+{
+	JCommon* common;
+
+	g_return_val_if_fail(j_is_initialized(), NULL);
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	common = g_atomic_pointer_get(&j_common);
+
+	if (!j_configuration_is_object_namespace_local(common->configuration, namespace))
+	{
+		return j_object_backend();
+	}
+
+	if (g_once_init_enter(&(common->object_local_loaded)))
+	{
+		j_load_local_backend(common, J_BACKEND_TYPE_OBJECT);
+		g_once_init_leave(&(common->object_local_loaded), 1);
+	}
+
+	return common->object_local_backend;
+}
+
+/**
+ * Returns the key-value backend for a namespace.
+ * Namespaces listed in the kv group's local-namespaces key use the local backend, all others use j_kv_backend().
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param namespace A namespace.
+ *
+ * \return The key-value backend, NULL if the namespace is stored on the key-value servers.
+ */
+JBackend*
+j_kv_backend_for_namespace (gchar const* namespace)
+{
+	JCommon* common;
+
+	g_return_val_if_fail(j_is_initialized(), NULL);
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	common = g_atomic_pointer_get(&j_common);
+
+	if (!j_configuration_is_kv_namespace_local(common->configuration, namespace))
+	{
+		return j_kv_backend();
+	}
+
+	if (g_once_init_enter(&(common->kv_local_loaded)))
+	{
+		j_load_local_backend(common, J_BACKEND_TYPE_KV);
+		g_once_init_leave(&(common->kv_local_loaded), 1);
+	}
+
+	return common->kv_local_backend;
+}
+
 /**
  * @}
  **/
@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include <jconfiguration.h>
+#include <jhelper.h>
 
 #include <julea-internal.h>
 
@@ -53,6 +54,12 @@ struct JConfiguration
 		 */
 		gchar** kv;
 
+		/**
+		 * The kv read replicas, NULL if there are none.
+		 * Replica i mirrors kv server i modulo the number of kv servers.
+		 */
+		gchar** kv_replicas;
+
 		/**
 		 * The number of object servers.
 		 */
@@ -62,6 +69,11 @@ struct JConfiguration
 		 * The number of kv servers.
 		 */
 		guint32 kv_len;
+
+		/**
+		 * The number of kv read replicas.
+		 */
+		guint32 kv_replicas_len;
 	}
 	servers;
 
@@ -84,6 +96,21 @@ struct JConfiguration
 		 * The path.
 		 */
 		gchar* path;
+
+		/**
+		 * The namespaces that are stored using the local backend, NULL if there are none.
+		 */
+		gchar** local_namespaces;
+
+		/**
+		 * The local backend, which is loaded by clients regardless of the component.
+		 */
+		gchar* local_backend;
+
+		/**
+		 * The local backend's path.
+		 */
+		gchar* local_path;
 	}
 	object;
 
@@ -106,11 +133,210 @@ struct JConfiguration
 		 * The path.
 		 */
 		gchar* path;
+
+		/**
+		 * The namespaces that are stored using the local backend, NULL if there are none.
+		 */
+		gchar** local_namespaces;
+
+		/**
+		 * The local backend, which is loaded by clients regardless of the component.
+		 */
+		gchar* local_backend;
+
+		/**
+		 * The local backend's path.
+		 */
+		gchar* local_path;
 	}
 	kv;
 
+	/**
+	 * The server configuration.
+	 */
+	struct
+	{
+		/**
+		 * The connection handling mode.
+		 */
+		gchar* mode;
+
+		/**
+		 * The number of worker threads.
+		 */
+		guint32 threads;
+
+		/**
+		 * The group commit time window in microseconds.
+		 */
+		guint64 group_commit_time;
+
+		/**
+		 * The maximum number of syncs per group commit.
+		 */
+		guint32 group_commit_size;
+
+		/**
+		 * Whether messages should be received while the previous one is executed.
+		 */
+		gboolean pipeline;
+
+		/**
+		 * The size of the per-object write buffer.
+		 */
+		guint64 write_buffer_size;
+
+		/**
+		 * The maximum age of buffered writes in microseconds.
+		 */
+		guint64 write_buffer_time;
+
+		/**
+		 * The maximum number of messages executed concurrently by the scheduler.
+		 */
+		guint32 scheduler_slots;
+
+		/**
+		 * The scheduler's weights for metadata, small I/O and bulk I/O messages.
+		 */
+		guint32 scheduler_weight_metadata;
+		guint32 scheduler_weight_small;
+		guint32 scheduler_weight_bulk;
+
+		/**
+		 * The memory budget in bytes.
+		 */
+		guint64 memory_budget;
+
+		/**
+		 * The maximum size of objects stored inline in the key-value backend.
+		 */
+		guint64 inline_size;
+
+		/**
+		 * The rate of the background scrubber in bytes per second.
+		 */
+		guint64 scrub_rate;
+
+		/**
+		 * The time between the starts of two scrubbing passes in seconds.
+		 */
+		guint64 scrub_interval;
+
+		/**
+		 * The rate at which deleted objects are reclaimed in bytes per second, 0 if objects are deleted immediately.
+		 */
+		guint64 trash_rate;
+
+		/**
+		 * The maximum size of the KV cache in bytes, 0 if KV values should not be cached.
+		 */
+		guint64 kv_cache_size;
+
+		/**
+		 * Whether lookups of non-existent KV keys should be answered using filters.
+		 */
+		gboolean kv_filter;
+
+		/**
+		 * The NUMA node the server runs on, NULL if it is not bound.
+		 */
+		gchar* numa_node;
+
+		/**
+		 * Whether large buffers are backed by huge pages.
+		 */
+		gboolean huge_pages;
+
+		/**
+		 * The directory of the journal for buffered writes, NULL if there is none.
+		 */
+		gchar* journal;
+
+		/**
+		 * The number of blocks indexed for deduplication, 0 if it is disabled.
+		 */
+		guint32 dedup;
+	}
+	server;
+
 	guint32 max_connections;
 
+	/**
+	 * The number of multiplexed connections per server.
+	 */
+	guint32 multiplex_connections;
+
+	/**
+	 * The number of connections per server to establish in advance.
+	 */
+	guint32 prewarm_connections;
+
+	/**
+	 * The maximum size of data cached by the operation cache in bytes.
+	 */
+	guint64 cache_size;
+
+	/**
+	 * The default block size of new distributions in bytes.
+	 */
+	guint64 block_size;
+
+	/**
+	 * The maximum amount of data per read or write message in bytes.
+	 */
+	guint64 message_size;
+
+	/**
+	 * The latency percentile after which reads of replicated objects are hedged, 0 if reads should not be hedged.
+	 */
+	guint32 hedge_percentile;
+
+	/**
+	 * The number of background threads.
+	 */
+	guint32 background_threads;
+
+	/**
+	 * Whether to pin background threads to processors.
+	 */
+	gboolean pin_threads;
+
+	/**
+	 * Whether large buffers are backed by huge pages.
+	 */
+	gboolean huge_pages;
+
+	/**
+	 * The directory of the node-local object cache, NULL if it is disabled.
+	 */
+	gchar* node_cache;
+
+	/**
+	 * Whether writes of whole blocks are deduplicated.
+	 */
+	gboolean dedup;
+
+	/**
+	 * The time to wait for concurrent batches to combine with in microseconds.
+	 */
+	guint64 combine_window;
+
+	/**
+	 * The fraction of batches to trace, 1 out of every trace_sample batches.
+	 */
+	guint32 trace_sample;
+
+	/**
+	 * Whether to checksum messages.
+	 */
+	gboolean checksums;
+
+	/**
+	 * Whether object payloads are transferred using RDMA.
+	 */
+	gboolean rdma;
+
 	/**
 	 * The reference count.
 	 */
@@ -118,23 +344,23 @@ struct JConfiguration
 };
 
 /**
- * Creates a new configuration.
+ * Loads the configuration data.
+ * The configuration file is determined by the JULEA_CONFIG environment variable, the user's and the system's configuration directories are searched otherwise.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \return A new configuration. Should be freed with j_configuration_unref().
+ * \return The configuration data, NULL if no configuration file could be loaded. Should be freed with g_key_file_free().
  **/
-JConfiguration*
-j_configuration_new (void)
+GKeyFile*
+j_configuration_load_key_file (void)
 {
-	JConfiguration* configuration = NULL;
 	GKeyFile* key_file;
-	gchar* config_name = NULL;
+	g_autofree gchar* config_name = NULL;
+	g_autofree gchar* user_path = NULL;
 	gchar const* env_path;
-	gchar* path = NULL;
 	gchar const* const* dirs;
 
 	key_file = g_key_file_new();
@@ -145,15 +371,13 @@ j_configuration_new (void)
 		{
 			if (g_key_file_load_from_file(key_file, env_path, G_KEY_FILE_NONE, NULL))
 			{
-				configuration = j_configuration_new_for_data(key_file);
-			}
-			else
-			{
-				J_CRITICAL("Can not open configuration file %s.", env_path);
+				return key_file;
 			}
 
+			J_CRITICAL("Can not open configuration file %s.", env_path);
+
 			/* If we do not find the configuration file, stop searching. */
-			goto out;
+			goto error;
 		}
 		else
 		{
@@ -166,40 +390,54 @@ j_configuration_new (void)
 		config_name = g_strdup("julea");
 	}
 
-	path = g_build_filename(g_get_user_config_dir(), "julea", config_name, NULL);
+	user_path = g_build_filename(g_get_user_config_dir(), "julea", config_name, NULL);
 
-	if (g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL))
+	if (g_key_file_load_from_file(key_file, user_path, G_KEY_FILE_NONE, NULL))
 	{
-		configuration = j_configuration_new_for_data(key_file);
-
-		goto out;
+		return key_file;
 	}
 
-	g_free(path);
-
 	dirs = g_get_system_config_dirs();
 
 	for (guint i = 0; dirs[i] != NULL; i++)
 	{
+		g_autofree gchar* path = NULL;
+
 		path = g_build_filename(dirs[i], "julea", config_name, NULL);
 
 		if (g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL))
 		{
-			configuration = j_configuration_new_for_data(key_file);
-
-			goto out;
+			return key_file;
 		}
-
-		g_free(path);
 	}
 
-	path = NULL;
-
-out:
+error:
 	g_key_file_free(key_file);
 
-	g_free(path);
-	g_free(config_name);
+	return NULL;
+}
+
+/**
+ * Creates a new configuration.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return A new configuration. Should be freed with j_configuration_unref().
+ **/
+JConfiguration*
+j_configuration_new (void)
+{
+	JConfiguration* configuration = NULL;
+	GKeyFile* key_file;
+
+	if ((key_file = j_configuration_load_key_file()) != NULL)
+	{
+		configuration = j_configuration_new_for_data(key_file);
+		g_key_file_free(key_file);
+	}
 
 	return configuration;
 }
@@ -222,25 +460,113 @@ j_configuration_new_for_data (GKeyFile* key_file)
 	JConfiguration* configuration;
 	gchar** servers_object;
 	gchar** servers_kv;
+	gchar** servers_kv_replicas;
 	gchar* object_backend;
 	gchar* object_component;
 	gchar* object_path;
 	gchar* kv_backend;
 	gchar* kv_component;
 	gchar* kv_path;
+	gchar** object_local_namespaces;
+	gchar* object_local_backend;
+	gchar* object_local_path;
+	gchar** kv_local_namespaces;
+	gchar* kv_local_backend;
+	gchar* kv_local_path;
+	gchar* server_mode;
+	guint32 server_threads;
+	guint64 server_group_commit_time;
+	guint32 server_group_commit_size;
+	gboolean server_pipeline;
+	guint64 server_write_buffer_size;
+	guint64 server_write_buffer_time;
+	guint32 server_scheduler_slots;
+	guint32 server_scheduler_weight_metadata;
+	guint32 server_scheduler_weight_small;
+	guint32 server_scheduler_weight_bulk;
+	guint64 server_memory_budget;
+	guint64 server_inline_size;
+	guint64 server_scrub_rate;
+	guint64 server_scrub_interval;
+	guint64 server_trash_rate;
+	guint64 server_kv_cache_size;
+	gboolean server_kv_filter;
+	gchar* server_numa_node;
+	gboolean server_huge_pages;
+	gchar* server_journal;
+	guint32 server_dedup;
 	guint32 max_connections;
+	guint32 multiplex_connections;
+	guint32 prewarm_connections;
+	guint64 cache_size;
+	guint64 block_size;
+	guint64 message_size;
+	guint32 hedge_percentile;
+	guint32 background_threads;
+	gboolean pin_threads;
+	gboolean huge_pages;
+	gchar* node_cache;
+	gboolean dedup;
+	guint64 combine_window;
+	guint32 trace_sample;
+	gboolean checksums;
+	gboolean rdma;
 
 	g_return_val_if_fail(key_file != NULL, FALSE);
 
 	max_connections = g_key_file_get_integer(key_file, "clients", "max-connections", NULL);
+	multiplex_connections = g_key_file_get_integer(key_file, "clients", "multiplex-connections", NULL);
+	prewarm_connections = g_key_file_get_integer(key_file, "clients", "prewarm-connections", NULL);
+	cache_size = g_key_file_get_uint64(key_file, "clients", "cache-size", NULL);
+	block_size = g_key_file_get_uint64(key_file, "clients", "block-size", NULL);
+	message_size = g_key_file_get_uint64(key_file, "clients", "message-size", NULL);
+	hedge_percentile = g_key_file_get_integer(key_file, "clients", "hedge-percentile", NULL);
+	background_threads = g_key_file_get_integer(key_file, "clients", "background-threads", NULL);
+	pin_threads = g_key_file_get_boolean(key_file, "clients", "pin-threads", NULL);
+	huge_pages = g_key_file_get_boolean(key_file, "clients", "huge-pages", NULL);
+	node_cache = g_key_file_get_string(key_file, "clients", "node-cache", NULL);
+	dedup = g_key_file_get_boolean(key_file, "clients", "dedup", NULL);
+	combine_window = g_key_file_get_uint64(key_file, "clients", "combine-window", NULL);
+	trace_sample = g_key_file_get_integer(key_file, "clients", "trace-sample", NULL);
+	checksums = g_key_file_get_boolean(key_file, "clients", "checksums", NULL);
+	rdma = g_key_file_get_boolean(key_file, "clients", "rdma", NULL);
 	servers_object = g_key_file_get_string_list(key_file, "servers", "object", NULL, NULL);
 	servers_kv = g_key_file_get_string_list(key_file, "servers", "kv", NULL, NULL);
+	servers_kv_replicas = g_key_file_get_string_list(key_file, "servers", "kv-replicas", NULL, NULL);
 	object_backend = g_key_file_get_string(key_file, "object", "backend", NULL);
 	object_component = g_key_file_get_string(key_file, "object", "component", NULL);
 	object_path = g_key_file_get_string(key_file, "object", "path", NULL);
 	kv_backend = g_key_file_get_string(key_file, "kv", "backend", NULL);
 	kv_component = g_key_file_get_string(key_file, "kv", "component", NULL);
 	kv_path = g_key_file_get_string(key_file, "kv", "path", NULL);
+	object_local_namespaces = g_key_file_get_string_list(key_file, "object", "local-namespaces", NULL, NULL);
+	object_local_backend = g_key_file_get_string(key_file, "object", "local-backend", NULL);
+	object_local_path = g_key_file_get_string(key_file, "object", "local-path", NULL);
+	kv_local_namespaces = g_key_file_get_string_list(key_file, "kv", "local-namespaces", NULL, NULL);
+	kv_local_backend = g_key_file_get_string(key_file, "kv", "local-backend", NULL);
+	kv_local_path = g_key_file_get_string(key_file, "kv", "local-path", NULL);
+	server_mode = g_key_file_get_string(key_file, "server", "mode", NULL);
+	server_threads = g_key_file_get_integer(key_file, "server", "threads", NULL);
+	server_group_commit_time = g_key_file_get_uint64(key_file, "server", "group-commit-time", NULL);
+	server_group_commit_size = g_key_file_get_integer(key_file, "server", "group-commit-size", NULL);
+	server_pipeline = g_key_file_get_boolean(key_file, "server", "pipeline", NULL);
+	server_write_buffer_size = g_key_file_get_uint64(key_file, "server", "write-buffer-size", NULL);
+	server_write_buffer_time = g_key_file_get_uint64(key_file, "server", "write-buffer-time", NULL);
+	server_scheduler_slots = g_key_file_get_integer(key_file, "server", "scheduler-slots", NULL);
+	server_scheduler_weight_metadata = g_key_file_get_integer(key_file, "server", "scheduler-weight-metadata", NULL);
+	server_scheduler_weight_small = g_key_file_get_integer(key_file, "server", "scheduler-weight-small", NULL);
+	server_scheduler_weight_bulk = g_key_file_get_integer(key_file, "server", "scheduler-weight-bulk", NULL);
+	server_memory_budget = g_key_file_get_uint64(key_file, "server", "memory-budget", NULL);
+	server_inline_size = g_key_file_get_uint64(key_file, "server", "inline-size", NULL);
+	server_scrub_rate = g_key_file_get_uint64(key_file, "server", "scrub-rate", NULL);
+	server_scrub_interval = g_key_file_get_uint64(key_file, "server", "scrub-interval", NULL);
+	server_trash_rate = g_key_file_get_uint64(key_file, "server", "trash-rate", NULL);
+	server_kv_cache_size = g_key_file_get_uint64(key_file, "server", "kv-cache-size", NULL);
+	server_kv_filter = g_key_file_get_boolean(key_file, "server", "kv-filter", NULL);
+	server_numa_node = g_key_file_get_string(key_file, "server", "numa-node", NULL);
+	server_huge_pages = g_key_file_get_boolean(key_file, "server", "huge-pages", NULL);
+	server_journal = g_key_file_get_string(key_file, "server", "journal", NULL);
+	server_dedup = g_key_file_get_integer(key_file, "server", "dedup", NULL);
 
 	if (servers_object == NULL || servers_object[0] == NULL
 	    || servers_kv == NULL || servers_kv[0] == NULL
@@ -251,14 +577,25 @@ j_configuration_new_for_data (GKeyFile* key_file)
 	    || kv_component == NULL
 	    || kv_path == NULL)
 	{
+		g_free(server_mode);
+		g_free(server_numa_node);
+		g_free(server_journal);
+		g_free(node_cache);
 		g_free(kv_backend);
 		g_free(kv_component);
 		g_free(kv_path);
 		g_free(object_backend);
 		g_free(object_component);
 		g_free(object_path);
+		g_strfreev(object_local_namespaces);
+		g_free(object_local_backend);
+		g_free(object_local_path);
+		g_strfreev(kv_local_namespaces);
+		g_free(kv_local_backend);
+		g_free(kv_local_path);
 		g_strfreev(servers_object);
 		g_strfreev(servers_kv);
+		g_strfreev(servers_kv_replicas);
 
 		return NULL;
 	}
@@ -268,13 +605,70 @@ j_configuration_new_for_data (GKeyFile* key_file)
 	configuration->servers.kv = servers_kv;
 	configuration->servers.object_len = g_strv_length(servers_object);
 	configuration->servers.kv_len = g_strv_length(servers_kv);
+	configuration->servers.kv_replicas = servers_kv_replicas;
+	configuration->servers.kv_replicas_len = (servers_kv_replicas != NULL) ? g_strv_length(servers_kv_replicas) : 0;
 	configuration->object.backend = object_backend;
 	configuration->object.component = object_component;
 	configuration->object.path = object_path;
 	configuration->kv.backend = kv_backend;
 	configuration->kv.component = kv_component;
 	configuration->kv.path = kv_path;
+
+	/* Local namespaces are only used if their backend is configured completely. */
+	if (object_local_backend == NULL || object_local_path == NULL)
+	{
+		g_clear_pointer(&object_local_namespaces, g_strfreev);
+	}
+
+	if (kv_local_backend == NULL || kv_local_path == NULL)
+	{
+		g_clear_pointer(&kv_local_namespaces, g_strfreev);
+	}
+
+	configuration->object.local_namespaces = object_local_namespaces;
+	configuration->object.local_backend = object_local_backend;
+	configuration->object.local_path = object_local_path;
+	configuration->kv.local_namespaces = kv_local_namespaces;
+	configuration->kv.local_backend = kv_local_backend;
+	configuration->kv.local_path = kv_local_path;
+	configuration->server.mode = (server_mode != NULL) ? server_mode : g_strdup("threaded");
+	configuration->server.threads = server_threads;
+	configuration->server.group_commit_time = server_group_commit_time;
+	configuration->server.group_commit_size = server_group_commit_size;
+	configuration->server.pipeline = server_pipeline;
+	configuration->server.write_buffer_size = server_write_buffer_size;
+	configuration->server.write_buffer_time = server_write_buffer_time;
+	configuration->server.scheduler_slots = server_scheduler_slots;
+	configuration->server.scheduler_weight_metadata = (server_scheduler_weight_metadata > 0) ? server_scheduler_weight_metadata : 4;
+	configuration->server.scheduler_weight_small = (server_scheduler_weight_small > 0) ? server_scheduler_weight_small : 2;
+	configuration->server.scheduler_weight_bulk = (server_scheduler_weight_bulk > 0) ? server_scheduler_weight_bulk : 1;
+	configuration->server.memory_budget = server_memory_budget;
+	configuration->server.inline_size = server_inline_size;
+	configuration->server.scrub_rate = server_scrub_rate;
+	configuration->server.scrub_interval = (server_scrub_interval > 0) ? server_scrub_interval : 24 * 60 * 60;
+	configuration->server.trash_rate = server_trash_rate;
+	configuration->server.kv_cache_size = server_kv_cache_size;
+	configuration->server.kv_filter = server_kv_filter;
+	configuration->server.numa_node = server_numa_node;
+	configuration->server.huge_pages = server_huge_pages;
+	configuration->server.journal = server_journal;
+	configuration->server.dedup = server_dedup;
 	configuration->max_connections = max_connections;
+	configuration->multiplex_connections = multiplex_connections;
+	configuration->prewarm_connections = prewarm_connections;
+	configuration->cache_size = (cache_size > 0) ? cache_size : 50 * 1024 * 1024;
+	configuration->block_size = (block_size > 0) ? CLAMP(block_size, 64 * 1024, 16 * J_STRIPE_SIZE) : J_STRIPE_SIZE;
+	configuration->message_size = (message_size > 0) ? MAX(message_size, 1024 * 1024) : 16 * J_STRIPE_SIZE;
+	configuration->hedge_percentile = MIN(hedge_percentile, 99);
+	configuration->background_threads = background_threads;
+	configuration->pin_threads = pin_threads;
+	configuration->huge_pages = huge_pages;
+	configuration->node_cache = node_cache;
+	configuration->dedup = dedup;
+	configuration->combine_window = combine_window;
+	configuration->trace_sample = trace_sample;
+	configuration->checksums = checksums;
+	configuration->rdma = rdma;
 	configuration->ref_count = 1;
 
 	return configuration;
@@ -321,16 +715,28 @@ j_configuration_unref (JConfiguration* configuration)
 {
 	if (g_atomic_int_dec_and_test(&(configuration->ref_count)))
 	{
+		g_free(configuration->server.mode);
+		g_free(configuration->server.numa_node);
+		g_free(configuration->server.journal);
+		g_free(configuration->node_cache);
+
 		g_free(configuration->kv.backend);
 		g_free(configuration->kv.component);
 		g_free(configuration->kv.path);
+		g_strfreev(configuration->kv.local_namespaces);
+		g_free(configuration->kv.local_backend);
+		g_free(configuration->kv.local_path);
 
 		g_free(configuration->object.backend);
 		g_free(configuration->object.component);
 		g_free(configuration->object.path);
+		g_strfreev(configuration->object.local_namespaces);
+		g_free(configuration->object.local_backend);
+		g_free(configuration->object.local_path);
 
 		g_strfreev(configuration->servers.object);
 		g_strfreev(configuration->servers.kv);
+		g_strfreev(configuration->servers.kv_replicas);
 
 		g_slice_free(JConfiguration, configuration);
 	}
@@ -370,6 +776,95 @@ j_configuration_get_kv_server_count (JConfiguration* configuration)
 	return configuration->servers.kv_len;
 }
 
+/**
+ * Looks for an object server that runs on the local host.
+ * If several object servers are local, the first one is returned.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint32 index;
+ *
+ * if (j_configuration_get_object_server_local(j_configuration(), &index))
+ * {
+ *   ...
+ * }
+ * \endcode
+ *
+ * \param configuration The configuration.
+ * \param index         Returns the server's index.
+ *
+ * \return TRUE if there is a local object server, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_object_server_local (JConfiguration* configuration, guint32* index)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+	g_return_val_if_fail(index != NULL, FALSE);
+
+	for (guint32 i = 0; i < configuration->servers.object_len; i++)
+	{
+		if (j_helper_is_local_host(configuration->servers.object[i]))
+		{
+			*index = i;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Returns a read replica of a kv server.
+ * Replicas are listed in the servers group's kv-replicas key and assigned to the kv servers round-robin.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ * \param index         The kv server's index.
+ * \param replica       The replica's index, less than j_configuration_get_kv_replica_count().
+ *
+ * \return The replica.
+ **/
+gchar const*
+j_configuration_get_kv_replica (JConfiguration* configuration, guint32 index, guint32 replica)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+	g_return_val_if_fail(index < configuration->servers.kv_len, NULL);
+	g_return_val_if_fail(index + replica * configuration->servers.kv_len < configuration->servers.kv_replicas_len, NULL);
+
+	return configuration->servers.kv_replicas[index + replica * configuration->servers.kv_len];
+}
+
+/**
+ * Returns the number of read replicas of a kv server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ * \param index         The kv server's index.
+ *
+ * \return The number of replicas.
+ **/
+guint32
+j_configuration_get_kv_replica_count (JConfiguration* configuration, guint32 index)
+{
+	guint32 kv_len;
+
+	g_return_val_if_fail(configuration != NULL, 0);
+	g_return_val_if_fail(index < configuration->servers.kv_len, 0);
+
+	kv_len = configuration->servers.kv_len;
+
+	return (configuration->servers.kv_replicas_len / kv_len) + ((index < configuration->servers.kv_replicas_len % kv_len) ? 1 : 0);
+}
+
 gchar const*
 j_configuration_get_object_backend (JConfiguration* configuration)
 {
@@ -418,12 +913,856 @@ j_configuration_get_kv_path (JConfiguration* configuration)
 	return configuration->kv.path;
 }
 
-guint32
-j_configuration_get_max_connections (JConfiguration* configuration)
+/**
+ * Returns whether an object namespace is stored using the local object backend instead of the object servers.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ * \param namespace     A namespace.
+ *
+ * \return TRUE if the namespace is local, FALSE otherwise.
+ **/
+gboolean
+j_configuration_is_object_namespace_local (JConfiguration* configuration, gchar const* namespace)
 {
-	g_return_val_if_fail(configuration != NULL, 0);
+	g_return_val_if_fail(configuration != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
 
-	return configuration->max_connections;
+	if (configuration->object.local_namespaces == NULL)
+	{
+		return FALSE;
+	}
+
+	/* g_strv_contains() requires GLib 2.44. */
+	for (guint i = 0; configuration->object.local_namespaces[i] != NULL; i++)
+	{
+		if (g_strcmp0(configuration->object.local_namespaces[i], namespace) == 0)
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+gchar const*
+j_configuration_get_object_local_backend (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->object.local_backend;
+}
+
+gchar const*
+j_configuration_get_object_local_path (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->object.local_path;
+}
+
+/**
+ * Returns whether a key-value namespace is stored using the local key-value backend instead of the key-value servers.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ * \param namespace     A namespace.
+ *
+ * \return TRUE if the namespace is local, FALSE otherwise.
+ **/
+gboolean
+j_configuration_is_kv_namespace_local (JConfiguration* configuration, gchar const* namespace)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+
+	if (configuration->kv.local_namespaces == NULL)
+	{
+		return FALSE;
+	}
+
+	for (guint i = 0; configuration->kv.local_namespaces[i] != NULL; i++)
+	{
+		if (g_strcmp0(configuration->kv.local_namespaces[i], namespace) == 0)
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+gchar const*
+j_configuration_get_kv_local_backend (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->kv.local_backend;
+}
+
+gchar const*
+j_configuration_get_kv_local_path (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->kv.local_path;
+}
+
+/**
+ * Returns the server's connection handling mode.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The mode, either "threaded" (one thread per connection) or "event" (readiness loop with a fixed number of worker threads).
+ **/
+gchar const*
+j_configuration_get_server_mode (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->server.mode;
+}
+
+/**
+ * Returns the number of the server's worker threads.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of worker threads, 0 if it should be determined automatically.
+ **/
+guint32
+j_configuration_get_server_threads (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.threads;
+}
+
+/**
+ * Returns the server's group commit time window.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The time window in microseconds, 0 if syncs should not be grouped.
+ **/
+guint64
+j_configuration_get_server_group_commit_time (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.group_commit_time;
+}
+
+/**
+ * Returns the maximum number of syncs the server groups into one commit.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The maximum number of syncs, 0 if unlimited.
+ **/
+guint32
+j_configuration_get_server_group_commit_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.group_commit_size;
+}
+
+/**
+ * Returns whether the server pipelines the messages of a connection.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if messages are received while the previous one is executed, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_server_pipeline (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->server.pipeline;
+}
+
+/**
+ * Returns the size of the server's per-object write buffer.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The size in bytes, 0 if writes should not be coalesced.
+ **/
+guint64
+j_configuration_get_server_write_buffer_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.write_buffer_size;
+}
+
+/**
+ * Returns the maximum age of writes buffered by the server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The age in microseconds, 0 to use the default.
+ **/
+guint64
+j_configuration_get_server_write_buffer_time (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.write_buffer_time;
+}
+
+/**
+ * Returns the maximum number of messages executed concurrently by the server's scheduler.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of slots, 0 if messages should not be scheduled.
+ **/
+guint32
+j_configuration_get_server_scheduler_slots (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.scheduler_slots;
+}
+
+/**
+ * Returns the scheduler's weight for metadata messages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The weight.
+ **/
+guint32
+j_configuration_get_server_scheduler_weight_metadata (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.scheduler_weight_metadata;
+}
+
+/**
+ * Returns the scheduler's weight for small I/O messages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The weight.
+ **/
+guint32
+j_configuration_get_server_scheduler_weight_small (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.scheduler_weight_small;
+}
+
+/**
+ * Returns the scheduler's weight for bulk I/O messages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The weight.
+ **/
+guint32
+j_configuration_get_server_scheduler_weight_bulk (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.scheduler_weight_bulk;
+}
+
+/**
+ * Returns the server's memory budget.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The budget in bytes, 0 if memory usage should not be limited.
+ **/
+guint64
+j_configuration_get_server_memory_budget (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.memory_budget;
+}
+
+/**
+ * Returns the maximum size of objects the server stores inline in the key-value backend.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The size in bytes, 0 if objects should always be stored in the object backend.
+ **/
+guint64
+j_configuration_get_server_inline_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.inline_size;
+}
+
+/**
+ * Returns the rate at which the server scrubs stored data.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The rate in bytes per second, 0 if scrubbing is disabled.
+ **/
+guint64
+j_configuration_get_server_scrub_rate (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.scrub_rate;
+}
+
+/**
+ * Returns the time between the starts of two scrubbing passes.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The interval in seconds.
+ **/
+guint64
+j_configuration_get_server_scrub_interval (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.scrub_interval;
+}
+
+/**
+ * Returns the rate at which the server reclaims the space of deleted objects.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The rate in bytes per second, 0 if objects are deleted immediately.
+ **/
+guint64
+j_configuration_get_server_trash_rate (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.trash_rate;
+}
+
+/**
+ * Returns the maximum size of the server's KV cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The size in bytes, 0 if KV values should not be cached.
+ **/
+guint64
+j_configuration_get_server_kv_cache_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.kv_cache_size;
+}
+
+/**
+ * Returns whether the server answers lookups of non-existent KV keys using filters.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if filters are used, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_server_kv_filter (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->server.kv_filter;
+}
+
+/**
+ * Returns the NUMA node the server binds its threads to.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of a node or the name of a network interface or block device local to it, NULL if the server should not be bound.
+ **/
+gchar const*
+j_configuration_get_server_numa_node (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->server.numa_node;
+}
+
+/**
+ * Returns whether the server backs large buffers with huge pages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if huge pages are used, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_server_huge_pages (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->server.huge_pages;
+}
+
+/**
+ * Returns the directory of the server's journal for buffered writes.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The directory, NULL if buffered writes should not be journaled.
+ **/
+gchar const*
+j_configuration_get_server_journal (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->server.journal;
+}
+
+/**
+ * Returns the number of blocks the server indexes for deduplication.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of blocks, 0 if writes should not be deduplicated.
+ **/
+guint32
+j_configuration_get_server_dedup (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->server.dedup;
+}
+
+guint32
+j_configuration_get_max_connections (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->max_connections;
+}
+
+/**
+ * Returns the number of multiplexed connections per server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of connections, 0 if requests should not be multiplexed.
+ **/
+guint32
+j_configuration_get_multiplex_connections (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->multiplex_connections;
+}
+
+/**
+ * Returns the number of connections per server that should be established when the connection pool is initialized.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of connections, 0 if connections should be established on demand.
+ **/
+guint32
+j_configuration_get_prewarm_connections (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->prewarm_connections;
+}
+
+/**
+ * Returns the maximum size of data cached by the operation cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The size in bytes.
+ **/
+guint64
+j_configuration_get_cache_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->cache_size;
+}
+
+/**
+ * Returns the default block size of new distributions.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The block size in bytes.
+ **/
+guint64
+j_configuration_get_block_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, J_STRIPE_SIZE);
+
+	return configuration->block_size;
+}
+
+/**
+ * Returns the maximum amount of data per read or write message.
+ * Larger shares of a server are split into several messages that are exchanged over multiple connections in parallel.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The size in bytes.
+ **/
+guint64
+j_configuration_get_message_size (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 16 * J_STRIPE_SIZE);
+
+	return configuration->message_size;
+}
+
+/**
+ * Returns the latency percentile after which reads of replicated objects are hedged.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The percentile, 0 if reads should not be hedged.
+ **/
+guint32
+j_configuration_get_hedge_percentile (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->hedge_percentile;
+}
+
+/**
+ * Returns the number of background threads.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of threads, 0 to use one per processor.
+ **/
+guint32
+j_configuration_get_background_threads (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->background_threads;
+}
+
+/**
+ * Returns whether background threads should be pinned to processors.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if threads should be pinned, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_pin_threads (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->pin_threads;
+}
+
+/**
+ * Returns whether clients back large buffers with huge pages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if huge pages are used, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_huge_pages (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->huge_pages;
+}
+
+/**
+ * Returns the directory of the node-local object cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The directory, NULL if objects should not be cached.
+ **/
+gchar const*
+j_configuration_get_node_cache (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, NULL);
+
+	return configuration->node_cache;
+}
+
+/**
+ * Returns whether clients deduplicate writes of whole blocks.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if writes are deduplicated, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_dedup (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->dedup;
+}
+
+/**
+ * Returns the time to wait for concurrent batches to combine with.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The time in microseconds, 0 if batches should not be combined.
+ **/
+guint64
+j_configuration_get_combine_window (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->combine_window;
+}
+
+/**
+ * Returns how many batches are executed per traced batch.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return The number of batches, 0 if no batches should be traced.
+ **/
+guint32
+j_configuration_get_trace_sample (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, 0);
+
+	return configuration->trace_sample;
+}
+
+/**
+ * Returns whether messages should be checksummed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if messages should be checksummed, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_checksums (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->checksums;
+}
+
+/**
+ * Returns whether clients transfer object payloads using RDMA.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param configuration A configuration.
+ *
+ * \return TRUE if RDMA should be used where available, FALSE otherwise.
+ **/
+gboolean
+j_configuration_get_rdma (JConfiguration* configuration)
+{
+	g_return_val_if_fail(configuration != NULL, FALSE);
+
+	return configuration->rdma;
 }
 
 /**
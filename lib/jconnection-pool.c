@@ -25,14 +25,22 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <gio/gio.h>
+#include <gio/gunixconnection.h>
+#include <gio/gunixsocketaddress.h>
+
+#include <string.h>
 
 #include <jconnection-pool.h>
 #include <jconnection-pool-internal.h>
 
+#include <jbatch-internal.h>
 #include <jhelper.h>
 #include <jhelper-internal.h>
 #include <jmessage.h>
+#include <jprobe-internal.h>
+#include <jstatistics-internal.h>
 #include <jtrace-internal.h>
+#include <jtransport.h>
 
 #include <julea-internal.h>
 
@@ -44,10 +52,187 @@
  * @{
  **/
 
+/**
+ * A request waiting for its reply on a multiplexed connection.
+ **/
+struct JConnectionMuxRequest
+{
+	/**
+	 * The reply to fill.
+	 **/
+	JMessage* reply;
+
+	/**
+	 * Whether the reply has been received and whether it was successful.
+	 **/
+	gboolean done;
+	gboolean ret;
+
+	/**
+	 * Whether the receive thread is reading the reply.
+	 **/
+	gboolean receiving;
+
+	GCond cond;
+};
+
+typedef struct JConnectionMuxRequest JConnectionMuxRequest;
+
+/**
+ * A connection shared by many concurrent requests.
+ * Requests are sent under a lock and their replies are matched by message ID in a separate receive thread.
+ **/
+struct JConnectionMux
+{
+	GSocketConnection* connection;
+
+	/**
+	 * The receive thread.
+	 **/
+	GThread* thread;
+
+	/**
+	 * Serializes sending.
+	 **/
+	GMutex send_mutex;
+
+	/**
+	 * Maps message IDs to waiting requests.
+	 **/
+	GHashTable* pending;
+
+	/**
+	 * The next message ID.
+	 **/
+	guint32 next_id;
+
+	/**
+	 * Set if the connection has failed.
+	 **/
+	gboolean failed;
+
+	/**
+	 * Protects pending, next_id and failed.
+	 **/
+	GMutex mutex;
+};
+
+typedef struct JConnectionMux JConnectionMux;
+
+/**
+ * An ordered channel to a server.
+ * Requests that have been sent without waiting for a reply keep their connection in the channel,
+ * so that the following requests for the same key are processed after them.
+ **/
+struct JConnectionPoolChannel
+{
+	GMutex mutex;
+
+	/**
+	 * The connection used for unacknowledged requests, NULL if there are none.
+	 **/
+	GSocketConnection* connection;
+};
+
+typedef struct JConnectionPoolChannel JConnectionPoolChannel;
+
 struct JConnectionPoolQueue
 {
 	GAsyncQueue* queue;
 	guint count;
+
+	/**
+	 * The multiplexed connections, created on first use.
+	 **/
+	JConnectionMux** muxes;
+
+	/**
+	 * Used for distributing requests over the multiplexed connections.
+	 **/
+	guint mux_next;
+
+	/**
+	 * Failed multiplexed connections that have been replaced.
+	 * They might still be used by other threads, so they are only freed when the pool is shut down.
+	 **/
+	GList* muxes_failed;
+
+	/**
+	 * The ordered channels, NULL if multiplexing is enabled.
+	 **/
+	JConnectionPoolChannel* channels;
+
+	/**
+	 * Whether the server understands compact messages.
+	 * Only known after the first connection has been established.
+	 **/
+	gint compact;
+
+	/**
+	 * Whether the server understands compound messages.
+	 * Only known after the first connection has been established.
+	 **/
+	gint compound;
+
+	/**
+	 * Whether the server deduplicates writes.
+	 * Only known after the first connection has been established.
+	 **/
+	gint dedup;
+
+	/**
+	 * Whether the server transfers object payloads using RDMA.
+	 * Only known after the first connection has been established.
+	 **/
+	gint rdma;
+
+	/**
+	 * The shared memory object payloads are transferred with, NULL if the server is not local.
+	 **/
+	JTransportShm* shm;
+
+	/**
+	 * Whether the server has mapped #shm: 1 if it has, 0 if that is not known yet and -1 if a connection could not pass it.
+	 * Regions are allocated before a connection is chosen, so the memory is only used if all connections have passed it.
+	 **/
+	gint shm_mapped;
+
+	/**
+	 * The server's address.
+	 **/
+	gchar const* server;
+
+	/**
+	 * The queue's slot in the per-thread caches.
+	 **/
+	guint cache_index;
+
+	/**
+	 * The number of popped connections that have not been pushed back yet.
+	 **/
+	gint in_use;
+
+	/**
+	 * Counters for j_connection_pool_get_statistics_object() and j_connection_pool_get_statistics_kv().
+	 * All of them are updated atomically.
+	 **/
+	gsize pops;
+	gsize waits;
+	gsize wait_time;
+	gsize connects;
+	gsize connect_failures;
+	gsize reconnects;
+
+	/**
+	 * The wait times of all pops in logarithmic buckets.
+	 **/
+	gsize wait_histogram[J_CONNECTION_POOL_WAIT_BUCKETS];
+
+	/**
+	 * The names of the queue's trace counters.
+	 **/
+	gchar* trace_in_use;
+	gchar* trace_wait;
 };
 
 typedef struct JConnectionPoolQueue JConnectionPoolQueue;
@@ -60,19 +245,205 @@ struct JConnectionPool
 	JConfiguration* configuration;
 	JConnectionPoolQueue* object_queues;
 	JConnectionPoolQueue* kv_queues;
+
+	/**
+	 * The kv read replicas, in the order of the configuration.
+	 * Replica r of kv server i is at i + r * kv_len.
+	 **/
+	JConnectionPoolQueue* kv_replica_queues;
+
 	guint object_len;
 	guint kv_len;
+	guint kv_replica_len;
 	guint max_count;
+	guint mux_count;
+	guint channel_count;
+
+	/**
+	 * Establishes connections in advance, NULL if disabled.
+	 **/
+	GThreadPool* prewarm;
+
+	/**
+	 * The per-thread caches, protected by j_connection_pool_cache.
+	 **/
+	GList* caches;
 };
 
 typedef struct JConnectionPool JConnectionPool;
 
+/**
+ * A thread's cached connections, one slot per server.
+ * Only the owning thread puts connections into its slots.
+ * Other threads may steal them when they would otherwise have to wait, so all slots are accessed atomically.
+ **/
+struct JConnectionPoolCache
+{
+	/**
+	 * The pool the cache belongs to, NULL if the pool has been shut down.
+	 **/
+	JConnectionPool* pool;
+
+	/**
+	 * The slots.
+	 **/
+	GSocketConnection** connections;
+	guint len;
+};
+
+typedef struct JConnectionPoolCache JConnectionPoolCache;
+
+/**
+ * A thread's compound message.
+ * While a batch is executed, consecutive messages for the same server and key that do not wait for a reply are collected,
+ * so that they can be sent together with the next message.
+ **/
+struct JConnectionPoolCompound
+{
+	/**
+	 * The number of batches being executed by the thread.
+	 **/
+	guint depth;
+
+	/**
+	 * The queue and key of the collected messages.
+	 **/
+	JConnectionPoolQueue* queue;
+	guint32 key;
+
+	/**
+	 * The collected messages, NULL if there are none.
+	 * A single message is kept as is, a compound message is only created for the second one.
+	 **/
+	JMessage* message;
+};
+
+typedef struct JConnectionPoolCompound JConnectionPoolCompound;
+
 static JConnectionPool* j_connection_pool = NULL;
 
+static void j_connection_pool_cache_free (gpointer);
+
+static GPrivate j_connection_pool_cache = G_PRIVATE_INIT(j_connection_pool_cache_free);
+
+static void j_connection_pool_compound_free (gpointer);
+
+static GPrivate j_connection_pool_compound = G_PRIVATE_INIT(j_connection_pool_compound_free);
+
+G_LOCK_DEFINE_STATIC(j_connection_pool_cache);
+
+G_LOCK_DEFINE_STATIC(j_connection_pool_mux);
+
+/**
+ * The maximum number of connections that are established in parallel in advance.
+ **/
+#define J_CONNECTION_POOL_PREWARM_THREADS 16
+
+/**
+ * How long to wait for a connection before trying to steal one from another thread's cache again.
+ **/
+#define J_CONNECTION_POOL_STEAL_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
+/**
+ * The minimum and maximum delays between failed connects.
+ **/
+#define J_CONNECTION_POOL_BACKOFF_MIN (100 * G_TIME_SPAN_MILLISECOND)
+#define J_CONNECTION_POOL_BACKOFF_MAX (10 * G_TIME_SPAN_SECOND)
+
+/**
+ * The maximum size of a compound message's body.
+ * Larger messages are sent on their own, since there is little to gain from combining them.
+ **/
+#define J_CONNECTION_POOL_COMPOUND_SIZE (64 * 1024)
+
+/**
+ * The size of the shared memory for each local object server.
+ * Messages whose payloads do not fit are sent over the connection.
+ **/
+#define J_CONNECTION_POOL_SHM_SIZE (64 * 1024 * 1024)
+
+/**
+ * How often requests waiting for a multiplexed reply check whether they have been cancelled.
+ **/
+#define J_CONNECTION_MUX_CANCEL_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
+static void j_connection_pool_muxes_free (JConnectionMux**, guint);
+static JConnectionPoolChannel* j_connection_pool_channels_new (guint);
+static void j_connection_pool_channels_free (JConnectionPoolChannel*, guint);
+static void j_connection_mux_free_func (gpointer);
+static void j_connection_pool_prewarm (gpointer, gpointer);
+
+/**
+ * Initializes a server's queue.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_queue_init (JConnectionPoolQueue* queue, JConnectionPool* pool, gchar const* server, guint cache_index)
+{
+	queue->queue = g_async_queue_new();
+	queue->count = 0;
+	queue->muxes = (pool->mux_count > 0) ? g_new0(JConnectionMux*, pool->mux_count) : NULL;
+	queue->mux_next = 0;
+	queue->muxes_failed = NULL;
+	queue->channels = j_connection_pool_channels_new(pool->channel_count);
+	queue->compact = FALSE;
+	queue->compound = FALSE;
+	queue->dedup = FALSE;
+	queue->rdma = FALSE;
+	queue->shm = NULL;
+	queue->shm_mapped = 0;
+	queue->server = server;
+	queue->cache_index = cache_index;
+	queue->in_use = 0;
+	queue->pops = 0;
+	queue->waits = 0;
+	queue->wait_time = 0;
+	queue->connects = 0;
+	queue->connect_failures = 0;
+	queue->reconnects = 0;
+	memset(queue->wait_histogram, 0, sizeof(queue->wait_histogram));
+	queue->trace_in_use = g_strdup_printf("connection_pool_in_use[%s]", server);
+	queue->trace_wait = g_strdup_printf("connection_pool_wait[%s]", server);
+}
+
+/**
+ * Closes a server's idle connections and frees its queue.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_queue_clear (JConnectionPoolQueue* queue, JConnectionPool* pool)
+{
+	GSocketConnection* connection;
+
+	while ((connection = g_async_queue_try_pop(queue->queue)) != NULL)
+	{
+		g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+		g_object_unref(connection);
+	}
+
+	g_async_queue_unref(queue->queue);
+	j_connection_pool_muxes_free(queue->muxes, pool->mux_count);
+	g_list_free_full(queue->muxes_failed, j_connection_mux_free_func);
+	j_connection_pool_channels_free(queue->channels, pool->channel_count);
+
+	if (queue->shm != NULL)
+	{
+		j_transport_shm_free(queue->shm);
+	}
+
+	g_free(queue->trace_in_use);
+	g_free(queue->trace_wait);
+}
+
 void
 j_connection_pool_init (JConfiguration* configuration)
 {
 	JConnectionPool* pool;
+	guint prewarm_count;
 
 	g_return_if_fail(j_connection_pool == NULL);
 
@@ -84,27 +455,81 @@ j_connection_pool_init (JConfiguration* configuration)
 	pool->object_queues = g_new(JConnectionPoolQueue, pool->object_len);
 	pool->kv_len = j_configuration_get_kv_server_count(configuration);
 	pool->kv_queues = g_new(JConnectionPoolQueue, pool->kv_len);
+	pool->kv_replica_len = 0;
+
+	for (guint i = 0; i < pool->kv_len; i++)
+	{
+		pool->kv_replica_len += j_configuration_get_kv_replica_count(configuration, i);
+	}
+
+	pool->kv_replica_queues = g_new(JConnectionPoolQueue, pool->kv_replica_len);
 	pool->max_count = j_configuration_get_max_connections(configuration);
 
+	pool->mux_count = j_configuration_get_multiplex_connections(configuration);
+	pool->prewarm = NULL;
+	pool->caches = NULL;
+
 	if (pool->max_count == 0)
 	{
 		pool->max_count = g_get_num_processors();
 	}
 
+	/* Multiplexed connections are ordered already. Channels may keep at most half of the connections, so other requests can still make progress. */
+	pool->channel_count = (pool->mux_count > 0) ? 0 : pool->max_count / 2;
+
 	for (guint i = 0; i < pool->object_len; i++)
 	{
-		pool->object_queues[i].queue = g_async_queue_new();
-		pool->object_queues[i].count = 0;
+		JConnectionPoolQueue* queue = &(pool->object_queues[i]);
+
+		j_connection_pool_queue_init(queue, pool, j_configuration_get_object_server(configuration, i), i);
+
+		/* Local servers can access object payloads in shared memory. */
+		if (j_helper_is_local_host(queue->server))
+		{
+			queue->shm = j_transport_shm_new(J_CONNECTION_POOL_SHM_SIZE);
+		}
 	}
 
 	for (guint i = 0; i < pool->kv_len; i++)
 	{
-		pool->kv_queues[i].queue = g_async_queue_new();
-		pool->kv_queues[i].count = 0;
+		j_connection_pool_queue_init(&(pool->kv_queues[i]), pool, j_configuration_get_kv_server(configuration, i), pool->object_len + i);
+	}
+
+	for (guint i = 0; i < pool->kv_replica_len; i++)
+	{
+		guint index = i % pool->kv_len;
+		guint replica = i / pool->kv_len;
+
+		j_connection_pool_queue_init(&(pool->kv_replica_queues[i]), pool, j_configuration_get_kv_replica(configuration, index, replica), pool->object_len + pool->kv_len + i);
 	}
 
 	g_atomic_pointer_set(&j_connection_pool, pool);
 
+	prewarm_count = MIN(j_configuration_get_prewarm_connections(configuration), pool->max_count);
+
+	if (prewarm_count > 0)
+	{
+		guint task_count;
+
+		task_count = (pool->object_len + pool->kv_len) * prewarm_count;
+
+		/* Connect in the background, so initialization does not have to wait for the servers. */
+		pool->prewarm = g_thread_pool_new(j_connection_pool_prewarm, pool, MIN(task_count, J_CONNECTION_POOL_PREWARM_THREADS), FALSE, NULL);
+
+		for (guint j = 0; j < prewarm_count; j++)
+		{
+			for (guint i = 0; i < pool->object_len; i++)
+			{
+				g_thread_pool_push(pool->prewarm, &(pool->object_queues[i]), NULL);
+			}
+
+			for (guint i = 0; i < pool->kv_len; i++)
+			{
+				g_thread_pool_push(pool->prewarm, &(pool->kv_queues[i]), NULL);
+			}
+		}
+	}
+
 	j_trace_leave(G_STRFUNC);
 }
 
@@ -118,207 +543,2215 @@ j_connection_pool_fini (void)
 	j_trace_enter(G_STRFUNC, NULL);
 
 	pool = g_atomic_pointer_get(&j_connection_pool);
+
+	if (pool->prewarm != NULL)
+	{
+		/* Drop connections that have not been started yet and wait for the others. */
+		g_thread_pool_free(pool->prewarm, TRUE, TRUE);
+	}
+
 	g_atomic_pointer_set(&j_connection_pool, NULL);
 
-	for (guint i = 0; i < pool->object_len; i++)
+	/* Other threads might still have cached connections. */
+	G_LOCK(j_connection_pool_cache);
+
+	for (GList* l = pool->caches; l != NULL; l = l->next)
 	{
-		GSocketConnection* connection;
+		JConnectionPoolCache* cache = l->data;
 
-		while ((connection = g_async_queue_try_pop(pool->object_queues[i].queue)) != NULL)
+		for (guint i = 0; i < cache->len; i++)
 		{
-			g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
-			g_object_unref(connection);
+			GSocketConnection* connection;
+
+			connection = g_atomic_pointer_get(&(cache->connections[i]));
+
+			if (connection != NULL)
+			{
+				g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+				g_object_unref(connection);
+				g_atomic_pointer_set(&(cache->connections[i]), NULL);
+			}
 		}
 
-		g_async_queue_unref(pool->object_queues[i].queue);
+		cache->pool = NULL;
 	}
 
-	for (guint i = 0; i < pool->kv_len; i++)
+	g_list_free(pool->caches);
+
+	G_UNLOCK(j_connection_pool_cache);
+
+	for (guint i = 0; i < pool->object_len; i++)
 	{
-		GSocketConnection* connection;
+		j_connection_pool_queue_clear(&(pool->object_queues[i]), pool);
+	}
 
-		while ((connection = g_async_queue_try_pop(pool->kv_queues[i].queue)) != NULL)
-		{
-			g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
-			g_object_unref(connection);
-		}
+	for (guint i = 0; i < pool->kv_len; i++)
+	{
+		j_connection_pool_queue_clear(&(pool->kv_queues[i]), pool);
+	}
 
-		g_async_queue_unref(pool->kv_queues[i].queue);
+	for (guint i = 0; i < pool->kv_replica_len; i++)
+	{
+		j_connection_pool_queue_clear(&(pool->kv_replica_queues[i]), pool);
 	}
 
 	j_configuration_unref(pool->configuration);
 
 	g_free(pool->object_queues);
 	g_free(pool->kv_queues);
+	g_free(pool->kv_replica_queues);
 
 	g_slice_free(JConnectionPool, pool);
 
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Connects to a server and checks which backends it provides.
+ * Local servers are reached via their UNIX domain socket if possible.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param server A server.
+ * \param queue  The server's queue, used to remember its capabilities.
+ *
+ * \return A new connection or NULL if the connection could not be established.
+ **/
 static
 GSocketConnection*
-j_connection_pool_pop_internal (GAsyncQueue* queue, guint* count, gchar const* server)
+j_connection_pool_connect (gchar const* server, JConnectionPoolQueue* queue)
 {
-	GSocketConnection* connection;
+	GError* error = NULL;
+	g_autoptr(GSocketClient) client = NULL;
 
-	g_return_val_if_fail(queue != NULL, NULL);
-	g_return_val_if_fail(count != NULL, NULL);
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	GSocketConnection* connection = NULL;
+	guint op_count;
 
-	connection = g_async_queue_try_pop(queue);
+	client = g_socket_client_new();
 
-	if (connection != NULL)
+	if (j_helper_is_local_host(server))
 	{
-		goto end;
+		g_autofree gchar* path = NULL;
+
+		path = j_helper_get_local_socket_path(4711);
+
+		/* Fall back to TCP if the server does not provide a local socket. */
+		if (g_file_test(path, G_FILE_TEST_EXISTS))
+		{
+			g_autoptr(GSocketAddress) address = NULL;
+
+			address = g_unix_socket_address_new(path);
+			connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, NULL);
+		}
 	}
 
-	if ((guint)g_atomic_int_get(count) < j_connection_pool->max_count)
+	if (connection == NULL)
 	{
-		if ((guint)g_atomic_int_add(count, 1) < j_connection_pool->max_count)
-		{
-			GError* error = NULL;
-			g_autoptr(GSocketClient) client = NULL;
+		connection = g_socket_client_connect_to_host(client, server, 4711, NULL, &error);
+	}
+
+	if (error != NULL)
+	{
+		J_CRITICAL("%s", error->message);
+		g_error_free(error);
+	}
 
-			g_autoptr(JMessage) message = NULL;
-			g_autoptr(JMessage) reply = NULL;
+	if (connection == NULL)
+	{
+		g_atomic_pointer_add(&(queue->connect_failures), 1);
+		return NULL;
+	}
 
-			guint op_count;
+	g_atomic_pointer_add(&(queue->connects), 1);
 
-			client = g_socket_client_new();
-			connection = g_socket_client_connect_to_host(client, server, 4711, NULL, &error);
+	if (G_IS_TCP_CONNECTION(connection))
+	{
+		j_helper_set_nodelay(connection, TRUE);
 
-			if (error != NULL)
-			{
-				J_CRITICAL("%s", error->message);
-				g_error_free(error);
-			}
+		/* Detect servers that have disappeared without closing their connections. */
+		g_socket_set_keepalive(g_socket_connection_get_socket(connection), TRUE);
 
-			if (connection == NULL)
-			{
-				J_CRITICAL("Can not connect to %s [%d].", server, g_atomic_int_get(count));
-			}
+		/* The server could not access regions in shared memory sent on this connection. */
+		if (queue->shm != NULL)
+		{
+			g_atomic_int_set(&(queue->shm_mapped), -1);
+		}
+	}
 
-			j_helper_set_nodelay(connection, TRUE);
+	message = j_message_new(J_MESSAGE_PING, 0);
 
-			message = j_message_new(J_MESSAGE_PING, 0);
-			j_message_send(message, connection);
+	if (j_message_compression_available())
+	{
+		j_message_add_operation(message, 4);
+		j_message_append_n(message, "lz4", 4);
+	}
 
-			reply = j_message_new_reply(message);
-			j_message_receive(reply, connection);
+	if (j_configuration_get_checksums(j_connection_pool->configuration))
+	{
+		j_message_add_operation(message, 7);
+		j_message_append_n(message, "crc32c", 7);
+	}
 
-			op_count = j_message_get_count(reply);
+	j_message_add_operation(message, 7);
+	j_message_append_n(message, "varint", 7);
 
-			for (guint i = 0; i < op_count; i++)
-			{
-				gchar const* backend;
+	j_message_add_operation(message, 9);
+	j_message_append_n(message, "compound", 9);
 
-				backend = j_message_get_string(reply);
+	j_message_add_operation(message, 9);
+	j_message_append_n(message, "length64", 9);
 
-				if (g_strcmp0(backend, "object") == 0)
-				{
-					//g_print("Server has object backend.\n");
-				}
-				else if (g_strcmp0(backend, "kv") == 0)
-				{
-					//g_print("Server has kv backend.\n");
-				}
-			}
-		}
-		else
-		{
-			g_atomic_int_add(count, -1);
-		}
+	if (j_configuration_get_dedup(j_connection_pool->configuration))
+	{
+		j_message_add_operation(message, 6);
+		j_message_append_n(message, "dedup", 6);
 	}
 
-	if (connection != NULL)
+	if (j_configuration_get_rdma(j_connection_pool->configuration) && j_transport_rdma_init())
 	{
-		goto end;
+		g_autofree gchar* rdma = NULL;
+		g_autofree gchar* address = NULL;
+
+		/* The server needs the client's address to access its registered buffers. */
+		address = j_transport_get_address();
+		rdma = g_strconcat("rdma:", address, NULL);
+
+		j_message_add_operation(message, strlen(rdma) + 1);
+		j_message_append_n(message, rdma, strlen(rdma) + 1);
+	}
+
+	/* The memory can only be passed over UNIX domain sockets. */
+	if (queue->shm != NULL && G_IS_UNIX_CONNECTION(connection))
+	{
+		j_message_add_operation(message, 4);
+		j_message_append_n(message, "shm", 4);
 	}
 
-	connection = g_async_queue_pop(queue);
+	j_message_send(message, connection);
 
-end:
-	j_trace_leave(G_STRFUNC);
+	reply = j_message_new_reply(message);
+	j_message_receive(reply, connection);
+
+	op_count = j_message_get_count(reply);
+
+	for (guint i = 0; i < op_count; i++)
+	{
+		gchar const* backend;
+
+		backend = j_message_get_string(reply);
+
+		if (g_strcmp0(backend, "object") == 0)
+		{
+			//g_print("Server has object backend.\n");
+		}
+		else if (g_strcmp0(backend, "kv") == 0)
+		{
+			//g_print("Server has kv backend.\n");
+		}
+		else if (g_strcmp0(backend, "lz4") == 0)
+		{
+			j_message_set_compression(connection, TRUE);
+		}
+		else if (g_strcmp0(backend, "crc32c") == 0)
+		{
+			j_message_set_checksum(connection, TRUE);
+		}
+		else if (g_strcmp0(backend, "varint") == 0)
+		{
+			g_atomic_int_set(&(queue->compact), TRUE);
+		}
+		else if (g_strcmp0(backend, "compound") == 0)
+		{
+			g_atomic_int_set(&(queue->compound), TRUE);
+		}
+		else if (g_strcmp0(backend, "length64") == 0)
+		{
+			j_message_set_length64(connection, TRUE);
+		}
+		else if (g_strcmp0(backend, "dedup") == 0)
+		{
+			g_atomic_int_set(&(queue->dedup), TRUE);
+		}
+		else if (g_strcmp0(backend, "rdma") == 0)
+		{
+			g_atomic_int_set(&(queue->rdma), TRUE);
+		}
+		else if (g_strcmp0(backend, "shm") == 0)
+		{
+			/* The server waits for the memory after its reply. */
+			if (j_transport_shm_offer(queue->shm, connection))
+			{
+				g_atomic_int_compare_and_exchange(&(queue->shm_mapped), 0, 1);
+			}
+			else
+			{
+				g_atomic_int_set(&(queue->shm_mapped), -1);
+			}
+		}
+	}
 
 	return connection;
 }
 
+/**
+ * Establishes a connection in advance and makes it available in the server's queue.
+ * The connection counts against the maximum number of connections like one established on demand.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data      A queue.
+ * \param user_data The connection pool.
+ **/
 static
 void
-j_connection_pool_push_internal (GAsyncQueue* queue, GSocketConnection* connection)
+j_connection_pool_prewarm (gpointer data, gpointer user_data)
 {
-	g_return_if_fail(queue != NULL);
-	g_return_if_fail(connection != NULL);
+	JConnectionPoolQueue* queue = data;
+	JConnectionPool* pool = user_data;
+	GSocketConnection* connection;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	g_async_queue_push(queue, connection);
+	if ((guint)g_atomic_int_add(&(queue->count), 1) >= pool->max_count)
+	{
+		g_atomic_int_add(&(queue->count), -1);
+		goto end;
+	}
+
+	connection = j_connection_pool_connect(queue->server, queue);
+
+	if (connection == NULL)
+	{
+		J_CRITICAL("Can not connect to %s.", queue->server);
+		g_atomic_int_add(&(queue->count), -1);
+		goto end;
+	}
+
+	g_async_queue_push(queue->queue, connection);
 
+end:
 	j_trace_leave(G_STRFUNC);
 }
 
-GSocketConnection*
-j_connection_pool_pop_object (guint index)
+static
+JMessage*
+j_connection_mux_lookup (guint32 id, gpointer data)
 {
-	GSocketConnection* connection;
+	JConnectionMux* mux = data;
+	JConnectionMuxRequest* request;
 
-	g_return_val_if_fail(j_connection_pool != NULL, NULL);
-	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
-
-	j_trace_enter(G_STRFUNC, NULL);
+	g_mutex_lock(&(mux->mutex));
+	request = g_hash_table_lookup(mux->pending, GUINT_TO_POINTER(id));
 
-	connection = j_connection_pool_pop_internal(j_connection_pool->object_queues[index].queue, &(j_connection_pool->object_queues[index].count), j_configuration_get_object_server(j_connection_pool->configuration, index));
+	if (request != NULL)
+	{
+		/* The request must not give up anymore, because its reply is being filled. */
+		request->receiving = TRUE;
+	}
 
-	j_trace_leave(G_STRFUNC);
+	g_mutex_unlock(&(mux->mutex));
 
-	return connection;
+	return (request != NULL) ? request->reply : NULL;
+}
+
+/**
+ * Receives replies and hands them to the waiting requests.
+ *
+ * \private
+ **/
+static
+gpointer
+j_connection_mux_receive (gpointer data)
+{
+	JConnectionMux* mux = data;
+	JMessage* reply;
+	GHashTableIter iter;
+	gpointer value;
+
+	while (j_message_receive_lookup(mux->connection, j_connection_mux_lookup, mux, &reply))
+	{
+		JConnectionMuxRequest* request;
+		guint32 id;
+
+		if (reply == NULL)
+		{
+			J_CRITICAL("%s", "Received unexpected reply.");
+			continue;
+		}
+
+		id = j_message_get_id(reply);
+
+		g_mutex_lock(&(mux->mutex));
+
+		request = g_hash_table_lookup(mux->pending, GUINT_TO_POINTER(id));
+
+		if (request != NULL)
+		{
+			g_hash_table_remove(mux->pending, GUINT_TO_POINTER(id));
+
+			request->done = TRUE;
+			request->ret = TRUE;
+			g_cond_signal(&(request->cond));
+		}
+
+		g_mutex_unlock(&(mux->mutex));
+	}
+
+	/* The connection has been closed or failed, so no more replies will arrive. */
+	g_mutex_lock(&(mux->mutex));
+
+	mux->failed = TRUE;
+
+	g_hash_table_iter_init(&iter, mux->pending);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JConnectionMuxRequest* request = value;
+
+		request->done = TRUE;
+		request->ret = FALSE;
+		g_cond_signal(&(request->cond));
+	}
+
+	g_hash_table_remove_all(mux->pending);
+
+	g_mutex_unlock(&(mux->mutex));
+
+	return NULL;
+}
+
+static
+JConnectionMux*
+j_connection_mux_new (gchar const* server, JConnectionPoolQueue* queue)
+{
+	JConnectionMux* mux;
+	GSocketConnection* connection;
+
+	connection = j_connection_pool_connect(server, queue);
+
+	if (connection == NULL)
+	{
+		J_CRITICAL("Can not connect to %s.", server);
+		return NULL;
+	}
+
+	mux = g_slice_new(JConnectionMux);
+	mux->connection = connection;
+	mux->pending = g_hash_table_new(NULL, NULL);
+	mux->next_id = g_random_int();
+	mux->failed = FALSE;
+	g_mutex_init(&(mux->send_mutex));
+	g_mutex_init(&(mux->mutex));
+
+	mux->thread = g_thread_new("julea-connection-mux", j_connection_mux_receive, mux);
+
+	return mux;
+}
+
+static
+void
+j_connection_mux_free (JConnectionMux* mux)
+{
+	/* Wake up the receive thread. */
+	g_socket_shutdown(g_socket_connection_get_socket(mux->connection), TRUE, TRUE, NULL);
+	g_thread_join(mux->thread);
+
+	g_io_stream_close(G_IO_STREAM(mux->connection), NULL, NULL);
+	g_object_unref(mux->connection);
+
+	g_hash_table_unref(mux->pending);
+	g_mutex_clear(&(mux->send_mutex));
+	g_mutex_clear(&(mux->mutex));
+
+	g_slice_free(JConnectionMux, mux);
+}
+
+static
+void
+j_connection_mux_free_func (gpointer data)
+{
+	j_connection_mux_free(data);
+}
+
+/**
+ * Checks whether a multiplexed connection has failed.
+ *
+ * \private
+ **/
+static
+gboolean
+j_connection_mux_failed (JConnectionMux* mux)
+{
+	gboolean failed;
+
+	g_mutex_lock(&(mux->mutex));
+	failed = mux->failed;
+	g_mutex_unlock(&(mux->mutex));
+
+	return failed;
+}
+
+static
+void
+j_connection_pool_muxes_free (JConnectionMux** muxes, guint count)
+{
+	if (muxes == NULL)
+	{
+		return;
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		if (muxes[i] != NULL)
+		{
+			j_connection_mux_free(muxes[i]);
+		}
+	}
+
+	g_free(muxes);
+}
+
+static
+JConnectionPoolChannel*
+j_connection_pool_channels_new (guint count)
+{
+	JConnectionPoolChannel* channels;
+
+	if (count == 0)
+	{
+		return NULL;
+	}
+
+	channels = g_new(JConnectionPoolChannel, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		g_mutex_init(&(channels[i].mutex));
+		channels[i].connection = NULL;
+	}
+
+	return channels;
+}
+
+static
+void
+j_connection_pool_channels_free (JConnectionPoolChannel* channels, guint count)
+{
+	if (channels == NULL)
+	{
+		return;
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		if (channels[i].connection != NULL)
+		{
+			g_io_stream_close(G_IO_STREAM(channels[i].connection), NULL, NULL);
+			g_object_unref(channels[i].connection);
+		}
+
+		g_mutex_clear(&(channels[i].mutex));
+	}
+
+	g_free(channels);
+}
+
+/**
+ * Sends a message over a multiplexed connection and waits for its reply.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param mux     A multiplexed connection.
+ * \param message A message.
+ * \param wait    Whether to wait for a reply.
+ *
+ * \return The reply, NULL if no reply was requested or an error occurred.
+ **/
+static
+JMessage*
+j_connection_mux_request (JConnectionMux* mux, JMessage* message, gboolean wait)
+{
+	JConnectionMuxRequest request;
+	GCancellable* cancellable;
+	guint32 id;
+	gboolean sent;
+
+	g_mutex_lock(&(mux->mutex));
+
+	if (mux->failed)
+	{
+		g_mutex_unlock(&(mux->mutex));
+		return NULL;
+	}
+
+	/* Only this connection's IDs have to be unique. */
+	id = mux->next_id++;
+	j_message_set_id(message, id);
+
+	if (wait)
+	{
+		request.reply = j_message_new_reply(message);
+		request.done = FALSE;
+		request.ret = FALSE;
+		request.receiving = FALSE;
+		g_cond_init(&(request.cond));
+
+		g_hash_table_insert(mux->pending, GUINT_TO_POINTER(id), &request);
+	}
+
+	g_mutex_unlock(&(mux->mutex));
+
+	g_mutex_lock(&(mux->send_mutex));
+	sent = j_message_send(message, mux->connection);
+	g_mutex_unlock(&(mux->send_mutex));
+
+	if (!wait)
+	{
+		return NULL;
+	}
+
+	g_mutex_lock(&(mux->mutex));
+
+	if (!sent)
+	{
+		g_hash_table_remove(mux->pending, GUINT_TO_POINTER(id));
+		request.done = TRUE;
+	}
+
+	cancellable = j_batch_get_cancellable();
+
+	while (!request.done)
+	{
+		if (cancellable == NULL)
+		{
+			g_cond_wait(&(request.cond), &(mux->mutex));
+			continue;
+		}
+
+		if (g_cancellable_is_cancelled(cancellable) && !request.receiving)
+		{
+			/* A late reply will be skipped by the receive thread. */
+			g_hash_table_remove(mux->pending, GUINT_TO_POINTER(id));
+			request.done = TRUE;
+			break;
+		}
+
+		g_cond_wait_until(&(request.cond), &(mux->mutex), g_get_monotonic_time() + J_CONNECTION_MUX_CANCEL_INTERVAL);
+	}
+
+	g_mutex_unlock(&(mux->mutex));
+
+	g_cond_clear(&(request.cond));
+
+	if (!request.ret)
+	{
+		j_message_unref(request.reply);
+		request.reply = NULL;
+	}
+
+	return request.reply;
+}
+
+/**
+ * Checks whether an idle connection is still usable.
+ * Idle connections must not have pending input, so readable connections have either been closed by the server or are out of sync.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE if the connection is usable, FALSE otherwise.
+ **/
+static
+gboolean
+j_connection_pool_check (GSocketConnection* connection)
+{
+	GSocket* socket_;
+
+	socket_ = g_socket_connection_get_socket(connection);
+
+	if (g_socket_is_closed(socket_) || !g_socket_is_connected(socket_))
+	{
+		return FALSE;
+	}
+
+	return (g_socket_condition_check(socket_, G_IO_IN | G_IO_ERR | G_IO_HUP) == 0);
+}
+
+/**
+ * Closes a broken connection.
+ * It no longer counts against the maximum number of connections, so it will be replaced on demand.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_evict (JConnectionPoolQueue* queue, GSocketConnection* connection)
+{
+	g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+	g_object_unref(connection);
+
+	g_atomic_int_add(&(queue->count), -1);
+	g_atomic_pointer_add(&(queue->reconnects), 1);
+}
+
+/**
+ * Updates a queue's in-use counter.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_in_use_add (JConnectionPoolQueue* queue, gint value)
+{
+	gint in_use;
+
+	in_use = g_atomic_int_add(&(queue->in_use), value) + value;
+	j_trace_counter(queue->trace_in_use, in_use);
+}
+
+/**
+ * Frees a thread's cache when the thread exits.
+ * Cached connections are handed back to the pool, or closed if the pool has been shut down.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_cache_free (gpointer data)
+{
+	JConnectionPoolCache* cache = data;
+
+	G_LOCK(j_connection_pool_cache);
+
+	if (cache->pool != NULL)
+	{
+		JConnectionPool* pool = cache->pool;
+
+		for (guint i = 0; i < cache->len; i++)
+		{
+			GSocketConnection* connection;
+
+			connection = g_atomic_pointer_get(&(cache->connections[i]));
+
+			if (connection == NULL || !g_atomic_pointer_compare_and_exchange(&(cache->connections[i]), connection, NULL))
+			{
+				continue;
+			}
+
+			if (i < pool->object_len)
+			{
+				g_async_queue_push(pool->object_queues[i].queue, connection);
+			}
+			else if (i < pool->object_len + pool->kv_len)
+			{
+				g_async_queue_push(pool->kv_queues[i - pool->object_len].queue, connection);
+			}
+			else
+			{
+				g_async_queue_push(pool->kv_replica_queues[i - pool->object_len - pool->kv_len].queue, connection);
+			}
+		}
+
+		pool->caches = g_list_remove(pool->caches, cache);
+	}
+
+	G_UNLOCK(j_connection_pool_cache);
+
+	g_free(cache->connections);
+	g_slice_free(JConnectionPoolCache, cache);
+}
+
+/**
+ * Returns the current thread's slot for a queue.
+ *
+ * \private
+ **/
+static
+GSocketConnection**
+j_connection_pool_cache_get (JConnectionPoolQueue* queue)
+{
+	JConnectionPoolCache* cache;
+
+	cache = g_private_get(&j_connection_pool_cache);
+
+	/* The cache might belong to a previous pool. */
+	if (cache == NULL || cache->pool != j_connection_pool)
+	{
+		cache = g_slice_new(JConnectionPoolCache);
+		cache->pool = j_connection_pool;
+		cache->len = j_connection_pool->object_len + j_connection_pool->kv_len + j_connection_pool->kv_replica_len;
+		cache->connections = g_new0(GSocketConnection*, cache->len);
+
+		G_LOCK(j_connection_pool_cache);
+		j_connection_pool->caches = g_list_prepend(j_connection_pool->caches, cache);
+		G_UNLOCK(j_connection_pool_cache);
+
+		/* This frees the old cache. */
+		g_private_replace(&j_connection_pool_cache, cache);
+	}
+
+	return &(cache->connections[queue->cache_index]);
+}
+
+/**
+ * Takes a connection out of a slot.
+ *
+ * \private
+ **/
+static
+GSocketConnection*
+j_connection_pool_cache_take (GSocketConnection** slot)
+{
+	GSocketConnection* connection;
+
+	connection = g_atomic_pointer_get(slot);
+
+	if (connection != NULL && g_atomic_pointer_compare_and_exchange(slot, connection, NULL))
+	{
+		return connection;
+	}
+
+	return NULL;
+}
+
+/**
+ * Steals a connection from another thread's cache.
+ *
+ * \private
+ **/
+static
+GSocketConnection*
+j_connection_pool_cache_steal (JConnectionPoolQueue* queue)
+{
+	GSocketConnection* connection = NULL;
+
+	G_LOCK(j_connection_pool_cache);
+
+	for (GList* l = j_connection_pool->caches; l != NULL && connection == NULL; l = l->next)
+	{
+		JConnectionPoolCache* cache = l->data;
+
+		connection = j_connection_pool_cache_take(&(cache->connections[queue->cache_index]));
+	}
+
+	G_UNLOCK(j_connection_pool_cache);
+
+	return connection;
+}
+
+/**
+ * Returns a connection to a server.
+ * The current thread's cached connection is preferred, followed by idle connections in the shared queue and new connections.
+ * If the maximum number of connections has been reached, connections are stolen from other threads' caches.
+ * Broken connections are dropped and replaced, failed connects are retried with exponential backoff.
+ * If wait is FALSE, NULL is returned instead of waiting for a connection or retrying a connect.
+ *
+ * \private
+ **/
+static
+GSocketConnection*
+j_connection_pool_pop_internal (JConnectionPoolQueue* queue, gchar const* server, gboolean wait)
+{
+	GSocketConnection* connection = NULL;
+	JStatistics* statistics;
+	guint* count;
+	gulong backoff;
+	gint64 start;
+	gint64 wait_time;
+	gboolean waited = FALSE;
+
+	g_return_val_if_fail(queue != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	count = &(queue->count);
+	backoff = J_CONNECTION_POOL_BACKOFF_MIN;
+	statistics = j_batch_get_current_statistics();
+	start = g_get_monotonic_time();
+
+	J_PROBE1(connection_pool_pop_begin, server);
+
+	while (connection == NULL)
+	{
+		connection = j_connection_pool_cache_take(j_connection_pool_cache_get(queue));
+
+		if (connection == NULL)
+		{
+			connection = g_async_queue_try_pop(queue->queue);
+		}
+
+		if (connection == NULL && (guint)g_atomic_int_get(count) < j_connection_pool->max_count)
+		{
+			if ((guint)g_atomic_int_add(count, 1) < j_connection_pool->max_count)
+			{
+				connection = j_connection_pool_connect(server, queue);
+
+				if (connection == NULL && !wait)
+				{
+					g_atomic_int_add(count, -1);
+					break;
+				}
+
+				if (connection == NULL)
+				{
+					J_CRITICAL("Can not connect to %s [%d], retrying in %lu ms.", server, g_atomic_int_get(count), backoff / G_TIME_SPAN_MILLISECOND);
+
+					/* The server might be restarting, so retry with increasing delays. */
+					waited = TRUE;
+					g_atomic_int_add(count, -1);
+					g_usleep(backoff);
+					backoff = MIN(backoff * 2, J_CONNECTION_POOL_BACKOFF_MAX);
+
+					continue;
+				}
+			}
+			else
+			{
+				g_atomic_int_add(count, -1);
+			}
+		}
+
+		/* Connections might end up in other threads' caches while we wait. */
+		if (connection == NULL)
+		{
+			connection = j_connection_pool_cache_steal(queue);
+		}
+
+		if (connection == NULL && !wait)
+		{
+			break;
+		}
+
+		if (connection == NULL)
+		{
+			/* All connections are in use. */
+			waited = TRUE;
+			connection = g_async_queue_timeout_pop(queue->queue, J_CONNECTION_POOL_STEAL_INTERVAL);
+		}
+
+		if (connection != NULL && !j_connection_pool_check(connection))
+		{
+			/* Make room for a new connection. */
+			j_connection_pool_evict(queue, connection);
+			connection = NULL;
+		}
+	}
+
+end:
+	J_PROBE1(connection_pool_pop_end, server);
+
+	wait_time = g_get_monotonic_time() - start;
+
+	g_atomic_pointer_add(&(queue->pops), 1);
+	g_atomic_pointer_add(&(queue->wait_time), wait_time);
+	g_atomic_pointer_add(&(queue->wait_histogram[MIN(g_bit_storage(wait_time), J_CONNECTION_POOL_WAIT_BUCKETS - 1)]), 1);
+
+	if (waited)
+	{
+		g_atomic_pointer_add(&(queue->waits), 1);
+		j_trace_counter(queue->trace_wait, wait_time);
+	}
+
+	if (connection != NULL)
+	{
+		j_connection_pool_in_use_add(queue, 1);
+
+		if (statistics != NULL)
+		{
+			j_statistics_add_atomic(statistics, J_STATISTICS_CONNECTION_WAIT, wait_time);
+			j_statistics_add_server(statistics, server);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+/**
+ * Returns a connection to the pool.
+ * The connection is kept in the current thread's cache if its slot is free, so the next pop does not need the shared queue.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_push_internal (JConnectionPoolQueue* queue, GSocketConnection* connection)
+{
+	g_return_if_fail(queue != NULL);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	J_PROBE1(connection_pool_push, queue->server);
+
+	j_connection_pool_in_use_add(queue, -1);
+
+	if (!g_atomic_pointer_compare_and_exchange(j_connection_pool_cache_get(queue), NULL, connection))
+	{
+		g_async_queue_push(queue->queue, connection);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Closes a connection instead of returning it to the pool.
+ * Used for connections whose state is unknown, for example, after a failed or cancelled send or receive.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_discard_internal (JConnectionPoolQueue* queue, GSocketConnection* connection)
+{
+	g_return_if_fail(queue != NULL);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_in_use_add(queue, -1);
+	j_connection_pool_evict(queue, connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Returns a multiplexed connection, replacing it if it has failed.
+ *
+ * \private
+ **/
+static
+JConnectionMux*
+j_connection_pool_mux_get (JConnectionPoolQueue* queue, gchar const* server, guint i)
+{
+	JConnectionMux* mux;
+
+	mux = g_atomic_pointer_get(&(queue->muxes[i]));
+
+	if (mux == NULL || j_connection_mux_failed(mux))
+	{
+		G_LOCK(j_connection_pool_mux);
+
+		/* Replace failed connections, for example, after the server has been restarted. */
+		if (queue->muxes[i] != NULL && j_connection_mux_failed(queue->muxes[i]))
+		{
+			queue->muxes_failed = g_list_prepend(queue->muxes_failed, queue->muxes[i]);
+			g_atomic_pointer_set(&(queue->muxes[i]), NULL);
+			g_atomic_pointer_add(&(queue->reconnects), 1);
+		}
+
+		if (queue->muxes[i] == NULL)
+		{
+			g_atomic_pointer_set(&(queue->muxes[i]), j_connection_mux_new(server, queue));
+		}
+
+		mux = queue->muxes[i];
+
+		G_UNLOCK(j_connection_pool_mux);
+	}
+
+	return mux;
+}
+
+/**
+ * Sends a message over an exclusive connection and optionally receives its reply.
+ *
+ * \private
+ *
+ * \return The reply, NULL if #wait is FALSE or an error occurred. #ok is set to FALSE if the connection's state is unknown.
+ **/
+static
+JMessage*
+j_connection_pool_request_connection (GSocketConnection* connection, JMessage* message, gboolean wait, gboolean* ok)
+{
+	JMessage* reply = NULL;
+	gboolean ret;
+
+	ret = j_message_send(message, connection);
+
+	if (ret && wait)
+	{
+		reply = j_message_new_reply(message);
+		ret = j_message_receive(reply, connection);
+	}
+
+	if (!ret && reply != NULL)
+	{
+		j_message_unref(reply);
+		reply = NULL;
+	}
+
+	*ok = ret;
+
+	return reply;
+}
+
+/**
+ * Sends a message and optionally receives its reply.
+ * Uses a multiplexed connection if configured, an exclusive connection otherwise.
+ *
+ * \private
+ **/
+static
+JMessage*
+j_connection_pool_request_internal (JConnectionPoolQueue* queue, gchar const* server, JMessage* message, gboolean wait)
+{
+	JMessage* reply = NULL;
+	GSocketConnection* connection;
+	gboolean ret;
+
+	if (queue->muxes != NULL)
+	{
+		guint i;
+
+		i = (guint)g_atomic_int_add(&(queue->mux_next), 1) % j_connection_pool->mux_count;
+
+		return j_connection_mux_request(j_connection_pool_mux_get(queue, server, i), message, wait);
+	}
+
+	connection = j_connection_pool_pop_internal(queue, server, TRUE);
+	reply = j_connection_pool_request_connection(connection, message, wait, &ret);
+
+	if (ret)
+	{
+		j_connection_pool_push_internal(queue, connection);
+	}
+	else
+	{
+		j_connection_pool_discard_internal(queue, connection);
+	}
+
+	return reply;
+}
+
+/**
+ * Sends a message in order with all previous messages using the same key and optionally receives its reply.
+ * The server handles each connection's messages sequentially, so messages with the same key always use the same connection while there are unacknowledged ones.
+ *
+ * \private
+ **/
+static
+JMessage*
+j_connection_pool_request_ordered_internal (JConnectionPoolQueue* queue, gchar const* server, guint32 key, JMessage* message, gboolean wait)
+{
+	JMessage* reply = NULL;
+	JConnectionPoolChannel* channel;
+	GSocketConnection* connection;
+	gboolean ret;
+
+	if (queue->muxes != NULL)
+	{
+		return j_connection_mux_request(j_connection_pool_mux_get(queue, server, key % j_connection_pool->mux_count), message, wait);
+	}
+
+	/* Without channels, there is only a single connection. */
+	if (queue->channels == NULL)
+	{
+		return j_connection_pool_request_internal(queue, server, message, wait);
+	}
+
+	channel = &(queue->channels[key % j_connection_pool->channel_count]);
+
+	g_mutex_lock(&(channel->mutex));
+
+	connection = channel->connection;
+
+	if (connection == NULL && wait)
+	{
+		/* All previous messages have been acknowledged, so any connection will do. */
+		g_mutex_unlock(&(channel->mutex));
+
+		return j_connection_pool_request_internal(queue, server, message, wait);
+	}
+
+	if (connection == NULL)
+	{
+		connection = j_connection_pool_pop_internal(queue, server, TRUE);
+	}
+
+	reply = j_connection_pool_request_connection(connection, message, wait, &ret);
+
+	if (!ret)
+	{
+		j_connection_pool_discard_internal(queue, connection);
+		connection = NULL;
+	}
+	else if (wait)
+	{
+		/* The reply implies that the server has processed all previous messages. */
+		j_connection_pool_push_internal(queue, connection);
+		connection = NULL;
+	}
+
+	channel->connection = connection;
+
+	g_mutex_unlock(&(channel->mutex));
+
+	return reply;
+}
+
+static
+void
+j_connection_pool_compound_free (gpointer data)
+{
+	JConnectionPoolCompound* compound = data;
+
+	/* Batches flush their messages, so there should not be any left. */
+	if (compound->message != NULL)
+	{
+		j_message_unref(compound->message);
+	}
+
+	g_slice_free(JConnectionPoolCompound, compound);
+}
+
+/**
+ * Sends the current thread's collected messages.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_compound_flush (void)
+{
+	JConnectionPoolCompound* compound;
+
+	compound = g_private_get(&j_connection_pool_compound);
+
+	if (compound == NULL || compound->message == NULL)
+	{
+		return;
+	}
+
+	j_connection_pool_request_ordered_internal(compound->queue, compound->queue->server, compound->key, compound->message, FALSE);
+
+	j_message_unref(compound->message);
+	compound->message = NULL;
+	compound->queue = NULL;
+}
+
+/**
+ * Sends a message as part of the current thread's compound message.
+ * Messages that do not wait for a reply are collected, a message that waits for a reply is sent together with the collected ones.
+ *
+ * \private
+ *
+ * \return TRUE if #message has been handled, FALSE if it has to be sent on its own.
+ **/
+static
+gboolean
+j_connection_pool_compound_request (JConnectionPoolQueue* queue, guint32 key, JMessage* message, gboolean wait, JMessage** reply)
+{
+	JConnectionPoolCompound* compound;
+
+	compound = g_private_get(&j_connection_pool_compound);
+
+	if (compound == NULL || compound->depth == 0)
+	{
+		return FALSE;
+	}
+
+	if (compound->message != NULL && (compound->queue != queue || compound->key != key))
+	{
+		j_connection_pool_compound_flush();
+	}
+
+	if (!g_atomic_int_get(&(queue->compound)) || j_message_get_length(message) > J_CONNECTION_POOL_COMPOUND_SIZE)
+	{
+		j_connection_pool_compound_flush();
+		return FALSE;
+	}
+
+	if (compound->message == NULL)
+	{
+		if (wait)
+		{
+			return FALSE;
+		}
+
+		compound->queue = queue;
+		compound->key = key;
+		compound->message = j_message_ref(message);
+
+		return TRUE;
+	}
+
+	if (j_message_get_type(compound->message) != J_MESSAGE_COMPOUND)
+	{
+		JMessage* first = compound->message;
+
+		compound->message = j_message_new(J_MESSAGE_COMPOUND, 0);
+		j_message_set_trace_id(compound->message, j_message_get_trace_id(first));
+		j_message_append_message(compound->message, first);
+		j_message_unref(first);
+	}
+
+	j_message_append_message(compound->message, message);
+
+	if (wait)
+	{
+		/* The message's reply is matched to the compound message. */
+		*reply = j_connection_pool_request_ordered_internal(queue, queue->server, key, compound->message, TRUE);
+
+		j_message_unref(compound->message);
+		compound->message = NULL;
+		compound->queue = NULL;
+	}
+	else if (j_message_get_length(compound->message) > J_CONNECTION_POOL_COMPOUND_SIZE)
+	{
+		j_connection_pool_compound_flush();
+	}
+
+	return TRUE;
+}
+
+/**
+ * Starts collecting messages into compound messages.
+ * Calls can be nested, the messages are sent by the outermost j_connection_pool_compound_end() at the latest.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ **/
+void
+j_connection_pool_compound_begin (void)
+{
+	JConnectionPoolCompound* compound;
+
+	compound = g_private_get(&j_connection_pool_compound);
+
+	if (compound == NULL)
+	{
+		compound = g_slice_new(JConnectionPoolCompound);
+		compound->depth = 0;
+		compound->queue = NULL;
+		compound->key = 0;
+		compound->message = NULL;
+
+		g_private_set(&j_connection_pool_compound, compound);
+	}
+
+	compound->depth++;
+}
+
+/**
+ * Stops collecting messages into compound messages and sends the collected ones.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ **/
+void
+j_connection_pool_compound_end (void)
+{
+	JConnectionPoolCompound* compound;
+
+	compound = g_private_get(&j_connection_pool_compound);
+
+	g_return_if_fail(compound != NULL);
+	g_return_if_fail(compound->depth > 0);
+
+	compound->depth--;
+
+	if (compound->depth == 0)
+	{
+		j_connection_pool_compound_flush();
+	}
+}
+
+GSocketConnection*
+j_connection_pool_pop_object (guint index)
+{
+	GSocketConnection* connection;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Messages collected for a compound message must not be overtaken. */
+	j_connection_pool_compound_flush();
+
+	connection = j_connection_pool_pop_internal(&(j_connection_pool->object_queues[index]), j_configuration_get_object_server(j_connection_pool->configuration, index), TRUE);
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+/**
+ * Returns a connection to an object server if one is available without waiting.
+ * Idle connections are preferred; a new connection is only established if the maximum number of connections has not been reached yet.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return A connection, NULL if all connections are in use. Should be returned with j_connection_pool_push_object().
+ **/
+GSocketConnection*
+j_connection_pool_try_pop_object (guint index)
+{
+	GSocketConnection* connection;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_compound_flush();
+
+	connection = j_connection_pool_pop_internal(&(j_connection_pool->object_queues[index]), j_configuration_get_object_server(j_connection_pool->configuration, index), FALSE);
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+/**
+ * Returns a connection to an object server that is ordered after all previous messages using the same key.
+ * The caller must wait for a reply before pushing the connection back.
+ * Multiplexed connections can not be used exclusively, so messages sent using them might still be overtaken.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ * \param key   A key, usually the hash of the object's name.
+ *
+ * \return A connection.
+ **/
+GSocketConnection*
+j_connection_pool_pop_object_ordered (guint index, guint32 key)
+{
+	JConnectionPoolQueue* queue;
+	GSocketConnection* connection = NULL;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_compound_flush();
+
+	queue = &(j_connection_pool->object_queues[index]);
+
+	if (queue->channels != NULL)
+	{
+		JConnectionPoolChannel* channel;
+
+		channel = &(queue->channels[key % j_connection_pool->channel_count]);
+
+		/* The caller's reply acknowledges the channel's messages, so the channel can give up its connection. */
+		g_mutex_lock(&(channel->mutex));
+		connection = channel->connection;
+		channel->connection = NULL;
+		g_mutex_unlock(&(channel->mutex));
+	}
+
+	if (connection == NULL)
+	{
+		connection = j_connection_pool_pop_internal(queue, j_configuration_get_object_server(j_connection_pool->configuration, index), TRUE);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+void
+j_connection_pool_push_object (guint index, GSocketConnection* connection)
+{
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(index < j_connection_pool->object_len);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_push_internal(&(j_connection_pool->object_queues[index]), connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Closes a connection to an object server whose state is unknown, instead of returning it to the pool.
+ * A new connection is established on demand.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index      The server's index.
+ * \param connection A connection returned by j_connection_pool_pop_object().
+ **/
+void
+j_connection_pool_discard_object (guint index, GSocketConnection* connection)
+{
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(index < j_connection_pool->object_len);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_discard_internal(&(j_connection_pool->object_queues[index]), connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+GSocketConnection*
+j_connection_pool_pop_kv (guint index)
+{
+	GSocketConnection* connection;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->kv_len, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Messages collected for a compound message must not be overtaken. */
+	j_connection_pool_compound_flush();
+
+	connection = j_connection_pool_pop_internal(&(j_connection_pool->kv_queues[index]), j_configuration_get_kv_server(j_connection_pool->configuration, index), TRUE);
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+void
+j_connection_pool_push_kv (guint index, GSocketConnection* connection)
+{
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(index < j_connection_pool->kv_len);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_push_internal(&(j_connection_pool->kv_queues[index]), connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Closes a connection to a key-value server whose state is unknown, instead of returning it to the pool.
+ * A new connection is established on demand.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index      The server's index.
+ * \param connection A connection returned by j_connection_pool_pop_kv().
+ **/
+void
+j_connection_pool_discard_kv (guint index, GSocketConnection* connection)
+{
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(index < j_connection_pool->kv_len);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_discard_internal(&(j_connection_pool->kv_queues[index]), connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Establishes a dedicated connection to an object server.
+ * The connection is not managed by the pool and does not count against the maximum number of connections.
+ * This is useful for measurements that must not interfere with other users of the pool.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return A connection, NULL if the server could not be reached. Should be closed and unreferenced by the caller.
+ **/
+GSocketConnection*
+j_connection_pool_connect_object (guint index)
+{
+	GSocketConnection* connection;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	connection = j_connection_pool_connect(j_connection_pool->object_queues[index].server, &(j_connection_pool->object_queues[index]));
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+/**
+ * Establishes a dedicated connection to a key-value server.
+ * The connection is not managed by the pool and does not count against the maximum number of connections.
+ * This is useful for long-lived connections, for example, for watching key-value pairs.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return A connection, NULL if the server could not be reached. Should be closed and unreferenced by the caller.
+ **/
+GSocketConnection*
+j_connection_pool_connect_kv (guint index)
+{
+	GSocketConnection* connection;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->kv_len, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	connection = j_connection_pool_connect(j_connection_pool->kv_queues[index].server, &(j_connection_pool->kv_queues[index]));
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
+}
+
+/**
+ * Returns a read replica's queue.
+ *
+ * \private
+ **/
+static
+JConnectionPoolQueue*
+j_connection_pool_kv_replica_queue (guint index, guint replica)
+{
+	guint i;
+
+	i = index + replica * j_connection_pool->kv_len;
+
+	if (index >= j_connection_pool->kv_len || i >= j_connection_pool->kv_replica_len)
+	{
+		return NULL;
+	}
+
+	return &(j_connection_pool->kv_replica_queues[i]);
+}
+
+/**
+ * Returns a connection to a read replica of a key-value server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param replica The replica's index.
+ *
+ * \return A connection. Should be returned with j_connection_pool_push_kv_replica().
+ **/
+GSocketConnection*
+j_connection_pool_pop_kv_replica (guint index, guint replica)
+{
+	JConnectionPoolQueue* queue;
+	GSocketConnection* connection;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+
+	queue = j_connection_pool_kv_replica_queue(index, replica);
+	g_return_val_if_fail(queue != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_compound_flush();
+
+	connection = j_connection_pool_pop_internal(queue, queue->server, TRUE);
+
+	j_trace_leave(G_STRFUNC);
+
+	return connection;
 }
 
 void
-j_connection_pool_push_object (guint index, GSocketConnection* connection)
+j_connection_pool_push_kv_replica (guint index, guint replica, GSocketConnection* connection)
 {
+	JConnectionPoolQueue* queue;
+
 	g_return_if_fail(j_connection_pool != NULL);
-	g_return_if_fail(index < j_connection_pool->object_len);
 	g_return_if_fail(connection != NULL);
 
+	queue = j_connection_pool_kv_replica_queue(index, replica);
+	g_return_if_fail(queue != NULL);
+
 	j_trace_enter(G_STRFUNC, NULL);
 
-	j_connection_pool_push_internal(j_connection_pool->object_queues[index].queue, connection);
+	j_connection_pool_push_internal(queue, connection);
 
 	j_trace_leave(G_STRFUNC);
 }
 
-GSocketConnection*
-j_connection_pool_pop_kv (guint index)
+/**
+ * Closes a connection to a read replica whose state is unknown, instead of returning it to the pool.
+ * A new connection is established on demand.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index      The server's index.
+ * \param replica    The replica's index.
+ * \param connection A connection returned by j_connection_pool_pop_kv_replica().
+ **/
+void
+j_connection_pool_discard_kv_replica (guint index, guint replica, GSocketConnection* connection)
 {
-	GSocketConnection* connection;
+	JConnectionPoolQueue* queue;
+
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(connection != NULL);
+
+	queue = j_connection_pool_kv_replica_queue(index, replica);
+	g_return_if_fail(queue != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_discard_internal(queue, connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Sends a message to an object server and optionally waits for its reply.
+ * Many requests can share one connection if multiplexing is enabled.
+ * The reply must not be followed by additional data.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param message A message.
+ * \param wait    Whether to wait for a reply.
+ *
+ * \return The reply, NULL if #wait is FALSE or an error occurred.
+ **/
+JMessage*
+j_connection_pool_request_object (guint index, JMessage* message, gboolean wait)
+{
+	JMessage* reply;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+	g_return_val_if_fail(message != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_connection_pool_compound_flush();
+
+	reply = j_connection_pool_request_internal(&(j_connection_pool->object_queues[index]), j_configuration_get_object_server(j_connection_pool->configuration, index), message, wait);
+
+	j_trace_leave(G_STRFUNC);
+
+	return reply;
+}
+
+/**
+ * Sends a message to an object server in order with all previous messages using the same key and optionally waits for its reply.
+ * This allows sending dependent messages, such as an object's create and its writes, without waiting for replies in between.
+ * Messages with different keys might still overtake each other.
+ * While a batch is executed, consecutive messages with the same key are combined into compound messages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param key     A key, usually the hash of the object's name.
+ * \param message A message.
+ * \param wait    Whether to wait for a reply.
+ *
+ * \return The reply, NULL if #wait is FALSE or an error occurred.
+ **/
+JMessage*
+j_connection_pool_request_object_ordered (guint index, guint32 key, JMessage* message, gboolean wait)
+{
+	JConnectionPoolQueue* queue;
+	JMessage* reply = NULL;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+	g_return_val_if_fail(message != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	queue = &(j_connection_pool->object_queues[index]);
+
+	if (!j_connection_pool_compound_request(queue, key, message, wait, &reply))
+	{
+		reply = j_connection_pool_request_ordered_internal(queue, queue->server, key, message, wait);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return reply;
+}
+
+/**
+ * Sends a message to a key-value server and optionally waits for its reply.
+ * Many requests can share one connection if multiplexing is enabled.
+ * The reply must not be followed by additional data.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param message A message.
+ * \param wait    Whether to wait for a reply.
+ *
+ * \return The reply, NULL if #wait is FALSE or an error occurred.
+ **/
+JMessage*
+j_connection_pool_request_kv (guint index, JMessage* message, gboolean wait)
+{
+	JMessage* reply;
 
 	g_return_val_if_fail(j_connection_pool != NULL, NULL);
 	g_return_val_if_fail(index < j_connection_pool->kv_len, NULL);
+	g_return_val_if_fail(message != NULL, NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	connection = j_connection_pool_pop_internal(j_connection_pool->kv_queues[index].queue, &(j_connection_pool->kv_queues[index].count), j_configuration_get_kv_server(j_connection_pool->configuration, index));
+	j_connection_pool_compound_flush();
+
+	reply = j_connection_pool_request_internal(&(j_connection_pool->kv_queues[index]), j_configuration_get_kv_server(j_connection_pool->configuration, index), message, wait);
 
 	j_trace_leave(G_STRFUNC);
 
-	return connection;
+	return reply;
 }
 
-void
-j_connection_pool_push_kv (guint index, GSocketConnection* connection)
+
+/**
+ * Sends a message to a read replica of a key-value server and optionally waits for its reply.
+ * Replicas only serve reads, except for the changes shipped to them by their key-value server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param replica The replica's index.
+ * \param message A message.
+ * \param wait    Whether to wait for a reply.
+ *
+ * \return The reply, NULL if #wait is FALSE or an error occurred.
+ **/
+JMessage*
+j_connection_pool_request_kv_replica (guint index, guint replica, JMessage* message, gboolean wait)
 {
-	g_return_if_fail(j_connection_pool != NULL);
-	g_return_if_fail(index < j_connection_pool->kv_len);
-	g_return_if_fail(connection != NULL);
+	JConnectionPoolQueue* queue;
+	JMessage* reply;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(message != NULL, NULL);
+
+	queue = j_connection_pool_kv_replica_queue(index, replica);
+	g_return_val_if_fail(queue != NULL, NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	j_connection_pool_push_internal(j_connection_pool->kv_queues[index].queue, connection);
+	j_connection_pool_compound_flush();
+
+	reply = j_connection_pool_request_internal(queue, queue->server, message, wait);
 
 	j_trace_leave(G_STRFUNC);
+
+	return reply;
+}
+
+
+/**
+ * Returns whether messages to an object server should use the compact encoding.
+ * This is only known after a connection to the server has been established.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return TRUE if the server understands compact messages, FALSE otherwise.
+ **/
+gboolean
+j_connection_pool_get_compact_object (guint index)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, FALSE);
+	g_return_val_if_fail(index < j_connection_pool->object_len, FALSE);
+
+	return g_atomic_int_get(&(j_connection_pool->object_queues[index].compact));
+}
+
+/**
+ * Returns whether an object server deduplicates writes.
+ * This is only known after a connection to the server has been established.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return TRUE if the server understands deduplication messages, FALSE otherwise.
+ **/
+gboolean
+j_connection_pool_get_dedup_object (guint index)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, FALSE);
+	g_return_val_if_fail(index < j_connection_pool->object_len, FALSE);
+
+	return g_atomic_int_get(&(j_connection_pool->object_queues[index].dedup));
+}
+
+/**
+ * Returns whether an object server transfers payloads using RDMA.
+ * This is only known after a connection to the server has been established.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return TRUE if the server accepts messages with remote regions, FALSE otherwise.
+ **/
+gboolean
+j_connection_pool_get_rdma_object (guint index)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, FALSE);
+	g_return_val_if_fail(index < j_connection_pool->object_len, FALSE);
+
+	return g_atomic_int_get(&(j_connection_pool->object_queues[index].rdma));
+}
+
+/**
+ * Returns the shared memory an object server can access payloads in.
+ * This is only known after a connection to the server has been established.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return The shared memory or NULL if the server is not local or could not map it.
+ **/
+JTransportShm*
+j_connection_pool_get_shm_object (guint index)
+{
+	JConnectionPoolQueue* queue;
+
+	g_return_val_if_fail(j_connection_pool != NULL, NULL);
+	g_return_val_if_fail(index < j_connection_pool->object_len, NULL);
+
+	queue = &(j_connection_pool->object_queues[index]);
+
+	return (g_atomic_int_get(&(queue->shm_mapped)) == 1) ? queue->shm : NULL;
+}
+
+/**
+ * Returns whether messages to a key-value server should use the compact encoding.
+ * This is only known after a connection to the server has been established.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return TRUE if the server understands compact messages, FALSE otherwise.
+ **/
+gboolean
+j_connection_pool_get_compact_kv (guint index)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, FALSE);
+	g_return_val_if_fail(index < j_connection_pool->kv_len, FALSE);
+
+	return g_atomic_int_get(&(j_connection_pool->kv_queues[index].compact));
+}
+
+/**
+ * Returns whether messages to a read replica should use the compact encoding.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param replica The replica's index.
+ *
+ * \return TRUE if the replica understands compact messages, FALSE otherwise.
+ **/
+gboolean
+j_connection_pool_get_compact_kv_replica (guint index, guint replica)
+{
+	JConnectionPoolQueue* queue;
+
+	g_return_val_if_fail(j_connection_pool != NULL, FALSE);
+
+	queue = j_connection_pool_kv_replica_queue(index, replica);
+	g_return_val_if_fail(queue != NULL, FALSE);
+
+	return g_atomic_int_get(&(queue->compact));
+}
+
+/**
+ * Returns the number of read replicas of a key-value server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return The number of replicas.
+ **/
+guint
+j_connection_pool_get_kv_replica_count (guint index)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, 0);
+	g_return_val_if_fail(index < j_connection_pool->kv_len, 0);
+
+	return j_configuration_get_kv_replica_count(j_connection_pool->configuration, index);
+}
+
+/**
+ * Chooses where to read from a key-value server.
+ * The server and its read replicas are chosen with equal probability, so reads are spread over all of them.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ *
+ * \return A replica's index, -1 for the server itself.
+ **/
+gint
+j_connection_pool_pick_kv_replica (guint index)
+{
+	guint count;
+
+	g_return_val_if_fail(j_connection_pool != NULL, -1);
+	g_return_val_if_fail(index < j_connection_pool->kv_len, -1);
+
+	count = j_configuration_get_kv_replica_count(j_connection_pool->configuration, index);
+
+	if (count == 0)
+	{
+		return -1;
+	}
+
+	return g_random_int_range(-1, count);
+}
+
+/**
+ * Returns a statistics value of a server's queue.
+ *
+ * \private
+ **/
+static
+guint64
+j_connection_pool_queue_get_statistics (JConnectionPoolQueue* queue, JConnectionPoolStatisticsType type)
+{
+	switch (type)
+	{
+		case J_CONNECTION_POOL_STATISTICS_CONNECTIONS:
+			return (guint)g_atomic_int_get(&(queue->count));
+		case J_CONNECTION_POOL_STATISTICS_IN_USE:
+			return (guint)g_atomic_int_get(&(queue->in_use));
+		case J_CONNECTION_POOL_STATISTICS_POPS:
+			return (gsize)g_atomic_pointer_get(&(queue->pops));
+		case J_CONNECTION_POOL_STATISTICS_WAITS:
+			return (gsize)g_atomic_pointer_get(&(queue->waits));
+		case J_CONNECTION_POOL_STATISTICS_WAIT_TIME:
+			return (gsize)g_atomic_pointer_get(&(queue->wait_time));
+		case J_CONNECTION_POOL_STATISTICS_CONNECTS:
+			return (gsize)g_atomic_pointer_get(&(queue->connects));
+		case J_CONNECTION_POOL_STATISTICS_CONNECT_FAILURES:
+			return (gsize)g_atomic_pointer_get(&(queue->connect_failures));
+		case J_CONNECTION_POOL_STATISTICS_RECONNECTS:
+			return (gsize)g_atomic_pointer_get(&(queue->reconnects));
+		default:
+			g_warn_if_reached();
+			return 0;
+	}
+}
+
+/**
+ * Copies the wait time histogram of a server's queue.
+ *
+ * \private
+ **/
+static
+void
+j_connection_pool_queue_get_wait_histogram (JConnectionPoolQueue* queue, guint64* buckets)
+{
+	for (guint i = 0; i < J_CONNECTION_POOL_WAIT_BUCKETS; i++)
+	{
+		buckets[i] = (gsize)g_atomic_pointer_get(&(queue->wait_histogram[i]));
+	}
+}
+
+/**
+ * Returns a statistics value of the connections to an object server.
+ * Wait times are given in microseconds and include the time needed to establish new connections.
+ * Pops that had to wait for another thread to return a connection or for a failed connect to be retried are counted as waits.
+ * Multiplexed connections are only counted as connects, connect failures and reconnects.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * if (j_connection_pool_get_statistics_object(0, J_CONNECTION_POOL_STATISTICS_WAITS) > 0)
+ * {
+ *   g_print("Consider increasing max-connections.\n");
+ * }
+ * \endcode
+ *
+ * \param index The server's index.
+ * \param type  A statistics type.
+ *
+ * \return The value.
+ **/
+guint64
+j_connection_pool_get_statistics_object (guint index, JConnectionPoolStatisticsType type)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, 0);
+	g_return_val_if_fail(index < j_connection_pool->object_len, 0);
+
+	return j_connection_pool_queue_get_statistics(&(j_connection_pool->object_queues[index]), type);
+}
+
+/**
+ * Returns a statistics value of the connections to a key-value server.
+ * See j_connection_pool_get_statistics_object().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index The server's index.
+ * \param type  A statistics type.
+ *
+ * \return The value.
+ **/
+guint64
+j_connection_pool_get_statistics_kv (guint index, JConnectionPoolStatisticsType type)
+{
+	g_return_val_if_fail(j_connection_pool != NULL, 0);
+	g_return_val_if_fail(index < j_connection_pool->kv_len, 0);
+
+	return j_connection_pool_queue_get_statistics(&(j_connection_pool->kv_queues[index]), type);
+}
+
+/**
+ * Returns the wait time histogram of an object server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint64 buckets[J_CONNECTION_POOL_WAIT_BUCKETS];
+ *
+ * j_connection_pool_get_wait_histogram_object(0, buckets);
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param buckets A return location for J_CONNECTION_POOL_WAIT_BUCKETS counters.
+ **/
+void
+j_connection_pool_get_wait_histogram_object (guint index, guint64* buckets)
+{
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(index < j_connection_pool->object_len);
+	g_return_if_fail(buckets != NULL);
+
+	j_connection_pool_queue_get_wait_histogram(&(j_connection_pool->object_queues[index]), buckets);
+}
+
+/**
+ * Returns the wait time histogram of a key-value server.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param index   The server's index.
+ * \param buckets A return location for J_CONNECTION_POOL_WAIT_BUCKETS counters.
+ **/
+void
+j_connection_pool_get_wait_histogram_kv (guint index, guint64* buckets)
+{
+	g_return_if_fail(j_connection_pool != NULL);
+	g_return_if_fail(index < j_connection_pool->kv_len);
+	g_return_if_fail(buckets != NULL);
+
+	j_connection_pool_queue_get_wait_histogram(&(j_connection_pool->kv_queues[index]), buckets);
 }
 
 /**
@@ -47,9 +47,31 @@ struct JCredentials
 	guint32 user;
 	guint32 group;
 
+	/**
+	 * The serialized credentials, NULL if they have not been serialized since the last change.
+	 */
+	bson_t* serialized;
+
 	gint ref_count;
 };
 
+/**
+ * Discards the cached serialized credentials.
+ */
+static
+void
+j_credentials_invalidate (JCredentials* credentials)
+{
+	bson_t* serialized;
+
+	if ((serialized = g_atomic_pointer_get(&(credentials->serialized))) != NULL)
+	{
+		credentials->serialized = NULL;
+		bson_destroy(serialized);
+		g_slice_free(bson_t, serialized);
+	}
+}
+
 JCredentials*
 j_credentials_new (void)
 {
@@ -60,6 +82,7 @@ j_credentials_new (void)
 	credentials = g_slice_new(JCredentials);
 	credentials->user = geteuid();
 	credentials->group = getegid();
+	credentials->serialized = NULL;
 	credentials->ref_count = 1;
 
 	j_trace_leave(G_STRFUNC);
@@ -90,6 +113,7 @@ j_credentials_unref (JCredentials* credentials)
 
 	if (g_atomic_int_dec_and_test(&(credentials->ref_count)))
 	{
+		j_credentials_invalidate(credentials);
 		g_slice_free(JCredentials, credentials);
 	}
 
@@ -154,6 +178,43 @@ j_credentials_serialize (JCredentials* credentials)
 	return b;
 }
 
+/**
+ * Returns the serialized credentials.
+ * The result is cached, so serializing an object repeatedly does not encode its credentials again.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param credentials Credentials.
+ *
+ * \return A BSON object owned by the credentials, which is valid until they are modified or freed.
+ **/
+bson_t const*
+j_credentials_serialize_cached (JCredentials* credentials)
+{
+	bson_t* serialized;
+
+	g_return_val_if_fail(credentials != NULL, NULL);
+
+	if ((serialized = g_atomic_pointer_get(&(credentials->serialized))) == NULL)
+	{
+		serialized = j_credentials_serialize(credentials);
+
+		if (!g_atomic_pointer_compare_and_exchange(&(credentials->serialized), NULL, serialized))
+		{
+			bson_destroy(serialized);
+			g_slice_free(bson_t, serialized);
+			serialized = g_atomic_pointer_get(&(credentials->serialized));
+		}
+	}
+
+	return serialized;
+}
+
 /**
  * Deserializes credentials.
  *
@@ -177,6 +238,8 @@ j_credentials_deserialize (JCredentials* credentials, bson_t const* b)
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	j_credentials_invalidate(credentials);
+
 	bson_iter_init(&iterator, b);
 
 	while (bson_iter_next(&iterator))
@@ -0,0 +1,359 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#ifdef HAVE_CUDA
+#include <cuda_runtime.h>
+#endif
+
+#include <jdevice.h>
+
+#include <jhelper.h>
+#include <jtrace-internal.h>
+
+#include <julea-internal.h>
+
+/**
+ * \defgroup JDevice Device
+ *
+ * Transfers between objects and device memory, staged through pinned host memory.
+ *
+ * Device memory can not be sent or received directly, so every transfer is split into chunks that pass through two pinned bounce buffers.
+ * While one chunk is transferred over the network, the other one is copied to or from the device, so both transfers overlap.
+ *
+ * @{
+ **/
+
+/**
+ * The size of each bounce buffer.
+ **/
+#define J_DEVICE_BOUNCE_SIZE (4 * J_STRIPE_SIZE)
+
+#ifdef HAVE_CUDA
+
+/**
+ * The pinned bounce buffers of a thread, kept for its lifetime because pinning memory is expensive.
+ **/
+struct JDeviceBounce
+{
+	gchar* buffers[2];
+
+	/**
+	 * Signaled when the last copy involving the corresponding buffer has finished.
+	 **/
+	cudaEvent_t events[2];
+
+	cudaStream_t stream;
+};
+
+typedef struct JDeviceBounce JDeviceBounce;
+
+static
+void
+j_device_bounce_free (gpointer data)
+{
+	JDeviceBounce* bounce = data;
+
+	cudaStreamSynchronize(bounce->stream);
+
+	for (guint i = 0; i < 2; i++)
+	{
+		cudaEventDestroy(bounce->events[i]);
+		cudaFreeHost(bounce->buffers[i]);
+	}
+
+	cudaStreamDestroy(bounce->stream);
+
+	g_slice_free(JDeviceBounce, bounce);
+}
+
+static GPrivate j_device_bounce = G_PRIVATE_INIT(j_device_bounce_free);
+
+/**
+ * Returns the current thread's bounce buffers.
+ *
+ * \private
+ *
+ * \return The bounce buffers, NULL if they could not be allocated.
+ **/
+static
+JDeviceBounce*
+j_device_bounce_get (void)
+{
+	JDeviceBounce* bounce;
+
+	if ((bounce = g_private_get(&j_device_bounce)) != NULL)
+	{
+		return bounce;
+	}
+
+	bounce = g_slice_new0(JDeviceBounce);
+
+	if (cudaStreamCreateWithFlags(&(bounce->stream), cudaStreamNonBlocking) != cudaSuccess)
+	{
+		g_slice_free(JDeviceBounce, bounce);
+
+		return NULL;
+	}
+
+	for (guint i = 0; i < 2; i++)
+	{
+		if (cudaMallocHost((void**)&(bounce->buffers[i]), J_DEVICE_BOUNCE_SIZE) != cudaSuccess
+		    || cudaEventCreateWithFlags(&(bounce->events[i]), cudaEventDisableTiming) != cudaSuccess)
+		{
+			J_CRITICAL("Can not allocate %d bytes of pinned memory.", J_DEVICE_BOUNCE_SIZE);
+
+			for (guint j = 0; j <= i; j++)
+			{
+				if (bounce->events[j] != NULL)
+				{
+					cudaEventDestroy(bounce->events[j]);
+				}
+
+				if (bounce->buffers[j] != NULL)
+				{
+					cudaFreeHost(bounce->buffers[j]);
+				}
+			}
+
+			cudaStreamDestroy(bounce->stream);
+			g_slice_free(JDeviceBounce, bounce);
+
+			return NULL;
+		}
+	}
+
+	g_private_set(&j_device_bounce, bounce);
+
+	return bounce;
+}
+
+#endif
+
+/**
+ * Returns whether device memory is supported.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * if (!j_device_is_available())
+ * {
+ *   g_print("Staging through host memory.\n");
+ * }
+ * \endcode
+ *
+ * \return TRUE if JULEA has been built with CUDA and a device is present, FALSE otherwise.
+ **/
+gboolean
+j_device_is_available (void)
+{
+#ifdef HAVE_CUDA
+	gint count = 0;
+
+	return (cudaGetDeviceCount(&count) == cudaSuccess && count > 0);
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * Reads into device memory.
+ * Each chunk is read into a bounce buffer and copied to the device asynchronously while the next chunk is read.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param device_data A device buffer to hold the read data.
+ * \param length      Number of bytes to read.
+ * \param offset      An offset.
+ * \param bytes_read  Number of bytes read.
+ * \param func        A function that reads into host memory.
+ * \param data        User data passed to #func.
+ *
+ * \return TRUE on success, FALSE if the data could not be copied to the device.
+ **/
+gboolean
+j_device_read (gpointer device_data, guint64 length, guint64 offset, guint64* bytes_read, JDeviceFunc func, gpointer data)
+{
+#ifdef HAVE_CUDA
+	JDeviceBounce* bounce;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(device_data != NULL, FALSE);
+	g_return_val_if_fail(bytes_read != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if ((bounce = j_device_bounce_get()) == NULL)
+	{
+		j_trace_leave(G_STRFUNC);
+
+		return FALSE;
+	}
+
+	for (guint64 position = 0, i = 0; position < length && ret; position += J_DEVICE_BOUNCE_SIZE, i++)
+	{
+		guint slot = i % 2;
+		guint64 chunk;
+		guint64 nbytes = 0;
+
+		chunk = MIN(length - position, J_DEVICE_BOUNCE_SIZE);
+
+		/* The buffer's previous chunk has to reach the device before it can be reused. */
+		ret = (cudaEventSynchronize(bounce->events[slot]) == cudaSuccess);
+
+		if (!ret)
+		{
+			break;
+		}
+
+		func(data, bounce->buffers[slot], chunk, offset + position, &nbytes);
+
+		if (nbytes > 0)
+		{
+			ret = (cudaMemcpyAsync((gchar*)device_data + position, bounce->buffers[slot], nbytes, cudaMemcpyHostToDevice, bounce->stream) == cudaSuccess)
+			      && (cudaEventRecord(bounce->events[slot], bounce->stream) == cudaSuccess);
+
+			j_helper_atomic_add(bytes_read, nbytes);
+		}
+
+		/* The end of the object has been reached. */
+		if (nbytes < chunk)
+		{
+			break;
+		}
+	}
+
+	ret = (cudaStreamSynchronize(bounce->stream) == cudaSuccess) && ret;
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+#else
+	(void)device_data;
+	(void)length;
+	(void)offset;
+	(void)bytes_read;
+	(void)func;
+	(void)data;
+
+	return FALSE;
+#endif
+}
+
+/**
+ * Writes from device memory.
+ * Each chunk is copied from the device into a bounce buffer while the previous chunk is written.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param device_data   A device buffer holding the data to write.
+ * \param length        Number of bytes to write.
+ * \param offset        An offset.
+ * \param bytes_written Number of bytes written.
+ * \param func          A function that writes from host memory.
+ * \param data          User data passed to #func.
+ *
+ * \return TRUE on success, FALSE if the data could not be copied from the device.
+ **/
+gboolean
+j_device_write (gconstpointer device_data, guint64 length, guint64 offset, guint64* bytes_written, JDeviceFunc func, gpointer data)
+{
+#ifdef HAVE_CUDA
+	JDeviceBounce* bounce;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(device_data != NULL, FALSE);
+	g_return_val_if_fail(bytes_written != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if ((bounce = j_device_bounce_get()) == NULL)
+	{
+		j_trace_leave(G_STRFUNC);
+
+		return FALSE;
+	}
+
+	if (length > 0)
+	{
+		ret = (cudaMemcpyAsync(bounce->buffers[0], device_data, MIN(length, J_DEVICE_BOUNCE_SIZE), cudaMemcpyDeviceToHost, bounce->stream) == cudaSuccess)
+		      && (cudaEventRecord(bounce->events[0], bounce->stream) == cudaSuccess);
+	}
+
+	for (guint64 position = 0, i = 0; position < length && ret; position += J_DEVICE_BOUNCE_SIZE, i++)
+	{
+		guint slot = i % 2;
+		guint64 next;
+		guint64 chunk;
+		guint64 nbytes = 0;
+
+		chunk = MIN(length - position, J_DEVICE_BOUNCE_SIZE);
+		next = position + chunk;
+
+		if (cudaEventSynchronize(bounce->events[slot]) != cudaSuccess)
+		{
+			ret = FALSE;
+			break;
+		}
+
+		/* The other buffer's chunk has already been written, so the next chunk can be copied into it while this one is written. */
+		if (next < length)
+		{
+			ret = (cudaMemcpyAsync(bounce->buffers[1 - slot], (gchar const*)device_data + next, MIN(length - next, J_DEVICE_BOUNCE_SIZE), cudaMemcpyDeviceToHost, bounce->stream) == cudaSuccess)
+			      && (cudaEventRecord(bounce->events[1 - slot], bounce->stream) == cudaSuccess);
+		}
+
+		func(data, bounce->buffers[slot], chunk, offset + position, &nbytes);
+		j_helper_atomic_add(bytes_written, nbytes);
+	}
+
+	ret = (cudaStreamSynchronize(bounce->stream) == cudaSuccess) && ret;
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+#else
+	(void)device_data;
+	(void)length;
+	(void)offset;
+	(void)bytes_written;
+	(void)func;
+	(void)data;
+
+	return FALSE;
+#endif
+}
+
+/**
+ * @}
+ **/
@@ -33,6 +33,8 @@
 
 #include <jcommon.h>
 #include <jconfiguration.h>
+#include <jconnection-pool.h>
+#include <jmessage.h>
 #include <jtrace-internal.h>
 
 #include "distribution/distribution.h"
@@ -60,30 +62,101 @@ struct JDistribution
 	 */
 	gpointer distribution;
 
+	/**
+	 * The server count the actual distribution was created for.
+	 */
+	guint server_count;
+
+	/**
+	 * Whether the block size is still to be chosen from the first write's size.
+	 */
+	gboolean adaptive;
+
+	/**
+	 * The serialized distribution, NULL if it has not been serialized since the last change.
+	 */
+	bson_t* serialized;
+
 	/**
 	 * The reference count.
 	 **/
 	guint ref_count;
 };
 
-static JDistributionVTable j_distribution_vtables[3];
+static JDistributionVTable j_distribution_vtables[7];
+
+/**
+ * How long the weights reported by the servers are reused, in microseconds.
+ */
+#define J_DISTRIBUTION_WEIGHTS_INTERVAL (10 * G_USEC_PER_SEC)
+
+/**
+ * The weights derived from the servers' reports and when they were determined.
+ */
+static guint* j_distribution_weights = NULL;
+static guint j_distribution_weights_count = 0;
+static gint64 j_distribution_weights_time = 0;
+
+G_LOCK_DEFINE_STATIC(j_distribution_weights);
+
+/**
+ * The range of block sizes chosen by the adaptive mode.
+ * Blocks may be larger than J_STRIPE_SIZE because the servers transfer large accesses in pieces.
+ */
+#define J_DISTRIBUTION_BLOCK_SIZE_MIN (64 * 1024)
+#define J_DISTRIBUTION_BLOCK_SIZE_MAX (16 * J_STRIPE_SIZE)
+
+/**
+ * Discards the cached serialized distribution.
+ * Must be called whenever the distribution is modified.
+ */
+static
+void
+j_distribution_invalidate (JDistribution* distribution)
+{
+	bson_t* serialized;
+
+	if ((serialized = g_atomic_pointer_get(&(distribution->serialized))) != NULL)
+	{
+		distribution->serialized = NULL;
+		bson_destroy(serialized);
+		g_slice_free(bson_t, serialized);
+	}
+}
 
 static
 JDistribution*
 j_distribution_new_common (JDistributionType type, JConfiguration* configuration)
 {
 	JDistribution* distribution;
+	guint64 block_size;
 	guint server_count;
+	guint32 local_index;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
 	server_count = j_configuration_get_object_server_count(configuration);
+	block_size = j_configuration_get_block_size(configuration);
 
 	distribution = g_slice_new(JDistribution);
 	distribution->type = type;
 	distribution->distribution = j_distribution_vtables[type].distribution_new(server_count);
+	distribution->server_count = server_count;
+	distribution->adaptive = FALSE;
+	distribution->serialized = NULL;
 	distribution->ref_count = 1;
 
+	if (block_size != J_STRIPE_SIZE && j_distribution_vtables[type].distribution_set != NULL)
+	{
+		j_distribution_vtables[type].distribution_set(distribution->distribution, "block-size", block_size);
+	}
+
+	/* Readers use the serialized index, so the local server is only looked up for new distributions. */
+	if (type == J_DISTRIBUTION_LOCAL && j_configuration_get_object_server_local(configuration, &local_index))
+	{
+		j_distribution_vtables[type].distribution_set(distribution->distribution, "index", local_index);
+	}
+
 	j_trace_leave(G_STRFUNC);
 
 	return distribution;
@@ -162,6 +235,7 @@ j_distribution_unref (JDistribution* distribution)
 
 	if (g_atomic_int_dec_and_test(&(distribution->ref_count)))
 	{
+		j_distribution_invalidate(distribution);
 		j_distribution_vtables[distribution->type].distribution_free(distribution->distribution);
 
 		g_slice_free(JDistribution, distribution);
@@ -187,12 +261,193 @@ j_distribution_set_block_size (JDistribution* distribution, guint64 block_size)
 	g_return_if_fail(distribution != NULL);
 	g_return_if_fail(block_size > 0);
 
+	j_distribution_invalidate(distribution);
+
 	if (j_distribution_vtables[distribution->type].distribution_set != NULL)
 	{
 		j_distribution_vtables[distribution->type].distribution_set(distribution->distribution, "block-size", MIN(block_size, J_STRIPE_SIZE));
 	}
 }
 
+/**
+ * Returns the number of servers a stripe of blocks is spread across.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The stripe width.
+ **/
+static
+guint
+j_distribution_get_stripe_width (JDistribution* distribution)
+{
+	guint data_count;
+	guint parity_count;
+	guint64 block_size;
+
+	if (distribution->type == J_DISTRIBUTION_SINGLE_SERVER)
+	{
+		return 1;
+	}
+
+	if (j_distribution_get_stripe(distribution, &data_count, &parity_count, &block_size))
+	{
+		return data_count;
+	}
+
+	return MAX(distribution->server_count / j_distribution_get_replica_count(distribution), 1);
+}
+
+/**
+ * Returns the block size for the distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The block size.
+ */
+guint64
+j_distribution_get_block_size (JDistribution* distribution)
+{
+	guint64 block_size = J_STRIPE_SIZE;
+
+	g_return_val_if_fail(distribution != NULL, J_STRIPE_SIZE);
+
+	if (j_distribution_vtables[distribution->type].distribution_get_block_size != NULL)
+	{
+		block_size = j_distribution_vtables[distribution->type].distribution_get_block_size(distribution->distribution);
+	}
+
+	return block_size;
+}
+
+/**
+ * Returns the access size that covers one block on each server of a stripe.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The access size.
+ */
+guint64
+j_distribution_get_optimal_access_size (JDistribution* distribution)
+{
+	g_return_val_if_fail(distribution != NULL, J_STRIPE_SIZE);
+
+	return j_distribution_get_block_size(distribution) * j_distribution_get_stripe_width(distribution);
+}
+
+/**
+ * Chooses the block size for an object of the given size.
+ * The object is spread across the whole stripe, using as few blocks per server as possible.
+ * Small objects use smaller blocks so they still reach several servers,
+ * large objects use larger blocks so they need fewer messages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * d = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+ * j_distribution_set_expected_size(d, 100 * 1024 * 1024);
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param size         The object's expected size.
+ */
+void
+j_distribution_set_expected_size (JDistribution* distribution, guint64 size)
+{
+	guint64 block_size;
+	guint64 per_server;
+	guint width;
+
+	g_return_if_fail(distribution != NULL);
+
+	if (j_distribution_vtables[distribution->type].distribution_set == NULL)
+	{
+		return;
+	}
+
+	j_distribution_invalidate(distribution);
+
+	width = j_distribution_get_stripe_width(distribution);
+	per_server = (size / width) + ((size % width != 0) ? 1 : 0);
+
+	block_size = J_DISTRIBUTION_BLOCK_SIZE_MIN;
+
+	while (block_size < per_server && block_size < J_DISTRIBUTION_BLOCK_SIZE_MAX)
+	{
+		block_size *= 2;
+	}
+
+	j_distribution_vtables[distribution->type].distribution_set(distribution->distribution, "block-size", block_size);
+
+	distribution->adaptive = FALSE;
+}
+
+/**
+ * Lets the distribution choose its block size from the size of the first write.
+ * Has no effect once a block size has been chosen using j_distribution_set_expected_size().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ */
+void
+j_distribution_set_adaptive (JDistribution* distribution)
+{
+	g_return_if_fail(distribution != NULL);
+
+	distribution->adaptive = TRUE;
+}
+
+/**
+ * Chooses the block size of an adaptive distribution if it has not been chosen yet.
+ * Must be called before data is written using the distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param size         The size the first write extends the object to.
+ *
+ * \return TRUE if the block size has been chosen, FALSE otherwise.
+ */
+gboolean
+j_distribution_adapt (JDistribution* distribution, guint64 size)
+{
+	g_return_val_if_fail(distribution != NULL, FALSE);
+
+	if (!distribution->adaptive)
+	{
+		return FALSE;
+	}
+
+	j_distribution_set_expected_size(distribution, size);
+
+	return TRUE;
+}
+
 /**
  * Sets the start index for the round robin distribution.
  *
@@ -210,6 +465,8 @@ j_distribution_set (JDistribution* distribution, gchar const* key, guint64 value
 	g_return_if_fail(distribution != NULL);
 	g_return_if_fail(key != NULL);
 
+	j_distribution_invalidate(distribution);
+
 	if (j_distribution_vtables[distribution->type].distribution_set != NULL)
 	{
 		j_distribution_vtables[distribution->type].distribution_set(distribution->distribution, key, value);
@@ -222,6 +479,8 @@ j_distribution_set2 (JDistribution* distribution, gchar const* key, guint64 valu
 	g_return_if_fail(distribution != NULL);
 	g_return_if_fail(key != NULL);
 
+	j_distribution_invalidate(distribution);
+
 	if (j_distribution_vtables[distribution->type].distribution_set2 != NULL)
 	{
 		j_distribution_vtables[distribution->type].distribution_set2(distribution->distribution, key, value1, value2);
@@ -253,6 +512,10 @@ j_distribution_init (void)
 	j_distribution_round_robin_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_ROUND_ROBIN]));
 	j_distribution_single_server_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_SINGLE_SERVER]));
 	j_distribution_weighted_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_WEIGHTED]));
+	j_distribution_rendezvous_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_RENDEZVOUS]));
+	j_distribution_replicated_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_REPLICATED]));
+	j_distribution_erasure_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_ERASURE]));
+	j_distribution_local_get_vtable(&(j_distribution_vtables[J_DISTRIBUTION_LOCAL]));
 
 	j_distribution_check_vtables();
 }
@@ -352,6 +615,44 @@ j_distribution_serialize (JDistribution* distribution)
 	return b;
 }
 
+/**
+ * Returns the serialized distribution.
+ * The result is cached, so distributions shared by many items are only serialized once.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return A BSON object owned by the distribution, which is valid until the distribution is modified or freed.
+ **/
+bson_t const*
+j_distribution_serialize_cached (JDistribution* distribution)
+{
+	bson_t* serialized;
+
+	g_return_val_if_fail(distribution != NULL, NULL);
+
+	if ((serialized = g_atomic_pointer_get(&(distribution->serialized))) == NULL)
+	{
+		serialized = j_distribution_serialize(distribution);
+
+		/* Another thread might have serialized the distribution concurrently. */
+		if (!g_atomic_pointer_compare_and_exchange(&(distribution->serialized), NULL, serialized))
+		{
+			bson_destroy(serialized);
+			g_slice_free(bson_t, serialized);
+			serialized = g_atomic_pointer_get(&(distribution->serialized));
+		}
+	}
+
+	return serialized;
+}
+
 /**
  * Deserializes distribution.
  *
@@ -369,12 +670,15 @@ void
 j_distribution_deserialize (JDistribution* distribution, bson_t const* b)
 {
 	bson_iter_t iterator;
+	JDistributionType type;
 
 	g_return_if_fail(distribution != NULL);
 	g_return_if_fail(b != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	type = distribution->type;
+
 	bson_iter_init(&iterator, b);
 
 	while (bson_iter_next(&iterator))
@@ -385,10 +689,23 @@ j_distribution_deserialize (JDistribution* distribution, bson_t const* b)
 
 		if (g_strcmp0(key, "type") == 0)
 		{
-			distribution->type = bson_iter_int32(&iterator);
+			type = bson_iter_int32(&iterator);
 		}
 	}
 
+	g_return_if_fail(type < G_N_ELEMENTS(j_distribution_vtables));
+
+	j_distribution_invalidate(distribution);
+
+	/* The actual distribution's data depends on the type, so it has to be recreated. */
+	if (type != distribution->type)
+	{
+		j_distribution_vtables[distribution->type].distribution_free(distribution->distribution);
+
+		distribution->type = type;
+		distribution->distribution = j_distribution_vtables[type].distribution_new(distribution->server_count);
+	}
+
 	j_distribution_vtables[distribution->type].distribution_deserialize(distribution->distribution, b);
 
 	j_trace_leave(G_STRFUNC);
@@ -456,6 +773,360 @@ j_distribution_distribute (JDistribution* distribution, guint* index, guint64* n
 	return ret;
 }
 
+/**
+ * Distributes the next extents of the range set with j_distribution_reset().
+ * This is equivalent to calling j_distribution_distribute() up to #count times, but considerably faster for large ranges.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistributionExtent extents[64];
+ * guint count;
+ *
+ * j_distribution_reset(distribution, length, offset);
+ *
+ * while ((count = j_distribution_distribute_extents(distribution, extents, G_N_ELEMENTS(extents))) > 0)
+ * {
+ * 	...
+ * }
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extents      An array of extents.
+ * \param count        The number of elements in #extents.
+ *
+ * \return The number of extents stored in #extents, 0 if the distribution is finished.
+ **/
+guint
+j_distribution_distribute_extents (JDistribution* distribution, JDistributionExtent* extents, guint count)
+{
+	JDistributionVTable* vtable;
+	guint n = 0;
+
+	g_return_val_if_fail(distribution != NULL, 0);
+	g_return_val_if_fail(extents != NULL, 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	vtable = &(j_distribution_vtables[distribution->type]);
+
+	if (vtable->distribution_distribute_extents != NULL)
+	{
+		n = vtable->distribution_distribute_extents(distribution->distribution, extents, count);
+	}
+	else
+	{
+		while (n < count && vtable->distribution_distribute(distribution->distribution, &(extents[n].index), &(extents[n].length), &(extents[n].offset), &(extents[n].block_id)))
+		{
+			n++;
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return n;
+}
+
+/**
+ * Returns the number of copies a distribution stores of each block.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ *
+ * \return The number of copies, 1 if the distribution does not replicate.
+ **/
+guint
+j_distribution_get_replica_count (JDistribution* distribution)
+{
+	JDistributionVTable* vtable;
+	guint count = 1;
+
+	g_return_val_if_fail(distribution != NULL, 1);
+
+	vtable = &(j_distribution_vtables[distribution->type]);
+
+	if (vtable->distribution_get_replica_count != NULL)
+	{
+		count = vtable->distribution_get_replica_count(distribution->distribution);
+	}
+
+	return count;
+}
+
+/**
+ * Returns where a copy of an extent is stored.
+ * Copy 0 is the extent itself.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param extent       An extent returned by j_distribution_distribute_extents().
+ * \param replica      A copy number smaller than j_distribution_get_replica_count().
+ * \param index        A server index.
+ * \param offset       An offset on the server.
+ **/
+void
+j_distribution_get_replica (JDistribution* distribution, JDistributionExtent const* extent, guint replica, guint* index, guint64* offset)
+{
+	JDistributionVTable* vtable;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(extent != NULL);
+	g_return_if_fail(index != NULL);
+	g_return_if_fail(offset != NULL);
+
+	vtable = &(j_distribution_vtables[distribution->type]);
+
+	if (replica == 0 || vtable->distribution_get_replica == NULL)
+	{
+		g_return_if_fail(replica == 0);
+
+		*index = extent->index;
+		*offset = extent->offset;
+	}
+	else
+	{
+		vtable->distribution_get_replica(distribution->distribution, extent, replica, index, offset);
+	}
+}
+
+/**
+ * Asks the object servers for their capacity and throughput and derives weights from them.
+ * Servers get weights proportional to their free space, reduced for servers that are busier than the average.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param weights The weights.
+ * \param count   The number of servers.
+ **/
+static
+void
+j_distribution_query_weights (guint* weights, guint count)
+{
+	g_autofree guint64* free_bytes = NULL;
+	g_autofree guint64* throughput = NULL;
+	gdouble free_mean = 0.0;
+	gdouble throughput_mean = 0.0;
+	gdouble score_max = 0.0;
+	g_autofree gdouble* scores = NULL;
+	guint known = 0;
+
+	free_bytes = g_new0(guint64, count);
+	throughput = g_new0(guint64, count);
+	scores = g_new0(gdouble, count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+		guint64 size_bytes;
+
+		message = j_message_new(J_MESSAGE_OBJECT_CAPACITY, 0);
+		j_message_add_operation(message, 0);
+
+		reply = j_connection_pool_request_object(i, message, TRUE);
+
+		if (reply == NULL)
+		{
+			continue;
+		}
+
+		free_bytes[i] = j_message_get_8(reply);
+		size_bytes = j_message_get_8(reply);
+		throughput[i] = j_message_get_8(reply);
+
+		/* Servers whose capacity is unknown are treated like an average server. */
+		if (size_bytes > 0)
+		{
+			free_mean += free_bytes[i];
+			known++;
+		}
+		else
+		{
+			free_bytes[i] = G_MAXUINT64;
+		}
+
+		throughput_mean += throughput[i];
+	}
+
+	free_mean = (known > 0) ? free_mean / known : 1.0;
+	throughput_mean = throughput_mean / count;
+
+	for (guint i = 0; i < count; i++)
+	{
+		gdouble capacity;
+
+		capacity = (free_bytes[i] == G_MAXUINT64) ? free_mean : free_bytes[i];
+		scores[i] = capacity / (1.0 + (throughput[i] / (throughput_mean + 1.0)));
+		score_max = MAX(score_max, scores[i]);
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		/* Weights must be smaller than 256 and at least one of them must not be zero. */
+		weights[i] = (score_max > 0.0) ? (guint)((255.0 * scores[i] / score_max) + 0.5) : 1;
+	}
+}
+
+/**
+ * Sets the weights of a weighted distribution according to the object servers' current state.
+ * The servers report their free space and throughput, so new objects favor servers with more free space and less load.
+ * The weights are serialized with the distribution, so existing objects can still be read after the servers' state changes.
+ * The servers' reports are reused for a few seconds to avoid querying them for every object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JDistribution* d;
+ *
+ * d = j_distribution_new(J_DISTRIBUTION_WEIGHTED);
+ * j_distribution_set_weights_from_servers(d);
+ * \endcode
+ *
+ * \param distribution A weighted distribution.
+ **/
+void
+j_distribution_set_weights_from_servers (JDistribution* distribution)
+{
+	g_autofree guint* weights = NULL;
+	gint64 now;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(distribution->type == J_DISTRIBUTION_WEIGHTED);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	weights = g_new(guint, distribution->server_count);
+	now = g_get_monotonic_time();
+
+	G_LOCK(j_distribution_weights);
+
+	if (j_distribution_weights_count != distribution->server_count || now - j_distribution_weights_time >= J_DISTRIBUTION_WEIGHTS_INTERVAL)
+	{
+		g_free(j_distribution_weights);
+
+		j_distribution_weights = g_new(guint, distribution->server_count);
+		j_distribution_weights_count = distribution->server_count;
+		j_distribution_weights_time = now;
+
+		j_distribution_query_weights(j_distribution_weights, j_distribution_weights_count);
+	}
+
+	for (guint i = 0; i < distribution->server_count; i++)
+	{
+		weights[i] = j_distribution_weights[i];
+	}
+
+	G_UNLOCK(j_distribution_weights);
+
+	/* Raise weights before lowering others, so the sum of all weights never drops to zero. */
+	for (guint i = 0; i < distribution->server_count; i++)
+	{
+		if (weights[i] > 0)
+		{
+			j_distribution_set2(distribution, "weight", i, weights[i]);
+		}
+	}
+
+	for (guint i = 0; i < distribution->server_count; i++)
+	{
+		if (weights[i] == 0)
+		{
+			j_distribution_set2(distribution, "weight", i, 0);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Returns the stripe layout of an erasure coded distribution.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint data_count;
+ * guint parity_count;
+ * guint64 block_size;
+ *
+ * if (j_distribution_get_stripe(d, &data_count, &parity_count, &block_size))
+ * {
+ *   ...
+ * }
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param data_count   The number of data blocks per stripe.
+ * \param parity_count The number of parity blocks per stripe.
+ * \param block_size   The block size.
+ *
+ * \return TRUE if the distribution is erasure coded, FALSE otherwise.
+ **/
+gboolean
+j_distribution_get_stripe (JDistribution* distribution, guint* data_count, guint* parity_count, guint64* block_size)
+{
+	JDistributionVTable* vtable;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(distribution != NULL, FALSE);
+	g_return_val_if_fail(data_count != NULL, FALSE);
+	g_return_val_if_fail(parity_count != NULL, FALSE);
+	g_return_val_if_fail(block_size != NULL, FALSE);
+
+	vtable = &(j_distribution_vtables[distribution->type]);
+
+	if (vtable->distribution_get_stripe != NULL)
+	{
+		ret = vtable->distribution_get_stripe(distribution->distribution, data_count, parity_count, block_size);
+	}
+
+	return ret;
+}
+
+/**
+ * Returns where a chunk of a stripe is stored.
+ * The data chunks are followed by the parity chunks.
+ * Only valid for distributions for which j_distribution_get_stripe() returns TRUE.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param distribution A distribution.
+ * \param stripe       A stripe.
+ * \param chunk        A chunk.
+ * \param index        A server index.
+ * \param offset       An offset on the server.
+ **/
+void
+j_distribution_get_chunk (JDistribution* distribution, guint64 stripe, guint chunk, guint* index, guint64* offset)
+{
+	JDistributionVTable* vtable;
+
+	g_return_if_fail(distribution != NULL);
+	g_return_if_fail(index != NULL);
+	g_return_if_fail(offset != NULL);
+
+	vtable = &(j_distribution_vtables[distribution->type]);
+
+	g_return_if_fail(vtable->distribution_get_chunk != NULL);
+
+	vtable->distribution_get_chunk(distribution->distribution, stripe, chunk, index, offset);
+}
+
 /**
  * @}
  **/
@@ -0,0 +1,624 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <tmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <string.h>
+
+#include <jerasure.h>
+
+#include <jtrace-internal.h>
+
+/**
+ * \defgroup JErasure Erasure
+ *
+ * Reed-Solomon erasure coding over GF(2^8).
+ *
+ * Blocks are split into data and parity blocks.
+ * Any data blocks can be reconstructed as long as at least as many blocks as there are data blocks are available.
+ *
+ * @{
+ **/
+
+/**
+ * The size of the multiplication tables for one coefficient.
+ * The first half contains the products with the low nibbles, the second half the ones with the high nibbles.
+ **/
+#define J_ERASURE_TABLE_SIZE 32
+
+/**
+ * An erasure code.
+ **/
+struct JErasure
+{
+	/**
+	 * The number of data blocks.
+	 **/
+	guint data_count;
+
+	/**
+	 * The number of parity blocks.
+	 **/
+	guint parity_count;
+
+	/**
+	 * The coding matrix with parity_count rows and data_count columns.
+	 **/
+	guint8* matrix;
+
+	/**
+	 * The multiplication tables for the coding matrix's coefficients.
+	 **/
+	guint8* tables;
+};
+
+/**
+ * The logarithm and exponential tables for GF(2^8).
+ * The exponential table is doubled to avoid reducing sums of logarithms.
+ **/
+static guint8 j_erasure_log[256];
+static guint8 j_erasure_exp[512];
+
+static
+gpointer
+j_erasure_init (gpointer data)
+{
+	guint x = 1;
+
+	(void)data;
+
+	for (guint i = 0; i < 255; i++)
+	{
+		j_erasure_exp[i] = x;
+		j_erasure_exp[i + 255] = x;
+		j_erasure_log[x] = i;
+
+		/* Multiply by the generator 2, reducing by x^8 + x^4 + x^3 + x^2 + 1. */
+		x <<= 1;
+
+		if (x & 0x100)
+		{
+			x ^= 0x11D;
+		}
+	}
+
+	j_erasure_exp[510] = j_erasure_exp[0];
+	j_erasure_exp[511] = j_erasure_exp[1];
+
+	return NULL;
+}
+
+static
+guint8
+j_erasure_multiply (guint8 a, guint8 b)
+{
+	if (a == 0 || b == 0)
+	{
+		return 0;
+	}
+
+	return j_erasure_exp[j_erasure_log[a] + j_erasure_log[b]];
+}
+
+static
+guint8
+j_erasure_inverse (guint8 a)
+{
+	g_return_val_if_fail(a != 0, 0);
+
+	return j_erasure_exp[255 - j_erasure_log[a]];
+}
+
+/**
+ * Fills the multiplication tables for a coefficient.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param coefficient A coefficient.
+ * \param table       A table with J_ERASURE_TABLE_SIZE bytes.
+ **/
+static
+void
+j_erasure_fill_table (guint8 coefficient, guint8* table)
+{
+	for (guint i = 0; i < 16; i++)
+	{
+		table[i] = j_erasure_multiply(coefficient, i);
+		table[i + 16] = j_erasure_multiply(coefficient, i << 4);
+	}
+}
+
+static
+void
+j_erasure_multiply_add_software (guint8 const* table, guchar const* source, guchar* destination, gsize length)
+{
+	for (gsize i = 0; i < length; i++)
+	{
+		destination[i] ^= table[source[i] & 0x0F] ^ table[16 + (source[i] >> 4)];
+	}
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/**
+ * Multiplies a region with a coefficient and adds it to another one using SSSE3 shuffles.
+ * Each shuffle looks up sixteen nibbles at once.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param table       The coefficient's multiplication tables.
+ * \param source      The source region.
+ * \param destination The destination region.
+ * \param length      The regions' length.
+ **/
+__attribute__((target("ssse3")))
+static
+void
+j_erasure_multiply_add_hardware (guint8 const* table, guchar const* source, guchar* destination, gsize length)
+{
+	__m128i const mask = _mm_set1_epi8(0x0F);
+	__m128i const low = _mm_loadu_si128((__m128i const*)(gconstpointer)table);
+	__m128i const high = _mm_loadu_si128((__m128i const*)(gconstpointer)(table + 16));
+
+	while (length >= 16)
+	{
+		__m128i data;
+		__m128i product;
+
+		data = _mm_loadu_si128((__m128i const*)(gconstpointer)source);
+		product = _mm_xor_si128(_mm_shuffle_epi8(low, _mm_and_si128(data, mask)), _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi64(data, 4), mask)));
+		product = _mm_xor_si128(product, _mm_loadu_si128((__m128i const*)(gpointer)destination));
+		_mm_storeu_si128((__m128i*)(gpointer)destination, product);
+
+		source += 16;
+		destination += 16;
+		length -= 16;
+	}
+
+	j_erasure_multiply_add_software(table, source, destination, length);
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/**
+ * Multiplies a region with a coefficient and adds it to another one using NEON table lookups.
+ * Each lookup translates sixteen nibbles at once.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param table       The coefficient's multiplication tables.
+ * \param source      The source region.
+ * \param destination The destination region.
+ * \param length      The regions' length.
+ **/
+static
+void
+j_erasure_multiply_add_hardware (guint8 const* table, guchar const* source, guchar* destination, gsize length)
+{
+	uint8x16_t const mask = vdupq_n_u8(0x0F);
+	uint8x16_t const low = vld1q_u8(table);
+	uint8x16_t const high = vld1q_u8(table + 16);
+
+	while (length >= 16)
+	{
+		uint8x16_t data;
+		uint8x16_t product;
+
+		data = vld1q_u8(source);
+		product = veorq_u8(vqtbl1q_u8(low, vandq_u8(data, mask)), vqtbl1q_u8(high, vshrq_n_u8(data, 4)));
+		vst1q_u8(destination, veorq_u8(product, vld1q_u8(destination)));
+
+		source += 16;
+		destination += 16;
+		length -= 16;
+	}
+
+	j_erasure_multiply_add_software(table, source, destination, length);
+}
+#endif
+
+/**
+ * Multiplies a region with a coefficient and adds it to another one.
+ * Uses the processor's vector instructions if available.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param table       The coefficient's multiplication tables.
+ * \param source      The source region.
+ * \param destination The destination region.
+ * \param length      The regions' length.
+ **/
+static
+void
+j_erasure_multiply_add (guint8 const* table, guchar const* source, guchar* destination, gsize length)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		j_erasure_multiply_add_hardware(table, source, destination, length);
+		return;
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	j_erasure_multiply_add_hardware(table, source, destination, length);
+	return;
+#endif
+
+	j_erasure_multiply_add_software(table, source, destination, length);
+}
+
+/**
+ * Inverts a square matrix using Gauss-Jordan elimination.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param matrix  A matrix, will be destroyed.
+ * \param inverse The inverse.
+ * \param size    The number of rows and columns.
+ *
+ * \return TRUE if the matrix could be inverted, FALSE otherwise.
+ **/
+static
+gboolean
+j_erasure_invert (guint8* matrix, guint8* inverse, guint size)
+{
+	for (guint i = 0; i < size; i++)
+	{
+		for (guint j = 0; j < size; j++)
+		{
+			inverse[i * size + j] = (i == j) ? 1 : 0;
+		}
+	}
+
+	for (guint i = 0; i < size; i++)
+	{
+		guint8 factor;
+
+		if (matrix[i * size + i] == 0)
+		{
+			guint pivot;
+
+			for (pivot = i + 1; pivot < size; pivot++)
+			{
+				if (matrix[pivot * size + i] != 0)
+				{
+					break;
+				}
+			}
+
+			if (pivot == size)
+			{
+				return FALSE;
+			}
+
+			for (guint j = 0; j < size; j++)
+			{
+				guint8 tmp;
+
+				tmp = matrix[i * size + j];
+				matrix[i * size + j] = matrix[pivot * size + j];
+				matrix[pivot * size + j] = tmp;
+
+				tmp = inverse[i * size + j];
+				inverse[i * size + j] = inverse[pivot * size + j];
+				inverse[pivot * size + j] = tmp;
+			}
+		}
+
+		factor = j_erasure_inverse(matrix[i * size + i]);
+
+		for (guint j = 0; j < size; j++)
+		{
+			matrix[i * size + j] = j_erasure_multiply(matrix[i * size + j], factor);
+			inverse[i * size + j] = j_erasure_multiply(inverse[i * size + j], factor);
+		}
+
+		for (guint row = 0; row < size; row++)
+		{
+			if (row == i || matrix[row * size + i] == 0)
+			{
+				continue;
+			}
+
+			factor = matrix[row * size + i];
+
+			for (guint j = 0; j < size; j++)
+			{
+				matrix[row * size + j] ^= j_erasure_multiply(matrix[i * size + j], factor);
+				inverse[row * size + j] ^= j_erasure_multiply(inverse[i * size + j], factor);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Creates a new erasure code.
+ * The parity blocks are computed using a Cauchy matrix, so any square submatrix of the coding matrix is invertible.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JErasure* erasure;
+ *
+ * erasure = j_erasure_new(4, 2);
+ * \endcode
+ *
+ * \param data_count   The number of data blocks.
+ * \param parity_count The number of parity blocks.
+ *
+ * \return A new erasure code. Should be freed with j_erasure_free().
+ **/
+JErasure*
+j_erasure_new (guint data_count, guint parity_count)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	JErasure* erasure;
+
+	g_return_val_if_fail(data_count > 0, NULL);
+	g_return_val_if_fail(data_count + parity_count <= 256, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_once(&once, j_erasure_init, NULL);
+
+	erasure = g_slice_new(JErasure);
+	erasure->data_count = data_count;
+	erasure->parity_count = parity_count;
+	erasure->matrix = g_new(guint8, parity_count * data_count);
+	erasure->tables = g_new(guint8, parity_count * data_count * J_ERASURE_TABLE_SIZE);
+
+	for (guint i = 0; i < parity_count; i++)
+	{
+		for (guint j = 0; j < data_count; j++)
+		{
+			guint8 coefficient;
+
+			coefficient = j_erasure_inverse((data_count + i) ^ j);
+
+			erasure->matrix[i * data_count + j] = coefficient;
+			j_erasure_fill_table(coefficient, erasure->tables + ((i * data_count + j) * J_ERASURE_TABLE_SIZE));
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return erasure;
+}
+
+/**
+ * Frees the memory allocated for an erasure code.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param erasure An erasure code.
+ **/
+void
+j_erasure_free (JErasure* erasure)
+{
+	g_return_if_fail(erasure != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_free(erasure->matrix);
+	g_free(erasure->tables);
+
+	g_slice_free(JErasure, erasure);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Computes parity blocks.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param erasure An erasure code.
+ * \param data    The data blocks.
+ * \param parity  The parity blocks.
+ * \param length  The blocks' length.
+ **/
+void
+j_erasure_encode (JErasure* erasure, gconstpointer const* data, gpointer* parity, gsize length)
+{
+	g_return_if_fail(erasure != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(parity != NULL || erasure->parity_count == 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	for (guint i = 0; i < erasure->parity_count; i++)
+	{
+		memset(parity[i], 0, length);
+
+		for (guint j = 0; j < erasure->data_count; j++)
+		{
+			j_erasure_multiply_add(erasure->tables + ((i * erasure->data_count + j) * J_ERASURE_TABLE_SIZE), data[j], parity[i], length);
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Reconstructs missing blocks.
+ * The data blocks are followed by the parity blocks.
+ * Missing blocks' buffers are overwritten with their reconstructed contents.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param erasure An erasure code.
+ * \param blocks  The data and parity blocks.
+ * \param present Whether the blocks are available.
+ * \param length  The blocks' length.
+ *
+ * \return TRUE if all blocks could be reconstructed, FALSE if too few blocks are available.
+ **/
+gboolean
+j_erasure_decode (JErasure* erasure, gpointer* blocks, gboolean const* present, gsize length)
+{
+	gboolean ret = FALSE;
+	g_autofree guint8* matrix = NULL;
+	g_autofree guint8* inverse = NULL;
+	g_autofree guint* rows = NULL;
+	guint8 table[J_ERASURE_TABLE_SIZE];
+	guint k;
+	guint n = 0;
+	gboolean data_missing = FALSE;
+
+	g_return_val_if_fail(erasure != NULL, FALSE);
+	g_return_val_if_fail(blocks != NULL, FALSE);
+	g_return_val_if_fail(present != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	k = erasure->data_count;
+	rows = g_new(guint, k);
+
+	for (guint i = 0; i < k + erasure->parity_count && n < k; i++)
+	{
+		if (present[i])
+		{
+			rows[n] = i;
+			n++;
+		}
+		else if (i < k)
+		{
+			data_missing = TRUE;
+		}
+	}
+
+	if (n < k)
+	{
+		goto end;
+	}
+
+	if (data_missing)
+	{
+		matrix = g_new(guint8, k * k);
+		inverse = g_new(guint8, k * k);
+
+		/* The rows of the coding matrix that belong to the available blocks. */
+		for (guint i = 0; i < k; i++)
+		{
+			for (guint j = 0; j < k; j++)
+			{
+				if (rows[i] < k)
+				{
+					matrix[i * k + j] = (rows[i] == j) ? 1 : 0;
+				}
+				else
+				{
+					matrix[i * k + j] = erasure->matrix[(rows[i] - k) * k + j];
+				}
+			}
+		}
+
+		if (!j_erasure_invert(matrix, inverse, k))
+		{
+			goto end;
+		}
+
+		for (guint i = 0; i < k; i++)
+		{
+			if (present[i])
+			{
+				continue;
+			}
+
+			memset(blocks[i], 0, length);
+
+			for (guint j = 0; j < k; j++)
+			{
+				j_erasure_fill_table(inverse[i * k + j], table);
+				j_erasure_multiply_add(table, blocks[rows[j]], blocks[i], length);
+			}
+		}
+	}
+
+	/* Missing parity blocks are recomputed from the complete data blocks. */
+	for (guint i = 0; i < erasure->parity_count; i++)
+	{
+		if (present[k + i])
+		{
+			continue;
+		}
+
+		memset(blocks[k + i], 0, length);
+
+		for (guint j = 0; j < k; j++)
+		{
+			j_erasure_multiply_add(erasure->tables + ((i * k + j) * J_ERASURE_TABLE_SIZE), blocks[j], blocks[k + i], length);
+		}
+	}
+
+	ret = TRUE;
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * @}
+ **/
@@ -22,11 +22,29 @@
 
 #include <julea-config.h>
 
+#ifdef HAVE_MADV_HUGEPAGE
+/* Required for MADV_HUGEPAGE and MAP_HUGETLB */
+#define _GNU_SOURCE
+#endif
+
 #include <glib.h>
 #include <gio/gio.h>
 
 #include <bson.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_MADV_HUGEPAGE
+#include <sys/mman.h>
+#endif
+
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
@@ -36,6 +54,7 @@
 #include <jhelper-internal.h>
 
 #include <jbackground-operation.h>
+#include <jbackground-operation-internal.h>
 #include <jsemantics.h>
 #include <jtrace-internal.h>
 
@@ -87,6 +106,66 @@ j_helper_set_cork (GSocketConnection* connection, gboolean enable)
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Returns the path of the UNIX domain socket a server listens on for local clients.
+ * The path only depends on the server's port, so clients can derive it on their own.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * gchar* path;
+ *
+ * path = j_helper_get_local_socket_path(4711);
+ * \endcode
+ *
+ * \param port A port.
+ *
+ * \return A new path that should be freed with g_free().
+ **/
+gchar*
+j_helper_get_local_socket_path (guint port)
+{
+	return g_strdup_printf("/tmp/julea-%u.socket", port);
+}
+
+/**
+ * Checks whether a server runs on the local host.
+ * Servers are compared to the host name, with or without its domain.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param server A server.
+ *
+ * \return TRUE if the server is local, FALSE otherwise.
+ **/
+gboolean
+j_helper_is_local_host (gchar const* server)
+{
+	gchar const* host_name;
+	gsize host_name_len;
+
+	g_return_val_if_fail(server != NULL, FALSE);
+
+	if (g_strcmp0(server, "localhost") == 0 || g_strcmp0(server, "::1") == 0 || g_str_has_prefix(server, "127."))
+	{
+		return TRUE;
+	}
+
+	host_name = g_get_host_name();
+	host_name_len = strcspn(host_name, ".");
+
+	if (g_ascii_strcasecmp(server, host_name) == 0)
+	{
+		return TRUE;
+	}
+
+	/* Also accept the short host name. */
+	return (strlen(server) == host_name_len && g_ascii_strncasecmp(server, host_name, host_name_len) == 0);
+}
+
 void
 j_helper_get_number_string (gchar* string, guint32 length, guint32 number)
 {
@@ -100,70 +179,168 @@ j_helper_get_number_string (gchar* string, guint32 length, guint32 number)
 gboolean
 j_helper_execute_parallel (JBackgroundOperationFunc func, gpointer* data, guint length)
 {
-	JBackgroundOperation** operations;
-	guint data_count = 0;
+	j_background_operation_execute_parallel(func, data, length);
 
-	operations = g_new(JBackgroundOperation*, length);
+	return TRUE;
+}
+
+guint64
+j_helper_atomic_add (guint64 volatile* ptr, guint64 val)
+{
+	guint64 ret;
 
-	for (guint i = 0; i < length; i++)
+	// FIXME check C11 atomic_fetch_add
+#ifdef HAVE_SYNC_FETCH_AND_ADD
+	ret = __sync_fetch_and_add(ptr, val);
+#else
+	G_LOCK_DEFINE_STATIC(j_helper_atomic_add);
+
+	G_LOCK(j_helper_atomic_add);
+	ret = *ptr;
+	*ptr += val;
+	G_UNLOCK(j_helper_atomic_add);
+#endif
+
+	return ret;
+}
+
+/**
+ * Whether large buffers are mapped explicitly, see j_helper_set_huge_pages().
+ **/
+static gboolean j_helper_huge_pages = FALSE;
+
+/**
+ * Sets whether large buffers are backed by huge pages.
+ * Has to be called before any buffers are allocated using j_helper_alloc_huge().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param enable Whether buffers should be mapped using explicit huge pages, falling back to transparent ones.
+ **/
+void
+j_helper_set_huge_pages (gboolean enable)
+{
+	j_helper_huge_pages = enable;
+}
+
+/**
+ * Allocates a buffer that can be backed by huge pages.
+ * It is aligned to J_HELPER_HUGE_PAGE_SIZE, so it should only be used for buffers of at least this size.
+ *
+ * Without huge pages enabled, the buffer is only marked as a candidate for transparent huge pages.
+ * Otherwise, it is mapped using explicit huge pages if some have been reserved and using transparent ones if not.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size A size.
+ *
+ * \return A buffer. Should be freed with j_helper_free_huge().
+ **/
+gpointer
+j_helper_alloc_huge (gsize size)
+{
+	gpointer data;
+	gsize alignment = 4096;
+
+	g_return_val_if_fail(size > 0, NULL);
+
+#ifdef HAVE_MADV_HUGEPAGE
+	if (j_helper_huge_pages)
 	{
-		operations[i] = NULL;
+		gchar* mapping;
+		gchar* aligned;
+		gsize length;
+		gsize head;
+
+		length = (size + J_HELPER_HUGE_PAGE_SIZE - 1) & ~((gsize)J_HELPER_HUGE_PAGE_SIZE - 1);
 
-		if (data[i] != NULL)
+#ifdef MAP_HUGETLB
+		data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (data != MAP_FAILED)
 		{
-			data_count++;
+			return data;
 		}
-	}
+#endif
 
-	for (guint i = 0; i < length; i++)
-	{
-		if (data[i] == NULL)
+		/* No huge pages have been reserved, map one additional huge page to be able to align the buffer for transparent ones. */
+		mapping = mmap(NULL, length + J_HELPER_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (mapping == MAP_FAILED)
 		{
-			continue;
+			g_error("%s: failed to map %" G_GSIZE_FORMAT " bytes", G_STRLOC, length);
 		}
 
-		if (data_count > 1)
+		aligned = (gchar*)(((guintptr)mapping + J_HELPER_HUGE_PAGE_SIZE - 1) & ~((guintptr)J_HELPER_HUGE_PAGE_SIZE - 1));
+		head = aligned - mapping;
+
+		if (head > 0)
 		{
-			operations[i] = j_background_operation_new(func, data[i]);
+			munmap(mapping, head);
 		}
-		else
+
+		if (head < J_HELPER_HUGE_PAGE_SIZE)
 		{
-			data[i] = func(data[i]);
+			munmap(aligned + length, J_HELPER_HUGE_PAGE_SIZE - head);
 		}
+
+		madvise(aligned, length, MADV_HUGEPAGE);
+
+		return aligned;
 	}
 
-	for (guint i = 0; i < length; i++)
+	alignment = J_HELPER_HUGE_PAGE_SIZE;
+#endif
+
+	if (posix_memalign(&data, alignment, size) != 0)
 	{
-		if (operations[i] != NULL)
-		{
-			data[i] = j_background_operation_wait(operations[i]);
-			j_background_operation_unref(operations[i]);
-		}
+		g_error("%s: failed to allocate %" G_GSIZE_FORMAT " bytes", G_STRLOC, size);
 	}
 
-	g_free(operations);
+#ifdef HAVE_MADV_HUGEPAGE
+	/* This is only a hint, huge pages might not be available. */
+	madvise(data, size, MADV_HUGEPAGE);
+#endif
 
-	return TRUE;
+	return data;
 }
 
-guint64
-j_helper_atomic_add (guint64 volatile* ptr, guint64 val)
+/**
+ * Frees a buffer allocated by j_helper_alloc_huge().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data A buffer.
+ * \param size The size the buffer has been allocated with.
+ **/
+void
+j_helper_free_huge (gpointer data, gsize size)
 {
-	guint64 ret;
+	if (data == NULL)
+	{
+		return;
+	}
 
-	// FIXME check C11 atomic_fetch_add
-#ifdef HAVE_SYNC_FETCH_AND_ADD
-	ret = __sync_fetch_and_add(ptr, val);
+#ifdef HAVE_MADV_HUGEPAGE
+	if (j_helper_huge_pages)
+	{
+		munmap(data, (size + J_HELPER_HUGE_PAGE_SIZE - 1) & ~((gsize)J_HELPER_HUGE_PAGE_SIZE - 1));
+		return;
+	}
 #else
-	G_LOCK_DEFINE_STATIC(j_helper_atomic_add);
-
-	G_LOCK(j_helper_atomic_add);
-	ret = *ptr;
-	*ptr += val;
-	G_UNLOCK(j_helper_atomic_add);
+	(void)size;
 #endif
 
-	return ret;
+	free(data);
 }
 
 guint32
@@ -182,6 +359,645 @@ j_helper_hash (gchar const* str)
 	return hash;
 }
 
+/**
+ * Returns the path of a name within a hashed directory hierarchy.
+ * Each level consists of up to 256 directories, so that a large number of names can be spread over small directories.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * gchar* path;
+ *
+ * // Returns something like "3f/a1/name".
+ * path = j_helper_get_fanout_path("name", 2);
+ * \endcode
+ *
+ * \param name  A name.
+ * \param depth The number of directory levels, at most 4.
+ *
+ * \return A new path that should be freed with g_free().
+ **/
+gchar*
+j_helper_get_fanout_path (gchar const* name, guint depth)
+{
+	GString* path;
+	guint32 hash;
+
+	g_return_val_if_fail(name != NULL, NULL);
+	g_return_val_if_fail(depth <= 4, NULL);
+
+	/* Objects are distributed using the low bits of j_helper_hash(), so the hash is mixed to make all bits usable. */
+	hash = j_helper_hash(name);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+
+	path = g_string_new(NULL);
+
+	for (guint i = 0; i < depth; i++)
+	{
+		g_string_append_printf(path, "%02x/", (hash >> (i * 8)) & 0xff);
+	}
+
+	g_string_append(path, name);
+
+	return g_string_free(path, FALSE);
+}
+
+
+/**
+ * Compares two BSON values.
+ * Numbers of different types are compared by value.
+ *
+ * \return TRUE if the values are comparable, FALSE otherwise.
+ **/
+static
+gboolean
+j_helper_bson_compare (bson_iter_t const* a, bson_iter_t const* b, gint* result)
+{
+	bson_type_t type_a = bson_iter_type(a);
+	bson_type_t type_b = bson_iter_type(b);
+
+	if (BSON_ITER_HOLDS_NUMBER(a) && BSON_ITER_HOLDS_NUMBER(b))
+	{
+		if (type_a == BSON_TYPE_DOUBLE || type_b == BSON_TYPE_DOUBLE)
+		{
+			gdouble value_a = bson_iter_as_double(a);
+			gdouble value_b = bson_iter_as_double(b);
+
+			*result = (value_a > value_b) - (value_a < value_b);
+		}
+		else
+		{
+			gint64 value_a = bson_iter_as_int64(a);
+			gint64 value_b = bson_iter_as_int64(b);
+
+			*result = (value_a > value_b) - (value_a < value_b);
+		}
+
+		return TRUE;
+	}
+
+	if (type_a != type_b)
+	{
+		return FALSE;
+	}
+
+	switch (type_a)
+	{
+		case BSON_TYPE_UTF8:
+			*result = g_strcmp0(bson_iter_utf8(a, NULL), bson_iter_utf8(b, NULL));
+			return TRUE;
+		case BSON_TYPE_BOOL:
+			*result = (gint)bson_iter_bool(a) - (gint)bson_iter_bool(b);
+			return TRUE;
+		case BSON_TYPE_OID:
+			*result = bson_oid_compare(bson_iter_oid(a), bson_iter_oid(b));
+			return TRUE;
+		case BSON_TYPE_DATE_TIME:
+			*result = (bson_iter_date_time(a) > bson_iter_date_time(b)) - (bson_iter_date_time(a) < bson_iter_date_time(b));
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/**
+ * Checks a single condition of a filter.
+ **/
+static
+gboolean
+j_helper_bson_match_condition (bson_iter_t const* field, gboolean exists, gchar const* operator, bson_iter_t const* operand)
+{
+	gint result;
+
+	if (g_strcmp0(operator, "$exists") == 0)
+	{
+		return (exists == bson_iter_as_bool(operand));
+	}
+
+	if (!exists || !j_helper_bson_compare(field, operand, &result))
+	{
+		/* Missing and incomparable fields are not equal to anything. */
+		return (g_strcmp0(operator, "$ne") == 0);
+	}
+
+	if (g_strcmp0(operator, "$eq") == 0)
+	{
+		return (result == 0);
+	}
+	else if (g_strcmp0(operator, "$ne") == 0)
+	{
+		return (result != 0);
+	}
+	else if (g_strcmp0(operator, "$lt") == 0)
+	{
+		return (result < 0);
+	}
+	else if (g_strcmp0(operator, "$lte") == 0)
+	{
+		return (result <= 0);
+	}
+	else if (g_strcmp0(operator, "$gt") == 0)
+	{
+		return (result > 0);
+	}
+	else if (g_strcmp0(operator, "$gte") == 0)
+	{
+		return (result >= 0);
+	}
+
+	/* Unknown operators never match, so that mistakes do not return everything. */
+	return FALSE;
+}
+
+/**
+ * Checks whether a document matches a filter.
+ * The filter's keys are field names that can contain dots to refer to nested fields.
+ * Its values are either compared for equality or are documents of the operators
+ * $eq, $ne, $lt, $lte, $gt, $gte and $exists, which all have to match.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * // Matches documents whose status.size is at least 1024.
+ * bson_t filter[1];
+ * bson_t condition[1];
+ *
+ * bson_init(filter);
+ * bson_append_document_begin(filter, "status.size", -1, condition);
+ * bson_append_int64(condition, "$gte", -1, 1024);
+ * bson_append_document_end(filter, condition);
+ * \endcode
+ *
+ * \param document A document.
+ * \param filter   A filter.
+ *
+ * \return TRUE if the document matches, FALSE otherwise.
+ **/
+gboolean
+j_helper_bson_match (bson_t const* document, bson_t const* filter)
+{
+	bson_iter_t iter;
+
+	g_return_val_if_fail(document != NULL, FALSE);
+	g_return_val_if_fail(filter != NULL, FALSE);
+
+	if (!bson_iter_init(&iter, filter))
+	{
+		return FALSE;
+	}
+
+	while (bson_iter_next(&iter))
+	{
+		bson_iter_t document_iter;
+		bson_iter_t field;
+		gboolean exists;
+
+		exists = (bson_iter_init(&document_iter, document) && bson_iter_find_descendant(&document_iter, bson_iter_key(&iter), &field));
+
+		if (BSON_ITER_HOLDS_DOCUMENT(&iter))
+		{
+			bson_iter_t conditions;
+			gboolean is_operator = FALSE;
+
+			/* Documents consisting of operators are conditions, all other documents are compared for equality. */
+			if (bson_iter_recurse(&iter, &conditions) && bson_iter_next(&conditions))
+			{
+				is_operator = (bson_iter_key(&conditions)[0] == '$');
+			}
+
+			if (is_operator)
+			{
+				bson_iter_recurse(&iter, &conditions);
+
+				while (bson_iter_next(&conditions))
+				{
+					if (!j_helper_bson_match_condition(&field, exists, bson_iter_key(&conditions), &conditions))
+					{
+						return FALSE;
+					}
+				}
+
+				continue;
+			}
+
+			if (!exists || !BSON_ITER_HOLDS_DOCUMENT(&field))
+			{
+				return FALSE;
+			}
+			else
+			{
+				guint8 const* data_a;
+				guint8 const* data_b;
+				guint32 len_a;
+				guint32 len_b;
+
+				bson_iter_document(&field, &len_a, &data_a);
+				bson_iter_document(&iter, &len_b, &data_b);
+
+				if (len_a != len_b || memcmp(data_a, data_b, len_a) != 0)
+				{
+					return FALSE;
+				}
+			}
+		}
+		else if (!j_helper_bson_match_condition(&field, exists, "$eq", &iter))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Copies the given fields of a document.
+ * Fields containing dots select their top-level field, for example, "status.size" selects "status".
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param document  A document.
+ * \param fields    A NULL-terminated array of field names.
+ * \param projected An uninitialized document, which has to be freed with bson_destroy().
+ **/
+void
+j_helper_bson_project (bson_t const* document, gchar const* const* fields, bson_t* projected)
+{
+	bson_iter_t iter;
+
+	g_return_if_fail(document != NULL);
+	g_return_if_fail(fields != NULL);
+	g_return_if_fail(projected != NULL);
+
+	bson_init(projected);
+
+	if (!bson_iter_init(&iter, document))
+	{
+		return;
+	}
+
+	while (bson_iter_next(&iter))
+	{
+		gchar const* key = bson_iter_key(&iter);
+		gsize key_len = strlen(key);
+
+		for (guint i = 0; fields[i] != NULL; i++)
+		{
+			if (strncmp(fields[i], key, key_len) == 0 && (fields[i][key_len] == '\0' || fields[i][key_len] == '.'))
+			{
+				bson_append_iter(projected, key, -1, &iter);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Appends the merge of two documents to an already initialized document.
+ **/
+static
+void
+j_helper_bson_merge_max_into (bson_t const* document, bson_t const* maxima, bson_t* merged)
+{
+	bson_iter_t iter;
+	bson_iter_t max_iter;
+
+	if (bson_iter_init(&iter, document))
+	{
+		while (bson_iter_next(&iter))
+		{
+			gchar const* key = bson_iter_key(&iter);
+
+			if (!bson_iter_init_find(&max_iter, maxima, key))
+			{
+				bson_append_iter(merged, key, -1, &iter);
+			}
+			else if (BSON_ITER_HOLDS_DOCUMENT(&iter) && BSON_ITER_HOLDS_DOCUMENT(&max_iter))
+			{
+				bson_t child[1];
+				bson_t sub_document[1];
+				bson_t sub_maxima[1];
+				guint8 const* data;
+				guint32 len;
+
+				bson_iter_document(&iter, &len, &data);
+				bson_init_static(sub_document, data, len);
+				bson_iter_document(&max_iter, &len, &data);
+				bson_init_static(sub_maxima, data, len);
+
+				bson_append_document_begin(merged, key, -1, child);
+				j_helper_bson_merge_max_into(sub_document, sub_maxima, child);
+				bson_append_document_end(merged, child);
+			}
+			else if (BSON_ITER_HOLDS_NUMBER(&iter) && BSON_ITER_HOLDS_NUMBER(&max_iter))
+			{
+				gint result;
+
+				j_helper_bson_compare(&iter, &max_iter, &result);
+				bson_append_iter(merged, key, -1, (result >= 0) ? &iter : &max_iter);
+			}
+			else
+			{
+				/* Values that cannot be compared are replaced. */
+				bson_append_iter(merged, key, -1, &max_iter);
+			}
+		}
+	}
+
+	if (bson_iter_init(&max_iter, maxima))
+	{
+		while (bson_iter_next(&max_iter))
+		{
+			gchar const* key = bson_iter_key(&max_iter);
+
+			if (!bson_iter_init_find(&iter, document, key))
+			{
+				bson_append_iter(merged, key, -1, &max_iter);
+			}
+		}
+	}
+}
+
+/**
+ * Merges a document of maxima into a document.
+ * Numeric fields are set to the maximum of both values, subdocuments are merged recursively.
+ * All other fields of the maxima replace the document's fields or are added if they do not exist.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param document A document.
+ * \param maxima   A document of maxima.
+ * \param merged   An uninitialized document, which has to be freed with bson_destroy().
+ **/
+void
+j_helper_bson_merge_max (bson_t const* document, bson_t const* maxima, bson_t* merged)
+{
+	g_return_if_fail(document != NULL);
+	g_return_if_fail(maxima != NULL);
+	g_return_if_fail(merged != NULL);
+
+	bson_init(merged);
+	j_helper_bson_merge_max_into(document, maxima, merged);
+}
+
+/**
+ * The CRC32C lookup tables used for slicing-by-8.
+ **/
+static guint32 j_helper_crc32c_table[8][256];
+
+static
+gpointer
+j_helper_crc32c_init (gpointer data)
+{
+	(void)data;
+
+	for (guint i = 0; i < 256; i++)
+	{
+		guint32 crc = i;
+
+		for (guint j = 0; j < 8; j++)
+		{
+			crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+		}
+
+		j_helper_crc32c_table[0][i] = crc;
+	}
+
+	for (guint i = 0; i < 256; i++)
+	{
+		for (guint j = 1; j < 8; j++)
+		{
+			guint32 crc = j_helper_crc32c_table[j - 1][i];
+
+			j_helper_crc32c_table[j][i] = (crc >> 8) ^ j_helper_crc32c_table[0][crc & 0xff];
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Computes a CRC32C checksum in software, processing eight bytes at a time.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param crc    The inverted checksum so far.
+ * \param data   The data.
+ * \param length The data's length.
+ *
+ * \return The inverted checksum.
+ **/
+static
+guint32
+j_helper_crc32c_software (guint32 crc, guchar const* data, gsize length)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	g_once(&once, j_helper_crc32c_init, NULL);
+
+	while (length >= 8)
+	{
+		guint32 low;
+
+		low = crc ^ ((guint32)data[0] | ((guint32)data[1] << 8) | ((guint32)data[2] << 16) | ((guint32)data[3] << 24));
+
+		crc = j_helper_crc32c_table[7][low & 0xff]
+		    ^ j_helper_crc32c_table[6][(low >> 8) & 0xff]
+		    ^ j_helper_crc32c_table[5][(low >> 16) & 0xff]
+		    ^ j_helper_crc32c_table[4][low >> 24]
+		    ^ j_helper_crc32c_table[3][data[4]]
+		    ^ j_helper_crc32c_table[2][data[5]]
+		    ^ j_helper_crc32c_table[1][data[6]]
+		    ^ j_helper_crc32c_table[0][data[7]];
+
+		data += 8;
+		length -= 8;
+	}
+
+	while (length > 0)
+	{
+		crc = (crc >> 8) ^ j_helper_crc32c_table[0][(crc ^ *data) & 0xff];
+
+		data++;
+		length--;
+	}
+
+	return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/**
+ * Computes a CRC32C checksum using the SSE 4.2 CRC32 instruction.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param crc    The inverted checksum so far.
+ * \param data   The data.
+ * \param length The data's length.
+ *
+ * \return The inverted checksum.
+ **/
+__attribute__((target("sse4.2")))
+static
+guint32
+j_helper_crc32c_hardware (guint32 crc, guchar const* data, gsize length)
+{
+	guint64 crc64 = crc;
+
+	while (length >= 8)
+	{
+		guint64 word;
+
+		memcpy(&word, data, sizeof(guint64));
+		crc64 = _mm_crc32_u64(crc64, word);
+
+		data += 8;
+		length -= 8;
+	}
+
+	crc = crc64;
+
+	while (length > 0)
+	{
+		crc = _mm_crc32_u8(crc, *data);
+
+		data++;
+		length--;
+	}
+
+	return crc;
+}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+/**
+ * Computes a CRC32C checksum using the ARMv8 CRC32 instructions.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param crc    The inverted checksum so far.
+ * \param data   The data.
+ * \param length The data's length.
+ *
+ * \return The inverted checksum.
+ **/
+static
+guint32
+j_helper_crc32c_hardware (guint32 crc, guchar const* data, gsize length)
+{
+	while (length >= 8)
+	{
+		guint64 word;
+
+		memcpy(&word, data, sizeof(guint64));
+		crc = __crc32cd(crc, word);
+
+		data += 8;
+		length -= 8;
+	}
+
+	while (length > 0)
+	{
+		crc = __crc32cb(crc, *data);
+
+		data++;
+		length--;
+	}
+
+	return crc;
+}
+#endif
+
+/**
+ * Computes a CRC32C checksum.
+ * Uses the processor's CRC32 instructions if available.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint32 crc;
+ *
+ * crc = j_helper_crc32c(0, data, length);
+ * crc = j_helper_crc32c(crc, more_data, more_length);
+ * \endcode
+ *
+ * \param crc    The checksum so far, 0 for the first call.
+ * \param data   The data.
+ * \param length The data's length.
+ *
+ * \return The checksum.
+ **/
+guint32
+j_helper_crc32c (guint32 crc, gconstpointer data, gsize length)
+{
+	g_return_val_if_fail(data != NULL || length == 0, crc);
+
+	crc = ~crc;
+
+#if defined(__x86_64__) && defined(__GNUC__)
+	if (__builtin_cpu_supports("sse4.2"))
+	{
+		return ~j_helper_crc32c_hardware(crc, data, length);
+	}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+	return ~j_helper_crc32c_hardware(crc, data, length);
+#endif
+
+	return ~j_helper_crc32c_software(crc, data, length);
+}
+
+/**
+ * Computes a SHA-256 digest, which identifies data by its content.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint8 digest[J_HELPER_SHA256_SIZE];
+ *
+ * j_helper_sha256(data, length, digest);
+ * \endcode
+ *
+ * \param data   The data.
+ * \param length The data's length.
+ * \param digest Returns the digest, must have room for #J_HELPER_SHA256_SIZE bytes.
+ **/
+void
+j_helper_sha256 (gconstpointer data, gsize length, guint8* digest)
+{
+	GChecksum* checksum;
+	gsize digest_len = J_HELPER_SHA256_SIZE;
+
+	g_return_if_fail(data != NULL || length == 0);
+	g_return_if_fail(digest != NULL);
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	g_checksum_update(checksum, data, length);
+	g_checksum_get_digest(checksum, digest, &digest_len);
+	g_checksum_free(checksum);
+}
+
 /**
  * @}
  **/
@@ -44,13 +44,13 @@ struct JListIterator
 	 **/
 	JList* list;
 	/**
-	 * The current list element.
+	 * The index of the next list element.
 	 **/
-	JListElement* current;
+	guint next;
 	/**
-	 * Whether the current element is the first one.
+	 * The current list element.
 	 **/
-	gboolean first;
+	gpointer current;
 };
 
 /**
@@ -74,8 +74,8 @@ j_list_iterator_new (JList* list)
 
 	iterator = g_slice_new(JListIterator);
 	iterator->list = j_list_ref(list);
-	iterator->current = j_list_head(iterator->list);
-	iterator->first = TRUE;
+	iterator->next = 0;
+	iterator->current = NULL;
 
 	return iterator;
 }
@@ -117,16 +117,16 @@ j_list_iterator_next (JListIterator* iterator)
 {
 	g_return_val_if_fail(iterator != NULL, FALSE);
 
-	if (G_UNLIKELY(iterator->first))
+	if (iterator->next >= j_list_length(iterator->list))
 	{
-		iterator->first = FALSE;
-	}
-	else
-	{
-		iterator->current = iterator->current->next;
+		iterator->current = NULL;
+		return FALSE;
 	}
 
-	return (iterator->current != NULL);
+	iterator->current = j_list_get_nth(iterator->list, iterator->next);
+	iterator->next++;
+
+	return TRUE;
 }
 
 /**
@@ -147,7 +147,7 @@ j_list_iterator_get (JListIterator* iterator)
 	g_return_val_if_fail(iterator != NULL, NULL);
 	g_return_val_if_fail(iterator->current != NULL, NULL);
 
-	return iterator->current->data;
+	return iterator->current;
 }
 
 /**
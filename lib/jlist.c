@@ -24,6 +24,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <jlist.h>
 #include <jlist-internal.h>
 
@@ -33,25 +35,38 @@
  **/
 
 /**
- * A linked list which allows fast prepend and append operations.
+ * The initial number of elements a list has room for.
+ **/
+#define J_LIST_INITIAL_SIZE 8
+
+/**
+ * A list which allows fast prepend and append operations.
  * Also allows querying the length of the list without iterating over it.
+ *
+ * The elements are stored contiguously with free room at both ends, so appending and prepending do not allocate in most cases.
  **/
 struct JList
 {
 	/**
-	 * The first element.
+	 * The elements, stored in data[offset] to data[offset + length - 1].
 	 **/
-	JListElement* head;
+	gpointer* data;
+
 	/**
-	 * The last element.
+	 * The index of the first element.
 	 **/
-	JListElement* tail;
+	guint offset;
 
 	/**
 	 * The length.
 	 **/
 	guint length;
 
+	/**
+	 * The number of elements #data has room for.
+	 **/
+	guint size;
+
 	/**
 	 * The function used to free the list elements.
 	 **/
@@ -63,6 +78,62 @@ struct JList
 	gint ref_count;
 };
 
+/**
+ * Makes sure there is room for more elements at the front or the back of a list.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param list  A list.
+ * \param count The number of additional elements.
+ * \param front Whether the room is needed at the front.
+ **/
+static
+void
+j_list_reserve (JList* list, guint count, gboolean front)
+{
+	gpointer* data;
+	guint size;
+	guint offset;
+
+	if (front && list->offset >= count)
+	{
+		return;
+	}
+
+	if (!front && list->offset + list->length + count <= list->size)
+	{
+		return;
+	}
+
+	size = MAX(list->size, J_LIST_INITIAL_SIZE);
+
+	while (size < 2 * (list->length + count))
+	{
+		size *= 2;
+	}
+
+	/* Leave room at the end the elements are added to, so repeated additions do not move them again. */
+	offset = (front) ? size - list->length - (size - list->length - count) / 2 : 0;
+
+	data = g_new(gpointer, size);
+
+	if (list->length > 0)
+	{
+		memcpy(data + offset, list->data + list->offset, list->length * sizeof(gpointer));
+	}
+
+	g_free(list->data);
+
+	list->data = data;
+	list->offset = offset;
+	list->size = size;
+}
+
 /**
  * Creates a new list.
  *
@@ -81,9 +152,10 @@ j_list_new (JListFreeFunc free_func)
 	JList* list;
 
 	list = g_slice_new(JList);
-	list->head = NULL;
-	list->tail = NULL;
+	list->data = NULL;
+	list->offset = 0;
 	list->length = 0;
+	list->size = 0;
 	list->free_func = free_func;
 	list->ref_count = 1;
 
@@ -129,6 +201,7 @@ j_list_unref (JList* list)
 	{
 		j_list_delete_all(list);
 
+		g_free(list->data);
 		g_slice_free(JList, list);
 	}
 }
@@ -167,28 +240,13 @@ j_list_length (JList* list)
 void
 j_list_append (JList* list, gpointer data)
 {
-	JListElement* element;
-
 	g_return_if_fail(list != NULL);
 	g_return_if_fail(data != NULL);
 
-	element = g_slice_new(JListElement);
-	element->next = NULL;
-	element->data = data;
+	j_list_reserve(list, 1, FALSE);
 
+	list->data[list->offset + list->length] = data;
 	list->length++;
-
-	if (list->tail != NULL)
-	{
-		list->tail->next = element;
-	}
-
-	list->tail = element;
-
-	if (list->head == NULL)
-	{
-		list->head = list->tail;
-	}
 }
 
 /**
@@ -205,22 +263,14 @@ j_list_append (JList* list, gpointer data)
 void
 j_list_prepend (JList* list, gpointer data)
 {
-	JListElement* element;
-
 	g_return_if_fail(list != NULL);
 	g_return_if_fail(data != NULL);
 
-	element = g_slice_new(JListElement);
-	element->next = list->head;
-	element->data = data;
+	j_list_reserve(list, 1, TRUE);
 
+	list->offset--;
+	list->data[list->offset] = data;
 	list->length++;
-	list->head = element;
-
-	if (list->tail == NULL)
-	{
-		list->tail = list->head;
-	}
 }
 
 /**
@@ -235,16 +285,14 @@ j_list_prepend (JList* list, gpointer data)
 gpointer
 j_list_get_first (JList* list)
 {
-	gpointer data = NULL;
-
 	g_return_val_if_fail(list != NULL, NULL);
 
-	if (list->head != NULL && list->tail != NULL)
+	if (list->length == 0)
 	{
-		data = list->head->data;
+		return NULL;
 	}
 
-	return data;
+	return list->data[list->offset];
 }
 
 /**
@@ -259,16 +307,14 @@ j_list_get_first (JList* list)
 gpointer
 j_list_get_last (JList* list)
 {
-	gpointer data = NULL;
-
 	g_return_val_if_fail(list != NULL, NULL);
 
-	if (list->head != NULL && list->tail != NULL)
+	if (list->length == 0)
 	{
-		data = list->tail->data;
+		return NULL;
 	}
 
-	return data;
+	return list->data[list->offset + list->length - 1];
 }
 
 /**
@@ -281,35 +327,58 @@ j_list_get_last (JList* list)
 void
 j_list_delete_all (JList* list)
 {
-	JListElement* element;
-
 	g_return_if_fail(list != NULL);
 
-	element = list->head;
-
-	while (element != NULL)
+	if (list->free_func != NULL)
 	{
-		JListElement* next;
-
-		if (list->free_func != NULL)
+		for (guint i = 0; i < list->length; i++)
 		{
-			list->free_func(element->data);
+			list->free_func(list->data[list->offset + i]);
 		}
-
-		next = element->next;
-		g_slice_free(JListElement, element);
-		element = next;
 	}
 
-	list->head = NULL;
-	list->tail = NULL;
+	/* Keep the memory for reuse. */
+	list->offset = 0;
 	list->length = 0;
 }
 
+/**
+ * Moves all elements of another list to the end of a list.
+ * The element data is not copied, so #list becomes responsible for freeing it.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param list  A list.
+ * \param other Another list, which is empty afterwards.
+ **/
+void
+j_list_move_all (JList* list, JList* other)
+{
+	g_return_if_fail(list != NULL);
+	g_return_if_fail(other != NULL);
+	g_return_if_fail(list != other);
+
+	if (other->length == 0)
+	{
+		return;
+	}
+
+	j_list_reserve(list, other->length, FALSE);
+
+	memcpy(list->data + list->offset + list->length, other->data + other->offset, other->length * sizeof(gpointer));
+	list->length += other->length;
+
+	other->offset = 0;
+	other->length = 0;
+}
+
 /* Internal */
 
 /**
- * Returns the list's first element.
+ * Returns a list element.
  *
  * \private
  *
@@ -318,16 +387,18 @@ j_list_delete_all (JList* list)
  * \code
  * \endcode
  *
- * \param list A JList.
+ * \param list  A JList.
+ * \param n     The element's index.
  *
- * \return A JListElement.
+ * \return The list element.
  **/
-JListElement*
-j_list_head (JList* list)
+gpointer
+j_list_get_nth (JList* list, guint n)
 {
 	g_return_val_if_fail(list != NULL, NULL);
+	g_return_val_if_fail(n < list->length, NULL);
 
-	return list->head;
+	return list->data[list->offset + n];
 }
 
 /**
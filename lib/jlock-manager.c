@@ -0,0 +1,746 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <jlock-manager.h>
+
+#include <jtrace-internal.h>
+
+/**
+ * \defgroup JLockManager Lock Manager
+ *
+ * Data structures and functions for managing byte-range locks.
+ *
+ * Every resource's locked ranges are kept in an interval tree.
+ * The tree is a treap ordered by the ranges' start offsets that additionally stores the largest end offset of every subtree.
+ * This allows finding conflicting ranges without looking at all of the resource's ranges.
+ *
+ * Owners whose ranges block other requests are marked as contended.
+ * Clients that cache locks as leases ask for their contended owners and release them, see j_lock_manager_get_contended().
+ *
+ * @{
+ **/
+
+struct JLockInterval
+{
+	/**
+	 * The range's start offset.
+	 */
+	guint64 start;
+
+	/**
+	 * The range's end offset (exclusive).
+	 */
+	guint64 end;
+
+	/**
+	 * The largest end offset of the subtree.
+	 */
+	guint64 max_end;
+
+	JLockMode mode;
+
+	/**
+	 * The treap's heap priority.
+	 */
+	guint32 priority;
+
+	struct JLockOwner* owner;
+
+	struct JLockInterval* left;
+	struct JLockInterval* right;
+};
+
+typedef struct JLockInterval JLockInterval;
+
+struct JLockOwner
+{
+	/**
+	 * The owner's ID, used as the key in the resource's owners.
+	 */
+	guint64 id;
+
+	/**
+	 * The owner's ranges.
+	 */
+	GPtrArray* intervals;
+
+	/**
+	 * Whether the owner's ranges block other requests.
+	 */
+	gboolean contended;
+};
+
+typedef struct JLockOwner JLockOwner;
+
+struct JLockResource
+{
+	gchar* name;
+
+	/**
+	 * The root of the interval tree.
+	 */
+	JLockInterval* root;
+
+	/**
+	 * Maps owner IDs to JLockOwner.
+	 */
+	GHashTable* owners;
+
+	/**
+	 * Signals that ranges have been released.
+	 */
+	GCond cond;
+
+	/**
+	 * The number of threads waiting for the resource.
+	 */
+	guint waiters;
+};
+
+typedef struct JLockResource JLockResource;
+
+/**
+ * A lock manager.
+ */
+struct JLockManager
+{
+	GMutex mutex;
+
+	/**
+	 * Maps resource names to JLockResource.
+	 * Resources only exist while they have owners or waiters.
+	 */
+	GHashTable* resources;
+
+	/**
+	 * Maps owner IDs to JLockOwner for all resources.
+	 */
+	GHashTable* owners;
+
+	/**
+	 * Signals that owners have become contended.
+	 */
+	GCond cond;
+
+	/**
+	 * The last owner ID that has been handed out.
+	 */
+	guint64 owner;
+};
+
+static
+guint64
+j_lock_interval_get_max_end (JLockInterval* interval)
+{
+	return (interval != NULL) ? interval->max_end : 0;
+}
+
+static
+void
+j_lock_interval_update (JLockInterval* interval)
+{
+	interval->max_end = MAX(interval->end, MAX(j_lock_interval_get_max_end(interval->left), j_lock_interval_get_max_end(interval->right)));
+}
+
+/**
+ * Orders ranges by their start offsets.
+ * Ranges with the same start offset are ordered by their addresses, so every range has a unique position.
+ */
+static
+gint
+j_lock_interval_compare (JLockInterval const* a, JLockInterval const* b)
+{
+	if (a->start != b->start)
+	{
+		return (a->start < b->start) ? -1 : 1;
+	}
+
+	if (a != b)
+	{
+		return ((guintptr)a < (guintptr)b) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+static
+JLockInterval*
+j_lock_interval_rotate_right (JLockInterval* interval)
+{
+	JLockInterval* left = interval->left;
+
+	interval->left = left->right;
+	left->right = interval;
+
+	j_lock_interval_update(interval);
+	j_lock_interval_update(left);
+
+	return left;
+}
+
+static
+JLockInterval*
+j_lock_interval_rotate_left (JLockInterval* interval)
+{
+	JLockInterval* right = interval->right;
+
+	interval->right = right->left;
+	right->left = interval;
+
+	j_lock_interval_update(interval);
+	j_lock_interval_update(right);
+
+	return right;
+}
+
+static
+JLockInterval*
+j_lock_interval_insert (JLockInterval* root, JLockInterval* interval)
+{
+	if (root == NULL)
+	{
+		return interval;
+	}
+
+	if (j_lock_interval_compare(interval, root) < 0)
+	{
+		root->left = j_lock_interval_insert(root->left, interval);
+
+		if (root->left->priority > root->priority)
+		{
+			root = j_lock_interval_rotate_right(root);
+		}
+	}
+	else
+	{
+		root->right = j_lock_interval_insert(root->right, interval);
+
+		if (root->right->priority > root->priority)
+		{
+			root = j_lock_interval_rotate_left(root);
+		}
+	}
+
+	j_lock_interval_update(root);
+
+	return root;
+}
+
+static
+JLockInterval*
+j_lock_interval_remove (JLockInterval* root, JLockInterval* interval)
+{
+	gint cmp;
+
+	if (root == NULL)
+	{
+		return NULL;
+	}
+
+	cmp = j_lock_interval_compare(interval, root);
+
+	if (cmp < 0)
+	{
+		root->left = j_lock_interval_remove(root->left, interval);
+	}
+	else if (cmp > 0)
+	{
+		root->right = j_lock_interval_remove(root->right, interval);
+	}
+	else if (root->left == NULL)
+	{
+		return root->right;
+	}
+	else if (root->right == NULL)
+	{
+		return root->left;
+	}
+	else if (root->left->priority > root->right->priority)
+	{
+		/* Rotate the range down until it has at most one child. */
+		root = j_lock_interval_rotate_right(root);
+		root->right = j_lock_interval_remove(root->right, interval);
+	}
+	else
+	{
+		root = j_lock_interval_rotate_left(root);
+		root->left = j_lock_interval_remove(root->left, interval);
+	}
+
+	j_lock_interval_update(root);
+
+	return root;
+}
+
+/**
+ * Checks whether a range conflicts with any range of a tree.
+ * Shared ranges only conflict with exclusive ones.
+ * The owners of all conflicting ranges are marked as contended.
+ *
+ * \return The number of owners that have newly been marked as contended, G_MAXUINT if there is no conflict.
+ */
+static
+guint
+j_lock_interval_contend (JLockInterval* root, guint64 start, guint64 end, JLockMode mode)
+{
+	guint contended;
+	guint right;
+
+	/* No range of the subtree ends after the start. */
+	if (root == NULL || root->max_end <= start)
+	{
+		return G_MAXUINT;
+	}
+
+	contended = j_lock_interval_contend(root->left, start, end, mode);
+
+	/* All ranges of the right subtree start at or after the root. */
+	if (root->start >= end)
+	{
+		return contended;
+	}
+
+	if (start < root->end && (mode == J_LOCK_MODE_EXCLUSIVE || root->mode == J_LOCK_MODE_EXCLUSIVE))
+	{
+		contended = (contended == G_MAXUINT) ? 0 : contended;
+
+		if (!root->owner->contended)
+		{
+			root->owner->contended = TRUE;
+			contended++;
+		}
+	}
+
+	right = j_lock_interval_contend(root->right, start, end, mode);
+
+	if (right != G_MAXUINT)
+	{
+		contended = ((contended == G_MAXUINT) ? 0 : contended) + right;
+	}
+
+	return contended;
+}
+
+static
+void
+j_lock_owner_free (gpointer data)
+{
+	JLockOwner* owner = data;
+
+	g_ptr_array_free(owner->intervals, TRUE);
+	g_slice_free(JLockOwner, owner);
+}
+
+static
+void
+j_lock_interval_free (gpointer data)
+{
+	g_slice_free(JLockInterval, data);
+}
+
+static
+void
+j_lock_resource_free (gpointer data)
+{
+	JLockResource* resource = data;
+
+	/* The owners' arrays free the ranges. */
+	g_hash_table_destroy(resource->owners);
+	g_cond_clear(&(resource->cond));
+	g_free(resource->name);
+
+	g_slice_free(JLockResource, resource);
+}
+
+/**
+ * Removes a resource if it is not used anymore.
+ */
+static
+void
+j_lock_manager_collect (JLockManager* manager, JLockResource* resource)
+{
+	if (g_hash_table_size(resource->owners) == 0 && resource->waiters == 0)
+	{
+		g_hash_table_remove(manager->resources, resource->name);
+	}
+}
+
+/**
+ * Creates a new lock manager.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return A new lock manager. Should be freed with j_lock_manager_free().
+ **/
+JLockManager*
+j_lock_manager_new (void)
+{
+	JLockManager* manager;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	manager = g_slice_new(JLockManager);
+	g_mutex_init(&(manager->mutex));
+	manager->resources = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, j_lock_resource_free);
+	manager->owners = g_hash_table_new(g_int64_hash, g_int64_equal);
+	g_cond_init(&(manager->cond));
+	manager->owner = 0;
+
+	j_trace_leave(G_STRFUNC);
+
+	return manager;
+}
+
+/**
+ * Frees the memory allocated by the lock manager.
+ * There must not be any waiting threads.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param manager A lock manager.
+ **/
+void
+j_lock_manager_free (JLockManager* manager)
+{
+	g_return_if_fail(manager != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_hash_table_destroy(manager->owners);
+	g_hash_table_destroy(manager->resources);
+	g_cond_clear(&(manager->cond));
+	g_mutex_clear(&(manager->mutex));
+
+	g_slice_free(JLockManager, manager);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Acquires ranges of a resource.
+ * Either all or none of the ranges are acquired.
+ * If one of the ranges conflicts with a range held by another owner, the call waits until the conflicting ranges have been released.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint64 offsets[] = { 0 };
+ * guint64 lengths[] = { 4096 };
+ * guint64 owner;
+ *
+ * owner = j_lock_manager_acquire(manager, "object/file", J_LOCK_MODE_EXCLUSIVE, offsets, lengths, 1, -1);
+ * ...
+ * j_lock_manager_release(manager, "object/file", owner);
+ * \endcode
+ *
+ * \param manager       A lock manager.
+ * \param resource_name A resource name.
+ * \param mode          The ranges' mode.
+ * \param offsets       The ranges' offsets.
+ * \param lengths       The ranges' lengths, G_MAXUINT64 extends a range to the end of the resource.
+ * \param count         The number of ranges.
+ * \param timeout       The maximum time to wait in microseconds, 0 to not wait at all and a negative value to wait indefinitely.
+ *
+ * \return The owner ID to release the ranges with, 0 if the ranges could not be acquired in time.
+ **/
+guint64
+j_lock_manager_acquire (JLockManager* manager, gchar const* resource_name, JLockMode mode, guint64 const* offsets, guint64 const* lengths, guint count, gint64 timeout)
+{
+	JLockResource* resource;
+	JLockOwner* owner;
+	gint64 deadline;
+	guint64 id = 0;
+
+	g_return_val_if_fail(manager != NULL, 0);
+	g_return_val_if_fail(resource_name != NULL, 0);
+	g_return_val_if_fail(offsets != NULL || count == 0, 0);
+	g_return_val_if_fail(lengths != NULL || count == 0, 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	deadline = g_get_monotonic_time() + timeout;
+
+	g_mutex_lock(&(manager->mutex));
+
+	resource = g_hash_table_lookup(manager->resources, resource_name);
+
+	if (resource == NULL)
+	{
+		resource = g_slice_new(JLockResource);
+		resource->name = g_strdup(resource_name);
+		resource->root = NULL;
+		resource->owners = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, j_lock_owner_free);
+		g_cond_init(&(resource->cond));
+		resource->waiters = 0;
+
+		g_hash_table_insert(manager->resources, resource->name, resource);
+	}
+
+	while (TRUE)
+	{
+		gboolean conflict = FALSE;
+		gboolean signaled = TRUE;
+		guint contended = 0;
+
+		for (guint i = 0; i < count; i++)
+		{
+			guint64 end;
+			guint ret;
+
+			end = (lengths[i] > G_MAXUINT64 - offsets[i]) ? G_MAXUINT64 : offsets[i] + lengths[i];
+			ret = j_lock_interval_contend(resource->root, offsets[i], end, mode);
+
+			if (ret != G_MAXUINT)
+			{
+				conflict = TRUE;
+				contended += ret;
+			}
+		}
+
+		if (!conflict)
+		{
+			break;
+		}
+
+		if (contended > 0)
+		{
+			/* Wake up the clients waiting for revocations. */
+			g_cond_broadcast(&(manager->cond));
+		}
+
+		if (timeout == 0)
+		{
+			goto end;
+		}
+
+		/* Releases wake up all waiters, which then check their ranges again. */
+		resource->waiters++;
+
+		if (timeout < 0)
+		{
+			g_cond_wait(&(resource->cond), &(manager->mutex));
+		}
+		else
+		{
+			signaled = g_cond_wait_until(&(resource->cond), &(manager->mutex), deadline);
+		}
+
+		resource->waiters--;
+
+		if (!signaled)
+		{
+			goto end;
+		}
+	}
+
+	id = ++manager->owner;
+
+	owner = g_slice_new(JLockOwner);
+	owner->id = id;
+	owner->intervals = g_ptr_array_new_full(count, j_lock_interval_free);
+	owner->contended = FALSE;
+
+	for (guint i = 0; i < count; i++)
+	{
+		JLockInterval* interval;
+
+		if (lengths[i] == 0)
+		{
+			continue;
+		}
+
+		interval = g_slice_new(JLockInterval);
+		interval->start = offsets[i];
+		interval->end = (lengths[i] > G_MAXUINT64 - offsets[i]) ? G_MAXUINT64 : offsets[i] + lengths[i];
+		interval->max_end = interval->end;
+		interval->mode = mode;
+		interval->priority = g_random_int();
+		interval->owner = owner;
+		interval->left = NULL;
+		interval->right = NULL;
+
+		resource->root = j_lock_interval_insert(resource->root, interval);
+		g_ptr_array_add(owner->intervals, interval);
+	}
+
+	g_hash_table_insert(resource->owners, &(owner->id), owner);
+	g_hash_table_insert(manager->owners, &(owner->id), owner);
+
+end:
+	j_lock_manager_collect(manager, resource);
+
+	g_mutex_unlock(&(manager->mutex));
+
+	j_trace_leave(G_STRFUNC);
+
+	return id;
+}
+
+/**
+ * Releases all ranges of an owner and wakes up the threads waiting for the resource.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param manager       A lock manager.
+ * \param resource_name A resource name.
+ * \param owner_id      An owner ID as returned by j_lock_manager_acquire().
+ *
+ * \return TRUE if the owner has held ranges of the resource, FALSE otherwise.
+ **/
+gboolean
+j_lock_manager_release (JLockManager* manager, gchar const* resource_name, guint64 owner_id)
+{
+	JLockResource* resource;
+	JLockOwner* owner = NULL;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(manager != NULL, FALSE);
+	g_return_val_if_fail(resource_name != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&(manager->mutex));
+
+	resource = g_hash_table_lookup(manager->resources, resource_name);
+
+	if (resource != NULL)
+	{
+		owner = g_hash_table_lookup(resource->owners, &owner_id);
+	}
+
+	if (owner != NULL)
+	{
+		for (guint i = 0; i < owner->intervals->len; i++)
+		{
+			resource->root = j_lock_interval_remove(resource->root, g_ptr_array_index(owner->intervals, i));
+		}
+
+		g_hash_table_remove(manager->owners, &owner_id);
+		g_hash_table_remove(resource->owners, &owner_id);
+		g_cond_broadcast(&(resource->cond));
+
+		j_lock_manager_collect(manager, resource);
+
+		ret = TRUE;
+	}
+
+	g_mutex_unlock(&(manager->mutex));
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Waits until one of the given owners has become contended.
+ * Unknown owners, for example because the server has been restarted, are considered contended.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param manager   A lock manager.
+ * \param owner_ids Owner IDs, replaced by the contended ones.
+ * \param count     The number of owner IDs.
+ * \param timeout   The maximum time to wait in microseconds, 0 to not wait at all and a negative value to wait indefinitely.
+ *
+ * \return The number of contended owners stored at the beginning of #owner_ids.
+ **/
+guint
+j_lock_manager_get_contended (JLockManager* manager, guint64* owner_ids, guint count, gint64 timeout)
+{
+	gint64 deadline;
+	guint contended = 0;
+
+	g_return_val_if_fail(manager != NULL, 0);
+	g_return_val_if_fail(owner_ids != NULL || count == 0, 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	deadline = g_get_monotonic_time() + timeout;
+
+	g_mutex_lock(&(manager->mutex));
+
+	while (TRUE)
+	{
+		gboolean found = FALSE;
+
+		for (guint i = 0; i < count && !found; i++)
+		{
+			JLockOwner* owner;
+
+			owner = g_hash_table_lookup(manager->owners, &(owner_ids[i]));
+			found = (owner == NULL || owner->contended);
+		}
+
+		if (found || timeout == 0)
+		{
+			break;
+		}
+
+		if (timeout < 0)
+		{
+			g_cond_wait(&(manager->cond), &(manager->mutex));
+		}
+		else if (!g_cond_wait_until(&(manager->cond), &(manager->mutex), deadline))
+		{
+			break;
+		}
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		JLockOwner* owner;
+
+		owner = g_hash_table_lookup(manager->owners, &(owner_ids[i]));
+
+		if (owner == NULL || owner->contended)
+		{
+			owner_ids[contended] = owner_ids[i];
+			contended++;
+		}
+	}
+
+	g_mutex_unlock(&(manager->mutex));
+
+	j_trace_leave(G_STRFUNC);
+
+	return contended;
+}
+
+/**
+ * @}
+ **/
@@ -24,14 +24,17 @@
 
 #include <glib.h>
 
-#include <bson.h>
+#include <string.h>
 
 #include <jlock.h>
+#include <jlock-internal.h>
 
-#include <jbackend.h>
 #include <jcommon.h>
+#include <jconfiguration.h>
 #include <jconnection-pool-internal.h>
-#include <jhelper-internal.h>
+#include <jhelper.h>
+#include <jlock-manager.h>
+#include <jmessage.h>
 #include <jtrace-internal.h>
 
 /**
@@ -39,45 +42,662 @@
  *
  * Data structures and functions for managing locks.
  *
+ * Locks cover byte ranges of an object and are managed by the object server responsible for the object's name.
+ * If the backends are loaded by the client, a lock manager within the process is used instead.
+ *
+ * Released locks are kept as leases, so acquiring them again does not require a round trip.
+ * For every server with leases, a thread asks the server which of them block other clients and releases those.
+ *
  * @{
  **/
 
+/**
+ * The maximum number of leases kept per process.
+ */
+#define J_LOCK_LEASES_MAX 1024
+
+/**
+ * A lock that has been released locally but is still held on the server.
+ */
+struct JLockLease
+{
+	gchar* namespace;
+	gchar* path;
+
+	/**
+	 * The lease's key in j_lock_leases_by_resource.
+	 */
+	gchar* resource;
+
+	/**
+	 * The index of the server managing the lease.
+	 */
+	guint32 index;
+
+	guint64 owner;
+	JLockMode mode;
+
+	GArray* offsets;
+	GArray* lengths;
+
+	/**
+	 * The number of locks currently using the lease.
+	 */
+	guint users;
+
+	/**
+	 * Whether the lease blocks other clients and has to be released once it is unused.
+	 */
+	gboolean revoked;
+};
+
+typedef struct JLockLease JLockLease;
+
+static GMutex j_lock_leases_mutex;
+
+/**
+ * Signals that a revocation thread has stopped.
+ */
+static GCond j_lock_leases_cond;
+
+/**
+ * Maps owner IDs to JLockLease.
+ */
+static GHashTable* j_lock_leases = NULL;
+
+/**
+ * Maps resource names to lists of JLockLease.
+ */
+static GHashTable* j_lock_leases_by_resource = NULL;
+
+/**
+ * Whether a revocation thread is running, per server.
+ */
+static gboolean* j_lock_revoke_running = NULL;
+static guint j_lock_revoke_threads = 0;
+
+/**
+ * Set by j_lock_fini(), released locks are not kept as leases anymore.
+ */
+static gboolean j_lock_leases_stopped = FALSE;
+
 /**
  * A JLock.
  **/
 struct JLock
 {
 	/**
-	 * The parent item.
+	 * The locked object.
 	 **/
 	gchar* namespace;
 	gchar* path;
 
-	GArray* blocks;
+	JLockMode mode;
+
+	/**
+	 * The ranges' offsets and lengths.
+	 **/
+	GArray* offsets;
+	GArray* lengths;
+
+	/**
+	 * The owner ID handed out by the lock manager, 0 if the lock has not been acquired.
+	 **/
+	guint64 owner;
+
+	/**
+	 * The lease the lock has been acquired from, NULL otherwise.
+	 **/
+	JLockLease* lease;
 
 	gboolean acquired;
 };
 
 /**
- * Creates a new lock.
+ * Returns the lock manager used if the backends are loaded by the client.
+ *
+ * \private
+ **/
+static
+JLockManager*
+j_lock_get_manager (void)
+{
+	static GOnce once = G_ONCE_INIT;
+
+	g_once(&once, (GThreadFunc)j_lock_manager_new, NULL);
+
+	return once.retval;
+}
+
+/**
+ * Returns the index of the object server managing the lock.
+ *
+ * \private
+ **/
+static
+guint32
+j_lock_get_index (JLock* lock)
+{
+	return j_helper_hash(lock->path) % j_configuration_get_object_server_count(j_configuration());
+}
+
+/**
+ * Sends a lock message and receives its reply.
+ * Lock messages use an exclusive connection, since the server only replies once the lock has been acquired or the wait has timed out.
+ *
+ * \private
+ **/
+static
+JMessage*
+j_lock_request (guint32 index, JMessage* message)
+{
+	GSocketConnection* connection;
+	JMessage* reply;
+
+	connection = j_connection_pool_pop_object(index);
+	reply = j_message_new_reply(message);
+
+	if (!j_message_send(message, connection) || !j_message_receive(reply, connection))
+	{
+		j_message_unref(reply);
+		reply = NULL;
+	}
+
+	j_connection_pool_push_object(index, connection);
+
+	return reply;
+}
+
+/**
+ * Sends a LOCK_RELEASE.
+ *
+ * \private
+ **/
+static
+gboolean
+j_lock_send_release (gchar const* namespace, gchar const* path, guint32 index, guint64 owner)
+{
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	gboolean released = FALSE;
+	gsize namespace_len;
+	gsize path_len;
+
+	namespace_len = strlen(namespace) + 1;
+	path_len = strlen(path) + 1;
+
+	message = j_message_new(J_MESSAGE_LOCK_RELEASE, namespace_len + path_len);
+	j_message_append_n(message, namespace, namespace_len);
+	j_message_append_n(message, path, path_len);
+	j_message_add_operation(message, sizeof(guint64));
+	j_message_append_8(message, &owner);
+
+	reply = j_lock_request(index, message);
+
+	if (reply != NULL)
+	{
+		released = (j_message_get_1(reply) != 0);
+	}
+
+	return released;
+}
+
+/**
+ * Checks whether a lease can be used for a lock.
+ * Shared leases can be used by any number of shared locks, exclusive leases by one lock at a time.
+ *
+ * \private
+ **/
+static
+gboolean
+j_lock_lease_covers (JLockLease* lease, JLock* lock)
+{
+	if (lease->revoked)
+	{
+		return FALSE;
+	}
+
+	if (lease->mode == J_LOCK_MODE_SHARED && lock->mode == J_LOCK_MODE_EXCLUSIVE)
+	{
+		return FALSE;
+	}
+
+	if (lease->mode == J_LOCK_MODE_EXCLUSIVE && lease->users > 0)
+	{
+		return FALSE;
+	}
+
+	/* Every range has to lie within one of the lease's ranges. */
+	for (guint i = 0; i < lock->offsets->len; i++)
+	{
+		guint64 offset = g_array_index(lock->offsets, guint64, i);
+		guint64 length = g_array_index(lock->lengths, guint64, i);
+		gboolean covered = FALSE;
+
+		for (guint j = 0; j < lease->offsets->len && !covered; j++)
+		{
+			guint64 lease_offset = g_array_index(lease->offsets, guint64, j);
+			guint64 lease_length = g_array_index(lease->lengths, guint64, j);
+
+			covered = (offset >= lease_offset && offset - lease_offset <= lease_length && length <= lease_length - (offset - lease_offset));
+		}
+
+		if (!covered)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Removes a lease from the lookup tables.
+ * Has to be called with j_lock_leases_mutex held.
+ *
+ * \private
+ **/
+static
+void
+j_lock_lease_remove (JLockLease* lease)
+{
+	GList* leases;
+
+	leases = g_hash_table_lookup(j_lock_leases_by_resource, lease->resource);
+	leases = g_list_remove(leases, lease);
+
+	if (leases != NULL)
+	{
+		g_hash_table_insert(j_lock_leases_by_resource, g_strdup(lease->resource), leases);
+	}
+	else
+	{
+		g_hash_table_remove(j_lock_leases_by_resource, lease->resource);
+	}
+
+	g_hash_table_remove(j_lock_leases, &(lease->owner));
+}
+
+/**
+ * Releases leases on their servers and frees them.
+ * Must not be called with j_lock_leases_mutex held.
+ *
+ * \private
+ **/
+static
+void
+j_lock_lease_release (GList* leases)
+{
+	for (GList* l = leases; l != NULL; l = l->next)
+	{
+		JLockLease* lease = l->data;
+
+		j_lock_send_release(lease->namespace, lease->path, lease->index, lease->owner);
+
+		g_free(lease->namespace);
+		g_free(lease->path);
+		g_free(lease->resource);
+		g_array_free(lease->offsets, TRUE);
+		g_array_free(lease->lengths, TRUE);
+
+		g_slice_free(JLockLease, lease);
+	}
+
+	g_list_free(leases);
+}
+
+/**
+ * Asks a server which of its leases block other clients.
+ * The server replies as soon as one of them does, which revokes them.
+ *
+ * \private
+ **/
+static
+gpointer
+j_lock_revoke_thread (gpointer data)
+{
+	guint32 index = GPOINTER_TO_UINT(data);
+
+	while (TRUE)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+		GHashTableIter iter;
+		gpointer value;
+		GList* revoked = NULL;
+
+		message = j_message_new(J_MESSAGE_LOCK_REVOKE, 0);
+
+		g_mutex_lock(&j_lock_leases_mutex);
+
+		g_hash_table_iter_init(&iter, j_lock_leases);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			JLockLease* lease = value;
+
+			if (lease->index == index)
+			{
+				j_message_add_operation(message, sizeof(guint64));
+				j_message_append_8(message, &(lease->owner));
+			}
+		}
+
+		if (j_message_get_count(message) == 0)
+		{
+			j_lock_revoke_running[index] = FALSE;
+			j_lock_revoke_threads--;
+			g_cond_broadcast(&j_lock_leases_cond);
+
+			g_mutex_unlock(&j_lock_leases_mutex);
+
+			break;
+		}
+
+		g_mutex_unlock(&j_lock_leases_mutex);
+
+		reply = j_lock_request(index, message);
+
+		if (reply == NULL)
+		{
+			/* Do not spin while the server is unreachable. */
+			g_usleep(100 * 1000);
+			continue;
+		}
+
+		g_mutex_lock(&j_lock_leases_mutex);
+
+		for (guint32 i = 0; i < j_message_get_count(reply); i++)
+		{
+			JLockLease* lease;
+			guint64 owner;
+
+			owner = j_message_get_8(reply);
+			lease = g_hash_table_lookup(j_lock_leases, &owner);
+
+			if (lease == NULL)
+			{
+				continue;
+			}
+
+			lease->revoked = TRUE;
+
+			/* Leases that are in use are released by the last lock using them. */
+			if (lease->users == 0)
+			{
+				j_lock_lease_remove(lease);
+				revoked = g_list_prepend(revoked, lease);
+			}
+		}
+
+		g_mutex_unlock(&j_lock_leases_mutex);
+
+		j_lock_lease_release(revoked);
+	}
+
+	return NULL;
+}
+
+/**
+ * Tries to acquire a lock from a lease.
+ * Unused leases of the same resource that cannot be used are released, since they would likely conflict with the lock on the server.
+ *
+ * \private
+ **/
+static
+gboolean
+j_lock_acquire_lease (JLock* lock, gchar const* resource)
+{
+	GList* idle = NULL;
+	gboolean ret = FALSE;
+
+	g_mutex_lock(&j_lock_leases_mutex);
+
+	if (j_lock_leases != NULL)
+	{
+		GList* leases;
+
+		leases = g_hash_table_lookup(j_lock_leases_by_resource, resource);
+
+		for (GList* l = leases; l != NULL; l = l->next)
+		{
+			JLockLease* lease = l->data;
+
+			if (j_lock_lease_covers(lease, lock))
+			{
+				lease->users++;
+
+				lock->lease = lease;
+				lock->owner = lease->owner;
+
+				ret = TRUE;
+				break;
+			}
+
+			if (lease->users == 0)
+			{
+				idle = g_list_prepend(idle, lease);
+			}
+		}
+
+		if (ret)
+		{
+			g_list_free(idle);
+			idle = NULL;
+		}
+
+		for (GList* l = idle; l != NULL; l = l->next)
+		{
+			j_lock_lease_remove(l->data);
+		}
+	}
+
+	g_mutex_unlock(&j_lock_leases_mutex);
+
+	j_lock_lease_release(idle);
+
+	return ret;
+}
+
+/**
+ * Keeps a released lock as a lease.
+ *
+ * \private
+ *
+ * \return TRUE if the lock is kept, FALSE if it has to be released on the server.
+ **/
+static
+gboolean
+j_lock_keep_lease (JLock* lock)
+{
+	JLockLease* lease;
+	GList* leases;
+	guint32 index;
+
+	index = j_lock_get_index(lock);
+
+	g_mutex_lock(&j_lock_leases_mutex);
+
+	if (j_lock_leases_stopped || (j_lock_leases != NULL && g_hash_table_size(j_lock_leases) >= J_LOCK_LEASES_MAX))
+	{
+		g_mutex_unlock(&j_lock_leases_mutex);
+
+		return FALSE;
+	}
+
+	if (j_lock_leases == NULL)
+	{
+		j_lock_leases = g_hash_table_new(g_int64_hash, g_int64_equal);
+		j_lock_leases_by_resource = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		j_lock_revoke_running = g_new0(gboolean, j_configuration_get_object_server_count(j_configuration()));
+	}
+
+	lease = g_slice_new(JLockLease);
+	lease->namespace = g_strdup(lock->namespace);
+	lease->path = g_strdup(lock->path);
+	lease->resource = g_strconcat(lock->namespace, "/", lock->path, NULL);
+	lease->index = index;
+	lease->owner = lock->owner;
+	lease->mode = lock->mode;
+	lease->offsets = g_array_sized_new(FALSE, FALSE, sizeof(guint64), lock->offsets->len);
+	lease->lengths = g_array_sized_new(FALSE, FALSE, sizeof(guint64), lock->lengths->len);
+	lease->users = 0;
+	lease->revoked = FALSE;
+
+	g_array_append_vals(lease->offsets, lock->offsets->data, lock->offsets->len);
+	g_array_append_vals(lease->lengths, lock->lengths->data, lock->lengths->len);
+
+	leases = g_hash_table_lookup(j_lock_leases_by_resource, lease->resource);
+	g_hash_table_insert(j_lock_leases_by_resource, g_strdup(lease->resource), g_list_prepend(leases, lease));
+	g_hash_table_insert(j_lock_leases, &(lease->owner), lease);
+
+	if (!j_lock_revoke_running[index])
+	{
+		j_lock_revoke_running[index] = TRUE;
+		j_lock_revoke_threads++;
+
+		g_thread_unref(g_thread_new("julea-lock-revoke", j_lock_revoke_thread, GUINT_TO_POINTER(index)));
+	}
+
+	g_mutex_unlock(&j_lock_leases_mutex);
+
+	return TRUE;
+}
+
+/**
+ * Acquires the lock's ranges.
+ *
+ * \private
+ **/
+static
+gboolean
+j_lock_acquire_internal (JLock* lock, gboolean wait)
+{
+	g_autofree gchar* resource = NULL;
+	guint64 const* range_offsets;
+	guint64 const* range_lengths;
+	guint count;
+
+	g_return_val_if_fail(lock != NULL, FALSE);
+	g_return_val_if_fail(!lock->acquired, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* A lock without ranges covers the whole object. */
+	if (lock->offsets->len == 0)
+	{
+		j_lock_add_range(lock, 0, G_MAXUINT64);
+	}
+
+	count = lock->offsets->len;
+	range_offsets = (guint64 const*)(gpointer)lock->offsets->data;
+	range_lengths = (guint64 const*)(gpointer)lock->lengths->data;
+	resource = g_strconcat(lock->namespace, "/", lock->path, NULL);
+
+	if (j_object_backend_for_namespace(lock->namespace) != NULL)
+	{
+		lock->owner = j_lock_manager_acquire(j_lock_get_manager(), resource, lock->mode, range_offsets, range_lengths, count, wait ? -1 : 0);
+	}
+	else if (j_lock_acquire_lease(lock, resource))
+	{
+		/* The lease is still held on the server. */
+	}
+	else
+	{
+		gsize namespace_len;
+		gsize path_len;
+		guint32 index;
+		gchar exclusive;
+		gchar wait_flag;
+
+		namespace_len = strlen(lock->namespace) + 1;
+		path_len = strlen(lock->path) + 1;
+		index = j_lock_get_index(lock);
+		exclusive = (lock->mode == J_LOCK_MODE_EXCLUSIVE);
+		wait_flag = wait;
+
+		lock->owner = 0;
+
+		/* The server only waits for a limited time, so keep asking until the lock has been acquired. */
+		do
+		{
+			g_autoptr(JMessage) message = NULL;
+			g_autoptr(JMessage) reply = NULL;
+
+			message = j_message_new(J_MESSAGE_LOCK_ACQUIRE, namespace_len + path_len + 2);
+			j_message_append_n(message, lock->namespace, namespace_len);
+			j_message_append_n(message, lock->path, path_len);
+			j_message_append_1(message, &exclusive);
+			j_message_append_1(message, &wait_flag);
+
+			for (guint i = 0; i < count; i++)
+			{
+				j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
+				j_message_append_8(message, &(range_offsets[i]));
+				j_message_append_8(message, &(range_lengths[i]));
+			}
+
+			reply = j_lock_request(index, message);
+
+			if (reply == NULL)
+			{
+				break;
+			}
+
+			lock->owner = j_message_get_8(reply);
+		}
+		while (lock->owner == 0 && wait);
+	}
+
+	lock->acquired = (lock->owner != 0);
+
+	j_trace_leave(G_STRFUNC);
+
+	return lock->acquired;
+}
+
+/**
+ * Creates a new exclusive lock.
  *
  * \author Michael Kuhn
  *
  * \code
- * JItem* item;
  * JLock* lock;
  *
- * ...
- *
- * lock = j_lock_new(item);
+ * lock = j_lock_new("object", "file");
  * \endcode
  *
- * \param item An item.
+ * \param namespace A namespace.
+ * \param path      An object's path.
  *
- * \return A new item. Should be freed with j_lock_unref().
+ * \return A new lock. Should be freed with j_lock_free().
  **/
 JLock*
 j_lock_new (gchar const* namespace, gchar const* path)
+{
+	return j_lock_new_for_mode(namespace, path, J_LOCK_MODE_EXCLUSIVE);
+}
+
+/**
+ * Creates a new lock.
+ * Shared locks are compatible with each other, exclusive locks are not compatible with any other lock.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JLock* lock;
+ *
+ * lock = j_lock_new_for_mode("object", "file", J_LOCK_MODE_SHARED);
+ * \endcode
+ *
+ * \param namespace A namespace.
+ * \param path      An object's path.
+ * \param mode      A lock mode.
+ *
+ * \return A new lock. Should be freed with j_lock_free().
+ **/
+JLock*
+j_lock_new_for_mode (gchar const* namespace, gchar const* path, JLockMode mode)
 {
 	JLock* lock;
 
@@ -89,7 +709,11 @@ j_lock_new (gchar const* namespace, gchar const* path)
 	lock = g_slice_new(JLock);
 	lock->namespace = g_strdup(namespace);
 	lock->path = g_strdup(path);
-	lock->blocks = g_array_new(FALSE, FALSE, sizeof(guint64));
+	lock->mode = mode;
+	lock->offsets = g_array_new(FALSE, FALSE, sizeof(guint64));
+	lock->lengths = g_array_new(FALSE, FALSE, sizeof(guint64));
+	lock->owner = 0;
+	lock->lease = NULL;
 	lock->acquired = FALSE;
 
 	j_trace_leave(G_STRFUNC);
@@ -99,6 +723,7 @@ j_lock_new (gchar const* namespace, gchar const* path)
 
 /**
  * Frees the memory allocated for the lock.
+ * The lock is released if it is still held.
  *
  * \author Michael Kuhn
  *
@@ -127,146 +752,207 @@ j_lock_free (JLock* lock)
 	g_free(lock->path);
 	g_free(lock->namespace);
 
-	g_array_free(lock->blocks, TRUE);
+	g_array_free(lock->offsets, TRUE);
+	g_array_free(lock->lengths, TRUE);
 
 	g_slice_free(JLock, lock);
 
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Acquires a lock.
+ * All ranges are acquired atomically.
+ * If one of the ranges is held by another lock, the call blocks until it has been released.
+ *
+ * \author Michael Kuhn
+ *
+ * \param lock A lock.
+ *
+ * \return TRUE if all ranges have been acquired, FALSE if an error occurred.
+ **/
 gboolean
 j_lock_acquire (JLock* lock)
 {
-	JBackend* kv_backend;
-	bson_t empty[1];
-	gboolean acquired = TRUE;
-	gpointer kv_batch;
+	return j_lock_acquire_internal(lock, TRUE);
+}
 
-	g_return_val_if_fail(lock != NULL, FALSE);
+/**
+ * Tries to acquire a lock without waiting.
+ *
+ * \author Michael Kuhn
+ *
+ * \param lock A lock.
+ *
+ * \return TRUE if all ranges have been acquired, FALSE if one of them is held by another lock.
+ **/
+gboolean
+j_lock_try_acquire (JLock* lock)
+{
+	return j_lock_acquire_internal(lock, FALSE);
+}
 
-	//j_lock_serialize(lock, obj);
+/**
+ * Releases a lock.
+ * The lock is kept as a lease until it blocks another client, other clients waiting for the lock's ranges are notified by the server.
+ *
+ * \author Michael Kuhn
+ *
+ * \param lock A lock.
+ *
+ * \return TRUE if the lock has been released, FALSE otherwise.
+ **/
+gboolean
+j_lock_release (JLock* lock)
+{
+	gboolean released = FALSE;
 
-	//write_concern = mongoc_write_concern_new();
-	//write_concern->j = 1;
-	//mongoc_write_concern_set_w(write_concern, 1);
+	g_return_val_if_fail(lock != NULL, FALSE);
+	g_return_val_if_fail(lock->acquired, FALSE);
 
-	//bson_init(index);
-	//bson_append_int32(index, "item", -1, 1);
-	// FIXME speed
-	//bson_append_int32(index, "blocks", -1, 1);
+	j_trace_enter(G_STRFUNC, NULL);
 
-	//j_helper_create_index(J_STORE_COLLECTION_LOCKS, mongo_connection, index);
+	if (j_object_backend_for_namespace(lock->namespace) != NULL)
+	{
+		g_autofree gchar* resource = NULL;
 
-	bson_init(empty);
+		resource = g_strconcat(lock->namespace, "/", lock->path, NULL);
+		released = j_lock_manager_release(j_lock_get_manager(), resource, lock->owner);
+	}
+	else if (lock->lease != NULL)
+	{
+		JLockLease* lease = lock->lease;
+		GList* revoked = NULL;
 
-	kv_backend = j_kv_backend();
+		g_mutex_lock(&j_lock_leases_mutex);
 
-	//mongo_connection = j_connection_pool_pop_kv(0);
+		lease->users--;
 
-	if (lock->blocks->len > 0)
-	{
-		if (kv_backend != NULL)
+		if (lease->revoked && lease->users == 0)
 		{
-			acquired = j_backend_kv_batch_start(kv_backend, "locks", J_SEMANTICS_SAFETY_NETWORK, &kv_batch);
+			j_lock_lease_remove(lease);
+			revoked = g_list_prepend(revoked, lease);
 		}
 
-		for (guint i = 0; i < lock->blocks->len; i++)
-		{
-			g_autofree gchar* block_str = NULL;
-			guint64 block;
-
-			block = g_array_index(lock->blocks, guint64, i);
-			block_str = g_strdup_printf("%" G_GUINT64_FORMAT, block);
+		g_mutex_unlock(&j_lock_leases_mutex);
 
-			if (kv_backend != NULL)
-			{
-				g_autofree gchar* path = NULL;
-
-				path = g_build_path("/", lock->namespace, lock->path, block_str, NULL);
-				acquired = j_backend_kv_put(kv_backend, kv_batch, path, empty) && acquired;
-			}
-		}
+		j_lock_lease_release(revoked);
 
-		if (kv_backend != NULL)
-		{
-			acquired = j_backend_kv_batch_execute(kv_backend, kv_batch) && acquired;
-		}
+		lock->lease = NULL;
+		released = TRUE;
+	}
+	else if (j_lock_keep_lease(lock))
+	{
+		released = TRUE;
+	}
+	else
+	{
+		released = j_lock_send_release(lock->namespace, lock->path, j_lock_get_index(lock), lock->owner);
 	}
 
-	lock->acquired = acquired;
+	if (released)
+	{
+		lock->owner = 0;
+		lock->acquired = FALSE;
+	}
 
-	//j_connection_pool_push_kv(0, mongo_connection);
+	j_trace_leave(G_STRFUNC);
 
-	bson_destroy(empty);
+	return released;
+}
 
-	return lock->acquired;
+/**
+ * Adds a block to a lock.
+ * A block is the range of length one starting at the block's number.
+ *
+ * \author Michael Kuhn
+ *
+ * \param lock  A lock.
+ * \param block A block.
+ **/
+void
+j_lock_add (JLock* lock, guint64 block)
+{
+	j_lock_add_range(lock, block, 1);
 }
 
-gboolean
-j_lock_release (JLock* lock)
+/**
+ * Adds a byte range to a lock.
+ * Ranges can only be added before the lock is acquired.
+ *
+ * \author Michael Kuhn
+ *
+ * \param lock   A lock.
+ * \param offset The range's offset.
+ * \param length The range's length, G_MAXUINT64 extends the range to the end of the object.
+ **/
+void
+j_lock_add_range (JLock* lock, guint64 offset, guint64 length)
 {
-	JBackend* kv_backend;
-	gboolean released = TRUE;
-	gpointer kv_batch;
+	g_return_if_fail(lock != NULL);
+	g_return_if_fail(!lock->acquired);
 
-	g_return_val_if_fail(lock != NULL, FALSE);
-	g_return_val_if_fail(lock->acquired, FALSE);
+	/* Overlapping ranges of the same lock do not conflict with each other. */
+	g_array_append_val(lock->offsets, offset);
+	g_array_append_val(lock->lengths, length);
+}
 
-	//write_concern = mongoc_write_concern_new();
-	//write_concern->j = 1;
-	//mongoc_write_concern_set_w(write_concern, 1);
+/**
+ * Releases all leases and waits for the revocation threads to stop.
+ *
+ * \private
+ **/
+void
+j_lock_fini (void)
+{
+	GList* leases = NULL;
 
-	//bson_init(obj);
-	//bson_append_oid(obj, "_id", -1, &(lock->id));
-	//bson_finish(obj);
+	g_mutex_lock(&j_lock_leases_mutex);
 
-	kv_backend = j_kv_backend();
-	//mongo_connection = j_connection_pool_pop_kv(0);
+	j_lock_leases_stopped = TRUE;
 
-	if (lock->blocks->len > 0)
+	if (j_lock_leases != NULL)
 	{
-		if (kv_backend != NULL)
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init(&iter, j_lock_leases);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value))
 		{
-			released = j_backend_kv_batch_start(kv_backend, "locks", J_SEMANTICS_SAFETY_NETWORK, &kv_batch);
+			leases = g_list_prepend(leases, value);
 		}
 
-		for (guint i = 0; i < lock->blocks->len; i++)
-		{
-			g_autofree gchar* block_str = NULL;
-			guint64 block;
+		g_hash_table_remove_all(j_lock_leases);
+		g_hash_table_remove_all(j_lock_leases_by_resource);
+	}
 
-			block = g_array_index(lock->blocks, guint64, i);
-			block_str = g_strdup_printf("%" G_GUINT64_FORMAT, block);
+	g_mutex_unlock(&j_lock_leases_mutex);
 
-			if (kv_backend != NULL)
-			{
-				g_autofree gchar* path = NULL;
+	j_lock_lease_release(leases);
 
-				path = g_build_path("/", lock->namespace, lock->path, block_str, NULL);
-				released = j_backend_kv_delete(kv_backend, kv_batch, path) && released;
-			}
-		}
+	g_mutex_lock(&j_lock_leases_mutex);
 
-		if (kv_backend != NULL)
-		{
-			released = j_backend_kv_batch_execute(kv_backend, kv_batch) && released;
-		}
+	/* The threads notice that there are no leases left after their current request. */
+	while (j_lock_revoke_threads > 0)
+	{
+		g_cond_wait(&j_lock_leases_cond, &j_lock_leases_mutex);
 	}
 
-	lock->acquired = !released;
-
-	//j_connection_pool_push_kv(0, mongo_connection);
+	if (j_lock_leases != NULL)
+	{
+		g_hash_table_destroy(j_lock_leases);
+		g_hash_table_destroy(j_lock_leases_by_resource);
+		g_free(j_lock_revoke_running);
 
-	return !(lock->acquired);
-}
+		j_lock_leases = NULL;
+		j_lock_leases_by_resource = NULL;
+		j_lock_revoke_running = NULL;
+	}
 
-void
-j_lock_add (JLock* lock, guint64 block)
-{
-	g_return_if_fail(lock != NULL);
+	j_lock_leases_stopped = FALSE;
 
-	/* FIXME handle duplicates */
-	g_array_append_val(lock->blocks, block);
+	g_mutex_unlock(&j_lock_leases_mutex);
 }
 
 /**
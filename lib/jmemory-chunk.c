@@ -24,11 +24,13 @@
 
 #include <glib.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <jmemory-chunk.h>
 
 #include <jcommon.h>
+#include <jhelper.h>
 #include <jtrace-internal.h>
 
 /**
@@ -36,6 +38,28 @@
  * @{
  **/
 
+/**
+ * The minimum alignment of segments.
+ * Servers hand segments to the storage backends, which might require aligned buffers for direct I/O.
+ **/
+#define J_MEMORY_CHUNK_ALIGNMENT 4096
+
+/**
+ * The maximum number of free segments kept per thread.
+ **/
+#define J_MEMORY_CHUNK_CACHED_SEGMENTS 2
+
+/**
+ * A contiguous part of a chunk's memory.
+ **/
+struct JMemoryChunkSegment
+{
+	gchar* data;
+	guint64 size;
+};
+
+typedef struct JMemoryChunkSegment JMemoryChunkSegment;
+
 /**
  * A cache.
  */
@@ -47,16 +71,168 @@ struct JMemoryChunk
 	guint64 size;
 
 	/**
-	* The data.
-	*/
-	gchar* data;
+	 * Whether additional segments are allocated if the first one is full.
+	 **/
+	gboolean growable;
+
+	/**
+	 * The first segment.
+	 **/
+	JMemoryChunkSegment* first;
 
 	/**
-	* The current position within #data.
+	 * The additional segments, the current one first.
+	 **/
+	GSList* segments;
+
+	/**
+	* The current position within the current segment.
 	*/
 	gchar* current;
+
+	/**
+	 * The end of the current segment.
+	 **/
+	gchar* end;
 };
 
+static
+void
+j_memory_chunk_segment_destroy (JMemoryChunkSegment* segment)
+{
+	/* Segments of at least a huge page are allocated using j_helper_alloc_huge(), smaller ones using posix_memalign(). */
+	if (segment->size >= J_HELPER_HUGE_PAGE_SIZE)
+	{
+		j_helper_free_huge(segment->data, segment->size);
+	}
+	else
+	{
+		free(segment->data);
+	}
+
+	g_slice_free(JMemoryChunkSegment, segment);
+}
+
+static
+void
+j_memory_chunk_thread_segments_free (gpointer data)
+{
+	GQueue* segments = data;
+	JMemoryChunkSegment* segment;
+
+	while ((segment = g_queue_pop_head(segments)) != NULL)
+	{
+		j_memory_chunk_segment_destroy(segment);
+	}
+
+	g_queue_free(segments);
+}
+
+/**
+ * Free segments of the current thread.
+ * Connections handled by the same thread share them, so that growing a chunk usually does not allocate memory.
+ **/
+static GPrivate j_memory_chunk_thread_segments = G_PRIVATE_INIT(j_memory_chunk_thread_segments_free);
+
+static
+GQueue*
+j_memory_chunk_get_thread_segments (void)
+{
+	GQueue* segments;
+
+	segments = g_private_get(&j_memory_chunk_thread_segments);
+
+	if (G_UNLIKELY(segments == NULL))
+	{
+		segments = g_queue_new();
+		g_private_set(&j_memory_chunk_thread_segments, segments);
+	}
+
+	return segments;
+}
+
+/**
+ * Returns a segment, reusing one of the current thread's free segments if possible.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size A size.
+ *
+ * \return A segment.
+ **/
+static
+JMemoryChunkSegment*
+j_memory_chunk_segment_new (guint64 size)
+{
+	GQueue* segments;
+	JMemoryChunkSegment* segment;
+	gpointer data;
+
+	segments = j_memory_chunk_get_thread_segments();
+
+	for (GList* l = segments->head; l != NULL; l = l->next)
+	{
+		segment = l->data;
+
+		if (segment->size == size)
+		{
+			g_queue_delete_link(segments, l);
+
+			return segment;
+		}
+	}
+
+	segment = g_slice_new(JMemoryChunkSegment);
+	segment->size = size;
+
+	/* Segments of at least a huge page can be backed by huge pages. */
+	if (size >= J_HELPER_HUGE_PAGE_SIZE)
+	{
+		data = j_helper_alloc_huge(size);
+	}
+	else if (posix_memalign(&data, J_MEMORY_CHUNK_ALIGNMENT, size) != 0)
+	{
+		g_error("%s: failed to allocate %" G_GUINT64_FORMAT " bytes", G_STRLOC, size);
+	}
+
+	segment->data = data;
+
+	return segment;
+}
+
+/**
+ * Returns a segment to the current thread's free segments.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param segment A segment.
+ **/
+static
+void
+j_memory_chunk_segment_free (JMemoryChunkSegment* segment)
+{
+	GQueue* segments;
+
+	segments = j_memory_chunk_get_thread_segments();
+
+	if (segments->length >= J_MEMORY_CHUNK_CACHED_SEGMENTS)
+	{
+		j_memory_chunk_segment_destroy(g_queue_pop_tail(segments));
+	}
+
+	g_queue_push_head(segments, segment);
+}
+
 /**
  * Creates a new cache.
  *
@@ -83,14 +259,48 @@ j_memory_chunk_new (guint64 size)
 
 	cache = g_slice_new(JMemoryChunk);
 	cache->size = size;
-	cache->data = g_malloc(cache->size);
-	cache->current = cache->data;
+	cache->growable = FALSE;
+	cache->first = j_memory_chunk_segment_new(size);
+	cache->segments = NULL;
+	cache->current = cache->first->data;
+	cache->end = cache->first->data + size;
 
 	j_trace_leave(G_STRFUNC);
 
 	return cache;
 }
 
+/**
+ * Creates a new cache that grows if it is full.
+ * Additional segments are allocated as necessary and freed when the cache is reset.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JMemoryChunk* cache;
+ *
+ * cache = j_memory_chunk_new_growable(1024);
+ * \endcode
+ *
+ * \param size The size of the first segment.
+ *
+ * \return A new cache. Should be freed with j_memory_chunk_free().
+ **/
+JMemoryChunk*
+j_memory_chunk_new_growable (guint64 size)
+{
+	JMemoryChunk* cache;
+
+	cache = j_memory_chunk_new(size);
+
+	if (cache != NULL)
+	{
+		cache->growable = TRUE;
+	}
+
+	return cache;
+}
+
 /**
  * Frees the memory allocated for the cache.
  *
@@ -113,10 +323,8 @@ j_memory_chunk_free (JMemoryChunk* cache)
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (cache->data != NULL)
-	{
-		g_free(cache->data);
-	}
+	j_memory_chunk_reset(cache);
+	j_memory_chunk_segment_free(cache->first);
 
 	g_slice_free(JMemoryChunk, cache);
 
@@ -144,19 +352,33 @@ j_memory_chunk_free (JMemoryChunk* cache)
 gpointer
 j_memory_chunk_get (JMemoryChunk* cache, guint64 length)
 {
+	JMemoryChunkSegment* segment;
 	gpointer ret = NULL;
 
 	g_return_val_if_fail(cache != NULL, NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (cache->current + length > cache->data + cache->size)
+	if (length <= (guint64)(cache->end - cache->current))
 	{
+		ret = cache->current;
+		cache->current += length;
+
 		goto end;
 	}
 
-	ret = cache->current;
-	cache->current += length;
+	if (!cache->growable)
+	{
+		goto end;
+	}
+
+	/* Large requests get a segment of their own. */
+	segment = j_memory_chunk_segment_new(MAX(cache->size, length));
+	cache->segments = g_slist_prepend(cache->segments, segment);
+
+	ret = segment->data;
+	cache->current = segment->data + length;
+	cache->end = segment->data + segment->size;
 
 end:
 	j_trace_leave(G_STRFUNC);
@@ -164,12 +386,27 @@ end:
 	return ret;
 }
 
+/**
+ * Resets the cache, invalidating all segments.
+ * Additional segments of growable caches are freed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A cache.
+ **/
 void
 j_memory_chunk_reset (JMemoryChunk* cache)
 {
 	g_return_if_fail(cache != NULL);
 
-	cache->current = cache->data;
+	g_slist_free_full(cache->segments, (GDestroyNotify)j_memory_chunk_segment_free);
+	cache->segments = NULL;
+
+	cache->current = cache->first->data;
+	cache->end = cache->first->data + cache->size;
 }
 
 /**
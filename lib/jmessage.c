@@ -25,15 +25,25 @@
 #include <glib.h>
 #include <gio/gio.h>
 
+#include <limits.h>
 #include <math.h>
 #include <string.h>
 
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
 #include <jmessage.h>
 
+#include <jbatch-internal.h>
+#include <jhelper.h>
 #include <jhelper-internal.h>
 #include <jlist.h>
 #include <jlist-iterator.h>
+#include <jprobe-internal.h>
 #include <jsemantics.h>
+#include <jstatistics.h>
+#include <jstatistics-internal.h>
 #include <jtrace-internal.h>
 
 #include <julea-internal.h>
@@ -44,6 +54,40 @@
  * @{
  **/
 
+/**
+ * The maximum number of buffers passed to a single vectored send.
+ **/
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define J_MESSAGE_VECTORS_MAX IOV_MAX
+#else
+#define J_MESSAGE_VECTORS_MAX 1024
+#endif
+
+/**
+ * The minimum body length for a message to be compressed.
+ **/
+#define J_MESSAGE_COMPRESSION_THRESHOLD (4 * 1024)
+
+/**
+ * The maximum length of a LEB128-encoded 64-bit number.
+ **/
+#define J_MESSAGE_VARINT_MAX 10
+
+/**
+ * The key used to mark connections that have negotiated compression.
+ **/
+#define J_MESSAGE_COMPRESSION_KEY "julea-message-compression"
+
+/**
+ * The key used to mark connections that have negotiated checksums.
+ **/
+#define J_MESSAGE_CHECKSUM_KEY "julea-message-checksum"
+
+/**
+ * The key used to mark connections that have negotiated 64-bit message lengths.
+ **/
+#define J_MESSAGE_LENGTH64_KEY "julea-message-length64"
+
 /**
  * Additional message data.
  **/
@@ -62,6 +106,37 @@ struct JMessageData
 
 typedef struct JMessageData JMessageData;
 
+/**
+ * The smallest and largest buffer sizes kept in the buffer pool, as powers of two.
+ **/
+#define J_MESSAGE_BUFFER_CLASS_MIN 8
+#define J_MESSAGE_BUFFER_CLASS_MAX 16
+#define J_MESSAGE_BUFFER_CLASSES (J_MESSAGE_BUFFER_CLASS_MAX - J_MESSAGE_BUFFER_CLASS_MIN + 1)
+
+/**
+ * The maximum number of unused buffers kept per size class and thread.
+ **/
+#define J_MESSAGE_BUFFER_POOL_SIZE 16
+
+/**
+ * A thread-local pool of message buffers.
+ **/
+struct JMessageBufferPool
+{
+	/**
+	 * The unused buffers per size class.
+	 * Each buffer's first bytes point to the next one.
+	 **/
+	gpointer buffers[J_MESSAGE_BUFFER_CLASSES];
+
+	/**
+	 * The number of unused buffers per size class.
+	 **/
+	guint count[J_MESSAGE_BUFFER_CLASSES];
+};
+
+typedef struct JMessageBufferPool JMessageBufferPool;
+
 #pragma pack(4)
 /**
  * A message header.
@@ -70,6 +145,8 @@ struct JMessageHeader
 {
 	/**
 	 * The message length.
+	 * Additional data added with j_message_add_send() is not included, its lengths are part of the operations.
+	 * If J_MESSAGE_FLAGS_LENGTH64 is set, the header is followed by another 32 bits containing the upper half of the length.
 	 **/
 	guint32 length;
 
@@ -130,6 +207,43 @@ struct JMessage
 	 **/
 	JMessage* original_message;
 
+	/**
+	 * The checksum of the additional data sent after the message.
+	 * Only valid if #payload_checksum_set is TRUE.
+	 **/
+	guint32 payload_checksum;
+
+	/**
+	 * Whether #payload_checksum has been received.
+	 **/
+	gboolean payload_checksum_set;
+
+	/**
+	 * The ID of the traced request the message belongs to, 0 if it is not traced.
+	 * It is sent after the body and the checksums.
+	 **/
+	guint64 trace_id;
+
+	/**
+	 * The upper half of the message length, the lower half is stored in the header.
+	 **/
+	guint32 length_high;
+
+	/**
+	 * The number of body bytes that j_message_receive_body() has not received yet.
+	 **/
+	guint64 body_remaining;
+
+	/**
+	 * The checksum of the body bytes received by j_message_receive_body().
+	 **/
+	guint32 body_checksum;
+
+	/**
+	 * Whether j_message_receive_header() had to receive the whole body, because it was compressed.
+	 **/
+	gboolean body_buffered;
+
 	/**
 	 * The reference count.
 	 **/
@@ -179,7 +293,28 @@ j_message_length (JMessage const* message)
 
 	length = j_message_header(message)->length;
 
-	return GUINT32_FROM_LE(length);
+	return ((guint64)message->length_high << 32) | GUINT32_FROM_LE(length);
+}
+
+/**
+ * Sets a message's length.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param length  The message's length.
+ **/
+static
+void
+j_message_set_length (JMessage* message, guint64 length)
+{
+	j_message_header(message)->length = GUINT32_TO_LE(length & G_MAXUINT32);
+	message->length_high = length >> 32;
 }
 
 static
@@ -189,6 +324,189 @@ j_message_data_free (gpointer data)
 	g_slice_free(JMessageData, data);
 }
 
+static
+void
+j_message_buffer_pool_free (gpointer data)
+{
+	JMessageBufferPool* pool = data;
+
+	for (guint i = 0; i < J_MESSAGE_BUFFER_CLASSES; i++)
+	{
+		while (pool->buffers[i] != NULL)
+		{
+			gpointer buffer = pool->buffers[i];
+
+			pool->buffers[i] = *(gpointer*)buffer;
+			g_free(buffer);
+		}
+	}
+
+	g_slice_free(JMessageBufferPool, pool);
+}
+
+static GPrivate j_message_buffer_pool = G_PRIVATE_INIT(j_message_buffer_pool_free);
+
+/**
+ * The number of buffers allocated from the heap.
+ **/
+static gsize j_message_buffer_allocations = 0;
+
+/**
+ * The number of corrupted messages.
+ **/
+static gsize j_message_checksum_errors = 0;
+
+static
+JMessageBufferPool*
+j_message_buffer_pool_get (void)
+{
+	JMessageBufferPool* pool;
+
+	pool = g_private_get(&j_message_buffer_pool);
+
+	if (G_UNLIKELY(pool == NULL))
+	{
+		pool = g_slice_new0(JMessageBufferPool);
+		g_private_set(&j_message_buffer_pool, pool);
+	}
+
+	return pool;
+}
+
+/**
+ * Returns a buffer.
+ * Buffers up to the largest size class are taken from the current thread's pool.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size A size. Will be set to the buffer's actual size.
+ *
+ * \return A buffer. Should be returned with j_message_buffer_put().
+ **/
+static
+gpointer
+j_message_buffer_get (gsize* size)
+{
+	JMessageBufferPool* pool;
+	gpointer buffer;
+	guint bits;
+
+	bits = MAX(g_bit_storage(*size - 1), J_MESSAGE_BUFFER_CLASS_MIN);
+
+	if (bits > J_MESSAGE_BUFFER_CLASS_MAX)
+	{
+		g_atomic_pointer_add(&j_message_buffer_allocations, 1);
+
+		/* Large payloads can be backed by huge pages. */
+		return (*size >= J_HELPER_HUGE_PAGE_SIZE) ? j_helper_alloc_huge(*size) : g_malloc(*size);
+	}
+
+	*size = (gsize)1 << bits;
+	bits -= J_MESSAGE_BUFFER_CLASS_MIN;
+
+	pool = j_message_buffer_pool_get();
+	buffer = pool->buffers[bits];
+
+	if (buffer != NULL)
+	{
+		pool->buffers[bits] = *(gpointer*)buffer;
+		pool->count[bits]--;
+
+		return buffer;
+	}
+
+	g_atomic_pointer_add(&j_message_buffer_allocations, 1);
+
+	return g_malloc(*size);
+}
+
+/**
+ * Returns a buffer to the current thread's pool.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param buffer A buffer.
+ * \param size   The buffer's size.
+ **/
+static
+void
+j_message_buffer_put (gpointer buffer, gsize size)
+{
+	JMessageBufferPool* pool;
+	guint bits;
+
+	bits = g_bit_storage(size - 1);
+
+	/* Only buffers of exactly one size class can be reused. */
+	if (bits < J_MESSAGE_BUFFER_CLASS_MIN || bits > J_MESSAGE_BUFFER_CLASS_MAX || size != ((gsize)1 << bits))
+	{
+		if (size >= J_HELPER_HUGE_PAGE_SIZE)
+		{
+			j_helper_free_huge(buffer, size);
+		}
+		else
+		{
+			g_free(buffer);
+		}
+
+		return;
+	}
+
+	bits -= J_MESSAGE_BUFFER_CLASS_MIN;
+	pool = j_message_buffer_pool_get();
+
+	if (pool->count[bits] >= J_MESSAGE_BUFFER_POOL_SIZE)
+	{
+		g_free(buffer);
+		return;
+	}
+
+	*(gpointer*)buffer = pool->buffers[bits];
+	pool->buffers[bits] = buffer;
+	pool->count[bits]++;
+}
+
+/**
+ * Resizes a message's buffer, keeping its content.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param size    The new size.
+ **/
+static
+void
+j_message_resize (JMessage* message, gsize size)
+{
+	gchar* data;
+	gsize position;
+
+	position = message->current - message->data;
+
+	data = j_message_buffer_get(&size);
+	memcpy(data, message->data, MIN(message->size, size));
+	j_message_buffer_put(message->data, message->size);
+
+	message->data = data;
+	message->size = size;
+	message->current = message->data + position;
+}
+
 /**
  * Checks whether it is possible to append data to a message.
  *
@@ -239,7 +557,6 @@ j_message_extend (JMessage* message, gsize length)
 {
 	gsize factor = 1;
 	gsize current_length;
-	gsize position;
 	guint32 count;
 
 	if (length == 0)
@@ -261,29 +578,19 @@ j_message_extend (JMessage* message, gsize length)
 		factor = pow(10, floor(log10(count)));
 	}
 
-	message->size += length * factor;
-
-	position = message->current - message->data;
-	message->data = g_realloc(message->data, message->size);
-	message->current = message->data + position;
+	j_message_resize(message, message->size + length * factor);
 }
 
 static
 void
 j_message_ensure_size (JMessage* message, gsize length)
 {
-	gsize position;
-
 	if (length <= message->size)
 	{
 		return;
 	}
 
-	message->size = length;
-
-	position = message->current - message->data;
-	message->data = g_realloc(message->data, message->size);
-	message->current = message->data + position;
+	j_message_resize(message, length);
 }
 
 /**
@@ -313,13 +620,19 @@ j_message_new (JMessageType op_type, gsize length)
 
 	message = g_slice_new(JMessage);
 	message->size = sizeof(JMessageHeader) + length;
-	message->data = g_malloc(message->size);
+	message->data = j_message_buffer_get(&(message->size));
 	message->current = message->data + sizeof(JMessageHeader);
 	message->send_list = j_list_new(j_message_data_free);
 	message->original_message = NULL;
+	message->payload_checksum = 0;
+	message->payload_checksum_set = FALSE;
+	message->trace_id = j_batch_get_trace_id();
+	message->body_remaining = 0;
+	message->body_checksum = 0;
+	message->body_buffered = FALSE;
 	message->ref_count = 1;
 
-	j_message_header(message)->length = GUINT32_TO_LE(0);
+	j_message_set_length(message, 0);
 	j_message_header(message)->id = GUINT32_TO_LE(rand);
 	j_message_header(message)->flags = GUINT32_TO_LE(J_MESSAGE_FLAGS_NONE);
 	j_message_header(message)->op_type = GUINT32_TO_LE(op_type);
@@ -354,15 +667,21 @@ j_message_new_reply (JMessage* message)
 
 	reply = g_slice_new(JMessage);
 	reply->size = sizeof(JMessageHeader);
-	reply->data = g_malloc(reply->size);
+	reply->data = j_message_buffer_get(&(reply->size));
 	reply->current = reply->data + sizeof(JMessageHeader);
 	reply->send_list = j_list_new(j_message_data_free);
 	reply->original_message = j_message_ref(message);
+	reply->payload_checksum = 0;
+	reply->payload_checksum_set = FALSE;
+	reply->trace_id = 0;
+	reply->body_remaining = 0;
+	reply->body_checksum = 0;
+	reply->body_buffered = FALSE;
 	reply->ref_count = 1;
 
 	op_flags = j_message_get_flags(message) | J_MESSAGE_FLAGS_REPLY;
 
-	j_message_header(reply)->length = GUINT32_TO_LE(0);
+	j_message_set_length(reply, 0);
 	j_message_header(reply)->id = j_message_header(message)->id;
 	j_message_header(reply)->flags = GUINT32_TO_LE(op_flags);
 	j_message_header(reply)->op_type = j_message_header(message)->op_type;
@@ -430,7 +749,7 @@ j_message_unref (JMessage* message)
 			j_list_unref(message->send_list);
 		}
 
-		g_free(message->data);
+		j_message_buffer_put(message->data, message->size);
 
 		g_slice_free(JMessage, message);
 	}
@@ -439,7 +758,9 @@ j_message_unref (JMessage* message)
 }
 
 /**
- * Returns a message's type.
+ * Resets a message, so that it can be reused.
+ * All operations and additional data are removed.
+ * Buffers that have grown beyond the pooled sizes are released.
  *
  * \author Michael Kuhn
  *
@@ -447,57 +768,64 @@ j_message_unref (JMessage* message)
  * \endcode
  *
  * \param message A message.
- *
- * \return The message's operation type.
  **/
-JMessageType
-j_message_get_type (JMessage const* message)
+void
+j_message_reset (JMessage* message)
 {
-	JMessageType op_type;
-
-	g_return_val_if_fail(message != NULL, J_MESSAGE_NONE);
+	g_return_if_fail(message != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	op_type = j_message_header(message)->op_type;
-	op_type = GUINT32_FROM_LE(op_type);
+	if (message->size > ((gsize)1 << J_MESSAGE_BUFFER_CLASS_MAX))
+	{
+		gsize size = sizeof(JMessageHeader);
+		gchar* data;
 
-	j_trace_leave(G_STRFUNC);
+		data = j_message_buffer_get(&size);
+		memcpy(data, message->data, sizeof(JMessageHeader));
+		j_message_buffer_put(message->data, message->size);
 
-	return op_type;
+		message->data = data;
+		message->size = size;
+	}
+
+	message->current = message->data + sizeof(JMessageHeader);
+
+	if (message->send_list != NULL)
+	{
+		j_list_delete_all(message->send_list);
+	}
+
+	message->payload_checksum_set = FALSE;
+	message->trace_id = 0;
+	message->body_remaining = 0;
+	message->body_buffered = FALSE;
+
+	j_message_set_length(message, 0);
+	j_message_header(message)->op_count = GUINT32_TO_LE(0);
+
+	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Returns a message's type modifier.
+ * Returns the number of message buffers that had to be allocated from the heap.
+ * Buffers reused from the buffer pool are not counted.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param message A message.
- *
- * \return The message's operation type.
+ * \return The number of allocations.
  **/
-JMessageFlags
-j_message_get_flags (JMessage const* message)
+guint64
+j_message_get_allocation_count (void)
 {
-	JMessageFlags op_flags;
-
-	g_return_val_if_fail(message != NULL, J_MESSAGE_NONE);
-
-	j_trace_enter(G_STRFUNC, NULL);
-
-	op_flags = j_message_header(message)->flags;
-	op_flags = GUINT32_FROM_LE(op_flags);
-
-	j_trace_leave(G_STRFUNC);
-
-	return op_flags;
+	return (gsize)g_atomic_pointer_get(&j_message_buffer_allocations);
 }
 
 /**
- * Returns a message's count.
+ * Returns a message's ID.
  *
  * \author Michael Kuhn
  *
@@ -506,27 +834,23 @@ j_message_get_flags (JMessage const* message)
  *
  * \param message A message.
  *
- * \return The message's operation count.
+ * \return The message's ID.
  **/
 guint32
-j_message_get_count (JMessage const* message)
+j_message_get_id (JMessage const* message)
 {
-	guint32 op_count;
+	guint32 id;
 
 	g_return_val_if_fail(message != NULL, 0);
 
-	j_trace_enter(G_STRFUNC, NULL);
-
-	op_count = j_message_header(message)->op_count;
-	op_count = GUINT32_FROM_LE(op_count);
-
-	j_trace_leave(G_STRFUNC);
+	id = j_message_header(message)->id;
 
-	return op_count;
+	return GUINT32_FROM_LE(id);
 }
 
 /**
- * Appends 1 byte to a message.
+ * Sets a message's ID.
+ * Replies have to be created afterwards to inherit the ID.
  *
  * \author Michael Kuhn
  *
@@ -534,14 +858,180 @@ j_message_get_count (JMessage const* message)
  * \endcode
  *
  * \param message A message.
- * \param data    Data to append.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \param id      An ID.
  **/
-gboolean
-j_message_append_1 (JMessage* message, gconstpointer data)
+void
+j_message_set_id (JMessage* message, guint32 id)
+{
+	g_return_if_fail(message != NULL);
+
+	j_message_header(message)->id = GUINT32_TO_LE(id);
+}
+
+/**
+ * Returns the ID of the traced request a message belongs to.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The trace ID, 0 if the message is not traced.
+ **/
+guint64
+j_message_get_trace_id (JMessage const* message)
+{
+	g_return_val_if_fail(message != NULL, 0);
+
+	return message->trace_id;
+}
+
+/**
+ * Sets the ID of the traced request a message belongs to.
+ * New messages inherit the trace ID of the batch executed by the current thread.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message  A message.
+ * \param trace_id A trace ID, 0 to stop tracing the message.
+ **/
+void
+j_message_set_trace_id (JMessage* message, guint64 trace_id)
+{
+	g_return_if_fail(message != NULL);
+
+	message->trace_id = trace_id;
+}
+
+/**
+ * Returns a message's type.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The message's operation type.
+ **/
+JMessageType
+j_message_get_type (JMessage const* message)
+{
+	JMessageType op_type;
+
+	g_return_val_if_fail(message != NULL, J_MESSAGE_NONE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	op_type = j_message_header(message)->op_type;
+	op_type = GUINT32_FROM_LE(op_type);
+
+	j_trace_leave(G_STRFUNC);
+
+	return op_type;
+}
+
+/**
+ * Returns a message's type modifier.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The message's operation type.
+ **/
+JMessageFlags
+j_message_get_flags (JMessage const* message)
+{
+	JMessageFlags op_flags;
+
+	g_return_val_if_fail(message != NULL, J_MESSAGE_NONE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	op_flags = j_message_header(message)->flags;
+	op_flags = GUINT32_FROM_LE(op_flags);
+
+	j_trace_leave(G_STRFUNC);
+
+	return op_flags;
+}
+
+/**
+ * Returns a message's count.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The message's operation count.
+ **/
+guint32
+j_message_get_count (JMessage const* message)
+{
+	guint32 op_count;
+
+	g_return_val_if_fail(message != NULL, 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	op_count = j_message_header(message)->op_count;
+	op_count = GUINT32_FROM_LE(op_count);
+
+	j_trace_leave(G_STRFUNC);
+
+	return op_count;
+}
+
+/**
+ * Returns a message's length, excluding its header.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return The message's length.
+ **/
+gsize
+j_message_get_length (JMessage const* message)
+{
+	g_return_val_if_fail(message != NULL, 0);
+
+	return j_message_length(message);
+}
+
+/**
+ * Appends 1 byte to a message.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param data    Data to append.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_1 (JMessage* message, gconstpointer data)
 {
-	guint32 new_length;
+	guint64 new_length;
 
 	g_return_val_if_fail(message != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
@@ -553,7 +1043,7 @@ j_message_append_1 (JMessage* message, gconstpointer data)
 	message->current += 1;
 
 	new_length = j_message_length(message) + 1;
-	j_message_header(message)->length = GUINT32_TO_LE(new_length);
+	j_message_set_length(message, new_length);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -578,7 +1068,7 @@ gboolean
 j_message_append_4 (JMessage* message, gconstpointer data)
 {
 	gint32 new_data;
-	guint32 new_length;
+	guint64 new_length;
 
 	g_return_val_if_fail(message != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
@@ -591,7 +1081,7 @@ j_message_append_4 (JMessage* message, gconstpointer data)
 	message->current += 4;
 
 	new_length = j_message_length(message) + 4;
-	j_message_header(message)->length = GUINT32_TO_LE(new_length);
+	j_message_set_length(message, new_length);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -616,7 +1106,7 @@ gboolean
 j_message_append_8 (JMessage* message, gconstpointer data)
 {
 	gint64 new_data;
-	guint32 new_length;
+	guint64 new_length;
 
 	g_return_val_if_fail(message != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
@@ -629,7 +1119,77 @@ j_message_append_8 (JMessage* message, gconstpointer data)
 	message->current += 8;
 
 	new_length = j_message_length(message) + 8;
-	j_message_header(message)->length = GUINT32_TO_LE(new_length);
+	j_message_set_length(message, new_length);
+
+	j_trace_leave(G_STRFUNC);
+
+	return TRUE;
+}
+
+/**
+ * Appends a number to a message.
+ * Compact messages use a LEB128 variable-length encoding, others use 8 bytes.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param value   A number.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_append_varint (JMessage* message, guint64 value)
+{
+	guchar buffer[J_MESSAGE_VARINT_MAX];
+	guint64 new_length;
+	gsize length = 0;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+
+	if (!(j_message_get_flags(message) & J_MESSAGE_FLAGS_COMPACT))
+	{
+		guint64 new_data;
+
+		if (!j_message_can_append(message, 8))
+		{
+			j_message_extend(message, 8);
+		}
+
+		new_data = value;
+
+		return j_message_append_8(message, &new_data);
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	do
+	{
+		buffer[length] = value & 0x7f;
+		value >>= 7;
+
+		if (value != 0)
+		{
+			buffer[length] |= 0x80;
+		}
+
+		length++;
+	}
+	while (value != 0);
+
+	/* Space is usually reserved for 8 bytes, which very large numbers can exceed. */
+	if (!j_message_can_append(message, length))
+	{
+		j_message_extend(message, length);
+	}
+
+	memcpy(message->current, buffer, length);
+	message->current += length;
+
+	new_length = j_message_length(message) + length;
+	j_message_set_length(message, new_length);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -656,7 +1216,7 @@ j_message_append_8 (JMessage* message, gconstpointer data)
 gboolean
 j_message_append_n (JMessage* message, gconstpointer data, gsize length)
 {
-	guint32 new_length;
+	guint64 new_length;
 
 	g_return_val_if_fail(message != NULL, FALSE);
 	g_return_val_if_fail(data != NULL, FALSE);
@@ -668,7 +1228,7 @@ j_message_append_n (JMessage* message, gconstpointer data, gsize length)
 	message->current += length;
 
 	new_length = j_message_length(message) + length;
-	j_message_header(message)->length = GUINT32_TO_LE(new_length);
+	j_message_set_length(message, new_length);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -769,6 +1329,58 @@ j_message_get_8 (JMessage* message)
 	return ret;
 }
 
+/**
+ * Gets a number appended with j_message_append_varint() from a message.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A number.
+ **/
+guint64
+j_message_get_varint (JMessage* message)
+{
+	guint64 ret = 0;
+
+	g_return_val_if_fail(message != NULL, 0);
+
+	if (!(j_message_get_flags(message) & J_MESSAGE_FLAGS_COMPACT))
+	{
+		return j_message_get_8(message);
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	for (guint i = 0; i < J_MESSAGE_VARINT_MAX; i++)
+	{
+		guchar byte;
+
+		if (!j_message_can_get(message, 1))
+		{
+			g_warn_if_reached();
+			break;
+		}
+
+		byte = *message->current;
+		message->current++;
+
+		ret |= (guint64)(byte & 0x7f) << (7 * i);
+
+		if (!(byte & 0x80))
+		{
+			break;
+		}
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
 /**
  * Gets n bytes from a message.
  *
@@ -829,7 +1441,7 @@ j_message_get_string (JMessage* message)
 }
 
 /**
- * Reads a message from the network.
+ * Resets a message's position, so that its content can be read again from the beginning.
  *
  * \author Michael Kuhn
  *
@@ -837,32 +1449,97 @@ j_message_get_string (JMessage* message)
  * \endcode
  *
  * \param message A message.
- * \parem stream  A network stream.
- *
- * \return TRUE on success, FALSE if an error occurred.
  **/
-gboolean
-j_message_receive (JMessage* message, GSocketConnection* connection)
+void
+j_message_rewind (JMessage* message)
 {
-	gboolean ret;
-
-	GInputStream* stream;
-
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_if_fail(message != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
-	ret = j_message_read(message, stream);
+	message->current = message->data + sizeof(JMessageHeader);
 
 	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 /**
- * Writes a message to the network.
+ * Traces a message as a flow from the client to the server and back.
+ * Probes fire for all messages, the trace only records requests and their replies.
+ * The message is also accounted in the statistics of the current batch.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param sent    Whether the message is being sent or has been received.
+ **/
+static
+void
+j_message_trace_flow (JMessage const* message, gboolean sent)
+{
+	JStatistics* statistics;
+	gboolean reply;
+
+	reply = ((j_message_get_flags(message) & J_MESSAGE_FLAGS_REPLY) != 0);
+
+	if ((statistics = j_batch_get_current_statistics()) != NULL)
+	{
+		guint64 length;
+
+		length = sizeof(JMessageHeader) + j_message_length(message);
+
+		if (sent)
+		{
+			if (message->send_list != NULL)
+			{
+				g_autoptr(JListIterator) iterator = NULL;
+
+				iterator = j_list_iterator_new(message->send_list);
+
+				while (j_list_iterator_next(iterator))
+				{
+					JMessageData* message_data = j_list_iterator_get(iterator);
+
+					length += message_data->length;
+				}
+			}
+
+			j_statistics_add_atomic(statistics, J_STATISTICS_MESSAGES_SENT, 1);
+			j_statistics_add_atomic(statistics, J_STATISTICS_BYTES_SENT, length);
+		}
+		else
+		{
+			j_statistics_add_atomic(statistics, J_STATISTICS_MESSAGES_RECEIVED, 1);
+			j_statistics_add_atomic(statistics, J_STATISTICS_BYTES_RECEIVED, length);
+		}
+	}
+
+	if (sent)
+	{
+		J_PROBE4(message_send, j_message_get_type(message), j_message_get_length(message), j_message_get_id(message), reply);
+	}
+	else
+	{
+		J_PROBE4(message_receive, j_message_get_type(message), j_message_get_length(message), j_message_get_id(message), reply);
+	}
+
+	/* Received requests are traced by the server when it handles them. */
+	if (sent)
+	{
+		j_trace_flow("message", j_message_get_id(message), (reply) ? J_TRACE_FLOW_STEP : J_TRACE_FLOW_BEGIN);
+	}
+	else if (reply)
+	{
+		j_trace_flow("message", j_message_get_id(message), J_TRACE_FLOW_END);
+	}
+}
+
+/**
+ * Reads a message from the network.
  *
  * \author Michael Kuhn
  *
@@ -875,31 +1552,1971 @@ j_message_receive (JMessage* message, GSocketConnection* connection)
  * \return TRUE on success, FALSE if an error occurred.
  **/
 gboolean
-j_message_send (JMessage* message, GSocketConnection* connection)
+j_message_receive (JMessage* message, GSocketConnection* connection)
 {
 	gboolean ret;
 
-	GOutputStream* stream;
+	GInputStream* stream;
+	gint64 start;
 
 	g_return_val_if_fail(message != NULL, FALSE);
 	g_return_val_if_fail(connection != NULL, FALSE);
 
-	j_trace_enter(G_STRFUNC, NULL);
+	j_trace_enter(G_STRFUNC, NULL);
+
+	start = g_get_monotonic_time();
+
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+	ret = j_message_read(message, stream);
+
+	j_batch_statistics_add(J_STATISTICS_NETWORK_TIME, g_get_monotonic_time() - start);
+
+	if (ret)
+	{
+		j_message_trace_flow(message, FALSE);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Compresses a message's body into a new buffer that can be sent instead of the message's body.
+ * The compressed body starts with the original body length.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param size    A return location for the buffer's size.
+ * \param length  A return location for the compressed body's length.
+ *
+ * \return A buffer, or NULL if the message should be sent uncompressed. Should be returned with j_message_buffer_put().
+ **/
+static
+gchar*
+j_message_compress (JMessage* message, gsize* size, gsize* length)
+{
+#ifdef HAVE_LZ4
+	gchar* buffer;
+	gsize body_length;
+	guint32 original_length;
+	gint compressed_length;
+
+	body_length = j_message_length(message);
+
+	if (body_length < J_MESSAGE_COMPRESSION_THRESHOLD || body_length > LZ4_MAX_INPUT_SIZE)
+	{
+		return NULL;
+	}
+
+	*size = sizeof(guint32) + LZ4_compressBound(body_length);
+	buffer = j_message_buffer_get(size);
+
+	compressed_length = LZ4_compress_default(message->data + sizeof(JMessageHeader), buffer + sizeof(guint32), body_length, *size - sizeof(guint32));
+
+	/* Only send the compressed body if it actually saves bandwidth. */
+	if (compressed_length <= 0 || sizeof(guint32) + compressed_length >= body_length)
+	{
+		j_message_buffer_put(buffer, *size);
+		return NULL;
+	}
+
+	original_length = GUINT32_TO_LE(body_length);
+	memcpy(buffer, &original_length, sizeof(guint32));
+
+	*length = sizeof(guint32) + compressed_length;
+
+	return buffer;
+#else
+	(void)message;
+	(void)size;
+	(void)length;
+
+	return NULL;
+#endif
+}
+
+/**
+ * Reads the upper half of a received message's length if the message has been sent with a 64-bit length.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param header      A received header.
+ * \param stream      A network stream.
+ * \param length_high A return location for the upper half of the length.
+ * \param error       A return location for an error.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_message_read_length_high (JMessageHeader* header, GInputStream* stream, guint32* length_high, GError** error)
+{
+	guint32 data;
+	gsize bytes_read;
+
+	*length_high = 0;
+
+	if (!(GUINT32_FROM_LE(header->flags) & J_MESSAGE_FLAGS_LENGTH64))
+	{
+		return TRUE;
+	}
+
+	if (!g_input_stream_read_all(stream, &data, sizeof(data), &bytes_read, j_batch_get_cancellable(), error) || bytes_read != sizeof(data))
+	{
+		return FALSE;
+	}
+
+	*length_high = GUINT32_FROM_LE(data);
+	header->flags = GUINT32_TO_LE(GUINT32_FROM_LE(header->flags) & ~J_MESSAGE_FLAGS_LENGTH64);
+
+	return TRUE;
+}
+
+/**
+ * Removes the trace ID from the end of a received message.
+ * It follows the checksums, so it has to be removed before verifying them.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return TRUE on success, FALSE if the message is too short.
+ **/
+static
+gboolean
+j_message_read_trace_id (JMessage* message)
+{
+	JMessageHeader* header;
+	guint64 trace_id;
+	gsize length;
+
+	message->trace_id = 0;
+
+	if (!(j_message_get_flags(message) & J_MESSAGE_FLAGS_TRACED))
+	{
+		return TRUE;
+	}
+
+	length = j_message_length(message);
+
+	if (length < sizeof(trace_id))
+	{
+		J_CRITICAL("Traced message too short (%" G_GSIZE_FORMAT " bytes)", length);
+		return FALSE;
+	}
+
+	length -= sizeof(trace_id);
+	memcpy(&trace_id, message->data + sizeof(JMessageHeader) + length, sizeof(trace_id));
+	message->trace_id = GUINT64_FROM_LE(trace_id);
+
+	j_message_set_length(message, length);
+
+	header = j_message_header(message);
+	header->flags = GUINT32_TO_LE(GUINT32_FROM_LE(header->flags) & ~J_MESSAGE_FLAGS_TRACED);
+
+	return TRUE;
+}
+
+/**
+ * Verifies a message's checksums if it has been sent with them and removes them from the body.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return TRUE on success, FALSE if the message is corrupted.
+ **/
+static
+gboolean
+j_message_verify (JMessage* message)
+{
+	JMessageHeader* header;
+	guint32 checksums[2];
+	gsize length;
+
+	message->payload_checksum_set = FALSE;
+
+	if (!(j_message_get_flags(message) & J_MESSAGE_FLAGS_CHECKSUM))
+	{
+		return TRUE;
+	}
+
+	length = j_message_length(message);
+
+	if (length < sizeof(checksums))
+	{
+		J_CRITICAL("Checksummed message too short (%" G_GSIZE_FORMAT " bytes)", length);
+		g_atomic_pointer_add(&j_message_checksum_errors, 1);
+		return FALSE;
+	}
+
+	length -= sizeof(checksums);
+	memcpy(checksums, message->data + sizeof(JMessageHeader) + length, sizeof(checksums));
+
+	if (j_helper_crc32c(0, message->data + sizeof(JMessageHeader), length) != GUINT32_FROM_LE(checksums[0]))
+	{
+		J_CRITICAL("Checksum mismatch in message %u", GUINT32_FROM_LE(j_message_header(message)->id));
+		g_atomic_pointer_add(&j_message_checksum_errors, 1);
+		return FALSE;
+	}
+
+	message->payload_checksum = GUINT32_FROM_LE(checksums[1]);
+	message->payload_checksum_set = TRUE;
+
+	j_message_set_length(message, length);
+
+	header = j_message_header(message);
+	header->flags = GUINT32_TO_LE(GUINT32_FROM_LE(header->flags) & ~J_MESSAGE_FLAGS_CHECKSUM);
+
+	return TRUE;
+}
+
+/**
+ * Decompresses a message's body in place if it has been sent compressed.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_message_decompress (JMessage* message)
+{
+#ifdef HAVE_LZ4
+	JMessageHeader* header;
+	gchar* data;
+	gsize size;
+	gsize length;
+	guint32 original_length;
+	gint decompressed_length;
+#endif
+
+	if (!(j_message_get_flags(message) & J_MESSAGE_FLAGS_COMPRESSED))
+	{
+		return TRUE;
+	}
+
+#ifdef HAVE_LZ4
+	length = j_message_length(message);
+
+	if (length < sizeof(guint32))
+	{
+		J_CRITICAL("Compressed message too short (%" G_GSIZE_FORMAT " bytes)", length);
+		return FALSE;
+	}
+
+	memcpy(&original_length, message->data + sizeof(JMessageHeader), sizeof(guint32));
+	original_length = GUINT32_FROM_LE(original_length);
+
+	/**
+	 * Senders only compress bodies of up to LZ4_MAX_INPUT_SIZE bytes and LZ4 cannot expand data by more than a factor of 255.
+	 * Larger lengths are corrupted or forged and must not be allocated.
+	 */
+	if (original_length > LZ4_MAX_INPUT_SIZE || (guint64)original_length > (guint64)(length - sizeof(guint32)) * 255)
+	{
+		J_CRITICAL("Compressed message claims an invalid length (%" G_GUINT32_FORMAT " bytes from %" G_GSIZE_FORMAT " bytes)", original_length, length - sizeof(guint32));
+		return FALSE;
+	}
+
+	size = sizeof(JMessageHeader) + original_length;
+	data = j_message_buffer_get(&size);
+
+	decompressed_length = LZ4_decompress_safe(message->data + sizeof(JMessageHeader) + sizeof(guint32), data + sizeof(JMessageHeader), length - sizeof(guint32), original_length);
+
+	if (decompressed_length < 0 || (guint32)decompressed_length != original_length)
+	{
+		J_CRITICAL("Failed to decompress message (%d)", decompressed_length);
+		j_message_buffer_put(data, size);
+		return FALSE;
+	}
+
+	memcpy(data, message->data, sizeof(JMessageHeader));
+	j_message_buffer_put(message->data, message->size);
+
+	message->data = data;
+	message->size = size;
+
+	j_message_set_length(message, original_length);
+
+	header = j_message_header(message);
+	header->flags = GUINT32_TO_LE(GUINT32_FROM_LE(header->flags) & ~J_MESSAGE_FLAGS_COMPRESSED);
+
+	return TRUE;
+#else
+	J_CRITICAL("%s", "Received compressed message but compression support is not available");
+
+	return FALSE;
+#endif
+}
+
+/**
+ * Sends all buffers, retrying after partial sends.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param socket  A socket.
+ * \param vectors The buffers. Will be modified.
+ * \param count   The number of buffers.
+ * \param error   A return location for an error.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_message_send_vectors (GSocket* socket, GOutputVector* vectors, guint count, GError** error)
+{
+	guint i = 0;
+
+	while (i < count)
+	{
+		gssize bytes_written;
+
+		bytes_written = g_socket_send_message(socket, NULL, vectors + i, count - i, NULL, 0, 0, j_batch_get_cancellable(), error);
+
+		if (bytes_written < 0)
+		{
+			return FALSE;
+		}
+
+		while (i < count && (gsize)bytes_written >= vectors[i].size)
+		{
+			bytes_written -= vectors[i].size;
+			i++;
+		}
+
+		if (i < count)
+		{
+			vectors[i].buffer = (gchar const*)vectors[i].buffer + bytes_written;
+			vectors[i].size -= bytes_written;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * The parts of a message as sent on the wire, excluding additional data.
+ **/
+struct JMessageOutput
+{
+	/**
+	 * A copy of the header, adapted to the compression and checksums.
+	 **/
+	JMessageHeader header;
+
+	/**
+	 * The upper half of the length, only sent if #header has J_MESSAGE_FLAGS_LENGTH64 set.
+	 **/
+	guint32 length_high;
+
+	/**
+	 * The checksums of the body and the additional data.
+	 **/
+	guint32 checksums[2];
+
+	/**
+	 * Whether #checksums is sent.
+	 **/
+	gboolean checksum;
+
+	/**
+	 * The trace ID, only sent if it is not 0.
+	 **/
+	guint64 trace_id;
+
+	/**
+	 * The body as sent.
+	 **/
+	gchar const* body;
+
+	/**
+	 * The length of #body.
+	 **/
+	gsize body_length;
+
+	/**
+	 * The compressed body, NULL if the body is not compressed.
+	 **/
+	gchar* compressed;
+
+	/**
+	 * The size of #compressed.
+	 **/
+	gsize compressed_size;
+};
+
+typedef struct JMessageOutput JMessageOutput;
+
+/**
+ * Prepares a message for sending.
+ * The message itself is left untouched, since it might be sent more than once.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param output   An output.
+ * \param message  A message.
+ * \param compress Whether the message's body may be compressed.
+ * \param checksum Whether to append checksums of the body and the additional data.
+ * \param length64 Whether the message may be longer than 4 GiB.
+ *
+ * \return TRUE on success, FALSE if the message is too long.
+ **/
+static
+gboolean
+j_message_output_init (JMessageOutput* output, JMessage* message, gboolean compress, gboolean checksum, gboolean length64)
+{
+	guint64 length;
+
+	memcpy(&(output->header), message->data, sizeof(JMessageHeader));
+	output->checksum = checksum;
+	output->body = message->data + sizeof(JMessageHeader);
+	output->body_length = j_message_length(message);
+	output->compressed = NULL;
+	output->compressed_size = 0;
+
+	if (compress)
+	{
+		output->compressed = j_message_compress(message, &(output->compressed_size), &(output->body_length));
+	}
+
+	if (output->compressed != NULL)
+	{
+		output->body = output->compressed;
+		output->header.flags = GUINT32_TO_LE(GUINT32_FROM_LE(output->header.flags) | J_MESSAGE_FLAGS_COMPRESSED);
+	}
+
+	if (checksum)
+	{
+		guint32 payload_checksum = 0;
+
+		/* The body checksum covers the body as sent, i.e. after compression. */
+		output->checksums[0] = GUINT32_TO_LE(j_helper_crc32c(0, output->body, output->body_length));
+
+		if (message->send_list != NULL)
+		{
+			g_autoptr(JListIterator) iterator = NULL;
+
+			iterator = j_list_iterator_new(message->send_list);
+
+			while (j_list_iterator_next(iterator))
+			{
+				JMessageData* message_data = j_list_iterator_get(iterator);
+
+				payload_checksum = j_helper_crc32c(payload_checksum, message_data->data, message_data->length);
+			}
+		}
+
+		output->checksums[1] = GUINT32_TO_LE(payload_checksum);
+		output->header.flags = GUINT32_TO_LE(GUINT32_FROM_LE(output->header.flags) | J_MESSAGE_FLAGS_CHECKSUM);
+	}
+
+	output->trace_id = GUINT64_TO_LE(message->trace_id);
+
+	if (message->trace_id != 0)
+	{
+		output->header.flags = GUINT32_TO_LE(GUINT32_FROM_LE(output->header.flags) | J_MESSAGE_FLAGS_TRACED);
+	}
+
+	length = output->body_length + ((checksum) ? sizeof(output->checksums) : 0) + ((message->trace_id != 0) ? sizeof(output->trace_id) : 0);
+
+	if (length > G_MAXUINT32)
+	{
+		/* Peers that do not know about 64-bit lengths would misinterpret the message. */
+		if (!length64)
+		{
+			J_CRITICAL("Message too long for the connection (%" G_GUINT64_FORMAT " bytes)", length);
+			return FALSE;
+		}
+
+		output->header.flags = GUINT32_TO_LE(GUINT32_FROM_LE(output->header.flags) | J_MESSAGE_FLAGS_LENGTH64);
+	}
+
+	output->header.length = GUINT32_TO_LE(length & G_MAXUINT32);
+	output->length_high = GUINT32_TO_LE(length >> 32);
+
+	return TRUE;
+}
+
+/**
+ * Returns an output's buffers.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param output  An output.
+ * \param vectors An array of at least five vectors.
+ *
+ * \return The number of buffers.
+ **/
+static
+guint
+j_message_output_get_vectors (JMessageOutput* output, GOutputVector* vectors)
+{
+	guint count = 0;
+
+	vectors[count].buffer = &(output->header);
+	vectors[count].size = sizeof(JMessageHeader);
+	count++;
+
+	if (GUINT32_FROM_LE(output->header.flags) & J_MESSAGE_FLAGS_LENGTH64)
+	{
+		vectors[count].buffer = &(output->length_high);
+		vectors[count].size = sizeof(output->length_high);
+		count++;
+	}
+
+	if (output->body_length > 0)
+	{
+		vectors[count].buffer = output->body;
+		vectors[count].size = output->body_length;
+		count++;
+	}
+
+	if (output->checksum)
+	{
+		vectors[count].buffer = output->checksums;
+		vectors[count].size = sizeof(output->checksums);
+		count++;
+	}
+
+	if (output->trace_id != 0)
+	{
+		vectors[count].buffer = &(output->trace_id);
+		vectors[count].size = sizeof(output->trace_id);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Frees the resources held by an output.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param output An output.
+ **/
+static
+void
+j_message_output_clear (JMessageOutput* output)
+{
+	if (output->compressed != NULL)
+	{
+		j_message_buffer_put(output->compressed, output->compressed_size);
+		output->compressed = NULL;
+	}
+}
+
+/**
+ * Writes a message to a socket using as few system calls as possible.
+ * The header, the body and all additional data are sent using vectored I/O.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message  A message.
+ * \param socket   A socket.
+ * \param compress Whether the message's body may be compressed.
+ * \param checksum Whether to append checksums of the body and the additional data.
+ * \param length64 Whether the message may be longer than 4 GiB.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+static
+gboolean
+j_message_write_vectored (JMessage* message, GSocket* socket, gboolean compress, gboolean checksum, gboolean length64)
+{
+	gboolean ret = FALSE;
+
+	g_autoptr(JListIterator) iterator = NULL;
+	GError* error = NULL;
+	GOutputVector vectors[J_MESSAGE_VECTORS_MAX];
+	JMessageOutput output;
+	guint count;
+
+	if (!j_message_output_init(&output, message, compress, checksum, length64))
+	{
+		goto end;
+	}
+
+	count = j_message_output_get_vectors(&output, vectors);
+
+	if (message->send_list != NULL)
+	{
+		iterator = j_list_iterator_new(message->send_list);
+
+		while (j_list_iterator_next(iterator))
+		{
+			JMessageData* message_data = j_list_iterator_get(iterator);
+
+			if (message_data->length == 0)
+			{
+				continue;
+			}
+
+			if (count == J_MESSAGE_VECTORS_MAX)
+			{
+				if (!j_message_send_vectors(socket, vectors, count, &error))
+				{
+					goto end;
+				}
+
+				count = 0;
+			}
+
+			vectors[count].buffer = message_data->data;
+			vectors[count].size = message_data->length;
+			count++;
+		}
+	}
+
+	if (!j_message_send_vectors(socket, vectors, count, &error))
+	{
+		goto end;
+	}
+
+	ret = TRUE;
+
+end:
+	j_message_output_clear(&output);
+
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	return ret;
+}
+
+/**
+ * Reads a reply from the network whose corresponding message is not known in advance.
+ * After the header has been read, the reply to fill is looked up using the message ID.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param func       A function returning the reply for a message ID.
+ * \param data       User data passed to #func.
+ * \param reply      A return location for the reply. Will be set to NULL if #func did not return a reply.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_receive_lookup (GSocketConnection* connection, JMessageLookupFunc func, gpointer data, JMessage** reply)
+{
+	gboolean ret = FALSE;
+
+	JMessageHeader header;
+	JMessage* message;
+	GInputStream* stream;
+	GError* error = NULL;
+	gsize bytes_read;
+	gsize length;
+	guint32 length_high;
+	gint64 start;
+
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+	g_return_val_if_fail(reply != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	start = g_get_monotonic_time();
+
+	*reply = NULL;
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	if (!g_input_stream_read_all(stream, &header, sizeof(JMessageHeader), &bytes_read, j_batch_get_cancellable(), &error) || bytes_read == 0)
+	{
+		goto end;
+	}
+
+	if (!j_message_read_length_high(&header, stream, &length_high, &error))
+	{
+		goto end;
+	}
+
+	length = ((guint64)length_high << 32) | GUINT32_FROM_LE(header.length);
+	message = func(GUINT32_FROM_LE(header.id), data);
+
+	if (message == NULL)
+	{
+		/* Skip the unexpected reply to keep the stream consistent. */
+		ret = (g_input_stream_skip(stream, length, j_batch_get_cancellable(), &error) == (gssize)length);
+		goto end;
+	}
+
+	memcpy(message->data, &header, sizeof(JMessageHeader));
+	message->length_high = length_high;
+	j_message_ensure_size(message, sizeof(JMessageHeader) + length);
+
+	if (!g_input_stream_read_all(stream, message->data + sizeof(JMessageHeader), length, &bytes_read, j_batch_get_cancellable(), &error))
+	{
+		goto end;
+	}
+
+	if (!j_message_read_trace_id(message) || !j_message_verify(message) || !j_message_decompress(message))
+	{
+		goto end;
+	}
+
+	message->current = message->data + sizeof(JMessageHeader);
+	*reply = message;
+
+	j_message_trace_flow(message, FALSE);
+
+	ret = TRUE;
+
+end:
+	j_batch_statistics_add(J_STATISTICS_NETWORK_TIME, g_get_monotonic_time() - start);
+
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Reads the checksums and the trace ID that follow the body of a message received using j_message_receive_body().
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message whose body has been received completely.
+ * \param stream  A network stream.
+ * \param error   A return location for an error.
+ *
+ * \return TRUE on success, FALSE if an error occurred or the message is corrupted.
+ **/
+static
+gboolean
+j_message_read_trailer (JMessage* message, GInputStream* stream, GError** error)
+{
+	JMessageHeader* header;
+	gsize bytes_read;
+
+	header = j_message_header(message);
+
+	if (GUINT32_FROM_LE(header->flags) & J_MESSAGE_FLAGS_CHECKSUM)
+	{
+		guint32 checksums[2];
+
+		if (!g_input_stream_read_all(stream, checksums, sizeof(checksums), &bytes_read, j_batch_get_cancellable(), error) || bytes_read != sizeof(checksums))
+		{
+			return FALSE;
+		}
+
+		if (message->body_checksum != GUINT32_FROM_LE(checksums[0]))
+		{
+			J_CRITICAL("Checksum mismatch in message %u", GUINT32_FROM_LE(header->id));
+			g_atomic_pointer_add(&j_message_checksum_errors, 1);
+			return FALSE;
+		}
+
+		message->payload_checksum = GUINT32_FROM_LE(checksums[1]);
+		message->payload_checksum_set = TRUE;
+	}
+
+	if (GUINT32_FROM_LE(header->flags) & J_MESSAGE_FLAGS_TRACED)
+	{
+		guint64 trace_id;
+
+		if (!g_input_stream_read_all(stream, &trace_id, sizeof(trace_id), &bytes_read, j_batch_get_cancellable(), error) || bytes_read != sizeof(trace_id))
+		{
+			return FALSE;
+		}
+
+		message->trace_id = GUINT64_FROM_LE(trace_id);
+	}
+
+	header->flags = GUINT32_TO_LE(GUINT32_FROM_LE(header->flags) & ~(J_MESSAGE_FLAGS_CHECKSUM | J_MESSAGE_FLAGS_TRACED));
+
+	return TRUE;
+}
+
+/**
+ * Reads a message's header from the network, but not its body.
+ * The body has to be received using j_message_receive_body() before the next message can be received.
+ * This allows receiving very long messages into the caller's buffers without buffering their bodies in the message.
+ * Compressed bodies can only be decompressed as a whole, so they are received completely.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint64 length;
+ *
+ * if (j_message_receive_header(message, connection, &length))
+ * {
+ *   while (length > 0)
+ *   {
+ *     gsize piece = MIN(length, buffer_size);
+ *
+ *     j_message_receive_body(message, connection, buffer, piece);
+ *     length -= piece;
+ *   }
+ * }
+ * \endcode
+ *
+ * \param message    A message.
+ * \param connection A connection.
+ * \param length     A return location for the body's length.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_receive_header (JMessage* message, GSocketConnection* connection, guint64* length)
+{
+	gboolean ret = FALSE;
+
+	GInputStream* stream;
+	GError* error = NULL;
+	JMessageFlags flags;
+	gsize bytes_read;
+	guint64 trailer_length = 0;
+	gint64 start;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(length != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	start = g_get_monotonic_time();
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	message->payload_checksum_set = FALSE;
+	message->trace_id = 0;
+	message->body_remaining = 0;
+	message->body_checksum = 0;
+	message->body_buffered = FALSE;
+
+	if (!g_input_stream_read_all(stream, message->data, sizeof(JMessageHeader), &bytes_read, j_batch_get_cancellable(), &error) || bytes_read == 0)
+	{
+		goto end;
+	}
+
+	if (!j_message_read_length_high(j_message_header(message), stream, &(message->length_high), &error))
+	{
+		goto end;
+	}
+
+	flags = j_message_get_flags(message);
+
+	if (flags & J_MESSAGE_FLAGS_COMPRESSED)
+	{
+		j_message_ensure_size(message, sizeof(JMessageHeader) + j_message_length(message));
+
+		if (!g_input_stream_read_all(stream, message->data + sizeof(JMessageHeader), j_message_length(message), &bytes_read, j_batch_get_cancellable(), &error))
+		{
+			goto end;
+		}
+
+		if (!j_message_read_trace_id(message) || !j_message_verify(message) || !j_message_decompress(message))
+		{
+			goto end;
+		}
+
+		message->body_remaining = j_message_length(message);
+		message->body_buffered = TRUE;
+	}
+	else
+	{
+		if (flags & J_MESSAGE_FLAGS_CHECKSUM)
+		{
+			trailer_length += 2 * sizeof(guint32);
+		}
+
+		if (flags & J_MESSAGE_FLAGS_TRACED)
+		{
+			trailer_length += sizeof(guint64);
+		}
+
+		if (j_message_length(message) < trailer_length)
+		{
+			J_CRITICAL("Message too short (%" G_GSIZE_FORMAT " bytes)", j_message_length(message));
+			goto end;
+		}
+
+		message->body_remaining = j_message_length(message) - trailer_length;
+
+		/* The body is not stored in the message, so it can not be read using j_message_get_n() and friends. */
+		j_message_set_length(message, 0);
+
+		if (message->body_remaining == 0 && !j_message_read_trailer(message, stream, &error))
+		{
+			goto end;
+		}
+	}
+
+	message->current = message->data + sizeof(JMessageHeader);
+	*length = message->body_remaining;
+
+	j_message_trace_flow(message, FALSE);
+
+	ret = TRUE;
+
+end:
+	j_batch_statistics_add(J_STATISTICS_NETWORK_TIME, g_get_monotonic_time() - start);
+
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Reads the next part of a message's body from the network.
+ * The message's header has to be received using j_message_receive_header() first.
+ * Once the whole body has been received, its checksum is verified.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message    A message.
+ * \param connection A connection.
+ * \param data       A buffer.
+ * \param length     The number of bytes to read, at most the remaining length of the body.
+ *
+ * \return TRUE on success, FALSE if an error occurred or the message is corrupted.
+ **/
+gboolean
+j_message_receive_body (JMessage* message, GSocketConnection* connection, gpointer data, gsize length)
+{
+	gboolean ret = FALSE;
+
+	GInputStream* stream;
+	GError* error = NULL;
+	gsize bytes_read;
+	gint64 start;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(data != NULL || length == 0, FALSE);
+	g_return_val_if_fail(length <= message->body_remaining, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	start = g_get_monotonic_time();
+
+	if (message->body_buffered)
+	{
+		memcpy(data, message->current, length);
+		message->current += length;
+		message->body_remaining -= length;
+
+		ret = TRUE;
+		goto end;
+	}
+
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	if (!g_input_stream_read_all(stream, data, length, &bytes_read, j_batch_get_cancellable(), &error) || bytes_read != length)
+	{
+		goto end;
+	}
+
+	if (j_message_get_flags(message) & J_MESSAGE_FLAGS_CHECKSUM)
+	{
+		message->body_checksum = j_helper_crc32c(message->body_checksum, data, length);
+	}
+
+	message->body_remaining -= length;
+
+	/* The checksums and the trace ID follow the body. */
+	if (message->body_remaining == 0 && !j_message_read_trailer(message, stream, &error))
+	{
+		goto end;
+	}
+
+	ret = TRUE;
+
+end:
+	j_batch_statistics_add(J_STATISTICS_NETWORK_TIME, g_get_monotonic_time() - start);
+
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Returns whether message compression is supported.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return TRUE if compression is supported, FALSE otherwise.
+ **/
+gboolean
+j_message_compression_available (void)
+{
+#ifdef HAVE_LZ4
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * Sets whether messages sent on a connection may be compressed.
+ * This should only be enabled after both peers have agreed on compression.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param compress   Whether to compress messages.
+ **/
+void
+j_message_set_compression (GSocketConnection* connection, gboolean compress)
+{
+	g_return_if_fail(connection != NULL);
+
+	g_object_set_data(G_OBJECT(connection), J_MESSAGE_COMPRESSION_KEY, GINT_TO_POINTER(compress && j_message_compression_available()));
+}
+
+/**
+ * Returns whether messages sent on a connection may be compressed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE if messages are compressed, FALSE otherwise.
+ **/
+gboolean
+j_message_get_compression (GSocketConnection* connection)
+{
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	return GPOINTER_TO_INT(g_object_get_data(G_OBJECT(connection), J_MESSAGE_COMPRESSION_KEY));
+}
+
+/**
+ * Sets whether messages sent on a connection are checksummed.
+ * This should only be enabled after both peers have agreed on checksums.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param checksum   Whether to checksum messages.
+ **/
+void
+j_message_set_checksum (GSocketConnection* connection, gboolean checksum)
+{
+	g_return_if_fail(connection != NULL);
+
+	g_object_set_data(G_OBJECT(connection), J_MESSAGE_CHECKSUM_KEY, GINT_TO_POINTER(checksum));
+}
+
+/**
+ * Returns whether messages sent on a connection are checksummed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE if messages are checksummed, FALSE otherwise.
+ **/
+gboolean
+j_message_get_checksum (GSocketConnection* connection)
+{
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	return GPOINTER_TO_INT(g_object_get_data(G_OBJECT(connection), J_MESSAGE_CHECKSUM_KEY));
+}
+
+/**
+ * Sets whether messages longer than 4 GiB may be sent on a connection.
+ * This should only be enabled after both peers have agreed on 64-bit lengths.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param length64   Whether to allow 64-bit lengths.
+ **/
+void
+j_message_set_length64 (GSocketConnection* connection, gboolean length64)
+{
+	g_return_if_fail(connection != NULL);
+
+	g_object_set_data(G_OBJECT(connection), J_MESSAGE_LENGTH64_KEY, GINT_TO_POINTER(length64));
+}
+
+/**
+ * Returns whether messages longer than 4 GiB may be sent on a connection.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE if 64-bit lengths are allowed, FALSE otherwise.
+ **/
+gboolean
+j_message_get_length64 (GSocketConnection* connection)
+{
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	return GPOINTER_TO_INT(g_object_get_data(G_OBJECT(connection), J_MESSAGE_LENGTH64_KEY));
+}
+
+/**
+ * Returns the checksum of the additional data sent after a received message.
+ * The additional data is read separately, so it has to be verified by the caller using j_helper_crc32c().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message  A message.
+ * \param checksum A return location for the checksum.
+ *
+ * \return TRUE if the message contained a checksum, FALSE otherwise.
+ **/
+gboolean
+j_message_get_payload_checksum (JMessage* message, guint32* checksum)
+{
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(checksum != NULL, FALSE);
+
+	if (!message->payload_checksum_set)
+	{
+		return FALSE;
+	}
+
+	*checksum = message->payload_checksum;
+
+	return TRUE;
+}
+
+/**
+ * Returns the number of corrupted messages that have been detected.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return The number of checksum errors.
+ **/
+guint64
+j_message_get_checksum_error_count (void)
+{
+	return (guint64)g_atomic_pointer_get(&j_message_checksum_errors);
+}
+
+/**
+ * Writes a message to the network.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \parem stream  A network stream.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_send (JMessage* message, GSocketConnection* connection)
+{
+	gboolean ret;
+	gint64 start;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(connection != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_message_trace_flow(message, TRUE);
+
+	start = g_get_monotonic_time();
+
+	j_helper_set_cork(connection, TRUE);
+
+	ret = j_message_write_vectored(message, g_socket_connection_get_socket(connection), j_message_get_compression(connection), j_message_get_checksum(connection), j_message_get_length64(connection));
+
+	j_helper_set_cork(connection, FALSE);
+
+	j_batch_statistics_add(J_STATISTICS_NETWORK_TIME, g_get_monotonic_time() - start);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Reads a message from the network.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \parem stream  A network stream.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_read (JMessage* message, GInputStream* stream)
+{
+	gboolean ret = FALSE;
+
+	GError* error = NULL;
+	gsize bytes_read;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(stream != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (j_message_get_flags(message) & J_MESSAGE_FLAGS_REPLY)
+	{
+		g_return_val_if_fail(message->original_message != NULL, FALSE);
+	}
+
+	if (!g_input_stream_read_all(stream, message->data, sizeof(JMessageHeader), &bytes_read, j_batch_get_cancellable(), &error))
+	{
+		goto end;
+	}
+
+	if (bytes_read == 0)
+	{
+		goto end;
+	}
+
+	if (!j_message_read_length_high(j_message_header(message), stream, &(message->length_high), &error))
+	{
+		goto end;
+	}
+
+	j_message_ensure_size(message, sizeof(JMessageHeader) + j_message_length(message));
+
+	if (!g_input_stream_read_all(stream, message->data + sizeof(JMessageHeader), j_message_length(message), &bytes_read, j_batch_get_cancellable(), &error))
+	{
+		goto end;
+	}
+
+	if (!j_message_read_trace_id(message) || !j_message_verify(message) || !j_message_decompress(message))
+	{
+		goto end;
+	}
+
+	message->current = message->data + sizeof(JMessageHeader);
+
+	if (j_message_get_flags(message) & J_MESSAGE_FLAGS_REPLY)
+	{
+		g_assert(j_message_header(message)->id == j_message_header(message->original_message)->id);
+	}
+
+	ret = TRUE;
+
+end:
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Writes a message to the network.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \parem stream  A network stream.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_write (JMessage* message, GOutputStream* stream)
+{
+	gboolean ret = FALSE;
+
+	g_autoptr(JListIterator) iterator = NULL;
+	GError* error = NULL;
+	gsize bytes_written;
+
+	g_return_val_if_fail(message != NULL, FALSE);
+	g_return_val_if_fail(stream != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (j_message_length(message) > G_MAXUINT32)
+	{
+		JMessageHeader header;
+		guint32 length_high;
+
+		/* Only peers that have negotiated 64-bit lengths can receive such messages. */
+		memcpy(&header, message->data, sizeof(JMessageHeader));
+		header.flags = GUINT32_TO_LE(GUINT32_FROM_LE(header.flags) | J_MESSAGE_FLAGS_LENGTH64);
+		length_high = GUINT32_TO_LE(message->length_high);
+
+		if (!g_output_stream_write_all(stream, &header, sizeof(JMessageHeader), &bytes_written, j_batch_get_cancellable(), &error)
+		    || !g_output_stream_write_all(stream, &length_high, sizeof(length_high), &bytes_written, j_batch_get_cancellable(), &error)
+		    || !g_output_stream_write_all(stream, message->data + sizeof(JMessageHeader), j_message_length(message), &bytes_written, j_batch_get_cancellable(), &error))
+		{
+			goto end;
+		}
+	}
+	else if (!g_output_stream_write_all(stream, message->data, sizeof(JMessageHeader) + j_message_length(message), &bytes_written, j_batch_get_cancellable(), &error))
+	{
+		goto end;
+	}
+
+	if (bytes_written == 0)
+	{
+		goto end;
+	}
+
+	if (message->send_list != NULL)
+	{
+		iterator = j_list_iterator_new(message->send_list);
+
+		while (j_list_iterator_next(iterator))
+		{
+			JMessageData* message_data = j_list_iterator_get(iterator);
+
+			if (!g_output_stream_write_all(stream, message_data->data, message_data->length, &bytes_written, j_batch_get_cancellable(), &error))
+			{
+				goto end;
+			}
+		}
+	}
+
+	g_output_stream_flush(stream, NULL, NULL);
+
+	ret = TRUE;
+
+end:
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * The state of an asynchronous send or receive.
+ **/
+struct JMessageAsync
+{
+	/**
+	 * The message, NULL when receiving additional data.
+	 **/
+	JMessage* message;
+
+	/**
+	 * The connection.
+	 **/
+	GSocketConnection* connection;
+
+	/**
+	 * The prepared message when sending.
+	 **/
+	JMessageOutput output;
+
+	/**
+	 * The buffers of #output.
+	 **/
+	GOutputVector vectors[5];
+
+	/**
+	 * The number of buffers in #vectors.
+	 **/
+	guint vector_count;
+
+	/**
+	 * The next buffer in #vectors.
+	 **/
+	guint vector_index;
+
+	/**
+	 * Iterates over the additional data when sending.
+	 **/
+	JListIterator* iterator;
+
+	/**
+	 * The current buffer when sending.
+	 **/
+	gchar const* send_buffer;
+
+	/**
+	 * The current buffer when receiving.
+	 **/
+	gchar* buffer;
+
+	/**
+	 * The remaining bytes of #buffer.
+	 **/
+	gsize remaining;
+
+	/**
+	 * Whether the header has been received.
+	 **/
+	gboolean header_done;
+
+	/**
+	 * The upper half of the length when receiving a message with a 64-bit length.
+	 **/
+	guint32 length_high;
+};
+
+typedef struct JMessageAsync JMessageAsync;
+
+static
+void
+j_message_async_free (gpointer data)
+{
+	JMessageAsync* async = data;
+
+	if (async->iterator != NULL)
+	{
+		j_list_iterator_free(async->iterator);
+		j_message_output_clear(&(async->output));
+	}
+
+	if (async->message != NULL)
+	{
+		j_message_unref(async->message);
+	}
+
+	g_object_unref(async->connection);
+
+	g_slice_free(JMessageAsync, async);
+}
+
+static
+JMessageAsync*
+j_message_async_new (JMessage* message, GSocketConnection* connection)
+{
+	JMessageAsync* async;
+
+	async = g_slice_new(JMessageAsync);
+	async->message = (message != NULL) ? j_message_ref(message) : NULL;
+	async->connection = g_object_ref(connection);
+	async->vector_count = 0;
+	async->vector_index = 0;
+	async->iterator = NULL;
+	async->send_buffer = NULL;
+	async->buffer = NULL;
+	async->remaining = 0;
+	async->header_done = FALSE;
+	async->length_high = 0;
+
+	return async;
+}
+
+static void j_message_send_async_next (GTask*);
+
+static
+void
+j_message_send_async_written (GObject* source, GAsyncResult* result, gpointer data)
+{
+	GTask* task = data;
+	JMessageAsync* async;
+	GError* error = NULL;
+	gssize bytes_written;
+
+	async = g_task_get_task_data(task);
+	bytes_written = g_output_stream_write_finish(G_OUTPUT_STREAM(source), result, &error);
+
+	if (bytes_written < 0)
+	{
+		g_task_return_error(task, error);
+		g_object_unref(task);
+		return;
+	}
+
+	async->send_buffer += bytes_written;
+	async->remaining -= bytes_written;
+
+	j_message_send_async_next(task);
+}
+
+static
+void
+j_message_send_async_next (GTask* task)
+{
+	JMessageAsync* async;
+	GOutputStream* stream;
+
+	async = g_task_get_task_data(task);
+
+	while (async->remaining == 0)
+	{
+		if (async->vector_index < async->vector_count)
+		{
+			async->send_buffer = async->vectors[async->vector_index].buffer;
+			async->remaining = async->vectors[async->vector_index].size;
+			async->vector_index++;
+		}
+		else if (j_list_iterator_next(async->iterator))
+		{
+			JMessageData* message_data = j_list_iterator_get(async->iterator);
+
+			async->send_buffer = message_data->data;
+			async->remaining = message_data->length;
+		}
+		else
+		{
+			g_task_return_boolean(task, TRUE);
+			g_object_unref(task);
+			return;
+		}
+	}
+
+	stream = g_io_stream_get_output_stream(G_IO_STREAM(async->connection));
+	g_output_stream_write_async(stream, async->send_buffer, async->remaining, G_PRIORITY_DEFAULT, g_task_get_cancellable(task), j_message_send_async_written, task);
+}
+
+/**
+ * Writes a message to the network without blocking.
+ * #callback is invoked in the thread-default main context once the message has been sent,
+ * it should call j_message_send_finish().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message    A message.
+ * \param connection A connection.
+ * \param callback   A callback.
+ * \param data       User data passed to #callback.
+ **/
+void
+j_message_send_async (JMessage* message, GSocketConnection* connection, GAsyncReadyCallback callback, gpointer data)
+{
+	JMessageAsync* async;
+	GTask* task;
+
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_message_trace_flow(message, TRUE);
+
+	async = j_message_async_new(message, connection);
+	async->iterator = j_list_iterator_new(message->send_list);
+
+	task = g_task_new(connection, j_batch_get_cancellable(), callback, data);
+	g_task_set_task_data(task, async, j_message_async_free);
+
+	if (!j_message_output_init(&(async->output), message, j_message_get_compression(connection), j_message_get_checksum(connection), j_message_get_length64(connection)))
+	{
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE, "Message too long for the connection");
+		g_object_unref(task);
+		goto end;
+	}
+
+	async->vector_count = j_message_output_get_vectors(&(async->output), async->vectors);
+
+	j_message_send_async_next(task);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Finishes sending a message started with j_message_send_async().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param result The result passed to the callback.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_send_finish (GAsyncResult* result)
+{
+	gboolean ret;
+
+	GError* error = NULL;
+
+	g_return_val_if_fail(result != NULL, FALSE);
+
+	ret = g_task_propagate_boolean(G_TASK(result), &error);
+
+	if (error != NULL)
+	{
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			J_CRITICAL("%s", error->message);
+		}
+
+		g_error_free(error);
+	}
+
+	return ret;
+}
+
+static void j_message_receive_async_next (GTask*);
+
+static
+void
+j_message_receive_async_read (GObject* source, GAsyncResult* result, gpointer data)
+{
+	GTask* task = data;
+	JMessageAsync* async;
+	GError* error = NULL;
+	gssize bytes_read;
+
+	async = g_task_get_task_data(task);
+	bytes_read = g_input_stream_read_finish(G_INPUT_STREAM(source), result, &error);
+
+	if (bytes_read <= 0)
+	{
+		if (error == NULL)
+		{
+			error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CLOSED, "Connection closed");
+		}
+
+		g_task_return_error(task, error);
+		g_object_unref(task);
+		return;
+	}
+
+	async->buffer += bytes_read;
+	async->remaining -= bytes_read;
+
+	j_message_receive_async_next(task);
+}
+
+static
+void
+j_message_receive_async_next (GTask* task)
+{
+	JMessageAsync* async;
+	GInputStream* stream;
+
+	async = g_task_get_task_data(task);
+
+	while (async->remaining == 0)
+	{
+		JMessage* message = async->message;
+
+		if (message != NULL && !async->header_done)
+		{
+			JMessageHeader* header = j_message_header(message);
+
+			/* The upper half of a 64-bit length follows the header. */
+			if (GUINT32_FROM_LE(header->flags) & J_MESSAGE_FLAGS_LENGTH64)
+			{
+				header->flags = GUINT32_TO_LE(GUINT32_FROM_LE(header->flags) & ~J_MESSAGE_FLAGS_LENGTH64);
+
+				async->buffer = (gchar*)&(async->length_high);
+				async->remaining = sizeof(async->length_high);
+
+				continue;
+			}
+
+			async->header_done = TRUE;
+			message->length_high = GUINT32_FROM_LE(async->length_high);
+
+			j_message_ensure_size(message, sizeof(JMessageHeader) + j_message_length(message));
+			async->buffer = message->data + sizeof(JMessageHeader);
+			async->remaining = j_message_length(message);
+
+			continue;
+		}
+
+		if (message != NULL)
+		{
+			if (!j_message_read_trace_id(message) || !j_message_verify(message) || !j_message_decompress(message))
+			{
+				g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Received invalid message");
+				g_object_unref(task);
+				return;
+			}
+
+			message->current = message->data + sizeof(JMessageHeader);
+
+			if (j_message_get_flags(message) & J_MESSAGE_FLAGS_REPLY)
+			{
+				g_assert(j_message_header(message)->id == j_message_header(message->original_message)->id);
+			}
+
+			j_message_trace_flow(message, FALSE);
+		}
+
+		g_task_return_boolean(task, TRUE);
+		g_object_unref(task);
+		return;
+	}
+
+	stream = g_io_stream_get_input_stream(G_IO_STREAM(async->connection));
+	g_input_stream_read_async(stream, async->buffer, async->remaining, G_PRIORITY_DEFAULT, g_task_get_cancellable(task), j_message_receive_async_read, task);
+}
+
+/**
+ * Reads a message from the network without blocking.
+ * #callback is invoked in the thread-default main context once the message has been received,
+ * it should call j_message_receive_finish().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message    A message.
+ * \param connection A connection.
+ * \param callback   A callback.
+ * \param data       User data passed to #callback.
+ **/
+void
+j_message_receive_async (JMessage* message, GSocketConnection* connection, GAsyncReadyCallback callback, gpointer data)
+{
+	JMessageAsync* async;
+	GTask* task;
+
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(connection != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	async = j_message_async_new(message, connection);
+	async->buffer = message->data;
+	async->remaining = sizeof(JMessageHeader);
+
+	task = g_task_new(connection, j_batch_get_cancellable(), callback, data);
+	g_task_set_task_data(task, async, j_message_async_free);
+
+	j_message_receive_async_next(task);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Finishes receiving a message started with j_message_receive_async().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param result The result passed to the callback.
+ *
+ * \return TRUE on success, FALSE if an error occurred.
+ **/
+gboolean
+j_message_receive_finish (GAsyncResult* result)
+{
+	return j_message_send_finish(result);
+}
+
+/**
+ * Reads additional data following a message from the network without blocking.
+ * #callback is invoked in the thread-default main context once all data has been received,
+ * it should call j_message_receive_finish().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param data       A buffer.
+ * \param length     The number of bytes to read.
+ * \param callback   A callback.
+ * \param user_data  User data passed to #callback.
+ **/
+void
+j_message_receive_data_async (GSocketConnection* connection, gpointer data, gsize length, GAsyncReadyCallback callback, gpointer user_data)
+{
+	JMessageAsync* async;
+	GTask* task;
+
+	g_return_if_fail(connection != NULL);
+	g_return_if_fail(data != NULL || length == 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	async = j_message_async_new(NULL, connection);
+	async->buffer = data;
+	async->remaining = length;
+
+	task = g_task_new(connection, j_batch_get_cancellable(), callback, user_data);
+	g_task_set_task_data(task, async, j_message_async_free);
+
+	j_message_receive_async_next(task);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Adds new data to send to a message.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param data    Data.
+ * \param length  A length.
+ **/
+void
+j_message_add_send (JMessage* message, gconstpointer data, guint64 length)
+{
+	JMessageData* message_data;
+
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(data != NULL);
+	g_return_if_fail(length > 0);
 
-	j_helper_set_cork(connection, TRUE);
+	j_trace_enter(G_STRFUNC, NULL);
 
-	stream = g_io_stream_get_output_stream(G_IO_STREAM(connection));
-	ret = j_message_write(message, stream);
+	message_data = g_slice_new(JMessageData);
+	message_data->data = data;
+	message_data->length = length;
 
-	j_helper_set_cork(connection, FALSE);
+	j_list_append(message->send_list, message_data);
 
 	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 /**
- * Reads a message from the network.
+ * Adds a new operation to a message.
  *
  * \author Michael Kuhn
  *
@@ -907,168 +3524,248 @@ j_message_send (JMessage* message, GSocketConnection* connection)
  * \endcode
  *
  * \param message A message.
- * \parem stream  A network stream.
- *
- * \return TRUE on success, FALSE if an error occurred.
+ * \param length  A length.
  **/
-gboolean
-j_message_read (JMessage* message, GInputStream* stream)
+void
+j_message_add_operation (JMessage* message, gsize length)
 {
-	gboolean ret = FALSE;
-
-	GError* error = NULL;
-	gsize bytes_read;
+	guint32 new_op_count;
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(stream != NULL, FALSE);
+	g_return_if_fail(message != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (j_message_get_flags(message) & J_MESSAGE_FLAGS_REPLY)
-	{
-		g_return_val_if_fail(message->original_message != NULL, FALSE);
-	}
+	new_op_count = j_message_get_count(message) + 1;
+	j_message_header(message)->op_count = GUINT32_TO_LE(new_op_count);
 
-	if (!g_input_stream_read_all(stream, message->data, sizeof(JMessageHeader), &bytes_read, NULL, &error))
-	{
-		goto end;
-	}
+	j_message_extend(message, length);
 
-	if (bytes_read == 0)
-	{
-		goto end;
-	}
+	j_trace_leave(G_STRFUNC);
+}
 
-	j_message_ensure_size(message, sizeof(JMessageHeader) + j_message_length(message));
+/**
+ * Appends a message to a compound message.
+ * The message's header and body are copied, its additional data is sent after the compound message's previous additional data.
+ * The additional data must therefore remain valid until the compound message has been sent.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message  A compound message.
+ * \param embedded A message.
+ **/
+void
+j_message_append_message (JMessage* message, JMessage* embedded)
+{
+	g_autoptr(JListIterator) iterator = NULL;
+	guint32 type;
+	guint32 flags;
+	guint32 count;
+	guint32 length;
 
-	if (!g_input_stream_read_all(stream, message->data + sizeof(JMessageHeader), j_message_length(message), &bytes_read, NULL, &error))
-	{
-		goto end;
-	}
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(embedded != NULL);
+	g_return_if_fail(j_message_get_type(message) == J_MESSAGE_COMPOUND);
+	g_return_if_fail(j_message_length(embedded) <= G_MAXUINT32);
 
-	message->current = message->data + sizeof(JMessageHeader);
+	j_trace_enter(G_STRFUNC, NULL);
 
-	if (j_message_get_flags(message) & J_MESSAGE_FLAGS_REPLY)
-	{
-		g_assert(j_message_header(message)->id == j_message_header(message->original_message)->id);
-	}
+	type = j_message_get_type(embedded);
+	flags = j_message_get_flags(embedded);
+	count = j_message_get_count(embedded);
+	length = j_message_length(embedded);
 
-	ret = TRUE;
+	j_message_add_operation(message, 4 * sizeof(guint32) + length);
+	j_message_append_4(message, &type);
+	j_message_append_4(message, &flags);
+	j_message_append_4(message, &count);
+	j_message_append_4(message, &length);
+	j_message_append_n(message, embedded->data + sizeof(JMessageHeader), length);
 
-end:
-	if (error != NULL)
+	iterator = j_list_iterator_new(embedded->send_list);
+
+	while (j_list_iterator_next(iterator))
 	{
-		J_CRITICAL("%s", error->message);
-		g_error_free(error);
+		JMessageData* message_data = j_list_iterator_get(iterator);
+
+		j_message_add_send(message, message_data->data, message_data->length);
 	}
 
 	j_trace_leave(G_STRFUNC);
-
-	return ret;
 }
 
 /**
- * Writes a message to the network.
+ * Gets a message from a compound message.
+ * The message inherits the compound message's ID and trace ID, so that its reply can be matched to the compound message.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param message A message.
- * \parem stream  A network stream.
+ * \param message A compound message.
  *
- * \return TRUE on success, FALSE if an error occurred.
+ * \return A new message. Should be freed with j_message_unref().
  **/
-gboolean
-j_message_write (JMessage* message, GOutputStream* stream)
+JMessage*
+j_message_get_message (JMessage* message)
 {
-	gboolean ret = FALSE;
+	JMessage* embedded;
+	gconstpointer data;
+	guint32 type;
+	guint32 flags;
+	guint32 count;
+	guint32 length;
 
-	g_autoptr(JListIterator) iterator = NULL;
-	GError* error = NULL;
-	gsize bytes_written;
+	g_return_val_if_fail(message != NULL, NULL);
+	g_return_val_if_fail(j_message_get_type(message) == J_MESSAGE_COMPOUND, NULL);
 
-	g_return_val_if_fail(message != NULL, FALSE);
-	g_return_val_if_fail(stream != NULL, FALSE);
+	j_trace_enter(G_STRFUNC, NULL);
+
+	type = j_message_get_4(message);
+	flags = j_message_get_4(message);
+	count = j_message_get_4(message);
+	length = j_message_get_4(message);
+	data = j_message_get_n(message, length);
+
+	embedded = j_message_new(type, length);
+	j_message_append_n(embedded, data, length);
+
+	j_message_header(embedded)->id = j_message_header(message)->id;
+	j_message_header(embedded)->flags = GUINT32_TO_LE(flags);
+	j_message_header(embedded)->op_count = GUINT32_TO_LE(count);
+	embedded->trace_id = message->trace_id;
+
+	j_trace_leave(G_STRFUNC);
+
+	return embedded;
+}
+
+void
+j_message_set_safety (JMessage* message, JSemantics* semantics)
+{
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(semantics != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	j_message_force_safety(message, j_semantics_get(semantics, J_SEMANTICS_SAFETY));
+
+	j_trace_leave(G_STRFUNC);
+}
+
+void
+j_message_force_safety (JMessage* message, gint safety)
+{
+	guint32 op_flags;
+
+	g_return_if_fail(message != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	if (!g_output_stream_write_all(stream, message->data, sizeof(JMessageHeader) + j_message_length(message), &bytes_written, NULL, &error))
+	op_flags = j_message_header(message)->flags;
+	op_flags = GUINT32_FROM_LE(op_flags);
+
+	if (safety == J_SEMANTICS_SAFETY_NETWORK)
 	{
-		goto end;
+		op_flags |= J_MESSAGE_FLAGS_SAFETY_NETWORK;
 	}
-
-	if (bytes_written == 0)
+	else if (safety == J_SEMANTICS_SAFETY_STORAGE)
 	{
-		goto end;
+		op_flags |= J_MESSAGE_FLAGS_SAFETY_NETWORK | J_MESSAGE_FLAGS_SAFETY_STORAGE;
 	}
 
-	if (message->send_list != NULL)
-	{
-		iterator = j_list_iterator_new(message->send_list);
+	j_message_header(message)->flags = GUINT32_TO_LE(op_flags);
 
-		while (j_list_iterator_next(iterator))
-		{
-			JMessageData* message_data = j_list_iterator_get(iterator);
+	j_trace_leave(G_STRFUNC);
+}
 
-			if (!g_output_stream_write_all(stream, message_data->data, message_data->length, &bytes_written, NULL, &error))
-			{
-				goto end;
-			}
-		}
-	}
+/**
+ * Sets whether a message uses the compact encoding for numbers appended with j_message_append_varint().
+ * This has to be set before any numbers are appended.
+ * Replies inherit the encoding of their messages.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param compact Whether to use the compact encoding.
+ **/
+void
+j_message_set_compact (JMessage* message, gboolean compact)
+{
+	guint32 op_flags;
 
-	g_output_stream_flush(stream, NULL, NULL);
+	g_return_if_fail(message != NULL);
 
-	ret = TRUE;
+	j_trace_enter(G_STRFUNC, NULL);
 
-end:
-	if (error != NULL)
+	op_flags = j_message_header(message)->flags;
+	op_flags = GUINT32_FROM_LE(op_flags);
+
+	if (compact)
 	{
-		J_CRITICAL("%s", error->message);
-		g_error_free(error);
+		op_flags |= J_MESSAGE_FLAGS_COMPACT;
+	}
+	else
+	{
+		op_flags &= ~J_MESSAGE_FLAGS_COMPACT;
 	}
 
-	j_trace_leave(G_STRFUNC);
+	j_message_header(message)->flags = GUINT32_TO_LE(op_flags);
 
-	return ret;
+	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Adds new data to send to a message.
+ * Passes the semantics' access hint on to the server.
  *
  * \author Michael Kuhn
  *
  * \code
  * \endcode
  *
- * \param message A message.
- * \param data    Data.
- * \param length  A length.
+ * \param message   A message.
+ * \param semantics A semantics object.
  **/
 void
-j_message_add_send (JMessage* message, gconstpointer data, guint64 length)
+j_message_set_access (JMessage* message, JSemantics* semantics)
 {
-	JMessageData* message_data;
+	guint32 op_flags;
+	gint access;
 
 	g_return_if_fail(message != NULL);
-	g_return_if_fail(data != NULL);
-	g_return_if_fail(length > 0);
+	g_return_if_fail(semantics != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	message_data = g_slice_new(JMessageData);
-	message_data->data = data;
-	message_data->length = length;
+	op_flags = j_message_header(message)->flags;
+	op_flags = GUINT32_FROM_LE(op_flags);
+	op_flags &= ~(J_MESSAGE_FLAGS_ACCESS_SEQUENTIAL | J_MESSAGE_FLAGS_ACCESS_RANDOM);
 
-	j_list_append(message->send_list, message_data);
+	access = j_semantics_get(semantics, J_SEMANTICS_ACCESS);
+
+	if (access == J_SEMANTICS_ACCESS_SEQUENTIAL)
+	{
+		op_flags |= J_MESSAGE_FLAGS_ACCESS_SEQUENTIAL;
+	}
+	else if (access == J_SEMANTICS_ACCESS_RANDOM)
+	{
+		op_flags |= J_MESSAGE_FLAGS_ACCESS_RANDOM;
+	}
+
+	j_message_header(message)->flags = GUINT32_TO_LE(op_flags);
 
 	j_trace_leave(G_STRFUNC);
 }
 
 /**
- * Adds a new operation to a message.
+ * Sets whether the server creates the message's object if it does not exist.
+ * This allows writes to create objects implicitly.
  *
  * \author Michael Kuhn
  *
@@ -1076,40 +3773,87 @@ j_message_add_send (JMessage* message, gconstpointer data, guint64 length)
  * \endcode
  *
  * \param message A message.
- * \param length  A length.
+ * \param create  Whether to create the object.
  **/
 void
-j_message_add_operation (JMessage* message, gsize length)
+j_message_set_create (JMessage* message, gboolean create)
 {
-	guint32 new_op_count;
+	guint32 op_flags;
 
 	g_return_if_fail(message != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	new_op_count = j_message_get_count(message) + 1;
-	j_message_header(message)->op_count = GUINT32_TO_LE(new_op_count);
+	op_flags = j_message_header(message)->flags;
+	op_flags = GUINT32_FROM_LE(op_flags);
 
-	j_message_extend(message, length);
+	if (create)
+	{
+		op_flags |= J_MESSAGE_FLAGS_CREATE;
+	}
+	else
+	{
+		op_flags &= ~J_MESSAGE_FLAGS_CREATE;
+	}
+
+	j_message_header(message)->flags = GUINT32_TO_LE(op_flags);
 
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Sets whether the message refers to its object using a handle returned by J_MESSAGE_OBJECT_OPEN.
+ * Such messages contain the handle instead of the object's namespace and path.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param handle  Whether the message contains a handle.
+ **/
 void
-j_message_set_safety (JMessage* message, JSemantics* semantics)
+j_message_set_handle (JMessage* message, gboolean handle)
 {
+	guint32 op_flags;
+
 	g_return_if_fail(message != NULL);
-	g_return_if_fail(semantics != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	j_message_force_safety(message, j_semantics_get(semantics, J_SEMANTICS_SAFETY));
+	op_flags = j_message_header(message)->flags;
+	op_flags = GUINT32_FROM_LE(op_flags);
+
+	if (handle)
+	{
+		op_flags |= J_MESSAGE_FLAGS_HANDLE;
+	}
+	else
+	{
+		op_flags &= ~J_MESSAGE_FLAGS_HANDLE;
+	}
+
+	j_message_header(message)->flags = GUINT32_TO_LE(op_flags);
 
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Sets whether the message's payloads are transferred using RDMA.
+ * Such messages contain the remote regions of all operations after their lengths and offsets, and no payloads.
+ * On connections to local servers, the regions can also be located in shared memory, see j_transport_shm_offer().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ * \param rdma    Whether the message's payloads are transferred using RDMA.
+ **/
 void
-j_message_force_safety (JMessage* message, gint safety)
+j_message_set_rdma (JMessage* message, gboolean rdma)
 {
 	guint32 op_flags;
 
@@ -1120,13 +3864,13 @@ j_message_force_safety (JMessage* message, gint safety)
 	op_flags = j_message_header(message)->flags;
 	op_flags = GUINT32_FROM_LE(op_flags);
 
-	if (safety == J_SEMANTICS_SAFETY_NETWORK)
+	if (rdma)
 	{
-		op_flags |= J_MESSAGE_FLAGS_SAFETY_NETWORK;
+		op_flags |= J_MESSAGE_FLAGS_RDMA;
 	}
-	else if (safety == J_SEMANTICS_SAFETY_STORAGE)
+	else
 	{
-		op_flags |= J_MESSAGE_FLAGS_SAFETY_NETWORK | J_MESSAGE_FLAGS_SAFETY_STORAGE;
+		op_flags &= ~J_MESSAGE_FLAGS_RDMA;
 	}
 
 	j_message_header(message)->flags = GUINT32_TO_LE(op_flags);
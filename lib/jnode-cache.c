@@ -0,0 +1,420 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <jnode-cache.h>
+
+#include <jhelper.h>
+#include <jtrace-internal.h>
+
+/**
+ * \defgroup JNodeCache Node Cache
+ *
+ * Caches blocks of objects on node-local storage.
+ *
+ * Every block is stored in a file of its own, which is written to a temporary file first and renamed afterwards.
+ * This allows all processes on a node to share the cache without any coordination.
+ * Blocks are tagged with the modification time and size of the object they were read from and are ignored if the object has changed.
+ *
+ * @{
+ **/
+
+/**
+ * The size of cached blocks.
+ **/
+#define J_NODE_CACHE_BLOCK_SIZE (1024 * 1024)
+
+/**
+ * Identifies block files, "JNC1".
+ **/
+#define J_NODE_CACHE_MAGIC 0x4a4e4331
+
+/**
+ * The header of a block file, followed by the block's data.
+ **/
+struct JNodeCacheHeader
+{
+	guint32 magic;
+	guint32 reserved;
+
+	/**
+	 * The object's modification time and size when the block was read.
+	 **/
+	gint64 modification_time;
+	guint64 size;
+
+	/**
+	 * The length of the block's data, smaller than J_NODE_CACHE_BLOCK_SIZE for the last block.
+	 **/
+	guint64 length;
+};
+
+typedef struct JNodeCacheHeader JNodeCacheHeader;
+
+/**
+ * A node cache.
+ **/
+struct JNodeCache
+{
+	/**
+	 * The directory containing the block files.
+	 **/
+	gchar* path;
+};
+
+/**
+ * Returns the path of a block file.
+ * Objects are identified by a hash of their namespace and name, which are spread over 256 directories.
+ **/
+static
+gchar*
+j_node_cache_block_path (JNodeCache* cache, gchar const* namespace, gchar const* name, guint64 block)
+{
+	g_autoptr(GChecksum) checksum = NULL;
+	gchar const* digest;
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	g_checksum_update(checksum, (guchar const*)namespace, strlen(namespace) + 1);
+	g_checksum_update(checksum, (guchar const*)name, strlen(name));
+	digest = g_checksum_get_string(checksum);
+
+	return g_strdup_printf("%s/%.2s/%s-%" G_GUINT64_FORMAT, cache->path, digest, digest, block);
+}
+
+/**
+ * Opens a block file and checks whether it belongs to the given version of the object.
+ *
+ * \return A file descriptor, -1 if the block is not cached.
+ **/
+static
+gint
+j_node_cache_block_open (gchar const* path, gint64 modification_time, guint64 size, JNodeCacheHeader* header)
+{
+	gint fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+	{
+		return -1;
+	}
+
+	if (pread(fd, header, sizeof(*header), 0) != sizeof(*header)
+	    || header->magic != J_NODE_CACHE_MAGIC
+	    || header->modification_time != modification_time
+	    || header->size != size)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static
+gboolean
+j_node_cache_write_all (gint fd, gconstpointer data, guint64 length)
+{
+	gchar const* buffer = data;
+
+	while (length > 0)
+	{
+		gssize nbytes;
+
+		if ((nbytes = write(fd, buffer, length)) <= 0)
+		{
+			if (nbytes == -1 && errno == EINTR)
+			{
+				continue;
+			}
+
+			return FALSE;
+		}
+
+		buffer += nbytes;
+		length -= nbytes;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Stores a block unless it is already cached.
+ * Failures are ignored, the block is simply read from the servers again.
+ **/
+static
+void
+j_node_cache_block_write (gchar const* path, gint64 modification_time, guint64 size, gconstpointer data, guint64 length)
+{
+	JNodeCacheHeader header;
+	g_autofree gchar* parent = NULL;
+	g_autofree gchar* temporary = NULL;
+	gboolean ret;
+	gint fd;
+
+	if ((fd = j_node_cache_block_open(path, modification_time, size, &header)) != -1)
+	{
+		close(fd);
+		return;
+	}
+
+	parent = g_path_get_dirname(path);
+	g_mkdir_with_parents(parent, 0700);
+
+	temporary = g_strconcat(path, ".XXXXXX", NULL);
+
+	if ((fd = g_mkstemp(temporary)) == -1)
+	{
+		return;
+	}
+
+	header.magic = J_NODE_CACHE_MAGIC;
+	header.reserved = 0;
+	header.modification_time = modification_time;
+	header.size = size;
+	header.length = length;
+
+	ret = j_node_cache_write_all(fd, &header, sizeof(header));
+	ret = ret && j_node_cache_write_all(fd, data, length);
+	ret = (close(fd) == 0) && ret;
+
+	/* Renaming replaces blocks of older versions atomically, so concurrent readers never see partial blocks. */
+	if (!ret || g_rename(temporary, path) != 0)
+	{
+		g_unlink(temporary);
+	}
+}
+
+/**
+ * Creates a new node cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param path A directory on node-local storage, which is shared by all processes using it.
+ *
+ * \return A new node cache. Should be freed with j_node_cache_free().
+ **/
+JNodeCache*
+j_node_cache_new (gchar const* path)
+{
+	JNodeCache* cache;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	cache = g_slice_new(JNodeCache);
+	cache->path = g_strdup(path);
+
+	g_mkdir_with_parents(path, 0700);
+
+	return cache;
+}
+
+/**
+ * Frees the memory allocated for the node cache.
+ * The cached blocks are kept.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A node cache.
+ **/
+void
+j_node_cache_free (JNodeCache* cache)
+{
+	g_return_if_fail(cache != NULL);
+
+	g_free(cache->path);
+
+	g_slice_free(JNodeCache, cache);
+}
+
+/**
+ * Reads data from the node cache.
+ * The read is only served if all blocks it touches are cached for the given version of the object.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache             A node cache.
+ * \param namespace         The object's namespace.
+ * \param name              The object's name.
+ * \param modification_time The object's modification time.
+ * \param size              The object's size.
+ * \param data              A buffer to hold the read data.
+ * \param length            Number of bytes to read.
+ * \param offset            An offset within the object.
+ * \param bytes_read        Number of bytes read, only increased if the read is served.
+ *
+ * \return TRUE if the read has been served, FALSE otherwise.
+ **/
+gboolean
+j_node_cache_read (JNodeCache* cache, gchar const* namespace, gchar const* name, gint64 modification_time, guint64 size, gpointer data, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	guint64 end;
+
+	g_return_val_if_fail(cache != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(bytes_read != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Reads beyond the end of the object are served without any data. */
+	end = MIN(offset + length, size);
+
+	for (guint64 position = offset; position < end;)
+	{
+		JNodeCacheHeader header;
+		g_autofree gchar* path = NULL;
+		guint64 block_offset;
+		guint64 chunk;
+		gint fd;
+		gboolean ret;
+
+		block_offset = position % J_NODE_CACHE_BLOCK_SIZE;
+		chunk = MIN(end - position, J_NODE_CACHE_BLOCK_SIZE - block_offset);
+
+		path = j_node_cache_block_path(cache, namespace, name, position / J_NODE_CACHE_BLOCK_SIZE);
+
+		if ((fd = j_node_cache_block_open(path, modification_time, size, &header)) == -1)
+		{
+			j_trace_leave(G_STRFUNC);
+			return FALSE;
+		}
+
+		ret = (header.length >= block_offset + chunk && pread(fd, (gchar*)data + (position - offset), chunk, sizeof(header) + block_offset) == (gssize)chunk);
+		close(fd);
+
+		if (!ret)
+		{
+			j_trace_leave(G_STRFUNC);
+			return FALSE;
+		}
+
+		position += chunk;
+	}
+
+	if (end > offset)
+	{
+		j_helper_atomic_add(bytes_read, end - offset);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return TRUE;
+}
+
+/**
+ * Reads data using the given function and stores the blocks it touches in the node cache.
+ * The read is extended to whole blocks, so that following reads of the same blocks can be served.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache             A node cache.
+ * \param namespace         The object's namespace.
+ * \param name              The object's name.
+ * \param modification_time The object's modification time.
+ * \param size              The object's size.
+ * \param func              The function that reads from the object.
+ * \param func_data         User data to give to func.
+ * \param data              A buffer to hold the read data.
+ * \param length            Number of bytes to read.
+ * \param offset            An offset within the object.
+ * \param bytes_read        Number of bytes read, only increased if the read is served.
+ *
+ * \return TRUE if the read has been served, FALSE if the object has changed.
+ **/
+gboolean
+j_node_cache_fill (JNodeCache* cache, gchar const* namespace, gchar const* name, gint64 modification_time, guint64 size, JNodeCacheFunc func, gpointer func_data, gpointer data, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	g_autofree gchar* buffer = NULL;
+	guint64 end;
+	guint64 first;
+	guint64 last;
+	guint64 nbytes = 0;
+
+	g_return_val_if_fail(cache != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(bytes_read != NULL, FALSE);
+
+	end = MIN(offset + length, size);
+
+	if (offset >= end)
+	{
+		return TRUE;
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	first = offset - (offset % J_NODE_CACHE_BLOCK_SIZE);
+	last = MIN((end + J_NODE_CACHE_BLOCK_SIZE - 1) / J_NODE_CACHE_BLOCK_SIZE * J_NODE_CACHE_BLOCK_SIZE, size);
+
+	buffer = g_malloc(last - first);
+	func(func_data, buffer, last - first, first, &nbytes);
+
+	/* The object has been shrunk in the meantime. */
+	if (nbytes < last - first)
+	{
+		j_trace_leave(G_STRFUNC);
+		return FALSE;
+	}
+
+	for (guint64 position = first; position < last; position += J_NODE_CACHE_BLOCK_SIZE)
+	{
+		g_autofree gchar* path = NULL;
+
+		path = j_node_cache_block_path(cache, namespace, name, position / J_NODE_CACHE_BLOCK_SIZE);
+		j_node_cache_block_write(path, modification_time, size, buffer + (position - first), MIN(J_NODE_CACHE_BLOCK_SIZE, last - position));
+	}
+
+	memcpy(data, buffer + (offset - first), end - offset);
+	j_helper_atomic_add(bytes_read, end - offset);
+
+	j_trace_leave(G_STRFUNC);
+
+	return TRUE;
+}
+
+/**
+ * @}
+ **/
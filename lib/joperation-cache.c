@@ -29,6 +29,7 @@
 #include <jbackground-operation-internal.h>
 #include <jcache.h>
 #include <jcommon.h>
+#include <jconfiguration.h>
 #include <jlist.h>
 #include <jlist-iterator.h>
 #include <jbatch.h>
@@ -44,6 +45,24 @@
  * @{
  **/
 
+/**
+ * A flusher executing cached batches in the background.
+ */
+struct JOperationCacheFlusher
+{
+	/**
+	 * The queue of cached batches.
+	 */
+	GAsyncQueue* queue;
+
+	/**
+	 * The thread executing the cached batches.
+	 */
+	GThread* thread;
+};
+
+typedef struct JOperationCacheFlusher JOperationCacheFlusher;
+
 /**
  * An operation cache.
  */
@@ -55,33 +74,62 @@ struct JOperationCache
 	JCache* cache;
 
 	/**
-	 * The queue of operations.
+	 * The cache's size.
 	 */
-	GAsyncQueue* queue;
+	guint64 size;
 
 	/**
-	 * The thread executing operations in the background.
+	 * The flushers.
+	 * Batches are distributed among them by their operations' keys.
 	 */
-	GThread* thread;
+	JOperationCacheFlusher* flushers;
+	guint flusher_count;
+
+	/**
+	 * Whether the flushers' threads have been started.
+	 * They are only started once the first batch is cached, so processes that never cache do not pay for them.
+	 */
+	gboolean started;
 
 	/**
-	 * Whether #thread is currently working.
+	 * Maps the keys of cached operations to their flushers.
+	 * Batches touching the same keys are executed by the same flusher to keep them in order.
 	 */
-	gboolean working;
+	GHashTable* keys;
 
 	/**
-	 * The mutex for #working.
+	 * The number of cached batches that have not been executed yet.
+	 */
+	guint pending;
+
+	/**
+	 * The mutex for #keys, #pending and the cache's memory.
 	 */
 	GMutex mutex[1];
 
 	/**
-	 * The condition for #working.
+	 * Signaled whenever a cached batch has been executed.
 	 */
 	GCond cond[1];
 };
 
 typedef struct JOperationCache JOperationCache;
 
+/**
+ * The flusher responsible for a key.
+ */
+struct JOperationCacheKey
+{
+	guint flusher;
+
+	/**
+	 * The number of cached operations with this key.
+	 */
+	guint count;
+};
+
+typedef struct JOperationCacheKey JOperationCacheKey;
+
 struct JCachedBatch
 {
 	JBatch* batch;
@@ -92,38 +140,137 @@ typedef struct JCachedBatch JCachedBatch;
 
 static JOperationCache* j_operation_cache = NULL;
 
+static
+void
+j_operation_cache_key_free (gpointer data)
+{
+	g_slice_free(JOperationCacheKey, data);
+}
+
+/**
+ * Checks whether two batches can be executed together.
+ *
+ * \private
+ **/
+static
+gboolean
+j_operation_cache_can_merge (JBatch* batch, JBatch* other)
+{
+	JSemantics* semantics;
+	JSemantics* other_semantics;
+
+	semantics = j_batch_get_semantics(batch);
+	other_semantics = j_batch_get_semantics(other);
+
+	if (semantics == other_semantics)
+	{
+		return TRUE;
+	}
+
+	for (JSemanticsType type = J_SEMANTICS_ATOMICITY; type <= J_SEMANTICS_SECURITY; type++)
+	{
+		if (j_semantics_get(semantics, type) != j_semantics_get(other_semantics, type))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Forgets the keys of executed operations.
+ *
+ * \private
+ **/
+static
+void
+j_operation_cache_release_keys (JOperationCache* cache, JList* operations)
+{
+	g_autoptr(JListIterator) iterator = NULL;
+
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
+	{
+		JOperation* operation = j_list_iterator_get(iterator);
+		JOperationCacheKey* key;
+
+		key = g_hash_table_lookup(cache->keys, operation->key);
+
+		if (key != NULL && --key->count == 0)
+		{
+			g_hash_table_remove(cache->keys, operation->key);
+		}
+	}
+}
+
 static
 gpointer
 j_operation_cache_thread (gpointer data)
 {
-	JOperationCache* cache = data;
-	JCachedBatch* cached_batch;
+	JOperationCacheFlusher* flusher = data;
+	JOperationCache* cache = j_operation_cache;
+	JCachedBatch* next_batch = NULL;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	while ((cached_batch = g_async_queue_pop(cache->queue)) != NULL)
+	while (TRUE)
 	{
-		/* data == cache, terminate */
+		g_autoptr(GPtrArray) merged_batches = NULL;
+		g_autoptr(JBatch) batch = NULL;
+		JCachedBatch* cached_batch;
+
+		cached_batch = (next_batch != NULL) ? next_batch : g_async_queue_pop(flusher->queue);
+		next_batch = NULL;
+
+		/* data == flusher, terminate */
 		if (cached_batch == data)
 		{
-			return NULL;
+			break;
 		}
 
-		j_batch_execute_internal(cached_batch->batch);
+		merged_batches = g_ptr_array_new();
+		g_ptr_array_add(merged_batches, cached_batch);
+
+		/* Execute queued batches together, so their operations can be combined, for example, writes to the same object. */
+		batch = j_batch_new(j_batch_get_semantics(cached_batch->batch));
+		j_batch_move_operations(batch, cached_batch->batch);
+
+		while ((next_batch = g_async_queue_try_pop(flusher->queue)) != NULL)
+		{
+			/* Keep the terminating or an incompatible batch for the next iteration. */
+			if (next_batch == data || !j_operation_cache_can_merge(batch, next_batch->batch))
+			{
+				break;
+			}
+
+			j_batch_move_operations(batch, next_batch->batch);
+			g_ptr_array_add(merged_batches, next_batch);
+		}
 
-		j_batch_unref(cached_batch->batch);
-		j_cache_release(j_operation_cache->cache, cached_batch->data);
-		g_slice_free(JCachedBatch, cached_batch);
+		j_batch_execute_internal(batch);
 
 		g_mutex_lock(cache->mutex);
 
-		cache->working = (g_async_queue_length(cache->queue) > 0);
+		j_operation_cache_release_keys(cache, j_batch_get_operations(batch));
 
-		if (!cache->working)
+		for (guint i = 0; i < merged_batches->len; i++)
 		{
-			g_cond_signal(cache->cond);
+			JCachedBatch* merged_batch = g_ptr_array_index(merged_batches, i);
+
+			if (merged_batch->data != NULL)
+			{
+				j_cache_release(cache->cache, merged_batch->data);
+			}
+
+			j_batch_unref(merged_batch->batch);
+			g_slice_free(JCachedBatch, merged_batch);
 		}
 
+		cache->pending -= merged_batches->len;
+
+		g_cond_broadcast(cache->cond);
 		g_mutex_unlock(cache->mutex);
 	}
 
@@ -132,39 +279,21 @@ j_operation_cache_thread (gpointer data)
 	return NULL;
 }
 
+/**
+ * Checks whether an operation can be cached.
+ * Only operations that do not return anything to the caller, that is, writes, creates, puts and deletes, provide a cache function.
+ *
+ * \private
+ **/
 static
 gboolean
 j_operation_cache_test (JOperation* operation)
 {
-	gboolean ret = FALSE;
-
-	(void)operation;
+	gboolean ret;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	/* FIXME
-	switch (operation->type)
-	{
-		case J_OPERATION_COLLECTION_CREATE:
-		case J_OPERATION_COLLECTION_DELETE:
-		case J_OPERATION_ITEM_CREATE:
-		case J_OPERATION_ITEM_DELETE:
-		case J_OPERATION_ITEM_WRITE:
-			ret = TRUE;
-			break;
-
-		case J_OPERATION_COLLECTION_GET:
-		case J_OPERATION_ITEM_GET:
-		case J_OPERATION_ITEM_GET_STATUS:
-		case J_OPERATION_ITEM_READ:
-			ret = FALSE;
-			break;
-
-		case J_OPERATION_NONE:
-		default:
-			g_warn_if_reached();
-	}
-	*/
+	ret = (operation->cache_func != NULL);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -177,33 +306,12 @@ j_operation_cache_get_required_size (JOperation* operation)
 {
 	guint64 ret = 0;
 
-	(void)operation;
-
 	j_trace_enter(G_STRFUNC, NULL);
 
-	/* FIXME
-	switch (operation->type)
+	if (operation->cache_size_func != NULL)
 	{
-		case J_OPERATION_ITEM_WRITE:
-			ret = operation->item_write.length;
-			break;
-
-		case J_OPERATION_COLLECTION_CREATE:
-		case J_OPERATION_COLLECTION_DELETE:
-		case J_OPERATION_ITEM_CREATE:
-		case J_OPERATION_ITEM_DELETE:
-		case J_OPERATION_COLLECTION_GET:
-		case J_OPERATION_ITEM_GET:
-		case J_OPERATION_ITEM_GET_STATUS:
-		case J_OPERATION_ITEM_READ:
-			ret = 0;
-			break;
-
-		case J_OPERATION_NONE:
-		default:
-			g_warn_if_reached();
+		ret = operation->cache_size_func(operation->data);
 	}
-	*/
 
 	j_trace_leave(G_STRFUNC);
 
@@ -211,7 +319,7 @@ j_operation_cache_get_required_size (JOperation* operation)
 }
 
 void
-j_operation_cache_init (void)
+j_operation_cache_init (JConfiguration* configuration)
 {
 	JOperationCache* cache;
 
@@ -220,16 +328,26 @@ j_operation_cache_init (void)
 	j_trace_enter(G_STRFUNC, NULL);
 
 	cache = g_slice_new(JOperationCache);
-	cache->cache = j_cache_new(50 * 1024 * 1024);
-	cache->queue = g_async_queue_new_full(NULL);
-	cache->thread = g_thread_new("JOperationCache", j_operation_cache_thread, cache);
-	cache->working = FALSE;
+	cache->size = j_configuration_get_cache_size(configuration);
+	cache->cache = j_cache_new(cache->size);
+	/* One flusher per server, so batches for different servers do not have to wait for each other. */
+	cache->flusher_count = MAX(j_configuration_get_object_server_count(configuration) + j_configuration_get_kv_server_count(configuration), 1);
+	cache->flushers = g_new(JOperationCacheFlusher, cache->flusher_count);
+	cache->keys = g_hash_table_new_full(NULL, NULL, NULL, j_operation_cache_key_free);
+	cache->pending = 0;
+	cache->started = FALSE;
 
 	g_mutex_init(cache->mutex);
 	g_cond_init(cache->cond);
 
 	g_atomic_pointer_set(&j_operation_cache, cache);
 
+	for (guint i = 0; i < cache->flusher_count; i++)
+	{
+		cache->flushers[i].queue = g_async_queue_new_full(NULL);
+		cache->flushers[i].thread = NULL;
+	}
+
 	j_trace_leave(G_STRFUNC);
 }
 
@@ -245,13 +363,23 @@ j_operation_cache_fini (void)
 	j_operation_cache_flush();
 
 	cache = g_atomic_pointer_get(&j_operation_cache);
-	g_atomic_pointer_set(&j_operation_cache, NULL);
 
-	/* push fake cached batch */
-	g_async_queue_push(cache->queue, cache);
-	g_thread_join(cache->thread);
+	for (guint i = 0; i < cache->flusher_count; i++)
+	{
+		if (cache->flushers[i].thread != NULL)
+		{
+			/* push fake cached batch */
+			g_async_queue_push(cache->flushers[i].queue, &(cache->flushers[i]));
+			g_thread_join(cache->flushers[i].thread);
+		}
 
-	g_async_queue_unref(cache->queue);
+		g_async_queue_unref(cache->flushers[i].queue);
+	}
+
+	g_atomic_pointer_set(&j_operation_cache, NULL);
+
+	g_free(cache->flushers);
+	g_hash_table_unref(cache->keys);
 	j_cache_free(cache->cache);
 
 	g_cond_clear(cache->cond);
@@ -271,7 +399,7 @@ j_operation_cache_flush (void)
 
 	g_mutex_lock(j_operation_cache->mutex);
 
-	while (j_operation_cache->working)
+	while (j_operation_cache->pending > 0)
 	{
 		g_cond_wait(j_operation_cache->cond, j_operation_cache->mutex);
 	}
@@ -283,6 +411,66 @@ j_operation_cache_flush (void)
 	return ret;
 }
 
+/**
+ * Returns the flusher a batch has to be executed by.
+ * If the batch's operations are handled by several flushers at the moment, waits until at most one of them is left.
+ *
+ * \private
+ *
+ * \param cache      An operation cache, its mutex has to be locked.
+ * \param operations A batch's operations.
+ *
+ * \return The flusher's index.
+ **/
+static
+guint
+j_operation_cache_get_flusher (JOperationCache* cache, JList* operations)
+{
+	gpointer first_key = NULL;
+
+	while (TRUE)
+	{
+		g_autoptr(JListIterator) iterator = NULL;
+		gboolean conflict = FALSE;
+		gint flusher = -1;
+
+		iterator = j_list_iterator_new(operations);
+
+		while (j_list_iterator_next(iterator))
+		{
+			JOperation* operation = j_list_iterator_get(iterator);
+			JOperationCacheKey* key;
+
+			if (first_key == NULL)
+			{
+				first_key = operation->key;
+			}
+
+			key = g_hash_table_lookup(cache->keys, operation->key);
+
+			if (key == NULL)
+			{
+				continue;
+			}
+
+			if (flusher >= 0 && (guint)flusher != key->flusher)
+			{
+				conflict = TRUE;
+				break;
+			}
+
+			flusher = key->flusher;
+		}
+
+		if (!conflict)
+		{
+			return (flusher >= 0) ? (guint)flusher : g_direct_hash(first_key) % cache->flusher_count;
+		}
+
+		g_cond_wait(cache->cond, cache->mutex);
+	}
+}
+
 gboolean
 j_operation_cache_add (JBatch* batch)
 {
@@ -292,8 +480,9 @@ j_operation_cache_add (JBatch* batch)
 	JListIterator* iterator;
 	gboolean can_cache = TRUE;
 	gchar* data;
-	gpointer buffer;
+	gpointer buffer = NULL;
 	guint64 required_size = 0;
+	guint flusher;
 
 	j_trace_enter(G_STRFUNC, NULL);
 
@@ -317,58 +506,102 @@ j_operation_cache_add (JBatch* batch)
 
 	j_list_iterator_free(iterator);
 
-	// FIXME never cleared
-	if ((buffer = j_cache_get(j_operation_cache->cache, required_size)) == NULL)
+	/* Batches that do not fit into the cache at all are executed directly. */
+	if (!ret || required_size > j_operation_cache->size)
 	{
 		ret = FALSE;
+		goto end;
+	}
+
+	g_mutex_lock(j_operation_cache->mutex);
+
+	/* Wait for cached batches to be executed if the cache is full. */
+	while (required_size > 0 && (buffer = j_cache_get(j_operation_cache->cache, required_size)) == NULL)
+	{
+		if (j_operation_cache->pending == 0)
+		{
+			break;
+		}
+
+		g_cond_wait(j_operation_cache->cond, j_operation_cache->mutex);
 	}
 
-	if (!ret)
+	if (required_size > 0 && buffer == NULL)
 	{
+		g_mutex_unlock(j_operation_cache->mutex);
+		ret = FALSE;
 		goto end;
 	}
 
 	data = buffer;
 	iterator = j_list_iterator_new(operations);
 
+	/* Copy the operations' payloads, so the caller can reuse its memory as soon as j_batch_execute() returns. */
 	while (j_list_iterator_next(iterator))
 	{
-		/* FIXME
 		JOperation* operation = j_list_iterator_get(iterator);
 
-		if (operation->type == J_OPERATION_ITEM_WRITE)
-		{
-			memcpy(data, operation->item_write.data, operation->item_write.length);
-
-			operation->item_write.data = data;
-			*(operation->item_write.bytes_written) += operation->item_write.length;
-			operation->item_write.bytes_written = NULL;
+		operation->cache_func(operation->data, data);
 
-			data += operation->item_write.length;
+		if (data != NULL)
+		{
+			data += j_operation_cache_get_required_size(operation);
 		}
-		*/
-		(void)data;
 	}
 
 	j_list_iterator_free(iterator);
 
-	if (!ret)
+	flusher = j_operation_cache_get_flusher(j_operation_cache, operations);
+
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
 	{
-		goto end;
+		JOperation* operation = j_list_iterator_get(iterator);
+		JOperationCacheKey* key;
+
+		key = g_hash_table_lookup(j_operation_cache->keys, operation->key);
+
+		if (key == NULL)
+		{
+			key = g_slice_new(JOperationCacheKey);
+			key->flusher = flusher;
+			key->count = 0;
+
+			g_hash_table_insert(j_operation_cache->keys, operation->key, key);
+		}
+
+		key->count++;
 	}
 
-	g_mutex_lock(j_operation_cache->mutex);
-	j_operation_cache->working = TRUE;
-	g_mutex_unlock(j_operation_cache->mutex);
+	j_list_iterator_free(iterator);
+
+	j_operation_cache->pending++;
 
 	cached_batch = g_slice_new(JCachedBatch);
 	cached_batch->batch = j_batch_new_from_batch(batch);
 	cached_batch->data = buffer;
 
-	g_async_queue_push(j_operation_cache->queue, cached_batch);
+	if (!j_operation_cache->started)
+	{
+		for (guint i = 0; i < j_operation_cache->flusher_count; i++)
+		{
+			j_operation_cache->flushers[i].thread = g_thread_new("JOperationCache", j_operation_cache_thread, &(j_operation_cache->flushers[i]));
+		}
+
+		j_operation_cache->started = TRUE;
+	}
+
+	g_async_queue_push(j_operation_cache->flushers[flusher].queue, cached_batch);
+
+	g_mutex_unlock(j_operation_cache->mutex);
 
 end:
 	j_trace_leave(G_STRFUNC);
 
 	return ret;
 }
+
+/**
+ * @}
+ **/
@@ -52,6 +52,8 @@ j_operation_new (void)
 	operation->data = NULL;
 	operation->exec_func = NULL;
 	operation->free_func = NULL;
+	operation->cache_size_func = NULL;
+	operation->cache_func = NULL;
 
 	return operation;
 }
@@ -0,0 +1,386 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <jreadahead.h>
+
+#include <jhelper.h>
+#include <jtrace-internal.h>
+
+/**
+ * \defgroup JReadahead Readahead
+ *
+ * Detects sequential reads and prefetches the following data in the background.
+ *
+ * @{
+ **/
+
+/**
+ * A prefetched part of an object.
+ **/
+struct JReadaheadWindow
+{
+	/**
+	 * The readahead the window belongs to.
+	 **/
+	struct JReadahead* readahead;
+
+	/**
+	 * The window's offset within the object.
+	 **/
+	guint64 offset;
+
+	/**
+	 * The window's length.
+	 **/
+	guint64 length;
+
+	/**
+	 * The number of bytes actually read, may be smaller than #length at the end of an object.
+	 **/
+	guint64 bytes_read;
+
+	/**
+	 * The data.
+	 **/
+	gchar* data;
+
+	/**
+	 * The thread reading the data, NULL once it has been joined.
+	 **/
+	GThread* thread;
+};
+
+typedef struct JReadaheadWindow JReadaheadWindow;
+
+/**
+ * A readahead.
+ **/
+struct JReadahead
+{
+	/**
+	 * The prefetch size.
+	 **/
+	guint64 size;
+
+	/**
+	 * The function that reads from the object.
+	 **/
+	JReadaheadFunc func;
+
+	/**
+	 * User data to give to #func.
+	 **/
+	gpointer data;
+
+	/**
+	 * The end of the last read, used to detect sequential reads.
+	 **/
+	guint64 next_offset;
+
+	/**
+	 * The window currently being consumed and the one following it.
+	 * Both are NULL if no data has been prefetched.
+	 **/
+	JReadaheadWindow* current;
+	JReadaheadWindow* next;
+
+	GMutex mutex;
+};
+
+static
+gpointer
+j_readahead_window_thread (gpointer data)
+{
+	JReadaheadWindow* window = data;
+
+	window->readahead->func(window->readahead->data, window->data, window->length, window->offset, &(window->bytes_read));
+
+	return NULL;
+}
+
+/**
+ * Starts prefetching a window.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param readahead A readahead.
+ * \param offset    The window's offset.
+ *
+ * \return A new window. Should be freed with j_readahead_window_free().
+ **/
+static
+JReadaheadWindow*
+j_readahead_window_new (JReadahead* readahead, guint64 offset)
+{
+	JReadaheadWindow* window;
+
+	window = g_slice_new(JReadaheadWindow);
+	window->readahead = readahead;
+	window->offset = offset;
+	window->length = readahead->size;
+	window->bytes_read = 0;
+	window->data = g_malloc(readahead->size);
+
+	/* A dedicated thread is used because the read may itself need background operations. */
+	window->thread = g_thread_new("JReadahead", j_readahead_window_thread, window);
+
+	return window;
+}
+
+static
+void
+j_readahead_window_wait (JReadaheadWindow* window)
+{
+	if (window->thread != NULL)
+	{
+		g_thread_join(window->thread);
+		window->thread = NULL;
+	}
+}
+
+static
+void
+j_readahead_window_free (JReadaheadWindow* window)
+{
+	if (window == NULL)
+	{
+		return;
+	}
+
+	j_readahead_window_wait(window);
+
+	g_free(window->data);
+	g_slice_free(JReadaheadWindow, window);
+}
+
+static
+gboolean
+j_readahead_window_contains (JReadaheadWindow* window, guint64 length, guint64 offset)
+{
+	return (window != NULL && offset >= window->offset && offset + length <= window->offset + window->length);
+}
+
+/**
+ * Creates a new readahead.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size The number of bytes to prefetch at once.
+ * \param func The function that reads from the object, called from other threads.
+ * \param data User data to give to #func.
+ *
+ * \return A new readahead. Should be freed with j_readahead_free().
+ **/
+JReadahead*
+j_readahead_new (guint64 size, JReadaheadFunc func, gpointer data)
+{
+	JReadahead* readahead;
+
+	g_return_val_if_fail(size > 0, NULL);
+	g_return_val_if_fail(func != NULL, NULL);
+
+	readahead = g_slice_new(JReadahead);
+	readahead->size = size;
+	readahead->func = func;
+	readahead->data = data;
+	readahead->next_offset = G_MAXUINT64;
+	readahead->current = NULL;
+	readahead->next = NULL;
+
+	g_mutex_init(&(readahead->mutex));
+
+	return readahead;
+}
+
+/**
+ * Frees the memory allocated for the readahead.
+ * Waits for outstanding prefetches.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param readahead A readahead.
+ **/
+void
+j_readahead_free (JReadahead* readahead)
+{
+	g_return_if_fail(readahead != NULL);
+
+	j_readahead_window_free(readahead->current);
+	j_readahead_window_free(readahead->next);
+
+	g_mutex_clear(&(readahead->mutex));
+
+	g_slice_free(JReadahead, readahead);
+}
+
+/**
+ * Reads from the prefetched data.
+ * Every read is recorded, so that sequential reads start prefetching the following data.
+ * A window is prefetched as soon as two reads follow each other,
+ * the one after it once half of the current window has been consumed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param readahead  A readahead.
+ * \param data       A buffer to hold the read data.
+ * \param length     Number of bytes to read.
+ * \param offset     An offset within the object.
+ * \param bytes_read Number of bytes read, only increased if TRUE is returned.
+ *
+ * \return TRUE if the read could be served from the prefetched data, FALSE otherwise.
+ **/
+gboolean
+j_readahead_read (JReadahead* readahead, gpointer data, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	gboolean ret = FALSE;
+	gboolean sequential;
+	guint64 end;
+
+	g_return_val_if_fail(readahead != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(bytes_read != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	end = offset + length;
+
+	g_mutex_lock(&(readahead->mutex));
+
+	sequential = (offset == readahead->next_offset);
+	readahead->next_offset = end;
+
+	/* The current window has been consumed, continue with the next one. */
+	if (!j_readahead_window_contains(readahead->current, length, offset) && j_readahead_window_contains(readahead->next, length, offset))
+	{
+		j_readahead_window_free(readahead->current);
+		readahead->current = readahead->next;
+		readahead->next = NULL;
+	}
+
+	if (j_readahead_window_contains(readahead->current, length, offset))
+	{
+		JReadaheadWindow* window = readahead->current;
+		guint64 displacement;
+		guint64 nbytes = 0;
+
+		j_readahead_window_wait(window);
+
+		displacement = offset - window->offset;
+
+		if (window->bytes_read > displacement)
+		{
+			nbytes = MIN(length, window->bytes_read - displacement);
+			memcpy(data, window->data + displacement, nbytes);
+		}
+
+		j_helper_atomic_add(bytes_read, nbytes);
+		ret = TRUE;
+
+		/* The object ends within this window, so there is nothing left to prefetch. */
+		if (window->bytes_read < window->length)
+		{
+			sequential = FALSE;
+		}
+	}
+
+	if (sequential)
+	{
+		JReadaheadWindow* last;
+
+		last = (readahead->next != NULL) ? readahead->next : readahead->current;
+
+		if (readahead->current == NULL || end < readahead->current->offset || end > last->offset + last->length)
+		{
+			j_readahead_window_free(readahead->current);
+			j_readahead_window_free(readahead->next);
+
+			readahead->current = j_readahead_window_new(readahead, end);
+			readahead->next = NULL;
+		}
+		else if (readahead->next == NULL && end - readahead->current->offset >= readahead->current->length / 2)
+		{
+			readahead->next = j_readahead_window_new(readahead, readahead->current->offset + readahead->current->length);
+		}
+	}
+
+	g_mutex_unlock(&(readahead->mutex));
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Discards all prefetched data.
+ * Must be called when the object is modified.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param readahead A readahead.
+ **/
+void
+j_readahead_invalidate (JReadahead* readahead)
+{
+	g_return_if_fail(readahead != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&(readahead->mutex));
+
+	j_readahead_window_free(readahead->current);
+	j_readahead_window_free(readahead->next);
+
+	readahead->current = NULL;
+	readahead->next = NULL;
+	readahead->next_offset = G_MAXUINT64;
+
+	g_mutex_unlock(&(readahead->mutex));
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * @}
+ **/
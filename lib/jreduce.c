@@ -0,0 +1,1085 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <smmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <jreduce.h>
+
+#include <jmessage.h>
+
+#include <jtrace-internal.h>
+
+/**
+ * \defgroup JReduce Reduce
+ *
+ * Reductions over arrays of numbers.
+ *
+ * A reduction computes the number of elements, their minimum, maximum and sum and optionally a histogram.
+ * Partial reductions of parts of an array can be combined, so arrays can be reduced where they are stored.
+ *
+ * @{
+ **/
+
+/**
+ * The maximum number of histogram bins.
+ * Limits the memory used for reductions received from other processes.
+ **/
+#define J_REDUCE_HISTOGRAM_MAX 65536
+
+/**
+ * A reduction.
+ **/
+struct JReduce
+{
+	JReduceType type;
+
+	/**
+	 * The number of elements.
+	 **/
+	guint64 count;
+
+	JReduceValue min;
+	JReduceValue max;
+	JReduceValue sum;
+
+	/**
+	 * The histogram's range, values outside of [lower, upper) are not counted.
+	 **/
+	gdouble lower;
+	gdouble upper;
+
+	/**
+	 * The number of histogram bins, 0 if no histogram is computed.
+	 **/
+	guint bins;
+	guint64* histogram;
+};
+
+static
+gboolean
+j_reduce_is_integer (JReduceType type)
+{
+	return (type == J_REDUCE_TYPE_INT32 || type == J_REDUCE_TYPE_INT64);
+}
+
+/**
+ * Merges a partial minimum, maximum and sum into a reduction.
+ * Integer sums wrap around on overflow.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_merge (JReduce* reduce, JReduceValue min, JReduceValue max, JReduceValue sum)
+{
+	if (j_reduce_is_integer(reduce->type))
+	{
+		reduce->min.i = MIN(reduce->min.i, min.i);
+		reduce->max.i = MAX(reduce->max.i, max.i);
+		reduce->sum.i = (gint64)((guint64)reduce->sum.i + (guint64)sum.i);
+	}
+	else
+	{
+		reduce->min.f = MIN(reduce->min.f, min.f);
+		reduce->max.f = MAX(reduce->max.f, max.f);
+		reduce->sum.f += sum.f;
+	}
+}
+
+static
+void
+j_reduce_update_int32_software (JReduce* reduce, gint32 const* data, guint64 count)
+{
+	JReduceValue min = { .i = G_MAXINT64 };
+	JReduceValue max = { .i = G_MININT64 };
+	guint64 sum = 0;
+
+	for (guint64 i = 0; i < count; i++)
+	{
+		min.i = MIN(min.i, data[i]);
+		max.i = MAX(max.i, data[i]);
+		sum += (guint64)(gint64)data[i];
+	}
+
+	j_reduce_merge(reduce, min, max, (JReduceValue){ .i = (gint64)sum });
+}
+
+static
+void
+j_reduce_update_int64_software (JReduce* reduce, gint64 const* data, guint64 count)
+{
+	JReduceValue min = { .i = G_MAXINT64 };
+	JReduceValue max = { .i = G_MININT64 };
+	guint64 sum = 0;
+
+	for (guint64 i = 0; i < count; i++)
+	{
+		min.i = MIN(min.i, data[i]);
+		max.i = MAX(max.i, data[i]);
+		sum += (guint64)data[i];
+	}
+
+	j_reduce_merge(reduce, min, max, (JReduceValue){ .i = (gint64)sum });
+}
+
+static
+void
+j_reduce_update_float_software (JReduce* reduce, gfloat const* data, guint64 count)
+{
+	JReduceValue min = { .f = INFINITY };
+	JReduceValue max = { .f = -INFINITY };
+	JReduceValue sum = { .f = 0.0 };
+
+	for (guint64 i = 0; i < count; i++)
+	{
+		min.f = MIN(min.f, data[i]);
+		max.f = MAX(max.f, data[i]);
+		sum.f += data[i];
+	}
+
+	j_reduce_merge(reduce, min, max, sum);
+}
+
+static
+void
+j_reduce_update_double_software (JReduce* reduce, gdouble const* data, guint64 count)
+{
+	JReduceValue min = { .f = INFINITY };
+	JReduceValue max = { .f = -INFINITY };
+	JReduceValue sum = { .f = 0.0 };
+
+	for (guint64 i = 0; i < count; i++)
+	{
+		min.f = MIN(min.f, data[i]);
+		max.f = MAX(max.f, data[i]);
+		sum.f += data[i];
+	}
+
+	j_reduce_merge(reduce, min, max, sum);
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/**
+ * Reduces 32-bit integers four at a time using SSE4.1.
+ * The sums are accumulated as 64-bit integers, so they do not overflow early.
+ *
+ * \private
+ **/
+__attribute__((target("sse4.1")))
+static
+void
+j_reduce_update_int32_hardware (JReduce* reduce, gint32 const* data, guint64 count)
+{
+	__m128i vmin = _mm_set1_epi32(G_MAXINT32);
+	__m128i vmax = _mm_set1_epi32(G_MININT32);
+	__m128i vsum = _mm_setzero_si128();
+	gint32 mins[4];
+	gint32 maxs[4];
+	gint64 sums[2];
+	JReduceValue min = { .i = G_MAXINT64 };
+	JReduceValue max = { .i = G_MININT64 };
+	JReduceValue sum;
+	guint64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((__m128i const*)(gconstpointer)(data + i));
+
+		vmin = _mm_min_epi32(vmin, v);
+		vmax = _mm_max_epi32(vmax, v);
+		vsum = _mm_add_epi64(vsum, _mm_cvtepi32_epi64(v));
+		vsum = _mm_add_epi64(vsum, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+	}
+
+	_mm_storeu_si128((__m128i*)(gpointer)mins, vmin);
+	_mm_storeu_si128((__m128i*)(gpointer)maxs, vmax);
+	_mm_storeu_si128((__m128i*)(gpointer)sums, vsum);
+
+	for (guint j = 0; j < 4; j++)
+	{
+		min.i = MIN(min.i, mins[j]);
+		max.i = MAX(max.i, maxs[j]);
+	}
+
+	sum.i = (gint64)((guint64)sums[0] + (guint64)sums[1]);
+
+	/* Without any full vector, the initial values must not end up in the result. */
+	if (i > 0)
+	{
+		j_reduce_merge(reduce, min, max, sum);
+	}
+
+	j_reduce_update_int32_software(reduce, data + i, count - i);
+}
+
+/**
+ * Reduces floats four at a time using SSE2.
+ * The sums are accumulated as doubles.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_update_float_hardware (JReduce* reduce, gfloat const* data, guint64 count)
+{
+	__m128 vmin = _mm_set1_ps(INFINITY);
+	__m128 vmax = _mm_set1_ps(-INFINITY);
+	__m128d vsum_low = _mm_setzero_pd();
+	__m128d vsum_high = _mm_setzero_pd();
+	gfloat mins[4];
+	gfloat maxs[4];
+	gdouble sums[2];
+	JReduceValue min = { .f = INFINITY };
+	JReduceValue max = { .f = -INFINITY };
+	JReduceValue sum;
+	guint64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 v = _mm_loadu_ps(data + i);
+
+		vmin = _mm_min_ps(vmin, v);
+		vmax = _mm_max_ps(vmax, v);
+		vsum_low = _mm_add_pd(vsum_low, _mm_cvtps_pd(v));
+		vsum_high = _mm_add_pd(vsum_high, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+	}
+
+	_mm_storeu_ps(mins, vmin);
+	_mm_storeu_ps(maxs, vmax);
+	_mm_storeu_pd(sums, _mm_add_pd(vsum_low, vsum_high));
+
+	for (guint j = 0; j < 4; j++)
+	{
+		min.f = MIN(min.f, mins[j]);
+		max.f = MAX(max.f, maxs[j]);
+	}
+
+	sum.f = sums[0] + sums[1];
+
+	j_reduce_merge(reduce, min, max, sum);
+	j_reduce_update_float_software(reduce, data + i, count - i);
+}
+
+/**
+ * Reduces doubles two at a time using SSE2.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_update_double_hardware (JReduce* reduce, gdouble const* data, guint64 count)
+{
+	__m128d vmin = _mm_set1_pd(INFINITY);
+	__m128d vmax = _mm_set1_pd(-INFINITY);
+	__m128d vsum = _mm_setzero_pd();
+	gdouble mins[2];
+	gdouble maxs[2];
+	gdouble sums[2];
+	JReduceValue min;
+	JReduceValue max;
+	JReduceValue sum;
+	guint64 i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128d v = _mm_loadu_pd(data + i);
+
+		vmin = _mm_min_pd(vmin, v);
+		vmax = _mm_max_pd(vmax, v);
+		vsum = _mm_add_pd(vsum, v);
+	}
+
+	_mm_storeu_pd(mins, vmin);
+	_mm_storeu_pd(maxs, vmax);
+	_mm_storeu_pd(sums, vsum);
+
+	min.f = MIN(mins[0], mins[1]);
+	max.f = MAX(maxs[0], maxs[1]);
+	sum.f = sums[0] + sums[1];
+
+	j_reduce_merge(reduce, min, max, sum);
+	j_reduce_update_double_software(reduce, data + i, count - i);
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/**
+ * Reduces 32-bit integers four at a time using NEON.
+ * The sums are accumulated as 64-bit integers, so they do not overflow early.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_update_int32_hardware (JReduce* reduce, gint32 const* data, guint64 count)
+{
+	int32x4_t vmin = vdupq_n_s32(G_MAXINT32);
+	int32x4_t vmax = vdupq_n_s32(G_MININT32);
+	int64x2_t vsum = vdupq_n_s64(0);
+	JReduceValue min;
+	JReduceValue max;
+	JReduceValue sum;
+	guint64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		int32x4_t v = vld1q_s32(data + i);
+
+		vmin = vminq_s32(vmin, v);
+		vmax = vmaxq_s32(vmax, v);
+		vsum = vpadalq_s32(vsum, v);
+	}
+
+	min.i = vminvq_s32(vmin);
+	max.i = vmaxvq_s32(vmax);
+	sum.i = vaddvq_s64(vsum);
+
+	/* Without any full vector, the initial values must not end up in the result. */
+	if (i > 0)
+	{
+		j_reduce_merge(reduce, min, max, sum);
+	}
+
+	j_reduce_update_int32_software(reduce, data + i, count - i);
+}
+
+/**
+ * Reduces floats four at a time using NEON.
+ * The sums are accumulated as doubles.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_update_float_hardware (JReduce* reduce, gfloat const* data, guint64 count)
+{
+	float32x4_t vmin = vdupq_n_f32(INFINITY);
+	float32x4_t vmax = vdupq_n_f32(-INFINITY);
+	float64x2_t vsum = vdupq_n_f64(0.0);
+	JReduceValue min;
+	JReduceValue max;
+	JReduceValue sum;
+	guint64 i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4_t v = vld1q_f32(data + i);
+
+		vmin = vminnmq_f32(vmin, v);
+		vmax = vmaxnmq_f32(vmax, v);
+		vsum = vaddq_f64(vsum, vcvt_f64_f32(vget_low_f32(v)));
+		vsum = vaddq_f64(vsum, vcvt_high_f64_f32(v));
+	}
+
+	min.f = vminnmvq_f32(vmin);
+	max.f = vmaxnmvq_f32(vmax);
+	sum.f = vaddvq_f64(vsum);
+
+	j_reduce_merge(reduce, min, max, sum);
+	j_reduce_update_float_software(reduce, data + i, count - i);
+}
+
+/**
+ * Reduces doubles two at a time using NEON.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_update_double_hardware (JReduce* reduce, gdouble const* data, guint64 count)
+{
+	float64x2_t vmin = vdupq_n_f64(INFINITY);
+	float64x2_t vmax = vdupq_n_f64(-INFINITY);
+	float64x2_t vsum = vdupq_n_f64(0.0);
+	JReduceValue min;
+	JReduceValue max;
+	JReduceValue sum;
+	guint64 i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		float64x2_t v = vld1q_f64(data + i);
+
+		vmin = vminnmq_f64(vmin, v);
+		vmax = vmaxnmq_f64(vmax, v);
+		vsum = vaddq_f64(vsum, v);
+	}
+
+	min.f = vminnmvq_f64(vmin);
+	max.f = vmaxnmvq_f64(vmax);
+	sum.f = vaddvq_f64(vsum);
+
+	j_reduce_merge(reduce, min, max, sum);
+	j_reduce_update_double_software(reduce, data + i, count - i);
+}
+#endif
+
+/**
+ * Counts elements into the histogram.
+ *
+ * \private
+ **/
+static
+void
+j_reduce_update_histogram (JReduce* reduce, gconstpointer data, guint64 count)
+{
+	gdouble const scale = reduce->bins / (reduce->upper - reduce->lower);
+
+	for (guint64 i = 0; i < count; i++)
+	{
+		gdouble value;
+		guint bin;
+
+		switch (reduce->type)
+		{
+			case J_REDUCE_TYPE_INT32:
+				value = ((gint32 const*)data)[i];
+				break;
+			case J_REDUCE_TYPE_INT64:
+				value = ((gint64 const*)data)[i];
+				break;
+			case J_REDUCE_TYPE_FLOAT:
+				value = ((gfloat const*)data)[i];
+				break;
+			case J_REDUCE_TYPE_DOUBLE:
+				value = ((gdouble const*)data)[i];
+				break;
+			default:
+				g_assert_not_reached();
+		}
+
+		if (!(value >= reduce->lower && value < reduce->upper))
+		{
+			continue;
+		}
+
+		/* Rounding might push values just below the upper bound out of the last bin. */
+		bin = MIN((guint)((value - reduce->lower) * scale), reduce->bins - 1);
+		reduce->histogram[bin]++;
+	}
+}
+
+/**
+ * Creates a new reduction.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * JReduce* reduce;
+ *
+ * reduce = j_reduce_new(J_REDUCE_TYPE_DOUBLE);
+ * \endcode
+ *
+ * \param type The type of the array's elements.
+ *
+ * \return A new reduction. Should be freed with j_reduce_free().
+ **/
+JReduce*
+j_reduce_new (JReduceType type)
+{
+	JReduce* reduce;
+
+	g_return_val_if_fail(type <= J_REDUCE_TYPE_DOUBLE, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	reduce = g_slice_new(JReduce);
+	reduce->type = type;
+	reduce->lower = 0.0;
+	reduce->upper = 0.0;
+	reduce->bins = 0;
+	reduce->histogram = NULL;
+
+	j_reduce_reset(reduce);
+
+	j_trace_leave(G_STRFUNC);
+
+	return reduce;
+}
+
+/**
+ * Frees the memory allocated by the reduction.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ **/
+void
+j_reduce_free (JReduce* reduce)
+{
+	g_return_if_fail(reduce != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_free(reduce->histogram);
+	g_slice_free(JReduce, reduce);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Lets the reduction compute a histogram with equally sized bins.
+ * Resets the histogram.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_reduce_set_histogram(reduce, 0.0, 100.0, 10);
+ * \endcode
+ *
+ * \param reduce A reduction.
+ * \param lower  The lower bound of the first bin.
+ * \param upper  The upper bound of the last bin, exclusive.
+ * \param bins   The number of bins, 0 to disable the histogram.
+ **/
+void
+j_reduce_set_histogram (JReduce* reduce, gdouble lower, gdouble upper, guint bins)
+{
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(bins == 0 || lower < upper);
+	g_return_if_fail(bins <= J_REDUCE_HISTOGRAM_MAX);
+
+	g_free(reduce->histogram);
+
+	reduce->lower = lower;
+	reduce->upper = upper;
+	reduce->bins = bins;
+	reduce->histogram = (bins > 0) ? g_new0(guint64, bins) : NULL;
+}
+
+/**
+ * Returns the type of the array's elements.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The type.
+ **/
+JReduceType
+j_reduce_get_type (JReduce const* reduce)
+{
+	g_return_val_if_fail(reduce != NULL, J_REDUCE_TYPE_INT32);
+
+	return reduce->type;
+}
+
+/**
+ * Returns the size of the array's elements.
+ * Offsets and lengths of reduced extents should be multiples of it.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The size in bytes.
+ **/
+gsize
+j_reduce_get_element_size (JReduce const* reduce)
+{
+	gsize ret = 0;
+
+	g_return_val_if_fail(reduce != NULL, 0);
+
+	switch (reduce->type)
+	{
+		case J_REDUCE_TYPE_INT32:
+			ret = sizeof(gint32);
+			break;
+		case J_REDUCE_TYPE_INT64:
+			ret = sizeof(gint64);
+			break;
+		case J_REDUCE_TYPE_FLOAT:
+			ret = sizeof(gfloat);
+			break;
+		case J_REDUCE_TYPE_DOUBLE:
+			ret = sizeof(gdouble);
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	return ret;
+}
+
+/**
+ * Resets the reduction, so it can be reused.
+ * The histogram's bins are kept.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ **/
+void
+j_reduce_reset (JReduce* reduce)
+{
+	g_return_if_fail(reduce != NULL);
+
+	reduce->count = 0;
+
+	if (j_reduce_is_integer(reduce->type))
+	{
+		reduce->min.i = G_MAXINT64;
+		reduce->max.i = G_MININT64;
+		reduce->sum.i = 0;
+	}
+	else
+	{
+		reduce->min.f = INFINITY;
+		reduce->max.f = -INFINITY;
+		reduce->sum.f = 0.0;
+	}
+
+	if (reduce->histogram != NULL)
+	{
+		memset(reduce->histogram, 0, reduce->bins * sizeof(guint64));
+	}
+}
+
+/**
+ * Adds elements to the reduction.
+ * A trailing partial element is ignored.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ * \param data   The elements.
+ * \param length The elements' length in bytes.
+ **/
+void
+j_reduce_update (JReduce* reduce, gconstpointer data, guint64 length)
+{
+	guint64 count;
+
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(data != NULL || length == 0);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	count = length / j_reduce_get_element_size(reduce);
+
+	if (count == 0)
+	{
+		goto end;
+	}
+
+	switch (reduce->type)
+	{
+		case J_REDUCE_TYPE_INT32:
+#if defined(__x86_64__) && defined(__GNUC__)
+			if (__builtin_cpu_supports("sse4.1"))
+			{
+				j_reduce_update_int32_hardware(reduce, data, count);
+				break;
+			}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+			j_reduce_update_int32_hardware(reduce, data, count);
+			break;
+#endif
+
+			j_reduce_update_int32_software(reduce, data, count);
+			break;
+		case J_REDUCE_TYPE_INT64:
+			/* Vector instructions for 64-bit minimums and maximums require AVX-512. */
+			j_reduce_update_int64_software(reduce, data, count);
+			break;
+		case J_REDUCE_TYPE_FLOAT:
+			/* SSE2 is always available on x86-64. */
+#if (defined(__x86_64__) && defined(__GNUC__)) || (defined(__aarch64__) && defined(__ARM_NEON))
+			j_reduce_update_float_hardware(reduce, data, count);
+#else
+			j_reduce_update_float_software(reduce, data, count);
+#endif
+			break;
+		case J_REDUCE_TYPE_DOUBLE:
+#if (defined(__x86_64__) && defined(__GNUC__)) || (defined(__aarch64__) && defined(__ARM_NEON))
+			j_reduce_update_double_hardware(reduce, data, count);
+#else
+			j_reduce_update_double_software(reduce, data, count);
+#endif
+			break;
+		default:
+			g_assert_not_reached();
+	}
+
+	if (reduce->bins > 0)
+	{
+		j_reduce_update_histogram(reduce, data, count);
+	}
+
+	reduce->count += count;
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Combines a partial reduction into another reduction.
+ * Both reductions must have the same type and histogram bins.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ * \param other  A partial reduction.
+ **/
+void
+j_reduce_combine (JReduce* reduce, JReduce const* other)
+{
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(other != NULL);
+	g_return_if_fail(reduce->type == other->type);
+	g_return_if_fail(reduce->bins == other->bins);
+
+	if (other->count == 0)
+	{
+		return;
+	}
+
+	j_reduce_merge(reduce, other->min, other->max, other->sum);
+	reduce->count += other->count;
+
+	for (guint i = 0; i < reduce->bins; i++)
+	{
+		reduce->histogram[i] += other->histogram[i];
+	}
+}
+
+/**
+ * Returns the number of elements.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The number of elements.
+ **/
+guint64
+j_reduce_get_count (JReduce const* reduce)
+{
+	g_return_val_if_fail(reduce != NULL, 0);
+
+	return reduce->count;
+}
+
+/**
+ * Returns the minimum.
+ * Only meaningful if there is at least one element.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The minimum.
+ **/
+JReduceValue
+j_reduce_get_min (JReduce const* reduce)
+{
+	g_return_val_if_fail(reduce != NULL, (JReduceValue){ .i = 0 });
+
+	return reduce->min;
+}
+
+/**
+ * Returns the maximum.
+ * Only meaningful if there is at least one element.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The maximum.
+ **/
+JReduceValue
+j_reduce_get_max (JReduce const* reduce)
+{
+	g_return_val_if_fail(reduce != NULL, (JReduceValue){ .i = 0 });
+
+	return reduce->max;
+}
+
+/**
+ * Returns the sum.
+ * Integer sums wrap around on overflow, float sums are computed using doubles.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The sum.
+ **/
+JReduceValue
+j_reduce_get_sum (JReduce const* reduce)
+{
+	g_return_val_if_fail(reduce != NULL, (JReduceValue){ .i = 0 });
+
+	return reduce->sum;
+}
+
+/**
+ * Returns the histogram.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ * \param bins   Returns the number of bins.
+ *
+ * \return The bins' counts, NULL if no histogram is computed.
+ **/
+guint64 const*
+j_reduce_get_histogram (JReduce const* reduce, guint* bins)
+{
+	g_return_val_if_fail(reduce != NULL, NULL);
+	g_return_val_if_fail(bins != NULL, NULL);
+
+	*bins = reduce->bins;
+
+	return reduce->histogram;
+}
+
+/**
+ * Returns the size of the parameters appended by j_reduce_append_parameters().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return The size in bytes.
+ **/
+gsize
+j_reduce_get_parameters_size (void)
+{
+	/* Type, number of bins and histogram range */
+	return 1 + 4 + 8 + 8;
+}
+
+/**
+ * Appends the reduction's parameters to a message.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce  A reduction.
+ * \param message A message.
+ **/
+void
+j_reduce_append_parameters (JReduce const* reduce, JMessage* message)
+{
+	gchar type;
+	guint32 bins;
+
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(message != NULL);
+
+	type = reduce->type;
+	bins = reduce->bins;
+
+	j_message_append_1(message, &type);
+	j_message_append_4(message, &bins);
+	j_message_append_8(message, &(reduce->lower));
+	j_message_append_8(message, &(reduce->upper));
+}
+
+/**
+ * Creates a new reduction from parameters appended with j_reduce_append_parameters().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ *
+ * \return A new reduction, NULL if the parameters are invalid. Should be freed with j_reduce_free().
+ **/
+JReduce*
+j_reduce_new_from_message (JMessage* message)
+{
+	JReduce* reduce;
+	gint64 lower;
+	gint64 upper;
+	guint type;
+	guint32 bins;
+
+	g_return_val_if_fail(message != NULL, NULL);
+
+	type = (guchar)j_message_get_1(message);
+	bins = j_message_get_4(message);
+	lower = j_message_get_8(message);
+	upper = j_message_get_8(message);
+
+	if (type > J_REDUCE_TYPE_DOUBLE || bins > J_REDUCE_HISTOGRAM_MAX)
+	{
+		return NULL;
+	}
+
+	reduce = j_reduce_new(type);
+
+	memcpy(&(reduce->lower), &lower, sizeof(gdouble));
+	memcpy(&(reduce->upper), &upper, sizeof(gdouble));
+
+	if (bins > 0 && reduce->lower < reduce->upper)
+	{
+		reduce->bins = bins;
+		reduce->histogram = g_new0(guint64, bins);
+	}
+
+	return reduce;
+}
+
+/**
+ * Returns the size of the result appended by j_reduce_append_result().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce A reduction.
+ *
+ * \return The size in bytes.
+ **/
+gsize
+j_reduce_get_result_size (JReduce const* reduce)
+{
+	g_return_val_if_fail(reduce != NULL, 0);
+
+	/* Count, minimum, maximum, sum and bins */
+	return (4 + reduce->bins) * sizeof(guint64);
+}
+
+/**
+ * Appends the reduction's result to a message.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce  A reduction.
+ * \param message A message.
+ **/
+void
+j_reduce_append_result (JReduce const* reduce, JMessage* message)
+{
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(message != NULL);
+
+	/* The values' bits are sent as they are, regardless of their type. */
+	j_message_append_8(message, &(reduce->count));
+	j_message_append_8(message, &(reduce->min));
+	j_message_append_8(message, &(reduce->max));
+	j_message_append_8(message, &(reduce->sum));
+
+	for (guint i = 0; i < reduce->bins; i++)
+	{
+		j_message_append_8(message, &(reduce->histogram[i]));
+	}
+}
+
+/**
+ * Combines a partial result appended with j_reduce_append_result() into a reduction.
+ * The partial result must have been computed with the reduction's parameters.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param reduce  A reduction.
+ * \param message A message.
+ **/
+void
+j_reduce_combine_from_message (JReduce* reduce, JMessage* message)
+{
+	JReduceValue min;
+	JReduceValue max;
+	JReduceValue sum;
+	guint64 count;
+
+	g_return_if_fail(reduce != NULL);
+	g_return_if_fail(message != NULL);
+
+	count = j_message_get_8(message);
+	min.i = j_message_get_8(message);
+	max.i = j_message_get_8(message);
+	sum.i = j_message_get_8(message);
+
+	for (guint i = 0; i < reduce->bins; i++)
+	{
+		reduce->histogram[i] += j_message_get_8(message);
+	}
+
+	if (count > 0)
+	{
+		j_reduce_merge(reduce, min, max, sum);
+		reduce->count += count;
+	}
+}
+
+/**
+ * @}
+ **/
@@ -72,6 +72,11 @@ struct JSemantics
 	 */
 	gint ordering;
 
+	/**
+	 * The access pattern hint.
+	 */
+	gint access;
+
 	/**
 	 * Whether the semantics object is immutable.
 	 **/
@@ -107,6 +112,7 @@ j_semantics_new (JSemanticsTemplate template)
 	semantics->persistency = J_SEMANTICS_PERSISTENCY_IMMEDIATE;
 	semantics->safety = J_SEMANTICS_SAFETY_NETWORK;
 	semantics->security = J_SEMANTICS_SECURITY_NONE;
+	semantics->access = J_SEMANTICS_ACCESS_DEFAULT;
 	semantics->immutable = FALSE;
 	semantics->ref_count = 1;
 
@@ -132,6 +138,21 @@ j_semantics_new (JSemanticsTemplate template)
 			semantics->safety = J_SEMANTICS_SAFETY_NETWORK;
 			semantics->security = J_SEMANTICS_SECURITY_NONE;
 			break;
+		case J_SEMANTICS_TEMPLATE_CHECKPOINT:
+			/*
+			 * Checkpoints are written once by a single process per object and only read back when restarting.
+			 * Locks and strict ordering are therefore unnecessary and batches are cached and executed in the background.
+			 * Durability is only required at the end, which has to be requested explicitly using j_object_sync().
+			 */
+			semantics->atomicity = J_SEMANTICS_ATOMICITY_NONE;
+			semantics->concurrency = J_SEMANTICS_CONCURRENCY_NON_OVERLAPPING;
+			semantics->consistency = J_SEMANTICS_CONSISTENCY_EVENTUAL;
+			semantics->ordering = J_SEMANTICS_ORDERING_RELAXED;
+			semantics->persistency = J_SEMANTICS_PERSISTENCY_EVENTUAL;
+			semantics->safety = J_SEMANTICS_SAFETY_NONE;
+			semantics->security = J_SEMANTICS_SECURITY_NONE;
+			semantics->access = J_SEMANTICS_ACCESS_SEQUENTIAL;
+			break;
 		default:
 			g_warn_if_reached();
 	}
@@ -177,6 +198,10 @@ j_semantics_new_from_string (gchar const* template_str, gchar const* semantics_s
 	{
 		semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_TEMPORARY_LOCAL);
 	}
+	else if (g_strcmp0(template_str, "checkpoint") == 0)
+	{
+		semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_CHECKPOINT);
+	}
 	else
 	{
 		g_assert_not_reached();
@@ -326,6 +351,25 @@ j_semantics_new_from_string (gchar const* template_str, gchar const* semantics_s
 				g_assert_not_reached();
 			}
 		}
+		else if (g_str_has_prefix(parts[i], "access="))
+		{
+			if (g_strcmp0(value, "default") == 0)
+			{
+				j_semantics_set(semantics, J_SEMANTICS_ACCESS, J_SEMANTICS_ACCESS_DEFAULT);
+			}
+			else if (g_strcmp0(value, "sequential") == 0)
+			{
+				j_semantics_set(semantics, J_SEMANTICS_ACCESS, J_SEMANTICS_ACCESS_SEQUENTIAL);
+			}
+			else if (g_strcmp0(value, "random") == 0)
+			{
+				j_semantics_set(semantics, J_SEMANTICS_ACCESS, J_SEMANTICS_ACCESS_RANDOM);
+			}
+			else
+			{
+				g_assert_not_reached();
+			}
+		}
 		else
 		{
 			g_assert_not_reached();
@@ -431,6 +475,9 @@ j_semantics_set (JSemantics* semantics, JSemanticsType key, gint value)
 		case J_SEMANTICS_SECURITY:
 			semantics->security = value;
 			break;
+		case J_SEMANTICS_ACCESS:
+			semantics->access = value;
+			break;
 		default:
 			g_warn_if_reached();
 	}
@@ -473,6 +520,8 @@ j_semantics_get (JSemantics* semantics, JSemanticsType key)
 			return semantics->safety;
 		case J_SEMANTICS_SECURITY:
 			return semantics->security;
+		case J_SEMANTICS_ACCESS:
+			return semantics->access;
 		default:
 			g_return_val_if_reached(-1);
 	}
@@ -25,7 +25,9 @@
 #include <glib.h>
 
 #include <jstatistics.h>
+#include <jstatistics-internal.h>
 
+#include <jhelper.h>
 #include <jtrace-internal.h>
 
 /**
@@ -39,6 +41,11 @@
  **/
 struct JStatistics
 {
+	/**
+	 * Padding to keep statistics of different threads in separate cache lines.
+	 **/
+	gchar padding_begin[64];
+
 	/**
 	 * Whether to trace.
 	 **/
@@ -83,6 +90,72 @@ struct JStatistics
 	 * The number of sent bytes.
 	 **/
 	guint64 bytes_sent;
+
+	/**
+	 * The number of detected checksum errors.
+	 **/
+	guint64 checksum_errors;
+
+	/**
+	 * The number of KV values found in the server's cache.
+	 **/
+	guint64 kv_cache_hits;
+
+	/**
+	 * The number of KV values not found in the server's cache.
+	 **/
+	guint64 kv_cache_misses;
+
+	/**
+	 * The number of bytes written to compressed objects before compressing them.
+	 **/
+	guint64 bytes_compressed;
+
+	/**
+	 * The number of bytes written to compressed objects after compressing them.
+	 **/
+	guint64 bytes_stored;
+
+	/**
+	 * The number of sent messages.
+	 **/
+	guint64 messages_sent;
+
+	/**
+	 * The number of received messages.
+	 **/
+	guint64 messages_received;
+
+	/**
+	 * The number of different servers contacted.
+	 **/
+	guint64 servers;
+
+	/**
+	 * The time spent waiting for connections in microseconds.
+	 **/
+	guint64 connection_wait;
+
+	/**
+	 * The time spent sending and receiving messages in microseconds.
+	 **/
+	guint64 network_time;
+
+	/**
+	 * The names of the contacted servers, NULL if none have been recorded.
+	 * Protected by #mutex.
+	 **/
+	GHashTable* server_names;
+
+	/**
+	 * Protects #server_names.
+	 **/
+	GMutex mutex[1];
+
+	/**
+	 * See padding_begin.
+	 **/
+	gchar padding_end[64];
 };
 
 static
@@ -107,6 +180,26 @@ j_statistics_get_type_name (JStatisticsType type)
 			return "bytes_received";
 		case J_STATISTICS_BYTES_SENT:
 			return "bytes_sent";
+		case J_STATISTICS_CHECKSUM_ERRORS:
+			return "checksum_errors";
+		case J_STATISTICS_KV_CACHE_HITS:
+			return "kv_cache_hits";
+		case J_STATISTICS_KV_CACHE_MISSES:
+			return "kv_cache_misses";
+		case J_STATISTICS_BYTES_COMPRESSED:
+			return "bytes_compressed";
+		case J_STATISTICS_BYTES_STORED:
+			return "bytes_stored";
+		case J_STATISTICS_MESSAGES_SENT:
+			return "messages_sent";
+		case J_STATISTICS_MESSAGES_RECEIVED:
+			return "messages_received";
+		case J_STATISTICS_SERVERS:
+			return "servers";
+		case J_STATISTICS_CONNECTION_WAIT:
+			return "connection_wait";
+		case J_STATISTICS_NETWORK_TIME:
+			return "network_time";
 		default:
 			g_warn_if_reached();
 			return NULL;
@@ -114,10 +207,67 @@ j_statistics_get_type_name (JStatisticsType type)
 }
 
 /**
- * Creates a new statistics.
+ * Returns the location of a statistics value.
  *
  * \private
  *
+ * \param statistics A statistics.
+ * \param type       A statistics type.
+ *
+ * \return The value's location, NULL if the type is unknown.
+ **/
+static
+guint64*
+j_statistics_get_location (JStatistics* statistics, JStatisticsType type)
+{
+	switch (type)
+	{
+		case J_STATISTICS_FILES_CREATED:
+			return &(statistics->files_created);
+		case J_STATISTICS_FILES_DELETED:
+			return &(statistics->files_deleted);
+		case J_STATISTICS_FILES_STATED:
+			return &(statistics->files_stated);
+		case J_STATISTICS_SYNC:
+			return &(statistics->sync_count);
+		case J_STATISTICS_BYTES_READ:
+			return &(statistics->bytes_read);
+		case J_STATISTICS_BYTES_WRITTEN:
+			return &(statistics->bytes_written);
+		case J_STATISTICS_BYTES_RECEIVED:
+			return &(statistics->bytes_received);
+		case J_STATISTICS_BYTES_SENT:
+			return &(statistics->bytes_sent);
+		case J_STATISTICS_CHECKSUM_ERRORS:
+			return &(statistics->checksum_errors);
+		case J_STATISTICS_KV_CACHE_HITS:
+			return &(statistics->kv_cache_hits);
+		case J_STATISTICS_KV_CACHE_MISSES:
+			return &(statistics->kv_cache_misses);
+		case J_STATISTICS_BYTES_COMPRESSED:
+			return &(statistics->bytes_compressed);
+		case J_STATISTICS_BYTES_STORED:
+			return &(statistics->bytes_stored);
+		case J_STATISTICS_MESSAGES_SENT:
+			return &(statistics->messages_sent);
+		case J_STATISTICS_MESSAGES_RECEIVED:
+			return &(statistics->messages_received);
+		case J_STATISTICS_SERVERS:
+			return &(statistics->servers);
+		case J_STATISTICS_CONNECTION_WAIT:
+			return &(statistics->connection_wait);
+		case J_STATISTICS_NETWORK_TIME:
+			return &(statistics->network_time);
+		default:
+			g_warn_if_reached();
+			return NULL;
+	}
+}
+
+/**
+ * Creates a new statistics.
+ * Statistics can be attached to batches using j_batch_set_statistics().
+ *
  * \author Michael Kuhn
  *
  * \code
@@ -145,6 +295,19 @@ j_statistics_new (gboolean trace)
 	statistics->bytes_written = 0;
 	statistics->bytes_received = 0;
 	statistics->bytes_sent = 0;
+	statistics->checksum_errors = 0;
+	statistics->kv_cache_hits = 0;
+	statistics->kv_cache_misses = 0;
+	statistics->bytes_compressed = 0;
+	statistics->bytes_stored = 0;
+	statistics->messages_sent = 0;
+	statistics->messages_received = 0;
+	statistics->servers = 0;
+	statistics->connection_wait = 0;
+	statistics->network_time = 0;
+	statistics->server_names = NULL;
+
+	g_mutex_init(statistics->mutex);
 
 	j_trace_leave(G_STRFUNC);
 
@@ -154,8 +317,6 @@ j_statistics_new (gboolean trace)
 /**
  * Frees the memory allocated for the statistics.
  *
- * \private
- *
  * \author Michael Kuhn
  *
  * \code
@@ -170,6 +331,13 @@ j_statistics_free (JStatistics* statistics)
 
 	j_trace_enter(G_STRFUNC, NULL);
 
+	if (statistics->server_names != NULL)
+	{
+		g_hash_table_unref(statistics->server_names);
+	}
+
+	g_mutex_clear(statistics->mutex);
+
 	g_slice_free(JStatistics, statistics);
 
 	j_trace_leave(G_STRFUNC);
@@ -178,41 +346,16 @@ j_statistics_free (JStatistics* statistics)
 guint64
 j_statistics_get (JStatistics* statistics, JStatisticsType type)
 {
+	guint64* location;
 	guint64 value = 0;
 
 	g_return_val_if_fail(statistics != NULL, 0);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	switch (type)
+	if ((location = j_statistics_get_location(statistics, type)) != NULL)
 	{
-		case J_STATISTICS_FILES_CREATED:
-			value = statistics->files_created;
-			break;
-		case J_STATISTICS_FILES_DELETED:
-			value = statistics->files_deleted;
-			break;
-		case J_STATISTICS_FILES_STATED:
-			value = statistics->files_stated;
-			break;
-		case J_STATISTICS_SYNC:
-			value = statistics->sync_count;
-			break;
-		case J_STATISTICS_BYTES_READ:
-			value = statistics->bytes_read;
-			break;
-		case J_STATISTICS_BYTES_WRITTEN:
-			value = statistics->bytes_written;
-			break;
-		case J_STATISTICS_BYTES_RECEIVED:
-			value = statistics->bytes_received;
-			break;
-		case J_STATISTICS_BYTES_SENT:
-			value = statistics->bytes_sent;
-			break;
-		default:
-			g_warn_if_reached();
-			break;
+		value = *location;
 	}
 
 	j_trace_leave(G_STRFUNC);
@@ -223,39 +366,15 @@ j_statistics_get (JStatistics* statistics, JStatisticsType type)
 void
 j_statistics_add (JStatistics* statistics, JStatisticsType type, guint64 value)
 {
+	guint64* location;
+
 	g_return_if_fail(statistics != NULL);
 
 	j_trace_enter(G_STRFUNC, NULL);
 
-	switch (type)
+	if ((location = j_statistics_get_location(statistics, type)) != NULL)
 	{
-		case J_STATISTICS_FILES_CREATED:
-			statistics->files_created += value;
-			break;
-		case J_STATISTICS_FILES_DELETED:
-			statistics->files_deleted += value;
-			break;
-		case J_STATISTICS_FILES_STATED:
-			statistics->files_stated += value;
-			break;
-		case J_STATISTICS_SYNC:
-			statistics->sync_count += value;
-			break;
-		case J_STATISTICS_BYTES_READ:
-			statistics->bytes_read += value;
-			break;
-		case J_STATISTICS_BYTES_WRITTEN:
-			statistics->bytes_written += value;
-			break;
-		case J_STATISTICS_BYTES_RECEIVED:
-			statistics->bytes_received += value;
-			break;
-		case J_STATISTICS_BYTES_SENT:
-			statistics->bytes_sent += value;
-			break;
-		default:
-			g_warn_if_reached();
-			break;
+		*location += value;
 	}
 
 	if (statistics->trace)
@@ -266,6 +385,69 @@ j_statistics_add (JStatistics* statistics, JStatisticsType type, guint64 value)
 	j_trace_leave(G_STRFUNC);
 }
 
+/**
+ * Adds a value to the statistics atomically.
+ * This is necessary for statistics that are shared between threads, such as those of batches.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param statistics A statistics.
+ * \param type       A statistics type.
+ * \param value      A value.
+ **/
+void
+j_statistics_add_atomic (JStatistics* statistics, JStatisticsType type, guint64 value)
+{
+	guint64* location;
+
+	g_return_if_fail(statistics != NULL);
+
+	if ((location = j_statistics_get_location(statistics, type)) != NULL)
+	{
+		j_helper_atomic_add(location, value);
+	}
+}
+
+/**
+ * Records that a server has been contacted.
+ * J_STATISTICS_SERVERS is only incremented for servers that have not been recorded before.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param statistics A statistics.
+ * \param server     A server name.
+ **/
+void
+j_statistics_add_server (JStatistics* statistics, gchar const* server)
+{
+	g_return_if_fail(statistics != NULL);
+	g_return_if_fail(server != NULL);
+
+	g_mutex_lock(statistics->mutex);
+
+	if (statistics->server_names == NULL)
+	{
+		statistics->server_names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	if (g_hash_table_add(statistics->server_names, g_strdup(server)))
+	{
+		j_helper_atomic_add(&(statistics->servers), 1);
+	}
+
+	g_mutex_unlock(statistics->mutex);
+}
+
 /**
  * @}
  **/
@@ -24,6 +24,16 @@
 
 #include <glib.h>
 #include <glib/gprintf.h>
+#include <glib-unix.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #ifdef HAVE_OTF
 #include <otf.h>
@@ -35,11 +45,47 @@
  * \defgroup JTrace Trace
  *
  * The JTrace framework offers abstracted trace capabilities.
- * It can use normal terminal output and OTF.
+ * It can use normal terminal output, OTF, per-thread ring buffers and the Chrome trace format.
  *
  * @{
  **/
 
+/**
+ * A ring buffer of events.
+ * It is filled by its thread and emptied by the flusher thread without locking.
+ **/
+struct JTraceRing
+{
+	JTraceEvent* events;
+
+	/**
+	 * The number of events recorded so far.
+	 * Only written by the thread.
+	 **/
+	guint head;
+
+	/**
+	 * The number of events flushed so far.
+	 * Only written by the flusher thread.
+	 **/
+	guint tail;
+
+	/**
+	 * The number of events dropped because the ring was full.
+	 **/
+	guint dropped;
+
+	guint32 thread_id;
+
+	/**
+	 * Whether the thread has finished.
+	 * The flusher thread frees the ring once it is empty.
+	 **/
+	gint finished;
+};
+
+typedef struct JTraceRing JTraceRing;
+
 /**
  * A trace.
  * Usually one trace per thread is used.
@@ -76,6 +122,33 @@ struct JTrace
 	otf;
 #endif
 
+	/**
+	 * Chrome-specific structure.
+	 **/
+	struct
+	{
+		/**
+		 * Thread ID, unique within the process.
+		 **/
+		guint32 thread_id;
+	}
+	chrome;
+
+	/**
+	 * Ring-specific structure.
+	 **/
+	struct
+	{
+		JTraceRing* ring;
+
+		/**
+		 * Thread-local copies of the interned IDs, indexed by record type.
+		 * They allow looking up IDs without taking the global lock.
+		 **/
+		GHashTable* ids[J_TRACE_RECORD_COUNTER + 1];
+	}
+	ring;
+
 	/**
 	 * The reference count.
 	 **/
@@ -89,13 +162,18 @@ enum JTraceFlags
 {
 	J_TRACE_OFF     = 0,
 	J_TRACE_ECHO    = 1 << 0,
-	J_TRACE_OTF     = 1 << 1
+	J_TRACE_OTF     = 1 << 1,
+	J_TRACE_RING    = 1 << 2,
+	J_TRACE_CHROME  = 1 << 3
 };
 
 typedef enum JTraceFlags JTraceFlags;
 
 static JTraceFlags j_trace_flags = J_TRACE_OFF;
 
+gboolean j_trace_enabled = FALSE;
+guint j_trace_generation = 0;
+
 static gchar* j_trace_name = NULL;
 static gint j_trace_thread_id = 1;
 
@@ -117,116 +195,695 @@ static GHashTable* otf_counter_table = NULL;
 G_LOCK_DEFINE_STATIC(j_trace_otf);
 #endif
 
+/**
+ * The number of events per ring, a power of two.
+ **/
+static guint j_trace_ring_size = 16384;
+
+static FILE* j_trace_ring_file = NULL;
+static GThread* j_trace_ring_thread = NULL;
+static GMainLoop* j_trace_ring_loop = NULL;
+
+/**
+ * The rings of all threads.
+ **/
+static GPtrArray* j_trace_ring_rings = NULL;
+
+/**
+ * The interned names, indexed by record type.
+ **/
+static GHashTable* j_trace_ring_ids[J_TRACE_RECORD_COUNTER + 1];
+static guint32 j_trace_ring_id = 1;
+
+/**
+ * Records defining names that have not been written yet.
+ **/
+static GByteArray* j_trace_ring_definitions = NULL;
+
+/**
+ * Protects the rings, the interned names and the definitions.
+ * Never taken when recording events.
+ **/
+G_LOCK_DEFINE_STATIC(j_trace_ring);
+
+static FILE* j_trace_chrome_file = NULL;
+static gint j_trace_chrome_pid = 0;
+static guint32 j_trace_chrome_thread_id = 1;
+static gboolean j_trace_chrome_first = TRUE;
+
+/**
+ * Protects the Chrome trace file.
+ **/
+G_LOCK_DEFINE_STATIC(j_trace_chrome);
+
 static
 void
 j_trace_thread_default_free (gpointer data)
 {
 	JTrace* trace = data;
 
-	j_trace_unref(trace);
-}
+	j_trace_unref(trace);
+}
+
+static GPrivate j_trace_thread_default = G_PRIVATE_INIT(j_trace_thread_default_free);
+
+G_LOCK_DEFINE_STATIC(j_trace_echo);
+
+/**
+ * Prints a common header to stderr.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param trace     A trace.
+ * \param timestamp A timestamp.
+ **/
+static
+void
+j_trace_echo_printerr (JTrace* trace, guint64 timestamp)
+{
+	guint i;
+
+	g_printerr("[%" G_GUINT64_FORMAT ".%06" G_GUINT64_FORMAT "] %s: ", timestamp / G_USEC_PER_SEC, timestamp % G_USEC_PER_SEC, trace->thread_name);
+
+	for (i = 0; i < trace->function_depth; i++)
+	{
+		g_printerr("  ");
+	}
+}
+
+/**
+ * Returns the current time.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * guint64 timestamp;
+ *
+ * timestamp = j_trace_get_time();
+ * \endcode
+ *
+ * \return A time stamp in microseconds.
+ **/
+static
+guint64
+j_trace_get_time (void)
+{
+	GTimeVal timeval;
+	guint64 timestamp;
+
+	g_get_current_time(&timeval);
+	timestamp = (timeval.tv_sec * G_USEC_PER_SEC) + timeval.tv_usec;
+
+	return timestamp;
+}
+
+/**
+ * Returns the name of a file operation.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param op A file operation.
+ *
+ * \return A name.
+ **/
+static
+gchar const*
+j_trace_file_operation_name (JTraceFileOperation op)
+{
+	switch (op)
+	{
+		case J_TRACE_FILE_CLOSE:
+			return "close";
+		case J_TRACE_FILE_CREATE:
+			return "create";
+		case J_TRACE_FILE_DELETE:
+			return "delete";
+		case J_TRACE_FILE_OPEN:
+			return "open";
+		case J_TRACE_FILE_READ:
+			return "read";
+		case J_TRACE_FILE_SEEK:
+			return "seek";
+		case J_TRACE_FILE_STATUS:
+			return "status";
+		case J_TRACE_FILE_SYNC:
+			return "sync";
+		case J_TRACE_FILE_WRITE:
+			return "write";
+		default:
+			g_warn_if_reached();
+			return NULL;
+	}
+}
+
+/**
+ * Returns the current tick count.
+ * Uses the time stamp counter if available.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \return A tick count.
+ **/
+static inline
+guint64
+j_trace_ring_get_ticks (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return g_get_monotonic_time();
+#endif
+}
+
+/**
+ * Appends a record to a byte array.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param array   A byte array.
+ * \param type    A record type.
+ * \param id      An ID.
+ * \param payload The payload.
+ * \param size    The payload's size.
+ **/
+static
+void
+j_trace_ring_append_record (GByteArray* array, JTraceRecordType type, guint32 id, gconstpointer payload, guint64 size)
+{
+	JTraceRecord record;
+
+	record.type = type;
+	record.id = id;
+	record.size = size;
+
+	g_byte_array_append(array, (guint8 const*)&record, sizeof(record));
+	g_byte_array_append(array, payload, size);
+}
+
+/**
+ * Writes a record to the trace file.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param type    A record type.
+ * \param id      An ID.
+ * \param payload The payload.
+ * \param size    The payload's size.
+ **/
+static
+void
+j_trace_ring_write_record (JTraceRecordType type, guint32 id, gconstpointer payload, guint64 size)
+{
+	JTraceRecord record;
+
+	record.type = type;
+	record.id = id;
+	record.size = size;
+
+	fwrite(&record, sizeof(record), 1, j_trace_ring_file);
+	fwrite(payload, size, 1, j_trace_ring_file);
+}
+
+/**
+ * Returns the ID of a name, interning it if necessary.
+ * Only takes the global lock the first time a thread uses a name.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param trace A trace.
+ * \param type  The record type defining the name.
+ * \param name  A name.
+ *
+ * \return An ID.
+ **/
+static
+guint32
+j_trace_ring_intern (JTrace* trace, JTraceRecordType type, gchar const* name)
+{
+	gpointer value;
+	guint32 id;
+
+	if (G_LIKELY((value = g_hash_table_lookup(trace->ring.ids[type], name)) != NULL))
+	{
+		return GPOINTER_TO_UINT(value);
+	}
+
+	G_LOCK(j_trace_ring);
+
+	if ((value = g_hash_table_lookup(j_trace_ring_ids[type], name)) == NULL)
+	{
+		id = j_trace_ring_id++;
+
+		g_hash_table_insert(j_trace_ring_ids[type], g_strdup(name), GUINT_TO_POINTER(id));
+		j_trace_ring_append_record(j_trace_ring_definitions, type, id, name, strlen(name));
+	}
+	else
+	{
+		id = GPOINTER_TO_UINT(value);
+	}
+
+	G_UNLOCK(j_trace_ring);
+
+	g_hash_table_insert(trace->ring.ids[type], g_strdup(name), GUINT_TO_POINTER(id));
+
+	return id;
+}
+
+/**
+ * Records an event in the thread's ring.
+ * The event is dropped if the ring is full.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param trace  A trace.
+ * \param type   An event type.
+ * \param id     The ID of the function, file or counter.
+ * \param op     A file operation.
+ * \param value0 The first value.
+ * \param value1 The second value.
+ **/
+static
+void
+j_trace_ring_record (JTrace* trace, JTraceEventType type, guint32 id, JTraceFileOperation op, guint64 value0, guint64 value1)
+{
+	JTraceRing* ring = trace->ring.ring;
+	JTraceEvent* event;
+	guint head;
+
+	head = ring->head;
+
+	if (G_UNLIKELY(head - (guint)g_atomic_int_get(&(ring->tail)) >= j_trace_ring_size))
+	{
+		g_atomic_int_inc(&(ring->dropped));
+		return;
+	}
+
+	event = &(ring->events[head & (j_trace_ring_size - 1)]);
+	event->ticks = j_trace_ring_get_ticks();
+	event->id = id;
+	event->type = type;
+	event->op = op;
+	event->value[0] = value0;
+	event->value[1] = value1;
+
+	/* Publishes the event to the flusher thread. */
+	g_atomic_int_set(&(ring->head), head + 1);
+}
+
+/**
+ * Writes the events recorded since the last flush to the trace file.
+ * Must only be called from one thread at a time.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param sync Whether to sync the trace file.
+ **/
+static
+void
+j_trace_ring_flush (gboolean sync)
+{
+	g_autoptr(GPtrArray) rings = NULL;
+	g_autofree guint* heads = NULL;
+	GByteArray* definitions;
+	guint64 clock[2];
+
+	rings = g_ptr_array_new();
+
+	/*
+	 * The heads have to be read before taking the definitions.
+	 * Otherwise, events could be written before the definitions of their IDs.
+	 */
+	G_LOCK(j_trace_ring);
+
+	heads = g_new(guint, j_trace_ring_rings->len);
+
+	for (guint i = 0; i < j_trace_ring_rings->len; i++)
+	{
+		JTraceRing* ring = g_ptr_array_index(j_trace_ring_rings, i);
+
+		g_ptr_array_add(rings, ring);
+		heads[i] = g_atomic_int_get(&(ring->head));
+	}
+
+	definitions = j_trace_ring_definitions;
+	j_trace_ring_definitions = g_byte_array_new();
+
+	G_UNLOCK(j_trace_ring);
+
+	clock[0] = j_trace_ring_get_ticks();
+	clock[1] = g_get_real_time();
+
+	fwrite(definitions->data, definitions->len, 1, j_trace_ring_file);
+	g_byte_array_unref(definitions);
+
+	j_trace_ring_write_record(J_TRACE_RECORD_CLOCK, 0, clock, sizeof(clock));
+
+	for (guint i = 0; i < rings->len; i++)
+	{
+		JTraceRing* ring = g_ptr_array_index(rings, i);
+		guint dropped;
+		guint tail;
+
+		tail = ring->tail;
+
+		if (heads[i] != tail)
+		{
+			guint begin = tail & (j_trace_ring_size - 1);
+			guint count = heads[i] - tail;
+			guint first = MIN(count, j_trace_ring_size - begin);
+			JTraceRecord record;
+
+			record.type = J_TRACE_RECORD_EVENTS;
+			record.id = ring->thread_id;
+			record.size = (guint64)count * sizeof(JTraceEvent);
+
+			fwrite(&record, sizeof(record), 1, j_trace_ring_file);
+			fwrite(ring->events + begin, sizeof(JTraceEvent), first, j_trace_ring_file);
+			fwrite(ring->events, sizeof(JTraceEvent), count - first, j_trace_ring_file);
+
+			/* Hands the slots back to the thread. */
+			g_atomic_int_set(&(ring->tail), heads[i]);
+		}
+
+		if ((dropped = g_atomic_int_and(&(ring->dropped), 0)) > 0)
+		{
+			guint64 dropped64 = dropped;
+
+			j_trace_ring_write_record(J_TRACE_RECORD_DROPPED, ring->thread_id, &dropped64, sizeof(dropped64));
+		}
+
+		if (g_atomic_int_get(&(ring->finished)) && g_atomic_int_get(&(ring->head)) == heads[i])
+		{
+			G_LOCK(j_trace_ring);
+			g_ptr_array_remove_fast(j_trace_ring_rings, ring);
+			G_UNLOCK(j_trace_ring);
+
+			g_free(ring->events);
+			g_slice_free(JTraceRing, ring);
+		}
+	}
+
+	fflush(j_trace_ring_file);
+
+	if (sync)
+	{
+		fsync(fileno(j_trace_ring_file));
+	}
+}
+
+/**
+ * Flushes the rings periodically.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Unused.
+ *
+ * \return G_SOURCE_CONTINUE.
+ **/
+static
+gboolean
+j_trace_ring_timeout (gpointer data)
+{
+	(void)data;
+
+	j_trace_ring_flush(FALSE);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Flushes and syncs the rings when SIGUSR2 is received.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Unused.
+ *
+ * \return G_SOURCE_CONTINUE.
+ **/
+static
+gboolean
+j_trace_ring_signal (gpointer data)
+{
+	(void)data;
+
+	j_trace_ring_flush(TRUE);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Runs the flusher thread's main loop.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param data Unused.
+ *
+ * \return NULL.
+ **/
+static
+gpointer
+j_trace_ring_thread_func (gpointer data)
+{
+	(void)data;
+
+	g_main_context_push_thread_default(g_main_loop_get_context(j_trace_ring_loop));
+	g_main_loop_run(j_trace_ring_loop);
+	g_main_context_pop_thread_default(g_main_loop_get_context(j_trace_ring_loop));
+
+	return NULL;
+}
+
+/**
+ * Opens the trace file and starts the flusher thread.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param name A trace name.
+ **/
+static
+void
+j_trace_ring_init (gchar const* name)
+{
+	g_autofree gchar* path = NULL;
+	g_autoptr(GMainContext) context = NULL;
+	g_autoptr(GSource) timeout_source = NULL;
+	g_autoptr(GSource) signal_source = NULL;
+	gchar const* size;
+	guint64 clock[2];
+
+	if ((size = g_getenv("J_TRACE_RING_SIZE")) != NULL)
+	{
+		guint64 value;
+
+		value = g_ascii_strtoull(size, NULL, 10);
+		j_trace_ring_size = 1024;
+
+		while (j_trace_ring_size < value && j_trace_ring_size < (1U << 30))
+		{
+			j_trace_ring_size *= 2;
+		}
+	}
+
+	path = g_strdup_printf("%s.%d.jtrace", name, getpid());
+	j_trace_ring_file = fopen(path, "wb");
+	g_assert(j_trace_ring_file != NULL);
+
+	fwrite(J_TRACE_RING_MAGIC, strlen(J_TRACE_RING_MAGIC), 1, j_trace_ring_file);
+
+	clock[0] = j_trace_ring_get_ticks();
+	clock[1] = g_get_real_time();
+	j_trace_ring_write_record(J_TRACE_RECORD_CLOCK, 0, clock, sizeof(clock));
+
+	j_trace_ring_rings = g_ptr_array_new();
+	j_trace_ring_definitions = g_byte_array_new();
+
+	for (guint i = J_TRACE_RECORD_THREAD; i <= J_TRACE_RECORD_COUNTER; i++)
+	{
+		j_trace_ring_ids[i] = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	context = g_main_context_new();
+	j_trace_ring_loop = g_main_loop_new(context, FALSE);
+
+	timeout_source = g_timeout_source_new(100);
+	g_source_set_callback(timeout_source, j_trace_ring_timeout, NULL, NULL);
+	g_source_attach(timeout_source, context);
+
+	signal_source = g_unix_signal_source_new(SIGUSR2);
+	g_source_set_callback(signal_source, j_trace_ring_signal, NULL, NULL);
+	g_source_attach(signal_source, context);
+
+	j_trace_ring_thread = g_thread_new("JTraceRing", j_trace_ring_thread_func, NULL);
+}
+
+/**
+ * Stops the flusher thread, flushes the remaining events and closes the trace file.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ **/
+static
+void
+j_trace_ring_fini (void)
+{
+	g_main_loop_quit(j_trace_ring_loop);
+	g_thread_join(j_trace_ring_thread);
+	j_trace_ring_thread = NULL;
+
+	g_main_loop_unref(j_trace_ring_loop);
+	j_trace_ring_loop = NULL;
+
+	j_trace_ring_flush(TRUE);
+
+	for (guint i = 0; i < j_trace_ring_rings->len; i++)
+	{
+		JTraceRing* ring = g_ptr_array_index(j_trace_ring_rings, i);
+
+		g_free(ring->events);
+		g_slice_free(JTraceRing, ring);
+	}
+
+	g_ptr_array_unref(j_trace_ring_rings);
+	j_trace_ring_rings = NULL;
 
-static GPrivate j_trace_thread_default = G_PRIVATE_INIT(j_trace_thread_default_free);
+	g_byte_array_unref(j_trace_ring_definitions);
+	j_trace_ring_definitions = NULL;
 
-G_LOCK_DEFINE_STATIC(j_trace_echo);
+	for (guint i = J_TRACE_RECORD_THREAD; i <= J_TRACE_RECORD_COUNTER; i++)
+	{
+		g_hash_table_unref(j_trace_ring_ids[i]);
+		j_trace_ring_ids[i] = NULL;
+	}
+
+	fclose(j_trace_ring_file);
+	j_trace_ring_file = NULL;
+}
 
 /**
- * Prints a common header to stderr.
+ * Appends a string to a JSON document, escaping it as necessary.
  *
  * \private
  *
  * \author Michael Kuhn
  *
- * \code
- * \endcode
- *
- * \param trace     A trace.
- * \param timestamp A timestamp.
+ * \param json   A JSON document.
+ * \param string A string.
  **/
 static
 void
-j_trace_echo_printerr (JTrace* trace, guint64 timestamp)
+j_trace_chrome_append_string (GString* json, gchar const* string)
 {
-	guint i;
+	g_string_append_c(json, '"');
 
-	g_printerr("[%" G_GUINT64_FORMAT ".%06" G_GUINT64_FORMAT "] %s: ", timestamp / G_USEC_PER_SEC, timestamp % G_USEC_PER_SEC, trace->thread_name);
-
-	for (i = 0; i < trace->function_depth; i++)
+	for (gchar const* c = string; *c != '\0'; c++)
 	{
-		g_printerr("  ");
+		switch (*c)
+		{
+			case '"':
+				g_string_append(json, "\\\"");
+				break;
+			case '\\':
+				g_string_append(json, "\\\\");
+				break;
+			default:
+				if ((guchar)*c < 0x20)
+				{
+					g_string_append_printf(json, "\\u%04x", (guint)*c);
+				}
+				else
+				{
+					g_string_append_c(json, *c);
+				}
+				break;
+		}
 	}
+
+	g_string_append_c(json, '"');
 }
 
 /**
- * Returns the current time.
+ * Starts a Chrome trace event.
+ * The event has to be finished with j_trace_chrome_end().
  *
  * \private
  *
  * \author Michael Kuhn
  *
- * \code
- * guint64 timestamp;
- *
- * timestamp = j_trace_get_time();
- * \endcode
- *
- * \return A time stamp in microseconds.
+ * \param json      A JSON document.
+ * \param trace     A trace.
+ * \param phase     The event's phase.
+ * \param category  The event's category.
+ * \param name      The event's name.
+ * \param timestamp A timestamp.
  **/
 static
-guint64
-j_trace_get_time (void)
+void
+j_trace_chrome_begin (GString* json, JTrace* trace, gchar phase, gchar const* category, gchar const* name, guint64 timestamp)
 {
-	GTimeVal timeval;
-	guint64 timestamp;
-
-	g_get_current_time(&timeval);
-	timestamp = (timeval.tv_sec * G_USEC_PER_SEC) + timeval.tv_usec;
-
-	return timestamp;
+	g_string_append_printf(json, "{\"ph\":\"%c\",\"cat\":\"%s\",\"name\":", phase, category);
+	j_trace_chrome_append_string(json, name);
+	g_string_append_printf(json, ",\"ts\":%" G_GUINT64_FORMAT ",\"pid\":%d,\"tid\":%" G_GUINT32_FORMAT, timestamp, j_trace_chrome_pid, trace->chrome.thread_id);
 }
 
 /**
- * Returns the name of a file operation.
+ * Finishes a Chrome trace event and writes it to the trace file.
  *
  * \private
  *
  * \author Michael Kuhn
  *
- * \code
- * \endcode
- *
- * \param op A file operation.
- *
- * \return A name.
+ * \param json A JSON document.
  **/
 static
-gchar const*
-j_trace_file_operation_name (JTraceFileOperation op)
+void
+j_trace_chrome_end (GString* json)
 {
-	switch (op)
+	g_string_append_c(json, '}');
+
+	G_LOCK(j_trace_chrome);
+
+	if (!j_trace_chrome_first)
 	{
-		case J_TRACE_FILE_CLOSE:
-			return "close";
-		case J_TRACE_FILE_CREATE:
-			return "create";
-		case J_TRACE_FILE_DELETE:
-			return "delete";
-		case J_TRACE_FILE_OPEN:
-			return "open";
-		case J_TRACE_FILE_READ:
-			return "read";
-		case J_TRACE_FILE_SEEK:
-			return "seek";
-		case J_TRACE_FILE_STATUS:
-			return "status";
-		case J_TRACE_FILE_SYNC:
-			return "sync";
-		case J_TRACE_FILE_WRITE:
-			return "write";
-		default:
-			g_warn_if_reached();
-			return NULL;
+		fputs(",\n", j_trace_chrome_file);
 	}
+
+	fputs(json->str, j_trace_chrome_file);
+	j_trace_chrome_first = FALSE;
+
+	G_UNLOCK(j_trace_chrome);
 }
 
 /**
@@ -262,13 +919,48 @@ j_trace_function_check (gchar const* name)
 	return TRUE;
 }
 
+/**
+ * Checks whether a call site should be traced and caches the result.
+ * Should only be called by the j_trace_enter() and j_trace_leave() macros.
+ *
+ * \private
+ *
+ * \author Michael Kuhn
+ *
+ * \param site A call site's cached result.
+ * \param name A function name.
+ *
+ * \return The new cached result.
+ **/
+guint
+j_trace_site_resolve (guint* site, gchar const* name)
+{
+	guint value;
+
+	value = (j_trace_generation << 1) | ((j_trace_function_check(name)) ? 1 : 0);
+
+	/* Concurrent resolutions of the same site store the same value. */
+	g_atomic_int_set(site, value);
+
+	return value;
+}
+
 /**
  * Initializes the trace framework.
  * Tracing is disabled by default.
  * Set the \c J_TRACE environment variable to enable it.
- * Valid values are \e echo and \e otf.
+ * Valid values are \e echo, \e otf, \e ring and \e chrome.
  * Multiple values can be combined with commas.
  *
+ * The ring back-end records events into per-thread ring buffers without locking.
+ * A background thread writes them to the binary file \c name.pid.jtrace every 100 ms
+ * and immediately when the process receives \c SIGUSR2.
+ * Events are dropped if a ring is full; the \c J_TRACE_RING_SIZE environment variable sets the number of events per ring (defaults to 16384).
+ *
+ * The chrome back-end writes the events to \c name.pid.json in the Chrome trace format, which can be opened with Perfetto or \c chrome://tracing.
+ * Messages are recorded as flows from the client to the server and back,
+ * so traces of several processes can be merged (for example, using <tt>jq -s add *.json</tt>) to follow requests across them.
+ *
  * \author Michael Kuhn
  *
  * \code
@@ -309,6 +1001,14 @@ j_trace_init (gchar const* name)
 			{
 				j_trace_flags |= J_TRACE_OTF;
 			}
+			else if (g_strcmp0(p[i], "ring") == 0)
+			{
+				j_trace_flags |= J_TRACE_RING;
+			}
+			else if (g_strcmp0(p[i], "chrome") == 0 || g_strcmp0(p[i], "perfetto") == 0)
+			{
+				j_trace_flags |= J_TRACE_CHROME;
+			}
 		}
 	}
 
@@ -354,8 +1054,36 @@ j_trace_init (gchar const* name)
 	}
 #endif
 
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_init(name);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autofree gchar* path = NULL;
+		g_autoptr(GString) json = NULL;
+
+		j_trace_chrome_pid = getpid();
+		path = g_strdup_printf("%s.%d.json", name, j_trace_chrome_pid);
+		j_trace_chrome_file = fopen(path, "w");
+		g_assert(j_trace_chrome_file != NULL);
+
+		fputs("[\n", j_trace_chrome_file);
+
+		json = g_string_new(NULL);
+		g_string_append_printf(json, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":", j_trace_chrome_pid);
+		j_trace_chrome_append_string(json, name);
+		g_string_append_c(json, '}');
+		j_trace_chrome_end(json);
+	}
+
 	g_free(j_trace_name);
 	j_trace_name = g_strdup(name);
+
+	/* Invalidates the filter results cached by the call sites. */
+	j_trace_generation++;
+	j_trace_enabled = TRUE;
 }
 
 /**
@@ -395,6 +1123,22 @@ j_trace_fini (void)
 	}
 #endif
 
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_fini();
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		G_LOCK(j_trace_chrome);
+		fputs("\n]\n", j_trace_chrome_file);
+		fclose(j_trace_chrome_file);
+		j_trace_chrome_file = NULL;
+		j_trace_chrome_first = TRUE;
+		G_UNLOCK(j_trace_chrome);
+	}
+
+	j_trace_enabled = FALSE;
 	j_trace_flags = J_TRACE_OFF;
 
 	if (j_trace_function_patterns != NULL)
@@ -483,6 +1227,51 @@ j_trace_new (GThread* thread)
 	}
 #endif
 
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+
+		trace->chrome.thread_id = g_atomic_int_add(&j_trace_chrome_thread_id, 1);
+
+		json = g_string_new(NULL);
+		g_string_append_printf(json, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%" G_GUINT32_FORMAT ",\"args\":{\"name\":", j_trace_chrome_pid, trace->chrome.thread_id);
+		j_trace_chrome_append_string(json, trace->thread_name);
+		g_string_append_c(json, '}');
+		j_trace_chrome_end(json);
+	}
+
+	trace->ring.ring = NULL;
+
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		JTraceRing* ring;
+
+		ring = g_slice_new(JTraceRing);
+		ring->events = g_new(JTraceEvent, j_trace_ring_size);
+		ring->head = 0;
+		ring->tail = 0;
+		ring->dropped = 0;
+		ring->finished = 0;
+
+		for (guint i = 0; i < G_N_ELEMENTS(trace->ring.ids); i++)
+		{
+			trace->ring.ids[i] = NULL;
+		}
+
+		for (guint i = J_TRACE_RECORD_THREAD; i <= J_TRACE_RECORD_COUNTER; i++)
+		{
+			trace->ring.ids[i] = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		}
+
+		G_LOCK(j_trace_ring);
+		ring->thread_id = j_trace_ring_id++;
+		j_trace_ring_append_record(j_trace_ring_definitions, J_TRACE_RECORD_THREAD, ring->thread_id, trace->thread_name, strlen(trace->thread_name));
+		g_ptr_array_add(j_trace_ring_rings, ring);
+		G_UNLOCK(j_trace_ring);
+
+		trace->ring.ring = ring;
+	}
+
 	trace->ref_count = 1;
 
 	return trace;
@@ -548,6 +1337,17 @@ j_trace_unref (JTrace* trace)
 		}
 #endif
 
+		if (trace->ring.ring != NULL)
+		{
+			/* The flusher thread frees the ring after writing its remaining events. */
+			g_atomic_int_set(&(trace->ring.ring->finished), 1);
+
+			for (guint i = J_TRACE_RECORD_THREAD; i <= J_TRACE_RECORD_COUNTER; i++)
+			{
+				g_hash_table_unref(trace->ring.ids[i]);
+			}
+		}
+
 		g_free(trace->thread_name);
 
 		g_slice_free(JTrace, trace);
@@ -556,6 +1356,7 @@ j_trace_unref (JTrace* trace)
 
 /**
  * Traces the entering of a function.
+ * Should be called using the j_trace_enter() macro, which skips the call if tracing is disabled or the function is filtered.
  *
  * \author Michael Kuhn
  *
@@ -565,10 +1366,10 @@ j_trace_unref (JTrace* trace)
  * \param name  A function name.
  **/
 void
-j_trace_enter (gchar const* name, gchar const* format, ...)
+j_trace_enter_real (gchar const* name, gchar const* format, ...)
 {
 	JTrace* trace;
-	guint64 timestamp;
+	guint64 timestamp = 0;
 	va_list args;
 
 	if (j_trace_flags == J_TRACE_OFF)
@@ -580,14 +1381,12 @@ j_trace_enter (gchar const* name, gchar const* format, ...)
 
 	trace = j_trace_get_thread_default();
 
-	if (!j_trace_function_check(name))
+	/* The ring back-end uses its own, cheaper timestamps. */
+	if (j_trace_flags & (J_TRACE_ECHO | J_TRACE_OTF | J_TRACE_CHROME))
 	{
-		/* FIXME also blacklist nested functions */
-		return;
+		timestamp = j_trace_get_time();
 	}
 
-	timestamp = j_trace_get_time();
-
 	va_start(args, format);
 
 	if (j_trace_flags & J_TRACE_ECHO)
@@ -598,8 +1397,12 @@ j_trace_enter (gchar const* name, gchar const* format, ...)
 		if (format != NULL)
 		{
 			g_autofree gchar* arguments = NULL;
+			va_list args_copy;
+
+			G_VA_COPY(args_copy, args);
+			arguments = g_strdup_vprintf(format, args_copy);
+			va_end(args_copy);
 
-			arguments = g_strdup_vprintf(format, args);
 			g_printerr("ENTER %s (%s)\n", name, arguments);
 		}
 		else
@@ -636,6 +1439,35 @@ j_trace_enter (gchar const* name, gchar const* format, ...)
 	}
 #endif
 
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_record(trace, J_TRACE_EVENT_ENTER, j_trace_ring_intern(trace, J_TRACE_RECORD_FUNCTION, name), 0, 0, 0);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+
+		json = g_string_new(NULL);
+		j_trace_chrome_begin(json, trace, 'B', "function", name, timestamp);
+
+		if (format != NULL)
+		{
+			g_autofree gchar* arguments = NULL;
+			va_list args_copy;
+
+			G_VA_COPY(args_copy, args);
+			arguments = g_strdup_vprintf(format, args_copy);
+			va_end(args_copy);
+
+			g_string_append(json, ",\"args\":{\"arguments\":");
+			j_trace_chrome_append_string(json, arguments);
+			g_string_append_c(json, '}');
+		}
+
+		j_trace_chrome_end(json);
+	}
+
 	va_end(args);
 
 	trace->function_depth++;
@@ -643,6 +1475,7 @@ j_trace_enter (gchar const* name, gchar const* format, ...)
 
 /**
  * Traces the leaving of a function.
+ * Should be called using the j_trace_leave() macro, which skips the call if tracing is disabled or the function is filtered.
  *
  * \author Michael Kuhn
  *
@@ -652,10 +1485,10 @@ j_trace_enter (gchar const* name, gchar const* format, ...)
  * \param name  A function name.
  **/
 void
-j_trace_leave (gchar const* name)
+j_trace_leave_real (gchar const* name)
 {
 	JTrace* trace;
-	guint64 timestamp;
+	guint64 timestamp = 0;
 
 	if (j_trace_flags == J_TRACE_OFF)
 	{
@@ -666,11 +1499,6 @@ j_trace_leave (gchar const* name)
 
 	trace = j_trace_get_thread_default();
 
-	if (!j_trace_function_check(name))
-	{
-		return;
-	}
-
 	/* FIXME */
 	if (trace->function_depth == 0)
 	{
@@ -678,7 +1506,12 @@ j_trace_leave (gchar const* name)
 	}
 
 	trace->function_depth--;
-	timestamp = j_trace_get_time();
+
+	/* The ring back-end uses its own, cheaper timestamps. */
+	if (j_trace_flags & (J_TRACE_ECHO | J_TRACE_OTF | J_TRACE_CHROME))
+	{
+		timestamp = j_trace_get_time();
+	}
 
 	if (j_trace_flags & J_TRACE_ECHO)
 	{
@@ -705,10 +1538,25 @@ j_trace_leave (gchar const* name)
 		OTF_Writer_writeLeave(otf_writer, timestamp, function_id, trace->otf.process_id, 0);
 	}
 #endif
+
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_record(trace, J_TRACE_EVENT_LEAVE, j_trace_ring_intern(trace, J_TRACE_RECORD_FUNCTION, name), 0, 0, 0);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+
+		json = g_string_new(NULL);
+		j_trace_chrome_begin(json, trace, 'E', "function", name, timestamp);
+		j_trace_chrome_end(json);
+	}
 }
 
 /**
  * Traces the beginning of a file operation.
+ * Should be called using the j_trace_file_begin() macro, which skips the call if tracing is disabled.
  *
  * \author Michael Kuhn
  *
@@ -720,10 +1568,10 @@ j_trace_leave (gchar const* name)
  * \param op    A file operation.
  **/
 void
-j_trace_file_begin (gchar const* path, JTraceFileOperation op)
+j_trace_file_begin_real (gchar const* path, JTraceFileOperation op)
 {
 	JTrace* trace;
-	guint64 timestamp;
+	guint64 timestamp = 0;
 
 	g_return_if_fail(path != NULL);
 
@@ -733,7 +1581,11 @@ j_trace_file_begin (gchar const* path, JTraceFileOperation op)
 	}
 
 	trace = j_trace_get_thread_default();
-	timestamp = j_trace_get_time();
+	/* The ring back-end uses its own, cheaper timestamps. */
+	if (j_trace_flags & (J_TRACE_ECHO | J_TRACE_OTF | J_TRACE_CHROME))
+	{
+		timestamp = j_trace_get_time();
+	}
 
 	if (j_trace_flags & J_TRACE_ECHO)
 	{
@@ -769,11 +1621,29 @@ j_trace_file_begin (gchar const* path, JTraceFileOperation op)
 	}
 #endif
 
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_record(trace, J_TRACE_EVENT_FILE_BEGIN, j_trace_ring_intern(trace, J_TRACE_RECORD_FILE, path), op, 0, 0);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+
+		json = g_string_new(NULL);
+		j_trace_chrome_begin(json, trace, 'B', "file", j_trace_file_operation_name(op), timestamp);
+		g_string_append(json, ",\"args\":{\"path\":");
+		j_trace_chrome_append_string(json, path);
+		g_string_append_c(json, '}');
+		j_trace_chrome_end(json);
+	}
+
 	return;
 }
 
 /**
  * Traces the ending of a file operation.
+ * Should be called using the j_trace_file_end() macro, which skips the call if tracing is disabled.
  *
  * \author Michael Kuhn
  *
@@ -787,10 +1657,10 @@ j_trace_file_begin (gchar const* path, JTraceFileOperation op)
  * \param offset An offset.
  **/
 void
-j_trace_file_end (gchar const* path, JTraceFileOperation op, guint64 length, guint64 offset)
+j_trace_file_end_real (gchar const* path, JTraceFileOperation op, guint64 length, guint64 offset)
 {
 	JTrace* trace;
-	guint64 timestamp;
+	guint64 timestamp = 0;
 
 	if (j_trace_flags == J_TRACE_OFF)
 	{
@@ -798,7 +1668,11 @@ j_trace_file_end (gchar const* path, JTraceFileOperation op, guint64 length, gui
 	}
 
 	trace = j_trace_get_thread_default();
-	timestamp = j_trace_get_time();
+	/* The ring back-end uses its own, cheaper timestamps. */
+	if (j_trace_flags & (J_TRACE_ECHO | J_TRACE_OTF | J_TRACE_CHROME))
+	{
+		timestamp = j_trace_get_time();
+	}
 
 	if (j_trace_flags & J_TRACE_ECHO)
 	{
@@ -868,10 +1742,31 @@ j_trace_file_end (gchar const* path, JTraceFileOperation op, guint64 length, gui
 		OTF_Writer_writeEndFileOperation(otf_writer, timestamp, trace->otf.process_id, file_id, 1, 0, otf_op, length, 0);
 	}
 #endif
+
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_record(trace, J_TRACE_EVENT_FILE_END, j_trace_ring_intern(trace, J_TRACE_RECORD_FILE, path), op, length, offset);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+
+		json = g_string_new(NULL);
+		j_trace_chrome_begin(json, trace, 'E', "file", j_trace_file_operation_name(op), timestamp);
+
+		if (op == J_TRACE_FILE_READ || op == J_TRACE_FILE_WRITE)
+		{
+			g_string_append_printf(json, ",\"args\":{\"length\":%" G_GUINT64_FORMAT ",\"offset\":%" G_GUINT64_FORMAT "}", length, offset);
+		}
+
+		j_trace_chrome_end(json);
+	}
 }
 
 /**
  * Traces a counter.
+ * Should be called using the j_trace_counter() macro, which skips the call if tracing is disabled.
  *
  * \author Michael Kuhn
  *
@@ -883,10 +1778,10 @@ j_trace_file_end (gchar const* path, JTraceFileOperation op, guint64 length, gui
  * \param counter_value A counter value.
  **/
 void
-j_trace_counter (gchar const* name, guint64 counter_value)
+j_trace_counter_real (gchar const* name, guint64 counter_value)
 {
 	JTrace* trace;
-	guint64 timestamp;
+	guint64 timestamp = 0;
 
 	if (j_trace_flags == J_TRACE_OFF)
 	{
@@ -896,7 +1791,11 @@ j_trace_counter (gchar const* name, guint64 counter_value)
 	g_return_if_fail(name != NULL);
 
 	trace = j_trace_get_thread_default();
-	timestamp = j_trace_get_time();
+	/* The ring back-end uses its own, cheaper timestamps. */
+	if (j_trace_flags & (J_TRACE_ECHO | J_TRACE_OTF | J_TRACE_CHROME))
+	{
+		timestamp = j_trace_get_time();
+	}
 
 	if (j_trace_flags & J_TRACE_ECHO)
 	{
@@ -931,6 +1830,82 @@ j_trace_counter (gchar const* name, guint64 counter_value)
 		OTF_Writer_writeCounter(otf_writer, timestamp, trace->otf.process_id, counter_id, counter_value);
 	}
 #endif
+
+	if (j_trace_flags & J_TRACE_RING)
+	{
+		j_trace_ring_record(trace, J_TRACE_EVENT_COUNTER, j_trace_ring_intern(trace, J_TRACE_RECORD_COUNTER, name), 0, counter_value, 0);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+
+		json = g_string_new(NULL);
+		j_trace_chrome_begin(json, trace, 'C', "counter", name, timestamp);
+		g_string_append_printf(json, ",\"args\":{\"value\":%" G_GUINT64_FORMAT "}", counter_value);
+		j_trace_chrome_end(json);
+	}
+}
+
+/**
+ * Traces a step of a flow.
+ * Should be called using the j_trace_flow() macro, which skips the call if tracing is disabled.
+ * Flows connect events that belong together, for example, a message being sent by a client and handled by a server.
+ * Steps are attached to the function that is currently being traced.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * j_trace_flow("message", id, J_TRACE_FLOW_BEGIN);
+ * \endcode
+ *
+ * \param name  A flow name.
+ * \param id    An ID identifying the flow, which has to be the same for all of its steps.
+ * \param phase The step's phase.
+ **/
+void
+j_trace_flow_real (gchar const* name, guint64 id, JTraceFlow phase)
+{
+	JTrace* trace;
+	guint64 timestamp;
+
+	if (!(j_trace_flags & (J_TRACE_ECHO | J_TRACE_CHROME)))
+	{
+		return;
+	}
+
+	g_return_if_fail(name != NULL);
+
+	trace = j_trace_get_thread_default();
+	timestamp = j_trace_get_time();
+
+	if (j_trace_flags & J_TRACE_ECHO)
+	{
+		gchar const* phase_name[] = { "BEGIN", "STEP", "END" };
+
+		G_LOCK(j_trace_echo);
+		j_trace_echo_printerr(trace, timestamp);
+		g_printerr("FLOW %s %s %" G_GUINT64_FORMAT "\n", phase_name[phase], name, id);
+		G_UNLOCK(j_trace_echo);
+	}
+
+	if (j_trace_flags & J_TRACE_CHROME)
+	{
+		g_autoptr(GString) json = NULL;
+		gchar phase_type[] = { 's', 't', 'f' };
+
+		json = g_string_new(NULL);
+		j_trace_chrome_begin(json, trace, phase_type[phase], "flow", name, timestamp);
+		g_string_append_printf(json, ",\"id\":%" G_GUINT64_FORMAT, id);
+
+		if (phase != J_TRACE_FLOW_BEGIN)
+		{
+			/* Binds the step to the enclosing slice instead of the next one. */
+			g_string_append(json, ",\"bp\":\"e\"");
+		}
+
+		j_trace_chrome_end(json);
+	}
 }
 
 /**
@@ -0,0 +1,1530 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#include <julea-config.h>
+
+#ifdef HAVE_MEMFD_CREATE
+/* Required for memfd_create() */
+#define _GNU_SOURCE
+#endif
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixconnection.h>
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBFABRIC
+#include <rdma/fabric.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
+#include <rdma/fi_rma.h>
+#endif
+
+#include <jtransport.h>
+
+#include <jtrace-internal.h>
+
+#include <julea-internal.h>
+
+/**
+ * \defgroup JTransport Transport
+ *
+ * Transfers of object payloads between clients and servers.
+ *
+ * Payloads are either streamed over the connection itself or, if the client has registered its buffers, copied directly from or to them using RDMA.
+ * RDMA transfers are always initiated by the server, so clients only have to register their buffers and send the resulting remote regions.
+ *
+ * Clients on the same node as the server can instead allocate their regions from shared memory, which they pass to the server over its UNIX domain socket.
+ * The messages on the socket still carry all control information and signal when the payloads are in place.
+ *
+ * @{
+ **/
+
+/**
+ * The key used to store the peer's fabric address in a connection.
+ **/
+#define J_TRANSPORT_ADDRESS_KEY "julea-transport-address"
+
+/**
+ * The key used to store the shared memory a connection's peer has passed.
+ **/
+#define J_TRANSPORT_SHM_KEY "julea-transport-shm"
+
+/**
+ * The alignment of regions in shared memory, a cache line.
+ **/
+#define J_TRANSPORT_SHM_ALIGNMENT 64
+
+/**
+ * A way of transferring payloads.
+ **/
+struct JTransport
+{
+	gboolean (*receive) (GSocketConnection*, JTransportRemote const*, gpointer, guint64);
+	gboolean (*send) (GSocketConnection*, JTransportRemote const*, gconstpointer, guint64);
+};
+
+typedef struct JTransport JTransport;
+
+/**
+ * Shared memory for transferring payloads between processes on the same node.
+ * Clients allocate their regions from it like from a ring buffer.
+ **/
+struct JTransportShm
+{
+	/**
+	 * The memory file, only kept open by clients, which pass it to servers.
+	 **/
+	gint fd;
+
+	gchar* data;
+	guint64 size;
+
+	/**
+	 * The offset of the oldest region.
+	 **/
+	guint64 tail;
+
+	/**
+	 * The offset of the next region.
+	 **/
+	guint64 head;
+
+	/**
+	 * The allocated regions, oldest first.
+	 * Regions can be freed in any order, but their space is only reused once all older regions have been freed.
+	 **/
+	GQueue regions;
+
+	GMutex mutex;
+};
+
+/**
+ * A registered memory region.
+ **/
+struct JTransportRegion
+{
+#ifdef HAVE_LIBFABRIC
+	struct fid_mr* mr;
+#endif
+
+	gpointer data;
+	guint64 length;
+
+	/**
+	 * The shared memory the region has been allocated from, NULL for registered buffers.
+	 **/
+	JTransportShm* shm;
+
+	/**
+	 * The region's offset within #shm.
+	 **/
+	guint64 offset;
+
+	/**
+	 * Whether a region allocated from #shm has been freed.
+	 **/
+	gboolean released;
+
+	/**
+	 * The number of transfers using a local registration.
+	 **/
+	guint users;
+
+	/**
+	 * Whether a local registration is kept by the fabric.
+	 **/
+	gboolean cached;
+};
+
+#ifdef HAVE_LIBFABRIC
+
+/**
+ * The process' fabric resources, shared by all connections.
+ **/
+struct JTransportFabric
+{
+	struct fi_info* info;
+	struct fid_fabric* fabric;
+	struct fid_domain* domain;
+	struct fid_cq* cq;
+	struct fid_av* av;
+	struct fid_ep* ep;
+
+	/**
+	 * The endpoint's address, as returned by fi_getname().
+	 **/
+	guchar* address;
+	gsize address_len;
+
+	/**
+	 * Local buffers that have already been registered, indexed by their addresses.
+	 **/
+	GHashTable* registrations;
+
+	/**
+	 * Serializes accesses to the endpoint, the completion queue and the domain's other objects.
+	 * It is only held while posting operations and polling for completions, not while waiting for them.
+	 **/
+	GMutex mutex;
+};
+
+typedef struct JTransportFabric JTransportFabric;
+
+/**
+ * A transfer that might consist of several operations.
+ **/
+struct JTransportRequest
+{
+	/**
+	 * The number of operations that have not completed yet.
+	 **/
+	guint pending;
+
+	gboolean failed;
+};
+
+typedef struct JTransportRequest JTransportRequest;
+
+/**
+ * A single posted operation.
+ **/
+struct JTransportOperation
+{
+	/**
+	 * Has to be the first member, because the provider returns a pointer to it on completion (FI_CONTEXT).
+	 **/
+	struct fi_context context;
+
+	JTransportRequest* request;
+};
+
+typedef struct JTransportOperation JTransportOperation;
+
+/**
+ * The maximum number of local buffers whose registrations are kept.
+ * Further buffers are registered for each transfer.
+ **/
+#define J_TRANSPORT_REGISTRATIONS_MAX 256
+
+static JTransportFabric* j_transport_fabric = NULL;
+
+#endif
+
+static GMutex j_transport_mutex;
+static gboolean j_transport_initialized = FALSE;
+
+static
+gboolean
+j_transport_tcp_receive (GSocketConnection* connection, JTransportRemote const* remote, gpointer data, guint64 length)
+{
+	GInputStream* input;
+	gsize bytes_read = 0;
+
+	(void)remote;
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	return (g_input_stream_read_all(input, data, length, &bytes_read, NULL, NULL) && bytes_read == length);
+}
+
+static
+gboolean
+j_transport_tcp_send (GSocketConnection* connection, JTransportRemote const* remote, gconstpointer data, guint64 length)
+{
+	GOutputStream* output;
+
+	(void)remote;
+
+	output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+
+	return g_output_stream_write_all(output, data, length, NULL, NULL, NULL);
+}
+
+static
+JTransportShm*
+j_transport_shm_new_internal (gint fd, gpointer data, guint64 size)
+{
+	JTransportShm* shm;
+
+	shm = g_slice_new(JTransportShm);
+	shm->fd = fd;
+	shm->data = data;
+	shm->size = size;
+	shm->tail = 0;
+	shm->head = 0;
+	g_queue_init(&(shm->regions));
+	g_mutex_init(&(shm->mutex));
+
+	return shm;
+}
+
+static
+void
+j_transport_shm_free_func (gpointer data)
+{
+	j_transport_shm_free(data);
+}
+
+/**
+ * Returns the shared memory a connection's peer has passed, NULL if there is none.
+ **/
+static
+JTransportShm*
+j_transport_shm_get (GSocketConnection* connection)
+{
+	return g_object_get_data(G_OBJECT(connection), J_TRANSPORT_SHM_KEY);
+}
+
+/**
+ * Allocates space for a region, the caller has to hold the shared memory's mutex.
+ *
+ * \return TRUE if enough contiguous space is available, FALSE otherwise.
+ **/
+static
+gboolean
+j_transport_shm_allocate (JTransportShm* shm, guint64 length, guint64* offset)
+{
+	length = (length + J_TRANSPORT_SHM_ALIGNMENT - 1) / J_TRANSPORT_SHM_ALIGNMENT * J_TRANSPORT_SHM_ALIGNMENT;
+
+	if (g_queue_is_empty(&(shm->regions)))
+	{
+		shm->tail = 0;
+		shm->head = 0;
+	}
+	else if (shm->head == shm->tail)
+	{
+		/* Completely used. */
+		return FALSE;
+	}
+
+	if (shm->head >= shm->tail)
+	{
+		if (length <= shm->size - shm->head)
+		{
+			*offset = shm->head;
+		}
+		/* Wrap around, the rest of the end stays unused until the older regions have been freed. */
+		else if (length <= shm->tail)
+		{
+			*offset = 0;
+		}
+		else
+		{
+			return FALSE;
+		}
+	}
+	else if (length <= shm->tail - shm->head)
+	{
+		*offset = shm->head;
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	shm->head = *offset + length;
+
+	return TRUE;
+}
+
+/**
+ * Frees a region allocated from shared memory, and all older ones that have already been freed.
+ **/
+static
+void
+j_transport_shm_release (JTransportShm* shm, JTransportRegion* region)
+{
+	JTransportRegion* oldest;
+
+	g_mutex_lock(&(shm->mutex));
+
+	region->released = TRUE;
+
+	while ((oldest = g_queue_peek_head(&(shm->regions))) != NULL && oldest->released)
+	{
+		g_queue_pop_head(&(shm->regions));
+		g_slice_free(JTransportRegion, oldest);
+	}
+
+	if (oldest != NULL)
+	{
+		shm->tail = oldest->offset;
+	}
+
+	g_mutex_unlock(&(shm->mutex));
+}
+
+static
+gboolean
+j_transport_shm_receive (GSocketConnection* connection, JTransportRemote const* remote, gpointer data, guint64 length)
+{
+	JTransportShm* shm;
+
+	shm = j_transport_shm_get(connection);
+
+	/* The offset and length have been sent by the peer. */
+	if (remote->address > shm->size || length > shm->size - remote->address)
+	{
+		return FALSE;
+	}
+
+	memcpy(data, shm->data + remote->address, length);
+
+	return TRUE;
+}
+
+static
+gboolean
+j_transport_shm_send (GSocketConnection* connection, JTransportRemote const* remote, gconstpointer data, guint64 length)
+{
+	JTransportShm* shm;
+
+	shm = j_transport_shm_get(connection);
+
+	/* The offset and length have been sent by the peer. */
+	if (remote->address > shm->size || length > shm->size - remote->address)
+	{
+		return FALSE;
+	}
+
+	memcpy(shm->data + remote->address, data, length);
+
+	return TRUE;
+}
+
+#ifdef HAVE_LIBFABRIC
+
+static
+void
+j_transport_region_free_internal (gpointer data)
+{
+	JTransportRegion* region = data;
+
+	fi_close(&(region->mr->fid));
+
+	g_slice_free(JTransportRegion, region);
+}
+
+static
+void
+j_transport_fabric_free (JTransportFabric* fabric)
+{
+	if (fabric->registrations != NULL)
+	{
+		g_hash_table_unref(fabric->registrations);
+	}
+
+	if (fabric->ep != NULL)
+	{
+		fi_close(&(fabric->ep->fid));
+	}
+
+	if (fabric->av != NULL)
+	{
+		fi_close(&(fabric->av->fid));
+	}
+
+	if (fabric->cq != NULL)
+	{
+		fi_close(&(fabric->cq->fid));
+	}
+
+	if (fabric->domain != NULL)
+	{
+		fi_close(&(fabric->domain->fid));
+	}
+
+	if (fabric->fabric != NULL)
+	{
+		fi_close(&(fabric->fabric->fid));
+	}
+
+	if (fabric->info != NULL)
+	{
+		fi_freeinfo(fabric->info);
+	}
+
+	g_free(fabric->address);
+	g_mutex_clear(&(fabric->mutex));
+
+	g_slice_free(JTransportFabric, fabric);
+}
+
+/**
+ * Opens a reliable unconnected endpoint that supports remote reads and writes.
+ *
+ * \return The fabric resources or NULL if no suitable provider is available.
+ **/
+static
+JTransportFabric*
+j_transport_fabric_new (void)
+{
+	JTransportFabric* fabric;
+	struct fi_info* hints;
+	struct fi_cq_attr cq_attr = { 0 };
+	struct fi_av_attr av_attr = { 0 };
+	gint ret;
+
+	fabric = g_slice_new0(JTransportFabric);
+	g_mutex_init(&(fabric->mutex));
+
+	hints = fi_allocinfo();
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_RMA | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE;
+	hints->mode = FI_CONTEXT;
+	/* Completions must imply that the data has been placed, because the peer is notified via its connection afterwards. */
+	hints->tx_attr->op_flags = FI_DELIVERY_COMPLETE;
+	hints->domain_attr->mr_mode = FI_MR_VIRT_ADDR | FI_MR_ALLOCATED | FI_MR_PROV_KEY | FI_MR_LOCAL;
+	/* Accesses are serialized using the fabric's mutex. */
+	hints->domain_attr->threading = FI_THREAD_DOMAIN;
+	hints->domain_attr->data_progress = FI_PROGRESS_AUTO;
+
+	ret = fi_getinfo(FI_VERSION(1, 5), NULL, NULL, 0, hints, &(fabric->info));
+	fi_freeinfo(hints);
+
+	if (ret != 0)
+	{
+		goto error;
+	}
+
+	if ((ret = fi_fabric(fabric->info->fabric_attr, &(fabric->fabric), NULL)) != 0)
+	{
+		goto error;
+	}
+
+	if ((ret = fi_domain(fabric->fabric, fabric->info, &(fabric->domain), NULL)) != 0)
+	{
+		goto error;
+	}
+
+	cq_attr.format = FI_CQ_FORMAT_CONTEXT;
+	cq_attr.wait_obj = FI_WAIT_UNSPEC;
+
+	if ((ret = fi_cq_open(fabric->domain, &cq_attr, &(fabric->cq), NULL)) != 0)
+	{
+		goto error;
+	}
+
+	av_attr.type = FI_AV_MAP;
+
+	if ((ret = fi_av_open(fabric->domain, &av_attr, &(fabric->av), NULL)) != 0)
+	{
+		goto error;
+	}
+
+	if ((ret = fi_endpoint(fabric->domain, fabric->info, &(fabric->ep), NULL)) != 0)
+	{
+		goto error;
+	}
+
+	if ((ret = fi_ep_bind(fabric->ep, &(fabric->cq->fid), FI_TRANSMIT | FI_RECV)) != 0)
+	{
+		goto error;
+	}
+
+	if ((ret = fi_ep_bind(fabric->ep, &(fabric->av->fid), 0)) != 0)
+	{
+		goto error;
+	}
+
+	if ((ret = fi_enable(fabric->ep)) != 0)
+	{
+		goto error;
+	}
+
+	/* The first call only determines the address' length. */
+	fi_getname(&(fabric->ep->fid), NULL, &(fabric->address_len));
+	fabric->address = g_malloc(fabric->address_len);
+
+	if ((ret = fi_getname(&(fabric->ep->fid), fabric->address, &(fabric->address_len))) != 0)
+	{
+		goto error;
+	}
+
+	fabric->registrations = g_hash_table_new_full(NULL, NULL, NULL, j_transport_region_free_internal);
+
+	return fabric;
+
+error:
+	J_CRITICAL("%s", fi_strerror(-ret));
+	j_transport_fabric_free(fabric);
+
+	return NULL;
+}
+
+/**
+ * Reads the available completions and updates the corresponding requests.
+ * Has to be called with the fabric's mutex held.
+ **/
+static
+void
+j_transport_fabric_progress (JTransportFabric* fabric)
+{
+	struct fi_cq_entry entries[16];
+	gssize ret;
+
+	ret = fi_cq_read(fabric->cq, entries, G_N_ELEMENTS(entries));
+
+	if (ret > 0)
+	{
+		for (gssize i = 0; i < ret; i++)
+		{
+			JTransportOperation* operation = entries[i].op_context;
+
+			operation->request->pending--;
+		}
+	}
+	else if (ret == -FI_EAVAIL)
+	{
+		struct fi_cq_err_entry error = { 0 };
+
+		if (fi_cq_readerr(fabric->cq, &error, 0) == 1)
+		{
+			JTransportOperation* operation = error.op_context;
+
+			J_CRITICAL("%s", fi_cq_strerror(fabric->cq, error.prov_errno, error.err_data, NULL, 0));
+
+			operation->request->failed = TRUE;
+			operation->request->pending--;
+		}
+	}
+}
+
+/**
+ * Waits for all operations of a request to complete.
+ * The fabric's mutex is only held while polling, so other transfers can make progress in the meantime.
+ **/
+static
+gboolean
+j_transport_fabric_wait (JTransportFabric* fabric, JTransportRequest* request)
+{
+	gboolean ret;
+
+	g_mutex_lock(&(fabric->mutex));
+
+	while (request->pending > 0)
+	{
+		j_transport_fabric_progress(fabric);
+
+		if (request->pending > 0)
+		{
+			g_mutex_unlock(&(fabric->mutex));
+			g_thread_yield();
+			g_mutex_lock(&(fabric->mutex));
+		}
+	}
+
+	ret = !request->failed;
+
+	g_mutex_unlock(&(fabric->mutex));
+
+	return ret;
+}
+
+/**
+ * Returns the registration of a local buffer, registering it if necessary.
+ * Registrations are kept until the fabric is shut down, which is why only long-lived buffers should be used for transfers.
+ * Has to be called with the fabric's mutex held.
+ **/
+static
+JTransportRegion*
+j_transport_fabric_register (JTransportFabric* fabric, gpointer data, guint64 length)
+{
+	JTransportRegion* region;
+	JTransportRegion* old_region;
+	struct fid_mr* mr = NULL;
+
+	old_region = g_hash_table_lookup(fabric->registrations, data);
+
+	if (old_region != NULL && old_region->length >= length)
+	{
+		old_region->users++;
+		return old_region;
+	}
+
+	if (fi_mr_reg(fabric->domain, data, length, FI_READ | FI_WRITE, 0, 0, 0, &mr, NULL) != 0)
+	{
+		return NULL;
+	}
+
+	region = g_slice_new(JTransportRegion);
+	region->mr = mr;
+	region->data = data;
+	region->length = length;
+	region->shm = NULL;
+	region->users = 1;
+	region->cached = FALSE;
+
+	if (old_region != NULL)
+	{
+		/* The smaller registration might still be in use, so it is only freed by its last user. */
+		g_hash_table_steal(fabric->registrations, data);
+		old_region->cached = FALSE;
+
+		if (old_region->users == 0)
+		{
+			j_transport_region_free_internal(old_region);
+		}
+	}
+
+	if (old_region != NULL || g_hash_table_size(fabric->registrations) < J_TRANSPORT_REGISTRATIONS_MAX)
+	{
+		region->cached = TRUE;
+		g_hash_table_insert(fabric->registrations, data, region);
+	}
+
+	return region;
+}
+
+/**
+ * Releases a registration returned by j_transport_fabric_register().
+ * Has to be called with the fabric's mutex held.
+ **/
+static
+void
+j_transport_fabric_unregister (JTransportRegion* region)
+{
+	region->users--;
+
+	if (!region->cached && region->users == 0)
+	{
+		j_transport_region_free_internal(region);
+	}
+}
+
+/**
+ * Reads from or writes to the peer's memory, split into pieces the provider can handle.
+ * All pieces are posted before waiting for their completion.
+ **/
+static
+gboolean
+j_transport_rdma_transfer (GSocketConnection* connection, JTransportRemote const* remote, gpointer data, guint64 length, gboolean write)
+{
+	JTransportFabric* fabric = j_transport_fabric;
+	JTransportRequest request = { 0, FALSE };
+	g_autofree JTransportOperation* operations = NULL;
+	JTransportRegion* region;
+	fi_addr_t const* peer;
+	guint64 max_piece;
+	guint64 done = 0;
+	guint n_operations;
+	gboolean ret;
+
+	peer = g_object_get_data(G_OBJECT(connection), J_TRANSPORT_ADDRESS_KEY);
+
+	if (fabric == NULL || peer == NULL)
+	{
+		return FALSE;
+	}
+
+	max_piece = MIN(length, fabric->info->ep_attr->max_msg_size);
+	n_operations = (length + max_piece - 1) / max_piece;
+	operations = g_new(JTransportOperation, n_operations);
+
+	g_mutex_lock(&(fabric->mutex));
+
+	/* Local buffers have to be registered, too. */
+	region = j_transport_fabric_register(fabric, data, length);
+
+	if (region == NULL)
+	{
+		g_mutex_unlock(&(fabric->mutex));
+		return FALSE;
+	}
+
+	for (guint i = 0; i < n_operations; i++)
+	{
+		guint64 piece;
+		gssize err;
+
+		piece = MIN(length - done, max_piece);
+
+		operations[i].request = &request;
+
+		while (TRUE)
+		{
+			if (write)
+			{
+				err = fi_write(fabric->ep, (gchar*)data + done, piece, fi_mr_desc(region->mr), *peer, remote->address + done, remote->key, &(operations[i].context));
+			}
+			else
+			{
+				err = fi_read(fabric->ep, (gchar*)data + done, piece, fi_mr_desc(region->mr), *peer, remote->address + done, remote->key, &(operations[i].context));
+			}
+
+			if (err != -FI_EAGAIN)
+			{
+				break;
+			}
+
+			/* The transmit queue is full, so completions have to be processed first. */
+			j_transport_fabric_progress(fabric);
+		}
+
+		if (err != 0)
+		{
+			J_CRITICAL("%s", fi_strerror(-err));
+			request.failed = TRUE;
+			break;
+		}
+
+		request.pending++;
+		done += piece;
+	}
+
+	g_mutex_unlock(&(fabric->mutex));
+
+	/* Operations that have already been posted have to complete even if a later one failed. */
+	ret = j_transport_fabric_wait(fabric, &request);
+
+	g_mutex_lock(&(fabric->mutex));
+	j_transport_fabric_unregister(region);
+	g_mutex_unlock(&(fabric->mutex));
+
+	return ret;
+}
+
+static
+void
+j_transport_peer_free (gpointer data)
+{
+	fi_addr_t* peer = data;
+
+	g_mutex_lock(&j_transport_mutex);
+
+	/* The fabric might already have been shut down. */
+	if (j_transport_fabric != NULL)
+	{
+		g_mutex_lock(&(j_transport_fabric->mutex));
+		fi_av_remove(j_transport_fabric->av, peer, 1, 0);
+		g_mutex_unlock(&(j_transport_fabric->mutex));
+	}
+
+	g_mutex_unlock(&j_transport_mutex);
+
+	g_free(peer);
+}
+
+#endif
+
+static
+gboolean
+j_transport_rdma_receive (GSocketConnection* connection, JTransportRemote const* remote, gpointer data, guint64 length)
+{
+#ifdef HAVE_LIBFABRIC
+	return j_transport_rdma_transfer(connection, remote, data, length, FALSE);
+#else
+	(void)connection;
+	(void)remote;
+	(void)data;
+	(void)length;
+
+	return FALSE;
+#endif
+}
+
+static
+gboolean
+j_transport_rdma_send (GSocketConnection* connection, JTransportRemote const* remote, gconstpointer data, guint64 length)
+{
+#ifdef HAVE_LIBFABRIC
+	/* The buffer is only read from. */
+	return j_transport_rdma_transfer(connection, remote, (gpointer)data, length, TRUE);
+#else
+	(void)connection;
+	(void)remote;
+	(void)data;
+	(void)length;
+
+	return FALSE;
+#endif
+}
+
+static JTransport const j_transport_tcp = {
+	j_transport_tcp_receive,
+	j_transport_tcp_send
+};
+
+static JTransport const j_transport_rdma = {
+	j_transport_rdma_receive,
+	j_transport_rdma_send
+};
+
+static JTransport const j_transport_shm = {
+	j_transport_shm_receive,
+	j_transport_shm_send
+};
+
+/**
+ * Returns the transport to use for a remote region.
+ * Peers that have passed shared memory allocate all their regions from it.
+ **/
+static
+JTransport const*
+j_transport_get (GSocketConnection* connection, JTransportRemote const* remote)
+{
+	if (remote == NULL)
+	{
+		return &j_transport_tcp;
+	}
+
+	return (j_transport_shm_get(connection) != NULL) ? &j_transport_shm : &j_transport_rdma;
+}
+
+/**
+ * Opens the process' RDMA endpoint.
+ * The endpoint is only opened once; further calls return whether that succeeded.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return TRUE if RDMA is available, FALSE otherwise.
+ **/
+gboolean
+j_transport_rdma_init (void)
+{
+	gboolean ret = FALSE;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&j_transport_mutex);
+
+#ifdef HAVE_LIBFABRIC
+	if (!j_transport_initialized)
+	{
+		j_transport_fabric = j_transport_fabric_new();
+	}
+
+	ret = (j_transport_fabric != NULL);
+#endif
+
+	j_transport_initialized = TRUE;
+
+	g_mutex_unlock(&j_transport_mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Closes the process' RDMA endpoint.
+ * Connections that have been accepted using j_transport_accept() can not use RDMA anymore afterwards.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ **/
+void
+j_transport_fini (void)
+{
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(&j_transport_mutex);
+
+#ifdef HAVE_LIBFABRIC
+	if (j_transport_fabric != NULL)
+	{
+		j_transport_fabric_free(j_transport_fabric);
+		j_transport_fabric = NULL;
+	}
+#endif
+
+	j_transport_initialized = FALSE;
+
+	g_mutex_unlock(&j_transport_mutex);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Returns the address of the process' RDMA endpoint.
+ * Peers pass it to j_transport_accept() to be able to access the process' registered regions.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \return The address as a hexadecimal string or NULL if RDMA is not available. Should be freed with g_free().
+ **/
+gchar*
+j_transport_get_address (void)
+{
+	gchar* address = NULL;
+
+#ifdef HAVE_LIBFABRIC
+	g_mutex_lock(&j_transport_mutex);
+
+	if (j_transport_fabric != NULL)
+	{
+		GString* string;
+
+		string = g_string_sized_new(2 * j_transport_fabric->address_len);
+
+		for (gsize i = 0; i < j_transport_fabric->address_len; i++)
+		{
+			g_string_append_printf(string, "%02x", j_transport_fabric->address[i]);
+		}
+
+		address = g_string_free(string, FALSE);
+	}
+
+	g_mutex_unlock(&j_transport_mutex);
+#endif
+
+	return address;
+}
+
+/**
+ * Allows RDMA transfers on a connection.
+ * The peer's regions can then be accessed using j_transport_receive() and j_transport_send().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param address    The peer's address, as returned by j_transport_get_address().
+ *
+ * \return TRUE if RDMA can be used on the connection, FALSE otherwise.
+ **/
+gboolean
+j_transport_accept (GSocketConnection* connection, gchar const* address)
+{
+	gboolean ret = FALSE;
+
+#ifdef HAVE_LIBFABRIC
+	g_autofree guchar* raw = NULL;
+	fi_addr_t* peer;
+	gsize len;
+
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(address != NULL, FALSE);
+
+	len = strlen(address);
+
+	if (len == 0 || len % 2 != 0)
+	{
+		return FALSE;
+	}
+
+	raw = g_malloc(len / 2);
+
+	for (gsize i = 0; i < len / 2; i++)
+	{
+		gint high;
+		gint low;
+
+		high = g_ascii_xdigit_value(address[2 * i]);
+		low = g_ascii_xdigit_value(address[2 * i + 1]);
+
+		if (high < 0 || low < 0)
+		{
+			return FALSE;
+		}
+
+		raw[i] = (high << 4) | low;
+	}
+
+	peer = g_new(fi_addr_t, 1);
+
+	g_mutex_lock(&j_transport_mutex);
+
+	if (j_transport_fabric != NULL)
+	{
+		g_mutex_lock(&(j_transport_fabric->mutex));
+		ret = (fi_av_insert(j_transport_fabric->av, raw, 1, peer, 0, NULL) == 1);
+		g_mutex_unlock(&(j_transport_fabric->mutex));
+	}
+
+	g_mutex_unlock(&j_transport_mutex);
+
+	if (ret)
+	{
+		g_object_set_data_full(G_OBJECT(connection), J_TRANSPORT_ADDRESS_KEY, peer, j_transport_peer_free);
+	}
+	else
+	{
+		g_free(peer);
+	}
+#else
+	(void)connection;
+	(void)address;
+#endif
+
+	return ret;
+}
+
+/**
+ * Registers a buffer, so that peers can access it using RDMA.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param data   A buffer.
+ * \param length The buffer's length.
+ *
+ * \return A new region or NULL if the buffer could not be registered. Should be freed with j_transport_region_free().
+ **/
+JTransportRegion*
+j_transport_region_new (gpointer data, guint64 length)
+{
+	JTransportRegion* region = NULL;
+
+#ifdef HAVE_LIBFABRIC
+	struct fid_mr* mr = NULL;
+
+	g_return_val_if_fail(data != NULL, NULL);
+
+	g_mutex_lock(&j_transport_mutex);
+
+	if (j_transport_fabric != NULL)
+	{
+		gint ret;
+
+		g_mutex_lock(&(j_transport_fabric->mutex));
+		ret = fi_mr_reg(j_transport_fabric->domain, data, length, FI_REMOTE_READ | FI_REMOTE_WRITE, 0, 0, 0, &mr, NULL);
+		g_mutex_unlock(&(j_transport_fabric->mutex));
+
+		if (ret == 0)
+		{
+			region = g_slice_new(JTransportRegion);
+			region->mr = mr;
+			region->data = data;
+			region->length = length;
+			region->shm = NULL;
+			region->users = 0;
+			region->cached = FALSE;
+		}
+	}
+
+	g_mutex_unlock(&j_transport_mutex);
+#else
+	(void)data;
+	(void)length;
+#endif
+
+	return region;
+}
+
+/**
+ * Returns the description peers need to access a region.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param region A region.
+ * \param remote The description.
+ **/
+void
+j_transport_region_get_remote (JTransportRegion* region, JTransportRemote* remote)
+{
+	g_return_if_fail(region != NULL);
+	g_return_if_fail(remote != NULL);
+
+	/* Regions in shared memory are addressed by their offsets. */
+	if (region->shm != NULL)
+	{
+		remote->address = region->offset;
+		remote->key = 0;
+		return;
+	}
+
+	/* Regions are addressed by their virtual addresses (FI_MR_VIRT_ADDR). */
+	remote->address = (guint64)(guintptr)region->data;
+
+#ifdef HAVE_LIBFABRIC
+	remote->key = fi_mr_key(region->mr);
+#else
+	remote->key = 0;
+#endif
+}
+
+/**
+ * Unregisters a region.
+ * Peers must not access it anymore.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param region A region.
+ **/
+void
+j_transport_region_free (JTransportRegion* region)
+{
+	g_return_if_fail(region != NULL);
+
+	if (region->shm != NULL)
+	{
+		j_transport_shm_release(region->shm, region);
+		return;
+	}
+
+#ifdef HAVE_LIBFABRIC
+	g_mutex_lock(&j_transport_mutex);
+
+	/* Otherwise, the registration's domain has already been closed. */
+	if (j_transport_fabric != NULL)
+	{
+		g_mutex_lock(&(j_transport_fabric->mutex));
+		fi_close(&(region->mr->fid));
+		g_mutex_unlock(&(j_transport_fabric->mutex));
+	}
+
+	g_mutex_unlock(&j_transport_mutex);
+#endif
+
+	g_slice_free(JTransportRegion, region);
+}
+
+/**
+ * Copies data that a peer has written to a region into the region's buffer.
+ * This is only necessary for regions in shared memory, RDMA writes to the buffer directly.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param region A region.
+ * \param length The number of bytes the peer has written.
+ **/
+void
+j_transport_region_sync (JTransportRegion* region, guint64 length)
+{
+	g_return_if_fail(region != NULL);
+	g_return_if_fail(length <= region->length);
+
+	if (region->shm != NULL && length > 0)
+	{
+		memcpy(region->data, region->shm->data + region->offset, length);
+	}
+}
+
+/**
+ * Creates shared memory that can be passed to a server on the same node.
+ * Its pages are only allocated once they are used.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size The size.
+ *
+ * \return New shared memory or NULL if it is not supported. Should be freed with j_transport_shm_free().
+ **/
+JTransportShm*
+j_transport_shm_new (guint64 size)
+{
+	JTransportShm* shm = NULL;
+
+#ifdef HAVE_MEMFD_CREATE
+	gpointer data;
+	gint fd;
+
+	g_return_val_if_fail(size > 0, NULL);
+
+	fd = memfd_create("julea-transport", MFD_CLOEXEC);
+
+	if (fd == -1)
+	{
+		return NULL;
+	}
+
+	if (ftruncate(fd, size) != 0 || (data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	shm = j_transport_shm_new_internal(fd, data, size);
+#else
+	(void)size;
+#endif
+
+	return shm;
+}
+
+/**
+ * Frees shared memory.
+ * All regions allocated from it have to have been freed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param shm Shared memory.
+ **/
+void
+j_transport_shm_free (JTransportShm* shm)
+{
+	g_return_if_fail(shm != NULL);
+	g_return_if_fail(g_queue_is_empty(&(shm->regions)));
+
+	munmap(shm->data, shm->size);
+
+	if (shm->fd != -1)
+	{
+		close(shm->fd);
+	}
+
+	g_mutex_clear(&(shm->mutex));
+
+	g_slice_free(JTransportShm, shm);
+}
+
+/**
+ * Passes shared memory to the server on the other end of a UNIX domain socket.
+ * The server has to call j_transport_shm_accept().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param shm        Shared memory.
+ * \param connection A connection.
+ *
+ * \return TRUE if the server has mapped the memory, FALSE otherwise.
+ **/
+gboolean
+j_transport_shm_offer (JTransportShm* shm, GSocketConnection* connection)
+{
+	GError* error = NULL;
+	GInputStream* input;
+	guchar ack = 0;
+	gsize bytes_read = 0;
+
+	g_return_val_if_fail(shm != NULL, FALSE);
+	g_return_val_if_fail(G_IS_UNIX_CONNECTION(connection), FALSE);
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	/* The server acknowledges whether it could map the memory. */
+	if (!g_unix_connection_send_fd(G_UNIX_CONNECTION(connection), shm->fd, NULL, &error)
+	    || !g_input_stream_read_all(input, &ack, sizeof(ack), &bytes_read, NULL, &error))
+	{
+		J_CRITICAL("%s", error->message);
+		g_error_free(error);
+	}
+
+	return (bytes_read == sizeof(ack) && ack == 1);
+}
+
+/**
+ * Maps the shared memory passed by a client using j_transport_shm_offer().
+ * The client's regions can then be accessed using j_transport_receive() and j_transport_send().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ *
+ * \return TRUE if the memory has been mapped, FALSE otherwise.
+ **/
+gboolean
+j_transport_shm_accept (GSocketConnection* connection)
+{
+	GError* error = NULL;
+	GOutputStream* output;
+	struct stat buf;
+	gpointer data = MAP_FAILED;
+	guchar ack = 0;
+	gint fd;
+
+	g_return_val_if_fail(G_IS_UNIX_CONNECTION(connection), FALSE);
+
+	fd = g_unix_connection_receive_fd(G_UNIX_CONNECTION(connection), NULL, &error);
+
+	if (fd == -1)
+	{
+		J_CRITICAL("%s", error->message);
+		g_error_free(error);
+
+		return FALSE;
+	}
+
+	if (fstat(fd, &buf) == 0 && buf.st_size > 0)
+	{
+		data = mmap(NULL, buf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+
+	/* The mapping stays valid without the file. */
+	close(fd);
+
+	if (data != MAP_FAILED)
+	{
+		g_object_set_data_full(G_OBJECT(connection), J_TRANSPORT_SHM_KEY, j_transport_shm_new_internal(-1, data, buf.st_size), j_transport_shm_free_func);
+		ack = 1;
+	}
+
+	output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+
+	if (!g_output_stream_write_all(output, &ack, sizeof(ack), NULL, NULL, &error))
+	{
+		J_CRITICAL("%s", error->message);
+		g_error_free(error);
+
+		return FALSE;
+	}
+
+	return (ack == 1);
+}
+
+/**
+ * Allocates a region for a buffer from shared memory.
+ * Peers access the region instead of the buffer, so data they write has to be copied using j_transport_region_sync().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param shm    Shared memory.
+ * \param data   A buffer.
+ * \param length The buffer's length.
+ * \param copy   Whether to copy the buffer's contents to the region, for peers that read them.
+ *
+ * \return A new region or NULL if there is not enough free space. Should be freed with j_transport_region_free().
+ **/
+JTransportRegion*
+j_transport_shm_region_new (JTransportShm* shm, gpointer data, guint64 length, gboolean copy)
+{
+	JTransportRegion* region = NULL;
+	guint64 offset;
+
+	g_return_val_if_fail(shm != NULL, NULL);
+	g_return_val_if_fail(data != NULL, NULL);
+	g_return_val_if_fail(length > 0, NULL);
+
+	g_mutex_lock(&(shm->mutex));
+
+	if (j_transport_shm_allocate(shm, length, &offset))
+	{
+		region = g_slice_new(JTransportRegion);
+		region->data = data;
+		region->length = length;
+		region->shm = shm;
+		region->offset = offset;
+		region->released = FALSE;
+		region->users = 0;
+		region->cached = FALSE;
+
+		g_queue_push_tail(&(shm->regions), region);
+	}
+
+	g_mutex_unlock(&(shm->mutex));
+
+	/* The space belongs to the region, so it can be written without holding the mutex. */
+	if (region != NULL && copy)
+	{
+		memcpy(shm->data + offset, data, length);
+	}
+
+	return region;
+}
+
+/**
+ * Receives a payload.
+ * It is read from the connection if remote is NULL, otherwise it is copied from the peer's region.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param remote     The peer's region or NULL.
+ * \param data       A buffer.
+ * \param length     The payload's length.
+ *
+ * \return TRUE if the whole payload has been received, FALSE otherwise.
+ **/
+gboolean
+j_transport_receive (GSocketConnection* connection, JTransportRemote const* remote, gpointer data, guint64 length)
+{
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(data != NULL || length == 0, FALSE);
+
+	if (length == 0)
+	{
+		return TRUE;
+	}
+
+	return j_transport_get(connection, remote)->receive(connection, remote, data, length);
+}
+
+/**
+ * Sends a payload.
+ * It is written to the connection if remote is NULL, otherwise it is copied to the peer's region.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param remote     The peer's region or NULL.
+ * \param data       A buffer.
+ * \param length     The payload's length.
+ *
+ * \return TRUE if the whole payload has been sent, FALSE otherwise.
+ **/
+gboolean
+j_transport_send (GSocketConnection* connection, JTransportRemote const* remote, gconstpointer data, guint64 length)
+{
+	g_return_val_if_fail(connection != NULL, FALSE);
+	g_return_val_if_fail(data != NULL || length == 0, FALSE);
+
+	if (length == 0)
+	{
+		return TRUE;
+	}
+
+	return j_transport_get(connection, remote)->send(connection, remote, data, length);
+}
+
+/**
+ * @}
+ **/
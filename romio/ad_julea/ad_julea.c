@@ -0,0 +1,703 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * ROMIO ADIO driver storing MPI-IO files in JULEA.
+ *
+ * The driver has to be built as part of ROMIO by copying this directory to adio/ad_julea and registering ADIO_JULEA_operations for the "julea:" prefix.
+ * Files are stored as distributed objects in the "adio" namespace.
+ * Independent accesses are executed as a single batch, noncontiguous ones use vectored reads and writes.
+ * Collective accesses use ROMIO's two-phase I/O, the aggregators' file domains are aligned to the distribution's block size.
+ **/
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+#include <julea-object.h>
+
+#include "ad_julea.h"
+
+#define J_ADIO_NAMESPACE "adio"
+
+struct JADIOFile
+{
+	JDistributedObject* object;
+};
+
+typedef struct JADIOFile JADIOFile;
+
+/**
+ * The keyval used to finalize JULEA, MPI_KEYVAL_INVALID if JULEA has not been initialized.
+ **/
+static int ADIOI_JULEA_Initialized = MPI_KEYVAL_INVALID;
+
+/**
+ * Finalizes JULEA when MPI_COMM_SELF is freed during MPI_Finalize.
+ **/
+static
+int
+ADIOI_JULEA_End (MPI_Comm comm, int keyval, void* attribute_val, void* extra_state)
+{
+	(void)comm;
+	(void)attribute_val;
+	(void)extra_state;
+
+	MPI_Comm_free_keyval(&keyval);
+	j_fini();
+
+	return MPI_SUCCESS;
+}
+
+static
+void
+ADIOI_JULEA_Init (int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_INIT";
+
+	if (ADIOI_JULEA_Initialized != MPI_KEYVAL_INVALID)
+	{
+		*error_code = MPI_SUCCESS;
+		return;
+	}
+
+	j_init();
+
+	if (MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, ADIOI_JULEA_End, &ADIOI_JULEA_Initialized, NULL) != MPI_SUCCESS
+	    || MPI_Comm_set_attr(MPI_COMM_SELF, ADIOI_JULEA_Initialized, NULL) != MPI_SUCCESS)
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	*error_code = MPI_SUCCESS;
+}
+
+/**
+ * Returns the distribution used for all files.
+ **/
+static
+JDistribution*
+ADIOI_JULEA_Distribution (void)
+{
+	return j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+}
+
+/**
+ * Returns a batch honoring the file's atomicity mode.
+ **/
+static
+JBatch*
+ADIOI_JULEA_Batch (ADIO_File fd)
+{
+	return j_batch_new_for_template(fd->atomicity ? J_SEMANTICS_TEMPLATE_POSIX : J_SEMANTICS_TEMPLATE_DEFAULT);
+}
+
+static
+gboolean
+ADIOI_JULEA_Size (ADIO_File fd, JDistributedObject* object, guint64* size)
+{
+	g_autoptr(JBatch) batch = NULL;
+	gint64 modification_time;
+
+	batch = ADIOI_JULEA_Batch(fd);
+	j_distributed_object_status(object, &modification_time, size, batch);
+
+	return j_batch_execute(batch);
+}
+
+void
+ADIOI_JULEA_Open (ADIO_File fd, int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_OPEN";
+
+	JADIOFile* file;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	guint64 size = 0;
+	gboolean exists;
+
+	ADIOI_JULEA_Init(error_code);
+
+	if (*error_code != MPI_SUCCESS)
+	{
+		return;
+	}
+
+	distribution = ADIOI_JULEA_Distribution();
+
+	file = g_slice_new(JADIOFile);
+	file->object = j_distributed_object_new(J_ADIO_NAMESPACE, fd->filename, distribution);
+
+	exists = ADIOI_JULEA_Size(fd, file->object, &size);
+
+	if (exists && (fd->access_mode & ADIO_EXCL))
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_FILE_EXISTS, "**fileexist", 0);
+		goto error;
+	}
+
+	if (!exists)
+	{
+		if (!(fd->access_mode & ADIO_CREATE))
+		{
+			*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_NO_SUCH_FILE, "**filenoexist", "**filenoexist %s", fd->filename);
+			goto error;
+		}
+
+		batch = ADIOI_JULEA_Batch(fd);
+		j_distributed_object_create(file->object, batch);
+
+		if (!j_batch_execute(batch))
+		{
+			*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+			goto error;
+		}
+
+		size = 0;
+	}
+
+	if (fd->access_mode & ADIO_APPEND)
+	{
+		fd->fp_ind = size;
+		fd->fp_sys_posn = size;
+	}
+
+	fd->fs_ptr = file;
+	*error_code = MPI_SUCCESS;
+
+	return;
+
+error:
+	j_distributed_object_unref(file->object);
+	g_slice_free(JADIOFile, file);
+}
+
+void
+ADIOI_JULEA_Close (ADIO_File fd, int* error_code)
+{
+	JADIOFile* file = fd->fs_ptr;
+
+	if (file != NULL)
+	{
+		j_distributed_object_unref(file->object);
+		g_slice_free(JADIOFile, file);
+	}
+
+	fd->fs_ptr = NULL;
+	*error_code = MPI_SUCCESS;
+}
+
+static
+void
+ADIOI_JULEA_Set_status (ADIO_Status* status, MPI_Datatype datatype, guint64 bytes)
+{
+#ifdef HAVE_STATUS_SET_BYTES
+	if (status != NULL)
+	{
+		MPIR_Status_set_bytes(status, datatype, bytes);
+	}
+#else
+	(void)status;
+	(void)datatype;
+	(void)bytes;
+#endif
+}
+
+/**
+ * Reads or writes a contiguous region.
+ * Explicit offsets are absolute byte offsets.
+ **/
+static
+void
+ADIOI_JULEA_Contig (ADIO_File fd, gpointer buf, MPI_Aint count, MPI_Datatype datatype, int file_ptr_type, ADIO_Offset offset, gboolean write, ADIO_Status* status, int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_CONTIG";
+
+	JADIOFile* file = fd->fs_ptr;
+	g_autoptr(JBatch) batch = NULL;
+	MPI_Count datatype_size;
+	guint64 length;
+	guint64 bytes = 0;
+
+	MPI_Type_size_x(datatype, &datatype_size);
+	length = (guint64)count * datatype_size;
+
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+	{
+		offset = fd->fp_ind;
+	}
+
+	batch = ADIOI_JULEA_Batch(fd);
+
+	if (write)
+	{
+		j_distributed_object_write(file->object, buf, length, offset, &bytes, batch);
+	}
+	else
+	{
+		j_distributed_object_read(file->object, buf, length, offset, &bytes, batch);
+	}
+
+	if (!j_batch_execute(batch))
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+	{
+		fd->fp_ind += bytes;
+	}
+
+	fd->fp_sys_posn = offset + bytes;
+
+	ADIOI_JULEA_Set_status(status, datatype, bytes);
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_JULEA_ReadContig (ADIO_File fd, void* buf, MPI_Aint count, MPI_Datatype datatype, int file_ptr_type, ADIO_Offset offset, ADIO_Status* status, int* error_code)
+{
+	ADIOI_JULEA_Contig(fd, buf, count, datatype, file_ptr_type, offset, FALSE, status, error_code);
+}
+
+void
+ADIOI_JULEA_WriteContig (ADIO_File fd, void const* buf, MPI_Aint count, MPI_Datatype datatype, int file_ptr_type, ADIO_Offset offset, ADIO_Status* status, int* error_code)
+{
+	/* Writes do not modify the buffer, only the helper is shared with reads. */
+	ADIOI_JULEA_Contig(fd, (gpointer)buf, count, datatype, file_ptr_type, offset, TRUE, status, error_code);
+}
+
+/**
+ * Converts an absolute file offset into an offset within the data of the file view.
+ **/
+static
+ADIO_Offset
+ADIOI_JULEA_View_offset (ADIO_File fd, ADIOI_Flatlist_node const* flat_file, MPI_Count filetype_size, MPI_Aint filetype_extent, ADIO_Offset position)
+{
+	ADIO_Offset within;
+	ADIO_Offset data_offset;
+
+	if (position <= fd->disp)
+	{
+		return 0;
+	}
+
+	within = (position - fd->disp) % filetype_extent;
+	data_offset = ((position - fd->disp) / filetype_extent) * filetype_size;
+
+	for (MPI_Count i = 0; i < flat_file->count; i++)
+	{
+		if (within >= flat_file->indices[i] + flat_file->blocklens[i])
+		{
+			data_offset += flat_file->blocklens[i];
+		}
+		else if (within > flat_file->indices[i])
+		{
+			data_offset += within - flat_file->indices[i];
+		}
+	}
+
+	return data_offset;
+}
+
+/**
+ * Reads or writes a contiguous buffer from or to a noncontiguous file view.
+ * All blocks are accessed using a single batch.
+ * Explicit offsets are given in etypes relative to the file view.
+ **/
+static
+void
+ADIOI_JULEA_Strided (ADIO_File fd, gpointer buf, MPI_Aint count, MPI_Datatype datatype, int file_ptr_type, ADIO_Offset offset, gboolean write, ADIO_Status* status, int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_STRIDED";
+
+	JADIOFile* file = fd->fs_ptr;
+	ADIOI_Flatlist_node* flat_file;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(GArray) vectors = NULL;
+	g_autoptr(GArray) offsets = NULL;
+	MPI_Count datatype_size;
+	MPI_Count filetype_size;
+	MPI_Aint filetype_lb;
+	MPI_Aint filetype_extent;
+	ADIO_Offset data_offset;
+	ADIO_Offset end = 0;
+	ADIO_Offset n;
+	ADIO_Offset skip;
+	MPI_Count block = 0;
+	guint64 length;
+	guint64 position = 0;
+	guint64 bytes = 0;
+
+	MPI_Type_size_x(datatype, &datatype_size);
+	MPI_Type_size_x(fd->filetype, &filetype_size);
+	MPI_Type_get_extent(fd->filetype, &filetype_lb, &filetype_extent);
+
+	length = (guint64)count * datatype_size;
+
+	if (length == 0 || filetype_size == 0)
+	{
+		ADIOI_JULEA_Set_status(status, datatype, 0);
+		*error_code = MPI_SUCCESS;
+		return;
+	}
+
+	flat_file = ADIOI_Flatten_and_find(fd->filetype);
+
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+	{
+		data_offset = ADIOI_JULEA_View_offset(fd, flat_file, filetype_size, filetype_extent, fd->fp_ind);
+	}
+	else
+	{
+		data_offset = offset * fd->etype_size;
+	}
+
+	n = data_offset / filetype_size;
+	skip = data_offset % filetype_size;
+
+	while (skip >= flat_file->blocklens[block])
+	{
+		skip -= flat_file->blocklens[block];
+		block++;
+	}
+
+	vectors = g_array_new(FALSE, FALSE, write ? sizeof(GOutputVector) : sizeof(GInputVector));
+	offsets = g_array_new(FALSE, FALSE, sizeof(guint64));
+
+	while (position < length)
+	{
+		ADIO_Offset file_offset;
+		guint64 piece;
+
+		file_offset = fd->disp + n * filetype_extent + flat_file->indices[block] + skip;
+		piece = MIN((guint64)(flat_file->blocklens[block] - skip), length - position);
+
+		if (piece > 0)
+		{
+			/* Blocks that are adjacent in the file are merged, the buffer is contiguous anyway. */
+			if (offsets->len > 0 && end == file_offset)
+			{
+				if (write)
+				{
+					g_array_index(vectors, GOutputVector, vectors->len - 1).size += piece;
+				}
+				else
+				{
+					g_array_index(vectors, GInputVector, vectors->len - 1).size += piece;
+				}
+			}
+			else
+			{
+				guint64 o = file_offset;
+
+				if (write)
+				{
+					GOutputVector vector = { (gchar const*)buf + position, piece };
+
+					g_array_append_val(vectors, vector);
+				}
+				else
+				{
+					GInputVector vector = { (gchar*)buf + position, piece };
+
+					g_array_append_val(vectors, vector);
+				}
+
+				g_array_append_val(offsets, o);
+			}
+
+			end = file_offset + piece;
+		}
+
+		position += piece;
+		skip = 0;
+		block++;
+
+		if (block == flat_file->count)
+		{
+			block = 0;
+			n++;
+		}
+	}
+
+	batch = ADIOI_JULEA_Batch(fd);
+
+	if (write)
+	{
+		j_distributed_object_writev(file->object, (GOutputVector const*)(gpointer)vectors->data, (guint64 const*)(gpointer)offsets->data, offsets->len, &bytes, batch);
+	}
+	else
+	{
+		j_distributed_object_readv(file->object, (GInputVector const*)(gpointer)vectors->data, (guint64 const*)(gpointer)offsets->data, offsets->len, &bytes, batch);
+	}
+
+	if (!j_batch_execute(batch))
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	if (file_ptr_type == ADIO_INDIVIDUAL)
+	{
+		fd->fp_ind = end;
+	}
+
+	fd->fp_sys_posn = end;
+
+	ADIOI_JULEA_Set_status(status, datatype, bytes);
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_JULEA_ReadStrided (ADIO_File fd, void* buf, MPI_Aint count, MPI_Datatype datatype, int file_ptr_type, ADIO_Offset offset, ADIO_Status* status, int* error_code)
+{
+	int buftype_is_contig;
+
+	ADIOI_Datatype_iscontig(datatype, &buftype_is_contig);
+
+	/* Noncontiguous buffers are rare enough to be handled piece by piece. */
+	if (!buftype_is_contig)
+	{
+		ADIOI_GEN_ReadStrided_naive(fd, buf, count, datatype, file_ptr_type, offset, status, error_code);
+		return;
+	}
+
+	ADIOI_JULEA_Strided(fd, buf, count, datatype, file_ptr_type, offset, FALSE, status, error_code);
+}
+
+void
+ADIOI_JULEA_WriteStrided (ADIO_File fd, void const* buf, MPI_Aint count, MPI_Datatype datatype, int file_ptr_type, ADIO_Offset offset, ADIO_Status* status, int* error_code)
+{
+	int buftype_is_contig;
+
+	ADIOI_Datatype_iscontig(datatype, &buftype_is_contig);
+
+	if (!buftype_is_contig)
+	{
+		ADIOI_GEN_WriteStrided_naive(fd, buf, count, datatype, file_ptr_type, offset, status, error_code);
+		return;
+	}
+
+	ADIOI_JULEA_Strided(fd, (gpointer)buf, count, datatype, file_ptr_type, offset, TRUE, status, error_code);
+}
+
+void
+ADIOI_JULEA_Fcntl (ADIO_File fd, int flag, ADIO_Fcntl_t* fcntl_struct, int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_FCNTL";
+
+	JADIOFile* file = fd->fs_ptr;
+
+	switch (flag)
+	{
+		case ADIO_FCNTL_GET_FSIZE:
+			{
+				guint64 size = 0;
+
+				if (!ADIOI_JULEA_Size(fd, file->object, &size))
+				{
+					*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+					return;
+				}
+
+				fcntl_struct->fsize = size;
+				*error_code = MPI_SUCCESS;
+			}
+			break;
+		case ADIO_FCNTL_SET_DISKSPACE:
+			ADIOI_GEN_Prealloc(fd, fcntl_struct->diskspace, error_code);
+			break;
+		case ADIO_FCNTL_SET_ATOMICITY:
+			/* Batches of atomic files use the POSIX semantics. */
+			fd->atomicity = (fcntl_struct->atomicity == 0) ? 0 : 1;
+			*error_code = MPI_SUCCESS;
+			break;
+		default:
+			*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_ARG, "**flag", "**flag %d", flag);
+			break;
+	}
+}
+
+void
+ADIOI_JULEA_SetInfo (ADIO_File fd, MPI_Info users_info, int* error_code)
+{
+	g_autoptr(JDistribution) distribution = NULL;
+	char value[MPI_MAX_INFO_VAL + 1];
+	guint64 block_size;
+
+	ADIOI_JULEA_Init(error_code);
+
+	if (*error_code != MPI_SUCCESS)
+	{
+		return;
+	}
+
+	ADIOI_GEN_SetInfo(fd, users_info, error_code);
+
+	if (*error_code != MPI_SUCCESS)
+	{
+		return;
+	}
+
+	distribution = ADIOI_JULEA_Distribution();
+	block_size = j_distribution_get_block_size(distribution);
+
+	/* Two-phase I/O aligns the aggregators' file domains to the striping unit, so every aggregator accesses whole blocks. */
+	fd->hints->striping_unit = block_size;
+	g_snprintf(value, sizeof(value), "%" G_GUINT64_FORMAT, block_size);
+	MPI_Info_set(fd->info, "striping_unit", value);
+
+	/* Aggregators access their collective buffer at once, so it should consist of whole blocks, too. */
+	if (fd->hints->cb_buffer_size % block_size != 0)
+	{
+		fd->hints->cb_buffer_size = ((fd->hints->cb_buffer_size / block_size) + 1) * block_size;
+		g_snprintf(value, sizeof(value), "%d", fd->hints->cb_buffer_size);
+		MPI_Info_set(fd->info, "cb_buffer_size", value);
+	}
+
+	/* Data sieving requires locks, noncontiguous accesses use vectored batches instead. */
+	fd->hints->ds_read = ADIOI_HINT_DISABLE;
+	fd->hints->ds_write = ADIOI_HINT_DISABLE;
+	MPI_Info_set(fd->info, "romio_ds_read", "disable");
+	MPI_Info_set(fd->info, "romio_ds_write", "disable");
+
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_JULEA_Flush (ADIO_File fd, int* error_code)
+{
+	(void)fd;
+
+	/* Batches are executed immediately, so there is nothing to flush. */
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_JULEA_Resize (ADIO_File fd, ADIO_Offset size, int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_RESIZE";
+
+	JADIOFile* file = fd->fs_ptr;
+	g_autoptr(JBatch) batch = NULL;
+	guint64 current_size = 0;
+	guint64 bytes;
+	gchar zero = 0;
+
+	if (!ADIOI_JULEA_Size(fd, file->object, &current_size))
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	if ((guint64)size == current_size)
+	{
+		*error_code = MPI_SUCCESS;
+		return;
+	}
+
+	/* Distributed objects can not be truncated, they can only be extended by writing their last byte. */
+	if ((guint64)size < current_size)
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_UNSUPPORTED_OPERATION, "**io", 0);
+		return;
+	}
+
+	batch = ADIOI_JULEA_Batch(fd);
+	j_distributed_object_write(file->object, &zero, 1, size - 1, &bytes, batch);
+
+	if (!j_batch_execute(batch))
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	*error_code = MPI_SUCCESS;
+}
+
+void
+ADIOI_JULEA_Delete (char const* filename, int* error_code)
+{
+	static char myname[] = "ADIOI_JULEA_DELETE";
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JDistributedObject) object = NULL;
+
+	ADIOI_JULEA_Init(error_code);
+
+	if (*error_code != MPI_SUCCESS)
+	{
+		return;
+	}
+
+	distribution = ADIOI_JULEA_Distribution();
+	object = j_distributed_object_new(J_ADIO_NAMESPACE, filename, distribution);
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	j_distributed_object_delete(object, batch);
+
+	if (!j_batch_execute(batch))
+	{
+		*error_code = MPIO_Err_create_code(MPI_SUCCESS, MPIR_ERR_RECOVERABLE, myname, __LINE__, MPI_ERR_IO, "**io", 0);
+		return;
+	}
+
+	*error_code = MPI_SUCCESS;
+}
+
+struct ADIOI_Fns_struct ADIO_JULEA_operations = {
+	ADIOI_JULEA_Open, /* Open */
+	ADIOI_GEN_OpenColl, /* OpenColl */
+	ADIOI_JULEA_ReadContig, /* ReadContig */
+	ADIOI_JULEA_WriteContig, /* WriteContig */
+	ADIOI_GEN_ReadStridedColl, /* ReadStridedColl */
+	ADIOI_GEN_WriteStridedColl, /* WriteStridedColl */
+	ADIOI_GEN_SeekIndividual, /* SeekIndividual */
+	ADIOI_JULEA_Fcntl, /* Fcntl */
+	ADIOI_JULEA_SetInfo, /* SetInfo */
+	ADIOI_JULEA_ReadStrided, /* ReadStrided */
+	ADIOI_JULEA_WriteStrided, /* WriteStrided */
+	ADIOI_JULEA_Close, /* Close */
+	ADIOI_FAKE_IreadContig, /* IreadContig */
+	ADIOI_FAKE_IwriteContig, /* IwriteContig */
+	ADIOI_FAKE_IODone, /* ReadDone */
+	ADIOI_FAKE_IODone, /* WriteDone */
+	ADIOI_FAKE_IOComplete, /* ReadComplete */
+	ADIOI_FAKE_IOComplete, /* WriteComplete */
+	ADIOI_FAKE_IreadStrided, /* IreadStrided */
+	ADIOI_FAKE_IwriteStrided, /* IwriteStrided */
+	ADIOI_JULEA_Flush, /* Flush */
+	ADIOI_JULEA_Resize, /* Resize */
+	ADIOI_JULEA_Delete, /* Delete */
+	ADIOI_GEN_Feature, /* Features */
+	"JULEA: ROMIO driver for the JULEA storage framework",
+	ADIOI_GEN_IreadStridedColl, /* IreadStridedColl */
+	ADIOI_GEN_IwriteStridedColl, /* IwriteStridedColl */
+#if defined(F_SETLKW64)
+	ADIOI_GEN_SetLock /* SetLock */
+#else
+	ADIOI_GEN_SetLock64 /* SetLock */
+#endif
+};
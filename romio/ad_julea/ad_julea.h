@@ -0,0 +1,44 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef AD_JULEA_H
+#define AD_JULEA_H
+
+#include "adio.h"
+
+extern struct ADIOI_Fns_struct ADIO_JULEA_operations;
+
+void ADIOI_JULEA_Open (ADIO_File, int*);
+void ADIOI_JULEA_Close (ADIO_File, int*);
+
+void ADIOI_JULEA_ReadContig (ADIO_File, void*, MPI_Aint, MPI_Datatype, int, ADIO_Offset, ADIO_Status*, int*);
+void ADIOI_JULEA_WriteContig (ADIO_File, void const*, MPI_Aint, MPI_Datatype, int, ADIO_Offset, ADIO_Status*, int*);
+void ADIOI_JULEA_ReadStrided (ADIO_File, void*, MPI_Aint, MPI_Datatype, int, ADIO_Offset, ADIO_Status*, int*);
+void ADIOI_JULEA_WriteStrided (ADIO_File, void const*, MPI_Aint, MPI_Datatype, int, ADIO_Offset, ADIO_Status*, int*);
+
+void ADIOI_JULEA_Fcntl (ADIO_File, int, ADIO_Fcntl_t*, int*);
+void ADIOI_JULEA_SetInfo (ADIO_File, MPI_Info, int*);
+void ADIOI_JULEA_Flush (ADIO_File, int*);
+void ADIOI_JULEA_Resize (ADIO_File, ADIO_Offset, int*);
+void ADIOI_JULEA_Delete (char const*, int*);
+
+#endif
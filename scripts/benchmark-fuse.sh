@@ -0,0 +1,63 @@
+#!/bin/sh
+
+# JULEA - Flexible storage framework
+# Copyright (C) 2017 Michael Kuhn
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Mounts julea-fuse and runs the FUSE benchmarks, followed by the item benchmarks for comparison.
+# Arguments are passed to julea-benchmark.
+
+set -e
+
+SELF_PATH="$(readlink --canonicalize-existing -- "$0")"
+SELF_DIR="${SELF_PATH%/*}"
+SELF_BASE="${SELF_PATH##*/}"
+
+. "${SELF_DIR}/common"
+
+set_glib_options
+set_path
+set_library_path
+
+run_benchmark ()
+{
+	local mountpoint
+	local i
+
+	mountpoint="$(mktemp --directory --tmpdir julea-fuse.XXXXXX)"
+
+	setup.sh start
+
+	julea-fuse "${mountpoint}"
+
+	# julea-fuse runs in the background, wait for the mount to appear.
+	i=0
+
+	while ! mountpoint --quiet "${mountpoint}" && test ${i} -lt 50
+	do
+		sleep 0.1
+		i=$((i + 1))
+	done
+
+	julea-benchmark --path=/fuse --fuse-mountpoint="${mountpoint}" "$@" || true
+	julea-benchmark --path=/item/item "$@" || true
+
+	fusermount -u "${mountpoint}" || true
+	rmdir "${mountpoint}"
+
+	setup.sh stop
+}
+
+run_benchmark "$@"
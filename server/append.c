@@ -0,0 +1,372 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Appends with server-assigned offsets.
+ *
+ * Appends to the same object are serialized, each one is written at the object's current end.
+ * Threads that append while another append to the same object is being written join the next batch of that object.
+ * The first thread joining a batch becomes its leader, waits until the previous batch has been written and then writes the data of all threads using a single write.
+ * The other threads wait until the batch has been written, their data stays valid in the meantime.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The data of one thread.
+ */
+struct JdAppendPart
+{
+	/**
+	 * The data, NULL if the space should only be reserved.
+	 */
+	gconstpointer data;
+	guint64 length;
+};
+
+typedef struct JdAppendPart JdAppendPart;
+
+struct JdAppendBatch
+{
+	/**
+	 * The parts of all threads, in the order they joined.
+	 */
+	GArray* parts;
+
+	/**
+	 * The total length.
+	 */
+	guint64 length;
+
+	/**
+	 * The offset the batch has been written to.
+	 */
+	guint64 offset;
+
+	/**
+	 * Whether the batch has been written.
+	 */
+	gboolean done;
+
+	/**
+	 * Whether writing the batch succeeded.
+	 */
+	gboolean ret;
+
+	/**
+	 * The number of waiting threads.
+	 */
+	guint ref_count;
+};
+
+typedef struct JdAppendBatch JdAppendBatch;
+
+struct JdAppendObject
+{
+	gchar* key;
+
+	/**
+	 * Whether a batch is being written.
+	 */
+	gboolean busy;
+
+	/**
+	 * The batch new appends are added to, NULL if there is none.
+	 */
+	JdAppendBatch* next;
+
+	/**
+	 * The number of threads appending to the object.
+	 */
+	guint ref_count;
+};
+
+typedef struct JdAppendObject JdAppendObject;
+
+struct JdAppend
+{
+	JBackend* backend;
+
+	/**
+	 * Maps namespaces and paths to objects that are being appended to.
+	 */
+	GHashTable* objects;
+
+	GMutex mutex[1];
+	GCond cond[1];
+};
+
+/**
+ * Writes a batch at the end of the object.
+ * Parts that only reserve space are written as zeros, unless the whole batch only reserves space.
+ */
+static
+gboolean
+jd_append_write_batch (JdAppend* append, gpointer object, JdAppendBatch* batch)
+{
+	g_autofree gchar* buffer = NULL;
+	gconstpointer data;
+	guint64 size = 0;
+	guint64 position = 0;
+	guint64 bytes_written = 0;
+	gboolean reserve = TRUE;
+
+	if (!j_backend_object_status(append->backend, object, NULL, &size))
+	{
+		return FALSE;
+	}
+
+	batch->offset = size;
+
+	for (guint i = 0; i < batch->parts->len; i++)
+	{
+		reserve = reserve && (g_array_index(batch->parts, JdAppendPart, i).data == NULL);
+	}
+
+	if (reserve)
+	{
+		return (append->backend->object.truncate != NULL && j_backend_object_truncate(append->backend, object, size + batch->length));
+	}
+
+	if (batch->parts->len == 1)
+	{
+		data = g_array_index(batch->parts, JdAppendPart, 0).data;
+	}
+	else
+	{
+		buffer = g_malloc(batch->length);
+
+		for (guint i = 0; i < batch->parts->len; i++)
+		{
+			JdAppendPart* part = &g_array_index(batch->parts, JdAppendPart, i);
+
+			if (part->data != NULL)
+			{
+				memcpy(buffer + position, part->data, part->length);
+			}
+			else
+			{
+				memset(buffer + position, 0, part->length);
+			}
+
+			position += part->length;
+		}
+
+		data = buffer;
+	}
+
+	return (j_backend_object_write(append->backend, object, data, batch->length, size, &bytes_written) && bytes_written == batch->length);
+}
+
+/**
+ * Creates a new append coordinator.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param backend An object backend.
+ *
+ * \return A new append coordinator. Should be freed with jd_append_free().
+ **/
+JdAppend*
+jd_append_new (JBackend* backend)
+{
+	JdAppend* append;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+
+	append = g_slice_new(JdAppend);
+	append->backend = backend;
+	append->objects = g_hash_table_new(g_str_hash, g_str_equal);
+
+	g_mutex_init(append->mutex);
+	g_cond_init(append->cond);
+
+	return append;
+}
+
+/**
+ * Frees the memory allocated by the append coordinator.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param append An append coordinator.
+ **/
+void
+jd_append_free (JdAppend* append)
+{
+	g_return_if_fail(append != NULL);
+	g_return_if_fail(g_hash_table_size(append->objects) == 0);
+
+	g_hash_table_destroy(append->objects);
+
+	g_cond_clear(append->cond);
+	g_mutex_clear(append->mutex);
+
+	g_slice_free(JdAppend, append);
+}
+
+/**
+ * Appends data to an object, possibly together with the data of other threads.
+ * Returns only after the data has been written.
+ * Buffered writes of the object have to be flushed before.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param append    An append coordinator.
+ * \param namespace The object's namespace.
+ * \param path      The object's path.
+ * \param object    The backend's object.
+ * \param data      The data, NULL if the space should only be reserved by extending the object.
+ * \param length    The data's length.
+ * \param offset    Returns the offset the data has been written to.
+ *
+ * \return TRUE if the data has been written, FALSE otherwise.
+ **/
+gboolean
+jd_append_write (JdAppend* append, gchar const* namespace, gchar const* path, gpointer object, gconstpointer data, guint64 length, guint64* offset)
+{
+	JdAppendObject* append_object;
+	JdAppendBatch* batch;
+	JdAppendPart part;
+	g_autofree gchar* key = NULL;
+	guint64 position;
+	gboolean leader = FALSE;
+	gboolean ret;
+
+	g_return_val_if_fail(append != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(path != NULL, FALSE);
+	g_return_val_if_fail(object != NULL, FALSE);
+	g_return_val_if_fail(offset != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	key = g_strconcat(namespace, "/", path, NULL);
+
+	part.data = data;
+	part.length = length;
+
+	g_mutex_lock(append->mutex);
+
+	if ((append_object = g_hash_table_lookup(append->objects, key)) == NULL)
+	{
+		append_object = g_slice_new(JdAppendObject);
+		append_object->key = g_steal_pointer(&key);
+		append_object->busy = FALSE;
+		append_object->next = NULL;
+		append_object->ref_count = 0;
+
+		g_hash_table_insert(append->objects, append_object->key, append_object);
+	}
+
+	append_object->ref_count++;
+
+	if ((batch = append_object->next) == NULL)
+	{
+		batch = g_slice_new(JdAppendBatch);
+		batch->parts = g_array_new(FALSE, FALSE, sizeof(JdAppendPart));
+		batch->length = 0;
+		batch->offset = 0;
+		batch->done = FALSE;
+		batch->ret = FALSE;
+		batch->ref_count = 0;
+
+		append_object->next = batch;
+		leader = TRUE;
+	}
+
+	position = batch->length;
+	batch->ref_count++;
+	batch->length += length;
+	g_array_append_val(batch->parts, part);
+
+	if (leader)
+	{
+		/* Other threads keep joining the batch while the previous one is written. */
+		while (append_object->busy)
+		{
+			g_cond_wait(append->cond, append->mutex);
+		}
+
+		append_object->busy = TRUE;
+		append_object->next = NULL;
+
+		g_mutex_unlock(append->mutex);
+
+		ret = jd_append_write_batch(append, object, batch);
+
+		g_mutex_lock(append->mutex);
+
+		batch->ret = ret;
+		batch->done = TRUE;
+		append_object->busy = FALSE;
+		g_cond_broadcast(append->cond);
+	}
+	else
+	{
+		while (!batch->done)
+		{
+			g_cond_wait(append->cond, append->mutex);
+		}
+	}
+
+	*offset = batch->offset + position;
+	ret = batch->ret;
+
+	batch->ref_count--;
+
+	if (batch->ref_count == 0)
+	{
+		g_array_unref(batch->parts);
+		g_slice_free(JdAppendBatch, batch);
+	}
+
+	append_object->ref_count--;
+
+	if (append_object->ref_count == 0)
+	{
+		g_hash_table_remove(append->objects, append_object->key);
+		g_free(append_object->key);
+		g_slice_free(JdAppendObject, append_object);
+	}
+
+	g_mutex_unlock(append->mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
@@ -0,0 +1,296 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Index of recently written blocks for deduplication.
+ *
+ * The index maps the SHA-256 digests of blocks to the locations they have been written to.
+ * Objects are not stored by content, so a location might have been overwritten since; users have to verify a block's digest after reading it.
+ * Once the index is full, the oldest blocks are forgotten first.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+struct JdDedupBlock
+{
+	guint8 digest[J_HELPER_SHA256_SIZE];
+
+	gchar* namespace;
+	gchar* path;
+
+	guint64 length;
+	guint64 offset;
+
+	/**
+	 * The block's link in #JdDedup's queue.
+	 */
+	GList link[1];
+};
+
+typedef struct JdDedupBlock JdDedupBlock;
+
+struct JdDedup
+{
+	/**
+	 * Maps digests to blocks.
+	 */
+	GHashTable* blocks;
+
+	/**
+	 * The blocks, from the newest to the oldest.
+	 */
+	GQueue queue[1];
+
+	/**
+	 * The maximum number of blocks.
+	 */
+	guint capacity;
+
+	GMutex mutex[1];
+};
+
+static
+guint
+jd_dedup_digest_hash (gconstpointer key)
+{
+	guint hash;
+
+	/* The digest is uniformly distributed, so its first bytes suffice. */
+	memcpy(&hash, key, sizeof(hash));
+
+	return hash;
+}
+
+static
+gboolean
+jd_dedup_digest_equal (gconstpointer a, gconstpointer b)
+{
+	return (memcmp(a, b, J_HELPER_SHA256_SIZE) == 0);
+}
+
+static
+void
+jd_dedup_block_free (JdDedup* dedup, JdDedupBlock* block)
+{
+	g_hash_table_remove(dedup->blocks, block->digest);
+	g_queue_unlink(dedup->queue, block->link);
+
+	g_free(block->namespace);
+	g_free(block->path);
+
+	g_slice_free(JdDedupBlock, block);
+}
+
+/**
+ * Creates a new deduplication index.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param capacity The maximum number of blocks.
+ *
+ * \return A new deduplication index. Should be freed with jd_dedup_free().
+ **/
+JdDedup*
+jd_dedup_new (guint capacity)
+{
+	JdDedup* dedup;
+
+	g_return_val_if_fail(capacity > 0, NULL);
+
+	dedup = g_slice_new(JdDedup);
+	dedup->blocks = g_hash_table_new(jd_dedup_digest_hash, jd_dedup_digest_equal);
+	dedup->capacity = capacity;
+
+	g_queue_init(dedup->queue);
+	g_mutex_init(dedup->mutex);
+
+	return dedup;
+}
+
+/**
+ * Frees the memory allocated by the deduplication index.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param dedup A deduplication index.
+ **/
+void
+jd_dedup_free (JdDedup* dedup)
+{
+	g_return_if_fail(dedup != NULL);
+
+	while (dedup->queue->head != NULL)
+	{
+		jd_dedup_block_free(dedup, dedup->queue->head->data);
+	}
+
+	g_hash_table_destroy(dedup->blocks);
+	g_mutex_clear(dedup->mutex);
+
+	g_slice_free(JdDedup, dedup);
+}
+
+/**
+ * Looks up where a block has been written to.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param dedup     A deduplication index.
+ * \param digest    The block's digest.
+ * \param namespace Returns the namespace, should be freed with g_free().
+ * \param path      Returns the path, should be freed with g_free().
+ * \param length    Returns the length.
+ * \param offset    Returns the offset.
+ *
+ * \return TRUE if the block is known, FALSE otherwise.
+ **/
+gboolean
+jd_dedup_lookup (JdDedup* dedup, guint8 const* digest, gchar** namespace, gchar** path, guint64* length, guint64* offset)
+{
+	JdDedupBlock* block;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(dedup != NULL, FALSE);
+	g_return_val_if_fail(digest != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(path != NULL, FALSE);
+	g_return_val_if_fail(length != NULL, FALSE);
+	g_return_val_if_fail(offset != NULL, FALSE);
+
+	g_mutex_lock(dedup->mutex);
+
+	if ((block = g_hash_table_lookup(dedup->blocks, digest)) != NULL)
+	{
+		*namespace = g_strdup(block->namespace);
+		*path = g_strdup(block->path);
+		*length = block->length;
+		*offset = block->offset;
+
+		ret = TRUE;
+	}
+
+	g_mutex_unlock(dedup->mutex);
+
+	return ret;
+}
+
+/**
+ * Remembers where a block has been written to.
+ * A known block with the same digest is replaced.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param dedup     A deduplication index.
+ * \param digest    The block's digest.
+ * \param namespace The namespace.
+ * \param path      The path.
+ * \param length    The length.
+ * \param offset    The offset.
+ **/
+void
+jd_dedup_insert (JdDedup* dedup, guint8 const* digest, gchar const* namespace, gchar const* path, guint64 length, guint64 offset)
+{
+	JdDedupBlock* block;
+
+	g_return_if_fail(dedup != NULL);
+	g_return_if_fail(digest != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(path != NULL);
+
+	block = g_slice_new(JdDedupBlock);
+	memcpy(block->digest, digest, J_HELPER_SHA256_SIZE);
+	block->namespace = g_strdup(namespace);
+	block->path = g_strdup(path);
+	block->length = length;
+	block->offset = offset;
+	block->link->data = block;
+	block->link->prev = NULL;
+	block->link->next = NULL;
+
+	g_mutex_lock(dedup->mutex);
+
+	{
+		JdDedupBlock* old;
+
+		if ((old = g_hash_table_lookup(dedup->blocks, digest)) != NULL)
+		{
+			jd_dedup_block_free(dedup, old);
+		}
+	}
+
+	while (g_queue_get_length(dedup->queue) >= dedup->capacity)
+	{
+		jd_dedup_block_free(dedup, dedup->queue->tail->data);
+	}
+
+	g_hash_table_insert(dedup->blocks, block->digest, block);
+	g_queue_push_head_link(dedup->queue, block->link);
+
+	g_mutex_unlock(dedup->mutex);
+}
+
+/**
+ * Forgets a block, for example because its location has been overwritten.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param dedup  A deduplication index.
+ * \param digest The block's digest.
+ **/
+void
+jd_dedup_remove (JdDedup* dedup, guint8 const* digest)
+{
+	JdDedupBlock* block;
+
+	g_return_if_fail(dedup != NULL);
+	g_return_if_fail(digest != NULL);
+
+	g_mutex_lock(dedup->mutex);
+
+	if ((block = g_hash_table_lookup(dedup->blocks, digest)) != NULL)
+	{
+		jd_dedup_block_free(dedup, block);
+	}
+
+	g_mutex_unlock(dedup->mutex);
+}
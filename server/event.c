@@ -0,0 +1,385 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Event-driven connection handling.
+ *
+ * All connections are registered with a single epoll instance.
+ * A poller thread waits for readable connections and hands them to a fixed pool of worker threads.
+ * Connections are registered with EPOLLONESHOT, so only one worker handles a given connection at a time.
+ * This keeps the per-connection message order of the threaded mode.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * A connection handled by the event loop.
+ */
+struct JdEventConnection
+{
+	/**
+	 * The connection.
+	 */
+	GSocketConnection* connection;
+
+	/**
+	 * The message that is reused for receiving.
+	 */
+	JMessage* message;
+
+	/**
+	 * The connection's statistics.
+	 */
+	JStatistics* statistics;
+
+	/**
+	 * The time at which the connection has become readable.
+	 */
+	gint64 ready;
+
+	/**
+	 * The connection's file descriptor.
+	 */
+	gint fd;
+};
+
+typedef struct JdEventConnection JdEventConnection;
+
+static gint jd_event_epoll_fd = -1;
+static gint jd_event_wakeup_fd = -1;
+static gint jd_event_running = 0;
+
+static GThread* jd_event_thread = NULL;
+static GThreadPool* jd_event_workers = NULL;
+
+/**
+ * All registered connections, used for cleaning up on shutdown.
+ */
+static GHashTable* jd_event_connections = NULL;
+
+G_LOCK_DEFINE_STATIC(jd_event_connections);
+
+static
+void
+jd_event_connection_free (JdEventConnection* event_connection)
+{
+	j_trace_enter(G_STRFUNC, NULL);
+
+	epoll_ctl(jd_event_epoll_fd, EPOLL_CTL_DEL, event_connection->fd, NULL);
+
+	jd_statistics_merge(event_connection->statistics);
+
+	g_io_stream_close(G_IO_STREAM(event_connection->connection), NULL, NULL);
+	g_object_unref(event_connection->connection);
+
+	j_message_unref(event_connection->message);
+	j_statistics_free(event_connection->statistics);
+
+	g_slice_free(JdEventConnection, event_connection);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+static
+gboolean
+jd_event_arm (JdEventConnection* event_connection, gint op)
+{
+	struct epoll_event event;
+
+	event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+	event.data.ptr = event_connection;
+
+	return (epoll_ctl(jd_event_epoll_fd, op, event_connection->fd, &event) == 0);
+}
+
+static
+void
+jd_event_worker (gpointer data, gpointer user_data)
+{
+	JdEventConnection* event_connection = data;
+
+	(void)user_data;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* The socket is readable, so receiving will only block until the rest of the message has arrived. */
+	if (j_message_receive(event_connection->message, event_connection->connection)
+	    && jd_handle_message(event_connection->message, event_connection->connection, event_connection->statistics, event_connection->ready))
+	{
+		/* Has to happen before re-arming, another worker might use the message afterwards. */
+		j_message_reset(event_connection->message);
+
+		if (jd_event_arm(event_connection, EPOLL_CTL_MOD))
+		{
+			goto end;
+		}
+	}
+
+	G_LOCK(jd_event_connections);
+	g_hash_table_remove(jd_event_connections, event_connection);
+	G_UNLOCK(jd_event_connections);
+
+	jd_event_connection_free(event_connection);
+
+end:
+	j_trace_leave(G_STRFUNC);
+}
+
+static
+gpointer
+jd_event_loop (gpointer data)
+{
+	struct epoll_event events[64];
+
+	(void)data;
+
+	while (g_atomic_int_get(&jd_event_running))
+	{
+		gint n;
+
+		n = epoll_wait(jd_event_epoll_fd, events, G_N_ELEMENTS(events), -1);
+
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			J_CRITICAL("epoll_wait failed: %s", g_strerror(errno));
+			break;
+		}
+
+		for (gint i = 0; i < n; i++)
+		{
+			if (events[i].data.ptr == NULL)
+			{
+				guint64 value;
+
+				/* Woken up by jd_event_stop(). */
+				if (read(jd_event_wakeup_fd, &value, sizeof(value)) != sizeof(value))
+				{
+					J_CRITICAL("Could not read wakeup event: %s", g_strerror(errno));
+				}
+
+				continue;
+			}
+
+			((JdEventConnection*)events[i].data.ptr)->ready = g_get_monotonic_time();
+			g_thread_pool_push(jd_event_workers, events[i].data.ptr, NULL);
+		}
+	}
+
+	return NULL;
+}
+
+static
+gboolean
+jd_event_on_incoming (GSocketService* service, GSocketConnection* connection, GObject* source_object, gpointer user_data)
+{
+	JdEventConnection* event_connection;
+
+	(void)service;
+	(void)source_object;
+	(void)user_data;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (G_IS_TCP_CONNECTION(connection))
+	{
+		j_helper_set_nodelay(connection, TRUE);
+	}
+
+	event_connection = g_slice_new(JdEventConnection);
+	event_connection->connection = g_object_ref(connection);
+	event_connection->message = j_message_new(J_MESSAGE_NONE, 0);
+	event_connection->statistics = j_statistics_new(TRUE);
+	event_connection->fd = g_socket_get_fd(g_socket_connection_get_socket(connection));
+
+	jd_statistics_register(event_connection->statistics);
+
+	G_LOCK(jd_event_connections);
+	g_hash_table_add(jd_event_connections, event_connection);
+	G_UNLOCK(jd_event_connections);
+
+	if (!jd_event_arm(event_connection, EPOLL_CTL_ADD))
+	{
+		J_CRITICAL("Could not register connection: %s", g_strerror(errno));
+
+		G_LOCK(jd_event_connections);
+		g_hash_table_remove(jd_event_connections, event_connection);
+		G_UNLOCK(jd_event_connections);
+
+		jd_event_connection_free(event_connection);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return TRUE;
+}
+
+/**
+ * Starts handling the service's connections in event-driven mode.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param service A socket service.
+ * \param threads The number of worker threads, 0 to use one per processor.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+jd_event_start (GSocketService* service, guint threads)
+{
+	struct epoll_event event;
+
+	g_return_val_if_fail(service != NULL, FALSE);
+	g_return_val_if_fail(jd_event_epoll_fd == -1, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	if (threads == 0)
+	{
+		threads = g_get_num_processors();
+	}
+
+	jd_event_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (jd_event_epoll_fd == -1)
+	{
+		goto error;
+	}
+
+	jd_event_wakeup_fd = eventfd(0, EFD_CLOEXEC);
+
+	if (jd_event_wakeup_fd == -1)
+	{
+		goto error;
+	}
+
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+
+	if (epoll_ctl(jd_event_epoll_fd, EPOLL_CTL_ADD, jd_event_wakeup_fd, &event) == -1)
+	{
+		goto error;
+	}
+
+	jd_event_connections = g_hash_table_new(NULL, NULL);
+	jd_event_workers = g_thread_pool_new(jd_event_worker, NULL, threads, TRUE, NULL);
+
+	g_atomic_int_set(&jd_event_running, 1);
+	jd_event_thread = g_thread_new("julea-server-event", jd_event_loop, NULL);
+
+	g_signal_connect(service, "incoming", G_CALLBACK(jd_event_on_incoming), NULL);
+
+	j_trace_leave(G_STRFUNC);
+
+	return TRUE;
+
+error:
+	J_CRITICAL("Could not start event loop: %s", g_strerror(errno));
+
+	if (jd_event_wakeup_fd != -1)
+	{
+		close(jd_event_wakeup_fd);
+		jd_event_wakeup_fd = -1;
+	}
+
+	if (jd_event_epoll_fd != -1)
+	{
+		close(jd_event_epoll_fd);
+		jd_event_epoll_fd = -1;
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return FALSE;
+}
+
+/**
+ * Stops the event loop and closes all remaining connections.
+ * The service has to be stopped before.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ **/
+void
+jd_event_stop (void)
+{
+	GHashTableIter iter;
+	gpointer key;
+	guint64 value = 1;
+
+	g_return_if_fail(jd_event_epoll_fd != -1);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_atomic_int_set(&jd_event_running, 0);
+
+	if (write(jd_event_wakeup_fd, &value, sizeof(value)) != sizeof(value))
+	{
+		J_CRITICAL("Could not wake up event loop: %s", g_strerror(errno));
+	}
+
+	g_thread_join(jd_event_thread);
+	jd_event_thread = NULL;
+
+	/* Wait for all messages that are currently being handled. */
+	g_thread_pool_free(jd_event_workers, FALSE, TRUE);
+	jd_event_workers = NULL;
+
+	g_hash_table_iter_init(&iter, jd_event_connections);
+
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		jd_event_connection_free(key);
+	}
+
+	g_hash_table_destroy(jd_event_connections);
+	jd_event_connections = NULL;
+
+	close(jd_event_wakeup_fd);
+	jd_event_wakeup_fd = -1;
+
+	close(jd_event_epoll_fd);
+	jd_event_epoll_fd = -1;
+
+	j_trace_leave(G_STRFUNC);
+}
@@ -0,0 +1,286 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Group commit for synchronous operations.
+ *
+ * Threads that have to sync objects join the currently open batch.
+ * The first thread joining a batch becomes its leader and waits until the batch's time window has passed or it has reached its maximum size.
+ * The leader then syncs every object of the batch once and wakes up all other threads, which only then send their replies.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+struct JdGroupCommitBatch
+{
+	/**
+	 * The objects to sync.
+	 */
+	GHashTable* objects;
+
+	/**
+	 * The number of requested syncs.
+	 */
+	guint count;
+
+	/**
+	 * Whether the batch has been committed.
+	 */
+	gboolean done;
+
+	/**
+	 * Whether all syncs succeeded.
+	 */
+	gboolean ret;
+
+	/**
+	 * The number of waiting threads.
+	 */
+	guint ref_count;
+};
+
+typedef struct JdGroupCommitBatch JdGroupCommitBatch;
+
+struct JdGroupCommit
+{
+	JBackend* backend;
+
+	/**
+	 * The time window in microseconds.
+	 */
+	guint64 time;
+
+	/**
+	 * The maximum number of syncs per batch.
+	 */
+	guint size;
+
+	/**
+	 * The batch new syncs are added to, NULL if there is none.
+	 */
+	JdGroupCommitBatch* current;
+
+	GMutex mutex[1];
+	GCond cond[1];
+};
+
+JdGroupCommit*
+jd_group_commit_new (JBackend* backend, guint64 time, guint size)
+{
+	JdGroupCommit* group_commit;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+
+	group_commit = g_slice_new(JdGroupCommit);
+	group_commit->backend = backend;
+	group_commit->time = time;
+	group_commit->size = (size > 0) ? size : G_MAXUINT;
+	group_commit->current = NULL;
+
+	g_mutex_init(group_commit->mutex);
+	g_cond_init(group_commit->cond);
+
+	return group_commit;
+}
+
+void
+jd_group_commit_free (JdGroupCommit* group_commit)
+{
+	g_return_if_fail(group_commit != NULL);
+	g_return_if_fail(group_commit->current == NULL);
+
+	g_cond_clear(group_commit->cond);
+	g_mutex_clear(group_commit->mutex);
+
+	g_slice_free(JdGroupCommit, group_commit);
+}
+
+/**
+ * Returns whether syncs are issued directly instead of being grouped.
+ * Callers can then sync together with their writes instead of calling jd_group_commit_sync().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param group_commit A group commit.
+ *
+ * \return TRUE if there is no time window, FALSE otherwise.
+ **/
+gboolean
+jd_group_commit_is_direct (JdGroupCommit* group_commit)
+{
+	g_return_val_if_fail(group_commit != NULL, FALSE);
+
+	return (group_commit->time == 0);
+}
+
+/**
+ * Syncs the given objects, possibly together with objects of other threads.
+ * Returns only after all objects have been synced.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param group_commit A group commit.
+ * \param objects      The backend objects.
+ * \param objects_len  The number of objects.
+ * \param statistics   The statistics syncs issued by this thread are accounted to.
+ *
+ * \return TRUE if all syncs of the batch succeeded, FALSE otherwise.
+ **/
+gboolean
+jd_group_commit_sync (JdGroupCommit* group_commit, gpointer* objects, guint objects_len, JStatistics* statistics)
+{
+	JdGroupCommitBatch* batch;
+	gboolean leader = FALSE;
+	gboolean ret;
+
+	g_return_val_if_fail(group_commit != NULL, FALSE);
+	g_return_val_if_fail(objects != NULL || objects_len == 0, FALSE);
+
+	if (objects_len == 0)
+	{
+		return TRUE;
+	}
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	/* Without a time window, sync directly. */
+	if (group_commit->time == 0)
+	{
+		ret = TRUE;
+
+		for (guint i = 0; i < objects_len; i++)
+		{
+			ret = j_backend_object_sync(group_commit->backend, objects[i]) && ret;
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_SYNC, objects_len);
+
+		goto end;
+	}
+
+	g_mutex_lock(group_commit->mutex);
+
+	if (group_commit->current == NULL)
+	{
+		batch = g_slice_new(JdGroupCommitBatch);
+		batch->objects = g_hash_table_new(NULL, NULL);
+		batch->count = 0;
+		batch->done = FALSE;
+		batch->ret = TRUE;
+		batch->ref_count = 0;
+
+		group_commit->current = batch;
+		leader = TRUE;
+	}
+
+	batch = group_commit->current;
+	batch->ref_count++;
+
+	for (guint i = 0; i < objects_len; i++)
+	{
+		g_hash_table_add(batch->objects, objects[i]);
+	}
+
+	batch->count += objects_len;
+
+	if (leader)
+	{
+		GHashTableIter iter;
+		gpointer object;
+		gint64 deadline;
+		guint syncs = 0;
+
+		deadline = g_get_monotonic_time() + group_commit->time;
+
+		while (batch->count < group_commit->size)
+		{
+			if (!g_cond_wait_until(group_commit->cond, group_commit->mutex, deadline))
+			{
+				break;
+			}
+		}
+
+		/* Close the batch, new syncs will start a new one while this one is committed. */
+		group_commit->current = NULL;
+
+		g_mutex_unlock(group_commit->mutex);
+
+		g_hash_table_iter_init(&iter, batch->objects);
+
+		while (g_hash_table_iter_next(&iter, &object, NULL))
+		{
+			if (!j_backend_object_sync(group_commit->backend, object))
+			{
+				batch->ret = FALSE;
+			}
+
+			syncs++;
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_SYNC, syncs);
+
+		g_mutex_lock(group_commit->mutex);
+
+		batch->done = TRUE;
+		g_cond_broadcast(group_commit->cond);
+	}
+	else
+	{
+		if (batch->count >= group_commit->size)
+		{
+			/* Wake up the leader. */
+			g_cond_broadcast(group_commit->cond);
+		}
+
+		while (!batch->done)
+		{
+			g_cond_wait(group_commit->cond, group_commit->mutex);
+		}
+	}
+
+	ret = batch->ret;
+	batch->ref_count--;
+
+	if (batch->ref_count == 0)
+	{
+		g_hash_table_destroy(batch->objects);
+		g_slice_free(JdGroupCommitBatch, batch);
+	}
+
+	g_mutex_unlock(group_commit->mutex);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
@@ -0,0 +1,857 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A cache for open object handles that is shared by all of the server's threads.
+ *
+ * Handles are looked up by namespace and path.
+ * Unused handles are kept open and evicted in least recently used order as soon as the cache is full.
+ *
+ * Additionally, every handle can buffer small writes to coalesce adjacent or overlapping ones across messages.
+ * Buffered data is written when the buffer is full, when it has become too old, before the object is read or synced and when the handle is closed.
+ * If a journal is given, buffered writes are appended to it, so that they are not lost if the server crashes.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * A cached handle.
+ */
+struct JdHandleCacheEntry
+{
+	/**
+	 * The key, i.e. namespace and path.
+	 * NULL if the entry has been invalidated.
+	 */
+	gchar* key;
+
+	/**
+	 * The namespace and path, which are kept even if the entry has been invalidated.
+	 */
+	gchar* namespace;
+	gchar* path;
+
+	/**
+	 * The backend's object.
+	 */
+	gpointer object;
+
+	/**
+	 * The link into the LRU queue.
+	 * NULL while the handle is in use.
+	 */
+	GList* link;
+
+	/**
+	 * The number of current users.
+	 */
+	guint ref_count;
+
+	/**
+	 * The write buffer.
+	 */
+	struct
+	{
+		/**
+		 * The buffered data, NULL if nothing has been buffered yet.
+		 */
+		gchar* data;
+
+		/**
+		 * The object offset of the buffered data.
+		 */
+		guint64 offset;
+
+		/**
+		 * The length of the buffered data.
+		 */
+		guint64 length;
+
+		/**
+		 * The time of the first buffered write.
+		 */
+		gint64 time;
+
+		GMutex mutex[1];
+	}
+	buffer;
+};
+
+typedef struct JdHandleCacheEntry JdHandleCacheEntry;
+
+struct JdHandleCache
+{
+	JBackend* backend;
+
+	/**
+	 * Maps keys to entries.
+	 */
+	GHashTable* entries;
+
+	/**
+	 * Unused entries, the least recently used one at the head.
+	 */
+	GQueue* lru;
+
+	/**
+	 * The maximum number of cached handles.
+	 */
+	guint capacity;
+
+	/**
+	 * The size of each handle's write buffer, 0 if writes should not be buffered.
+	 */
+	guint64 buffer_size;
+
+	/**
+	 * The journal buffered writes are appended to, NULL if there is none.
+	 */
+	JdJournal* journal;
+
+	GMutex mutex[1];
+};
+
+static
+gchar*
+jd_handle_cache_key (gchar const* namespace, gchar const* path)
+{
+	return g_strconcat(namespace, "/", path, NULL);
+}
+
+/* Must be called with the mutex held. */
+static
+void
+jd_handle_cache_entry_unlink (JdHandleCache* cache, JdHandleCacheEntry* entry)
+{
+	if (entry->link != NULL)
+	{
+		g_queue_delete_link(cache->lru, entry->link);
+		entry->link = NULL;
+	}
+
+	if (entry->key != NULL)
+	{
+		g_hash_table_remove(cache->entries, entry->key);
+		g_free(entry->key);
+		entry->key = NULL;
+	}
+}
+
+/* Must be called with the entry's buffer mutex held. */
+static
+gboolean
+jd_handle_cache_entry_flush (JdHandleCache* cache, JdHandleCacheEntry* entry)
+{
+	gboolean ret = TRUE;
+
+	if (entry->buffer.length > 0)
+	{
+		guint64 bytes_written = 0;
+
+		ret = j_backend_object_write(cache->backend, entry->object, entry->buffer.data, entry->buffer.length, entry->buffer.offset, &bytes_written);
+
+		entry->buffer.offset = 0;
+		entry->buffer.length = 0;
+	}
+
+	return ret;
+}
+
+static
+JdHandleCacheEntry*
+jd_handle_cache_entry_new (gpointer object, gchar const* namespace, gchar const* path)
+{
+	JdHandleCacheEntry* entry;
+
+	entry = g_slice_new(JdHandleCacheEntry);
+	entry->key = NULL;
+	entry->namespace = g_strdup(namespace);
+	entry->path = g_strdup(path);
+	entry->object = object;
+	entry->link = NULL;
+	entry->ref_count = 1;
+	entry->buffer.data = NULL;
+	entry->buffer.offset = 0;
+	entry->buffer.length = 0;
+	entry->buffer.time = 0;
+
+	g_mutex_init(entry->buffer.mutex);
+
+	return entry;
+}
+
+static
+void
+jd_handle_cache_entry_free (JdHandleCache* cache, JdHandleCacheEntry* entry)
+{
+	/* Nobody else can access the entry anymore. */
+	jd_handle_cache_entry_flush(cache, entry);
+
+	j_backend_object_close(cache->backend, entry->object);
+
+	g_free(entry->buffer.data);
+	g_mutex_clear(entry->buffer.mutex);
+
+	g_free(entry->namespace);
+	g_free(entry->path);
+
+	g_slice_free(JdHandleCacheEntry, entry);
+}
+
+/* Must be called with the mutex held, returns the entries that have to be closed. */
+static
+GList*
+jd_handle_cache_evict (JdHandleCache* cache)
+{
+	GList* evicted = NULL;
+
+	while (g_hash_table_size(cache->entries) > cache->capacity && !g_queue_is_empty(cache->lru))
+	{
+		JdHandleCacheEntry* entry;
+
+		entry = g_queue_peek_head(cache->lru);
+		jd_handle_cache_entry_unlink(cache, entry);
+
+		evicted = g_list_prepend(evicted, entry);
+	}
+
+	return evicted;
+}
+
+JdHandleCache*
+jd_handle_cache_new (JBackend* backend, guint capacity, guint64 buffer_size, JdJournal* journal)
+{
+	JdHandleCache* cache;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+
+	cache = g_slice_new(JdHandleCache);
+	cache->backend = backend;
+	cache->entries = g_hash_table_new(g_str_hash, g_str_equal);
+	cache->lru = g_queue_new();
+	cache->capacity = capacity;
+	cache->buffer_size = buffer_size;
+	cache->journal = journal;
+
+	g_mutex_init(cache->mutex);
+
+	return cache;
+}
+
+void
+jd_handle_cache_free (JdHandleCache* cache)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail(cache != NULL);
+
+	/* All handles have been released at this point. */
+	g_hash_table_iter_init(&iter, cache->entries);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JdHandleCacheEntry* entry = value;
+
+		g_assert(entry->ref_count == 0);
+
+		g_free(entry->key);
+		jd_handle_cache_entry_free(cache, entry);
+	}
+
+	g_queue_free(cache->lru);
+	g_hash_table_destroy(cache->entries);
+
+	g_mutex_clear(cache->mutex);
+
+	g_slice_free(JdHandleCache, cache);
+}
+
+/**
+ * Creates an object that could not be opened.
+ *
+ * \private
+ **/
+static
+gboolean
+jd_handle_cache_create_object (JdHandleCache* cache, gchar const* namespace, gchar const* path, gpointer* object)
+{
+	if (*object != NULL)
+	{
+		j_backend_object_close(cache->backend, *object);
+		*object = NULL;
+	}
+
+	return j_backend_object_create(cache->backend, namespace, path, object);
+}
+
+/**
+ * Returns a handle for the given object, opening it if it is not cached.
+ * If create is TRUE, objects that do not exist are created.
+ *
+ * \private
+ **/
+static
+gpointer
+jd_handle_cache_get (JdHandleCache* cache, gchar const* namespace, gchar const* path, gboolean create, gpointer* object)
+{
+	JdHandleCacheEntry* entry;
+	g_autofree gchar* key = NULL;
+	gpointer new_object = NULL;
+
+	g_return_val_if_fail(cache != NULL, NULL);
+	g_return_val_if_fail(namespace != NULL, NULL);
+	g_return_val_if_fail(path != NULL, NULL);
+	g_return_val_if_fail(object != NULL, NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	key = jd_handle_cache_key(namespace, path);
+
+	g_mutex_lock(cache->mutex);
+
+	if ((entry = g_hash_table_lookup(cache->entries, key)) != NULL)
+	{
+		goto hit;
+	}
+
+	g_mutex_unlock(cache->mutex);
+
+	/* Do not hold the lock while opening, other threads might be able to use cached handles in the meantime. */
+	if (!j_backend_object_open(cache->backend, namespace, path, &new_object)
+	    && (!create || !jd_handle_cache_create_object(cache, namespace, path, &new_object)))
+	{
+		if (new_object != NULL)
+		{
+			j_backend_object_close(cache->backend, new_object);
+		}
+
+		entry = NULL;
+		*object = NULL;
+
+		goto end;
+	}
+
+	g_mutex_lock(cache->mutex);
+
+	entry = jd_handle_cache_entry_new(new_object, namespace, path);
+
+	/* If another thread has opened the same object in the meantime, the handle is not cached and closed when it is released. */
+	if (!g_hash_table_contains(cache->entries, key))
+	{
+		entry->key = g_steal_pointer(&key);
+		g_hash_table_insert(cache->entries, entry->key, entry);
+	}
+
+	*object = entry->object;
+
+	g_mutex_unlock(cache->mutex);
+
+	goto end;
+
+hit:
+	if (entry->link != NULL)
+	{
+		g_queue_delete_link(cache->lru, entry->link);
+		entry->link = NULL;
+	}
+
+	entry->ref_count++;
+	*object = entry->object;
+
+	g_mutex_unlock(cache->mutex);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return entry;
+}
+
+/**
+ * Returns a handle for the given object, opening it if it is not cached.
+ * The handle has to be released using jd_handle_cache_release().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache     A handle cache.
+ * \param namespace A namespace.
+ * \param path      A path.
+ * \param object    Returns the backend's object.
+ *
+ * \return A handle on success, NULL if the object could not be opened.
+ **/
+gpointer
+jd_handle_cache_open (JdHandleCache* cache, gchar const* namespace, gchar const* path, gpointer* object)
+{
+	return jd_handle_cache_get(cache, namespace, path, FALSE, object);
+}
+
+/**
+ * Returns a handle for the given object like jd_handle_cache_open(), creating the object if it does not exist.
+ * This allows writes to create objects implicitly.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache     A handle cache.
+ * \param namespace A namespace.
+ * \param path      A path.
+ * \param object    Returns the backend's object.
+ *
+ * \return A handle on success, NULL if the object could not be opened or created.
+ **/
+gpointer
+jd_handle_cache_create (JdHandleCache* cache, gchar const* namespace, gchar const* path, gpointer* object)
+{
+	return jd_handle_cache_get(cache, namespace, path, TRUE, object);
+}
+
+/**
+ * Releases a handle returned by jd_handle_cache_open().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache  A handle cache.
+ * \param handle A handle.
+ **/
+void
+jd_handle_cache_release (JdHandleCache* cache, gpointer handle)
+{
+	JdHandleCacheEntry* entry = handle;
+	GList* evicted = NULL;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(handle != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(cache->mutex);
+
+	g_assert(entry->ref_count > 0);
+	entry->ref_count--;
+
+	if (entry->ref_count == 0)
+	{
+		if (entry->key == NULL)
+		{
+			/* The entry has been invalidated or was never cached. */
+			evicted = g_list_prepend(evicted, entry);
+		}
+		else
+		{
+			g_queue_push_tail(cache->lru, entry);
+			entry->link = g_queue_peek_tail_link(cache->lru);
+
+			evicted = jd_handle_cache_evict(cache);
+		}
+	}
+
+	g_mutex_unlock(cache->mutex);
+
+	/* Close outside of the lock. */
+	for (GList* l = evicted; l != NULL; l = l->next)
+	{
+		jd_handle_cache_entry_free(cache, l->data);
+	}
+
+	g_list_free(evicted);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Acquires another reference to a handle that is in use, without looking it up again.
+ * The additional reference has to be released using jd_handle_cache_release().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache  A handle cache.
+ * \param handle A handle.
+ * \param object Returns the backend's object.
+ *
+ * \return The handle.
+ **/
+gpointer
+jd_handle_cache_ref (JdHandleCache* cache, gpointer handle, gpointer* object)
+{
+	JdHandleCacheEntry* entry = handle;
+
+	g_return_val_if_fail(cache != NULL, NULL);
+	g_return_val_if_fail(handle != NULL, NULL);
+	g_return_val_if_fail(object != NULL, NULL);
+
+	g_mutex_lock(cache->mutex);
+
+	/* Handles in use are not part of the LRU queue, so they cannot be evicted in the meantime. */
+	g_assert(entry->ref_count > 0);
+	entry->ref_count++;
+	*object = entry->object;
+
+	g_mutex_unlock(cache->mutex);
+
+	return handle;
+}
+
+/**
+ * Returns the namespace and path of a handle.
+ * They stay valid until the handle is released, even if it has been invalidated in the meantime.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param handle    A handle.
+ * \param namespace Returns the namespace.
+ * \param path      Returns the path.
+ **/
+void
+jd_handle_cache_get_name (gpointer handle, gchar const** namespace, gchar const** path)
+{
+	JdHandleCacheEntry* entry = handle;
+
+	g_return_if_fail(handle != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(path != NULL);
+
+	*namespace = entry->namespace;
+	*path = entry->path;
+}
+
+/**
+ * Invalidates the cached handle for the given object, for instance, because the object is about to be deleted.
+ * Handles that are still in use remain valid until they are released.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache     A handle cache.
+ * \param namespace A namespace.
+ * \param path      A path.
+ **/
+void
+jd_handle_cache_invalidate (JdHandleCache* cache, gchar const* namespace, gchar const* path)
+{
+	JdHandleCacheEntry* entry;
+	g_autofree gchar* key = NULL;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(path != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	key = jd_handle_cache_key(namespace, path);
+
+	g_mutex_lock(cache->mutex);
+
+	if ((entry = g_hash_table_lookup(cache->entries, key)) != NULL)
+	{
+		jd_handle_cache_entry_unlink(cache, entry);
+
+		/* Handles that are in use will be closed when they are released. */
+		if (entry->ref_count > 0)
+		{
+			entry = NULL;
+		}
+	}
+
+	g_mutex_unlock(cache->mutex);
+
+	if (entry != NULL)
+	{
+		jd_handle_cache_entry_free(cache, entry);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Invalidates the cached handles of all objects below a directory.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache     A handle cache.
+ * \param namespace A namespace.
+ * \param directory A directory.
+ **/
+void
+jd_handle_cache_invalidate_directory (JdHandleCache* cache, gchar const* namespace, gchar const* directory)
+{
+	GHashTableIter iter;
+	GList* invalidated = NULL;
+	GList* freed = NULL;
+	g_autofree gchar* prefix = NULL;
+	gpointer value;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(directory != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	prefix = g_strconcat(namespace, "/", directory, "/", NULL);
+
+	g_mutex_lock(cache->mutex);
+
+	g_hash_table_iter_init(&iter, cache->entries);
+
+	/* Unlinking removes entries from the table, so it can not be done while iterating. */
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JdHandleCacheEntry* entry = value;
+
+		if (g_str_has_prefix(entry->key, prefix))
+		{
+			invalidated = g_list_prepend(invalidated, entry);
+		}
+	}
+
+	for (GList* link = invalidated; link != NULL; link = link->next)
+	{
+		JdHandleCacheEntry* entry = link->data;
+
+		jd_handle_cache_entry_unlink(cache, entry);
+
+		/* Handles that are in use will be closed when they are released. */
+		if (entry->ref_count == 0)
+		{
+			freed = g_list_prepend(freed, entry);
+		}
+	}
+
+	g_mutex_unlock(cache->mutex);
+
+	for (GList* link = freed; link != NULL; link = link->next)
+	{
+		jd_handle_cache_entry_free(cache, link->data);
+	}
+
+	g_list_free(invalidated);
+	g_list_free(freed);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Writes data to an object, coalescing it with previous writes if possible.
+ * Writes that can not be buffered are written directly after buffered data has been written.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache         A handle cache.
+ * \param handle        A handle.
+ * \param data          The data.
+ * \param length        The data's length.
+ * \param offset        The object offset.
+ * \param bytes_written Returns the number of bytes written or buffered.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+jd_handle_cache_write (JdHandleCache* cache, gpointer handle, gconstpointer data, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JdHandleCacheEntry* entry = handle;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(cache != NULL, FALSE);
+	g_return_val_if_fail(handle != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+	g_return_val_if_fail(bytes_written != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(entry->buffer.mutex);
+
+	if (cache->buffer_size > 0 && length <= cache->buffer_size)
+	{
+		guint64 buffer_end;
+
+		buffer_end = entry->buffer.offset + entry->buffer.length;
+
+		/* The write has to start within or directly after the buffered data and the result has to fit. */
+		if (entry->buffer.length > 0
+		    && (offset < entry->buffer.offset || offset > buffer_end || offset + length - entry->buffer.offset > cache->buffer_size))
+		{
+			ret = jd_handle_cache_entry_flush(cache, entry);
+		}
+
+		if (entry->buffer.data == NULL)
+		{
+			entry->buffer.data = g_malloc(cache->buffer_size);
+		}
+
+		/* Journaled while holding the buffer's lock, so that a checkpoint flushing the buffer also writes this data. */
+		if (cache->journal != NULL)
+		{
+			jd_journal_append(cache->journal, entry->namespace, entry->path, data, length, offset);
+		}
+
+		if (entry->buffer.length == 0)
+		{
+			entry->buffer.offset = offset;
+			entry->buffer.time = g_get_monotonic_time();
+		}
+
+		memcpy(entry->buffer.data + (offset - entry->buffer.offset), data, length);
+		entry->buffer.length = MAX(entry->buffer.length, offset + length - entry->buffer.offset);
+
+		*bytes_written = length;
+
+		if (entry->buffer.length == cache->buffer_size)
+		{
+			ret = jd_handle_cache_entry_flush(cache, entry) && ret;
+		}
+	}
+	else
+	{
+		ret = jd_handle_cache_entry_flush(cache, entry);
+		ret = j_backend_object_write(cache->backend, entry->object, data, length, offset, bytes_written) && ret;
+	}
+
+	g_mutex_unlock(entry->buffer.mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Writes an object's buffered data.
+ * Has to be called before the object is accessed in other ways than using jd_handle_cache_write().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache  A handle cache.
+ * \param handle A handle.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+jd_handle_cache_flush (JdHandleCache* cache, gpointer handle)
+{
+	JdHandleCacheEntry* entry = handle;
+	gboolean ret;
+
+	g_return_val_if_fail(cache != NULL, FALSE);
+	g_return_val_if_fail(handle != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	g_mutex_lock(entry->buffer.mutex);
+	ret = jd_handle_cache_entry_flush(cache, entry);
+	g_mutex_unlock(entry->buffer.mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Writes all buffered data that is older than the given age.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache   A handle cache.
+ * \param max_age The maximum age in microseconds.
+ **/
+void
+jd_handle_cache_flush_expired (JdHandleCache* cache, gint64 max_age)
+{
+	GHashTableIter iter;
+	GList* expired = NULL;
+	gpointer value;
+	gint64 now;
+
+	g_return_if_fail(cache != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(cache->mutex);
+
+	g_hash_table_iter_init(&iter, cache->entries);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		JdHandleCacheEntry* entry = value;
+
+		/* Reading the length without holding the buffer mutex is only a hint. */
+		if (entry->buffer.length > 0 && now - entry->buffer.time >= max_age)
+		{
+			/* Keep the entry from being evicted while it is flushed. */
+			if (entry->link != NULL)
+			{
+				g_queue_delete_link(cache->lru, entry->link);
+				entry->link = NULL;
+			}
+
+			entry->ref_count++;
+			expired = g_list_prepend(expired, entry);
+		}
+	}
+
+	g_mutex_unlock(cache->mutex);
+
+	for (GList* l = expired; l != NULL; l = l->next)
+	{
+		jd_handle_cache_flush(cache, l->data);
+		jd_handle_cache_release(cache, l->data);
+	}
+
+	g_list_free(expired);
+
+	j_trace_leave(G_STRFUNC);
+}
@@ -0,0 +1,797 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Inline storage of small objects.
+ *
+ * Wraps the object backend, so that objects up to a configurable size are stored in the key-value backend instead.
+ * Such objects do not need a file, a file descriptor or an inode.
+ * As soon as an object grows beyond the size, it is moved to the object backend.
+ * The key-value entry is only deleted after the object has been synced, so it is authoritative as long as it exists.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * The key-value namespace of inline objects.
+ */
+#define JD_INLINE_NAMESPACE "julea-inline"
+
+struct JdInlineObject
+{
+	/**
+	 * The object's namespace.
+	 */
+	gchar* namespace;
+
+	/**
+	 * The object's path.
+	 */
+	gchar* path;
+
+	/**
+	 * The object's key within the key-value backend.
+	 */
+	gchar* key;
+
+	/**
+	 * The object backend's handle, NULL while the object is stored inline.
+	 */
+	gpointer object;
+};
+
+typedef struct JdInlineObject JdInlineObject;
+
+static JBackend* jd_inline_object_backend = NULL;
+static JBackend* jd_inline_kv_backend = NULL;
+static guint64 jd_inline_size = 0;
+
+/**
+ * Serializes modifications of inline objects, including moving them to the object backend.
+ */
+static GMutex jd_inline_mutex;
+
+static JBackend jd_inline_backend_wrapper;
+
+static
+JdInlineObject*
+jd_inline_object_new (gchar const* namespace, gchar const* path)
+{
+	JdInlineObject* inline_object;
+
+	inline_object = g_slice_new(JdInlineObject);
+	inline_object->namespace = g_strdup(namespace);
+	inline_object->path = g_strdup(path);
+	inline_object->key = g_strdup_printf("%s/%s", namespace, path);
+	inline_object->object = NULL;
+
+	return inline_object;
+}
+
+static
+void
+jd_inline_object_free (JdInlineObject* inline_object)
+{
+	g_free(inline_object->namespace);
+	g_free(inline_object->path);
+	g_free(inline_object->key);
+
+	g_slice_free(JdInlineObject, inline_object);
+}
+
+/**
+ * Loads an inline object's data.
+ *
+ * \param inline_object     An inline object.
+ * \param data              Returns the data, if not NULL. Should be freed with g_byte_array_unref().
+ * \param modification_time Returns the modification time, if not NULL.
+ *
+ * \return TRUE if the object is stored inline, FALSE otherwise.
+ */
+static
+gboolean
+jd_inline_object_load (JdInlineObject* inline_object, GByteArray** data, gint64* modification_time)
+{
+	bson_t value[1];
+	bson_iter_t iter;
+
+	if (!j_backend_kv_get(jd_inline_kv_backend, JD_INLINE_NAMESPACE, inline_object->key, value))
+	{
+		return FALSE;
+	}
+
+	if (data != NULL)
+	{
+		*data = g_byte_array_new();
+
+		if (bson_iter_init_find(&iter, value, "data") && BSON_ITER_HOLDS_BINARY(&iter))
+		{
+			bson_subtype_t subtype;
+			guint8 const* binary;
+			guint32 binary_len;
+
+			bson_iter_binary(&iter, &subtype, &binary_len, &binary);
+			g_byte_array_append(*data, binary, binary_len);
+		}
+	}
+
+	if (modification_time != NULL)
+	{
+		*modification_time = 0;
+
+		if (bson_iter_init_find(&iter, value, "modification_time") && BSON_ITER_HOLDS_INT64(&iter))
+		{
+			*modification_time = bson_iter_int64(&iter);
+		}
+	}
+
+	bson_destroy(value);
+
+	return TRUE;
+}
+
+static
+gboolean
+jd_inline_object_store (JdInlineObject* inline_object, GByteArray* data, JSemanticsSafety safety)
+{
+	bson_t value[1];
+	gpointer batch;
+	gboolean ret = FALSE;
+
+	bson_init(value);
+	bson_append_binary(value, "data", -1, BSON_SUBTYPE_BINARY, data->data, data->len);
+	bson_append_int64(value, "modification_time", -1, g_get_real_time());
+
+	if (j_backend_kv_batch_start(jd_inline_kv_backend, JD_INLINE_NAMESPACE, safety, &batch))
+	{
+		ret = j_backend_kv_put(jd_inline_kv_backend, batch, inline_object->key, value);
+		ret = j_backend_kv_batch_execute(jd_inline_kv_backend, batch) && ret;
+	}
+
+	bson_destroy(value);
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_object_remove (JdInlineObject* inline_object)
+{
+	gpointer batch;
+	gboolean ret = FALSE;
+
+	/* The entry takes precedence over the object backend, so its removal has to be persistent. */
+	if (j_backend_kv_batch_start(jd_inline_kv_backend, JD_INLINE_NAMESPACE, J_SEMANTICS_SAFETY_STORAGE, &batch))
+	{
+		ret = j_backend_kv_delete(jd_inline_kv_backend, batch, inline_object->key);
+		ret = j_backend_kv_batch_execute(jd_inline_kv_backend, batch) && ret;
+	}
+
+	return ret;
+}
+
+/**
+ * Checks whether an object is stored inline.
+ * Must be called with jd_inline_mutex held.
+ * If the object is not stored inline (anymore), it is opened in the object backend.
+ *
+ * \return TRUE if the object is stored inline, FALSE otherwise.
+ */
+static
+gboolean
+jd_inline_object_resolve (JdInlineObject* inline_object, GByteArray** data, gint64* modification_time)
+{
+	gpointer object;
+
+	if (inline_object->object != NULL)
+	{
+		return FALSE;
+	}
+
+	if (jd_inline_object_load(inline_object, data, modification_time))
+	{
+		return TRUE;
+	}
+
+	/* Another handle has moved the object to the object backend in the meantime. */
+	if (j_backend_object_open(jd_inline_object_backend, inline_object->namespace, inline_object->path, &object))
+	{
+		g_atomic_pointer_set(&(inline_object->object), object);
+	}
+
+	return FALSE;
+}
+
+/**
+ * Moves an inline object to the object backend.
+ * Must be called with jd_inline_mutex held.
+ */
+static
+gboolean
+jd_inline_object_promote (JdInlineObject* inline_object, GByteArray* data)
+{
+	gpointer object;
+	guint64 bytes_written;
+
+	if (!j_backend_object_create(jd_inline_object_backend, inline_object->namespace, inline_object->path, &object))
+	{
+		return FALSE;
+	}
+
+	/* Remove leftovers of a previous attempt that has been interrupted. */
+	if (jd_inline_object_backend->object.truncate != NULL)
+	{
+		j_backend_object_truncate(jd_inline_object_backend, object, 0);
+	}
+
+	if ((data->len > 0 && !j_backend_object_write(jd_inline_object_backend, object, data->data, data->len, 0, &bytes_written))
+	    || !j_backend_object_sync(jd_inline_object_backend, object)
+	    || !jd_inline_object_remove(inline_object))
+	{
+		j_backend_object_close(jd_inline_object_backend, object);
+
+		return FALSE;
+	}
+
+	g_atomic_pointer_set(&(inline_object->object), object);
+
+	return TRUE;
+}
+
+/**
+ * Resizes an inline object's data, new data is zeroed.
+ */
+static
+void
+jd_inline_data_resize (GByteArray* data, guint64 size)
+{
+	guint old_len = data->len;
+
+	g_byte_array_set_size(data, size);
+
+	if (size > old_len)
+	{
+		memset(data->data + old_len, 0, size - old_len);
+	}
+}
+
+static
+gboolean
+jd_inline_create (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JdInlineObject* inline_object;
+	g_autoptr(GByteArray) inline_data = NULL;
+	gpointer object;
+	gboolean ret = TRUE;
+
+	inline_object = jd_inline_object_new(namespace, path);
+
+	g_mutex_lock(&jd_inline_mutex);
+
+	/* Existing objects are kept, as with the object backends. */
+	if (!jd_inline_object_load(inline_object, NULL, NULL))
+	{
+		if (j_backend_object_open(jd_inline_object_backend, namespace, path, &object))
+		{
+			inline_object->object = object;
+		}
+		else
+		{
+			inline_data = g_byte_array_new();
+			ret = jd_inline_object_store(inline_object, inline_data, J_SEMANTICS_SAFETY_NETWORK);
+		}
+	}
+
+	g_mutex_unlock(&jd_inline_mutex);
+
+	if (!ret)
+	{
+		jd_inline_object_free(inline_object);
+		inline_object = NULL;
+	}
+
+	*data = inline_object;
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_open (gchar const* namespace, gchar const* path, gpointer* data)
+{
+	JdInlineObject* inline_object;
+	gboolean ret;
+
+	inline_object = jd_inline_object_new(namespace, path);
+
+	g_mutex_lock(&jd_inline_mutex);
+	ret = jd_inline_object_resolve(inline_object, NULL, NULL) || inline_object->object != NULL;
+	g_mutex_unlock(&jd_inline_mutex);
+
+	if (!ret)
+	{
+		jd_inline_object_free(inline_object);
+		inline_object = NULL;
+	}
+
+	*data = inline_object;
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_close (gpointer data)
+{
+	JdInlineObject* inline_object = data;
+	gboolean ret = TRUE;
+
+	if (inline_object->object != NULL)
+	{
+		ret = j_backend_object_close(jd_inline_object_backend, inline_object->object);
+	}
+
+	jd_inline_object_free(inline_object);
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_delete (gpointer data)
+{
+	JdInlineObject* inline_object = data;
+	gboolean ret = FALSE;
+
+	g_mutex_lock(&jd_inline_mutex);
+
+	if (jd_inline_object_resolve(inline_object, NULL, NULL))
+	{
+		ret = jd_inline_object_remove(inline_object);
+	}
+
+	g_mutex_unlock(&jd_inline_mutex);
+
+	/* Deleting closes the object backend's handle. */
+	if (inline_object->object != NULL)
+	{
+		ret = j_backend_object_delete(jd_inline_object_backend, inline_object->object);
+	}
+
+	jd_inline_object_free(inline_object);
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_status (gpointer data, gint64* modification_time, guint64* size)
+{
+	JdInlineObject* inline_object = data;
+	g_autoptr(GByteArray) inline_data = NULL;
+	gpointer object;
+	gboolean found;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		g_mutex_lock(&jd_inline_mutex);
+		found = jd_inline_object_resolve(inline_object, &inline_data, modification_time);
+		object = inline_object->object;
+		g_mutex_unlock(&jd_inline_mutex);
+
+		if (found)
+		{
+			if (size != NULL)
+			{
+				*size = inline_data->len;
+			}
+
+			return TRUE;
+		}
+	}
+
+	if (object == NULL)
+	{
+		return FALSE;
+	}
+
+	return j_backend_object_status(jd_inline_object_backend, object, modification_time, size);
+}
+
+static
+gboolean
+jd_inline_sync (gpointer data)
+{
+	JdInlineObject* inline_object = data;
+	g_autoptr(GByteArray) inline_data = NULL;
+	gpointer object;
+	gboolean ret = TRUE;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		gboolean found;
+
+		g_mutex_lock(&jd_inline_mutex);
+
+		/* The key-value backends can only sync as part of a batch, so the data is stored again. */
+		if ((found = jd_inline_object_resolve(inline_object, &inline_data, NULL)))
+		{
+			ret = jd_inline_object_store(inline_object, inline_data, J_SEMANTICS_SAFETY_STORAGE);
+		}
+
+		object = inline_object->object;
+
+		g_mutex_unlock(&jd_inline_mutex);
+
+		if (found)
+		{
+			return ret;
+		}
+	}
+
+	if (object == NULL)
+	{
+		return FALSE;
+	}
+
+	return j_backend_object_sync(jd_inline_object_backend, object);
+}
+
+static
+gboolean
+jd_inline_read (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	JdInlineObject* inline_object = data;
+	g_autoptr(GByteArray) inline_data = NULL;
+	gpointer object;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		gboolean found;
+
+		g_mutex_lock(&jd_inline_mutex);
+		found = jd_inline_object_resolve(inline_object, &inline_data, NULL);
+		object = inline_object->object;
+		g_mutex_unlock(&jd_inline_mutex);
+
+		if (found)
+		{
+			guint64 nbytes = 0;
+
+			if (offset < inline_data->len)
+			{
+				nbytes = MIN(length, inline_data->len - offset);
+				memcpy(buffer, inline_data->data + offset, nbytes);
+			}
+
+			if (bytes_read != NULL)
+			{
+				*bytes_read = nbytes;
+			}
+
+			return TRUE;
+		}
+	}
+
+	if (object == NULL)
+	{
+		return FALSE;
+	}
+
+	return j_backend_object_read(jd_inline_object_backend, object, buffer, length, offset, bytes_read);
+}
+
+static
+gboolean
+jd_inline_write (gpointer data, gconstpointer buffer, guint64 length, guint64 offset, guint64* bytes_written)
+{
+	JdInlineObject* inline_object = data;
+	g_autoptr(GByteArray) inline_data = NULL;
+	gpointer object;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		gboolean ret = TRUE;
+		gboolean found;
+
+		g_mutex_lock(&jd_inline_mutex);
+
+		if ((found = jd_inline_object_resolve(inline_object, &inline_data, NULL)))
+		{
+			if (offset + length <= jd_inline_size)
+			{
+				if (offset + length > inline_data->len)
+				{
+					jd_inline_data_resize(inline_data, offset + length);
+				}
+
+				memcpy(inline_data->data + offset, buffer, length);
+				ret = jd_inline_object_store(inline_object, inline_data, J_SEMANTICS_SAFETY_NETWORK);
+			}
+			else
+			{
+				/* The write is performed by the object backend below. */
+				found = FALSE;
+				ret = jd_inline_object_promote(inline_object, inline_data);
+			}
+		}
+
+		object = inline_object->object;
+
+		g_mutex_unlock(&jd_inline_mutex);
+
+		if (found || !ret)
+		{
+			if (bytes_written != NULL)
+			{
+				*bytes_written = (ret) ? length : 0;
+			}
+
+			return ret;
+		}
+	}
+
+	if (object == NULL)
+	{
+		return FALSE;
+	}
+
+	return j_backend_object_write(jd_inline_object_backend, object, buffer, length, offset, bytes_written);
+}
+
+static
+gboolean
+jd_inline_truncate (gpointer data, guint64 size)
+{
+	JdInlineObject* inline_object = data;
+	g_autoptr(GByteArray) inline_data = NULL;
+	gpointer object;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		gboolean ret = TRUE;
+		gboolean found;
+
+		g_mutex_lock(&jd_inline_mutex);
+
+		if ((found = jd_inline_object_resolve(inline_object, &inline_data, NULL)))
+		{
+			if (size <= jd_inline_size)
+			{
+				jd_inline_data_resize(inline_data, size);
+				ret = jd_inline_object_store(inline_object, inline_data, J_SEMANTICS_SAFETY_NETWORK);
+			}
+			else
+			{
+				found = FALSE;
+				ret = jd_inline_object_promote(inline_object, inline_data);
+			}
+		}
+
+		object = inline_object->object;
+
+		g_mutex_unlock(&jd_inline_mutex);
+
+		if (found || !ret)
+		{
+			return ret;
+		}
+	}
+
+	if (object == NULL || jd_inline_object_backend->object.truncate == NULL)
+	{
+		return FALSE;
+	}
+
+	return j_backend_object_truncate(jd_inline_object_backend, object, size);
+}
+
+static
+gboolean
+jd_inline_readv (gpointer data, gpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, guint64* bytes_read)
+{
+	JdInlineObject* inline_object = data;
+	gpointer object;
+	gboolean ret = TRUE;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) != NULL)
+	{
+		return j_backend_object_readv(jd_inline_object_backend, object, buffers, lengths, offsets, count, bytes_read);
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		bytes_read[i] = 0;
+		ret = jd_inline_read(data, buffers[i], lengths[i], offsets[i], &(bytes_read[i])) && ret;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_writev (gpointer data, gconstpointer const* buffers, guint64 const* lengths, guint64 const* offsets, guint count, gboolean sync, guint64* bytes_written)
+{
+	JdInlineObject* inline_object = data;
+	gpointer object;
+	gboolean ret = TRUE;
+
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) != NULL)
+	{
+		return j_backend_object_writev(jd_inline_object_backend, object, buffers, lengths, offsets, count, sync, bytes_written);
+	}
+
+	for (guint i = 0; i < count; i++)
+	{
+		bytes_written[i] = 0;
+		ret = jd_inline_write(data, buffers[i], lengths[i], offsets[i], &(bytes_written[i])) && ret;
+	}
+
+	if (sync)
+	{
+		ret = jd_inline_sync(data) && ret;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+jd_inline_hint (gpointer data, gint access, guint64 length, guint64 offset)
+{
+	JdInlineObject* inline_object = data;
+	gpointer object;
+
+	/* Inline objects are read as a whole anyway. */
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		return TRUE;
+	}
+
+	return j_backend_object_hint(jd_inline_object_backend, object, access, length, offset);
+}
+
+static
+gboolean
+jd_inline_prefetch (gpointer data, guint64 length, guint64 offset)
+{
+	JdInlineObject* inline_object = data;
+	gpointer object;
+
+	/* Inline objects are read from the key-value backend, which has its own caching. */
+	if ((object = g_atomic_pointer_get(&(inline_object->object))) == NULL)
+	{
+		return TRUE;
+	}
+
+	return j_backend_object_prefetch(jd_inline_object_backend, object, length, offset);
+}
+
+static
+gboolean
+jd_inline_purge (gchar const* namespace, gchar const* directory)
+{
+	g_autoptr(GPtrArray) keys = NULL;
+	g_autofree gchar* prefix = NULL;
+	gpointer iterator;
+	gpointer batch;
+	gboolean ret = TRUE;
+
+	keys = g_ptr_array_new_with_free_func(g_free);
+	prefix = g_strdup_printf("%s/%s/", namespace, directory);
+
+	g_mutex_lock(&jd_inline_mutex);
+
+	/* The keys are collected first, so that the iterator does not observe its own deletions. */
+	if (j_backend_kv_get_by_prefix(jd_inline_kv_backend, JD_INLINE_NAMESPACE, prefix, &iterator))
+	{
+		bson_t value[1];
+		gchar const* key;
+
+		while (j_backend_kv_iterate(jd_inline_kv_backend, iterator, &key, value))
+		{
+			g_ptr_array_add(keys, g_strdup(key));
+			bson_destroy(value);
+		}
+	}
+
+	if (keys->len > 0 && j_backend_kv_batch_start(jd_inline_kv_backend, JD_INLINE_NAMESPACE, J_SEMANTICS_SAFETY_STORAGE, &batch))
+	{
+		for (guint i = 0; i < keys->len; i++)
+		{
+			ret = j_backend_kv_delete(jd_inline_kv_backend, batch, g_ptr_array_index(keys, i)) && ret;
+		}
+
+		ret = j_backend_kv_batch_execute(jd_inline_kv_backend, batch) && ret;
+	}
+
+	g_mutex_unlock(&jd_inline_mutex);
+
+	return j_backend_object_purge(jd_inline_object_backend, namespace, directory) && ret;
+}
+
+/**
+ * Wraps an object backend, so that small objects are stored in a key-value backend.
+ * Both backends have to be initialized already.
+ * Finalizing the returned backend finalizes the object backend.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object_backend An object backend.
+ * \param kv_backend     A key-value backend.
+ * \param size           The maximum size of inline objects.
+ *
+ * \return The wrapping object backend.
+ **/
+JBackend*
+jd_inline_backend (JBackend* object_backend, JBackend* kv_backend, guint64 size)
+{
+	g_return_val_if_fail(object_backend != NULL, NULL);
+	g_return_val_if_fail(kv_backend != NULL, NULL);
+	g_return_val_if_fail(size > 0, NULL);
+
+	jd_inline_object_backend = object_backend;
+	jd_inline_kv_backend = kv_backend;
+	jd_inline_size = size;
+
+	jd_inline_backend_wrapper.type = J_BACKEND_TYPE_OBJECT;
+	jd_inline_backend_wrapper.object.init = object_backend->object.init;
+	jd_inline_backend_wrapper.object.fini = object_backend->object.fini;
+	jd_inline_backend_wrapper.object.create = jd_inline_create;
+	jd_inline_backend_wrapper.object.delete = jd_inline_delete;
+	jd_inline_backend_wrapper.object.open = jd_inline_open;
+	jd_inline_backend_wrapper.object.close = jd_inline_close;
+	jd_inline_backend_wrapper.object.status = jd_inline_status;
+	jd_inline_backend_wrapper.object.sync = jd_inline_sync;
+	jd_inline_backend_wrapper.object.read = jd_inline_read;
+	jd_inline_backend_wrapper.object.write = jd_inline_write;
+
+	/* Inline objects have no file descriptor. */
+	jd_inline_backend_wrapper.object.read_to_fd = NULL;
+	jd_inline_backend_wrapper.object.write_from_fd = NULL;
+
+	jd_inline_backend_wrapper.object.truncate = jd_inline_truncate;
+	jd_inline_backend_wrapper.object.allocate = NULL;
+	jd_inline_backend_wrapper.object.punch_hole = NULL;
+	jd_inline_backend_wrapper.object.copy = NULL;
+
+	/* The optional callbacks are only offered if the object backend implements them. */
+	jd_inline_backend_wrapper.object.readv = (object_backend->object.readv != NULL) ? jd_inline_readv : NULL;
+	jd_inline_backend_wrapper.object.writev = (object_backend->object.writev != NULL) ? jd_inline_writev : NULL;
+	jd_inline_backend_wrapper.object.hint = (object_backend->object.hint != NULL) ? jd_inline_hint : NULL;
+	jd_inline_backend_wrapper.object.purge = (object_backend->object.purge != NULL) ? jd_inline_purge : NULL;
+	jd_inline_backend_wrapper.object.prefetch = (object_backend->object.prefetch != NULL) ? jd_inline_prefetch : NULL;
+	/* Inline objects are stored uncompressed. */
+	jd_inline_backend_wrapper.object.compression = object_backend->object.compression;
+
+	return &jd_inline_backend_wrapper;
+}
@@ -0,0 +1,598 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A journal for buffered writes.
+ *
+ * Writes buffered by the handle cache are appended to a journal on fast storage, so that they survive a crash of the server.
+ * The journal consists of two files that are used alternately: A checkpoint switches to the other file, writes all buffered data to the object backend, syncs the affected objects and empties the previous file afterwards.
+ * Journals that have not been emptied are replayed before the server starts handling requests.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * Identifies journal files, "JDJ1".
+ */
+#define JD_JOURNAL_MAGIC 0x4a444a31
+
+/**
+ * The size at which a checkpoint is started.
+ */
+#define JD_JOURNAL_CHECKPOINT_SIZE (64 * 1024 * 1024)
+
+/**
+ * The maximum time between two checkpoints in microseconds.
+ */
+#define JD_JOURNAL_CHECKPOINT_INTERVAL (10 * G_USEC_PER_SEC)
+
+/**
+ * The header at the start of each journal file.
+ * The generation orders the files when replaying them.
+ */
+struct JdJournalHeader
+{
+	guint32 magic;
+	guint32 reserved;
+	guint64 generation;
+};
+
+typedef struct JdJournalHeader JdJournalHeader;
+
+/**
+ * The header of a record, followed by the namespace, the path and the data.
+ */
+struct JdJournalRecord
+{
+	guint32 magic;
+
+	/**
+	 * The checksum of the remaining header and everything following it.
+	 */
+	guint32 checksum;
+
+	guint32 namespace_len;
+	guint32 path_len;
+	guint64 offset;
+	guint64 length;
+};
+
+typedef struct JdJournalRecord JdJournalRecord;
+
+struct JdJournalFile
+{
+	gint fd;
+
+	/**
+	 * The current size, including the header.
+	 */
+	guint64 size;
+
+	/**
+	 * The objects written to the file, mapping keys to their namespace and path.
+	 */
+	GHashTable* objects;
+};
+
+typedef struct JdJournalFile JdJournalFile;
+
+struct JdJournal
+{
+	JBackend* object_backend;
+
+	JdJournalFile files[2];
+
+	/**
+	 * The file records are appended to.
+	 */
+	guint active;
+
+	guint64 generation;
+
+	/**
+	 * Whether records have been appended since the last sync.
+	 */
+	gboolean dirty;
+
+	gint64 last_checkpoint;
+
+	GMutex mutex[1];
+};
+
+static
+gboolean
+jd_journal_write_all (gint fd, gconstpointer data, gsize length)
+{
+	gchar const* buffer = data;
+
+	while (length > 0)
+	{
+		gssize nbytes;
+
+		if ((nbytes = write(fd, buffer, length)) <= 0)
+		{
+			if (nbytes == -1 && errno == EINTR)
+			{
+				continue;
+			}
+
+			return FALSE;
+		}
+
+		buffer += nbytes;
+		length -= nbytes;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Empties a file and starts it with a new header.
+ */
+static
+gboolean
+jd_journal_file_reset (JdJournalFile* file, guint64 generation)
+{
+	JdJournalHeader header;
+
+	header.magic = JD_JOURNAL_MAGIC;
+	header.reserved = 0;
+	header.generation = generation;
+
+	if (ftruncate(file->fd, 0) != 0 || lseek(file->fd, 0, SEEK_SET) != 0)
+	{
+		return FALSE;
+	}
+
+	file->size = sizeof(header);
+	g_hash_table_remove_all(file->objects);
+
+	return jd_journal_write_all(file->fd, &header, sizeof(header)) && fdatasync(file->fd) == 0;
+}
+
+/**
+ * Applies all valid records of a file to the object backend.
+ * Replaying stops at the first incomplete or corrupted record, which has not been acknowledged by the server.
+ */
+static
+void
+jd_journal_file_replay (JdJournal* journal, JdJournalFile* file, GHashTable* objects)
+{
+	JdJournalRecord record;
+	guint64 position = sizeof(JdJournalHeader);
+	guint64 count = 0;
+
+	while (pread(file->fd, &record, sizeof(record), position) == sizeof(record) && record.magic == JD_JOURNAL_MAGIC)
+	{
+		g_autofree gchar* payload = NULL;
+		gsize payload_len;
+		gchar const* namespace;
+		gchar const* path;
+		gchar* key;
+		gpointer object;
+		guint32 checksum;
+		guint64 bytes_written;
+
+		payload_len = record.namespace_len + record.path_len + record.length;
+		payload = g_malloc(payload_len);
+
+		if (pread(file->fd, payload, payload_len, position + sizeof(record)) != (gssize)payload_len)
+		{
+			break;
+		}
+
+		checksum = j_helper_crc32c(0, (gchar const*)&record + G_STRUCT_OFFSET(JdJournalRecord, namespace_len), sizeof(record) - G_STRUCT_OFFSET(JdJournalRecord, namespace_len));
+		checksum = j_helper_crc32c(checksum, payload, payload_len);
+
+		if (checksum != record.checksum || record.namespace_len == 0 || record.path_len == 0
+		    || payload[record.namespace_len - 1] != '\0' || payload[record.namespace_len + record.path_len - 1] != '\0')
+		{
+			break;
+		}
+
+		namespace = payload;
+		path = payload + record.namespace_len;
+		key = g_strconcat(namespace, "/", path, NULL);
+
+		if (!g_hash_table_lookup_extended(objects, key, NULL, &object))
+		{
+			/* Objects that have been deleted in the meantime are not recreated. */
+			if (!j_backend_object_open(journal->object_backend, namespace, path, &object))
+			{
+				object = NULL;
+			}
+
+			g_hash_table_insert(objects, g_strdup(key), object);
+		}
+
+		if (object != NULL)
+		{
+			j_backend_object_write(journal->object_backend, object, payload + record.namespace_len + record.path_len, record.length, record.offset, &bytes_written);
+		}
+
+		g_free(key);
+
+		position += sizeof(record) + payload_len;
+		count++;
+	}
+
+	if (count > 0)
+	{
+		g_message("Replayed %" G_GUINT64_FORMAT " journal records.", count);
+	}
+}
+
+/**
+ * Syncs all objects written to a file.
+ */
+static
+void
+jd_journal_file_sync_objects (JdJournal* journal, JdJournalFile* file)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, file->objects);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		gchar** names = value;
+		gpointer object;
+
+		if (j_backend_object_open(journal->object_backend, names[0], names[1], &object))
+		{
+			j_backend_object_sync(journal->object_backend, object);
+			j_backend_object_close(journal->object_backend, object);
+		}
+	}
+}
+
+/**
+ * Creates a new journal, replaying existing journal files first.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object_backend The object backend.
+ * \param path           The directory containing the journal files, ideally on fast storage.
+ *
+ * \return A new journal, NULL if the journal files could not be opened. Should be freed with jd_journal_free().
+ **/
+JdJournal*
+jd_journal_new (JBackend* object_backend, gchar const* path)
+{
+	JdJournal* journal;
+	g_autoptr(GHashTable) objects = NULL;
+	JdJournalHeader headers[2];
+	gboolean valid[2];
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_val_if_fail(object_backend != NULL, NULL);
+	g_return_val_if_fail(path != NULL, NULL);
+
+	g_mkdir_with_parents(path, 0700);
+
+	journal = g_slice_new(JdJournal);
+	journal->object_backend = object_backend;
+	journal->active = 0;
+	journal->generation = 0;
+	journal->dirty = FALSE;
+	journal->last_checkpoint = g_get_monotonic_time();
+
+	g_mutex_init(journal->mutex);
+
+	for (guint i = 0; i < 2; i++)
+	{
+		journal->files[i].fd = -1;
+		journal->files[i].size = 0;
+		journal->files[i].objects = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_strfreev);
+	}
+
+	for (guint i = 0; i < 2; i++)
+	{
+		g_autofree gchar* name = NULL;
+		g_autofree gchar* file_path = NULL;
+		JdJournalFile* file = &(journal->files[i]);
+
+		name = g_strdup_printf("journal-%u", i);
+		file_path = g_build_filename(path, name, NULL);
+
+		file->fd = open(file_path, O_RDWR | O_CREAT, 0600);
+
+		if (file->fd == -1)
+		{
+			g_critical("Could not open journal %s.", file_path);
+			jd_journal_free(journal);
+			return NULL;
+		}
+
+		valid[i] = (pread(file->fd, &(headers[i]), sizeof(headers[i]), 0) == sizeof(headers[i]) && headers[i].magic == JD_JOURNAL_MAGIC);
+
+		if (valid[i])
+		{
+			journal->generation = MAX(journal->generation, headers[i].generation);
+		}
+	}
+
+	/* The older file is replayed first, since newer records might overwrite its data. */
+	objects = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	for (guint j = 0; j < 2; j++)
+	{
+		guint i = (valid[0] && valid[1] && headers[1].generation < headers[0].generation) ? 1 - j : j;
+
+		if (valid[i])
+		{
+			jd_journal_file_replay(journal, &(journal->files[i]), objects);
+		}
+	}
+
+	g_hash_table_iter_init(&iter, objects);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		if (value != NULL)
+		{
+			j_backend_object_sync(object_backend, value);
+			j_backend_object_close(object_backend, value);
+		}
+	}
+
+	journal->generation++;
+
+	if (!jd_journal_file_reset(&(journal->files[0]), journal->generation) || ftruncate(journal->files[1].fd, 0) != 0)
+	{
+		g_critical("Could not reset journal in %s.", path);
+		jd_journal_free(journal);
+		return NULL;
+	}
+
+	return journal;
+}
+
+/**
+ * Frees the journal.
+ * All buffered data has to have been written to the object backend, the journal is emptied after syncing the affected objects.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param journal A journal.
+ **/
+void
+jd_journal_free (JdJournal* journal)
+{
+	g_return_if_fail(journal != NULL);
+
+	for (guint i = 0; i < 2; i++)
+	{
+		JdJournalFile* file = &(journal->files[i]);
+
+		if (file->fd != -1)
+		{
+			jd_journal_file_sync_objects(journal, file);
+
+			if (ftruncate(file->fd, 0) == 0)
+			{
+				fdatasync(file->fd);
+			}
+
+			close(file->fd);
+		}
+
+		g_hash_table_destroy(file->objects);
+	}
+
+	g_mutex_clear(journal->mutex);
+
+	g_slice_free(JdJournal, journal);
+}
+
+/**
+ * Appends a write to the journal.
+ * Has to be called before the data is buffered and while holding the buffer's lock, so that a concurrent checkpoint writes it to the object backend.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param journal   A journal.
+ * \param namespace The object's namespace.
+ * \param path      The object's path.
+ * \param data      The data.
+ * \param length    The data's length.
+ * \param offset    The object offset.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+jd_journal_append (JdJournal* journal, gchar const* namespace, gchar const* path, gconstpointer data, guint64 length, guint64 offset)
+{
+	JdJournalFile* file;
+	JdJournalRecord* record;
+	g_autofree gchar* buffer = NULL;
+	g_autofree gchar* key = NULL;
+	gsize namespace_len;
+	gsize path_len;
+	gsize buffer_len;
+	gboolean ret;
+
+	g_return_val_if_fail(journal != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(path != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	namespace_len = strlen(namespace) + 1;
+	path_len = strlen(path) + 1;
+	buffer_len = sizeof(JdJournalRecord) + namespace_len + path_len + length;
+
+	/* The record is assembled in one buffer, so that it is appended using a single write. */
+	buffer = g_malloc(buffer_len);
+	record = (JdJournalRecord*)(gpointer)buffer;
+	record->magic = JD_JOURNAL_MAGIC;
+	record->namespace_len = namespace_len;
+	record->path_len = path_len;
+	record->offset = offset;
+	record->length = length;
+
+	memcpy(buffer + sizeof(JdJournalRecord), namespace, namespace_len);
+	memcpy(buffer + sizeof(JdJournalRecord) + namespace_len, path, path_len);
+	memcpy(buffer + sizeof(JdJournalRecord) + namespace_len + path_len, data, length);
+
+	record->checksum = j_helper_crc32c(0, buffer + G_STRUCT_OFFSET(JdJournalRecord, namespace_len), buffer_len - G_STRUCT_OFFSET(JdJournalRecord, namespace_len));
+
+	key = g_strconcat(namespace, "/", path, NULL);
+
+	g_mutex_lock(journal->mutex);
+
+	file = &(journal->files[journal->active]);
+
+	ret = jd_journal_write_all(file->fd, buffer, buffer_len);
+
+	if (ret)
+	{
+		file->size += buffer_len;
+		journal->dirty = TRUE;
+
+		if (!g_hash_table_contains(file->objects, key))
+		{
+			gchar** names;
+
+			names = g_new(gchar*, 3);
+			names[0] = g_strdup(namespace);
+			names[1] = g_strdup(path);
+			names[2] = NULL;
+
+			g_hash_table_insert(file->objects, g_steal_pointer(&key), names);
+		}
+	}
+	else
+	{
+		/* Remove a partially written record, it would stop the replay of following ones. */
+		if (ftruncate(file->fd, file->size) != 0 || lseek(file->fd, file->size, SEEK_SET) != (off_t)file->size)
+		{
+			g_critical("Could not repair journal after a failed write.");
+		}
+	}
+
+	g_mutex_unlock(journal->mutex);
+
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Syncs the journal and starts a checkpoint if it has become too large or too old.
+ * Should be called periodically from a single thread.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param journal      A journal.
+ * \param handle_cache The handle cache buffering the journaled writes.
+ **/
+void
+jd_journal_checkpoint (JdJournal* journal, JdHandleCache* handle_cache)
+{
+	JdJournalFile* previous;
+	gboolean dirty;
+	gint64 now;
+	gint fd;
+
+	g_return_if_fail(journal != NULL);
+	g_return_if_fail(handle_cache != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(journal->mutex);
+
+	previous = &(journal->files[journal->active]);
+	fd = previous->fd;
+	dirty = journal->dirty;
+	journal->dirty = FALSE;
+
+	if (previous->size <= sizeof(JdJournalHeader) || (previous->size < JD_JOURNAL_CHECKPOINT_SIZE && now - journal->last_checkpoint < JD_JOURNAL_CHECKPOINT_INTERVAL))
+	{
+		g_mutex_unlock(journal->mutex);
+
+		/* Acknowledged writes become durable within one period. */
+		if (dirty)
+		{
+			fdatasync(fd);
+		}
+
+		j_trace_leave(G_STRFUNC);
+		return;
+	}
+
+	/* New records go to the other file while the previous one is checkpointed. */
+	journal->generation++;
+	journal->active = 1 - journal->active;
+	journal->last_checkpoint = now;
+
+	if (!jd_journal_file_reset(&(journal->files[journal->active]), journal->generation))
+	{
+		g_critical("Could not reset journal.");
+	}
+
+	g_mutex_unlock(journal->mutex);
+
+	/* Writes appended to the previous file have been buffered before the switch, so flushing all buffers writes them. */
+	jd_handle_cache_flush_expired(handle_cache, 0);
+	jd_journal_file_sync_objects(journal, previous);
+
+	if (ftruncate(previous->fd, 0) == 0)
+	{
+		fdatasync(previous->fd);
+	}
+
+	g_mutex_lock(journal->mutex);
+	previous->size = 0;
+	g_hash_table_remove_all(previous->objects);
+	g_mutex_unlock(journal->mutex);
+
+	j_trace_leave(G_STRFUNC);
+}
@@ -0,0 +1,494 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A cache for frequently read KV values that is shared by all of the server's threads.
+ *
+ * Values are looked up by namespace and key.
+ * The cache is split into shards with separate locks, each of which evicts values using the CLOCK algorithm as soon as it is full.
+ *
+ * Writes go through the cache: Successful puts replace cached values and all other modifications remove them.
+ * Every shard counts the modifications that started or finished, so that values that were read or written concurrently with another modification are never cached.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The number of shards.
+ */
+#define JD_KV_CACHE_SHARDS 16
+
+/**
+ * The bookkeeping overhead of an entry in bytes, used to account for small values.
+ */
+#define JD_KV_CACHE_OVERHEAD 128
+
+/**
+ * A cached value.
+ */
+struct JdKVCacheEntry
+{
+	gchar* key;
+	bson_t* value;
+
+	/**
+	 * The link into the clock.
+	 */
+	GList* link;
+
+	/**
+	 * Whether the value has been read since the clock hand passed it.
+	 */
+	gboolean referenced;
+};
+
+typedef struct JdKVCacheEntry JdKVCacheEntry;
+
+struct JdKVCacheShard
+{
+	/**
+	 * Maps keys to entries.
+	 */
+	GHashTable* entries;
+
+	/**
+	 * All entries, in the order they have been inserted.
+	 */
+	GQueue* clock;
+
+	/**
+	 * The clock hand, NULL if the shard is empty.
+	 */
+	GList* hand;
+
+	/**
+	 * The number of cached bytes.
+	 */
+	guint64 size;
+
+	/**
+	 * The number of modifications that started or finished.
+	 */
+	guint64 generation;
+
+	GMutex mutex[1];
+};
+
+typedef struct JdKVCacheShard JdKVCacheShard;
+
+struct JdKVCache
+{
+	/**
+	 * The maximum number of cached bytes per shard.
+	 */
+	guint64 capacity;
+
+	JdKVCacheShard shards[JD_KV_CACHE_SHARDS];
+};
+
+/**
+ * Returns the key of a value.
+ * The namespace's length is included, so that different namespace and key pairs never result in the same key.
+ */
+static
+gchar*
+jd_kv_cache_key (gchar const* namespace, gchar const* key)
+{
+	return g_strdup_printf("%" G_GSIZE_FORMAT ":%s:%s", strlen(namespace), namespace, key);
+}
+
+static
+JdKVCacheShard*
+jd_kv_cache_shard (JdKVCache* cache, gchar const* key)
+{
+	return &(cache->shards[g_str_hash(key) % JD_KV_CACHE_SHARDS]);
+}
+
+static
+guint64
+jd_kv_cache_entry_size (JdKVCacheEntry const* entry)
+{
+	return strlen(entry->key) + entry->value->len + JD_KV_CACHE_OVERHEAD;
+}
+
+/* Must be called with the shard's mutex held. */
+static
+void
+jd_kv_cache_remove (JdKVCacheShard* shard, JdKVCacheEntry* entry)
+{
+	if (shard->hand == entry->link)
+	{
+		shard->hand = (entry->link->next != NULL) ? entry->link->next : shard->clock->head;
+	}
+
+	g_queue_delete_link(shard->clock, entry->link);
+
+	if (shard->clock->length == 0)
+	{
+		shard->hand = NULL;
+	}
+
+	shard->size -= jd_kv_cache_entry_size(entry);
+
+	/* Frees the entry. */
+	g_hash_table_remove(shard->entries, entry->key);
+}
+
+/* Must be called with the shard's mutex held. */
+static
+void
+jd_kv_cache_evict (JdKVCache* cache, JdKVCacheShard* shard)
+{
+	while (shard->size > cache->capacity && shard->hand != NULL)
+	{
+		JdKVCacheEntry* entry = shard->hand->data;
+
+		if (entry->referenced)
+		{
+			/* Give the entry a second chance. */
+			entry->referenced = FALSE;
+			shard->hand = (shard->hand->next != NULL) ? shard->hand->next : shard->clock->head;
+		}
+		else
+		{
+			jd_kv_cache_remove(shard, entry);
+		}
+	}
+}
+
+/* Must be called with the shard's mutex held. */
+static
+void
+jd_kv_cache_store (JdKVCache* cache, JdKVCacheShard* shard, gchar* key, bson_t const* value)
+{
+	JdKVCacheEntry* entry;
+
+	if ((entry = g_hash_table_lookup(shard->entries, key)) != NULL)
+	{
+		jd_kv_cache_remove(shard, entry);
+	}
+
+	/* Values that do not even fit into an empty shard would only evict everything else. */
+	if (strlen(key) + value->len + JD_KV_CACHE_OVERHEAD > cache->capacity)
+	{
+		g_free(key);
+		return;
+	}
+
+	entry = g_slice_new(JdKVCacheEntry);
+	entry->key = key;
+	entry->value = bson_copy(value);
+	entry->referenced = FALSE;
+
+	/* New entries are inserted right behind the hand, so that they are the last ones to be examined. */
+	if (shard->hand != NULL)
+	{
+		g_queue_insert_before(shard->clock, shard->hand, entry);
+		entry->link = shard->hand->prev;
+	}
+	else
+	{
+		g_queue_push_tail(shard->clock, entry);
+		entry->link = shard->clock->tail;
+		shard->hand = entry->link;
+	}
+
+	g_hash_table_insert(shard->entries, entry->key, entry);
+	shard->size += jd_kv_cache_entry_size(entry);
+
+	jd_kv_cache_evict(cache, shard);
+}
+
+static
+void
+jd_kv_cache_entry_free (gpointer data)
+{
+	JdKVCacheEntry* entry = data;
+
+	bson_destroy(entry->value);
+	g_free(entry->key);
+
+	g_slice_free(JdKVCacheEntry, entry);
+}
+
+/**
+ * Creates a new KV cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param size The maximum number of cached bytes.
+ *
+ * \return A new KV cache. Should be freed with jd_kv_cache_free().
+ **/
+JdKVCache*
+jd_kv_cache_new (guint64 size)
+{
+	JdKVCache* cache;
+
+	g_return_val_if_fail(size > 0, NULL);
+
+	cache = g_slice_new(JdKVCache);
+	cache->capacity = size / JD_KV_CACHE_SHARDS;
+
+	for (guint i = 0; i < JD_KV_CACHE_SHARDS; i++)
+	{
+		JdKVCacheShard* shard = &(cache->shards[i]);
+
+		shard->entries = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, jd_kv_cache_entry_free);
+		shard->clock = g_queue_new();
+		shard->hand = NULL;
+		shard->size = 0;
+		shard->generation = 0;
+
+		g_mutex_init(shard->mutex);
+	}
+
+	return cache;
+}
+
+/**
+ * Frees the memory allocated by the KV cache.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache A KV cache.
+ **/
+void
+jd_kv_cache_free (JdKVCache* cache)
+{
+	g_return_if_fail(cache != NULL);
+
+	for (guint i = 0; i < JD_KV_CACHE_SHARDS; i++)
+	{
+		JdKVCacheShard* shard = &(cache->shards[i]);
+
+		g_queue_free(shard->clock);
+		g_hash_table_destroy(shard->entries);
+
+		g_mutex_clear(shard->mutex);
+	}
+
+	g_slice_free(JdKVCache, cache);
+}
+
+/**
+ * Looks up a value.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache      A KV cache.
+ * \param namespace  A namespace.
+ * \param key        A key.
+ * \param value      An uninitialized BSON document, initialized with a copy of the value on success.
+ * \param generation Returns the shard's generation on failure, which has to be passed to jd_kv_cache_fill().
+ *
+ * \return TRUE if the value was cached, FALSE otherwise.
+ **/
+gboolean
+jd_kv_cache_get (JdKVCache* cache, gchar const* namespace, gchar const* key, bson_t* value, guint64* generation)
+{
+	JdKVCacheShard* shard;
+	JdKVCacheEntry* entry;
+	g_autofree gchar* cache_key = NULL;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail(cache != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(key != NULL, FALSE);
+	g_return_val_if_fail(value != NULL, FALSE);
+	g_return_val_if_fail(generation != NULL, FALSE);
+
+	cache_key = jd_kv_cache_key(namespace, key);
+	shard = jd_kv_cache_shard(cache, cache_key);
+
+	g_mutex_lock(shard->mutex);
+
+	if ((entry = g_hash_table_lookup(shard->entries, cache_key)) != NULL)
+	{
+		entry->referenced = TRUE;
+		bson_copy_to(entry->value, value);
+		ret = TRUE;
+	}
+	else
+	{
+		*generation = shard->generation;
+	}
+
+	g_mutex_unlock(shard->mutex);
+
+	return ret;
+}
+
+/**
+ * Caches a value that has been read from the backend after jd_kv_cache_get() failed.
+ * The value is dropped if the shard has been modified in the meantime, because it might be outdated already.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache      A KV cache.
+ * \param namespace  A namespace.
+ * \param key        A key.
+ * \param value      The value.
+ * \param generation The generation returned by jd_kv_cache_get().
+ **/
+void
+jd_kv_cache_fill (JdKVCache* cache, gchar const* namespace, gchar const* key, bson_t const* value, guint64 generation)
+{
+	JdKVCacheShard* shard;
+	gchar* cache_key;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(key != NULL);
+	g_return_if_fail(value != NULL);
+
+	cache_key = jd_kv_cache_key(namespace, key);
+	shard = jd_kv_cache_shard(cache, cache_key);
+
+	g_mutex_lock(shard->mutex);
+
+	if (shard->generation == generation)
+	{
+		jd_kv_cache_store(cache, shard, cache_key, value);
+	}
+	else
+	{
+		g_free(cache_key);
+	}
+
+	g_mutex_unlock(shard->mutex);
+}
+
+/**
+ * Starts modifying a value, which is removed from the cache.
+ * Has to be followed by jd_kv_cache_end_write() after the backend has been modified.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache     A KV cache.
+ * \param namespace A namespace.
+ * \param key       A key.
+ *
+ * \return The generation that has to be passed to jd_kv_cache_end_write().
+ **/
+guint64
+jd_kv_cache_begin_write (JdKVCache* cache, gchar const* namespace, gchar const* key)
+{
+	JdKVCacheShard* shard;
+	JdKVCacheEntry* entry;
+	g_autofree gchar* cache_key = NULL;
+	guint64 generation;
+
+	g_return_val_if_fail(cache != NULL, 0);
+	g_return_val_if_fail(namespace != NULL, 0);
+	g_return_val_if_fail(key != NULL, 0);
+
+	cache_key = jd_kv_cache_key(namespace, key);
+	shard = jd_kv_cache_shard(cache, cache_key);
+
+	g_mutex_lock(shard->mutex);
+
+	if ((entry = g_hash_table_lookup(shard->entries, cache_key)) != NULL)
+	{
+		jd_kv_cache_remove(shard, entry);
+	}
+
+	generation = ++shard->generation;
+
+	g_mutex_unlock(shard->mutex);
+
+	return generation;
+}
+
+/**
+ * Finishes modifying a value.
+ * The new value is only cached if no other modification of the shard started or finished in the meantime,
+ * because the order in which the backend applied them is unknown otherwise.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param cache      A KV cache.
+ * \param namespace  A namespace.
+ * \param key        A key.
+ * \param value      The new value, NULL if the value has been deleted or is unknown.
+ * \param generation The generation returned by jd_kv_cache_begin_write().
+ **/
+void
+jd_kv_cache_end_write (JdKVCache* cache, gchar const* namespace, gchar const* key, bson_t const* value, guint64 generation)
+{
+	JdKVCacheShard* shard;
+	JdKVCacheEntry* entry;
+	gchar* cache_key;
+
+	g_return_if_fail(cache != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(key != NULL);
+
+	cache_key = jd_kv_cache_key(namespace, key);
+	shard = jd_kv_cache_shard(cache, cache_key);
+
+	g_mutex_lock(shard->mutex);
+
+	if (value != NULL && shard->generation == generation)
+	{
+		jd_kv_cache_store(cache, shard, cache_key, value);
+	}
+	else
+	{
+		if ((entry = g_hash_table_lookup(shard->entries, cache_key)) != NULL)
+		{
+			jd_kv_cache_remove(shard, entry);
+		}
+
+		g_free(cache_key);
+	}
+
+	shard->generation++;
+
+	g_mutex_unlock(shard->mutex);
+}
@@ -0,0 +1,408 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Group commit for KV puts and deletes.
+ *
+ * Threads that have to write KV pairs with storage safety join the currently open batch of their namespace.
+ * The first thread joining a batch becomes its leader and waits until the batch's time window has passed or it has reached its maximum size.
+ * The leader then writes the operations of all threads using a single backend batch and wakes up the other threads, which only then send their replies.
+ * Backend batches are bound to the thread that started them, so only the leader accesses the backend.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * The operations of one thread.
+ * They point into the thread's message, which stays valid because the thread waits until the batch has been committed.
+ */
+struct JdKVCommitOperations
+{
+	gchar const** keys;
+
+	/**
+	 * The values, NULL for deletes.
+	 */
+	gconstpointer* datas;
+	guint32* lens;
+
+	guint count;
+
+	/**
+	 * Whether the values are opaque bytes instead of BSON documents.
+	 */
+	gboolean raw;
+};
+
+typedef struct JdKVCommitOperations JdKVCommitOperations;
+
+struct JdKVCommitBatch
+{
+	gchar* namespace;
+
+	/**
+	 * The operations of all threads, in the order they joined.
+	 */
+	GArray* operations;
+
+	/**
+	 * The number of KV pairs.
+	 */
+	guint count;
+
+	/**
+	 * Whether the batch has been committed.
+	 */
+	gboolean done;
+
+	/**
+	 * Whether the backend batch succeeded.
+	 */
+	gboolean ret;
+
+	/**
+	 * The number of waiting threads.
+	 */
+	guint ref_count;
+};
+
+typedef struct JdKVCommitBatch JdKVCommitBatch;
+
+struct JdKVCommit
+{
+	JBackend* backend;
+	JdKVIndex* index;
+
+	/**
+	 * The time window in microseconds.
+	 */
+	guint64 time;
+
+	/**
+	 * The maximum number of KV pairs per batch.
+	 */
+	guint size;
+
+	/**
+	 * Maps namespaces to the batches new operations are added to.
+	 */
+	GHashTable* current;
+
+	GMutex mutex[1];
+	GCond cond[1];
+};
+
+/**
+ * Writes operations using a single backend batch, maintaining the namespace's indexes.
+ */
+static
+gboolean
+jd_kv_commit_write_batch (JdKVCommit* commit, gchar const* namespace, JSemanticsSafety safety, JdKVCommitOperations const* operations, guint operations_len)
+{
+	JdKVIndexBatch* index_batch;
+	gpointer batch;
+	gboolean ret;
+
+	if (!j_backend_kv_batch_start(commit->backend, namespace, safety, &batch))
+	{
+		return FALSE;
+	}
+
+	index_batch = jd_kv_index_batch_start(commit->index, namespace, batch);
+
+	for (guint i = 0; i < operations_len; i++)
+	{
+		JdKVCommitOperations const* ops = &(operations[i]);
+
+		for (guint j = 0; j < ops->count; j++)
+		{
+			if (ops->raw)
+			{
+				/* Raw values cannot be indexed, so they only remove the key from the indexes. */
+				if (index_batch != NULL)
+				{
+					jd_kv_index_batch_delete(index_batch, ops->keys[j]);
+				}
+
+				j_backend_kv_put_raw(commit->backend, batch, ops->keys[j], ops->datas[j], ops->lens[j]);
+			}
+			else if (ops->datas != NULL)
+			{
+				bson_t value[1];
+
+				bson_init_static(value, ops->datas[j], ops->lens[j]);
+
+				if (index_batch != NULL)
+				{
+					jd_kv_index_batch_put(index_batch, ops->keys[j], value);
+				}
+
+				j_backend_kv_put(commit->backend, batch, ops->keys[j], value);
+			}
+			else
+			{
+				if (index_batch != NULL)
+				{
+					jd_kv_index_batch_delete(index_batch, ops->keys[j]);
+				}
+
+				j_backend_kv_delete(commit->backend, batch, ops->keys[j]);
+			}
+		}
+	}
+
+	ret = j_backend_kv_batch_execute(commit->backend, batch);
+
+	if (index_batch != NULL)
+	{
+		jd_kv_index_batch_end(index_batch);
+	}
+
+	return ret;
+}
+
+/**
+ * Creates a new KV group commit.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param backend A KV backend.
+ * \param index   The KV backend's indexes.
+ * \param time    The time window in microseconds, 0 if KV pairs should be written directly.
+ * \param size    The maximum number of KV pairs per batch, 0 for no limit.
+ *
+ * \return A new KV group commit. Should be freed with jd_kv_commit_free().
+ **/
+JdKVCommit*
+jd_kv_commit_new (JBackend* backend, JdKVIndex* index, guint64 time, guint size)
+{
+	JdKVCommit* commit;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+	g_return_val_if_fail(index != NULL, NULL);
+
+	commit = g_slice_new(JdKVCommit);
+	commit->backend = backend;
+	commit->index = index;
+	commit->time = time;
+	commit->size = (size > 0) ? size : G_MAXUINT;
+	commit->current = g_hash_table_new(g_str_hash, g_str_equal);
+
+	g_mutex_init(commit->mutex);
+	g_cond_init(commit->cond);
+
+	return commit;
+}
+
+/**
+ * Frees the memory allocated by the KV group commit.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param commit A KV group commit.
+ **/
+void
+jd_kv_commit_free (JdKVCommit* commit)
+{
+	g_return_if_fail(commit != NULL);
+	g_return_if_fail(g_hash_table_size(commit->current) == 0);
+
+	g_hash_table_destroy(commit->current);
+
+	g_cond_clear(commit->cond);
+	g_mutex_clear(commit->mutex);
+
+	g_slice_free(JdKVCommit, commit);
+}
+
+static
+gboolean
+jd_kv_commit_write_internal (JdKVCommit* commit, gchar const* namespace, JSemanticsSafety safety, gchar const** keys, gconstpointer* datas, guint32* lens, guint count, gboolean raw)
+{
+	JdKVCommitBatch* batch;
+	JdKVCommitOperations operations;
+	gboolean leader = FALSE;
+	gboolean ret;
+
+	g_return_val_if_fail(commit != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(keys != NULL || count == 0, FALSE);
+	g_return_val_if_fail((datas == NULL) == (lens == NULL), FALSE);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	operations.keys = keys;
+	operations.datas = datas;
+	operations.lens = lens;
+	operations.count = count;
+	operations.raw = raw;
+
+	/* Without a time window or durability, waiting for other threads does not pay off. */
+	if (commit->time == 0 || safety != J_SEMANTICS_SAFETY_STORAGE)
+	{
+		ret = jd_kv_commit_write_batch(commit, namespace, safety, &operations, 1);
+		goto end;
+	}
+
+	g_mutex_lock(commit->mutex);
+
+	if ((batch = g_hash_table_lookup(commit->current, namespace)) == NULL)
+	{
+		batch = g_slice_new(JdKVCommitBatch);
+		batch->namespace = g_strdup(namespace);
+		batch->operations = g_array_new(FALSE, FALSE, sizeof(JdKVCommitOperations));
+		batch->count = 0;
+		batch->done = FALSE;
+		batch->ret = FALSE;
+		batch->ref_count = 0;
+
+		g_hash_table_insert(commit->current, batch->namespace, batch);
+		leader = TRUE;
+	}
+
+	batch->ref_count++;
+	g_array_append_val(batch->operations, operations);
+	batch->count += count;
+
+	if (leader)
+	{
+		gint64 deadline;
+
+		deadline = g_get_monotonic_time() + commit->time;
+
+		while (batch->count < commit->size)
+		{
+			if (!g_cond_wait_until(commit->cond, commit->mutex, deadline))
+			{
+				break;
+			}
+		}
+
+		/* Close the batch, new operations will start a new one while this one is committed. */
+		g_hash_table_remove(commit->current, batch->namespace);
+
+		g_mutex_unlock(commit->mutex);
+
+		ret = jd_kv_commit_write_batch(commit, batch->namespace, safety, (JdKVCommitOperations*)(gpointer)batch->operations->data, batch->operations->len);
+
+		g_mutex_lock(commit->mutex);
+
+		batch->ret = ret;
+		batch->done = TRUE;
+		g_cond_broadcast(commit->cond);
+	}
+	else
+	{
+		if (batch->count >= commit->size)
+		{
+			/* Wake up the leader. */
+			g_cond_broadcast(commit->cond);
+		}
+
+		while (!batch->done)
+		{
+			g_cond_wait(commit->cond, commit->mutex);
+		}
+	}
+
+	ret = batch->ret;
+	batch->ref_count--;
+
+	if (batch->ref_count == 0)
+	{
+		g_array_unref(batch->operations);
+		g_free(batch->namespace);
+		g_slice_free(JdKVCommitBatch, batch);
+	}
+
+	g_mutex_unlock(commit->mutex);
+
+end:
+	j_trace_leave(G_STRFUNC);
+
+	return ret;
+}
+
+/**
+ * Puts or deletes KV pairs, possibly together with the ones of other threads.
+ * Returns only after the KV pairs have been written.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param commit    A KV group commit.
+ * \param namespace A namespace.
+ * \param safety    The safety of the KV pairs, only storage safety is grouped.
+ * \param keys      The keys.
+ * \param datas     The values' data, NULL if the keys should be deleted.
+ * \param lens      The values' lengths, NULL if the keys should be deleted.
+ * \param count     The number of KV pairs.
+ *
+ * \return TRUE if the backend batch succeeded, FALSE otherwise.
+ **/
+gboolean
+jd_kv_commit_write (JdKVCommit* commit, gchar const* namespace, JSemanticsSafety safety, gchar const** keys, gconstpointer* datas, guint32* lens, guint count)
+{
+	return jd_kv_commit_write_internal(commit, namespace, safety, keys, datas, lens, count, FALSE);
+}
+
+/**
+ * Puts KV pairs with raw values, possibly together with the ones of other threads.
+ * Returns only after the KV pairs have been written.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param commit    A KV group commit.
+ * \param namespace A namespace.
+ * \param safety    The safety of the KV pairs, only storage safety is grouped.
+ * \param keys      The keys.
+ * \param datas     The values' data.
+ * \param lens      The values' lengths.
+ * \param count     The number of KV pairs.
+ *
+ * \return TRUE if the backend batch succeeded, FALSE otherwise.
+ **/
+gboolean
+jd_kv_commit_write_raw (JdKVCommit* commit, gchar const* namespace, JSemanticsSafety safety, gchar const** keys, gconstpointer* datas, guint32* lens, guint count)
+{
+	g_return_val_if_fail(datas != NULL || count == 0, FALSE);
+
+	return jd_kv_commit_write_internal(commit, namespace, safety, keys, datas, lens, count, TRUE);
+}
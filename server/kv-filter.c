@@ -0,0 +1,488 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Bloom filters for answering KV lookups of non-existent keys without accessing the backend.
+ *
+ * Every namespace gets its own filter, which is built from a scan of the namespace when it is looked up for the first time.
+ * Keys are added before and after they are written, so that writes that overlap a scan are not lost.
+ * Deleted keys cannot be removed from a Bloom filter, because the backend does not tell whether they existed.
+ * Instead, a filter is rebuilt once it contains too many deleted or too many keys, keeping the old one in use until the new one is ready.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The number of bits per key, which results in a false positive rate of about 1 %.
+ */
+#define JD_KV_FILTER_BITS 10
+
+/**
+ * The number of bits set per key.
+ */
+#define JD_KV_FILTER_HASHES 7
+
+/**
+ * The minimum number of keys a filter is sized for.
+ */
+#define JD_KV_FILTER_MIN_KEYS 1024
+
+struct JdKVFilterNamespace
+{
+	/**
+	 * The bits, NULL if the filter has not been built yet.
+	 */
+	guint64* bits;
+	guint64 bit_count;
+
+	/**
+	 * The number of keys the filter has been sized for.
+	 */
+	guint64 capacity;
+
+	/**
+	 * The number of added and deleted keys since the filter has been built.
+	 */
+	guint64 added;
+	guint64 deleted;
+
+	/**
+	 * The hashes of the keys added while the filter is being rebuilt, NULL otherwise.
+	 */
+	GArray* pending;
+
+	/**
+	 * Whether the namespace could not be scanned, the filter is not used in this case.
+	 */
+	gboolean failed;
+
+	GMutex mutex[1];
+};
+
+typedef struct JdKVFilterNamespace JdKVFilterNamespace;
+
+struct JdKVFilter
+{
+	JBackend* backend;
+
+	/**
+	 * Maps namespaces to filters.
+	 */
+	GHashTable* namespaces;
+
+	GMutex mutex[1];
+};
+
+/**
+ * Hashes a key using 64-bit FNV-1a.
+ */
+static
+guint64
+jd_kv_filter_hash (gchar const* key)
+{
+	guint64 hash = G_GUINT64_CONSTANT(14695981039346656037);
+
+	for (; *key != '\0'; key++)
+	{
+		hash ^= (guchar)*key;
+		hash *= G_GUINT64_CONSTANT(1099511628211);
+	}
+
+	return hash;
+}
+
+/**
+ * Sets the bits of a hash.
+ * Uses double hashing to derive all bit positions from the two halves of the hash.
+ *
+ * \return TRUE if at least one bit was not set before, i.e. if the key is new.
+ */
+static
+gboolean
+jd_kv_filter_bits_add (guint64* bits, guint64 bit_count, guint64 hash)
+{
+	guint64 h1 = hash & 0xffffffff;
+	guint64 h2 = (hash >> 32) | 1;
+	gboolean ret = FALSE;
+
+	for (guint i = 0; i < JD_KV_FILTER_HASHES; i++)
+	{
+		guint64 bit = (h1 + i * h2) % bit_count;
+		guint64 mask = G_GUINT64_CONSTANT(1) << (bit % 64);
+
+		if ((bits[bit / 64] & mask) == 0)
+		{
+			bits[bit / 64] |= mask;
+			ret = TRUE;
+		}
+	}
+
+	return ret;
+}
+
+static
+gboolean
+jd_kv_filter_bits_contain (guint64 const* bits, guint64 bit_count, guint64 hash)
+{
+	guint64 h1 = hash & 0xffffffff;
+	guint64 h2 = (hash >> 32) | 1;
+
+	for (guint i = 0; i < JD_KV_FILTER_HASHES; i++)
+	{
+		guint64 bit = (h1 + i * h2) % bit_count;
+
+		if ((bits[bit / 64] & (G_GUINT64_CONSTANT(1) << (bit % 64))) == 0)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Must be called with the namespace's mutex held. */
+static
+gboolean
+jd_kv_filter_namespace_is_stale (JdKVFilterNamespace* ns)
+{
+	return (ns->added > ns->capacity || ns->deleted > ns->added / 2);
+}
+
+/**
+ * Builds a namespace's filter from a scan of the backend.
+ * The current filter, if any, stays in use while the namespace is being scanned.
+ * Must be called with the namespace's mutex held, which is released during the scan.
+ */
+static
+void
+jd_kv_filter_namespace_build (JdKVFilter* filter, JdKVFilterNamespace* ns, gchar const* namespace)
+{
+	g_autoptr(GArray) hashes = NULL;
+	gpointer iterator;
+	guint64* bits;
+	guint64 bit_count;
+	guint64 capacity;
+	guint64 added = 0;
+
+	ns->pending = g_array_new(FALSE, FALSE, sizeof(guint64));
+	hashes = g_array_new(FALSE, FALSE, sizeof(guint64));
+
+	g_mutex_unlock(ns->mutex);
+
+	if (j_backend_kv_get_all(filter->backend, namespace, &iterator))
+	{
+		bson_t value[1];
+		gchar const* key;
+
+		while (j_backend_kv_iterate(filter->backend, iterator, &key, value))
+		{
+			guint64 hash;
+
+			hash = jd_kv_filter_hash(key);
+			g_array_append_val(hashes, hash);
+
+			bson_destroy(value);
+		}
+	}
+	else
+	{
+		g_mutex_lock(ns->mutex);
+
+		g_array_unref(ns->pending);
+		ns->pending = NULL;
+		ns->failed = TRUE;
+
+		return;
+	}
+
+	g_mutex_lock(ns->mutex);
+
+	/* Leave room for the namespace to double in size. */
+	capacity = MAX(2 * (hashes->len + ns->pending->len), JD_KV_FILTER_MIN_KEYS);
+	bit_count = capacity * JD_KV_FILTER_BITS;
+	bits = g_new0(guint64, (bit_count + 63) / 64);
+
+	for (guint i = 0; i < hashes->len; i++)
+	{
+		added += jd_kv_filter_bits_add(bits, bit_count, g_array_index(hashes, guint64, i));
+	}
+
+	for (guint i = 0; i < ns->pending->len; i++)
+	{
+		added += jd_kv_filter_bits_add(bits, bit_count, g_array_index(ns->pending, guint64, i));
+	}
+
+	g_array_unref(ns->pending);
+	ns->pending = NULL;
+
+	g_free(ns->bits);
+	ns->bits = bits;
+	ns->bit_count = bit_count;
+	ns->capacity = capacity;
+	ns->added = added;
+	ns->deleted = 0;
+}
+
+static
+void
+jd_kv_filter_namespace_free (gpointer data)
+{
+	JdKVFilterNamespace* ns = data;
+
+	if (ns->pending != NULL)
+	{
+		g_array_unref(ns->pending);
+	}
+
+	g_free(ns->bits);
+	g_mutex_clear(ns->mutex);
+
+	g_slice_free(JdKVFilterNamespace, ns);
+}
+
+/**
+ * Returns a namespace's filter, creating an empty one if necessary.
+ */
+static
+JdKVFilterNamespace*
+jd_kv_filter_get_namespace (JdKVFilter* filter, gchar const* namespace)
+{
+	JdKVFilterNamespace* ns;
+
+	g_mutex_lock(filter->mutex);
+
+	if ((ns = g_hash_table_lookup(filter->namespaces, namespace)) == NULL)
+	{
+		ns = g_slice_new(JdKVFilterNamespace);
+		ns->bits = NULL;
+		ns->bit_count = 0;
+		ns->capacity = 0;
+		ns->added = 0;
+		ns->deleted = 0;
+		ns->pending = NULL;
+		ns->failed = FALSE;
+
+		g_mutex_init(ns->mutex);
+
+		g_hash_table_insert(filter->namespaces, g_strdup(namespace), ns);
+	}
+
+	g_mutex_unlock(filter->mutex);
+
+	return ns;
+}
+
+/**
+ * Returns whether a namespace is filtered.
+ * Internal namespaces are modified by the server directly and are therefore never filtered.
+ */
+static
+gboolean
+jd_kv_filter_is_used (gchar const* namespace)
+{
+	return !g_str_has_prefix(namespace, "julea-");
+}
+
+/**
+ * Creates a new KV filter.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param backend A KV backend.
+ *
+ * \return A new KV filter. Should be freed with jd_kv_filter_free().
+ **/
+JdKVFilter*
+jd_kv_filter_new (JBackend* backend)
+{
+	JdKVFilter* filter;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+
+	filter = g_slice_new(JdKVFilter);
+	filter->backend = backend;
+	filter->namespaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, jd_kv_filter_namespace_free);
+
+	g_mutex_init(filter->mutex);
+
+	return filter;
+}
+
+/**
+ * Frees the memory allocated by the KV filter.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param filter A KV filter.
+ **/
+void
+jd_kv_filter_free (JdKVFilter* filter)
+{
+	g_return_if_fail(filter != NULL);
+
+	g_hash_table_destroy(filter->namespaces);
+	g_mutex_clear(filter->mutex);
+
+	g_slice_free(JdKVFilter, filter);
+}
+
+/**
+ * Checks whether a key might exist.
+ * Builds or rebuilds the namespace's filter if necessary, which scans the namespace.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param filter    A KV filter.
+ * \param namespace A namespace.
+ * \param key       A key.
+ *
+ * \return FALSE if the key definitely does not exist, TRUE otherwise.
+ **/
+gboolean
+jd_kv_filter_contains (JdKVFilter* filter, gchar const* namespace, gchar const* key)
+{
+	JdKVFilterNamespace* ns;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(filter != NULL, TRUE);
+	g_return_val_if_fail(namespace != NULL, TRUE);
+	g_return_val_if_fail(key != NULL, TRUE);
+
+	if (!jd_kv_filter_is_used(namespace))
+	{
+		return TRUE;
+	}
+
+	ns = jd_kv_filter_get_namespace(filter, namespace);
+
+	g_mutex_lock(ns->mutex);
+
+	/* Only one thread scans a namespace at a time, the others keep using the current filter. */
+	if (!ns->failed && ns->pending == NULL && (ns->bits == NULL || jd_kv_filter_namespace_is_stale(ns)))
+	{
+		jd_kv_filter_namespace_build(filter, ns, namespace);
+	}
+
+	if (ns->bits != NULL)
+	{
+		ret = jd_kv_filter_bits_contain(ns->bits, ns->bit_count, jd_kv_filter_hash(key));
+	}
+
+	g_mutex_unlock(ns->mutex);
+
+	return ret;
+}
+
+/**
+ * Adds a key that is about to be or has just been written.
+ * Has to be called both before and after writing, because a concurrent scan might miss the key otherwise.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param filter    A KV filter.
+ * \param namespace A namespace.
+ * \param key       A key.
+ **/
+void
+jd_kv_filter_add (JdKVFilter* filter, gchar const* namespace, gchar const* key)
+{
+	JdKVFilterNamespace* ns;
+	guint64 hash;
+
+	g_return_if_fail(filter != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(key != NULL);
+
+	if (!jd_kv_filter_is_used(namespace))
+	{
+		return;
+	}
+
+	hash = jd_kv_filter_hash(key);
+	ns = jd_kv_filter_get_namespace(filter, namespace);
+
+	g_mutex_lock(ns->mutex);
+
+	if (ns->bits != NULL && jd_kv_filter_bits_add(ns->bits, ns->bit_count, hash))
+	{
+		ns->added++;
+	}
+
+	if (ns->pending != NULL)
+	{
+		g_array_append_val(ns->pending, hash);
+	}
+
+	g_mutex_unlock(ns->mutex);
+}
+
+/**
+ * Records that a key has been deleted.
+ * The key stays in the filter until it is rebuilt.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param filter    A KV filter.
+ * \param namespace A namespace.
+ **/
+void
+jd_kv_filter_delete (JdKVFilter* filter, gchar const* namespace)
+{
+	JdKVFilterNamespace* ns;
+
+	g_return_if_fail(filter != NULL);
+	g_return_if_fail(namespace != NULL);
+
+	if (!jd_kv_filter_is_used(namespace))
+	{
+		return;
+	}
+
+	ns = jd_kv_filter_get_namespace(filter, namespace);
+
+	g_mutex_lock(ns->mutex);
+	ns->deleted++;
+	g_mutex_unlock(ns->mutex);
+}
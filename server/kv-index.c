@@ -0,0 +1,721 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Secondary indexes on fields of KV values.
+ *
+ * Index entries are stored in the indexed namespace itself, so they are updated in the same backend batch as the values.
+ * An entry's key consists of the field, the field's value encoded so that keys sort like the values and the value's key.
+ * Range queries are answered by scanning the entries between the encoded bounds and looking up the values they refer to.
+ * Keys starting with JD_KV_INDEX_ENTRY or JD_KV_INDEX_DECLARATION are internal and hidden from iterators.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+#define JD_KV_INDEX_ENTRY "\x01"
+#define JD_KV_INDEX_DECLARATION "\x02"
+#define JD_KV_INDEX_SEPARATOR "\x01"
+
+/**
+ * Sorts after the separator, so that starting after it skips all entries of a value.
+ */
+#define JD_KV_INDEX_AFTER "\x02"
+
+/**
+ * The number of entries read at once by scans.
+ * Every page's iterator has to be exhausted, so this also bounds the entries read unnecessarily.
+ */
+#define JD_KV_INDEX_PAGE_SIZE 128
+
+struct JdKVIndex
+{
+	JBackend* backend;
+
+	/**
+	 * Maps namespaces to their indexed fields.
+	 * Namespaces are loaded lazily and namespaces without indexes map to empty arrays.
+	 */
+	GHashTable* namespaces;
+
+	/**
+	 * Batches hold the lock for reading, so indexes are only created while no batch is running.
+	 */
+	GRWLock lock[1];
+};
+
+struct JdKVIndexBatch
+{
+	JdKVIndex* index;
+	gpointer batch;
+	gchar const* namespace;
+	GPtrArray* fields;
+
+	/**
+	 * The values written by the batch, which gets do not return yet.
+	 * Deleted keys map to NULL.
+	 */
+	GHashTable* written;
+};
+
+static
+void
+jd_kv_index_bson_free (gpointer data)
+{
+	if (data != NULL)
+	{
+		bson_destroy(data);
+	}
+}
+
+/**
+ * Appends a field value so that the encoded values sort like the values.
+ * Numbers of all types are compared as doubles, like j_helper_bson_match() does.
+ *
+ * \return FALSE if values of the field's type cannot be indexed.
+ */
+static
+gboolean
+jd_kv_index_encode (bson_iter_t const* iter, GString* encoded)
+{
+	switch (bson_iter_type(iter))
+	{
+		case BSON_TYPE_DOUBLE:
+		case BSON_TYPE_INT32:
+		case BSON_TYPE_INT64:
+			{
+				gdouble value;
+				guint64 bits;
+
+				value = bson_iter_as_double(iter);
+				memcpy(&bits, &value, sizeof(bits));
+
+				/* Flip negative numbers completely and positive ones only in the sign bit. */
+				bits = (bits & G_GUINT64_CONSTANT(0x8000000000000000)) ? ~bits : bits ^ G_GUINT64_CONSTANT(0x8000000000000000);
+
+				g_string_append_printf(encoded, "n%016" G_GINT64_MODIFIER "x", bits);
+			}
+			return TRUE;
+		case BSON_TYPE_DATE_TIME:
+			g_string_append_printf(encoded, "d%016" G_GINT64_MODIFIER "x", (guint64)bson_iter_date_time(iter) ^ G_GUINT64_CONSTANT(0x8000000000000000));
+			return TRUE;
+		case BSON_TYPE_UTF8:
+			g_string_append_c(encoded, 's');
+			g_string_append(encoded, bson_iter_utf8(iter, NULL));
+			return TRUE;
+		case BSON_TYPE_BOOL:
+			g_string_append(encoded, bson_iter_bool(iter) ? "b1" : "b0");
+			return TRUE;
+		case BSON_TYPE_OID:
+			{
+				gchar oid[25];
+
+				bson_oid_to_string(bson_iter_oid(iter), oid);
+				g_string_append_c(encoded, 'o');
+				g_string_append(encoded, oid);
+			}
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/**
+ * Returns the key of the entry of a value, NULL if the value does not contain the field.
+ */
+static
+gchar*
+jd_kv_index_entry_key (gchar const* field, gchar const* key, bson_t const* value)
+{
+	GString* entry_key;
+	bson_iter_t iter;
+	bson_iter_t child;
+
+	if (!bson_iter_init(&iter, value) || !bson_iter_find_descendant(&iter, field, &child))
+	{
+		return NULL;
+	}
+
+	entry_key = g_string_new(JD_KV_INDEX_ENTRY);
+	g_string_append(entry_key, field);
+	g_string_append(entry_key, JD_KV_INDEX_SEPARATOR);
+
+	if (!jd_kv_index_encode(&child, entry_key))
+	{
+		g_string_free(entry_key, TRUE);
+		return NULL;
+	}
+
+	g_string_append(entry_key, JD_KV_INDEX_SEPARATOR);
+	g_string_append(entry_key, key);
+
+	return g_string_free(entry_key, FALSE);
+}
+
+/**
+ * Loads the indexed fields of a namespace if necessary.
+ * Has to be called with the lock held for writing.
+ */
+static
+GPtrArray*
+jd_kv_index_load (JdKVIndex* index, gchar const* namespace)
+{
+	GPtrArray* fields;
+	gpointer iterator;
+
+	if ((fields = g_hash_table_lookup(index->namespaces, namespace)) != NULL)
+	{
+		return fields;
+	}
+
+	fields = g_ptr_array_new_with_free_func(g_free);
+
+	if (j_backend_kv_get_by_prefix(index->backend, namespace, JD_KV_INDEX_DECLARATION, &iterator))
+	{
+		bson_t value[1];
+		gchar const* key;
+
+		while (j_backend_kv_iterate(index->backend, iterator, &key, value))
+		{
+			g_ptr_array_add(fields, g_strdup(key + strlen(JD_KV_INDEX_DECLARATION)));
+			bson_destroy(value);
+		}
+	}
+
+	g_hash_table_insert(index->namespaces, g_strdup(namespace), fields);
+
+	return fields;
+}
+
+/**
+ * Returns the fields of a namespace with the lock held for reading.
+ */
+static
+GPtrArray*
+jd_kv_index_get_fields (JdKVIndex* index, gchar const* namespace)
+{
+	GPtrArray* fields;
+
+	g_rw_lock_reader_lock(index->lock);
+
+	if ((fields = g_hash_table_lookup(index->namespaces, namespace)) == NULL)
+	{
+		g_rw_lock_reader_unlock(index->lock);
+
+		g_rw_lock_writer_lock(index->lock);
+		jd_kv_index_load(index, namespace);
+		g_rw_lock_writer_unlock(index->lock);
+
+		/* Namespaces are never removed, so the fields are still there. */
+		g_rw_lock_reader_lock(index->lock);
+		fields = g_hash_table_lookup(index->namespaces, namespace);
+	}
+
+	return fields;
+}
+
+JdKVIndex*
+jd_kv_index_new (JBackend* backend)
+{
+	JdKVIndex* index;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+
+	index = g_slice_new(JdKVIndex);
+	index->backend = backend;
+	index->namespaces = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+	g_rw_lock_init(index->lock);
+
+	return index;
+}
+
+void
+jd_kv_index_free (JdKVIndex* index)
+{
+	g_return_if_fail(index != NULL);
+
+	g_hash_table_unref(index->namespaces);
+	g_rw_lock_clear(index->lock);
+
+	g_slice_free(JdKVIndex, index);
+}
+
+/**
+ * Checks whether a key is used internally by indexes.
+ */
+gboolean
+jd_kv_index_is_internal (gchar const* key)
+{
+	return (key[0] == JD_KV_INDEX_ENTRY[0] || key[0] == JD_KV_INDEX_DECLARATION[0]);
+}
+
+/**
+ * Creates an index on a field of a namespace's values and adds the existing values to it.
+ */
+gboolean
+jd_kv_index_create (JdKVIndex* index, gchar const* namespace, gchar const* field)
+{
+	g_autofree gchar* declaration_key = NULL;
+	GPtrArray* fields;
+	bson_t declaration[1];
+	gpointer iterator;
+	gpointer batch;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(index != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(field != NULL, FALSE);
+
+	g_rw_lock_writer_lock(index->lock);
+
+	fields = jd_kv_index_load(index, namespace);
+
+	for (guint i = 0; i < fields->len; i++)
+	{
+		if (g_strcmp0(g_ptr_array_index(fields, i), field) == 0)
+		{
+			goto end;
+		}
+	}
+
+	if (!j_backend_kv_batch_start(index->backend, namespace, J_SEMANTICS_SAFETY_STORAGE, &batch))
+	{
+		ret = FALSE;
+		goto end;
+	}
+
+	if (j_backend_kv_get_all(index->backend, namespace, &iterator))
+	{
+		bson_t value[1];
+		gchar const* key;
+
+		while (j_backend_kv_iterate(index->backend, iterator, &key, value))
+		{
+			g_autofree gchar* entry_key = NULL;
+
+			if (!jd_kv_index_is_internal(key) && (entry_key = jd_kv_index_entry_key(field, key, value)) != NULL)
+			{
+				bson_t entry[1];
+
+				bson_init(entry);
+				bson_append_utf8(entry, "key", -1, key, -1);
+				ret = j_backend_kv_put(index->backend, batch, entry_key, entry) && ret;
+				bson_destroy(entry);
+			}
+
+			bson_destroy(value);
+		}
+	}
+
+	declaration_key = g_strconcat(JD_KV_INDEX_DECLARATION, field, NULL);
+
+	bson_init(declaration);
+	bson_append_utf8(declaration, "field", -1, field, -1);
+	ret = j_backend_kv_put(index->backend, batch, declaration_key, declaration) && ret;
+	bson_destroy(declaration);
+
+	ret = j_backend_kv_batch_execute(index->backend, batch) && ret;
+
+	if (ret)
+	{
+		g_ptr_array_add(fields, g_strdup(field));
+	}
+
+end:
+	g_rw_lock_writer_unlock(index->lock);
+
+	return ret;
+}
+
+/**
+ * Starts maintaining the indexes of a namespace for a backend batch.
+ * Has to be ended with jd_kv_index_batch_end() after the backend batch has been executed.
+ *
+ * \return The index batch or NULL if the namespace has no indexes.
+ */
+JdKVIndexBatch*
+jd_kv_index_batch_start (JdKVIndex* index, gchar const* namespace, gpointer batch)
+{
+	JdKVIndexBatch* index_batch;
+	GPtrArray* fields;
+
+	g_return_val_if_fail(index != NULL, NULL);
+	g_return_val_if_fail(namespace != NULL, NULL);
+
+	fields = jd_kv_index_get_fields(index, namespace);
+
+	if (fields->len == 0)
+	{
+		g_rw_lock_reader_unlock(index->lock);
+		return NULL;
+	}
+
+	index_batch = g_slice_new(JdKVIndexBatch);
+	index_batch->index = index;
+	index_batch->batch = batch;
+	index_batch->namespace = namespace;
+	index_batch->fields = fields;
+	index_batch->written = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, jd_kv_index_bson_free);
+
+	return index_batch;
+}
+
+/**
+ * Replaces the entries of an old value (NULL if there was none) with the ones of a new value (NULL if it has been deleted).
+ */
+static
+void
+jd_kv_index_replace (JBackend* backend, gpointer batch, GPtrArray* fields, gchar const* key, bson_t const* old, bson_t const* value)
+{
+	for (guint i = 0; i < fields->len; i++)
+	{
+		gchar const* field = g_ptr_array_index(fields, i);
+		g_autofree gchar* old_key = NULL;
+		g_autofree gchar* new_key = NULL;
+
+		old_key = (old != NULL) ? jd_kv_index_entry_key(field, key, old) : NULL;
+		new_key = (value != NULL) ? jd_kv_index_entry_key(field, key, value) : NULL;
+
+		if (g_strcmp0(old_key, new_key) == 0)
+		{
+			continue;
+		}
+
+		if (old_key != NULL)
+		{
+			j_backend_kv_delete(backend, batch, old_key);
+		}
+
+		if (new_key != NULL)
+		{
+			bson_t entry[1];
+
+			bson_init(entry);
+			bson_append_utf8(entry, "key", -1, key, -1);
+			j_backend_kv_put(backend, batch, new_key, entry);
+			bson_destroy(entry);
+		}
+	}
+}
+
+/**
+ * Updates the entries of a key whose value is replaced (value is not NULL) or deleted (value is NULL).
+ */
+static
+void
+jd_kv_index_batch_update (JdKVIndexBatch* index_batch, gchar const* key, bson_t const* value)
+{
+	JBackend* backend = index_batch->index->backend;
+	bson_t stored[1];
+	bson_t const* old = NULL;
+	gpointer written;
+	gboolean found_stored = FALSE;
+
+	/* The previous value is either part of this batch or already stored. */
+	if (g_hash_table_lookup_extended(index_batch->written, key, NULL, &written))
+	{
+		old = written;
+	}
+	else if (j_backend_kv_get(backend, index_batch->namespace, key, stored))
+	{
+		old = stored;
+		found_stored = TRUE;
+	}
+
+	jd_kv_index_replace(backend, index_batch->batch, index_batch->fields, key, old, value);
+
+	if (found_stored)
+	{
+		bson_destroy(stored);
+	}
+
+	g_hash_table_insert(index_batch->written, g_strdup(key), (value != NULL) ? bson_copy(value) : NULL);
+}
+
+void
+jd_kv_index_batch_put (JdKVIndexBatch* index_batch, gchar const* key, bson_t const* value)
+{
+	g_return_if_fail(index_batch != NULL);
+	g_return_if_fail(key != NULL);
+	g_return_if_fail(value != NULL);
+
+	jd_kv_index_batch_update(index_batch, key, value);
+}
+
+void
+jd_kv_index_batch_delete (JdKVIndexBatch* index_batch, gchar const* key)
+{
+	g_return_if_fail(index_batch != NULL);
+	g_return_if_fail(key != NULL);
+
+	jd_kv_index_batch_update(index_batch, key, NULL);
+}
+
+void
+jd_kv_index_batch_end (JdKVIndexBatch* index_batch)
+{
+	g_return_if_fail(index_batch != NULL);
+
+	g_hash_table_unref(index_batch->written);
+	g_rw_lock_reader_unlock(index_batch->index->lock);
+
+	g_slice_free(JdKVIndexBatch, index_batch);
+}
+
+/**
+ * Checks whether a namespace has indexes.
+ */
+gboolean
+jd_kv_index_is_used (JdKVIndex* index, gchar const* namespace)
+{
+	gboolean ret;
+
+	g_return_val_if_fail(index != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+
+	ret = (jd_kv_index_get_fields(index, namespace)->len > 0);
+	g_rw_lock_reader_unlock(index->lock);
+
+	return ret;
+}
+
+/**
+ * Updates the entries of a key that has been changed without a batch, for example, by an atomic update.
+ * Concurrent changes of the same key can leave stale entries behind, which scans ignore.
+ *
+ * \param old The value before the change, NULL if the key did not exist.
+ */
+void
+jd_kv_index_update (JdKVIndex* index, gchar const* namespace, gchar const* key, bson_t const* old)
+{
+	GPtrArray* fields;
+	bson_t value[1];
+	gboolean found;
+	gpointer batch;
+
+	g_return_if_fail(index != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(key != NULL);
+
+	fields = jd_kv_index_get_fields(index, namespace);
+
+	if (fields->len > 0 && j_backend_kv_batch_start(index->backend, namespace, J_SEMANTICS_SAFETY_NETWORK, &batch))
+	{
+		found = j_backend_kv_get(index->backend, namespace, key, value);
+
+		jd_kv_index_replace(index->backend, batch, fields, key, old, (found) ? value : NULL);
+		j_backend_kv_batch_execute(index->backend, batch);
+
+		if (found)
+		{
+			bson_destroy(value);
+		}
+	}
+
+	g_rw_lock_reader_unlock(index->lock);
+}
+
+/**
+ * Compares an encoded value with a bound.
+ */
+static
+gint
+jd_kv_index_compare (gchar const* encoded, gsize encoded_len, GString const* bound)
+{
+	gint ret;
+
+	ret = memcmp(encoded, bound->str, MIN(encoded_len, bound->len));
+
+	if (ret == 0)
+	{
+		ret = (encoded_len > bound->len) - (encoded_len < bound->len);
+	}
+
+	return ret;
+}
+
+/**
+ * Calls func for all values whose field matches a range of conditions.
+ * The range supports $eq, $gt, $gte, $lt and $lte to restrict the entries that are read.
+ * All conditions are checked against the values themselves, so other operators work, too, and stale entries are ignored.
+ *
+ * \return FALSE if the field is not indexed, TRUE otherwise.
+ */
+gboolean
+jd_kv_index_scan (JdKVIndex* index, gchar const* namespace, gchar const* field, bson_t const* range, guint32 limit, JdKVIndexFunc func, gpointer data)
+{
+	g_autoptr(GString) prefix = NULL;
+	g_autoptr(GString) lower = NULL;
+	g_autoptr(GString) upper = NULL;
+	g_autofree gchar* page_start = NULL;
+	GPtrArray* fields;
+	bson_t filter[1];
+	bson_iter_t iter;
+	gboolean indexed = FALSE;
+	gboolean lower_inclusive = TRUE;
+	gboolean upper_inclusive = TRUE;
+	gboolean done = FALSE;
+	guint32 sent = 0;
+	guint32 count;
+
+	g_return_val_if_fail(index != NULL, FALSE);
+	g_return_val_if_fail(namespace != NULL, FALSE);
+	g_return_val_if_fail(field != NULL, FALSE);
+	g_return_val_if_fail(range != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+
+	fields = jd_kv_index_get_fields(index, namespace);
+
+	for (guint i = 0; i < fields->len; i++)
+	{
+		if (g_strcmp0(g_ptr_array_index(fields, i), field) == 0)
+		{
+			indexed = TRUE;
+			break;
+		}
+	}
+
+	g_rw_lock_reader_unlock(index->lock);
+
+	if (!indexed)
+	{
+		return FALSE;
+	}
+
+	if (bson_iter_init(&iter, range))
+	{
+		while (bson_iter_next(&iter))
+		{
+			gchar const* operator = bson_iter_key(&iter);
+			gboolean is_eq = (g_strcmp0(operator, "$eq") == 0);
+			g_autoptr(GString) encoded = NULL;
+
+			encoded = g_string_new(NULL);
+
+			if (!jd_kv_index_encode(&iter, encoded))
+			{
+				continue;
+			}
+
+			/* Only the first bound of each side is used to restrict the scan. */
+			if (lower == NULL && (is_eq || g_strcmp0(operator, "$gt") == 0 || g_strcmp0(operator, "$gte") == 0))
+			{
+				lower = g_string_new(encoded->str);
+				lower_inclusive = (g_strcmp0(operator, "$gt") != 0);
+			}
+
+			if (upper == NULL && (is_eq || g_strcmp0(operator, "$lt") == 0 || g_strcmp0(operator, "$lte") == 0))
+			{
+				upper = g_string_new(encoded->str);
+				upper_inclusive = (g_strcmp0(operator, "$lt") != 0);
+			}
+		}
+	}
+
+	prefix = g_string_new(JD_KV_INDEX_ENTRY);
+	g_string_append(prefix, field);
+	g_string_append(prefix, JD_KV_INDEX_SEPARATOR);
+
+	/* The first character of an encoded value is its type, bounds restrict the scan to it. */
+	if (lower != NULL || upper != NULL)
+	{
+		g_string_append_c(prefix, (lower != NULL) ? lower->str[0] : upper->str[0]);
+	}
+
+	if (lower != NULL)
+	{
+		page_start = g_strconcat(JD_KV_INDEX_ENTRY, field, JD_KV_INDEX_SEPARATOR, lower->str, (lower_inclusive) ? NULL : JD_KV_INDEX_AFTER, NULL);
+	}
+
+	bson_init(filter);
+	bson_append_document(filter, field, -1, range);
+
+	do
+	{
+		gpointer iterator = NULL;
+		bson_t entry[1];
+		gchar const* entry_key;
+		gboolean ret;
+
+		ret = j_backend_kv_get_range(index->backend, namespace, prefix->str, page_start, JD_KV_INDEX_PAGE_SIZE, &iterator);
+		count = 0;
+
+		while (ret && j_backend_kv_iterate(index->backend, iterator, &entry_key, entry))
+		{
+			bson_iter_t key_iter;
+
+			count++;
+
+			if (!done && bson_iter_init_find(&key_iter, entry, "key") && BSON_ITER_HOLDS_UTF8(&key_iter))
+			{
+				gchar const* key = bson_iter_utf8(&key_iter, NULL);
+				gsize prefix_len = strlen(JD_KV_INDEX_ENTRY) + strlen(field) + strlen(JD_KV_INDEX_SEPARATOR);
+				gsize encoded_len = strlen(entry_key) - prefix_len - strlen(JD_KV_INDEX_SEPARATOR) - strlen(key);
+
+				if (upper != NULL)
+				{
+					gint cmp;
+
+					cmp = jd_kv_index_compare(entry_key + prefix_len, encoded_len, upper);
+					done = (upper_inclusive) ? (cmp > 0) : (cmp >= 0);
+				}
+
+				if (!done)
+				{
+					bson_t value[1];
+
+					if (j_backend_kv_get(index->backend, namespace, key, value))
+					{
+						if (j_helper_bson_match(value, filter))
+						{
+							func(key, value, data);
+							sent++;
+
+							done = (limit > 0 && sent == limit);
+						}
+
+						bson_destroy(value);
+					}
+				}
+			}
+
+			/* The key is only valid until the next iteration. */
+			g_free(page_start);
+			page_start = g_strdup(entry_key);
+
+			bson_destroy(entry);
+		}
+	}
+	while (!done && count == JD_KV_INDEX_PAGE_SIZE);
+
+	bson_destroy(filter);
+
+	return TRUE;
+}
@@ -0,0 +1,468 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Shipping of KV changes to read replicas.
+ *
+ * Every replica has its own thread that ships the changed keys as ordinary put, raw put and delete messages.
+ * Like for watches, changed keys are only remembered and their current values are read when they are shipped.
+ * This coalesces fast updates of the same key and lets replicas converge even if shipping had to be retried.
+ * Replicas that are unreachable keep their changes until they are reachable again.
+ * Replicas only receive changes made after the server has started, so they have to start with the same data.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * How long changes are collected before they are shipped.
+ */
+#define JD_KV_REPLICATION_COALESCE (10 * G_TIME_SPAN_MILLISECOND)
+
+/**
+ * How long to wait before retrying an unreachable replica.
+ */
+#define JD_KV_REPLICATION_RETRY G_TIME_SPAN_SECOND
+
+/**
+ * The maximum number of changes per message.
+ */
+#define JD_KV_REPLICATION_BATCH 1024
+
+struct JdKVReplica
+{
+	JdKVReplication* replication;
+
+	guint replica;
+	GThread* thread;
+
+	/**
+	 * The changed keys, as sets per namespace.
+	 * Protected by the replication's mutex.
+	 */
+	GHashTable* pending;
+
+	/**
+	 * Signaled when the first change is pending or the replication is stopped.
+	 */
+	GCond cond;
+};
+
+typedef struct JdKVReplica JdKVReplica;
+
+struct JdKVReplication
+{
+	JBackend* backend;
+
+	/**
+	 * The index of the key-value server whose replicas receive the changes.
+	 */
+	guint index;
+
+	GMutex mutex;
+
+	JdKVReplica* replicas;
+	guint replicas_len;
+
+	gboolean stop;
+};
+
+static
+GHashTable*
+jd_kv_replication_pending_new (void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_hash_table_unref);
+}
+
+/**
+ * Remembers a changed key.
+ * Needs the replication's mutex.
+ */
+static
+void
+jd_kv_replica_add (JdKVReplica* replica, gchar const* namespace, gchar const* key)
+{
+	GHashTable* keys;
+
+	keys = g_hash_table_lookup(replica->pending, namespace);
+
+	if (keys == NULL)
+	{
+		keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert(replica->pending, g_strdup(namespace), keys);
+	}
+
+	g_hash_table_add(keys, g_strdup(key));
+}
+
+static
+JMessage*
+jd_kv_replica_message_new (JdKVReplica* replica, JMessageType type, gchar const* namespace)
+{
+	JMessage* message;
+	gsize namespace_len;
+
+	namespace_len = strlen(namespace) + 1;
+
+	message = j_message_new(type, namespace_len);
+	j_message_set_compact(message, j_connection_pool_get_compact_kv_replica(replica->replication->index, replica->replica));
+	/* The reply confirms that the replica has applied the changes. */
+	j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
+	j_message_append_n(message, namespace, namespace_len);
+
+	return message;
+}
+
+/**
+ * Sends a message to the replica and frees it.
+ */
+static
+gboolean
+jd_kv_replica_send (JdKVReplica* replica, JMessage* message)
+{
+	g_autoptr(JMessage) reply = NULL;
+
+	reply = j_connection_pool_request_kv_replica(replica->replication->index, replica->replica, message, TRUE);
+	j_message_unref(message);
+
+	return (reply != NULL);
+}
+
+/**
+ * Ships the current state of a namespace's changed keys.
+ * Keys that exist are put, all others are deleted.
+ */
+static
+gboolean
+jd_kv_replica_ship (JdKVReplica* replica, gchar const* namespace, GHashTable* keys)
+{
+	JMessage* put = NULL;
+	JMessage* put_raw = NULL;
+	JMessage* delete = NULL;
+	GHashTableIter iter;
+	gpointer key;
+	gboolean ret = TRUE;
+	guint put_count = 0;
+	guint put_raw_count = 0;
+	guint delete_count = 0;
+
+	g_hash_table_iter_init(&iter, keys);
+
+	while (ret && g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		g_autoptr(GBytes) value = NULL;
+		gsize key_len;
+
+		key_len = strlen(key) + 1;
+
+		if (j_backend_kv_get_raw(replica->replication->backend, namespace, key, &value))
+		{
+			JMessage** message;
+			guint* count;
+			bson_t document[1];
+			gconstpointer data;
+			gsize len;
+
+			data = g_bytes_get_data(value, &len);
+
+			/*
+			 * Both kinds of values are stored as the same bytes.
+			 * Documents are still shipped as documents, so that replicas whose backends only support documents keep working.
+			 */
+			if (bson_init_static(document, data, len))
+			{
+				message = &put;
+				count = &put_count;
+			}
+			else
+			{
+				message = &put_raw;
+				count = &put_raw_count;
+			}
+
+			if (*message == NULL)
+			{
+				*message = jd_kv_replica_message_new(replica, (message == &put) ? J_MESSAGE_KV_PUT : J_MESSAGE_KV_PUT_RAW, namespace);
+			}
+
+			j_message_add_operation(*message, key_len + sizeof(guint64) + len);
+			j_message_append_n(*message, key, key_len);
+			j_message_append_varint(*message, len);
+			j_message_append_n(*message, data, len);
+
+			if (++(*count) == JD_KV_REPLICATION_BATCH)
+			{
+				ret = jd_kv_replica_send(replica, *message);
+				*message = NULL;
+				*count = 0;
+			}
+		}
+		else
+		{
+			if (delete == NULL)
+			{
+				delete = jd_kv_replica_message_new(replica, J_MESSAGE_KV_DELETE, namespace);
+			}
+
+			j_message_add_operation(delete, key_len);
+			j_message_append_n(delete, key, key_len);
+
+			if (++delete_count == JD_KV_REPLICATION_BATCH)
+			{
+				ret = jd_kv_replica_send(replica, delete);
+				delete = NULL;
+				delete_count = 0;
+			}
+		}
+	}
+
+	if (ret && put != NULL)
+	{
+		ret = jd_kv_replica_send(replica, put);
+		put = NULL;
+	}
+
+	if (ret && put_raw != NULL)
+	{
+		ret = jd_kv_replica_send(replica, put_raw);
+		put_raw = NULL;
+	}
+
+	if (ret && delete != NULL)
+	{
+		ret = jd_kv_replica_send(replica, delete);
+		delete = NULL;
+	}
+
+	if (put != NULL)
+	{
+		j_message_unref(put);
+	}
+
+	if (put_raw != NULL)
+	{
+		j_message_unref(put_raw);
+	}
+
+	if (delete != NULL)
+	{
+		j_message_unref(delete);
+	}
+
+	return ret;
+}
+
+static
+gpointer
+jd_kv_replica_thread (gpointer data)
+{
+	JdKVReplica* replica = data;
+	JdKVReplication* replication = replica->replication;
+
+	g_mutex_lock(&(replication->mutex));
+
+	/* Remaining changes are still shipped when the replication is stopped. */
+	while (!replication->stop || g_hash_table_size(replica->pending) > 0)
+	{
+		GHashTable* changes;
+		GHashTableIter iter;
+		gpointer namespace;
+		gpointer keys;
+		gboolean ok = TRUE;
+
+		if (g_hash_table_size(replica->pending) == 0)
+		{
+			g_cond_wait(&(replica->cond), &(replication->mutex));
+			continue;
+		}
+
+		/* Give further changes a chance to be coalesced with the first one. */
+		if (!replication->stop)
+		{
+			g_mutex_unlock(&(replication->mutex));
+			g_usleep(JD_KV_REPLICATION_COALESCE);
+			g_mutex_lock(&(replication->mutex));
+		}
+
+		changes = replica->pending;
+		replica->pending = jd_kv_replication_pending_new();
+
+		g_mutex_unlock(&(replication->mutex));
+
+		g_hash_table_iter_init(&iter, changes);
+
+		while (ok && g_hash_table_iter_next(&iter, &namespace, &keys))
+		{
+			if ((ok = jd_kv_replica_ship(replica, namespace, keys)))
+			{
+				g_hash_table_iter_remove(&iter);
+			}
+		}
+
+		g_mutex_lock(&(replication->mutex));
+
+		if (!ok)
+		{
+			/* Hand the unshipped changes back, shipping them again is harmless. */
+			g_hash_table_iter_init(&iter, changes);
+
+			while (g_hash_table_iter_next(&iter, &namespace, &keys))
+			{
+				GHashTableIter keys_iter;
+				gpointer key;
+
+				g_hash_table_iter_init(&keys_iter, keys);
+
+				while (g_hash_table_iter_next(&keys_iter, &key, NULL))
+				{
+					jd_kv_replica_add(replica, namespace, key);
+				}
+			}
+
+			if (replication->stop)
+			{
+				g_warning("Could not ship all changes to replica %u of key-value server %u.", replica->replica, replication->index);
+				g_hash_table_unref(changes);
+				break;
+			}
+
+			/* The replica is unreachable, so do not spin. */
+			g_cond_wait_until(&(replica->cond), &(replication->mutex), g_get_monotonic_time() + JD_KV_REPLICATION_RETRY);
+		}
+
+		g_hash_table_unref(changes);
+	}
+
+	g_mutex_unlock(&(replication->mutex));
+
+	return NULL;
+}
+
+/**
+ * Starts shipping changes to the read replicas of a key-value server.
+ * The connection pool has to be initialized.
+ */
+JdKVReplication*
+jd_kv_replication_new (JBackend* backend, guint index, guint replicas)
+{
+	JdKVReplication* replication;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+	g_return_val_if_fail(replicas > 0, NULL);
+
+	replication = g_slice_new(JdKVReplication);
+	replication->backend = backend;
+	replication->index = index;
+	replication->replicas = g_new(JdKVReplica, replicas);
+	replication->replicas_len = replicas;
+	replication->stop = FALSE;
+
+	g_mutex_init(&(replication->mutex));
+
+	for (guint i = 0; i < replicas; i++)
+	{
+		JdKVReplica* replica = &(replication->replicas[i]);
+
+		replica->replication = replication;
+		replica->replica = i;
+		replica->pending = jd_kv_replication_pending_new();
+
+		g_cond_init(&(replica->cond));
+	}
+
+	for (guint i = 0; i < replicas; i++)
+	{
+		replication->replicas[i].thread = g_thread_new("julea-kv-replica", jd_kv_replica_thread, &(replication->replicas[i]));
+	}
+
+	return replication;
+}
+
+/**
+ * Ships the remaining changes and stops the replication.
+ * Replicas that are unreachable at this point miss their remaining changes.
+ */
+void
+jd_kv_replication_free (JdKVReplication* replication)
+{
+	g_return_if_fail(replication != NULL);
+
+	g_mutex_lock(&(replication->mutex));
+
+	replication->stop = TRUE;
+
+	for (guint i = 0; i < replication->replicas_len; i++)
+	{
+		g_cond_signal(&(replication->replicas[i].cond));
+	}
+
+	g_mutex_unlock(&(replication->mutex));
+
+	for (guint i = 0; i < replication->replicas_len; i++)
+	{
+		JdKVReplica* replica = &(replication->replicas[i]);
+
+		g_thread_join(replica->thread);
+
+		g_hash_table_unref(replica->pending);
+		g_cond_clear(&(replica->cond));
+	}
+
+	g_mutex_clear(&(replication->mutex));
+
+	g_free(replication->replicas);
+	g_slice_free(JdKVReplication, replication);
+}
+
+/**
+ * Records a changed key for all replicas.
+ */
+void
+jd_kv_replication_notify (JdKVReplication* replication, gchar const* namespace, gchar const* key)
+{
+	g_return_if_fail(replication != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(key != NULL);
+
+	g_mutex_lock(&(replication->mutex));
+
+	for (guint i = 0; i < replication->replicas_len; i++)
+	{
+		JdKVReplica* replica = &(replication->replicas[i]);
+
+		if (g_hash_table_size(replica->pending) == 0)
+		{
+			g_cond_signal(&(replica->cond));
+		}
+
+		jd_kv_replica_add(replica, namespace, key);
+	}
+
+	g_mutex_unlock(&(replication->mutex));
+}
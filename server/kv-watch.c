@@ -0,0 +1,403 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Change notifications for KV prefixes.
+ *
+ * A client watches a prefix by sending J_MESSAGE_KV_WATCH over a dedicated connection.
+ * Afterwards, every watch has its own thread that pushes notifications over the connection.
+ * Changed keys are only remembered, so that fast updates of the same key are coalesced into a single notification.
+ * If the client has asked for values, the current values are read when the notification is sent.
+ * The connection's handler continues to receive messages as usual, so a watch ends when the client closes the connection.
+ * If sending a notification fails, the connection is shut down, which also ends the handler.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * How long changes are collected before they are sent.
+ */
+#define JD_KV_WATCH_COALESCE (10 * G_TIME_SPAN_MILLISECOND)
+
+/**
+ * How often idle watches check whether their connection has been closed.
+ */
+#define JD_KV_WATCH_CHECK_INTERVAL G_TIME_SPAN_SECOND
+
+/**
+ * The maximum number of changes per notification.
+ */
+#define JD_KV_WATCH_BATCH 1024
+
+struct JdKVWatcher
+{
+	JdKVWatch* watch;
+
+	GSocketConnection* connection;
+	GThread* thread;
+
+	gchar* namespace;
+	gchar* prefix;
+	gboolean values;
+
+	/**
+	 * The changed keys, mapped to whether they have been deleted.
+	 * Protected by the watch's mutex.
+	 */
+	GHashTable* pending;
+
+	/**
+	 * Signaled when the first change is pending or the watch is stopped.
+	 */
+	GCond cond;
+
+	gboolean stop;
+};
+
+typedef struct JdKVWatcher JdKVWatcher;
+
+struct JdKVWatch
+{
+	JBackend* backend;
+
+	GMutex mutex;
+
+	/**
+	 * Signaled whenever a watcher has finished.
+	 */
+	GCond cond;
+
+	/**
+	 * The active watchers, protected by #mutex.
+	 */
+	GList* watchers;
+
+	/**
+	 * The number of active watchers, so that changes can be ignored without locking if there are none.
+	 */
+	gint count;
+};
+
+/**
+ * Checks whether the client has closed the connection.
+ * Clients do not send anything after the watch message, so a readable connection signals its end.
+ */
+static
+gboolean
+jd_kv_watch_connection_closed (GSocketConnection* connection)
+{
+	GSocket* socket_;
+
+	socket_ = g_socket_connection_get_socket(connection);
+
+	if (g_socket_is_closed(socket_))
+	{
+		return TRUE;
+	}
+
+	return (g_socket_condition_check(socket_, G_IO_IN | G_IO_ERR | G_IO_HUP) != 0);
+}
+
+/**
+ * Sends a notification for a number of changes.
+ * Each operation consists of the key, whether it has been deleted and, if requested, its current value.
+ */
+static
+gboolean
+jd_kv_watch_send (JdKVWatcher* watcher, GHashTable* changes)
+{
+	g_autoptr(JMessage) message = NULL;
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	gboolean ret = TRUE;
+	guint count = 0;
+
+	g_hash_table_iter_init(&iter, changes);
+
+	while (ret && g_hash_table_iter_next(&iter, &key, &value))
+	{
+		guint32 key_len;
+		gchar deleted;
+
+		if (message == NULL)
+		{
+			message = j_message_new(J_MESSAGE_KV_WATCH, 0);
+		}
+
+		key_len = strlen(key) + 1;
+		deleted = GPOINTER_TO_INT(value);
+
+		if (watcher->values && !deleted)
+		{
+			g_autoptr(GBytes) current = NULL;
+
+			/* Values are sent as they are stored, which also works for raw values. */
+			if (j_backend_kv_get_raw(watcher->watch->backend, watcher->namespace, key, &current))
+			{
+				gconstpointer current_data;
+				gsize current_len;
+
+				current_data = g_bytes_get_data(current, &current_len);
+
+				j_message_add_operation(message, key_len + 1 + sizeof(guint64) + current_len);
+				j_message_append_n(message, key, key_len);
+				j_message_append_1(message, &deleted);
+				j_message_append_varint(message, current_len);
+				j_message_append_n(message, current_data, current_len);
+			}
+			else
+			{
+				/* The key has been deleted in the meantime. */
+				deleted = 1;
+
+				j_message_add_operation(message, key_len + 1 + sizeof(guint64));
+				j_message_append_n(message, key, key_len);
+				j_message_append_1(message, &deleted);
+				j_message_append_varint(message, 0);
+			}
+		}
+		else if (watcher->values)
+		{
+			j_message_add_operation(message, key_len + 1 + sizeof(guint64));
+			j_message_append_n(message, key, key_len);
+			j_message_append_1(message, &deleted);
+			j_message_append_varint(message, 0);
+		}
+		else
+		{
+			j_message_add_operation(message, key_len + 1);
+			j_message_append_n(message, key, key_len);
+			j_message_append_1(message, &deleted);
+		}
+
+		if (++count == JD_KV_WATCH_BATCH)
+		{
+			ret = j_message_send(message, watcher->connection);
+			g_clear_pointer(&message, j_message_unref);
+			count = 0;
+		}
+	}
+
+	if (ret && message != NULL)
+	{
+		ret = j_message_send(message, watcher->connection);
+	}
+
+	return ret;
+}
+
+static
+gpointer
+jd_kv_watch_thread (gpointer data)
+{
+	JdKVWatcher* watcher = data;
+	JdKVWatch* watch = watcher->watch;
+
+	g_mutex_lock(&(watch->mutex));
+
+	while (!watcher->stop)
+	{
+		GHashTable* changes;
+		gboolean ok;
+
+		if (g_hash_table_size(watcher->pending) == 0)
+		{
+			g_cond_wait_until(&(watcher->cond), &(watch->mutex), g_get_monotonic_time() + JD_KV_WATCH_CHECK_INTERVAL);
+
+			if (!watcher->stop && g_hash_table_size(watcher->pending) == 0 && jd_kv_watch_connection_closed(watcher->connection))
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		/* Give further changes a chance to be coalesced with the first one. */
+		g_mutex_unlock(&(watch->mutex));
+		g_usleep(JD_KV_WATCH_COALESCE);
+		g_mutex_lock(&(watch->mutex));
+
+		changes = watcher->pending;
+		watcher->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+		g_mutex_unlock(&(watch->mutex));
+		ok = jd_kv_watch_send(watcher, changes);
+		g_hash_table_unref(changes);
+		g_mutex_lock(&(watch->mutex));
+
+		if (!ok)
+		{
+			break;
+		}
+	}
+
+	watch->watchers = g_list_remove(watch->watchers, watcher);
+	g_atomic_int_add(&(watch->count), -1);
+	g_cond_broadcast(&(watch->cond));
+
+	g_mutex_unlock(&(watch->mutex));
+
+	/* The connection's handler notices the shutdown and cleans up as usual. */
+	g_socket_shutdown(g_socket_connection_get_socket(watcher->connection), TRUE, TRUE, NULL);
+	g_object_unref(watcher->connection);
+
+	g_hash_table_unref(watcher->pending);
+	g_cond_clear(&(watcher->cond));
+	g_free(watcher->namespace);
+	g_free(watcher->prefix);
+	g_slice_free(JdKVWatcher, watcher);
+
+	return NULL;
+}
+
+JdKVWatch*
+jd_kv_watch_new (JBackend* backend)
+{
+	JdKVWatch* watch;
+
+	g_return_val_if_fail(backend != NULL, NULL);
+
+	watch = g_slice_new(JdKVWatch);
+	watch->backend = backend;
+	watch->watchers = NULL;
+	watch->count = 0;
+
+	g_mutex_init(&(watch->mutex));
+	g_cond_init(&(watch->cond));
+
+	return watch;
+}
+
+void
+jd_kv_watch_free (JdKVWatch* watch)
+{
+	g_return_if_fail(watch != NULL);
+
+	g_mutex_lock(&(watch->mutex));
+
+	for (GList* l = watch->watchers; l != NULL; l = l->next)
+	{
+		JdKVWatcher* watcher = l->data;
+
+		watcher->stop = TRUE;
+		g_cond_signal(&(watcher->cond));
+
+		/* Wake up watchers that are blocked sending to slow clients. */
+		g_socket_shutdown(g_socket_connection_get_socket(watcher->connection), FALSE, TRUE, NULL);
+	}
+
+	while (watch->watchers != NULL)
+	{
+		g_cond_wait(&(watch->cond), &(watch->mutex));
+	}
+
+	g_mutex_unlock(&(watch->mutex));
+
+	g_mutex_clear(&(watch->mutex));
+	g_cond_clear(&(watch->cond));
+
+	g_slice_free(JdKVWatch, watch);
+}
+
+/**
+ * Starts watching a prefix.
+ * Notifications are sent over the connection until it is closed, so the watch's reply has to be sent before.
+ */
+void
+jd_kv_watch_add (JdKVWatch* watch, GSocketConnection* connection, gchar const* namespace, gchar const* prefix, gboolean values)
+{
+	JdKVWatcher* watcher;
+
+	g_return_if_fail(watch != NULL);
+	g_return_if_fail(connection != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(prefix != NULL);
+
+	watcher = g_slice_new(JdKVWatcher);
+	watcher->watch = watch;
+	watcher->connection = g_object_ref(connection);
+	watcher->namespace = g_strdup(namespace);
+	watcher->prefix = g_strdup(prefix);
+	watcher->values = values;
+	watcher->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	watcher->stop = FALSE;
+
+	g_cond_init(&(watcher->cond));
+
+	g_mutex_lock(&(watch->mutex));
+
+	watch->watchers = g_list_prepend(watch->watchers, watcher);
+	g_atomic_int_add(&(watch->count), 1);
+
+	/* The thread frees the watcher when it finishes. */
+	watcher->thread = g_thread_new("julea-kv-watch", jd_kv_watch_thread, watcher);
+	g_thread_unref(watcher->thread);
+
+	g_mutex_unlock(&(watch->mutex));
+}
+
+/**
+ * Records a changed key for all watches whose prefix it matches.
+ */
+void
+jd_kv_watch_notify (JdKVWatch* watch, gchar const* namespace, gchar const* key, gboolean deleted)
+{
+	g_return_if_fail(watch != NULL);
+	g_return_if_fail(namespace != NULL);
+	g_return_if_fail(key != NULL);
+
+	if (G_LIKELY(g_atomic_int_get(&(watch->count)) == 0))
+	{
+		return;
+	}
+
+	g_mutex_lock(&(watch->mutex));
+
+	for (GList* l = watch->watchers; l != NULL; l = l->next)
+	{
+		JdKVWatcher* watcher = l->data;
+
+		if (g_strcmp0(watcher->namespace, namespace) != 0 || !g_str_has_prefix(key, watcher->prefix))
+		{
+			continue;
+		}
+
+		if (g_hash_table_size(watcher->pending) == 0)
+		{
+			g_cond_signal(&(watcher->cond));
+		}
+
+		g_hash_table_insert(watcher->pending, g_strdup(key), GINT_TO_POINTER(deleted ? 1 : 0));
+	}
+
+	g_mutex_unlock(&(watch->mutex));
+}
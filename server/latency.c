@@ -0,0 +1,220 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Latency histograms for all message types.
+ *
+ * Each message's latency is split into the time it waited before being handled (queue),
+ * the time spent handling it (backend) and the time spent sending replies (send).
+ * Latencies are counted in logarithmic buckets, that is, bucket i contains all latencies below 2^i microseconds that do not fit into bucket i-1.
+ * Counters are updated atomically, so recording does not require any locking.
+ *
+ * Additionally, the latencies of the most recent traced messages are kept in a small ring.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The number of message types.
+ */
+#define JD_LATENCY_TYPES (J_MESSAGE_COMPOUND + 1)
+
+/**
+ * The number of traced messages to keep.
+ */
+#define JD_LATENCY_TRACED 64
+
+struct JdLatencyTraced
+{
+	guint64 trace_id;
+	guint64 type;
+	guint64 usec[JD_LATENCY_PHASES];
+};
+
+typedef struct JdLatencyTraced JdLatencyTraced;
+
+static gsize jd_latency[JD_LATENCY_TYPES][JD_LATENCY_PHASES][JD_LATENCY_BUCKETS];
+
+static JdLatencyTraced jd_latency_traced[JD_LATENCY_TRACED];
+static guint jd_latency_traced_count = 0;
+
+G_LOCK_DEFINE_STATIC(jd_latency_traced);
+
+/**
+ * Records a latency.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param type  A message type.
+ * \param phase A phase.
+ * \param usec  A latency in microseconds.
+ **/
+void
+jd_latency_record (JMessageType type, JdLatencyPhase phase, gint64 usec)
+{
+	guint bucket;
+
+	g_return_if_fail((guint)type < JD_LATENCY_TYPES);
+	g_return_if_fail(phase < JD_LATENCY_PHASES);
+
+	if (usec < 0)
+	{
+		usec = 0;
+	}
+
+	bucket = MIN(g_bit_storage(usec), JD_LATENCY_BUCKETS - 1);
+	g_atomic_pointer_add(&(jd_latency[type][phase][bucket]), 1);
+}
+
+/**
+ * Appends all histograms to a message.
+ * The operation consists of the number of message types, phases and buckets (4 bytes each),
+ * followed by the counters (8 bytes each) ordered by message type, phase and bucket.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ **/
+void
+jd_latency_append (JMessage* message)
+{
+	guint32 value;
+
+	g_return_if_fail(message != NULL);
+
+	j_message_add_operation(message, 3 * sizeof(guint32) + JD_LATENCY_TYPES * JD_LATENCY_PHASES * JD_LATENCY_BUCKETS * sizeof(guint64));
+
+	value = JD_LATENCY_TYPES;
+	j_message_append_4(message, &value);
+	value = JD_LATENCY_PHASES;
+	j_message_append_4(message, &value);
+	value = JD_LATENCY_BUCKETS;
+	j_message_append_4(message, &value);
+
+	for (guint i = 0; i < JD_LATENCY_TYPES; i++)
+	{
+		for (guint j = 0; j < JD_LATENCY_PHASES; j++)
+		{
+			for (guint k = 0; k < JD_LATENCY_BUCKETS; k++)
+			{
+				guint64 count;
+
+				count = (gsize)g_atomic_pointer_get(&(jd_latency[i][j][k]));
+				j_message_append_8(message, &count);
+			}
+		}
+	}
+}
+
+/**
+ * Records the latencies of a traced message.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param trace_id A trace ID.
+ * \param type     A message type.
+ * \param queue    The queue latency in microseconds.
+ * \param backend  The backend latency in microseconds.
+ * \param send     The send latency in microseconds.
+ **/
+void
+jd_latency_record_traced (guint64 trace_id, JMessageType type, gint64 queue, gint64 backend, gint64 send)
+{
+	JdLatencyTraced* traced;
+
+	g_return_if_fail(trace_id != 0);
+
+	g_debug("Trace %016" G_GINT64_MODIFIER "x: message type %d queued %" G_GINT64_FORMAT " us, handled %" G_GINT64_FORMAT " us, sent %" G_GINT64_FORMAT " us", trace_id, type, queue, backend, send);
+
+	G_LOCK(jd_latency_traced);
+
+	traced = &(jd_latency_traced[jd_latency_traced_count % JD_LATENCY_TRACED]);
+	traced->trace_id = trace_id;
+	traced->type = type;
+	traced->usec[JD_LATENCY_QUEUE] = MAX(queue, 0);
+	traced->usec[JD_LATENCY_BACKEND] = MAX(backend, 0);
+	traced->usec[JD_LATENCY_SEND] = MAX(send, 0);
+	jd_latency_traced_count++;
+
+	G_UNLOCK(jd_latency_traced);
+}
+
+/**
+ * Appends the most recent traced messages to a message.
+ * The operation consists of the number of traced messages (8 bytes),
+ * followed by the trace ID, the message type and the queue, backend and send latencies (8 bytes each) of every traced message, oldest first.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param message A message.
+ **/
+void
+jd_latency_append_traced (JMessage* message)
+{
+	JdLatencyTraced traced[JD_LATENCY_TRACED];
+	guint64 count;
+	guint first;
+
+	g_return_if_fail(message != NULL);
+
+	G_LOCK(jd_latency_traced);
+
+	count = MIN(jd_latency_traced_count, JD_LATENCY_TRACED);
+	first = jd_latency_traced_count - count;
+
+	for (guint i = 0; i < count; i++)
+	{
+		traced[i] = jd_latency_traced[(first + i) % JD_LATENCY_TRACED];
+	}
+
+	G_UNLOCK(jd_latency_traced);
+
+	j_message_add_operation(message, (1 + count * (2 + JD_LATENCY_PHASES)) * sizeof(guint64));
+	j_message_append_8(message, &count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		j_message_append_8(message, &(traced[i].trace_id));
+		j_message_append_8(message, &(traced[i].type));
+
+		for (guint j = 0; j < JD_LATENCY_PHASES; j++)
+		{
+			j_message_append_8(message, &(traced[i].usec[j]));
+		}
+	}
+}
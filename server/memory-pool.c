@@ -0,0 +1,185 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * A pool of memory chunks shared by all connections.
+ *
+ * Chunks are only allocated when a message needs one and returned to the pool afterwards.
+ * If the pool is limited and all chunks are in use, acquiring blocks until one is released.
+ * Chunks of unlimited pools grow as necessary, so that large replies do not have to be split.
+ * Since the waiting thread does not read from its connection anymore, this pushes back on the client via TCP flow control.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+struct JdMemoryPool
+{
+	/**
+	 * The unused chunks.
+	 */
+	GQueue chunks;
+
+	/**
+	 * The size of each chunk.
+	 */
+	guint64 chunk_size;
+
+	/**
+	 * The number of allocated chunks and the maximum number, 0 if unlimited.
+	 */
+	guint allocated;
+	guint max;
+
+	GMutex mutex;
+	GCond cond;
+};
+
+/**
+ * Creates a new memory pool.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param chunk_size The size of each chunk.
+ * \param max        The maximum number of chunks, 0 if unlimited.
+ *
+ * \return A new memory pool. Should be freed with jd_memory_pool_free().
+ **/
+JdMemoryPool*
+jd_memory_pool_new (guint64 chunk_size, guint max)
+{
+	JdMemoryPool* pool;
+
+	g_return_val_if_fail(chunk_size > 0, NULL);
+
+	pool = g_slice_new(JdMemoryPool);
+	g_queue_init(&(pool->chunks));
+	pool->chunk_size = chunk_size;
+	pool->allocated = 0;
+	pool->max = max;
+	g_mutex_init(&(pool->mutex));
+	g_cond_init(&(pool->cond));
+
+	return pool;
+}
+
+/**
+ * Frees the memory allocated for the pool.
+ * All chunks have to be released before.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param pool A memory pool.
+ **/
+void
+jd_memory_pool_free (JdMemoryPool* pool)
+{
+	JMemoryChunk* chunk;
+
+	g_return_if_fail(pool != NULL);
+
+	while ((chunk = g_queue_pop_head(&(pool->chunks))) != NULL)
+	{
+		j_memory_chunk_free(chunk);
+	}
+
+	g_cond_clear(&(pool->cond));
+	g_mutex_clear(&(pool->mutex));
+
+	g_slice_free(JdMemoryPool, pool);
+}
+
+/**
+ * Acquires a chunk, waiting until one is available.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param pool A memory pool.
+ *
+ * \return A memory chunk. Should be released with jd_memory_pool_release().
+ **/
+JMemoryChunk*
+jd_memory_pool_acquire (JdMemoryPool* pool)
+{
+	JMemoryChunk* chunk;
+
+	g_return_val_if_fail(pool != NULL, NULL);
+
+	g_mutex_lock(&(pool->mutex));
+
+	while ((chunk = g_queue_pop_head(&(pool->chunks))) == NULL)
+	{
+		if (pool->max == 0 || pool->allocated < pool->max)
+		{
+			pool->allocated++;
+			break;
+		}
+
+		g_cond_wait(&(pool->cond), &(pool->mutex));
+	}
+
+	g_mutex_unlock(&(pool->mutex));
+
+	if (chunk == NULL)
+	{
+		chunk = (pool->max == 0) ? j_memory_chunk_new_growable(pool->chunk_size) : j_memory_chunk_new(pool->chunk_size);
+	}
+
+	return chunk;
+}
+
+/**
+ * Releases a chunk.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param pool  A memory pool.
+ * \param chunk A memory chunk.
+ **/
+void
+jd_memory_pool_release (JdMemoryPool* pool, JMemoryChunk* chunk)
+{
+	g_return_if_fail(pool != NULL);
+	g_return_if_fail(chunk != NULL);
+
+	j_memory_chunk_reset(chunk);
+
+	g_mutex_lock(&(pool->mutex));
+	g_queue_push_head(&(pool->chunks), chunk);
+	g_cond_signal(&(pool->cond));
+	g_mutex_unlock(&(pool->mutex));
+}
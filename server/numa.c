@@ -0,0 +1,181 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Binding the server to a NUMA node.
+ *
+ * The server's main thread is bound to the node's processors before any other thread is started, so all threads inherit its affinity.
+ * Memory chunks and message buffers are allocated lazily by the threads using them, so the kernel's first-touch policy places them on the same node.
+ **/
+
+#include <julea-config.h>
+
+#ifdef HAVE_SCHED_SETAFFINITY
+/* Required for sched_setaffinity() */
+#define _GNU_SOURCE
+#endif
+
+#include <glib.h>
+
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+
+#include <stdlib.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * Reads the NUMA node of a network interface or block device from sysfs.
+ * NVMe namespaces only report the node of their controller.
+ *
+ * \return The node, -1 if it is unknown.
+ */
+static
+gint
+jd_numa_device_node (gchar const* device)
+{
+	gchar const* const patterns[] = {
+		"/sys/class/net/%s/device/numa_node",
+		"/sys/class/block/%s/device/numa_node",
+		"/sys/class/block/%s/device/device/numa_node"
+	};
+
+	for (guint i = 0; i < G_N_ELEMENTS(patterns); i++)
+	{
+		g_autofree gchar* path = NULL;
+		g_autofree gchar* contents = NULL;
+
+		path = g_strdup_printf(patterns[i], device);
+
+		if (g_file_get_contents(path, &contents, NULL, NULL))
+		{
+			return atoi(contents);
+		}
+	}
+
+	return -1;
+}
+
+#ifdef HAVE_SCHED_SETAFFINITY
+/**
+ * Parses a list of processors like "0-15,32-47" as found in sysfs.
+ */
+static
+gboolean
+jd_numa_parse_cpulist (gchar const* cpulist, cpu_set_t* set)
+{
+	g_auto(GStrv) ranges = NULL;
+
+	CPU_ZERO(set);
+
+	ranges = g_strsplit(g_strstrip((gchar*)cpulist), ",", 0);
+
+	for (guint i = 0; ranges[i] != NULL; i++)
+	{
+		gchar* end;
+		guint64 first;
+		guint64 last;
+
+		if (ranges[i][0] == '\0')
+		{
+			continue;
+		}
+
+		first = g_ascii_strtoull(ranges[i], &end, 10);
+		last = (*end == '-') ? g_ascii_strtoull(end + 1, &end, 10) : first;
+
+		if (*end != '\0' || last < first)
+		{
+			return FALSE;
+		}
+
+		for (guint64 cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+		{
+			CPU_SET(cpu, set);
+		}
+	}
+
+	return (CPU_COUNT(set) > 0);
+}
+#endif
+
+/**
+ * Binds the calling thread and all threads started by it afterwards to a NUMA node.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param node The number of a node or the name of a network interface or block device local to it.
+ *
+ * \return TRUE on success, FALSE otherwise.
+ **/
+gboolean
+jd_numa_bind (gchar const* node)
+{
+#ifdef HAVE_SCHED_SETAFFINITY
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* cpulist = NULL;
+	cpu_set_t set;
+	gchar* end;
+	gint number;
+#endif
+
+	g_return_val_if_fail(node != NULL, FALSE);
+
+#ifdef HAVE_SCHED_SETAFFINITY
+	number = (gint)g_ascii_strtoll(node, &end, 10);
+
+	if (end == node || *end != '\0')
+	{
+		number = jd_numa_device_node(node);
+	}
+
+	if (number < 0)
+	{
+		g_warning("Could not determine the NUMA node of %s.", node);
+		return FALSE;
+	}
+
+	path = g_strdup_printf("/sys/devices/system/node/node%d/cpulist", number);
+
+	if (!g_file_get_contents(path, &cpulist, NULL, NULL) || !jd_numa_parse_cpulist(cpulist, &set))
+	{
+		g_warning("Could not determine the processors of NUMA node %d.", number);
+		return FALSE;
+	}
+
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+	{
+		g_warning("Could not bind to NUMA node %d.", number);
+		return FALSE;
+	}
+
+	return TRUE;
+#else
+	g_warning("Binding to NUMA nodes is not supported.");
+
+	return FALSE;
+#endif
+}
@@ -0,0 +1,188 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Opaque handles for objects that have been opened explicitly.
+ *
+ * Clients open an object using J_MESSAGE_OBJECT_OPEN and afterwards refer to it using the returned handle instead of its namespace and path.
+ * Every handle keeps a handle of the handle cache in use, so the object does not have to be looked up again.
+ * Like file descriptors, handles keep referring to the object they have been opened for, even if it is deleted in the meantime.
+ * Handles are shared by all connections, because clients spread their messages over several ones.
+ * Their values are random, so that handles of a previous server instance are not mistaken for current ones.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+struct JdObjectHandles
+{
+	JdHandleCache* cache;
+
+	/**
+	 * Maps handles to the handle cache's handles.
+	 */
+	GHashTable* handles;
+
+	GMutex mutex[1];
+};
+
+JdObjectHandles*
+jd_object_handles_new (JdHandleCache* cache)
+{
+	JdObjectHandles* handles;
+
+	g_return_val_if_fail(cache != NULL, NULL);
+
+	handles = g_slice_new(JdObjectHandles);
+	handles->cache = cache;
+	handles->handles = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+
+	g_mutex_init(handles->mutex);
+
+	return handles;
+}
+
+/**
+ * Closes all remaining handles.
+ * Has to be called before the handle cache is freed.
+ */
+void
+jd_object_handles_free (JdObjectHandles* handles)
+{
+	GHashTableIter iter;
+	gpointer handle;
+
+	g_return_if_fail(handles != NULL);
+
+	g_hash_table_iter_init(&iter, handles->handles);
+
+	while (g_hash_table_iter_next(&iter, NULL, &handle))
+	{
+		jd_handle_cache_release(handles->cache, handle);
+	}
+
+	g_hash_table_destroy(handles->handles);
+	g_mutex_clear(handles->mutex);
+
+	g_slice_free(JdObjectHandles, handles);
+}
+
+/**
+ * Opens an object.
+ *
+ * \return A new handle, 0 if the object could not be opened.
+ */
+guint64
+jd_object_handles_open (JdObjectHandles* handles, gchar const* namespace, gchar const* path)
+{
+	gpointer handle;
+	gpointer object;
+	guint64* id;
+
+	g_return_val_if_fail(handles != NULL, 0);
+	g_return_val_if_fail(namespace != NULL, 0);
+	g_return_val_if_fail(path != NULL, 0);
+
+	if ((handle = jd_handle_cache_open(handles->cache, namespace, path, &object)) == NULL)
+	{
+		return 0;
+	}
+
+	id = g_new(guint64, 1);
+
+	g_mutex_lock(handles->mutex);
+
+	do
+	{
+		*id = ((guint64)g_random_int() << 32) | g_random_int();
+	}
+	while (*id == 0 || g_hash_table_contains(handles->handles, id));
+
+	g_hash_table_insert(handles->handles, id, handle);
+
+	g_mutex_unlock(handles->mutex);
+
+	return *id;
+}
+
+/**
+ * Closes a handle.
+ * Messages that are still using the handle's object keep it open until they have finished.
+ *
+ * \return TRUE if the handle existed, FALSE otherwise.
+ */
+gboolean
+jd_object_handles_close (JdObjectHandles* handles, guint64 id)
+{
+	gpointer handle = NULL;
+	gboolean ret;
+
+	g_return_val_if_fail(handles != NULL, FALSE);
+
+	g_mutex_lock(handles->mutex);
+
+	if ((ret = g_hash_table_lookup_extended(handles->handles, &id, NULL, &handle)))
+	{
+		g_hash_table_remove(handles->handles, &id);
+	}
+
+	g_mutex_unlock(handles->mutex);
+
+	if (ret)
+	{
+		jd_handle_cache_release(handles->cache, handle);
+	}
+
+	return ret;
+}
+
+/**
+ * Returns the handle cache's handle for a handle, like jd_handle_cache_open() does for a namespace and path.
+ * The returned handle has to be released using jd_handle_cache_release().
+ *
+ * \return A handle of the handle cache, NULL if the handle does not exist.
+ */
+gpointer
+jd_object_handles_get (JdObjectHandles* handles, guint64 id, gpointer* object)
+{
+	gpointer handle;
+
+	g_return_val_if_fail(handles != NULL, NULL);
+	g_return_val_if_fail(object != NULL, NULL);
+
+	*object = NULL;
+
+	g_mutex_lock(handles->mutex);
+
+	/* The reference has to be acquired before the handle can be closed by another thread. */
+	if ((handle = g_hash_table_lookup(handles->handles, &id)) != NULL)
+	{
+		jd_handle_cache_ref(handles->cache, handle, object);
+	}
+
+	g_mutex_unlock(handles->mutex);
+
+	return handle;
+}
@@ -0,0 +1,255 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Pipelined message handling for a single connection.
+ *
+ * The connection's thread only receives messages and hands them to an executor thread.
+ * This way, the next message is already received and decoded while the current one is being executed.
+ * Since there is only one executor per connection, replies are sent in the same order as the messages have been received.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * The maximum number of messages received ahead of the one being executed.
+ */
+#define JD_PIPELINE_DEPTH 4
+
+struct JdPipeline
+{
+	GSocketConnection* connection;
+	JStatistics* statistics;
+
+	/**
+	 * Messages that can be used for receiving.
+	 */
+	GAsyncQueue* free;
+
+	/**
+	 * Messages that have been received and wait for being executed.
+	 */
+	GAsyncQueue* ready;
+
+	/**
+	 * Signals that a message's payload has been consumed.
+	 */
+	GAsyncQueue* consumed;
+
+	/**
+	 * The times at which the messages in the pipeline have been received.
+	 * Messages are executed in order and at most JD_PIPELINE_DEPTH of them are in flight, so a ring buffer suffices.
+	 */
+	gint64 received[JD_PIPELINE_DEPTH];
+
+	/**
+	 * Set by the executor if the connection should be closed.
+	 */
+	gint stop;
+};
+
+typedef struct JdPipeline JdPipeline;
+
+/**
+ * Marks the end of the ready queue.
+ */
+static gint jd_pipeline_end;
+
+/**
+ * Checks whether a message is followed by additional data that is read from the connection while it is executed.
+ * The next message can only be received after this data has been consumed.
+ */
+static
+gboolean
+jd_pipeline_has_payload (JMessage* message)
+{
+	gboolean ret = FALSE;
+
+	switch (j_message_get_type(message))
+	{
+		case J_MESSAGE_OBJECT_WRITE:
+		case J_MESSAGE_OBJECT_APPEND:
+		case J_MESSAGE_ECHO:
+		case J_MESSAGE_COMPOUND:
+			/* Compound messages might contain writes. */
+			ret = TRUE;
+			break;
+		case J_MESSAGE_NONE:
+		case J_MESSAGE_PING:
+		case J_MESSAGE_STATISTICS:
+		case J_MESSAGE_OBJECT_CREATE:
+		case J_MESSAGE_OBJECT_DELETE:
+		case J_MESSAGE_OBJECT_READ:
+		case J_MESSAGE_OBJECT_STATUS:
+		case J_MESSAGE_KV_PUT:
+		case J_MESSAGE_KV_DELETE:
+		case J_MESSAGE_KV_GET:
+		case J_MESSAGE_KV_GET_ALL:
+		case J_MESSAGE_KV_GET_BY_PREFIX:
+		case J_MESSAGE_OBJECT_CAPACITY:
+		case J_MESSAGE_OBJECT_TRUNCATE:
+		case J_MESSAGE_OBJECT_ALLOCATE:
+		case J_MESSAGE_OBJECT_PUNCH_HOLE:
+		case J_MESSAGE_OBJECT_COPY:
+		case J_MESSAGE_KV_COMPARE_AND_SWAP:
+		case J_MESSAGE_KV_INCREMENT:
+		case J_MESSAGE_KV_CREATE_INDEX:
+		case J_MESSAGE_KV_GET_BY_INDEX:
+		case J_MESSAGE_KV_MAX_MERGE:
+		case J_MESSAGE_OBJECT_PURGE:
+		case J_MESSAGE_KV_DELETE_BY_PREFIX:
+		case J_MESSAGE_LOCK_ACQUIRE:
+		case J_MESSAGE_LOCK_RELEASE:
+		case J_MESSAGE_LOCK_REVOKE:
+		case J_MESSAGE_OBJECT_LIST:
+		case J_MESSAGE_OBJECT_DEDUP:
+		case J_MESSAGE_OBJECT_REDUCE:
+		case J_MESSAGE_KV_WATCH:
+		case J_MESSAGE_KV_PUT_RAW:
+		case J_MESSAGE_KV_GET_RAW:
+		case J_MESSAGE_OBJECT_OPEN:
+		case J_MESSAGE_OBJECT_CLOSE:
+		case J_MESSAGE_OBJECT_SYNC:
+		case J_MESSAGE_OBJECT_EXTENTS:
+		case J_MESSAGE_OBJECT_PREFETCH:
+		default:
+			break;
+	}
+
+	return ret;
+}
+
+static
+gpointer
+jd_pipeline_execute (gpointer data)
+{
+	JdPipeline* pipeline = data;
+	gpointer item;
+	guint executed = 0;
+
+	while ((item = g_async_queue_pop(pipeline->ready)) != &jd_pipeline_end)
+	{
+		JMessage* message = item;
+		gboolean payload;
+
+		payload = jd_pipeline_has_payload(message);
+
+		if (!g_atomic_int_get(&(pipeline->stop)))
+		{
+			if (!jd_handle_message(message, pipeline->connection, pipeline->statistics, pipeline->received[executed % JD_PIPELINE_DEPTH]))
+			{
+				g_atomic_int_set(&(pipeline->stop), 1);
+			}
+		}
+
+		executed++;
+		g_async_queue_push(pipeline->free, message);
+
+		if (payload)
+		{
+			g_async_queue_push(pipeline->consumed, GINT_TO_POINTER(1));
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Handles all messages of a connection using a pipeline.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param connection A connection.
+ * \param statistics The connection's statistics.
+ **/
+void
+jd_pipeline_run (GSocketConnection* connection, JStatistics* statistics)
+{
+	JdPipeline pipeline;
+	GThread* executor;
+	JMessage* message;
+	guint received = 0;
+
+	g_return_if_fail(connection != NULL);
+	g_return_if_fail(statistics != NULL);
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	pipeline.connection = connection;
+	pipeline.statistics = statistics;
+	pipeline.free = g_async_queue_new_full((GDestroyNotify)j_message_unref);
+	pipeline.ready = g_async_queue_new();
+	pipeline.consumed = g_async_queue_new();
+	pipeline.stop = 0;
+
+	for (guint i = 0; i < JD_PIPELINE_DEPTH; i++)
+	{
+		g_async_queue_push(pipeline.free, j_message_new(J_MESSAGE_NONE, 0));
+	}
+
+	executor = g_thread_new("julea-server-pipeline", jd_pipeline_execute, &pipeline);
+
+	while (!g_atomic_int_get(&(pipeline.stop)))
+	{
+		gboolean payload;
+
+		message = g_async_queue_pop(pipeline.free);
+
+		if (!j_message_receive(message, connection))
+		{
+			g_async_queue_push(pipeline.free, message);
+			break;
+		}
+
+		payload = jd_pipeline_has_payload(message);
+
+		/* The slot is free since the executor has returned the message that used it before. */
+		pipeline.received[received % JD_PIPELINE_DEPTH] = g_get_monotonic_time();
+		received++;
+
+		g_async_queue_push(pipeline.ready, message);
+
+		if (payload)
+		{
+			/* Wait until the executor has read the payload from the connection. */
+			g_async_queue_pop(pipeline.consumed);
+		}
+	}
+
+	g_async_queue_push(pipeline.ready, &jd_pipeline_end);
+	g_thread_join(executor);
+
+	g_async_queue_unref(pipeline.consumed);
+	g_async_queue_unref(pipeline.ready);
+	g_async_queue_unref(pipeline.free);
+
+	j_trace_leave(G_STRFUNC);
+}
@@ -0,0 +1,532 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Scheduling of message execution.
+ *
+ * The scheduler limits the number of messages executed concurrently.
+ * Messages that have to wait for a free slot are divided into classes (metadata, small I/O and bulk I/O).
+ * Free slots are assigned to the classes according to their weights using stride scheduling,
+ * and to the clients of a class in a round-robin fashion, so a single client cannot starve the others.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <julea.h>
+
+#include "server.h"
+
+/**
+ * The maximum size of all operations of a small I/O message.
+ */
+#define JD_SCHEDULER_SMALL_SIZE (64 * 1024)
+
+/**
+ * The stride of a class with weight 1.
+ */
+#define JD_SCHEDULER_STRIDE (1 << 20)
+
+enum JdSchedulerClass
+{
+	JD_SCHEDULER_METADATA,
+	JD_SCHEDULER_SMALL,
+	JD_SCHEDULER_BULK,
+	JD_SCHEDULER_CLASSES
+};
+
+typedef enum JdSchedulerClass JdSchedulerClass;
+
+/**
+ * A message waiting for a slot.
+ */
+struct JdSchedulerWaiter
+{
+	GCond cond;
+
+	/**
+	 * Whether a slot has been assigned to the waiter.
+	 */
+	gboolean granted;
+};
+
+typedef struct JdSchedulerWaiter JdSchedulerWaiter;
+
+/**
+ * All waiting messages of one client within a class.
+ */
+struct JdSchedulerFlow
+{
+	/**
+	 * The client, identified by its address.
+	 */
+	gchar* client;
+
+	/**
+	 * The waiters.
+	 */
+	GQueue waiters;
+};
+
+typedef struct JdSchedulerFlow JdSchedulerFlow;
+
+struct JdScheduler
+{
+	struct
+	{
+		/**
+		 * The flows with waiting messages, in round-robin order.
+		 */
+		GQueue flows;
+
+		/**
+		 * Maps clients to their flows.
+		 */
+		GHashTable* clients;
+
+		/**
+		 * The class's stride and current pass.
+		 */
+		guint64 stride;
+		guint64 pass;
+	}
+	classes[JD_SCHEDULER_CLASSES];
+
+	/**
+	 * The pass of the most recently scheduled class.
+	 */
+	guint64 pass;
+
+	/**
+	 * The number of slots and the number of currently used ones.
+	 */
+	guint slots;
+	guint running;
+
+	/**
+	 * The number of waiting messages.
+	 */
+	guint waiting;
+
+	GMutex mutex;
+};
+
+static
+JdSchedulerClass
+jd_scheduler_classify (JMessage* message)
+{
+	JdSchedulerClass ret = JD_SCHEDULER_METADATA;
+
+	switch (j_message_get_type(message))
+	{
+		case J_MESSAGE_OBJECT_READ:
+		case J_MESSAGE_OBJECT_WRITE:
+			{
+				guint32 operation_count;
+				guint64 size = 0;
+
+				operation_count = j_message_get_count(message);
+
+				/* Namespace and path or handle */
+				if (j_message_get_flags(message) & J_MESSAGE_FLAGS_HANDLE)
+				{
+					j_message_get_8(message);
+				}
+				else
+				{
+					j_message_get_string(message);
+					j_message_get_string(message);
+				}
+
+				for (guint32 i = 0; i < operation_count; i++)
+				{
+					/* Length and offset */
+					size += j_message_get_varint(message);
+					j_message_get_varint(message);
+				}
+
+				j_message_rewind(message);
+
+				ret = (size <= JD_SCHEDULER_SMALL_SIZE) ? JD_SCHEDULER_SMALL : JD_SCHEDULER_BULK;
+			}
+			break;
+		case J_MESSAGE_OBJECT_APPEND:
+			{
+				guint32 operation_count;
+				guint64 size = 0;
+
+				operation_count = j_message_get_count(message);
+
+				/* Namespace, path and whether space is only reserved */
+				j_message_get_string(message);
+				j_message_get_string(message);
+				j_message_get_1(message);
+
+				for (guint32 i = 0; i < operation_count; i++)
+				{
+					size += j_message_get_varint(message);
+				}
+
+				j_message_rewind(message);
+
+				ret = (size <= JD_SCHEDULER_SMALL_SIZE) ? JD_SCHEDULER_SMALL : JD_SCHEDULER_BULK;
+			}
+			break;
+		case J_MESSAGE_OBJECT_REDUCE:
+			{
+				guint32 operation_count;
+				guint64 size = 0;
+
+				operation_count = j_message_get_count(message);
+
+				/* Namespace, path and the reduction's parameters */
+				j_message_get_string(message);
+				j_message_get_string(message);
+				j_message_get_n(message, j_reduce_get_parameters_size());
+
+				for (guint32 i = 0; i < operation_count; i++)
+				{
+					/* Length and offset */
+					size += j_message_get_varint(message);
+					j_message_get_varint(message);
+				}
+
+				j_message_rewind(message);
+
+				/* Reductions read as much data as reads, even though their replies are small. */
+				ret = (size <= JD_SCHEDULER_SMALL_SIZE) ? JD_SCHEDULER_SMALL : JD_SCHEDULER_BULK;
+			}
+			break;
+		case J_MESSAGE_OBJECT_COPY:
+		case J_MESSAGE_OBJECT_DEDUP:
+		case J_MESSAGE_OBJECT_PREFETCH:
+			/* Copies and promoting prefetches move whole objects, deduplicated writes copy whole blocks. */
+			ret = JD_SCHEDULER_BULK;
+			break;
+		case J_MESSAGE_OBJECT_PURGE:
+		case J_MESSAGE_KV_DELETE_BY_PREFIX:
+		case J_MESSAGE_OBJECT_LIST:
+			/* Purges, prefix deletions and listings touch arbitrarily many objects or values. */
+			ret = JD_SCHEDULER_BULK;
+			break;
+		case J_MESSAGE_NONE:
+		case J_MESSAGE_PING:
+		case J_MESSAGE_STATISTICS:
+		case J_MESSAGE_OBJECT_CREATE:
+		case J_MESSAGE_OBJECT_DELETE:
+		case J_MESSAGE_OBJECT_STATUS:
+		case J_MESSAGE_KV_PUT:
+		case J_MESSAGE_KV_DELETE:
+		case J_MESSAGE_KV_GET:
+		case J_MESSAGE_KV_GET_ALL:
+		case J_MESSAGE_KV_GET_BY_PREFIX:
+		case J_MESSAGE_OBJECT_CAPACITY:
+		case J_MESSAGE_OBJECT_TRUNCATE:
+		case J_MESSAGE_OBJECT_ALLOCATE:
+		case J_MESSAGE_OBJECT_PUNCH_HOLE:
+		case J_MESSAGE_OBJECT_SYNC:
+		case J_MESSAGE_OBJECT_EXTENTS:
+		case J_MESSAGE_KV_COMPARE_AND_SWAP:
+		case J_MESSAGE_KV_INCREMENT:
+		case J_MESSAGE_KV_CREATE_INDEX:
+		case J_MESSAGE_KV_GET_BY_INDEX:
+		case J_MESSAGE_KV_MAX_MERGE:
+		case J_MESSAGE_LOCK_ACQUIRE:
+		case J_MESSAGE_LOCK_RELEASE:
+		case J_MESSAGE_LOCK_REVOKE:
+		case J_MESSAGE_KV_WATCH:
+		case J_MESSAGE_KV_PUT_RAW:
+		case J_MESSAGE_KV_GET_RAW:
+		case J_MESSAGE_OBJECT_OPEN:
+		case J_MESSAGE_OBJECT_CLOSE:
+		case J_MESSAGE_ECHO:
+		case J_MESSAGE_COMPOUND:
+		default:
+			break;
+	}
+
+	return ret;
+}
+
+static
+gchar*
+jd_scheduler_client (GSocketConnection* connection)
+{
+	g_autoptr(GSocketAddress) address = NULL;
+	gchar* ret = NULL;
+
+	address = g_socket_connection_get_remote_address(connection, NULL);
+
+	if (address != NULL && G_IS_INET_SOCKET_ADDRESS(address))
+	{
+		ret = g_inet_address_to_string(g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(address)));
+	}
+
+	if (ret == NULL)
+	{
+		/* Fall back to treating each connection as its own client. */
+		ret = g_strdup_printf("%p", (gpointer)connection);
+	}
+
+	return ret;
+}
+
+static
+void
+jd_scheduler_flow_free (gpointer data)
+{
+	JdSchedulerFlow* flow = data;
+
+	g_free(flow->client);
+	g_slice_free(JdSchedulerFlow, flow);
+}
+
+/**
+ * Assigns free slots to waiting messages.
+ * The scheduler's mutex has to be held.
+ */
+static
+void
+jd_scheduler_dispatch (JdScheduler* scheduler)
+{
+	while (scheduler->running < scheduler->slots && scheduler->waiting > 0)
+	{
+		JdSchedulerFlow* flow;
+		JdSchedulerWaiter* waiter;
+		guint class = JD_SCHEDULER_CLASSES;
+
+		for (guint i = 0; i < JD_SCHEDULER_CLASSES; i++)
+		{
+			if (g_queue_is_empty(&(scheduler->classes[i].flows)))
+			{
+				continue;
+			}
+
+			if (class == JD_SCHEDULER_CLASSES || scheduler->classes[i].pass < scheduler->classes[class].pass)
+			{
+				class = i;
+			}
+		}
+
+		g_assert(class < JD_SCHEDULER_CLASSES);
+
+		scheduler->pass = scheduler->classes[class].pass;
+		scheduler->classes[class].pass += scheduler->classes[class].stride;
+
+		flow = g_queue_pop_head(&(scheduler->classes[class].flows));
+		waiter = g_queue_pop_head(&(flow->waiters));
+
+		if (g_queue_is_empty(&(flow->waiters)))
+		{
+			g_hash_table_remove(scheduler->classes[class].clients, flow->client);
+		}
+		else
+		{
+			g_queue_push_tail(&(scheduler->classes[class].flows), flow);
+		}
+
+		scheduler->waiting--;
+		scheduler->running++;
+
+		waiter->granted = TRUE;
+		g_cond_signal(&(waiter->cond));
+	}
+}
+
+/**
+ * Creates a new scheduler.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param slots           The maximum number of concurrently executed messages.
+ * \param weight_metadata The weight of metadata messages.
+ * \param weight_small    The weight of small I/O messages.
+ * \param weight_bulk     The weight of bulk I/O messages.
+ *
+ * \return A new scheduler. Should be freed with jd_scheduler_free().
+ **/
+JdScheduler*
+jd_scheduler_new (guint slots, guint weight_metadata, guint weight_small, guint weight_bulk)
+{
+	JdScheduler* scheduler;
+	guint weights[JD_SCHEDULER_CLASSES];
+
+	g_return_val_if_fail(slots > 0, NULL);
+
+	weights[JD_SCHEDULER_METADATA] = weight_metadata;
+	weights[JD_SCHEDULER_SMALL] = weight_small;
+	weights[JD_SCHEDULER_BULK] = weight_bulk;
+
+	scheduler = g_slice_new(JdScheduler);
+
+	for (guint i = 0; i < JD_SCHEDULER_CLASSES; i++)
+	{
+		g_queue_init(&(scheduler->classes[i].flows));
+		scheduler->classes[i].clients = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, jd_scheduler_flow_free);
+		scheduler->classes[i].stride = JD_SCHEDULER_STRIDE / MAX(weights[i], 1);
+		scheduler->classes[i].pass = 0;
+	}
+
+	scheduler->pass = 0;
+	scheduler->slots = slots;
+	scheduler->running = 0;
+	scheduler->waiting = 0;
+	g_mutex_init(&(scheduler->mutex));
+
+	return scheduler;
+}
+
+/**
+ * Frees the memory allocated for the scheduler.
+ * No messages must be waiting or executing.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scheduler A scheduler.
+ **/
+void
+jd_scheduler_free (JdScheduler* scheduler)
+{
+	g_return_if_fail(scheduler != NULL);
+
+	for (guint i = 0; i < JD_SCHEDULER_CLASSES; i++)
+	{
+		g_hash_table_destroy(scheduler->classes[i].clients);
+	}
+
+	g_mutex_clear(&(scheduler->mutex));
+
+	g_slice_free(JdScheduler, scheduler);
+}
+
+/**
+ * Waits until a message may be executed.
+ * Every call has to be followed by a call to jd_scheduler_release().
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scheduler  A scheduler.
+ * \param message    A message.
+ * \param connection The message's connection.
+ **/
+void
+jd_scheduler_acquire (JdScheduler* scheduler, JMessage* message, GSocketConnection* connection)
+{
+	JdSchedulerWaiter waiter;
+	JdSchedulerFlow* flow;
+	JdSchedulerClass class;
+	gchar* client;
+
+	g_return_if_fail(scheduler != NULL);
+	g_return_if_fail(message != NULL);
+	g_return_if_fail(connection != NULL);
+
+	g_mutex_lock(&(scheduler->mutex));
+
+	if (scheduler->running < scheduler->slots && scheduler->waiting == 0)
+	{
+		scheduler->running++;
+		g_mutex_unlock(&(scheduler->mutex));
+
+		return;
+	}
+
+	g_mutex_unlock(&(scheduler->mutex));
+
+	/* Classifying might be expensive, so only do it when we actually have to wait. */
+	class = jd_scheduler_classify(message);
+	client = jd_scheduler_client(connection);
+
+	g_cond_init(&(waiter.cond));
+	waiter.granted = FALSE;
+
+	g_mutex_lock(&(scheduler->mutex));
+
+	flow = g_hash_table_lookup(scheduler->classes[class].clients, client);
+
+	if (flow == NULL)
+	{
+		if (g_queue_is_empty(&(scheduler->classes[class].flows)))
+		{
+			/* An idle class must not be able to catch up on the time it has not used. */
+			scheduler->classes[class].pass = MAX(scheduler->classes[class].pass, scheduler->pass);
+		}
+
+		flow = g_slice_new(JdSchedulerFlow);
+		flow->client = client;
+		g_queue_init(&(flow->waiters));
+
+		g_hash_table_insert(scheduler->classes[class].clients, flow->client, flow);
+		g_queue_push_tail(&(scheduler->classes[class].flows), flow);
+	}
+	else
+	{
+		g_free(client);
+	}
+
+	g_queue_push_tail(&(flow->waiters), &waiter);
+	scheduler->waiting++;
+
+	/* A slot might have become free in the meantime. */
+	jd_scheduler_dispatch(scheduler);
+
+	while (!waiter.granted)
+	{
+		g_cond_wait(&(waiter.cond), &(scheduler->mutex));
+	}
+
+	g_mutex_unlock(&(scheduler->mutex));
+
+	g_cond_clear(&(waiter.cond));
+}
+
+/**
+ * Signals that a message has been executed.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scheduler A scheduler.
+ **/
+void
+jd_scheduler_release (JdScheduler* scheduler)
+{
+	g_return_if_fail(scheduler != NULL);
+
+	g_mutex_lock(&(scheduler->mutex));
+
+	scheduler->running--;
+	jd_scheduler_dispatch(scheduler);
+
+	g_mutex_unlock(&(scheduler->mutex));
+}
@@ -0,0 +1,939 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Background scrubbing of stored data.
+ *
+ * Writes to item objects record a CRC32C checksum per block together with the object's size.
+ * Other modifications remove the object's record.
+ * A thread walks all item documents in the key-value backend and checks that the corresponding objects exist in the object backend.
+ * It reads every object at a throttled rate and compares its checksums against the recorded ones, which detects data that has been corrupted at rest.
+ * Objects without a record, for example because they have been written before scrubbing was enabled, are recorded by the thread instead.
+ * The records are stored in the key-value namespace JD_SCRUB_NAMESPACE, using the objects' names as keys.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <bson.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * The key-value namespace of the checksum records.
+ */
+#define JD_SCRUB_NAMESPACE "julea-scrub"
+
+/**
+ * The namespaces of item documents and their objects.
+ */
+#define JD_SCRUB_ITEMS_NAMESPACE "items"
+#define JD_SCRUB_OBJECTS_NAMESPACE "item"
+
+/**
+ * The number of bytes covered by one checksum.
+ */
+#define JD_SCRUB_BLOCK_SIZE J_STRIPE_SIZE
+
+/**
+ * Objects modified less than this many microseconds ago are skipped.
+ * Modification times have a limited resolution, so a recent write might not be reflected in it yet.
+ */
+#define JD_SCRUB_SETTLE_TIME (G_USEC_PER_SEC * 60)
+
+/**
+ * The number of locks protecting the records.
+ * Writes and the scrubber take the lock of an object's record while updating or comparing it.
+ */
+#define JD_SCRUB_LOCKS 64
+
+/**
+ * The number of keys read at once.
+ * Keys are collected before checking them, so that no iterator is kept open while reading objects.
+ */
+#define JD_SCRUB_PAGE_SIZE 128
+
+struct JdScrub
+{
+	JBackend* object_backend;
+	JBackend* kv_backend;
+
+	/**
+	 * The rate in bytes per second.
+	 */
+	guint64 rate;
+
+	/**
+	 * The time between the starts of two passes in microseconds.
+	 */
+	gint64 interval;
+
+	/**
+	 * The start of the current pass and the number of bytes read since then, used for throttling.
+	 */
+	gint64 pass_start;
+	guint64 pass_bytes;
+
+	/**
+	 * The counters reported through the statistics message.
+	 */
+	guint64 passes;
+	guint64 objects;
+	guint64 bytes;
+	guint64 corrupted;
+	guint64 missing;
+
+	gboolean stop;
+
+	GThread* thread;
+	GMutex mutex[1];
+	GCond cond[1];
+
+	GMutex records[JD_SCRUB_LOCKS];
+};
+
+/**
+ * Returns the lock of an object's record.
+ */
+static
+GMutex*
+jd_scrub_lock (JdScrub* scrub, gchar const* name)
+{
+	return &(scrub->records[g_str_hash(name) % JD_SCRUB_LOCKS]);
+}
+
+/**
+ * Waits until the given monotonic time.
+ *
+ * \return FALSE if the scrubber has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_scrub_wait_until (JdScrub* scrub, gint64 end_time)
+{
+	gboolean ret;
+
+	g_mutex_lock(scrub->mutex);
+
+	while (!scrub->stop && g_cond_wait_until(scrub->cond, scrub->mutex, end_time))
+	{
+	}
+
+	ret = !scrub->stop;
+
+	g_mutex_unlock(scrub->mutex);
+
+	return ret;
+}
+
+/**
+ * Accounts for read data and sleeps as long as the pass is ahead of its rate.
+ */
+static
+gboolean
+jd_scrub_throttle (JdScrub* scrub, guint64 length)
+{
+	gint64 due;
+
+	scrub->pass_bytes += length;
+
+	g_mutex_lock(scrub->mutex);
+	scrub->bytes += length;
+	g_mutex_unlock(scrub->mutex);
+
+	due = scrub->pass_start + (gint64)(scrub->pass_bytes * G_USEC_PER_SEC / scrub->rate);
+
+	/* Also checks whether the scrubber has been stopped if no waiting is necessary. */
+	return jd_scrub_wait_until(scrub, due);
+}
+
+/**
+ * Reads an object completely and computes its checksums.
+ *
+ * \return FALSE if the object could not be read or the scrubber has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_scrub_read (JdScrub* scrub, gpointer object, guint64 size, gpointer buffer, GArray* checksums)
+{
+	for (guint64 offset = 0; offset < size; offset += JD_SCRUB_BLOCK_SIZE)
+	{
+		guint64 length;
+		guint64 bytes_read = 0;
+		guint32 checksum;
+
+		length = MIN(size - offset, JD_SCRUB_BLOCK_SIZE);
+
+		if (!j_backend_object_read(scrub->object_backend, object, buffer, length, offset, &bytes_read) || bytes_read != length)
+		{
+			return FALSE;
+		}
+
+		checksum = j_helper_crc32c(0, buffer, length);
+		g_array_append_val(checksums, checksum);
+
+		if (!jd_scrub_throttle(scrub, length))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Returns the recorded size and checksums.
+ */
+static
+gboolean
+jd_scrub_record_get (bson_t const* record, guint64* size, guint32 const** checksums, guint32* checksums_len)
+{
+	bson_iter_t iter;
+	bson_subtype_t subtype;
+	guint8 const* data;
+	guint32 data_len;
+
+	if (!bson_iter_init_find(&iter, record, "size") || !BSON_ITER_HOLDS_INT64(&iter))
+	{
+		return FALSE;
+	}
+
+	*size = bson_iter_int64(&iter);
+
+	if (!bson_iter_init_find(&iter, record, "checksums") || !BSON_ITER_HOLDS_BINARY(&iter))
+	{
+		return FALSE;
+	}
+
+	bson_iter_binary(&iter, &subtype, &data_len, &data);
+
+	*checksums = (guint32 const*)data;
+	*checksums_len = data_len / sizeof(guint32);
+
+	return TRUE;
+}
+
+static
+void
+jd_scrub_record_store (JdScrub* scrub, gchar const* key, guint64 size, GArray* checksums)
+{
+	bson_t record[1];
+	gpointer batch;
+
+	bson_init(record);
+	bson_append_int64(record, "size", -1, size);
+	bson_append_binary(record, "checksums", -1, BSON_SUBTYPE_BINARY, (guint8 const*)checksums->data, checksums->len * sizeof(guint32));
+
+	if (j_backend_kv_batch_start(scrub->kv_backend, JD_SCRUB_NAMESPACE, J_SEMANTICS_SAFETY_NETWORK, &batch))
+	{
+		j_backend_kv_put(scrub->kv_backend, batch, key, record);
+		j_backend_kv_batch_execute(scrub->kv_backend, batch);
+	}
+
+	bson_destroy(record);
+}
+
+static
+void
+jd_scrub_record_delete (JdScrub* scrub, gchar const* key)
+{
+	gpointer batch;
+
+	if (j_backend_kv_batch_start(scrub->kv_backend, JD_SCRUB_NAMESPACE, J_SEMANTICS_SAFETY_NETWORK, &batch))
+	{
+		j_backend_kv_delete(scrub->kv_backend, batch, key);
+		j_backend_kv_batch_execute(scrub->kv_backend, batch);
+	}
+}
+
+/**
+ * Returns the name of an item's object, which is stored in its document.
+ * Items created before objects were named independently use their key.
+ *
+ * \return The name, NULL if the item does not exist.
+ */
+static
+gchar*
+jd_scrub_object_name (JdScrub* scrub, gchar const* key)
+{
+	bson_t document[1];
+	bson_iter_t iter;
+	gchar* name;
+
+	if (!j_backend_kv_get(scrub->kv_backend, JD_SCRUB_ITEMS_NAMESPACE, key, document))
+	{
+		return NULL;
+	}
+
+	if (bson_iter_init_find(&iter, document, "object") && BSON_ITER_HOLDS_UTF8(&iter))
+	{
+		name = g_strdup(bson_iter_utf8(&iter, NULL));
+	}
+	else
+	{
+		name = g_strdup(key);
+	}
+
+	bson_destroy(document);
+
+	return name;
+}
+
+/**
+ * Opens the object of an item.
+ * Documents and objects are created and deleted in separate steps, so the document is checked again before the object is considered missing.
+ *
+ * \return TRUE and the object's name if the object exists, FALSE otherwise.
+ */
+static
+gboolean
+jd_scrub_open (JdScrub* scrub, gchar const* key, gchar** name, gpointer* object)
+{
+	if ((*name = jd_scrub_object_name(scrub, key)) == NULL)
+	{
+		return FALSE;
+	}
+
+	if (j_backend_object_open(scrub->object_backend, JD_SCRUB_OBJECTS_NAMESPACE, *name, object))
+	{
+		return TRUE;
+	}
+
+	g_clear_pointer(name, g_free);
+
+	if ((*name = jd_scrub_object_name(scrub, key)) == NULL)
+	{
+		return FALSE;
+	}
+
+	if (j_backend_object_open(scrub->object_backend, JD_SCRUB_OBJECTS_NAMESPACE, *name, object))
+	{
+		return TRUE;
+	}
+
+	g_clear_pointer(name, g_free);
+
+	g_warning("Scrubbing found item %s without an object.", key);
+
+	g_mutex_lock(scrub->mutex);
+	scrub->missing++;
+	g_mutex_unlock(scrub->mutex);
+
+	return FALSE;
+}
+
+static
+void
+jd_scrub_report_corrupted (JdScrub* scrub, guint count)
+{
+	g_mutex_lock(scrub->mutex);
+	scrub->corrupted += count;
+	g_mutex_unlock(scrub->mutex);
+}
+
+/**
+ * Compares an object's checksums against its record.
+ * Objects without a valid record are recorded.
+ * Has to be called with the record's lock held.
+ */
+static
+void
+jd_scrub_verify (JdScrub* scrub, gchar const* key, gchar const* name, guint64 size, GArray* checksums)
+{
+	bson_t record[1];
+	guint32 const* recorded;
+	guint32 recorded_len;
+	guint64 recorded_size;
+	guint corrupted = 0;
+
+	if (!j_backend_kv_get(scrub->kv_backend, JD_SCRUB_NAMESPACE, name, record))
+	{
+		jd_scrub_record_store(scrub, name, size, checksums);
+		return;
+	}
+
+	/* Writes keep the size up to date, so a different size means that a write could not update the record. */
+	if (!jd_scrub_record_get(record, &recorded_size, &recorded, &recorded_len) || recorded_size != size)
+	{
+		bson_destroy(record);
+		jd_scrub_record_store(scrub, name, size, checksums);
+		return;
+	}
+
+	for (guint i = 0; i < checksums->len; i++)
+	{
+		if (i >= recorded_len || g_array_index(checksums, guint32, i) != recorded[i])
+		{
+			g_warning("Scrubbing found a checksum mismatch in block %u of item %s.", i, key);
+			corrupted++;
+		}
+	}
+
+	/* The record is kept, so that corruption is reported again by later passes. */
+	bson_destroy(record);
+
+	if (corrupted > 0)
+	{
+		jd_scrub_report_corrupted(scrub, corrupted);
+	}
+}
+
+/**
+ * Checks one item's object.
+ *
+ * \return FALSE if the scrubber has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_scrub_object (JdScrub* scrub, gchar const* key, gpointer buffer)
+{
+	g_autoptr(GArray) checksums = NULL;
+	g_autofree gchar* name = NULL;
+	GMutex* lock;
+	gpointer object;
+	gint64 modification_time;
+	gint64 modification_time_after = 0;
+	guint64 size;
+	guint64 size_after = 0;
+	gboolean read;
+	gboolean unchanged;
+	gboolean ret;
+
+	if (!jd_scrub_open(scrub, key, &name, &object))
+	{
+		return TRUE;
+	}
+
+	if (!j_backend_object_status(scrub->object_backend, object, &modification_time, &size)
+	    || modification_time > g_get_real_time() - JD_SCRUB_SETTLE_TIME)
+	{
+		j_backend_object_close(scrub->object_backend, object);
+		return TRUE;
+	}
+
+	checksums = g_array_sized_new(FALSE, FALSE, sizeof(guint32), (size + JD_SCRUB_BLOCK_SIZE - 1) / JD_SCRUB_BLOCK_SIZE);
+	read = jd_scrub_read(scrub, object, size, buffer, checksums);
+
+	g_mutex_lock(scrub->mutex);
+	ret = !scrub->stop;
+	g_mutex_unlock(scrub->mutex);
+
+	if (!ret)
+	{
+		j_backend_object_close(scrub->object_backend, object);
+		return ret;
+	}
+
+	/* Writes update the record while holding its lock, so a write that has not updated it yet is detected by the status. */
+	lock = jd_scrub_lock(scrub, name);
+	g_mutex_lock(lock);
+
+	/* Objects modified while being read cannot be checked. */
+	unchanged = j_backend_object_status(scrub->object_backend, object, &modification_time_after, &size_after)
+		&& modification_time_after == modification_time && size_after == size;
+
+	if (unchanged && !read)
+	{
+		g_warning("Scrubbing could not read item %s.", key);
+		jd_scrub_report_corrupted(scrub, 1);
+	}
+	else if (unchanged && modification_time > 0)
+	{
+		jd_scrub_verify(scrub, key, name, size, checksums);
+	}
+
+	/* Without modification times, modified objects cannot be told apart from corrupted ones, so they are only read. */
+
+	g_mutex_unlock(lock);
+
+	j_backend_object_close(scrub->object_backend, object);
+
+	if (unchanged)
+	{
+		g_mutex_lock(scrub->mutex);
+		scrub->objects++;
+		g_mutex_unlock(scrub->mutex);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Reads the next page of keys of a namespace.
+ */
+static
+GPtrArray*
+jd_scrub_next_keys (JdScrub* scrub, gchar const* namespace, gchar const* prefix, gchar const* start_after)
+{
+	GPtrArray* keys;
+	gpointer iterator;
+	gchar const* key;
+	bson_t value[1];
+
+	keys = g_ptr_array_new_with_free_func(g_free);
+
+	if (!j_backend_kv_get_range(scrub->kv_backend, namespace, prefix, start_after, JD_SCRUB_PAGE_SIZE, &iterator))
+	{
+		return keys;
+	}
+
+	while (j_backend_kv_iterate(scrub->kv_backend, iterator, &key, value))
+	{
+		g_ptr_array_add(keys, g_strdup(key));
+		bson_destroy(value);
+	}
+
+	return keys;
+}
+
+/**
+ * Scrubs all items once.
+ * Also removes the records of deleted objects.
+ *
+ * \return FALSE if the scrubber has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_scrub_pass (JdScrub* scrub, gpointer buffer)
+{
+	g_autofree gchar* start_after = NULL;
+	gboolean ret = TRUE;
+	guint len;
+
+	scrub->pass_start = g_get_monotonic_time();
+	scrub->pass_bytes = 0;
+
+	do
+	{
+		g_autoptr(GPtrArray) keys = NULL;
+
+		keys = jd_scrub_next_keys(scrub, JD_SCRUB_ITEMS_NAMESPACE, "", start_after);
+		len = keys->len;
+
+		for (guint i = 0; ret && i < keys->len; i++)
+		{
+			gchar const* key = g_ptr_array_index(keys, i);
+
+			/* Secondary index entries are stored in the same namespace. */
+			if (!jd_kv_index_is_internal(key))
+			{
+				ret = jd_scrub_object(scrub, key, buffer);
+			}
+		}
+
+		if (len > 0)
+		{
+			g_free(start_after);
+			start_after = g_strdup(g_ptr_array_index(keys, len - 1));
+		}
+	}
+	while (ret && len == JD_SCRUB_PAGE_SIZE);
+
+	g_clear_pointer(&start_after, g_free);
+
+	do
+	{
+		g_autoptr(GPtrArray) keys = NULL;
+
+		keys = jd_scrub_next_keys(scrub, JD_SCRUB_NAMESPACE, "", start_after);
+		len = keys->len;
+
+		for (guint i = 0; ret && i < keys->len; i++)
+		{
+			gchar const* name = g_ptr_array_index(keys, i);
+			GMutex* lock;
+			gpointer object;
+
+			lock = jd_scrub_lock(scrub, name);
+			g_mutex_lock(lock);
+
+			/* The object might be created concurrently, so it is checked while holding the lock. */
+			if (j_backend_object_open(scrub->object_backend, JD_SCRUB_OBJECTS_NAMESPACE, name, &object))
+			{
+				j_backend_object_close(scrub->object_backend, object);
+			}
+			else
+			{
+				jd_scrub_record_delete(scrub, name);
+			}
+
+			g_mutex_unlock(lock);
+		}
+
+		if (len > 0)
+		{
+			g_free(start_after);
+			start_after = g_strdup(g_ptr_array_index(keys, len - 1));
+		}
+	}
+	while (ret && len == JD_SCRUB_PAGE_SIZE);
+
+	return ret;
+}
+
+static
+gpointer
+jd_scrub_thread (gpointer data)
+{
+	JdScrub* scrub = data;
+	g_autofree gpointer buffer = NULL;
+	gint64 next_pass;
+
+	buffer = g_malloc(JD_SCRUB_BLOCK_SIZE);
+	next_pass = g_get_monotonic_time();
+
+	while (jd_scrub_wait_until(scrub, next_pass))
+	{
+		next_pass = g_get_monotonic_time() + scrub->interval;
+
+		if (!jd_scrub_pass(scrub, buffer))
+		{
+			break;
+		}
+
+		g_mutex_lock(scrub->mutex);
+		scrub->passes++;
+		g_mutex_unlock(scrub->mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * Creates a new scrubber and starts its thread.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object_backend The object backend.
+ * \param kv_backend     The key-value backend.
+ * \param rate           The rate in bytes per second.
+ * \param interval       The time between the starts of two passes in seconds.
+ *
+ * \return A new scrubber. Should be freed with jd_scrub_free().
+ **/
+JdScrub*
+jd_scrub_new (JBackend* object_backend, JBackend* kv_backend, guint64 rate, guint64 interval)
+{
+	JdScrub* scrub;
+
+	g_return_val_if_fail(object_backend != NULL, NULL);
+	g_return_val_if_fail(kv_backend != NULL, NULL);
+	g_return_val_if_fail(rate > 0, NULL);
+
+	scrub = g_slice_new0(JdScrub);
+	scrub->object_backend = object_backend;
+	scrub->kv_backend = kv_backend;
+	scrub->rate = rate;
+	scrub->interval = interval * G_USEC_PER_SEC;
+	scrub->stop = FALSE;
+
+	g_mutex_init(scrub->mutex);
+	g_cond_init(scrub->cond);
+
+	for (guint i = 0; i < JD_SCRUB_LOCKS; i++)
+	{
+		g_mutex_init(&(scrub->records[i]));
+	}
+
+	scrub->thread = g_thread_new("julea-server-scrub", jd_scrub_thread, scrub);
+
+	return scrub;
+}
+
+/**
+ * Stops the scrubber and frees it.
+ * The current object is abandoned, so stopping does not have to wait for a pass to finish.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scrub A scrubber.
+ **/
+void
+jd_scrub_free (JdScrub* scrub)
+{
+	g_return_if_fail(scrub != NULL);
+
+	g_mutex_lock(scrub->mutex);
+	scrub->stop = TRUE;
+	g_cond_signal(scrub->cond);
+	g_mutex_unlock(scrub->mutex);
+
+	g_thread_join(scrub->thread);
+
+	for (guint i = 0; i < JD_SCRUB_LOCKS; i++)
+	{
+		g_mutex_clear(&(scrub->records[i]));
+	}
+
+	g_cond_clear(scrub->cond);
+	g_mutex_clear(scrub->mutex);
+
+	g_slice_free(JdScrub, scrub);
+}
+
+/**
+ * Updates the record of an object after it has been written.
+ * The checksums of the written blocks and of the blocks beyond the recorded size are computed again.
+ * The blocks are read back from the object backend, so that partially written blocks are covered completely.
+ * Objects without a record only get one if the writes cover all of their blocks, the others are recorded by the scrubber.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scrub     A scrubber, NULL if scrubbing is disabled.
+ * \param namespace The object's namespace.
+ * \param name      The object's name.
+ * \param object    The object.
+ * \param buffer    A buffer of J_STRIPE_SIZE bytes.
+ * \param lengths   The writes' lengths.
+ * \param offsets   The writes' offsets.
+ * \param count     The number of writes.
+ **/
+void
+jd_scrub_update (JdScrub* scrub, gchar const* namespace, gchar const* name, gpointer object, gpointer buffer, guint64 const* lengths, guint64 const* offsets, guint count)
+{
+	g_autoptr(GArray) checksums = NULL;
+	g_autofree gboolean* written = NULL;
+	GMutex* lock;
+	bson_t record[1];
+	gint64 modification_time;
+	guint64 size;
+	guint64 recorded_size = 0;
+	guint64 block_count;
+	guint64 first_grown;
+	gboolean complete = TRUE;
+
+	if (scrub == NULL || object == NULL || g_strcmp0(namespace, JD_SCRUB_OBJECTS_NAMESPACE) != 0)
+	{
+		return;
+	}
+
+	lock = jd_scrub_lock(scrub, name);
+	g_mutex_lock(lock);
+
+	if (!j_backend_object_status(scrub->object_backend, object, &modification_time, &size))
+	{
+		jd_scrub_record_delete(scrub, name);
+		goto end;
+	}
+
+	block_count = (size + JD_SCRUB_BLOCK_SIZE - 1) / JD_SCRUB_BLOCK_SIZE;
+	written = g_new0(gboolean, block_count);
+
+	for (guint i = 0; i < count; i++)
+	{
+		if (lengths[i] == 0)
+		{
+			continue;
+		}
+
+		for (guint64 block = offsets[i] / JD_SCRUB_BLOCK_SIZE; block < block_count && block * JD_SCRUB_BLOCK_SIZE < offsets[i] + lengths[i]; block++)
+		{
+			written[block] = TRUE;
+		}
+	}
+
+	checksums = g_array_sized_new(FALSE, TRUE, sizeof(guint32), block_count);
+
+	if (j_backend_kv_get(scrub->kv_backend, JD_SCRUB_NAMESPACE, name, record))
+	{
+		guint32 const* recorded;
+		guint32 recorded_len;
+
+		if (jd_scrub_record_get(record, &recorded_size, &recorded, &recorded_len))
+		{
+			g_array_append_vals(checksums, recorded, MIN(recorded_len, block_count));
+		}
+
+		bson_destroy(record);
+	}
+	else
+	{
+		for (guint64 block = 0; block < block_count; block++)
+		{
+			complete = complete && written[block];
+		}
+	}
+
+	if (!complete)
+	{
+		goto end;
+	}
+
+	/* The last recorded block might have grown, too. */
+	first_grown = (size != recorded_size) ? MIN(size, recorded_size) / JD_SCRUB_BLOCK_SIZE : block_count;
+	g_array_set_size(checksums, block_count);
+
+	for (guint64 block = 0; block < block_count; block++)
+	{
+		guint64 length;
+		guint64 bytes_read = 0;
+
+		if (!written[block] && block < first_grown)
+		{
+			continue;
+		}
+
+		length = MIN(size - (block * JD_SCRUB_BLOCK_SIZE), JD_SCRUB_BLOCK_SIZE);
+
+		/* An outdated record would be reported as corruption. */
+		if (!j_backend_object_read(scrub->object_backend, object, buffer, length, block * JD_SCRUB_BLOCK_SIZE, &bytes_read) || bytes_read != length)
+		{
+			jd_scrub_record_delete(scrub, name);
+			goto end;
+		}
+
+		g_array_index(checksums, guint32, block) = j_helper_crc32c(0, buffer, length);
+	}
+
+	jd_scrub_record_store(scrub, name, size, checksums);
+
+end:
+	g_mutex_unlock(lock);
+}
+
+/**
+ * Removes the record of an object whose data has been modified other than by writes.
+ * The scrubber records the object again once it has settled.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scrub     A scrubber, NULL if scrubbing is disabled.
+ * \param namespace The object's namespace.
+ * \param name      The object's name.
+ **/
+void
+jd_scrub_invalidate (JdScrub* scrub, gchar const* namespace, gchar const* name)
+{
+	GMutex* lock;
+
+	if (scrub == NULL || g_strcmp0(namespace, JD_SCRUB_OBJECTS_NAMESPACE) != 0)
+	{
+		return;
+	}
+
+	lock = jd_scrub_lock(scrub, name);
+
+	g_mutex_lock(lock);
+	jd_scrub_record_delete(scrub, name);
+	g_mutex_unlock(lock);
+}
+
+/**
+ * Removes the records of all objects below a purged directory.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scrub     A scrubber, NULL if scrubbing is disabled.
+ * \param namespace The objects' namespace.
+ * \param directory The directory.
+ **/
+void
+jd_scrub_invalidate_directory (JdScrub* scrub, gchar const* namespace, gchar const* directory)
+{
+	g_autofree gchar* prefix = NULL;
+	g_autofree gchar* start_after = NULL;
+	guint len;
+
+	if (scrub == NULL || g_strcmp0(namespace, JD_SCRUB_OBJECTS_NAMESPACE) != 0)
+	{
+		return;
+	}
+
+	prefix = g_strconcat(directory, "/", NULL);
+
+	do
+	{
+		g_autoptr(GPtrArray) keys = NULL;
+
+		keys = jd_scrub_next_keys(scrub, JD_SCRUB_NAMESPACE, prefix, start_after);
+		len = keys->len;
+
+		for (guint i = 0; i < keys->len; i++)
+		{
+			jd_scrub_invalidate(scrub, namespace, g_ptr_array_index(keys, i));
+		}
+
+		if (len > 0)
+		{
+			g_free(start_after);
+			start_after = g_strdup(g_ptr_array_index(keys, len - 1));
+		}
+	}
+	while (len == JD_SCRUB_PAGE_SIZE);
+}
+
+/**
+ * Appends the scrubber's progress to a statistics reply.
+ * The completed passes, checked objects, read bytes, corrupted blocks and missing objects are appended as one operation.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param scrub   A scrubber, NULL if scrubbing is disabled.
+ * \param message A message.
+ **/
+void
+jd_scrub_append (JdScrub* scrub, JMessage* message)
+{
+	guint64 values[5] = { 0, 0, 0, 0, 0 };
+
+	g_return_if_fail(message != NULL);
+
+	if (scrub != NULL)
+	{
+		g_mutex_lock(scrub->mutex);
+		values[0] = scrub->passes;
+		values[1] = scrub->objects;
+		values[2] = scrub->bytes;
+		values[3] = scrub->corrupted;
+		values[4] = scrub->missing;
+		g_mutex_unlock(scrub->mutex);
+	}
+
+	j_message_add_operation(message, G_N_ELEMENTS(values) * sizeof(guint64));
+
+	for (guint i = 0; i < G_N_ELEMENTS(values); i++)
+	{
+		j_message_append_8(message, &values[i]);
+	}
+}
@@ -23,22 +23,111 @@
 #include <glib-unix.h>
 #include <glib-object.h>
 #include <gio/gio.h>
+#include <gio/gunixconnection.h>
+#include <gio/gunixsocketaddress.h>
 #include <gmodule.h>
 
 #include <string.h>
 
 #include <julea.h>
 #include <julea-internal.h>
+#include <jprobe-internal.h>
 
+#include "server.h"
+
+/**
+ * The statistics of all closed connections.
+ */
 static JStatistics* jd_statistics;
 
+/**
+ * The statistics of all open connections.
+ * Each one is only modified by the thread currently handling its connection, so no locking is necessary on the hot path.
+ */
+static GHashTable* jd_statistics_live;
+
+/* Protects jd_statistics and jd_statistics_live. */
 G_LOCK_DEFINE_STATIC(jd_statistics);
 
+static void jd_statistics_collect (JStatistics*);
+static guint64 jd_statistics_count_connections (void);
+static void jd_capacity_get (guint64*, guint64*, guint64*);
+
 static JBackend* jd_object_backend;
 static JBackend* jd_kv_backend;
 
+/**
+ * The object backend's path, used to report the available capacity.
+ */
+static gchar const* jd_object_path = NULL;
+
+/**
+ * The number of bytes read and written and the time of the last capacity report.
+ * Used to report the throughput since then.
+ */
+static guint64 jd_capacity_bytes = 0;
+static gint64 jd_capacity_time = 0;
+
+G_LOCK_DEFINE_STATIC(jd_capacity);
+
+/**
+ * The maximum number of unused object handles kept open.
+ */
+#define JD_HANDLE_CACHE_SIZE 1024
+
+/**
+ * The size after which a KV_GET_ALL or KV_GET_BY_PREFIX reply is sent and a new one is started.
+ */
+#define JD_KV_REPLY_SIZE (256 * 1024)
+
+/**
+ * The maximum time a LOCK_ACQUIRE waits for conflicting locks and a LOCK_REVOKE for revocations before replying.
+ * Clients retry afterwards, so a waiting client does not occupy a server thread indefinitely.
+ */
+#define JD_LOCK_WAIT (G_USEC_PER_SEC)
+
+static JdHandleCache* jd_handle_cache;
+static JdObjectHandles* jd_object_handles;
+static JdGroupCommit* jd_group_commit;
+static JdKVIndex* jd_kv_index;
+static JdKVCache* jd_kv_cache;
+static JdKVFilter* jd_kv_filter;
+static JdKVWatch* jd_kv_watch;
+static JdKVReplication* jd_kv_replication;
+static JdKVCommit* jd_kv_commit;
+static JdScheduler* jd_scheduler;
+static JdScrub* jd_scrub;
+static JdTrash* jd_trash;
+static JLockManager* jd_lock_manager;
+
+/**
+ * The memory chunks used for reading and writing objects.
+ */
+static JdMemoryPool* jd_memory_pool;
+
+static gboolean jd_pipeline = FALSE;
+
+static JdJournal* jd_journal = NULL;
+static JdDedup* jd_dedup = NULL;
+static JdAppend* jd_append = NULL;
+
+/**
+ * Whether object payloads can be transferred using RDMA.
+ */
+static gboolean jd_rdma = FALSE;
+
+static guint64 jd_write_buffer_size = 0;
+static guint64 jd_write_buffer_time = 0;
+
 static guint jd_thread_num = 0;
 
+/**
+ * The configuration, used to connect to other servers.
+ * The connection pool is only initialized once another server has to be contacted.
+ */
+static JConfiguration* jd_configuration = NULL;
+static gsize jd_connection_pool_initialized = 0;
+
 static
 gboolean
 jd_signal (gpointer data)
@@ -61,17 +150,18 @@ jd_safety_message_to_semantics (JMessageFlags flags)
 
 	safety = J_SEMANTICS_SAFETY_NONE;
 
-	switch (flags)
+	/* Only the safety flags are relevant, the others describe the encoding. */
+	switch (flags & (J_MESSAGE_FLAGS_SAFETY_NETWORK | J_MESSAGE_FLAGS_SAFETY_STORAGE))
 	{
 		case J_MESSAGE_FLAGS_NONE:
 			break;
 		case J_MESSAGE_FLAGS_SAFETY_STORAGE:
+		case J_MESSAGE_FLAGS_SAFETY_NETWORK | J_MESSAGE_FLAGS_SAFETY_STORAGE:
 			safety = J_SEMANTICS_SAFETY_STORAGE;
 			break;
 		case J_MESSAGE_FLAGS_SAFETY_NETWORK:
 			safety = J_SEMANTICS_SAFETY_NETWORK;
 			break;
-		case J_MESSAGE_FLAGS_REPLY:
 		default:
 			g_warn_if_reached();
 			break;
@@ -82,565 +172,3823 @@ jd_safety_message_to_semantics (JMessageFlags flags)
 
 static
 gboolean
-jd_on_run (GThreadedSocketService* service, GSocketConnection* connection, GObject* source_object, gpointer user_data)
+jd_object_write (gpointer handle, gpointer object, gconstpointer data, guint64 length, guint64 offset, gboolean coalesce, guint64* bytes_written)
 {
-	JMemoryChunk* memory_chunk;
-	g_autoptr(JMessage) message = NULL;
-	JStatistics* statistics;
-	GInputStream* input;
-
-	(void)service;
-	(void)source_object;
-	(void)user_data;
+	gboolean ret;
 
-	j_trace_enter(G_STRFUNC, NULL);
+	if (coalesce)
+	{
+		ret = jd_handle_cache_write(jd_handle_cache, handle, data, length, offset, bytes_written);
+	}
+	else
+	{
+		ret = j_backend_object_write(jd_object_backend, object, data, length, offset, bytes_written);
+	}
 
-	j_helper_set_nodelay(connection, TRUE);
+	return ret;
+}
 
-	statistics = j_statistics_new(TRUE);
-	memory_chunk = j_memory_chunk_new(J_STRIPE_SIZE);
+static
+gboolean
+jd_on_write_buffer_timeout (gpointer data)
+{
+	(void)data;
 
-	message = j_message_new(J_MESSAGE_NONE, 0);
-	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+	jd_handle_cache_flush_expired(jd_handle_cache, jd_write_buffer_time);
 
-	while (j_message_receive(message, connection))
+	if (jd_journal != NULL)
 	{
-		gchar const* key;
-		gchar const* namespace;
-		gchar const* path;
-		guint32 operation_count;
-		JMessageFlags type_modifier;
-		JSemanticsSafety safety;
-		guint i;
+		jd_journal_checkpoint(jd_journal, jd_handle_cache);
+	}
 
-		operation_count = j_message_get_count(message);
-		type_modifier = j_message_get_flags(message);
-		safety = jd_safety_message_to_semantics(type_modifier);
+	return G_SOURCE_CONTINUE;
+}
 
-		switch (j_message_get_type(message))
-		{
-			case J_MESSAGE_NONE:
-				break;
-			case J_MESSAGE_OBJECT_CREATE:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					gpointer object;
+/**
+ * Returns the handle cache's handle for a message's object, like jd_handle_cache_open() and jd_handle_cache_create().
+ * The object is either given by namespace and path or, if it has been opened explicitly, by handle.
+ * Handles only refer to existing objects, so they are never created.
+ */
+static
+gpointer
+jd_object_get (JMessage* message, gboolean create, gchar const** namespace, gchar const** path, gpointer* object)
+{
+	if (j_message_get_flags(message) & J_MESSAGE_FLAGS_HANDLE)
+	{
+		gpointer handle;
+		guint64 id;
 
-					if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-					{
-						reply = j_message_new_reply(message);
-					}
+		id = j_message_get_8(message);
 
-					namespace = j_message_get_string(message);
+		if ((handle = jd_object_handles_get(jd_object_handles, id, object)) != NULL)
+		{
+			jd_handle_cache_get_name(handle, namespace, path);
+		}
+		else
+		{
+			/* Unknown handles behave like objects that do not exist. */
+			*namespace = "";
+			*path = "";
+		}
 
-					for (i = 0; i < operation_count; i++)
-					{
-						path = j_message_get_string(message);
+		return handle;
+	}
 
-						if (j_backend_object_create(jd_object_backend, namespace, path, &object))
-						{
-							j_statistics_add(statistics, J_STATISTICS_FILES_CREATED, 1);
+	*namespace = j_message_get_string(message);
+	*path = j_message_get_string(message);
 
-							if (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE)
-							{
-								j_backend_object_sync(jd_object_backend, object);
-								j_statistics_add(statistics, J_STATISTICS_SYNC, 1);
-							}
+	if (create)
+	{
+		return jd_handle_cache_create(jd_handle_cache, *namespace, *path, object);
+	}
 
-							j_backend_object_close(jd_object_backend, object);
-						}
+	return jd_handle_cache_open(jd_handle_cache, *namespace, *path, object);
+}
 
-						if (reply != NULL)
-						{
-							j_message_add_operation(reply, 0);
-						}
-					}
+/**
+ * Passes the client's access hint for the range [start, end) on to the backend.
+ */
+static
+void
+jd_object_hint (JMessage* message, gpointer object, guint64 start, guint64 end)
+{
+	guint32 flags;
+	gint access;
 
-					if (reply != NULL)
-					{
-						j_message_send(reply, connection);
-					}
-				}
-				break;
-			case J_MESSAGE_OBJECT_DELETE:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					gpointer object;
+	if (object == NULL || jd_object_backend->object.hint == NULL || end <= start)
+	{
+		return;
+	}
 
-					if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-					{
-						reply = j_message_new_reply(message);
-					}
+	flags = j_message_get_flags(message);
 
-					namespace = j_message_get_string(message);
+	if (flags & J_MESSAGE_FLAGS_ACCESS_SEQUENTIAL)
+	{
+		access = J_SEMANTICS_ACCESS_SEQUENTIAL;
+	}
+	else if (flags & J_MESSAGE_FLAGS_ACCESS_RANDOM)
+	{
+		access = J_SEMANTICS_ACCESS_RANDOM;
+	}
+	else
+	{
+		return;
+	}
 
-					for (i = 0; i < operation_count; i++)
-					{
-						path = j_message_get_string(message);
+	j_backend_object_hint(jd_object_backend, object, access, end - start, start);
+}
 
-						if (j_backend_object_open(jd_object_backend, namespace, path, &object)
-						    && j_backend_object_delete(jd_object_backend, object))
-						{
-							j_statistics_add(statistics, J_STATISTICS_FILES_DELETED, 1);
-						}
+/**
+ * Handles a read message by letting the backend copy the data directly into the socket.
+ * The sizes of all reads are determined up front, so the reply header can be sent before the data.
+ */
+static
+void
+jd_object_read_to_fd (JMessage* message, GSocketConnection* connection, gpointer object, guint32 operation_count, JStatistics* statistics)
+{
+	g_autoptr(JMessage) reply = NULL;
+	g_autofree guint64* operations = NULL;
+	GOutputStream* output;
+	gint64 modification_time;
+	guint64 size = 0;
+	guint64 start = G_MAXUINT64;
+	guint64 end = 0;
+	gint fd;
 
-						if (reply != NULL)
-						{
-							j_message_add_operation(reply, 0);
-						}
-					}
+	j_trace_enter(G_STRFUNC, NULL);
 
-					if (reply != NULL)
-					{
-						j_message_send(reply, connection);
-					}
-				}
-				break;
-			case J_MESSAGE_OBJECT_READ:
-				{
-					JMessage* reply;
-					gpointer object;
+	output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+	fd = g_socket_get_fd(g_socket_connection_get_socket(connection));
 
-					namespace = j_message_get_string(message);
-					path = j_message_get_string(message);
+	if (object != NULL)
+	{
+		j_backend_object_status(jd_object_backend, object, &modification_time, &size);
+	}
 
-					reply = j_message_new_reply(message);
+	reply = j_message_new_reply(message);
+	operations = g_new(guint64, 2 * operation_count);
 
-					// FIXME return value
-					j_backend_object_open(jd_object_backend, namespace, path, &object);
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 length;
+		guint64 offset;
+		guint64 bytes_read = 0;
 
-					for (i = 0; i < operation_count; i++)
-					{
-						gchar* buf;
-						guint64 length;
-						guint64 offset;
-						guint64 bytes_read = 0;
+		length = j_message_get_varint(message);
+		offset = j_message_get_varint(message);
 
-						length = j_message_get_8(message);
-						offset = j_message_get_8(message);
+		if (offset < size)
+		{
+			bytes_read = MIN(length, size - offset);
+		}
 
-						buf = j_memory_chunk_get(memory_chunk, length);
+		operations[2 * i] = bytes_read;
+		operations[2 * i + 1] = offset;
 
-						if (buf == NULL)
-						{
-							// FIXME ugly
-							j_message_send(reply, connection);
-							j_message_unref(reply);
+		start = MIN(start, offset);
+		end = MAX(end, offset + bytes_read);
 
-							reply = j_message_new_reply(message);
+		j_message_add_operation(reply, sizeof(guint64));
+		j_message_append_varint(reply, bytes_read);
+	}
 
-							j_memory_chunk_reset(memory_chunk);
-							buf = j_memory_chunk_get(memory_chunk, length);
-						}
+	jd_object_hint(message, object, start, end);
 
-						j_backend_object_read(jd_object_backend, object, buf, length, offset, &bytes_read);
-						j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+	j_helper_set_cork(connection, TRUE);
 
-						j_message_add_operation(reply, sizeof(guint64));
-						j_message_append_8(reply, &bytes_read);
+	j_message_write(reply, output);
 
-						if (bytes_read > 0)
-						{
-							j_message_add_send(reply, buf, bytes_read);
-						}
+	for (guint i = 0; i < operation_count; i++)
+	{
+		guint64 length = operations[2 * i];
+		guint64 offset = operations[2 * i + 1];
+		guint64 bytes_read = 0;
 
-						j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_read);
-					}
+		if (length == 0)
+		{
+			continue;
+		}
 
-					j_backend_object_close(jd_object_backend, object);
+		j_backend_object_read_to_fd(jd_object_backend, object, fd, length, offset, &bytes_read);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
 
-					j_message_send(reply, connection);
-					j_message_unref(reply);
+		/* The object has been truncated in the meantime, pad the reply to keep the stream consistent. */
+		while (bytes_read < length)
+		{
+			gchar zero[4096] = { 0 };
+			gsize bytes_written;
 
-					j_memory_chunk_reset(memory_chunk);
-				}
+			if (!g_output_stream_write_all(output, zero, MIN(sizeof(zero), length - bytes_read), &bytes_written, NULL, NULL))
+			{
 				break;
-			case J_MESSAGE_OBJECT_WRITE:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					gchar* buf;
-					gpointer object;
-					guint64 merge_length = 0;
-					guint64 merge_offset = 0;
+			}
 
-					if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-					{
-						reply = j_message_new_reply(message);
-					}
+			bytes_read += bytes_written;
+		}
 
-					namespace = j_message_get_string(message);
-					path = j_message_get_string(message);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, length);
+	}
 
-					/* Guaranteed to work, because memory_chunk is not shared. */
-					buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
-					g_assert(buf != NULL);
+	j_helper_set_cork(connection, FALSE);
 
-					// FIXME return value
-					j_backend_object_open(jd_object_backend, namespace, path, &object);
+	j_trace_leave(G_STRFUNC);
+}
 
-					for (i = 0; i < operation_count; i++)
-					{
-						guint64 length;
-						guint64 offset;
+/**
+ * Sends a reply and accounts for the time spent doing so.
+ */
+static
+gboolean
+jd_message_send (JMessage* reply, GSocketConnection* connection, gint64* send_time)
+{
+	gboolean ret;
+	gint64 start;
 
-						length = j_message_get_8(message);
-						offset = j_message_get_8(message);
+	start = g_get_monotonic_time();
+	ret = j_message_send(reply, connection);
+	*send_time += g_get_monotonic_time() - start;
 
-						/* Check whether we can merge two consecutive operations. */
-						if (merge_length > 0 && merge_offset + merge_length == offset && merge_length + length <= J_STRIPE_SIZE)
-						{
-							merge_length += length;
-						}
-						else if (merge_length > 0)
-						{
-							guint64 bytes_written = 0;
+	return ret;
+}
 
-							g_input_stream_read_all(input, buf, merge_length, NULL, NULL, NULL);
-							j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, merge_length);
+/**
+ * Receives a message's payload from the connection.
+ * Fails if the connection is closed before all of it has arrived, in which case the connection should be dropped, because its stream cannot be resynchronized.
+ */
+static
+gboolean
+jd_message_receive_payload (GInputStream* input, gpointer data, guint64 length, JStatistics* statistics)
+{
+	gsize bytes_read = 0;
 
-							j_backend_object_write(jd_object_backend, object, buf, merge_length, merge_offset, &bytes_written);
-							j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+	if (!g_input_stream_read_all(input, data, length, &bytes_read, NULL, NULL) || bytes_read != length)
+	{
+		return FALSE;
+	}
 
-							merge_length = 0;
-							merge_offset = 0;
-						}
+	j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, length);
 
-						if (merge_length == 0)
-						{
-							merge_length = length;
-							merge_offset = offset;
-						}
+	return TRUE;
+}
 
-						if (reply != NULL)
-						{
-							// FIXME the reply is faked (length should be bytes_written)
-							j_message_add_operation(reply, sizeof(guint64));
-							j_message_append_8(reply, &length);
-						}
-					}
+/**
+ * Handles a single read that is too large for a memory chunk.
+ * Its reply is sent first and the data is streamed afterwards in pieces of the size of #buf.
+ */
+static
+void
+jd_object_read_streamed (JMessage* message, GSocketConnection* connection, gpointer object, guint64 length, guint64 offset, gchar* buf, JStatistics* statistics)
+{
+	g_autoptr(JMessage) reply = NULL;
+	GOutputStream* output;
+	gint64 modification_time;
+	guint64 size = 0;
+	guint64 total = 0;
+	guint64 done = 0;
 
-					if (merge_length > 0)
-					{
-						guint64 bytes_written = 0;
+	j_trace_enter(G_STRFUNC, NULL);
 
-						g_input_stream_read_all(input, buf, merge_length, NULL, NULL, NULL);
-						j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, merge_length);
+	output = g_io_stream_get_output_stream(G_IO_STREAM(connection));
 
-						j_backend_object_write(jd_object_backend, object, buf, merge_length, merge_offset, &bytes_written);
-						j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
-					}
+	if (object != NULL)
+	{
+		j_backend_object_status(jd_object_backend, object, &modification_time, &size);
+	}
 
-					if (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE)
-					{
-						j_backend_object_sync(jd_object_backend, object);
-						j_statistics_add(statistics, J_STATISTICS_SYNC, 1);
-					}
+	if (offset < size)
+	{
+		total = MIN(length, size - offset);
+	}
 
-					j_backend_object_close(jd_object_backend, object);
+	reply = j_message_new_reply(message);
+	j_message_add_operation(reply, sizeof(guint64));
+	j_message_append_varint(reply, total);
 
-					if (reply != NULL)
-					{
-						j_message_send(reply, connection);
-					}
+	j_helper_set_cork(connection, TRUE);
 
-					j_memory_chunk_reset(memory_chunk);
-				}
-				break;
-			case J_MESSAGE_OBJECT_STATUS:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					gpointer object;
+	j_message_write(reply, output);
 
-					reply = j_message_new_reply(message);
+	while (done < total)
+	{
+		guint64 piece;
+		guint64 bytes_read = 0;
 
-					namespace = j_message_get_string(message);
+		piece = MIN(J_STRIPE_SIZE, total - done);
 
-					for (i = 0; i < operation_count; i++)
-					{
-						gint64 modification_time = 0;
-						guint64 size = 0;
+		j_backend_object_read(jd_object_backend, object, buf, piece, offset + done, &bytes_read);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
 
-						path = j_message_get_string(message);
+		/* The object has been truncated in the meantime, pad the reply to keep the stream consistent. */
+		if (bytes_read < piece)
+		{
+			memset(buf + bytes_read, 0, piece - bytes_read);
+		}
 
-						// FIXME return value
-						j_backend_object_open(jd_object_backend, namespace, path, &object);
+		if (!g_output_stream_write_all(output, buf, piece, NULL, NULL, NULL))
+		{
+			break;
+		}
 
-						if (j_backend_object_status(jd_object_backend, object, &modification_time, &size))
-						{
-							j_statistics_add(statistics, J_STATISTICS_FILES_STATED, 1);
-						}
+		done += piece;
+	}
 
-						j_message_add_operation(reply, sizeof(gint64) + sizeof(guint64));
-						j_message_append_8(reply, &modification_time);
-						j_message_append_8(reply, &size);
+	j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, done);
 
-						j_backend_object_close(jd_object_backend, object);
-					}
+	j_helper_set_cork(connection, FALSE);
 
-					j_message_send(reply, connection);
-				}
-				break;
-			case J_MESSAGE_STATISTICS:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					JStatistics* r_statistics;
-					gchar get_all;
-					guint64 value;
+	j_trace_leave(G_STRFUNC);
+}
 
-					get_all = j_message_get_1(message);
-					r_statistics = (get_all == 0) ? statistics : jd_statistics;
+/**
+ * Handles a read message whose payloads are written to the client's memory using RDMA or to its shared memory.
+ * The reply only contains the number of bytes that have been written to each region.
+ */
+static
+void
+jd_object_read_transport (JMessage* message, GSocketConnection* connection, gpointer object, guint32 operation_count, gint64* send_time, JStatistics* statistics)
+{
+	g_autoptr(JMessage) reply = NULL;
+	g_autofree guint64* lengths = NULL;
+	g_autofree guint64* offsets = NULL;
+	JMemoryChunk* memory_chunk;
+	gchar* buf;
+	guint64 start = G_MAXUINT64;
+	guint64 end = 0;
 
-					if (get_all != 0)
-					{
-						G_LOCK(jd_statistics);
-						/* FIXME add statistics of all threads */
-					}
+	j_trace_enter(G_STRFUNC, NULL);
 
-					reply = j_message_new_reply(message);
-					j_message_add_operation(reply, 8 * sizeof(guint64));
+	lengths = g_new(guint64, operation_count);
+	offsets = g_new(guint64, operation_count);
 
-					value = j_statistics_get(r_statistics, J_STATISTICS_FILES_CREATED);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_FILES_DELETED);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_FILES_STATED);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_SYNC);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_READ);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_WRITTEN);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_RECEIVED);
-					j_message_append_8(reply, &value);
-					value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_SENT);
-					j_message_append_8(reply, &value);
+	/* The remote regions follow all lengths and offsets. */
+	for (guint i = 0; i < operation_count; i++)
+	{
+		lengths[i] = j_message_get_varint(message);
+		offsets[i] = j_message_get_varint(message);
 
-					if (get_all != 0)
-					{
-						G_UNLOCK(jd_statistics);
-					}
+		start = MIN(start, offsets[i]);
+		end = MAX(end, offsets[i] + lengths[i]);
+	}
 
-					j_message_send(reply, connection);
-				}
-				break;
-			case J_MESSAGE_PING:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					guint num;
+	jd_object_hint(message, object, start, end);
 
-					num = g_atomic_int_add(&jd_thread_num, 1);
+	reply = j_message_new_reply(message);
 
-					(void)num;
-					//g_print("HELLO %d\n", num);
+	memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
 
+	/* Guaranteed to work, because memory_chunk is not shared. */
+	buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+	g_assert(buf != NULL);
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		JTransportRemote remote;
+		guint64 done = 0;
+
+		remote.address = j_message_get_8(message);
+		remote.key = j_message_get_8(message);
+
+		while (object != NULL && done < lengths[i])
+		{
+			JTransportRemote piece_remote;
+			guint64 piece;
+			guint64 bytes_read = 0;
+
+			piece = MIN(J_STRIPE_SIZE, lengths[i] - done);
+
+			j_backend_object_read(jd_object_backend, object, buf, piece, offsets[i] + done, &bytes_read);
+			j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+
+			piece_remote.address = remote.address + done;
+			piece_remote.key = remote.key;
+
+			if (!j_transport_send(connection, &piece_remote, buf, bytes_read))
+			{
+				break;
+			}
+
+			j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, bytes_read);
+			done += bytes_read;
+
+			/* The end of the object has been reached. */
+			if (bytes_read < piece)
+			{
+				break;
+			}
+		}
+
+		j_message_add_operation(reply, sizeof(guint64));
+		j_message_append_varint(reply, done);
+	}
+
+	jd_memory_pool_release(jd_memory_pool, memory_chunk);
+
+	jd_message_send(reply, connection, send_time);
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Handles a write message whose payloads are read from the client's memory using RDMA or from its shared memory.
+ * If reply is not NULL, it receives the number of bytes that have been written from each region.
+ */
+static
+void
+jd_object_write_transport (JMessage* message, GSocketConnection* connection, gchar const* namespace, gchar const* path, gpointer handle, gpointer object, guint32 operation_count, JMessage* reply, JStatistics* statistics)
+{
+	g_autofree guint64* lengths = NULL;
+	g_autofree guint64* offsets = NULL;
+	JMemoryChunk* memory_chunk;
+	gchar* buf;
+	guint32 flags;
+	gboolean coalesce;
+
+	j_trace_enter(G_STRFUNC, NULL);
+
+	flags = j_message_get_flags(message);
+
+	/* Writes are only coalesced across messages if they do not have to reach the storage immediately and the scrubber does not read them back. */
+	coalesce = (handle != NULL && jd_write_buffer_size > 0 && jd_scrub == NULL && !(flags & J_MESSAGE_FLAGS_SAFETY_STORAGE));
+
+	if (handle != NULL && !coalesce)
+	{
+		jd_handle_cache_flush(jd_handle_cache, handle);
+	}
+
+	lengths = g_new(guint64, operation_count);
+	offsets = g_new(guint64, operation_count);
+
+	/* The remote regions follow all lengths and offsets. */
+	for (guint i = 0; i < operation_count; i++)
+	{
+		lengths[i] = j_message_get_varint(message);
+		offsets[i] = j_message_get_varint(message);
+	}
+
+	/* Blocks if the memory budget is exhausted. */
+	memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+
+	/* Guaranteed to work, because memory_chunk is not shared. */
+	buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+	g_assert(buf != NULL);
+
+	for (guint i = 0; i < operation_count; i++)
+	{
+		JTransportRemote remote;
+		guint64 done = 0;
+
+		remote.address = j_message_get_8(message);
+		remote.key = j_message_get_8(message);
+
+		while (done < lengths[i])
+		{
+			JTransportRemote piece_remote;
+			guint64 piece;
+			guint64 bytes_written = 0;
+
+			piece = MIN(J_STRIPE_SIZE, lengths[i] - done);
+
+			piece_remote.address = remote.address + done;
+			piece_remote.key = remote.key;
+
+			if (!j_transport_receive(connection, &piece_remote, buf, piece))
+			{
+				break;
+			}
+
+			j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, piece);
+
+			if (object != NULL)
+			{
+				jd_object_write(handle, object, buf, piece, offsets[i] + done, coalesce, &bytes_written);
+				j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+			}
+
+			done += piece;
+		}
+
+		if (reply != NULL)
+		{
+			j_message_add_operation(reply, sizeof(guint64));
+			j_message_append_varint(reply, done);
+		}
+	}
+
+	jd_scrub_update(jd_scrub, namespace, path, object, buf, lengths, offsets, operation_count);
+
+	jd_memory_pool_release(jd_memory_pool, memory_chunk);
+
+	if (object != NULL && (flags & J_MESSAGE_FLAGS_SAFETY_STORAGE))
+	{
+		jd_group_commit_sync(jd_group_commit, &object, 1, statistics);
+	}
+
+	j_trace_leave(G_STRFUNC);
+}
+
+/**
+ * Extents of an object that are read or written together.
+ * Backends supporting vectored access receive all of them at once.
+ */
+struct JdObjectExtents
+{
+	gpointer* buffers;
+	guint64* lengths;
+	guint64* offsets;
+	guint64* nbytes;
+
+	/**
+	 * The first operation of each extent and the number of operations merged into it.
+	 */
+	guint* first;
+	guint* merged;
+
+	guint count;
+
+	/**
+	 * The number of bytes of the write buffer used by the extents.
+	 */
+	guint64 fill;
+};
+
+typedef struct JdObjectExtents JdObjectExtents;
+
+static
+JdObjectExtents*
+jd_object_extents_new (guint size)
+{
+	JdObjectExtents* extents;
+
+	extents = g_slice_new(JdObjectExtents);
+	extents->buffers = g_new(gpointer, size);
+	extents->lengths = g_new(guint64, size);
+	extents->offsets = g_new(guint64, size);
+	extents->nbytes = g_new(guint64, size);
+	extents->first = g_new(guint, size);
+	extents->merged = g_new(guint, size);
+	extents->count = 0;
+	extents->fill = 0;
+
+	return extents;
+}
+
+static
+void
+jd_object_extents_free (JdObjectExtents* extents)
+{
+	g_free(extents->buffers);
+	g_free(extents->lengths);
+	g_free(extents->offsets);
+	g_free(extents->nbytes);
+	g_free(extents->first);
+	g_free(extents->merged);
+
+	g_slice_free(JdObjectExtents, extents);
+}
+
+static
+void
+jd_object_extents_add (JdObjectExtents* extents, gpointer buffer, guint64 length, guint64 offset, guint first, guint merged)
+{
+	extents->buffers[extents->count] = buffer;
+	extents->lengths[extents->count] = length;
+	extents->offsets[extents->count] = offset;
+	extents->nbytes[extents->count] = 0;
+	extents->first[extents->count] = first;
+	extents->merged[extents->count] = merged;
+	extents->count++;
+}
+
+/**
+ * Reads the collected extents and adds one reply operation per merged read operation.
+ */
+static
+void
+jd_object_read_extents (gpointer object, JdObjectExtents* extents, guint64 const* lengths, guint64 const* offsets, JMessage* reply, JStatistics* statistics)
+{
+	if (extents->count == 0)
+	{
+		return;
+	}
+
+	if (object != NULL)
+	{
+		if (jd_object_backend->object.readv != NULL)
+		{
+			j_backend_object_readv(jd_object_backend, object, extents->buffers, extents->lengths, extents->offsets, extents->count, extents->nbytes);
+		}
+		else
+		{
+			for (guint e = 0; e < extents->count; e++)
+			{
+				j_backend_object_read(jd_object_backend, object, extents->buffers[e], extents->lengths[e], extents->offsets[e], &(extents->nbytes[e]));
+			}
+		}
+
+		for (guint e = 0; e < extents->count; e++)
+		{
+			j_statistics_add(statistics, J_STATISTICS_BYTES_READ, extents->nbytes[e]);
+		}
+	}
+
+	for (guint e = 0; e < extents->count; e++)
+	{
+		gchar* buf = extents->buffers[e];
+		guint64 bytes_read = extents->nbytes[e];
+
+		/* Each operation still gets its own reply, short reads only affect the operations at the end. */
+		for (guint j = 0; j < extents->merged[e]; j++)
+		{
+			guint k = extents->first[e] + j;
+			guint64 displacement;
+			guint64 nbytes = 0;
+
+			displacement = offsets[k] - extents->offsets[e];
+
+			if (bytes_read > displacement)
+			{
+				nbytes = MIN(lengths[k], bytes_read - displacement);
+			}
+
+			j_message_add_operation(reply, sizeof(guint64));
+			j_message_append_varint(reply, nbytes);
+
+			if (nbytes > 0)
+			{
+				j_message_add_send(reply, buf + displacement, nbytes);
+			}
+
+			j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, nbytes);
+		}
+	}
+
+	extents->count = 0;
+}
+
+/**
+ * Writes the collected extents at once.
+ *
+ * \return TRUE if the extents were synced together with the writes.
+ */
+static
+gboolean
+jd_object_write_extents (gpointer object, JdObjectExtents* extents, gboolean sync, JStatistics* statistics)
+{
+	gboolean synced = FALSE;
+
+	if (extents->count > 0 || sync)
+	{
+		j_backend_object_writev(jd_object_backend, object, (gconstpointer const*)extents->buffers, extents->lengths, extents->offsets, extents->count, sync, extents->nbytes);
+		synced = sync;
+
+		for (guint e = 0; e < extents->count; e++)
+		{
+			j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, extents->nbytes[e]);
+		}
+
+		if (synced)
+		{
+			j_statistics_add(statistics, J_STATISTICS_SYNC, 1);
+		}
+	}
+
+	extents->count = 0;
+	extents->fill = 0;
+
+	return synced;
+}
+
+/**
+ * Receives a run of merged write operations and writes it.
+ * If extents are given, the run is only collected and written together with the other extents.
+ * Returns FALSE if the run could not be received completely, nothing is written in that case.
+ */
+static
+gboolean
+jd_object_write_merged (GInputStream* input, gpointer handle, gpointer object, gchar* buf, guint64 length, guint64 offset, gboolean coalesce, JdObjectExtents* extents, gboolean verify, guint32* checksum, JStatistics* statistics)
+{
+	guint64 bytes_written = 0;
+
+	if (extents != NULL)
+	{
+		if (extents->fill + length > J_STRIPE_SIZE)
+		{
+			jd_object_write_extents(object, extents, FALSE, statistics);
+		}
+
+		buf += extents->fill;
+	}
+
+	if (!jd_message_receive_payload(input, buf, length, statistics))
+	{
+		return FALSE;
+	}
+
+	if (verify)
+	{
+		*checksum = j_helper_crc32c(*checksum, buf, length);
+	}
+
+	if (extents != NULL)
+	{
+		jd_object_extents_add(extents, buf, length, offset, 0, 0);
+		extents->fill += length;
+	}
+	else if (object != NULL)
+	{
+		jd_object_write(handle, object, buf, length, offset, coalesce, &bytes_written);
+		j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Copies an object by reading it in chunks, used if the backend cannot copy by itself.
+ */
+static
+gboolean
+jd_object_copy_generic (gpointer from, gpointer to, gchar* buf, guint64* bytes_copied, JStatistics* statistics)
+{
+	guint64 offset = 0;
+
+	if (jd_object_backend->object.truncate != NULL && !j_backend_object_truncate(jd_object_backend, to, 0))
+	{
+		return FALSE;
+	}
+
+	while (TRUE)
+	{
+		guint64 nbytes = 0;
+		guint64 bytes_written = 0;
+
+		if (!j_backend_object_read(jd_object_backend, from, buf, J_STRIPE_SIZE, offset, &nbytes))
+		{
+			return FALSE;
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, nbytes);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+
+		if (!j_backend_object_write(jd_object_backend, to, buf, nbytes, offset, &bytes_written))
+		{
+			return FALSE;
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+
+		offset += nbytes;
+		*bytes_copied = offset;
+
+		if (nbytes < J_STRIPE_SIZE)
+		{
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * Copies an object to another object on this server.
+ */
+static
+gboolean
+jd_object_copy_local (gpointer object, gchar const* namespace, gchar const* path, gchar* buf, guint64* bytes_copied, JStatistics* statistics)
+{
+	gboolean ret = FALSE;
+	gpointer handle;
+	gpointer to_object = NULL;
+
+	if (!j_backend_object_create(jd_object_backend, namespace, path, &to_object))
+	{
+		return FALSE;
+	}
+
+	j_statistics_add(statistics, J_STATISTICS_FILES_CREATED, 1);
+	j_backend_object_close(jd_object_backend, to_object);
+
+	/* The destination may have cached handles with coalesced writes that must not overwrite the copy later. */
+	if ((handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &to_object)) == NULL)
+	{
+		return FALSE;
+	}
+
+	jd_handle_cache_flush(jd_handle_cache, handle);
+
+	if (jd_object_backend->object.copy != NULL && j_backend_object_copy(jd_object_backend, object, to_object, bytes_copied))
+	{
+		ret = TRUE;
+	}
+	else
+	{
+		*bytes_copied = 0;
+		ret = jd_object_copy_generic(object, to_object, buf, bytes_copied, statistics);
+	}
+
+	jd_handle_cache_release(jd_handle_cache, handle);
+
+	return ret;
+}
+
+/**
+ * Creates and truncates an object on another server.
+ */
+static
+gboolean
+jd_object_copy_remote_prepare (guint32 index, gchar const* namespace, gchar const* path)
+{
+	gboolean ret = TRUE;
+	gsize namespace_len;
+	gsize path_len;
+
+	namespace_len = strlen(namespace) + 1;
+	path_len = strlen(path) + 1;
+
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+
+		message = j_message_new(J_MESSAGE_OBJECT_CREATE, namespace_len);
+		j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
+		j_message_append_n(message, namespace, namespace_len);
+		j_message_add_operation(message, path_len);
+		j_message_append_n(message, path, path_len);
+
+		reply = j_connection_pool_request_object(index, message, TRUE);
+		ret = (reply != NULL) && ret;
+	}
+
+	if (ret)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+
+		message = j_message_new(J_MESSAGE_OBJECT_TRUNCATE, namespace_len + path_len);
+		j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
+		j_message_append_n(message, namespace, namespace_len);
+		j_message_append_n(message, path, path_len);
+		j_message_add_operation(message, sizeof(guint64));
+		j_message_append_varint(message, 0);
+
+		reply = j_connection_pool_request_object(index, message, TRUE);
+		ret = (reply != NULL && j_message_get_1(reply) != 0) && ret;
+	}
+
+	return ret;
+}
+
+/**
+ * Copies an object to another server by streaming it there directly.
+ * This way, the data does not have to pass through the client.
+ */
+static
+gboolean
+jd_object_copy_remote (gpointer object, guint32 index, gchar const* namespace, gchar const* path, gchar* buf, guint64* bytes_copied, JStatistics* statistics)
+{
+	gsize namespace_len;
+	gsize path_len;
+	guint64 offset = 0;
+
+	if (index >= j_configuration_get_object_server_count(jd_configuration))
+	{
+		return FALSE;
+	}
+
+	if (g_once_init_enter(&jd_connection_pool_initialized))
+	{
+		j_connection_pool_init(jd_configuration);
+		g_once_init_leave(&jd_connection_pool_initialized, 1);
+	}
+
+	if (!jd_object_copy_remote_prepare(index, namespace, path))
+	{
+		return FALSE;
+	}
+
+	namespace_len = strlen(namespace) + 1;
+	path_len = strlen(path) + 1;
+
+	while (TRUE)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+		GSocketConnection* to_connection;
+		guint64 nbytes = 0;
+
+		if (!j_backend_object_read(jd_object_backend, object, buf, J_STRIPE_SIZE, offset, &nbytes))
+		{
+			return FALSE;
+		}
+
+		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, nbytes);
+
+		if (nbytes == 0)
+		{
+			break;
+		}
+
+		message = j_message_new(J_MESSAGE_OBJECT_WRITE, namespace_len + path_len);
+		j_message_force_safety(message, J_SEMANTICS_SAFETY_NETWORK);
+		j_message_append_n(message, namespace, namespace_len);
+		j_message_append_n(message, path, path_len);
+		j_message_add_operation(message, sizeof(guint64) + sizeof(guint64));
+		j_message_append_varint(message, nbytes);
+		j_message_append_varint(message, offset);
+		j_message_add_send(message, buf, nbytes);
+
+		to_connection = j_connection_pool_pop_object(index);
+		j_message_send(message, to_connection);
+
+		reply = j_message_new_reply(message);
+		j_message_receive(reply, to_connection);
+
+		j_connection_pool_push_object(index, to_connection);
+
+		j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, nbytes);
+
+		offset += j_message_get_varint(reply);
+		*bytes_copied = offset;
+
+		if (nbytes < J_STRIPE_SIZE)
+		{
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * The replies to a KV iteration.
+ * The values are sent in multiple replies of roughly JD_KV_REPLY_SIZE bytes, so the result set never has to be held in memory completely.
+ */
+struct JdKVReply
+{
+	JMessage* message;
+	JMessage* reply;
+	GSocketConnection* connection;
+	gint64* send_time;
+	gsize reply_size;
+};
+
+typedef struct JdKVReply JdKVReply;
+
+static
+void
+jd_kv_reply_init (JdKVReply* kv_reply, JMessage* message, GSocketConnection* connection, gint64* send_time)
+{
+	kv_reply->message = message;
+	kv_reply->reply = j_message_new_reply(message);
+	kv_reply->connection = connection;
+	kv_reply->send_time = send_time;
+	kv_reply->reply_size = 0;
+}
+
+/**
+ * Sends the current reply if it is full and starts a new one.
+ */
+static
+void
+jd_kv_reply_send_full (JdKVReply* kv_reply)
+{
+	if (kv_reply->reply_size >= JD_KV_REPLY_SIZE)
+	{
+		jd_message_send(kv_reply->reply, kv_reply->connection, kv_reply->send_time);
+		j_message_unref(kv_reply->reply);
+
+		kv_reply->reply = j_message_new_reply(kv_reply->message);
+		kv_reply->reply_size = 0;
+	}
+}
+
+/**
+ * Appends a value followed by its key.
+ * If fields is not NULL, only the given fields of the value are sent.
+ */
+static
+void
+jd_kv_reply_append (JdKVReply* kv_reply, gchar const* key, bson_t const* value, gchar const* const* fields)
+{
+	bson_t projected[1];
+	gsize key_len;
+	gsize entry_size;
+
+	if (fields != NULL)
+	{
+		j_helper_bson_project(value, fields, projected);
+		value = projected;
+	}
+
+	key_len = strlen(key) + 1;
+	entry_size = sizeof(guint64) + value->len + key_len;
+
+	j_message_add_operation(kv_reply->reply, entry_size);
+	j_message_append_varint(kv_reply->reply, value->len);
+	j_message_append_n(kv_reply->reply, bson_get_data(value), value->len);
+	j_message_append_n(kv_reply->reply, key, key_len);
+	kv_reply->reply_size += entry_size;
+
+	if (fields != NULL)
+	{
+		bson_destroy(projected);
+	}
+
+	jd_kv_reply_send_full(kv_reply);
+}
+
+/**
+ * Sends the last reply, which is terminated by a zero length.
+ */
+static
+void
+jd_kv_reply_finish (JdKVReply* kv_reply)
+{
+	j_message_add_operation(kv_reply->reply, sizeof(guint64));
+	j_message_append_varint(kv_reply->reply, 0);
+
+	jd_message_send(kv_reply->reply, kv_reply->connection, kv_reply->send_time);
+	j_message_unref(kv_reply->reply);
+}
+
+/**
+ * Sends all values returned by a KV iterator, each followed by its key.
+ * If iterator is NULL, only the terminating reply is sent.
+ */
+static
+void
+jd_send_kv_iterator (JMessage* message, GSocketConnection* connection, gpointer iterator, gint64* send_time)
+{
+	JdKVReply kv_reply;
+	bson_t value[1];
+	gchar const* key;
+
+	jd_kv_reply_init(&kv_reply, message, connection, send_time);
+
+	while (iterator != NULL && j_backend_kv_iterate(jd_kv_backend, iterator, &key, value))
+	{
+		/* Index entries are stored in the same namespace. */
+		if (!jd_kv_index_is_internal(key))
+		{
+			jd_kv_reply_append(&kv_reply, key, value, NULL);
+		}
+
+		bson_destroy(value);
+	}
+
+	jd_kv_reply_finish(&kv_reply);
+}
+
+/**
+ * Sends the paths returned by an object listing, using the same chunked replies as KV iterations.
+ * Each path is preceded by its length including the terminating null byte.
+ * If iterator is NULL, only the terminating reply is sent.
+ */
+static
+void
+jd_send_object_list (JMessage* message, GSocketConnection* connection, gpointer iterator, gint64* send_time)
+{
+	JdKVReply kv_reply;
+	gchar const* path;
+
+	jd_kv_reply_init(&kv_reply, message, connection, send_time);
+
+	while (iterator != NULL && j_backend_object_iterate(jd_object_backend, iterator, &path))
+	{
+		gsize path_len;
+		gsize entry_size;
+
+		path_len = strlen(path) + 1;
+		entry_size = sizeof(guint64) + path_len;
+
+		j_message_add_operation(kv_reply.reply, entry_size);
+		j_message_append_varint(kv_reply.reply, path_len);
+		j_message_append_n(kv_reply.reply, path, path_len);
+		kv_reply.reply_size += entry_size;
+
+		jd_kv_reply_send_full(&kv_reply);
+	}
+
+	jd_kv_reply_finish(&kv_reply);
+}
+
+/**
+ * Sends the values of a range of keys that match a filter.
+ * With a delimiter, keys that contain it after the prefix are skipped, so only the prefix's direct children are sent.
+ * The limit refers to the matching values, so the range is read in pages of limit keys until enough values have been found.
+ * Each page's iterator has to be exhausted, so at most one page is read unnecessarily.
+ */
+static
+void
+jd_send_kv_query (JMessage* message, GSocketConnection* connection, gchar const* namespace, gchar const* prefix, gchar const* delimiter, gchar const* start_after, guint32 limit, bson_t const* filter, gchar const* const* fields, gint64* send_time)
+{
+	JdKVReply kv_reply;
+	g_autofree gchar* last_key = NULL;
+	gchar const* page_start = start_after;
+	gsize prefix_len;
+	gboolean skips;
+	guint32 sent = 0;
+	guint32 count;
+
+	prefix_len = strlen(prefix);
+	/* Filters and delimiters skip values, so the limit does not bound the number of keys read. */
+	skips = (filter != NULL || delimiter != NULL);
+
+	jd_kv_reply_init(&kv_reply, message, connection, send_time);
+
+	do
+	{
+		gpointer iterator = NULL;
+		bson_t value[1];
+		gchar const* key;
+		gboolean ret;
+
+		if (page_start == NULL && limit == 0)
+		{
+			ret = j_backend_kv_get_by_prefix(jd_kv_backend, namespace, prefix, &iterator);
+		}
+		else
+		{
+			ret = j_backend_kv_get_range(jd_kv_backend, namespace, prefix, page_start, limit, &iterator);
+		}
+
+		count = 0;
+
+		while (ret && j_backend_kv_iterate(jd_kv_backend, iterator, &key, value))
+		{
+			count++;
+
+			if ((limit == 0 || sent < limit) && !jd_kv_index_is_internal(key)
+			    && (delimiter == NULL || strstr(key + prefix_len, delimiter) == NULL)
+			    && (filter == NULL || j_helper_bson_match(value, filter)))
+			{
+				jd_kv_reply_append(&kv_reply, key, value, fields);
+				sent++;
+			}
+
+			/* The key is only valid until the next iteration. */
+			if (skips && limit > 0)
+			{
+				g_free(last_key);
+				last_key = g_strdup(key);
+			}
+
+			bson_destroy(value);
+		}
+
+		page_start = last_key;
+	}
+	while (skips && limit > 0 && sent < limit && count == limit);
+
+	jd_kv_reply_finish(&kv_reply);
+}
+
+struct JdKVIndexReply
+{
+	JdKVReply* kv_reply;
+	gchar const* const* fields;
+};
+
+typedef struct JdKVIndexReply JdKVIndexReply;
+
+static
+void
+jd_kv_index_reply_append (gchar const* key, bson_t const* value, gpointer data)
+{
+	JdKVIndexReply* index_reply = data;
+
+	jd_kv_reply_append(index_reply->kv_reply, key, value, index_reply->fields);
+}
+
+/**
+ * Sends the values whose field matches a range.
+ * Fields without an index are answered by filtering all values.
+ */
+static
+void
+jd_send_kv_index (JMessage* message, GSocketConnection* connection, gchar const* namespace, gchar const* field, bson_t const* range, guint32 limit, gchar const* const* fields, gint64* send_time)
+{
+	JdKVReply kv_reply;
+	JdKVIndexReply index_reply;
+
+	index_reply.kv_reply = &kv_reply;
+	index_reply.fields = fields;
+
+	jd_kv_reply_init(&kv_reply, message, connection, send_time);
+
+	if (jd_kv_index_scan(jd_kv_index, namespace, field, range, limit, jd_kv_index_reply_append, &index_reply))
+	{
+		jd_kv_reply_finish(&kv_reply);
+	}
+	else
+	{
+		bson_t filter[1];
+
+		/* The query sends its own replies. */
+		j_message_unref(kv_reply.reply);
+
+		bson_init(filter);
+		bson_append_document(filter, field, -1, range);
+		jd_send_kv_query(message, connection, namespace, "", NULL, NULL, limit, filter, fields, send_time);
+		bson_destroy(filter);
+	}
+}
+
+/**
+ * Announces a changed key to the watches and read replicas.
+ */
+static
+void
+jd_kv_changed (gchar const* namespace, gchar const* key, gboolean deleted)
+{
+	if (jd_kv_watch != NULL)
+	{
+		jd_kv_watch_notify(jd_kv_watch, namespace, key, deleted);
+	}
+
+	if (jd_kv_replication != NULL)
+	{
+		jd_kv_replication_notify(jd_kv_replication, namespace, key);
+	}
+}
+
+/**
+ * Deletes all values whose keys start with a prefix, including their index entries.
+ */
+static
+gboolean
+jd_kv_delete_by_prefix (gchar const* namespace, gchar const* prefix, JSemanticsSafety safety)
+{
+	g_autoptr(GPtrArray) keys = NULL;
+	g_autofree guint64* generations = NULL;
+	JdKVIndexBatch* index_batch;
+	gpointer iterator;
+	gpointer batch;
+	gboolean ret = TRUE;
+
+	keys = g_ptr_array_new_with_free_func(g_free);
+
+	/* The keys are collected first, so that the iterator does not observe its own deletions. */
+	if (j_backend_kv_get_by_prefix(jd_kv_backend, namespace, prefix, &iterator))
+	{
+		bson_t value[1];
+		gchar const* key;
+
+		while (j_backend_kv_iterate(jd_kv_backend, iterator, &key, value))
+		{
+			if (!jd_kv_index_is_internal(key))
+			{
+				g_ptr_array_add(keys, g_strdup(key));
+			}
+
+			bson_destroy(value);
+		}
+	}
+
+	if (keys->len == 0)
+	{
+		return TRUE;
+	}
+
+	if (!j_backend_kv_batch_start(jd_kv_backend, namespace, safety, &batch))
+	{
+		return FALSE;
+	}
+
+	index_batch = jd_kv_index_batch_start(jd_kv_index, namespace, batch);
+	generations = g_new(guint64, keys->len);
+
+	for (guint i = 0; i < keys->len; i++)
+	{
+		gchar const* key = g_ptr_array_index(keys, i);
+
+		if (jd_kv_cache != NULL)
+		{
+			generations[i] = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
+		}
+
+		if (index_batch != NULL)
+		{
+			jd_kv_index_batch_delete(index_batch, key);
+		}
+
+		ret = j_backend_kv_delete(jd_kv_backend, batch, key) && ret;
+	}
+
+	ret = j_backend_kv_batch_execute(jd_kv_backend, batch) && ret;
+
+	for (guint i = 0; i < keys->len; i++)
+	{
+		if (jd_kv_cache != NULL)
+		{
+			jd_kv_cache_end_write(jd_kv_cache, namespace, g_ptr_array_index(keys, i), NULL, generations[i]);
+		}
+
+		if (jd_kv_filter != NULL)
+		{
+			jd_kv_filter_delete(jd_kv_filter, namespace);
+		}
+
+		jd_kv_changed(namespace, g_ptr_array_index(keys, i), TRUE);
+	}
+
+	if (index_batch != NULL)
+	{
+		jd_kv_index_batch_end(index_batch);
+	}
+
+	return ret;
+}
+
+/**
+ * Handles a message and sends its replies.
+ * Returns FALSE if the connection has to be dropped, because a message's payload could not be received completely.
+ */
+gboolean
+jd_handle_message (JMessage* message, GSocketConnection* connection, JStatistics* statistics, gint64 received)
+{
+	JMessageType message_type;
+	gint64 start;
+	gint64 send_time = 0;
+	guint64 trace_id;
+	gchar const* key;
+	gchar const* namespace;
+	gchar const* path;
+	guint32 operation_count;
+	JMessageFlags type_modifier;
+	JSemanticsSafety safety;
+	GInputStream* input;
+	gboolean scheduled;
+	gboolean connected = TRUE;
+	guint i;
+
+	j_trace_enter(G_STRFUNC, NULL);
+	j_trace_flow("message", j_message_get_id(message), J_TRACE_FLOW_STEP);
+
+	trace_id = j_message_get_trace_id(message);
+
+	if (trace_id != 0)
+	{
+		j_trace_flow("batch", trace_id, J_TRACE_FLOW_STEP);
+	}
+
+	message_type = j_message_get_type(message);
+
+	/**
+	 * Waiting for locks must not occupy a slot, otherwise the releases might not get one.
+	 * Compound messages do not occupy one either, since their messages acquire their own.
+	 **/
+	scheduled = (jd_scheduler != NULL && message_type != J_MESSAGE_LOCK_ACQUIRE && message_type != J_MESSAGE_LOCK_REVOKE && message_type != J_MESSAGE_COMPOUND);
+
+	if (scheduled)
+	{
+		jd_scheduler_acquire(jd_scheduler, message, connection);
+	}
+
+	start = g_get_monotonic_time();
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	operation_count = j_message_get_count(message);
+	type_modifier = j_message_get_flags(message);
+	safety = jd_safety_message_to_semantics(type_modifier);
+
+	J_PROBE4(server_dispatch_begin, message_type, operation_count, j_message_get_length(message), j_message_get_id(message));
+
+	switch (message_type)
+	{
+		case J_MESSAGE_NONE:
+			break;
+		case J_MESSAGE_OBJECT_CREATE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree gpointer* objects = NULL;
+				gpointer object;
+				guint objects_len = 0;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				namespace = j_message_get_string(message);
+
+				/* Created objects are kept open until they have been synced together. */
+				objects = g_new(gpointer, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					path = j_message_get_string(message);
+
+					if (j_backend_object_create(jd_object_backend, namespace, path, &object))
+					{
+						j_statistics_add(statistics, J_STATISTICS_FILES_CREATED, 1);
+						objects[objects_len] = object;
+						objects_len++;
+					}
+
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
+				}
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE)
+				{
+					jd_group_commit_sync(jd_group_commit, objects, objects_len, statistics);
+				}
+
+				for (i = 0; i < objects_len; i++)
+				{
+					j_backend_object_close(jd_object_backend, objects[i]);
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_OBJECT_DELETE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gpointer object;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				namespace = j_message_get_string(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					path = j_message_get_string(message);
+
+					/* Handles still in use by other threads stay valid until they are released. */
+					jd_handle_cache_invalidate(jd_handle_cache, namespace, path);
+
+					if (j_backend_object_open(jd_object_backend, namespace, path, &object))
+					{
+						gboolean deleted;
+
+						/* Moving objects to the trash returns at once, their space is reclaimed in the background. */
+						if (jd_trash != NULL)
+						{
+							deleted = jd_trash_delete(jd_trash, object);
+						}
+						else
+						{
+							deleted = j_backend_object_delete(jd_object_backend, object);
+						}
+
+						if (deleted)
+						{
+							j_statistics_add(statistics, J_STATISTICS_FILES_DELETED, 1);
+						}
+					}
+
+					/* A new object of the same name must not be compared against the old one's checksums. */
+					jd_scrub_invalidate(jd_scrub, namespace, path);
+
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_OBJECT_PURGE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					gchar const* directory;
+					gchar success = FALSE;
+
+					directory = j_message_get_string(message);
+
+					jd_handle_cache_invalidate_directory(jd_handle_cache, namespace, directory);
+
+					if (jd_object_backend->object.purge != NULL)
+					{
+						success = j_backend_object_purge(jd_object_backend, namespace, directory);
+					}
+
+					jd_scrub_invalidate_directory(jd_scrub, namespace, directory);
+
+					j_message_add_operation(reply, 1);
+					j_message_append_1(reply, &success);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_LIST:
+			{
+				gchar const* prefix;
+				gpointer iterator = NULL;
+				gboolean ret = FALSE;
+
+				namespace = j_message_get_string(message);
+				/* An empty prefix lists all objects. */
+				prefix = j_message_get_string(message);
+
+				if (jd_object_backend->object.list != NULL && prefix[0] == '\0')
+				{
+					ret = j_backend_object_list(jd_object_backend, namespace, &iterator);
+				}
+				else if (jd_object_backend->object.list_by_prefix != NULL && prefix[0] != '\0')
+				{
+					ret = j_backend_object_list_by_prefix(jd_object_backend, namespace, prefix, &iterator);
+				}
+
+				jd_send_object_list(message, connection, (ret) ? iterator : NULL, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_READ:
+			{
+				gpointer handle;
+				gpointer object;
+
+				handle = jd_object_get(message, FALSE, &namespace, &path, &object);
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+				}
+
+				if (type_modifier & J_MESSAGE_FLAGS_RDMA)
+				{
+					jd_object_read_transport(message, connection, object, operation_count, &send_time, statistics);
+				}
+				else if (jd_object_backend->object.read_to_fd != NULL)
+				{
+					jd_object_read_to_fd(message, connection, object, operation_count, statistics);
+				}
+				else
+				{
+					JMemoryChunk* memory_chunk;
+					JMessage* reply;
+					JdObjectExtents* extents;
+					g_autofree guint64* lengths = NULL;
+					g_autofree guint64* offsets = NULL;
+					guint64 start = G_MAXUINT64;
+					guint64 end = 0;
+
+					memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+					reply = j_message_new_reply(message);
+
+					lengths = g_new(guint64, operation_count);
+					offsets = g_new(guint64, operation_count);
+
+					for (i = 0; i < operation_count; i++)
+					{
+						lengths[i] = j_message_get_varint(message);
+						offsets[i] = j_message_get_varint(message);
+
+						start = MIN(start, offsets[i]);
+						end = MAX(end, offsets[i] + lengths[i]);
+					}
+
+					jd_object_hint(message, object, start, end);
+
+					extents = jd_object_extents_new(operation_count);
+
+					for (i = 0; i < operation_count; i++)
+					{
+						gchar* buf;
+						guint64 length;
+						guint64 offset;
+						guint64 merge_length;
+						guint merge_count;
+
+						length = lengths[i];
+						offset = offsets[i];
+
+						if (length > J_STRIPE_SIZE)
+						{
+							jd_object_read_extents(object, extents, lengths, offsets, reply, statistics);
+
+							/* The pending reply references the memory chunk, so it has to be sent before the chunk can be reused. */
+							if (j_message_get_count(reply) > 0)
+							{
+								jd_message_send(reply, connection, &send_time);
+							}
+
+							j_message_unref(reply);
+							j_memory_chunk_reset(memory_chunk);
+
+							buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+							jd_object_read_streamed(message, connection, object, length, offset, buf, statistics);
+
+							j_memory_chunk_reset(memory_chunk);
+							reply = j_message_new_reply(message);
+
+							continue;
+						}
+
+						/* Merge the following operations that continue this one, so the backend is accessed only once. */
+						merge_length = length;
+						merge_count = 1;
+
+						while (i + merge_count < operation_count && offsets[i + merge_count] == offset + merge_length && merge_length + lengths[i + merge_count] <= J_STRIPE_SIZE)
+						{
+							merge_length += lengths[i + merge_count];
+							merge_count++;
+						}
+
+						buf = j_memory_chunk_get(memory_chunk, merge_length);
+
+						/* Only possible with a memory budget, because chunks can not grow then. */
+						if (buf == NULL)
+						{
+							jd_object_read_extents(object, extents, lengths, offsets, reply, statistics);
+
+							jd_message_send(reply, connection, &send_time);
+							j_message_unref(reply);
+
+							reply = j_message_new_reply(message);
+
+							j_memory_chunk_reset(memory_chunk);
+							buf = j_memory_chunk_get(memory_chunk, merge_length);
+						}
+
+						/* The extents are read together, so backends can submit them at once. */
+						jd_object_extents_add(extents, buf, merge_length, offset, i, merge_count);
+
+						i += merge_count - 1;
+					}
+
+					jd_object_read_extents(object, extents, lengths, offsets, reply, statistics);
+					jd_object_extents_free(extents);
+
+					jd_message_send(reply, connection, &send_time);
+					j_message_unref(reply);
+
+					jd_memory_pool_release(jd_memory_pool, memory_chunk);
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+			}
+			break;
+		case J_MESSAGE_OBJECT_WRITE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree guint64* lengths = NULL;
+				g_autofree guint64* offsets = NULL;
+				JMemoryChunk* memory_chunk;
+				JdObjectExtents* extents = NULL;
+				gchar* buf;
+				gpointer handle;
+				gpointer object;
+				guint64 merge_length = 0;
+				guint64 merge_offset = 0;
+				guint32 checksum = 0;
+				guint32 payload_checksum = 0;
+				gboolean verify;
+				gboolean coalesce;
+				gboolean synced = FALSE;
+				gint fd;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				/* Stripes of distributed objects are created by their first write. */
+				handle = jd_object_get(message, (type_modifier & J_MESSAGE_FLAGS_CREATE) != 0, &namespace, &path, &object);
+
+				if (type_modifier & J_MESSAGE_FLAGS_RDMA)
+				{
+					jd_object_write_transport(message, connection, namespace, path, handle, object, operation_count, reply, statistics);
+
+					if (handle != NULL)
+					{
+						jd_handle_cache_release(jd_handle_cache, handle);
+					}
+
+					if (reply != NULL)
+					{
+						jd_message_send(reply, connection, &send_time);
+					}
+
+					break;
+				}
+
+				verify = j_message_get_payload_checksum(message, &payload_checksum);
+
+				fd = g_socket_get_fd(g_socket_connection_get_socket(connection));
+
+				/* Blocks if the memory budget is exhausted, which stops reading the payload from the connection. */
+				memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+
+				/* Guaranteed to work, because memory_chunk is not shared. */
+				buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+				g_assert(buf != NULL);
+
+				/* Writes are only coalesced across messages if they do not have to reach the storage immediately and the scrubber does not read them back. */
+				coalesce = (handle != NULL && jd_write_buffer_size > 0 && jd_scrub == NULL && !(type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE));
+
+				if (handle != NULL && !coalesce)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+				}
+
+				/* The scrubber's checksums of the written blocks are updated afterwards. */
+				if (jd_scrub != NULL)
+				{
+					lengths = g_new(guint64, operation_count);
+					offsets = g_new(guint64, operation_count);
+				}
+
+				/* The merged operations are collected in the buffer and handed to the backend at once. */
+				if (object != NULL && !coalesce && jd_object_backend->object.write_from_fd == NULL && jd_object_backend->object.writev != NULL)
+				{
+					extents = jd_object_extents_new(operation_count);
+				}
+
+				/* A payload that ends early cannot be told apart from the next message, so the connection is dropped. */
+				for (i = 0; connected && i < operation_count; i++)
+				{
+					guint64 length;
+					guint64 offset;
+
+					length = j_message_get_varint(message);
+					offset = j_message_get_varint(message);
+
+					if (lengths != NULL)
+					{
+						lengths[i] = length;
+						offsets[i] = offset;
+					}
+
+					if (jd_object_backend->object.write_from_fd != NULL && object != NULL && !coalesce)
+					{
+						guint64 bytes_written = 0;
+
+						/* The backend consumes the data directly from the socket, so it cannot be verified. */
+						j_backend_object_write_from_fd(jd_object_backend, object, fd, length, offset, &bytes_written);
+						verify = FALSE;
+						j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, length);
+						j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+					}
+					/* Check whether we can merge two consecutive operations. */
+					else if (merge_length > 0 && merge_offset + merge_length == offset && merge_length + length <= J_STRIPE_SIZE)
+					{
+						merge_length += length;
+					}
+					else
+					{
+						if (merge_length > 0 && !jd_object_write_merged(input, handle, object, buf, merge_length, merge_offset, coalesce, extents, verify, &checksum, statistics))
+						{
+							connected = FALSE;
+							break;
+						}
+
+						if (length > J_STRIPE_SIZE)
+						{
+							guint64 done = 0;
+
+							if (extents != NULL)
+							{
+								jd_object_write_extents(object, extents, FALSE, statistics);
+							}
+
+							/* Too large for the buffer, so the data is received and written in pieces. */
+							while (done < length)
+							{
+								guint64 piece;
+								guint64 bytes_written = 0;
+
+								piece = MIN(J_STRIPE_SIZE, length - done);
+
+								if (!jd_message_receive_payload(input, buf, piece, statistics))
+								{
+									connected = FALSE;
+									break;
+								}
+
+								if (verify)
+								{
+									checksum = j_helper_crc32c(checksum, buf, piece);
+								}
+
+								if (object != NULL)
+								{
+									jd_object_write(handle, object, buf, piece, offset + done, coalesce, &bytes_written);
+									j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+								}
+
+								done += piece;
+							}
+
+							merge_length = 0;
+						}
+						else
+						{
+							merge_length = length;
+							merge_offset = offset;
+						}
+					}
+
+					if (reply != NULL)
+					{
+						// FIXME the reply is faked (length should be bytes_written)
+						j_message_add_operation(reply, sizeof(guint64));
+						j_message_append_varint(reply, length);
+					}
+				}
+
+				if (connected && merge_length > 0 && !jd_object_write_merged(input, handle, object, buf, merge_length, merge_offset, coalesce, extents, verify, &checksum, statistics))
+				{
+					connected = FALSE;
+				}
+
+				if (extents != NULL)
+				{
+					/* Without a time window, the sync can be submitted together with the writes. */
+					gboolean sync = ((type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE) && jd_group_commit_is_direct(jd_group_commit));
+
+					if (connected)
+					{
+						synced = jd_object_write_extents(object, extents, sync, statistics);
+					}
+
+					jd_object_extents_free(extents);
+				}
+
+				if (lengths != NULL)
+				{
+					/* Aborted writes might have changed some of the blocks, but not all of their lengths are known. */
+					if (connected)
+					{
+						jd_scrub_update(jd_scrub, namespace, path, object, buf, lengths, offsets, operation_count);
+					}
+					else
+					{
+						jd_scrub_invalidate(jd_scrub, namespace, path);
+					}
+				}
+
+				if (connected && verify && checksum != payload_checksum)
+				{
+					J_CRITICAL("Checksum mismatch in data written to %s/%s", namespace, path);
+					j_statistics_add(statistics, J_STATISTICS_CHECKSUM_ERRORS, 1);
+				}
+
+				if (object != NULL && (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE) && !synced)
+				{
+					jd_group_commit_sync(jd_group_commit, &object, 1, statistics);
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+
+				if (reply != NULL && connected)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+
+				jd_memory_pool_release(jd_memory_pool, memory_chunk);
+			}
+			break;
+		case J_MESSAGE_OBJECT_DEDUP:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				JMemoryChunk* memory_chunk;
+				gchar* buf;
+				gpointer handle = NULL;
+				gpointer object = NULL;
+				gboolean coalesce;
+				gboolean written = FALSE;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+
+				memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+
+				/* Guaranteed to work, because memory_chunk is not shared. */
+				buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+				g_assert(buf != NULL);
+
+				if (jd_dedup != NULL)
+				{
+					if (type_modifier & J_MESSAGE_FLAGS_CREATE)
+					{
+						handle = jd_handle_cache_create(jd_handle_cache, namespace, path, &object);
+					}
+					else
+					{
+						handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &object);
+					}
+				}
+
+				coalesce = (handle != NULL && jd_write_buffer_size > 0 && !(type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE));
+
+				if (handle != NULL && !coalesce)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+				}
+
+				for (i = 0; i < operation_count; i++)
+				{
+					g_autofree gchar* known_namespace = NULL;
+					g_autofree gchar* known_path = NULL;
+					guint8 const* digest;
+					guint64 length;
+					guint64 offset;
+					guint64 known_length;
+					guint64 known_offset;
+					guint64 bytes_written = 0;
+
+					length = j_message_get_varint(message);
+					offset = j_message_get_varint(message);
+					digest = j_message_get_n(message, J_HELPER_SHA256_SIZE);
+
+					if (object == NULL || length > J_STRIPE_SIZE)
+					{
+						/* Nothing to copy to, or too large for the buffer. */
+					}
+					else if (jd_dedup_lookup(jd_dedup, digest, &known_namespace, &known_path, &known_length, &known_offset) && known_length == length)
+					{
+						gpointer known_handle;
+						gpointer known_object;
+						guint64 bytes_read = 0;
+
+						/* Buffered writes have to be visible before reading the block. */
+						if ((known_handle = jd_handle_cache_open(jd_handle_cache, known_namespace, known_path, &known_object)) != NULL)
+						{
+							guint8 known_digest[J_HELPER_SHA256_SIZE];
+
+							jd_handle_cache_flush(jd_handle_cache, known_handle);
+
+							if (j_backend_object_read(jd_object_backend, known_object, buf, length, known_offset, &bytes_read) && bytes_read == length)
+							{
+								j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+								j_helper_sha256(buf, length, known_digest);
+
+								/* The block might have been overwritten since it was indexed. */
+								if (memcmp(known_digest, digest, J_HELPER_SHA256_SIZE) == 0 && jd_object_write(handle, object, buf, length, offset, coalesce, &bytes_written))
+								{
+									j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, bytes_written);
+									written = TRUE;
+								}
+								else
+								{
+									bytes_written = 0;
+								}
+							}
+
+							jd_handle_cache_release(jd_handle_cache, known_handle);
+						}
+
+						if (bytes_written == 0)
+						{
+							jd_dedup_remove(jd_dedup, digest);
+						}
+					}
+					else
+					{
+						/* The client writes the block next, so later copies can be served from it. */
+						jd_dedup_insert(jd_dedup, digest, namespace, path, length, offset);
+					}
+
+					j_message_add_operation(reply, sizeof(guint64));
+					j_message_append_varint(reply, bytes_written);
+				}
+
+				if (written)
+				{
+					jd_scrub_invalidate(jd_scrub, namespace, path);
+				}
+
+				if (object != NULL && written && (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE))
+				{
+					jd_group_commit_sync(jd_group_commit, &object, 1, statistics);
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+
+				jd_memory_pool_release(jd_memory_pool, memory_chunk);
+			}
+			break;
+		case J_MESSAGE_OBJECT_APPEND:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree guint64* lengths = NULL;
+				g_autofree gchar* data = NULL;
+				gpointer handle;
+				gpointer object;
+				guint64 length = 0;
+				guint64 offset = 0;
+				guint32 payload_checksum = 0;
+				gboolean verify;
+				gboolean reserve;
+				gboolean ret = FALSE;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+				reserve = (j_message_get_1(message) != 0);
+
+				verify = j_message_get_payload_checksum(message, &payload_checksum);
+
+				lengths = g_new(guint64, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					lengths[i] = j_message_get_varint(message);
+					length += lengths[i];
+				}
+
+				/* The data of all operations is appended at once, so it has to be received completely. */
+				if (!reserve && length > 0)
+				{
+					data = g_malloc(length);
+
+					/* Incomplete data is not appended and the connection is dropped. */
+					if (!jd_message_receive_payload(input, data, length, statistics))
+					{
+						connected = FALSE;
+						break;
+					}
+
+					if (verify && j_helper_crc32c(0, data, length) != payload_checksum)
+					{
+						J_CRITICAL("Checksum mismatch in data appended to %s/%s", namespace, path);
+						j_statistics_add(statistics, J_STATISTICS_CHECKSUM_ERRORS, 1);
+					}
+				}
+
+				/* Appends create objects implicitly, like writes of distributed objects. */
+				handle = jd_handle_cache_create(jd_handle_cache, namespace, path, &object);
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+
+					ret = jd_append_write(jd_append, namespace, path, object, data, length, &offset);
+
+					if (ret && !reserve)
+					{
+						j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, length);
+					}
+
+					if (ret && jd_scrub != NULL)
+					{
+						JMemoryChunk* memory_chunk;
+
+						memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+						jd_scrub_update(jd_scrub, namespace, path, object, j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE), &length, &offset, 1);
+						jd_memory_pool_release(jd_memory_pool, memory_chunk);
+					}
+
+					if (ret && (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE))
+					{
+						jd_group_commit_sync(jd_group_commit, &object, 1, statistics);
+					}
+
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+
+				/* The operations are placed one after another in the order they were sent. */
+				for (i = 0; i < operation_count; i++)
+				{
+					guint64 bytes_written = (ret) ? lengths[i] : 0;
+
+					j_message_add_operation(reply, sizeof(guint64) + sizeof(guint64));
+					j_message_append_varint(reply, offset);
+					j_message_append_varint(reply, bytes_written);
+
+					offset += lengths[i];
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_REDUCE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autoptr(JReduce) reduce = NULL;
+				JMemoryChunk* memory_chunk;
+				gchar* buf;
+				gpointer handle;
+				gpointer object = NULL;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+
+				if ((reduce = j_reduce_new_from_message(message)) == NULL)
+				{
+					J_CRITICAL("Invalid reduction of %s/%s", namespace, path);
+					jd_message_send(reply, connection, &send_time);
+					break;
+				}
+
+				handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &object);
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+				}
+
+				memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+
+				/* Guaranteed to work, because memory_chunk is not shared. */
+				buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+				g_assert(buf != NULL);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					guint64 length;
+					guint64 offset;
+
+					length = j_message_get_varint(message);
+					offset = j_message_get_varint(message);
+
+					j_reduce_reset(reduce);
+
+					/* Only the partial results are sent back, the data never leaves the server. */
+					while (handle != NULL && length > 0)
+					{
+						guint64 bytes_read = 0;
+
+						if (!j_backend_object_read(jd_object_backend, object, buf, MIN(length, J_STRIPE_SIZE), offset, &bytes_read) || bytes_read == 0)
+						{
+							break;
+						}
+
+						j_statistics_add(statistics, J_STATISTICS_BYTES_READ, bytes_read);
+						j_reduce_update(reduce, buf, bytes_read);
+
+						length -= bytes_read;
+						offset += bytes_read;
+					}
+
+					j_message_add_operation(reply, j_reduce_get_result_size(reduce));
+					j_reduce_append_result(reduce, reply);
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+
+				jd_memory_pool_release(jd_memory_pool, memory_chunk);
+			}
+			break;
+		case J_MESSAGE_OBJECT_STATUS:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gpointer handle;
+				gpointer object;
+
+				reply = j_message_new_reply(message);
+
+				/* With handles, every operation carries its object's handle instead of a path. */
+				if (!(type_modifier & J_MESSAGE_FLAGS_HANDLE))
+				{
+					namespace = j_message_get_string(message);
+				}
+
+				for (i = 0; i < operation_count; i++)
+				{
+					gint64 modification_time = 0;
+					guint64 size = 0;
+
+					if (type_modifier & J_MESSAGE_FLAGS_HANDLE)
+					{
+						handle = jd_object_handles_get(jd_object_handles, j_message_get_8(message), &object);
+					}
+					else
+					{
+						path = j_message_get_string(message);
+						handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &object);
+					}
+
+					if (handle != NULL)
+					{
+						jd_handle_cache_flush(jd_handle_cache, handle);
+					}
+
+					if (handle != NULL && j_backend_object_status(jd_object_backend, object, &modification_time, &size))
+					{
+						j_statistics_add(statistics, J_STATISTICS_FILES_STATED, 1);
+					}
+
+					j_message_add_operation(reply, sizeof(gint64) + sizeof(guint64));
+					j_message_append_8(reply, &modification_time);
+					j_message_append_8(reply, &size);
+
+					if (handle != NULL)
+					{
+						jd_handle_cache_release(jd_handle_cache, handle);
+					}
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_OPEN:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					guint64 id;
+
+					path = j_message_get_string(message);
+
+					/* 0 signals that the object could not be opened. */
+					id = jd_object_handles_open(jd_object_handles, namespace, path);
+
+					j_message_add_operation(reply, sizeof(guint64));
+					j_message_append_8(reply, &id);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_CLOSE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				for (i = 0; i < operation_count; i++)
+				{
+					jd_object_handles_close(jd_object_handles, j_message_get_8(message));
+
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_STATISTICS:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				JStatistics* r_statistics;
+				gchar get_all;
+				guint64 value;
+
+				get_all = j_message_get_1(message);
+
+				if (get_all != 0)
+				{
+					r_statistics = j_statistics_new(FALSE);
+					jd_statistics_collect(r_statistics);
+
+					/* Corrupted messages cannot be attributed to a connection's statistics. */
+					j_statistics_add(r_statistics, J_STATISTICS_CHECKSUM_ERRORS, j_message_get_checksum_error_count());
+
+					/* Neither can compression, which happens in the object backend. */
+					if (jd_object_backend != NULL && jd_object_backend->object.compression != NULL)
+					{
+						guint64 bytes_compressed = 0;
+						guint64 bytes_stored = 0;
+
+						if (j_backend_object_compression(jd_object_backend, &bytes_compressed, &bytes_stored))
+						{
+							j_statistics_add(r_statistics, J_STATISTICS_BYTES_COMPRESSED, bytes_compressed);
+							j_statistics_add(r_statistics, J_STATISTICS_BYTES_STORED, bytes_stored);
+						}
+					}
+				}
+				else
+				{
+					r_statistics = statistics;
+				}
+
+				reply = j_message_new_reply(message);
+				j_message_add_operation(reply, 13 * sizeof(guint64));
+
+				value = j_statistics_get(r_statistics, J_STATISTICS_FILES_CREATED);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_FILES_DELETED);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_FILES_STATED);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_SYNC);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_READ);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_WRITTEN);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_RECEIVED);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_SENT);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_CHECKSUM_ERRORS);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_KV_CACHE_HITS);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_KV_CACHE_MISSES);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_COMPRESSED);
+				j_message_append_8(reply, &value);
+				value = j_statistics_get(r_statistics, J_STATISTICS_BYTES_STORED);
+				j_message_append_8(reply, &value);
+
+				if (get_all != 0)
+				{
+					/* Latencies are only tracked globally. */
+					jd_latency_append(reply);
+
+					j_message_add_operation(reply, sizeof(guint64));
+					value = jd_statistics_count_connections();
+					j_message_append_8(reply, &value);
+
+					jd_scrub_append(jd_scrub, reply);
+					jd_latency_append_traced(reply);
+
+					j_statistics_free(r_statistics);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_PING:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gboolean compression = FALSE;
+				gboolean checksum = FALSE;
+				gboolean compact = FALSE;
+				gboolean compound = FALSE;
+				gboolean length64 = FALSE;
+				gboolean dedup = FALSE;
+				gboolean rdma = FALSE;
+				gboolean shm = FALSE;
+				guint num;
+
+				num = g_atomic_int_add(&jd_thread_num, 1);
+
+				(void)num;
+				//g_print("HELLO %d\n", num);
+
+				/* Clients list their capabilities as operations. */
+				for (i = 0; i < operation_count; i++)
+				{
+					gchar const* capability;
+
+					capability = j_message_get_string(message);
+
+					if (g_strcmp0(capability, "lz4") == 0)
+					{
+						compression = j_message_compression_available();
+					}
+					else if (g_strcmp0(capability, "crc32c") == 0)
+					{
+						checksum = TRUE;
+					}
+					else if (g_strcmp0(capability, "varint") == 0)
+					{
+						compact = TRUE;
+					}
+					else if (g_strcmp0(capability, "compound") == 0)
+					{
+						compound = TRUE;
+					}
+					else if (g_strcmp0(capability, "length64") == 0)
+					{
+						length64 = TRUE;
+					}
+					else if (g_strcmp0(capability, "dedup") == 0)
+					{
+						/* Only offered if blocks are indexed. */
+						dedup = (jd_dedup != NULL);
+					}
+					else if (g_str_has_prefix(capability, "rdma:"))
+					{
+						/* The client's fabric address follows the prefix. */
+						rdma = (jd_rdma && j_transport_accept(connection, capability + 5));
+					}
+					else if (g_strcmp0(capability, "shm") == 0)
+					{
+						/* Shared memory can only be passed by local clients. */
+						shm = G_IS_UNIX_CONNECTION(connection);
+					}
+				}
+
+				reply = j_message_new_reply(message);
+
+				if (jd_object_backend != NULL)
+				{
+					j_message_add_operation(reply, 7);
+					j_message_append_n(reply, "object", 7);
+				}
+
+				if (jd_kv_backend != NULL)
+				{
+					j_message_add_operation(reply, 3);
+					j_message_append_n(reply, "kv", 3);
+				}
+
+				if (compression)
+				{
+					j_message_add_operation(reply, 4);
+					j_message_append_n(reply, "lz4", 4);
+				}
+
+				if (checksum)
+				{
+					j_message_add_operation(reply, 7);
+					j_message_append_n(reply, "crc32c", 7);
+				}
+
+				/* Compact messages are marked as such, so nothing has to be remembered. */
+				if (compact)
+				{
+					j_message_add_operation(reply, 7);
+					j_message_append_n(reply, "varint", 7);
+				}
+
+				if (compound)
+				{
+					j_message_add_operation(reply, 9);
+					j_message_append_n(reply, "compound", 9);
+				}
+
+				if (length64)
+				{
+					j_message_add_operation(reply, 9);
+					j_message_append_n(reply, "length64", 9);
+				}
+
+				if (dedup)
+				{
+					j_message_add_operation(reply, 6);
+					j_message_append_n(reply, "dedup", 6);
+				}
+
+				if (rdma)
+				{
+					j_message_add_operation(reply, 5);
+					j_message_append_n(reply, "rdma", 5);
+				}
+
+				if (shm)
+				{
+					j_message_add_operation(reply, 4);
+					j_message_append_n(reply, "shm", 4);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+
+				/* The client passes its shared memory once it has received the reply. */
+				if (shm)
+				{
+					j_transport_shm_accept(connection);
+				}
+
+				/* Only compress messages sent after the client knows about it. */
+				j_message_set_compression(connection, compression);
+				j_message_set_checksum(connection, checksum);
+				j_message_set_length64(connection, length64);
+			}
+			break;
+		case J_MESSAGE_ECHO:
+			{
+				JMemoryChunk* memory_chunk;
+				gchar* buf;
+
+				/* Echoes only exercise the network, so they do not need a backend. */
+				memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+				buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+				g_assert(buf != NULL);
+
+				for (i = 0; connected && i < operation_count; i++)
+				{
+					guint64 length;
+					guint64 done = 0;
+
+					length = j_message_get_varint(message);
+
+					/*
+					 * The payload is echoed in pieces, each in a reply of its own, so the client has to count bytes instead of operations.
+					 * Echoes are sent while the client might still be sending, so clients should only send a single operation of at most J_STRIPE_SIZE bytes per message.
+					 */
+					do
+					{
+						g_autoptr(JMessage) reply = NULL;
+						guint64 piece;
+
+						piece = MIN(J_STRIPE_SIZE, length - done);
+
+						if (piece > 0 && !jd_message_receive_payload(input, buf, piece, statistics))
+						{
+							connected = FALSE;
+							break;
+						}
+
+						reply = j_message_new_reply(message);
+						j_message_add_operation(reply, sizeof(guint64));
+						j_message_append_varint(reply, piece);
+
+						if (piece > 0)
+						{
+							j_message_add_send(reply, buf, piece);
+						}
+
+						jd_message_send(reply, connection, &send_time);
+						j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, piece);
+
+						done += piece;
+					}
+					while (done < length);
+				}
+
+				jd_memory_pool_release(jd_memory_pool, memory_chunk);
+			}
+			break;
+		case J_MESSAGE_KV_PUT:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree gchar const** keys = NULL;
+				g_autofree gconstpointer* datas = NULL;
+				g_autofree guint32* lens = NULL;
+				g_autofree guint64* generations = NULL;
+				gboolean executed;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				namespace = j_message_get_string(message);
+
+				keys = g_new(gchar const*, operation_count);
+				datas = g_new(gconstpointer, operation_count);
+				lens = g_new(guint32, operation_count);
+				generations = g_new(guint64, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					key = j_message_get_string(message);
+					lens[i] = j_message_get_varint(message);
+					datas[i] = j_message_get_n(message, lens[i]);
+					keys[i] = key;
+
+					if (jd_kv_cache != NULL)
+					{
+						generations[i] = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
+				}
+
+				/* The keys and values point into the message, which is still valid. */
+				executed = jd_kv_commit_write(jd_kv_commit, namespace, safety, keys, datas, lens, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					if (jd_kv_cache != NULL)
+					{
+						bson_t value[1];
+
+						bson_init_static(value, datas[i], lens[i]);
+						jd_kv_cache_end_write(jd_kv_cache, namespace, keys[i], (executed) ? value : NULL, generations[i]);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, keys[i]);
+					}
+
+					if (executed)
+					{
+						jd_kv_changed(namespace, keys[i], FALSE);
+					}
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_KV_DELETE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree gchar const** keys = NULL;
+				g_autofree guint64* generations = NULL;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				namespace = j_message_get_string(message);
+
+				keys = g_new(gchar const*, operation_count);
+				generations = g_new(guint64, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					key = j_message_get_string(message);
+					keys[i] = key;
+
+					if (jd_kv_cache != NULL)
+					{
+						generations[i] = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
+					}
+
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
+				}
+
+				jd_kv_commit_write(jd_kv_commit, namespace, safety, keys, NULL, NULL, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					if (jd_kv_cache != NULL)
+					{
+						jd_kv_cache_end_write(jd_kv_cache, namespace, keys[i], NULL, generations[i]);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_delete(jd_kv_filter, namespace);
+					}
+
+					jd_kv_changed(namespace, keys[i], TRUE);
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_KV_DELETE_BY_PREFIX:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					gchar const* prefix;
+					gchar success;
+
+					prefix = j_message_get_string(message);
+					success = jd_kv_delete_by_prefix(namespace, prefix, safety);
+
+					j_message_add_operation(reply, 1);
+					j_message_append_1(reply, &success);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_LOCK_ACQUIRE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree gchar* resource = NULL;
+				g_autofree guint64* offsets = NULL;
+				g_autofree guint64* lengths = NULL;
+				JLockMode mode;
+				guint64 owner;
+				gboolean wait;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+				mode = (j_message_get_1(message) != 0) ? J_LOCK_MODE_EXCLUSIVE : J_LOCK_MODE_SHARED;
+				wait = (j_message_get_1(message) != 0);
+
+				resource = g_strconcat(namespace, "/", path, NULL);
+				offsets = g_new(guint64, operation_count);
+				lengths = g_new(guint64, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					offsets[i] = j_message_get_8(message);
+					lengths[i] = j_message_get_8(message);
+				}
+
+				/* Releases wake up the waiting thread, which replies as soon as the ranges have been acquired. */
+				owner = j_lock_manager_acquire(jd_lock_manager, resource, mode, offsets, lengths, operation_count, wait ? JD_LOCK_WAIT : 0);
+
+				j_message_add_operation(reply, sizeof(guint64));
+				j_message_append_8(reply, &owner);
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_LOCK_RELEASE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree gchar* resource = NULL;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+
+				resource = g_strconcat(namespace, "/", path, NULL);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					guint64 owner;
+					gchar released;
+
+					owner = j_message_get_8(message);
+					released = j_lock_manager_release(jd_lock_manager, resource, owner);
+
+					j_message_add_operation(reply, 1);
+					j_message_append_1(reply, &released);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_LOCK_REVOKE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree guint64* owners = NULL;
+				guint contended;
+
+				reply = j_message_new_reply(message);
+				owners = g_new(guint64, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					owners[i] = j_message_get_8(message);
+				}
+
+				/* The reply is the revocation callback for the client's cached leases. */
+				contended = j_lock_manager_get_contended(jd_lock_manager, owners, operation_count, JD_LOCK_WAIT);
+
+				for (i = 0; i < contended; i++)
+				{
+					j_message_add_operation(reply, sizeof(guint64));
+					j_message_append_8(reply, &(owners[i]));
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_GET:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				reply = j_message_new_reply(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					bson_t value[1];
+					gboolean found;
+					guint64 generation = 0;
+
+					/* Every operation carries its namespace. */
+					namespace = j_message_get_string(message);
+					key = j_message_get_string(message);
+
+					if (jd_kv_cache != NULL && jd_kv_cache_get(jd_kv_cache, namespace, key, value, &generation))
+					{
+						j_statistics_add(statistics, J_STATISTICS_KV_CACHE_HITS, 1);
+						found = TRUE;
+					}
+					else if (jd_kv_filter != NULL && !jd_kv_filter_contains(jd_kv_filter, namespace, key))
+					{
+						/* The key definitely does not exist. */
+						found = FALSE;
+					}
+					else
+					{
+						found = j_backend_kv_get(jd_kv_backend, namespace, key, value);
+
+						if (jd_kv_cache != NULL)
+						{
+							j_statistics_add(statistics, J_STATISTICS_KV_CACHE_MISSES, 1);
+
+							if (found)
+							{
+								jd_kv_cache_fill(jd_kv_cache, namespace, key, value, generation);
+							}
+						}
+					}
+
+					if (found)
+					{
+						j_message_add_operation(reply, sizeof(guint64) + value->len);
+						j_message_append_varint(reply, value->len);
+						j_message_append_n(reply, bson_get_data(value), value->len);
+
+						bson_destroy(value);
+					}
+					else
+					{
+						j_message_add_operation(reply, sizeof(guint64));
+						j_message_append_varint(reply, 0);
+					}
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_GET_ALL:
+			{
+				gpointer iterator = NULL;
+
+				namespace = j_message_get_string(message);
+
+				if (!j_backend_kv_get_all(jd_kv_backend, namespace, &iterator))
+				{
+					iterator = NULL;
+				}
+
+				jd_send_kv_iterator(message, connection, iterator, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_GET_BY_PREFIX:
+			{
+				g_autofree gchar const** fields = NULL;
+				gchar const* delimiter;
+				gchar const* prefix;
+				gchar const* start_after;
+				bson_t filter[1];
+				guint32 filter_len;
+				guint32 fields_len;
+				guint32 limit;
+
+				namespace = j_message_get_string(message);
+				prefix = j_message_get_string(message);
+				/* An empty key starts at the beginning of the prefix. */
+				start_after = j_message_get_string(message);
+				limit = j_message_get_varint(message);
+
+				/* An empty filter matches all values. */
+				filter_len = j_message_get_varint(message);
+
+				if (filter_len > 0)
+				{
+					bson_init_static(filter, j_message_get_n(message, filter_len), filter_len);
+				}
+
+				/* Without fields, the complete values are sent. */
+				fields_len = j_message_get_varint(message);
+
+				if (fields_len > 0)
+				{
+					fields = g_new(gchar const*, fields_len + 1);
+
+					for (i = 0; i < fields_len; i++)
+					{
+						fields[i] = j_message_get_string(message);
+					}
+
+					fields[fields_len] = NULL;
+				}
+
+				/* An empty delimiter returns all keys with the prefix. */
+				delimiter = j_message_get_string(message);
+
+				jd_send_kv_query(message, connection, namespace, prefix, (delimiter[0] != '\0') ? delimiter : NULL, (start_after[0] != '\0') ? start_after : NULL, limit, (filter_len > 0) ? filter : NULL, fields, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_CAPACITY:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				guint64 free_bytes = 0;
+				guint64 size_bytes = 0;
+				guint64 throughput;
+
+				jd_capacity_get(&free_bytes, &size_bytes, &throughput);
+
+				reply = j_message_new_reply(message);
+				j_message_add_operation(reply, 3 * sizeof(guint64));
+				j_message_append_8(reply, &free_bytes);
+				j_message_append_8(reply, &size_bytes);
+				j_message_append_8(reply, &throughput);
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_TRUNCATE:
+		case J_MESSAGE_OBJECT_ALLOCATE:
+		case J_MESSAGE_OBJECT_PUNCH_HOLE:
+		case J_MESSAGE_OBJECT_SYNC:
+		case J_MESSAGE_OBJECT_PREFETCH:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gpointer handle;
+				gpointer object;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+
+				/* Distributed objects ask for their stripes to be created, because servers that have not been written to do not have one yet. */
+				if ((type_modifier & J_MESSAGE_FLAGS_CREATE) && message_type != J_MESSAGE_OBJECT_SYNC && message_type != J_MESSAGE_OBJECT_PREFETCH)
+				{
+					handle = jd_handle_cache_create(jd_handle_cache, namespace, path, &object);
+				}
+				else
+				{
+					handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &object);
+				}
+
+				/* Pending coalesced writes have to reach the object before its extents are changed. */
+				if (handle != NULL)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+				}
+
+				for (i = 0; i < operation_count; i++)
+				{
+					gchar success = 0;
+					guint64 length = 0;
+					guint64 offset = 0;
+
+					if (message_type != J_MESSAGE_OBJECT_SYNC)
+					{
+						length = j_message_get_varint(message);
+					}
+
+					if (message_type != J_MESSAGE_OBJECT_TRUNCATE && message_type != J_MESSAGE_OBJECT_SYNC)
+					{
+						offset = j_message_get_varint(message);
+					}
+
+					if (handle != NULL)
+					{
+						switch (message_type)
+						{
+							case J_MESSAGE_OBJECT_TRUNCATE:
+								success = jd_object_backend->object.truncate != NULL && j_backend_object_truncate(jd_object_backend, object, length);
+								break;
+							case J_MESSAGE_OBJECT_ALLOCATE:
+								success = jd_object_backend->object.allocate != NULL && j_backend_object_allocate(jd_object_backend, object, length, offset);
+								break;
+							case J_MESSAGE_OBJECT_PUNCH_HOLE:
+								success = jd_object_backend->object.punch_hole != NULL && j_backend_object_punch_hole(jd_object_backend, object, length, offset);
+								break;
+							case J_MESSAGE_OBJECT_SYNC:
+								/* The handle cache's pending writes have already been flushed above. */
+								success = jd_group_commit_sync(jd_group_commit, &object, 1, statistics);
+								break;
+							case J_MESSAGE_OBJECT_PREFETCH:
+								success = j_backend_object_prefetch(jd_object_backend, object, length, offset);
+								break;
+							default:
+								g_warn_if_reached();
+								break;
+						}
+					}
+
+					j_message_add_operation(reply, 1);
+					j_message_append_1(reply, &success);
+				}
+
+				if (message_type != J_MESSAGE_OBJECT_SYNC && message_type != J_MESSAGE_OBJECT_PREFETCH)
+				{
+					jd_scrub_invalidate(jd_scrub, namespace, path);
+				}
+
+				if (object != NULL && message_type != J_MESSAGE_OBJECT_SYNC && message_type != J_MESSAGE_OBJECT_PREFETCH && (type_modifier & J_MESSAGE_FLAGS_SAFETY_STORAGE))
+				{
+					jd_group_commit_sync(jd_group_commit, &object, 1, statistics);
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+
+				/* Prefetches are only hints, so clients only wait for them if they have asked for it. */
+				if (message_type != J_MESSAGE_OBJECT_PREFETCH || (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK))
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_OBJECT_EXTENTS:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gpointer handle;
+				gpointer object;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+
+				handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &object);
+
+				/* Pending coalesced writes might fill holes. */
+				if (handle != NULL)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+				}
+
+				for (i = 0; i < operation_count; i++)
+				{
+					g_autofree guint64* lengths = NULL;
+					g_autofree guint64* offsets = NULL;
+					gchar success = 0;
+					guint64 length;
+					guint64 offset;
+					guint32 max_count;
+					guint count = 0;
+
+					length = j_message_get_varint(message);
+					offset = j_message_get_varint(message);
+					max_count = j_message_get_4(message);
+
+					lengths = g_new(guint64, max_count);
+					offsets = g_new(guint64, max_count);
+
+					if (handle != NULL)
+					{
+						success = j_backend_object_extents(jd_object_backend, object, length, offset, lengths, offsets, max_count, &count);
+					}
+
+					if (!success)
+					{
+						count = 0;
+					}
+
+					j_message_add_operation(reply, 1 + sizeof(guint32) + count * 2 * sizeof(guint64));
+					j_message_append_1(reply, &success);
+					j_message_append_4(reply, &count);
+
+					for (guint j = 0; j < count; j++)
+					{
+						j_message_append_varint(reply, lengths[j]);
+						j_message_append_varint(reply, offsets[j]);
+					}
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_OBJECT_COPY:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				JMemoryChunk* memory_chunk = NULL;
+				gchar* buf = NULL;
+				gpointer handle;
+				gpointer object;
+
+				reply = j_message_new_reply(message);
+
+				namespace = j_message_get_string(message);
+				path = j_message_get_string(message);
+
+				handle = jd_handle_cache_open(jd_handle_cache, namespace, path, &object);
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_flush(jd_handle_cache, handle);
+
+					memory_chunk = jd_memory_pool_acquire(jd_memory_pool);
+					buf = j_memory_chunk_get(memory_chunk, J_STRIPE_SIZE);
+					g_assert(buf != NULL);
+				}
+
+				for (i = 0; i < operation_count; i++)
+				{
+					gchar const* to_namespace;
+					gchar const* to_path;
+					gchar local;
+					guint32 index;
+					gchar success = 0;
+					guint64 bytes_copied = 0;
+
+					local = j_message_get_1(message);
+					index = j_message_get_4(message);
+					to_namespace = j_message_get_string(message);
+					to_path = j_message_get_string(message);
+
+					if (handle == NULL)
+					{
+						/* Nothing to copy. */
+					}
+					else if (local)
+					{
+						/* Copying an object onto itself would truncate it. */
+						if (g_strcmp0(namespace, to_namespace) != 0 || g_strcmp0(path, to_path) != 0)
+						{
+							success = jd_object_copy_local(object, to_namespace, to_path, buf, &bytes_copied, statistics);
+							jd_scrub_invalidate(jd_scrub, to_namespace, to_path);
+						}
+					}
+					else
+					{
+						success = jd_object_copy_remote(object, index, to_namespace, to_path, buf, &bytes_copied, statistics);
+					}
+
+					j_message_add_operation(reply, 1 + sizeof(guint64));
+					j_message_append_1(reply, &success);
+					j_message_append_8(reply, &bytes_copied);
+				}
+
+				if (handle != NULL)
+				{
+					jd_handle_cache_release(jd_handle_cache, handle);
+					jd_memory_pool_release(jd_memory_pool, memory_chunk);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_COMPARE_AND_SWAP:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gboolean indexed;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+				indexed = jd_kv_index_is_used(jd_kv_index, namespace);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					bson_t old[1];
+					bson_t value[1];
+					gconstpointer data;
+					gboolean found_old = FALSE;
+					gchar swapped;
+					guint32 len;
+					guint64 expected;
+					guint64 generation = 0;
+					guint64 version = 0;
+
+					key = j_message_get_string(message);
+					expected = j_message_get_8(message);
+					len = j_message_get_varint(message);
+					data = j_message_get_n(message, len);
+					bson_init_static(value, data, len);
+
+					if (indexed)
+					{
+						found_old = j_backend_kv_get(jd_kv_backend, namespace, key, old);
+					}
+
+					/* The backend may store the value differently, so it has to be read again. */
+					if (jd_kv_cache != NULL)
+					{
+						generation = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					swapped = j_backend_kv_compare_and_swap(jd_kv_backend, namespace, key, expected, value, &version);
+
+					if (jd_kv_cache != NULL)
+					{
+						jd_kv_cache_end_write(jd_kv_cache, namespace, key, NULL, generation);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					if (swapped)
+					{
+						jd_kv_changed(namespace, key, FALSE);
+					}
+
+					if (indexed)
+					{
+						if (swapped)
+						{
+							jd_kv_index_update(jd_kv_index, namespace, key, (found_old) ? old : NULL);
+						}
+
+						if (found_old)
+						{
+							bson_destroy(old);
+						}
+					}
+
+					j_message_add_operation(reply, 1 + sizeof(guint64));
+					j_message_append_1(reply, &swapped);
+					j_message_append_8(reply, &version);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_INCREMENT:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gboolean indexed;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+				indexed = jd_kv_index_is_used(jd_kv_index, namespace);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					bson_t old[1];
+					gchar const* field;
+					gboolean found_old = FALSE;
+					gchar success;
+					gint64 delta;
+					gint64 result = 0;
+					guint64 generation = 0;
+
+					key = j_message_get_string(message);
+					field = j_message_get_string(message);
+					delta = j_message_get_8(message);
+
+					if (indexed)
+					{
+						found_old = j_backend_kv_get(jd_kv_backend, namespace, key, old);
+					}
+
+					if (jd_kv_cache != NULL)
+					{
+						generation = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					success = j_backend_kv_increment(jd_kv_backend, namespace, key, field, delta, &result);
+
+					if (jd_kv_cache != NULL)
+					{
+						jd_kv_cache_end_write(jd_kv_cache, namespace, key, NULL, generation);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					if (success)
+					{
+						jd_kv_changed(namespace, key, FALSE);
+					}
+
+					if (indexed)
+					{
+						if (success)
+						{
+							jd_kv_index_update(jd_kv_index, namespace, key, (found_old) ? old : NULL);
+						}
+
+						if (found_old)
+						{
+							bson_destroy(old);
+						}
+					}
+
+					j_message_add_operation(reply, 1 + sizeof(gint64));
+					j_message_append_1(reply, &success);
+					j_message_append_8(reply, &result);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_MAX_MERGE:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gboolean indexed;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
+					reply = j_message_new_reply(message);
+				}
+
+				namespace = j_message_get_string(message);
+				indexed = jd_kv_index_is_used(jd_kv_index, namespace);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					bson_t maxima[1];
+					bson_t old[1];
+					gconstpointer data;
+					gboolean found_old = FALSE;
+					gboolean merged;
+					guint32 len;
+					guint64 generation = 0;
+
+					key = j_message_get_string(message);
+					len = j_message_get_varint(message);
+					data = j_message_get_n(message, len);
+					bson_init_static(maxima, data, len);
+
+					if (indexed)
+					{
+						found_old = j_backend_kv_get(jd_kv_backend, namespace, key, old);
+					}
+
+					if (jd_kv_cache != NULL)
+					{
+						generation = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					merged = j_backend_kv_max_merge(jd_kv_backend, namespace, key, maxima);
+
+					if (jd_kv_cache != NULL)
+					{
+						jd_kv_cache_end_write(jd_kv_cache, namespace, key, NULL, generation);
+					}
+
+					if (jd_kv_filter != NULL)
+					{
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
+					}
+
+					if (merged && indexed)
+					{
+						jd_kv_index_update(jd_kv_index, namespace, key, (found_old) ? old : NULL);
+					}
+
+					if (merged)
+					{
+						jd_kv_changed(namespace, key, FALSE);
+					}
+
+					if (found_old)
+					{
+						bson_destroy(old);
+					}
+
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_KV_WATCH:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				gchar const* prefix;
+				gboolean values;
+				gchar success;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+				prefix = j_message_get_string(message);
+				values = (j_message_get_1(message) != 0);
+
+				/* Every watch sends over the connection on its own, so only a single one is allowed per connection. */
+				success = (jd_kv_watch != NULL && operation_count == 1);
+
+				j_message_add_operation(reply, 1);
+				j_message_append_1(reply, &success);
+
+				jd_message_send(reply, connection, &send_time);
+
+				/* Notifications must only be sent after the reply. */
+				if (success)
+				{
+					jd_kv_watch_add(jd_kv_watch, connection, namespace, prefix, values);
+				}
+			}
+			break;
+		case J_MESSAGE_KV_PUT_RAW:
+			{
+				g_autoptr(JMessage) reply = NULL;
+				g_autofree gchar const** keys = NULL;
+				g_autofree gconstpointer* datas = NULL;
+				g_autofree guint32* lens = NULL;
+				g_autofree guint64* generations = NULL;
+				gboolean executed;
+
+				if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+				{
 					reply = j_message_new_reply(message);
+				}
+
+				namespace = j_message_get_string(message);
 
-					if (jd_object_backend != NULL)
+				keys = g_new(gchar const*, operation_count);
+				datas = g_new(gconstpointer, operation_count);
+				lens = g_new(guint32, operation_count);
+				generations = g_new(guint64, operation_count);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					key = j_message_get_string(message);
+					lens[i] = j_message_get_varint(message);
+					datas[i] = j_message_get_n(message, lens[i]);
+					keys[i] = key;
+
+					if (jd_kv_cache != NULL)
 					{
-						j_message_add_operation(reply, 7);
-						j_message_append_n(reply, "object", 7);
+						generations[i] = jd_kv_cache_begin_write(jd_kv_cache, namespace, key);
 					}
 
-					if (jd_kv_backend != NULL)
+					if (jd_kv_filter != NULL)
 					{
-						j_message_add_operation(reply, 3);
-						j_message_append_n(reply, "kv", 3);
+						jd_kv_filter_add(jd_kv_filter, namespace, key);
 					}
 
-					j_message_send(reply, connection);
+					if (reply != NULL)
+					{
+						j_message_add_operation(reply, 0);
+					}
 				}
-				break;
-			case J_MESSAGE_KV_PUT:
+
+				executed = jd_kv_commit_write_raw(jd_kv_commit, namespace, safety, keys, datas, lens, operation_count);
+
+				for (i = 0; i < operation_count; i++)
 				{
-					g_autoptr(JMessage) reply = NULL;
-					gpointer batch;
+					/* The cache only holds BSON documents, so raw values only invalidate it. */
+					if (jd_kv_cache != NULL)
+					{
+						jd_kv_cache_end_write(jd_kv_cache, namespace, keys[i], NULL, generations[i]);
+					}
 
-					if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
+					if (executed)
 					{
-						reply = j_message_new_reply(message);
+						jd_kv_changed(namespace, keys[i], FALSE);
 					}
+				}
+
+				if (reply != NULL)
+				{
+					jd_message_send(reply, connection, &send_time);
+				}
+			}
+			break;
+		case J_MESSAGE_KV_GET_RAW:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				reply = j_message_new_reply(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					g_autoptr(GBytes) value = NULL;
+					gboolean found;
 
+					/* Every operation carries its namespace. */
 					namespace = j_message_get_string(message);
-					j_backend_kv_batch_start(jd_kv_backend, namespace, safety, &batch);
+					key = j_message_get_string(message);
 
-					for (i = 0; i < operation_count; i++)
+					if (jd_kv_filter != NULL && !jd_kv_filter_contains(jd_kv_filter, namespace, key))
+					{
+						/* The key definitely does not exist. */
+						found = FALSE;
+					}
+					else
+					{
+						found = j_backend_kv_get_raw(jd_kv_backend, namespace, key, &value);
+					}
+
+					/* Raw values can be empty, so whether the key exists is sent separately. */
+					if (found)
 					{
-						bson_t value[1];
 						gconstpointer data;
-						guint32 len;
+						gsize len;
+						gchar exists = 1;
+
+						data = g_bytes_get_data(value, &len);
+
+						j_message_add_operation(reply, 1 + sizeof(guint64) + len);
+						j_message_append_1(reply, &exists);
+						j_message_append_varint(reply, len);
+						j_message_append_n(reply, data, len);
+					}
+					else
+					{
+						gchar exists = 0;
+
+						j_message_add_operation(reply, 1);
+						j_message_append_1(reply, &exists);
+					}
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_CREATE_INDEX:
+			{
+				g_autoptr(JMessage) reply = NULL;
+
+				reply = j_message_new_reply(message);
+				namespace = j_message_get_string(message);
+
+				for (i = 0; i < operation_count; i++)
+				{
+					gchar const* field;
+					gchar success;
+
+					field = j_message_get_string(message);
+					success = jd_kv_index_create(jd_kv_index, namespace, field);
+
+					j_message_add_operation(reply, 1);
+					j_message_append_1(reply, &success);
+				}
+
+				jd_message_send(reply, connection, &send_time);
+			}
+			break;
+		case J_MESSAGE_KV_GET_BY_INDEX:
+			{
+				g_autofree gchar const** fields = NULL;
+				gchar const* field;
+				bson_t range[1];
+				guint32 range_len;
+				guint32 fields_len;
+				guint32 limit;
+
+				namespace = j_message_get_string(message);
+				field = j_message_get_string(message);
+				range_len = j_message_get_varint(message);
+				bson_init_static(range, j_message_get_n(message, range_len), range_len);
+				limit = j_message_get_varint(message);
+
+				fields_len = j_message_get_varint(message);
+
+				if (fields_len > 0)
+				{
+					fields = g_new(gchar const*, fields_len + 1);
+
+					for (i = 0; i < fields_len; i++)
+					{
+						fields[i] = j_message_get_string(message);
+					}
+
+					fields[fields_len] = NULL;
+				}
+
+				jd_send_kv_index(message, connection, namespace, field, range, limit, fields, &send_time);
+			}
+			break;
+		case J_MESSAGE_COMPOUND:
+			/**
+			 * The messages are handled in order and send their own replies.
+			 * Their additional data follows the compound message in the same order, so they can read it from the connection as usual.
+			 **/
+			for (i = 0; i < operation_count; i++)
+			{
+				g_autoptr(JMessage) embedded = NULL;
+
+				embedded = j_message_get_message(message);
+
+				if (!jd_handle_message(embedded, connection, statistics, received))
+				{
+					connected = FALSE;
+					break;
+				}
+			}
+			break;
+		default:
+			g_warn_if_reached();
+			break;
+	}
+
+	J_PROBE2(server_dispatch_end, message_type, j_message_get_id(message));
+
+	jd_latency_record(message_type, JD_LATENCY_QUEUE, start - received);
+	jd_latency_record(message_type, JD_LATENCY_BACKEND, g_get_monotonic_time() - start - send_time);
+	jd_latency_record(message_type, JD_LATENCY_SEND, send_time);
+
+	if (trace_id != 0)
+	{
+		jd_latency_record_traced(trace_id, message_type, start - received, g_get_monotonic_time() - start - send_time, send_time);
+	}
+
+	if (scheduled)
+	{
+		jd_scheduler_release(jd_scheduler);
+	}
+
+	j_trace_leave(G_STRFUNC);
+
+	return connected;
+}
+
+static
+void
+jd_statistics_add_all (JStatistics* to, JStatistics* from)
+{
+	for (JStatisticsType type = J_STATISTICS_FILES_CREATED; type <= J_STATISTICS_BYTES_STORED; type++)
+	{
+		j_statistics_add(to, type, j_statistics_get(from, type));
+	}
+}
+
+/**
+ * Makes a connection's statistics visible to jd_statistics_collect().
+ */
+void
+jd_statistics_register (JStatistics* statistics)
+{
+	G_LOCK(jd_statistics);
+	g_hash_table_add(jd_statistics_live, statistics);
+	G_UNLOCK(jd_statistics);
+}
+
+/**
+ * Merges a closed connection's statistics into the global ones.
+ */
+void
+jd_statistics_merge (JStatistics* statistics)
+{
+	G_LOCK(jd_statistics);
 
-						key = j_message_get_string(message);
-						len = j_message_get_4(message);
-						data = j_message_get_n(message, len);
-						bson_init_static(value, data, len);
+	g_hash_table_remove(jd_statistics_live, statistics);
+	jd_statistics_add_all(jd_statistics, statistics);
 
-						j_backend_kv_put(jd_kv_backend, batch, key, value);
+	G_UNLOCK(jd_statistics);
+}
 
-						if (reply != NULL)
-						{
-							j_message_add_operation(reply, 0);
-						}
-					}
+/**
+ * Sums up the statistics of all closed and open connections.
+ * The values of open connections are read while they might be modified, so they can be slightly out of date.
+ */
+static
+void
+jd_statistics_collect (JStatistics* result)
+{
+	GHashTableIter iter;
+	gpointer key;
 
-					j_backend_kv_batch_execute(jd_kv_backend, batch);
+	G_LOCK(jd_statistics);
 
-					if (reply != NULL)
-					{
-						j_message_send(reply, connection);
-					}
-				}
-				break;
-			case J_MESSAGE_KV_DELETE:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					gpointer batch;
+	jd_statistics_add_all(result, jd_statistics);
 
-					if (type_modifier & J_MESSAGE_FLAGS_SAFETY_NETWORK)
-					{
-						reply = j_message_new_reply(message);
-					}
+	g_hash_table_iter_init(&iter, jd_statistics_live);
 
-					namespace = j_message_get_string(message);
-					j_backend_kv_batch_start(jd_kv_backend, namespace, safety, &batch);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		jd_statistics_add_all(result, key);
+	}
 
-					for (i = 0; i < operation_count; i++)
-					{
-						key = j_message_get_string(message);
+	G_UNLOCK(jd_statistics);
+}
 
-						j_backend_kv_delete(jd_kv_backend, batch, key);
+/**
+ * Returns the number of open connections.
+ */
+static
+guint64
+jd_statistics_count_connections (void)
+{
+	guint64 count;
 
-						if (reply != NULL)
-						{
-							j_message_add_operation(reply, 0);
-						}
-					}
+	G_LOCK(jd_statistics);
+	count = g_hash_table_size(jd_statistics_live);
+	G_UNLOCK(jd_statistics);
 
-					j_backend_kv_batch_execute(jd_kv_backend, batch);
+	return count;
+}
 
-					if (reply != NULL)
-					{
-						j_message_send(reply, connection);
-					}
-				}
-				break;
-			case J_MESSAGE_KV_GET:
-				{
-					g_autoptr(JMessage) reply = NULL;
+/**
+ * Determines the object backend's capacity and the throughput since the last call.
+ *
+ * \param free_bytes The free space in bytes, 0 if unknown.
+ * \param size_bytes The total space in bytes, 0 if unknown.
+ * \param throughput The bytes read and written per second since the last call.
+ */
+static
+void
+jd_capacity_get (guint64* free_bytes, guint64* size_bytes, guint64* throughput)
+{
+	JStatistics* r_statistics;
+	guint64 bytes;
+	gint64 now;
 
-					reply = j_message_new_reply(message);
-					namespace = j_message_get_string(message);
+	*free_bytes = 0;
+	*size_bytes = 0;
+	*throughput = 0;
 
-					for (i = 0; i < operation_count; i++)
-					{
-						bson_t value[1];
+	if (jd_object_path != NULL && jd_object_path[0] != '\0')
+	{
+		g_autoptr(GFile) file = NULL;
+		g_autoptr(GFileInfo) info = NULL;
 
-						key = j_message_get_string(message);
+		file = g_file_new_for_path(jd_object_path);
+		info = g_file_query_filesystem_info(file, G_FILE_ATTRIBUTE_FILESYSTEM_FREE "," G_FILE_ATTRIBUTE_FILESYSTEM_SIZE, NULL, NULL);
 
-						if (j_backend_kv_get(jd_kv_backend, namespace, key, value))
-						{
-							j_message_add_operation(reply, 4 + value->len);
-							j_message_append_4(reply, &(value->len));
-							j_message_append_n(reply, bson_get_data(value), value->len);
+		if (info != NULL)
+		{
+			*free_bytes = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
+			*size_bytes = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
+		}
+	}
 
-							bson_destroy(value);
-						}
-						else
-						{
-							guint32 zero = 0;
+	r_statistics = j_statistics_new(FALSE);
+	jd_statistics_collect(r_statistics);
+	bytes = j_statistics_get(r_statistics, J_STATISTICS_BYTES_READ) + j_statistics_get(r_statistics, J_STATISTICS_BYTES_WRITTEN);
+	j_statistics_free(r_statistics);
 
-							j_message_add_operation(reply, 4);
-							j_message_append_4(reply, &zero);
-						}
-					}
+	now = g_get_monotonic_time();
 
-					j_message_send(reply, connection);
-				}
-				break;
-			case J_MESSAGE_KV_GET_ALL:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					bson_t value[1];
-					gpointer iterator;
-					guint32 zero = 0;
+	G_LOCK(jd_capacity);
 
-					reply = j_message_new_reply(message);
-					namespace = j_message_get_string(message);
+	if (jd_capacity_time > 0 && now > jd_capacity_time && bytes >= jd_capacity_bytes)
+	{
+		*throughput = (bytes - jd_capacity_bytes) * G_USEC_PER_SEC / (now - jd_capacity_time);
+	}
 
-					j_backend_kv_get_all(jd_kv_backend, namespace, &iterator);
+	jd_capacity_bytes = bytes;
+	jd_capacity_time = now;
 
-					while (j_backend_kv_iterate(jd_kv_backend, iterator, value))
-					{
-						j_message_add_operation(reply, 4 + value->len);
-						j_message_append_4(reply, &(value->len));
-						j_message_append_n(reply, bson_get_data(value), value->len);
-						bson_destroy(value);
-					}
+	G_UNLOCK(jd_capacity);
+}
 
-					j_message_add_operation(reply, 4);
-					j_message_append_4(reply, &zero);
+static
+gboolean
+jd_on_run (GThreadedSocketService* service, GSocketConnection* connection, GObject* source_object, gpointer user_data)
+{
+	g_autoptr(JMessage) message = NULL;
+	JStatistics* statistics;
 
-					j_message_send(reply, connection);
-				}
-				break;
-			case J_MESSAGE_KV_GET_BY_PREFIX:
-				{
-					g_autoptr(JMessage) reply = NULL;
-					bson_t value[1];
-					gchar const* prefix;
-					gpointer iterator;
-					guint32 zero = 0;
+	(void)service;
+	(void)source_object;
+	(void)user_data;
 
-					reply = j_message_new_reply(message);
-					namespace = j_message_get_string(message);
-					prefix = j_message_get_string(message);
+	j_trace_enter(G_STRFUNC, NULL);
 
-					j_backend_kv_get_by_prefix(jd_kv_backend, namespace, prefix, &iterator);
+	if (G_IS_TCP_CONNECTION(connection))
+	{
+		j_helper_set_nodelay(connection, TRUE);
+	}
 
-					while (j_backend_kv_iterate(jd_kv_backend, iterator, value))
-					{
-						j_message_add_operation(reply, 4 + value->len);
-						j_message_append_4(reply, &(value->len));
-						j_message_append_n(reply, bson_get_data(value), value->len);
-						bson_destroy(value);
-					}
+	statistics = j_statistics_new(TRUE);
 
-					j_message_add_operation(reply, 4);
-					j_message_append_4(reply, &zero);
+	jd_statistics_register(statistics);
 
-					j_message_send(reply, connection);
-				}
-				break;
-			default:
-				g_warn_if_reached();
-				break;
-		}
+	if (jd_pipeline)
+	{
+		jd_pipeline_run(connection, statistics);
 	}
-
+	else
 	{
-		guint64 value;
+		message = j_message_new(J_MESSAGE_NONE, 0);
 
-		G_LOCK(jd_statistics);
-
-		value = j_statistics_get(statistics, J_STATISTICS_FILES_CREATED);
-		j_statistics_add(jd_statistics, J_STATISTICS_FILES_CREATED, value);
-		value = j_statistics_get(statistics, J_STATISTICS_FILES_DELETED);
-		j_statistics_add(jd_statistics, J_STATISTICS_FILES_DELETED, value);
-		value = j_statistics_get(statistics, J_STATISTICS_SYNC);
-		j_statistics_add(jd_statistics, J_STATISTICS_SYNC, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_READ);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_READ, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_WRITTEN);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_WRITTEN, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_RECEIVED);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_RECEIVED, value);
-		value = j_statistics_get(statistics, J_STATISTICS_BYTES_SENT);
-		j_statistics_add(jd_statistics, J_STATISTICS_BYTES_SENT, value);
+		while (j_message_receive(message, connection))
+		{
+			if (!jd_handle_message(message, connection, statistics, g_get_monotonic_time()))
+			{
+				break;
+			}
 
-		G_UNLOCK(jd_statistics);
+			/* Keep the buffer for the next message unless it has grown too large. */
+			j_message_reset(message);
+		}
 	}
 
-	j_memory_chunk_free(memory_chunk);
+	jd_statistics_merge(statistics);
+
 	j_statistics_free(statistics);
 
 	j_trace_leave(G_STRFUNC);
@@ -702,6 +4050,7 @@ main (int argc, char** argv)
 {
 	gboolean opt_daemon = FALSE;
 	gint opt_port = 4711;
+	gint opt_kv_index = -1;
 
 	g_autoptr(JConfiguration) configuration = NULL;
 	GError* error = NULL;
@@ -710,12 +4059,18 @@ main (int argc, char** argv)
 	GModule* kv_module = NULL;
 	g_autoptr(GOptionContext) context = NULL;
 	g_autoptr(GSocketService) socket_service = NULL;
+	g_autoptr(GSocketAddress) local_address = NULL;
+	g_autofree gchar* local_path = NULL;
 	gchar const* object_backend;
 	gchar const* object_component;
 	gchar const* object_path;
 	gchar const* kv_backend;
 	gchar const* kv_component;
 	gchar const* kv_path;
+	gchar const* server_mode;
+	gboolean event_mode = FALSE;
+	guint64 memory_budget;
+	guint64 inline_size;
 #ifdef JULEA_DEBUG
 	g_autofree gchar* object_path_port = NULL;
 	g_autofree gchar* kv_path_port = NULL;
@@ -724,6 +4079,7 @@ main (int argc, char** argv)
 	GOptionEntry entries[] = {
 		{ "daemon", 0, 0, G_OPTION_ARG_NONE, &opt_daemon, "Run as daemon", NULL },
 		{ "port", 0, 0, G_OPTION_ARG_INT, &opt_port, "Port to use", "4711" },
+		{ "kv-index", 0, 0, G_OPTION_ARG_INT, &opt_kv_index, "Index of this server among the key-value servers, ships changes to its read replicas", "-1" },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -748,7 +4104,41 @@ main (int argc, char** argv)
 		return 1;
 	}
 
-	socket_service = g_threaded_socket_service_new(-1);
+	configuration = j_configuration_new();
+
+	if (configuration == NULL)
+	{
+		g_printerr("Could not read configuration.\n");
+		return 1;
+	}
+
+	jd_configuration = configuration;
+
+	/* Has to happen before any buffers are allocated. */
+	j_helper_set_huge_pages(j_configuration_get_server_huge_pages(configuration));
+
+	/* Has to happen before any threads are started, so that they inherit the binding. */
+	if (j_configuration_get_server_numa_node(configuration) != NULL)
+	{
+		jd_numa_bind(j_configuration_get_server_numa_node(configuration));
+	}
+
+	server_mode = j_configuration_get_server_mode(configuration);
+
+	if (g_strcmp0(server_mode, "event") == 0)
+	{
+		event_mode = TRUE;
+		socket_service = g_socket_service_new();
+	}
+	else if (g_strcmp0(server_mode, "threaded") == 0)
+	{
+		socket_service = g_threaded_socket_service_new(-1);
+	}
+	else
+	{
+		g_printerr("Unknown server mode %s.\n", server_mode);
+		return 1;
+	}
 
 	g_socket_listener_set_backlog(G_SOCKET_LISTENER(socket_service), 128);
 
@@ -763,18 +4153,24 @@ main (int argc, char** argv)
 		return 1;
 	}
 
-	j_trace_init("julea-server");
-
-	j_trace_enter(G_STRFUNC, NULL);
+	/* Local clients connect via a UNIX domain socket, bypassing the TCP/IP stack. */
+	local_path = j_helper_get_local_socket_path(opt_port);
+	local_address = g_unix_socket_address_new(local_path);
 
-	configuration = j_configuration_new();
+	/* Remove the socket of a previous server that has not been shut down properly. */
+	g_unlink(local_path);
 
-	if (configuration == NULL)
+	if (!g_socket_listener_add_address(G_SOCKET_LISTENER(socket_service), local_address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error))
 	{
-		g_printerr("Could not read configuration.\n");
-		return 1;
+		/* Clients fall back to TCP. */
+		g_printerr("%s\n", error->message);
+		g_clear_error(&error);
 	}
 
+	j_trace_init("julea-server");
+
+	j_trace_enter(G_STRFUNC, NULL);
+
 	object_backend = j_configuration_get_object_backend(configuration);
 	object_component = j_configuration_get_object_component(configuration);
 	object_path = j_configuration_get_object_path(configuration);
@@ -791,6 +4187,8 @@ main (int argc, char** argv)
 	kv_path = kv_path_port;
 #endif
 
+	jd_object_path = object_path;
+
 	if (j_backend_load_server(object_backend, object_component, J_BACKEND_TYPE_OBJECT, &object_module, &jd_object_backend))
 	{
 		if (jd_object_backend == NULL || !j_backend_object_init(jd_object_backend, object_path))
@@ -809,13 +4207,153 @@ main (int argc, char** argv)
 		}
 	}
 
+	if (jd_kv_backend != NULL)
+	{
+		jd_kv_index = jd_kv_index_new(jd_kv_backend);
+		jd_kv_commit = jd_kv_commit_new(jd_kv_backend, jd_kv_index, j_configuration_get_server_group_commit_time(configuration), j_configuration_get_server_group_commit_size(configuration));
+
+		if (j_configuration_get_server_kv_cache_size(configuration) > 0)
+		{
+			jd_kv_cache = jd_kv_cache_new(j_configuration_get_server_kv_cache_size(configuration));
+		}
+
+		if (j_configuration_get_server_kv_filter(configuration))
+		{
+			jd_kv_filter = jd_kv_filter_new(jd_kv_backend);
+		}
+
+		jd_kv_watch = jd_kv_watch_new(jd_kv_backend);
+
+		if (opt_kv_index >= 0)
+		{
+			guint kv_replicas = 0;
+
+			if ((guint)opt_kv_index < j_configuration_get_kv_server_count(configuration))
+			{
+				kv_replicas = j_configuration_get_kv_replica_count(configuration, opt_kv_index);
+			}
+
+			if (kv_replicas > 0)
+			{
+				/* Changes are shipped using the connection pool. */
+				if (g_once_init_enter(&jd_connection_pool_initialized))
+				{
+					j_connection_pool_init(jd_configuration);
+					g_once_init_leave(&jd_connection_pool_initialized, 1);
+				}
+
+				jd_kv_replication = jd_kv_replication_new(jd_kv_backend, opt_kv_index, kv_replicas);
+			}
+			else
+			{
+				g_warning("Key-value server %d has no read replicas.", opt_kv_index);
+			}
+		}
+	}
+
+	inline_size = j_configuration_get_server_inline_size(configuration);
+
+	if (jd_object_backend != NULL && jd_kv_backend != NULL && inline_size > 0)
+	{
+		/* All object operations go through the wrapper, so small objects are stored in the key-value backend transparently. */
+		jd_object_backend = jd_inline_backend(jd_object_backend, jd_kv_backend, inline_size);
+	}
+
+	if (jd_object_backend != NULL)
+	{
+		jd_write_buffer_size = j_configuration_get_server_write_buffer_size(configuration);
+		jd_write_buffer_time = j_configuration_get_server_write_buffer_time(configuration);
+
+		if (jd_write_buffer_time == 0)
+		{
+			jd_write_buffer_time = 100 * 1000;
+		}
+
+		if (j_configuration_get_server_journal(configuration) != NULL)
+		{
+			/* Only buffered writes are journaled. */
+			if (jd_write_buffer_size > 0)
+			{
+				jd_journal = jd_journal_new(jd_object_backend, j_configuration_get_server_journal(configuration));
+			}
+			else
+			{
+				g_warning("The journal requires a write buffer, disabling it.");
+			}
+		}
+
+		jd_handle_cache = jd_handle_cache_new(jd_object_backend, JD_HANDLE_CACHE_SIZE, jd_write_buffer_size, jd_journal);
+		jd_object_handles = jd_object_handles_new(jd_handle_cache);
+		jd_group_commit = jd_group_commit_new(jd_object_backend, j_configuration_get_server_group_commit_time(configuration), j_configuration_get_server_group_commit_size(configuration));
+
+		if (j_configuration_get_server_dedup(configuration) > 0)
+		{
+			jd_dedup = jd_dedup_new(j_configuration_get_server_dedup(configuration));
+		}
+
+		jd_append = jd_append_new(jd_object_backend);
+
+		/* Only clients that send their address in the ping use RDMA. */
+		jd_rdma = j_transport_rdma_init();
+	}
+
+	memory_budget = j_configuration_get_server_memory_budget(configuration);
+	jd_memory_pool = jd_memory_pool_new(J_STRIPE_SIZE, (memory_budget > 0) ? MAX(memory_budget / J_STRIPE_SIZE, 1) : 0);
+	jd_lock_manager = j_lock_manager_new();
+
+	if (j_configuration_get_server_scheduler_slots(configuration) > 0)
+	{
+		jd_scheduler = jd_scheduler_new(j_configuration_get_server_scheduler_slots(configuration),
+			j_configuration_get_server_scheduler_weight_metadata(configuration),
+			j_configuration_get_server_scheduler_weight_small(configuration),
+			j_configuration_get_server_scheduler_weight_bulk(configuration));
+	}
+
+	/* Scrubbing walks the item documents, so it requires both backends. */
+	if (jd_object_backend != NULL && jd_kv_backend != NULL && j_configuration_get_server_scrub_rate(configuration) > 0)
+	{
+		jd_scrub = jd_scrub_new(jd_object_backend, jd_kv_backend, j_configuration_get_server_scrub_rate(configuration), j_configuration_get_server_scrub_interval(configuration));
+	}
+
+	/* Deferred deletes require renaming objects and finding them again after a restart. */
+	if (jd_object_backend != NULL && j_configuration_get_server_trash_rate(configuration) > 0)
+	{
+		if (jd_object_backend->object.rename != NULL && jd_object_backend->object.list != NULL)
+		{
+			jd_trash = jd_trash_new(jd_object_backend, j_configuration_get_server_trash_rate(configuration));
+		}
+		else
+		{
+			g_warning("Object backend does not support deferred deletes, deleting objects immediately.");
+		}
+	}
+
 	jd_statistics = j_statistics_new(FALSE);
+	jd_statistics_live = g_hash_table_new(NULL, NULL);
+
+	if (event_mode)
+	{
+		if (!jd_event_start(socket_service, j_configuration_get_server_threads(configuration)))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		jd_pipeline = j_configuration_get_server_pipeline(configuration);
+		g_signal_connect(socket_service, "run", G_CALLBACK(jd_on_run), NULL);
+	}
 
 	g_socket_service_start(socket_service);
-	g_signal_connect(socket_service, "run", G_CALLBACK(jd_on_run), NULL);
 
 	main_loop = g_main_loop_new(NULL, FALSE);
 
+	if (jd_write_buffer_size > 0)
+	{
+		/* Check twice per time window, so data is at most 1.5 times as old as configured. */
+		g_timeout_add(MAX(jd_write_buffer_time / 2000, 1), jd_on_write_buffer_timeout, NULL);
+	}
+
 	g_unix_signal_add(SIGHUP, jd_signal, main_loop);
 	g_unix_signal_add(SIGINT, jd_signal, main_loop);
 	g_unix_signal_add(SIGTERM, jd_signal, main_loop);
@@ -823,9 +4361,107 @@ main (int argc, char** argv)
 	g_main_loop_run(main_loop);
 
 	g_socket_service_stop(socket_service);
+	g_socket_listener_close(G_SOCKET_LISTENER(socket_service));
+	g_unlink(local_path);
+
+	if (event_mode)
+	{
+		jd_event_stop();
+	}
+
+	/* Ships the remaining changes, so the connection pool is still needed. */
+	if (jd_kv_replication != NULL)
+	{
+		jd_kv_replication_free(jd_kv_replication);
+		jd_kv_replication = NULL;
+	}
 
+	if (jd_connection_pool_initialized)
+	{
+		j_connection_pool_fini();
+	}
+
+	g_hash_table_destroy(jd_statistics_live);
 	j_statistics_free(jd_statistics);
 
+	if (jd_scheduler != NULL)
+	{
+		jd_scheduler_free(jd_scheduler);
+	}
+
+	if (jd_scrub != NULL)
+	{
+		jd_scrub_free(jd_scrub);
+	}
+
+	if (jd_trash != NULL)
+	{
+		jd_trash_free(jd_trash);
+	}
+
+	j_lock_manager_free(jd_lock_manager);
+
+	/* Also closes the registrations of the memory pool's chunks. */
+	j_transport_fini();
+
+	jd_memory_pool_free(jd_memory_pool);
+
+	if (jd_dedup != NULL)
+	{
+		jd_dedup_free(jd_dedup);
+	}
+
+	if (jd_append != NULL)
+	{
+		jd_append_free(jd_append);
+	}
+
+	if (jd_group_commit != NULL)
+	{
+		jd_group_commit_free(jd_group_commit);
+	}
+
+	if (jd_object_handles != NULL)
+	{
+		jd_object_handles_free(jd_object_handles);
+	}
+
+	if (jd_handle_cache != NULL)
+	{
+		jd_handle_cache_free(jd_handle_cache);
+	}
+
+	/* The handle cache has written all buffered data, so the journal can be emptied. */
+	if (jd_journal != NULL)
+	{
+		jd_journal_free(jd_journal);
+	}
+
+	if (jd_kv_watch != NULL)
+	{
+		jd_kv_watch_free(jd_kv_watch);
+	}
+
+	if (jd_kv_filter != NULL)
+	{
+		jd_kv_filter_free(jd_kv_filter);
+	}
+
+	if (jd_kv_commit != NULL)
+	{
+		jd_kv_commit_free(jd_kv_commit);
+	}
+
+	if (jd_kv_cache != NULL)
+	{
+		jd_kv_cache_free(jd_kv_cache);
+	}
+
+	if (jd_kv_index != NULL)
+	{
+		jd_kv_index_free(jd_kv_index);
+	}
+
 	if (jd_kv_backend != NULL)
 	{
 		j_backend_kv_fini(jd_kv_backend);
@@ -0,0 +1,253 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ **/
+
+#ifndef JULEA_SERVER_SERVER_H
+#define JULEA_SERVER_SERVER_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <julea.h>
+
+gboolean jd_handle_message (JMessage*, GSocketConnection*, JStatistics*, gint64);
+void jd_statistics_register (JStatistics*);
+void jd_statistics_merge (JStatistics*);
+
+struct JdJournal;
+
+typedef struct JdJournal JdJournal;
+
+struct JdHandleCache;
+
+typedef struct JdHandleCache JdHandleCache;
+
+JdJournal* jd_journal_new (JBackend*, gchar const*);
+void jd_journal_free (JdJournal*);
+
+gboolean jd_journal_append (JdJournal*, gchar const*, gchar const*, gconstpointer, guint64, guint64);
+void jd_journal_checkpoint (JdJournal*, JdHandleCache*);
+
+JdHandleCache* jd_handle_cache_new (JBackend*, guint, guint64, JdJournal*);
+void jd_handle_cache_free (JdHandleCache*);
+
+gpointer jd_handle_cache_open (JdHandleCache*, gchar const*, gchar const*, gpointer*);
+gpointer jd_handle_cache_create (JdHandleCache*, gchar const*, gchar const*, gpointer*);
+void jd_handle_cache_release (JdHandleCache*, gpointer);
+gpointer jd_handle_cache_ref (JdHandleCache*, gpointer, gpointer*);
+void jd_handle_cache_get_name (gpointer, gchar const**, gchar const**);
+void jd_handle_cache_invalidate (JdHandleCache*, gchar const*, gchar const*);
+void jd_handle_cache_invalidate_directory (JdHandleCache*, gchar const*, gchar const*);
+
+gboolean jd_handle_cache_write (JdHandleCache*, gpointer, gconstpointer, guint64, guint64, guint64*);
+gboolean jd_handle_cache_flush (JdHandleCache*, gpointer);
+void jd_handle_cache_flush_expired (JdHandleCache*, gint64);
+
+struct JdObjectHandles;
+
+typedef struct JdObjectHandles JdObjectHandles;
+
+JdObjectHandles* jd_object_handles_new (JdHandleCache*);
+void jd_object_handles_free (JdObjectHandles*);
+
+guint64 jd_object_handles_open (JdObjectHandles*, gchar const*, gchar const*);
+gboolean jd_object_handles_close (JdObjectHandles*, guint64);
+gpointer jd_object_handles_get (JdObjectHandles*, guint64, gpointer*);
+
+struct JdGroupCommit;
+
+typedef struct JdGroupCommit JdGroupCommit;
+
+JdGroupCommit* jd_group_commit_new (JBackend*, guint64, guint);
+void jd_group_commit_free (JdGroupCommit*);
+
+gboolean jd_group_commit_sync (JdGroupCommit*, gpointer*, guint, JStatistics*);
+gboolean jd_group_commit_is_direct (JdGroupCommit*);
+
+JBackend* jd_inline_backend (JBackend*, JBackend*, guint64);
+
+struct JdKVIndex;
+
+typedef struct JdKVIndex JdKVIndex;
+
+struct JdKVIndexBatch;
+
+typedef struct JdKVIndexBatch JdKVIndexBatch;
+
+typedef void (*JdKVIndexFunc) (gchar const*, bson_t const*, gpointer);
+
+JdKVIndex* jd_kv_index_new (JBackend*);
+void jd_kv_index_free (JdKVIndex*);
+
+gboolean jd_kv_index_is_internal (gchar const*);
+gboolean jd_kv_index_create (JdKVIndex*, gchar const*, gchar const*);
+gboolean jd_kv_index_is_used (JdKVIndex*, gchar const*);
+void jd_kv_index_update (JdKVIndex*, gchar const*, gchar const*, bson_t const*);
+
+JdKVIndexBatch* jd_kv_index_batch_start (JdKVIndex*, gchar const*, gpointer);
+void jd_kv_index_batch_put (JdKVIndexBatch*, gchar const*, bson_t const*);
+void jd_kv_index_batch_delete (JdKVIndexBatch*, gchar const*);
+void jd_kv_index_batch_end (JdKVIndexBatch*);
+
+gboolean jd_kv_index_scan (JdKVIndex*, gchar const*, gchar const*, bson_t const*, guint32, JdKVIndexFunc, gpointer);
+
+struct JdKVCache;
+
+typedef struct JdKVCache JdKVCache;
+
+JdKVCache* jd_kv_cache_new (guint64);
+void jd_kv_cache_free (JdKVCache*);
+
+gboolean jd_kv_cache_get (JdKVCache*, gchar const*, gchar const*, bson_t*, guint64*);
+void jd_kv_cache_fill (JdKVCache*, gchar const*, gchar const*, bson_t const*, guint64);
+guint64 jd_kv_cache_begin_write (JdKVCache*, gchar const*, gchar const*);
+void jd_kv_cache_end_write (JdKVCache*, gchar const*, gchar const*, bson_t const*, guint64);
+
+struct JdKVFilter;
+
+typedef struct JdKVFilter JdKVFilter;
+
+JdKVFilter* jd_kv_filter_new (JBackend*);
+void jd_kv_filter_free (JdKVFilter*);
+
+gboolean jd_kv_filter_contains (JdKVFilter*, gchar const*, gchar const*);
+void jd_kv_filter_add (JdKVFilter*, gchar const*, gchar const*);
+void jd_kv_filter_delete (JdKVFilter*, gchar const*);
+
+struct JdKVCommit;
+
+typedef struct JdKVCommit JdKVCommit;
+
+JdKVCommit* jd_kv_commit_new (JBackend*, JdKVIndex*, guint64, guint);
+void jd_kv_commit_free (JdKVCommit*);
+
+gboolean jd_kv_commit_write (JdKVCommit*, gchar const*, JSemanticsSafety, gchar const**, gconstpointer*, guint32*, guint);
+gboolean jd_kv_commit_write_raw (JdKVCommit*, gchar const*, JSemanticsSafety, gchar const**, gconstpointer*, guint32*, guint);
+
+struct JdKVWatch;
+
+typedef struct JdKVWatch JdKVWatch;
+
+JdKVWatch* jd_kv_watch_new (JBackend*);
+void jd_kv_watch_free (JdKVWatch*);
+
+void jd_kv_watch_add (JdKVWatch*, GSocketConnection*, gchar const*, gchar const*, gboolean);
+void jd_kv_watch_notify (JdKVWatch*, gchar const*, gchar const*, gboolean);
+
+struct JdKVReplication;
+
+typedef struct JdKVReplication JdKVReplication;
+
+JdKVReplication* jd_kv_replication_new (JBackend*, guint, guint);
+void jd_kv_replication_free (JdKVReplication*);
+
+void jd_kv_replication_notify (JdKVReplication*, gchar const*, gchar const*);
+
+gboolean jd_numa_bind (gchar const*);
+
+/**
+ * The number of latency buckets per histogram.
+ */
+#define JD_LATENCY_BUCKETS 32
+
+enum JdLatencyPhase
+{
+	JD_LATENCY_QUEUE,
+	JD_LATENCY_BACKEND,
+	JD_LATENCY_SEND,
+	JD_LATENCY_PHASES
+};
+
+typedef enum JdLatencyPhase JdLatencyPhase;
+
+void jd_latency_record (JMessageType, JdLatencyPhase, gint64);
+void jd_latency_append (JMessage*);
+void jd_latency_record_traced (guint64, JMessageType, gint64, gint64, gint64);
+void jd_latency_append_traced (JMessage*);
+
+struct JdScheduler;
+
+typedef struct JdScheduler JdScheduler;
+
+JdScheduler* jd_scheduler_new (guint, guint, guint, guint);
+void jd_scheduler_free (JdScheduler*);
+
+void jd_scheduler_acquire (JdScheduler*, JMessage*, GSocketConnection*);
+void jd_scheduler_release (JdScheduler*);
+
+struct JdMemoryPool;
+
+typedef struct JdMemoryPool JdMemoryPool;
+
+JdMemoryPool* jd_memory_pool_new (guint64, guint);
+void jd_memory_pool_free (JdMemoryPool*);
+
+JMemoryChunk* jd_memory_pool_acquire (JdMemoryPool*);
+void jd_memory_pool_release (JdMemoryPool*, JMemoryChunk*);
+
+struct JdScrub;
+
+typedef struct JdScrub JdScrub;
+
+JdScrub* jd_scrub_new (JBackend*, JBackend*, guint64, guint64);
+void jd_scrub_free (JdScrub*);
+
+void jd_scrub_update (JdScrub*, gchar const*, gchar const*, gpointer, gpointer, guint64 const*, guint64 const*, guint);
+void jd_scrub_invalidate (JdScrub*, gchar const*, gchar const*);
+void jd_scrub_invalidate_directory (JdScrub*, gchar const*, gchar const*);
+
+void jd_scrub_append (JdScrub*, JMessage*);
+
+struct JdTrash;
+
+typedef struct JdTrash JdTrash;
+
+JdTrash* jd_trash_new (JBackend*, guint64);
+void jd_trash_free (JdTrash*);
+
+gboolean jd_trash_delete (JdTrash*, gpointer);
+
+void jd_pipeline_run (GSocketConnection*, JStatistics*);
+
+struct JdDedup;
+
+typedef struct JdDedup JdDedup;
+
+JdDedup* jd_dedup_new (guint);
+void jd_dedup_free (JdDedup*);
+
+gboolean jd_dedup_lookup (JdDedup*, guint8 const*, gchar**, gchar**, guint64*, guint64*);
+void jd_dedup_insert (JdDedup*, guint8 const*, gchar const*, gchar const*, guint64, guint64);
+void jd_dedup_remove (JdDedup*, guint8 const*);
+
+struct JdAppend;
+
+typedef struct JdAppend JdAppend;
+
+JdAppend* jd_append_new (JBackend*);
+void jd_append_free (JdAppend*);
+
+gboolean jd_append_write (JdAppend*, gchar const*, gchar const*, gpointer, gconstpointer, guint64, guint64*);
+
+gboolean jd_event_start (GSocketService*, guint);
+void jd_event_stop (void);
+
+#endif
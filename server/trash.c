@@ -0,0 +1,338 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Deferred deletion of objects.
+ *
+ * Deleted objects are renamed into the object namespace JD_TRASH_NAMESPACE, which is cheap regardless of their size.
+ * A thread reclaims their space in the background by truncating them step by step at a throttled rate before finally deleting them.
+ * The trash is a regular namespace, so objects that have not been reclaimed when the server stops are reclaimed after it has been restarted.
+ **/
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+#include "server.h"
+
+/**
+ * The object namespace of deleted objects.
+ */
+#define JD_TRASH_NAMESPACE "julea-trash"
+
+/**
+ * The number of bytes reclaimed at once.
+ */
+#define JD_TRASH_STEP (16 * J_STRIPE_SIZE)
+
+/**
+ * The time between two passes in microseconds if no objects are deleted.
+ * Passes also pick up objects left over from before a restart.
+ */
+#define JD_TRASH_INTERVAL (G_USEC_PER_SEC * 60)
+
+struct JdTrash
+{
+	JBackend* object_backend;
+
+	/**
+	 * The rate in bytes per second.
+	 */
+	guint64 rate;
+
+	/**
+	 * The start of the current pass and the number of bytes reclaimed since then, used for throttling.
+	 */
+	gint64 pass_start;
+	guint64 pass_bytes;
+
+	/**
+	 * Used for generating unique names together with the current time.
+	 */
+	guint counter;
+
+	/**
+	 * Whether objects have been deleted since the last pass started.
+	 */
+	gboolean pending;
+
+	gboolean stop;
+
+	GThread* thread;
+	GMutex mutex[1];
+	GCond cond[1];
+};
+
+/**
+ * Waits until the given monotonic time.
+ * If #pending is TRUE, also returns as soon as objects have been deleted.
+ *
+ * \return FALSE if the reclaimer has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_trash_wait_until (JdTrash* trash, gint64 end_time, gboolean pending)
+{
+	gboolean ret;
+
+	g_mutex_lock(trash->mutex);
+
+	while (!trash->stop && !(pending && trash->pending) && g_cond_wait_until(trash->cond, trash->mutex, end_time))
+	{
+	}
+
+	if (pending)
+	{
+		trash->pending = FALSE;
+	}
+
+	ret = !trash->stop;
+
+	g_mutex_unlock(trash->mutex);
+
+	return ret;
+}
+
+/**
+ * Accounts for reclaimed data and sleeps as long as the pass is ahead of its rate.
+ */
+static
+gboolean
+jd_trash_throttle (JdTrash* trash, guint64 length)
+{
+	gint64 due;
+
+	trash->pass_bytes += length;
+	due = trash->pass_start + (gint64)(trash->pass_bytes * G_USEC_PER_SEC / trash->rate);
+
+	/* Also checks whether the reclaimer has been stopped if no waiting is necessary. */
+	return jd_trash_wait_until(trash, due, FALSE);
+}
+
+/**
+ * Shrinks a deleted object step by step and deletes it afterwards.
+ *
+ * \return FALSE if the reclaimer has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_trash_reclaim (JdTrash* trash, gchar const* path)
+{
+	gpointer object;
+	guint64 size = 0;
+
+	if (!j_backend_object_open(trash->object_backend, JD_TRASH_NAMESPACE, path, &object))
+	{
+		return TRUE;
+	}
+
+	j_backend_object_status(trash->object_backend, object, NULL, &size);
+
+	/* Without truncation, the whole object is reclaimed by deleting it. */
+	while (trash->object_backend->object.truncate != NULL && size > 0)
+	{
+		guint64 length;
+
+		length = MIN(size, JD_TRASH_STEP);
+		size -= length;
+
+		if (!j_backend_object_truncate(trash->object_backend, object, size))
+		{
+			break;
+		}
+
+		if (!jd_trash_throttle(trash, length))
+		{
+			j_backend_object_close(trash->object_backend, object);
+			return FALSE;
+		}
+	}
+
+	j_backend_object_delete(trash->object_backend, object);
+
+	return jd_trash_throttle(trash, size);
+}
+
+/**
+ * Reclaims all deleted objects once.
+ * The paths are collected first, so that no iterator is kept open while reclaiming.
+ *
+ * \return FALSE if the reclaimer has been stopped, TRUE otherwise.
+ */
+static
+gboolean
+jd_trash_pass (JdTrash* trash)
+{
+	g_autoptr(GPtrArray) paths = NULL;
+	gpointer iterator;
+	gboolean ret = TRUE;
+
+	trash->pass_start = g_get_monotonic_time();
+	trash->pass_bytes = 0;
+
+	paths = g_ptr_array_new_with_free_func(g_free);
+
+	if (j_backend_object_list(trash->object_backend, JD_TRASH_NAMESPACE, &iterator))
+	{
+		gchar const* path;
+
+		while (j_backend_object_iterate(trash->object_backend, iterator, &path))
+		{
+			g_ptr_array_add(paths, g_strdup(path));
+		}
+	}
+
+	for (guint i = 0; ret && i < paths->len; i++)
+	{
+		ret = jd_trash_reclaim(trash, g_ptr_array_index(paths, i));
+	}
+
+	return ret;
+}
+
+static
+gpointer
+jd_trash_thread (gpointer data)
+{
+	JdTrash* trash = data;
+
+	do
+	{
+		if (!jd_trash_pass(trash))
+		{
+			break;
+		}
+	}
+	while (jd_trash_wait_until(trash, g_get_monotonic_time() + JD_TRASH_INTERVAL, TRUE));
+
+	return NULL;
+}
+
+/**
+ * Creates a new trash and starts its reclaimer thread.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param object_backend The object backend, which has to support renaming and listing objects.
+ * \param rate           The rate at which space is reclaimed in bytes per second.
+ *
+ * \return A new trash. Should be freed with jd_trash_free().
+ **/
+JdTrash*
+jd_trash_new (JBackend* object_backend, guint64 rate)
+{
+	JdTrash* trash;
+
+	g_return_val_if_fail(object_backend != NULL, NULL);
+	g_return_val_if_fail(object_backend->object.rename != NULL, NULL);
+	g_return_val_if_fail(object_backend->object.list != NULL, NULL);
+	g_return_val_if_fail(rate > 0, NULL);
+
+	trash = g_slice_new0(JdTrash);
+	trash->object_backend = object_backend;
+	trash->rate = rate;
+	trash->counter = 0;
+	trash->pending = FALSE;
+	trash->stop = FALSE;
+
+	g_mutex_init(trash->mutex);
+	g_cond_init(trash->cond);
+
+	trash->thread = g_thread_new("julea-server-trash", jd_trash_thread, trash);
+
+	return trash;
+}
+
+/**
+ * Stops the reclaimer and frees the trash.
+ * Objects that have not been reclaimed yet stay in the trash.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param trash A trash.
+ **/
+void
+jd_trash_free (JdTrash* trash)
+{
+	g_return_if_fail(trash != NULL);
+
+	g_mutex_lock(trash->mutex);
+	trash->stop = TRUE;
+	g_cond_signal(trash->cond);
+	g_mutex_unlock(trash->mutex);
+
+	g_thread_join(trash->thread);
+
+	g_cond_clear(trash->cond);
+	g_mutex_clear(trash->mutex);
+
+	g_slice_free(JdTrash, trash);
+}
+
+/**
+ * Deletes an object by moving it to the trash.
+ * If the object can not be moved, it is deleted directly.
+ *
+ * \author Michael Kuhn
+ *
+ * \code
+ * \endcode
+ *
+ * \param trash  A trash.
+ * \param object An open object, which is closed afterwards.
+ *
+ * \return TRUE on success, FALSE if the object could neither be moved nor deleted.
+ **/
+gboolean
+jd_trash_delete (JdTrash* trash, gpointer object)
+{
+	g_autofree gchar* path = NULL;
+	guint counter;
+
+	g_return_val_if_fail(trash != NULL, FALSE);
+	g_return_val_if_fail(object != NULL, FALSE);
+
+	counter = (guint)g_atomic_int_add(&(trash->counter), 1);
+
+	/* The time keeps names unique across restarts. */
+	path = g_strdup_printf("%016" G_GINT64_MODIFIER "x-%08x", g_get_real_time(), counter);
+
+	if (!j_backend_object_rename(trash->object_backend, object, JD_TRASH_NAMESPACE, path))
+	{
+		/* The object is still open, deleting it also closes it. */
+		return j_backend_object_delete(trash->object_backend, object);
+	}
+
+	g_mutex_lock(trash->mutex);
+	trash->pending = TRUE;
+	g_cond_signal(trash->cond);
+	g_mutex_unlock(trash->mutex);
+
+	return TRUE;
+}
@@ -20,6 +20,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 #include <julea-item.h>
 
@@ -123,6 +125,134 @@ test_batch_execute_async (void)
 	_test_batch_execute(TRUE);
 }
 
+static
+void
+test_batch_wait_any (void)
+{
+	JBatch* batches[4];
+	guint done = 0;
+
+	for (guint i = 0; i < G_N_ELEMENTS(batches); i++)
+	{
+		g_autoptr(JCollection) collection = NULL;
+		g_autofree gchar* name = NULL;
+
+		name = g_strdup_printf("test-wait-any-%u", i);
+
+		batches[i] = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+		collection = j_collection_create(name, batches[i]);
+		j_collection_delete(collection, batches[i]);
+
+		j_batch_execute_async(batches[i], NULL, NULL);
+	}
+
+	while (done < G_N_ELEMENTS(batches))
+	{
+		guint index;
+
+		index = j_batch_wait_any(batches, G_N_ELEMENTS(batches) - done);
+		g_assert_cmpuint(index, <, G_N_ELEMENTS(batches) - done);
+		g_assert(j_batch_test(batches[index]));
+
+		j_batch_unref(batches[index]);
+
+		/* Move the last outstanding batch into the finished one's place. */
+		done++;
+		batches[index] = batches[G_N_ELEMENTS(batches) - done];
+	}
+}
+
+static
+void
+test_batch_cancel (void)
+{
+	g_autoptr(JCollection) collection = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	GCancellable* cancellable;
+
+	cancellable = g_cancellable_new();
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_batch_set_timeout(batch, G_TIME_SPAN_SECOND);
+	j_batch_set_cancellable(batch, cancellable);
+
+	collection = j_collection_create("test-cancel", batch);
+
+	/* Cancelled batches do not execute their operations. */
+	g_cancellable_cancel(cancellable);
+	g_assert(!j_batch_execute(batch));
+	g_assert_cmpint(j_batch_get_result(batch, 0), ==, J_OPERATION_RESULT_CANCELLED);
+
+	g_object_unref(cancellable);
+}
+
+static
+void
+test_batch_statistics (void)
+{
+	g_autoptr(JCollection) collection = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	JStatistics* statistics;
+
+	statistics = j_statistics_new(FALSE);
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_batch_set_statistics(batch, statistics);
+	g_assert(j_batch_get_statistics(batch) == statistics);
+
+	collection = j_collection_create("test-statistics", batch);
+	j_collection_delete(collection, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpint(j_batch_get_result(batch, 0), ==, J_OPERATION_RESULT_SUCCESS);
+
+	g_assert_cmpuint(j_statistics_get(statistics, J_STATISTICS_MESSAGES_SENT), >, 0);
+	g_assert_cmpuint(j_statistics_get(statistics, J_STATISTICS_BYTES_SENT), >, 0);
+	g_assert_cmpuint(j_statistics_get(statistics, J_STATISTICS_SERVERS), >, 0);
+
+	j_statistics_free(statistics);
+}
+
+static
+void
+test_batch_alloc (void)
+{
+	guint const n = 10000;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JBatch) other = NULL;
+	g_autofree guint64** values = NULL;
+	gchar* large;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	other = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	values = g_new(guint64*, n);
+
+	for (guint i = 0; i < n; i++)
+	{
+		values[i] = j_batch_alloc(batch, 3 * sizeof(guint64));
+		g_assert_cmpuint(GPOINTER_TO_SIZE(values[i]) % sizeof(gpointer), ==, 0);
+
+		values[i][0] = i;
+		values[i][2] = i;
+	}
+
+	large = j_batch_alloc(batch, 1024 * 1024);
+	memset(large, 0xff, 1024 * 1024);
+
+	/* Moving the operations keeps their payloads valid. */
+	j_batch_move_operations(other, batch);
+
+	large = j_batch_alloc(batch, 1024 * 1024);
+	memset(large, 0, 1024 * 1024);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_assert_cmpuint(values[i][0], ==, i);
+		g_assert_cmpuint(values[i][2], ==, i);
+	}
+}
+
 void
 test_batch (void)
 {
@@ -130,4 +260,8 @@ test_batch (void)
 	g_test_add_func("/batch/semantics", test_batch_semantics);
 	g_test_add_func("/batch/execute", test_batch_execute);
 	g_test_add_func("/batch/execute_async", test_batch_execute_async);
+	g_test_add_func("/batch/wait_any", test_batch_wait_any);
+	g_test_add_func("/batch/cancel", test_batch_cancel);
+	g_test_add_func("/batch/statistics", test_batch_statistics);
+	g_test_add_func("/batch/alloc", test_batch_alloc);
 }
@@ -20,6 +20,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 
 #include <jcache.h>
@@ -84,10 +86,42 @@ test_cache_release (void)
 	j_cache_free(cache);
 }
 
+static
+void
+test_cache_reuse (void)
+{
+	JCache* cache;
+	gpointer ret1;
+	gpointer ret2;
+
+	cache = j_cache_new(2 * 1024 * 1024);
+
+	for (guint i = 0; i < 10000; i++)
+	{
+		ret1 = j_cache_get(cache, 1 + (i % 100) * 100);
+		g_assert(ret1 != NULL);
+		memset(ret1, 42, 1 + (i % 100) * 100);
+
+		j_cache_release(cache, ret1);
+	}
+
+	ret1 = j_cache_get(cache, 1024 * 1024);
+	g_assert(ret1 != NULL);
+	ret2 = j_cache_get(cache, 1024 * 1024);
+	g_assert(ret2 != NULL);
+	g_assert(j_cache_get(cache, 1) == NULL);
+
+	j_cache_release(cache, ret2);
+	j_cache_release(cache, ret1);
+
+	j_cache_free(cache);
+}
+
 void
 test_cache (void)
 {
 	g_test_add_func("/cache/new_free", test_cache_new_free);
 	g_test_add_func("/cache/get", test_cache_get);
 	g_test_add_func("/cache/release", test_cache_release);
+	g_test_add_func("/cache/reuse", test_cache_reuse);
 }
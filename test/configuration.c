@@ -101,6 +101,49 @@ test_configuration_get (void)
 	g_assert_cmpstr(j_configuration_get_kv_component(configuration), ==, "client");
 	g_assert_cmpstr(j_configuration_get_kv_path(configuration), ==, "NULL2");
 
+	g_assert_cmpstr(j_configuration_get_server_mode(configuration), ==, "threaded");
+	g_assert_cmpuint(j_configuration_get_server_threads(configuration), ==, 0);
+
+	j_configuration_unref(configuration);
+
+	g_key_file_free(key_file);
+}
+
+static
+void
+test_configuration_local_namespaces (void)
+{
+	JConfiguration* configuration;
+	GKeyFile* key_file;
+	gchar const* servers[] = { "localhost", NULL };
+	gchar const* local_namespaces[] = { "scratch", "tmp", NULL };
+
+	key_file = g_key_file_new();
+	g_key_file_set_string_list(key_file, "servers", "object", servers, 1);
+	g_key_file_set_string_list(key_file, "servers", "kv", servers, 1);
+	g_key_file_set_string(key_file, "object", "backend", "null");
+	g_key_file_set_string(key_file, "object", "component", "server");
+	g_key_file_set_string(key_file, "object", "path", "");
+	g_key_file_set_string_list(key_file, "object", "local-namespaces", local_namespaces, 2);
+	g_key_file_set_string(key_file, "object", "local-backend", "posix");
+	g_key_file_set_string(key_file, "object", "local-path", "/tmp/julea-local");
+	g_key_file_set_string(key_file, "kv", "backend", "null");
+	g_key_file_set_string(key_file, "kv", "component", "server");
+	g_key_file_set_string(key_file, "kv", "path", "");
+	/* Local namespaces without a backend are ignored. */
+	g_key_file_set_string_list(key_file, "kv", "local-namespaces", local_namespaces, 2);
+
+	configuration = j_configuration_new_for_data(key_file);
+	g_assert(configuration != NULL);
+
+	g_assert(j_configuration_is_object_namespace_local(configuration, "scratch"));
+	g_assert(j_configuration_is_object_namespace_local(configuration, "tmp"));
+	g_assert(!j_configuration_is_object_namespace_local(configuration, "item"));
+	g_assert_cmpstr(j_configuration_get_object_local_backend(configuration), ==, "posix");
+	g_assert_cmpstr(j_configuration_get_object_local_path(configuration), ==, "/tmp/julea-local");
+
+	g_assert(!j_configuration_is_kv_namespace_local(configuration, "scratch"));
+
 	j_configuration_unref(configuration);
 
 	g_key_file_free(key_file);
@@ -112,4 +155,5 @@ test_configuration (void)
 	g_test_add_func("/configuration/new_ref_unref", test_configuration_new_ref_unref);
 	g_test_add_func("/configuration/new_for_data", test_configuration_new_for_data);
 	g_test_add_func("/configuration/get", test_configuration_get);
+	g_test_add_func("/configuration/local_namespaces", test_configuration_local_namespaces);
 }
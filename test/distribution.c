@@ -220,10 +220,411 @@ test_distribution_weighted (JConfiguration** configuration, gconstpointer data)
 	test_distribution_distribute(J_DISTRIBUTION_WEIGHTED, configuration, data);
 }
 
+static
+void
+test_distribution_extents (JConfiguration** configuration, gconstpointer data)
+{
+	JDistributionType types[] = { J_DISTRIBUTION_ROUND_ROBIN, J_DISTRIBUTION_SINGLE_SERVER, J_DISTRIBUTION_WEIGHTED, J_DISTRIBUTION_RENDEZVOUS, J_DISTRIBUTION_REPLICATED, J_DISTRIBUTION_ERASURE, J_DISTRIBUTION_LOCAL };
+
+	(void)data;
+
+	for (guint i = 0; i < G_N_ELEMENTS(types); i++)
+	{
+		g_autoptr(JDistribution) distribution = NULL;
+		g_autoptr(JDistribution) reference = NULL;
+		JDistributionExtent extents[3];
+		guint64 block_size;
+		guint count;
+		guint total;
+
+		block_size = 1000;
+
+		distribution = j_distribution_new_for_configuration(types[i], *configuration);
+		reference = j_distribution_new_for_configuration(types[i], *configuration);
+
+		j_distribution_set_block_size(distribution, block_size);
+		j_distribution_set_block_size(reference, block_size);
+
+		if (types[i] == J_DISTRIBUTION_WEIGHTED)
+		{
+			j_distribution_set2(distribution, "weight", 0, 1);
+			j_distribution_set2(distribution, "weight", 1, 2);
+			j_distribution_set2(reference, "weight", 0, 1);
+			j_distribution_set2(reference, "weight", 1, 2);
+		}
+		else if (types[i] == J_DISTRIBUTION_RENDEZVOUS)
+		{
+			j_distribution_set(distribution, "seed", 42);
+			j_distribution_set(reference, "seed", 42);
+		}
+		else if (types[i] == J_DISTRIBUTION_LOCAL)
+		{
+			j_distribution_set(distribution, "local-blocks", 3);
+			j_distribution_set(reference, "local-blocks", 3);
+		}
+
+		j_distribution_reset(distribution, 10 * block_size, 42);
+		j_distribution_reset(reference, 10 * block_size, 42);
+
+		total = 0;
+
+		while ((count = j_distribution_distribute_extents(distribution, extents, G_N_ELEMENTS(extents))) > 0)
+		{
+			g_assert_cmpuint(count, <=, G_N_ELEMENTS(extents));
+
+			for (guint j = 0; j < count; j++)
+			{
+				gboolean ret;
+				guint64 length;
+				guint64 offset;
+				guint64 block_id;
+				guint index;
+
+				ret = j_distribution_distribute(reference, &index, &length, &offset, &block_id);
+				g_assert(ret);
+
+				g_assert_cmpuint(extents[j].index, ==, index);
+				g_assert_cmpuint(extents[j].length, ==, length);
+				g_assert_cmpuint(extents[j].offset, ==, offset);
+				g_assert_cmpuint(extents[j].block_id, ==, block_id);
+			}
+
+			total += count;
+		}
+
+		g_assert_cmpuint(total, ==, 11);
+	}
+}
+
+static
+void
+test_distribution_rendezvous (JConfiguration** configuration, gconstpointer data)
+{
+	g_autoptr(JConfiguration) grown_configuration = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JDistribution) grown_distribution = NULL;
+	GKeyFile* key_file;
+	gchar const* servers[] = { "localhost", "localhost", "localhost", NULL };
+	guint const block_count = 3000;
+	guint moved = 0;
+	guint counts[3] = { 0, 0, 0 };
+
+	(void)data;
+
+	key_file = g_key_file_new();
+	g_key_file_set_string_list(key_file, "servers", "object", servers, 3);
+	g_key_file_set_string_list(key_file, "servers", "kv", servers, 3);
+	g_key_file_set_string(key_file, "object", "backend", "null");
+	g_key_file_set_string(key_file, "object", "component", "server");
+	g_key_file_set_string(key_file, "object", "path", "");
+	g_key_file_set_string(key_file, "kv", "backend", "null");
+	g_key_file_set_string(key_file, "kv", "component", "server");
+	g_key_file_set_string(key_file, "kv", "path", "");
+
+	grown_configuration = j_configuration_new_for_data(key_file);
+
+	g_key_file_free(key_file);
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_RENDEZVOUS, *configuration);
+	grown_distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_RENDEZVOUS, grown_configuration);
+
+	j_distribution_set_block_size(distribution, 1);
+	j_distribution_set_block_size(grown_distribution, 1);
+	j_distribution_set(distribution, "seed", 42);
+	j_distribution_set(grown_distribution, "seed", 42);
+
+	j_distribution_reset(distribution, block_count, 0);
+	j_distribution_reset(grown_distribution, block_count, 0);
+
+	for (guint i = 0; i < block_count; i++)
+	{
+		gboolean ret;
+		guint64 length;
+		guint64 offset;
+		guint64 block_id;
+		guint index;
+		guint grown_index;
+
+		ret = j_distribution_distribute(distribution, &index, &length, &offset, &block_id);
+		g_assert(ret);
+		g_assert_cmpuint(index, <, 2);
+		g_assert_cmpuint(offset, ==, i);
+
+		ret = j_distribution_distribute(grown_distribution, &grown_index, &length, &offset, &block_id);
+		g_assert(ret);
+		g_assert_cmpuint(grown_index, <, 3);
+
+		counts[grown_index]++;
+
+		/* Blocks only move to the new server. */
+		if (grown_index != index)
+		{
+			g_assert_cmpuint(grown_index, ==, 2);
+			moved++;
+		}
+	}
+
+	/* About a third of the blocks should have moved. */
+	g_assert_cmpuint(moved, >, block_count / 4);
+	g_assert_cmpuint(moved, <, block_count / 2);
+
+	for (guint i = 0; i < G_N_ELEMENTS(counts); i++)
+	{
+		g_assert_cmpuint(counts[i], >, block_count / 4);
+	}
+}
+
+static
+void
+test_distribution_replicated (JConfiguration** configuration, gconstpointer data)
+{
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(GHashTable) slots = NULL;
+	JDistributionExtent extents[8];
+	guint64 const block_size = 1000;
+	guint count;
+
+	(void)data;
+
+	slots = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_REPLICATED, *configuration);
+	j_distribution_set_block_size(distribution, block_size);
+	j_distribution_set(distribution, "replicas", 2);
+
+	g_assert_cmpuint(j_distribution_get_replica_count(distribution), ==, 2);
+
+	j_distribution_reset(distribution, 10 * block_size, 0);
+
+	while ((count = j_distribution_distribute_extents(distribution, extents, G_N_ELEMENTS(extents))) > 0)
+	{
+		for (guint i = 0; i < count; i++)
+		{
+			guint index;
+			guint64 offset;
+			guint replica_index;
+			guint64 replica_offset;
+
+			j_distribution_get_replica(distribution, &(extents[i]), 0, &index, &offset);
+			g_assert_cmpuint(index, ==, extents[i].index);
+			g_assert_cmpuint(offset, ==, extents[i].offset);
+
+			j_distribution_get_replica(distribution, &(extents[i]), 1, &replica_index, &replica_offset);
+			g_assert_cmpuint(replica_index, !=, index);
+
+			/* No two copies may share a slot on a server. */
+			g_assert(g_hash_table_add(slots, g_strdup_printf("%u:%" G_GUINT64_FORMAT, index, offset)));
+			g_assert(g_hash_table_add(slots, g_strdup_printf("%u:%" G_GUINT64_FORMAT, replica_index, replica_offset)));
+		}
+	}
+
+	g_assert_cmpuint(g_hash_table_size(slots), ==, 20);
+}
+
+static
+void
+test_distribution_erasure (JConfiguration** configuration, gconstpointer data)
+{
+	g_autoptr(JDistribution) distribution = NULL;
+	JDistributionExtent extents[8];
+	guint64 block_size;
+	guint data_count;
+	guint parity_count;
+	guint count;
+	gboolean ret;
+
+	(void)data;
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_ROUND_ROBIN, *configuration);
+	ret = j_distribution_get_stripe(distribution, &data_count, &parity_count, &block_size);
+	g_assert(!ret);
+
+	j_distribution_unref(distribution);
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_ERASURE, *configuration);
+	j_distribution_set_block_size(distribution, 1000);
+	j_distribution_set(distribution, "data-blocks", 1);
+	j_distribution_set(distribution, "parity-blocks", 1);
+
+	ret = j_distribution_get_stripe(distribution, &data_count, &parity_count, &block_size);
+	g_assert(ret);
+	g_assert_cmpuint(data_count, ==, 1);
+	g_assert_cmpuint(parity_count, ==, 1);
+	g_assert_cmpuint(block_size, ==, 1000);
+
+	j_distribution_reset(distribution, 10 * block_size, 42);
+
+	while ((count = j_distribution_distribute_extents(distribution, extents, G_N_ELEMENTS(extents))) > 0)
+	{
+		for (guint i = 0; i < count; i++)
+		{
+			guint64 stripe;
+			guint index;
+			guint64 offset;
+			guint parity_index;
+			guint64 parity_offset;
+
+			stripe = extents[i].block_id / data_count;
+
+			j_distribution_get_chunk(distribution, stripe, extents[i].block_id % data_count, &index, &offset);
+			g_assert_cmpuint(index, ==, extents[i].index);
+			g_assert_cmpuint(offset, ==, extents[i].offset - (extents[i].offset % block_size));
+
+			/* Parity is stored on another server at the same offset. */
+			j_distribution_get_chunk(distribution, stripe, data_count, &parity_index, &parity_offset);
+			g_assert_cmpuint(parity_index, !=, index);
+			g_assert_cmpuint(parity_offset, ==, offset);
+		}
+	}
+}
+
+static
+void
+test_distribution_block_size (JConfiguration** configuration, gconstpointer data)
+{
+	g_autoptr(JDistribution) distribution = NULL;
+	gboolean ret;
+
+	(void)data;
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_ROUND_ROBIN, *configuration);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, J_STRIPE_SIZE);
+	g_assert_cmpuint(j_distribution_get_optimal_access_size(distribution), ==, 2 * J_STRIPE_SIZE);
+
+	/* Small objects are still spread across both servers. */
+	j_distribution_set_expected_size(distribution, 1024 * 1024);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, 512 * 1024);
+	g_assert_cmpuint(j_distribution_get_optimal_access_size(distribution), ==, 1024 * 1024);
+
+	j_distribution_set_expected_size(distribution, 1);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, 64 * 1024);
+
+	/* Large objects use large blocks, but not arbitrarily large ones. */
+	j_distribution_set_expected_size(distribution, G_GUINT64_CONSTANT(1024) * 1024 * 1024 * 1024);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, 16 * J_STRIPE_SIZE);
+
+	/* Only adaptive distributions are changed by the first write. */
+	ret = j_distribution_adapt(distribution, 1024 * 1024);
+	g_assert(!ret);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, 16 * J_STRIPE_SIZE);
+
+	j_distribution_unref(distribution);
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_SINGLE_SERVER, *configuration);
+	j_distribution_set_adaptive(distribution);
+
+	ret = j_distribution_adapt(distribution, 1024 * 1024);
+	g_assert(ret);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, 1024 * 1024);
+
+	ret = j_distribution_adapt(distribution, 8 * 1024 * 1024);
+	g_assert(!ret);
+	g_assert_cmpuint(j_distribution_get_block_size(distribution), ==, 1024 * 1024);
+}
+
+static
+void
+test_distribution_local (JConfiguration** configuration, gconstpointer data)
+{
+	g_autoptr(JConfiguration) remote_configuration = NULL;
+	g_autoptr(JDistribution) distribution = NULL;
+	g_autoptr(JDistribution) remote_distribution = NULL;
+	GKeyFile* key_file;
+	bson_t* b;
+	bson_iter_t iterator;
+	gchar const* servers[] = { "julea-test-remote-1", "julea-test-remote-2", NULL };
+	/* Two local blocks, afterwards round robin starting on the other server. */
+	guint const indexes[] = { 0, 0, 1, 0, 1, 0 };
+	guint64 const offsets[] = { 0, 1000, 0, 2000, 1000, 3000 };
+	guint previous_index = 0;
+
+	(void)data;
+
+	distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_LOCAL, *configuration);
+
+	j_distribution_set_block_size(distribution, 1000);
+	j_distribution_set(distribution, "local-blocks", 2);
+
+	j_distribution_reset(distribution, 6 * 1000, 0);
+
+	for (guint i = 0; i < G_N_ELEMENTS(indexes); i++)
+	{
+		gboolean ret;
+		guint64 length;
+		guint64 offset;
+		guint64 block_id;
+		guint index;
+
+		ret = j_distribution_distribute(distribution, &index, &length, &offset, &block_id);
+		g_assert(ret);
+		g_assert_cmpuint(index, ==, indexes[i]);
+		g_assert_cmpuint(length, ==, 1000);
+		g_assert_cmpuint(offset, ==, offsets[i]);
+		g_assert_cmpuint(block_id, ==, i);
+	}
+
+	/* Readers on other hosts have to find the local server. */
+	b = j_distribution_serialize(distribution);
+
+	g_assert(bson_iter_init_find(&iterator, b, "index"));
+	g_assert_cmpint(bson_iter_int32(&iterator), ==, 0);
+	g_assert(bson_iter_init_find(&iterator, b, "local_blocks"));
+	g_assert_cmpint(bson_iter_int64(&iterator), ==, 2);
+
+	bson_destroy(b);
+	g_slice_free(bson_t, b);
+
+	key_file = g_key_file_new();
+	g_key_file_set_string_list(key_file, "servers", "object", servers, 2);
+	g_key_file_set_string_list(key_file, "servers", "kv", servers, 2);
+	g_key_file_set_string(key_file, "object", "backend", "null");
+	g_key_file_set_string(key_file, "object", "component", "server");
+	g_key_file_set_string(key_file, "object", "path", "");
+	g_key_file_set_string(key_file, "kv", "backend", "null");
+	g_key_file_set_string(key_file, "kv", "component", "server");
+	g_key_file_set_string(key_file, "kv", "path", "");
+
+	remote_configuration = j_configuration_new_for_data(key_file);
+
+	g_key_file_free(key_file);
+
+	/* Without a local server, all blocks are distributed in a round robin fashion. */
+	remote_distribution = j_distribution_new_for_configuration(J_DISTRIBUTION_LOCAL, remote_configuration);
+
+	j_distribution_set_block_size(remote_distribution, 1000);
+	j_distribution_reset(remote_distribution, 4 * 1000, 0);
+
+	for (guint i = 0; i < 4; i++)
+	{
+		gboolean ret;
+		guint64 length;
+		guint64 offset;
+		guint64 block_id;
+		guint index;
+
+		ret = j_distribution_distribute(remote_distribution, &index, &length, &offset, &block_id);
+		g_assert(ret);
+		g_assert_cmpuint(offset, ==, (i / 2) * 1000);
+
+		if (i > 0)
+		{
+			g_assert_cmpuint(index, !=, previous_index);
+		}
+
+		previous_index = index;
+	}
+}
+
 void
 test_distribution (void)
 {
 	g_test_add("/distribution/round_robin", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_round_robin, test_distribution_fixture_teardown);
 	g_test_add("/distribution/single_server", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_single_server, test_distribution_fixture_teardown);
 	g_test_add("/distribution/weighted", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_weighted, test_distribution_fixture_teardown);
+	g_test_add("/distribution/rendezvous", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_rendezvous, test_distribution_fixture_teardown);
+	g_test_add("/distribution/replicated", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_replicated, test_distribution_fixture_teardown);
+	g_test_add("/distribution/erasure", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_erasure, test_distribution_fixture_teardown);
+	g_test_add("/distribution/local", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_local, test_distribution_fixture_teardown);
+	g_test_add("/distribution/extents", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_extents, test_distribution_fixture_teardown);
+	g_test_add("/distribution/block_size", JConfiguration*, NULL, test_distribution_fixture_setup, test_distribution_block_size, test_distribution_fixture_teardown);
 }
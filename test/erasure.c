@@ -0,0 +1,116 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+#include <jerasure.h>
+
+#include "test.h"
+
+#define TEST_ERASURE_DATA 4
+#define TEST_ERASURE_PARITY 2
+#define TEST_ERASURE_LENGTH 1027
+
+static
+void
+test_erasure_encode_decode (void)
+{
+	JErasure* erasure;
+	gpointer blocks[TEST_ERASURE_DATA + TEST_ERASURE_PARITY];
+	gpointer original[TEST_ERASURE_DATA + TEST_ERASURE_PARITY];
+	gboolean present[TEST_ERASURE_DATA + TEST_ERASURE_PARITY];
+	gboolean ret;
+
+	erasure = j_erasure_new(TEST_ERASURE_DATA, TEST_ERASURE_PARITY);
+	g_assert(erasure != NULL);
+
+	for (guint i = 0; i < G_N_ELEMENTS(blocks); i++)
+	{
+		blocks[i] = g_malloc(TEST_ERASURE_LENGTH);
+		original[i] = g_malloc(TEST_ERASURE_LENGTH);
+	}
+
+	for (guint i = 0; i < TEST_ERASURE_DATA; i++)
+	{
+		guchar* data = blocks[i];
+
+		for (guint j = 0; j < TEST_ERASURE_LENGTH; j++)
+		{
+			data[j] = g_random_int();
+		}
+	}
+
+	j_erasure_encode(erasure, (gconstpointer const*)blocks, blocks + TEST_ERASURE_DATA, TEST_ERASURE_LENGTH);
+
+	for (guint i = 0; i < G_N_ELEMENTS(blocks); i++)
+	{
+		memcpy(original[i], blocks[i], TEST_ERASURE_LENGTH);
+	}
+
+	/* Lose every pair of blocks. */
+	for (guint i = 0; i < G_N_ELEMENTS(blocks); i++)
+	{
+		for (guint j = i + 1; j < G_N_ELEMENTS(blocks); j++)
+		{
+			for (guint l = 0; l < G_N_ELEMENTS(blocks); l++)
+			{
+				present[l] = (l != i && l != j);
+			}
+
+			memset(blocks[i], 0, TEST_ERASURE_LENGTH);
+			memset(blocks[j], 0, TEST_ERASURE_LENGTH);
+
+			ret = j_erasure_decode(erasure, blocks, present, TEST_ERASURE_LENGTH);
+			g_assert(ret);
+
+			for (guint l = 0; l < G_N_ELEMENTS(blocks); l++)
+			{
+				g_assert(memcmp(blocks[l], original[l], TEST_ERASURE_LENGTH) == 0);
+			}
+		}
+	}
+
+	/* Losing more blocks than there are parity blocks is not recoverable. */
+	for (guint i = 0; i < G_N_ELEMENTS(present); i++)
+	{
+		present[i] = (i > TEST_ERASURE_PARITY);
+	}
+
+	ret = j_erasure_decode(erasure, blocks, present, TEST_ERASURE_LENGTH);
+	g_assert(!ret);
+
+	for (guint i = 0; i < G_N_ELEMENTS(blocks); i++)
+	{
+		g_free(blocks[i]);
+		g_free(original[i]);
+	}
+
+	j_erasure_free(erasure);
+}
+
+void
+test_erasure (void)
+{
+	g_test_add_func("/erasure/encode_decode", test_erasure_encode_decode);
+}
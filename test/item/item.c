@@ -20,6 +20,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 #include <julea-item.h>
 
@@ -95,6 +97,200 @@ test_item_modification_time (JItem** item, gconstpointer data)
 	g_assert_cmpuint(j_item_get_modification_time(*item), >, 0);
 }
 
+static
+void
+test_item_attribute (JItem** item, gconstpointer data)
+{
+	g_autoptr(JBatch) batch = NULL;
+
+	(void)data;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	g_assert(j_item_get_attribute(*item, "units") == NULL);
+
+	j_item_set_attribute(*item, "units", "K", batch);
+	g_assert_cmpstr(j_item_get_attribute(*item, "units"), ==, "K");
+
+	j_item_set_attribute(*item, "units", "C", batch);
+	g_assert_cmpstr(j_item_get_attribute(*item, "units"), ==, "C");
+}
+
+static
+void
+test_item_snapshot (JItem** item, gconstpointer data)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JItem) snapshot = NULL;
+
+	(void)data;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	j_item_set_attribute(*item, "units", "K", batch);
+	snapshot = j_item_snapshot(*item, "test-snapshot", batch);
+
+	g_assert(snapshot != NULL);
+	g_assert_cmpstr(j_item_get_name(snapshot), ==, "test-snapshot");
+	g_assert_cmpuint(j_item_get_size(snapshot), ==, j_item_get_size(*item));
+	g_assert_cmpstr(j_item_get_attribute(snapshot, "units"), ==, "K");
+
+	/* The attributes are copied. */
+	j_item_set_attribute(*item, "units", "C", batch);
+	g_assert_cmpstr(j_item_get_attribute(snapshot, "units"), ==, "K");
+}
+
+static
+void
+test_item_rename (JItem** item, gconstpointer data)
+{
+	g_autoptr(JBatch) batch = NULL;
+
+	(void)data;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	j_item_set_attribute(*item, "units", "K", batch);
+	j_item_rename(*item, "test-renamed", batch);
+
+	g_assert_cmpstr(j_item_get_name(*item), ==, "test-renamed");
+	g_assert_cmpstr(j_item_get_attribute(*item, "units"), ==, "K");
+}
+
+/**
+ * Writes an item and reads its stored status using another handle.
+ */
+static
+void
+test_item_write_status (void)
+{
+	guint64 const size = 4096;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JCollection) collection = NULL;
+	g_autoptr(JItem) item = NULL;
+	g_autoptr(JItem) other = NULL;
+	g_autofree gchar* data = NULL;
+	guint64 bytes_written = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	collection = j_collection_create("test-collection-write-status", batch);
+	item = j_item_create(collection, "test-item", NULL, batch);
+	g_assert(j_batch_execute(batch));
+
+	data = g_malloc0(size);
+
+	j_item_write(item, data, size, size, &bytes_written, batch);
+	j_item_write(item, data, size, 0, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_written, ==, 2 * size);
+	g_assert_cmpuint(j_item_get_size(item), ==, 2 * size);
+
+	j_item_get(collection, &other, "test-item", batch);
+	g_assert(j_batch_execute(batch));
+
+	j_item_get_status(other, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(j_item_get_size(other), ==, 2 * size);
+	g_assert_cmpint(j_item_get_modification_time(other), >=, j_item_get_modification_time(item));
+
+	j_item_delete(item, batch);
+	j_collection_delete(collection, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Truncates, preallocates and punches holes into an item, whose data is striped across the servers.
+ * Preallocation and punching holes are optional for object backends.
+ */
+static
+void
+test_item_truncate (void)
+{
+	guint64 const size = 1024 * 1024;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JCollection) collection = NULL;
+	g_autoptr(JItem) item = NULL;
+	g_autoptr(JItem) other = NULL;
+	g_autofree gchar* data = NULL;
+	JDistribution* distribution;
+	g_autofree gchar* buffer = NULL;
+	guint64 bytes_written = 0;
+	guint64 bytes_read = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	distribution = j_distribution_new(J_DISTRIBUTION_ROUND_ROBIN);
+	j_distribution_set_block_size(distribution, size / 16);
+
+	/* The item takes over the distribution. */
+	collection = j_collection_create("test-collection-truncate", batch);
+	item = j_item_create(collection, "test-item", distribution, batch);
+	g_assert(j_batch_execute(batch));
+
+	data = g_malloc(size);
+	buffer = g_malloc0(size);
+	memset(data, 'a', size);
+
+	j_item_write(item, data, size, 0, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_written, ==, size);
+
+	/* The new size is not a multiple of the block size, so the servers keep different amounts of data. */
+	j_item_truncate(item, size / 4 + 1, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(j_item_get_size(item), ==, size / 4 + 1);
+
+	j_item_get(collection, &other, "test-item", batch);
+	g_assert(j_batch_execute(batch));
+
+	j_item_get_status(other, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(j_item_get_size(other), ==, size / 4 + 1);
+
+	/* Extending the item again fills it with zeros. */
+	j_item_truncate(item, size, batch);
+	j_item_read(item, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(buffer, data, size / 4 + 1) == 0);
+
+	for (guint64 i = size / 4 + 1; i < size; i++)
+	{
+		g_assert_cmpint(buffer[i], ==, 0);
+	}
+
+	/* Preallocating does not change the size. */
+	j_item_allocate(item, 2 * size, 0, batch);
+
+	if (j_batch_execute(batch))
+	{
+		g_assert_cmpuint(j_item_get_size(item), ==, size);
+	}
+
+	/* Holes span several servers and read as zeros. */
+	j_item_punch_hole(item, size / 8, size / 32, batch);
+
+	if (j_batch_execute(batch))
+	{
+		j_item_read(item, buffer, size, 0, &bytes_read, batch);
+		g_assert(j_batch_execute(batch));
+		g_assert_cmpuint(bytes_read, ==, size);
+		g_assert(memcmp(buffer, data, size / 32) == 0);
+
+		for (guint64 i = size / 32; i < size / 32 + size / 8; i++)
+		{
+			g_assert_cmpint(buffer[i], ==, 0);
+		}
+
+		g_assert(memcmp(buffer + size / 32 + size / 8, data, size / 4 + 1 - size / 32 - size / 8) == 0);
+	}
+
+	j_item_delete(item, batch);
+	j_collection_delete(collection, batch);
+	g_assert(j_batch_execute(batch));
+}
+
 void
 test_item (void)
 {
@@ -102,4 +298,9 @@ test_item (void)
 	g_test_add("/item/item/name", JItem*, NULL, test_item_fixture_setup, test_item_name, test_item_fixture_teardown);
 	g_test_add("/item/item/size", JItem*, NULL, test_item_fixture_setup, test_item_size, test_item_fixture_teardown);
 	g_test_add("/item/item/modification_time", JItem*, NULL, test_item_fixture_setup, test_item_modification_time, test_item_fixture_teardown);
+	g_test_add("/item/item/attribute", JItem*, NULL, test_item_fixture_setup, test_item_attribute, test_item_fixture_teardown);
+	g_test_add("/item/item/snapshot", JItem*, NULL, test_item_fixture_setup, test_item_snapshot, test_item_fixture_teardown);
+	g_test_add("/item/item/rename", JItem*, NULL, test_item_fixture_setup, test_item_rename, test_item_fixture_teardown);
+	g_test_add_func("/item/item/write_status", test_item_write_status);
+	g_test_add_func("/item/item/truncate", test_item_truncate);
 }
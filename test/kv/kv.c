@@ -0,0 +1,456 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <bson.h>
+
+#include <julea.h>
+#include <julea-kv.h>
+
+#include "test.h"
+
+struct TestKVField
+{
+	gchar const* name;
+	gint64 value;
+};
+
+typedef struct TestKVField TestKVField;
+
+static
+void
+test_kv_get_int64_callback (bson_t const* value, gpointer data)
+{
+	TestKVField* field = data;
+	bson_iter_t iter;
+
+	if (bson_iter_init_find(&iter, value, field->name) && BSON_ITER_HOLDS_NUMBER(&iter))
+	{
+		field->value = bson_iter_as_int64(&iter);
+	}
+}
+
+/**
+ * Returns an integer field of a stored value, G_MININT64 if it does not exist.
+ */
+static
+gint64
+test_kv_get_int64 (JKV* kv, gchar const* name)
+{
+	g_autoptr(JBatch) batch = NULL;
+	TestKVField field;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	field.name = name;
+	field.value = G_MININT64;
+
+	j_kv_get_callback(kv, test_kv_get_int64_callback, &field, batch);
+	g_assert(j_batch_execute(batch));
+
+	return field.value;
+}
+
+/**
+ * Puts a value with a single integer field.
+ */
+static
+void
+test_kv_put_int64 (JKV* kv, gchar const* name, gint64 value, JBatch* batch)
+{
+	bson_t* b;
+
+	b = g_slice_new(bson_t);
+	bson_init(b);
+	bson_append_int64(b, name, -1, value);
+
+	j_kv_put(kv, b, batch);
+}
+
+/**
+ * Swaps values based on their versions.
+ * A swap with a stale version fails and returns the current version.
+ */
+static
+void
+test_kv_compare_and_swap (void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	bson_t value[1];
+	guint64 version = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new("test", "test-kv-compare-and-swap");
+
+	j_kv_delete(kv, batch);
+	j_batch_execute(batch);
+
+	bson_init(value);
+	bson_append_int64(value, "generation", -1, 1);
+
+	/* The key does not exist yet. */
+	j_kv_compare_and_swap(kv, 0, value, &version, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(version, ==, 1);
+
+	/* The key exists now. */
+	j_kv_compare_and_swap(kv, 0, value, &version, batch);
+	g_assert(!j_batch_execute(batch));
+
+	bson_reinit(value);
+	bson_append_int64(value, "generation", -1, 2);
+
+	j_kv_compare_and_swap(kv, 1, value, &version, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(version, ==, 2);
+
+	/* Version 1 is stale. */
+	bson_reinit(value);
+	bson_append_int64(value, "generation", -1, 3);
+
+	j_kv_compare_and_swap(kv, 1, value, &version, batch);
+	g_assert(!j_batch_execute(batch));
+	g_assert_cmpuint(version, ==, 2);
+
+	g_assert_cmpint(test_kv_get_int64(kv, "generation"), ==, 2);
+
+	bson_destroy(value);
+
+	j_kv_delete(kv, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Increments fields, missing ones start at 0.
+ */
+static
+void
+test_kv_increment (void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	gint64 result = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new("test", "test-kv-increment");
+
+	j_kv_delete(kv, batch);
+	j_batch_execute(batch);
+
+	j_kv_increment(kv, "count", 2, &result, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpint(result, ==, 2);
+
+	j_kv_increment(kv, "count", -3, &result, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpint(result, ==, -1);
+
+	j_kv_increment(kv, "other", 5, NULL, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpint(test_kv_get_int64(kv, "count"), ==, -1);
+	g_assert_cmpint(test_kv_get_int64(kv, "other"), ==, 5);
+
+	j_kv_delete(kv, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Merges maxima into a value, smaller numbers do not replace larger ones.
+ */
+static
+void
+test_kv_max_merge (void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	bson_t maxima[1];
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new("test", "test-kv-max-merge");
+
+	j_kv_delete(kv, batch);
+	j_batch_execute(batch);
+
+	/* Missing values are created. */
+	bson_init(maxima);
+	bson_append_int64(maxima, "size", -1, 100);
+	j_kv_max_merge(kv, maxima, batch);
+	bson_destroy(maxima);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpint(test_kv_get_int64(kv, "size"), ==, 100);
+
+	bson_init(maxima);
+	bson_append_int64(maxima, "size", -1, 50);
+	bson_append_int64(maxima, "time", -1, 7);
+	j_kv_max_merge(kv, maxima, batch);
+	bson_destroy(maxima);
+
+	/* Max-merges of the same batch are combined. */
+	bson_init(maxima);
+	bson_append_int64(maxima, "size", -1, 150);
+	j_kv_max_merge(kv, maxima, batch);
+	bson_destroy(maxima);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpint(test_kv_get_int64(kv, "size"), ==, 150);
+	g_assert_cmpint(test_kv_get_int64(kv, "time"), ==, 7);
+
+	j_kv_delete(kv, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+static
+void
+test_kv_get_many_callback_func (GBytes** values, guint32 count, gpointer data)
+{
+	gint64* sizes = data;
+
+	for (guint32 i = 0; i < count; i++)
+	{
+		bson_t value[1];
+		bson_iter_t iter;
+		gconstpointer value_data;
+		gsize len;
+
+		if (values[i] == NULL)
+		{
+			continue;
+		}
+
+		value_data = g_bytes_get_data(values[i], &len);
+		g_assert(bson_init_static(value, value_data, len));
+
+		if (bson_iter_init_find(&iter, value, "size"))
+		{
+			sizes[i] = bson_iter_as_int64(&iter);
+		}
+	}
+}
+
+/**
+ * Gets several values at once, missing ones are reported as NULL.
+ */
+static
+void
+test_kv_get_many_callback (void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	JKV* kvs[3];
+	gint64 sizes[3] = { -1, -1, -1 };
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	for (guint i = 0; i < G_N_ELEMENTS(kvs); i++)
+	{
+		g_autofree gchar* key = NULL;
+
+		key = g_strdup_printf("test-kv-get-many-%u", i);
+		kvs[i] = j_kv_new("test", key);
+
+		j_kv_delete(kvs[i], batch);
+	}
+
+	j_batch_execute(batch);
+
+	test_kv_put_int64(kvs[0], "size", 10, batch);
+	test_kv_put_int64(kvs[2], "size", 30, batch);
+	g_assert(j_batch_execute(batch));
+
+	/* Like other gets, the batch reports the missing value as an error. */
+	j_kv_get_many_callback(kvs, G_N_ELEMENTS(kvs), test_kv_get_many_callback_func, sizes, batch);
+	j_batch_execute(batch);
+
+	g_assert_cmpint(sizes[0], ==, 10);
+	g_assert_cmpint(sizes[1], ==, -1);
+	g_assert_cmpint(sizes[2], ==, 30);
+
+	for (guint i = 0; i < G_N_ELEMENTS(kvs); i++)
+	{
+		j_kv_delete(kvs[i], batch);
+		j_kv_unref(kvs[i]);
+	}
+
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Iterates over the values whose indexed field lies within a range.
+ */
+static
+void
+test_kv_index (void)
+{
+	guint const n = 5;
+
+	g_autoptr(JBatch) batch = NULL;
+	JKVIterator* iterator;
+	bson_t range[1];
+	guint count = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+
+	j_kv_create_index("test-kv-index", "size", batch);
+	g_assert(j_batch_execute(batch));
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JKV) kv = NULL;
+		g_autofree gchar* key = NULL;
+
+		key = g_strdup_printf("test-kv-index-%u", i);
+		kv = j_kv_new("test-kv-index", key);
+
+		test_kv_put_int64(kv, "size", i * 10, batch);
+	}
+
+	g_assert(j_batch_execute(batch));
+
+	bson_init(range);
+	bson_append_int64(range, "$gte", -1, 20);
+	bson_append_int64(range, "$lt", -1, 40);
+
+	iterator = j_kv_iterator_new_index("test-kv-index", "size", range, NULL);
+
+	while (j_kv_iterator_next(iterator))
+	{
+		bson_iter_t iter;
+
+		g_assert(bson_iter_init_find(&iter, j_kv_iterator_get(iterator), "size"));
+		g_assert_cmpint(bson_iter_as_int64(&iter), >=, 20);
+		g_assert_cmpint(bson_iter_as_int64(&iter), <, 40);
+
+		count++;
+	}
+
+	j_kv_iterator_free(iterator);
+	bson_destroy(range);
+
+	g_assert_cmpuint(count, ==, 2);
+
+	j_kv_delete_by_prefix("test-kv-index", "test-kv-index-", batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Puts and gets opaque values, including empty ones.
+ */
+static
+void
+test_kv_raw (void)
+{
+	guint8 const data[] = { 0, 1, 2, 0, 255 };
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autoptr(JKV) empty = NULL;
+	g_autoptr(GBytes) value = NULL;
+	g_autoptr(GBytes) empty_value = NULL;
+	g_autoptr(GBytes) result = NULL;
+	g_autoptr(GBytes) empty_result = NULL;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new("test-kv-raw", "test-kv-raw");
+	empty = j_kv_new("test-kv-raw", "test-kv-raw-empty");
+
+	value = g_bytes_new_static(data, sizeof(data));
+	empty_value = g_bytes_new_static("", 0);
+
+	j_kv_put_raw(kv, value, batch);
+	j_kv_put_raw(empty, empty_value, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_kv_get_raw(kv, &result, batch);
+	j_kv_get_raw(empty, &empty_result, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert(result != NULL);
+	g_assert(g_bytes_equal(result, value));
+
+	/* Empty values exist, too. */
+	g_assert(empty_result != NULL);
+	g_assert_cmpuint(g_bytes_get_size(empty_result), ==, 0);
+
+	j_kv_delete(kv, batch);
+	j_kv_delete(empty, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Watches a prefix and receives the changes of a key.
+ */
+static
+void
+test_kv_watch (void)
+{
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JKV) kv = NULL;
+	g_autoptr(JKV) other = NULL;
+	g_autoptr(JKVWatch) watch = NULL;
+	bson_iter_t iter;
+
+	watch = j_kv_watch_new("test-kv-watch", "watched/", TRUE);
+
+	if (watch == NULL)
+	{
+		g_test_skip("Watches require key-value servers.");
+		return;
+	}
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	kv = j_kv_new("test-kv-watch", "watched/key");
+	other = j_kv_new("test-kv-watch", "other/key");
+
+	/* Changes outside of the prefix are not reported. */
+	test_kv_put_int64(other, "size", 1, batch);
+	test_kv_put_int64(kv, "size", 42, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert(j_kv_watch_next(watch, 5 * G_USEC_PER_SEC));
+	g_assert_cmpstr(j_kv_watch_get_key(watch), ==, "watched/key");
+	g_assert(!j_kv_watch_is_deleted(watch));
+	g_assert(bson_iter_init_find(&iter, j_kv_watch_get(watch), "size"));
+	g_assert_cmpint(bson_iter_as_int64(&iter), ==, 42);
+
+	j_kv_delete(kv, batch);
+	j_kv_delete(other, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert(j_kv_watch_next(watch, 5 * G_USEC_PER_SEC));
+	g_assert_cmpstr(j_kv_watch_get_key(watch), ==, "watched/key");
+	g_assert(j_kv_watch_is_deleted(watch));
+
+	g_assert(!j_kv_watch_next(watch, G_USEC_PER_SEC / 10));
+}
+
+void
+test_kv (void)
+{
+	g_test_add_func("/kv/compare-and-swap", test_kv_compare_and_swap);
+	g_test_add_func("/kv/increment", test_kv_increment);
+	g_test_add_func("/kv/index", test_kv_index);
+	g_test_add_func("/kv/max-merge", test_kv_max_merge);
+	g_test_add_func("/kv/get-many-callback", test_kv_get_many_callback);
+	g_test_add_func("/kv/watch", test_kv_watch);
+	g_test_add_func("/kv/raw", test_kv_raw);
+}
@@ -122,6 +122,38 @@ test_list_get (JList** list, gconstpointer data)
 	g_assert_cmpstr(s, ==, "-1");
 }
 
+static
+void
+test_list_move_all (JList** list, gconstpointer data)
+{
+	g_autoptr(JList) other = NULL;
+	gchar const* s;
+
+	(void)data;
+
+	other = j_list_new(g_free);
+
+	j_list_append(*list, g_strdup("0"));
+	j_list_append(other, g_strdup("1"));
+	j_list_append(other, g_strdup("2"));
+
+	j_list_move_all(*list, other);
+
+	g_assert_cmpuint(j_list_length(*list), ==, 3);
+	g_assert_cmpuint(j_list_length(other), ==, 0);
+
+	s = j_list_get_first(*list);
+	g_assert_cmpstr(s, ==, "0");
+	s = j_list_get_last(*list);
+	g_assert_cmpstr(s, ==, "2");
+
+	j_list_append(other, g_strdup("3"));
+	j_list_move_all(*list, other);
+
+	s = j_list_get_last(*list);
+	g_assert_cmpstr(s, ==, "3");
+}
+
 void
 test_list (void)
 {
@@ -130,4 +162,5 @@ test_list (void)
 	g_test_add("/list/append", JList*, NULL, test_list_fixture_setup, test_list_append, test_list_fixture_teardown);
 	g_test_add("/list/prepend", JList*, NULL, test_list_fixture_setup, test_list_prepend, test_list_fixture_teardown);
 	g_test_add("/list/get", JList*, NULL, test_list_fixture_setup, test_list_get, test_list_fixture_teardown);
+	g_test_add("/list/move_all", JList*, NULL, test_list_fixture_setup, test_list_move_all, test_list_fixture_teardown);
 }
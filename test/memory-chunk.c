@@ -20,6 +20,8 @@
 
 #include <glib.h>
 
+#include <string.h>
+
 #include <julea.h>
 
 #include <jmemory-chunk.h>
@@ -83,10 +85,46 @@ test_memory_chunk_reset (void)
 	j_memory_chunk_free(memory_chunk);
 }
 
+static
+void
+test_memory_chunk_growable (void)
+{
+	JMemoryChunk* memory_chunk;
+	gchar* ret1;
+	gchar* ret2;
+	gchar* ret3;
+
+	memory_chunk = j_memory_chunk_new_growable(2);
+
+	ret1 = j_memory_chunk_get(memory_chunk, 2);
+	g_assert(ret1 != NULL);
+	ret2 = j_memory_chunk_get(memory_chunk, 1);
+	g_assert(ret2 != NULL);
+	ret3 = j_memory_chunk_get(memory_chunk, 42);
+	g_assert(ret3 != NULL);
+
+	memset(ret1, 1, 2);
+	memset(ret2, 2, 1);
+	memset(ret3, 3, 42);
+
+	g_assert_cmpint(ret1[0], ==, 1);
+	g_assert_cmpint(ret1[1], ==, 1);
+	g_assert_cmpint(ret2[0], ==, 2);
+	g_assert_cmpint(ret3[41], ==, 3);
+
+	j_memory_chunk_reset(memory_chunk);
+
+	ret1 = j_memory_chunk_get(memory_chunk, 2);
+	g_assert(ret1 != NULL);
+
+	j_memory_chunk_free(memory_chunk);
+}
+
 void
 test_memory_chunk (void)
 {
 	g_test_add_func("/memory-chunk/new_free", test_memory_chunk_new_free);
 	g_test_add_func("/memory-chunk/get", test_memory_chunk_get);
 	g_test_add_func("/memory-chunk/reset", test_memory_chunk_reset);
+	g_test_add_func("/memory-chunk/growable", test_memory_chunk_growable);
 }
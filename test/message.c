@@ -23,6 +23,8 @@
 
 #include <string.h>
 
+#include <sys/socket.h>
+
 #include <julea.h>
 
 #include <jmessage.h>
@@ -152,6 +154,178 @@ test_message_write_read (void)
 	g_assert_cmpuint(dummy_8, ==, 2342);
 	dummy_str = j_message_get_string(message_recv);
 	g_assert_cmpstr(dummy_str, ==, "42");
+
+	j_message_rewind(message_recv);
+
+	dummy_1 = j_message_get_1(message_recv);
+	g_assert_cmpint(dummy_1, ==, 23);
+}
+
+static
+void
+test_message_checksum (void)
+{
+	gchar const* data = "123456789";
+	guint32 checksum;
+
+	checksum = j_helper_crc32c(0, data, strlen(data));
+	g_assert_cmpuint(checksum, ==, 0xE3069283);
+
+	checksum = j_helper_crc32c(0, data, 4);
+	checksum = j_helper_crc32c(checksum, data + 4, strlen(data) - 4);
+	g_assert_cmpuint(checksum, ==, 0xE3069283);
+}
+
+static
+void
+test_message_varint (void)
+{
+	g_autoptr(JMessage) message = NULL;
+
+	message = j_message_new(J_MESSAGE_NONE, 0);
+	j_message_set_compact(message, TRUE);
+
+	j_message_add_operation(message, 3 * sizeof(guint64));
+	j_message_append_varint(message, 0);
+	j_message_append_varint(message, 300);
+	j_message_append_varint(message, G_MAXUINT64);
+
+	/* 1 + 2 + 10 bytes */
+	g_assert_cmpuint(j_message_get_length(message), ==, 13);
+
+	j_message_rewind(message);
+
+	g_assert_cmpuint(j_message_get_varint(message), ==, 0);
+	g_assert_cmpuint(j_message_get_varint(message), ==, 300);
+	g_assert_cmpuint(j_message_get_varint(message), ==, G_MAXUINT64);
+}
+
+static
+void
+test_message_length64 (void)
+{
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GInputStream) input = NULL;
+	gchar const* body = "Hello world!";
+	guint32 header[6];
+	gboolean ret;
+
+	/* Messages longer than 4 GiB are too large for a test, so only the encoding is checked. */
+	header[0] = GUINT32_TO_LE(strlen(body) + 1);
+	header[1] = GUINT32_TO_LE(42);
+	header[2] = GUINT32_TO_LE(J_MESSAGE_FLAGS_LENGTH64);
+	header[3] = GUINT32_TO_LE(J_MESSAGE_NONE);
+	header[4] = GUINT32_TO_LE(1);
+	header[5] = GUINT32_TO_LE(0);
+
+	input = g_memory_input_stream_new();
+	g_memory_input_stream_add_data(G_MEMORY_INPUT_STREAM(input), header, sizeof(header), NULL);
+	g_memory_input_stream_add_data(G_MEMORY_INPUT_STREAM(input), body, strlen(body) + 1, NULL);
+
+	message = j_message_new(J_MESSAGE_NONE, 0);
+
+	ret = j_message_read(message, input);
+	g_assert(ret);
+
+	g_assert_cmpuint(j_message_get_id(message), ==, 42);
+	g_assert_cmpuint(j_message_get_flags(message), ==, J_MESSAGE_FLAGS_NONE);
+	g_assert_cmpuint(j_message_get_length(message), ==, strlen(body) + 1);
+	g_assert_cmpstr(j_message_get_string(message), ==, body);
+}
+
+static
+void
+test_message_decompress_length (void)
+{
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(GInputStream) input = NULL;
+	guint32 header[5];
+	guint32 body[2];
+	gboolean ret;
+
+	/* The body claims to decompress to 4 GiB, which has to be rejected before it is allocated. */
+	body[0] = GUINT32_TO_LE(G_MAXUINT32);
+	body[1] = 0;
+
+	header[0] = GUINT32_TO_LE(sizeof(body));
+	header[1] = GUINT32_TO_LE(42);
+	header[2] = GUINT32_TO_LE(J_MESSAGE_FLAGS_COMPRESSED);
+	header[3] = GUINT32_TO_LE(J_MESSAGE_NONE);
+	header[4] = GUINT32_TO_LE(1);
+
+	input = g_memory_input_stream_new();
+	g_memory_input_stream_add_data(G_MEMORY_INPUT_STREAM(input), header, sizeof(header), NULL);
+	g_memory_input_stream_add_data(G_MEMORY_INPUT_STREAM(input), body, sizeof(body), NULL);
+
+	message = j_message_new(J_MESSAGE_NONE, 0);
+
+	g_test_expect_message(NULL, G_LOG_LEVEL_CRITICAL, "*");
+	ret = j_message_read(message, input);
+	g_test_assert_expected_messages();
+
+	g_assert(!ret);
+}
+
+static
+void
+test_message_receive_body (void)
+{
+	for (guint i = 0; i < 2; i++)
+	{
+		g_autoptr(GSocket) socket_send = NULL;
+		g_autoptr(GSocket) socket_receive = NULL;
+		g_autoptr(GSocketConnection) connection_send = NULL;
+		g_autoptr(GSocketConnection) connection_receive = NULL;
+		g_autoptr(JMessage) message_send = NULL;
+		g_autoptr(JMessage) message_receive = NULL;
+		g_autofree gchar* body = NULL;
+		g_autofree gchar* received = NULL;
+		gsize const body_length = 16 * 1024;
+		guint64 length;
+		gint fds[2];
+		gboolean ret;
+
+		g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+
+		socket_send = g_socket_new_from_fd(fds[0], NULL);
+		socket_receive = g_socket_new_from_fd(fds[1], NULL);
+		connection_send = g_socket_connection_factory_create_connection(socket_send);
+		connection_receive = g_socket_connection_factory_create_connection(socket_receive);
+
+		/* Compressed bodies are received as a whole, uncompressed ones are streamed. */
+		j_message_set_compression(connection_send, (i == 1));
+		j_message_set_checksum(connection_send, TRUE);
+
+		body = g_malloc(body_length);
+		received = g_malloc(body_length);
+
+		for (gsize j = 0; j < body_length; j++)
+		{
+			body[j] = (i == 1) ? 'a' : (gchar)g_random_int();
+		}
+
+		/* The body fits into the socket's buffer, so sending does not block. */
+		message_send = j_message_new(J_MESSAGE_NONE, body_length);
+		j_message_add_operation(message_send, body_length);
+		j_message_append_n(message_send, body, body_length);
+
+		ret = j_message_send(message_send, connection_send);
+		g_assert(ret);
+
+		message_receive = j_message_new(J_MESSAGE_NONE, 0);
+
+		ret = j_message_receive_header(message_receive, connection_receive, &length);
+		g_assert(ret);
+		g_assert_cmpuint(length, ==, body_length);
+		g_assert_cmpuint(j_message_get_count(message_receive), ==, 1);
+
+		ret = j_message_receive_body(message_receive, connection_receive, received, 1000);
+		g_assert(ret);
+		ret = j_message_receive_body(message_receive, connection_receive, received + 1000, body_length - 1000);
+		g_assert(ret);
+
+		g_assert(memcmp(body, received, body_length) == 0);
+	}
 }
 
 void
@@ -161,4 +335,9 @@ test_message (void)
 	g_test_add_func("/message/header", test_message_header);
 	g_test_add_func("/message/append", test_message_append);
 	g_test_add_func("/message/write_read", test_message_write_read);
+	g_test_add_func("/message/checksum", test_message_checksum);
+	g_test_add_func("/message/varint", test_message_varint);
+	g_test_add_func("/message/length64", test_message_length64);
+	g_test_add_func("/message/decompress_length", test_message_decompress_length);
+	g_test_add_func("/message/receive_body", test_message_receive_body);
 }
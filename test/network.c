@@ -0,0 +1,149 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+#include <jconnection-pool.h>
+#include <jmessage.h>
+
+#include "test.h"
+
+/**
+ * Connects to the first object server, NULL if there is none.
+ * Pinging without any capabilities disables compression and checksums for the server's replies.
+ */
+static
+GSocketConnection*
+test_network_connect (void)
+{
+	GSocketConnection* connection;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+
+	if (j_object_backend() != NULL || j_configuration_get_object_server_count(j_configuration()) == 0)
+	{
+		return NULL;
+	}
+
+	connection = j_connection_pool_connect_object(0);
+	g_assert(connection != NULL);
+
+	message = j_message_new(J_MESSAGE_PING, 0);
+	reply = j_message_new_reply(message);
+	g_assert(j_message_send(message, connection));
+	g_assert(j_message_receive(reply, connection));
+
+	j_message_set_compression(connection, FALSE);
+	j_message_set_checksum(connection, FALSE);
+
+	return connection;
+}
+
+/**
+ * Sends an echo with a payload, immediately followed by a ping.
+ * Pipelining servers receive the ping while the echo is still being executed, so they must not mistake the payload for it.
+ */
+static
+void
+test_network_echo (void)
+{
+	guint64 const size = 64 * 1024;
+
+	GSocketConnection* connection;
+	GInputStream* input;
+	g_autofree gchar* payload = NULL;
+	g_autofree gchar* echo = NULL;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) ping = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	guint64 received = 0;
+
+	if ((connection = test_network_connect()) == NULL)
+	{
+		g_test_skip("Echoes require object servers.");
+		return;
+	}
+
+	input = g_io_stream_get_input_stream(G_IO_STREAM(connection));
+
+	payload = g_malloc(size);
+	echo = g_malloc0(size);
+
+	for (guint64 i = 0; i < size; i++)
+	{
+		payload[i] = i % 251;
+	}
+
+	message = j_message_new(J_MESSAGE_ECHO, 0);
+	j_message_add_operation(message, sizeof(guint64));
+	j_message_append_varint(message, size);
+	j_message_add_send(message, payload, size);
+
+	ping = j_message_new(J_MESSAGE_PING, 0);
+
+	g_assert(j_message_send(message, connection));
+	g_assert(j_message_send(ping, connection));
+
+	reply = j_message_new(J_MESSAGE_NONE, 0);
+
+	/* The payload is echoed in pieces, each in a reply of its own. */
+	while (received < size)
+	{
+		guint32 operation_count;
+
+		g_assert(j_message_receive(reply, connection));
+		g_assert(j_message_get_type(reply) == J_MESSAGE_ECHO);
+
+		operation_count = j_message_get_count(reply);
+
+		for (guint32 i = 0; i < operation_count; i++)
+		{
+			guint64 nbytes;
+
+			nbytes = j_message_get_varint(reply);
+			g_assert_cmpuint(received + nbytes, <=, size);
+
+			if (nbytes > 0)
+			{
+				g_assert(g_input_stream_read_all(input, echo + received, nbytes, NULL, NULL, NULL));
+				received += nbytes;
+			}
+		}
+	}
+
+	g_assert(memcmp(payload, echo, size) == 0);
+
+	g_assert(j_message_receive(reply, connection));
+	g_assert(j_message_get_type(reply) == J_MESSAGE_PING);
+
+	g_io_stream_close(G_IO_STREAM(connection), NULL, NULL);
+	g_object_unref(connection);
+}
+
+void
+test_network (void)
+{
+	g_test_add_func("/network/echo", test_network_echo);
+}
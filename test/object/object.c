@@ -0,0 +1,559 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+#include <julea-object.h>
+
+#include "test.h"
+
+/**
+ * Reads an object that is much larger than the socket buffers.
+ * Servers send such reads in many steps, all of which have to arrive intact.
+ */
+static
+void
+test_object_read_large (void)
+{
+	guint64 const size = 32 * 1024 * 1024;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buffer = NULL;
+	guint64 bytes_written = 0;
+	guint64 bytes_read = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-read-large");
+
+	data = g_malloc(size);
+	buffer = g_malloc0(size);
+
+	for (guint64 i = 0; i < size; i++)
+	{
+		data[i] = i % 251;
+	}
+
+	j_object_create(object, batch);
+	j_object_write(object, data, size, 0, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_written, ==, size);
+
+	j_object_read(object, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(data, buffer, size) == 0);
+
+	j_object_delete(object, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Truncates, preallocates and punches holes into an object.
+ * Preallocation and punching holes are optional for object backends.
+ */
+static
+void
+test_object_truncate (void)
+{
+	guint64 const size = 4096;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buffer = NULL;
+	gint64 modification_time = 0;
+	guint64 object_size = 0;
+	guint64 bytes_written = 0;
+	guint64 bytes_read = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-truncate");
+
+	data = g_malloc(size);
+	buffer = g_malloc0(size);
+	memset(data, 'a', size);
+
+	j_object_create(object, batch);
+	j_object_write(object, data, size, 0, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_written, ==, size);
+
+	/* Truncating shrinks the object. */
+	j_object_truncate(object, size / 4, batch);
+	j_object_status(object, &modification_time, &object_size, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(object_size, ==, size / 4);
+
+	/* Extending the object again fills it with zeros. */
+	j_object_truncate(object, size, batch);
+	j_object_read(object, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(buffer, data, size / 4) == 0);
+
+	for (guint64 i = size / 4; i < size; i++)
+	{
+		g_assert_cmpint(buffer[i], ==, 0);
+	}
+
+	/* Preallocating does not change the size. */
+	j_object_allocate(object, 2 * size, 0, batch);
+
+	if (j_batch_execute(batch))
+	{
+		j_object_status(object, &modification_time, &object_size, batch);
+		g_assert(j_batch_execute(batch));
+		g_assert_cmpuint(object_size, ==, size);
+	}
+
+	/* Holes read as zeros and do not change the size either. */
+	j_object_punch_hole(object, size / 8, 0, batch);
+
+	if (j_batch_execute(batch))
+	{
+		j_object_read(object, buffer, size, 0, &bytes_read, batch);
+		g_assert(j_batch_execute(batch));
+		g_assert_cmpuint(bytes_read, ==, size);
+
+		for (guint64 i = 0; i < size / 8; i++)
+		{
+			g_assert_cmpint(buffer[i], ==, 0);
+		}
+
+		g_assert(memcmp(buffer + size / 8, data + size / 8, size / 8) == 0);
+	}
+
+	j_object_delete(object, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Copies an object on its server.
+ */
+static
+void
+test_object_copy (void)
+{
+	guint64 const size = 64 * 1024;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autoptr(JObject) copy = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buffer = NULL;
+	guint64 bytes_written = 0;
+	guint64 bytes_copied = 0;
+	guint64 bytes_read = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-copy");
+	copy = j_object_new("test", "test-object-copy-copy");
+
+	data = g_malloc(size);
+	buffer = g_malloc0(size);
+
+	for (guint64 i = 0; i < size; i++)
+	{
+		data[i] = i % 251;
+	}
+
+	j_object_create(object, batch);
+	j_object_write(object, data, size, 0, &bytes_written, batch);
+	j_object_copy(object, copy, &bytes_copied, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_copied, ==, size);
+
+	j_object_read(copy, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(data, buffer, size) == 0);
+
+	/* The copy is independent of the original. */
+	j_object_delete(object, batch);
+	j_object_read(copy, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(data, buffer, size) == 0);
+
+	j_object_delete(copy, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Lists the objects of a namespace whose paths start with a prefix.
+ */
+static
+void
+test_object_iterator (void)
+{
+	guint const n = 10;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(GHashTable) paths = NULL;
+	g_autoptr(JObject) other = NULL;
+	JObjectIterator* iterator;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* path = NULL;
+
+		path = g_strdup_printf("test-object-iterator/%u", i);
+		object = j_object_new("test", path);
+
+		j_object_create(object, batch);
+	}
+
+	/* Objects outside of the prefix are not listed. */
+	other = j_object_new("test", "test-object-iterator-other");
+	j_object_create(other, batch);
+
+	g_assert(j_batch_execute(batch));
+
+	iterator = j_object_iterator_new("test", "test-object-iterator/");
+
+	while (j_object_iterator_next(iterator))
+	{
+		gchar const* path;
+
+		path = j_object_iterator_get(iterator, NULL);
+
+		g_assert(g_str_has_prefix(path, "test-object-iterator/"));
+		g_assert(!g_hash_table_contains(paths, path));
+
+		g_hash_table_add(paths, g_strdup(path));
+	}
+
+	j_object_iterator_free(iterator);
+
+	g_assert_cmpuint(g_hash_table_size(paths), ==, n);
+
+	for (guint i = 0; i < n; i++)
+	{
+		g_autoptr(JObject) object = NULL;
+		g_autofree gchar* path = NULL;
+
+		path = g_strdup_printf("test-object-iterator/%u", i);
+		object = j_object_new("test", path);
+
+		j_object_delete(object, batch);
+	}
+
+	j_object_delete(other, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Appends records to an object, which are placed at increasing offsets.
+ */
+static
+void
+test_object_append (void)
+{
+	guint const n = 4;
+	guint64 const length = 100;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* data = NULL;
+	gint64 modification_time = 0;
+	guint64 size = 0;
+	guint64 offsets[4];
+	guint64 bytes_read = 0;
+	gchar buffer[100];
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-append");
+
+	data = g_malloc(n * length);
+
+	for (guint i = 0; i < n; i++)
+	{
+		memset(data + i * length, 'a' + i, length);
+	}
+
+	j_object_delete(object, batch);
+	j_batch_execute(batch);
+
+	/* The object is created by the first append. */
+	for (guint i = 0; i < n; i++)
+	{
+		j_object_append(object, data + i * length, length, &(offsets[i]), batch);
+		g_assert(j_batch_execute(batch));
+
+		g_assert_cmpuint(offsets[i], ==, i * length);
+	}
+
+	j_object_status(object, &modification_time, &size, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(size, ==, n * length);
+
+	/* Appends of the same batch are placed one after another, too. */
+	j_object_append(object, data, length, &(offsets[0]), batch);
+	j_object_append(object, data + length, length, &(offsets[1]), batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpuint(MIN(offsets[0], offsets[1]), ==, n * length);
+	g_assert_cmpuint(MAX(offsets[0], offsets[1]), ==, (n + 1) * length);
+
+	j_object_read(object, buffer, length, offsets[1], &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, length);
+	g_assert(memcmp(buffer, data + length, length) == 0);
+
+	j_object_delete(object, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Reduces an array of integers on the server and compares the result with a local reduction.
+ */
+static
+void
+test_object_reduce (void)
+{
+	guint const n = 1000;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autoptr(JReduce) reduce = NULL;
+	g_autoptr(JReduce) expected = NULL;
+	g_autofree gint64* data = NULL;
+	guint64 bytes_written = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-reduce");
+	reduce = j_reduce_new(J_REDUCE_TYPE_INT64);
+	expected = j_reduce_new(J_REDUCE_TYPE_INT64);
+
+	data = g_new(gint64, n);
+
+	for (guint i = 0; i < n; i++)
+	{
+		data[i] = (gint64)i - 100;
+	}
+
+	j_reduce_update(expected, data, n * sizeof(gint64));
+
+	j_object_create(object, batch);
+	j_object_write(object, data, n * sizeof(gint64), 0, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_object_reduce(object, reduce, n * sizeof(gint64), 0, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpuint(j_reduce_get_count(reduce), ==, n);
+	g_assert_cmpint(j_reduce_get_min(reduce).i, ==, -100);
+	g_assert_cmpint(j_reduce_get_max(reduce).i, ==, n - 101);
+	g_assert_cmpint(j_reduce_get_sum(reduce).i, ==, j_reduce_get_sum(expected).i);
+
+	/* Further extents are combined into the result. */
+	j_object_reduce(object, reduce, 10 * sizeof(gint64), 0, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpuint(j_reduce_get_count(reduce), ==, n + 10);
+
+	j_object_delete(object, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Accesses an object through a server-side handle.
+ * Like file descriptors, handles keep referring to deleted objects.
+ */
+static
+void
+test_object_handle (void)
+{
+	guint64 const size = 4096;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autoptr(JObject) other = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buffer = NULL;
+	gint64 modification_time = 0;
+	guint64 object_size = 0;
+	guint64 bytes_written = 0;
+	guint64 bytes_read = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-handle");
+	other = j_object_new("test", "test-object-handle");
+
+	data = g_malloc(size);
+	buffer = g_malloc0(size);
+	memset(data, 'h', size);
+
+	j_object_create(object, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_object_open(object, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_object_write(object, data, size, 0, &bytes_written, batch);
+	j_object_status(object, &modification_time, &object_size, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_written, ==, size);
+	g_assert_cmpuint(object_size, ==, size);
+
+	/* The object is deleted using its path, the handle stays valid. */
+	j_object_delete(other, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_object_read(object, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(data, buffer, size) == 0);
+
+	j_object_close(object, batch);
+	g_assert(j_batch_execute(batch));
+
+	/* Without the handle, the object does not exist anymore. */
+	j_object_read(object, buffer, size, 0, &bytes_read, batch);
+	j_batch_execute(batch);
+	g_assert_cmpuint(bytes_read, ==, 0);
+}
+
+/**
+ * Lists the extents of a sparse object.
+ * Backends that can not detect holes report a single extent, so only the written ranges being covered is checked.
+ */
+static
+void
+test_object_extents (void)
+{
+	guint64 const length = 4096;
+	guint64 const hole = 1024 * 1024;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* data = NULL;
+	guint64 lengths[16];
+	guint64 offsets[16];
+	guint64 bytes_written = 0;
+	guint count = 0;
+	guint64 end = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-extents");
+
+	data = g_malloc(length);
+	memset(data, 'e', length);
+
+	j_object_create(object, batch);
+	j_object_write(object, data, length, 0, &bytes_written, batch);
+	j_object_write(object, data, length, hole, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_object_extents(object, G_MAXUINT64, 0, lengths, offsets, G_N_ELEMENTS(lengths), &count, batch);
+	g_assert(j_batch_execute(batch));
+
+	g_assert_cmpuint(count, >=, 1);
+	g_assert_cmpuint(count, <, G_N_ELEMENTS(lengths));
+	g_assert_cmpuint(offsets[0], ==, 0);
+	g_assert_cmpuint(lengths[0], >=, length);
+
+	for (guint i = 0; i < count; i++)
+	{
+		/* Extents are returned in ascending order and do not overlap. */
+		g_assert_cmpuint(offsets[i], >=, end);
+		g_assert_cmpuint(lengths[i], >, 0);
+
+		end = offsets[i] + lengths[i];
+	}
+
+	g_assert_cmpuint(end, ==, hole + length);
+
+	/* Ranges are clipped to the object. */
+	j_object_extents(object, length, hole + length, lengths, offsets, G_N_ELEMENTS(lengths), &count, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(count, ==, 0);
+
+	j_object_delete(object, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+/**
+ * Prefetches a range of an object, which does not change what is read afterwards.
+ */
+static
+void
+test_object_prefetch (void)
+{
+	guint64 const size = 1024 * 1024;
+
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buffer = NULL;
+	guint64 bytes_written = 0;
+	guint64 bytes_read = 0;
+
+	batch = j_batch_new_for_template(J_SEMANTICS_TEMPLATE_DEFAULT);
+	object = j_object_new("test", "test-object-prefetch");
+
+	data = g_malloc(size);
+	buffer = g_malloc0(size);
+
+	for (guint64 i = 0; i < size; i++)
+	{
+		data[i] = i % 251;
+	}
+
+	j_object_create(object, batch);
+	j_object_write(object, data, size, 0, &bytes_written, batch);
+	g_assert(j_batch_execute(batch));
+
+	/* Prefetching beyond the object's end is not an error. */
+	j_object_prefetch(object, 2 * size, 0, batch);
+	g_assert(j_batch_execute(batch));
+
+	j_object_prefetch(object, size / 2, size / 2, batch);
+	j_object_read(object, buffer, size, 0, &bytes_read, batch);
+	g_assert(j_batch_execute(batch));
+	g_assert_cmpuint(bytes_read, ==, size);
+	g_assert(memcmp(data, buffer, size) == 0);
+
+	j_object_delete(object, batch);
+	g_assert(j_batch_execute(batch));
+}
+
+void
+test_object (void)
+{
+	g_test_add_func("/object/read-large", test_object_read_large);
+	g_test_add_func("/object/truncate", test_object_truncate);
+	g_test_add_func("/object/copy", test_object_copy);
+	g_test_add_func("/object/iterator", test_object_iterator);
+	g_test_add_func("/object/append", test_object_append);
+	g_test_add_func("/object/reduce", test_object_reduce);
+	g_test_add_func("/object/handle", test_object_handle);
+	g_test_add_func("/object/extents", test_object_extents);
+	g_test_add_func("/object/prefetch", test_object_prefetch);
+}
@@ -0,0 +1,431 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+#include "test.h"
+
+/**
+ * All operations use the same key, so they are executed by the same flusher.
+ */
+static gint test_operation_cache_key;
+
+static GMutex test_operation_cache_mutex;
+static GCond test_operation_cache_cond;
+
+/**
+ * While set, executing cached operations blocks, so that further batches queue up behind them.
+ */
+static gboolean test_operation_cache_blocked;
+
+static guint test_operation_cache_entered;
+static guint test_operation_cache_calls;
+static guint test_operation_cache_operations;
+
+static guint64 test_operation_cache_size;
+
+/**
+ * Set once j_batch_execute() has returned in test_operation_cache_execute_thread().
+ */
+static gint test_operation_cache_executed;
+
+/**
+ * The data written by test_operation_cache_write_exec() and read by test_operation_cache_read_exec().
+ */
+static gchar test_operation_cache_store[16];
+
+struct TestOperationCacheWrite
+{
+	gchar const* data;
+	guint64 length;
+};
+
+typedef struct TestOperationCacheWrite TestOperationCacheWrite;
+
+static
+gboolean
+test_operation_cache_exec (JList* operations, JSemantics* semantics)
+{
+	(void)semantics;
+
+	g_mutex_lock(&test_operation_cache_mutex);
+
+	test_operation_cache_entered++;
+	g_cond_broadcast(&test_operation_cache_cond);
+
+	while (test_operation_cache_blocked)
+	{
+		g_cond_wait(&test_operation_cache_cond, &test_operation_cache_mutex);
+	}
+
+	test_operation_cache_calls++;
+	test_operation_cache_operations += j_list_length(operations);
+
+	g_mutex_unlock(&test_operation_cache_mutex);
+
+	return TRUE;
+}
+
+static
+gboolean
+test_operation_cache_exec_none (JList* operations, JSemantics* semantics)
+{
+	(void)operations;
+	(void)semantics;
+
+	return TRUE;
+}
+
+static
+gboolean
+test_operation_cache_write_exec (JList* operations, JSemantics* semantics)
+{
+	g_autoptr(JListIterator) iterator = NULL;
+
+	test_operation_cache_exec(operations, semantics);
+
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
+	{
+		TestOperationCacheWrite* write = j_list_iterator_get(iterator);
+
+		memcpy(test_operation_cache_store, write->data, MIN(write->length, sizeof(test_operation_cache_store)));
+	}
+
+	return TRUE;
+}
+
+static
+void
+test_operation_cache_write_free (gpointer data)
+{
+	g_slice_free(TestOperationCacheWrite, data);
+}
+
+static
+guint64
+test_operation_cache_write_cache_size (gpointer data)
+{
+	TestOperationCacheWrite* write = data;
+
+	return write->length;
+}
+
+static
+void
+test_operation_cache_write_cache (gpointer data, gpointer buffer)
+{
+	TestOperationCacheWrite* write = data;
+
+	memcpy(buffer, write->data, write->length);
+	write->data = buffer;
+}
+
+static
+gboolean
+test_operation_cache_read_exec (JList* operations, JSemantics* semantics)
+{
+	g_autoptr(JListIterator) iterator = NULL;
+
+	(void)semantics;
+
+	iterator = j_list_iterator_new(operations);
+
+	while (j_list_iterator_next(iterator))
+	{
+		gchar* data = j_list_iterator_get(iterator);
+
+		memcpy(data, test_operation_cache_store, sizeof(test_operation_cache_store));
+	}
+
+	return TRUE;
+}
+
+static
+guint64
+test_operation_cache_cache_size (gpointer data)
+{
+	(void)data;
+
+	return test_operation_cache_size;
+}
+
+static
+void
+test_operation_cache_cache (gpointer data, gpointer buffer)
+{
+	(void)data;
+	(void)buffer;
+}
+
+static
+void
+test_operation_cache_reset (guint64 size)
+{
+	g_mutex_lock(&test_operation_cache_mutex);
+
+	test_operation_cache_blocked = TRUE;
+	test_operation_cache_entered = 0;
+	test_operation_cache_calls = 0;
+	test_operation_cache_operations = 0;
+	test_operation_cache_size = size;
+
+	g_mutex_unlock(&test_operation_cache_mutex);
+}
+
+static
+void
+test_operation_cache_wait_entered (void)
+{
+	g_mutex_lock(&test_operation_cache_mutex);
+
+	while (test_operation_cache_entered == 0)
+	{
+		g_cond_wait(&test_operation_cache_cond, &test_operation_cache_mutex);
+	}
+
+	g_mutex_unlock(&test_operation_cache_mutex);
+}
+
+static
+void
+test_operation_cache_unblock (void)
+{
+	g_mutex_lock(&test_operation_cache_mutex);
+
+	test_operation_cache_blocked = FALSE;
+	g_cond_broadcast(&test_operation_cache_cond);
+
+	g_mutex_unlock(&test_operation_cache_mutex);
+}
+
+static
+JBatch*
+test_operation_cache_batch_new (JSemantics* semantics, gboolean cacheable)
+{
+	JBatch* batch;
+	JOperation* operation;
+
+	batch = j_batch_new(semantics);
+
+	operation = j_operation_new();
+	operation->key = &test_operation_cache_key;
+
+	if (cacheable)
+	{
+		operation->exec_func = test_operation_cache_exec;
+		operation->cache_size_func = test_operation_cache_cache_size;
+		operation->cache_func = test_operation_cache_cache;
+	}
+	else
+	{
+		operation->exec_func = test_operation_cache_exec_none;
+	}
+
+	j_batch_add(batch, operation);
+
+	return batch;
+}
+
+static
+JSemantics*
+test_operation_cache_semantics_new (void)
+{
+	JSemantics* semantics;
+
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_semantics_set(semantics, J_SEMANTICS_PERSISTENCY, J_SEMANTICS_PERSISTENCY_EVENTUAL);
+
+	return semantics;
+}
+
+/**
+ * Executes a batch that can not be cached, which waits for all cached batches first.
+ */
+static
+void
+test_operation_cache_flush (JSemantics* semantics)
+{
+	g_autoptr(JBatch) batch = NULL;
+
+	batch = test_operation_cache_batch_new(semantics, FALSE);
+	g_assert(j_batch_execute(batch));
+}
+
+static
+gpointer
+test_operation_cache_execute_thread (gpointer data)
+{
+	JBatch* batch = data;
+	gboolean ret;
+
+	ret = j_batch_execute(batch);
+	g_atomic_int_set(&test_operation_cache_executed, 1);
+
+	return GINT_TO_POINTER(ret);
+}
+
+static
+void
+test_operation_cache_coalesce (void)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+
+	semantics = test_operation_cache_semantics_new();
+
+	test_operation_cache_reset(0);
+
+	{
+		g_autoptr(JBatch) batch = NULL;
+
+		batch = test_operation_cache_batch_new(semantics, TRUE);
+		g_assert(j_batch_execute(batch));
+	}
+
+	/* The flusher is now blocked in the first batch, the following ones queue up behind it. */
+	test_operation_cache_wait_entered();
+
+	for (guint i = 0; i < 4; i++)
+	{
+		g_autoptr(JBatch) batch = NULL;
+
+		batch = test_operation_cache_batch_new(semantics, TRUE);
+		g_assert(j_batch_execute(batch));
+	}
+
+	test_operation_cache_unblock();
+	test_operation_cache_flush(semantics);
+
+	/* The queued batches have been executed together. */
+	g_assert_cmpuint(test_operation_cache_operations, ==, 5);
+	g_assert_cmpuint(test_operation_cache_calls, ==, 2);
+}
+
+static
+void
+test_operation_cache_backpressure (void)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	GThread* thread;
+	guint64 cache_size;
+
+	semantics = test_operation_cache_semantics_new();
+	cache_size = j_configuration_get_cache_size(j_configuration());
+
+	/* Two batches fit into the cache, the third one does not. */
+	test_operation_cache_reset(cache_size * 2 / 5);
+
+	for (guint i = 0; i < 2; i++)
+	{
+		g_autoptr(JBatch) cached_batch = NULL;
+
+		cached_batch = test_operation_cache_batch_new(semantics, TRUE);
+		g_assert(j_batch_execute(cached_batch));
+	}
+
+	test_operation_cache_wait_entered();
+
+	batch = test_operation_cache_batch_new(semantics, TRUE);
+	g_atomic_int_set(&test_operation_cache_executed, 0);
+	thread = g_thread_new("test-operation-cache", test_operation_cache_execute_thread, batch);
+
+	/* The third batch has to wait for the cache to drain. */
+	g_usleep(100 * 1000);
+
+	g_assert_cmpint(g_atomic_int_get(&test_operation_cache_executed), ==, 0);
+
+	test_operation_cache_unblock();
+
+	g_assert(GPOINTER_TO_INT(g_thread_join(thread)));
+
+	test_operation_cache_flush(semantics);
+
+	g_assert_cmpuint(test_operation_cache_operations, ==, 3);
+}
+
+static
+void
+test_operation_cache_read_after_write (void)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JBatch) read_batch = NULL;
+	JOperation* operation;
+	TestOperationCacheWrite* write;
+	gchar data[] = "cached";
+	gchar result[sizeof(test_operation_cache_store)];
+
+	semantics = test_operation_cache_semantics_new();
+
+	test_operation_cache_reset(0);
+	memset(test_operation_cache_store, 0, sizeof(test_operation_cache_store));
+
+	batch = j_batch_new(semantics);
+
+	write = g_slice_new(TestOperationCacheWrite);
+	write->data = data;
+	write->length = sizeof(data);
+
+	operation = j_operation_new();
+	operation->key = &test_operation_cache_key;
+	operation->data = write;
+	operation->exec_func = test_operation_cache_write_exec;
+	operation->free_func = test_operation_cache_write_free;
+	operation->cache_size_func = test_operation_cache_write_cache_size;
+	operation->cache_func = test_operation_cache_write_cache;
+
+	j_batch_add(batch, operation);
+	g_assert(j_batch_execute(batch));
+
+	/* The write has been cached and is blocked in the flusher, so the caller's buffer can be reused. */
+	test_operation_cache_wait_entered();
+	g_assert_cmpstr(test_operation_cache_store, ==, "");
+	memset(data, 'x', sizeof(data) - 1);
+
+	test_operation_cache_unblock();
+
+	/* Reads can not be cached, so they wait for the cached write. */
+	read_batch = j_batch_new(semantics);
+
+	operation = j_operation_new();
+	operation->key = &test_operation_cache_key;
+	operation->data = result;
+	operation->exec_func = test_operation_cache_read_exec;
+
+	j_batch_add(read_batch, operation);
+	g_assert(j_batch_execute(read_batch));
+
+	g_assert_cmpstr(result, ==, "cached");
+	g_assert_cmpuint(test_operation_cache_operations, ==, 1);
+}
+
+void
+test_operation_cache (void)
+{
+	g_test_add_func("/operation-cache/coalesce", test_operation_cache_coalesce);
+	g_test_add_func("/operation-cache/backpressure", test_operation_cache_backpressure);
+	g_test_add_func("/operation-cache/read-after-write", test_operation_cache_read_after_write);
+}
@@ -0,0 +1,146 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <julea.h>
+
+#include <jreadahead.h>
+
+#include "test.h"
+
+/**
+ * The size of the simulated object.
+ **/
+#define TEST_READAHEAD_SIZE 1000
+
+static
+void
+test_readahead_fetch (gpointer data, gpointer buffer, guint64 length, guint64 offset, guint64* bytes_read)
+{
+	guint* fetches = data;
+	guchar* b = buffer;
+	guint64 nbytes = 0;
+
+	g_atomic_int_inc(fetches);
+
+	for (guint64 i = offset; i < offset + length && i < TEST_READAHEAD_SIZE; i++)
+	{
+		b[i - offset] = i % 256;
+		nbytes++;
+	}
+
+	*bytes_read = nbytes;
+}
+
+static
+void
+test_readahead_sequential (void)
+{
+	JReadahead* readahead;
+	guint fetches = 0;
+	guint served = 0;
+
+	readahead = j_readahead_new(400, test_readahead_fetch, &fetches);
+
+	for (guint64 offset = 0; offset < TEST_READAHEAD_SIZE; offset += 100)
+	{
+		guchar buffer[100];
+		guint64 bytes_read = 0;
+
+		if (j_readahead_read(readahead, buffer, sizeof(buffer), offset, &bytes_read))
+		{
+			g_assert_cmpuint(bytes_read, ==, sizeof(buffer));
+
+			for (guint i = 0; i < sizeof(buffer); i++)
+			{
+				g_assert_cmpuint(buffer[i], ==, (offset + i) % 256);
+			}
+
+			served++;
+		}
+	}
+
+	/* The first two reads detect the pattern, all others are prefetched. */
+	g_assert_cmpuint(served, ==, 8);
+
+	j_readahead_free(readahead);
+
+	g_assert_cmpuint(fetches, >=, 2);
+}
+
+static
+void
+test_readahead_random (void)
+{
+	JReadahead* readahead;
+	guint fetches = 0;
+	guint64 offsets[] = { 500, 0, 900, 200, 700 };
+
+	readahead = j_readahead_new(400, test_readahead_fetch, &fetches);
+
+	for (guint i = 0; i < G_N_ELEMENTS(offsets); i++)
+	{
+		guchar buffer[100];
+		guint64 bytes_read = 0;
+		gboolean ret;
+
+		ret = j_readahead_read(readahead, buffer, sizeof(buffer), offsets[i], &bytes_read);
+		g_assert(!ret);
+		g_assert_cmpuint(bytes_read, ==, 0);
+	}
+
+	j_readahead_free(readahead);
+
+	g_assert_cmpuint(fetches, ==, 0);
+}
+
+static
+void
+test_readahead_invalidate (void)
+{
+	JReadahead* readahead;
+	guchar buffer[100];
+	guint fetches = 0;
+	guint64 bytes_read = 0;
+	gboolean ret;
+
+	readahead = j_readahead_new(400, test_readahead_fetch, &fetches);
+
+	j_readahead_read(readahead, buffer, sizeof(buffer), 0, &bytes_read);
+	j_readahead_read(readahead, buffer, sizeof(buffer), 100, &bytes_read);
+
+	j_readahead_invalidate(readahead);
+
+	bytes_read = 0;
+	ret = j_readahead_read(readahead, buffer, sizeof(buffer), 200, &bytes_read);
+	g_assert(!ret);
+	g_assert_cmpuint(bytes_read, ==, 0);
+
+	j_readahead_free(readahead);
+}
+
+void
+test_readahead (void)
+{
+	g_test_add_func("/readahead/sequential", test_readahead_sequential);
+	g_test_add_func("/readahead/random", test_readahead_random);
+	g_test_add_func("/readahead/invalidate", test_readahead_invalidate);
+}
@@ -87,9 +87,33 @@ test_semantics_set_get (JSemantics** semantics, G_GNUC_UNUSED gconstpointer data
 	g_assert_cmpint(s, ==, J_SEMANTICS_SECURITY_STRICT);
 }
 
+static
+void
+test_semantics_checkpoint (void)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	gint s;
+
+	semantics = j_semantics_new_from_string("checkpoint", NULL);
+	g_assert(semantics != NULL);
+
+	s = j_semantics_get(semantics, J_SEMANTICS_ATOMICITY);
+	g_assert_cmpint(s, ==, J_SEMANTICS_ATOMICITY_NONE);
+
+	s = j_semantics_get(semantics, J_SEMANTICS_ORDERING);
+	g_assert_cmpint(s, ==, J_SEMANTICS_ORDERING_RELAXED);
+
+	s = j_semantics_get(semantics, J_SEMANTICS_PERSISTENCY);
+	g_assert_cmpint(s, ==, J_SEMANTICS_PERSISTENCY_EVENTUAL);
+
+	s = j_semantics_get(semantics, J_SEMANTICS_SAFETY);
+	g_assert_cmpint(s, ==, J_SEMANTICS_SAFETY_NONE);
+}
+
 void
 test_semantics (void)
 {
 	g_test_add_func("/semantics/new_ref_unref", test_semantics_new_ref_unref);
 	g_test_add("/semantics/set_get", JSemantics*, NULL, test_semantics_fixture_setup, test_semantics_set_get, test_semantics_fixture_teardown);
+	g_test_add_func("/semantics/checkpoint", test_semantics_checkpoint);
 }
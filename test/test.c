@@ -39,12 +39,23 @@ main (int argc, char** argv)
 	test_cache();
 	test_configuration();
 	test_distribution();
+	test_erasure();
 	test_list();
 	test_list_iterator();
 	test_lock();
 	test_memory_chunk();
 	test_message();
+	test_network();
+	test_operation_cache();
+	test_readahead();
 	test_semantics();
+	test_transport();
+
+	// KV client
+	test_kv();
+
+	// Object client
+	test_object();
 
 	// Item client
 	test_collection();
@@ -24,12 +24,21 @@ void test_batch (void);
 void test_cache (void);
 void test_configuration (void);
 void test_distribution (void);
+void test_erasure (void);
 void test_list (void);
 void test_list_iterator (void);
 void test_lock (void);
 void test_memory_chunk (void);
 void test_message (void);
+void test_network (void);
+void test_operation_cache (void);
+void test_readahead (void);
 void test_semantics (void);
+void test_transport (void);
+
+void test_kv (void);
+
+void test_object (void);
 
 void test_collection (void);
 void test_item (void);
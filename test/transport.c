@@ -0,0 +1,227 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2010-2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <string.h>
+
+#include <sys/socket.h>
+
+#include <julea.h>
+
+#include "test.h"
+
+/**
+ * Creates two connected connections that do not need a server.
+ */
+static
+void
+test_transport_connection_pair (GSocketConnection** a, GSocketConnection** b)
+{
+	g_autoptr(GSocket) socket_a = NULL;
+	g_autoptr(GSocket) socket_b = NULL;
+	gint fds[2];
+
+	g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), ==, 0);
+
+	socket_a = g_socket_new_from_fd(fds[0], NULL);
+	socket_b = g_socket_new_from_fd(fds[1], NULL);
+	g_assert(socket_a != NULL);
+	g_assert(socket_b != NULL);
+
+	*a = g_socket_connection_factory_create_connection(socket_a);
+	*b = g_socket_connection_factory_create_connection(socket_b);
+}
+
+/**
+ * Without a usable provider, RDMA is not available and payloads are transferred over the connection.
+ */
+static
+void
+test_transport_fallback (void)
+{
+	guint64 const size = 4 * 1024;
+
+	g_autoptr(GSocketConnection) a = NULL;
+	g_autoptr(GSocketConnection) b = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buf = NULL;
+	g_autofree gchar* address = NULL;
+	JTransportRemote remote = { 0, 0 };
+
+	if (j_configuration_get_rdma(j_configuration()))
+	{
+		g_test_skip("RDMA is in use");
+		return;
+	}
+
+	/* There is no such provider, so opening the endpoint fails. */
+	g_setenv("FI_PROVIDER", "julea-test-none", TRUE);
+
+	g_assert(!j_transport_rdma_init());
+
+	address = j_transport_get_address();
+	g_assert(address == NULL);
+
+	data = g_malloc(size);
+	buf = g_malloc0(size);
+	memset(data, 'a', size);
+
+	/* Clients fall back to sending their payloads if their buffers can not be registered. */
+	g_assert(j_transport_region_new(data, size) == NULL);
+
+	test_transport_connection_pair(&a, &b);
+
+	g_assert(!j_transport_accept(a, "0123456789abcdef"));
+
+	g_assert(j_transport_send(a, NULL, data, size));
+	g_assert(j_transport_receive(b, NULL, buf, size));
+	g_assert(memcmp(data, buf, size) == 0);
+
+	/* Remote regions can not be accessed on connections that have not been accepted. */
+	g_assert(!j_transport_send(a, &remote, data, size));
+	g_assert(!j_transport_receive(a, &remote, buf, size));
+
+	j_transport_fini();
+	g_unsetenv("FI_PROVIDER");
+}
+
+static
+void
+test_transport_accept_invalid (void)
+{
+	g_autoptr(GSocketConnection) a = NULL;
+	g_autoptr(GSocketConnection) b = NULL;
+
+	test_transport_connection_pair(&a, &b);
+
+	/* Addresses consist of pairs of hexadecimal digits. */
+	g_assert(!j_transport_accept(a, ""));
+	g_assert(!j_transport_accept(a, "abc"));
+	g_assert(!j_transport_accept(a, "0g"));
+	g_assert(!j_transport_accept(a, "rdma"));
+}
+
+static
+gpointer
+test_transport_shm_accept (gpointer data)
+{
+	GSocketConnection* connection = data;
+
+	return GINT_TO_POINTER(j_transport_shm_accept(connection));
+}
+
+static
+void
+test_transport_shm (void)
+{
+	guint64 const size = 4 * 1024;
+
+	g_autoptr(GSocketConnection) a = NULL;
+	g_autoptr(GSocketConnection) b = NULL;
+	g_autofree gchar* data = NULL;
+	g_autofree gchar* buf = NULL;
+	JTransportShm* shm;
+	JTransportRegion* regions[4];
+	JTransportRegion* region;
+	JTransportRemote remote;
+	GThread* thread;
+
+	/* Room for four regions. */
+	shm = j_transport_shm_new(4 * size);
+
+	if (shm == NULL)
+	{
+		g_test_skip("Shared memory is not available");
+		return;
+	}
+
+	test_transport_connection_pair(&a, &b);
+
+	/* The client waits for the server to acknowledge the memory. */
+	thread = g_thread_new("test-transport-shm", test_transport_shm_accept, b);
+	g_assert(j_transport_shm_offer(shm, a));
+	g_assert(GPOINTER_TO_INT(g_thread_join(thread)));
+
+	data = g_malloc(size);
+	buf = g_malloc0(size);
+	memset(data, 'a', size);
+
+	/* Written data is copied to the region, where the server reads it. */
+	regions[0] = j_transport_shm_region_new(shm, data, size, TRUE);
+	g_assert(regions[0] != NULL);
+
+	j_transport_region_get_remote(regions[0], &remote);
+	g_assert(j_transport_receive(b, &remote, buf, size));
+	g_assert(memcmp(data, buf, size) == 0);
+
+	/* Read data is only copied to the buffer when syncing the region. */
+	regions[1] = j_transport_shm_region_new(shm, buf, size, FALSE);
+	g_assert(regions[1] != NULL);
+
+	memset(data, 'b', size);
+
+	j_transport_region_get_remote(regions[1], &remote);
+	g_assert(j_transport_send(b, &remote, data, size));
+	g_assert_cmpint(buf[0], ==, 'a');
+
+	j_transport_region_sync(regions[1], size);
+	g_assert(memcmp(data, buf, size) == 0);
+
+	/* Regions outside of the memory are rejected. */
+	remote.address = 4 * size;
+	g_assert(!j_transport_receive(b, &remote, buf, 1));
+
+	regions[2] = j_transport_shm_region_new(shm, buf, size, FALSE);
+	regions[3] = j_transport_shm_region_new(shm, buf, size, FALSE);
+	g_assert(regions[2] != NULL);
+	g_assert(regions[3] != NULL);
+
+	/* Clients fall back to sending their payloads if the memory is used up. */
+	g_assert(j_transport_shm_region_new(shm, buf, size, FALSE) == NULL);
+
+	/* Space is only reused once all older regions have been freed. */
+	j_transport_region_free(regions[1]);
+	g_assert(j_transport_shm_region_new(shm, buf, size, FALSE) == NULL);
+
+	j_transport_region_free(regions[0]);
+
+	/* The new region wraps around. */
+	region = j_transport_shm_region_new(shm, buf, size, FALSE);
+	g_assert(region != NULL);
+
+	j_transport_region_get_remote(region, &remote);
+	g_assert_cmpuint(remote.address, ==, 0);
+
+	j_transport_region_free(regions[2]);
+	j_transport_region_free(regions[3]);
+	j_transport_region_free(region);
+
+	j_transport_shm_free(shm);
+}
+
+void
+test_transport (void)
+{
+	g_test_add_func("/transport/fallback", test_transport_fallback);
+	g_test_add_func("/transport/accept-invalid", test_transport_accept_invalid);
+	g_test_add_func("/transport/shm", test_transport_shm);
+}
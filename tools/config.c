@@ -22,21 +22,74 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <julea.h>
+#include <julea-object.h>
+
+#include <jconnection-pool.h>
+#include <jmessage.h>
 
 static gboolean opt_user = FALSE;
 static gboolean opt_system = FALSE;
 static gboolean opt_read = FALSE;
+static gboolean opt_tune = FALSE;
 static gchar const* opt_name = "julea";
 static gchar const* opt_servers_object = NULL;
 static gchar const* opt_servers_kv = NULL;
+static gchar const* opt_servers_kv_replicas = NULL;
 static gchar const* opt_object_backend = NULL;
 static gchar const* opt_object_component = NULL;
 static gchar const* opt_object_path = NULL;
 static gchar const* opt_kv_backend = NULL;
 static gchar const* opt_kv_component = NULL;
 static gchar const* opt_kv_path = NULL;
+static gchar const* opt_object_local_namespaces = NULL;
+static gchar const* opt_object_local_backend = NULL;
+static gchar const* opt_object_local_path = NULL;
+static gchar const* opt_kv_local_namespaces = NULL;
+static gchar const* opt_kv_local_backend = NULL;
+static gchar const* opt_kv_local_path = NULL;
+static gchar const* opt_server_mode = NULL;
+static gint opt_server_threads = 0;
+static gint64 opt_server_group_commit_time = 0;
+static gint opt_server_group_commit_size = 0;
+static gboolean opt_server_pipeline = FALSE;
+static gint64 opt_server_write_buffer_size = 0;
+static gint64 opt_server_write_buffer_time = 0;
+static gint opt_server_scheduler_slots = 0;
+static gint opt_server_scheduler_weight_metadata = 0;
+static gint opt_server_scheduler_weight_small = 0;
+static gint opt_server_scheduler_weight_bulk = 0;
+static gint64 opt_server_memory_budget = 0;
+static gint64 opt_server_inline_size = 0;
+static gint64 opt_server_scrub_rate = 0;
+static gint64 opt_server_scrub_interval = 0;
+static gint64 opt_server_trash_rate = 0;
+static gint64 opt_server_kv_cache_size = 0;
+static gboolean opt_server_kv_filter = FALSE;
+static gchar const* opt_server_numa_node = NULL;
+static gboolean opt_server_huge_pages = FALSE;
+static gchar const* opt_server_journal = NULL;
+static gint opt_server_dedup = 0;
 static gint opt_max_connections = 0;
+static gint opt_multiplex_connections = 0;
+static gint opt_prewarm_connections = 0;
+static gint64 opt_cache_size = 0;
+static gint64 opt_block_size = 0;
+static gint64 opt_message_size = 0;
+static gint opt_hedge_percentile = 0;
+static gint opt_background_threads = 0;
+static gboolean opt_pin_threads = FALSE;
+static gboolean opt_huge_pages = FALSE;
+static gchar const* opt_node_cache = NULL;
+static gboolean opt_dedup = FALSE;
+static gint64 opt_combine_window = 0;
+static gint opt_trace_sample = 0;
+static gboolean opt_checksums = FALSE;
+static gboolean opt_rdma = FALSE;
 
 static
 gchar**
@@ -99,14 +152,230 @@ write_config (gchar* path)
 
 	key_file = g_key_file_new();
 	g_key_file_set_integer(key_file, "clients", "max-connections", opt_max_connections);
+
+	if (opt_multiplex_connections > 0)
+	{
+		g_key_file_set_integer(key_file, "clients", "multiplex-connections", opt_multiplex_connections);
+	}
+
+	if (opt_prewarm_connections > 0)
+	{
+		g_key_file_set_integer(key_file, "clients", "prewarm-connections", opt_prewarm_connections);
+	}
+
+	if (opt_cache_size > 0)
+	{
+		g_key_file_set_uint64(key_file, "clients", "cache-size", opt_cache_size);
+	}
+
+	if (opt_block_size > 0)
+	{
+		g_key_file_set_uint64(key_file, "clients", "block-size", opt_block_size);
+	}
+
+	if (opt_message_size > 0)
+	{
+		g_key_file_set_uint64(key_file, "clients", "message-size", opt_message_size);
+	}
+
+	if (opt_hedge_percentile > 0)
+	{
+		g_key_file_set_integer(key_file, "clients", "hedge-percentile", opt_hedge_percentile);
+	}
+
+	if (opt_background_threads > 0)
+	{
+		g_key_file_set_integer(key_file, "clients", "background-threads", opt_background_threads);
+	}
+
+	if (opt_pin_threads)
+	{
+		g_key_file_set_boolean(key_file, "clients", "pin-threads", TRUE);
+	}
+
+	if (opt_huge_pages)
+	{
+		g_key_file_set_boolean(key_file, "clients", "huge-pages", TRUE);
+	}
+
+	if (opt_node_cache != NULL)
+	{
+		g_key_file_set_string(key_file, "clients", "node-cache", opt_node_cache);
+	}
+
+	if (opt_dedup)
+	{
+		g_key_file_set_boolean(key_file, "clients", "dedup", TRUE);
+	}
+
+	if (opt_combine_window > 0)
+	{
+		g_key_file_set_uint64(key_file, "clients", "combine-window", opt_combine_window);
+	}
+
+	if (opt_trace_sample > 0)
+	{
+		g_key_file_set_integer(key_file, "clients", "trace-sample", opt_trace_sample);
+	}
+
+	if (opt_checksums)
+	{
+		g_key_file_set_boolean(key_file, "clients", "checksums", TRUE);
+	}
+
+	if (opt_rdma)
+	{
+		g_key_file_set_boolean(key_file, "clients", "rdma", TRUE);
+	}
+
 	g_key_file_set_string_list(key_file, "servers", "object", (gchar const* const*)servers_object, g_strv_length(servers_object));
 	g_key_file_set_string_list(key_file, "servers", "kv", (gchar const* const*)servers_kv, g_strv_length(servers_kv));
+
+	if (opt_servers_kv_replicas != NULL)
+	{
+		g_auto(GStrv) servers_kv_replicas = NULL;
+
+		servers_kv_replicas = string_split(opt_servers_kv_replicas);
+		g_key_file_set_string_list(key_file, "servers", "kv-replicas", (gchar const* const*)servers_kv_replicas, g_strv_length(servers_kv_replicas));
+	}
+
 	g_key_file_set_string(key_file, "object", "backend", opt_object_backend);
 	g_key_file_set_string(key_file, "object", "component", opt_object_component);
 	g_key_file_set_string(key_file, "object", "path", opt_object_path);
 	g_key_file_set_string(key_file, "kv", "backend", opt_kv_backend);
 	g_key_file_set_string(key_file, "kv", "component", opt_kv_component);
 	g_key_file_set_string(key_file, "kv", "path", opt_kv_path);
+
+	if (opt_object_local_namespaces != NULL && opt_object_local_backend != NULL && opt_object_local_path != NULL)
+	{
+		g_auto(GStrv) object_local_namespaces = NULL;
+
+		object_local_namespaces = string_split(opt_object_local_namespaces);
+		g_key_file_set_string_list(key_file, "object", "local-namespaces", (gchar const* const*)object_local_namespaces, g_strv_length(object_local_namespaces));
+		g_key_file_set_string(key_file, "object", "local-backend", opt_object_local_backend);
+		g_key_file_set_string(key_file, "object", "local-path", opt_object_local_path);
+	}
+
+	if (opt_kv_local_namespaces != NULL && opt_kv_local_backend != NULL && opt_kv_local_path != NULL)
+	{
+		g_auto(GStrv) kv_local_namespaces = NULL;
+
+		kv_local_namespaces = string_split(opt_kv_local_namespaces);
+		g_key_file_set_string_list(key_file, "kv", "local-namespaces", (gchar const* const*)kv_local_namespaces, g_strv_length(kv_local_namespaces));
+		g_key_file_set_string(key_file, "kv", "local-backend", opt_kv_local_backend);
+		g_key_file_set_string(key_file, "kv", "local-path", opt_kv_local_path);
+	}
+
+	if (opt_server_mode != NULL)
+	{
+		g_key_file_set_string(key_file, "server", "mode", opt_server_mode);
+	}
+
+	if (opt_server_threads > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "threads", opt_server_threads);
+	}
+
+	if (opt_server_group_commit_time > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "group-commit-time", opt_server_group_commit_time);
+	}
+
+	if (opt_server_group_commit_size > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "group-commit-size", opt_server_group_commit_size);
+	}
+
+	if (opt_server_pipeline)
+	{
+		g_key_file_set_boolean(key_file, "server", "pipeline", TRUE);
+	}
+
+	if (opt_server_write_buffer_size > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "write-buffer-size", opt_server_write_buffer_size);
+	}
+
+	if (opt_server_write_buffer_time > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "write-buffer-time", opt_server_write_buffer_time);
+	}
+
+	if (opt_server_scheduler_slots > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "scheduler-slots", opt_server_scheduler_slots);
+	}
+
+	if (opt_server_scheduler_weight_metadata > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "scheduler-weight-metadata", opt_server_scheduler_weight_metadata);
+	}
+
+	if (opt_server_scheduler_weight_small > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "scheduler-weight-small", opt_server_scheduler_weight_small);
+	}
+
+	if (opt_server_scheduler_weight_bulk > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "scheduler-weight-bulk", opt_server_scheduler_weight_bulk);
+	}
+
+	if (opt_server_memory_budget > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "memory-budget", opt_server_memory_budget);
+	}
+
+	if (opt_server_inline_size > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "inline-size", opt_server_inline_size);
+	}
+
+	if (opt_server_scrub_rate > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "scrub-rate", opt_server_scrub_rate);
+	}
+
+	if (opt_server_scrub_interval > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "scrub-interval", opt_server_scrub_interval);
+	}
+
+	if (opt_server_trash_rate > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "trash-rate", opt_server_trash_rate);
+	}
+
+	if (opt_server_kv_cache_size > 0)
+	{
+		g_key_file_set_uint64(key_file, "server", "kv-cache-size", opt_server_kv_cache_size);
+	}
+
+	if (opt_server_kv_filter)
+	{
+		g_key_file_set_boolean(key_file, "server", "kv-filter", TRUE);
+	}
+
+	if (opt_server_numa_node != NULL)
+	{
+		g_key_file_set_string(key_file, "server", "numa-node", opt_server_numa_node);
+	}
+
+	if (opt_server_huge_pages)
+	{
+		g_key_file_set_boolean(key_file, "server", "huge-pages", TRUE);
+	}
+
+	if (opt_server_journal != NULL)
+	{
+		g_key_file_set_string(key_file, "server", "journal", opt_server_journal);
+	}
+
+	if (opt_server_dedup > 0)
+	{
+		g_key_file_set_integer(key_file, "server", "dedup", opt_server_dedup);
+	}
+
 	key_file_data = g_key_file_to_data(key_file, &key_file_data_len, NULL);
 
 	if (path != NULL)
@@ -127,6 +396,316 @@ write_config (gchar* path)
 	return ret;
 }
 
+/**
+ * The number of round trips used to measure the latency.
+ */
+#define TUNE_ROUND_TRIPS 50
+
+/**
+ * The amount of data written and read to measure the bandwidth.
+ */
+#define TUNE_DATA_SIZE (64 * 1024 * 1024)
+
+/**
+ * The size of a single transfer used to measure the bandwidth.
+ */
+#define TUNE_TRANSFER_SIZE (4 * 1024 * 1024)
+
+/**
+ * The number and size of the random writes used to measure the IOPS.
+ */
+#define TUNE_OPERATIONS 1000
+#define TUNE_OPERATION_SIZE (4 * 1024)
+
+/**
+ * The results of probing a single object server.
+ */
+struct TuneResult
+{
+	/**
+	 * The median round-trip time in seconds.
+	 */
+	gdouble rtt;
+
+	/**
+	 * The write and read bandwidths in bytes per second.
+	 */
+	gdouble write_bandwidth;
+	gdouble read_bandwidth;
+
+	/**
+	 * The small random writes per second.
+	 */
+	gdouble iops;
+};
+
+typedef struct TuneResult TuneResult;
+
+static
+gint
+tune_compare_double (gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(gdouble const*)a;
+	gdouble y = *(gdouble const*)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+/**
+ * Measures the round-trip time to an object server.
+ * Uses statistics requests, which do not touch the backend.
+ */
+static
+gboolean
+tune_rtt (guint32 index, gdouble* rtt)
+{
+	gdouble times[TUNE_ROUND_TRIPS];
+	gchar get_all = 0;
+
+	for (guint i = 0; i < TUNE_ROUND_TRIPS; i++)
+	{
+		g_autoptr(JMessage) message = NULL;
+		g_autoptr(JMessage) reply = NULL;
+		gint64 start;
+
+		message = j_message_new(J_MESSAGE_STATISTICS, sizeof(gchar));
+		j_message_add_operation(message, 0);
+		j_message_append_1(message, &get_all);
+
+		start = g_get_monotonic_time();
+		reply = j_connection_pool_request_object(index, message, TRUE);
+
+		if (reply == NULL)
+		{
+			return FALSE;
+		}
+
+		times[i] = (gdouble)(g_get_monotonic_time() - start) / G_USEC_PER_SEC;
+	}
+
+	qsort(times, TUNE_ROUND_TRIPS, sizeof(gdouble), tune_compare_double);
+	*rtt = times[TUNE_ROUND_TRIPS / 2];
+
+	return TRUE;
+}
+
+/**
+ * Measures the bandwidth and IOPS of an object server's backend.
+ * Uses a temporary object that is deleted afterwards.
+ */
+static
+gboolean
+tune_backend (guint32 index, TuneResult* result)
+{
+	g_autoptr(JSemantics) semantics = NULL;
+	g_autoptr(JBatch) batch = NULL;
+	g_autoptr(JObject) object = NULL;
+	g_autofree gchar* name = NULL;
+	g_autofree gchar* buffer = NULL;
+	gboolean ret = FALSE;
+	guint64 bytes[TUNE_DATA_SIZE / TUNE_TRANSFER_SIZE];
+	guint64 bytes_operations[TUNE_OPERATIONS];
+	gint64 start;
+
+	semantics = j_semantics_new(J_SEMANTICS_TEMPLATE_DEFAULT);
+	j_semantics_set(semantics, J_SEMANTICS_SAFETY, J_SEMANTICS_SAFETY_STORAGE);
+	batch = j_batch_new(semantics);
+
+	name = g_strdup_printf("probe-%d", getpid());
+	object = j_object_new_for_index(index, "julea-tune", name);
+	buffer = g_malloc(TUNE_TRANSFER_SIZE);
+
+	for (guint i = 0; i < TUNE_TRANSFER_SIZE; i++)
+	{
+		buffer[i] = g_random_int();
+	}
+
+	j_object_create(object, batch);
+
+	if (!j_batch_execute(batch))
+	{
+		goto end;
+	}
+
+	start = g_get_monotonic_time();
+
+	for (guint i = 0; i < G_N_ELEMENTS(bytes); i++)
+	{
+		j_object_write(object, buffer, TUNE_TRANSFER_SIZE, (guint64)i * TUNE_TRANSFER_SIZE, &(bytes[i]), batch);
+	}
+
+	if (!j_batch_execute(batch))
+	{
+		goto delete;
+	}
+
+	result->write_bandwidth = (gdouble)TUNE_DATA_SIZE * G_USEC_PER_SEC / MAX(g_get_monotonic_time() - start, 1);
+
+	start = g_get_monotonic_time();
+
+	for (guint i = 0; i < G_N_ELEMENTS(bytes); i++)
+	{
+		j_object_read(object, buffer, TUNE_TRANSFER_SIZE, (guint64)i * TUNE_TRANSFER_SIZE, &(bytes[i]), batch);
+	}
+
+	if (!j_batch_execute(batch))
+	{
+		goto delete;
+	}
+
+	result->read_bandwidth = (gdouble)TUNE_DATA_SIZE * G_USEC_PER_SEC / MAX(g_get_monotonic_time() - start, 1);
+
+	start = g_get_monotonic_time();
+
+	for (guint i = 0; i < TUNE_OPERATIONS; i++)
+	{
+		guint64 offset;
+
+		offset = (guint64)g_random_int_range(0, TUNE_DATA_SIZE / TUNE_OPERATION_SIZE) * TUNE_OPERATION_SIZE;
+		j_object_write(object, buffer, TUNE_OPERATION_SIZE, offset, &(bytes_operations[i]), batch);
+	}
+
+	if (!j_batch_execute(batch))
+	{
+		goto delete;
+	}
+
+	result->iops = (gdouble)TUNE_OPERATIONS * G_USEC_PER_SEC / MAX(g_get_monotonic_time() - start, 1);
+
+	ret = TRUE;
+
+delete:
+	j_object_delete(object, batch);
+	j_batch_execute(batch);
+
+end:
+	return ret;
+}
+
+/**
+ * Returns the smallest power of two that is not smaller than value, clamped to [min, max].
+ */
+static
+guint64
+tune_power_of_two (gdouble value, guint64 min, guint64 max)
+{
+	guint64 ret = min;
+
+	while (ret < value && ret < max)
+	{
+		ret *= 2;
+	}
+
+	return MIN(ret, max);
+}
+
+/**
+ * Probes all object servers and recommends client settings.
+ * Writes the recommendations to the configuration at path, or prints them if path is NULL.
+ */
+static
+gboolean
+tune_config (gchar* path)
+{
+	g_autoptr(GKeyFile) key_file = NULL;
+	g_autofree TuneResult* results = NULL;
+	g_autofree gchar* key_file_data = NULL;
+	JConfiguration* configuration;
+	gsize key_file_data_len;
+	gdouble rtt = 0.0;
+	gdouble bandwidth = 0.0;
+	gdouble bandwidth_total = 0.0;
+	gdouble iops = 0.0;
+	guint processors;
+	guint server_count;
+	guint64 block_size;
+	guint64 cache_size;
+	guint32 max_connections;
+	guint32 background_threads;
+	gboolean ret = TRUE;
+
+	key_file = g_key_file_new();
+
+	if (path != NULL && !g_key_file_load_from_file(key_file, path, G_KEY_FILE_KEEP_COMMENTS, NULL))
+	{
+		g_printerr("Configuration %s can not be loaded.\n", path);
+
+		return FALSE;
+	}
+
+	j_init();
+
+	configuration = j_configuration();
+	server_count = j_configuration_get_object_server_count(configuration);
+	processors = g_get_num_processors();
+	results = g_new0(TuneResult, server_count);
+
+	for (guint i = 0; i < server_count; i++)
+	{
+		TuneResult* result = &(results[i]);
+
+		if (!tune_rtt(i, &(result->rtt)) || !tune_backend(i, result))
+		{
+			g_printerr("Object server %s can not be probed.\n", j_configuration_get_object_server(configuration, i));
+			ret = FALSE;
+
+			break;
+		}
+
+		g_print("Object server %s: round-trip time %.0f us, write %.1f MiB/s, read %.1f MiB/s, %.0f IOPS\n",
+			j_configuration_get_object_server(configuration, i),
+			result->rtt * G_USEC_PER_SEC,
+			result->write_bandwidth / (1024 * 1024),
+			result->read_bandwidth / (1024 * 1024),
+			result->iops);
+
+		rtt += result->rtt / server_count;
+		bandwidth += MIN(result->write_bandwidth, result->read_bandwidth) / server_count;
+		bandwidth_total += result->write_bandwidth;
+		iops += result->iops / server_count;
+	}
+
+	j_fini();
+
+	if (!ret)
+	{
+		return FALSE;
+	}
+
+	// Blocks should be large enough for the round trip to take at most a tenth of their transfer time.
+	block_size = tune_power_of_two(bandwidth * rtt * 10, 64 * 1024, 64 * 1024 * 1024);
+	// Enough concurrent requests to keep a server's backend busy despite the round-trip time.
+	max_connections = CLAMP((guint32)(iops * rtt) + 1, processors, 16 * processors);
+	// Enough threads to access all servers in parallel.
+	background_threads = CLAMP(server_count, processors, 4 * processors);
+	// About one second of writes to all servers.
+	cache_size = CLAMP((guint64)bandwidth_total, 16 * 1024 * 1024, 1024 * 1024 * 1024);
+
+	g_key_file_set_uint64(key_file, "clients", "block-size", block_size);
+	g_key_file_set_integer(key_file, "clients", "max-connections", max_connections);
+	g_key_file_set_integer(key_file, "clients", "background-threads", background_threads);
+	g_key_file_set_uint64(key_file, "clients", "cache-size", cache_size);
+
+	if (path != NULL)
+	{
+		g_autoptr(GFile) file = NULL;
+
+		key_file_data = g_key_file_to_data(key_file, &key_file_data_len, NULL);
+		file = g_file_new_for_commandline_arg(path);
+		ret = g_file_replace_contents(file, key_file_data, key_file_data_len, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL, NULL);
+	}
+	else
+	{
+		g_print("\n[clients]\n");
+		g_print("block-size=%" G_GUINT64_FORMAT "\n", block_size);
+		g_print("max-connections=%" G_GUINT32_FORMAT "\n", max_connections);
+		g_print("background-threads=%" G_GUINT32_FORMAT "\n", background_threads);
+		g_print("cache-size=%" G_GUINT64_FORMAT "\n", cache_size);
+	}
+
+	return ret;
+}
+
 gint
 main (gint argc, gchar** argv)
 {
@@ -139,16 +718,61 @@ main (gint argc, gchar** argv)
 		{ "user", 0, 0, G_OPTION_ARG_NONE, &opt_user, "Write user configuration", NULL },
 		{ "system", 0, 0, G_OPTION_ARG_NONE, &opt_system, "Write system configuration", NULL },
 		{ "read", 0, 0, G_OPTION_ARG_NONE, &opt_read, "Read configuration", NULL },
+		{ "tune", 0, 0, G_OPTION_ARG_NONE, &opt_tune, "Probe the servers and recommend client settings", NULL },
 		{ "name", 0, 0, G_OPTION_ARG_STRING, &opt_name, "Configuration name", "julea" },
 		{ "object-servers", 0, 0, G_OPTION_ARG_STRING, &opt_servers_object, "Object servers to use", "host1,host2" },
 		{ "kv-servers", 0, 0, G_OPTION_ARG_STRING, &opt_servers_kv, "Key-value servers to use", "host1,host2" },
+		{ "kv-replicas", 0, 0, G_OPTION_ARG_STRING, &opt_servers_kv_replicas, "Key-value read replicas to use", "host3,host4" },
 		{ "object-backend", 0, 0, G_OPTION_ARG_STRING, &opt_object_backend, "Object backend to use", "posix|null|gio|…" },
 		{ "object-component", 0, 0, G_OPTION_ARG_STRING, &opt_object_component, "Object component to use", "client|server" },
 		{ "object-path", 0, 0, G_OPTION_ARG_STRING, &opt_object_path, "Object path to use", "/path/to/storage" },
 		{ "kv-backend", 0, 0, G_OPTION_ARG_STRING, &opt_kv_backend, "Key-value backend to use", "posix|null|gio|…" },
 		{ "kv-component", 0, 0, G_OPTION_ARG_STRING, &opt_kv_component, "Key-value component to use", "client|server" },
 		{ "kv-path", 0, 0, G_OPTION_ARG_STRING, &opt_kv_path, "Key-value path to use", "/path/to/storage" },
+		{ "object-local-namespaces", 0, 0, G_OPTION_ARG_STRING, &opt_object_local_namespaces, "Object namespaces to store in a client-side backend", "scratch,tmp" },
+		{ "object-local-backend", 0, 0, G_OPTION_ARG_STRING, &opt_object_local_backend, "Client-side object backend for local namespaces", "posix|gio|…" },
+		{ "object-local-path", 0, 0, G_OPTION_ARG_STRING, &opt_object_local_path, "Object path for local namespaces", "/path/to/local/storage" },
+		{ "kv-local-namespaces", 0, 0, G_OPTION_ARG_STRING, &opt_kv_local_namespaces, "Key-value namespaces to store in a client-side backend", "scratch,tmp" },
+		{ "kv-local-backend", 0, 0, G_OPTION_ARG_STRING, &opt_kv_local_backend, "Client-side key-value backend for local namespaces", "sqlite|lmdb|…" },
+		{ "kv-local-path", 0, 0, G_OPTION_ARG_STRING, &opt_kv_local_path, "Key-value path for local namespaces", "/path/to/local/storage" },
+		{ "server-mode", 0, 0, G_OPTION_ARG_STRING, &opt_server_mode, "Server connection handling mode", "threaded|event" },
+		{ "server-threads", 0, 0, G_OPTION_ARG_INT, &opt_server_threads, "Number of server worker threads", "0" },
+		{ "server-group-commit-time", 0, 0, G_OPTION_ARG_INT64, &opt_server_group_commit_time, "Time window for grouping syncs in microseconds", "0" },
+		{ "server-group-commit-size", 0, 0, G_OPTION_ARG_INT, &opt_server_group_commit_size, "Maximum number of syncs per group commit", "0" },
+		{ "server-pipeline", 0, 0, G_OPTION_ARG_NONE, &opt_server_pipeline, "Receive messages while the previous one is executed", NULL },
+		{ "server-write-buffer-size", 0, 0, G_OPTION_ARG_INT64, &opt_server_write_buffer_size, "Size of the per-object write buffer in bytes", "0" },
+		{ "server-write-buffer-time", 0, 0, G_OPTION_ARG_INT64, &opt_server_write_buffer_time, "Maximum age of buffered writes in microseconds", "100000" },
+		{ "server-scheduler-slots", 0, 0, G_OPTION_ARG_INT, &opt_server_scheduler_slots, "Maximum number of concurrently executed messages", "0" },
+		{ "server-scheduler-weight-metadata", 0, 0, G_OPTION_ARG_INT, &opt_server_scheduler_weight_metadata, "Scheduler weight of metadata messages", "4" },
+		{ "server-scheduler-weight-small", 0, 0, G_OPTION_ARG_INT, &opt_server_scheduler_weight_small, "Scheduler weight of small I/O messages", "2" },
+		{ "server-scheduler-weight-bulk", 0, 0, G_OPTION_ARG_INT, &opt_server_scheduler_weight_bulk, "Scheduler weight of bulk I/O messages", "1" },
+		{ "server-memory-budget", 0, 0, G_OPTION_ARG_INT64, &opt_server_memory_budget, "Maximum memory used for buffering data in bytes", "0" },
+		{ "server-inline-size", 0, 0, G_OPTION_ARG_INT64, &opt_server_inline_size, "Maximum size of objects stored in the key-value backend in bytes", "0" },
+		{ "server-scrub-rate", 0, 0, G_OPTION_ARG_INT64, &opt_server_scrub_rate, "Rate at which stored data is verified in the background in bytes per second", "0" },
+		{ "server-scrub-interval", 0, 0, G_OPTION_ARG_INT64, &opt_server_scrub_interval, "Time between the starts of two scrubbing passes in seconds", "86400" },
+		{ "server-trash-rate", 0, 0, G_OPTION_ARG_INT64, &opt_server_trash_rate, "Rate at which the space of deleted objects is reclaimed in the background in bytes per second", "0" },
+		{ "server-kv-cache-size", 0, 0, G_OPTION_ARG_INT64, &opt_server_kv_cache_size, "Maximum size of the cache for KV values in bytes", "0" },
+		{ "server-kv-filter", 0, 0, G_OPTION_ARG_NONE, &opt_server_kv_filter, "Answer lookups of non-existent KV keys without accessing the backend", NULL },
+		{ "server-numa-node", 0, 0, G_OPTION_ARG_STRING, &opt_server_numa_node, "NUMA node to bind the server's threads to, or a network interface or block device local to it", "node|interface|device" },
+		{ "server-huge-pages", 0, 0, G_OPTION_ARG_NONE, &opt_server_huge_pages, "Back the server's large buffers with huge pages", NULL },
+		{ "server-journal", 0, 0, G_OPTION_ARG_STRING, &opt_server_journal, "Directory on fast storage to journal buffered writes in", "path" },
+		{ "server-dedup", 0, 0, G_OPTION_ARG_INT, &opt_server_dedup, "Number of written blocks to index for deduplication", "0" },
 		{ "max-connections", 0, 0, G_OPTION_ARG_INT, &opt_max_connections, "Maximum number of connections", "0" },
+		{ "multiplex-connections", 0, 0, G_OPTION_ARG_INT, &opt_multiplex_connections, "Number of multiplexed connections per server", "0" },
+		{ "prewarm-connections", 0, 0, G_OPTION_ARG_INT, &opt_prewarm_connections, "Number of connections per server to establish at startup", "0" },
+		{ "cache-size", 0, 0, G_OPTION_ARG_INT64, &opt_cache_size, "Maximum size of data cached for eventual persistency in bytes", "52428800" },
+		{ "block-size", 0, 0, G_OPTION_ARG_INT64, &opt_block_size, "Default block size of new distributions in bytes", "4194304" },
+		{ "message-size", 0, 0, G_OPTION_ARG_INT64, &opt_message_size, "Maximum amount of data per read or write message in bytes", "67108864" },
+		{ "hedge-percentile", 0, 0, G_OPTION_ARG_INT, &opt_hedge_percentile, "Latency percentile after which reads of replicated objects are sent to another copy", "0" },
+		{ "background-threads", 0, 0, G_OPTION_ARG_INT, &opt_background_threads, "Number of background threads", "0" },
+		{ "pin-threads", 0, 0, G_OPTION_ARG_NONE, &opt_pin_threads, "Pin background threads to processors", NULL },
+		{ "huge-pages", 0, 0, G_OPTION_ARG_NONE, &opt_huge_pages, "Back large buffers with huge pages", NULL },
+		{ "node-cache", 0, 0, G_OPTION_ARG_STRING, &opt_node_cache, "Directory on node-local storage to cache read objects in", "path" },
+		{ "dedup", 0, 0, G_OPTION_ARG_NONE, &opt_dedup, "Only send blocks the servers do not already store", NULL },
+		{ "combine-window", 0, 0, G_OPTION_ARG_INT64, &opt_combine_window, "Time to wait for concurrent batches to combine with in microseconds", "0" },
+		{ "trace-sample", 0, 0, G_OPTION_ARG_INT, &opt_trace_sample, "Trace one out of the given number of batches", "0" },
+		{ "checksums", 0, 0, G_OPTION_ARG_NONE, &opt_checksums, "Checksum messages to detect corruption", NULL },
+		{ "rdma", 0, 0, G_OPTION_ARG_NONE, &opt_rdma, "Transfer object data using RDMA", NULL },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -167,10 +791,38 @@ main (gint argc, gchar** argv)
 	}
 
 	if ((opt_user && opt_system)
+	    || (opt_read && opt_tune)
+	    || (opt_tune && (opt_servers_object != NULL || opt_servers_kv != NULL || opt_object_backend != NULL || opt_object_component != NULL || opt_object_path != NULL || opt_kv_backend != NULL || opt_kv_component != NULL || opt_kv_path != NULL))
 	    || (opt_read && (opt_servers_object != NULL || opt_servers_kv != NULL || opt_object_backend != NULL || opt_object_component != NULL || opt_object_path != NULL || opt_kv_backend != NULL || opt_kv_component != NULL || opt_kv_path != NULL))
 	    || (opt_read && !opt_user && !opt_system)
-	    || (!opt_read && (opt_servers_object == NULL || opt_servers_kv == NULL || opt_object_backend == NULL || opt_object_component == NULL || opt_object_path == NULL || opt_kv_backend == NULL || opt_kv_component == NULL || opt_kv_path == NULL))
+	    || (!opt_read && !opt_tune && (opt_servers_object == NULL || opt_servers_kv == NULL || opt_object_backend == NULL || opt_object_component == NULL || opt_object_path == NULL || opt_kv_backend == NULL || opt_kv_component == NULL || opt_kv_path == NULL))
 	    || opt_max_connections < 0
+	    || opt_multiplex_connections < 0
+	    || opt_prewarm_connections < 0
+	    || opt_cache_size < 0
+	    || opt_block_size < 0
+	    || opt_message_size < 0
+	    || opt_hedge_percentile < 0
+	    || opt_hedge_percentile > 99
+	    || opt_background_threads < 0
+	    || opt_combine_window < 0
+	    || opt_trace_sample < 0
+	    || opt_server_threads < 0
+	    || opt_server_group_commit_time < 0
+	    || opt_server_group_commit_size < 0
+	    || opt_server_write_buffer_size < 0
+	    || opt_server_write_buffer_time < 0
+	    || opt_server_scheduler_slots < 0
+	    || opt_server_scheduler_weight_metadata < 0
+	    || opt_server_scheduler_weight_small < 0
+	    || opt_server_scheduler_weight_bulk < 0
+	    || opt_server_memory_budget < 0
+	    || opt_server_inline_size < 0
+	    || opt_server_scrub_rate < 0
+	    || opt_server_scrub_interval < 0
+	    || opt_server_trash_rate < 0
+	    || opt_server_kv_cache_size < 0
+	    || (opt_server_mode != NULL && g_strcmp0(opt_server_mode, "threaded") != 0 && g_strcmp0(opt_server_mode, "event") != 0)
 	)
 	{
 		g_autofree gchar* help = NULL;
@@ -199,6 +851,10 @@ main (gint argc, gchar** argv)
 	{
 		ret = read_config(path);
 	}
+	else if (opt_tune)
+	{
+		ret = tune_config(path);
+	}
 	else
 	{
 		ret = write_config(path);
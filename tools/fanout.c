@@ -0,0 +1,244 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <julea.h>
+
+static gint opt_from = 0;
+static gint opt_to = 0;
+static gboolean opt_dry_run = FALSE;
+
+/**
+ * Collects the paths of all files below a directory, relative to the namespace's directory.
+ */
+static
+void
+collect_files (gchar const* base, gchar const* relative, GPtrArray* files)
+{
+	GDir* dir;
+	g_autofree gchar* path = NULL;
+	gchar const* name;
+
+	path = (relative != NULL) ? g_build_filename(base, relative, NULL) : g_strdup(base);
+
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return;
+	}
+
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* child = NULL;
+		g_autofree gchar* child_path = NULL;
+
+		child = (relative != NULL) ? g_build_filename(relative, name, NULL) : g_strdup(name);
+		child_path = g_build_filename(base, child, NULL);
+
+		if (g_file_test(child_path, G_FILE_TEST_IS_DIR))
+		{
+			collect_files(base, child, files);
+		}
+		else
+		{
+			g_ptr_array_add(files, g_steal_pointer(&child));
+		}
+	}
+
+	g_dir_close(dir);
+}
+
+/**
+ * Removes all empty directories below a directory.
+ */
+static
+void
+remove_empty_directories (gchar const* path)
+{
+	GDir* dir;
+	gchar const* name;
+
+	if ((dir = g_dir_open(path, 0, NULL)) == NULL)
+	{
+		return;
+	}
+
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* child_path = NULL;
+
+		child_path = g_build_filename(path, name, NULL);
+
+		if (g_file_test(child_path, G_FILE_TEST_IS_DIR))
+		{
+			remove_empty_directories(child_path);
+
+			/* Fails for directories that still contain files. */
+			g_rmdir(child_path);
+		}
+	}
+
+	g_dir_close(dir);
+}
+
+/**
+ * Moves all objects of a namespace from one fan-out depth to another.
+ */
+static
+gboolean
+migrate_namespace (gchar const* namespace_path)
+{
+	g_autoptr(GPtrArray) files = NULL;
+	gboolean ret = TRUE;
+
+	files = g_ptr_array_new_with_free_func(g_free);
+	collect_files(namespace_path, NULL, files);
+
+	for (guint i = 0; i < files->len; i++)
+	{
+		gchar const* file = g_ptr_array_index(files, i);
+		g_auto(GStrv) components = NULL;
+		g_autofree gchar* name = NULL;
+		g_autofree gchar* to = NULL;
+		g_autofree gchar* from_path = NULL;
+		g_autofree gchar* to_path = NULL;
+		g_autofree gchar* parent = NULL;
+
+		components = g_strsplit(file, G_DIR_SEPARATOR_S, opt_from + 1);
+
+		if (g_strv_length(components) <= (guint)opt_from)
+		{
+			g_printerr("Skipping %s/%s, it is not part of a fan-out of depth %d.\n", namespace_path, file, opt_from);
+			continue;
+		}
+
+		/* The last component contains the name, which might itself contain directories. */
+		name = g_strdup(components[opt_from]);
+		to = j_helper_get_fanout_path(name, opt_to);
+
+		if (g_strcmp0(file, to) == 0)
+		{
+			continue;
+		}
+
+		from_path = g_build_filename(namespace_path, file, NULL);
+		to_path = g_build_filename(namespace_path, to, NULL);
+
+		if (opt_dry_run)
+		{
+			g_print("%s -> %s\n", from_path, to_path);
+			continue;
+		}
+
+		if (g_file_test(to_path, G_FILE_TEST_EXISTS))
+		{
+			g_printerr("Skipping %s, %s already exists.\n", from_path, to_path);
+			ret = FALSE;
+			continue;
+		}
+
+		parent = g_path_get_dirname(to_path);
+		g_mkdir_with_parents(parent, 0700);
+
+		if (g_rename(from_path, to_path) != 0)
+		{
+			g_printerr("Could not move %s to %s.\n", from_path, to_path);
+			ret = FALSE;
+		}
+	}
+
+	if (!opt_dry_run)
+	{
+		remove_empty_directories(namespace_path);
+	}
+
+	return ret;
+}
+
+gint
+main (gint argc, gchar** argv)
+{
+	GError* error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	GDir* dir;
+	gchar const* path;
+	gchar const* name;
+	gboolean ret = TRUE;
+
+	GOptionEntry entries[] = {
+		{ "from", 0, 0, G_OPTION_ARG_INT, &opt_from, "Current fan-out depth", "0" },
+		{ "to", 0, 0, G_OPTION_ARG_INT, &opt_to, "New fan-out depth", "0" },
+		{ "dry-run", 0, 0, G_OPTION_ARG_NONE, &opt_dry_run, "Only print the files that would be moved", NULL },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new("PATH");
+	g_option_context_set_summary(context, "Moves the objects stored by the posix backend to a different fan-out depth.\nThe server must not be running.");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		if (error)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+
+		return 1;
+	}
+
+	if (argc != 2 || opt_from < 0 || opt_from > 4 || opt_to < 0 || opt_to > 4)
+	{
+		g_autofree gchar* help = NULL;
+
+		help = g_option_context_get_help(context, TRUE, NULL);
+		g_print("%s", help);
+
+		return 1;
+	}
+
+	path = argv[1];
+
+	if ((dir = g_dir_open(path, 0, &error)) == NULL)
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+
+		return 1;
+	}
+
+	/* Every directory below the storage path is a namespace. */
+	while ((name = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* namespace_path = NULL;
+
+		namespace_path = g_build_filename(path, name, NULL);
+
+		if (g_file_test(namespace_path, G_FILE_TEST_IS_DIR))
+		{
+			ret = migrate_namespace(namespace_path) && ret;
+		}
+	}
+
+	g_dir_close(dir);
+
+	return (ret) ? 0 : 1;
+}
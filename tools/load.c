@@ -0,0 +1,519 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ *
+ * Loads key-value pairs and objects directly into a server's backends, bypassing the server protocol.
+ * Both the server and its clients must not be running.
+ **/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <julea-config.h>
+
+#include <glib.h>
+#include <gmodule.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <bson.h>
+
+#include <julea.h>
+#include <julea-internal.h>
+
+static gint opt_server = 0;
+static gint opt_port = 4711;
+static gint opt_batch_size = 100000;
+
+/**
+ * Returns the backend path used by the server, which debug builds separate by port.
+ */
+static
+gchar*
+load_get_path (gchar const* path)
+{
+#ifdef JULEA_DEBUG
+	return g_strdup_printf("%s/%d", path, opt_port);
+#else
+	return g_strdup(path);
+#endif
+}
+
+/**
+ * Returns whether a namespace contains secondary index declarations.
+ * Their entries are maintained by the server, so such namespaces cannot be loaded offline.
+ */
+static
+gboolean
+load_kv_has_indexes (JBackend* backend, gchar const* namespace)
+{
+	gpointer iterator;
+	gchar const* key;
+	bson_t value[1];
+	gboolean ret = FALSE;
+
+	if (!j_backend_kv_get_by_prefix(backend, namespace, "\x02", &iterator))
+	{
+		return FALSE;
+	}
+
+	/* Iterators have to be exhausted. */
+	while (j_backend_kv_iterate(backend, iterator, &key, value))
+	{
+		ret = TRUE;
+	}
+
+	return ret;
+}
+
+static
+gboolean
+load_kv_batch_start (JBackend* backend, gchar const* namespace, gpointer* batch)
+{
+	/* Batches are large, so syncing every one of them is cheap and leaves completely loaded batches on errors. */
+	if (!j_backend_kv_batch_start(backend, namespace, J_SEMANTICS_SAFETY_STORAGE, batch))
+	{
+		return FALSE;
+	}
+
+	if (backend->kv.batch_set_sorted != NULL && !j_backend_kv_batch_set_sorted(backend, *batch))
+	{
+		j_backend_kv_batch_execute(backend, *batch);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Loads key-value pairs from a file with one "key<TAB>JSON value" line per pair.
+ * The keys have to be sorted in ascending byte order, so backends can append them.
+ */
+static
+gboolean
+load_kv (JConfiguration* configuration, gchar const* namespace, gchar const* file_name)
+{
+	GModule* module;
+	JBackend* backend;
+	g_autofree gchar* path = NULL;
+	g_autofree gchar* previous = NULL;
+	FILE* file;
+	gchar* line = NULL;
+	gsize line_size = 0;
+	gpointer batch = NULL;
+	guint64 line_number = 0;
+	guint64 loaded = 0;
+	guint64 skipped = 0;
+	guint32 batch_len = 0;
+	guint32 server_count;
+	gboolean ret = FALSE;
+
+	server_count = j_configuration_get_kv_server_count(configuration);
+
+	if ((guint32)opt_server >= server_count)
+	{
+		g_printerr("There are only %u key-value servers.\n", server_count);
+		return FALSE;
+	}
+
+	if (!j_backend_load_server(j_configuration_get_kv_backend(configuration), j_configuration_get_kv_component(configuration), J_BACKEND_TYPE_KV, &module, &backend))
+	{
+		g_printerr("Key-value backend %s does not run on the server and cannot be loaded offline.\n", j_configuration_get_kv_backend(configuration));
+		return FALSE;
+	}
+
+	path = load_get_path(j_configuration_get_kv_path(configuration));
+
+	if (backend == NULL || !j_backend_kv_init(backend, path))
+	{
+		g_printerr("Could not initialize key-value backend %s.\n", j_configuration_get_kv_backend(configuration));
+		goto end_module;
+	}
+
+	if (load_kv_has_indexes(backend, namespace))
+	{
+		g_printerr("Namespace %s has secondary indexes, which are only maintained by the server.\n", namespace);
+		goto end_backend;
+	}
+
+	file = (g_strcmp0(file_name, "-") == 0) ? stdin : fopen(file_name, "r");
+
+	if (file == NULL)
+	{
+		g_printerr("Could not open %s: %s\n", file_name, g_strerror(errno));
+		goto end_backend;
+	}
+
+	ret = TRUE;
+
+	while (ret && getline(&line, &line_size, file) != -1)
+	{
+		bson_t* value;
+		bson_error_t error;
+		gchar* separator;
+		gsize length;
+
+		line_number++;
+		length = strlen(line);
+
+		if (length > 0 && line[length - 1] == '\n')
+		{
+			line[length - 1] = '\0';
+		}
+
+		if (line[0] == '\0')
+		{
+			continue;
+		}
+
+		if ((separator = strchr(line, '\t')) == NULL)
+		{
+			g_printerr("%s:%" G_GUINT64_FORMAT ": Missing tab between key and value.\n", file_name, line_number);
+			ret = FALSE;
+			break;
+		}
+
+		*separator = '\0';
+
+		/* Such keys are used internally by secondary indexes. */
+		if (line[0] == '\0' || line[0] == '\x01' || line[0] == '\x02')
+		{
+			g_printerr("%s:%" G_GUINT64_FORMAT ": Invalid key.\n", file_name, line_number);
+			ret = FALSE;
+			break;
+		}
+
+		if (previous != NULL && strcmp(previous, line) >= 0)
+		{
+			g_printerr("%s:%" G_GUINT64_FORMAT ": Key %s is not greater than previous key %s.\n", file_name, line_number, line, previous);
+			ret = FALSE;
+			break;
+		}
+
+		g_free(previous);
+		previous = g_strdup(line);
+
+		/* Clients distribute keys by their hash. */
+		if (j_helper_hash(line) % server_count != (guint32)opt_server)
+		{
+			skipped++;
+			continue;
+		}
+
+		if ((value = bson_new_from_json((guint8 const*)(separator + 1), -1, &error)) == NULL)
+		{
+			g_printerr("%s:%" G_GUINT64_FORMAT ": %s\n", file_name, line_number, error.message);
+			ret = FALSE;
+			break;
+		}
+
+		if (batch == NULL && !load_kv_batch_start(backend, namespace, &batch))
+		{
+			g_printerr("Could not start batch.\n");
+			bson_destroy(value);
+			ret = FALSE;
+			break;
+		}
+
+		ret = j_backend_kv_put(backend, batch, line, value);
+		bson_destroy(value);
+
+		if (!ret)
+		{
+			g_printerr("%s:%" G_GUINT64_FORMAT ": Could not store key %s.\n", file_name, line_number, line);
+			break;
+		}
+
+		loaded++;
+
+		if (++batch_len == (guint32)opt_batch_size)
+		{
+			ret = j_backend_kv_batch_execute(backend, batch);
+			batch = NULL;
+			batch_len = 0;
+		}
+	}
+
+	if (batch != NULL && !j_backend_kv_batch_execute(backend, batch))
+	{
+		ret = FALSE;
+	}
+
+	if (ret)
+	{
+		g_print("Loaded %" G_GUINT64_FORMAT " key-value pairs, skipped %" G_GUINT64_FORMAT " belonging to other servers.\n", loaded, skipped);
+	}
+
+	free(line);
+
+	if (file != stdin)
+	{
+		fclose(file);
+	}
+
+end_backend:
+	j_backend_kv_fini(backend);
+
+end_module:
+	if (module != NULL)
+	{
+		g_module_close(module);
+	}
+
+	return ret;
+}
+
+/**
+ * Writes a local file to an object sequentially.
+ */
+static
+gboolean
+load_object_file (JBackend* backend, gchar const* namespace, gchar const* name, gchar const* file_name, gpointer buffer)
+{
+	gpointer object;
+	guint64 offset = 0;
+	gboolean ret = TRUE;
+	gint fd;
+
+	if ((fd = open(file_name, O_RDONLY)) == -1)
+	{
+		g_printerr("Could not open %s: %s\n", file_name, g_strerror(errno));
+		return FALSE;
+	}
+
+	if (!j_backend_object_create(backend, namespace, name, &object))
+	{
+		g_printerr("Could not create object %s.\n", name);
+		close(fd);
+		return FALSE;
+	}
+
+	/* Existing objects are kept by create, so longer ones have to be cut off. */
+	if (backend->object.truncate != NULL)
+	{
+		ret = j_backend_object_truncate(backend, object, 0);
+	}
+
+	while (ret)
+	{
+		gssize nbytes;
+		guint64 bytes_written = 0;
+
+		if ((nbytes = read(fd, buffer, J_STRIPE_SIZE)) <= 0)
+		{
+			ret = (nbytes == 0);
+			break;
+		}
+
+		ret = j_backend_object_write(backend, object, buffer, nbytes, offset, &bytes_written) && bytes_written == (guint64)nbytes;
+		offset += nbytes;
+	}
+
+	if (ret)
+	{
+		ret = j_backend_object_sync(backend, object);
+	}
+
+	if (!ret)
+	{
+		g_printerr("Could not load %s into object %s.\n", file_name, name);
+	}
+
+	j_backend_object_close(backend, object);
+	close(fd);
+
+	return ret;
+}
+
+/**
+ * Loads all files below a directory, named by their relative paths.
+ */
+static
+gboolean
+load_object_directory (JBackend* backend, gchar const* namespace, gchar const* base, gchar const* relative, guint32 server_count, gpointer buffer, guint64* loaded, guint64* skipped)
+{
+	GDir* dir;
+	GError* error = NULL;
+	g_autofree gchar* path = NULL;
+	gchar const* name;
+	gboolean ret = TRUE;
+
+	path = (relative != NULL) ? g_build_filename(base, relative, NULL) : g_strdup(base);
+
+	if ((dir = g_dir_open(path, 0, &error)) == NULL)
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+
+		return FALSE;
+	}
+
+	while (ret && (name = g_dir_read_name(dir)) != NULL)
+	{
+		g_autofree gchar* child = NULL;
+		g_autofree gchar* child_path = NULL;
+
+		child = (relative != NULL) ? g_strdup_printf("%s/%s", relative, name) : g_strdup(name);
+		child_path = g_build_filename(base, child, NULL);
+
+		if (g_file_test(child_path, G_FILE_TEST_IS_DIR))
+		{
+			ret = load_object_directory(backend, namespace, base, child, server_count, buffer, loaded, skipped);
+		}
+		else if (j_helper_hash(child) % server_count != (guint32)opt_server)
+		{
+			/* Clients distribute objects by the hash of their name. */
+			(*skipped)++;
+		}
+		else
+		{
+			ret = load_object_file(backend, namespace, child, child_path, buffer);
+			(*loaded)++;
+		}
+	}
+
+	g_dir_close(dir);
+
+	return ret;
+}
+
+/**
+ * Loads all files below a directory as objects.
+ * Objects are always stored in the object backend, even if the server stores small objects inline, because it falls back to the object backend when opening them.
+ */
+static
+gboolean
+load_object (JConfiguration* configuration, gchar const* namespace, gchar const* directory)
+{
+	GModule* module;
+	JBackend* backend;
+	g_autofree gchar* path = NULL;
+	g_autofree gpointer buffer = NULL;
+	guint64 loaded = 0;
+	guint64 skipped = 0;
+	guint32 server_count;
+	gboolean ret = FALSE;
+
+	server_count = j_configuration_get_object_server_count(configuration);
+
+	if ((guint32)opt_server >= server_count)
+	{
+		g_printerr("There are only %u object servers.\n", server_count);
+		return FALSE;
+	}
+
+	if (!j_backend_load_server(j_configuration_get_object_backend(configuration), j_configuration_get_object_component(configuration), J_BACKEND_TYPE_OBJECT, &module, &backend))
+	{
+		g_printerr("Object backend %s does not run on the server and cannot be loaded offline.\n", j_configuration_get_object_backend(configuration));
+		return FALSE;
+	}
+
+	path = load_get_path(j_configuration_get_object_path(configuration));
+
+	if (backend == NULL || !j_backend_object_init(backend, path))
+	{
+		g_printerr("Could not initialize object backend %s.\n", j_configuration_get_object_backend(configuration));
+		goto end;
+	}
+
+	buffer = g_malloc(J_STRIPE_SIZE);
+	ret = load_object_directory(backend, namespace, directory, NULL, server_count, buffer, &loaded, &skipped);
+
+	if (ret)
+	{
+		g_print("Loaded %" G_GUINT64_FORMAT " objects, skipped %" G_GUINT64_FORMAT " belonging to other servers.\n", loaded, skipped);
+	}
+
+	j_backend_object_fini(backend);
+
+end:
+	if (module != NULL)
+	{
+		g_module_close(module);
+	}
+
+	return ret;
+}
+
+gint
+main (gint argc, gchar** argv)
+{
+	GError* error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(JConfiguration) configuration = NULL;
+	gboolean ret;
+
+	GOptionEntry entries[] = {
+		{ "server", 0, 0, G_OPTION_ARG_INT, &opt_server, "Index of the server whose storage is loaded", "0" },
+		{ "port", 0, 0, G_OPTION_ARG_INT, &opt_port, "Port of the server, used to find its storage in debug builds", "4711" },
+		{ "batch-size", 0, 0, G_OPTION_ARG_INT, &opt_batch_size, "Number of key-value pairs stored per batch", "100000" },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new("kv NAMESPACE FILE | object NAMESPACE DIRECTORY");
+	g_option_context_set_summary(context, "Loads key-value pairs or objects directly into a server's backends.\n"
+		"Key-value pairs are read from FILE (- for standard input) with one \"key<TAB>JSON value\" line per pair, sorted by key.\n"
+		"Objects are read from all files below DIRECTORY and named by their relative paths.\n"
+		"Entries belonging to other servers are skipped, so the same input can be loaded on all servers.\n"
+		"The server must not be running.");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		if (error)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+
+		return 1;
+	}
+
+	if (argc != 4 || opt_server < 0 || opt_batch_size <= 0 || (g_strcmp0(argv[1], "kv") != 0 && g_strcmp0(argv[1], "object") != 0))
+	{
+		g_autofree gchar* help = NULL;
+
+		help = g_option_context_get_help(context, TRUE, NULL);
+		g_print("%s", help);
+
+		return 1;
+	}
+
+	if ((configuration = j_configuration_new()) == NULL)
+	{
+		g_printerr("Could not read configuration.\n");
+		return 1;
+	}
+
+	if (g_strcmp0(argv[1], "kv") == 0)
+	{
+		ret = load_kv(configuration, argv[2], argv[3]);
+	}
+	else
+	{
+		ret = load_object(configuration, argv[2], argv[3]);
+	}
+
+	return (ret) ? 0 : 1;
+}
@@ -20,6 +20,9 @@
 
 #include <glib.h>
 
+#include <string.h>
+#include <unistd.h>
+
 #include <julea.h>
 
 #include <jcommon.h>
@@ -27,28 +30,197 @@
 #include <jmessage.h>
 #include <jstatistics.h>
 
+static gint opt_interval = 0;
+static gint opt_count = 0;
+static gboolean opt_prometheus = FALSE;
+
+/**
+ * The number of counters reported by a server.
+ */
+#define STATISTICS_VALUES (J_STATISTICS_BYTES_STORED + 1)
+
+/**
+ * The number of scrubbing counters reported by a server.
+ */
+#define SCRUB_VALUES 5
+
+/**
+ * The latency histograms reported by a server.
+ */
+struct Latencies
+{
+	guint32 types;
+	guint32 phases;
+	guint32 buckets;
+
+	/**
+	 * The counters, ordered by message type, phase and bucket.
+	 */
+	guint64* counts;
+};
+
+typedef struct Latencies Latencies;
+
+/**
+ * A server's state at one point in time.
+ */
+struct Sample
+{
+	gboolean valid;
+
+	/**
+	 * The monotonic time the reply was received at.
+	 */
+	gint64 time;
+
+	guint64 values[STATISTICS_VALUES];
+
+	/**
+	 * The number of open connections, G_MAXUINT64 if not reported.
+	 */
+	guint64 connections;
+
+	/**
+	 * The scrubber's progress, see scrub_names.
+	 */
+	gboolean scrub_valid;
+	guint64 scrub[SCRUB_VALUES];
+
+	Latencies latencies;
+
+	/**
+	 * The most recent traced messages, 5 values each, see read_traced.
+	 */
+	guint64 traced_count;
+	guint64* traced;
+};
+
+typedef struct Sample Sample;
+
+/**
+ * A server to poll.
+ * A host that is configured as object and key-value server is only polled once, because both are handled by the same process.
+ */
+struct Server
+{
+	gchar const* host;
+
+	gboolean object;
+	guint index;
+
+	Sample current;
+	Sample previous;
+};
+
+typedef struct Server Server;
+
+static gchar const* statistics_names[] = {
+	"files_created",
+	"files_deleted",
+	"files_stated",
+	"syncs",
+	"bytes_read",
+	"bytes_written",
+	"bytes_received",
+	"bytes_sent",
+	"checksum_errors",
+	"kv_cache_hits",
+	"kv_cache_misses",
+	"bytes_compressed",
+	"bytes_stored"
+};
+
+static gchar const* scrub_names[] = {
+	"scrub_passes",
+	"scrub_objects",
+	"scrub_bytes",
+	"scrub_corrupted_blocks",
+	"scrub_missing_objects"
+};
+
+static gchar const* latency_types[] = {
+	"none",
+	"ping",
+	"statistics",
+	"object create",
+	"object delete",
+	"object read",
+	"object status",
+	"object write",
+	"kv put",
+	"kv delete",
+	"kv get",
+	"kv get all",
+	"kv get by prefix",
+	"object capacity",
+	"object truncate",
+	"object allocate",
+	"object punch hole",
+	"object copy",
+	"kv compare and swap",
+	"kv increment",
+	"kv create index",
+	"kv get by index",
+	"kv max merge",
+	"object purge",
+	"kv delete by prefix",
+	"lock acquire",
+	"lock release",
+	"lock revoke",
+	"object list",
+	"object dedup",
+	"object append",
+	"object reduce",
+	"kv watch",
+	"kv put raw",
+	"kv get raw",
+	"object open",
+	"object close",
+	"compound"
+};
+
+static gchar const* latency_phases[] = {
+	"queue",
+	"backend",
+	"send"
+};
+
 static
 void
-print_statistics (JStatistics* statistics)
+print_statistics (guint64 const* values)
 {
 	gchar* size_read;
 	gchar* size_written;
 	gchar* size_received;
 	gchar* size_sent;
 
-	size_read = g_format_size(j_statistics_get(statistics, J_STATISTICS_BYTES_READ));
-	size_written = g_format_size(j_statistics_get(statistics, J_STATISTICS_BYTES_WRITTEN));
-	size_received = g_format_size(j_statistics_get(statistics, J_STATISTICS_BYTES_RECEIVED));
-	size_sent = g_format_size(j_statistics_get(statistics, J_STATISTICS_BYTES_SENT));
+	size_read = g_format_size(values[J_STATISTICS_BYTES_READ]);
+	size_written = g_format_size(values[J_STATISTICS_BYTES_WRITTEN]);
+	size_received = g_format_size(values[J_STATISTICS_BYTES_RECEIVED]);
+	size_sent = g_format_size(values[J_STATISTICS_BYTES_SENT]);
 
-	g_print("  %" G_GUINT64_FORMAT " files created\n", j_statistics_get(statistics, J_STATISTICS_FILES_CREATED));
-	g_print("  %" G_GUINT64_FORMAT " files deleted\n", j_statistics_get(statistics, J_STATISTICS_FILES_DELETED));
-	g_print("  %" G_GUINT64_FORMAT " files stat'ed\n", j_statistics_get(statistics, J_STATISTICS_FILES_STATED));
-	g_print("  %" G_GUINT64_FORMAT " syncs\n", j_statistics_get(statistics, J_STATISTICS_SYNC));
+	g_print("  %" G_GUINT64_FORMAT " files created\n", values[J_STATISTICS_FILES_CREATED]);
+	g_print("  %" G_GUINT64_FORMAT " files deleted\n", values[J_STATISTICS_FILES_DELETED]);
+	g_print("  %" G_GUINT64_FORMAT " files stat'ed\n", values[J_STATISTICS_FILES_STATED]);
+	g_print("  %" G_GUINT64_FORMAT " syncs\n", values[J_STATISTICS_SYNC]);
 	g_print("  %s read\n", size_read);
 	g_print("  %s written\n", size_written);
 	g_print("  %s received\n", size_received);
 	g_print("  %s sent\n", size_sent);
+	g_print("  %" G_GUINT64_FORMAT " checksum errors\n", values[J_STATISTICS_CHECKSUM_ERRORS]);
+	g_print("  %" G_GUINT64_FORMAT " KV cache hits\n", values[J_STATISTICS_KV_CACHE_HITS]);
+	g_print("  %" G_GUINT64_FORMAT " KV cache misses\n", values[J_STATISTICS_KV_CACHE_MISSES]);
+
+	if (values[J_STATISTICS_BYTES_STORED] > 0)
+	{
+		g_autofree gchar* size_compressed = NULL;
+		g_autofree gchar* size_stored = NULL;
+
+		size_compressed = g_format_size(values[J_STATISTICS_BYTES_COMPRESSED]);
+		size_stored = g_format_size(values[J_STATISTICS_BYTES_STORED]);
+
+		g_print("  %s compressed to %s (ratio %.2f)\n", size_compressed, size_stored, (gdouble)values[J_STATISTICS_BYTES_COMPRESSED] / values[J_STATISTICS_BYTES_STORED]);
+	}
 
 	g_free(size_read);
 	g_free(size_written);
@@ -56,94 +228,842 @@ print_statistics (JStatistics* statistics)
 	g_free(size_sent);
 }
 
-int
-main (int argc, char** argv)
+/**
+ * Returns the upper bound of the bucket containing the given percentile.
+ */
+static
+guint64
+latency_percentile (guint64 const* counts, guint32 buckets, guint64 total, gdouble percentile)
 {
-	JConfiguration* configuration;
-	g_autoptr(JMessage) message = NULL;
-	JStatistics* statistics_total;
-	gchar get_all;
+	guint64 threshold;
+	guint64 sum = 0;
 
-	(void)argc;
-	(void)argv;
+	threshold = (guint64)(total * percentile);
 
-	j_init();
+	for (guint32 i = 0; i < buckets; i++)
+	{
+		sum += counts[i];
 
-	get_all = 1;
-	configuration = j_configuration();
-	statistics_total = j_statistics_new(FALSE);
+		if (sum > threshold || sum == total)
+		{
+			return G_GUINT64_CONSTANT(1) << i;
+		}
+	}
+
+	return G_GUINT64_CONSTANT(1) << (buckets - 1);
+}
+
+/**
+ * Prints the percentiles of all non-empty histograms.
+ *
+ * \param duration The time the histograms cover in microseconds, 0 to print absolute counts instead of rates.
+ */
+static
+void
+print_latencies (Latencies const* latencies, gint64 duration)
+{
+	for (guint32 i = 0; i < latencies->types; i++)
+	{
+		for (guint32 j = 0; j < latencies->phases; j++)
+		{
+			guint64 const* counts;
+			guint64 total = 0;
+			gchar const* type;
+			gchar const* phase;
+
+			counts = latencies->counts + ((i * latencies->phases) + j) * latencies->buckets;
+
+			for (guint32 k = 0; k < latencies->buckets; k++)
+			{
+				total += counts[k];
+			}
+
+			if (total == 0)
+			{
+				continue;
+			}
+
+			type = (i < G_N_ELEMENTS(latency_types)) ? latency_types[i] : "unknown";
+			phase = (j < G_N_ELEMENTS(latency_phases)) ? latency_phases[j] : "unknown";
+
+			if (duration > 0)
+			{
+				g_print("  %s %s: %.1f messages/s", type, phase, (gdouble)total * G_USEC_PER_SEC / duration);
+			}
+			else
+			{
+				g_print("  %s %s: %" G_GUINT64_FORMAT " messages", type, phase, total);
+			}
+
+			g_print(", p50 < %" G_GUINT64_FORMAT " us, p99 < %" G_GUINT64_FORMAT " us, p99.9 < %" G_GUINT64_FORMAT " us\n",
+				latency_percentile(counts, latencies->buckets, total, 0.5),
+				latency_percentile(counts, latencies->buckets, total, 0.99),
+				latency_percentile(counts, latencies->buckets, total, 0.999));
+		}
+	}
+}
+
+/**
+ * Adds the histograms of from to to.
+ * Histograms of different dimensions are ignored.
+ */
+static
+void
+latencies_add (Latencies* to, Latencies const* from)
+{
+	gsize count;
+
+	if (from->counts == NULL)
+	{
+		return;
+	}
+
+	count = from->types * from->phases * from->buckets;
+
+	if (to->counts == NULL)
+	{
+		to->types = from->types;
+		to->phases = from->phases;
+		to->buckets = from->buckets;
+		to->counts = g_new0(guint64, count);
+	}
+
+	if (to->types != from->types || to->phases != from->phases || to->buckets != from->buckets)
+	{
+		return;
+	}
+
+	for (gsize i = 0; i < count; i++)
+	{
+		to->counts[i] += from->counts[i];
+	}
+}
+
+/**
+ * Returns the increase of a counter.
+ * A counter that went backwards belongs to a restarted server, so its current value is the increase.
+ */
+static
+guint64
+counter_delta (guint64 current, guint64 previous)
+{
+	return (current >= previous) ? current - previous : current;
+}
+
+/**
+ * Computes the histograms of the messages handled between two samples.
+ */
+static
+void
+latencies_delta (Latencies* delta, Latencies const* current, Latencies const* previous)
+{
+	gsize count;
+
+	delta->types = current->types;
+	delta->phases = current->phases;
+	delta->buckets = current->buckets;
+	delta->counts = NULL;
+
+	if (current->counts == NULL)
+	{
+		return;
+	}
+
+	count = current->types * current->phases * current->buckets;
+	delta->counts = g_new(guint64, count);
+
+	for (gsize i = 0; i < count; i++)
+	{
+		guint64 before = 0;
+
+		if (previous->counts != NULL && previous->types == current->types && previous->phases == current->phases && previous->buckets == current->buckets)
+		{
+			before = previous->counts[i];
+		}
+
+		delta->counts[i] = counter_delta(current->counts[i], before);
+	}
+}
+
+static
+void
+sample_clear (Sample* sample)
+{
+	g_free(sample->latencies.counts);
+	g_free(sample->traced);
+	memset(sample, 0, sizeof(*sample));
+}
+
+/**
+ * Reads the latency histograms from a reply.
+ */
+static
+gboolean
+read_latencies (JMessage* reply, Latencies* latencies)
+{
+	gsize count;
+
+	/* Older servers do not report latencies. */
+	if (j_message_get_count(reply) < 2)
+	{
+		return FALSE;
+	}
+
+	latencies->types = j_message_get_4(reply);
+	latencies->phases = j_message_get_4(reply);
+	latencies->buckets = j_message_get_4(reply);
+
+	count = latencies->types * latencies->phases * latencies->buckets;
+	latencies->counts = g_new(guint64, count);
+
+	for (gsize i = 0; i < count; i++)
+	{
+		latencies->counts[i] = j_message_get_8(reply);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Reads the most recent traced messages from a reply.
+ * Each consists of the trace ID, the message type and the queue, backend and send latencies.
+ */
+static
+void
+read_traced (JMessage* reply, Sample* sample)
+{
+	/* Older servers do not report traced messages. */
+	if (j_message_get_count(reply) < 5)
+	{
+		return;
+	}
+
+	sample->traced_count = j_message_get_8(reply);
+	sample->traced = g_new(guint64, sample->traced_count * 5);
+
+	for (guint64 i = 0; i < sample->traced_count * 5; i++)
+	{
+		sample->traced[i] = j_message_get_8(reply);
+	}
+}
+
+/**
+ * Requests a server's statistics and stores them as its current sample.
+ * Runs in its own thread, so all servers are polled in parallel.
+ */
+static
+gpointer
+poll_server (gpointer data)
+{
+	Server* server = data;
+	g_autoptr(JMessage) message = NULL;
+	g_autoptr(JMessage) reply = NULL;
+	Sample* sample = &(server->current);
+	gchar get_all = 1;
 
 	message = j_message_new(J_MESSAGE_STATISTICS, sizeof(gchar));
 	j_message_add_operation(message, 0);
 	j_message_append_1(message, &get_all);
 
+	if (server->object)
+	{
+		reply = j_connection_pool_request_object(server->index, message, TRUE);
+	}
+	else
+	{
+		reply = j_connection_pool_request_kv(server->index, message, TRUE);
+	}
+
+	sample_clear(sample);
+
+	if (reply == NULL)
+	{
+		return NULL;
+	}
+
+	sample->valid = TRUE;
+	sample->time = g_get_monotonic_time();
+	sample->connections = G_MAXUINT64;
+
+	for (guint i = 0; i < STATISTICS_VALUES; i++)
+	{
+		sample->values[i] = j_message_get_8(reply);
+	}
+
+	if (read_latencies(reply, &(sample->latencies)) && j_message_get_count(reply) >= 3)
+	{
+		sample->connections = j_message_get_8(reply);
+	}
+
+	if (j_message_get_count(reply) >= 4)
+	{
+		sample->scrub_valid = TRUE;
+
+		for (guint i = 0; i < SCRUB_VALUES; i++)
+		{
+			sample->scrub[i] = j_message_get_8(reply);
+		}
+	}
+
+	read_traced(reply, sample);
+
+	return NULL;
+}
+
+static
+void
+poll_servers (GArray* servers)
+{
+	GThread** threads;
+
+	threads = g_new(GThread*, servers->len);
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server* server = &g_array_index(servers, Server, i);
+
+		sample_clear(&(server->previous));
+		server->previous = server->current;
+		memset(&(server->current), 0, sizeof(server->current));
+
+		threads[i] = g_thread_new("julea-statistics", poll_server, server);
+	}
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		g_thread_join(threads[i]);
+	}
+
+	g_free(threads);
+}
+
+/**
+ * Collects the object servers and all key-value servers running on other hosts.
+ */
+static
+GArray*
+servers_new (JConfiguration* configuration)
+{
+	GArray* servers;
+
+	servers = g_array_new(FALSE, TRUE, sizeof(Server));
+
 	for (guint i = 0; i < j_configuration_get_object_server_count(configuration); i++)
 	{
-		g_autoptr(JMessage) reply = NULL;
-		JStatistics* statistics;
-		GSocketConnection* connection;
-		guint64 value;
+		Server server;
+
+		memset(&server, 0, sizeof(server));
+		server.host = j_configuration_get_object_server(configuration, i);
+		server.object = TRUE;
+		server.index = i;
+		g_array_append_val(servers, server);
+	}
+
+	for (guint i = 0; i < j_configuration_get_kv_server_count(configuration); i++)
+	{
+		Server server;
+		gboolean known = FALSE;
+
+		memset(&server, 0, sizeof(server));
+		server.host = j_configuration_get_kv_server(configuration, i);
+		server.index = i;
+
+		for (guint j = 0; j < servers->len; j++)
+		{
+			if (g_strcmp0(g_array_index(servers, Server, j).host, server.host) == 0)
+			{
+				known = TRUE;
+				break;
+			}
+		}
+
+		if (!known)
+		{
+			g_array_append_val(servers, server);
+		}
+	}
+
+	return servers;
+}
+
+static
+void
+servers_free (GArray* servers)
+{
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server* server = &g_array_index(servers, Server, i);
 
-		connection = j_connection_pool_pop_object(i);
-		statistics = j_statistics_new(FALSE);
+		sample_clear(&(server->current));
+		sample_clear(&(server->previous));
+	}
 
-		j_message_send(message, connection);
+	g_array_free(servers, TRUE);
+}
 
-		reply = j_message_new_reply(message);
-		j_message_receive(reply, connection);
+/**
+ * Prints the scrubber's progress, unless it has not done anything.
+ */
+static
+void
+print_scrub (guint64 const* scrub)
+{
+	g_autofree gchar* size = NULL;
+	gboolean idle = TRUE;
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_FILES_CREATED, value);
-		j_statistics_add(statistics_total, J_STATISTICS_FILES_CREATED, value);
+	for (guint i = 0; i < SCRUB_VALUES; i++)
+	{
+		idle = idle && (scrub[i] == 0);
+	}
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_FILES_DELETED, value);
-		j_statistics_add(statistics_total, J_STATISTICS_FILES_DELETED, value);
+	if (idle)
+	{
+		return;
+	}
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_FILES_STATED, value);
-		j_statistics_add(statistics_total, J_STATISTICS_FILES_STATED, value);
+	size = g_format_size(scrub[2]);
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_SYNC, value);
-		j_statistics_add(statistics_total, J_STATISTICS_SYNC, value);
+	g_print("  scrubbing: %" G_GUINT64_FORMAT " passes, %" G_GUINT64_FORMAT " objects, %s read, %" G_GUINT64_FORMAT " corrupted blocks, %" G_GUINT64_FORMAT " missing objects\n",
+		scrub[0], scrub[1], size, scrub[3], scrub[4]);
+}
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_BYTES_READ, value);
-		j_statistics_add(statistics_total, J_STATISTICS_BYTES_READ, value);
+/**
+ * Prints the most recent traced messages, if there are any.
+ */
+static
+void
+print_traced (Sample const* sample)
+{
+	if (sample->traced_count == 0)
+	{
+		return;
+	}
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_BYTES_WRITTEN, value);
-		j_statistics_add(statistics_total, J_STATISTICS_BYTES_WRITTEN, value);
+	g_print("  Recent traced requests:\n");
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_BYTES_RECEIVED, value);
-		j_statistics_add(statistics_total, J_STATISTICS_BYTES_RECEIVED, value);
+	for (guint64 i = 0; i < sample->traced_count; i++)
+	{
+		guint64 const* traced = &(sample->traced[i * 5]);
+		gchar const* type;
 
-		value = j_message_get_8(reply);
-		j_statistics_add(statistics, J_STATISTICS_BYTES_SENT, value);
-		j_statistics_add(statistics_total, J_STATISTICS_BYTES_SENT, value);
+		type = (traced[1] < G_N_ELEMENTS(latency_types)) ? latency_types[traced[1]] : "unknown";
 
-		g_print("Data server %d\n", i);
-		print_statistics(statistics);
+		g_print("    %016" G_GINT64_MODIFIER "x %s: queue %" G_GUINT64_FORMAT " us, backend %" G_GUINT64_FORMAT " us, send %" G_GUINT64_FORMAT " us\n",
+			traced[0], type, traced[2], traced[3], traced[4]);
+	}
+}
 
-		if (i != j_configuration_get_object_server_count(configuration) - 1)
+static
+void
+print_server_name (Server const* server)
+{
+	g_print("%s server %u (%s)\n", (server->object) ? "Object" : "Key-value", server->index, server->host);
+}
+
+/**
+ * Prints the absolute counters of all servers once.
+ */
+static
+void
+print_snapshot (GArray* servers)
+{
+	guint64 values_total[STATISTICS_VALUES] = { 0 };
+	Latencies latencies_total = { 0, 0, 0, NULL };
+	guint64 connections_total = 0;
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server const* server = &g_array_index(servers, Server, i);
+		Sample const* sample = &(server->current);
+
+		if (i > 0)
 		{
 			g_print("\n");
 		}
 
-		j_statistics_free(statistics);
-		j_connection_pool_push_object(i, connection);
+		print_server_name(server);
+
+		if (!sample->valid)
+		{
+			g_print("  unreachable\n");
+			continue;
+		}
+
+		print_statistics(sample->values);
+
+		if (sample->connections != G_MAXUINT64)
+		{
+			g_print("  %" G_GUINT64_FORMAT " open connections\n", sample->connections);
+			connections_total += sample->connections;
+		}
+
+		if (sample->scrub_valid)
+		{
+			print_scrub(sample->scrub);
+		}
+
+		if (sample->latencies.counts != NULL)
+		{
+			print_latencies(&(sample->latencies), 0);
+		}
+
+		print_traced(sample);
+
+		for (guint j = 0; j < STATISTICS_VALUES; j++)
+		{
+			values_total[j] += sample->values[j];
+		}
+
+		latencies_add(&latencies_total, &(sample->latencies));
 	}
 
-	if (j_configuration_get_object_server_count(configuration) > 1)
+	if (servers->len > 1)
 	{
 		g_print("\n");
 		g_print("Total\n");
-		print_statistics(statistics_total);
+		print_statistics(values_total);
+		g_print("  %" G_GUINT64_FORMAT " open connections\n", connections_total);
+
+		if (latencies_total.counts != NULL)
+		{
+			print_latencies(&latencies_total, 0);
+		}
+	}
+
+	g_free(latencies_total.counts);
+}
+
+static
+void
+print_rate_line (gchar const* name, guint64 const* deltas, gint64 duration, guint64 connections)
+{
+	gchar* rates[4];
+	gdouble ops;
+
+	rates[0] = g_format_size(deltas[J_STATISTICS_BYTES_READ] * G_USEC_PER_SEC / duration);
+	rates[1] = g_format_size(deltas[J_STATISTICS_BYTES_WRITTEN] * G_USEC_PER_SEC / duration);
+	rates[2] = g_format_size(deltas[J_STATISTICS_BYTES_RECEIVED] * G_USEC_PER_SEC / duration);
+	rates[3] = g_format_size(deltas[J_STATISTICS_BYTES_SENT] * G_USEC_PER_SEC / duration);
+
+	ops = (gdouble)(deltas[J_STATISTICS_FILES_CREATED] + deltas[J_STATISTICS_FILES_DELETED] + deltas[J_STATISTICS_FILES_STATED] + deltas[J_STATISTICS_SYNC]) * G_USEC_PER_SEC / duration;
+
+	g_print("%-24s %6" G_GUINT64_FORMAT " %12s %12s %12s %12s %10.1f %8" G_GUINT64_FORMAT "\n",
+		name, connections, rates[0], rates[1], rates[2], rates[3], ops, deltas[J_STATISTICS_CHECKSUM_ERRORS]);
+
+	for (guint i = 0; i < G_N_ELEMENTS(rates); i++)
+	{
+		g_free(rates[i]);
+	}
+}
+
+/**
+ * Prints the rates between the previous and the current sample of all servers.
+ * Latency percentiles only cover the messages handled during the interval.
+ */
+static
+void
+print_rates (GArray* servers)
+{
+	guint64 deltas_total[STATISTICS_VALUES] = { 0 };
+	Latencies latencies_total = { 0, 0, 0, NULL };
+	guint64 connections_total = 0;
+	gint64 duration_total = 0;
+	guint valid = 0;
+	g_autoptr(GDateTime) now = NULL;
+	g_autofree gchar* now_string = NULL;
+
+	now = g_date_time_new_now_local();
+	now_string = g_date_time_format(now, "%Y-%m-%d %H:%M:%S");
+
+	/* Behave like top when writing to a terminal. */
+	if (isatty(STDOUT_FILENO))
+	{
+		g_print("\033[H\033[2J");
+	}
+
+	g_print("%s, %d s interval\n\n", now_string, opt_interval);
+	g_print("%-24s %6s %12s %12s %12s %12s %10s %8s\n", "SERVER", "CONN", "READ/s", "WRITTEN/s", "RECEIVED/s", "SENT/s", "OPS/s", "CHKERR");
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server const* server = &g_array_index(servers, Server, i);
+		Sample const* current = &(server->current);
+		Sample const* previous = &(server->previous);
+		guint64 deltas[STATISTICS_VALUES];
+		Latencies latencies;
+		gint64 duration;
+
+		if (!current->valid || !previous->valid || current->time <= previous->time)
+		{
+			g_print("%-24s %6s\n", server->host, (current->valid) ? "-" : "down");
+			continue;
+		}
+
+		duration = current->time - previous->time;
+
+		for (guint j = 0; j < STATISTICS_VALUES; j++)
+		{
+			deltas[j] = counter_delta(current->values[j], previous->values[j]);
+			deltas_total[j] += deltas[j];
+		}
+
+		print_rate_line(server->host, deltas, duration, (current->connections != G_MAXUINT64) ? current->connections : 0);
+
+		latencies_delta(&latencies, &(current->latencies), &(previous->latencies));
+		latencies_add(&latencies_total, &latencies);
+		g_free(latencies.counts);
+
+		if (current->connections != G_MAXUINT64)
+		{
+			connections_total += current->connections;
+		}
+
+		duration_total += duration;
+		valid++;
+	}
+
+	if (valid == 0)
+	{
+		return;
+	}
+
+	/* Servers are polled in parallel, so their intervals are nearly identical. */
+	duration_total /= valid;
+
+	if (servers->len > 1)
+	{
+		print_rate_line("Total", deltas_total, duration_total, connections_total);
+	}
+
+	if (latencies_total.counts != NULL)
+	{
+		g_print("\nLatencies\n");
+		print_latencies(&latencies_total, duration_total);
+	}
+
+	g_free(latencies_total.counts);
+}
+
+/**
+ * Returns name with all spaces replaced by underscores.
+ */
+static
+gchar*
+prometheus_name (gchar const* name)
+{
+	return g_strdelimit(g_strdup(name), " ", '_');
+}
+
+/**
+ * Prints the absolute counters of all servers in the OpenMetrics text format.
+ * Rates are left to the monitoring system.
+ */
+static
+void
+print_prometheus (GArray* servers)
+{
+	for (guint i = 0; i < STATISTICS_VALUES; i++)
+	{
+		g_print("# TYPE julea_%s counter\n", statistics_names[i]);
+
+		for (guint j = 0; j < servers->len; j++)
+		{
+			Server const* server = &g_array_index(servers, Server, j);
+
+			if (server->current.valid)
+			{
+				g_print("julea_%s_total{server=\"%s\"} %" G_GUINT64_FORMAT "\n", statistics_names[i], server->host, server->current.values[i]);
+			}
+		}
+	}
+
+	g_print("# TYPE julea_up gauge\n");
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server const* server = &g_array_index(servers, Server, i);
+
+		g_print("julea_up{server=\"%s\"} %d\n", server->host, (server->current.valid) ? 1 : 0);
+	}
+
+	for (guint i = 0; i < SCRUB_VALUES; i++)
+	{
+		g_print("# TYPE julea_%s counter\n", scrub_names[i]);
+
+		for (guint j = 0; j < servers->len; j++)
+		{
+			Server const* server = &g_array_index(servers, Server, j);
+
+			if (server->current.valid && server->current.scrub_valid)
+			{
+				g_print("julea_%s_total{server=\"%s\"} %" G_GUINT64_FORMAT "\n", scrub_names[i], server->host, server->current.scrub[i]);
+			}
+		}
+	}
+
+	g_print("# TYPE julea_connections gauge\n");
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server const* server = &g_array_index(servers, Server, i);
+
+		if (server->current.valid && server->current.connections != G_MAXUINT64)
+		{
+			g_print("julea_connections{server=\"%s\"} %" G_GUINT64_FORMAT "\n", server->host, server->current.connections);
+		}
+	}
+
+	g_print("# TYPE julea_latency_microseconds histogram\n");
+
+	for (guint i = 0; i < servers->len; i++)
+	{
+		Server const* server = &g_array_index(servers, Server, i);
+		Latencies const* latencies = &(server->current.latencies);
+
+		if (!server->current.valid || latencies->counts == NULL)
+		{
+			continue;
+		}
+
+		for (guint32 j = 0; j < latencies->types; j++)
+		{
+			for (guint32 k = 0; k < latencies->phases; k++)
+			{
+				guint64 const* counts;
+				g_autofree gchar* type = NULL;
+				gchar const* phase;
+				guint64 sum = 0;
+
+				counts = latencies->counts + ((j * latencies->phases) + k) * latencies->buckets;
+
+				for (guint32 l = 0; l < latencies->buckets; l++)
+				{
+					sum += counts[l];
+				}
+
+				/* Skip message types that were never handled to keep the output small. */
+				if (sum == 0)
+				{
+					continue;
+				}
+
+				type = prometheus_name((j < G_N_ELEMENTS(latency_types)) ? latency_types[j] : "unknown");
+				phase = (k < G_N_ELEMENTS(latency_phases)) ? latency_phases[k] : "unknown";
+				sum = 0;
+
+				/* The last bucket is unbounded. */
+				for (guint32 l = 0; l + 1 < latencies->buckets; l++)
+				{
+					sum += counts[l];
+					g_print("julea_latency_microseconds_bucket{server=\"%s\",type=\"%s\",phase=\"%s\",le=\"%" G_GUINT64_FORMAT "\"} %" G_GUINT64_FORMAT "\n",
+						server->host, type, phase, G_GUINT64_CONSTANT(1) << l, sum);
+				}
+
+				sum += counts[latencies->buckets - 1];
+				g_print("julea_latency_microseconds_bucket{server=\"%s\",type=\"%s\",phase=\"%s\",le=\"+Inf\"} %" G_GUINT64_FORMAT "\n", server->host, type, phase, sum);
+				g_print("julea_latency_microseconds_count{server=\"%s\",type=\"%s\",phase=\"%s\"} %" G_GUINT64_FORMAT "\n", server->host, type, phase, sum);
+			}
+		}
+	}
+
+	g_print("# EOF\n");
+}
+
+int
+main (int argc, char** argv)
+{
+	GError* error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	JConfiguration* configuration;
+	GArray* servers;
+	gint64 next;
+
+	GOptionEntry entries[] = {
+		{ "interval", 'i', 0, G_OPTION_ARG_INT, &opt_interval, "Poll the servers continuously and show rates (0 to print a single snapshot)", "0" },
+		{ "count", 'n', 0, G_OPTION_ARG_INT, &opt_count, "Stop after this many updates (0 for no limit)", "0" },
+		{ "prometheus", 0, 0, G_OPTION_ARG_NONE, &opt_prometheus, "Print the counters in the Prometheus/OpenMetrics text format", NULL },
+		{ NULL, 0, 0, 0, NULL, NULL, NULL }
+	};
+
+	context = g_option_context_new(NULL);
+	g_option_context_set_summary(context, "Shows the statistics of all object and key-value servers.");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		if (error)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+
+		return 1;
+	}
+
+	if (argc != 1 || opt_interval < 0 || opt_count < 0)
+	{
+		g_autofree gchar* help = NULL;
+
+		help = g_option_context_get_help(context, TRUE, NULL);
+		g_print("%s", help);
+
+		return 1;
+	}
+
+	j_init();
+
+	configuration = j_configuration();
+	servers = servers_new(configuration);
+
+	poll_servers(servers);
+
+	if (opt_interval == 0)
+	{
+		if (opt_prometheus)
+		{
+			print_prometheus(servers);
+		}
+		else
+		{
+			print_snapshot(servers);
+		}
+	}
+	else
+	{
+		next = g_get_monotonic_time();
+
+		if (opt_prometheus)
+		{
+			print_prometheus(servers);
+		}
+
+		for (gint i = 0; opt_count == 0 || i < opt_count; i++)
+		{
+			gint64 now;
+
+			/* Sleeping until a fixed deadline prevents the polling time from adding up. */
+			next += (gint64)opt_interval * G_USEC_PER_SEC;
+			now = g_get_monotonic_time();
+
+			if (next > now)
+			{
+				g_usleep(next - now);
+			}
+
+			poll_servers(servers);
+
+			if (opt_prometheus)
+			{
+				print_prometheus(servers);
+			}
+			else
+			{
+				print_rates(servers);
+			}
+		}
 	}
 
-	j_statistics_free(statistics_total);
+	servers_free(servers);
 
 	j_fini();
 
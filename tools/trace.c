@@ -0,0 +1,297 @@
+/*
+ * JULEA - Flexible storage framework
+ * Copyright (C) 2017 Michael Kuhn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <julea-config.h>
+
+#include <glib.h>
+
+#include <string.h>
+
+#include <julea.h>
+
+/**
+ * A clock record, used to convert tick counts to wall-clock time.
+ */
+struct Clock
+{
+	guint64 ticks;
+	guint64 time;
+};
+
+typedef struct Clock Clock;
+
+static Clock clock_first;
+static Clock clock_last;
+
+static
+gchar const*
+operation_name (guint op)
+{
+	switch (op)
+	{
+		case J_TRACE_FILE_CLOSE:
+			return "close";
+		case J_TRACE_FILE_CREATE:
+			return "create";
+		case J_TRACE_FILE_DELETE:
+			return "delete";
+		case J_TRACE_FILE_OPEN:
+			return "open";
+		case J_TRACE_FILE_READ:
+			return "read";
+		case J_TRACE_FILE_SEEK:
+			return "seek";
+		case J_TRACE_FILE_STATUS:
+			return "status";
+		case J_TRACE_FILE_SYNC:
+			return "sync";
+		case J_TRACE_FILE_WRITE:
+			return "write";
+		default:
+			return "unknown";
+	}
+}
+
+/**
+ * Converts a tick count to microseconds since the epoch.
+ * Interpolates between the first and last clock records of the file.
+ */
+static
+guint64
+ticks_to_time (guint64 ticks)
+{
+	gdouble rate = 1.0;
+
+	if (clock_last.ticks > clock_first.ticks && clock_last.time > clock_first.time)
+	{
+		rate = (gdouble)(clock_last.time - clock_first.time) / (clock_last.ticks - clock_first.ticks);
+	}
+
+	return clock_first.time + (gint64)(((gdouble)ticks - (gdouble)clock_first.ticks) * rate);
+}
+
+/**
+ * Iterates over the records of a trace file.
+ * Returns FALSE at the end of the file or if the file is truncated.
+ */
+static
+gboolean
+next_record (gchar const* data, gsize length, gsize* position, JTraceRecord* record, gchar const** payload)
+{
+	if (length - *position < sizeof(JTraceRecord))
+	{
+		return FALSE;
+	}
+
+	memcpy(record, data + *position, sizeof(JTraceRecord));
+
+	if (length - *position - sizeof(JTraceRecord) < record->size)
+	{
+		return FALSE;
+	}
+
+	*payload = data + *position + sizeof(JTraceRecord);
+	*position += sizeof(JTraceRecord) + record->size;
+
+	return TRUE;
+}
+
+static
+void
+print_event (JTraceEvent const* event, gchar const* thread, guint* depth, GHashTable* names)
+{
+	guint64 time;
+	gchar const* name;
+
+	time = ticks_to_time(event->ticks);
+	name = g_hash_table_lookup(names, GUINT_TO_POINTER(event->id));
+
+	if (event->type == J_TRACE_EVENT_LEAVE && *depth > 0)
+	{
+		(*depth)--;
+	}
+
+	g_print("[%" G_GUINT64_FORMAT ".%06" G_GUINT64_FORMAT "] %s: ", time / G_USEC_PER_SEC, time % G_USEC_PER_SEC, thread);
+
+	for (guint i = 0; i < *depth; i++)
+	{
+		g_print("  ");
+	}
+
+	switch (event->type)
+	{
+		case J_TRACE_EVENT_ENTER:
+			g_print("ENTER %s\n", name);
+			(*depth)++;
+			break;
+		case J_TRACE_EVENT_LEAVE:
+			g_print("LEAVE %s\n", name);
+			break;
+		case J_TRACE_EVENT_FILE_BEGIN:
+			g_print("BEGIN %s %s\n", operation_name(event->op), name);
+			break;
+		case J_TRACE_EVENT_FILE_END:
+			g_print("END %s %s", operation_name(event->op), name);
+
+			if (event->op == J_TRACE_FILE_READ || event->op == J_TRACE_FILE_WRITE)
+			{
+				g_print(" (length=%" G_GUINT64_FORMAT ", offset=%" G_GUINT64_FORMAT ")", event->value[0], event->value[1]);
+			}
+
+			g_print("\n");
+			break;
+		case J_TRACE_EVENT_COUNTER:
+			g_print("COUNTER %s %" G_GUINT64_FORMAT "\n", name, event->value[0]);
+			break;
+		default:
+			g_print("UNKNOWN %u\n", event->type);
+			break;
+	}
+}
+
+gint
+main (gint argc, gchar** argv)
+{
+	GError* error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GHashTable) names = NULL;
+	g_autoptr(GHashTable) depths = NULL;
+	GMappedFile* file;
+	JTraceRecord record;
+	gchar const* data;
+	gchar const* payload;
+	gsize length;
+	gsize position;
+	gsize magic_length;
+	gboolean have_clock = FALSE;
+
+	context = g_option_context_new("FILE");
+	g_option_context_set_summary(context, "Prints a trace written by the ring trace back-end (J_TRACE=ring).");
+
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		if (error)
+		{
+			g_printerr("%s\n", error->message);
+			g_error_free(error);
+		}
+
+		return 1;
+	}
+
+	if (argc != 2)
+	{
+		g_autofree gchar* help = NULL;
+
+		help = g_option_context_get_help(context, TRUE, NULL);
+		g_print("%s", help);
+
+		return 1;
+	}
+
+	if ((file = g_mapped_file_new(argv[1], FALSE, &error)) == NULL)
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+
+		return 1;
+	}
+
+	data = g_mapped_file_get_contents(file);
+	length = g_mapped_file_get_length(file);
+	magic_length = strlen(J_TRACE_RING_MAGIC);
+
+	if (length < magic_length || memcmp(data, J_TRACE_RING_MAGIC, magic_length) != 0)
+	{
+		g_printerr("%s is not a trace file.\n", argv[1]);
+		g_mapped_file_unref(file);
+
+		return 1;
+	}
+
+	names = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+	depths = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+
+	/* The first pass collects the clocks and names, since events can only be converted with both. */
+	position = magic_length;
+
+	while (next_record(data, length, &position, &record, &payload))
+	{
+		if (record.type == J_TRACE_RECORD_CLOCK && record.size == sizeof(Clock))
+		{
+			memcpy(&clock_last, payload, sizeof(Clock));
+
+			if (!have_clock)
+			{
+				clock_first = clock_last;
+				have_clock = TRUE;
+			}
+		}
+		else if (record.type >= J_TRACE_RECORD_THREAD && record.type <= J_TRACE_RECORD_COUNTER)
+		{
+			g_hash_table_insert(names, GUINT_TO_POINTER(record.id), g_strndup(payload, record.size));
+		}
+	}
+
+	position = magic_length;
+
+	while (next_record(data, length, &position, &record, &payload))
+	{
+		gchar const* thread;
+		guint* depth;
+
+		if (record.type != J_TRACE_RECORD_EVENTS && record.type != J_TRACE_RECORD_DROPPED)
+		{
+			continue;
+		}
+
+		thread = g_hash_table_lookup(names, GUINT_TO_POINTER(record.id));
+
+		if ((depth = g_hash_table_lookup(depths, GUINT_TO_POINTER(record.id))) == NULL)
+		{
+			depth = g_new0(guint, 1);
+			g_hash_table_insert(depths, GUINT_TO_POINTER(record.id), depth);
+		}
+
+		if (record.type == J_TRACE_RECORD_DROPPED && record.size == sizeof(guint64))
+		{
+			guint64 dropped;
+
+			memcpy(&dropped, payload, sizeof(dropped));
+			g_print("%s: DROPPED %" G_GUINT64_FORMAT " events\n", thread, dropped);
+
+			continue;
+		}
+		else if (record.type == J_TRACE_RECORD_DROPPED)
+		{
+			continue;
+		}
+
+		for (guint64 i = 0; i < record.size / sizeof(JTraceEvent); i++)
+		{
+			JTraceEvent event;
+
+			memcpy(&event, payload + (i * sizeof(JTraceEvent)), sizeof(JTraceEvent));
+			print_event(&event, thread, depth, names);
+		}
+	}
+
+	g_mapped_file_unref(file);
+
+	return 0;
+}